@@ -0,0 +1,17 @@
+find_path(ZSTD_INCLUDE_DIR
+  NAMES zstd.h
+)
+
+find_library(ZSTD_LIBRARY
+  NAMES zstd
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD
+  FOUND_VAR ZSTD_FOUND
+  REQUIRED_VARS
+    ZSTD_LIBRARY
+    ZSTD_INCLUDE_DIR
+)
+
+mark_as_advanced(ZSTD_INCLUDE_DIR ZSTD_LIBRARY)
@@ -53,6 +53,16 @@ bool Imager::isRunning()
     return ProgressNP.getState() == IPS_BUSY;
 }
 
+bool Imager::isPipelined()
+{
+    return PipelineSP[INDI_ENABLED].getState() == ISS_ON;
+}
+
+bool Imager::isLastImage()
+{
+    return group == maxGroup && image == maxImage;
+}
+
 bool Imager::isCCDConnected()
 {
     return StatusLP[CCD].getState() == IPS_OK;
@@ -132,15 +142,25 @@ void Imager::initiateNextCapture()
                 ProgressNP.apply();
                 return;
             }
-            CCDImageBinNP[HOR_BIN].setValue(currentGroup()->binning());
-            CCDImageBinNP[VER_BIN].setValue(currentGroup()->binning());
-            sendNewNumber(CCDImageBinNP);
+            // when pipelined, only what changed since the previous image is sent before the exposure
+            int binning = currentGroup()->binning();
+            if (!isPipelined() || binning != sentBinning)
+            {
+                CCDImageBinNP[HOR_BIN].setValue(binning);
+                CCDImageBinNP[VER_BIN].setValue(binning);
+                sendNewNumber(CCDImageBinNP);
+                sentBinning = binning;
+            }
             CCDImageExposureNP[0].setValue(currentGroup()->exposure());
             sendNewNumber(CCDImageExposureNP);
-            CCDUploadSettingsTP[UPLOAD_DIR].setText(ImageNameTP[IMAGE_FOLDER].getText());
-            CCDUploadSettingsTP[UPLOAD_PREFIX].setText("_TMP_");
-            sendNewSwitch(CCDUploadSP);
-            sendNewText(CCDUploadSettingsTP);
+            if (!isPipelined() || !sentUploadSettings)
+            {
+                CCDUploadSettingsTP[UPLOAD_DIR].setText(ImageNameTP[IMAGE_FOLDER].getText());
+                CCDUploadSettingsTP[UPLOAD_PREFIX].setText("_TMP_");
+                sendNewSwitch(CCDUploadSP);
+                sendNewText(CCDUploadSettingsTP);
+                sentUploadSettings = true;
+            }
             LOGF_DEBUG("Group %d of %d, image %d of %d, duration %.1fs, binning %d, capture initiated on %s", group,
                        maxGroup, image, maxImage, CCDImageExposureNP[0].getValue(), (int)CCDImageBinNP[HOR_BIN].getValue(),
                        CCDImageExposureNP.getDeviceName());
@@ -154,6 +174,8 @@ void Imager::startBatch()
     ProgressNP[GROUP].setValue(group = 1);
     ProgressNP[IMAGE].setValue(image = 1);
     maxImage                   = currentGroup()->count();
+    sentBinning                = 0;
+    sentUploadSettings         = false;
     ProgressNP.setState(IPS_BUSY);
     ProgressNP.apply();
     initiateNextFilter();
@@ -173,6 +195,31 @@ void Imager::batchDone()
     ProgressNP.apply();
 }
 
+void Imager::nextImage()
+{
+    if (image == maxImage)
+    {
+        if (group == maxGroup)
+        {
+            batchDone();
+        }
+        else
+        {
+            maxImage           = nextGroup()->count();
+            ProgressNP[GROUP].setValue(group = group + 1);
+            ProgressNP[IMAGE].setValue(image = 1);
+            ProgressNP.apply();
+            initiateNextFilter();
+        }
+    }
+    else
+    {
+        ProgressNP[IMAGE].setValue(image = image + 1);
+        ProgressNP.apply();
+        initiateNextFilter();
+    }
+}
+
 void Imager::initiateDownload()
 {
     int group = (int)DownloadNP[GROUP].getValue();
@@ -258,6 +305,10 @@ bool Imager::initProperties()
     BatchSP.fill(getDefaultName(), "BATCH", "Batch control", MAIN_CONTROL_TAB, IP_RW, ISR_NOFMANY,
                  60, IPS_IDLE);
 
+    PipelineSP[INDI_ENABLED].fill("INDI_ENABLED", "Enabled", ISS_OFF);
+    PipelineSP[INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    PipelineSP.fill(getDefaultName(), "PIPELINE", "Pipeline", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
     ImageNameTP[IMAGE_FOLDER].fill("IMAGE_FOLDER", "Image folder", "/tmp");
     ImageNameTP[IMAGE_NAME_PREFIX].fill("IMAGE_NAME_PREFIX", "Image prefix", "IMG");
     ImageNameTP.fill(getDefaultName(), "IMAGE_NAME", "Image name", OPTIONS_TAB, IP_RW, 60,
@@ -273,6 +324,7 @@ bool Imager::initProperties()
 
     defineProperty(GroupCountNP);
     defineProperty(ControlledDeviceTP);
+    defineProperty(PipelineSP);
     defineProperty(ImageNameTP);
 
     for (int i = 0; i < GroupCountNP[0].getValue(); i++)
@@ -401,6 +453,13 @@ bool Imager::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
             BatchSP.apply();
             return true;
         }
+        if (PipelineSP.isNameMatch(name))
+        {
+            PipelineSP.update(states, names, n);
+            PipelineSP.setState(IPS_OK);
+            PipelineSP.apply();
+            return true;
+        }
     }
     return DefaultDevice::ISNewSwitch(dev, name, states, names, n);
 }
@@ -532,35 +591,22 @@ void Imager::updateProperty(INDI::Property property)
             {
                 char name[128] = {0};
                 std::ofstream file;
+                int savedGroup = group, savedImage = image, savedMaxImage = maxImage;
 
                 strncpy(format, bp.getFormat(), 16);
                 sprintf(name, IMAGE_NAME, ImageNameTP[IMAGE_FOLDER].getText(), ImageNameTP[IMAGE_NAME_PREFIX].getText(), group, image, format);
+
+                // when pipelined, the next image is taken while this one is saved
+                bool ahead = isPipelined() && !isLastImage();
+                if (ahead)
+                    nextImage();
                 file.open(name, std::ios::out | std::ios::binary | std::ios::trunc);
                 file.write(static_cast<char *>(bp.getBlob()), bp.getBlobLen());
                 file.close();
-                LOGF_DEBUG("Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image, maxImage,
+                LOGF_DEBUG("Group %d of %d, image %d of %d, saved to %s", savedGroup, maxGroup, savedImage, savedMaxImage,
                            name);
-                if (image == maxImage)
-                {
-                    if (group == maxGroup)
-                    {
-                        batchDone();
-                    }
-                    else
-                    {
-                        maxImage           = nextGroup()->count();
-                        ProgressNP[GROUP].setValue(group = group + 1);
-                        ProgressNP[IMAGE].setValue(image = 1);
-                        ProgressNP.apply();
-                        initiateNextFilter();
-                    }
-                }
-                else
-                {
-                    ProgressNP[IMAGE].setValue(image = image + 1);
-                    ProgressNP.apply();
-                    initiateNextFilter();
-                }
+                if (!ahead)
+                    nextImage();
             }
         }
         return;
@@ -606,32 +652,21 @@ void Imager::updateProperty(INDI::Property property)
         INDI::PropertyText propertyText(property);
         char name[128] = {0};
 
-        strncpy(format, strrchr(propertyText[0].getText(), '.'), sizeof(format));
+        std::string path = propertyText[0].getText();
+        int savedGroup = group, savedImage = image, savedMaxImage = maxImage;
+
+        strncpy(format, strrchr(path.c_str(), '.'), sizeof(format));
         sprintf(name, IMAGE_NAME, ImageNameTP[IMAGE_FOLDER].getText(), ImageNameTP[IMAGE_NAME_PREFIX].getText(), group, image, format);
-        rename(propertyText[0].getText(), name);
-        LOGF_DEBUG("Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image,
-                   maxImage, name);
-        if (image == maxImage)
-        {
-            if (group == maxGroup)
-            {
-                batchDone();
-            }
-            else
-            {
-                maxImage           = nextGroup()->count();
-                ProgressNP[GROUP].setValue(group = group + 1);
-                ProgressNP[IMAGE].setValue(image = 1);
-                ProgressNP.apply();
-                initiateNextFilter();
-            }
-        }
-        else
-        {
-            ProgressNP[IMAGE].setValue(image = image + 1);
-            ProgressNP.apply();
-            initiateNextFilter();
-        }
+
+        // when pipelined, the next image is taken while this one is moved in place
+        bool ahead = isPipelined() && !isLastImage();
+        if (ahead)
+            nextImage();
+        rename(path.c_str(), name);
+        LOGF_DEBUG("Group %d of %d, image %d of %d, saved to %s", savedGroup, maxGroup, savedImage,
+                   savedMaxImage, name);
+        if (!ahead)
+            nextImage();
         return;
     }
 }
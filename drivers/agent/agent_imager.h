@@ -59,6 +59,8 @@ protected:
 
 private:
     bool isRunning();
+    bool isPipelined();
+    bool isLastImage();
     bool isCCDConnected();
     bool isFilterConnected();
     void defineProperties();
@@ -68,6 +70,7 @@ private:
     void startBatch();
     void abortBatch();
     void batchDone();
+    void nextImage();
     void initiateDownload();
 
     char format[16];
@@ -75,6 +78,8 @@ private:
     int maxGroup { 0 };
     int image { 0 };
     int maxImage { 0 };
+    int sentBinning { 0 };
+    bool sentUploadSettings { false };
     const char *controlledCCD { nullptr };
     const char *controlledFilterWheel { nullptr };
 
@@ -102,6 +107,8 @@ private:
     };
     INDI::PropertyLight StatusLP {2};
 
+    INDI::PropertySwitch PipelineSP {2};
+
     INDI::PropertyText ImageNameTP {2};
     enum
     {
@@ -96,6 +96,8 @@ bool ArduinoST4::Handshake()
 
 bool ArduinoST4::Disconnect()
 {
+    cancelGuideStop(AXIS_RA);
+    cancelGuideStop(AXIS_DE);
     sendCommand("DISCONNECT#");
 
     return INDI::DefaultDevice::Disconnect();
@@ -112,133 +114,43 @@ bool ArduinoST4::ISNewNumber(const char *dev, const char *name, double values[],
 
 IPState ArduinoST4::GuideNorth(uint32_t ms)
 {
-    LOGF_DEBUG("Guiding: N %.0f ms", ms);
-
-    if (GuideNSTID)
-    {
-        IERmTimer(GuideNSTID);
-        GuideNSTID = 0;
-    }
-
-    if (sendCommand("DEC+#") == false)
-        return IPS_ALERT;
-
-    guideDirection = ARD_N;
-    GuideNSTID      = IEAddTimer(static_cast<int>(ms), guideTimeoutHelperN, this);
-    return IPS_BUSY;
+    return startGuide(AXIS_DE, "N", "DEC+#", ms);
 }
 
 IPState ArduinoST4::GuideSouth(uint32_t ms)
 {
-    LOGF_DEBUG("Guiding: S %.0f ms", ms);
-
-    if (GuideNSTID)
-    {
-        IERmTimer(GuideNSTID);
-        GuideNSTID = 0;
-    }
-
-    if (sendCommand("DEC-#") == false)
-        return IPS_ALERT;
-
-    guideDirection = ARD_S;
-    GuideNSTID      = IEAddTimer(static_cast<int>(ms), guideTimeoutHelperS, this);
-    return IPS_BUSY;
+    return startGuide(AXIS_DE, "S", "DEC-#", ms);
 }
 
 IPState ArduinoST4::GuideEast(uint32_t ms)
 {
-    LOGF_DEBUG("Guiding: E %.0f ms", ms);
-
-    if (GuideWETID)
-    {
-        IERmTimer(GuideWETID);
-        GuideWETID = 0;
-    }
-
-    if (sendCommand("RA+#") == false)
-        return IPS_ALERT;
-
-    guideDirection = ARD_E;
-    GuideWETID      = IEAddTimer(static_cast<int>(ms), guideTimeoutHelperE, this);
-    return IPS_BUSY;
+    return startGuide(AXIS_RA, "E", "RA+#", ms);
 }
 
 IPState ArduinoST4::GuideWest(uint32_t ms)
 {
-    LOGF_DEBUG("Guiding: W %.0f ms", ms);
-
-    if (GuideWETID)
-    {
-        IERmTimer(GuideWETID);
-        GuideWETID = 0;
-    }
-
-    if (sendCommand("RA-#") == false)
-        return IPS_ALERT;
-
-    guideDirection = ARD_W;
-    GuideWETID      = IEAddTimer(static_cast<int>(ms), guideTimeoutHelperE, this);
-    return IPS_BUSY;
+    return startGuide(AXIS_RA, "W", "RA-#", ms);
 }
 
-//GUIDE The timer helper functions.
-void ArduinoST4::guideTimeoutHelperN(void *p)
-{
-    static_cast<ArduinoST4 *>(p)->guideTimeout(ARD_N);
-}
-void ArduinoST4::guideTimeoutHelperS(void *p)
-{
-    static_cast<ArduinoST4 *>(p)->guideTimeout(ARD_S);
-}
-void ArduinoST4::guideTimeoutHelperW(void *p)
-{
-    static_cast<ArduinoST4 *>(p)->guideTimeout(ARD_W);
-}
-void ArduinoST4::guideTimeoutHelperE(void *p)
+IPState ArduinoST4::startGuide(INDI_EQ_AXIS axis, const char *label, const char *command, uint32_t ms)
 {
-    static_cast<ArduinoST4 *>(p)->guideTimeout(ARD_E);
-}
-
-void ArduinoST4::guideTimeout(ARDUINO_DIRECTION direction)
-{
-    if (direction == ARD_N || direction == ARD_S)
-    {
-        if (sendCommand("DEC0#"))
-        {
-            GuideNSNP.setState(IPS_IDLE);
-            LOG_DEBUG("Guiding: DEC axis stopped.");
-        }
-        else
-        {
-            GuideNSNP.setState(IPS_ALERT);
-            LOG_ERROR("Failed to stop DEC axis.");
-        }
+    LOGF_DEBUG("Guiding: %s %u ms", label, ms);
 
-        GuideNSTID            = 0;
-        GuideNSNP[0].setValue(0);
-        GuideNSNP[1].setValue(0);
-        GuideNSNP.apply();
-    }
+    // A pulse still pending on the axis is replaced by this one, or stopped on time if it fails
+    if (sendCommand(command) == false)
+        return IPS_ALERT;
 
-    if (direction == ARD_W || direction == ARD_E)
+    // The stop command is sent from the guide pulse thread, never while a guide command is being sent
+    const char *axisName = (axis == AXIS_DE) ? "DEC" : "RA";
+    const char *stopCommand = (axis == AXIS_DE) ? "DEC0#" : "RA0#";
+    scheduleGuideStop(axis, ms, [this, axisName, stopCommand]()
     {
-        if (sendCommand("RA0#"))
-        {
-            GuideNSNP.setState(IPS_IDLE);
-            LOG_DEBUG("Guiding: RA axis stopped.");
-        }
+        if (sendCommand(stopCommand))
+            LOGF_DEBUG("Guiding: %s axis stopped.", axisName);
         else
-        {
-            LOG_ERROR("Failed to stop RA axis.");
-            GuideNSNP.setState(IPS_ALERT);
-        }
-
-        GuideWENP[0].setValue(0);
-        GuideWENP[1].setValue(0);
-        GuideWETID            = 0;
-        GuideWENP.apply();
-    }
+            LOGF_ERROR("Failed to stop %s axis.", axisName);
+    });
+    return IPS_BUSY;
 }
 
 bool ArduinoST4::sendCommand(const char *cmd)
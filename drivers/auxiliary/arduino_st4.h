@@ -47,8 +47,6 @@ class ArduinoST4 : public INDI::DefaultDevice, public INDI::GuiderInterface
 
         virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override ;
 
-        void guideTimeout(ARDUINO_DIRECTION direction);
-
     protected:
         const char *getDefaultName() override;
 
@@ -58,19 +56,10 @@ class ArduinoST4 : public INDI::DefaultDevice, public INDI::GuiderInterface
         virtual IPState GuideEast(uint32_t ms) override;
         virtual IPState GuideWest(uint32_t ms) override;
 
-        // Helper functions
-        static void guideTimeoutHelperN(void *p);
-        static void guideTimeoutHelperS(void *p);
-        static void guideTimeoutHelperW(void *p);
-        static void guideTimeoutHelperE(void *p);
-
     private:
         bool Handshake();
         bool sendCommand(const char *cmd);
-
-        int GuideNSTID { -1 };
-        int GuideWETID { -1 };
-        ARDUINO_DIRECTION guideDirection;
+        IPState startGuide(INDI_EQ_AXIS axis, const char *label, const char *command, uint32_t ms);
 
         int PortFD { -1 };
 
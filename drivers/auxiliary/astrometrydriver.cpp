@@ -24,19 +24,35 @@
 
 #include "astrometrydriver.h"
 
+#include "indithreadpool.h"
+#include "libastro.h"
+
 #include <memory>
 
 #include <cerrno>
 #include <cstring>
 
+#include <dirent.h>
+#include <libnova/julian_day.h>
+#include <unistd.h>
 #include <zlib.h>
 
+// Images waiting for a worker, per worker, before new ones are dropped
+#define MAX_QUEUED_PER_WORKER 2
+
 // We declare an auto pointer to AstrometryDriver.
 std::unique_ptr<AstrometryDriver> astrometry(new AstrometryDriver());
 
 AstrometryDriver::AstrometryDriver()
 {
-    setVersion(1, 0);
+    setVersion(1, 1);
+}
+
+AstrometryDriver::~AstrometryDriver()
+{
+    // The queued images are dropped, the running solves are left as soon as they print a line
+    m_Generation++;
+    m_Solvers.reset();
 }
 
 bool AstrometryDriver::initProperties()
@@ -72,6 +88,16 @@ bool AstrometryDriver::initProperties()
     IUFillNumberVector(&SolverResultNP, SolverResultN, 5, getDeviceName(), "ASTROMETRY_RESULTS", "Results",
                        MAIN_CONTROL_TAB, IP_RO, 0, IPS_IDLE);
 
+    // Solver Hint
+    IUFillNumber(&SolverHintN[0], "ASTROMETRY_HINT_RADIUS", "Radius (deg)", "%.1f", 0, 180, 1, 15);
+    IUFillNumberVector(&SolverHintNP, SolverHintN, 1, getDeviceName(), "ASTROMETRY_HINT", "Mount Hint", OPTIONS_TAB,
+                       IP_RW, 0, IPS_IDLE);
+
+    // Solver Workers
+    IUFillNumber(&SolverWorkersN[0], "ASTROMETRY_WORKERS_COUNT", "Workers", "%.f", 1, 16, 1, 1);
+    IUFillNumberVector(&SolverWorkersNP, SolverWorkersN, 1, getDeviceName(), "ASTROMETRY_WORKERS", "Solvers",
+                       OPTIONS_TAB, IP_RW, 0, IPS_IDLE);
+
     // Solver Data Blob
     IUFillBLOB(&SolverDataB[0], "ASTROMETRY_DATA_BLOB", "Image", "");
     IUFillBLOBVector(&SolverDataBP, SolverDataB, 1, getDeviceName(), "ASTROMETRY_DATA", "Upload", MAIN_CONTROL_TAB,
@@ -82,8 +108,9 @@ bool AstrometryDriver::initProperties()
     /**********************************************/
 
     // Snooped Devices
-    IUFillText(&ActiveDeviceT[0], "ACTIVE_CCD", "CCD", "CCD Simulator");
-    IUFillTextVector(&ActiveDeviceTP, ActiveDeviceT, 1, getDeviceName(), "ACTIVE_DEVICES", "Snoop devices", OPTIONS_TAB,
+    IUFillText(&ActiveDeviceT[ACTIVE_CCD], "ACTIVE_CCD", "CCD", "CCD Simulator");
+    IUFillText(&ActiveDeviceT[ACTIVE_TELESCOPE], "ACTIVE_TELESCOPE", "Telescope", "");
+    IUFillTextVector(&ActiveDeviceTP, ActiveDeviceT, 2, getDeviceName(), "ACTIVE_DEVICES", "Snoop devices", OPTIONS_TAB,
                      IP_RW, 60, IPS_IDLE);
 
     // Primary CCD Chip Data Blob
@@ -94,6 +121,8 @@ bool AstrometryDriver::initProperties()
     IDSnoopDevice(ActiveDeviceT[0].text, "CCD1");
     IDSnoopBLOBs(ActiveDeviceT[0].text, "CCD1", B_ONLY);
 
+    snoopMount();
+
     addDebugControl();
 
     setDriverInterface(AUX_INTERFACE);
@@ -106,6 +135,49 @@ void AstrometryDriver::ISGetProperties(const char *dev)
     DefaultDevice::ISGetProperties(dev);
 
     defineProperty(&ActiveDeviceTP);
+    defineProperty(&SolverHintNP);
+    defineProperty(&SolverWorkersNP);
+}
+
+void AstrometryDriver::snoopMount()
+{
+    const char *mount = ActiveDeviceT[ACTIVE_TELESCOPE].text;
+
+    if (!m_MountSnoops.empty())
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            m_MountValid = m_MountJ2000 = false;
+        }
+        for (int id : m_MountSnoops)
+            setSnoopDevice(id, mount);
+        return;
+    }
+
+    // The J2000 coordinates are used as they are, the ones of date only until the mount sends J2000 ones
+    m_MountSnoops.push_back(snoopProperty(INDI::SnoopRouter::NUMBER, mount, "EQUATORIAL_COORD", {"RA", "DEC"},
+                                          [this](const INDI::SnoopUpdate & update)
+    {
+        if (!update.has(0) || !update.has(1))
+            return;
+        std::lock_guard<std::mutex> guard(lock);
+        m_MountRA = update.number(0);
+        m_MountDE = update.number(1);
+        m_MountValid = m_MountJ2000 = true;
+    }));
+
+    m_MountSnoops.push_back(snoopProperty(INDI::SnoopRouter::NUMBER, mount, "EQUATORIAL_EOD_COORD", {"RA", "DEC"},
+                                          [this](const INDI::SnoopUpdate & update)
+    {
+        if (!update.has(0) || !update.has(1) || m_MountJ2000)
+            return;
+        INDI::IEquatorialCoordinates observed { update.number(0), update.number(1) }, J2000Pos;
+        INDI::ObservedToJ2000(&observed, ln_get_julian_from_sys(), &J2000Pos);
+        std::lock_guard<std::mutex> guard(lock);
+        m_MountRA = J2000Pos.rightascension;
+        m_MountDE = J2000Pos.declination;
+        m_MountValid = true;
+    }));
 }
 
 bool AstrometryDriver::updateProperties()
@@ -149,6 +221,28 @@ bool AstrometryDriver::Disconnect()
 
 bool AstrometryDriver::ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
 {
+    if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
+    {
+        if (strcmp(name, SolverHintNP.name) == 0)
+        {
+            IUUpdateNumber(&SolverHintNP, values, names, n);
+            SolverHintNP.s = IPS_OK;
+            IDSetNumber(&SolverHintNP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, SolverWorkersNP.name) == 0)
+        {
+            IUUpdateNumber(&SolverWorkersNP, values, names, n);
+            SolverWorkersNP.s = IPS_OK;
+            if (m_Jobs > 0)
+                IDSetNumber(&SolverWorkersNP, "Solver workers are changed once the queued images are solved.");
+            else
+                IDSetNumber(&SolverWorkersNP, nullptr);
+            return true;
+        }
+    }
+
     return INDI::DefaultDevice::ISNewNumber(dev, name, values, names, n);
 }
 
@@ -198,6 +292,7 @@ bool AstrometryDriver::ISNewText(const char *dev, const char *name, char *texts[
             strncpy(CCDDataBP.device, ActiveDeviceT[0].text, MAXINDIDEVICE);
             IDSnoopDevice(ActiveDeviceT[0].text, "CCD1");
             IDSnoopBLOBs(ActiveDeviceT[0].text, "CCD1", B_ONLY);
+            snoopMount();
 
             //  We processed this one, so, tell the world we did it
             return true;
@@ -222,7 +317,7 @@ bool AstrometryDriver::ISNewSwitch(const char *dev, const char *name, ISState *s
         // Astrometry Enable/Disable
         if (strcmp(name, SolverSP.name) == 0)
         {
-            pthread_mutex_lock(&lock);
+            std::lock_guard<std::mutex> guard(lock);
 
             IUUpdateSwitch(&SolverSP, states, names, n);
             SolverSP.s = IPS_OK;
@@ -234,13 +329,13 @@ bool AstrometryDriver::ISNewSwitch(const char *dev, const char *name, ISState *s
             }
             else
             {
+                // Drop the queued images and leave the running solves
+                m_Generation++;
                 LOG_INFO("Astrometry solver is disabled.");
                 deleteProperty(SolverResultNP.name);
             }
 
             IDSetSwitch(&SolverSP, nullptr);
-
-            pthread_mutex_unlock(&lock);
             return true;
         }
     }
@@ -264,33 +359,25 @@ bool AstrometryDriver::saveConfigItems(FILE *fp)
 {
     IUSaveConfigText(fp, &ActiveDeviceTP);
     IUSaveConfigText(fp, &SolverSettingsTP);
+    IUSaveConfigNumber(fp, &SolverHintNP);
+    IUSaveConfigNumber(fp, &SolverWorkersNP);
     return true;
 }
 
 bool AstrometryDriver::processBLOB(uint8_t *data, uint32_t size, uint32_t len)
 {
-    FILE *fp = nullptr;
-    char imageFileName[MAXRBUF];
-
-    uint8_t *processedData = data;
+    SolveJob job;
 
     // If size != len then we have compressed buffer
     if (size != len)
     {
-        uint8_t *dataBuffer = new uint8_t[size];
-        uLongf destLen      = size;
-
-        if (dataBuffer == nullptr)
-        {
-            LOG_DEBUG("Unable to allocate memory for data buffer");
-            return false;
-        }
+        job.image.resize(size);
+        uLongf destLen = size;
 
-        int r = uncompress(dataBuffer, &destLen, data, len);
+        int r = uncompress(job.image.data(), &destLen, data, len);
         if (r != Z_OK)
         {
             LOGF_ERROR("Astrometry compression error: %d", r);
-            delete[] dataBuffer;
             return false;
         }
 
@@ -298,73 +385,127 @@ bool AstrometryDriver::processBLOB(uint8_t *data, uint32_t size, uint32_t len)
         {
             LOGF_WARN("Discrepancy between uncompressed data size %ld and expected size %ld",
                       size, destLen);
+            job.image.resize(destLen);
         }
-
-        processedData = dataBuffer;
     }
+    else
+        job.image.assign(data, data + size);
 
-    strncpy(imageFileName, "/tmp/ccdsolver.fits", MAXRBUF);
+    size_t workers = static_cast<size_t>(SolverWorkersN[0].value);
 
-    fp = fopen(imageFileName, "w");
-    if (fp == nullptr)
+    // The pool is resized once it has nothing left to do
+    if (m_Solvers == nullptr || (m_Jobs == 0 && m_Solvers->threadCount() != workers))
     {
-        LOGF_ERROR("Unable to save image file (%s). %s", imageFileName, strerror(errno));
-        if (size != len)
-            delete[] processedData;
+        m_Solvers.reset();
+        m_Solvers.reset(new INDI::ThreadPool(workers));
+    }
 
+    if (m_Solvers->pending() >= m_Solvers->threadCount() * MAX_QUEUED_PER_WORKER)
+    {
+        LOG_WARN("Solver queue is full, image dropped.");
         return false;
     }
 
-    int n = 0;
-    for (uint32_t nr = 0; nr < size; nr += n)
-        n = fwrite(processedData + nr, 1, size - nr, fp);
-
-    fclose(fp);
+    job.binary  = SolverSettingsT[ASTROMETRY_SETTINGS_BINARY].text;
+    job.options = SolverSettingsT[ASTROMETRY_SETTINGS_OPTIONS].text;
 
-    // Do not forget to release uncompressed buffer
-    if (size != len)
-        delete[] processedData;
+    std::lock_guard<std::mutex> guard(lock);
+    job.generation = m_Generation;
+    if (m_MountValid && SolverHintN[0].value > 0)
+    {
+        job.hint   = true;
+        job.ra     = m_MountRA * 15.0;
+        job.de     = m_MountDE;
+        job.radius = SolverHintN[0].value;
+    }
 
-    pthread_mutex_lock(&lock);
+    m_Jobs++;
     SolverSP.s = IPS_BUSY;
-    LOG_INFO("Solving image...");
+    LOGF_INFO("Solving image... (%d in progress)", m_Jobs.load());
     IDSetSwitch(&SolverSP, nullptr);
-    pthread_mutex_unlock(&lock);
-
-    int result = pthread_create(&solverThread, nullptr, &AstrometryDriver::runSolverHelper, this);
 
-    if (result != 0)
+    auto shared = std::make_shared<SolveJob>(std::move(job));
+    m_Solvers->post([this, shared]()
     {
-        SolverSP.s = IPS_ALERT;
-        LOGF_INFO("Failed to create solver thread: %s", strerror(errno));
-        IDSetSwitch(&SolverSP, nullptr);
-    }
+        runSolver(*shared);
+    });
 
     return true;
 }
 
-void *AstrometryDriver::runSolverHelper(void *context)
+void AstrometryDriver::finishJob(IPState state, const char *message)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    // Another image still being solved keeps the solver busy
+    if (--m_Jobs > 0 && state != IPS_OK)
+        state = IPS_BUSY;
+    SolverSP.s = state;
+    IDSetSwitch(&SolverSP, nullptr);
+    LOG_INFO(message);
+}
+
+// Remove the files solve-field wrote in its own directory, and the directory
+static void removeSolverDir(const char *dir)
 {
-    (static_cast<AstrometryDriver *>(context))->runSolver();
-    return nullptr;
+    DIR *dp = opendir(dir);
+    if (dp != nullptr)
+    {
+        for (struct dirent *entry; (entry = readdir(dp)) != nullptr;)
+        {
+            if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+                continue;
+            std::string path = std::string(dir) + "/" + entry->d_name;
+            unlink(path.c_str());
+        }
+        closedir(dp);
+    }
+    rmdir(dir);
 }
 
-void AstrometryDriver::runSolver()
+void AstrometryDriver::runSolver(const SolveJob &job)
 {
-    char cmd[MAXRBUF] = {0}, line[256] = {0}, parity_str[8] = {0};
+    if (job.generation != m_Generation)
+    {
+        finishJob(IPS_IDLE, "Solver canceled.");
+        return;
+    }
+
+    // Each image gets its own directory, so the workers never share solve-field files
+    char dir[] = "/tmp/indi_astrometry_XXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        LOGF_ERROR("Unable to create solver directory. %s", strerror(errno));
+        finishJob(IPS_ALERT, "Solver failed.");
+        return;
+    }
+
+    std::string imageFileName = std::string(dir) + "/ccdsolver.fits";
+    FILE *fp = fopen(imageFileName.c_str(), "w");
+    if (fp == nullptr || fwrite(job.image.data(), 1, job.image.size(), fp) != job.image.size())
+    {
+        LOGF_ERROR("Unable to save image file (%s). %s", imageFileName.c_str(), strerror(errno));
+        if (fp != nullptr)
+            fclose(fp);
+        removeSolverDir(dir);
+        finishJob(IPS_ALERT, "Solver failed.");
+        return;
+    }
+    fclose(fp);
+
+    char cmd[MAXRBUF] = {0}, hint[128] = {0}, line[256] = {0}, parity_str[8] = {0};
     float ra = -1000, dec = -1000, angle = -1000, pixscale = -1000, parity = 0;
-    snprintf(cmd, MAXRBUF, "%s %s -W /tmp/solution.wcs /tmp/ccdsolver.fits",
-             SolverSettingsT[ASTROMETRY_SETTINGS_BINARY].text, SolverSettingsT[ASTROMETRY_SETTINGS_OPTIONS].text);
+    if (job.hint)
+        snprintf(hint, sizeof(hint), "--ra %f --dec %f --radius %f", job.ra, job.de, job.radius);
+    snprintf(cmd, MAXRBUF, "%s %s %s -D %s -W %s/solution.wcs %s", job.binary.c_str(), job.options.c_str(), hint, dir,
+             dir, imageFileName.c_str());
 
     LOGF_DEBUG("%s", cmd);
     FILE *handle = popen(cmd, "r");
     if (handle == nullptr)
     {
         LOGF_DEBUG("Failed to run solver: %s", strerror(errno));
-        pthread_mutex_lock(&lock);
-        SolverSP.s = IPS_ALERT;
-        IDSetSwitch(&SolverSP, nullptr);
-        pthread_mutex_unlock(&lock);
+        removeSolverDir(dir);
+        finishJob(IPS_ALERT, "Solver failed.");
         return;
     }
 
@@ -384,50 +525,39 @@ void AstrometryDriver::runSolver()
 
         if (ra != -1000 && dec != -1000 && angle != -1000 && pixscale != -1000)
         {
-            // Pixscale is arcsec/pixel. Astrometry result is in arcmin
-            SolverResultN[ASTROMETRY_RESULTS_PIXSCALE].value = pixscale;
-            // Astrometry.net angle, E of N
-            SolverResultN[ASTROMETRY_RESULTS_ORIENTATION].value = angle;
-            // Astrometry.net J2000 RA in degrees
-            SolverResultN[ASTROMETRY_RESULTS_RA].value = ra;
-            // Astrometry.net J2000 DEC in degrees
-            SolverResultN[ASTROMETRY_RESULTS_DE].value = dec;
-            // Astrometry.net parity
-            SolverResultN[ASTROMETRY_RESULTS_PARITY].value = parity;
-
-            SolverResultNP.s = IPS_OK;
-            IDSetNumber(&SolverResultNP, nullptr);
-
-            pthread_mutex_lock(&lock);
-            SolverSP.s = IPS_OK;
-            IDSetSwitch(&SolverSP, nullptr);
-            pthread_mutex_unlock(&lock);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                // Pixscale is arcsec/pixel. Astrometry result is in arcmin
+                SolverResultN[ASTROMETRY_RESULTS_PIXSCALE].value = pixscale;
+                // Astrometry.net angle, E of N
+                SolverResultN[ASTROMETRY_RESULTS_ORIENTATION].value = angle;
+                // Astrometry.net J2000 RA in degrees
+                SolverResultN[ASTROMETRY_RESULTS_RA].value = ra;
+                // Astrometry.net J2000 DEC in degrees
+                SolverResultN[ASTROMETRY_RESULTS_DE].value = dec;
+                // Astrometry.net parity
+                SolverResultN[ASTROMETRY_RESULTS_PARITY].value = parity;
+
+                SolverResultNP.s = IPS_OK;
+                IDSetNumber(&SolverResultNP, nullptr);
+            }
 
             pclose(handle);
-            LOG_INFO("Solver complete.");
+            removeSolverDir(dir);
+            finishJob(IPS_OK, "Solver complete.");
             return;
         }
 
-        pthread_mutex_lock(&lock);
-        if (SolverS[SOLVER_DISABLE].s == ISS_ON)
+        if (job.generation != m_Generation)
         {
-            SolverSP.s = IPS_IDLE;
-            IDSetSwitch(&SolverSP, nullptr);
-            pthread_mutex_unlock(&lock);
             pclose(handle);
-            LOG_INFO("Solver canceled.");
+            removeSolverDir(dir);
+            finishJob(IPS_IDLE, "Solver canceled.");
             return;
         }
-        pthread_mutex_unlock(&lock);
     }
 
     pclose(handle);
-
-    pthread_mutex_lock(&lock);
-    SolverSP.s = IPS_ALERT;
-    IDSetSwitch(&SolverSP, nullptr);
-    LOG_INFO("Solver failed.");
-    pthread_mutex_unlock(&lock);
-
-    pthread_exit(nullptr);
+    removeSolverDir(dir);
+    finishJob(IPS_ALERT, "Solver failed.");
 }
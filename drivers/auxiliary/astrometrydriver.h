@@ -26,7 +26,16 @@
 
 #include "defaultdevice.h"
 
-#include <pthread.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace INDI
+{
+class ThreadPool;
+}
 
 /**
  * @brief The AstrometryDriver class is an INDI driver frontend for astrometry.net
@@ -39,6 +48,10 @@
  * The solver settings should be set before running the solver in order to ensure correct and timely response from astrometry.net
  * It is assumed that astrometry.net is property set-up in the same machine the driver is running along with the appropriate index files.
  *
+ * Images are solved by a pool of workers, several solve-field processes running at once as set in Options.
+ * Images received while all the workers are busy wait in a queue. When the mount to snoop is set, its
+ * coordinates restrict the search to the hint radius around them.
+ *
  * If the solver is successful, the driver sets the solver results which include:
  * + Pixel Scale (arcsec/pixel).
  * + Orientation (E or W) degrees.
@@ -66,8 +79,14 @@ class AstrometryDriver : public INDI::DefaultDevice
             ASTROMETRY_RESULTS_PARITY
         };
 
+        enum
+        {
+            ACTIVE_CCD,
+            ACTIVE_TELESCOPE
+        };
+
         AstrometryDriver();
-        ~AstrometryDriver() = default;
+        ~AstrometryDriver();
 
         virtual void ISGetProperties(const char *dev) override;
         virtual bool initProperties() override;
@@ -80,8 +99,6 @@ class AstrometryDriver : public INDI::DefaultDevice
                                char *formats[], char *names[], int n) override;
         virtual bool ISSnoopDevice(XMLEle *root) override;
 
-        static void *runSolverHelper(void *context);
-
     protected:
         //  Generic indi device entries
         bool Connect() override;
@@ -106,7 +123,15 @@ class AstrometryDriver : public INDI::DefaultDevice
         INumberVectorProperty SolverResultNP;
 
         ITextVectorProperty ActiveDeviceTP;
-        IText ActiveDeviceT[1] {};
+        IText ActiveDeviceT[2] {};
+
+        // Search radius around the mount coordinates, 0 to search the whole sky
+        INumber SolverHintN[1];
+        INumberVectorProperty SolverHintNP;
+
+        // Number of images solved at once
+        INumber SolverWorkersN[1];
+        INumberVectorProperty SolverWorkersNP;
 
         IBLOBVectorProperty SolverDataBP;
         IBLOB SolverDataB[1];
@@ -115,12 +140,27 @@ class AstrometryDriver : public INDI::DefaultDevice
         IBLOBVectorProperty CCDDataBP;
 
     private:
-        // Run solver thread
-        void runSolver();
+        /** An image waiting for a worker, with what is needed to solve it. */
+        struct SolveJob
+        {
+            std::vector<uint8_t> image;
+            std::string binary;
+            std::string options;
+            bool hint {false};
+            double ra {0};      // J2000 degrees
+            double de {0};      // J2000 degrees
+            double radius {0};  // degrees
+            uint64_t generation {0};
+        };
+
+        // Run solve-field on one image, from a worker of the pool
+        void runSolver(const SolveJob &job);
+
+        // Report the outcome of a solve, the solver stays busy while other images are queued
+        void finishJob(IPState state, const char *message);
 
         /**
-         * @brief processBLOB Read blob FITS. Uncompress if necessary, write to temporary file, and run
-         * solver against it.
+         * @brief processBLOB Read blob FITS. Uncompress if necessary, and queue it to the solver workers.
          * @param data raw data FITS buffer
          * @param size size of FITS data
          * @param len size of raw data. If no compression is used then len = size. If compression is used,
@@ -129,7 +169,20 @@ class AstrometryDriver : public INDI::DefaultDevice
          */
         bool processBLOB(uint8_t *data, uint32_t size, uint32_t len);
 
-        // Thread for listenINDI()
-        pthread_t solverThread;
-        pthread_mutex_t lock;
+        // Set the snoop subscriptions to the mount coordinates
+        void snoopMount();
+
+        std::unique_ptr<INDI::ThreadPool> m_Solvers;
+        // Solves queued or running
+        std::atomic<int> m_Jobs {0};
+        // Bumped to drop the queued and running solves
+        std::atomic<uint64_t> m_Generation {0};
+        std::mutex lock;
+
+        // Last mount position, J2000
+        bool m_MountValid {false};
+        bool m_MountJ2000 {false};
+        double m_MountRA {0};   // hours
+        double m_MountDE {0};   // degrees
+        std::vector<int> m_MountSnoops;
 };
@@ -144,99 +144,36 @@ void GPUSB::debugTriggered(bool enable)
 
 IPState GPUSB::GuideNorth(uint32_t ms)
 {
-    RemoveTimer(NSTimerID);
-
-    driver->startPulse(GPUSB_NORTH);
-
-    NSDirection = GPUSB_NORTH;
-
-    LOG_DEBUG("Starting NORTH guide");
-
-    NSPulseRequest = ms;
-
-    NSGuideTS = std::chrono::system_clock::now();
-
-    NSTimerID = IEAddTimer(ms, &GPUSB::NSTimerHelper, this);
-
-    return IPS_BUSY;
+    return startGuide(AXIS_DE, GPUSB_NORTH, "NORTH", ms);
 }
 
 IPState GPUSB::GuideSouth(uint32_t ms)
 {
-    RemoveTimer(NSTimerID);
-
-    driver->startPulse(GPUSB_SOUTH);
-
-    NSDirection = GPUSB_SOUTH;
-
-    LOG_DEBUG("Starting SOUTH guide");
-
-    NSPulseRequest = ms;
-
-    NSGuideTS = std::chrono::system_clock::now();
-
-    NSTimerID = IEAddTimer(ms, &GPUSB::NSTimerHelper, this);
-
-    return IPS_BUSY;
+    return startGuide(AXIS_DE, GPUSB_SOUTH, "SOUTH", ms);
 }
 
 IPState GPUSB::GuideEast(uint32_t ms)
 {
-    RemoveTimer(WETimerID);
-
-    driver->startPulse(GPUSB_EAST);
-
-    WEDirection = GPUSB_EAST;
-
-    LOG_DEBUG("Starting EAST guide");
-
-    WEPulseRequest = ms;
-
-    WEGuideTS = std::chrono::system_clock::now();
-
-    WETimerID = IEAddTimer(ms, &GPUSB::WETimerHelper, this);
-
-    return IPS_BUSY;
+    return startGuide(AXIS_RA, GPUSB_EAST, "EAST", ms);
 }
 
 IPState GPUSB::GuideWest(uint32_t ms)
 {
-    RemoveTimer(WETimerID);
-
-    driver->startPulse(GPUSB_WEST);
-
-    WEDirection = GPUSB_WEST;
-
-    LOG_DEBUG("Starting WEST guide");
-
-    WEPulseRequest = ms;
-
-    WEGuideTS = std::chrono::system_clock::now();
-
-    WETimerID = IEAddTimer(ms, &GPUSB::WETimerHelper, this);
-
-    return IPS_BUSY;
+    return startGuide(AXIS_RA, GPUSB_WEST, "WEST", ms);
 }
 
-void GPUSB::NSTimerHelper(void *context)
+IPState GPUSB::startGuide(INDI_EQ_AXIS axis, int direction, const char *label, uint32_t ms)
 {
-    static_cast<GPUSB*>(context)->NSTimerCallback();
-}
+    // startPulse() replaces the pulse running on the axis, and so does its end
+    driver->startPulse(direction);
 
-void GPUSB::WETimerHelper(void *context)
-{
-    static_cast<GPUSB*>(context)->WETimerCallback();
-}
+    LOGF_DEBUG("Starting %s guide", label);
 
-void GPUSB::NSTimerCallback()
-{
-    driver->stopPulse(NSDirection);
-    GuideComplete(AXIS_DE);
-}
+    scheduleGuideStop(axis, ms, [this, direction]()
+    {
+        driver->stopPulse(direction);
+    });
 
-void GPUSB::WETimerCallback()
-{
-    driver->stopPulse(WEDirection);
-    GuideComplete(AXIS_RA);
+    return IPS_BUSY;
 }
 
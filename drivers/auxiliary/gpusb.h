@@ -25,8 +25,6 @@
 #include "defaultdevice.h"
 #include "indiguiderinterface.h"
 
-#include <chrono>
-
 class GPUSBDriver;
 
 class GPUSB : public INDI::DefaultDevice, public INDI::GuiderInterface
@@ -39,9 +37,6 @@ class GPUSB : public INDI::DefaultDevice, public INDI::GuiderInterface
         virtual bool updateProperties() override;
         virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
 
-        static void NSTimerHelper(void *context);
-        static void WETimerHelper(void *context);
-
     protected:
         bool Connect() override;
         bool Disconnect() override;
@@ -54,12 +49,7 @@ class GPUSB : public INDI::DefaultDevice, public INDI::GuiderInterface
         virtual IPState GuideWest(uint32_t ms) override;
 
     private:
-        std::chrono::system_clock::time_point NSGuideTS, WEGuideTS;
-        uint32_t NSPulseRequest = 0, WEPulseRequest = 0;
-        int NSDirection = -1, WEDirection = -1, NSTimerID = -1, WETimerID = -1;
-
-        void NSTimerCallback();
-        void WETimerCallback();
+        IPState startGuide(INDI_EQ_AXIS axis, int direction, const char *label, uint32_t ms);
 
         GPUSBDriver *driver;
 };
@@ -22,7 +22,7 @@
 #include "connectionplugins/connectiontcp.h"
 #include "indipropertyswitch.h"
 #include <memory>
-#include <httplib.h>
+#include "httpclientpool.h"
 
 #ifdef _USE_SYSTEM_JSONLIB
 #include <nlohmann/json.hpp>
@@ -112,13 +112,13 @@ bool IPX800::Handshake()
         return false;
     }
 
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     // Get relay status as a simple test
     std::string endpoint = "/api/xdevices.json";
     endpoint += "?key=" + std::string(APIKeyTP[0].getText());
     endpoint += "&Get=D";
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOG_ERROR("Failed to connect to device");
@@ -163,12 +163,12 @@ void IPX800::TimerHit()
 
 bool IPX800::UpdateDigitalInputs()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     std::string endpoint = "/api/xdevices.json";
     endpoint += "?key=" + std::string(APIKeyTP[0].getText());
     endpoint += "&Get=D";
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOG_ERROR("Failed to get digital inputs");
@@ -204,12 +204,12 @@ bool IPX800::UpdateDigitalInputs()
 
 bool IPX800::UpdateAnalogInputs()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     std::string endpoint = "/api/xdevices.json";
     endpoint += "?key=" + std::string(APIKeyTP[0].getText());
     endpoint += "&Get=A";
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOG_ERROR("Failed to get analog inputs");
@@ -247,12 +247,12 @@ bool IPX800::UpdateAnalogInputs()
 
 bool IPX800::UpdateDigitalOutputs()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     std::string endpoint = "/api/xdevices.json";
     endpoint += "?key=" + std::string(APIKeyTP[0].getText());
     endpoint += "&Get=R";
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOG_ERROR("Failed to get digital outputs");
@@ -288,14 +288,14 @@ bool IPX800::UpdateDigitalOutputs()
 
 bool IPX800::CommandOutput(uint32_t index, OutputState command)
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     // IPX800 uses 1-based indexing for outputs
     std::string endpoint = "/api/xdevices.json";
     endpoint += "?key=" + std::string(APIKeyTP[0].getText());
     endpoint += "&" + std::string(command == OutputState::On ? "SetR=" : "ClearR=") + std::to_string(index + 1);
 
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOGF_ERROR("Failed to set output %d", index + 1);
@@ -25,6 +25,7 @@
 #include "joystickdriver.h"
 #include "indistandardproperty.h"
 
+#include <cmath>
 #include <memory>
 #include <cstring>
 
@@ -34,6 +35,12 @@ std::unique_ptr<JoyStick> joystick(new JoyStick());
 JoyStick::JoyStick()
 {
     driver.reset(new JoyStickDriver());
+
+    m_UpdateTimer.callOnTimeout([this]()
+    {
+        std::lock_guard<std::mutex> lock(m_EventMutex);
+        flushEvents();
+    });
 }
 
 const char *JoyStick::getDefaultName()
@@ -118,6 +125,10 @@ void JoyStick::setupParams()
 
     IUFillSwitchVector(&ButtonSP, ButtonS, nButtons, getDeviceName(), "JOYSTICK_BUTTONS", "Buttons", "Monitor", IP_RO,
                        ISR_NOFMANY, 0, IPS_IDLE);
+
+    std::lock_guard<std::mutex> lock(m_EventMutex);
+    m_PendingAxis.assign(nAxis, 0);
+    m_PendingJoystick.assign(nJoysticks, JoystickValue());
 }
 
 bool JoyStick::initProperties()
@@ -135,6 +146,11 @@ bool JoyStick::initProperties()
     IUFillTextVector(&JoystickInfoTP, JoystickInfoT, 5, getDeviceName(), "JOYSTICK_INFO", "Joystick Info",
                      MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
 
+    IUFillNumber(&UpdatesN[UPDATE_RATE], "UPDATE_RATE", "Rate (Hz)", "%.f", 0, 100, 5, 20);
+    IUFillNumber(&UpdatesN[UPDATE_DELTA], "UPDATE_DELTA", "Delta", "%.f", 0, 5000, 50, 100);
+    IUFillNumberVector(&UpdatesNP, UpdatesN, 2, getDeviceName(), "JOYSTICK_UPDATES", "Updates", OPTIONS_TAB, IP_RW, 0,
+                       IPS_IDLE);
+
     addDebugControl();
 
     return true;
@@ -172,6 +188,8 @@ bool JoyStick::updateProperties()
 
         // Dead zones
         defineProperty(&DeadZoneNP);
+        defineProperty(&UpdatesNP);
+        startUpdateTimer();
 
         // N.B. Only set callbacks AFTER we define our properties above
         // because these calls backs otherwise can be called asynchronously
@@ -182,6 +200,8 @@ bool JoyStick::updateProperties()
     }
     else
     {
+        m_UpdateTimer.stop();
+
         deleteProperty(JoystickInfoTP.name);
 
         for (int i = 0; i < driver->getNumOfJoysticks(); i++)
@@ -189,6 +209,7 @@ bool JoyStick::updateProperties()
 
         deleteProperty(AxisNP.name);
         deleteProperty(DeadZoneNP.name);
+        deleteProperty(UpdatesNP.name);
         deleteProperty(ButtonSP.name);
 
         delete[] JoyStickNP;
@@ -256,6 +277,18 @@ bool JoyStick::ISNewNumber(const char *dev, const char *name, double values[], c
             IDSetNumber(&DeadZoneNP, nullptr);
             return true;
         }
+
+        if (!strcmp(name, UpdatesNP.name))
+        {
+            std::lock_guard<std::mutex> lock(m_EventMutex);
+            IUUpdateNumber(&UpdatesNP, values, names, n);
+            UpdatesNP.s = IPS_OK;
+            IDSetNumber(&UpdatesNP, nullptr);
+            // Events pending when coalescing is turned off are sent now
+            flushEvents();
+            startUpdateTimer();
+            return true;
+        }
     }
 
     return INDI::DefaultDevice::ISNewNumber(dev, name, values, names, n);
@@ -283,15 +316,21 @@ void JoyStick::joystickEvent(int joystick_n, double mag, double angle)
 
     LOGF_DEBUG("joystickEvent[%d]: %g @ %g", joystick_n, mag, angle);
 
-    if (mag == 0)
-        JoyStickNP[joystick_n].s = IPS_IDLE;
-    else
-        JoyStickNP[joystick_n].s = IPS_BUSY;
-
-    JoyStickNP[joystick_n].np[0].value = mag;
-    JoyStickNP[joystick_n].np[1].value = angle;
+    // The dead zone of the first axis of the joystick applies to its magnitude.
+    // Magnitudes are normalized, except for direction keys which report raw values.
+    int axis_n = joystick_n * 2;
+    double rawMag = std::fabs(mag) <= 1 ? std::fabs(mag) * 32767.0 : std::fabs(mag);
+    if (axis_n < AxisNP.nnp && rawMag <= DeadZoneN[axis_n].value)
+    {
+        mag = 0;
+        angle = 0;
+    }
 
-    IDSetNumber(&JoyStickNP[joystick_n], nullptr);
+    std::lock_guard<std::mutex> lock(m_EventMutex);
+    m_PendingJoystick[joystick_n].mag = mag;
+    m_PendingJoystick[joystick_n].angle = angle;
+    if (UpdatesN[UPDATE_RATE].value <= 0)
+        flushJoystick(joystick_n);
 }
 
 void JoyStick::axisEvent(int axis_n, int value)
@@ -305,16 +344,76 @@ void JoyStick::axisEvent(int axis_n, int value)
     if (std::abs(value) <= DeadZoneN[axis_n].value)
         value = 0;
 
-    if (value == 0)
-        AxisNP.s = IPS_IDLE;
-    else
-        AxisNP.s = IPS_BUSY;
+    std::lock_guard<std::mutex> lock(m_EventMutex);
+    m_PendingAxis[axis_n] = value;
+    if (UpdatesN[UPDATE_RATE].value <= 0)
+        flushAxes();
+}
 
-    AxisNP.np[axis_n].value = value;
+// Whether value changed from sent by at least delta. Reaching or leaving zero is always sent, so that motion stops or starts.
+static bool exceedsDelta(double sent, double value, double delta)
+{
+    if ((sent == 0) != (value == 0))
+        return true;
+    return value != sent && std::fabs(value - sent) >= delta;
+}
 
+void JoyStick::flushAxes()
+{
+    bool changed = false, moving = false;
+    for (int i = 0; i < AxisNP.nnp; i++)
+    {
+        if (exceedsDelta(AxisN[i].value, m_PendingAxis[i], UpdatesN[UPDATE_DELTA].value))
+        {
+            AxisN[i].value = m_PendingAxis[i];
+            changed = true;
+        }
+        moving |= (AxisN[i].value != 0);
+    }
+
+    if (!changed)
+        return;
+
+    AxisNP.s = moving ? IPS_BUSY : IPS_IDLE;
     IDSetNumber(&AxisNP, nullptr);
 }
 
+void JoyStick::flushJoystick(int joystick_n)
+{
+    INumberVectorProperty &property = JoyStickNP[joystick_n];
+    const JoystickValue &pending = m_PendingJoystick[joystick_n];
+
+    // The delta is in raw axis units, normalized magnitudes are compared in the same units
+    double scale = std::fabs(pending.mag) <= 1 && std::fabs(property.np[0].value) <= 1 ? 32767.0 : 1.0;
+    bool magChanged = exceedsDelta(property.np[0].value * scale, pending.mag * scale, UpdatesN[UPDATE_DELTA].value);
+    bool angleChanged = pending.mag != 0 && std::fabs(std::remainder(pending.angle - property.np[1].value, 360.0)) >= ANGLE_DELTA;
+    if (!magChanged && !angleChanged)
+        return;
+
+    property.s = (pending.mag == 0) ? IPS_IDLE : IPS_BUSY;
+    property.np[0].value = pending.mag;
+    property.np[1].value = pending.angle;
+    IDSetNumber(&property, nullptr);
+}
+
+void JoyStick::flushEvents()
+{
+    if (!isConnected())
+        return;
+
+    flushAxes();
+    for (size_t i = 0; i < m_PendingJoystick.size(); i++)
+        flushJoystick(i);
+}
+
+void JoyStick::startUpdateTimer()
+{
+    if (UpdatesN[UPDATE_RATE].value > 0)
+        m_UpdateTimer.start(std::max(1, static_cast<int>(std::lround(1000 / UpdatesN[UPDATE_RATE].value))));
+    else
+        m_UpdateTimer.stop();
+}
+
 void JoyStick::buttonEvent(int button_n, int value)
 {
     if (!isConnected())
@@ -334,6 +433,7 @@ bool JoyStick::saveConfigItems(FILE *fp)
 
     IUSaveConfigText(fp, &PortTP);
     IUSaveConfigNumber(fp, &DeadZoneNP);
+    IUSaveConfigNumber(fp, &UpdatesNP);
 
     return true;
 }
@@ -23,7 +23,11 @@
 #pragma once
 
 #include "defaultdevice.h"
+#include "inditimer.h"
+
 #include <memory>
+#include <mutex>
+#include <vector>
 
 class JoyStickDriver;
 
@@ -31,6 +35,9 @@ class JoyStickDriver;
  * @brief The JoyStick class provides an INDI driver that displays event data from game pads. The INDI driver can be encapsulated in any other driver
  * via snooping on properties of interesting.
  *
+ * Axis and joystick events are coalesced: only their latest values are sent, at most JOYSTICK_UPDATES rate times per second,
+ * and only when they changed by the update delta. A rate of zero sends every event as it comes.
+ *
  */
 class JoyStick : public INDI::DefaultDevice
 {
@@ -62,6 +69,12 @@ class JoyStick : public INDI::DefaultDevice
         void axisEvent(int axis_n, int value);
         void buttonEvent(int button_n, int value);
 
+        // Send the pending values that changed enough, called with m_EventMutex held
+        void flushAxes();
+        void flushJoystick(int joystick_n);
+        void flushEvents();
+        void startUpdateTimer();
+
         INumberVectorProperty *JoyStickNP = nullptr;
         INumber *JoyStickN = nullptr;
 
@@ -80,5 +93,29 @@ class JoyStick : public INDI::DefaultDevice
         ITextVectorProperty JoystickInfoTP;
         IText JoystickInfoT[5] {};
 
+        INumberVectorProperty UpdatesNP;
+        INumber UpdatesN[2];
+        enum
+        {
+            UPDATE_RATE,
+            UPDATE_DELTA
+        };
+
         std::unique_ptr<JoyStickDriver> driver;
+
+    private:
+        struct JoystickValue
+        {
+            double mag { 0 };
+            double angle { 0 };
+        };
+
+        // Latest values from the joystick thread, sent from the update timer
+        std::mutex m_EventMutex;
+        std::vector<int> m_PendingAxis;
+        std::vector<JoystickValue> m_PendingJoystick;
+        INDI::Timer m_UpdateTimer;
+
+        // Angles are sent when they changed by this many degrees
+        static constexpr double ANGLE_DELTA { 1.0 };
 };
@@ -23,6 +23,7 @@
 #include "joystickdriver.h"
 
 #include <cstring>
+#include <poll.h>
 
 #define MAX_JOYSTICKS 3
 
@@ -79,8 +80,8 @@ bool JoyStickDriver::Connect()
         ioctl(joystick_fd, JSIOCGAXES, &axes);
         ioctl(joystick_fd, JSIOCGBUTTONS, &buttons);
 
-        joystick_st->axis.reserve(axes);
-        joystick_st->button.reserve(buttons);
+        joystick_st->axis.assign(axes, 0);
+        joystick_st->button.assign(buttons, 0);
         active = true;
         pthread_create(&thread, 0, &JoyStickDriver::loop, this);
         return true;
@@ -112,16 +113,23 @@ void *JoyStickDriver::loop(void *obj)
 
 void JoyStickDriver::readEv()
 {
-    int bytes = read(joystick_fd, joystick_ev, sizeof(*joystick_ev));
-    if (bytes > 0)
+    // Wait for events, waking up every poll period to notice a disconnection
+    struct pollfd pfd = { joystick_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, pollMS) <= 0)
+        return;
+
+    js_event events[32];
+    int bytes = read(joystick_fd, events, sizeof(events));
+    for (int i = 0; i < bytes / static_cast<int>(sizeof(js_event)); i++)
     {
+        *joystick_ev = events[i];
         joystick_ev->type &= ~JS_EVENT_INIT;
-        if (joystick_ev->type & JS_EVENT_BUTTON)
+        if ((joystick_ev->type & JS_EVENT_BUTTON) && joystick_ev->number < buttons)
         {
             joystick_st->button[joystick_ev->number] = joystick_ev->value;
             buttonCallbackFunc(joystick_ev->number, joystick_ev->value);
         }
-        if (joystick_ev->type & JS_EVENT_AXIS)
+        if ((joystick_ev->type & JS_EVENT_AXIS) && joystick_ev->number < axes)
         {
             joystick_st->axis[joystick_ev->number] = joystick_ev->value;
             int joystick_n                         = joystick_ev->number;
@@ -144,8 +152,6 @@ void JoyStickDriver::readEv()
             axisCallbackFunc(joystick_ev->number, joystick_ev->value);
         }
     }
-    else
-        usleep(pollMS * 1000);
 }
 
 joystick_position JoyStickDriver::joystickPosition(int n)
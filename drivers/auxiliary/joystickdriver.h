@@ -53,8 +53,8 @@ typedef struct
  * A game pad may have one or more joysticks depending on the number of reported axis. You can utilize the class in an event driven fashion by using callbacks.
  * The callbacks have a specific signature and must be set. Alternatively, you may query the status and position of the buttons & axis at any time as well.
  *
- * Since the class runs a non-blocking thread, the thread goes to sleep when there are no events detected in order to reduce CPU utilization. The sleep period is set by
- * default to 100 milliseconds and can be adjusted by the \i setPoll function.
+ * The class runs a thread that waits for events, and reads all the pending ones when the device has some. It wakes up every poll period
+ * to notice a disconnection, by default every 100 milliseconds, which can be adjusted by the \i setPoll function.
  *
  * Each joystick has a normalized magnitude [0 to 1] and an angle. The magnitude is 0 when the stick is not depressed, and 1 when depressed all the way.
  * The angles are measured counter clock wise [0 to 360] with right/east direction being zero.
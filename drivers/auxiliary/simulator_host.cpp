@@ -0,0 +1,122 @@
+/*******************************************************************************
+  Simulator host driver.
+
+  Runs any number of the CCD, telescope, focuser, dome and weather simulators
+  from one process, so indiserver and its clients can be loaded with hundreds of
+  devices without hundreds of drivers.
+
+  The count of each simulator is read from the environment, 1 by default:
+
+    INDI_SIMULATOR_HOST_CCD, INDI_SIMULATOR_HOST_TELESCOPE, INDI_SIMULATOR_HOST_FOCUS,
+    INDI_SIMULATOR_HOST_DOME, INDI_SIMULATOR_HOST_WEATHER
+
+  The first device of each kind keeps the usual simulator name, so the other
+  simulators find it, the next ones are numbered from 2, e.g. "CCD Simulator 2".
+
+  INDI_SIMULATOR_HOST_POLLING sets the default polling period of all the devices
+  in milliseconds, INDI_SIMULATOR_HOST_SEED seeds the read noise of the cameras
+  so a benchmark sees the same frames on every run.
+
+    e.g. $ INDI_SIMULATOR_HOST_CCD=50 INDI_SIMULATOR_HOST_POLLING=10 indiserver indi_simulator_host
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#include "../ccd/ccd_simulator.h"
+#include "../telescope/telescope_simulator.h"
+#include "../focuser/focus_simulator.h"
+#include "../dome/dome_simulator.h"
+#include "../weather/weathersimulator.h"
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+/**
+ * @brief The HostedSimulator class gives a simulator the name and polling period it has in the host.
+ */
+template <class Simulator>
+class HostedSimulator : public Simulator
+{
+    public:
+        HostedSimulator(const std::string &name, uint32_t pollingPeriod) : m_Name(name), m_PollingPeriod(pollingPeriod) {}
+
+        const char *getDefaultName() override
+        {
+            return m_Name.c_str();
+        }
+
+        bool initProperties() override
+        {
+            bool rc = Simulator::initProperties();
+            if (m_PollingPeriod > 0)
+                this->setDefaultPollingPeriod(m_PollingPeriod);
+            return rc;
+        }
+
+    private:
+        std::string m_Name;
+        uint32_t m_PollingPeriod;
+};
+
+uint32_t environmentValue(const char *name, uint32_t defaultValue)
+{
+    const char *value = getenv(name);
+    return value == nullptr ? defaultValue : static_cast<uint32_t>(strtoul(value, nullptr, 10));
+}
+
+template <class Simulator>
+void addSimulators(std::vector<std::unique_ptr<INDI::DefaultDevice>> &devices, const char *variable, const char *name,
+                   uint32_t pollingPeriod)
+{
+    uint32_t count = environmentValue(variable, 1);
+    for (uint32_t i = 1; i <= count; i++)
+    {
+        std::string deviceName = (i == 1) ? name : std::string(name) + " " + std::to_string(i);
+        devices.emplace_back(new HostedSimulator<Simulator>(deviceName, pollingPeriod));
+    }
+}
+
+std::vector<std::unique_ptr<INDI::DefaultDevice>> createSimulators()
+{
+    std::vector<std::unique_ptr<INDI::DefaultDevice>> devices;
+    uint32_t pollingPeriod = environmentValue("INDI_SIMULATOR_HOST_POLLING", 0);
+
+    addSimulators<CCDSim>(devices, "INDI_SIMULATOR_HOST_CCD", "CCD Simulator", pollingPeriod);
+    if (getenv("INDI_SIMULATOR_HOST_SEED") != nullptr)
+    {
+        // Each camera gets its own sequence, the same on every run
+        uint32_t seed = environmentValue("INDI_SIMULATOR_HOST_SEED", 0);
+        for (size_t i = 0; i < devices.size(); i++)
+            static_cast<CCDSim *>(devices[i].get())->setNoiseSeed(seed + i);
+    }
+
+    addSimulators<ScopeSim>(devices, "INDI_SIMULATOR_HOST_TELESCOPE", "Telescope Simulator", pollingPeriod);
+    addSimulators<FocusSim>(devices, "INDI_SIMULATOR_HOST_FOCUS", "Focuser Simulator", pollingPeriod);
+    addSimulators<DomeSim>(devices, "INDI_SIMULATOR_HOST_DOME", "Dome Simulator", pollingPeriod);
+    addSimulators<WeatherSimulator>(devices, "INDI_SIMULATOR_HOST_WEATHER", "Weather Simulator", pollingPeriod);
+    return devices;
+}
+}
+
+// The devices register with the driver on construction, which dispatches the client requests to them by name
+static std::vector<std::unique_ptr<INDI::DefaultDevice>> simulators = createSimulators();
@@ -33,6 +33,9 @@
 #include <unistd.h>
 #include <sys/wait.h>
 
+// Step of the shutdown procedure while the client connects to the server
+#define CLIENT_WAIT_MS 100
+
 // Naming the object after my love Juli which I lost in 2018. May she rest in peace.
 // http://indilib.org/images/juli_tommy.jpg
 std::unique_ptr<WatchDog> juli(new WatchDog());
@@ -96,6 +99,10 @@ bool WatchDog::Connect()
     IDSnoopDevice(ActiveDeviceT[ACTIVE_TELESCOPE].text, "TELESCOPE_PARK");
     IDSnoopDevice(ActiveDeviceT[ACTIVE_DOME].text, "DOME_PARK");
 
+    // The client is ready before anything goes wrong, so parking starts as soon as the shutdown is triggered
+    if (ShutdownProcedureS[PARK_MOUNT].s == ISS_ON || ShutdownProcedureS[PARK_DOME].s == ISS_ON)
+        connectClient();
+
     return true;
 }
 
@@ -106,6 +113,13 @@ bool WatchDog::Disconnect()
 {
     m_ClientAlertTimer.stop();
     m_WeatherAlertTimer.stop();
+    if (m_ShutdownTimerID != -1)
+    {
+        RemoveTimer(m_ShutdownTimerID);
+        m_ShutdownTimerID = -1;
+    }
+    if (m_WatchDogClientInstance->isServerConnected())
+        m_WatchDogClientInstance->disconnectServer();
 
     LOG_INFO("Watchdog is disabled.");
     m_ShutdownStage = WATCHDOG_IDLE;
@@ -225,13 +239,13 @@ bool WatchDog::ISNewText(const char *dev, const char *name, char *texts[], char
                 return true;
             }
 
-            IDSnoopDevice(ActiveDeviceT[ACTIVE_WEATHER].text, "WEATHER_STATUS");
-            IDSnoopDevice(ActiveDeviceT[ACTIVE_TELESCOPE].text, "TELESCOPE_PARK");
-            IDSnoopDevice(ActiveDeviceT[ACTIVE_DOME].text, "DOME_PARK");
-
             IUUpdateText(&ActiveDeviceTP, texts, names, n);
             ActiveDeviceTP.s = IPS_OK;
             IDSetText(&ActiveDeviceTP, nullptr);
+
+            IDSnoopDevice(ActiveDeviceT[ACTIVE_WEATHER].text, "WEATHER_STATUS");
+            IDSnoopDevice(ActiveDeviceT[ACTIVE_TELESCOPE].text, "TELESCOPE_PARK");
+            IDSnoopDevice(ActiveDeviceT[ACTIVE_DOME].text, "DOME_PARK");
             return true;
         }
     }
@@ -332,6 +346,9 @@ bool WatchDog::ISNewSwitch(const char *dev, const char *name, ISState *states, c
 
             saveConfig(true, ShutdownProcedureSP.name);
             IDSetSwitch(&ShutdownProcedureSP, nullptr);
+
+            if (isConnected() && (ShutdownProcedureS[PARK_MOUNT].s == ISS_ON || ShutdownProcedureS[PARK_DOME].s == ISS_ON))
+                connectClient();
             return true;
         }
         // Mount Lock Policy
@@ -476,6 +493,9 @@ bool WatchDog::ISSnoopDevice(XMLEle * root)
             {
                 LOGF_INFO("Mount is %s", parked ? "Parked" : "Unparked");
                 m_IsMountParked = parked;
+                // Go on with the shutdown now rather than on the next poll
+                if (parked && m_ShutdownStage == WATCHDOG_MOUNT_PARKED)
+                    scheduleShutdownStep(0);
                 // In case mount was UNPARKED while weather status is still ALERT
                 // And weather shutdown trigger was active and mount parking was selected
                 // then we force the mount to park again.
@@ -511,6 +531,8 @@ bool WatchDog::ISSnoopDevice(XMLEle * root)
             {
                 LOGF_INFO("Dome is %s", parked ? "Parked" : "Unparked");
                 m_IsDomeParked = parked;
+                if (parked && m_ShutdownStage == WATCHDOG_DOME_PARKED)
+                    scheduleShutdownStep(0);
                 // In case mount was UNPARKED while weather status is still ALERT
                 // And weather shutdown trigger was active and mount parking was selected
                 // then we force the mount to park again.
@@ -579,11 +601,43 @@ void WatchDog::processShutdown()
     TimerHit();
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+///
+////////////////////////////////////////////////////////////////////////////////////
+void WatchDog::connectClient()
+{
+    if (m_WatchDogClientInstance->isServerConnected())
+        return;
+
+    // Watch mount if required
+    if (ShutdownProcedureS[PARK_MOUNT].s == ISS_ON)
+        m_WatchDogClientInstance->setMount(ActiveDeviceT[ACTIVE_TELESCOPE].text);
+    // Watch dome
+    if (ShutdownProcedureS[PARK_DOME].s == ISS_ON)
+        m_WatchDogClientInstance->setDome(ActiveDeviceT[ACTIVE_DOME].text);
+
+    // Set indiserver host and port
+    m_WatchDogClientInstance->setServer(SettingsT[INDISERVER_HOST].text, m_INDIServerPort);
+
+    LOG_DEBUG("Connecting to INDI server...");
+
+    m_WatchDogClientInstance->connectServer();
+}
+
+void WatchDog::scheduleShutdownStep(uint32_t ms)
+{
+    if (m_ShutdownTimerID != -1)
+        RemoveTimer(m_ShutdownTimerID);
+    m_ShutdownTimerID = SetTimer(ms);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////////
 void WatchDog::TimerHit()
 {
+    m_ShutdownTimerID = -1;
+
     // Timer is up, we need to start shutdown procedure
     switch (m_ShutdownStage)
     {
@@ -606,23 +660,13 @@ void WatchDog::TimerHit()
                 break;
             }
 
-            // Watch mount if required
-            if (ShutdownProcedureS[PARK_MOUNT].s == ISS_ON)
-                m_WatchDogClientInstance->setMount(ActiveDeviceT[ACTIVE_TELESCOPE].text);
-            // Watch dome
-            if (ShutdownProcedureS[PARK_DOME].s == ISS_ON)
-                m_WatchDogClientInstance->setDome(ActiveDeviceT[ACTIVE_DOME].text);
-
-            // Set indiserver host and port
-            m_WatchDogClientInstance->setServer(SettingsT[INDISERVER_HOST].text, m_INDIServerPort);
-
-            LOG_DEBUG("Connecting to INDI server...");
-
-            m_WatchDogClientInstance->connectServer();
+            // Usually connected since the watchdog was, then parking starts right away
+            connectClient();
 
             m_ShutdownStage = WATCHDOG_CLIENT_STARTED;
 
-            break;
+            scheduleShutdownStep(m_WatchDogClientInstance->isConnected() ? 0 : CLIENT_WAIT_MS);
+            return;
 
         case WATCHDOG_CLIENT_STARTED:
             // Check if client is ready
@@ -639,7 +683,11 @@ void WatchDog::TimerHit()
                     executeScript();
             }
             else
+            {
                 LOG_DEBUG("Waiting for INDI server connection...");
+                scheduleShutdownStep(CLIENT_WAIT_MS);
+                return;
+            }
             break;
 
         case WATCHDOG_MOUNT_PARKED:
@@ -647,7 +695,7 @@ void WatchDog::TimerHit()
             // check if mount is parked
             IPState mountState = m_WatchDogClientInstance->getMountParkState();
 
-            if (mountState == IPS_OK || mountState == IPS_IDLE)
+            if (m_IsMountParked || mountState == IPS_OK || mountState == IPS_IDLE)
             {
                 LOG_INFO("Mount parked.");
 
@@ -666,7 +714,7 @@ void WatchDog::TimerHit()
             // check if dome is parked
             IPState domeState = m_WatchDogClientInstance->getDomeParkState();
 
-            if (domeState == IPS_OK || domeState == IPS_IDLE)
+            if (m_IsDomeParked || domeState == IPS_OK || domeState == IPS_IDLE)
             {
                 LOG_INFO("Dome parked.");
 
@@ -696,7 +744,10 @@ void WatchDog::TimerHit()
             return;
     }
 
-    SetTimer(getCurrentPollingPeriod());
+    // Parking progress comes with the snooped park properties, polling is only a fallback
+    bool parked = (m_ShutdownStage == WATCHDOG_MOUNT_PARKED && m_IsMountParked) ||
+                  (m_ShutdownStage == WATCHDOG_DOME_PARKED && m_IsDomeParked);
+    scheduleShutdownStep(parked ? 0 : getCurrentPollingPeriod());
 }
 
 void WatchDog::parkDome()
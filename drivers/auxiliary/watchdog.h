@@ -67,6 +67,10 @@ class WatchDog : public INDI::DefaultDevice
 
     private:
         void processShutdown();
+        // Connect the client to the mount and dome to park, if not already
+        void connectClient();
+        // Run the next step of the shutdown procedure in ms, replacing any scheduled one
+        void scheduleShutdownStep(uint32_t ms);
         void parkDome();
         void parkMount();
         void executeScript();
@@ -117,4 +121,6 @@ class WatchDog : public INDI::DefaultDevice
         bool m_IsDomeParked { false };
         // State machine to store where in the shutdown procedure we currently stand
         ShutdownStages m_ShutdownStage;
+        // Timer of the next shutdown step, -1 if none
+        int m_ShutdownTimerID { -1 };
 };
@@ -72,6 +72,16 @@ void WatchDogClient::newProperty(INDI::Property property)
         domeParkSP = property.getSwitch();
 }
 
+/**************************************************************************************
+** The devices have to be received again on the next connection
+***************************************************************************************/
+void WatchDogClient::serverDisconnected(int exit_code)
+{
+    INDI_UNUSED(exit_code);
+    isReady = mountOnline = domeOnline = false;
+    mountParkSP = domeParkSP = nullptr;
+}
+
 /**************************************************************************************
 **
 ***************************************************************************************/
@@ -57,6 +57,7 @@ class WatchDogClient : public INDI::BaseClient
     protected:
         virtual void newDevice(INDI::BaseDevice dp) override;
         virtual void newProperty(INDI::Property property) override;
+        virtual void serverDisconnected(int exit_code) override;
 
     private:
         std::string dome, mount;
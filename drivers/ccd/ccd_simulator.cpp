@@ -19,6 +19,7 @@
 #include "ccd_simulator.h"
 #include "indicom.h"
 #include "stream/streammanager.h"
+#include "indisimulatedclock.h"
 
 #include "locale_compat.h"
 
@@ -32,13 +33,38 @@
 #include <sys/stat.h>
 #include <algorithm>
 #include <chrono>
+#include <mutex>
 #include <random>
 #include <thread>
+#include <vector>
 
-static pthread_cond_t cv         = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t condMutex = PTHREAD_MUTEX_INITIALIZER;
-
+#ifndef INDI_SIMULATOR_HOST
 static std::unique_ptr<CCDSim> ccdsim(new CCDSim());
+#endif
+
+namespace
+{
+// Calls fn(first, last) over ranges of the rows, on as many threads as the frame is worth
+template <typename Fn>
+void forEachRowRange(uint32_t rows, Fn fn)
+{
+    constexpr uint32_t minRowsPerThread = 64;
+    uint32_t threads = std::max(1u, std::min(std::thread::hardware_concurrency(), rows / minRowsPerThread));
+    if (threads == 1)
+    {
+        fn(0, rows);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    uint32_t chunk = (rows + threads - 1) / threads;
+    for (uint32_t first = chunk; first < rows; first += chunk)
+        workers.emplace_back(fn, first, std::min(rows, first + chunk));
+    fn(0, std::min(rows, chunk));
+    for (auto &worker : workers)
+        worker.join();
+}
+}
 
 CCDSim::CCDSim() : INDI::FilterInterface(this)
 {
@@ -47,7 +73,7 @@ CCDSim::CCDSim() : INDI::FilterInterface(this)
 
     terminateThread = false;
 
-    time(&RunStart);
+    RunStart = INDI::SimulatedClock::now();
 
     // Filter stuff
     FilterSlotNP[0].setMin(1);
@@ -91,7 +117,7 @@ bool CCDSim::Connect()
     streamPredicate = 0;
     terminateThread = false;
     pthread_create(&primary_thread, nullptr, &streamVideoHelper, this);
-    SetTimer(getCurrentPollingPeriod());
+    SetTimer(INDI::SimulatedClock::toWallMs(getCurrentPollingPeriod()));
     return true;
 }
 
@@ -340,7 +366,7 @@ bool CCDSim::StartExposure(float duration)
     ExposureRequest   = duration;
 
     PrimaryCCD.setExposureDuration(duration);
-    gettimeofday(&ExpStart, nullptr);
+    INDI::SimulatedClock::gettimeofday(&ExpStart);
     //  Leave the proper time showing for the draw routines
     if (PrimaryCCD.getFrameType() == INDI::CCDChip::LIGHT_FRAME && DirectorySP[INDI_ENABLED].getState() == ISS_ON)
     {
@@ -362,7 +388,7 @@ bool CCDSim::StartGuideExposure(float n)
     AbortGuideFrame      = false;
     GuideCCD.setExposureDuration(n);
     DrawCcdFrame(&GuideCCD);
-    gettimeofday(&GuideExpStart, nullptr);
+    INDI::SimulatedClock::gettimeofday(&GuideExpStart);
     InGuideExposure = true;
     return true;
 }
@@ -394,7 +420,7 @@ float CCDSim::CalcTimeLeft(timeval start, float req)
     {
         0, 0
     };
-    gettimeofday(&now, nullptr);
+    INDI::SimulatedClock::gettimeofday(&now);
 
     timesince =
         (double)(now.tv_sec * 1000.0 + now.tv_usec / 1000) - (double)(start.tv_sec * 1000.0 + start.tv_usec / 1000);
@@ -512,7 +538,8 @@ void CCDSim::TimerHit()
     }
 
 
-    SetTimer(nextTimer);
+    // Timers are in simulated time, which may run faster than the wall clock
+    SetTimer(INDI::SimulatedClock::toWallMs(nextTimer));
 }
 
 double CCDSim::flux(double mag) const
@@ -557,12 +584,8 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
 
         if (m_PEPeriod > 0)
         {
-            double timesince;
-            time_t now;
-            time(&now);
-
             //  Lets figure out where we are on the pe curve
-            timesince = difftime(now, RunStart);
+            double timesince = INDI::SimulatedClock::now() - RunStart;
             //  This is our spot in the curve
             double PESpot = timesince / m_PEPeriod;
             //  Now convert to radians
@@ -646,7 +669,7 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
 
             INDI::IEquatorialCoordinates epochPos { 0, 0 }, J2000Pos { 0, 0 };
 
-            double jd = ln_get_julian_from_sys();
+            double jd = INDI::SimulatedClock::julianDate();
 
             epochPos.rightascension  = currentRA;
             epochPos.declination = currentDE;
@@ -710,7 +733,7 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
         //  if this is a light frame, we need a star field drawn
         INDI::CCDChip::CCD_FRAME ftype = targetChip->getFrameType();
 
-        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        std::unique_lock<std::mutex> guard(targetChip->getBufferLock());
 
         //  Start by clearing the frame buffer
         memset(targetChip->getFrameBuffer(), 0, targetChip->getFrameBufferSize());
@@ -722,6 +745,8 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
             FILE * pp;
             int drawn = 0;
 
+            buildStarStamp();
+
             sprintf(gsccmd, "gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",
                     range360(rad),
                     rangeDec(cameradec),
@@ -824,64 +849,89 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
             // Flux represents one second, scale up linearly for exposure time
             float const skyflux = flux(glow) * exposure_time;
 
-            uint16_t * pt = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
+            uint16_t * buffer = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
 
             nheight = targetChip->getSubH();
             nwidth  = targetChip->getSubW();
 
+            // Vignetting parameter in arcsec
+            float const vig = std::min(nwidth, nheight) * ImageScalex;
+
+            // Gaussian falloff to the edges of the frame, the product of a falloff along the rows and one along the columns
+            std::vector<float> fx(nwidth), fy(nheight);
+            for (int x = 0; x < nwidth; x++)
+            {
+                float const sx = nwidth / 2 - x;
+                fx[x] = exp(-2.0 * 0.7 * sx * sx * ImageScalex * ImageScalex / (vig * vig));
+            }
             for (int y = 0; y < nheight; y++)
             {
                 float const sy = nheight / 2 - y;
+                fy[y] = exp(-2.0 * 0.7 * sy * sy * ImageScaley * ImageScaley / (vig * vig));
+            }
 
-                for (int x = 0; x < nwidth; x++)
+            std::mutex minmaxLock;
+            forEachRowRange(nheight, [&](uint32_t first, uint32_t last)
+            {
+                float rangeMax = 0, rangeMin = m_MaxVal;
+                for (uint32_t y = first; y < last; y++)
                 {
-                    float const sx = nwidth / 2 - x;
-
-                    // Vignetting parameter in arcsec
-                    float const vig = std::min(nwidth, nheight) * ImageScalex;
-
-                    // Squared distance to center in arcsec (need to make this account for actual pixel size)
-                    float const dc2 = sx * sx * ImageScalex * ImageScalex + sy * sy * ImageScaley * ImageScaley;
-
-                    // Gaussian falloff to the edges of the frame
-                    float const fa = exp(-2.0 * 0.7 * dc2 / (vig * vig));
-
-                    // Get the current value of the pixel, add the sky glow and scale for vignetting
-                    float fp = (pt[0] + skyflux) * fa;
+                    uint16_t * pt = buffer + y * nwidth;
+                    for (int x = 0; x < nwidth; x++)
+                    {
+                        // Get the current value of the pixel, add the sky glow and scale for vignetting
+                        float fp = (pt[x] + skyflux) * fx[x] * fy[y];
 
-                    // Clamp to limits, store minmax
-                    if (fp > m_MaxVal) fp = m_MaxVal;
-                    if (fp < pt[0]) fp = pt[0];
-                    if (fp > maxpix) maxpix = fp;
-                    if (fp < minpix) minpix = fp;
+                        // Clamp to limits, store minmax
+                        if (fp > m_MaxVal) fp = m_MaxVal;
+                        if (fp < pt[x]) fp = pt[x];
+                        rangeMax = std::max(rangeMax, fp);
+                        rangeMin = std::min(rangeMin, fp);
 
-                    // And put it back
-                    pt[0] = fp;
-                    pt++;
+                        // And put it back
+                        pt[x] = fp;
+                    }
                 }
-            }
+                std::lock_guard<std::mutex> lock(minmaxLock);
+                maxpix = std::max(maxpix, static_cast<int>(rangeMax));
+                minpix = std::min(minpix, static_cast<int>(rangeMin));
+            });
         }
 
         //  Now we add some bias and read noise
-        int subX = targetChip->getSubX();
-        int subY = targetChip->getSubY();
-        int subW = targetChip->getSubW() + subX;
-        int subH = targetChip->getSubH() + subY;
-
         if (m_MaxNoise > 0)
         {
-            for (int x = subX; x < subW; x++)
+            const std::vector<uint16_t> &table = noiseTable();
+            size_t const start = m_NoiseGenerator() % table.size();
+            uint16_t * buffer = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
+            int const width = targetChip->getSubW();
+
+            std::mutex minmaxLock;
+            forEachRowRange(targetChip->getSubH(), [&](uint32_t first, uint32_t last)
             {
-                for (int y = subY; y < subH; y++)
+                // Rows take the noise they would in a single pass, whatever the threads
+                size_t index = (start + static_cast<size_t>(first) * width) % table.size();
+                int rangeMax = 0, rangeMin = m_MaxVal;
+                for (uint32_t y = first; y < last; y++)
                 {
-                    int noise;
-
-                    noise = random();
-                    noise = noise % m_MaxNoise; //
-
-                    AddToPixel(targetChip, x, y, m_Bias + noise);
+                    uint16_t * pt = buffer + y * width;
+                    for (int x = 0; x < width; x++)
+                    {
+                        int value = pt[x] + m_Bias + table[index] % m_MaxNoise;
+                        if (++index == table.size())
+                            index = 0;
+
+                        if (value > m_MaxVal)
+                            value = m_MaxVal;
+                        rangeMax = std::max(rangeMax, value);
+                        rangeMin = std::min(rangeMin, value);
+                        pt[x] = value;
+                    }
                 }
-            }
+                std::lock_guard<std::mutex> lock(minmaxLock);
+                maxpix = std::max(maxpix, rangeMax);
+                minpix = std::min(minpix, rangeMin);
+            });
         }
     }
     else
@@ -902,12 +952,41 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
     return 0;
 }
 
+void CCDSim::buildStarStamp()
+{
+    //  we need a box size that gives a radius at least 3 times fwhm
+    //qx       = seeing / ImageScalex;
+    //qx       = qx * 3;
+    //boxsizex = (int)qx;
+    //boxsizex++;
+    auto qx = seeing / ImageScaley;
+    qx = qx * 3;
+    m_StarStampRadius = static_cast<int>(qx);
+    m_StarStampRadius++;
+
+    int const side = 2 * m_StarStampRadius + 1;
+    m_StarStamp.resize(side * side);
+    for (int sy = -m_StarStampRadius; sy <= m_StarStampRadius; sy++)
+    {
+        for (int sx = -m_StarStampRadius; sx <= m_StarStampRadius; sx++)
+        {
+            // Squared distance to center in arcsec (need to make this account for actual pixel size)
+            float const dc2 = sx * sx * ImageScalex * ImageScalex + sy * sy * ImageScaley * ImageScaley;
+
+            // Use a gaussian of unitary integral, scale it with the source flux
+            // f(x) = 1/(sqrt(2*pi)*sigma) * exp( -x² / (2*sigma²) )
+            // FWHM = 2*sqrt(2*log(2))*sigma => sigma = seeing/(2*sqrt(2*log(2)))
+            float const sigma = seeing / ( 2 * sqrt(2 * log(2)));
+            m_StarStamp[(sy + m_StarStampRadius) * side + sx + m_StarStampRadius] =
+                1 / (sigma * sqrt(2 * 3.1416)) * exp( -dc2 / (2 * sigma * sigma));
+        }
+    }
+}
+
 int CCDSim::DrawImageStar(INDI::CCDChip * targetChip, float mag, float x, float y, float exposure_time)
 {
     int sx, sy;
     int drew     = 0;
-    //int boxsizex = 5;
-    int boxsizey = 5;
     float flux;
 
     int subX = targetChip->getSubX();
@@ -928,35 +1007,19 @@ int CCDSim::DrawImageStar(INDI::CCDChip * targetChip, float mag, float x, float
     //  scale up linearly for exposure time
     flux = flux * exposure_time;
 
-    //  we need a box size that gives a radius at least 3 times fwhm
-    //qx       = seeing / ImageScalex;
-    //qx       = qx * 3;
-    //boxsizex = (int)qx;
-    //boxsizex++;
-    auto qx = seeing / ImageScaley;
-    qx = qx * 3;
-    boxsizey = static_cast<int>(qx);
-    boxsizey++;
-
-    //IDLog("BoxSize %d %d\n",boxsizex,boxsizey);
+    // The gaussian of the seeing over the box, computed once for all the stars of the frame
+    int const boxsize = m_StarStampRadius;
+    int const side = 2 * boxsize + 1;
+    const float * stamp = m_StarStamp.data();
 
-    for (sy = -boxsizey; sy <= boxsizey; sy++)
+    for (sy = -boxsize; sy <= boxsize; sy++)
     {
-        for (sx = -boxsizey; sx <= boxsizey; sx++)
+        for (sx = -boxsize; sx <= boxsize; sx++)
         {
             int rc;
 
-            // Squared distance to center in arcsec (need to make this account for actual pixel size)
-            float const dc2 = sx * sx * ImageScalex * ImageScalex + sy * sy * ImageScaley * ImageScaley;
-
-            // Use a gaussian of unitary integral, scale it with the source flux
-            // f(x) = 1/(sqrt(2*pi)*sigma) * exp( -x² / (2*sigma²) )
-            // FWHM = 2*sqrt(2*log(2))*sigma => sigma = seeing/(2*sqrt(2*log(2)))
-            float const sigma = seeing / ( 2 * sqrt(2 * log(2)));
-            float const fa = 1 / (sigma * sqrt(2 * 3.1416)) * exp( -dc2 / (2 * sigma * sigma));
-
             // The source contribution is the gaussian value, stretched by seeing/FWHM
-            float fp = fa * flux;
+            float fp = stamp[(sy + boxsize) * side + sx + boxsize] * flux;
 
             if (fp < 0)
                 fp = 0;
@@ -1117,7 +1180,7 @@ bool CCDSim::ISNewNumber(const char * dev, const char * name, double values[], c
             RA = EqPENP[AXIS_RA].getValue();
             Dec = EqPENP[AXIS_DE].getValue();
 
-            INDI::ObservedToJ2000(&epochPos, ln_get_julian_from_sys(), &J2000Pos);
+            INDI::ObservedToJ2000(&epochPos, INDI::SimulatedClock::julianDate(), &J2000Pos);
             currentRA  = J2000Pos.rightascension;
             currentDE = J2000Pos.declination;
             usePE = true;
@@ -1350,7 +1413,7 @@ bool CCDSim::ISSnoopDevice(XMLEle * root)
             INDI::IEquatorialCoordinates epochPos { 0, 0 }, J2000Pos { 0, 0 };
             epochPos.ra  = newra * 15.0;
             epochPos.dec = newdec;
-            ln_get_equ_prec2(&epochPos, ln_get_julian_from_sys(), JD2000, &J2000Pos);
+            ln_get_equ_prec2(&epochPos, INDI::SimulatedClock::julianDate(), JD2000, &J2000Pos);
             raPE  = J2000Pos.ra / 15.0;
             decPE = J2000Pos.dec;
             usePE = true;
@@ -1405,7 +1468,7 @@ bool CCDSim::SelectFilter(int f)
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> dist(1500, 2000);
-    std::this_thread::sleep_for(std::chrono::milliseconds(dist(gen)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(INDI::SimulatedClock::toWallMs(dist(gen))));
 
     CurrentFilter = f;
     SelectFilterDone(f);
@@ -1477,6 +1540,26 @@ bool CCDSim::UpdateGuiderBin(int hor, int ver)
     return INDI::CCD::UpdateGuiderBin(hor, ver);
 }
 
+void CCDSim::setNoiseSeed(uint32_t seed)
+{
+    m_NoiseGenerator.seed(seed);
+}
+
+const std::vector<uint16_t> &CCDSim::noiseTable()
+{
+    // An odd size, so the rows of a frame do not keep in step with the table
+    static const std::vector<uint16_t> table = []()
+    {
+        std::vector<uint16_t> values((1 << 20) + 1);
+        std::mt19937 generator(0);
+        std::uniform_int_distribution<int> distribution(0, 65535);
+        for (auto &value : values)
+            value = distribution(generator);
+        return values;
+    }();
+    return table;
+}
+
 void * CCDSim::streamVideoHelper(void * context)
 {
     return static_cast<CCDSim *>(context)->streamVideo();
@@ -1484,7 +1567,7 @@ void * CCDSim::streamVideoHelper(void * context)
 
 void * CCDSim::streamVideo()
 {
-    auto start = std::chrono::high_resolution_clock::now();
+    double start = INDI::SimulatedClock::now();
 
     while (true)
     {
@@ -1508,16 +1591,14 @@ void * CCDSim::streamVideo()
 
         PrimaryCCD.binFrame();
 
-        auto finish = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed = finish - start;
-
-        if (elapsed.count() < ExposureRequest)
-            usleep(fabs(ExposureRequest - elapsed.count()) * 1e6);
+        double elapsed = INDI::SimulatedClock::now() - start;
+        if (elapsed < ExposureRequest)
+            INDI::SimulatedClock::sleep(ExposureRequest - elapsed);
 
         uint32_t size = PrimaryCCD.getFrameBufferSize() / (PrimaryCCD.getBinX() * PrimaryCCD.getBinY());
         Streamer->newFrame(PrimaryCCD.getFrameBuffer(), size);
 
-        start = std::chrono::high_resolution_clock::now();
+        start = INDI::SimulatedClock::now();
     }
 
     pthread_mutex_unlock(&condMutex);
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <deque>
+#include <random>
 
 #include "indiccd.h"
 #include "indifilterinterface.h"
@@ -82,6 +83,13 @@ public:
     static void *streamVideoHelper(void *context);
     void *streamVideo();
 
+    /**
+     * @brief setNoiseSeed Draws the read noise of the frames from a sequence started at seed, so the same
+     * exposures give the same noise from one run to the next.
+     * @param seed start of the sequence
+     */
+    void setNoiseSeed(uint32_t seed);
+
 protected:
 
     bool Connect() override;
@@ -98,6 +106,8 @@ protected:
     int DrawCcdFrame(INDI::CCDChip *targetChip);
 
     int DrawImageStar(INDI::CCDChip *targetChip, float, float, float, float ExposureTime);
+    // Fills the star stamp DrawImageStar scales by the flux of each star, for the seeing and scale of the frame
+    void buildStarStamp();
     int AddToPixel(INDI::CCDChip *targetChip, int, int, int);
 
     virtual IPState GuideNorth(uint32_t) override;
@@ -161,6 +171,9 @@ protected:
     float seeing { 3.5 };
     float ImageScalex { 1.0 };
     float ImageScaley { 1.0 };
+    // The gaussian of a star of unit flux, over a square of 2 * m_StarStampRadius + 1 pixels
+    std::vector<float> m_StarStamp;
+    int m_StarStampRadius { 0 };
     //  An oag is offset this much from center of scope position (arcminutes)
     float m_OAGOffset { 0 };
     float m_RotationCW { 0 };
@@ -186,7 +199,7 @@ protected:
     double currentRA { 0 };
     double currentDE { 0 };
     bool usePE { false };
-    time_t RunStart;
+    double RunStart;
 
     float guideNSOffset {0};
     float guideWEOffset {0};
@@ -199,6 +212,13 @@ protected:
     int streamPredicate {0};
     pthread_t primary_thread;
     bool terminateThread;
+    pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+    pthread_mutex_t condMutex = PTHREAD_MUTEX_INITIALIZER;
+
+    // Read noise is taken from a table shared by all the simulated cameras of the process,
+    // starting at an offset drawn for each frame.
+    static const std::vector<uint16_t> &noiseTable();
+    std::mt19937 m_NoiseGenerator { std::random_device{}() };
 
     std::deque<std::string> m_AllFiles, m_RemainingFiles;
 
@@ -716,7 +716,7 @@ int GuideSim::DrawCcdFrame(INDI::CCDChip * targetChip)
         //  if this is a light frame, we need a star field drawn
         INDI::CCDChip::CCD_FRAME ftype = targetChip->getFrameType();
 
-        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        std::unique_lock<std::mutex> guard(targetChip->getBufferLock());
 
         //  Start by clearing the frame buffer
         memset(targetChip->getFrameBuffer(), 0, targetChip->getFrameBufferSize());
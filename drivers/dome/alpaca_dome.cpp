@@ -24,7 +24,7 @@
 
 #include "alpaca_dome.h"
 
-#include <httplib.h>
+#include "httpclientpool.h"
 #include <string.h>
 #include <chrono>
 #include <thread>
@@ -224,11 +224,11 @@ bool AlpacaDome::makeAlpacaRequest(const std::string& path, nlohmann::json& resp
 
     try
     {
-        httplib::Client cli(ServerAddressTP[0].getText(), std::stoi(ServerAddressTP[1].getText()));
-        cli.set_connection_timeout(static_cast<int>(ConnectionSettingsNP[0].getValue()));
-        cli.set_read_timeout(static_cast<int>(ConnectionSettingsNP[0].getValue()));
+        auto cli = INDI::HTTPClientPool::instance().acquire(ServerAddressTP[0].getText(), std::stoi(ServerAddressTP[1].getText()));
+        cli->set_connection_timeout(static_cast<int>(ConnectionSettingsNP[0].getValue()));
+        cli->set_read_timeout(static_cast<int>(ConnectionSettingsNP[0].getValue()));
 
-        auto result = isPut ? cli.Put(path.c_str()) : cli.Get(path.c_str());
+        auto result = isPut ? cli->Put(path.c_str()) : cli->Get(path.c_str());
         
         if (!result)
         {
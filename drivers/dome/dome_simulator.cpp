@@ -19,13 +19,16 @@
 #include "dome_simulator.h"
 
 #include "indicom.h"
+#include "indisimulatedclock.h"
 
 #include <cmath>
 #include <memory>
 #include <unistd.h>
 
 // We declare an auto pointer to domeSim.
+#ifndef INDI_SIMULATOR_HOST
 static std::unique_ptr<DomeSim> domeSim(new DomeSim());
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
@@ -114,7 +117,7 @@ bool DomeSim::updateProperties()
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 bool DomeSim::Connect()
 {
-    SetTimer(1000);
+    SetTimer(INDI::SimulatedClock::toWallMs(1000));
     return true;
 }
 
@@ -200,7 +203,8 @@ void DomeSim::TimerHit()
         }
     }
 
-    SetTimer(getPollingPeriod());
+    // The dome moves by its speed each cycle, cycles are shorter when the simulated time runs faster
+    SetTimer(INDI::SimulatedClock::toWallMs(getPollingPeriod()));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -18,6 +18,8 @@
 
 #include "filter_simulator.h"
 
+#include "indisimulatedclock.h"
+
 #include <memory>
 #include <chrono>
 #include <random>
@@ -92,7 +94,7 @@ bool FilterSim::SelectFilter(int f)
     if (delay < 0)
         return false;
 
-    std::this_thread::sleep_for(std::chrono::seconds(delay));
+    INDI::SimulatedClock::sleep(delay);
 
     CurrentFilter = f;
     SetTimer(10);
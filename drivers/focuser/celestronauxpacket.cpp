@@ -25,6 +25,9 @@
 #include "indicom.h"
 #include "indilogger.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 #include <termios.h>
 #include <stdio.h>
 
@@ -36,18 +39,24 @@ namespace Aux
 char debugStr[301];
 
 // free function to return the contents of a buffer as a string containing a series of hex numbers
-char * toHexStr(buffer data)
+char * toHexStr(const uint8_t *data, size_t size)
 {
-    int sz = (int)data.size();
+    int sz = (int)size;
     if (sz > 100)
         sz = 100;
+    debugStr[0] = '\0';
     for (int i = 0; i < sz; i++)
     {
-        snprintf(&debugStr[i * 3], 301, "%02X ", data[i]);
+        snprintf(&debugStr[i * 3], sizeof(debugStr) - i * 3, "%02X ", data[i]);
     }
     return debugStr;
 }
 
+char * toHexStr(buffer data)
+{
+    return toHexStr(data.data(), data.size());
+}
+
 std::string Communicator::Device;
 
 Packet::Packet(Target source, Target destination, Command command, buffer data)
@@ -62,21 +71,28 @@ Packet::Packet(Target source, Target destination, Command command, buffer data)
 void Packet::FillBuffer(buffer &buff)
 {
     buff.resize(this->length + 3);
-    buff[0] = AUX_HDR;
-    buff[1] = length;
-    buff[2] = source;
-    buff[3] = destination;
-    buff[4] = command;
-    for (uint32_t i = 0; i < data.size(); i++)
-    {
-        buff[5 + i] = data[i];
-    }
-
-    buff.back() = checksum(buff);
+    Encode(source, destination, command, data.data(), data.size(), buff.data(), buff.size());
 
     DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_DEBUG, "fillBuffer <%s>", toHexStr(buff));
 }
 
+size_t Packet::Encode(Target source, Target destination, Command command, const uint8_t *data, size_t size,
+                      uint8_t *out, size_t outSize)
+{
+    if (size > MAX_DATA || outSize < size + 6)
+        return 0;
+
+    out[0] = AUX_HDR;
+    out[1] = static_cast<uint8_t>(size + 3);
+    out[2] = source;
+    out[3] = destination;
+    out[4] = command;
+    if (size > 0)
+        memcpy(out + 5, data, size);
+    out[size + 5] = Checksum(out);
+    return size + 6;
+}
+
 bool Packet::Parse(buffer packet)
 {
     if (packet.size() < 6)  // must contain header, len, src, dest, cmd and checksum at least
@@ -104,7 +120,7 @@ bool Packet::Parse(buffer packet)
     command = static_cast<Command>(packet[4]);
     data  = buffer(packet.begin() + 5, packet.end() - 1);
 
-    uint8_t cs = checksum(packet);
+    uint8_t cs = Checksum(packet.data());
     uint8_t cb = packet[length + 2];
 
     if (cs != cb)
@@ -114,7 +130,7 @@ bool Packet::Parse(buffer packet)
     return  cb == cs;
 }
 
-uint8_t Packet::checksum(buffer packet)
+uint8_t Packet::Checksum(const uint8_t *packet)
 {
     int cs = 0;
     for (int i = 1; i < packet[1] + 2; i++)
@@ -124,6 +140,48 @@ uint8_t Packet::checksum(buffer packet)
     return (-cs & 0xff);
 }
 
+/////////////////////////////////////////////
+/////////// PacketDecoder
+/////////////////////////////////////////////
+
+size_t PacketDecoder::Needed() const
+{
+    // The header and the length come one at a time, then the rest of the packet
+    if (m_Size < 2)
+        return 1;
+    return m_Buffer[1] + 3 - m_Size;
+}
+
+bool PacketDecoder::Push(uint8_t byte, PacketView &packet)
+{
+    if (m_Size == 0 && byte != Packet::AUX_HDR)
+        return false;
+
+    m_Buffer[m_Size++] = byte;
+    // A packet holds at least source, destination and command
+    if (m_Size == 2 && byte < 3)
+    {
+        m_Size = 0;
+        return false;
+    }
+    if (m_Size < 2 || Needed() > 0)
+        return false;
+
+    m_Size = 0;
+    if (Packet::Checksum(m_Buffer) != m_Buffer[m_Buffer[1] + 2])
+    {
+        m_Errors++;
+        return false;
+    }
+
+    packet.source      = static_cast<Target>(m_Buffer[2]);
+    packet.destination = static_cast<Target>(m_Buffer[3]);
+    packet.command     = static_cast<Command>(m_Buffer[4]);
+    packet.data        = m_Buffer + 5;
+    packet.size        = m_Buffer[1] - 3;
+    return true;
+}
+
 /////////////////////////////////////////////
 /////////// Communicator
 /////////////////////////////////////////////
@@ -138,17 +196,21 @@ Communicator::Communicator(Target source)
     this->source = source;
 }
 
-bool Communicator::sendPacket(int portFD, Target dest, Command cmd, buffer data)
+bool Communicator::sendPacket(int portFD, Target dest, Command cmd, const uint8_t *data, size_t size)
 {
-    Packet pkt(source, dest, cmd, data);
+    uint8_t txbuff[MAX_PACKET];
+    size_t length = Packet::Encode(source, dest, cmd, data, size, txbuff, sizeof(txbuff));
+    if (length == 0)
+    {
+        DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_ERROR, "sendPacket %zu bytes of data do not fit", size);
+        return false;
+    }
 
-    buffer txbuff;
-    pkt.FillBuffer(txbuff);
-    int ns;
+    DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_DEBUG, "CMD <%s>", toHexStr(txbuff, length));
 
+    int ns = 0;
     int ttyrc = 0;
-    tcflush(portFD, TCIOFLUSH);
-    if ( (ttyrc = tty_write(portFD, reinterpret_cast<const char *>(txbuff.data()), txbuff.size(), &ns)) != TTY_OK)
+    if ( (ttyrc = tty_write(portFD, reinterpret_cast<const char *>(txbuff), length, &ns)) != TTY_OK)
     {
         char errmsg[MAXRBUF];
         tty_error_msg(ttyrc, errmsg, MAXRBUF);
@@ -158,82 +220,128 @@ bool Communicator::sendPacket(int portFD, Target dest, Command cmd, buffer data)
     return true;
 }
 
-bool Communicator::readPacket(int portFD, Packet &reply)
+bool Communicator::readPacket(int portFD, PacketView &reply)
 {
-    char rxbuf[] = {0};
-    int nr = 0, ttyrc = 0;
-    // look for header
-    while(rxbuf[0] != Packet::AUX_HDR)
+    uint8_t rxbuf[MAX_PACKET];
+    while (true)
     {
-        if ( (ttyrc = tty_read(portFD, rxbuf, 1, SHORT_TIMEOUT, &nr) != TTY_OK))
+        // Never read past the packet, the rest may be the reply of another target
+        int nr = 0, ttyrc = 0;
+        if ( (ttyrc = tty_read(portFD, reinterpret_cast<char *>(rxbuf), decoder.Needed(), SHORT_TIMEOUT, &nr)) != TTY_OK)
         {
             char errmsg[MAXRBUF];
             tty_error_msg(ttyrc, errmsg, MAXRBUF);
-            DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_ERROR,
-                         "readPacket fail read hdr tty %i %s, nr %i", ttyrc, errmsg, nr);
-            return false;		// read failure is instantly fatal
+            DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_ERROR, "readPacket fail tty %i %s, nr %i", ttyrc, errmsg, nr);
+            decoder.Reset();
+            return false;       // read failure is instantly fatal
+        }
+
+        for (int i = 0; i < nr; i++)
+        {
+            if (decoder.Push(rxbuf[i], reply))
+            {
+                DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_DEBUG, "RES %02X -> %02X cmd %02X <%s>",
+                             reply.source, reply.destination, reply.command, toHexStr(reply.data, reply.size));
+                return true;
+            }
         }
     }
-    // get length
-    if (tty_read(portFD, rxbuf, 1, SHORT_TIMEOUT, &nr) != TTY_OK)
+}
+
+bool Communicator::sendCommands(int portFD, Request *requests, size_t count)
+{
+    // The request waiting for its reply, per target
+    int inFlight[256];
+    std::fill(std::begin(inFlight), std::end(inFlight), -1);
+
+    for (size_t i = 0; i < count; i++)
     {
-        char errmsg[MAXRBUF];
-        tty_error_msg(ttyrc, errmsg, MAXRBUF);
-        DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_ERROR, "readPacket fail read len tty %i %s, ns %i", ttyrc,
-                     errmsg, nr);
-        return false;
+        requests[i].done = false;
+        requests[i].replySize = 0;
     }
 
-    int len = rxbuf[0];
-    buffer packet(2);
-    packet[0] = Packet::AUX_HDR;
-    packet[1] = len;
+    tcflush(portFD, TCIOFLUSH);
+    decoder.Reset();
 
-    // get source, destination, command, data and checksum
-    char rxdata[MAXRBUF] = {0};
-    if ( (ttyrc = tty_read(portFD, rxdata, len + 1, SHORT_TIMEOUT, &nr) != TTY_OK))
+    size_t pending = count;
+    int num_tries = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3 * SHORT_TIMEOUT);
+    while (pending > 0)
     {
-        char errmsg[MAXRBUF];
-        tty_error_msg(ttyrc, errmsg, MAXRBUF);
-        DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_ERROR, "readPacket fail data tty %i %s, nr %i", ttyrc, errmsg,
-                     nr);
-        return false;
-    }
+        // Start the next request of every idle target, the earliest that is not done comes first
+        for (size_t i = 0; i < count; i++)
+        {
+            Request &request = requests[i];
+            if (request.done || inFlight[request.destination] >= 0)
+                continue;
+            if (!sendPacket(portFD, request.destination, request.command, request.data, request.size))
+                return false;   // failure to send is fatal
+            inFlight[request.destination] = static_cast<int>(i);
+        }
 
-    packet.insert(packet.end(), rxdata, rxdata + len + 1);
+        PacketView packet;
+        if (!readPacket(portFD, packet))
+        {
+            if (++num_tries >= 3)
+                break;
+
+            // try again what is still unanswered
+            for (int target = 0; target < 256; target++)
+            {
+                if (inFlight[target] < 0)
+                    continue;
+                Request &request = requests[inFlight[target]];
+                if (!sendPacket(portFD, request.destination, request.command, request.data, request.size))
+                    return false;
+            }
+            continue;
+        }
 
-    DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_DEBUG, "RES <%s>", toHexStr(packet));
+        // Other devices talk on the bus too, and a serial link may echo what was sent
+        int index = packet.destination == source ? inFlight[packet.source] : -1;
+        if (index < 0 || requests[index].command != packet.command)
+        {
+            DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_DEBUG,
+                         "sendCommands skipping pkt.command %i, pkt.destination %i pkt.source %i",
+                         packet.command, packet.destination, packet.source);
+            if (std::chrono::steady_clock::now() > deadline)
+                break;
+            continue;
+        }
+
+        Request &request = requests[index];
+        memcpy(request.reply, packet.data, packet.size);
+        request.replySize = packet.size;
+        request.done = true;
+        inFlight[packet.source] = -1;
+        pending--;
+        deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3 * SHORT_TIMEOUT);
+    }
 
-    return reply.Parse(packet);
+    if (pending > 0)
+        DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_ERROR, "sendCommands %zu of %zu requests unanswered",
+                     pending, count);
+    return pending == 0;
 }
 
 // send command with data and reply
 bool Communicator::sendCommand(int portFD, Target dest, Command cmd, buffer data, buffer &reply)
 {
-    int num_tries = 0;
-
-    while (num_tries++ < 3)
-    {
-        if (!sendPacket(portFD, dest, cmd, data))
-            return false;       // failure to send is fatal
+    if (data.size() > MAX_DATA)
+        return false;
 
-        Packet pkt;
-        if (!readPacket(portFD, pkt))
-            continue;           // try again
+    Request request;
+    request.destination = dest;
+    request.command = cmd;
+    request.size = data.size();
+    if (!data.empty())
+        memcpy(request.data, data.data(), data.size());
 
-        // check the packet is the one we want
-        if (pkt.command != cmd || pkt.destination != Target::APP || pkt.source != dest)
-        {
-            DEBUGFDEVICE(Communicator::Device.c_str(), INDI::Logger::DBG_ERROR,
-                         "sendCommand pkt.command %i cmd %i, pkt.destination %i pkt.source %i dest %i",
-                         pkt.command, cmd, pkt.destination, pkt.source, dest);
-            continue;           // wrong packet, try again
-        }
+    if (!sendCommands(portFD, &request, 1))
+        return false;
 
-        reply = pkt.data;
-        return true;
-    }
-    return false;
+    reply.assign(request.reply, request.reply + request.replySize);
+    return true;
 }
 
 // send command with reply but no data
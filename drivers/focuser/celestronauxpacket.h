@@ -37,6 +37,11 @@ namespace Aux
 
 typedef std::vector<uint8_t> buffer;
 
+/** Longest packet: header, length, up to 255 bytes of source, destination, command and data, checksum. */
+static const size_t MAX_PACKET = 258;
+/** Most data bytes a packet carries. */
+static const size_t MAX_DATA = 252;
+
 /**
  * @brief The Command enum includes all the command types sent to the various devices (motor, focuser..etc)
  */
@@ -121,8 +126,62 @@ class Packet
 
         bool Parse (buffer buf);
 
+        /**
+         * @brief Encode Write a packet into a caller provided buffer, without allocating.
+         * @return The size of the packet, 0 if the data does not fit in a packet or the packet in out.
+         */
+        static size_t Encode(Target source, Target destination, Command command, const uint8_t *data, size_t size,
+                             uint8_t *out, size_t outSize);
+
+        /** The checksum of a packet, computed over the length, source, destination, command and data. */
+        static uint8_t Checksum(const uint8_t *packet);
+};
+
+/**
+ * @brief The PacketView struct is a packet decoded in place by a PacketDecoder.
+ * The data points into the decoder and is valid until the decoder is given the next byte.
+ */
+struct PacketView
+{
+    Target source;
+    Target destination;
+    Command command;
+    const uint8_t *data;
+    size_t size;
+};
+
+/**
+ * @brief The PacketDecoder class frames packets out of the bytes read from the AUX bus, without allocating.
+ * Bytes outside of a packet are skipped and packets with a bad checksum are dropped.
+ */
+class PacketDecoder
+{
+    public:
+        /**
+         * @brief Push Add the next byte read.
+         * @return True if the byte completed a valid packet, which is then decoded in packet.
+         */
+        bool Push(uint8_t byte, PacketView &packet);
+
+        /** The bytes the current packet still needs, read no more to not consume the start of the next one. */
+        size_t Needed() const;
+
+        /** Forget the partial packet, e.g. after a timeout. */
+        void Reset()
+        {
+            m_Size = 0;
+        }
+
+        /** Packets dropped for a bad checksum. */
+        uint32_t Errors() const
+        {
+            return m_Errors;
+        }
+
     private:
-        uint8_t checksum(buffer data);
+        uint8_t m_Buffer[MAX_PACKET];
+        size_t m_Size {0};
+        uint32_t m_Errors {0};
 };
 
 /**
@@ -140,6 +199,30 @@ class Communicator
         // send command with data but no reply
         bool commandBlind(int port, Target dest, Command cmd, buffer data);
 
+        /**
+         * @brief The Request struct is one command of a sendCommands() batch.
+         */
+        struct Request
+        {
+            Target destination;
+            Command command;
+            uint8_t data[MAX_DATA];
+            size_t size;
+            /** Filled in by sendCommands() */
+            uint8_t reply[MAX_DATA];
+            size_t replySize;
+            bool done;
+        };
+
+        /**
+         * @brief sendCommands Send a batch of commands, with one request outstanding per target at a time.
+         * Requests to different targets, e.g. both axes and the focuser, are on the bus together and their replies
+         * are matched by source, destination and command in whatever order they arrive. Requests to the same
+         * target are sent in order, each once the previous one was answered.
+         * @return True if every request was answered, see Request::done for which ones were otherwise.
+         */
+        bool sendCommands(int port, Request *requests, size_t count);
+
         Target source;
 
         static std::string Device;
@@ -149,8 +232,10 @@ class Communicator
         }
 
     private:
-        bool sendPacket(int port, Target dest, Command cmd, buffer data);
-        bool readPacket(int port, Packet &reply);
+        bool sendPacket(int port, Target dest, Command cmd, const uint8_t *data, size_t size);
+        bool readPacket(int port, PacketView &reply);
+
+        PacketDecoder decoder;
 };
 
 }
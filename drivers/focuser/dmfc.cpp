@@ -801,6 +801,14 @@ void DMFC::TimerHit()
         return;
     }
 
+    // Moving with a learned motion model, show the predicted position and query the focuser once it should be done
+    uint32_t nextPoll = 0;
+    if ((FocusAbsPosNP.getState() == IPS_BUSY || FocusRelPosNP.getState() == IPS_BUSY) && updatePredictedPosition(nextPoll))
+    {
+        SetTimer(nextPoll);
+        return;
+    }
+
     bool rc = updateFocusParams();
 
     if (rc)
@@ -814,6 +822,7 @@ void DMFC::TimerHit()
                 FocusAbsPosNP.apply();
                 FocusRelPosNP.apply();
                 LOG_INFO("Focuser reached requested position.");
+                motionFinished();
             }
         }
     }
@@ -18,13 +18,17 @@
 
 #include "focus_simulator.h"
 
+#include "indisimulatedclock.h"
+
 #include <cmath>
 #include <memory>
 #include <cstring>
 #include <unistd.h>
 
 // We declare an auto pointer to focusSim.
+#ifndef INDI_SIMULATOR_HOST
 static std::unique_ptr<FocusSim> focusSim(new FocusSim());
+#endif
 
 /************************************************************************************
  *
@@ -251,7 +255,7 @@ IPState FocusSim::MoveFocuser(FocusDirection dir, int speed, uint16_t duration)
     }
 
     // simulate delay in motion as the focuser moves to the new position
-    usleep(duration * 1000);
+    INDI::SimulatedClock::sleep(duration / 1000.0);
 
     double ticks = initTicks + (internalTicks - mid) / 5000.0;
 
@@ -287,7 +291,7 @@ IPState FocusSim::MoveAbsFocuser(uint32_t targetTicks)
     double ticks = initTicks + (targetTicks - mid) / 5000.0;
 
     // simulate delay in motion as the focuser moves to the new position
-    usleep(std::abs((targetTicks - FocusAbsPosNP[0].getValue()) * DelayNP[0].getValue()));
+    INDI::SimulatedClock::sleep(std::abs((targetTicks - FocusAbsPosNP[0].getValue()) * DelayNP[0].getValue()) / 1e6);
 
     FocusAbsPosNP[0].setValue(targetTicks);
 
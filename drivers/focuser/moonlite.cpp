@@ -382,6 +382,10 @@ bool MoonLite::ISNewSwitch(const char * dev, const char * name, ISState * states
                 return false;
             }
 
+            // A step is a different distance now
+            if (current_mode != target_mode)
+                resetMotionModel();
+
             StepModeSP.setState(IPS_OK);
             StepModeSP.apply();
             return true;
@@ -530,6 +534,14 @@ void MoonLite::TimerHit()
     if (!isConnected())
         return;
 
+    // Moving with a learned motion model, show the predicted position and query the focuser once it should be done
+    uint32_t nextPoll = 0;
+    if ((FocusAbsPosNP.getState() == IPS_BUSY || FocusRelPosNP.getState() == IPS_BUSY) && updatePredictedPosition(nextPoll))
+    {
+        SetTimer(nextPoll);
+        return;
+    }
+
     bool rc = readPosition();
     if (rc)
     {
@@ -560,6 +572,7 @@ void MoonLite::TimerHit()
             FocusRelPosNP.apply();
             lastPos = static_cast<uint32_t>(FocusAbsPosNP[0].getValue());
             LOG_INFO("Focuser reached requested position.");
+            motionFinished();
         }
     }
 
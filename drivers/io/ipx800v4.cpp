@@ -22,7 +22,7 @@
 #include "connectionplugins/connectiontcp.h"
 #include "indipropertyswitch.h"
 #include <memory>
-#include <httplib.h>
+#include "httpclientpool.h"
 
 #ifdef _USE_SYSTEM_JSONLIB
 #include <nlohmann/json.hpp>
@@ -112,7 +112,7 @@ const char *IPX800::getDefaultName()
 
 bool IPX800::Handshake()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     // Get digital input status as a simple test
     std::string endpoint = "/api/xdevices.json?";
@@ -121,7 +121,7 @@ bool IPX800::Handshake()
 		endpoint += "key=" + apiKey + "&" ;
     }
 	endpoint += "Get=D";
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
 	
     if (!result)
     {
@@ -173,7 +173,7 @@ void IPX800::TimerHit()
 
 bool IPX800::UpdateDigitalInputs()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     std::string endpoint = "/api/xdevices.json?";
 	std::string apiKey = std::string(APIKeyTP[0].getText());
@@ -181,7 +181,7 @@ bool IPX800::UpdateDigitalInputs()
 		endpoint += "key=" + apiKey + "&" ;
     }
 	endpoint += "Get=D";
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOG_ERROR("Failed to get digital inputs");
@@ -216,14 +216,14 @@ bool IPX800::UpdateDigitalInputs()
 
 bool IPX800::UpdateAnalogInputs()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
     std::string endpoint = "/api/xdevices.json?";
 	std::string apiKey = std::string(APIKeyTP[0].getText());
 	if (!apiKey.empty()) {
 		endpoint += "key=" + apiKey + "&" ;
     }
 	endpoint += "Get=A";
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOG_ERROR("Failed to get analog inputs");
@@ -260,7 +260,7 @@ bool IPX800::UpdateAnalogInputs()
 
 bool IPX800::UpdateDigitalOutputs()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     std::string endpoint = "/api/xdevices.json?";
     std::string apiKey = std::string(APIKeyTP[0].getText());
@@ -268,7 +268,7 @@ bool IPX800::UpdateDigitalOutputs()
 		endpoint += "key=" + apiKey + "&" ;
     }
 	endpoint += "Get=R";
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOG_ERROR("Failed to get digital outputs");
@@ -304,7 +304,7 @@ bool IPX800::UpdateDigitalOutputs()
 
 bool IPX800::CommandOutput(uint32_t index, OutputState command)
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
     // IPX800 uses 1-based indexing for outputs
     std::string endpoint = "/api/xdevices.json?";
@@ -314,7 +314,7 @@ bool IPX800::CommandOutput(uint32_t index, OutputState command)
     
     endpoint += std::string(command == OutputState::On ? "SetR=" : "ClearR=") + std::to_string(index + 1);
 
-    auto result = cli.Get(endpoint);
+    auto result = cli->Get(endpoint);
     if (!result)
     {
         LOGF_ERROR("Failed to set output %d", index + 1);
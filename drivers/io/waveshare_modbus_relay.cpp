@@ -121,6 +121,11 @@ bool WaveshareRelay::Handshake()
         }
     }
 
+    m_Batch.clear();
+    m_Batch.add(ModbusReadBatch::COILS, 0, 8);
+    if (m_HaveInput)
+        m_Batch.add(ModbusReadBatch::DISCRETE_INPUTS, 0, 8);
+
     uint16_t output;
     err = nmbs_read_holding_registers(&nmbs, 0x8000, 1, &output);
     if (err == NMBS_ERROR_NONE)
@@ -199,6 +204,7 @@ void WaveshareRelay::TimerHit()
     if (!isConnected())
         return;
 
+    m_Batch.execute(&nmbs);
     if (m_HaveInput)
         UpdateDigitalInputs();
     UpdateDigitalOutputs();
@@ -212,8 +218,7 @@ void WaveshareRelay::TimerHit()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool WaveshareRelay::UpdateDigitalOutputs()
 {
-    nmbs_bitfield coils = {0};
-    auto err = nmbs_read_coils(&nmbs, 0, 8, coils);
+    auto err = m_Batch.error(ModbusReadBatch::COILS);
     if (err != NMBS_ERROR_NONE)
     {
         LOGF_ERROR("Error reading coils at address 0: %s", nmbs_strerror(err));
@@ -224,7 +229,7 @@ bool WaveshareRelay::UpdateDigitalOutputs()
         for (size_t i = 0; i < DigitalOutputsSP.size(); i++)
         {
             auto oldState = DigitalOutputsSP[i].findOnSwitchIndex();
-            auto newState = nmbs_bitfield_read(coils, i);
+            auto newState = m_Batch.bit(ModbusReadBatch::COILS, i);
             if (oldState != newState)
             {
                 DigitalOutputsSP[i].reset();
@@ -251,6 +256,8 @@ bool WaveshareRelay::CommandOutput(uint32_t index, OutputState command)
         return false;
     }
 
+    m_Batch.update(ModbusReadBatch::COILS, index, command == OutputState::On);
+
     return true;
 }
 
@@ -259,9 +266,7 @@ bool WaveshareRelay::CommandOutput(uint32_t index, OutputState command)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool WaveshareRelay::UpdateDigitalInputs()
 {
-    nmbs_bitfield inputs_buffer = {0};
-
-    nmbs_error err = nmbs_read_discrete_inputs(&nmbs, 0, 8, inputs_buffer);
+    nmbs_error err = m_Batch.error(ModbusReadBatch::DISCRETE_INPUTS);
 
     if (err != NMBS_ERROR_NONE)
     {
@@ -281,7 +286,7 @@ bool WaveshareRelay::UpdateDigitalInputs()
         for (int i = 0; i < 8; i++)
         {
             auto oldStateIndex = DigitalInputsSP[i].findOnSwitchIndex();
-            auto newState      = nmbs_bitfield_read(inputs_buffer, i);
+            auto newState      = m_Batch.bit(ModbusReadBatch::DISCRETE_INPUTS, i);
 
             // Update if value changed or if the individual input was in ALERT
             if (DigitalInputsSP[i].getState() == IPS_ALERT || oldStateIndex != newState)
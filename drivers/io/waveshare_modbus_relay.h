@@ -21,6 +21,7 @@
 #include "defaultdevice.h"
 #include "inditimer.h"
 #include "../../libs/modbus/nanomodbus.h"
+#include "../../libs/modbus/readbatch.h"
 
 class WaveshareRelay : public INDI::DefaultDevice, public INDI::OutputInterface,
     public INDI::InputInterface // Added InputInterface
@@ -75,5 +76,7 @@ class WaveshareRelay : public INDI::DefaultDevice, public INDI::OutputInterface,
         int PortFD{-1};
         bool m_HaveInput {false};
         nmbs_t nmbs;
+        // Coils and inputs, read once per poll
+        ModbusReadBatch m_Batch;
 
 };
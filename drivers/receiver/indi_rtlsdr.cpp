@@ -27,9 +27,12 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <termios.h>
+#include <poll.h>
 #include <indilogger.h>
 #include <memory>
 #include <deque>
+#include <algorithm>
+#include <cstring>
 #include <indicom.h>
 
 #define min(a, b)               \
@@ -44,57 +47,130 @@
 #define MAX_FRAME_SIZE (SUBFRAME_SIZE * 16)
 #define SPECTRUM_SIZE  (256)
 
-static pthread_cond_t cv         = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t condMutex = PTHREAD_MUTEX_INITIALIZER;
+#define RING_BLOCKS    (64)
 
-void RTLSDR::Callback()
+void RTLSDR::asyncCallback(unsigned char *buf, uint32_t len, void *ctx)
+{
+    RTLSDR *receiver = static_cast<RTLSDR *>(ctx);
+    if (!receiver->readerRunning)
+    {
+        rtlsdr_cancel_async(receiver->rtl_dev);
+        return;
+    }
+    receiver->pushSamples(buf, len);
+}
+
+void RTLSDR::pushSamples(const uint8_t *data, size_t size)
+{
+    std::vector<uint8_t> dropped;
+    samples->push(std::vector<uint8_t>(data, data + size), &dropped);
+    if (!dropped.empty())
+    {
+        // Processing can not keep up, the oldest samples are lost
+        if (droppedBlocks++ == 0)
+            LOG_WARN("Sample processing is too slow, samples lost.");
+        else
+            LOGF_DEBUG("%llu sample blocks lost.", static_cast<unsigned long long>(droppedBlocks));
+    }
+}
+
+void RTLSDR::readLoop()
 {
-    LOG_INFO("Integration started...");
-    b_read = 0;
-    n_read = 0;
-    setBufferSize(getSampleRate() * IntegrationRequest * getBPS() / 8);
-    setBufferSize(getBufferSize() + MAX_FRAME_SIZE - (getBufferSize() % MAX_FRAME_SIZE));
-    to_read = getBufferSize();
-    buffer = (unsigned char *)realloc(buffer, min(MAX_FRAME_SIZE, getBufferSize()));
     if((getSensorConnection() & CONNECTION_TCP) == 0)
+    {
         rtlsdr_reset_buffer(rtl_dev);
-    else
-        tcflush(PortFD, TCIFLUSH);
-    setIntegrationTime(IntegrationRequest);
-    InIntegration = true;
-    continuum = getBuffer();
-    gettimeofday(&IntStart, nullptr);
-    while (InIntegration)
+        // Returns once asyncCallback cancels it
+        if (rtlsdr_read_async(rtl_dev, asyncCallback, this, 0, MAX_FRAME_SIZE) < 0)
+            LOG_ERROR("Failed to read samples from the device.");
+        return;
+    }
+
+    tcflush(PortFD, TCIFLUSH);
+    std::vector<uint8_t> block(MAX_FRAME_SIZE);
+    while (readerRunning)
     {
-        if (to_read > 0)
+        struct pollfd pfd = { PortFD, POLLIN, 0 };
+        if (poll(&pfd, 1, 500) <= 0)
+            continue;
+
+        int n_read = read(PortFD, block.data(), block.size());
+        if (n_read > 0)
+            pushSamples(block.data(), n_read);
+        else if (n_read == 0 || (errno != EINTR && errno != EAGAIN))
         {
-            if((getSensorConnection() & CONNECTION_TCP) == 0)
-                rtlsdr_read_sync(rtl_dev, continuum + b_read, min(MAX_FRAME_SIZE, to_read), &n_read);
-            else
-                n_read = read(PortFD, continuum + b_read, min(MAX_FRAME_SIZE, to_read));
-
-            if (n_read > 0) {
-                b_read += n_read;
-                to_read -= n_read;
-            }
-        } else {
-            if(!streamPredicate)
+            LOG_ERROR("Failed to read samples from the rtl_tcp server.");
+            return;
+        }
+    }
+}
+
+void RTLSDR::processLoop()
+{
+    std::vector<uint8_t> block;
+    while (samples->pop(block))
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+
+        if (InIntegration && to_read > 0)
+        {
+            int n = min(to_read, static_cast<int>(block.size()));
+            memcpy(getBuffer() + b_read, block.data(), n);
+            b_read += n;
+            to_read -= n;
+            if (to_read == 0)
             {
                 InIntegration = false;
+                LOG_INFO("Download complete.");
                 IntegrationComplete();
             }
-            else
+        }
+
+        // The same samples, cut into fixed-size stream blocks
+        for (size_t offset = 0; streamBlockSize > 0 && offset < block.size();)
+        {
+            if (streamFill == 0)
+                streamBlock = Streamer->acquireFrameBuffer(streamBlockSize);
+
+            size_t n = min(streamBlockSize - streamFill, block.size() - offset);
+            memcpy(streamBlock.data() + streamFill, block.data() + offset, n);
+            offset += n;
+            streamFill += n;
+            if (streamFill == streamBlockSize)
             {
-                Streamer->newFrame(getBuffer(), getBufferSize());
-                to_read = getBufferSize();
-                b_read = 0;
-                n_read = 0;
+                // Spectra are integrated on the stream, whole samples only
+                if (HasDSP())
+                    DSP->processStream(streamBlock.data(), streamBlockSize * 8 / getBPS(), getBPS());
+                Streamer->newFrame(std::move(streamBlock));
+                streamFill = 0;
             }
-            LOG_INFO("Download complete.");
         }
     }
 }
 
+void RTLSDR::startReader()
+{
+    if (readerRunning)
+        return;
+
+    samples.reset(new SPSCRing<std::vector<uint8_t>>(RING_BLOCKS, SPSCRing<std::vector<uint8_t>>::OVERFLOW_DROP_OLDEST));
+    droppedBlocks = 0;
+    readerRunning = true;
+    readerThread  = std::thread(&RTLSDR::readLoop, this);
+    processThread = std::thread(&RTLSDR::processLoop, this);
+}
+
+void RTLSDR::stopReader()
+{
+    if (!readerRunning.exchange(false))
+        return;
+
+    if((getSensorConnection() & CONNECTION_TCP) == 0)
+        rtlsdr_cancel_async(rtl_dev);
+    readerThread.join();
+    samples->abort();
+    processThread.join();
+}
+
 static class Loader
 {
         std::deque<std::unique_ptr<RTLSDR>> receivers;
@@ -136,7 +212,6 @@ RTLSDR::RTLSDR(int32_t index)
     // We set the Receiver capabilities
     uint32_t cap = SENSOR_CAN_ABORT | SENSOR_HAS_STREAMING | SENSOR_HAS_DSP;
     SetReceiverCapability(cap);
-    buffer = (unsigned char*)malloc(1);
 }
 
 bool RTLSDR::Connect()
@@ -159,6 +234,7 @@ bool RTLSDR::Connect()
 bool RTLSDR::Disconnect()
 {
     InIntegration = false;
+    stopReader();
     if((getSensorConnection() & CONNECTION_TCP) == 0)
     {
         rtlsdr_close(rtl_dev);
@@ -166,11 +242,7 @@ bool RTLSDR::Disconnect()
     PortFD = -1;
 
     setBufferSize(1);
-    pthread_mutex_lock(&condMutex);
-    streamPredicate = 1;
-    terminateThread = true;
-    pthread_cond_signal(&cv);
-    pthread_mutex_unlock(&condMutex);
+    streamBlockSize = 0;
     LOG_INFO("RTL-SDR Receiver disconnected successfully!");
     return true;
 }
@@ -331,10 +403,21 @@ bool RTLSDR::ISNewNumber(const char *dev, const char *name, double values[], cha
 bool RTLSDR::StartIntegration(double duration)
 {
     IntegrationRequest = static_cast<float>(duration);
-    AbortIntegration();
 
-    // Run threads
-    std::thread(&RTLSDR::Callback, this).detach();
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        setBufferSize(getSampleRate() * IntegrationRequest * getBPS() / 8);
+        setBufferSize(getBufferSize() + MAX_FRAME_SIZE - (getBufferSize() % MAX_FRAME_SIZE));
+        to_read = getBufferSize();
+        b_read = 0;
+        setIntegrationTime(IntegrationRequest);
+        InIntegration = true;
+        gettimeofday(&IntStart, nullptr);
+    }
+
+    // The integration starts with the next samples read, the device keeps running from the previous one
+    startReader();
+    LOG_INFO("Integration started...");
     return true;
 }
 
@@ -343,10 +426,13 @@ bool RTLSDR::StartIntegration(double duration)
 ***************************************************************************************/
 bool RTLSDR::AbortIntegration()
 {
-    if (InIntegration)
-    {
-        InIntegration = false;
-    }
+    std::unique_lock<std::mutex> lock(captureMutex);
+    InIntegration = false;
+    bool streaming = streamBlockSize > 0;
+    lock.unlock();
+
+    if (!streaming)
+        stopReader();
     return true;
 }
 
@@ -407,22 +493,29 @@ void RTLSDR::grabData()
 
 bool RTLSDR::StartStreaming()
 {
-    pthread_mutex_lock(&condMutex);
-    streamPredicate = 1;
-    StartIntegration(1.0 / Streamer->getTargetFPS());
-    pthread_mutex_unlock(&condMutex);
-    pthread_cond_signal(&cv);
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        // One block per frame at the target rate, whole 16 bits I/Q samples
+        streamBlockSize = static_cast<size_t>(getSampleRate() / Streamer->getTargetFPS()) * getBPS() / 8;
+        streamBlockSize = std::max<size_t>(streamBlockSize - streamBlockSize % 2, MIN_FRAME_SIZE);
+        streamFill = 0;
+    }
 
+    startReader();
     return true;
 }
 
 bool RTLSDR::StopStreaming()
 {
-    pthread_mutex_lock(&condMutex);
-    streamPredicate = 0;
-    pthread_mutex_unlock(&condMutex);
-    pthread_cond_signal(&cv);
-
+    std::unique_lock<std::mutex> lock(captureMutex);
+    streamBlockSize = 0;
+    streamFill = 0;
+    streamBlock = std::vector<uint8_t>();
+    bool integrating = InIntegration;
+    lock.unlock();
+
+    if (!integrating)
+        stopReader();
     return true;
 }
 
@@ -437,8 +530,6 @@ bool RTLSDR::Handshake()
         }
     }
 
-    streamPredicate = 0;
-    terminateThread = false;
     LOG_INFO("RTL-SDR Receiver connected successfully!");
     // Let's set a timer that checks teleReceivers status every POLLMS milliseconds.
     // JM 2017-07-31 SetTimer already called in updateProperties(). Just call it once
@@ -26,6 +26,13 @@
 #include <rtl-sdr.h>
 #include "indireceiver.h"
 #include "stream/streammanager.h"
+#include "stream/spscring.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 enum Settings
 {
@@ -44,8 +51,7 @@ class RTLSDR : public INDI::Receiver
         int to_read;
         // Are we integrating?
         bool InIntegration;
-        uint8_t *buffer;
-        int b_read, n_read;
+        int b_read;
         bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
 
     protected:
@@ -64,12 +70,18 @@ class RTLSDR : public INDI::Receiver
 
         bool StartStreaming() override;
         bool StopStreaming() override;
-        void * streamCapture();
 
         bool Handshake() override;
 
     private:
-        void Callback();
+        // Continuous capture: the reader thread fills the sample ring, the process thread cuts integrations
+        // and stream blocks from it, so the device keeps running between integrations
+        void startReader();
+        void stopReader();
+        void readLoop();
+        void processLoop();
+        void pushSamples(const uint8_t *data, size_t size);
+        static void asyncCallback(unsigned char *buf, uint32_t len, void *ctx);
 
         // Utility functions
         float CalcTimeLeft();
@@ -81,9 +93,17 @@ class RTLSDR : public INDI::Receiver
 
         int32_t receiverIndex = { 0 };
 
-        int streamPredicate;
-        pthread_t primary_thread;
-        bool terminateThread;
+        std::unique_ptr<SPSCRing<std::vector<uint8_t>>> samples;
+        std::thread readerThread;
+        std::thread processThread;
+        std::atomic<bool> readerRunning { false };
+        uint64_t droppedBlocks { 0 };
+
+        // Guards the integration and stream state shared with the process thread
+        std::mutex captureMutex;
+        std::vector<uint8_t> streamBlock;
+        size_t streamBlockSize { 0 };
+        size_t streamFill { 0 };
 
         bool sendTcpCommand(int cmd, int value);
         enum TcpCommands
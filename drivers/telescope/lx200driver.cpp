@@ -41,6 +41,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 /* Add mutex */
 
 #include <mutex>
+#include <vector>
 
 #define LX200_TIMEOUT 5 /* FD timeout in seconds */
 #define RB_MAX_LEN    64
@@ -249,6 +250,84 @@ int getCommandString(int fd, char *data, const char *cmd)
     return 0;
 }
 
+int getCommandStringBatch(int fd, char *const *data, const char *const *cmds, int count)
+{
+    char batch[RB_MAX_LEN * 4] = {0};
+    int error_type;
+    int nbytes_write = 0, nbytes_read = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (strlen(batch) + strlen(cmds[i]) >= sizeof(batch))
+            return TTY_OVERFLOW;
+        strcat(batch, cmds[i]);
+    }
+
+    DEBUGFDEVICE(lx200Name, DBG_SCOPE, "CMD <%s>", batch);
+
+    /* Add mutex */
+    std::unique_lock<std::mutex> guard(lx200CommsLock);
+
+    tcflush(fd, TCIFLUSH);
+
+    if ((error_type = tty_write_string(fd, batch, &nbytes_write)) != TTY_OK)
+        return error_type;
+
+    // The replies come back to back, read them in blocks and keep what follows each one for the next
+    tty_set_read_ahead(fd, 1);
+    for (int i = 0; i < count && error_type == TTY_OK; i++)
+    {
+        error_type = tty_nread_section(fd, data[i], RB_MAX_LEN, '#', LX200_TIMEOUT, &nbytes_read);
+        if (error_type == TTY_OK)
+        {
+            data[i][nbytes_read - 1] = '\0';
+            DEBUGFDEVICE(lx200Name, DBG_SCOPE, "RES <%s>", data[i]);
+        }
+    }
+    tty_set_read_ahead(fd, 0);
+    tcflush(fd, TCIFLUSH);
+
+    return error_type;
+}
+
+int getCommandSexaBatch(int fd, double *values, const char *const *cmds, int count)
+{
+    std::vector<char> replies(count * RB_MAX_LEN);
+    std::vector<char *> data(count);
+    for (int i = 0; i < count; i++)
+        data[i] = replies.data() + i * RB_MAX_LEN;
+
+    int error_type = getCommandStringBatch(fd, data.data(), cmds, count);
+    if (error_type != TTY_OK)
+        return error_type;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (f_scansexa(data[i], &values[i]))
+        {
+            DEBUGFDEVICE(lx200Name, DBG_SCOPE, "Unable to parse %s response", cmds[i]);
+            return -1;
+        }
+        DEBUGFDEVICE(lx200Name, DBG_SCOPE, "VAL [%g]", values[i]);
+    }
+
+    return 0;
+}
+
+int getLX200EquatorialCoordinates(int fd, double *ra, double *dec)
+{
+    const char *cmds[2] = {":GR#", ":GD#"};
+    double values[2] = {0, 0};
+
+    int error_type = getCommandSexaBatch(fd, values, cmds, 2);
+    if (error_type != 0)
+        return error_type;
+
+    *ra  = values[0];
+    *dec = values[1];
+    return 0;
+}
+
 int isSlewComplete(int fd)
 {
     DEBUGFDEVICE(lx200Name, DBG_SCOPE, "<%s>", __FUNCTION__);
@@ -202,6 +202,12 @@ int getCommandSexa(int fd, double *value, const char *cmd);
 int getCommandString(int fd, char *data, const char *cmd);
 /* Get Int */
 int getCommandInt(int fd, int *value, const char *cmd);
+/* Send count commands back to back and read their '#' terminated replies in order, each data[i] holds 64 bytes */
+int getCommandStringBatch(int fd, char *const *data, const char *const *cmds, int count);
+/* Send count commands back to back and parse their sexagesimal replies in order */
+int getCommandSexaBatch(int fd, double *values, const char *const *cmds, int count);
+/* Get RA and DEC with one batch of :GR# and :GD# */
+int getLX200EquatorialCoordinates(int fd, double *ra, double *dec);
 /* Get tracking frequency */
 int getTrackFreq(int fd, double *value);
 /* Get site Latitude */
@@ -312,7 +312,10 @@ bool LX200Telescope::ReadScopeStatus()
         }
     }
 
-    if (getLX200RA(PortFD, &currentRA) < 0 || getLX200DEC(PortFD, &currentDEC) < 0)
+    int rc = (genericCapability & LX200_HAS_PIPELINED_QUERIES) ?
+             getLX200EquatorialCoordinates(PortFD, &currentRA, &currentDEC) :
+             ((getLX200RA(PortFD, &currentRA) < 0 || getLX200DEC(PortFD, &currentDEC) < 0) ? -1 : 0);
+    if (rc < 0)
     {
         EqNP.setState(IPS_ALERT);
         LOG_ERROR("Error reading RA/DEC.");
@@ -47,6 +47,7 @@ class LX200Telescope : public INDI::Telescope, public INDI::GuiderInterface, pub
             LX200_HAS_SITES                  = 1 << 3, /** Define Sites */
             LX200_HAS_PULSE_GUIDING          = 1 << 4, /** Define Pulse Guiding */
             LX200_HAS_PRECISE_TRACKING_FREQ  = 1 << 5, /** Use more precise tracking frequency, if supported by hardware. */
+            LX200_HAS_PIPELINED_QUERIES      = 1 << 6, /** Send the status queries back to back, the controller answers them in order. */
         } LX200Capability;
 
         uint32_t getLX200Capability() const
@@ -22,7 +22,7 @@
 #include "planewave_mount.h"
 
 #include "indicom.h"
-#include <httplib.h>
+#include "httpclientpool.h"
 #include "connectionplugins/connectiontcp.h"
 #include <libnova/sidereal_time.h>
 #include <libnova/transform.h>
@@ -148,9 +148,9 @@ bool PlaneWave::Sync(double ra, double dec)
 /////////////////////////////////////////////////////////////////////////////
 bool PlaneWave::Goto(double ra, double dec)
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
     std::string request = "/mount/goto_ra_dec_apparent?ra_hours=" + std::to_string(ra) + "&dec_degs=" + std::to_string(dec);
-    return cli.Get(request);
+    return cli->Get(request);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -193,9 +193,9 @@ bool PlaneWave::ReadScopeStatus()
 /////////////////////////////////////////////////////////////////////////////
 bool PlaneWave::Park()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
     std::string request = "/mount/park";
-    return cli.Get(request);
+    return cli->Get(request);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -249,9 +249,9 @@ bool PlaneWave::ISNewSwitch(const char *dev, const char *name, ISState * states,
 /////////////////////////////////////////////////////////////////////////////
 bool PlaneWave::Abort()
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
     std::string request = "/mount/stop";
-    return cli.Get(request);
+    return cli->Get(request);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -371,9 +371,9 @@ bool PlaneWave::SetTrackMode(uint8_t mode)
     INDI_UNUSED(dDE);
 
     // TODO figure out how to set tracking rate per axis
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
     std::string request = "/mount/tracking_on";
-    return cli.Get(request);
+    return cli->Get(request);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -387,9 +387,9 @@ bool PlaneWave::SetTrackEnabled(bool enabled)
     // Disable tracking
     else
     {
-        httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+        auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
         std::string request = "/mount/tracking_off";
-        return cli.Get(request);
+        return cli->Get(request);
     }
     return false;
 }
@@ -408,9 +408,9 @@ bool PlaneWave::saveConfigItems(FILE *fp)
 /////////////////////////////////////////////////////////////////////////////
 bool PlaneWave::dispatch(const std::string &request)
 {
-    httplib::Client cli(tcpConnection->host(), tcpConnection->port());
+    auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
 
-    if (auto res = cli.Get(request))
+    if (auto res = cli->Get(request))
     {
         try
         {
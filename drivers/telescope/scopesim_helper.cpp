@@ -24,6 +24,9 @@
 #include "scopesim_helper.h"
 
 #include "indilogger.h"
+#include "indisimulatedclock.h"
+
+#include <libnova/sidereal_time.h>
 
 /////////////////////////////////////////////////////////////////////
 
@@ -132,7 +135,7 @@ void Axis::update()         // called about once a second to update the position
     };
 
     /* update elapsed time since last poll, don't presume exactly POLLMS */
-    gettimeofday(&currentTime, nullptr);
+    INDI::SimulatedClock::gettimeofday(&currentTime);
 
     if (lastTime.tv_sec == 0 && lastTime.tv_usec == 0)
         lastTime = currentTime;
@@ -225,7 +228,9 @@ void Axis::update()         // called about once a second to update the position
 
 Angle Alignment::lst()
 {
-    return Angle(get_local_sidereal_time(longitude.Degrees360()) * 15.0);
+    // The sky turns with the simulated time, the mount tracks it at the simulated rate
+    return Angle(range24(ln_get_apparent_sidereal_time(INDI::SimulatedClock::julianDate()) + longitude.Degrees360() / 15.0) *
+                 15.0);
 }
 
 void Alignment::mountToApparentHaDec(Angle primary, Angle secondary, Angle * apparentHa, Angle* apparentDec)
@@ -360,10 +365,10 @@ void Alignment::instrumentToObserved(Angle instrumentHa, Angle instrumentDec, An
 
     // Use rotations so the corrections work at the pole
     // apply polar axis Azimuth error using rotation in the East, West, Pole plane (X)
-    Vector vMa = Vector(*observedHa, *observedDec).rotateX(MA);
+    Vector vMa = Vector(*observedHa, *observedDec).rotateX(cosMa, sinMa);
 
     // apply polar axis elevation error using rotation in the North, South, Pole plane (Y)
-    Vector vMe = vMa.rotateY(Angle(ME));
+    Vector vMe = vMa.rotateY(cosMe, sinMe);
 
     *observedHa = vMe.primary();
     *observedDec = vMe.secondary();
@@ -379,10 +384,10 @@ void Alignment::observedToInstrument(Angle observedHa, Angle observedDec, Angle
     // do the corrections consecutively
     // use vector rotations for MA and ME so they work close to the pole
     // rotate about the EW axis (Y)
-    Vector vMe = Vector(observedHa, observedDec).rotateY(Angle(-ME));
+    Vector vMe = Vector(observedHa, observedDec).rotateY(cosMe, -sinMe);
 
     // apply polar axis Azimuth error
-    Vector vMa = vMe.rotateX(-MA);
+    Vector vMa = vMe.rotateX(cosMa, -sinMa);
 
     *instrumentHa = vMa.primary();
     *instrumentDec = vMa.secondary();
@@ -493,6 +498,10 @@ void Alignment::setCorrections(double ih, double id, double ch, double np, doubl
     NP = np;
     MA = ma;
     ME = me;
+    cosMa = std::cos(Angle(MA).radians());
+    sinMa = std::sin(Angle(MA).radians());
+    cosMe = std::cos(Angle(ME).radians());
+    sinMe = std::sin(Angle(ME).radians());
     LOGF_DEBUG("setCorrections IH %f, ID %f, CH %f, NP %f, MA %f, ME %f", IH, ID, CH, NP, MA, ME);
 }
 
@@ -544,21 +553,30 @@ Angle Vector::secondary()
 
 Vector Vector::rotateX(Angle angle)
 {
-    double ca = std::cos(angle.radians());
-    double sa = std::sin(angle.radians());
+    return rotateX(std::cos(angle.radians()), std::sin(angle.radians()));
+}
+
+Vector Vector::rotateX(double ca, double sa)
+{
     return Vector(L, M * ca + N * sa, N * ca - M * sa);
 }
 
 Vector Vector::rotateY(Angle angle)
 {
-    double ca = std::cos(angle.radians());
-    double sa = std::sin(angle.radians());
+    return rotateY(std::cos(angle.radians()), std::sin(angle.radians()));
+}
+
+Vector Vector::rotateY(double ca, double sa)
+{
     return Vector(L * ca - N * sa, M, L * sa + N * ca);
 }
 
 Vector Vector::rotateZ(Angle angle)
 {
-    double ca = std::cos(angle.radians());
-    double sa = std::sin(angle.radians());
+    return rotateZ(std::cos(angle.radians()), std::sin(angle.radians()));
+}
+
+Vector Vector::rotateZ(double ca, double sa)
+{
     return Vector(L * ca + M * sa, M * ca - L * sa, N);
 }
@@ -549,6 +549,9 @@ class Alignment
         ///
         double ME = 0;
 
+        // the MA and ME rotations, set with the corrections so the trig is not repeated for every position
+        double cosMa = 1, sinMa = 0;
+        double cosMe = 1, sinMe = 0;
 
         // corrections done using direction cosines and rotations after Taki
         //apparentHaDecToMount(Vector HaDec, Vector * mount);
@@ -619,18 +622,42 @@ class Vector
         ///
         Vector rotateX(Angle angle);
 
+        ///
+        /// \brief rotateX rotates this vector about the X axis through an angle given by its cosine and sine,
+        /// so a rotation used for many vectors is found once
+        /// \param cosAngle
+        /// \param sinAngle
+        ///
+        Vector rotateX(double cosAngle, double sinAngle);
+
         ///
         /// \brief rotateY rotates this vector through angle about the Y axis
         /// \param angle
         ///
         Vector rotateY(Angle angle);
 
+        ///
+        /// \brief rotateY rotates this vector about the Y axis through an angle given by its cosine and sine,
+        /// so a rotation used for many vectors is found once
+        /// \param cosAngle
+        /// \param sinAngle
+        ///
+        Vector rotateY(double cosAngle, double sinAngle);
+
         ///
         /// \brief rotateZ rotates this vector through angle about the Z axis
         /// \param rotX
         ///
         Vector rotateZ(Angle angle);
 
+        ///
+        /// \brief rotateZ rotates this vector about the Z axis through an angle given by its cosine and sine,
+        /// so a rotation used for many vectors is found once
+        /// \param cosAngle
+        /// \param sinAngle
+        ///
+        Vector rotateZ(double cosAngle, double sinAngle);
+
         double l()
         {
             return L;
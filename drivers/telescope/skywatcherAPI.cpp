@@ -230,11 +230,27 @@ bool SkywatcherAPI::GetEncoder(AXISID Axis)
     if (!TalkWithAxis(Axis, GetAxisPosition, Parameters, Response))
         return false;
 
+    ParseEncoder(Axis, Response);
+    return true;
+}
+
+bool SkywatcherAPI::GetEncoders()
+{
+    std::vector<std::string> Responses;
+    if (!TalkWithAxes({{AXIS1, GetAxisPosition}, {AXIS2, GetAxisPosition}}, Responses))
+        return false;
+
+    ParseEncoder(AXIS1, Responses[0]);
+    ParseEncoder(AXIS2, Responses[1]);
+    return true;
+}
+
+void SkywatcherAPI::ParseEncoder(AXISID Axis, std::string &Response)
+{
     long Microsteps = BCDstr2long(Response);
     // Only accept valid data
     if (Microsteps > 0)
         CurrentEncoders[Axis] = Microsteps;
-    return true;
 }
 
 bool SkywatcherAPI::GetHighSpeedRatio(AXISID Axis)
@@ -366,6 +382,30 @@ bool SkywatcherAPI::GetStatus(AXISID Axis)
     if (!TalkWithAxis(Axis, GetAxisStatus, Parameters, Response))
         return false;
 
+    ParseStatus(Axis, Response);
+    return true;
+}
+
+bool SkywatcherAPI::GetStatusAndEncoders()
+{
+    std::vector<std::string> Responses;
+    if (!TalkWithAxes({{AXIS1, GetAxisStatus}, {AXIS2, GetAxisStatus}, {AXIS1, GetAxisPosition}, {AXIS2, GetAxisPosition}},
+                      Responses))
+        return false;
+
+    ParseEncoder(AXIS1, Responses[2]);
+    ParseEncoder(AXIS2, Responses[3]);
+    ParseStatus(AXIS1, Responses[0]);
+    ParseStatus(AXIS2, Responses[1]);
+    return true;
+}
+
+void SkywatcherAPI::ParseStatus(AXISID Axis, const std::string &Response)
+{
+    // Status is three hex digits
+    if (Response.size() < 3)
+        return;
+
     if ((Response[1] & 0x01) != 0)
     {
         // Axis is running
@@ -415,8 +455,6 @@ bool SkywatcherAPI::GetStatus(AXISID Axis)
         AxesStatus[(int)Axis].NotInitialized = true; // MC is not initialized.
     else
         AxesStatus[(int)Axis].NotInitialized = false;
-
-    return true;
 }
 
 // Set initialization done ":F3", where '3'= Both CH1 and CH2.
@@ -971,6 +1009,77 @@ bool SkywatcherAPI::TalkWithAxis(AXISID Axis, SkywatcherCommand Command, std::st
     return true;
 }
 
+bool SkywatcherAPI::TalkWithAxes(const std::vector<std::pair<AXISID, SkywatcherCommand>> &Commands,
+                                 std::vector<std::string> &Responses)
+{
+    Responses.clear();
+
+    if (PipelinedCommands)
+    {
+        int bytesWritten = 0;
+        int bytesRead = 0;
+        bool isComplete = true;
+        char command[SKYWATCHER_MAX_CMD] = {0};
+        char response[SKYWATCHER_MAX_CMD] = {0};
+
+        tcflush(MyPortFD, TCIOFLUSH);
+        // One write per command, so each is a datagram of its own over UDP
+        for (const auto &exchange : Commands)
+        {
+            snprintf(command, SKYWATCHER_MAX_CMD, ":%c%c\r", exchange.second, exchange.first == AXIS1 ? '1' : '2');
+            MYDEBUGF(DBG_SCOPE, "CMD <%.*s>", static_cast<int>(strlen(command)) - 2, command + 1);
+            if (tty_write_string(MyPortFD, command, &bytesWritten) != TTY_OK)
+            {
+                isComplete = false;
+                break;
+            }
+        }
+
+        // The serial replies arrive back to back, read them in blocks
+        tty_set_read_ahead(MyPortFD, 1);
+        while (isComplete && Responses.size() < Commands.size())
+        {
+            memset(response, '\0', SKYWATCHER_MAX_CMD);
+            if (tty_read_section_expanded(MyPortFD, response, 0x0D, SKYWATCHER_TIMEOUT_S, SKYWATCHER_TIMEOUT_US,
+                                          &bytesRead) != TTY_OK || bytesRead < 2 || (response[0] != '=' && response[0] != '!'))
+            {
+                isComplete = false;
+                break;
+            }
+            response[bytesRead - 1] = '\0';
+            MYDEBUGF(DBG_SCOPE, "RES <%s>", response + 1);
+            if (response[0] == '!')
+                break;
+            Responses.push_back(response + 1);
+        }
+        tty_set_read_ahead(MyPortFD, 0);
+
+        if (isComplete && response[0] == '!')
+        {
+            // The controller keeps up, it just refused a command
+            uint8_t code = response[1] - 0x30;
+            if (errorCodes.count(code) > 0)
+                MYDEBUGF(INDI::Logger::DBG_ERROR, "Mount error: %s", errorCodes.at(code).c_str());
+            return false;
+        }
+        if (isComplete)
+            return true;
+
+        MYDEBUG(INDI::Logger::DBG_DEBUG, "Pipelined commands unanswered, sending one command at a time.");
+        PipelinedCommands = false;
+        Responses.clear();
+    }
+
+    for (const auto &exchange : Commands)
+    {
+        std::string Parameters, Response;
+        if (!TalkWithAxis(exchange.first, exchange.second, Parameters, Response))
+            return false;
+        Responses.push_back(Response);
+    }
+    return true;
+}
+
 bool SkywatcherAPI::IsInMotion(AXISID Axis)
 {
     MYDEBUG(DBG_SCOPE, "IsInMotion");
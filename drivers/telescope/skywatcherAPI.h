@@ -18,6 +18,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #define INDI_DEBUG_LOGGING
 #ifdef INDI_DEBUG_LOGGING
@@ -153,6 +154,10 @@ class SkywatcherAPI
         /// \return false failure
         bool GetEncoder(AXISID Axis);
 
+        /// \brief Set the CurrentEncoders status variable of both axes with one pipelined exchange.
+        /// \return false failure
+        bool GetEncoders();
+
         /// \brief Set the HighSpeedRatio status variable to the ratio between
         /// high and low speed stepping modes.
         bool GetHighSpeedRatio(AXISID Axis);
@@ -185,6 +190,10 @@ class SkywatcherAPI
 
         bool GetStatus(AXISID Axis);
 
+        /// \brief Set the AxesStatus and CurrentEncoders status variables of both axes with one pipelined exchange.
+        /// \return false failure
+        bool GetStatusAndEncoders();
+
         /// \brief Set the StepperClockFrequency status variable to fixed PIC timer interrupt
         /// frequency (ticks per second).
         /// \return false failure
@@ -325,6 +334,15 @@ class SkywatcherAPI
 
         bool TalkWithAxis(AXISID Axis, SkywatcherCommand Command, std::string &cmdDataStr, std::string &responseStr);
 
+        /// \brief Write several parameterless commands back to back and collect their responses in order.
+        /// Falls back to one TalkWithAxis per command, for the rest of the session, if the controller does not
+        /// answer them all.
+        /// \param[in] Commands - The axis and command of each exchange.
+        /// \param[out] Responses - The response of each command, without the leading '='.
+        /// \return false failure
+        bool TalkWithAxes(const std::vector<std::pair<AXISID, SkywatcherCommand>> &Commands,
+                          std::vector<std::string> &Responses);
+
         /// \brief Check if an axis is moving
         /// \param[in] Axis - The axis to check.
         /// \return True if the axis is moving otherwise false.
@@ -408,7 +426,12 @@ class SkywatcherAPI
         unsigned int DBG_SCOPE { 0 };
 
     private:
+        void ParseEncoder(AXISID Axis, std::string &Response);
+        void ParseStatus(AXISID Axis, const std::string &Response);
+
         int MyPortFD { 0 };
+        /// Commands are pipelined until the controller misses one of the replies
+        bool PipelinedCommands { true };
         /// default timeout in synscan app os 200ms and 2 retransmissions, so put there little bit more
         static constexpr uint8_t SKYWATCHER_MAX_RETRTY {5};
         static constexpr uint8_t SKYWATCHER_TIMEOUT_S  {0};
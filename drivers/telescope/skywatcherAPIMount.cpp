@@ -794,16 +794,8 @@ bool SkywatcherAPIMount::SetTrackEnabled(bool enabled)
 //////////////////////////////////////////////////////////////////////////////////////////////////
 bool SkywatcherAPIMount::ReadScopeStatus()
 {
-    if (!GetStatus(AXIS1))
-        return false;
-
-    if (!GetStatus(AXIS2))
-        return false;
-
-    // Update Axis Position
-    if (!GetEncoder(AXIS1))
-        return false;
-    if (!GetEncoder(AXIS2))
+    // Update Axis Status and Position
+    if (!GetStatusAndEncoders())
         return false;
 
     UpdateDetailedMountInformation(true);
@@ -882,7 +874,7 @@ bool SkywatcherAPIMount::ReadScopeStatus()
 bool SkywatcherAPIMount::getCurrentAltAz(INDI::IHorizontalCoordinates &altaz)
 {
     // Update Axis Position
-    if (GetEncoder(AXIS1) && GetEncoder(AXIS2))
+    if (GetEncoders())
     {
         altaz.azimuth = range360(MicrostepsToDegrees(AXIS1,
                                  CurrentEncoders[AXIS1] - AxisOffsetNP[AZSteps].getValue() - ZeroPositionEncoders[AXIS1]));
@@ -963,9 +955,7 @@ bool SkywatcherAPIMount::Sync(double ra, double dec)
     DEBUG(INDI::AlignmentSubsystem::DBG_ALIGNMENT, "SkywatcherAPIMount::Sync");
 
     // Compute a telescope direction vector from the current encoders
-    if (!GetEncoder(AXIS1))
-        return false;
-    if (!GetEncoder(AXIS2))
+    if (!GetEncoders())
         return false;
 
     // Syncing is treated specially when the telescope position is known in park position to spare
@@ -26,7 +26,9 @@
 #include <memory>
 
 // We declare an auto pointer to ScopeSim.
+#ifndef INDI_SIMULATOR_HOST
 static std::unique_ptr<ScopeSim> telescope_sim(new ScopeSim());
+#endif
 
 #define RA_AXIS     0
 #define DEC_AXIS    1
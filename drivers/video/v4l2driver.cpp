@@ -1450,6 +1450,23 @@ void V4L2_Driver::newFrame()
     {
         non_capture_frames = 0;
 
+        // Time of capture by the kernel, rather than of processing
+        uint64_t timestamp = INDI::StreamManager::getTimestamp(v4l_base->getFrameTime());
+
+        uint32_t lentSize = 0;
+        int lentIndex     = -1;
+        auto lent = v4l_base->takeLentFrame(lentSize, lentIndex);
+        if (lent)
+        {
+            if (v4l_base->getFormat() != V4L2_PIX_FMT_GREY)
+                Streamer->setPixelFormat(INDI_JPG);
+            Streamer->newFrame(lent, lentSize, timestamp, [this, lentIndex]()
+            {
+                v4l_base->releaseFrame(lentIndex);
+            });
+            return;
+        }
+
         int width             = v4l_base->getWidth();
         int height            = v4l_base->getHeight();
         int bpp               = v4l_base->getBpp();
@@ -1470,7 +1487,7 @@ void V4L2_Driver::newFrame()
             }
             guard.unlock();
 
-            Streamer->newFrame(buffer, totalBytes);
+            Streamer->newFrame(buffer, totalBytes, timestamp);
             return;
         }
 
@@ -1527,12 +1544,12 @@ void V4L2_Driver::newFrame()
             memcpy(PrimaryCCD.getFrameBuffer(), buffer, totalBytes);
             PrimaryCCD.binFrame();
             guard.unlock();
-            Streamer->newFrame(PrimaryCCD.getFrameBuffer(), frameBytes / PrimaryCCD.getBinX());
+            Streamer->newFrame(PrimaryCCD.getFrameBuffer(), frameBytes / PrimaryCCD.getBinX(), timestamp);
         }
         else
         {
             guard.unlock();
-            Streamer->newFrame(buffer, frameBytes);
+            Streamer->newFrame(buffer, frameBytes, timestamp);
         }
         return;
     }
@@ -2055,6 +2072,11 @@ bool V4L2_Driver::StartStreaming()
     auto onSwitch = IUFindOnSwitch(&CaptureFormatsSP);
     if (onSwitch && strstr(onSwitch->label, "JPEG"))
         v4l_base->setNative(true);
+    // Stream the capture buffers as they are when no conversion is needed
+    v4l_base->setLending(PrimaryCCD.getBinX() == 1 && (v4l_base->getFormat() == V4L2_PIX_FMT_MJPEG ||
+                         v4l_base->getFormat() == V4L2_PIX_FMT_JPEG || CaptureFormatSP[IMAGE_MONO].getState() == ISS_ON));
+    // Keep the event loop free while streaming, iOptron cameras never stop capturing so they stay on it
+    v4l_base->setThreadedCapture(!isIOptron());
     /* Callee will take care of checking states */
     return start_capturing(true);
 }
@@ -2070,7 +2092,11 @@ bool V4L2_Driver::StopStreaming()
     }
 
     v4l_base->setNative(EncodeFormatSP[FORMAT_NATIVE].getState() == ISS_ON);
-    return stop_capturing();
+    v4l_base->setLending(false);
+    bool rc = stop_capturing();
+    // Exposures update properties and timers from the frame callback, they capture from the event loop
+    v4l_base->setThreadedCapture(false);
+    return rc;
 }
 
 bool V4L2_Driver::saveConfigItems(FILE * fp)
@@ -23,7 +23,7 @@
 #include "indi_astrospheric_weather.h"
 
 #include <indicom.h>
-#include <httplib.h>
+#include "httpclientpool.h"
 #ifdef _USE_SYSTEM_JSONLIB
 #include <nlohmann/json.hpp>
 #else
@@ -350,15 +350,22 @@ bool AstrosphericWeather::fetchDataFromAPI(std::string &responseBody)
     payload["APIKey"] = APIKeyTP[0].getText();
     std::string jsonDataString = payload.dump();
 
-    httplib::Client client(host.c_str());
-    auto res = client.Post(endpoint.c_str(), jsonDataString, "application/json");
-    if (!res || res->status != 200)
+    // The forecast of a site is fetched once an hour however many drivers on this host ask for it
+    auto fetch = [&](std::string & body)
     {
-        LOGF_ERROR("API request failed: %d - %s", res ? res->status : -1, res ? res->body.c_str() : "No response");
+        auto client = INDI::HTTPClientPool::instance().acquire(host);
+        auto res = client->Post(endpoint.c_str(), jsonDataString, "application/json");
+        if (!res || res->status != 200)
+        {
+            LOGF_ERROR("API request failed: %d - %s", res ? res->status : -1, res ? res->body.c_str() : "No response");
+            return false;
+        }
+        body = res->body;
+        return true;
+    };
+    if (!fetchCached(host + endpoint + jsonDataString, 3600, fetch, responseBody))
         return false;
-    }
 
-    responseBody = res->body;
     LOGF_DEBUG("API response: %s", responseBody.c_str());
     return true;
 }
@@ -36,6 +36,7 @@
 
 #include <curl/curl.h>
 
+#include <algorithm>
 #include <memory>
 #include <cstring>
 #include <limits> // Needed for std::numeric_limits
@@ -170,29 +171,36 @@ IPState OpenWeatherMap::updateWeather()
     snprintf(requestURL, MAXRBUF, "http://api.openweathermap.org/data/2.5/weather?lat=%g&lon=%g&appid=%s&units=metric",
              owmLat, owmLong, owmAPIKeyTP[0].getText());
 
-    curl = curl_easy_init();
-    if (curl)
+    // Other drivers of the same site on this host may have fetched it already
+    auto fetch = [&](std::string & response)
     {
-        curl_easy_setopt(curl, CURLOPT_URL, requestURL);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errorBuffer);
-        errorBuffer[0] = 0;
-        res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-        if(res != CURLE_OK)
+        curl = curl_easy_init();
+        if (curl)
         {
-            if(strlen(errorBuffer))
+            curl_easy_setopt(curl, CURLOPT_URL, requestURL);
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+            curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errorBuffer);
+            errorBuffer[0] = 0;
+            res = curl_easy_perform(curl);
+            curl_easy_cleanup(curl);
+            if(res != CURLE_OK)
             {
-                LOGF_ERROR("Error %d reading data: %s", res, errorBuffer);
+                if(strlen(errorBuffer))
+                {
+                    LOGF_ERROR("Error %d reading data: %s", res, errorBuffer);
+                }
+                else
+                {
+                    LOGF_ERROR("Error %d reading data: %s", res, curl_easy_strerror(res));
+                }
+                return false;
             }
-            else
-            {
-                LOGF_ERROR("Error %d reading data: %s", res, curl_easy_strerror(res));
-            }
-            return IPS_ALERT;
         }
-    }
+        return curl != nullptr;
+    };
+    if (!fetchCached(requestURL, std::max(1, static_cast<int>(UpdatePeriodNP[0].getValue())), fetch, readBuffer))
+        return IPS_ALERT;
 
     double forecast = 0;
     double temperature = 0;
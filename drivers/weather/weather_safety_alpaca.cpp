@@ -24,7 +24,7 @@
 
 #include "weather_safety_alpaca.h"
 
-#include <httplib.h>
+#include "httpclientpool.h"
 #include <memory>
 #include <chrono>
 #include <thread>
@@ -176,22 +176,22 @@ bool WeatherSafetyAlpaca::makeAlpacaRequest(const std::string& path, nlohmann::j
                   ServerAddressTP[0].getText(), 
                   ServerAddressTP[1].getText());
 
-        httplib::Client cli(ServerAddressTP[0].getText(), std::stoi(ServerAddressTP[1].getText()));
+        auto cli = INDI::HTTPClientPool::instance().acquire(ServerAddressTP[0].getText(), std::stoi(ServerAddressTP[1].getText()));
         
         // Log timeout settings
         LOGF_INFO("Setting timeouts - Connection: %d sec, Read: %d sec", 
                   static_cast<int>(ConnectionSettingsNP[0].getValue()),
                   static_cast<int>(ConnectionSettingsNP[0].getValue()));
 
-        cli.set_connection_timeout(static_cast<int>(ConnectionSettingsNP[0].getValue()));
-        cli.set_read_timeout(static_cast<int>(ConnectionSettingsNP[0].getValue()));
+        cli->set_connection_timeout(static_cast<int>(ConnectionSettingsNP[0].getValue()));
+        cli->set_read_timeout(static_cast<int>(ConnectionSettingsNP[0].getValue()));
 
         // Log request details
         LOGF_INFO("Making %s request to path: %s", 
                   isPut ? "PUT" : "GET", 
                   path.c_str());
 
-        auto result = isPut ? cli.Put(path.c_str()) : cli.Get(path.c_str());
+        auto result = isPut ? cli->Put(path.c_str()) : cli->Get(path.c_str());
         
         if (!result)
         {
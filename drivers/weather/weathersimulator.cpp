@@ -28,7 +28,9 @@
 #include <cstring>
 
 // We declare an auto pointer to WeatherSimulator.
+#ifndef INDI_SIMULATOR_HOST
 std::unique_ptr<WeatherSimulator> weatherSimulator(new WeatherSimulator());
+#endif
 
 WeatherSimulator::WeatherSimulator()
 {
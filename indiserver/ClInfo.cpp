@@ -23,8 +23,15 @@
 #include "Utils.hpp"
 #include "Property.hpp"
 #include "CommandLineArgs.hpp"
+#include "IoWorker.hpp"
+
+#include <algorithm>
 
 ConcurrentSet<ClInfo> ClInfo::clients;
+std::set<unsigned long> ClInfo::allPropsClients;
+std::unordered_map<std::string, std::set<unsigned long>> ClInfo::deviceClients;
+std::unordered_map<PropertyKey, std::set<unsigned long>, PropertyKeyHash> ClInfo::propertyClients;
+std::unordered_map<std::string, std::set<unsigned long>> ClInfo::propertyDeviceClients;
 
 // root will be released
 void ClInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
@@ -44,16 +51,28 @@ void ClInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
         // Signature for CHAINED SERVER
         // Not a regular client.
         if (dev[0] == '*' && !this->props.size())
-            this->allprops = 2;
+            setAllProps(2);
         else
             addDevice(dev, name, isblob);
     }
     else if (!strcmp(roottag, "getProperties") && !this->props.size() && this->allprops != 2)
-        this->allprops = 1;
+        setAllProps(1);
+
+    if (!strcmp(roottag, "getProperties") && !strcmp(findXMLAttValu(root, "numbers"), "ieee754"))
+        encodedNumbers = true;
+
+    /* a chained server reads BLOBs as they are, without base64 */
+    if (!strcmp(roottag, "getProperties"))
+        crackBLOBBinary(findXMLAtt(root, "binary"));
 
     /* snag enableBLOB -- send to remote drivers too */
     if (!strcmp(roottag, "enableBLOB"))
+    {
         crackBLOBHandling(dev, name, pcdataXMLEle(root));
+        crackBLOBCompression(findXMLAtt(root, "compress"));
+        crackBLOBBinary(findXMLAtt(root, "binary"));
+        crackBLOBFrames(findXMLAtt(root, "frames"));
+    }
 
     if (!strcmp(roottag, "pingRequest"))
     {
@@ -65,6 +84,9 @@ void ClInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
         return;
     }
 
+    /* decode the next BLOBs while reading if drivers or clients can take them as they are */
+    decodeInlineBlobs = DvrInfo::anyAcceptsSharedBuffers() || anyAcceptsRawBlobs();
+
     /* build a new message -- set content iff anyone cares */
     Msg* mp = Msg::fromXml(this, root, sharedBuffers);
     if (!mp)
@@ -74,8 +96,21 @@ void ClInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
         return;
     }
 
+    /* answer from what the drivers defined already, those that may not have defined all of it are asked */
+    std::set<unsigned long> answered;
+    if (!strcmp(roottag, "getProperties") && dev[0] != '*')
+    {
+        auto hb = heartBeat();
+        answered = DvrInfo::q2CachedDefs(this, dev, name);
+        if (!hb.alive())
+        {
+            mp->queuingDone();
+            return;
+        }
+    }
+
     /* send message to driver(s) responsible for dev */
-    DvrInfo::q2RDrivers(dev, mp, root);
+    DvrInfo::q2RDrivers(dev, mp, root, answered);
 
     /* JM 2016-05-18: Upstream client can be a chained INDI server. If any driver locally is snooping
     * on any remote drivers, we should catch it and forward it to the responsible snooping driver. */
@@ -106,10 +141,16 @@ void ClInfo::close()
 #endif
 }
 
-void ClInfo::q2Clients(ClInfo *notme, int isblob, const std::string &dev, const std::string &name, Msg *mp, XMLEle *root)
+double ClInfo::q2Clients(ClInfo *notme, int isblob, const std::string &dev, const std::string &name, Msg *mp, XMLEle *root)
 {
+    /* stream BLOBs are dropped beyond maxStreamSizeMB, clients shut down beyond maxQueueSizeMB otherwise */
+    double streamBacklog = 0;
+    unsigned long streamLimit = userConfigurableArguments->maxStreamSizeMB > 0 ? userConfigurableArguments->maxStreamSizeMB :
+                                userConfigurableArguments->maxQueueSizeMB;
+    bool isStream = isblob && mp->isStream();
+
     /* queue message to each interested client */
-    for (auto cpId : clients.ids())
+    for (auto cpId : interestedClients(dev, name))
     {
         auto cp = clients[cpId];
         if (cp == nullptr) continue;
@@ -128,15 +169,7 @@ void ClInfo::q2Clients(ClInfo *notme, int isblob, const std::string &dev, const
         {
             if (cp->props.size() > 0)
             {
-                Property *blobp = nullptr;
-                for (auto pp : cp->props)
-                {
-                    if (pp->dev == dev && pp->name == name)
-                    {
-                        blobp = pp;
-                        break;
-                    }
-                }
+                Property *blobp = cp->findProperty(dev, name);
 
                 if ((blobp && blobp->blob == B_NEVER) || (!blobp && cp->blob == B_NEVER))
                     continue;
@@ -150,26 +183,11 @@ void ClInfo::q2Clients(ClInfo *notme, int isblob, const std::string &dev, const
         if (isblob && userConfigurableArguments->maxStreamSizeMB > 0 && ql > userConfigurableArguments->maxStreamSizeMB)
         {
             // Drop frames for streaming blobs
-            /* pull out each name/BLOB pair, decode */
-            XMLEle *ep      = NULL;
-            int streamFound = 0;
-            for (ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
-            {
-                if (strcmp(tagXMLEle(ep), "oneBLOB") == 0)
-                {
-                    XMLAtt *fa = findXMLAtt(ep, "format");
-
-                    if (fa && strstr(valuXMLAtt(fa), "stream"))
-                    {
-                        streamFound = 1;
-                        break;
-                    }
-                }
-            }
-            if (streamFound)
+            if (isStream)
             {
                 if (userConfigurableArguments->verbosity > 1)
                     cp->log(fmt("%ld bytes behind. Dropping stream BLOB...\n", ql));
+                streamBacklog = 1;
                 continue;
             }
         }
@@ -185,11 +203,56 @@ void ClInfo::q2Clients(ClInfo *notme, int isblob, const std::string &dev, const
             cp->log(fmt("queuing <%s device='%s' name='%s'>\n",
                         tagXMLEle(root), findXMLAttValu(root, "device"), findXMLAttValu(root, "name")));
 
+        if (isStream && streamLimit > 0)
+            streamBacklog = std::max(streamBacklog, std::min(1.0, double(ql) / streamLimit));
+
         // pushmsg can kill cp. do at end
         cp->pushMsg(mp);
     }
 
-    return;
+    return streamBacklog;
+}
+
+bool ClInfo::anyAcceptsRawBlobs()
+{
+    for (auto cpId : clients.ids())
+    {
+        auto cp = clients[cpId];
+        if (cp && (cp->acceptSharedBuffers() || cp->acceptBinaryBlobs() || cp->acceptCompressedBlobs()))
+            return true;
+    }
+    return false;
+}
+
+bool ClInfo::setBandwidth(unsigned int kbps, int fd)
+{
+    bool found = false;
+
+    if (fd == -1)
+        userConfigurableArguments->clientRateKB = kbps;
+
+    // Local clients don't share the network link
+    for (auto cpId : clients.ids())
+    {
+        auto cp = clients[cpId];
+        if (cp && !cp->acceptSharedBuffers() && (fd == -1 || cp->getRFd() == fd))
+        {
+            cp->setSendRate(kbps * 1024.);
+            found = true;
+        }
+    }
+    return found || fd == -1;
+}
+
+bool ClInfo::allAcceptEncodedNumbers(const std::string &dev, const std::string &name)
+{
+    for (auto cpId : interestedClients(dev, name))
+    {
+        auto cp = clients[cpId];
+        if (cp && !cp->acceptEncodedNumbers())
+            return false;
+    }
+    return true;
 }
 
 void ClInfo::q2Servers(DvrInfo *me, Msg *mp, XMLEle *root)
@@ -249,35 +312,87 @@ void ClInfo::q2Servers(DvrInfo *me, Msg *mp, XMLEle *root)
         cp->pushMsg(mp);
     }
 }
+std::set<unsigned long> ClInfo::interestedClients(const std::string &dev, const std::string &name)
+{
+    if (dev.empty())
+    {
+        auto ids = clients.ids();
+        return std::set<unsigned long>(ids.begin(), ids.end());
+    }
+
+    std::set<unsigned long> result = allPropsClients;
+
+    auto devIt = deviceClients.find(dev);
+    if (devIt != deviceClients.end())
+        result.insert(devIt->second.begin(), devIt->second.end());
+
+    auto propIt = propertyClients.find(PropertyKey(dev, name));
+    if (propIt != propertyClients.end())
+        result.insert(propIt->second.begin(), propIt->second.end());
+
+    /* device wide messages and deletions also reach clients watching some of its props */
+    if (name.empty())
+    {
+        auto watchIt = propertyDeviceClients.find(dev);
+        if (watchIt != propertyDeviceClients.end())
+            result.insert(watchIt->second.begin(), watchIt->second.end());
+    }
+
+    return result;
+}
+
+void ClInfo::setAllProps(int allprops)
+{
+    this->allprops = allprops;
+    allPropsClients.insert(getId());
+}
+
 int ClInfo::findDevice(const std::string &dev, const std::string &name) const
 {
     if (allprops >= 1 || dev.empty())
         return (0);
-    for (auto pp : props)
-    {
-        if ((pp->dev == dev) && (pp->name.empty() || (pp->name == name)))
-            return (0);
-    }
+    if (devices.count(dev) || propsIndex.count(PropertyKey(dev, name)))
+        return (0);
+    if (name.empty() && propertyDevices.count(dev))
+        return (0);
     return (-1);
 }
 
+Property *ClInfo::findProperty(const std::string &dev, const std::string &name) const
+{
+    auto it = propsIndex.find(PropertyKey(dev, name));
+    return it == propsIndex.end() ? nullptr : it->second;
+}
+
 void ClInfo::addDevice(const std::string &dev, const std::string &name, int isblob)
 {
     if (isblob)
     {
-        for (auto pp : props)
-        {
-            if (pp->dev == dev && pp->name == name)
-                return;
-        }
+        if (findProperty(dev, name))
+            return;
     }
     /* no dups */
-    else if (!findDevice(dev, name))
+    else if (allprops >= 1 || devices.count(dev) || findProperty(dev, name))
         return;
 
     /* add */
     Property *pp = new Property(dev, name);
     props.push_back(pp);
+
+    /* index */
+    PropertyKey key(dev, name);
+    propsIndex[key] = pp;
+    if (name.empty())
+    {
+        devices.insert(dev);
+        deviceClients[dev].insert(getId());
+    }
+    else
+    {
+        propertyClients[key].insert(getId());
+        propertyDevices.insert(dev);
+        propertyDeviceClients[dev].insert(getId());
+    }
 }
 
 void ClInfo::crackBLOBHandling(const std::string &dev, const std::string &name, const char *enableBLOB)
@@ -291,24 +406,105 @@ void ClInfo::crackBLOBHandling(const std::string &dev, const std::string &name,
 
     /* If whole client blob handling policy was updated, we need to pass that also to all children
        and if the request was for a specific property, then we apply the policy to it */
-    for (auto pp : props)
+    if (!name.empty())
     {
-        if (name.empty())
+        Property *pp = findProperty(dev, name);
+        if (pp)
             crackBLOB(enableBLOB, &pp->blob);
-        else if (pp->dev == dev && pp->name == name)
-        {
+    }
+    else
+    {
+        for (auto pp : props)
             crackBLOB(enableBLOB, &pp->blob);
-            return;
-        }
     }
+
+    updateSocketProfile();
 }
+
+void ClInfo::setNetworkClient()
+{
+    networkClient = true;
+    updateSocketProfile();
+}
+
+void ClInfo::updateSocketProfile()
+{
+    if (!networkClient)
+        return;
+
+    bool wantsBlobs = blob != B_NEVER || std::any_of(props.begin(), props.end(), [](const Property * pp)
+    {
+        return pp->blob != B_NEVER;
+    });
+    setSocketProfile(wantsBlobs ? BulkProfile : ControlProfile);
+}
+
+void ClInfo::crackBLOBBinary(XMLAtt *binary)
+{
+    /* Without the attribute, keep what was negotiated before */
+    if (!binary)
+        return;
+
+    binaryBlobs = !strcmp(valuXMLAtt(binary), "true");
+}
+
+void ClInfo::crackBLOBFrames(XMLAtt *frames)
+{
+    /* Without the attribute, keep what was negotiated before */
+    if (!frames)
+        return;
+
+    const char *value = valuXMLAtt(frames);
+    if (!strcmp(value, "latest"))
+        latestFrameWins = true;
+    else if (!strcmp(value, "all"))
+        latestFrameWins = false;
+    else if (userConfigurableArguments->verbosity > 0)
+        log(fmt("unsupported BLOB frames '%s', ignored\n", value));
+}
+
+void ClInfo::crackBLOBCompression(XMLAtt *compress)
+{
+    /* Without the attribute, keep what was negotiated before */
+    if (!compress)
+        return;
+
+    const char *value = valuXMLAtt(compress);
+    if (!strcmp(value, "zlib"))
+        compressBlobs = true;
+    else
+    {
+        if (strcmp(value, "none") && userConfigurableArguments->verbosity > 0)
+            log(fmt("unsupported BLOB compression '%s', sending uncompressed\n", value));
+        compressBlobs = false;
+    }
+}
+
 ClInfo::ClInfo(bool useSharedBuffer) : MsgQueue(useSharedBuffer)
 {
     clients.insert(this);
+    latestFrameWins = userConfigurableArguments->latestFrameWins;
+    attachWorker(IoWorker::acquire());
 }
 
 ClInfo::~ClInfo()
 {
+    // Stop io first: the worker may still be inside a callback
+    detachWorker();
+
+    /* drop from routing indexes */
+    unsigned long id = getId();
+    allPropsClients.erase(id);
+    for (auto prop : props)
+    {
+        if (prop->name.empty())
+            eraseFromIndex(deviceClients, prop->dev, id);
+        else
+            eraseFromIndex(propertyClients, PropertyKey(prop->dev, prop->name), id);
+    }
+    for (auto &dev : propertyDevices)
+        eraseFromIndex(propertyDeviceClients, dev, id);
+
     for(auto prop : props)
     {
         delete prop;
@@ -20,10 +20,14 @@
 
 #include "indicore/indidevapi.h"
 #include "MsgQueue.hpp"
+#include "Property.hpp"
 #include "lilxml.h"
 
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
 class DvrInfo;
-class Property;
 
 /* info for each connected client */
 class ClInfo: public MsgQueue
@@ -37,12 +41,46 @@ class ClInfo: public MsgQueue
         /* Update the client property BLOB handling policy */
         void crackBLOBHandling(const std::string &dev, const std::string &name, const char *enableBLOB);
 
+        /* Update the client BLOB compression from the compress attribute of enableBLOB, if any */
+        void crackBLOBCompression(XMLAtt *compress);
+
+        /* Update the client raw BLOB transfer from the binary attribute of enableBLOB, if any */
+        void crackBLOBBinary(XMLAtt *binary);
+
+        /* Update whether the client only keeps the latest frame of streams from the frames attribute of
+         * enableBLOB, if any: "latest" for a preview, "all" to get every frame. Defaults to -s */
+        void crackBLOBFrames(XMLAtt *frames);
+
         /* close down the given client */
         virtual void close();
 
+    private:
+        std::unordered_set<std::string> devices;                            /* devices wanted as a whole */
+        std::unordered_set<std::string> propertyDevices;                    /* devices with only some props wanted */
+        std::unordered_map<PropertyKey, Property*, PropertyKeyHash> propsIndex; /* props by dev/name */
+
+        /* ids of clients by interest, so routing only visits clients that may care */
+        static std::set<unsigned long> allPropsClients;
+        static std::unordered_map<std::string, std::set<unsigned long>> deviceClients;
+        static std::unordered_map<PropertyKey, std::set<unsigned long>, PropertyKeyHash> propertyClients;
+        static std::unordered_map<std::string, std::set<unsigned long>> propertyDeviceClients;
+
+        /* record that this client wants every device */
+        void setAllProps(int allprops);
+
+        /* ids of the clients that may be interested in dev/name, in id order */
+        static std::set<unsigned long> interestedClients(const std::string &dev, const std::string &name);
+
+        bool compressBlobs {false};     /* asked for zlib compressed BLOBs in enableBLOB */
+        bool binaryBlobs {false};       /* asked for raw shared buffer content in enableBLOB */
+        bool networkClient {false};     /* connected over TCP, see setNetworkClient */
+
+        /* tune the socket of a network client for whether it asked for BLOBs */
+        void updateSocketProfile();
+
     public:
-        std::list<Property*> props;     /* props we want */
-        int allprops = 0;               /* saw getProperties w/o device */
+        std::list<Property*> props;     /* props we want. Modified through addDevice only */
+        int allprops = 0;               /* saw getProperties w/o device. Modified through setAllProps only */
         BLOBHandling blob = B_NEVER;    /* when to send setBLOBs */
 
         ClInfo(bool useSharedBuffer);
@@ -52,10 +90,26 @@ class ClInfo: public MsgQueue
          */
         int findDevice(const std::string &dev, const std::string &name) const;
 
+        /* return the Property registered for exactly dev/name, else nullptr */
+        Property *findProperty(const std::string &dev, const std::string &name) const;
+
         /* add the given device and property to the props[] list of client if new.
          */
         void addDevice(const std::string &dev, const std::string &name, int isblob);
 
+        /* the client came over TCP: its socket is tuned for control, then for BLOBs once enabled */
+        void setNetworkClient();
+
+        virtual bool acceptCompressedBlobs() const
+        {
+            return compressBlobs;
+        }
+
+        virtual bool acceptBinaryBlobs() const
+        {
+            return binaryBlobs;
+        }
+
         virtual void log(const std::string &log) const;
 
         /* put Msg mp on queue of each chained server client, except notme.
@@ -64,8 +118,20 @@ class ClInfo: public MsgQueue
 
         /* put Msg mp on queue of each client interested in dev/name, except notme.
          * if BLOB always honor current mode.
+         * return the backlog of the slowest client sent a stream BLOB, as a fraction of the queue size
+         * stream BLOBs are dropped beyond, 1 if one was dropped.
          */
-        static void q2Clients(ClInfo *notme, int isblob, const std::string &dev, const std::string &name, Msg *mp, XMLEle *root);
+        static double q2Clients(ClInfo *notme, int isblob, const std::string &dev, const std::string &name, Msg *mp, XMLEle *root);
+
+        /* true if some client takes BLOBs as raw data: shared buffers, binary or compressed */
+        static bool anyAcceptsRawBlobs();
+
+        /* true if every client that may be interested in dev/name reads encoding='ieee754' numbers */
+        static bool allAcceptEncodedNumbers(const std::string &dev, const std::string &name);
+
+        /* send at most kbps KiB/s to the network client whose connection is fd, or to all of them and
+         * the next ones if fd is -1. 0 for no limit. return false if there is no such client */
+        static bool setBandwidth(unsigned int kbps, int fd = -1);
 
         /* Reference to all active clients */
         static ConcurrentSet<ClInfo> clients;
@@ -43,6 +43,13 @@ class Collectable
                 }
         };
 
+    public:
+        /* identifier within the current collection, 0 if none */
+        unsigned long getId() const
+        {
+            return id;
+        }
+
     protected:
         /* heartbeat.alive will return true as long as this item has not changed collection.
          * Also detect deletion of the Collectable */
@@ -18,6 +18,7 @@
 */
 #pragma once
 #include "Constants.hpp"
+#include "Scheduling.hpp"
 
 #include <string>
 
@@ -30,8 +31,22 @@ struct CommandLineArgs
     unsigned int maxQueueSizeMB{indiserver::constants::defaultMaxQueueSizeMB};
     char *loggingDir{nullptr};
     int maxRestartAttempts{indiserver::constants::defaultMaximumRestarts};
+    bool warmRestart{false};        /* clients keep the properties of local drivers that restart, only changes are sent */
     std::string binaryName{};
     int port{indiserver::constants::indiPortDefault};
+    int webSocketPort{0};           /* port of web socket clients. 0 for none */
+    bool latestFrameWins{false};    /* clients only keep the latest unsent frame of each stream, unless they chose */
+    unsigned int ioWorkers{0};      /* client io threads. 0 to do all io from the main loop */
+    bool ioUring{false};            /* writes go through an io_uring per loop, when available */
+    unsigned int encodeThreads{4};  /* threads sharing base64 encoding of large BLOBs. 0 to encode in place */
+    unsigned int clientRateKB{0};   /* send budget of each network client in KiB/s. 0 for no limit */
+    unsigned int notSentLowatKB{0}; /* TCP_NOTSENT_LOWAT of clients getting BLOBs in KiB. 0 for the kernel setting */
+    unsigned int serializedMemoryMB{0}; /* encoded BLOBs kept in memory, beyond go to spill files. 0 for no limit */
+    Scheduling driverScheduling{};  /* of local drivers, unless their fifo start line says otherwise */
+    Scheduling serverScheduling{};  /* of the server threads */
+    unsigned int sharedRingKB{0};   /* local drivers write their messages to a shared memory ring of that size. 0 for the socket */
+    char *telemetryFile{nullptr};   /* values of numbers, switches and lights are recorded there */
+    std::string telemetrySelection{}; /* device.property[.element] globs of what is recorded, empty for all */
 };
 
 extern CommandLineArgs* userConfigurableArguments;
@@ -25,6 +25,7 @@ constexpr unsigned maxStringBufferLength {512};
 constexpr unsigned defaultMaxQueueSizeMB {128 * 1024 * 1024};
 constexpr unsigned defaultMaxStreamSizeMB {5 * 1024 * 1024};
 constexpr unsigned defaultMaximumRestarts {10};
+constexpr int bulkSendBufferLength {4 * 1024 * 1024}; /* SO_SNDBUF of clients getting BLOBs */
 
 #ifdef OSX_EMBEDED_MODE
 constexpr std::string_view logNamePattern {"/Users/%s/Library/Logs/indiserver.log"};
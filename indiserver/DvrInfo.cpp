@@ -24,8 +24,12 @@
 #include "Property.hpp"
 #include "Fifo.hpp"
 #include "CommandLineArgs.hpp"
+#include "StartupReport.hpp"
+#include "Recorder.hpp"
 
 ConcurrentSet<DvrInfo> DvrInfo::drivers;
+std::unordered_map<std::string, std::set<unsigned long>> DvrInfo::deviceSnoopers;
+std::unordered_map<PropertyKey, std::set<unsigned long>, PropertyKeyHash> DvrInfo::propertySnoopers;
 
 void DvrInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
 {
@@ -47,6 +51,8 @@ void DvrInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
     if (!strcmp(roottag, "getProperties"))
     {
         this->addSDevice(dev, name);
+        if (!strcmp(findXMLAttValu(root, "numbers"), "ieee754"))
+            encodedNumbers = true;
         Msg *mp = new Msg(this, root);
         /* send to interested chained servers upstream */
         // FIXME: no use of root here
@@ -63,6 +69,14 @@ void DvrInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
     /* that's all if driver desires to snoop BLOBs from other drivers */
     if (!strcmp(roottag, "enableBLOB"))
     {
+        /* or if it reads the BLOBs it is sent as attached buffers */
+        if (!dev[0] && !strcmp(findXMLAttValu(root, "attached"), "true"))
+        {
+            attachedBlobs = true;
+            delXMLEle(root);
+            return;
+        }
+
         Property *sp = findSDevice(dev, name);
         if (sp)
             crackBLOB(pcdataXMLEle(root), &sp->blob);
@@ -81,10 +95,33 @@ void DvrInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
         this->dev.insert(dev);
     }
 
+    if (!strncmp(roottag, "def", 3))
+        StartupReport::defined(this);
+
+    if (!strcmp(roottag, "defNumberVector") && !strcmp(name, "STREAM_BACKLOG"))
+        backlogDevices.insert(dev);
+
     /* log messages if any and wanted */
     if (userConfigurableArguments->loggingDir)
         logDMsg(root, dev);
 
+    /* values go to the telemetry file if any */
+    Recorder::record(root);
+
+    /* the driver is done answering a getProperties */
+    if (!strcmp(roottag, "pingReply"))
+    {
+        auto it = answerPings.find(findXMLAttValu(root, "uid"));
+        if (it != answerPings.end())
+        {
+            repliesToPings = true;
+            cache->answered(it->second);
+            answerPings.erase(it);
+            delXMLEle(root);
+            return;
+        }
+    }
+
     if (!strcmp(roottag, "pingRequest"))
     {
         setXMLEleTag(root, "pingReply");
@@ -95,6 +132,14 @@ void DvrInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
         return;
     }
 
+    /* encoded numbers are turned back to text if any recipient did not ask for them */
+    if (!strcmp(roottag, "setNumberVector") && !strcmp(findXMLAttValu(root, "encoding"), "ieee754")
+            && !(ClInfo::allAcceptEncodedNumbers(dev, name) && snoopersAcceptEncodedNumbers(dev, name)))
+        decodeNumbers(root);
+
+    /* decode the next BLOBs while reading only if they won't have to be encoded again */
+    decodeInlineBlobs = ClInfo::anyAcceptsRawBlobs() || anyAcceptsSharedBuffers();
+
     /* build a new message -- set content iff anyone cares */
     Msg * mp = Msg::fromXml(this, root, sharedBuffers);
     if (!mp)
@@ -103,8 +148,10 @@ void DvrInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
         return;
     }
 
-    /* send to interested clients */
-    ClInfo::q2Clients(NULL, isblob, dev, name, mp, root);
+    /* send to interested clients, telling the driver how far behind they are */
+    double backlog = ClInfo::q2Clients(NULL, isblob, dev, name, mp, root);
+    if (isblob && mp->isStream())
+        reportBacklog(dev, backlog);
 
     /* send to snooping drivers */
     DvrInfo::q2SDrivers(this, isblob, dev, name, mp, root);
@@ -113,30 +160,92 @@ void DvrInfo::onMessage(XMLEle * root, std::list<int> &sharedBuffers)
     mp->queuingDone();
 }
 
-void DvrInfo::closeWritePart()
+void DvrInfo::startResync()
 {
-    // Don't want any half-dead drivers
-    close();
+    if (cache->startResync())
+        settle.start(firstDefDelay);
 }
 
+void DvrInfo::onSettled(ev::timer &, int)
+{
+    /* what was not defined again is gone */
+    for (auto &key : cache->endResync())
+    {
+        XMLEle *root = addXMLEle(NULL, "delProperty");
+        addXMLAtt(root, "device", key.first.c_str());
+        addXMLAtt(root, "name", key.second.c_str());
+        Msg *mp = new Msg(this, root);
+
+        ClInfo::q2Clients(NULL, 0, key.first, key.second, mp, root);
+        mp->queuingDone();
+    }
+}
 
+void DvrInfo::reportBacklog(const std::string &dev, double backlog)
+{
+    if (!backlogDevices.count(dev))
+        return;
 
-void DvrInfo::close()
+    /* falling behind is told at once, catching up once it lasted, so that the encoder does not swing */
+    int level = std::min(4, static_cast<int>(backlog * 4));
+    auto &reported = reportedBacklog[dev];
+    auto now = std::chrono::steady_clock::now();
+    if (level >= reported.level)
+        reported.reached = now;
+    if (level == reported.level || (level < reported.level && now - reported.reached < backlogHold))
+        return;
+    reported.level = level;
+
+    XMLEle *root = addXMLEle(NULL, "newNumberVector");
+    addXMLAtt(root, "device", dev.c_str());
+    addXMLAtt(root, "name", "STREAM_BACKLOG");
+    XMLEle *number = addXMLEle(root, "oneNumber");
+    addXMLAtt(number, "name", "BACKLOG");
+    editXMLEle(number, fmt("%g", level / 4.0).c_str());
+    Msg *mp = new Msg(nullptr, root);
+    pushMsg(mp);
+    mp->queuingDone();
+}
+
+XMLEle *DvrInfo::updateCache(XMLEle *root)
 {
-    // Tell client driver is dead.
-    for (auto dev : dev)
+    if (cache->isResyncing() && !strncmp(tagXMLEle(root), "def", 3))
+        settle.start(settleDelay);
+
+    bool redefine;
+    XMLEle *forward = cache->update(root, redefine);
+    if (forward != root)
     {
-        /* Inform clients that this driver is dead */
-        XMLEle *root = addXMLEle(NULL, "delProperty");
-        addXMLAtt(root, "device", dev.c_str());
+        delXMLEle(root);
+        if (forward == nullptr)
+            return nullptr;
+        root = forward;
+    }
 
-        prXMLEle(stderr, root, 0);
-        Msg *mp = new Msg(this, root);
+    /* clients forget the definition they know before getting the new one */
+    if (redefine)
+    {
+        XMLEle *del = addXMLEle(NULL, "delProperty");
+        addXMLAtt(del, "device", findXMLAttValu(root, "device"));
+        addXMLAtt(del, "name", findXMLAttValu(root, "name"));
+        Msg *mp = new Msg(this, del);
 
-        ClInfo::q2Clients(NULL, 0, dev.c_str(), "", mp, root);
+        ClInfo::q2Clients(NULL, 0, findXMLAttValu(root, "device"), findXMLAttValu(root, "name"), mp, del);
         mp->queuingDone();
     }
+    return root;
+}
+
+void DvrInfo::closeWritePart()
+{
+    // Don't want any half-dead drivers
+    close();
+}
 
+
+
+void DvrInfo::close()
+{
     bool terminate;
     if (!restart)
     {
@@ -157,6 +266,23 @@ void DvrInfo::close()
         }
     }
 
+    // Tell client driver is dead, unless they keep its devices while it restarts
+    if (terminate || !keepsDevicesOnRestart())
+    {
+        for (auto dev : dev)
+        {
+            /* Inform clients that this driver is dead */
+            XMLEle *root = addXMLEle(NULL, "delProperty");
+            addXMLAtt(root, "device", dev.c_str());
+
+            prXMLEle(stderr, root, 0);
+            Msg *mp = new Msg(this, root);
+
+            ClInfo::q2Clients(NULL, 0, dev.c_str(), "", mp, root);
+            mp->queuingDone();
+        }
+    }
+
 #ifdef OSX_EMBEDED_MODE
     fprintf(stderr, "STOPPED \"%s\"\n", name.c_str());
     fflush(stderr);
@@ -178,7 +304,7 @@ void DvrInfo::close()
     }
 }
 
-void DvrInfo::q2RDrivers(const std::string &dev, Msg *mp, XMLEle *root)
+void DvrInfo::q2RDrivers(const std::string &dev, Msg *mp, XMLEle *root, const std::set<unsigned long> &skip)
 {
     char *roottag = tagXMLEle(root);
 
@@ -190,7 +316,7 @@ void DvrInfo::q2RDrivers(const std::string &dev, Msg *mp, XMLEle *root)
     for (auto dpId : drivers.ids())
     {
         auto dp = drivers[dpId];
-        if (dp == nullptr) continue;
+        if (dp == nullptr || skip.count(dpId)) continue;
 
         std::string remoteUid = dp->remoteServerUid();
         bool isRemote = !remoteUid.empty();
@@ -222,15 +348,77 @@ void DvrInfo::q2RDrivers(const std::string &dev, Msg *mp, XMLEle *root)
                         tagXMLEle(root), findXMLAttValu(root, "device"), findXMLAttValu(root, "name")));
         }
 
-        // pushmsg can kill dp. do at end
+        // pushmsg can kill dp
         dp->pushMsg(mp);
+
+        /* a driver answers every getProperties of a device it handles */
+        if (!strcmp(roottag, "getProperties") && dev[0] != '*' && !*findXMLAttValu(root, "name")
+                && (dp = drivers[dpId]))
+            dp->askAnswered(dev);
     }
 }
 
+void DvrInfo::askAnswered(const std::string &dev)
+{
+    if (!pingsFollowMessages() || (!repliesToPings && lastAnswerPing > 0))
+        return;
+
+    std::string uid = fmt("getProperties/%lu", ++lastAnswerPing);
+    answerPings[uid] = dev;
+
+    XMLEle *root = addXMLEle(NULL, "pingRequest");
+    addXMLAtt(root, "uid", uid.c_str());
+    Msg *mp = new Msg(nullptr, root);
+    pushMsg(mp);
+    mp->queuingDone();
+}
+
+std::set<unsigned long> DvrInfo::q2CachedDefs(ClInfo *cp, const std::string &dev, const std::string &name)
+{
+    std::set<unsigned long> answered;
+    unsigned long cpId = cp->getId();
+    for (auto dpId : drivers.ids())
+    {
+        auto dp = drivers[dpId];
+        if (dp == nullptr) continue;
+
+        /* a remote server sending its definitions again is asked as well, and so is a driver that
+         * may not have defined everything asked for */
+        if ((!dev.empty() && !dp->isHandlingDevice(dev)) || dp->cache->isResyncing()
+                || !dp->cache->isAnswered(dev, name))
+            continue;
+        answered.insert(dpId);
+
+        std::vector<XMLEle *> defs = dp->cache->definitions(dev, name);
+
+        /* the driver would not have sent them either */
+        if (cp->blob == B_ONLY)
+            continue;
+
+        if (userConfigurableArguments->verbosity > 1)
+            cp->log(fmt("queuing %zu cached definitions of %s\n", defs.size(), dp->name.c_str()));
+
+        for (XMLEle *def : defs)
+        {
+            /* the message was for the time it was defined */
+            XMLEle *root = cloneXMLEle(def, nullptr, nullptr);
+            rmXMLAtt(root, "message");
+
+            Msg *mp = new Msg(dp, root);
+            // pushmsg can kill cp
+            cp->pushMsg(mp);
+            mp->queuingDone();
+            if (ClInfo::clients[cpId] == nullptr)
+                return answered;
+        }
+    }
+    return answered;
+}
+
 void DvrInfo::q2SDrivers(DvrInfo *me, int isblob, const std::string &dev, const std::string &name, Msg *mp, XMLEle *root)
 {
     std::string meRemoteServerUid = me ? me->remoteServerUid() : "";
-    for (auto dpId : drivers.ids())
+    for (auto dpId : snoopingDrivers(dev, name))
     {
         auto dp = drivers[dpId];
         if (dp == nullptr) continue;
@@ -274,37 +462,105 @@ void DvrInfo::addSDevice(const std::string &dev, const std::string &name)
     sp->blob = B_NEVER;
     sprops.push_back(sp);
 
+    /* index */
+    if (name.empty())
+    {
+        sdevices[dev] = sp;
+        deviceSnoopers[dev].insert(getId());
+    }
+    else
+    {
+        PropertyKey key(dev, name);
+        spropsIndex[key] = sp;
+        propertySnoopers[key].insert(getId());
+    }
+
     if (userConfigurableArguments->verbosity)
         log(fmt("snooping on %s.%s\n", dev.c_str(), name.c_str()));
 }
 
 Property * DvrInfo::findSDevice(const std::string &dev, const std::string &name) const
 {
-    for(auto sp : sprops)
+    /* a specific property can only be registered before its whole device, so it comes first */
+    auto propIt = spropsIndex.find(PropertyKey(dev, name));
+    if (propIt != spropsIndex.end())
+        return propIt->second;
+
+    auto devIt = sdevices.find(dev);
+    if (devIt != sdevices.end())
+        return devIt->second;
+
+    return nullptr;
+}
+
+std::set<unsigned long> DvrInfo::snoopingDrivers(const std::string &dev, const std::string &name)
+{
+    std::set<unsigned long> result;
+
+    auto devIt = deviceSnoopers.find(dev);
+    if (devIt != deviceSnoopers.end())
+        result.insert(devIt->second.begin(), devIt->second.end());
+
+    auto propIt = propertySnoopers.find(PropertyKey(dev, name));
+    if (propIt != propertySnoopers.end())
+        result.insert(propIt->second.begin(), propIt->second.end());
+
+    return result;
+}
+
+bool DvrInfo::snoopersAcceptEncodedNumbers(const std::string &dev, const std::string &name)
+{
+    for (auto dpId : snoopingDrivers(dev, name))
     {
-        if ((sp->dev == dev) && (sp->name.empty() || sp->name == name))
-            return (sp);
+        auto dp = drivers[dpId];
+        if (dp && !dp->acceptEncodedNumbers())
+            return false;
     }
+    return true;
+}
 
-    return nullptr;
+bool DvrInfo::anyAcceptsSharedBuffers()
+{
+    for (auto dpId : drivers.ids())
+    {
+        auto dp = drivers[dpId];
+        if (dp && dp->acceptSharedBuffers())
+            return true;
+    }
+    return false;
 }
+
 DvrInfo::DvrInfo(bool useSharedBuffer) :
     MsgQueue(useSharedBuffer),
+    cache(std::make_shared<PropertyCache>()),
     restarts(0)
 {
+    settle.set<DvrInfo, &DvrInfo::onSettled>(this);
     drivers.insert(this);
 }
 
 DvrInfo::DvrInfo(const DvrInfo &model):
     MsgQueue(model.useSharedBuffer),
+    cache(std::make_shared<PropertyCache>()),
     name(model.name),
     restarts(model.restarts)
 {
+    settle.set<DvrInfo, &DvrInfo::onSettled>(this);
     drivers.insert(this);
 }
 
 DvrInfo::~DvrInfo()
 {
+    /* drop from snoop indexes */
+    unsigned long id = getId();
+    for (auto prop : sprops)
+    {
+        if (prop->name.empty())
+            eraseFromIndex(deviceSnoopers, prop->dev, id);
+        else
+            eraseFromIndex(propertySnoopers, PropertyKey(prop->dev, prop->name), id);
+    }
+
     drivers.erase(this);
     for(auto prop : sprops)
     {
@@ -19,14 +19,19 @@
 #pragma once
 
 #include "MsgQueue.hpp"
+#include "Property.hpp"
+#include "PropertyCache.hpp"
 #include "lilxml.h"
 
+#include <chrono>
 #include <list>
+#include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 
+class ClInfo;
 class Msg;
-class Property;
 
 /* info for each connected driver */
 class DvrInfo: public MsgQueue
@@ -36,19 +41,86 @@ class DvrInfo: public MsgQueue
          */
         void addSDevice(const std::string &dev, const std::string &name);
 
+        std::unordered_map<std::string, Property*> sdevices;                     /* whole devices we snoop */
+        std::unordered_map<PropertyKey, Property*, PropertyKeyHash> spropsIndex; /* props we snoop, by dev/name */
+
+        /* ids of drivers by snooped device or property */
+        static std::unordered_map<std::string, std::set<unsigned long>> deviceSnoopers;
+        static std::unordered_map<PropertyKey, std::set<unsigned long>, PropertyKeyHash> propertySnoopers;
+
+        /* ids of the drivers that may be snooping dev/name, in id order */
+        static std::set<unsigned long> snoopingDrivers(const std::string &dev, const std::string &name);
+
+        /* true if every driver that may be snooping dev/name reads encoding='ieee754' numbers */
+        static bool snoopersAcceptEncodedNumbers(const std::string &dev, const std::string &name);
+
+        /* the driver answered blobs='attached' with enableBLOB attached='true' */
+        bool attachedBlobs {false};
+
+        /* the definitions sent again are over when none came for that long, in seconds */
+        static constexpr double settleDelay {2};
+        /* allowance for the first definition to come */
+        static constexpr double firstDefDelay {10};
+
+        ev::timer settle;
+        void onSettled(ev::timer &watcher, int revents);
+
+        /* devices that defined STREAM_BACKLOG, told how far behind the slowest client of their stream is */
+        std::set<std::string> backlogDevices;
+        struct ReportedBacklog
+        {
+            int level {0};                                  /* quarters of the drop threshold */
+            std::chrono::steady_clock::time_point reached;  /* last time the backlog was at least level */
+        };
+        std::unordered_map<std::string, ReportedBacklog> reportedBacklog;
+        /* a lower backlog is only reported once it held for that long */
+        static constexpr std::chrono::seconds backlogHold {2};
+
+        /* send STREAM_BACKLOG to the driver of dev as its stream falls behind or catches up */
+        void reportBacklog(const std::string &dev, double backlog);
+
+        /* devices of the getProperties sent, by the uid of the pingRequest that followed them */
+        std::unordered_map<std::string, std::string> answerPings;
+        unsigned long lastAnswerPing = 0;
+        /* the driver replied to one of them. until then, only the first is sent */
+        bool repliesToPings {false};
+
     public:
         /* return Property if dp is this driver is snooping dev/name, else NULL.
          */
         Property *findSDevice(const std::string &dev, const std::string &name) const;
 
     protected:
+        /* the properties defined by the driver */
+        std::shared_ptr<PropertyCache> cache;
+
         /* send message to each interested client
          */
         void onMessage(XMLEle *root, std::list<int> &sharedBuffers) override;
 
+        /* the driver defines its properties again: they are checked against those clients know,
+         * and what is not defined again before it settles is deleted */
+        void startResync();
+
+        /* record root in the cache and return what is to be routed instead: root, a set message when a
+         * definition sent again only brings new values, or nullptr when it brings nothing new. root is
+         * deleted if not returned. */
+        XMLEle *updateCache(XMLEle *root);
+
         /* override to kill driver that are not reachable anymore */
         void closeWritePart() override;
 
+        /* follow a getProperties of dev, or of all devices if dev is empty, with a pingRequest. The
+         * driver handles messages in order: once it replies, the cache holds its whole answer */
+        void askAnswered(const std::string &dev);
+
+        /* true if answering pingRequest means the messages before were handled. A remote server
+         * replies to them at once. */
+        virtual bool pingsFollowMessages() const
+        {
+            return false;
+        }
+
 
         /* Construct an instance that will start the same driver */
         DvrInfo(const DvrInfo &model);
@@ -57,7 +129,7 @@ class DvrInfo: public MsgQueue
         std::string name;               /* persistent name */
 
         std::set<std::string> dev;      /* device served by this driver */
-        std::list<Property*>sprops;     /* props we snoop */
+        std::list<Property*>sprops;     /* props we snoop. Modified through addSDevice only */
         int restarts;                   /* times process has been restarted */
         bool restart = true;            /* Restart on shutdown */
 
@@ -74,6 +146,24 @@ class DvrInfo: public MsgQueue
         /* close down the given driver and restart if set*/
         void close() override;
 
+        /* true if this driver was started for the given entry */
+        virtual bool isNamed(const std::string &entry) const
+        {
+            return name == entry;
+        }
+
+        /* stop serving the given entry. return true if the driver is to be closed */
+        virtual bool stopNamed(const std::string &)
+        {
+            return true;
+        }
+
+        /* true if clients keep the properties of the devices while the driver restarts */
+        virtual bool keepsDevicesOnRestart() const
+        {
+            return false;
+        }
+
         /* Allocate an instance that will start the same driver */
         virtual DvrInfo * clone() const = 0;
 
@@ -82,9 +172,15 @@ class DvrInfo: public MsgQueue
         virtual const std::string remoteServerUid() const = 0;
 
         /* put Msg mp on queue of each driver responsible for dev, or all drivers
-         * if dev empty.
+         * if dev empty. the drivers in skip are left out.
          */
-        static void q2RDrivers(const std::string &dev, Msg *mp, XMLEle *root);
+        static void q2RDrivers(const std::string &dev, Msg *mp, XMLEle *root, const std::set<unsigned long> &skip = {});
+
+        /* queue to cp the definitions the drivers made for dev/name, as asked by a getProperties.
+         * return the ids of the drivers answered for, those whose definitions may not hold the whole
+         * answer are still to be asked.
+         */
+        static std::set<unsigned long> q2CachedDefs(ClInfo *cp, const std::string &dev, const std::string &name);
 
         /* put Msg mp on queue of each driver snooping dev/name.
          * if BLOB always honor current mode.
@@ -94,9 +190,11 @@ class DvrInfo: public MsgQueue
         /* Reference to all active drivers */
         static ConcurrentSet<DvrInfo> drivers;
 
-        // decoding of attached blobs from driver is not supported ATM. Be conservative here
+        /* true if some driver maps the buffers attached to the BLOBs it is sent */
+        static bool anyAcceptsSharedBuffers();
+
         bool acceptSharedBuffers() const override
         {
-            return false;
+            return useSharedBuffer && attachedBlobs;
         }
 };
@@ -0,0 +1,73 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "EncodePool.hpp"
+
+#include <thread>
+
+EncodePool * EncodePool::instance = nullptr;
+
+EncodePool::EncodePool(unsigned threads): threads(threads)
+{
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        // Threads live as long as the process, like the pool
+        std::thread([this]()
+        {
+            run();
+        }).detach();
+    }
+}
+
+void EncodePool::start(unsigned threads)
+{
+    if (threads > 0 && !instance)
+    {
+        instance = new EncodePool(threads);
+    }
+}
+
+void EncodePool::run()
+{
+    for(;;)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wakeup.wait(guard, [this]()
+            {
+                return !tasks.empty();
+            });
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+std::future<void> EncodePool::post(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged(std::move(task));
+    auto result = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        tasks.push_back(std::move(packaged));
+    }
+    wakeup.notify_one();
+    return result;
+}
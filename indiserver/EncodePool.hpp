@@ -0,0 +1,60 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+
+/* Threads encoding slices of large BLOBs to base64, shared by all messages.
+ * Tasks run in posting order as threads get free. May be used from any thread.
+ */
+class EncodePool
+{
+        std::mutex lock;
+        std::condition_variable wakeup;
+        std::deque<std::packaged_task<void()>> tasks;
+        unsigned threads;
+
+        static EncodePool * instance;
+
+        explicit EncodePool(unsigned threads);
+        void run();
+
+    public:
+        /* create the pool with the given number of threads. With 0, there is no pool */
+        static void start(unsigned threads);
+
+        /* the pool, or nullptr if not started */
+        static EncodePool * get()
+        {
+            return instance;
+        }
+
+        /* number of slices worth keeping in flight for one BLOB */
+        unsigned window() const
+        {
+            return 2 * threads;
+        }
+
+        /* queue task for one of the threads */
+        std::future<void> post(std::function<void()> task);
+};
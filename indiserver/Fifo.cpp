@@ -19,10 +19,13 @@
 #include "Fifo.hpp"
 #include "Utils.hpp"
 #include "Constants.hpp"
+#include "ClInfo.hpp"
 #include "DvrInfo.hpp"
 #include "LocalDrvInfo.hpp"
 #include "RemoteDvrInfo.hpp"
+#include "PluginDvrInfo.hpp"
 #include "CommandLineArgs.hpp"
+#include "Metrics.hpp"
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -61,6 +64,47 @@ void Fifo::open()
 }
 
 
+/* Write the metrics report to path, or to the log if path is empty */
+void Fifo::dumpMetrics(const char * path)
+{
+    std::string report = Metrics::report();
+
+    if (!path[0])
+    {
+        log(report);
+        return;
+    }
+
+    // Write aside then rename, so readers never see a partial report
+    std::string tmpPath = std::string(path) + ".tmp";
+    FILE * fp = fopen(tmpPath.c_str(), "w");
+    if (fp == nullptr)
+    {
+        log(fmt("open(%s): %s.\n", tmpPath.c_str(), strerror(errno)));
+        return;
+    }
+    fputs(report.c_str(), fp);
+    if (fclose(fp) != 0 || rename(tmpPath.c_str(), path) != 0)
+    {
+        log(fmt("writing metrics to %s: %s.\n", path, strerror(errno)));
+    }
+}
+
+/* Change the send budget of network clients: "kb" for all of them, "kb client" for one */
+void Fifo::setBandwidth(const char * args)
+{
+    int kbps = 0, client = -1;
+
+    if (sscanf(args, "%d %d", &kbps, &client) < 1 || kbps < 0)
+    {
+        log("FIFO: bandwidth requires KiB/s and an optional client\n");
+        return;
+    }
+
+    if (!ClInfo::setBandwidth(kbps, client))
+        log(fmt("FIFO: no network client %d\n", client));
+}
+
 /* Handle one fifo command. Start/stop drivers accordingly */
 void Fifo::processLine(const char * line)
 {
@@ -68,9 +112,24 @@ void Fifo::processLine(const char * line)
     if (userConfigurableArguments->verbosity)
         log(fmt("FIFO: %s\n", line));
 
+    if (!strncmp(line, "metrics", 7) && (line[7] == '\0' || line[7] == ' '))
+    {
+        const char * path = line + 7;
+        while (*path == ' ')
+            path++;
+        dumpMetrics(path);
+        return;
+    }
+
+    if (!strncmp(line, "bandwidth", 9) && (line[9] == '\0' || line[9] == ' '))
+    {
+        setBandwidth(line + 9);
+        return;
+    }
+
     char cmd[maxStringBufferLength];
-    char arg[4][1];
-    char var[4][maxStringBufferLength];
+    char arg[5][1];
+    char var[5][maxStringBufferLength];
 
     char tDriver[maxStringBufferLength];
     memset(&tDriver[0], 0, sizeof(char) * maxStringBufferLength);
@@ -87,6 +146,9 @@ void Fifo::processLine(const char * line)
     char envPrefix[maxStringBufferLength];
     memset(&envPrefix[0], 0, sizeof(char) * maxStringBufferLength);
 
+    Scheduling scheduling = userConfigurableArguments->driverScheduling;
+    bool validScheduling = true;
+
 
     int n = 0;
 
@@ -109,8 +171,8 @@ void Fifo::processLine(const char * line)
     // If local driver
     else
     {
-        n = sscanf(line, "%s %s -%1c \"%511[^\"]\" -%1c \"%511[^\"]\" -%1c \"%511[^\"]\" -%1c \"%511[^\"]\"", cmd,
-                   tDriver, arg[0], var[0], arg[1], var[1], arg[2], var[2], arg[3], var[3]);
+        n = sscanf(line, "%s %s -%1c \"%511[^\"]\" -%1c \"%511[^\"]\" -%1c \"%511[^\"]\" -%1c \"%511[^\"]\" -%1c \"%511[^\"]\"",
+                   cmd, tDriver, arg[0], var[0], arg[1], var[1], arg[2], var[2], arg[3], var[3], arg[4], var[4]);
     }
 
     int n_args = (n - 2) / 2;
@@ -150,6 +212,13 @@ void Fifo::processLine(const char * line)
             if (userConfigurableArguments->verbosity)
                 log(fmt("With prefix: %s\n", envPrefix));
         }
+        else if (arg[j][0] == 'a')
+        {
+            validScheduling = scheduling.parse(var[j]);
+
+            if (userConfigurableArguments->verbosity)
+                log(fmt("With scheduling: %s\n", scheduling.toString().c_str()));
+        }
     }
 
     bool startCmd;
@@ -163,23 +232,34 @@ void Fifo::processLine(const char * line)
         if (userConfigurableArguments->verbosity)
             log(fmt("FIFO: Starting driver %s\n", tDriver));
 
-        DvrInfo * dp;
         if (remoteDriver == 0)
         {
+            if (!validScheduling)
+            {
+                log(fmt("FIFO: not starting %s\n", tDriver));
+                return;
+            }
+            if (PluginDvrInfo::isPlugin(tDriver))
+            {
+                auto * pluginDp = new PluginDvrInfo();
+                pluginDp->name = tDriver;
+                pluginDp->start();
+                return;
+            }
             auto * localDp = new LocalDvrInfo();
-            dp = localDp;
             //strncpy(dp->dev, tName, MAXINDIDEVICE);
             localDp->envDev = tName;
             localDp->envConfig = envConfig;
             localDp->envSkel = envSkel;
             localDp->envPrefix = envPrefix;
+            localDp->scheduling = scheduling;
+            localDp->name = tDriver;
+            localDp->start();
         }
         else
         {
-            dp = new RemoteDvrInfo();
+            RemoteDvrInfo::launch(tDriver);
         }
-        dp->name = tDriver;
-        dp->start();
     }
     else
     {
@@ -187,7 +267,7 @@ void Fifo::processLine(const char * line)
         {
             if (dp == nullptr) continue;
 
-            if (dp->name == tDriver)
+            if (dp->isNamed(tDriver))
             {
                 /* If device name is given, check against it before shutting down */
                 if (tName[0] && !dp->isHandlingDevice(tName))
@@ -195,6 +275,10 @@ void Fifo::processLine(const char * line)
                 if (userConfigurableArguments->verbosity)
                     log(fmt("FIFO: Shutting down driver: %s\n", tDriver));
 
+                /* a connection shared with other entries stays open */
+                if (!dp->stopNamed(tDriver))
+                    break;
+
                 dp->restart = false;
                 dp->close();
                 break;
@@ -33,6 +33,8 @@ class Fifo
         void close();
         void open();
         void processLine(const char * line);
+        void dumpMetrics(const char * path);
+        void setBandwidth(const char * args);
 
         /* Read commands from FIFO and process them. Start/stop drivers accordingly */
         void read();
@@ -0,0 +1,350 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "IoUring.hpp"
+#include "Utils.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+bool IoUring::enabled = false;
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+static int io_uring_setup(unsigned entries, struct io_uring_params * p)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void * arg, unsigned nrArgs)
+{
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+// The rings are shared with the kernel
+static unsigned loadAcquire(const unsigned * p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static void storeRelease(unsigned * p, unsigned v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+IoUring::IoUring(struct ev_loop * loop): completions(loop), submitter(loop)
+{
+    completions.set<IoUring, &IoUring::completionsCb>(this);
+    submitter.set<IoUring, &IoUring::submitterCb>(this);
+}
+
+IoUring::~IoUring()
+{
+    completions.stop();
+    submitter.stop();
+    if (sqes)
+        munmap(sqes, sqesSize);
+    if (cqMap && cqMap != sqMap)
+        munmap(cqMap, cqMapSize);
+    if (sqMap)
+        munmap(sqMap, sqMapSize);
+    if (ringFd != -1)
+        close(ringFd);
+    if (eventFd != -1)
+        close(eventFd);
+}
+
+bool IoUring::setup(unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    ringFd = io_uring_setup(entries, &p);
+    if (ringFd == -1)
+        return false;
+
+    sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED)
+    {
+        sqMap = nullptr;
+        return false;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        cqMap = sqMap;
+    else
+    {
+        cqMap = mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED)
+        {
+            cqMap = nullptr;
+            return false;
+        }
+    }
+
+    sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    void * sqeMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqeMap == MAP_FAILED)
+        return false;
+    sqes = (struct io_uring_sqe *) sqeMap;
+
+    char * sq = (char *) sqMap;
+    sqHead = (unsigned *)(sq + p.sq_off.head);
+    sqTail = (unsigned *)(sq + p.sq_off.tail);
+    sqMask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    sqArray = (unsigned *)(sq + p.sq_off.array);
+    sqEntries = p.sq_entries;
+
+    char * cq = (char *) cqMap;
+    cqHead = (unsigned *)(cq + p.cq_off.head);
+    cqTail = (unsigned *)(cq + p.cq_off.tail);
+    cqMask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventFd == -1 || io_uring_register(ringFd, IORING_REGISTER_EVENTFD, &eventFd, 1) == -1)
+        return false;
+
+    completions.start(eventFd, ev::READ);
+    return true;
+}
+
+IoUring * IoUring::get(struct ev_loop * loop)
+{
+    // Never freed: queues may be torn down during exit, after thread locals
+    static thread_local IoUring * ring = nullptr;
+    static thread_local bool failed = false;
+    static std::atomic<bool> logged {false};
+
+    if (!enabled || failed)
+        return nullptr;
+    if (ring)
+        return ring;
+
+    IoUring * created = new IoUring(loop);
+    if (!created->setup(256))
+    {
+        int error = errno;
+        delete created;
+        if (!logged.exchange(true))
+            log(fmt("io_uring not available, using readiness based io: %s\n", strerror(error)));
+        failed = true;
+        return nullptr;
+    }
+    ring = created;
+    return ring;
+}
+
+io_uring_sqe * IoUring::getSqe(Op * op)
+{
+    unsigned tail = *sqTail;
+    if (tail - loadAcquire(sqHead) >= sqEntries)
+    {
+        submit(0);
+        if (tail - loadAcquire(sqHead) >= sqEntries)
+            return nullptr;
+    }
+
+    io_uring_sqe * sqe = &sqes[tail & sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uintptr_t) op;
+    sqArray[tail & sqMask] = tail & sqMask;
+    storeRelease(sqTail, tail + 1);
+
+    if (toSubmit++ == 0)
+        submitter.start();
+    if (op)
+        op->inFlight = true;
+    return sqe;
+}
+
+void IoUring::submit(unsigned wait)
+{
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    while (toSubmit > 0 || wait > 0)
+    {
+        int r = io_uring_enter(ringFd, toSubmit, wait, flags);
+        if (r == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EBUSY)
+                log(fmt("io_uring_enter: %s\n", strerror(errno)));
+            // Completions must be reaped first
+            break;
+        }
+        toSubmit -= std::min<unsigned>(toSubmit, r);
+        break;
+    }
+    if (toSubmit == 0)
+        submitter.stop();
+}
+
+void IoUring::reap(Op * waitFor)
+{
+    unsigned head = *cqHead;
+    while (head != loadAcquire(cqTail))
+    {
+        io_uring_cqe * cqe = &cqes[head & cqMask];
+        Op * op = (Op *)(uintptr_t) cqe->user_data;
+        int res = cqe->res;
+        storeRelease(cqHead, ++head);
+
+        // Cancel requests have no op
+        if (op == nullptr)
+            continue;
+        if (waitFor != nullptr && op != waitFor)
+        {
+            deferred.emplace_back(op, res);
+            continue;
+        }
+        op->inFlight = false;
+        if (op != waitFor)
+            op->done(res);
+        // done may have queued or canceled: reload
+        head = *cqHead;
+    }
+}
+
+void IoUring::completionsCb(ev::io &, int)
+{
+    eventfd_t count;
+    eventfd_read(eventFd, &count);
+
+    std::vector<std::pair<Op *, int>> ready;
+    ready.swap(deferred);
+    for (auto &completed : ready)
+    {
+        completed.first->inFlight = false;
+        completed.first->done(completed.second);
+    }
+    reap(nullptr);
+}
+
+void IoUring::submitterCb(ev::prepare &, int)
+{
+    submit(0);
+}
+
+bool IoUring::writev(Op &op, int fd, const struct iovec * iov, unsigned count)
+{
+    io_uring_sqe * sqe = getSqe(&op);
+    if (sqe == nullptr)
+        return false;
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t) iov;
+    sqe->len = count;
+    return true;
+}
+
+bool IoUring::sendmsg(Op &op, int fd, const struct msghdr * msgh, int flags)
+{
+    io_uring_sqe * sqe = getSqe(&op);
+    if (sqe == nullptr)
+        return false;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t) msgh;
+    sqe->len = 1;
+    sqe->msg_flags = flags;
+    return true;
+}
+
+void IoUring::cancel(Op &op)
+{
+    if (!op.inFlight)
+        return;
+
+    for (auto it = deferred.begin(); it != deferred.end(); ++it)
+    {
+        if (it->first == &op)
+        {
+            deferred.erase(it);
+            op.inFlight = false;
+            return;
+        }
+    }
+
+    io_uring_sqe * sqe = getSqe(nullptr);
+    if (sqe)
+    {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = (uintptr_t) &op;
+    }
+
+    // Whether canceled or not, the op completes
+    while (op.inFlight)
+    {
+        submit(1);
+        reap(&op);
+    }
+    if (!deferred.empty())
+        completions.feed_event(ev::READ);
+}
+
+#else
+
+IoUring::IoUring(struct ev_loop * loop): completions(loop), submitter(loop)
+{
+}
+
+IoUring::~IoUring()
+{
+}
+
+IoUring * IoUring::get(struct ev_loop *)
+{
+    return nullptr;
+}
+
+bool IoUring::writev(Op &, int, const struct iovec *, unsigned)
+{
+    return false;
+}
+
+bool IoUring::sendmsg(Op &, int, const struct msghdr *, int)
+{
+    return false;
+}
+
+void IoUring::cancel(Op &)
+{
+}
+
+#endif
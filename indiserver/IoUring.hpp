@@ -0,0 +1,109 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <ev++.h>
+
+#include <functional>
+#include <vector>
+#include <sys/types.h>
+
+struct iovec;
+struct msghdr;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/* An io_uring serving the queues of one event loop (Linux only).
+ * Operations queued during a loop iteration are submitted together, with a single
+ * io_uring_enter before the loop waits. Completions are signaled through an eventfd
+ * and dispatched from the loop. Only to be used from the thread running the loop.
+ */
+class IoUring
+{
+    public:
+        /* An operation, with what to do on completion. res is the syscall result, or -errno.
+         * It must stay alive until done was called, or until cancel returns.
+         */
+        struct Op
+        {
+            std::function<void(int res)> done;
+            bool inFlight {false};
+        };
+
+    private:
+        int ringFd {-1};
+        int eventFd {-1};
+
+        unsigned * sqHead {nullptr};
+        unsigned * sqTail {nullptr};
+        unsigned sqMask {0};
+        unsigned * sqArray {nullptr};
+        io_uring_sqe * sqes {nullptr};
+        unsigned sqEntries {0};
+        unsigned toSubmit {0};
+
+        unsigned * cqHead {nullptr};
+        unsigned * cqTail {nullptr};
+        unsigned cqMask {0};
+        io_uring_cqe * cqes {nullptr};
+
+        void * sqMap {nullptr};
+        size_t sqMapSize {0};
+        void * cqMap {nullptr};
+        size_t cqMapSize {0};
+        size_t sqesSize {0};
+
+        ev::io completions;
+        ev::prepare submitter;
+
+        /* reaped by cancel while waiting for another op. Dispatched from the next completions event */
+        std::vector<std::pair<Op *, int>> deferred;
+
+        explicit IoUring(struct ev_loop * loop);
+        bool setup(unsigned entries);
+
+        /* a free sqe, submitting what is queued if the ring is full. nullptr on failure */
+        io_uring_sqe * getSqe(Op * op);
+        void submit(unsigned wait);
+        /* handle the ready completions. Those of ops other than waitFor are deferred if given */
+        void reap(Op * waitFor);
+
+        void completionsCb(ev::io &watcher, int revents);
+        void submitterCb(ev::prepare &watcher, int revents);
+
+    public:
+        ~IoUring();
+
+        /* queues are served from io_uring when available. Set once, before the loops start */
+        static bool enabled;
+
+        /* the ring of the loop run by the calling thread, created on first use.
+         * nullptr when not enabled, or when the kernel refused it (logged once)
+         */
+        static IoUring * get(struct ev_loop * loop);
+
+        /* queue a writev or a sendmsg on fd. iov, msgh and the data must stay valid until completion.
+         * return false if the op could not be queued, then the caller does the io itself
+         */
+        bool writev(Op &op, int fd, const struct iovec * iov, unsigned count);
+        bool sendmsg(Op &op, int fd, const struct msghdr * msgh, int flags);
+
+        /* make sure op does not complete anymore. done is not called for it */
+        void cancel(Op &op);
+};
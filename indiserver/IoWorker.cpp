@@ -0,0 +1,137 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "IoWorker.hpp"
+
+#include <condition_variable>
+
+std::unique_ptr<LoopTasks> IoWorker::mainLoopTasks;
+std::vector<std::unique_ptr<IoWorker>> IoWorker::pool;
+
+LoopTasks::LoopTasks(struct ev_loop * loop): wakeup(loop)
+{
+    wakeup.set<LoopTasks, &LoopTasks::onWakeup>(this);
+    wakeup.start();
+}
+
+void LoopTasks::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending.push_back(std::move(task));
+    }
+    wakeup.send();
+}
+
+void LoopTasks::onWakeup(ev::async &, int)
+{
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        ready.swap(pending);
+    }
+    for (auto &task : ready)
+    {
+        task();
+    }
+}
+
+IoWorker::IoWorker(): loop(ev::AUTO), tasks(loop)
+{
+    thread = std::thread([this]()
+    {
+        loop.run(0);
+    });
+}
+
+IoWorker::~IoWorker()
+{
+    if (isCurrentThread())
+    {
+        // Exiting from within the worker. Nothing to wait for
+        thread.detach();
+        return;
+    }
+    post([this]()
+    {
+        loop.break_loop(ev::ALL);
+    });
+    thread.join();
+}
+
+void IoWorker::post(std::function<void()> task)
+{
+    tasks.post(std::move(task));
+}
+
+void IoWorker::runSync(std::function<void()> task)
+{
+    std::mutex doneLock;
+    std::condition_variable doneCond;
+    bool done = false;
+
+    post([&]()
+    {
+        task();
+        std::lock_guard<std::mutex> guard(doneLock);
+        done = true;
+        doneCond.notify_one();
+    });
+
+    std::unique_lock<std::mutex> guard(doneLock);
+    doneCond.wait(guard, [&done]()
+    {
+        return done;
+    });
+}
+
+void IoWorker::release()
+{
+    if (clients > 0)
+        clients--;
+}
+
+void IoWorker::startPool(struct ev_loop * mainLoop, unsigned count)
+{
+    if (count == 0)
+        return;
+
+    mainLoopTasks = std::make_unique<LoopTasks>(mainLoop);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        pool.push_back(std::make_unique<IoWorker>());
+    }
+}
+
+IoWorker * IoWorker::acquire()
+{
+    IoWorker * best = nullptr;
+    for (auto &worker : pool)
+    {
+        if (best == nullptr || worker->clients < best->clients)
+            best = worker.get();
+    }
+    if (best)
+        best->clients++;
+    return best;
+}
+
+void IoWorker::postToMainLoop(std::function<void()> task)
+{
+    mainLoopTasks->post(std::move(task));
+}
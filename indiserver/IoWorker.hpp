@@ -0,0 +1,94 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <ev++.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Tasks to be run from an event loop. Tasks can be posted from any thread,
+ * they are executed in posting order by the thread running the loop.
+ */
+class LoopTasks
+{
+        ev::async wakeup;
+        std::mutex lock;
+        std::vector<std::function<void()>> pending;
+
+        void onWakeup(ev::async &watcher, int revents);
+    public:
+        explicit LoopTasks(struct ev_loop * loop);
+
+        void post(std::function<void()> task);
+};
+
+/* A thread running its own event loop, doing the io of the clients pinned to it.
+ * Reading, parsing and writing happen there. Routing, message and client lifetime
+ * are kept on the main loop; both sides exchange work through LoopTasks.
+ */
+class IoWorker
+{
+        ev::dynamic_loop loop;
+        LoopTasks tasks;
+        std::thread thread;
+        unsigned clients {0};           /* pinned clients. Only accessed from the main loop */
+
+        static std::unique_ptr<LoopTasks> mainLoopTasks;
+        static std::vector<std::unique_ptr<IoWorker>> pool;
+
+    public:
+        IoWorker();
+        ~IoWorker();
+
+        struct ev_loop * getLoop()
+        {
+            return loop;
+        }
+
+        bool isCurrentThread() const
+        {
+            return std::this_thread::get_id() == thread.get_id();
+        }
+
+        /* queue task for execution from this worker loop */
+        void post(std::function<void()> task);
+
+        /* run task from this worker loop and wait for its completion.
+         * Must not be called from the worker itself.
+         */
+        void runSync(std::function<void()> task);
+
+        /* unpin a client previously returned by acquire */
+        void release();
+
+        /* start count worker loops. To be called once, before accepting clients */
+        static void startPool(struct ev_loop * mainLoop, unsigned count);
+
+        /* pick the worker with fewest clients for a new connection.
+         * return nullptr when clients are served from the main loop.
+         */
+        static IoWorker * acquire();
+
+        /* queue task for execution from the main loop. Safe from any thread */
+        static void postToMainLoop(std::function<void()> task);
+};
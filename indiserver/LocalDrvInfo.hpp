@@ -19,6 +19,7 @@
 #pragma once
 
 #include "DvrInfo.hpp"
+#include "Scheduling.hpp"
 
 #include <ev++.h>
 #include <string>
@@ -40,11 +41,15 @@ class LocalDvrInfo: public DvrInfo
     protected:
         LocalDvrInfo(const LocalDvrInfo &model);
 
+        /* keep track of the properties defined, then route what clients do not know yet */
+        void onMessage(XMLEle *root, std::list<int> &sharedBuffers) override;
+
     public:
         std::string envDev;
         std::string envConfig;
         std::string envSkel;
         std::string envPrefix;
+        Scheduling scheduling;  /* applied to the driver process before exec */
 
         LocalDvrInfo();
         virtual ~LocalDvrInfo();
@@ -53,6 +58,13 @@ class LocalDvrInfo: public DvrInfo
 
         LocalDvrInfo * clone() const override;
 
+        bool keepsDevicesOnRestart() const override;
+
+        bool pingsFollowMessages() const override
+        {
+            return true;
+        }
+
         const std::string remoteServerUid() const override
         {
             return "";
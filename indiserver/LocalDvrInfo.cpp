@@ -22,8 +22,10 @@
 #include "Msg.hpp"
 #include "Constants.hpp"
 #include "CommandLineArgs.hpp"
+#include "StartupReport.hpp"
 
 #include "Fifo.hpp"
+#include "sharedring.h"
 #include <sys/socket.h>
 #include <fcntl.h>
 #include <libgen.h>
@@ -38,6 +40,7 @@ void LocalDvrInfo::start()
     int rp[2], wp[2], ep[2];
     int ux[2];
     int pid;
+    shared_ring * ring = nullptr;
 
 #ifdef OSX_EMBEDED_MODE
     fprintf(stderr, "STARTING \"%s\"\n", name.c_str());
@@ -53,6 +56,14 @@ void LocalDvrInfo::start()
             log(fmt("socketpair: %s\n", strerror(errno)));
             Bye();
         }
+
+        /* the driver writes its messages to shared memory, if it knows how to */
+        if (userConfigurableArguments->sharedRingKB > 0)
+        {
+            ring = IDSharedRingCreate(static_cast<size_t>(userConfigurableArguments->sharedRingKB) * 1024);
+            if (ring == nullptr)
+                log(fmt("shared ring: %s\n", strerror(errno)));
+        }
     }
     else
     {
@@ -100,10 +111,34 @@ void LocalDvrInfo::start()
             dup2(rp[1], 1); /* driver stdout writes to rp[1] */
         }
         dup2(ep[1], 2); /* driver stderr writes to e[]1] */
+
+        /* the ring fds are kept above the ones being closed, then given the first numbers */
+        int ringFds[SHARED_RING_FDS];
+        if (ring != nullptr)
+        {
+            IDSharedRingGetFds(ring, ringFds);
+            for (int i = 0; i < SHARED_RING_FDS; i++)
+                ringFds[i] = fcntl(ringFds[i], F_DUPFD, 100);
+        }
         for (fd = 3; fd < 100; fd++)
         {
             (void)::close(fd);
         }
+        if (ring != nullptr)
+        {
+            for (int i = 0; i < SHARED_RING_FDS; i++)
+            {
+                dup2(ringFds[i], 3 + i);
+                ::close(ringFds[i]);
+            }
+            setenv("INDIRING", "3,4,5", 1);
+        }
+        else
+        {
+            unsetenv("INDIRING");
+        }
+        /* stderr already goes to the server, that logs what fails */
+        scheduling.applyToDriver();
         if (!envDev.empty())
         {
             setenv("INDIDEV", envDev.c_str(), 1);
@@ -173,6 +208,7 @@ void LocalDvrInfo::start()
 
         /* record pid, io channels, init lp and snoop list */
         setFds(ux[1], ux[1]);
+        setRing(ring);
         rp[0] = ux[1];
         wp[1] = ux[1];
     }
@@ -206,10 +242,30 @@ void LocalDvrInfo::start()
 
     XMLEle *root = addXMLEle(NULL, "getProperties");
     addXMLAtt(root, "version", TO_STRING(INDIV));
+    addXMLAtt(root, "numbers", "ieee754");
+    if (useSharedBuffer)
+        addXMLAtt(root, "blobs", "attached");
     mp = new Msg(nullptr, root);
 
-    // pushmsg can kill mp. do at end
+    /* after a warm restart, the definitions are checked against those clients kept */
+    startResync();
+
+    StartupReport::track(this);
+
+    // pushmsg can kill this
+    auto hb = heartBeat();
     pushMsg(mp);
+    if (hb.alive())
+        askAnswered("");
+}
+
+void LocalDvrInfo::onMessage(XMLEle *root, std::list<int> &sharedBuffers)
+{
+    root = updateCache(root);
+    if (root == nullptr)
+        return;
+
+    DvrInfo::onMessage(root, sharedBuffers);
 }
 
 LocalDvrInfo::LocalDvrInfo(): DvrInfo(true)
@@ -223,8 +279,16 @@ LocalDvrInfo::LocalDvrInfo(const LocalDvrInfo &model):
     envDev(model.envDev),
     envConfig(model.envConfig),
     envSkel(model.envSkel),
-    envPrefix(model.envPrefix)
+    envPrefix(model.envPrefix),
+    scheduling(model.scheduling)
 {
+    /* clients keep the devices: the new instance is sent their messages and its definitions are checked */
+    if (keepsDevicesOnRestart())
+    {
+        dev   = model.dev;
+        cache = model.cache;
+    }
+
     eio.set<LocalDvrInfo, &LocalDvrInfo::onEfdEvent>(this);
     pidwatcher.set<LocalDvrInfo, &LocalDvrInfo::onPidEvent>(this);
 }
@@ -245,6 +309,11 @@ LocalDvrInfo * LocalDvrInfo::clone() const
     return new LocalDvrInfo(*this);
 }
 
+bool LocalDvrInfo::keepsDevicesOnRestart() const
+{
+    return userConfigurableArguments->warmRestart;
+}
+
 void LocalDvrInfo::closeEfd()
 {
     ::close(efd);
@@ -0,0 +1,150 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Metrics.hpp"
+#include "ClInfo.hpp"
+#include "DvrInfo.hpp"
+#include "Utils.hpp"
+
+LatencyHistogram Metrics::enqueueToFirstByte;
+LatencyHistogram Metrics::serializationTime;
+std::atomic<uint64_t> Metrics::serializedBytes {0};
+std::atomic<uint64_t> Metrics::spilledBytes {0};
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (auto &bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+unsigned LatencyHistogram::bucketOf(uint64_t value)
+{
+    if (value < subBuckets)
+        return value;
+
+    unsigned msb = 63 - __builtin_clzll(value);
+    unsigned shift = msb - subBucketBits;
+    if (shift >= magnitudes)
+        return bucketCount - 1;
+
+    return (shift + 1) * subBuckets + ((value >> shift) - subBuckets);
+}
+
+uint64_t LatencyHistogram::bucketValue(unsigned bucket)
+{
+    if (bucket < subBuckets)
+        return bucket;
+
+    unsigned shift = bucket / subBuckets - 1;
+    uint64_t lower = ((uint64_t)(subBuckets + bucket % subBuckets)) << shift;
+    return lower + (((uint64_t)1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t us)
+{
+    buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t prev = max.load(std::memory_order_relaxed);
+    while (prev < us && !max.compare_exchange_weak(prev, us, std::memory_order_relaxed));
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration d)
+{
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    record(us > 0 ? (uint64_t)us : 0);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return total.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::maximum() const
+{
+    return max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::quantile(double q) const
+{
+    uint64_t n = count();
+    if (n == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(q * (n - 1)) + 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < bucketCount; ++i)
+    {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(bucketValue(i), maximum());
+    }
+    return maximum();
+}
+
+static void reportHistogram(std::string &out, const char * name, const LatencyHistogram &h)
+{
+    for (double q : {0.5, 0.9, 0.99, 0.999})
+        out += fmt("%s{quantile=\"%g\"} %llu\n", name, q, (unsigned long long)h.quantile(q));
+    out += fmt("%s_max %llu\n", name, (unsigned long long)h.maximum());
+    out += fmt("%s_count %llu\n", name, (unsigned long long)h.count());
+}
+
+static void reportQueue(std::string &out, const std::string &labels, const MsgQueue &q)
+{
+    const QueueCounters &c = q.getCounters();
+    const char * l = labels.c_str();
+
+    out += fmt("indiserver_queue_size_bytes{%s} %lu\n", l, q.msgQSize());
+    out += fmt("indiserver_msgs_queued_total{%s} %llu\n", l, (unsigned long long)c.msgsQueued.load());
+    out += fmt("indiserver_msgs_sent_total{%s} %llu\n", l, (unsigned long long)c.msgsSent.load());
+    out += fmt("indiserver_bytes_sent_total{%s} %llu\n", l, (unsigned long long)c.bytesSent.load());
+    out += fmt("indiserver_msgs_received_total{%s} %llu\n", l, (unsigned long long)c.msgsReceived.load());
+    out += fmt("indiserver_bytes_received_total{%s} %llu\n", l, (unsigned long long)c.bytesReceived.load());
+    out += fmt("indiserver_shared_buffers_sent_total{%s} %llu\n", l, (unsigned long long)c.sharedBuffersSent.load());
+    out += fmt("indiserver_shared_buffers_received_total{%s} %llu\n", l,
+               (unsigned long long)c.sharedBuffersReceived.load());
+}
+
+std::string Metrics::report()
+{
+    std::string out;
+
+    reportHistogram(out, "indiserver_enqueue_to_first_byte_us", enqueueToFirstByte);
+    reportHistogram(out, "indiserver_serialization_us", serializationTime);
+    out += fmt("indiserver_serialized_bytes %llu\n", (unsigned long long)serializedBytes.load());
+    out += fmt("indiserver_spilled_bytes %llu\n", (unsigned long long)spilledBytes.load());
+
+    for (auto cpId : ClInfo::clients.ids())
+    {
+        auto cp = ClInfo::clients[cpId];
+        if (cp == nullptr) continue;
+        reportQueue(out, fmt("client=\"%lu\"", cpId), *cp);
+    }
+
+    for (auto dpId : DvrInfo::drivers.ids())
+    {
+        auto dp = DvrInfo::drivers[dpId];
+        if (dp == nullptr) continue;
+        reportQueue(out, fmt("driver=\"%s\"", dp->name.c_str()), *dp);
+    }
+
+    return out;
+}
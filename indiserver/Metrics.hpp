@@ -0,0 +1,84 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/* Log-linear histogram of durations in microseconds, HDR histogram style:
+ * every power of two is split in subBuckets, so the relative error stays below 1/subBuckets.
+ * record() is lock free and may be called from any thread.
+ */
+class LatencyHistogram
+{
+        static constexpr unsigned subBucketBits {3};
+        static constexpr unsigned subBuckets {1 << subBucketBits};
+        static constexpr unsigned magnitudes {40};      /* Beyond 2^40 us, values go to the last bucket */
+        static constexpr unsigned bucketCount {(magnitudes + 1) * subBuckets};
+
+        std::atomic<uint64_t> buckets[bucketCount];
+        std::atomic<uint64_t> total;
+        std::atomic<uint64_t> max;
+
+        static unsigned bucketOf(uint64_t value);
+        /* highest value that goes to the bucket */
+        static uint64_t bucketValue(unsigned bucket);
+
+    public:
+        LatencyHistogram();
+
+        void record(uint64_t us);
+        void record(std::chrono::steady_clock::duration d);
+
+        uint64_t count() const;
+        uint64_t maximum() const;
+
+        /* value at the given quantile (0..1), in us. Upper bound of its bucket */
+        uint64_t quantile(double q) const;
+};
+
+/* Traffic counters of a MsgQueue. Updated from the loop doing its io */
+struct QueueCounters
+{
+    std::atomic<uint64_t> msgsQueued {0};
+    std::atomic<uint64_t> msgsSent {0};
+    std::atomic<uint64_t> bytesSent {0};
+    std::atomic<uint64_t> msgsReceived {0};
+    std::atomic<uint64_t> bytesReceived {0};
+    std::atomic<uint64_t> sharedBuffersSent {0};
+    std::atomic<uint64_t> sharedBuffersReceived {0};
+};
+
+class Metrics
+{
+    public:
+        /* from pushMsg to the first byte written, for every queue */
+        static LatencyHistogram enqueueToFirstByte;
+        /* from start to end of SerializedMsg production */
+        static LatencyHistogram serializationTime;
+
+        /* serialized content owned by messages, in memory and in spill files */
+        static std::atomic<uint64_t> serializedBytes;
+        static std::atomic<uint64_t> spilledBytes;
+
+        /* All clients, drivers and histograms in Prometheus text format. From main loop */
+        static std::string report();
+};
@@ -22,10 +22,19 @@
 #include "SerializedMsg.hpp"
 #include "SerializedMsgWithSharedBuffer.hpp"
 #include "SerializedMsgWithoutSharedBuffer.hpp"
+#include "SerializedMsgWithCompression.hpp"
+#include "SerializedMsgWithBinaryBlobs.hpp"
+#include "SerializedMsgWithWebSocketFrames.hpp"
 #include "Utils.hpp"
 
+#include "sharedblob.h"
+#include "base64.h"
+#include "indiprobes.h"
+
 #include <string>
+#include <vector>
 #include <assert.h>
+#include <string.h>
 #include <unistd.h>
 
 Msg::Msg(MsgQueue * from, XMLEle * ele): sharedBuffers()
@@ -34,15 +43,22 @@ Msg::Msg(MsgQueue * from, XMLEle * ele): sharedBuffers()
     xmlContent = ele;
     hasInlineBlobs = false;
     hasSharedBufferBlobs = false;
+    stream = false;
 
     convertionToSharedBuffer = nullptr;
     convertionToInline = nullptr;
+    convertionToCompressed = nullptr;
+    convertionToBinary = nullptr;
+    convertionToWebSocket = nullptr;
+
+    device = findXMLAttValu(xmlContent, "device");
+    name = findXMLAttValu(xmlContent, "name");
 
     queueSize = sprlXMLEle(xmlContent, 0);
     for(auto blobContent : findBlobElements(xmlContent))
     {
         std::string attached = findXMLAttValu(blobContent, "attached");
-        if (attached == "true")
+        if (attached == "true" || blobXMLEle(blobContent, nullptr))
         {
             hasSharedBufferBlobs = true;
         }
@@ -50,14 +66,27 @@ Msg::Msg(MsgQueue * from, XMLEle * ele): sharedBuffers()
         {
             hasInlineBlobs = true;
         }
+
+        if (strstr(findXMLAttValu(blobContent, "format"), "stream"))
+        {
+            stream = true;
+        }
     }
 }
 
+bool Msg::isStream() const
+{
+    return stream;
+}
+
 Msg::~Msg()
 {
     // Assume convertionToSharedBlob and convertionToInlineBlob were already dropped
     assert(convertionToSharedBuffer == nullptr);
     assert(convertionToInline == nullptr);
+    assert(convertionToCompressed == nullptr);
+    assert(convertionToBinary == nullptr);
+    assert(convertionToWebSocket == nullptr);
 
     releaseXmlContent();
     releaseSharedBuffers(std::set<int>());
@@ -75,6 +104,21 @@ void Msg::releaseSerialization(SerializedMsg * msg)
         convertionToInline = nullptr;
     }
 
+    if (msg == convertionToCompressed)
+    {
+        convertionToCompressed = nullptr;
+    }
+
+    if (msg == convertionToBinary)
+    {
+        convertionToBinary = nullptr;
+    }
+
+    if (msg == convertionToWebSocket)
+    {
+        convertionToWebSocket = nullptr;
+    }
+
     delete(msg);
     prune();
 }
@@ -116,6 +160,18 @@ void Msg::prune()
     {
         convertionToInline->collectRequirements(req);
     }
+    if (convertionToCompressed)
+    {
+        convertionToCompressed->collectRequirements(req);
+    }
+    if (convertionToBinary)
+    {
+        convertionToBinary->collectRequirements(req);
+    }
+    if (convertionToWebSocket)
+    {
+        convertionToWebSocket->collectRequirements(req);
+    }
     // Free the resources.
     if (!req.xml)
     {
@@ -125,11 +181,26 @@ void Msg::prune()
     releaseSharedBuffers(req.sharedBuffers);
 
     // Nobody cares anymore ?
-    if (convertionToSharedBuffer == nullptr && convertionToInline == nullptr)
+    if (convertionToSharedBuffer == nullptr && convertionToInline == nullptr && convertionToCompressed == nullptr
+            && convertionToBinary == nullptr && convertionToWebSocket == nullptr)
     {
         delete(this);
     }
 }
+/** Put back raw content as base64 pcdata */
+static int encodeBlob(XMLEle * blobContent, const void * blob, size_t size)
+{
+    std::vector<char> base64(4 * size / 3 + 4);
+    int base64Count = to64frombits_s((unsigned char*)base64.data(), (const unsigned char*)blob, size, base64.size());
+    base64.resize(base64Count);
+    base64.push_back(0);
+
+    rmXMLAtt(blobContent, "enclen");
+    addXMLAtt(blobContent, "enclen", std::to_string(base64Count).c_str());
+    editXMLEle(blobContent, base64.data());
+    return base64Count;
+}
+
 /** Init a message from xml content & additional incoming buffers */
 bool Msg::fetchBlobs(std::list<int> &incomingSharedBuffers)
 {
@@ -159,11 +230,40 @@ bool Msg::fetchBlobs(std::list<int> &incomingSharedBuffers)
 
             sharedBuffers.push_back(fd);
         }
+        else if (blobXMLEle(blobContent, nullptr))
+        {
+            // Decoded by the parser in a shared buffer, or read as binary: attach it
+            size_t decodedSize;
+            void * blob = takeBlobXMLEle(blobContent, &decodedSize);
+            rmXMLAtt(blobContent, "binary");
+            int fd = IDSharedBlobGetFd(blob);
+            if (fd == -1)
+            {
+                // Binary content while nobody takes raw blobs, or without shared memory
+                queueSize += encodeBlob(blobContent, blob, decodedSize);
+                IDSharedBlobFree(blob);
+                hasInlineBlobs = true;
+                continue;
+            }
+            IDSharedBlobDettach(blob);
+
+            if ((ssize_t)decodedSize != blobSize)
+            {
+                log(fmt("Blob size mismatch after base64dec: %lld vs %lld\n", (long long int)decodedSize, (long long int)blobSize));
+            }
+
+            rmXMLAtt(blobContent, "enclen");
+            addXMLAtt(blobContent, "attached", "true");
+
+            queueSize += blobSize;
+            sharedBuffers.push_back(fd);
+        }
         else
         {
             // Check cdata length vs blobSize ?
         }
     }
+    hasSharedBufferBlobs = !sharedBuffers.empty();
     return true;
 }
 
@@ -180,6 +280,7 @@ Msg * Msg::fromXml(MsgQueue * from, XMLEle * root, std::list<int> &incomingShare
         delete(m);
         return nullptr;
     }
+    INDI_PROBE5(msg_parsed, m, tagXMLEle(root), m->device.c_str(), m->name.c_str(), m->queueSize);
     return m;
 }
 
@@ -208,14 +309,58 @@ SerializedMsg * Msg::buildConvertionToInline()
     return convertionToInline = new SerializedMsgWithoutSharedBuffer(this);
 }
 
+SerializedMsg * Msg::buildConvertionToCompressed()
+{
+    if (convertionToCompressed)
+    {
+        return convertionToCompressed;
+    }
+
+    return convertionToCompressed = new SerializedMsgWithCompression(this);
+}
+
+SerializedMsg * Msg::buildConvertionToBinary()
+{
+    if (convertionToBinary)
+    {
+        return convertionToBinary;
+    }
+
+    return convertionToBinary = new SerializedMsgWithBinaryBlobs(this);
+}
+
+SerializedMsg * Msg::buildConvertionToWebSocket()
+{
+    if (convertionToWebSocket)
+    {
+        return convertionToWebSocket;
+    }
+
+    return convertionToWebSocket = new SerializedMsgWithWebSocketFrames(this);
+}
+
 SerializedMsg * Msg::serialize(MsgQueue * to)
 {
+    // Every message goes in frames
+    if (to->acceptWebSocketFrames())
+    {
+        return buildConvertionToWebSocket();
+    }
+
     if (hasSharedBufferBlobs || hasInlineBlobs)
     {
         if (to->acceptSharedBuffers())
         {
             return buildConvertionToSharedBuffer();
         }
+        else if (hasSharedBufferBlobs && to->acceptBinaryBlobs())
+        {
+            return buildConvertionToBinary();
+        }
+        else if (to->acceptCompressedBlobs())
+        {
+            return buildConvertionToCompressed();
+        }
         else
         {
             return buildConvertionToInline();
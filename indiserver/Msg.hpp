@@ -21,19 +21,27 @@
 #include <vector>
 #include <list>
 #include <set>
+#include <string>
 
 #include "lilxml.h"
+#include "Pool.hpp"
 
 class MsgQueue;
 class SerializedMsg;
 class SerializedMsgWithSharedBuffer;
 class SerializedMsgWithoutSharedBuffer;
+class SerializedMsgWithCompression;
+class SerializedMsgWithBinaryBlobs;
+class SerializedMsgWithWebSocketFrames;
 
-class Msg
+class Msg: public Pooled<Msg>
 {
         friend class SerializedMsg;
         friend class SerializedMsgWithSharedBuffer;
         friend class SerializedMsgWithoutSharedBuffer;
+        friend class SerializedMsgWithCompression;
+        friend class SerializedMsgWithBinaryBlobs;
+        friend class SerializedMsgWithWebSocketFrames;
     private:
         // Present for sure until message queueing is doned. Prune asap then
         XMLEle * xmlContent;
@@ -44,15 +52,26 @@ class Msg
         int queueSize;
         bool hasInlineBlobs;
         bool hasSharedBufferBlobs;
+        bool stream;                    /* Has a BLOB in a stream format */
+
+        // Kept after xml release, to order messages within queues
+        std::string device;
+        std::string name;
 
         std::vector<int> sharedBuffers; /* fds of shared buffer */
 
         // Convertion task and resultat of the task
         SerializedMsg* convertionToSharedBuffer;
         SerializedMsg* convertionToInline;
+        SerializedMsg* convertionToCompressed;
+        SerializedMsg* convertionToBinary;
+        SerializedMsg* convertionToWebSocket;
 
         SerializedMsg * buildConvertionToSharedBuffer();
         SerializedMsg * buildConvertionToInline();
+        SerializedMsg * buildConvertionToCompressed();
+        SerializedMsg * buildConvertionToBinary();
+        SerializedMsg * buildConvertionToWebSocket();
 
         bool fetchBlobs(std::list<int> &incomingSharedBuffers);
 
@@ -73,6 +92,9 @@ class Msg
 
         Msg(MsgQueue * from, XMLEle * root);
 
+        /* true for frames of a video stream: they can be dropped or replaced by newer ones */
+        bool isStream() const;
+
         static Msg * fromXml(MsgQueue * from, XMLEle * root, std::list<int> &incomingSharedBuffers);
 
         /**
@@ -21,10 +21,22 @@ MsgChunck::MsgChunck() : sharedBufferIdsToAttach()
 {
     content = nullptr;
     contentLength = 0;
+    fileFd = -1;
+    fileOffset = 0;
 }
 
 MsgChunck::MsgChunck(char * content, unsigned long length) : sharedBufferIdsToAttach()
 {
     this->content = content;
     this->contentLength = length;
+    this->fileFd = -1;
+    this->fileOffset = 0;
+}
+
+MsgChunck::MsgChunck(int fileFd, off_t fileOffset, unsigned long length) : sharedBufferIdsToAttach()
+{
+    this->content = nullptr;
+    this->contentLength = length;
+    this->fileFd = fileFd;
+    this->fileOffset = fileOffset;
 }
\ No newline at end of file
@@ -19,29 +19,40 @@
 #pragma once
 
 #include <vector>
+#include <sys/types.h>
 
 class SerializedMsg;
 class SerializedMsgWithSharedBuffer;
 class SerializedMsgWithoutSharedBuffer;
+class SerializedMsgWithCompression;
+class SerializedMsgWithBinaryBlobs;
 class MsgChunckIterator;
 
 /**
  * A MsgChunk is either:
  *  a raw xml fragment
  *  a ref to a shared buffer in the message
+ *  a range of a file, to be sent as is (content is nullptr)
  */
 class MsgChunck
 {
         friend class SerializedMsg;
         friend class SerializedMsgWithSharedBuffer;
         friend class SerializedMsgWithoutSharedBuffer;
+        friend class SerializedMsgWithCompression;
+        friend class SerializedMsgWithBinaryBlobs;
+        friend class SerializedMsgWithWebSocketFrames;
         friend class MsgChunckIterator;
 
         MsgChunck();
         MsgChunck(char * content, unsigned long length);
+        MsgChunck(int fileFd, off_t fileOffset, unsigned long length);
 
         char * content;
         unsigned long contentLength;
 
+        int fileFd;
+        off_t fileOffset;
+
         std::vector<int> sharedBufferIdsToAttach;
 };
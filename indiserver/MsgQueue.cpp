@@ -22,11 +22,24 @@
 #include "SerializedMsg.hpp"
 #include "Msg.hpp"
 #include "CommandLineArgs.hpp"
+#include "IoWorker.hpp"
+
+#include "sharedblob.h"
+#include "sharedring.h"
+#include "indiprobes.h"
 
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 using namespace indiserver::constants;
 
 void MsgQueue::writeToFd()
@@ -49,6 +62,7 @@ void MsgQueue::writeToFd()
     {
         if (!mp->getContent(nsent, data, nsend, sharedBuffers))
         {
+            // Will be restarted by messageMayHaveProgressed or kickHeadMsg
             wio.stop();
             return;
         }
@@ -65,69 +79,133 @@ void MsgQueue::writeToFd()
     }
     while(nsend == 0);
 
-    /* send next chunk, never more than maxWriteBufferLength to reduce blocking */
-    if (nsend > static_cast<ssize_t>(maxWriteBufferLength))
-        nsend = static_cast<ssize_t>(maxWriteBufferLength);
+    size_t allowance = sendAllowance(data == nullptr ? maxFileWriteLength : maxWriteBufferLength);
+    if (allowance == 0)
+        return;
 
-    if (!useSharedBuffer)
+    /* a BLOB taking several writes leaves in full frames, until its end uncorks in consumeHeadMsg */
+    if (socketProfile == BulkProfile && !corked && mp->hasBlobs() && mp->queueSize() > static_cast<ssize_t>(allowance))
+        setCork(true);
+
+    if (data == nullptr)
     {
-        nw = write(wFd, data, nsend);
+        writeFileChunk(mp, std::min(nsend, static_cast<ssize_t>(allowance)));
+        return;
     }
-    else
-    {
-        struct msghdr msgh;
-        struct iovec iov[1];
-        int cmsghdrlength;
-        struct cmsghdr * cmsgh;
 
-        size_t fdCount = sharedBuffers.size();
-        if (fdCount > 0)
+    /* gather the ready chunks that follow, from this message and the next queued ones,
+     * never more than maxWriteBufferLength to reduce blocking, nor than the send budget allows.
+     * fds are only sent along the first chunk: they must never leave before their chunk.
+     */
+    iovCount = 0;
+    size_t total = 0;
+
+    std::vector<SerializedMsg *> upcoming = upcomingMsgs(maxIovPerWrite);
+    size_t nextUpcoming = 0;
+    SerializedMsg * gmp = mp;
+    MsgChunckIterator iter = nsent;
+    while(true)
+    {
+        if (nsend > static_cast<ssize_t>(allowance - total))
+            nsend = static_cast<ssize_t>(allowance - total);
+
+        iov[iovCount].iov_base = data;
+        iov[iovCount].iov_len = nsend;
+        iovMsg[iovCount] = gmp;
+        iovCount++;
+        total += nsend;
+        gmp->advance(iter, nsend);
+
+        if (iovCount == maxIovPerWrite || total >= allowance)
+            break;
+
+        std::vector<int> fds;
+        bool ready = false;
+        do
         {
-            if (fdCount > maxFDPerMessage)
+            if (iter.done())
             {
-                log(fmt("attempt to send too many FD\n"));
-                close();
-                return;
+                if (nextUpcoming == upcoming.size())
+                    break;
+                gmp = upcoming[nextUpcoming++];
+                iter.reset();
             }
+            ready = gmp->getContent(iter, data, nsend, fds);
+        }
+        while(ready && nsend == 0);
+
+        // File chunks are written on their own
+        if (iter.done() || !ready || !fds.empty() || data == nullptr)
+            break;
 
-            cmsghdrlength = CMSG_SPACE((fdCount * sizeof(int)));
-            // FIXME: abort on alloc error here
-            cmsgh = (struct cmsghdr*)malloc(cmsghdrlength);
-            memset(cmsgh, 0, cmsghdrlength);
+        // A queued frame may be replaced by a newer one while the write is in flight
+        if (uring && gmp != mp && gmp->isStream())
+            break;
+    }
+
+    iovFdCount = sharedBuffers.size();
+    if (iovFdCount > maxFDPerMessage)
+    {
+        log(fmt("attempt to send too many FD\n"));
+        requestClose();
+        return;
+    }
 
+    if (useSharedBuffer)
+    {
+        writeMsgh.msg_flags = 0;
+        writeMsgh.msg_name = NULL;
+        writeMsgh.msg_namelen = 0;
+        writeMsgh.msg_iov = iov;
+        writeMsgh.msg_iovlen = iovCount;
+
+        if (iovFdCount > 0)
+        {
             /* Write the fd as ancillary data */
-            cmsgh->cmsg_len = CMSG_LEN(fdCount * sizeof(int));
+            memset(writeControl, 0, sizeof(writeControl));
+            writeMsgh.msg_control = writeControl;
+            writeMsgh.msg_controllen = CMSG_SPACE(iovFdCount * sizeof(int));
+            struct cmsghdr * cmsgh = CMSG_FIRSTHDR(&writeMsgh);
+            cmsgh->cmsg_len = CMSG_LEN(iovFdCount * sizeof(int));
             cmsgh->cmsg_level = SOL_SOCKET;
             cmsgh->cmsg_type = SCM_RIGHTS;
-            msgh.msg_control = cmsgh;
-            msgh.msg_controllen = cmsghdrlength;
-            for(size_t i = 0; i < fdCount; ++i)
+            for(size_t i = 0; i < iovFdCount; ++i)
             {
-                ((int *) CMSG_DATA(CMSG_FIRSTHDR(&msgh)))[i] = sharedBuffers[i];
+                ((int *) CMSG_DATA(cmsgh))[i] = sharedBuffers[i];
             }
         }
         else
         {
-            cmsgh = NULL;
-            cmsghdrlength = 0;
-            msgh.msg_control = cmsgh;
-            msgh.msg_controllen = cmsghdrlength;
+            writeMsgh.msg_control = NULL;
+            writeMsgh.msg_controllen = 0;
         }
+    }
 
-        iov[0].iov_base = data;
-        iov[0].iov_len = nsend;
-
-        msgh.msg_flags = 0;
-        msgh.msg_name = NULL;
-        msgh.msg_namelen = 0;
-        msgh.msg_iov = iov;
-        msgh.msg_iovlen = 1;
-
-        nw = sendmsg(wFd, &msgh,  MSG_NOSIGNAL);
+    if (uring)
+    {
+        // The chunks stay in place until completion, see wrote
+        bool queued = useSharedBuffer ? uring->sendmsg(writeOp, wFd, &writeMsgh, MSG_NOSIGNAL)
+                      : uring->writev(writeOp, wFd, iov, iovCount);
+        if (queued)
+        {
+            wio.stop();
+            return;
+        }
+    }
 
-        free(cmsgh);
+    if (!useSharedBuffer)
+    {
+        nw = writev(wFd, iov, iovCount);
+    }
+    else
+    {
+        nw = sendmsg(wFd, &writeMsgh, MSG_NOSIGNAL);
     }
+    wrote(nw);
+}
 
+void MsgQueue::wrote(ssize_t nw)
+{
     /* shut down if trouble */
     if (nw <= 0)
     {
@@ -141,25 +219,234 @@ void MsgQueue::writeToFd()
         return;
     }
 
+    counters.bytesSent += nw;
+    counters.sharedBuffersSent += iovFdCount;
+    if (sendRate > 0)
+        sendTokens -= nw;
+
     /* trace */
     if (userConfigurableArguments->verbosity > 2)
     {
-        log(fmt("sending msg nq %ld:\n%.*s\n",
-                msgq.size(), (int)nw, data));
-    }
-    else if (userConfigurableArguments->verbosity > 1)
-    {
-        log(fmt("sending %.*s\n", (int)nw, data));
+        size_t nq;
+        {
+            std::lock_guard<std::mutex> guard(msgqLock);
+            nq = (sending ? 1 : 0) + controlq.size() + msgq.size();
+        }
+        log(fmt("sending msg nq %ld:\n", nq));
     }
 
     /* update amount sent. when complete: free message if we are the last
      * to use it and pop from our queue.
      */
+    size_t remaining = nw;
+    for(int i = 0; i < iovCount && remaining > 0; ++i)
+    {
+        size_t len = std::min(remaining, iov[i].iov_len);
+
+        if (userConfigurableArguments->verbosity > 1)
+        {
+            log(fmt("sending %.*s\n", (int)len, (const char *)iov[i].iov_base));
+        }
+
+        // Previous piece was the end of its message
+        if (iovMsg[i] != headMsg())
+            consumeHeadMsg(iovMsg[i]);
+
+        if (i == 0 || iovMsg[i] != iovMsg[i - 1])
+            recordFirstByte(iovMsg[i]);
+
+        iovMsg[i]->advance(nsent, len);
+        remaining -= len;
+        if (nsent.done())
+            consumeHeadMsg(i + 1 < iovCount ? iovMsg[i + 1] : nullptr);
+    }
+}
+
+void MsgQueue::writeCompleted(int res)
+{
+    if (res == -EAGAIN)
+    {
+        // Nothing went, wait for the socket to be writable
+        updateIos();
+        return;
+    }
+    if (res < 0)
+    {
+        errno = -res;
+        res = -1;
+    }
+    auto hb = heartBeat();
+    wrote(res);
+    if (hb.alive())
+        updateIos();
+}
+
+void MsgQueue::cancelWrite()
+{
+    if (uring)
+        uring->cancel(writeOp);
+}
+
+void MsgQueue::writeFileChunk(SerializedMsg * mp, ssize_t nsend)
+{
+    off_t offset;
+    int fd = mp->getContentFile(nsent, offset);
+
+    if (nsend > static_cast<ssize_t>(maxFileWriteLength))
+        nsend = static_cast<ssize_t>(maxFileWriteLength);
+
+#ifdef __linux__
+    // From the page cache to the socket, no user space copy
+    ssize_t nw = sendfile(wFd, fd, &offset, nsend);
+#else
+    char buf[maxWriteBufferLength];
+    ssize_t nw = pread(fd, buf, std::min(nsend, static_cast<ssize_t>(sizeof(buf))), offset);
+    if (nw > 0)
+        nw = write(wFd, buf, nw);
+#endif
+
+    /* shut down if trouble */
+    if (nw <= 0)
+    {
+        if (nw == 0)
+            log("write returned 0\n");
+        else
+            log(fmt("write: %s\n", strerror(errno)));
+
+        // Keep the read part open
+        closeWritePart();
+        return;
+    }
+
+    counters.bytesSent += nw;
+    if (sendRate > 0)
+        sendTokens -= nw;
+    recordFirstByte(mp);
+
+    if (userConfigurableArguments->verbosity > 1)
+    {
+        log(fmt("sending %ld raw bytes\n", (long)nw));
+    }
+
     mp->advance(nsent, nw);
     if (nsent.done())
         consumeHeadMsg();
 }
 
+size_t MsgQueue::sendAllowance(size_t max)
+{
+    if (sendRate <= 0)
+        return max;
+
+    // Refill for the time elapsed, up to a burst of 100ms worth, at least one chunk
+    auto now = std::chrono::steady_clock::now();
+    double burst = std::max(sendRate / 10, static_cast<double>(maxWriteBufferLength));
+    sendTokens = std::min(burst, sendTokens + sendRate * std::chrono::duration<double>(now - sendRefill).count());
+    sendRefill = now;
+
+    // Don't dribble: wait until a fair part of a chunk may go at once
+    double enough = std::min(static_cast<double>(max), 4096.0);
+    if (sendTokens >= enough)
+        return std::min(max, static_cast<size_t>(sendTokens));
+
+    wio.stop();
+    rateTimer.start((enough - sendTokens) / sendRate);
+    return 0;
+}
+
+void MsgQueue::rateCb(ev::timer &, int)
+{
+    updateIos();
+}
+
+#ifdef __linux__
+/* a buffer size set by hand is no longer autotuned by the kernel, and capped by the given limit */
+static bool bufferAllowed(const char * limitPath, int length)
+{
+    FILE * file = fopen(limitPath, "r");
+    if (file == nullptr)
+        return false;
+    long limit = 0;
+    if (fscanf(file, "%ld", &limit) != 1)
+        limit = 0;
+    fclose(file);
+    return limit >= length;
+}
+#endif
+
+void MsgQueue::setCork(bool cork)
+{
+    corked = cork;
+#ifdef TCP_CORK
+    int value = cork ? 1 : 0;
+    if (wFd != -1)
+        setsockopt(wFd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+#endif
+}
+
+void MsgQueue::setSocketProfile(SocketProfile profile)
+{
+    if (worker && !worker->isCurrentThread())
+    {
+        worker->post([this, profile]()
+        {
+            setSocketProfile(profile);
+        });
+        return;
+    }
+
+    if (wFd == -1 || profile == socketProfile || profile == NoProfile)
+        return;
+
+    int one = 1;
+    if (setsockopt(wFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0 && userConfigurableArguments->verbosity > 0)
+        log(fmt("TCP_NODELAY: %s\n", strerror(errno)));
+
+    if (profile == BulkProfile && socketProfile != BulkProfile)
+    {
+        int length = 0;
+        socklen_t len = sizeof(length);
+        bool enlarge = getsockopt(wFd, SOL_SOCKET, SO_SNDBUF, &length, &len) == 0 && length < bulkSendBufferLength;
+#ifdef __linux__
+        enlarge = enlarge && bufferAllowed("/proc/sys/net/core/wmem_max", bulkSendBufferLength);
+#endif
+        if (enlarge)
+            setsockopt(wFd, SOL_SOCKET, SO_SNDBUF, &bulkSendBufferLength, sizeof(bulkSendBufferLength));
+
+#ifdef TCP_NOTSENT_LOWAT
+        int lowat = userConfigurableArguments->notSentLowatKB * 1024;
+        if (lowat > 0 && setsockopt(wFd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) < 0
+                && userConfigurableArguments->verbosity > 0)
+            log(fmt("TCP_NOTSENT_LOWAT: %s\n", strerror(errno)));
+#endif
+    }
+
+    if (profile == ControlProfile && corked)
+        setCork(false);
+
+    if (userConfigurableArguments->verbosity > 1)
+        log(fmt("%s socket profile\n", profile == BulkProfile ? "bulk" : "control"));
+    socketProfile = profile;
+}
+
+void MsgQueue::setSendRate(double bytesPerSecond)
+{
+    if (worker && !worker->isCurrentThread())
+    {
+        worker->post([this, bytesPerSecond]()
+        {
+            setSendRate(bytesPerSecond);
+        });
+        return;
+    }
+
+    sendRate = bytesPerSecond;
+    sendTokens = std::max(sendRate / 10, static_cast<double>(maxWriteBufferLength));
+    sendRefill = std::chrono::steady_clock::now();
+    rateTimer.stop();
+    updateIos();
+}
+
 void MsgQueue::log(const std::string &str) const
 {
     // This is only invoked from destructor
@@ -220,14 +507,24 @@ void MsgQueue::traceMsg(const std::string &logMsg, XMLEle *root)
 MsgQueue::MsgQueue(bool useSharedBuffer): useSharedBuffer(useSharedBuffer)
 {
     lp = newLilXML();
+    /* messages are parsed, forwarded and freed whole */
+    setArenaLilXML(lp, 1);
     rio.set<MsgQueue, &MsgQueue::ioCb>(this);
     wio.set<MsgQueue, &MsgQueue::ioCb>(this);
+    ringio.set<MsgQueue, &MsgQueue::ringCb>(this);
+    rateTimer.set<MsgQueue, &MsgQueue::rateCb>(this);
+    writeOp.done = [this](int res)
+    {
+        writeCompleted(res);
+    };
     rFd = -1;
     wFd = -1;
 }
 
 MsgQueue::~MsgQueue()
 {
+    detachWorker();
+
     rio.stop();
     wio.stop();
 
@@ -235,6 +532,7 @@ MsgQueue::~MsgQueue()
     delLilXML(lp);
     lp = nullptr;
 
+    setRing(nullptr);
     setFds(-1, -1);
 
     /* unreference messages queue for this client */
@@ -256,7 +554,10 @@ void MsgQueue::closeWritePart()
 
     int oldWFd = wFd;
 
-    wFd = -1;
+    {
+        std::lock_guard<std::mutex> guard(msgqLock);
+        wFd = -1;
+    }
     // Clear the queue and stop the io slot
     clearMsgQueue();
 
@@ -267,7 +568,7 @@ void MsgQueue::closeWritePart()
             if (errno != ENOTCONN)
             {
                 log(fmt("socket shutdown failed: %s\n", strerror(errno)));
-                close();
+                requestClose();
             }
         }
     }
@@ -276,13 +577,67 @@ void MsgQueue::closeWritePart()
         if (::close(oldWFd) == -1)
         {
             log(fmt("socket close failed: %s\n", strerror(errno)));
-            close();
+            requestClose();
         }
     }
 }
 
+void MsgQueue::requestClose()
+{
+    if (worker && worker->isCurrentThread())
+    {
+        rio.stop();
+        wio.stop();
+
+        auto hb = heartBeat();
+        IoWorker::postToMainLoop([this, hb]()
+        {
+            if (hb.alive())
+                close();
+        });
+        return;
+    }
+    close();
+}
+
+void MsgQueue::attachWorker(IoWorker * worker)
+{
+    this->worker = worker;
+    if (worker)
+    {
+        rio.set(worker->getLoop());
+        wio.set(worker->getLoop());
+        rateTimer.set(worker->getLoop());
+    }
+}
+
+void MsgQueue::detachWorker()
+{
+    if (!worker)
+        return;
+
+    // Once done, nothing refers to this queue from the worker anymore
+    worker->runSync([this]()
+    {
+        setFds(-1, -1);
+    });
+    worker->release();
+    worker = nullptr;
+}
+
 void MsgQueue::setFds(int rFd, int wFd)
 {
+    if (worker && !worker->isCurrentThread())
+    {
+        worker->runSync([this, rFd, wFd]()
+        {
+            setFds(rFd, wFd);
+        });
+        return;
+    }
+
+    rateTimer.stop();
+    cancelWrite();
     if (this->rFd != -1)
     {
         rio.stop();
@@ -300,7 +655,10 @@ void MsgQueue::setFds(int rFd, int wFd)
     }
 
     this->rFd = rFd;
-    this->wFd = wFd;
+    {
+        std::lock_guard<std::mutex> guard(msgqLock);
+        this->wFd = wFd;
+    }
     this->nsent.reset();
 
     if (rFd != -1)
@@ -313,48 +671,255 @@ void MsgQueue::setFds(int rFd, int wFd)
 
         rio.set(rFd, ev::READ);
         wio.set(wFd, ev::WRITE);
+        uring = IoUring::get(worker ? worker->getLoop() : EV_DEFAULT);
         updateIos();
     }
 }
 
+void MsgQueue::setRing(shared_ring * ring)
+{
+    if (this->ring != nullptr)
+    {
+        ringio.stop();
+        IDSharedRingFree(this->ring);
+        delLilXML(ringLp);
+        ringLp = nullptr;
+    }
+
+    this->ring = ring;
+    if (ring != nullptr)
+    {
+        ringLp = newLilXML();
+        setArenaLilXML(ringLp, 1);
+        ringio.start(IDSharedRingGetReadFd(ring), ev::READ);
+    }
+}
+
 SerializedMsg * MsgQueue::headMsg() const
 {
-    if (msgq.empty()) return nullptr;
-    return *(msgq.begin());
+    std::lock_guard<std::mutex> guard(msgqLock);
+    return sending;
 }
 
-void MsgQueue::consumeHeadMsg()
+bool MsgQueue::mustFollowBlobs(const SerializedMsg * mp) const
 {
-    auto msg = headMsg();
-    msgq.pop_front();
-    msg->release(this);
+    if (msgq.empty())
+        return false;
+
+    const std::string &dev = mp->getDevice();
+    const std::string &name = mp->getName();
+
+    // Messages not bound to a device are ordered with everything
+    if (dev.empty())
+        return true;
+
+    for (auto queued : msgq)
+    {
+        if (queued->getDevice().empty())
+            return true;
+        if (queued->getDevice() != dev)
+            continue;
+        if (name.empty() || queued->getName().empty() || queued->getName() == name)
+            return true;
+    }
+    return false;
+}
+
+SerializedMsg * MsgQueue::popNextMsg(SerializedMsg * expected)
+{
+    if (expected != nullptr)
+    {
+        // Already partially written: it is at the front of its lane, whatever was pushed since
+        for (auto lane : {&controlq, &msgq})
+        {
+            if (!lane->empty() && lane->front() == expected)
+            {
+                lane->pop_front();
+                return expected;
+            }
+        }
+    }
+
+    auto &lane = controlq.empty() ? msgq : controlq;
+    if (lane.empty())
+        return nullptr;
+
+    auto mp = lane.front();
+    lane.pop_front();
+    return mp;
+}
+
+std::vector<SerializedMsg *> MsgQueue::upcomingMsgs(size_t count) const
+{
+    std::vector<SerializedMsg *> result;
+
+    std::lock_guard<std::mutex> guard(msgqLock);
+    for (auto lane : {&controlq, &msgq})
+    {
+        for (auto mp : *lane)
+        {
+            if (result.size() == count)
+                return result;
+            result.push_back(mp);
+        }
+    }
+    return result;
+}
+
+void MsgQueue::recordFirstByte(const SerializedMsg * mp)
+{
+    std::lock_guard<std::mutex> guard(msgqLock);
+    auto it = queuedAt.find(mp);
+    if (it == queuedAt.end())
+        return;
+    Metrics::enqueueToFirstByte.record(std::chrono::steady_clock::now() - it->second);
+    queuedAt.erase(it);
+}
+
+void MsgQueue::consumeHeadMsg(SerializedMsg * next)
+{
+    SerializedMsg * msg;
+    {
+        std::lock_guard<std::mutex> guard(msgqLock);
+        msg = sending;
+        sending = popNextMsg(next);
+        queuedAt.erase(msg);
+    }
+    INDI_PROBE4(msg_pop, this, msg, msg->getDevice().c_str(), msg->getName().c_str());
+    counters.msgsSent++;
     nsent.reset();
+    if (corked)
+        setCork(false);
+
+    if (worker && worker->isCurrentThread())
+    {
+        // The next message may not be produced yet. This is started from the main loop
+        auto hb = heartBeat();
+        IoWorker::postToMainLoop([this, hb, msg]()
+        {
+            msg->release(this);
+            if (hb.alive())
+                kickHeadMsg();
+        });
+        return;
+    }
 
+    msg->release(this);
     updateIos();
 }
 
-void MsgQueue::pushMsg(Msg * mp)
+void MsgQueue::releaseMsg(SerializedMsg * mp)
 {
-    // Don't write messages to client that have been disconnected
-    if (wFd == -1)
+    if (worker && worker->isCurrentThread())
     {
+        IoWorker::postToMainLoop([this, mp]()
+        {
+            mp->release(this);
+        });
         return;
     }
+    mp->release(this);
+}
 
-    auto serialized = mp->serialize(this);
+void MsgQueue::kickHeadMsg()
+{
+    auto mp = headMsg();
+    if (mp != nullptr)
+    {
+        mp->requestContent(MsgChunckIterator());
+    }
+    updateIos();
+}
 
-    msgq.push_back(serialized);
+void MsgQueue::pushMsg(Msg * mp)
+{
+    {
+        std::lock_guard<std::mutex> guard(msgqLock);
+        // Don't write messages to client that have been disconnected
+        if (wFd == -1)
+        {
+            return;
+        }
+    }
+
+    auto serialized = mp->serialize(this);
     serialized->addAwaiter(this);
+    INDI_PROBE5(msg_push, this, serialized, serialized->getDevice().c_str(), serialized->getName().c_str(),
+                serialized->queueSize());
+
+    bool isHead = false;
+    SerializedMsg * replaced = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(msgqLock);
+        queuedAt[serialized] = std::chrono::steady_clock::now();
+        if (latestFrameWins && serialized->isStream())
+        {
+            // Drop the unsent older frame. The new one goes at the end, after what was emitted before it
+            for (auto it = msgq.begin(); it != msgq.end(); ++it)
+            {
+                if ((*it)->isStream() && (*it)->getDevice() == serialized->getDevice() && (*it)->getName() == serialized->getName())
+                {
+                    replaced = *it;
+                    msgq.erase(it);
+                    queuedAt.erase(replaced);
+                    break;
+                }
+            }
+        }
+
+        if (sending == nullptr)
+        {
+            sending = serialized;
+            isHead = true;
+        }
+        else if (serialized->hasBlobs() || mustFollowBlobs(serialized))
+        {
+            msgq.push_back(serialized);
+        }
+        else
+        {
+            controlq.push_back(serialized);
+        }
+    }
+
+    if (replaced)
+    {
+        if (userConfigurableArguments->verbosity > 1)
+            log(fmt("replacing unsent frame of %s.%s\n", replaced->getDevice().c_str(), replaced->getName().c_str()));
+        replaced->release(this);
+    }
+
+    counters.msgsQueued++;
+
+    // Without BLOB, production is cheap and synchronous: have it ready for gathered writes
+    if (!isHead && !serialized->hasBlobs())
+        serialized->requestContent(MsgChunckIterator());
 
     // Register for client write
-    updateIos();
+    if (worker && isHead)
+        kickHeadMsg();
+    else
+        updateIos();
 }
 
 void MsgQueue::updateIos()
 {
+    if (worker && !worker->isCurrentThread())
+    {
+        worker->post([this]()
+        {
+            updateIos();
+        });
+        return;
+    }
+
     if (wFd != -1)
     {
-        if (msgq.empty() || !msgq.front()->requestContent(nsent))
+        auto mp = headMsg();
+        // Production is only ever started from the main loop
+        bool ready = (mp != nullptr) && (worker ? mp->hasContent(nsent) : mp->requestContent(nsent));
+        // Over budget, rateTimer restarts writing. In flight, the completion does
+        if (!ready || rateTimer.is_active() || writeOp.inFlight)
         {
             wio.stop();
         }
@@ -371,7 +936,7 @@ void MsgQueue::updateIos()
 
 void MsgQueue::messageMayHaveProgressed(const SerializedMsg * msg)
 {
-    if ((!msgq.empty()) && (msgq.front() == msg))
+    if (headMsg() == msg)
     {
         updateIos();
     }
@@ -379,16 +944,27 @@ void MsgQueue::messageMayHaveProgressed(const SerializedMsg * msg)
 
 void MsgQueue::clearMsgQueue()
 {
+    // The kernel must be done with the chunks before they are released
+    cancelWrite();
     nsent.reset();
 
-    auto queueCopy = msgq;
+    Lane queueCopy;
+    {
+        std::lock_guard<std::mutex> guard(msgqLock);
+        if (sending)
+            queueCopy.push_back(sending);
+        sending = nullptr;
+        queueCopy.splice(queueCopy.end(), controlq);
+        queueCopy.splice(queueCopy.end(), msgq);
+        queuedAt.clear();
+    }
     for(auto mp : queueCopy)
     {
-        mp->release(this);
+        releaseMsg(mp);
     }
-    msgq.clear();
 
     // Cancel io write events
+    rateTimer.stop();
     updateIos();
     wio.stop();
 }
@@ -397,10 +973,19 @@ unsigned long MsgQueue::msgQSize() const
 {
     unsigned long l = 0;
 
-    for (auto mp : msgq)
+    std::lock_guard<std::mutex> guard(msgqLock);
+    if (sending)
     {
         l += sizeof(Msg);
-        l += mp->queueSize();
+        l += sending->queueSize();
+    }
+    for (auto lane : {&controlq, &msgq})
+    {
+        for (auto mp : *lane)
+        {
+            l += sizeof(Msg);
+            l += mp->queueSize();
+        }
     }
 
     return (l);
@@ -419,7 +1004,7 @@ void MsgQueue::ioCb(ev::io &, int revents)
         if (sockErrno)
         {
             log(fmt("Communication error: %s\n", strerror(sockErrno)));
-            close();
+            requestClose();
             return;
         }
     }
@@ -436,7 +1021,7 @@ size_t MsgQueue::doRead(char * buf, size_t nr)
     if (!useSharedBuffer)
     {
         /* read client - works for all kinds of fds incl pipe*/
-        return read(rFd, buf, sizeof(buf));
+        return read(rFd, buf, nr);
     }
     else
     {
@@ -491,6 +1076,7 @@ size_t MsgQueue::doRead(char * buf, size_t nr)
                     fcntl(fds[i], F_SETFD, FD_CLOEXEC);
 #endif
                     incomingSharedBuffers.push_back(fds[i]);
+                    counters.sharedBuffersReceived++;
                 }
             }
             else
@@ -502,36 +1088,149 @@ size_t MsgQueue::doRead(char * buf, size_t nr)
     }
 }
 
-void MsgQueue::readFromFd()
+bool MsgQueue::readFromFd()
 {
-    char buf[maxReadBufferLength];
+    /* Within a BLOB, read as much of it as announced at once so it takes a few large copies
+     * instead of thousands of small reads. Back to the small buffer for the next messages */
+    size_t len = std::min<size_t>(std::max<size_t>(pendingContentLilXML(lp), maxReadBufferLength),
+                                  maxBlobReadBufferLength);
+    if (readBuffer.size() < len)
+        readBuffer.resize(len);
+    else if (len == maxReadBufferLength && readBuffer.size() > len)
+        std::vector<char>(len).swap(readBuffer);
+
+    char * buf = readBuffer.data();
     ssize_t nr;
 
     /* read client */
-    nr = doRead(buf, sizeof(buf));
+    nr = doRead(buf, len);
     if (nr <= 0)
     {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
 
         if (nr < 0)
             log(fmt("read: %s\n", strerror(errno)));
         else if (userConfigurableArguments->verbosity > 0)
             log(fmt("read EOF\n"));
-        close();
-        return;
+
+        // What the driver wrote before leaving
+        if (ring != nullptr && !readingRing)
+        {
+            auto hb = heartBeat();
+            readFromRing(0);
+            if (!hb.alive())
+                return false;
+        }
+        requestClose();
+        return false;
+    }
+
+    counters.bytesReceived += nr;
+
+    return processInput(buf, nr);
+}
+
+bool MsgQueue::processInput(char * buf, size_t nr)
+{
+    return processXml(buf, nr);
+}
+
+bool MsgQueue::processXml(char * buf, size_t nr)
+{
+    return processChunk(lp, buf, nr);
+}
+
+void MsgQueue::ringCb(ev::io &, int revents)
+{
+    if (revents & EV_READ)
+    {
+        IDSharedRingClearReadFd(ring);
+        if (readFromRing(1))
+        {
+            // Like a socket, one buffer per wake up. The clients get served in between
+            IDSharedRingWakeReader(ring);
+        }
+    }
+}
+
+bool MsgQueue::readFromRing(int maxChunks)
+{
+    char buf[maxReadBufferLength];
+    auto hb = heartBeat();
+
+    readingRing = true;
+    for (int chunk = 0; maxChunks == 0 || chunk < maxChunks; chunk++)
+    {
+        size_t nr = IDSharedRingRead(ring, buf, sizeof(buf));
+        if (nr == 0)
+        {
+            readingRing = false;
+            return false;
+        }
+
+        // The fds of the attached buffers were sent before the messages were written
+        while (rFd != -1 && counters.sharedBuffersReceived < IDSharedRingGetFdCount(ring))
+        {
+            if (!readFromFd())
+                break;
+        }
+        if (!hb.alive())
+            return false;
+
+        counters.bytesReceived += nr;
+        if (!processChunk(ringLp, buf, nr))
+            return false;
     }
+    readingRing = false;
+    return true;
+}
 
+bool MsgQueue::processChunk(LilXML * parser, char * buf, size_t nr)
+{
     /* process XML chunk */
     char err[1024];
-    XMLEle **nodes = parseXMLChunk(lp, buf, nr, err);
+#ifdef ENABLE_INDI_SHARED_MEMORY
+    setBlobDecodeLilXML(parser, decodeInlineBlobs ? IDSharedBlobRealloc : nullptr, IDSharedBlobFree);
+#endif
+    XMLEle **nodes = parseXMLChunk(parser, buf, nr, err);
     if (!nodes)
     {
         log(fmt("XML error: %s\n", err));
-        log(fmt("XML read: %.*s\n", (int)nr, buf));
-        close();
-        return;
+        log(fmt("XML read: %.*s\n", (int)std::min<size_t>(nr, maxReadBufferLength), buf));
+        requestClose();
+        return false;
     }
 
+    if (worker)
+    {
+        // Routing is done from the main loop. Shared buffers travel along the nodes
+        auto hb = heartBeat();
+        std::list<int> fds;
+        fds.swap(incomingSharedBuffers);
+        IoWorker::postToMainLoop([this, hb, nodes, fds]() mutable
+        {
+            if (hb.alive())
+            {
+                routedSharedBuffers.splice(routedSharedBuffers.end(), fds);
+                processNodes(nodes, routedSharedBuffers);
+                return;
+            }
+            for (int inode = 0; nodes[inode]; ++inode)
+                delXMLEle(nodes[inode]);
+            free(nodes);
+            for (auto fd : fds)
+                ::close(fd);
+        });
+        return true;
+    }
+
+    auto hb = heartBeat();
+    processNodes(nodes, incomingSharedBuffers);
+    return hb.alive();
+}
+
+void MsgQueue::processNodes(XMLEle **nodes, std::list<int> &sharedBuffers)
+{
     int inode = 0;
 
     XMLEle *root = nodes[inode];
@@ -549,7 +1248,8 @@ void MsgQueue::readFromFd()
                         tagXMLEle(root), findXMLAttValu(root, "device"), findXMLAttValu(root, "name")));
             }
 
-            onMessage(root, incomingSharedBuffers);
+            counters.msgsReceived++;
+            onMessage(root, sharedBuffers);
         }
         else
         {
@@ -21,23 +21,50 @@
 #include "lilxml.h"
 #include "Collectable.hpp"
 #include "MsgChunckIterator.hpp"
+#include "Metrics.hpp"
+#include "IoUring.hpp"
+#include "Pool.hpp"
 #include "indicore/indidevapi.h"
 
 #include <ev++.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <list>
+#include <mutex>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 class SerializedMsg;
 class Msg;
+class IoWorker;
+struct shared_ring;
 
 class MsgQueue: public Collectable
 {
+    public:
+        /* TCP options of network queues, for what they carry */
+        enum SocketProfile
+        {
+            NoProfile,          /* Local socket or pipe, nothing to tune */
+            ControlProfile,     /* Small messages go without delay (TCP_NODELAY) */
+            BulkProfile         /* Also BLOBs: large send buffer, and corked while one goes out */
+        };
+
+    private:
         static constexpr unsigned maxFDPerMessage {16}; /* No more than 16 buffer attached to a message */
         static constexpr unsigned maxReadBufferLength {49152};
+        static constexpr unsigned maxBlobReadBufferLength {8388608}; /* Per read, within a large BLOB */
         static constexpr unsigned maxWriteBufferLength {49152};
+        static constexpr int maxIovPerWrite {64};       /* Chunks gathered in a single write, well below IOV_MAX */
+        static constexpr unsigned maxFileWriteLength {1048576}; /* Per write of a file chunk */
 
         int rFd, wFd;
         LilXML * lp;         /* XML parsing context */
+        std::vector<char> readBuffer;   /* Grows while a large BLOB comes in, see readFromFd */
         ev::io   rio, wio;   /* Event loop io events */
         void ioCb(ev::io &watcher, int revents);
 
@@ -46,24 +73,119 @@ class MsgQueue: public Collectable
 
         std::set<SerializedMsg*> readBlocker;     /* The message that block this queue */
 
-        std::list<SerializedMsg*> msgq;           /* To send msg queue */
+        /* Messages are written one after the other, never interleaved. At message boundaries,
+         * the control lane is served first so small updates don't wait behind queued BLOBs.
+         * A message stays in msgq if it must follow a queued BLOB of the same device/property.
+         */
+        SerializedMsg * sending {nullptr};        /* Message being sent, nsent is the position within */
+        typedef std::list<SerializedMsg*, PoolAllocator<SerializedMsg*>> Lane;
+        Lane msgq;                                /* To send msg queue: BLOBs and what must follow them */
+        Lane controlq;                            /* To send msg queue: priority lane */
+        mutable std::mutex msgqLock;              /* Guards the queues and wFd when io runs on a worker */
         std::list<int> incomingSharedBuffers; /* During reception, fds accumulate here */
+        std::list<int> routedSharedBuffers;   /* fds received by a worker, waiting for routing */
+
+        IoWorker * worker {nullptr};              /* Loop doing the io, or nullptr for the main loop */
+
+        QueueCounters counters;
+        /* When queued messages were pushed, until their first byte is sent. Guarded by msgqLock */
+        std::unordered_map<const SerializedMsg *, std::chrono::steady_clock::time_point, std::hash<const SerializedMsg *>,
+            std::equal_to<const SerializedMsg *>,
+            PoolAllocator<std::pair<const SerializedMsg * const, std::chrono::steady_clock::time_point>>> queuedAt;
 
         // Position in the head message
         MsgChunckIterator nsent;
 
+        /* Send budget, see setSendRate: a bucket of sendTokens bytes refilled at sendRate bytes/s */
+        double sendRate {0};
+        double sendTokens {0};
+        std::chrono::steady_clock::time_point sendRefill;
+        ev::timer rateTimer;              /* Writing resumes when the bucket has refilled */
+        void rateCb(ev::timer &watcher, int revents);
+
+        /* bytes the budget allows in the next write, at most max. 0 if writing waits for rateTimer */
+        size_t sendAllowance(size_t max);
+
+        /* TCP options of wFd, see setSocketProfile. From the io loop */
+        SocketProfile socketProfile {NoProfile};
+        bool corked {false};              /* TCP_CORK set while a BLOB takes several writes */
+        void setCork(bool cork);
+
+        /* Local driver writing its messages to shared memory, see setRing */
+        shared_ring * ring {nullptr};
+        LilXML * ringLp {nullptr};        /* XML parsing context of the ring, apart from the socket one */
+        ev::io ringio;                    /* Data written while the ring was empty */
+        bool readingRing {false};
+        void ringCb(ev::io &watcher, int revents);
+
         // Handle fifo or socket case
         size_t doRead(char * buff, size_t len);
-        void readFromFd();
+        /* return true if something was read and this queue is still alive */
+        bool readFromFd();
+
+        /* read up to maxChunks buffers from the ring, or until empty if 0, along with the fds sent on
+         * the socket for its messages. return true if the ring may have more and this queue is still alive */
+        bool readFromRing(int maxChunks);
+
+        /* parse a chunk of the given context and handle the messages. return true if still alive */
+        bool processChunk(LilXML * parser, char * buf, size_t nr);
 
-        /* write the next chunk of the current message in the queue to the given
-         * client. pop message from queue when complete and free the message if we are
-         * the last one to use it. shut down this client if trouble.
+        /* hand the parsed nodes to onMessage, then free them */
+        void processNodes(XMLEle **nodes, std::list<int> &sharedBuffers);
+
+        /* start production of the head message then refresh the ios. From main loop */
+        void kickHeadMsg();
+
+        /* release the given message. From the io loop, this is delegated to the main loop */
+        void releaseMsg(SerializedMsg * mp);
+
+        /* true if mp must not overtake the messages of msgq. msgqLock must be held */
+        bool mustFollowBlobs(const SerializedMsg * mp) const;
+
+        /* account the delay until the first byte of mp was written */
+        void recordFirstByte(const SerializedMsg * mp);
+
+        /* remove the next message to send from the lanes, or nullptr. msgqLock must be held.
+         * When given, expected is taken instead if it is still at the front of a lane */
+        SerializedMsg * popNextMsg(SerializedMsg * expected = nullptr);
+
+        /* the queued messages after the current one, in sending order if nothing gets pushed */
+        std::vector<SerializedMsg *> upcomingMsgs(size_t count) const;
+
+        /* write the ready chunks of the current message and of the following ones to the given
+         * client, in a single writev/sendmsg. pop messages from queue when complete and free them
+         * if we are the last one to use them. shut down this client if trouble.
          */
         void writeToFd();
 
+        /* write the head file chunk of mp, whose nsend bytes are left, from its fd */
+        void writeFileChunk(SerializedMsg * mp, ssize_t nsend);
+
+        /* The chunks gathered by writeToFd. With an io_uring, they stay in place until the write completes */
+        struct iovec iov[maxIovPerWrite];
+        SerializedMsg * iovMsg[maxIovPerWrite];
+        int iovCount {0};
+        size_t iovFdCount {0};
+        struct msghdr writeMsgh;
+        char writeControl[CMSG_SPACE(maxFDPerMessage * sizeof(int))];
+
+        /* account nw bytes written from the gathered chunks. On error, nw is -1 and errno is set */
+        void wrote(ssize_t nw);
+
+        /* Writes go through the ring of the loop doing the io, when enabled. See IoUring */
+        IoUring * uring {nullptr};
+        IoUring::Op writeOp;
+        void writeCompleted(int res);
+        /* wait until an in flight write is done with the chunks */
+        void cancelWrite();
+
     protected:
         bool useSharedBuffer;
+        /* A queued stream frame is replaced by a newer one of the same property. Set by the reading side */
+        std::atomic<bool> latestFrameWins {false};
+        /* Decode inline BLOBs to shared buffers while reading, see Msg::fetchBlobs. Set from the main loop */
+        std::atomic<bool> decodeInlineBlobs {false};
+        bool encodedNumbers {false};    /* Peer announced numbers='ieee754' in a getProperties */
         int getRFd() const
         {
             return rFd;
@@ -82,6 +204,26 @@ class MsgQueue: public Collectable
         /* Close the writing part of the connection. By default, shutdown the write part, but keep on reading. May delete this */
         virtual void closeWritePart();
 
+        /* close() from the loop doing the io. When that's a worker, close is deferred to the main loop */
+        void requestClose();
+
+        /* serve the io of this queue from the given worker loop. Must be called before setFds */
+        void attachWorker(IoWorker * worker);
+
+        /* stop io on the worker, close the fds and unpin. No-op without worker */
+        void detachWorker();
+
+        /* read messages from the given ring too, and free it along with the queue. From the main loop.
+         * The fds of shared buffers still come from rFd, counted in the ring before the messages
+         * that refer to them */
+        void setRing(shared_ring * ring);
+
+        /* handle what was read from rFd. By default it is xml. return true if this queue is still alive */
+        virtual bool processInput(char * buf, size_t nr);
+
+        /* parse xml read from rFd and handle the messages. return true if still alive */
+        bool processXml(char * buf, size_t nr);
+
         /* Handle a message. root will be freed by caller. fds of buffers will be closed, unless set to -1 */
         virtual void onMessage(XMLEle *root, std::list<int> &sharedBuffers) = 0;
 
@@ -99,8 +241,14 @@ class MsgQueue: public Collectable
         /* return storage size of all Msqs on the given q */
         unsigned long msgQSize() const;
 
+        const QueueCounters &getCounters() const
+        {
+            return counters;
+        }
+
         SerializedMsg * headMsg() const;
-        void consumeHeadMsg();
+        /* pop the current message. next, when known, is the message that must follow */
+        void consumeHeadMsg(SerializedMsg * next = nullptr);
 
         /* Remove all messages from queue */
         void clearMsgQueue();
@@ -109,10 +257,43 @@ class MsgQueue: public Collectable
 
         void setFds(int rFd, int wFd);
 
+        /* write at most bytesPerSecond to this queue, 0 for no limit. From the main loop.
+         * Each writable queue of a loop writes one chunk per loop iteration, so queues are served
+         * in turn and those over their budget leave the link to the others */
+        void setSendRate(double bytesPerSecond);
+
+        /* tune the TCP options of wFd. From the main loop. A bulk queue getting back to control
+         * keeps its send buffer and unsent low water mark, see CommandLineArgs::notSentLowatKB */
+        void setSocketProfile(SocketProfile profile);
+
         virtual bool acceptSharedBuffers() const
         {
             return useSharedBuffer;
         }
 
+        /* inline BLOBs may be compressed for this queue. Shared buffers take precedence */
+        virtual bool acceptCompressedBlobs() const
+        {
+            return false;
+        }
+
+        /* shared buffers may be sent raw, see SerializedMsgWithBinaryBlobs. Takes precedence over compression */
+        virtual bool acceptBinaryBlobs() const
+        {
+            return false;
+        }
+
+        /* every message is sent in web socket frames, see SerializedMsgWithWebSocketFrames. Takes precedence */
+        virtual bool acceptWebSocketFrames() const
+        {
+            return false;
+        }
+
+        /* setNumberVector may be sent with encoding='ieee754' values */
+        bool acceptEncodedNumbers() const
+        {
+            return encodedNumbers;
+        }
+
         virtual void log(const std::string &log) const;
 };
\ No newline at end of file
@@ -0,0 +1,203 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "PluginDvrInfo.hpp"
+#include "Utils.hpp"
+#include "Msg.hpp"
+#include "Constants.hpp"
+#include "CommandLineArgs.hpp"
+#include "StartupReport.hpp"
+
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::map<std::string, PluginDvrInfo::Plugin> PluginDvrInfo::plugins;
+
+PluginDvrInfo::PluginDvrInfo(): DvrInfo(true)
+{
+    joinPoll.set<PluginDvrInfo, &PluginDvrInfo::onJoinPoll>(this);
+}
+
+PluginDvrInfo::PluginDvrInfo(const PluginDvrInfo &model): DvrInfo(model)
+{
+    joinPoll.set<PluginDvrInfo, &PluginDvrInfo::onJoinPoll>(this);
+    if (keepsDevicesOnRestart())
+    {
+        dev   = model.dev;
+        cache = model.cache;
+    }
+}
+
+PluginDvrInfo::~PluginDvrInfo()
+{
+    /* still waiting for the previous thread */
+    if (pluginFd != -1)
+        ::close(pluginFd);
+}
+
+PluginDvrInfo * PluginDvrInfo::clone() const
+{
+    return new PluginDvrInfo(*this);
+}
+
+bool PluginDvrInfo::keepsDevicesOnRestart() const
+{
+    return userConfigurableArguments->warmRestart;
+}
+
+bool PluginDvrInfo::isPlugin(const std::string &entry)
+{
+    static const std::string suffix(".so");
+    return entry.size() > suffix.size() && entry.compare(entry.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool PluginDvrInfo::load(Plugin &plugin)
+{
+    if (plugin.handle != nullptr)
+        return true;
+
+#ifdef LM_ID_NEWLM
+    /* bare names are looked for where plugins are installed, then as dlopen does */
+    std::string path = name;
+#ifdef INDI_PLUGIN_DIR
+    if (name.find('/') == std::string::npos && access((INDI_PLUGIN_DIR "/" + name).c_str(), R_OK) == 0)
+        path = INDI_PLUGIN_DIR "/" + name;
+#endif
+
+    plugin.handle = dlmopen(LM_ID_NEWLM, path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (plugin.handle == nullptr)
+    {
+        log(fmt("dlmopen: %s\n", dlerror()));
+        return false;
+    }
+
+    /* libindidriver's own, in the link map of the plugin */
+    plugin.main = reinterpret_cast<int (*)(int, const char *)>(dlsym(plugin.handle, "IDPluginMain"));
+    if (plugin.main == nullptr)
+    {
+        log(fmt("%s is not an INDI driver plugin: %s\n", path.c_str(), dlerror()));
+        dlclose(plugin.handle);
+        plugin.handle = nullptr;
+        return false;
+    }
+    return true;
+#else
+    log("driver plugins need dlmopen, not available here\n");
+    return false;
+#endif
+}
+
+/* start the thread of the plugin. When it can't run, its end of the socket is closed: the server
+ * sees it as a driver that exited, and restarts it as usual
+ */
+void PluginDvrInfo::start()
+{
+    int ux[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ux) == -1)
+    {
+        log(fmt("socketpair: %s\n", strerror(errno)));
+        Bye();
+    }
+    setFds(ux[1], ux[1]);
+    pluginFd = ux[0];
+
+    auto &plugin = plugins[name];
+
+    /* one thread at a time in a link map: the previous one ends once it sees its socket closed.
+     * Meanwhile the messages for the next one wait in the socket */
+    if (plugin.thread.joinable() && plugin.done.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        joinDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(stopDelay);
+        joinPoll.start(joinPollDelay, joinPollDelay);
+    }
+    else
+    {
+        run(plugin);
+    }
+
+    if (userConfigurableArguments->verbosity > 0)
+        log(fmt("plugin rfd=%d wfd=%d\n", ux[1], ux[1]));
+
+    XMLEle *root = addXMLEle(NULL, "getProperties");
+    addXMLAtt(root, "version", TO_STRING(INDIV));
+    addXMLAtt(root, "numbers", "ieee754");
+    addXMLAtt(root, "blobs", "attached");
+    Msg *mp = new Msg(nullptr, root);
+
+    startResync();
+
+    StartupReport::track(this);
+
+    // pushmsg can kill this
+    auto hb = heartBeat();
+    pushMsg(mp);
+    if (hb.alive())
+        askAnswered("");
+}
+
+void PluginDvrInfo::onJoinPoll(ev::timer &, int)
+{
+    auto &plugin = plugins[name];
+
+    if (plugin.done.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        joinPoll.stop();
+        run(plugin);
+    }
+    else if (std::chrono::steady_clock::now() >= joinDeadline)
+    {
+        joinPoll.stop();
+        log("previous instance still running\n");
+        ::close(pluginFd);
+        pluginFd = -1;
+    }
+}
+
+void PluginDvrInfo::run(Plugin &plugin)
+{
+    if (plugin.thread.joinable())
+        plugin.thread.join();
+
+    if (load(plugin))
+    {
+        std::promise<void> done;
+        plugin.done = done.get_future();
+        plugin.thread = std::thread([main = plugin.main, fd = pluginFd, name = name, done = std::move(done)]() mutable
+        {
+            main(fd, name.c_str());
+            done.set_value();
+        });
+    }
+    else
+    {
+        ::close(pluginFd);
+    }
+    pluginFd = -1;
+}
+
+void PluginDvrInfo::onMessage(XMLEle *root, std::list<int> &sharedBuffers)
+{
+    root = updateCache(root);
+    if (root == nullptr)
+        return;
+
+    DvrInfo::onMessage(root, sharedBuffers);
+}
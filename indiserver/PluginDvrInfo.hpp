@@ -0,0 +1,94 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include "DvrInfo.hpp"
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <string>
+#include <thread>
+
+/* A driver built as a shared library, run by a thread of the server instead of a process of its own.
+ * Each one is loaded with dlmopen in a link map of its own, with its own copy of libindidriver and of
+ * everything it links: its event loop, its devices and their state do not meet those of other plugins.
+ * It is served on a socket pair like a local driver, so clients, snoopers and shared buffers see no
+ * difference. Its stderr is the server's, and a driver that crashes or exits takes the server along.
+ */
+class PluginDvrInfo: public DvrInfo
+{
+        /* how long a restart waits for the previous thread to see its socket closed, in seconds */
+        static constexpr int stopDelay {2};
+        /* how often the event loop checks meanwhile, in seconds */
+        static constexpr double joinPollDelay {0.05};
+
+        struct Plugin
+        {
+            void *handle {nullptr};
+            int (*main)(int fd, const char *name) {nullptr};
+            std::thread thread;
+            std::future<void> done;
+        };
+        /* loaded once by name, they stay loaded: a restart serves the same link map again */
+        static std::map<std::string, Plugin> plugins;
+
+        /* load the plugin, or log why not. return false if it is not loaded */
+        bool load(Plugin &plugin);
+
+        /* the plugin's end of the socket, until its thread is started on it */
+        int pluginFd {-1};
+        std::chrono::steady_clock::time_point joinDeadline;
+        ev::timer joinPoll;
+
+        /* join the previous thread once it has ended, without holding the event loop */
+        void onJoinPoll(ev::timer &watcher, int revents);
+
+        /* start the thread on pluginFd, or close it */
+        void run(Plugin &plugin);
+
+    protected:
+        PluginDvrInfo(const PluginDvrInfo &model);
+
+        /* keep track of the properties defined, then route what clients do not know yet */
+        void onMessage(XMLEle *root, std::list<int> &sharedBuffers) override;
+
+    public:
+        PluginDvrInfo();
+        ~PluginDvrInfo() override;
+
+        void start() override;
+
+        PluginDvrInfo * clone() const override;
+
+        bool keepsDevicesOnRestart() const override;
+
+        bool pingsFollowMessages() const override
+        {
+            return true;
+        }
+
+        const std::string remoteServerUid() const override
+        {
+            return "";
+        }
+
+        /* true if the driver entry names a plugin, like indi_simulator_ccd.so */
+        static bool isPlugin(const std::string &entry);
+};
@@ -0,0 +1,124 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/* Free lists of memory blocks, by block size. Freed blocks are kept for reuse,
+ * up to maxFreeBlocks per size, so the blocks of a steady flow of messages come from the lists.
+ * May be used from any thread.
+ */
+class BlockPool
+{
+        static constexpr size_t maxFreeBlocks {4096};
+
+        struct FreeList
+        {
+            size_t size;
+            std::vector<void*> blocks;
+        };
+
+        std::mutex lock;
+        std::vector<FreeList> lists;    /* One per block size seen. There are only a few */
+
+        FreeList &listFor(size_t size);
+
+    public:
+        void * allocate(size_t size);
+        void release(void * ptr, size_t size);
+};
+
+/* Derive T from Pooled<T> to have new/delete of T reuse memory from a BlockPool.
+ * Subclasses of T share the pool: their destructor must be virtual, so the right size is released.
+ */
+template<class T>
+class Pooled
+{
+        static BlockPool &pool()
+        {
+            // Never destroyed: objects may be freed late during exit
+            static BlockPool * instance = new BlockPool();
+            return *instance;
+        }
+
+    public:
+        static void * operator new(std::size_t size)
+        {
+            return pool().allocate(size);
+        }
+
+        static void operator delete(void * ptr, std::size_t size)
+        {
+            pool().release(ptr, size);
+        }
+};
+
+/* The pool of the containers filled and emptied with each message */
+inline BlockPool &containerPool()
+{
+    // Never destroyed, as the pools of Pooled
+    static BlockPool * instance = new BlockPool();
+    return *instance;
+}
+
+/* Allocator for std containers taking their memory from containerPool: the nodes of lists, sets and
+ * maps, and the storage of small vectors. Larger blocks come from the heap.
+ */
+template<class T>
+class PoolAllocator
+{
+        static constexpr std::size_t maxPooledSize {4096};
+
+    public:
+        using value_type = T;
+
+        PoolAllocator() = default;
+
+        template<class U>
+        PoolAllocator(const PoolAllocator<U> &) {}
+
+        T * allocate(std::size_t n)
+        {
+            std::size_t size = n * sizeof(T);
+            return static_cast<T*>(size <= maxPooledSize ? containerPool().allocate(size) : ::operator new(size));
+        }
+
+        void deallocate(T * ptr, std::size_t n)
+        {
+            std::size_t size = n * sizeof(T);
+            if (size <= maxPooledSize)
+                containerPool().release(ptr, size);
+            else
+                ::operator delete(ptr);
+        }
+
+        template<class U>
+        bool operator==(const PoolAllocator<U> &) const
+        {
+            return true;
+        }
+
+        template<class U>
+        bool operator!=(const PoolAllocator<U> &) const
+        {
+            return false;
+        }
+};
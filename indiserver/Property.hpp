@@ -20,7 +20,33 @@
 
 #include "indicore/indidevapi.h"
 
+#include <functional>
 #include <string>
+#include <utility>
+
+/* device + property name, as a key for routing indexes */
+typedef std::pair<std::string, std::string> PropertyKey;
+
+struct PropertyKeyHash
+{
+    size_t operator()(const PropertyKey &key) const
+    {
+        size_t h = std::hash<std::string>()(key.first);
+        return h ^ (std::hash<std::string>()(key.second) + 0x9e3779b9 + (h << 6) + (h >> 2));
+    }
+};
+
+/* remove id from the set stored under key, dropping the set once empty */
+template <class Index, class Key>
+void eraseFromIndex(Index &index, const Key &key, unsigned long id)
+{
+    auto it = index.find(key);
+    if (it == index.end())
+        return;
+    it->second.erase(id);
+    if (it->second.empty())
+        index.erase(it);
+}
 
 /* device + property name */
 class Property
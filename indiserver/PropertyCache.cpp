@@ -0,0 +1,302 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "PropertyCache.hpp"
+#include "indicom.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/* attributes a set message may change */
+static bool isValueAtt(const char *name)
+{
+    return !strcmp(name, "state") || !strcmp(name, "timeout") || !strcmp(name, "timestamp") || !strcmp(name, "message");
+}
+
+/* same attributes, leaving out those a set message may change if skipValues */
+static bool sameAtts(XMLEle *a, XMLEle *b, bool skipValues)
+{
+    int count = 0;
+    for (XMLAtt *ap = nextXMLAtt(a, 1); ap; ap = nextXMLAtt(a, 0))
+    {
+        if (skipValues && isValueAtt(nameXMLAtt(ap)))
+            continue;
+        XMLAtt *bp = findXMLAtt(b, nameXMLAtt(ap));
+        if (!bp || strcmp(valuXMLAtt(ap), valuXMLAtt(bp)))
+            return false;
+        count++;
+    }
+    for (XMLAtt *bp = nextXMLAtt(b, 1); bp; bp = nextXMLAtt(b, 0))
+    {
+        if (!skipValues || !isValueAtt(nameXMLAtt(bp)))
+            count--;
+    }
+    return count == 0;
+}
+
+/* same property and elements, values left out */
+static bool sameStructure(XMLEle *a, XMLEle *b)
+{
+    if (strcmp(tagXMLEle(a), tagXMLEle(b)) || !sameAtts(a, b, true) || nXMLEle(a) != nXMLEle(b))
+        return false;
+
+    for (XMLEle *ca = nextXMLEle(a, 1), *cb = nextXMLEle(b, 1); ca && cb; ca = nextXMLEle(a, 0), cb = nextXMLEle(b, 0))
+    {
+        if (strcmp(tagXMLEle(ca), tagXMLEle(cb)) || !sameAtts(ca, cb, false))
+            return false;
+    }
+    return true;
+}
+
+/* same values, for two definitions of the same structure */
+static bool sameValues(XMLEle *a, XMLEle *b)
+{
+    if (strcmp(findXMLAttValu(a, "state"), findXMLAttValu(b, "state"))
+            || strcmp(findXMLAttValu(a, "timeout"), findXMLAttValu(b, "timeout")))
+        return false;
+
+    for (XMLEle *ca = nextXMLEle(a, 1), *cb = nextXMLEle(b, 1); ca && cb; ca = nextXMLEle(a, 0), cb = nextXMLEle(b, 0))
+    {
+        /* numbers written again may differ in text only */
+        if (!strcmp(tagXMLEle(ca), "defNumber"))
+        {
+            if (strtod(pcdataXMLEle(ca), nullptr) != strtod(pcdataXMLEle(cb), nullptr))
+                return false;
+        }
+        else if (strcmp(pcdataXMLEle(ca), pcdataXMLEle(cb)))
+            return false;
+    }
+    return true;
+}
+
+/* the set message bringing the values of a definition */
+static XMLEle *setFromDef(XMLEle *def)
+{
+    std::string tag = std::string("set") + (tagXMLEle(def) + 3);
+    XMLEle *root = addXMLEle(nullptr, tag.c_str());
+
+    for (const char *name : {"device", "name", "state", "timeout", "timestamp", "message"})
+    {
+        XMLAtt *ap = findXMLAtt(def, name);
+        if (ap)
+            addXMLAtt(root, name, valuXMLAtt(ap));
+    }
+
+    /* BLOBs are not defined with a content */
+    if (!strcmp(tagXMLEle(def), "defBLOBVector"))
+        return root;
+
+    for (XMLEle *ep = nextXMLEle(def, 1); ep; ep = nextXMLEle(def, 0))
+    {
+        std::string childTag = std::string("one") + (tagXMLEle(ep) + 3);
+        XMLEle *child = addXMLEle(root, childTag.c_str());
+        addXMLAtt(child, "name", findXMLAttValu(ep, "name"));
+        editXMLEle(child, pcdataXMLEle(ep));
+    }
+    return root;
+}
+
+PropertyCache::~PropertyCache()
+{
+    for (auto &entry : defs)
+        delXMLEle(entry.second.root);
+}
+
+void PropertyCache::store(const PropertyKey &key, XMLEle *root)
+{
+    auto it = defs.find(key);
+    if (it == defs.end())
+        it = defs.emplace(key, Definition{nullptr, ++lastSeq}).first;
+    else
+        delXMLEle(it->second.root);
+    it->second.root = cloneXMLEle(root, nullptr, nullptr);
+}
+
+void PropertyCache::applySet(XMLEle *def, XMLEle *root)
+{
+    for (const char *name : {"state", "timeout"})
+    {
+        XMLAtt *ap = findXMLAtt(root, name);
+        if (!ap)
+            continue;
+        XMLAtt *dp = findXMLAtt(def, name);
+        if (dp)
+            editXMLAtt(dp, valuXMLAtt(ap));
+        else
+            addXMLAtt(def, name, valuXMLAtt(ap));
+    }
+
+    /* BLOB contents are not kept, they are never defined again */
+    if (!strcmp(tagXMLEle(root), "setBLOBVector"))
+        return;
+
+    bool encoded = !strcmp(findXMLAttValu(root, "encoding"), "ieee754");
+    for (XMLEle *ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        const char *name = findXMLAttValu(ep, "name");
+        XMLEle *element = nullptr;
+        for (XMLEle *dp = nextXMLEle(def, 1); dp && !element; dp = nextXMLEle(def, 0))
+        {
+            if (!strcmp(findXMLAttValu(dp, "name"), name))
+                element = dp;
+        }
+        if (!element)
+            continue;
+
+        double value;
+        char buf[64];
+        if (encoded && !strcmp(tagXMLEle(ep), "oneNumber") && f_scanieee754(pcdataXMLEle(ep), &value) >= 0)
+        {
+            snprintf(buf, sizeof(buf), "%.20g", value);
+            editXMLEle(element, buf);
+        }
+        else
+            editXMLEle(element, pcdataXMLEle(ep));
+    }
+}
+
+XMLEle *PropertyCache::update(XMLEle *root, bool &redefine)
+{
+    const char *roottag = tagXMLEle(root);
+    PropertyKey key(findXMLAttValu(root, "device"), findXMLAttValu(root, "name"));
+    redefine = false;
+
+    if (!strcmp(roottag, "delProperty"))
+    {
+        for (auto it = defs.begin(); it != defs.end();)
+        {
+            if (it->first.first == key.first && (key.second.empty() || it->first.second == key.second))
+            {
+                delXMLEle(it->second.root);
+                it = defs.erase(it);
+            }
+            else
+                ++it;
+        }
+        return root;
+    }
+
+    if (!strncmp(roottag, "set", 3))
+    {
+        auto it = defs.find(key);
+        if (it != defs.end())
+            applySet(it->second.root, root);
+        return root;
+    }
+
+    if (strncmp(roottag, "def", 3))
+        return root;
+
+    XMLEle *result = root;
+    auto it = defs.find(key);
+    if (resyncing && it != defs.end())
+    {
+        redefined.insert(key);
+        if (!sameStructure(it->second.root, root))
+            redefine = true;
+        else if (sameValues(it->second.root, root))
+            result = nullptr;
+        else
+            result = setFromDef(root);
+    }
+    store(key, root);
+    return result;
+}
+
+std::vector<XMLEle *> PropertyCache::definitions(const std::string &dev, const std::string &name) const
+{
+    std::vector<const Definition *> found;
+    if (!dev.empty() && !name.empty())
+    {
+        auto it = defs.find(PropertyKey(dev, name));
+        if (it != defs.end())
+            found.push_back(&it->second);
+    }
+    else
+    {
+        for (auto &entry : defs)
+        {
+            if (dev.empty() || entry.first.first == dev)
+                found.push_back(&entry.second);
+        }
+        std::sort(found.begin(), found.end(), [](const Definition * a, const Definition * b)
+        {
+            return a->seq < b->seq;
+        });
+    }
+
+    std::vector<XMLEle *> result;
+    for (auto def : found)
+        result.push_back(def->root);
+    return result;
+}
+
+std::set<std::string> PropertyCache::devices() const
+{
+    std::set<std::string> result;
+    for (auto &entry : defs)
+        result.insert(entry.first.first);
+    return result;
+}
+
+void PropertyCache::answered(const std::string &dev)
+{
+    if (dev.empty())
+        answeredAll = true;
+    else
+        answeredDevices.insert(dev);
+}
+
+bool PropertyCache::isAnswered(const std::string &dev, const std::string &name) const
+{
+    if (!name.empty())
+        return name.compare(0, 5, "LAZY_") != 0 && defs.find(PropertyKey(dev, name)) != defs.end();
+
+    return answeredAll || (!dev.empty() && answeredDevices.count(dev));
+}
+
+bool PropertyCache::startResync()
+{
+    /* what was answered is to be answered again */
+    redefined.clear();
+    answeredAll = false;
+    answeredDevices.clear();
+    resyncing = !defs.empty();
+    return resyncing;
+}
+
+std::vector<PropertyKey> PropertyCache::endResync()
+{
+    std::vector<PropertyKey> vanished;
+    for (auto it = defs.begin(); it != defs.end();)
+    {
+        if (redefined.find(it->first) == redefined.end())
+        {
+            vanished.push_back(it->first);
+            delXMLEle(it->second.root);
+            it = defs.erase(it);
+        }
+        else
+            ++it;
+    }
+    redefined.clear();
+    resyncing = false;
+    return vanished;
+}
@@ -0,0 +1,92 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include "Property.hpp"
+#include "lilxml.h"
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Last known definition of each property of a driver, kept up to date with its set messages.
+ * Clients asking for properties the driver is known to have fully answered already are answered
+ * from it, without the driver being asked again.
+ * When the link to a remote server drops and its properties are requested again, the definitions
+ * it sends are checked against the cache so that clients only get what changed meanwhile.
+ */
+class PropertyCache
+{
+        struct Definition
+        {
+            XMLEle *root;
+            unsigned long seq;              /* definitions come back in the order they were made */
+        };
+
+        std::unordered_map<PropertyKey, Definition, PropertyKeyHash> defs;
+        std::set<PropertyKey> redefined;    /* defined again since startResync */
+        std::set<std::string> answeredDevices;  /* whose getProperties the driver answered in full */
+        bool answeredAll = false;           /* a getProperties of all devices was answered in full */
+        bool resyncing = false;
+        unsigned long lastSeq = 0;
+
+        void store(const PropertyKey &key, XMLEle *root);
+        void applySet(XMLEle *def, XMLEle *root);
+
+    public:
+        PropertyCache() = default;
+        PropertyCache(const PropertyCache &) = delete;
+        PropertyCache &operator=(const PropertyCache &) = delete;
+        ~PropertyCache();
+
+        /* record the message from the remote server and return what is to be forwarded instead:
+         * root itself, a set message when a definition only brings new values, or nullptr when
+         * it brings nothing new. redefine is set when clients must forget the property before
+         * root defines it again. The caller owns root and the message returned.
+         */
+        XMLEle *update(XMLEle *root, bool &redefine);
+
+        /* the definitions known for dev/name, of all its properties if name is empty and of all the
+         * devices if dev is empty, in definition order. The cache keeps them */
+        std::vector<XMLEle *> definitions(const std::string &dev, const std::string &name) const;
+
+        /* the driver is done answering a getProperties of dev, or of all devices if dev is empty */
+        void answered(const std::string &dev);
+
+        /* true if the definitions known hold the whole answer to a getProperties of dev/name: the
+         * property is defined and is not the stub of a lazy group, whose definition defines the group,
+         * or the driver answered in full a getProperties of dev or of all devices */
+        bool isAnswered(const std::string &dev, const std::string &name) const;
+
+        /* devices with known properties */
+        std::set<std::string> devices() const;
+
+        /* the properties are being requested again. return false if nothing is known yet */
+        bool startResync();
+
+        /* the remote server is done defining. return the properties it did not define again,
+         * which are forgotten */
+        std::vector<PropertyKey> endResync();
+
+        bool isResyncing() const
+        {
+            return resyncing;
+        }
+};
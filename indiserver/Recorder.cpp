@@ -0,0 +1,165 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Recorder.hpp"
+#include "Utils.hpp"
+#include "indicom.h"
+#include "indidevapi.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fnmatch.h>
+
+using namespace INDI::Telemetry;
+
+Recorder * Recorder::instance {nullptr};
+
+Recorder::Recorder()
+{
+    flush.set<Recorder, &Recorder::onFlush>(this);
+    sigint.set<Recorder, &Recorder::onSignal>(this);
+    sigterm.set<Recorder, &Recorder::onSignal>(this);
+}
+
+bool Recorder::start(const std::string &path, const std::string &selection)
+{
+    static Recorder recorder;
+
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!recorder.writer.open(path, now))
+    {
+        log(fmt("cannot record telemetry to %s: %s\n", path.c_str(), strerror(errno)));
+        return false;
+    }
+
+    size_t first = 0;
+    while (first < selection.size())
+    {
+        size_t last = selection.find(',', first);
+        if (last == std::string::npos)
+            last = selection.size();
+        if (last > first)
+            recorder.patterns.push_back(selection.substr(first, last - first));
+        first = last + 1;
+    }
+
+    /* what is pending is written before leaving as asked */
+    recorder.flush.start(flushPeriod, flushPeriod);
+    recorder.sigint.start(SIGINT);
+    recorder.sigterm.start(SIGTERM);
+
+    instance = &recorder;
+    return true;
+}
+
+void Recorder::onFlush(ev::timer &, int)
+{
+    writer.flush();
+}
+
+void Recorder::onSignal(ev::sig &watcher, int)
+{
+    writer.close();
+    signal(watcher.signum, SIG_DFL);
+    raise(watcher.signum);
+}
+
+bool Recorder::selected(const char *dev, const char *name, const char *element) const
+{
+    if (patterns.empty())
+        return true;
+
+    std::string property = std::string(dev) + "." + name;
+    std::string full = property + "." + element;
+    for (auto &pattern : patterns)
+    {
+        if (!fnmatch(pattern.c_str(), property.c_str(), 0) || !fnmatch(pattern.c_str(), full.c_str(), 0))
+            return true;
+    }
+    return false;
+}
+
+int64_t Recorder::channel(Kind kind, const char *dev, const char *name, const char *element)
+{
+    std::string key = std::string(dev) + '\0' + name + '\0' + element;
+    auto it = ids.find(key);
+    if (it != ids.end())
+        return it->second;
+
+    int64_t id = selected(dev, name, element) ? writer.channel(kind, dev, name, element) : -1;
+    ids.emplace(key, id);
+    return id;
+}
+
+void Recorder::record(XMLEle * root)
+{
+    if (instance == nullptr)
+        return;
+
+    const char *tag = tagXMLEle(root);
+    if (strncmp(tag, "set", 3) && strncmp(tag, "def", 3))
+        return;
+
+    Kind kind;
+    if (!strcmp(tag + 3, "NumberVector"))
+        kind = NUMBER;
+    else if (!strcmp(tag + 3, "SwitchVector"))
+        kind = SWITCH;
+    else if (!strcmp(tag + 3, "LightVector"))
+        kind = LIGHT;
+    else
+        return;
+
+    const char *dev  = findXMLAttValu(root, "device");
+    const char *name = findXMLAttValu(root, "name");
+    bool encoded = kind == NUMBER && !strcmp(findXMLAttValu(root, "encoding"), "ieee754");
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count();
+
+    for (auto ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        int64_t id = instance->channel(kind, dev, name, findXMLAttValu(ep, "name"));
+        if (id < 0)
+            continue;
+
+        const char *text = pcdataXMLEle(ep);
+        double value;
+        if (kind == NUMBER)
+        {
+            if ((encoded ? f_scanieee754(text, &value) : f_scansexa(text, &value)) < 0)
+                continue;
+        }
+        else if (kind == SWITCH)
+        {
+            ISState state;
+            if (crackISState(text, &state) < 0)
+                continue;
+            value = state;
+        }
+        else
+        {
+            IPState state;
+            if (crackIPState(text, &state) < 0)
+                continue;
+            value = state;
+        }
+        instance->writer.add(static_cast<uint32_t>(id), now, value);
+    }
+}
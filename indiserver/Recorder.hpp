@@ -0,0 +1,60 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include "lilxml.h"
+#include "telemetry.h"
+
+#include <ev++.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Records the values of the number, switch and light elements that drivers send to a
+ * telemetry file (see telemetry.h), as they are routed: one more consumer would cost as
+ * much work as a client. BLOBs and text are not recorded.
+ * Samples are kept per element and written in blocks, when full and every flushPeriod.
+ */
+class Recorder
+{
+        static constexpr double flushPeriod {1.0};      /* s */
+
+        INDI::Telemetry::Writer writer;
+        std::vector<std::string> patterns;              /* device.property[.element] globs, none for all */
+        std::unordered_map<std::string, int64_t> ids;   /* channel of each element seen, -1 when not recorded */
+        ev::timer flush;
+        ev::sig sigint, sigterm;
+
+        void onFlush(ev::timer &watcher, int revents);
+        void onSignal(ev::sig &watcher, int revents);
+        bool selected(const char *dev, const char *name, const char *element) const;
+        int64_t channel(INDI::Telemetry::Kind kind, const char *dev, const char *name, const char *element);
+
+        static Recorder * instance;
+
+    public:
+        Recorder();
+
+        /* start recording to path. selection is a comma separated list of globs, empty for everything */
+        static bool start(const std::string &path, const std::string &selection);
+
+        /* root was sent by a driver */
+        static void record(XMLEle * root);
+};
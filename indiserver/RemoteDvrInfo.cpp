@@ -17,18 +17,23 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "RemoteDvrInfo.hpp"
+#include "ClInfo.hpp"
 #include "Utils.hpp"
 #include "Constants.hpp"
 #include "Msg.hpp"
 #include "CommandLineArgs.hpp"
+#include "StartupReport.hpp"
 
 #include <cstdio>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 using namespace indiserver::constants;
 
-void RemoteDvrInfo::extractRemoteId(const std::string &name, std::string &o_host, int &o_port, std::string &o_dev) const
+void RemoteDvrInfo::extractRemoteId(const std::string &name, std::string &o_host, int &o_port, std::string &o_dev)
 {
     char dev[MAXINDIDEVICE] = {0};
     char host[maxStringBufferLength] = {0};
@@ -40,7 +45,7 @@ void RemoteDvrInfo::extractRemoteId(const std::string &name, std::string &o_host
         // Device missing? Try a different syntax for all devices
         if (sscanf(name.c_str(), "@%[^:]:%d", host, &indi_port) < 1)
         {
-            log(fmt("Bad remote device syntax: %s\n", name.c_str()));
+            ::log(fmt("Bad remote device syntax: %s\n", name.c_str()));
             Bye();
         }
     }
@@ -50,17 +55,131 @@ void RemoteDvrInfo::extractRemoteId(const std::string &name, std::string &o_host
     o_dev = dev;
 }
 
-/* start the given remote INDI driver connection.
+/* start the given remote device entry.
  * exit if trouble.
  */
+void RemoteDvrInfo::launch(const std::string &name)
+{
+    std::string host, device;
+    int port;
+    extractRemoteId(name, host, port, device);
+
+    /* devices of the same server share a connection. An entry for all its devices keeps its own */
+    if (!device.empty())
+    {
+        for (auto dp : drivers)
+        {
+            auto remote = dynamic_cast<RemoteDvrInfo *>(dp);
+            if (remote == nullptr || remote->remoteDevs.empty() || !remote->restart)
+                continue;
+
+            if (remote->host == host && remote->port == port)
+            {
+                remote->share(name, device);
+                return;
+            }
+        }
+    }
+
+    auto dp = new RemoteDvrInfo();
+    dp->name = name;
+    dp->start();
+}
+
+void RemoteDvrInfo::share(const std::string &entry, const std::string &device)
+{
+    names.insert(entry);
+    if (!remoteDevs.insert(device).second)
+        return;
+
+    if (userConfigurableArguments->verbosity > 0)
+        log(fmt("serving %s too\n", entry.c_str()));
+
+    /* N.B. storing name now is key to limiting outbound traffic to this
+     * dev.
+     */
+    dev.insert(device);
+
+    // pushmsg can kill this. do at end
+    requestProperties(device);
+}
+
+void RemoteDvrInfo::requestProperties(const std::string &device)
+{
+    /* Sending getProperties with device lets remote server limit its
+     * outbound (and our inbound) traffic on this socket to this device.
+     * "*" informs downstream server that it is connecting to an upstream server
+     * and not a regular client. The difference is in how it treats snooping properties
+     * among properties.
+     */
+    XMLEle *root = addXMLEle(NULL, "getProperties");
+    addXMLAtt(root, "device", device.c_str());
+    addXMLAtt(root, "version", TO_STRING(INDIV));
+    addXMLAtt(root, "numbers", "ieee754");
+    // BLOBs come raw and are kept so, base64 is only for the clients that need it
+    addXMLAtt(root, "binary", "true");
+
+    Msg *mp = new Msg(nullptr, root);
+
+    // pushmsg can kill this. do at end
+    pushMsg(mp);
+    mp->queuingDone();
+}
+
+/* start the given remote INDI driver connection.
+ * exit if trouble on the first start, try again later otherwise.
+ */
 void RemoteDvrInfo::start()
 {
-    int sockfd;
-    std::string dev;
-    extractRemoteId(name, host, port, dev);
+    if (names.empty())
+    {
+        std::string device;
+        extractRemoteId(name, host, port, device);
+        names.insert(name);
+        if (!device.empty())
+            remoteDevs.insert(device);
+    }
 
     /* connect */
-    sockfd = openINDIServer();
+    if (!openINDIServer())
+        unreachable();
+}
+
+void RemoteDvrInfo::unreachable()
+{
+    if (restarts == 0)
+        Bye();
+
+    /* clients keep the properties through a short outage only */
+    if (!dev.empty() && std::chrono::steady_clock::now() - lost > std::chrono::duration<double>(keepDelay))
+        dropDevices();
+
+    retry.start(retryDelay);
+}
+
+void RemoteDvrInfo::onConnecting(ev::io &watcher, int)
+{
+    int sockfd = watcher.fd;
+    watcher.stop();
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+        err = errno;
+    if (err != 0)
+    {
+        log(fmt("connect(%s,%d): %s\n", host.c_str(), port, strerror(err)));
+        ::close(sockfd);
+        unreachable();
+        return;
+    }
+
+    connected(sockfd);
+}
+
+void RemoteDvrInfo::connected(int sockfd)
+{
+    lost = std::chrono::steady_clock::time_point();
 
     /* record flag pid, io channels, init lp and snoop list */
 
@@ -72,83 +191,181 @@ void RemoteDvrInfo::start()
     /* N.B. storing name now is key to limiting outbound traffic to this
      * dev.
      */
-    if (!dev.empty())
-        this->dev.insert(dev);
+    dev.insert(remoteDevs.begin(), remoteDevs.end());
 
-    /* Sending getProperties with device lets remote server limit its
-     * outbound (and our inbound) traffic on this socket to this device.
-     */
-    XMLEle *root = addXMLEle(NULL, "getProperties");
+    /* the definitions sent again are checked against those clients know */
+    startResync();
+
+    StartupReport::track(this);
 
-    if (!dev.empty())
+    if (remoteDevs.empty())
     {
-        addXMLAtt(root, "device", dev.c_str());
-        addXMLAtt(root, "version", TO_STRING(INDIV));
+        // pushmsg can kill this. do at end
+        requestProperties("*");
+        return;
     }
-    else
+
+    auto hb = heartBeat();
+    std::set<std::string> devices = remoteDevs;
+    for (auto &device : devices)
     {
-        // This informs downstream server that it is connecting to an upstream server
-        // and not a regular client. The difference is in how it treats snooping properties
-        // among properties.
-        addXMLAtt(root, "device", "*");
-        addXMLAtt(root, "version", TO_STRING(INDIV));
+        requestProperties(device);
+        if (!hb.alive())
+            return;
     }
+}
 
-    Msg *mp = new Msg(nullptr, root);
+void RemoteDvrInfo::dropDevices()
+{
+    log("connection lost, dropping its devices\n");
 
-    // pushmsg can kill this. do at end
-    pushMsg(mp);
+    for (auto &device : dev)
+    {
+        XMLEle *root = addXMLEle(NULL, "delProperty");
+        addXMLAtt(root, "device", device.c_str());
+        Msg *mp = new Msg(this, root);
+
+        ClInfo::q2Clients(NULL, 0, device, "", mp, root);
+        mp->queuingDone();
+    }
+    dev.clear();
+
+    /* they will be defined from scratch */
+    cache = std::make_shared<PropertyCache>();
+}
+
+void RemoteDvrInfo::onRetry(ev::timer &, int)
+{
+    start();
+}
+
+void RemoteDvrInfo::onMessage(XMLEle *root, std::list<int> &sharedBuffers)
+{
+    const char *roottag = tagXMLEle(root);
+    const char *dev  = findXMLAttValu(root, "device");
+
+    /* the remote server keeps sending the devices of the entries stopped */
+    if (!remoteDevs.empty() && dev[0] && strcmp(roottag, "getProperties") && remoteDevs.find(dev) == remoteDevs.end())
+    {
+        delXMLEle(root);
+        return;
+    }
+
+    root = updateCache(root);
+    if (root == nullptr)
+        return;
+
+    DvrInfo::onMessage(root, sharedBuffers);
 }
 
-int RemoteDvrInfo::openINDIServer()
+bool RemoteDvrInfo::openINDIServer()
 {
-    struct sockaddr_in serv_addr;
-    struct hostent *hp;
     int sockfd;
 
     /* lookup host address */
-    hp = gethostbyname(host.c_str());
-    if (!hp)
+    if (!resolved)
     {
-        log(fmt("gethostbyname(%s): %s\n", host.c_str(), strerror(errno)));
-        Bye();
+        struct hostent *hp = gethostbyname(host.c_str());
+        if (!hp)
+        {
+            log(fmt("gethostbyname(%s): %s\n", host.c_str(), strerror(errno)));
+            return false;
+        }
+
+        (void)memset((char *)&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = ((struct in_addr *)(hp->h_addr_list[0]))->s_addr;
+        addr.sin_port        = htons(port);
+        resolved = true;
     }
 
     /* create a socket to the INDI server */
-    (void)memset((char *)&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family      = AF_INET;
-    serv_addr.sin_addr.s_addr = ((struct in_addr *)(hp->h_addr_list[0]))->s_addr;
-    serv_addr.sin_port        = htons(port);
     if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
     {
         log(fmt("socket(%s,%d): %s\n", host.c_str(), port, strerror(errno)));
-        Bye();
+        return false;
     }
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
 
-    /* connect */
-    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    /* connect, the loop tells when it is done */
+    if (connect(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)
     {
         log(fmt("connect(%s,%d): %s\n", host.c_str(), port, strerror(errno)));
-        Bye();
+        ::close(sockfd);
+        return false;
     }
 
-    /* ok */
-    return (sockfd);
+    connecting.start(sockfd, ev::WRITE);
+    return true;
 }
 
-RemoteDvrInfo::RemoteDvrInfo(): DvrInfo(false)
-{}
+RemoteDvrInfo::RemoteDvrInfo():
+    DvrInfo(false)
+{
+    retry.set<RemoteDvrInfo, &RemoteDvrInfo::onRetry>(this);
+    connecting.set<RemoteDvrInfo, &RemoteDvrInfo::onConnecting>(this);
+}
 
 RemoteDvrInfo::RemoteDvrInfo(const RemoteDvrInfo &model):
     DvrInfo(model),
+    names(model.names),
+    remoteDevs(model.remoteDevs),
+    lost(model.lost == std::chrono::steady_clock::time_point() ? std::chrono::steady_clock::now() : model.lost),
+    addr(model.addr),
+    resolved(model.resolved),
     host(model.host),
     port(model.port)
-{}
+{
+    /* clients keep the devices: their messages still come here while connecting again */
+    dev = model.dev;
+    cache = model.cache;
+
+    retry.set<RemoteDvrInfo, &RemoteDvrInfo::onRetry>(this);
+    connecting.set<RemoteDvrInfo, &RemoteDvrInfo::onConnecting>(this);
+}
 
 RemoteDvrInfo::~RemoteDvrInfo()
-{}
+{
+    if (connecting.is_active())
+    {
+        connecting.stop();
+        ::close(connecting.fd);
+    }
+}
 
 RemoteDvrInfo * RemoteDvrInfo::clone() const
 {
     return new RemoteDvrInfo(*this);
-}
\ No newline at end of file
+}
+
+bool RemoteDvrInfo::isNamed(const std::string &entry) const
+{
+    return names.find(entry) != names.end();
+}
+
+bool RemoteDvrInfo::stopNamed(const std::string &entry)
+{
+    /* the connection closes with its last entry */
+    if (names.size() <= 1)
+        return true;
+
+    names.erase(entry);
+    if (name == entry)
+        name = *names.begin();
+
+    std::string host, device;
+    int port;
+    extractRemoteId(entry, host, port, device);
+    remoteDevs.erase(device);
+    if (dev.erase(device) == 0)
+        return false;
+
+    /* Inform clients that this device is gone */
+    XMLEle *root = addXMLEle(NULL, "delProperty");
+    addXMLAtt(root, "device", device.c_str());
+    Msg *mp = new Msg(this, root);
+
+    ClInfo::q2Clients(NULL, 0, device, "", mp, root);
+    mp->queuingDone();
+    return false;
+}
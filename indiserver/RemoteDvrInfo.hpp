@@ -20,20 +20,67 @@
 
 #include "DvrInfo.hpp"
 
+#include <chrono>
+#include <memory>
+#include <netinet/in.h>
+#include <set>
 #include <string>
 
+/* Connection to a chained INDI server. All the device entries for a host:port share one of them,
+ * and when it drops, it is opened again while clients keep the properties they know: the
+ * definitions sent again by the remote server are only forwarded for what changed meanwhile.
+ */
 class RemoteDvrInfo: public DvrInfo
 {
-        /* open a connection to the given host and port or die.
-         * return socket fd.
+        /* delay between attempts to connect again, in seconds */
+        static constexpr double retryDelay {5};
+        /* how long the properties are kept for clients while the link is down, in seconds */
+        static constexpr double keepDelay {30};
+
+        std::set<std::string> names;        /* entries served by this connection */
+        std::set<std::string> remoteDevs;   /* devices asked for, all if empty */
+        std::chrono::steady_clock::time_point lost; /* when the connection dropped, if it did */
+
+        ev::timer retry;
+
+        /* the address of host, looked up once per entry launched: retries do not hold the loop on it */
+        struct sockaddr_in addr {};
+        bool resolved {false};
+
+        /* the connection in progress */
+        ev::io connecting;
+
+        /* start a connection to the given host and port, completed in onConnecting().
+         * return false if not reachable.
          */
-        int openINDIServer();
+        bool openINDIServer();
+
+        void onConnecting(ev::io &watcher, int revents);
+
+        /* serve the connection opened on sockfd */
+        void connected(int sockfd);
+
+        /* try again later, or exit on the first start */
+        void unreachable();
+
+        static void extractRemoteId(const std::string &name, std::string &o_host, int &o_port, std::string &o_dev);
+
+        /* ask the remote server for the properties of device, "*" for all */
+        void requestProperties(const std::string &device);
 
-        void extractRemoteId(const std::string &name, std::string &o_host, int &o_port, std::string &o_dev) const;
+        /* serve the device of entry name over this connection too */
+        void share(const std::string &name, const std::string &device);
+
+        /* tell clients the devices served are gone, and forget their properties */
+        void dropDevices();
+
+        void onRetry(ev::timer &watcher, int revents);
 
     protected:
         RemoteDvrInfo(const RemoteDvrInfo &model);
 
+        void onMessage(XMLEle *root, std::list<int> &sharedBuffers) override;
+
     public:
         std::string host;
         int port;
@@ -41,10 +88,22 @@ class RemoteDvrInfo: public DvrInfo
         RemoteDvrInfo();
         virtual ~RemoteDvrInfo();
 
+        /* start the entry name, over the connection already open to its host and port if any */
+        static void launch(const std::string &name);
+
         void start() override;
 
         RemoteDvrInfo * clone() const override;
 
+        bool isNamed(const std::string &name) const override;
+
+        bool stopNamed(const std::string &name) override;
+
+        bool keepsDevicesOnRestart() const override
+        {
+            return true;
+        }
+
         const std::string remoteServerUid() const override
         {
             return std::string(host) + ":" + std::to_string(port);
@@ -0,0 +1,245 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // needed for sched_setaffinity
+#endif
+
+#include "Scheduling.hpp"
+#include "Utils.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+Scheduling Scheduling::inherited;
+static bool serverChanged = false;
+
+static bool parseInt(const std::string &s, int &value)
+{
+    char * end;
+    errno = 0;
+    long v = strtol(s.c_str(), &end, 10);
+    if (s.empty() || *end || errno)
+        return false;
+    value = (int) v;
+    return true;
+}
+
+static bool parseCpus(const std::string &list, std::vector<int> &cpus)
+{
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        int first, last;
+        auto dash = item.find('-');
+        if (dash == std::string::npos)
+        {
+            if (!parseInt(item, first))
+                return false;
+            last = first;
+        }
+        else if (!parseInt(item.substr(0, dash), first) || !parseInt(item.substr(dash + 1), last))
+            return false;
+
+#ifdef __linux__
+        if (first < 0 || last < first || last >= CPU_SETSIZE)
+            return false;
+#else
+        if (first < 0 || last < first)
+            return false;
+#endif
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return !cpus.empty();
+}
+
+bool Scheduling::parse(const std::string &spec)
+{
+    std::stringstream ss(spec);
+    std::string item;
+    while (ss >> item)
+    {
+        auto eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+
+        bool ok;
+        if (key == "mlock" && eq == std::string::npos)
+        {
+            lockMemory = true;
+            ok = true;
+        }
+        else if (key == "cpus")
+        {
+            cpus.clear();
+            ok = parseCpus(value, cpus);
+#ifndef __linux__
+            if (ok)
+                log("CPU affinity is not supported on this system, ignored\n");
+#endif
+        }
+        else if (key == "fifo" || key == "rr")
+        {
+            policy = key == "fifo" ? SCHED_FIFO : SCHED_RR;
+            ok = parseInt(value, priority) && priority >= sched_get_priority_min(policy)
+                 && priority <= sched_get_priority_max(policy);
+        }
+        else if (key == "nice")
+        {
+            setNice = true;
+            ok = parseInt(value, nice) && nice >= -20 && nice <= 19;
+        }
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            log(fmt("invalid scheduling setting '%s'\n", item.c_str()));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Scheduling::empty() const
+{
+    return cpus.empty() && policy == -1 && !setNice && !lockMemory;
+}
+
+std::string Scheduling::toString() const
+{
+    std::string out;
+    if (!cpus.empty())
+    {
+        out += "cpus=";
+        for (size_t i = 0; i < cpus.size(); i++)
+            out += (i ? "," : "") + std::to_string(cpus[i]);
+    }
+    if (policy == SCHED_FIFO || policy == SCHED_RR)
+        out += fmt("%s%s=%d", out.empty() ? "" : " ", policy == SCHED_FIFO ? "fifo" : "rr", priority);
+    if (setNice)
+        out += fmt("%snice=%d", out.empty() ? "" : " ", nice);
+    if (lockMemory)
+        out += out.empty() ? "mlock" : " mlock";
+    return out;
+}
+
+void Scheduling::saveInherited()
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &set))
+                inherited.cpus.push_back(cpu);
+    }
+#endif
+    struct sched_param param;
+    inherited.policy = sched_getscheduler(0);
+    inherited.priority = sched_getparam(0, &param) == 0 ? param.sched_priority : 0;
+
+    errno = 0;
+    int current = getpriority(PRIO_PROCESS, 0);
+    inherited.setNice = errno == 0;
+    inherited.nice = current;
+}
+
+// Apply everything that is set. Return false if something failed, after logging
+static bool apply(const std::vector<int> &cpus, int policy, int priority, bool setNice, int nice)
+{
+    bool ok = true;
+#ifdef __linux__
+    if (!cpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+            CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == -1)
+        {
+            log(fmt("sched_setaffinity: %s\n", strerror(errno)));
+            ok = false;
+        }
+    }
+#else
+    (void) cpus;
+#endif
+    if (policy != -1)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+        if (sched_setscheduler(0, policy, &param) == -1)
+        {
+            log(fmt("sched_setscheduler: %s\n", strerror(errno)));
+            ok = false;
+        }
+    }
+    if (setNice && setpriority(PRIO_PROCESS, 0, nice) == -1)
+    {
+        log(fmt("setpriority: %s\n", strerror(errno)));
+        ok = false;
+    }
+    return ok;
+}
+
+bool Scheduling::applyToServer() const
+{
+    if (empty())
+        return true;
+    serverChanged = true;
+
+    bool ok = apply(cpus, policy, priority, setNice, nice);
+    if (lockMemory && mlockall(MCL_CURRENT | MCL_FUTURE) == -1)
+    {
+        log(fmt("mlockall: %s\n", strerror(errno)));
+        ok = false;
+    }
+    return ok;
+}
+
+void Scheduling::applyToDriver() const
+{
+    if (lockMemory)
+        setenv("INDIMLOCK", "1", 1);
+    else
+        unsetenv("INDIMLOCK");
+
+    if (!serverChanged)
+    {
+        apply(cpus, policy, priority, setNice, nice);
+        return;
+    }
+
+    // Don't let the driver inherit what the server set for itself
+    apply(cpus.empty() ? inherited.cpus : cpus,
+          policy == -1 ? inherited.policy : policy,
+          policy == -1 ? inherited.priority : priority,
+          setNice || inherited.setNice,
+          setNice ? nice : inherited.nice);
+}
@@ -0,0 +1,64 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+/* Where and how a process runs: the CPUs it may use, its priority and whether its memory is locked.
+ * Given as a list of space separated settings, like "cpus=2,4-7 fifo=40 mlock":
+ *   cpus=list  CPUs, as numbers or ranges of numbers separated by commas (Linux only)
+ *   fifo=n     SCHED_FIFO real time priority n
+ *   rr=n       SCHED_RR real time priority n
+ *   nice=n     nice value n
+ *   mlock      lock all the memory of the process
+ */
+class Scheduling
+{
+        std::vector<int> cpus;  /* empty for any */
+        int policy {-1};        /* SCHED_FIFO, SCHED_RR or -1 to keep the current one */
+        int priority {0};
+        bool setNice {false};
+        int nice {0};
+
+        /* what the server got from its parent, for the drivers that don't say otherwise */
+        static Scheduling inherited;
+
+    public:
+        bool lockMemory {false};
+
+        /* read a list of settings. Log and return false if one of them is wrong */
+        bool parse(const std::string &spec);
+
+        bool empty() const;
+
+        /* the settings, as given to parse */
+        std::string toString() const;
+
+        /* record the settings of the calling process. To be called once, before any change */
+        static void saveInherited();
+
+        /* apply the settings to the calling thread. Threads it creates afterwards get them.
+         * With memory locking, the whole process gets locked. Log and return false on failure */
+        bool applyToServer() const;
+
+        /* apply the settings to a forked driver, about to exec. What is not set gets back to
+         * what the server inherited. Memory locking is done by the driver, see INDIMLOCK */
+        void applyToDriver() const;
+};
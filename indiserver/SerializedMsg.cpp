@@ -21,10 +21,20 @@
 #include "MsgChunck.hpp"
 #include "MsgChunckIterator.hpp"
 #include "MsgQueue.hpp"
+#include "Metrics.hpp"
+#include "Utils.hpp"
+#include "shm_open_anon.h"
+#include "indiprobes.h"
 
+#include <cerrno>
+#include <cstring>
 #include <thread>
+#include <unistd.h>
 
-SerializedMsg::SerializedMsg(Msg * parent) : asyncProgress(), owner(parent), awaiters(), chuncks(), ownBuffers()
+unsigned long SerializedMsg::memoryLimit = 0;
+
+SerializedMsg::SerializedMsg(Msg * parent) : asyncProgress(), owner(parent), awaiters(), chuncks(), ownBuffers(),
+    ownBytes(0), spillFd(-1), spillBytes(0)
 {
     blockedProducer = nullptr;
     // At first, everything is required.
@@ -47,6 +57,12 @@ SerializedMsg::~SerializedMsg()
     {
         free(buff);
     }
+    Metrics::serializedBytes -= ownBytes - spillBytes;
+    if (spillFd != -1)
+    {
+        Metrics::spilledBytes -= spillBytes;
+        close(spillFd);
+    }
 }
 
 bool SerializedMsg::async_canceled()
@@ -74,10 +90,67 @@ void SerializedMsg::async_pushChunck(const MsgChunck &m)
     asyncProgress.send();
 }
 
+void SerializedMsg::async_pushOwnedChunck(char * buffer, unsigned long length)
+{
+    ownBytes += length;
+
+    if (memoryLimit && Metrics::serializedBytes + length > memoryLimit)
+    {
+        off_t offset = spillBytes;
+        if (spill(buffer, length))
+        {
+            // Readers only get the fd and offset of that chunck: it is sent with sendfile
+            free(buffer);
+            Metrics::spilledBytes += length;
+            async_pushChunck(MsgChunck(spillFd, offset, length));
+            return;
+        }
+    }
+
+    ownBuffers.push_back(buffer);
+    Metrics::serializedBytes += length;
+    async_pushChunck(MsgChunck(buffer, length));
+}
+
+// Append to the spill file, created on first use
+bool SerializedMsg::spill(const char * buffer, unsigned long length)
+{
+    if (spillFd == -1)
+    {
+        spillFd = shm_open_anon();
+        if (spillFd == -1)
+        {
+            log(fmt("Unable to create spill file, keeping content in memory: %s\n", strerror(errno)));
+            return false;
+        }
+    }
+
+    off_t offset = spillBytes;
+    for (unsigned long done = 0; done < length;)
+    {
+        ssize_t w = pwrite(spillFd, buffer + done, length - done, offset + done);
+        if (w == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (w <= 0)
+        {
+            log(fmt("Unable to spill content, keeping it in memory: %s\n", strerror(errno)));
+            // What was written is never read
+            return false;
+        }
+        done += w;
+    }
+    spillBytes += length;
+    return true;
+}
+
 void SerializedMsg::async_done()
 {
     std::lock_guard<std::recursive_mutex> guard(lock);
     asyncStatus = SerializationStatus::terminated;
+    Metrics::serializationTime.record(std::chrono::steady_clock::now() - productionStart);
+    INDI_PROBE4(serialize_done, this, getDevice().c_str(), getName().c_str(), queueSize());
     asyncProgress.send();
 }
 
@@ -90,6 +163,8 @@ void SerializedMsg::async_start()
     }
 
     asyncStatus = SerializationStatus::running;
+    productionStart = std::chrono::steady_clock::now();
+    INDI_PROBE4(serialize_start, this, getDevice().c_str(), getName().c_str(), queueSize());
     if (generateContentAsync())
     {
         asyncProgress.start();
@@ -143,6 +218,13 @@ bool SerializedMsg::requestContent(const MsgChunckIterator &position)
         async_start();
     }
 
+    return hasContent(position);
+}
+
+bool SerializedMsg::hasContent(const MsgChunckIterator &position)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+
     if (asyncStatus == SerializationStatus::terminated)
     {
         return true;
@@ -188,11 +270,21 @@ bool SerializedMsg::getContent(MsgChunckIterator &from, void* &data, ssize_t &si
         sharedBuffers.clear();
     }
 
-    data = ck.content + from.chunckOffset;
+    // File chunks stay null, even when partly sent
+    data = ck.content ? ck.content + from.chunckOffset : nullptr;
     size = ck.contentLength - from.chunckOffset;
     return true;
 }
 
+int SerializedMsg::getContentFile(const MsgChunckIterator &from, off_t &offset)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+
+    const MsgChunck &ck = chuncks[from.chunckId];
+    offset = ck.fileOffset + from.chunckOffset;
+    return ck.fileFd;
+}
+
 void SerializedMsg::advance(MsgChunckIterator &iter, ssize_t s)
 {
     std::lock_guard<std::recursive_mutex> guard(lock);
@@ -239,4 +331,24 @@ void SerializedMsg::blockReceiver(MsgQueue * receiver)
 ssize_t SerializedMsg::queueSize()
 {
     return owner->queueSize;
+}
+
+bool SerializedMsg::hasBlobs() const
+{
+    return owner->hasInlineBlobs || owner->hasSharedBufferBlobs;
+}
+
+bool SerializedMsg::isStream() const
+{
+    return owner->stream;
+}
+
+const std::string &SerializedMsg::getDevice() const
+{
+    return owner->device;
+}
+
+const std::string &SerializedMsg::getName() const
+{
+    return owner->name;
 }
\ No newline at end of file
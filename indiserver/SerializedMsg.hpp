@@ -19,10 +19,15 @@
 #pragma once
 
 #include "SerializationRequirement.hpp"
+#include "Pool.hpp"
 
+#include <chrono>
+#include <sys/types.h>
 #include <mutex>
+#include <string>
 #include <vector>
 #include <list>
+#include <set>
 #include <ev++.h>
 
 class Msg;
@@ -32,7 +37,7 @@ class MsgQueue;
 
 enum class SerializationStatus { pending, running, canceling, terminated };
 
-class SerializedMsg
+class SerializedMsg: public Pooled<SerializedMsg>
 {
         friend class Msg;
         friend class MsgChunckIterator;
@@ -52,11 +57,15 @@ class SerializedMsg
 
         void produce(bool sync);
 
+        std::chrono::steady_clock::time_point productionStart;
+
     protected:
         // These methods are to be called from asyncRun
         bool async_canceled();
         void async_updateRequirement(const SerializationRequirement &n);
         void async_pushChunck(const MsgChunck &m);
+        // Push a malloced buffer that the message now owns. Beyond the memory limit, it goes to the spill file
+        void async_pushOwnedChunck(char * buffer, unsigned long length);
         void async_done();
 
         // True if a producing thread is active
@@ -67,14 +76,24 @@ class SerializedMsg
 
         MsgQueue* blockedProducer;
 
-        std::set<MsgQueue *> awaiters;
+        std::set<MsgQueue *, std::less<MsgQueue *>, PoolAllocator<MsgQueue *>> awaiters;
     private:
-        std::vector<MsgChunck> chuncks;
+        std::vector<MsgChunck, PoolAllocator<MsgChunck>> chuncks;
 
     protected:
         // Buffers malloced during asyncRun
         std::list<void*> ownBuffers;
 
+    private:
+        // Bytes of the buffers pushed with async_pushOwnedChunck, in memory or in spillFd
+        unsigned long ownBytes;
+        int spillFd;
+        off_t spillBytes;
+
+        bool spill(const char * buffer, unsigned long length);
+
+    protected:
+
         // This will notify awaiters and possibly release the owner
         void onDataReady();
 
@@ -98,17 +117,36 @@ class SerializedMsg
         // Return true if some content is available
         bool requestContent(const MsgChunckIterator &position);
 
+        // Same as requestContent, without starting production. Safe from io workers
+        bool hasContent(const MsgChunckIterator &position);
+
         // Return true if some content is available
         // It is possible to have 0 to send, meaning end was actually reached
         bool getContent(MsgChunckIterator &position, void * &data, ssize_t &nsend, std::vector<int> &sharedBuffers);
 
         void advance(MsgChunckIterator &position, ssize_t s);
 
+        // For file chunks (getContent gave a null data): the fd to read from, at offset
+        int getContentFile(const MsgChunckIterator &position, off_t &offset);
+
         // When a queue is done with sending this message
         void release(MsgQueue * from);
 
         void addAwaiter(MsgQueue * awaiter);
 
         ssize_t queueSize();
+
+        // True for messages carrying BLOB content
+        bool hasBlobs() const;
+
+        // Frame of a video stream
+        bool isStream() const;
+
+        // Device & property of the message (may be empty)
+        const std::string &getDevice() const;
+        const std::string &getName() const;
+
+        // Above that many bytes of owned content over all messages, new content is spilled. 0 for no limit
+        static unsigned long memoryLimit;
 };
 
@@ -0,0 +1,145 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "SerializedMsgWithBinaryBlobs.hpp"
+#include "Utils.hpp"
+#include "Msg.hpp"
+#include "MsgChunck.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+#include <unordered_map>
+
+SerializedMsgWithBinaryBlobs::SerializedMsgWithBinaryBlobs(Msg * parent): SerializedMsg(parent)
+{
+}
+
+SerializedMsgWithBinaryBlobs::~SerializedMsgWithBinaryBlobs()
+{
+}
+
+bool SerializedMsgWithBinaryBlobs::generateContentAsync() const
+{
+    // No encoding: just a model and file ranges
+    return false;
+}
+
+void SerializedMsgWithBinaryBlobs::generateContent()
+{
+    auto xmlContent = owner->xmlContent;
+
+    std::vector<XMLEle*> cdata;
+    std::vector<int> fds;
+    std::vector<size_t> sizes;
+
+    std::unordered_map<XMLEle*, XMLEle*> replacement;
+
+    int ownerSharedBufferId = 0;
+
+    for(auto blobContent : findBlobElements(xmlContent))
+    {
+        std::string attached = findXMLAttValu(blobContent, "attached");
+        if (attached != "true")
+        {
+            continue;
+        }
+
+        int fd = owner->sharedBuffers[ownerSharedBufferId++];
+
+        struct stat sb;
+        if (fstat(fd, &sb) == -1)
+        {
+            log(fmt("fstat of shared buffer failed: %s\n", strerror(errno)));
+            sb.st_size = 0;
+        }
+
+        size_t size = sb.st_size;
+        ssize_t xmlSize;
+        if (parseBlobSize(blobContent, xmlSize) && xmlSize >= 0 && ((size_t)xmlSize) <= size)
+        {
+            size = xmlSize;
+        }
+
+        XMLEle * clone = shallowCloneXMLEle(blobContent);
+        rmXMLAtt(clone, "attached");
+        rmXMLAtt(clone, "enclen");
+        rmXMLAtt(clone, "size");
+        addXMLAtt(clone, "size", std::to_string(size).c_str());
+        addXMLAtt(clone, "binary", "true");
+        // Put something here for later replacement
+        editXMLEle(clone, "_");
+
+        replacement[blobContent] = clone;
+        cdata.push_back(clone);
+        fds.push_back(fd);
+        sizes.push_back(size);
+    }
+
+    if (!replacement.empty())
+    {
+        xmlContent = cloneXMLEleWithReplacementMap(xmlContent, replacement);
+    }
+
+    // Print in one pass. Referred cdata locates the dummy cdata of the clones
+    XMLSpan * spans;
+    int nspans;
+    char * model = sprvXMLEle(xmlContent, 0, 1, &spans, &nspans, nullptr);
+
+    ownBuffers.push_back(model);
+
+    // The fds stay open until this is released: requirements are never lowered
+    for(int i = 0; i < nspans; ++i)
+    {
+        if (spans[i].ele == nullptr)
+        {
+            async_pushChunck(MsgChunck(model + spans[i].offset, spans[i].len));
+            continue;
+        }
+
+        auto pos = std::find(cdata.begin(), cdata.end(), spans[i].ele);
+        if (pos != cdata.end())
+        {
+            // Skip the dummy cdata completely
+            size_t blob = pos - cdata.begin();
+            if (sizes[blob] > 0)
+            {
+                async_pushChunck(MsgChunck(fds[blob], 0, sizes[blob]));
+            }
+        }
+        else if (replacement.empty())
+        {
+            async_pushChunck(MsgChunck(pcdataXMLEle(spans[i].ele), spans[i].len));
+        }
+        else
+        {
+            // The copy goes away: keep its other cdata
+            char * text = (char*)malloc(spans[i].len);
+            memcpy(text, pcdataXMLEle(spans[i].ele), spans[i].len);
+            ownBuffers.push_back(text);
+            async_pushChunck(MsgChunck(text, spans[i].len));
+        }
+    }
+    free(spans);
+
+    if (!replacement.empty())
+    {
+        delXMLEle(xmlContent);
+    }
+    async_done();
+}
@@ -0,0 +1,181 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "SerializedMsgWithCompression.hpp"
+#include "Utils.hpp"
+#include "Msg.hpp"
+#include "MsgChunck.hpp"
+#include "base64.h"
+
+#include <zlib.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+static bool endsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Compressing again is a waste for these
+static bool isCompressedFormat(const std::string &format)
+{
+    return endsWith(format, ".z") || endsWith(format, ".fz");
+}
+
+static void setXMLAtt(XMLEle * ep, const char * name, const std::string &value)
+{
+    XMLAtt * ap = findXMLAtt(ep, name);
+    if (ap)
+        editXMLAtt(ap, value.c_str());
+    else
+        addXMLAtt(ep, name, value.c_str());
+}
+
+SerializedMsgWithCompression::SerializedMsgWithCompression(Msg * parent): SerializedMsg(parent)
+{
+}
+
+SerializedMsgWithCompression::~SerializedMsgWithCompression()
+{
+}
+
+bool SerializedMsgWithCompression::generateContentAsync() const
+{
+    return owner->hasInlineBlobs || owner->hasSharedBufferBlobs;
+}
+
+void SerializedMsgWithCompression::generateContent()
+{
+    auto xmlContent = owner->xmlContent;
+
+    std::unordered_map<XMLEle*, XMLEle*> replacement;
+
+    int ownerSharedBufferId = 0;
+
+    for(auto blobContent : findBlobElements(xmlContent))
+    {
+        std::string attached = findXMLAttValu(blobContent, "attached");
+        int fd = -1;
+        if (attached == "true")
+        {
+            fd = owner->sharedBuffers[ownerSharedBufferId++];
+        }
+        else if (pcdatalenXMLEle(blobContent) == 0)
+        {
+            continue;
+        }
+
+        std::string format = findXMLAttValu(blobContent, "format");
+        if (fd == -1 && isCompressedFormat(format))
+        {
+            // Keep the base64 as is
+            continue;
+        }
+
+        // Get the raw data
+        const unsigned char * raw;
+        size_t rawSize;
+        void * mapped = nullptr;
+        size_t mappedSize = 0;
+        std::vector<unsigned char> decoded;
+
+        if (fd != -1)
+        {
+            mapped = attachSharedBuffer(fd, mappedSize);
+            rawSize = mappedSize;
+
+            ssize_t size;
+            if (parseBlobSize(blobContent, size) && size >= 0 && ((size_t)size) <= mappedSize)
+            {
+                rawSize = size;
+            }
+            raw = (const unsigned char *)mapped;
+        }
+        else
+        {
+            int len = pcdatalenXMLEle(blobContent);
+            decoded.resize(3 * len / 4 + 4);
+            int decodedSize = from64tobits_fast((char*)decoded.data(), pcdataXMLEle(blobContent), len);
+            if (decodedSize < 0)
+            {
+                log("Invalid base64 content, sending it uncompressed\n");
+                continue;
+            }
+            rawSize = decodedSize;
+            raw = decoded.data();
+        }
+
+        // Compress, unless already done by the driver
+        const unsigned char * payload = raw;
+        size_t payloadSize = rawSize;
+        std::vector<unsigned char> compressed;
+
+        if (!isCompressedFormat(format))
+        {
+            uLongf compressedSize = compressBound(rawSize);
+            compressed.resize(compressedSize);
+            if (compress2(compressed.data(), &compressedSize, raw, rawSize, compressionLevel) == Z_OK)
+            {
+                payload = compressed.data();
+                payloadSize = compressedSize;
+                format += ".z";
+            }
+            else
+            {
+                log("BLOB compression failed, sending it uncompressed\n");
+            }
+        }
+
+        std::vector<char> base64(4 * payloadSize / 3 + 4);
+        int base64Count = to64frombits_s((unsigned char*)base64.data(), payload, payloadSize, base64.size());
+        base64.resize(base64Count);
+        base64.push_back(0);
+
+        if (mapped)
+        {
+            // Dettach blobs ASAP
+            dettachSharedBuffer(fd, mapped, mappedSize);
+        }
+
+        XMLEle * clone = shallowCloneXMLEle(blobContent);
+        rmXMLAtt(clone, "attached");
+        setXMLAtt(clone, "format", format);
+        setXMLAtt(clone, "size", std::to_string(rawSize));
+        setXMLAtt(clone, "enclen", std::to_string(base64Count));
+        editXMLEle(clone, base64.data());
+
+        replacement[blobContent] = clone;
+    }
+
+    if (!replacement.empty())
+    {
+        xmlContent = cloneXMLEleWithReplacementMap(xmlContent, replacement);
+    }
+
+    size_t modelSize;
+    char * model = sprvXMLEle(xmlContent, 0, 0, nullptr, nullptr, &modelSize);
+
+    if (!replacement.empty())
+    {
+        delXMLEle(xmlContent);
+    }
+
+    async_pushOwnedChunck(model, modelSize);
+    async_done();
+}
@@ -117,9 +117,10 @@ void SerializedMsgWithSharedBuffer::generateContent()
     // Now create a Chunk from xmlContent
     MsgChunck chunck;
 
-    chunck.content = (char*)malloc(sprlXMLEle(xmlContent, 0) + 1);
+    size_t contentLength;
+    chunck.content = sprvXMLEle(xmlContent, 0, 0, nullptr, nullptr, &contentLength);
     ownBuffers.push_back(chunck.content);
-    chunck.contentLength = sprXMLEle(chunck.content, xmlContent, 0);
+    chunck.contentLength = contentLength;
     chunck.sharedBufferIdsToAttach = sharedBuffers;
 
     async_pushChunck(chunck);
@@ -0,0 +1,141 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "SerializedMsgWithWebSocketFrames.hpp"
+#include "Utils.hpp"
+#include "Msg.hpp"
+#include "MsgChunck.hpp"
+
+#include <cstring>
+#include <sys/stat.h>
+#include <unordered_map>
+
+SerializedMsgWithWebSocketFrames::SerializedMsgWithWebSocketFrames(Msg * parent): SerializedMsg(parent)
+{
+}
+
+SerializedMsgWithWebSocketFrames::~SerializedMsgWithWebSocketFrames()
+{
+}
+
+bool SerializedMsgWithWebSocketFrames::generateContentAsync() const
+{
+    // No encoding: the xml, frame headers and file ranges
+    return false;
+}
+
+size_t SerializedMsgWithWebSocketFrames::frameHeader(unsigned char * header, int opcode, uint64_t length)
+{
+    header[0] = 0x80 | opcode;
+    if (length < 126)
+    {
+        header[1] = length;
+        return 2;
+    }
+    if (length <= 0xFFFF)
+    {
+        header[1] = 126;
+        header[2] = length >> 8;
+        header[3] = length;
+        return 4;
+    }
+    header[1] = 127;
+    for (int i = 0; i < 8; i++)
+        header[2 + i] = length >> (8 * (7 - i));
+    return 10;
+}
+
+void SerializedMsgWithWebSocketFrames::generateContent()
+{
+    auto xmlContent = owner->xmlContent;
+
+    std::vector<int> fds;
+    std::vector<size_t> sizes;
+
+    std::unordered_map<XMLEle*, XMLEle*> replacement;
+
+    int ownerSharedBufferId = 0;
+
+    for(auto blobContent : findBlobElements(xmlContent))
+    {
+        std::string attached = findXMLAttValu(blobContent, "attached");
+        if (attached != "true")
+        {
+            continue;
+        }
+
+        int fd = owner->sharedBuffers[ownerSharedBufferId++];
+
+        struct stat sb;
+        if (fstat(fd, &sb) == -1)
+        {
+            log(fmt("fstat of shared buffer failed: %s\n", strerror(errno)));
+            sb.st_size = 0;
+        }
+
+        size_t size = sb.st_size;
+        ssize_t xmlSize;
+        if (parseBlobSize(blobContent, xmlSize) && xmlSize >= 0 && ((size_t)xmlSize) <= size)
+        {
+            size = xmlSize;
+        }
+
+        XMLEle * clone = shallowCloneXMLEle(blobContent);
+        rmXMLAtt(clone, "attached");
+        rmXMLAtt(clone, "enclen");
+        rmXMLAtt(clone, "size");
+        addXMLAtt(clone, "size", std::to_string(size).c_str());
+        addXMLAtt(clone, "binary", "true");
+        editXMLEle(clone, "");
+
+        replacement[blobContent] = clone;
+        fds.push_back(fd);
+        sizes.push_back(size);
+    }
+
+    if (!replacement.empty())
+    {
+        xmlContent = cloneXMLEleWithReplacementMap(xmlContent, replacement);
+    }
+
+    // The text frame, its header right before the xml
+    size_t length = sprlXMLEle(xmlContent, 0);
+    unsigned char * text = (unsigned char*)malloc(maxFrameHeaderLength + length + 1);
+    size_t headerLength = frameHeader(text, 0x1, length);
+    sprXMLEle((char*)text + headerLength, xmlContent, 0);
+    ownBuffers.push_back(text);
+    async_pushChunck(MsgChunck((char*)text, headerLength + length));
+
+    // The fds stay open until this is released: requirements are never lowered
+    for(size_t blob = 0; blob < fds.size(); ++blob)
+    {
+        unsigned char * header = (unsigned char*)malloc(maxFrameHeaderLength);
+        ownBuffers.push_back(header);
+        async_pushChunck(MsgChunck((char*)header, frameHeader(header, 0x2, sizes[blob])));
+        if (sizes[blob] > 0)
+        {
+            async_pushChunck(MsgChunck(fds[blob], 0, sizes[blob]));
+        }
+    }
+
+    if (!replacement.empty())
+    {
+        delXMLEle(xmlContent);
+    }
+    async_done();
+}
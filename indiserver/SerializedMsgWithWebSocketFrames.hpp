@@ -0,0 +1,42 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include "SerializedMsg.hpp"
+
+/* Messages to web socket clients, see WsClInfo: the xml goes in a text frame, then each shared buffer
+ * BLOB in a binary frame, straight from its fd. Such oneBLOB elements are empty, with a binary="true"
+ * attribute: the binary frames that follow the text frame carry their content, in order.
+ * Inline BLOBs keep their base64 content.
+ */
+class SerializedMsgWithWebSocketFrames: public SerializedMsg
+{
+
+    public:
+        SerializedMsgWithWebSocketFrames(Msg * parent);
+        virtual ~SerializedMsgWithWebSocketFrames();
+
+        virtual bool generateContentAsync() const;
+        virtual void generateContent();
+
+        static constexpr size_t maxFrameHeaderLength {10};
+
+        /* write the header of an unmasked final frame of the given opcode and payload length. return its length */
+        static size_t frameHeader(unsigned char * header, int opcode, uint64_t length);
+};
@@ -20,8 +20,13 @@
 #include "Utils.hpp"
 #include "Msg.hpp"
 #include "MsgChunck.hpp"
+#include "EncodePool.hpp"
 #include "base64.h"
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
 #include <unordered_map>
 
 SerializedMsgWithoutSharedBuffer::SerializedMsgWithoutSharedBuffer(Msg * parent): SerializedMsg(parent)
@@ -95,14 +100,27 @@ void SerializedMsgWithoutSharedBuffer::generateContent()
 
     if (replacement.empty())
     {
-        // Just print the content as is...
+        // Just print the content as is, in one pass. Large cdata is sent from the
+        // message itself: the xml is required until the end
 
-        char * model = (char*)malloc(sprlXMLEle(xmlContent, 0) + 1);
-        int modelSize = sprXMLEle(model, xmlContent, 0);
+        XMLSpan * spans;
+        int nspans;
+        char * model = sprvXMLEle(xmlContent, 0, 4096, &spans, &nspans, nullptr);
 
         ownBuffers.push_back(model);
 
-        async_pushChunck(MsgChunck(model, modelSize));
+        for(int i = 0; i < nspans; ++i)
+        {
+            if (spans[i].ele)
+            {
+                async_pushChunck(MsgChunck(pcdataXMLEle(spans[i].ele), spans[i].len));
+            }
+            else
+            {
+                async_pushChunck(MsgChunck(model + spans[i].offset, spans[i].len));
+            }
+        }
+        free(spans);
 
         // FIXME: lower requirements asap... how to do that ?
         // requirements.xml = false;
@@ -114,18 +132,35 @@ void SerializedMsgWithoutSharedBuffer::generateContent()
         // Create a replacement that shares original CData buffers
         xmlContent = cloneXMLEleWithReplacementMap(xmlContent, replacement);
 
-        std::vector<size_t> modelCdataOffset(cdata.size());
-
-        char * model = (char*)malloc(sprlXMLEle(xmlContent, 0) + 1);
-        int modelSize = sprXMLEle(model, xmlContent, 0);
+        // Print in one pass. Referred cdata locates the dummy cdata of the clones
+        XMLSpan * spans;
+        int nspans;
+        char * model = sprvXMLEle(xmlContent, 0, 1, &spans, &nspans, nullptr);
 
         ownBuffers.push_back(model);
 
-        // Get the element offset
-        for(size_t i = 0; i < cdata.size(); ++i)
+        // Ready chuncks of the model, with the index in cdata of the part to insert after each one (or -1)
+        std::vector<std::pair<MsgChunck, int>> parts;
+        for(int i = 0; i < nspans; ++i)
         {
-            modelCdataOffset[i] = sprXMLCDataOffset(xmlContent, cdata[i], 0);
+            if (spans[i].ele == nullptr)
+            {
+                parts.emplace_back(MsgChunck(model + spans[i].offset, spans[i].len), -1);
+                continue;
+            }
+            auto pos = std::find(cdata.begin(), cdata.end(), spans[i].ele);
+            if (pos != cdata.end())
+            {
+                parts.emplace_back(MsgChunck(), int(pos - cdata.begin()));
+                continue;
+            }
+            // The copy goes away: keep its other cdata
+            char * text = (char*)malloc(spans[i].len);
+            memcpy(text, pcdataXMLEle(spans[i].ele), spans[i].len);
+            ownBuffers.push_back(text);
+            parts.emplace_back(MsgChunck(text, spans[i].len), -1);
         }
+        free(spans);
         delXMLEle(xmlContent);
 
         std::vector<int> fds(cdata.size());
@@ -159,16 +194,14 @@ void SerializedMsgWithoutSharedBuffer::generateContent()
         }
 
         // Copy from model or blob (streaming base64 encode)
-        int modelOffset = 0;
-        for(size_t i = 0; i < cdata.size(); ++i)
+        for(auto &part : parts)
         {
-            int cdataOffset = modelCdataOffset[i];
-            if (cdataOffset > modelOffset)
+            if (part.second == -1)
             {
-                async_pushChunck(MsgChunck(model + modelOffset, cdataOffset - modelOffset));
+                async_pushChunck(part.first);
+                continue;
             }
-            // Skip the dummy cdata completely
-            modelOffset = cdataOffset + 1;
+            size_t i = part.second;
 
             // Perform inplace base64
             // FIXME: could be streamed/splitted
@@ -182,16 +215,44 @@ void SerializedMsgWithoutSharedBuffer::generateContent()
 
                 // split here in smaller chunks for faster startup
                 // This allow starting write before the whole blob is converted
+                EncodePool * pool = buffSze > 3 * 16384 ? EncodePool::get() : nullptr;
+                if (pool)
+                {
+                    // Slices are encoded in parallel, but pushed in order
+                    std::deque<std::pair<std::future<void>, MsgChunck>> inflight;
+                    while(buffSze > 0 || !inflight.empty())
+                    {
+                        while(buffSze > 0 && inflight.size() < pool->window())
+                        {
+                            unsigned long sze = buffSze > 3 * 16384 ? 3 * 16384 : buffSze;
+
+                            // Output size is known upfront: no need to wait for the encoder
+                            char* buffer = (char*) malloc(4 * sze / 3 + 4);
+                            auto done = pool->post([buffer, src, sze]()
+                            {
+                                to64frombits_s((unsigned char*)buffer, src, sze, (4 * sze / 3 + 4));
+                            });
+                            inflight.emplace_back(std::move(done), MsgChunck(buffer, 4 * ((sze + 2) / 3)));
+
+                            buffSze -= sze;
+                            src += sze;
+                        }
+
+                        inflight.front().first.wait();
+                        async_pushOwnedChunck(inflight.front().second.content, inflight.front().second.contentLength);
+                        inflight.pop_front();
+                    }
+                }
+
                 while(buffSze > 0)
                 {
                     // We need a block size multiple of 24 bits (3 bytes)
                     unsigned long sze = buffSze > 3 * 16384 ? 3 * 16384 : buffSze;
 
                     char* buffer = (char*) malloc(4 * sze / 3 + 4);
-                    ownBuffers.push_back(buffer);
                     int base64Count = to64frombits_s((unsigned char*)buffer, src, sze, (4 * sze / 3 + 4));
 
-                    async_pushChunck(MsgChunck(buffer, base64Count));
+                    async_pushOwnedChunck(buffer, base64Count);
 
                     buffSze -= sze;
                     src += sze;
@@ -212,12 +273,6 @@ void SerializedMsgWithoutSharedBuffer::generateContent()
                 async_pushChunck(MsgChunck(data, len));
             }
         }
-
-        if (modelOffset < modelSize)
-        {
-            async_pushChunck(MsgChunck(model + modelOffset, modelSize - modelOffset));
-            modelOffset = modelSize;
-        }
     }
     async_done();
 }
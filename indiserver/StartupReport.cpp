@@ -0,0 +1,114 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "StartupReport.hpp"
+#include "DvrInfo.hpp"
+#include "Utils.hpp"
+
+StartupReport StartupReport::instance;
+
+StartupReport::StartupReport()
+{
+    poll.set<StartupReport, &StartupReport::onPoll>(this);
+}
+
+void StartupReport::track(const DvrInfo * dp)
+{
+    auto &self = instance;
+    auto now = clock::now();
+
+    if (self.entries.empty())
+    {
+        self.batchStart = now;
+        self.poll.start(pollPeriod, pollPeriod);
+    }
+
+    Entry entry;
+    entry.driverId = dp->getId();
+    entry.name = dp->name;
+    entry.started = now;
+    self.entries.push_back(entry);
+}
+
+void StartupReport::defined(const DvrInfo * dp)
+{
+    for (auto &entry : instance.entries)
+    {
+        if (entry.driverId == dp->getId())
+        {
+            entry.lastDef = clock::now();
+            entry.defs++;
+            return;
+        }
+    }
+}
+
+void StartupReport::onPoll(ev::timer &, int)
+{
+    auto now = clock::now();
+    auto settle = std::chrono::duration<double>(settleDelay);
+
+    if (now - batchStart > std::chrono::duration<double>(giveUpDelay))
+    {
+        summarize(true);
+        return;
+    }
+
+    for (auto &entry : entries)
+    {
+        // Exited drivers get restarted under a new id: they won't settle here
+        if (DvrInfo::drivers[entry.driverId] == nullptr)
+            continue;
+        if (entry.defs == 0 || now - entry.lastDef < settle)
+            return;
+    }
+    summarize(false);
+}
+
+void StartupReport::summarize(bool forced)
+{
+    poll.stop();
+
+    auto ms = [](clock::duration d)
+    {
+        return (long)std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+
+    clock::time_point last = batchStart;
+    for (auto &entry : entries)
+    {
+        if (entry.defs > 0 && entry.lastDef > last)
+            last = entry.lastDef;
+    }
+
+    log(fmt("%zu driver(s) ready in %ld ms%s\n", entries.size(), ms(last - batchStart),
+            forced ? " (gave up waiting)" : ""));
+
+    for (auto &entry : entries)
+    {
+        if (entry.defs == 0)
+            log(fmt("  %s: no property defined\n", entry.name.c_str()));
+        else if (DvrInfo::drivers[entry.driverId] == nullptr)
+            log(fmt("  %s: exited after %u definitions\n", entry.name.c_str(), entry.defs));
+        else
+            log(fmt("  %s: %u definitions, ready after %ld ms\n", entry.name.c_str(), entry.defs,
+                    ms(entry.lastDef - entry.started)));
+    }
+
+    entries.clear();
+}
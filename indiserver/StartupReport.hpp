@@ -0,0 +1,68 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <ev++.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class DvrInfo;
+
+/* Follows drivers from their start until they are done defining their properties,
+ * then logs how long each one took. Drivers started together (command line, or
+ * a burst of fifo start commands) are summarized together.
+ * A driver is ready once one of its def messages was followed by settleDelay of silence.
+ */
+class StartupReport
+{
+        static constexpr double settleDelay {0.5};      /* s without def message */
+        static constexpr double giveUpDelay {60};       /* s before the summary is forced */
+        static constexpr double pollPeriod {0.1};
+
+        typedef std::chrono::steady_clock clock;
+
+        struct Entry
+        {
+            unsigned long driverId;
+            std::string name;
+            clock::time_point started;
+            clock::time_point lastDef;
+            unsigned defs {0};
+        };
+
+        std::vector<Entry> entries;
+        clock::time_point batchStart;
+        ev::timer poll;
+
+        void onPoll(ev::timer &watcher, int revents);
+        void summarize(bool forced);
+
+        static StartupReport instance;
+
+    public:
+        StartupReport();
+
+        /* dp was just started */
+        static void track(const DvrInfo * dp);
+
+        /* dp sent a def message */
+        static void defined(const DvrInfo * dp);
+};
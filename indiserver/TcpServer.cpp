@@ -20,13 +20,14 @@
 #include "Constants.hpp"
 #include "Utils.hpp"
 #include "ClInfo.hpp"
+#include "WsClInfo.hpp"
 #include "CommandLineArgs.hpp"
 
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
 
-TcpServer::TcpServer(int port): port(port)
+TcpServer::TcpServer(int port, bool webSocket): port(port), webSocket(webSocket)
 {
     sfdev.set<TcpServer, &TcpServer::ioCb>(this);
 }
@@ -92,7 +93,7 @@ void TcpServer::listen()
 
     /* ok */
     if (userConfigurableArguments->verbosity > 0)
-        log(fmt("listening to port %d on fd %d\n", port, sfd));
+        log(fmt("listening to %sport %d on fd %d\n", webSocket ? "web socket " : "", port, sfd));
 }
 
 void TcpServer::accept()
@@ -112,10 +113,13 @@ void TcpServer::accept()
         Bye();
     }
 
-    ClInfo * cp = new ClInfo(false);
+    ClInfo * cp = webSocket ? new WsClInfo() : new ClInfo(false);
 
     /* rig up new clinfo entry */
     cp->setFds(cli_fd, cli_fd);
+    cp->setNetworkClient();
+    if (userConfigurableArguments->clientRateKB)
+        cp->setSendRate(userConfigurableArguments->clientRateKB * 1024.);
 
     if (userConfigurableArguments->verbosity > 0)
     {
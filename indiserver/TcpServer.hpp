@@ -23,6 +23,7 @@
 class TcpServer
 {
         int port;
+        bool webSocket;     /* clients speak INDI over web sockets, see WsClInfo */
         int sfd = -1;
         ev::io sfdev;
 
@@ -32,7 +33,7 @@ class TcpServer
         void accept();
         void ioCb(ev::io &watcher, int revents);
     public:
-        TcpServer(int port);
+        TcpServer(int port, bool webSocket = false);
 
         /* create the public INDI Driver endpoint lsocket on port.
          * return server socket else exit.
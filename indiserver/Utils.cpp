@@ -20,6 +20,7 @@
 #include "Utils.hpp"
 #include "Constants.hpp"
 #include "CommandLineArgs.hpp"
+#include "indicom.h"
 
 #include <cstring>
 #include <csignal>
@@ -62,14 +63,14 @@ void noSIGPIPE()
 char *indi_tstamp(char *s)
 {
     static char sbuf[64];
-    struct tm *tp;
+    struct tm tm;
     time_t t;
 
     time(&t);
-    tp = gmtime(&t);
+    gmtime_r(&t, &tm);
     if (!s)
         s = sbuf;
-    strftime(s, sizeof(sbuf), "%Y-%m-%dT%H:%M:%S", tp);
+    strftime(s, sizeof(sbuf), "%Y-%m-%dT%H:%M:%S", &tm);
     return (s);
 }
 
@@ -158,10 +159,25 @@ std::vector<XMLEle *> findBlobElements(XMLEle * root)
     return result;
 }
 
+void decodeNumbers(XMLEle * root)
+{
+    for (auto ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        double value;
+        char buf[64];
+        if (strcmp(tagXMLEle(ep), "oneNumber") || f_scanieee754(pcdataXMLEle(ep), &value) < 0)
+            continue;
+        snprintf(buf, sizeof(buf), "%.20g", value);
+        editXMLEle(ep, buf);
+    }
+    rmXMLAtt(root, "encoding");
+}
+
 void log(const std::string &log)
 {
-    fprintf(stderr, "%s: ", indi_tstamp(NULL));
-    fprintf(stderr, "%s", log.c_str());
+    // May be called from io workers: don't use the shared timestamp buffer
+    char stamp[64];
+    fprintf(stderr, "%s: %s", indi_tstamp(stamp), log.c_str());
 }
 
 int readFdError(int fd)
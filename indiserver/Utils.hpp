@@ -40,6 +40,8 @@ int readFdError(int
 void * attachSharedBuffer(int fd, size_t &size);
 void dettachSharedBuffer(int fd, void * ptr, size_t size);
 bool parseBlobSize(XMLEle * blobWithAttachedBuffer, ssize_t &size);
+/* rewrite the encoding='ieee754' values of a setNumberVector as text */
+void decodeNumbers(XMLEle * root);
 XMLEle * cloneXMLEleWithReplacementMap(XMLEle * root, const std::unordered_map<XMLEle*, XMLEle*> &replacement);
 
 #define STRINGIFY_TOK(x) #x
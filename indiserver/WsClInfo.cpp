@@ -0,0 +1,299 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "WsClInfo.hpp"
+#include "Utils.hpp"
+#include "CommandLineArgs.hpp"
+
+#include "base64.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+/* SHA-1 of data, only for the handshake key */
+static void sha1(const std::string &data, unsigned char digest[20])
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string msg = data;
+    uint64_t bits = uint64_t(data.size()) * 8;
+    msg.push_back('\x80');
+    while (msg.size() % 64 != 56)
+        msg.push_back('\0');
+    for (int i = 7; i >= 0; i--)
+        msg.push_back(static_cast<char>(bits >> (8 * i)));
+
+    auto rol = [](uint32_t v, int n)
+    {
+        return (v << n) | (v >> (32 - n));
+    };
+
+    for (size_t block = 0; block < msg.size(); block += 64)
+    {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++)
+        {
+            const unsigned char * p = reinterpret_cast<const unsigned char *>(msg.data()) + block + 4 * i;
+            w[i] = (uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++)
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 20; i++)
+        digest[i] = static_cast<unsigned char>(h[i / 4] >> (8 * (3 - i % 4)));
+}
+
+/* value of the given header of an HTTP request, empty if missing. Names are case insensitive */
+static std::string headerValue(const std::string &request, const char * name)
+{
+    size_t nameLength = strlen(name);
+    size_t pos = request.find("\r\n");
+    while (pos != std::string::npos)
+    {
+        pos += 2;
+        size_t end = request.find("\r\n", pos);
+        std::string line = request.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        if (line.size() > nameLength && line[nameLength] == ':' && !strncasecmp(line.c_str(), name, nameLength))
+        {
+            size_t first = line.find_first_not_of(" \t", nameLength + 1);
+            size_t last = line.find_last_not_of(" \t");
+            return first == std::string::npos ? std::string() : line.substr(first, last - first + 1);
+        }
+        pos = end;
+    }
+    return std::string();
+}
+
+/* true if the comma separated list has the given token, ignoring case */
+static bool hasToken(const std::string &list, const char * token)
+{
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        size_t first = list.find_first_not_of(" \t", pos);
+        size_t last = list.find_last_not_of(" \t", end - 1);
+        if (first < end && last != std::string::npos && last >= first
+                && last - first + 1 == strlen(token) && !strncasecmp(list.c_str() + first, token, strlen(token)))
+            return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+WsClInfo::WsClInfo() : ClInfo(false)
+{
+}
+
+std::string WsClInfo::acceptKey(const std::string &key)
+{
+    unsigned char digest[20];
+    sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+
+    unsigned char encoded[32];
+    int length = to64frombits_s(encoded, digest, sizeof(digest), sizeof(encoded));
+    return std::string(reinterpret_cast<char *>(encoded), std::max(length, 0));
+}
+
+bool WsClInfo::writeRaw(const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t nw = write(getWFd(), data.data() + sent, data.size() - sent);
+        if (nw < 0 && errno == EINTR)
+            continue;
+        if (nw <= 0)
+        {
+            log(fmt("write: %s\n", nw < 0 ? strerror(errno) : "nothing written"));
+            return false;
+        }
+        sent += nw;
+    }
+    return true;
+}
+
+bool WsClInfo::handshake(const std::string &request)
+{
+    std::string key = headerValue(request, "Sec-WebSocket-Key");
+    if (request.compare(0, 4, "GET ") || !hasToken(headerValue(request, "Upgrade"), "websocket") || key.empty())
+    {
+        log("not a web socket upgrade request\n");
+        writeRaw("HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+        return false;
+    }
+
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " + acceptKey(key) + "\r\n";
+    // Only offered when asked for, browsers fail the connection otherwise
+    if (hasToken(headerValue(request, "Sec-WebSocket-Protocol"), "indi"))
+        response += "Sec-WebSocket-Protocol: indi\r\n";
+    response += "\r\n";
+
+    if (userConfigurableArguments->verbosity > 0)
+        log("web socket upgraded\n");
+    return writeRaw(response);
+}
+
+bool WsClInfo::processInput(char * buf, size_t nr)
+{
+    if (upgraded)
+        return processFrames(buf, nr);
+
+    request.append(buf, nr);
+    size_t end = request.find("\r\n\r\n");
+    if (end == std::string::npos)
+    {
+        if (request.size() <= maxRequestLength)
+            return true;
+        log("web socket upgrade request too long\n");
+        requestClose();
+        return false;
+    }
+
+    if (!handshake(request.substr(0, end + 2)))
+    {
+        requestClose();
+        return false;
+    }
+    upgraded = true;
+
+    // A client may not wait for the answer to send its first frames
+    std::string rest = request.substr(end + 4);
+    request = std::string();
+    return rest.empty() || processFrames(&rest[0], rest.size());
+}
+
+bool WsClInfo::processFrames(char * buf, size_t nr)
+{
+    size_t pos = 0;
+    while (pos < nr)
+    {
+        if (!inPayload)
+        {
+            header[headerLength++] = buf[pos++];
+            size_t needed = 2;
+            if (headerLength >= 2)
+            {
+                int length = header[1] & 0x7F;
+                needed += (length == 126 ? 2 : length == 127 ? 8 : 0) + 4;
+            }
+            if (headerLength < needed)
+                continue;
+
+            // Client frames are always masked
+            if (!(header[1] & 0x80))
+            {
+                log("unmasked web socket frame\n");
+                requestClose();
+                return false;
+            }
+
+            int opcode = header[0] & 0x0F;
+            uint64_t length = header[1] & 0x7F;
+            size_t at = 2;
+            if (length == 126)
+            {
+                length = (uint64_t(header[2]) << 8) | header[3];
+                at = 4;
+            }
+            else if (length == 127)
+            {
+                length = 0;
+                for (int i = 0; i < 8; i++)
+                    length = (length << 8) | header[2 + i];
+                at = 10;
+            }
+            memcpy(mask, header + at, sizeof(mask));
+            headerLength = 0;
+            maskPos = 0;
+
+            if (opcode == 0x8)
+            {
+                if (userConfigurableArguments->verbosity > 0)
+                    log("web socket closed by the client\n");
+                requestClose();
+                return false;
+            }
+            controlFrame = opcode >= 0x8;
+            if (opcode == 0x1)
+                textMessage = true;
+            else if (opcode == 0x2)
+                textMessage = false;
+
+            payloadLeft = length;
+            inPayload = payloadLeft > 0;
+            continue;
+        }
+
+        size_t n = static_cast<size_t>(std::min<uint64_t>(nr - pos, payloadLeft));
+        for (size_t i = 0; i < n; i++)
+            buf[pos + i] ^= mask[(maskPos + i) & 3];
+        maskPos += n;
+        payloadLeft -= n;
+        inPayload = payloadLeft > 0;
+
+        if (textMessage && !controlFrame && !processXml(buf + pos, n))
+            return false;
+        pos += n;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+/* INDI Server for protocol version 1.7.
+ * Copyright (C) 2007 Elwood C. Downey <ecdowney@clearskyinstitute.com>
+                 2013 Jasem Mutlaq <mutlaqja@ikarustech.com>
+                 2022 Ludovic Pollet
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include "ClInfo.hpp"
+
+#include <atomic>
+#include <string>
+
+/* A client speaking INDI over a web socket, for web browsers (RFC 6455).
+ * It is a regular client once the HTTP upgrade is done: its text frames carry the xml, and
+ * messages to it go in frames, see SerializedMsgWithWebSocketFrames.
+ * Browsers do not ping, so control frames other than close are skipped.
+ */
+class WsClInfo: public ClInfo
+{
+        static constexpr size_t maxRequestLength {8192};
+
+        std::atomic<bool> upgraded {false};
+        std::string request;                /* HTTP upgrade request, until its blank line */
+
+        /* Frame being received */
+        unsigned char header[14];
+        size_t headerLength {0};
+        bool inPayload {false};
+        uint64_t payloadLeft {0};
+        unsigned char mask[4];
+        size_t maskPos {0};
+        bool textMessage {false};           /* The data frames are those of a text message */
+        bool controlFrame {false};
+
+        /* answer the upgrade request. return false if it is not one */
+        bool handshake(const std::string &request);
+
+        /* unmask the frames in buf and parse the payload of text messages */
+        bool processFrames(char * buf, size_t nr);
+
+        /* write all of data to the socket, before anything is queued */
+        bool writeRaw(const std::string &data);
+
+    protected:
+        virtual bool processInput(char * buf, size_t nr);
+
+    public:
+        WsClInfo();
+
+        virtual bool acceptWebSocketFrames() const
+        {
+            return upgraded;
+        }
+
+        /* The BLOBs it gets are raw, in binary frames */
+        virtual bool acceptBinaryBlobs() const
+        {
+            return true;
+        }
+
+        /* Sec-WebSocket-Accept of a key */
+        static std::string acceptKey(const std::string &key);
+};
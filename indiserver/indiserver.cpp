@@ -43,6 +43,9 @@
  * consumer is finished. XMLEle are converted to linear strings before being
  * sent to optimize write system calls and avoid blocking to slow clients.
  * Clients that get more than maxqsiz bytes behind are shut down.
+ * With -j, client sockets are read, parsed and written from a pool of io
+ * threads, each with its own loop. Routing between drivers and clients, and
+ * the lifetime of messages, remain in the main loop.
  */
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE // needed for siginfo_t and sigaction
@@ -53,13 +56,20 @@
 #include "DvrInfo.hpp"
 #include "LocalDrvInfo.hpp"
 #include "RemoteDvrInfo.hpp"
+#include "PluginDvrInfo.hpp"
 #include "TcpServer.hpp"
 #include "UnixServer.hpp"
 #include "Utils.hpp"
 #include "Constants.hpp"
 #include "CommandLineArgs.hpp"
+#include "IoWorker.hpp"
+#include "EncodePool.hpp"
+#include "IoUring.hpp"
+#include "SerializedMsg.hpp"
+#include "Recorder.hpp"
 
 #include "config.h"
+#include <algorithm>
 #include <string>
 
 #include <assert.h>
@@ -107,20 +117,46 @@ void usage(void)
     fprintf(stderr, "INDI Library: %s\nCode %s. Protocol %g.\n", CMAKE_INDI_VERSION_STRING, GIT_TAG_STRING, INDIV);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, " -l d     : log driver messages to <d>/YYYY-MM-DD.islog\n");
+    fprintf(stderr, " -o file  : record the number, switch and light values of drivers to a telemetry file\n");
+    fprintf(stderr, " -q list  : only record these, like \"Mount.EQUATORIAL_EOD_COORD,CCD*.CCD_TEMPERATURE\"\n");
+    fprintf(stderr, "            (device.property[.element] with * and ? wildcards), default everything\n");
     fprintf(stderr, " -m m     : kill client if gets more than this many MB behind, default %d\n", defaultMaxQueueSizeMB);
     fprintf(stderr,
             " -d m     : drop streaming blobs if client gets more than this many MB behind, default %d. 0 to disable\n",
             defaultMaxStreamSizeMB);
 #ifdef ENABLE_INDI_SHARED_MEMORY
     fprintf(stderr, " -u path  : Path for the local connection socket (abstract), default %s\n", INDIUNIXSOCK);
+    fprintf(stderr, " -w kb    : local drivers write messages to a shared memory ring of kb KiB, default 0 (socket)\n");
 #endif
     fprintf(stderr, " -p p     : alternate IP port, default %d\n", indiPortDefault);
+    fprintf(stderr, " -x p     : also serve web socket clients (web browsers) on port p, BLOBs in binary frames\n");
     fprintf(stderr, " -r r     : maximum driver restarts on error, default %d\n", defaultMaximumRestarts);
-    fprintf(stderr, " -f path  : Path to fifo for dynamic startup and shutdown of drivers.\n");
+    fprintf(stderr, " -k       : warm restarts: clients keep the properties of a local driver while it restarts\n");
+    fprintf(stderr, "            and only get what its new instance defines differently\n");
+    fprintf(stderr, " -f path  : Path to fifo for dynamic startup and shutdown of drivers,\n");
+    fprintf(stderr, "            \"metrics [file]\" reports of queues and latencies,\n");
+    fprintf(stderr, "            and \"bandwidth kb [client]\" changes of the -b budget.\n");
+    fprintf(stderr, " -b kb    : send at most kb KiB/s to each network client, default 0 (no limit)\n");
+#ifdef __linux__
+    fprintf(stderr, " -n kb    : keep at most kb KiB unsent in the socket of clients getting BLOBs, so that\n");
+    fprintf(stderr, "            small updates queue in the server and overtake them. Default 0 (kernel setting)\n");
+#endif
+    fprintf(stderr, " -a s     : scheduling of local drivers, with s like \"cpus=2,4-7 fifo=40 nice=-5 mlock\"\n");
+    fprintf(stderr, "            (cpus=list, fifo=prio, rr=prio, nice=n, mlock). Also -a \"s\" on a fifo start line\n");
+    fprintf(stderr, " -t s     : scheduling of the server own threads, same settings as -a\n");
+    fprintf(stderr, " -s       : stream BLOBs: a new frame replaces the unsent one of each client\n");
+    fprintf(stderr, "            clients may choose with enableBLOB frames='latest' or 'all'\n");
+    fprintf(stderr, " -j n     : serve clients from n io threads, default 0 (everything in main loop)\n");
+#ifdef __linux__
+    fprintf(stderr, " -i       : submit the writes of each loop in batches to an io_uring, if the kernel allows\n");
+#endif
+    fprintf(stderr, " -e n     : base64 encode large BLOBs from n threads, default 4. 0 to disable\n");
+    fprintf(stderr, " -c m     : keep at most m MB of encoded BLOBs in memory, more goes to temp files, default 0 (no limit)\n");
     fprintf(stderr, " -v       : show key events, no traffic\n");
     fprintf(stderr, " -vv      : -v + key message content\n");
     fprintf(stderr, " -vvv     : -vv + complete xml\n");
-    fprintf(stderr, "driver    : executable or [device]@host[:port]\n");
+    fprintf(stderr, "driver    : executable, [device]@host[:port], or plugin.so run in the server\n");
+    fprintf(stderr, "            (each in its own link map, sharing the server process and its fate)\n");
 
     exit(2);
 }
@@ -169,6 +205,24 @@ int main(int ac, char *av[])
                     userConfigurableArguments->loggingDir = *++av;
                     ac--;
                     break;
+                case 'o':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-o requires telemetry file\n");
+                        usage();
+                    }
+                    userConfigurableArguments->telemetryFile = *++av;
+                    ac--;
+                    break;
+                case 'q':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-q requires list of recorded properties\n");
+                        usage();
+                    }
+                    userConfigurableArguments->telemetrySelection = *++av;
+                    ac--;
+                    break;
                 case 'm':
                     if (ac < 2)
                     {
@@ -206,6 +260,15 @@ int main(int ac, char *av[])
                     UnixServer::unixSocketPath = *++av;
                     ac--;
                     break;
+                case 'w':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-w requires ring size in KiB\n");
+                        usage();
+                    }
+                    userConfigurableArguments->sharedRingKB = std::max(0, atoi(*++av));
+                    ac--;
+                    break;
 #endif // ENABLE_INDI_SHARED_MEMORY
                 case 'f':
                     if (ac < 2)
@@ -218,6 +281,93 @@ int main(int ac, char *av[])
                     fifoHandle = fifoHandleOwner.get();
                     ac--;
                     break;
+                case 'j':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-j requires number of io threads\n");
+                        usage();
+                    }
+                    userConfigurableArguments->ioWorkers = std::max(0, atoi(*++av));
+                    ac--;
+                    break;
+                case 'e':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-e requires number of encoding threads\n");
+                        usage();
+                    }
+                    userConfigurableArguments->encodeThreads = std::max(0, atoi(*++av));
+                    ac--;
+                    break;
+                case 'c':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-c requires max MB of encoded BLOBs in memory\n");
+                        usage();
+                    }
+                    userConfigurableArguments->serializedMemoryMB = std::max(0, atoi(*++av));
+                    ac--;
+                    break;
+                case 'b':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-b requires KiB/s per client\n");
+                        usage();
+                    }
+                    userConfigurableArguments->clientRateKB = std::max(0, atoi(*++av));
+                    ac--;
+                    break;
+#ifdef __linux__
+                case 'n':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-n requires KiB left unsent per client\n");
+                        usage();
+                    }
+                    userConfigurableArguments->notSentLowatKB = std::max(0, atoi(*++av));
+                    ac--;
+                    break;
+#endif
+                case 'a':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-a requires driver scheduling settings\n");
+                        usage();
+                    }
+                    if (!userConfigurableArguments->driverScheduling.parse(*++av))
+                        usage();
+                    ac--;
+                    break;
+                case 't':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-t requires server scheduling settings\n");
+                        usage();
+                    }
+                    if (!userConfigurableArguments->serverScheduling.parse(*++av))
+                        usage();
+                    ac--;
+                    break;
+                case 's':
+                    userConfigurableArguments->latestFrameWins = true;
+                    break;
+                case 'k':
+                    userConfigurableArguments->warmRestart = true;
+                    break;
+                case 'x':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-x requires web socket port\n");
+                        usage();
+                    }
+                    userConfigurableArguments->webSocketPort = atoi(*++av);
+                    ac--;
+                    break;
+#ifdef __linux__
+                case 'i':
+                    userConfigurableArguments->ioUring = true;
+                    break;
+#endif
                 case 'r':
                     if (ac < 2)
                     {
@@ -245,28 +395,69 @@ int main(int ac, char *av[])
     /* take care of some unixisms */
     noSIGPIPE();
 
-    std::vector<std::unique_ptr<DvrInfo>> drivers(ac);
+    /* before any thread is created, they inherit it. Drivers don't */
+    Scheduling::saveInherited();
+    userConfigurableArguments->serverScheduling.applyToServer();
+
+    /* rings are created by each loop as its queues get their fds */
+    IoUring::enabled = userConfigurableArguments->ioUring;
+
+    /* before drivers send anything */
+    if (userConfigurableArguments->telemetryFile &&
+            !Recorder::start(userConfigurableArguments->telemetryFile, userConfigurableArguments->telemetrySelection))
+        Bye();
 
-    /* start each driver */
+    std::vector<std::unique_ptr<DvrInfo>> drivers;
+    drivers.reserve(ac);
+
+    /* start each driver. start() does not wait for the driver: all of them
+     * define their properties concurrently once the loop runs */
     while (ac-- > 0)
     {
         std::string dvrName = *av++;
         if (dvrName.find('@') != std::string::npos)
         {
-            drivers.push_back(std::make_unique<RemoteDvrInfo>());
+            /* devices of the same server share a connection */
+            RemoteDvrInfo::launch(dvrName);
+            continue;
         }
-        else
+        if (PluginDvrInfo::isPlugin(dvrName))
         {
-            drivers.push_back(std::make_unique<LocalDvrInfo>());
+            drivers.push_back(std::make_unique<PluginDvrInfo>());
+            drivers.back()->name = dvrName;
+            drivers.back()->start();
+            continue;
         }
-        drivers.back()->name = dvrName;
+        auto localDp = std::make_unique<LocalDvrInfo>();
+        localDp->name = dvrName;
+        localDp->scheduling = userConfigurableArguments->driverScheduling;
+        drivers.push_back(std::move(localDp));
         drivers.back()->start();
     }
 
+    /* client io threads, if requested. Drivers stay on the main loop */
+    IoWorker::startPool(loop, userConfigurableArguments->ioWorkers);
+    if (userConfigurableArguments->verbosity > 0 && userConfigurableArguments->ioWorkers > 0)
+        log(fmt("serving clients from %u io threads\n", userConfigurableArguments->ioWorkers));
+
+    /* large BLOBs are base64 encoded from a shared pool of threads */
+    EncodePool::start(userConfigurableArguments->encodeThreads);
+
+    /* encoded content that one slow client keeps waiting beyond that goes to temp files */
+    SerializedMsg::memoryLimit = userConfigurableArguments->serializedMemoryMB * 1024ul * 1024ul;
+
     /* announce we are online */
     const auto tcpServer = std::make_unique<TcpServer>(userConfigurableArguments->port);
     tcpServer->listen();
 
+    /* web browsers connect on their own port */
+    std::unique_ptr<TcpServer> webSocketServer;
+    if (userConfigurableArguments->webSocketPort)
+    {
+        webSocketServer = std::make_unique<TcpServer>(userConfigurableArguments->webSocketPort, true);
+        webSocketServer->listen();
+    }
+
 #ifdef ENABLE_INDI_SHARED_MEMORY
     /* create a new unix server */
     const auto unixServer = std::make_unique<UnixServer>(UnixServer::unixSocketPath);
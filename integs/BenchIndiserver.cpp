@@ -0,0 +1,499 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+/*
+ * Throughput and latency benchmark of indiserver.
+ *
+ * Starts indiserver with N fake drivers and connects M clients. Each driver sends number updates at a
+ * fixed rate and, optionally, BLOBs of a given size, either inline in base64 or as shared buffers.
+ * Every message carries the time it was sent, which the clients compare with the time it arrived.
+ *
+ * Run it from the integs build directory, like the tests:
+ *     ./BenchIndiserver --drivers=4 --clients=2 --rate=200 --blob-size=1048576 --blob-rate=5 --duration=10
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+#include "SharedBuffer.h"
+#include "DriverMock.h"
+#include "IndiServerController.h"
+#include "IndiClientMock.h"
+
+struct BenchOptions
+{
+    int drivers = 1;
+    int clients = 1;
+    double rate = 100;          // number updates per second and driver
+    int elements = 1;           // numbers per update
+    long blobSize = 0;          // bytes, 0 for no BLOBs
+    double blobRate = 0;        // BLOBs per second and driver
+    bool sharedBlobs = false;   // drivers attach BLOBs as shared buffers instead of base64
+    bool unixClients = false;   // clients connect over the unix socket instead of TCP
+    double duration = 10;       // seconds
+};
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: BenchIndiserver [options]\n"
+            " --drivers=N     fake drivers, default 1\n"
+            " --clients=M     clients, default 1\n"
+            " --rate=X        number updates per second and driver, default 100\n"
+            " --elements=K    numbers per update, default 1\n"
+            " --blob-size=Y   BLOB size in bytes, default 0 (no BLOBs)\n"
+            " --blob-rate=Z   BLOBs per second and driver, default 0\n"
+            " --shared        drivers send BLOBs as shared buffers\n"
+            " --unix          clients connect over the unix socket\n"
+            " --duration=S    seconds of load, default 10\n");
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        std::string value = arg.find('=') == std::string::npos ? "" : arg.substr(arg.find('=') + 1);
+        std::string name = arg.substr(0, arg.find('='));
+
+        if (name == "--drivers")
+            options.drivers = std::max(1, atoi(value.c_str()));
+        else if (name == "--clients")
+            options.clients = std::max(1, atoi(value.c_str()));
+        else if (name == "--rate")
+            options.rate = atof(value.c_str());
+        else if (name == "--elements")
+            options.elements = std::max(1, atoi(value.c_str()));
+        else if (name == "--blob-size")
+            options.blobSize = atol(value.c_str());
+        else if (name == "--blob-rate")
+            options.blobRate = atof(value.c_str());
+        else if (name == "--shared")
+            options.sharedBlobs = true;
+        else if (name == "--unix")
+            options.unixClients = true;
+        else if (name == "--duration")
+            options.duration = atof(value.c_str());
+        else
+            return false;
+    }
+    if (options.blobSize <= 0)
+        options.blobRate = 0;
+    return true;
+}
+
+/**
+ * Finds the send time of each message in a client stream, the latency is taken once the whole message
+ * arrived. Markers may be split between reads, so the end of each read is kept until the next one.
+ */
+class StreamScanner
+{
+        std::string pending;
+        int64_t sentAt = -1;
+    public:
+        std::vector<int64_t> latencies;
+        uint64_t definitions = 0;
+
+        void feed(const char * data, size_t size, int64_t receivedAt)
+        {
+            pending.append(data, size);
+
+            size_t pos = 0, done = 0;
+            while (true)
+            {
+                size_t marker = pending.find("message=", pos);
+                size_t close = pending.find("</set", pos);
+                size_t def = pending.find("<defNumberVector", pos);
+                size_t next = std::min(marker, std::min(close, def));
+                if (next == std::string::npos)
+                    break;
+
+                if (next == def)
+                {
+                    definitions++;
+                    pos = done = def + 16;
+                }
+                else if (next == close)
+                {
+                    if (sentAt >= 0)
+                        latencies.push_back(receivedAt - sentAt);
+                    sentAt = -1;
+                    pos = done = close + 5;
+                }
+                else
+                {
+                    // message="t=123456"
+                    size_t value = marker + 9;
+                    size_t end = value + 2 < pending.size() ? pending.find_first_of("\"'", value) : std::string::npos;
+                    if (end == std::string::npos)
+                        break;
+                    if (pending.compare(value, 2, "t=") == 0)
+                        sentAt = atoll(pending.c_str() + value + 2);
+                    pos = done = end;
+                }
+            }
+
+            // Keep what may be the start of a marker
+            size_t keep = std::max(done, pending.size() > 32 ? pending.size() - 32 : 0);
+            pending.erase(0, keep);
+        }
+};
+
+class BenchClient
+{
+    public:
+        IndiClientMock client;
+        StreamScanner scanner;
+        std::atomic<uint64_t> bytes {0};
+        std::atomic<uint64_t> definitions {0};
+        std::atomic<uint64_t> messages {0};
+        std::thread reader;
+
+        void read(std::atomic<bool> &stop)
+        {
+            int fd = client.cnx.getReadFd();
+            std::vector<char> buffer(256 * 1024);
+            while (!stop)
+            {
+                struct pollfd pfd = { fd, POLLIN, 0 };
+                if (poll(&pfd, 1, 100) <= 0)
+                    continue;
+
+                union
+                {
+                    struct cmsghdr cmsgh;
+                    char control[CMSG_SPACE(16 * sizeof(int))];
+                } control_un;
+                struct iovec iov = { buffer.data(), buffer.size() };
+                struct msghdr msgh;
+                memset(&msgh, 0, sizeof(msgh));
+                msgh.msg_iov = &iov;
+                msgh.msg_iovlen = 1;
+                msgh.msg_control = control_un.control;
+                msgh.msg_controllen = sizeof(control_un.control);
+
+                ssize_t n = recvmsg(fd, &msgh, 0);
+                if (n <= 0)
+                {
+                    fprintf(stderr, "client connection closed\n");
+                    return;
+                }
+                int64_t receivedAt = nowNs();
+
+                // Shared buffers count as received once they are
+                for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgh); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgh, cmsg))
+                {
+                    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+                        continue;
+                    int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    for (int i = 0; i < count; i++)
+                    {
+                        int blobFd = reinterpret_cast<int *>(CMSG_DATA(cmsg))[i];
+                        struct stat st;
+                        if (fstat(blobFd, &st) == 0)
+                            bytes += st.st_size;
+                        ::close(blobFd);
+                    }
+                }
+
+                bytes += n;
+                scanner.feed(buffer.data(), n, receivedAt);
+                definitions = scanner.definitions;
+                messages = scanner.latencies.size();
+            }
+        }
+};
+
+class BenchDriver
+{
+    public:
+        DriverMock driver;
+        std::string name;
+        std::atomic<uint64_t> sent {0};
+        std::thread writer;
+        std::thread drain;
+
+        void establish()
+        {
+            driver.waitEstablish();
+            driver.cnx.expectXml("<getProperties version='1.7' numbers='ieee754' blobs='attached'/>");
+            driver.cnx.expectXml("<pingRequest uid='getProperties/1'/>");
+        }
+
+        void define(const BenchOptions &options)
+        {
+            std::string def = "<defNumberVector device='" + name +
+                              "' name='bench' label='bench' group='bench' state='Idle' perm='ro' timeout='0'>\n";
+            for (int i = 0; i < options.elements; i++)
+                def += "<defNumber name='e" + std::to_string(i) + "' label='e' format='%g' min='0' max='0' step='0'>0</defNumber>\n";
+            def += "</defNumberVector>\n";
+            if (options.blobSize > 0)
+                def += "<defBLOBVector device='" + name + "' name='benchblob' label='bench' group='bench' state='Idle' perm='ro' timeout='0'>\n"
+                       "<defBLOB name='content' label='content'/>\n"
+                       "</defBLOBVector>\n";
+            driver.cnx.send(def);
+        }
+
+        // What clients send goes to the drivers too, do not let it fill the pipe
+        void discard(std::atomic<bool> &stop)
+        {
+            int fd = driver.cnx.getReadFd();
+            char buffer[4096];
+            while (!stop)
+            {
+                struct pollfd pfd = { fd, POLLIN, 0 };
+                if (poll(&pfd, 1, 100) > 0 && ::read(fd, buffer, sizeof(buffer)) <= 0)
+                    return;
+            }
+        }
+
+        void run(const BenchOptions &options, int64_t until, const std::string &base64)
+        {
+            using namespace std::chrono;
+            auto start = steady_clock::now();
+            auto deadline = start + nanoseconds(until - nowNs());
+            auto numberPeriod = options.rate > 0 ? duration<double>(1.0 / options.rate) : duration<double>(0);
+            auto blobPeriod = options.blobRate > 0 ? duration<double>(1.0 / options.blobRate) : duration<double>(0);
+            auto nextNumber = start;
+            auto nextBlob = start;
+
+            std::string size = std::to_string(options.blobSize);
+            try
+            {
+                while (true)
+                {
+                    bool number = options.rate > 0 && (options.blobRate <= 0 || nextNumber <= nextBlob);
+                    auto next = number ? nextNumber : nextBlob;
+                    if ((options.rate <= 0 && options.blobRate <= 0) || next >= deadline)
+                        break;
+                    std::this_thread::sleep_until(next);
+
+                    std::string vector = "' state='Ok' message='t=" + std::to_string(nowNs()) + "'>\n";
+                    if (number)
+                    {
+                        std::string message = "<setNumberVector device='" + name + "' name='bench" + vector;
+                        for (int i = 0; i < options.elements; i++)
+                            message += "<oneNumber name='e" + std::to_string(i) + "'>" + std::to_string(sent.load()) + "</oneNumber>\n";
+                        message += "</setNumberVector>\n";
+                        driver.cnx.send(message);
+                        nextNumber += duration_cast<steady_clock::duration>(numberPeriod);
+                    }
+                    else if (options.sharedBlobs)
+                    {
+                        SharedBuffer buffer;
+                        buffer.allocate(options.blobSize);
+                        driver.cnx.send("<setBLOBVector device='" + name + "' name='benchblob" + vector);
+                        driver.cnx.send("<oneBLOB name='content' size='" + size + "' format='.bin' attached='true'/>\n", buffer);
+                        driver.cnx.send("</setBLOBVector>\n");
+                        buffer.release();
+                        nextBlob += duration_cast<steady_clock::duration>(blobPeriod);
+                    }
+                    else
+                    {
+                        driver.cnx.send("<setBLOBVector device='" + name + "' name='benchblob" + vector +
+                                        "<oneBLOB name='content' size='" + size + "' format='.bin' enclen='" +
+                                        std::to_string(base64.size()) + "'>\n" + base64 + "\n</oneBLOB>\n</setBLOBVector>\n");
+                        nextBlob += duration_cast<steady_clock::duration>(blobPeriod);
+                    }
+                    sent++;
+                }
+            }
+            catch (std::exception &e)
+            {
+                fprintf(stderr, "%s: %s\n", name.c_str(), e.what());
+            }
+        }
+};
+
+// utime + stime of a process in seconds
+static double processCpuSeconds(pid_t pid)
+{
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string content((std::istreambuf_iterator<char>(stat)), std::istreambuf_iterator<char>());
+    size_t end = content.rfind(')');
+    if (end == std::string::npos)
+        return -1;
+
+    // Fields after the command name, utime and stime are the 12th and 13th
+    const char * p = content.c_str() + end + 2;
+    unsigned long long utime = 0, stime = 0;
+    if (sscanf(p, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2)
+        return -1;
+    return static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static double percentile(const std::vector<int64_t> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+    return sorted[index] / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+
+    setupSigPipe();
+
+    IndiServerController indiServer;
+    indiServer.setFifo(options.drivers > 1);
+    indiServer.setVerbose(false);
+
+    std::string fakeDriverPath = getTestExePath("fakedriver");
+    std::vector<std::unique_ptr<BenchDriver>> drivers;
+    for (int i = 0; i < options.drivers; i++)
+    {
+        drivers.emplace_back(new BenchDriver());
+        BenchDriver &driver = *drivers.back();
+        driver.name = "bench" + std::to_string(i);
+        driver.driver.setup();
+        if (i == 0)
+            indiServer.startDriver(fakeDriverPath);
+        else
+            indiServer.addDriver(fakeDriverPath);
+        driver.establish();
+        driver.define(options);
+    }
+
+    std::atomic<bool> stopDrain {false};
+    for (auto &driver : drivers)
+        driver->drain = std::thread(&BenchDriver::discard, driver.get(), std::ref(stopDrain));
+
+    std::atomic<bool> stopRead {false};
+    std::vector<std::unique_ptr<BenchClient>> clients;
+    for (int i = 0; i < options.clients; i++)
+    {
+        clients.emplace_back(new BenchClient());
+        BenchClient &client = *clients.back();
+        if (options.unixClients)
+            client.client.connectUnix(indiServer);
+        else
+            client.client.connectTcp(indiServer);
+
+        // Before getProperties, so BLOBs are enabled once the definitions arrive
+        if (options.blobSize > 0)
+            client.client.cnx.send("<enableBLOB>Also</enableBLOB>\n");
+        client.client.cnx.send("<getProperties version='1.7'/>\n");
+        client.reader = std::thread(&BenchClient::read, &client, std::ref(stopRead));
+    }
+
+    // Every client knows every driver before the load starts
+    auto ready = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (auto &client : clients)
+        while (client->definitions < static_cast<uint64_t>(options.drivers) && std::chrono::steady_clock::now() < ready)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::string base64;
+    if (options.blobSize > 0 && !options.sharedBlobs)
+        base64.assign(4 * ((options.blobSize + 2) / 3), 'A');
+
+    fprintf(stderr, "running %d drivers, %d clients for %g s\n", options.drivers, options.clients, options.duration);
+    double cpuStart = processCpuSeconds(indiServer.getPid());
+    int64_t start = nowNs();
+    int64_t until = start + static_cast<int64_t>(options.duration * 1e9);
+    for (auto &driver : drivers)
+        driver->writer = std::thread(&BenchDriver::run, driver.get(), std::cref(options), until, std::cref(base64));
+    for (auto &driver : drivers)
+        driver->writer.join();
+
+    // Let the queues drain, until nothing arrives for a while
+    uint64_t sent = 0;
+    for (auto &driver : drivers)
+        sent += driver->sent;
+    uint64_t expected = sent * options.clients;
+    uint64_t received = 0, previous = 0;
+    for (int idle = 0; idle < 20; idle++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        received = 0;
+        for (auto &client : clients)
+            received += client->messages;
+        if (received >= expected)
+            break;
+        if (received != previous)
+            idle = 0;
+        previous = received;
+    }
+    int64_t end = nowNs();
+    double cpuEnd = processCpuSeconds(indiServer.getPid());
+
+    stopRead = true;
+    for (auto &client : clients)
+        client->reader.join();
+    stopDrain = true;
+    for (auto &driver : drivers)
+        driver->drain.join();
+
+    std::vector<int64_t> latencies;
+    uint64_t bytes = 0;
+    for (auto &client : clients)
+    {
+        latencies.insert(latencies.end(), client->scanner.latencies.begin(), client->scanner.latencies.end());
+        bytes += client->bytes;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    double seconds = (end - start) / 1e9;
+    printf("drivers %d, clients %d, rate %g/s, elements %d, blobs %ld bytes at %g/s over %s, clients over %s\n",
+           options.drivers, options.clients, options.rate, options.elements, options.blobSize, options.blobRate,
+           options.sharedBlobs ? "shared buffers" : "base64", options.unixClients ? "unix socket" : "tcp");
+    printf("sent %llu, received %llu of %llu\n", static_cast<unsigned long long>(sent),
+           static_cast<unsigned long long>(latencies.size()), static_cast<unsigned long long>(expected));
+    printf("throughput %.0f msgs/s, %.2f MB/s\n", latencies.size() / seconds, bytes / seconds / 1e6);
+    printf("latency us p50 %.0f, p99 %.0f, p999 %.0f, max %.0f\n", percentile(latencies, 0.5),
+           percentile(latencies, 0.99), percentile(latencies, 0.999), latencies.empty() ? 0 : latencies.back() / 1000.0);
+    if (cpuStart >= 0 && cpuEnd >= 0)
+        printf("indiserver cpu %.1f %%\n", 100 * (cpuEnd - cpuStart) / seconds);
+    else
+        printf("indiserver cpu n/a\n");
+
+    for (auto &driver : drivers)
+        driver->driver.terminateDriver();
+    indiServer.kill();
+    indiServer.join();
+
+    return latencies.size() == expected ? 0 : 2;
+}
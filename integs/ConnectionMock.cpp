@@ -67,6 +67,16 @@ void ConnectionMock::setFds(int rd, int wr)
     bufferReceiveAllowed = false;
 }
 
+int ConnectionMock::getReadFd() const
+{
+    return fds[0];
+}
+
+int ConnectionMock::getWriteFd() const
+{
+    return fds[1];
+}
+
 void ConnectionMock::allowBufferReceive(bool state)
 {
     if ((!state) && receivedFds.size())
@@ -59,6 +59,10 @@ class ConnectionMock
 
         void allowBufferReceive(bool state);
         void expectBuffer(SharedBuffer &fd);
+
+        // Raw descriptors, for users that do their own reading and writing
+        int getReadFd() const;
+        int getWriteFd() const;
 };
 
 
@@ -21,6 +21,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <cstdlib>
+#include <ctime>
 
 #include "utils.h"
 #include "IndiServerController.h"
@@ -34,6 +36,7 @@
 
 IndiServerController::IndiServerController() {
     fifo = false;
+    verbose = true;
 }
 
 IndiServerController::~IndiServerController() {
@@ -47,12 +50,25 @@ void IndiServerController::setFifo(bool fifo) {
     this->fifo = fifo;
 }
 
+void IndiServerController::setVerbose(bool verbose) {
+    this->verbose = verbose;
+}
+
+void IndiServerController::setSimulationSpeed(double speed) {
+    // Inherited by indiserver and its drivers, which then share the same simulated time
+    setenv("INDI_SIMULATION_SPEED", std::to_string(speed).c_str(), 1);
+    setenv("INDI_SIMULATION_EPOCH", std::to_string(time(nullptr)).c_str(), 1);
+}
+
 void IndiServerController::start(const std::vector<std::string> & args) {
     ProcessController::start("../indiserver/indiserver", args);
 }
 
 void IndiServerController::startDriver(const std::string & path) {
-    std::vector<std::string> args = { "-p", TO_STRING(TEST_TCP_PORT), "-r", "0", "-vvv" };
+    std::vector<std::string> args = { "-p", TO_STRING(TEST_TCP_PORT), "-r", "0" };
+    if (verbose) {
+        args.push_back("-vvv");
+    }
 #ifdef ENABLE_INDI_SHARED_MEMORY
     args.push_back("-u");
     args.push_back(TEST_UNIX_SOCKET);
@@ -32,10 +32,15 @@
 class IndiServerController : public ProcessController
 {
         bool fifo;
+        bool verbose;
     public:
         IndiServerController();
         ~IndiServerController();
         void setFifo(bool enable);
+        // Log every message (-vvv), on by default. Benchmarks turn it off.
+        void setVerbose(bool enable);
+        // Run the simulators the server starts that many times faster than the wall clock, from now.
+        void setSimulationSpeed(double speed);
         void start(const std::vector<std::string> & args);
 
         void startDriver(const std::string & driver);
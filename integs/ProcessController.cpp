@@ -98,6 +98,10 @@ void ProcessController::start(const std::string & path, const std::vector<std::s
     }
 }
 
+pid_t ProcessController::getPid() const {
+    return pid;
+}
+
 void ProcessController::waitProcessEnd(int exitCode) {
     join();
     expectExitCode(exitCode);
@@ -47,6 +47,9 @@ public:
 
     void waitProcessEnd(int expectedExitCode);
 
+    // -1 when not running
+    pid_t getPid() const;
+
     // Returns 0 on some system. Use checkOpenFdCount for actual verification
     int getOpenFdCount();
 
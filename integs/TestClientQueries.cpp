@@ -75,7 +75,8 @@ static void startFakeDev1(IndiServerController &indiServer, DriverMock &fakeDriv
     fakeDriver.waitEstablish();
     fprintf(stderr, "fake driver started\n");
 
-    fakeDriver.cnx.expectXml("<getProperties version='1.7'/>");
+    fakeDriver.cnx.expectXml("<getProperties version='1.7' numbers='ieee754' blobs='attached'/>");
+    fakeDriver.cnx.expectXml("<pingRequest uid='getProperties/1'/>");
     fprintf(stderr, "getProperties received\n");
 
     driverSendsProps(fakeDriver);
@@ -164,3 +165,83 @@ TEST(TestClientQueries, ServerForwardRequestOfHalfDeadClient)
     // Exit code 1 is expected when driver stopped
     indiServer.waitProcessEnd(1);
 }
+
+static void driverAnswersProps(DriverMock &fakeDriver)
+{
+    // The properties are all defined once the ping following getProperties is answered
+    fakeDriver.cnx.send("<pingReply uid='getProperties/1'/>\n");
+}
+
+static void clientSendsNewNumber(IndiClientMock &indiClient, DriverMock &fakeDriver)
+{
+    indiClient.cnx.send("<newNumberVector device='fakedev1' name='testnumber0' timestamp='2018-01-01T00:00:00'>");
+    indiClient.cnx.send("<oneNumber name='content' > 51 </oneNumber>");
+    indiClient.cnx.send("</newNumberVector>");
+
+    fakeDriver.cnx.expectXml("<newNumberVector device='fakedev1' name='testnumber0' timestamp='2018-01-01T00:00:00'>");
+    fakeDriver.cnx.expectXml("<oneNumber name='content'>");
+    fakeDriver.cnx.expect("\n51");
+    fakeDriver.cnx.expectXml("</oneNumber>");
+    fakeDriver.cnx.expectXml("</newNumberVector>");
+}
+
+TEST(TestClientQueries, ServerAnswersFromDefinitions)
+{
+    DriverMock fakeDriver;
+    IndiServerController indiServer;
+
+    startFakeDev1(indiServer, fakeDriver);
+    driverAnswersProps(fakeDriver);
+
+    IndiClientMock indiClient;
+
+    indiClient.connect(indiServer);
+
+    indiClient.cnx.send("<getProperties version='1.7'/>\n");
+    clientReceivesProps(indiClient);
+
+    // The driver was not asked: the next message it gets is the client's
+    clientSendsNewNumber(indiClient, fakeDriver);
+
+    fakeDriver.terminateDriver();
+    // Exit code 1 is expected when driver stopped
+    indiServer.waitProcessEnd(1);
+}
+
+TEST(TestClientQueries, ServerForwardsWhatDefinitionsDoNotAnswer)
+{
+    DriverMock fakeDriver;
+    IndiServerController indiServer;
+
+    startFakeDev1(indiServer, fakeDriver);
+    fakeDriver.cnx.send("<defSwitchVector device='fakedev1' name='LAZY_extra' label='extra' group='extra' state='Idle' perm='rw' rule='AtMostOne' timeout='0' timestamp='2018-01-01T00:00:00'>\n");
+    fakeDriver.cnx.send("<defSwitch name='LOAD' label='load'>Off</defSwitch>\n");
+    fakeDriver.cnx.send("</defSwitchVector>\n");
+    driverAnswersProps(fakeDriver);
+
+    IndiClientMock indiClient;
+
+    indiClient.connect(indiServer);
+
+    // Asking for the stub of a lazy group defines the group
+    indiClient.cnx.send("<getProperties version='1.7' device='fakedev1' name='LAZY_extra'/>\n");
+    fakeDriver.cnx.expectXml("<getProperties version='1.7' device='fakedev1' name='LAZY_extra'/>");
+
+    // A property never defined may be one the driver withholds
+    indiClient.cnx.send("<getProperties version='1.7' device='fakedev1' name='testnumber9'/>\n");
+    fakeDriver.cnx.expectXml("<getProperties version='1.7' device='fakedev1' name='testnumber9'/>");
+
+    // A defined one is answered from its definition
+    indiClient.cnx.send("<getProperties version='1.7' device='fakedev1' name='testnumber0'/>\n");
+    indiClient.cnx.expectXml("<defNumberVector device='fakedev1' name='testnumber0' label='test label' group='test_group' state='Idle' perm='rw' timeout='100' timestamp='2018-01-01T00:00:00'>");
+    indiClient.cnx.expectXml("<defNumber name='content' label='content' min='0' max='100' step='1'>");
+    indiClient.cnx.expect("\n50");
+    indiClient.cnx.expectXml("</defNumber>");
+    indiClient.cnx.expectXml("</defNumberVector>");
+
+    clientSendsNewNumber(indiClient, fakeDriver);
+
+    fakeDriver.terminateDriver();
+    // Exit code 1 is expected when driver stopped
+    indiServer.waitProcessEnd(1);
+}
@@ -42,8 +42,8 @@ static void startIndiSetProp(ProcessController & indiSetProp, const std::vector<
     indiSetProp.start(indiSetPropPath, args);
 }
 
-static void driverIsAskedProps(DriverMock & fakeDriver) {
-    fakeDriver.cnx.expectXml("<getProperties version='1.7'/>");
+static void driverIsAskedProps(DriverMock & fakeDriver, const std::string & getProperties = "<getProperties version='1.7'/>") {
+    fakeDriver.cnx.expectXml(getProperties);
     fprintf(stderr, "getProperties received\n");
 
     for(int i = 0; i < PROP_COUNT; ++i) {
@@ -67,7 +67,8 @@ static void startFakeDev1(IndiServerController & indiServer, DriverMock & fakeDr
     fakeDriver.waitEstablish();
     fprintf(stderr, "fake driver started\n");
 
-    driverIsAskedProps(fakeDriver);
+    driverIsAskedProps(fakeDriver, "<getProperties version='1.7' numbers='ieee754' blobs='attached'/>");
+    fakeDriver.cnx.expectXml("<pingRequest uid='getProperties/1'/>");
 }
 
 
@@ -69,7 +69,8 @@ TEST(IndiserverSingleDriver, ReplyToPing)
     fakeDriver.waitEstablish();
     fprintf(stderr, "fake driver started\n");
 
-    fakeDriver.cnx.expectXml("<getProperties version='1.7'/>");
+    fakeDriver.cnx.expectXml("<getProperties version='1.7' numbers='ieee754' blobs='attached'/>");
+    fakeDriver.cnx.expectXml("<pingRequest uid='getProperties/1'/>");
     fprintf(stderr, "getProperties received");
 
     // Establish a client & send ping
@@ -113,7 +114,8 @@ static void establishDriver(IndiServerController &indiServer, DriverMock &fakeDr
     fakeDriver.waitEstablish();
     fprintf(stderr, "fake driver started\n");
 
-    fakeDriver.cnx.expectXml("<getProperties version='1.7'/>");
+    fakeDriver.cnx.expectXml("<getProperties version='1.7' numbers='ieee754' blobs='attached'/>");
+    fakeDriver.cnx.expectXml("<pingRequest uid='getProperties/1'/>");
     fprintf(stderr, "getProperties received\n");
 
     // Give one props to the driver
@@ -8,15 +8,10 @@
 #include "libastro.h"
 #include <libnova/julian_day.h>
 
-#include <gsl/gsl_blas.h>
-#include <gsl/gsl_permutation.h>
-#include <gsl/gsl_linalg.h>
-
 #include "indicom.h"
 
 #include <limits>
 #include <iostream>
-#include <map>
 
 namespace INDI
 {
@@ -24,16 +19,12 @@ namespace AlignmentSubsystem
 {
 BasicMathPlugin::BasicMathPlugin()
 {
-    pActualToApparentTransform = gsl_matrix_alloc(3, 3);
-    pApparentToActualTransform = gsl_matrix_alloc(3, 3);
 }
 
 // Destructor
 
 BasicMathPlugin::~BasicMathPlugin()
 {
-    gsl_matrix_free(pActualToApparentTransform);
-    gsl_matrix_free(pApparentToActualTransform);
 }
 
 // Public methods
@@ -43,6 +34,12 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
     MathPlugin::Initialise(pInMemoryDatabase);
     InMemoryDatabase::AlignmentDatabaseType &SyncPoints = pInMemoryDatabase->GetAlignmentDatabase();
 
+    // The hull faces of the last initialisation are gone or about to be
+    ActualFaceGrid.Clear();
+    ApparentFaceGrid.Clear();
+    LastActualFace   = nullptr;
+    LastApparentFace = nullptr;
+
     /// See how many entries there are in the in memory database.
     /// - If just one use a hint to mounts approximate alignment, this can either be ZENITH,
     /// NORTH_CELESTIAL_POLE or SOUTH_CELESTIAL_POLE. The hint is used to make a dummy second
@@ -123,8 +120,8 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
             DummyApparentDirectionCosine3.Normalise();
             CalculateTransformMatrices(ActualDirectionCosine1, DummyActualDirectionCosine2, DummyActualDirectionCosine3,
                                        Entry1.TelescopeDirection, DummyApparentDirectionCosine2,
-                                       DummyApparentDirectionCosine3, pActualToApparentTransform,
-                                       pApparentToActualTransform);
+                                       DummyApparentDirectionCosine3, ActualToApparentTransform,
+                                       &ApparentToActualTransform);
             return true;
         }
         case 2:
@@ -169,8 +166,8 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
             // The third direction vectors is generated by taking the cross product of the first two
             CalculateTransformMatrices(ActualDirectionCosine1, ActualDirectionCosine2, DummyActualDirectionCosine3,
                                        Entry1.TelescopeDirection, Entry2.TelescopeDirection,
-                                       DummyApparentDirectionCosine3, pActualToApparentTransform,
-                                       pApparentToActualTransform);
+                                       DummyApparentDirectionCosine3, ActualToApparentTransform,
+                                       &ApparentToActualTransform);
             return true;
         }
 
@@ -214,7 +211,7 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
 
             CalculateTransformMatrices(ActualDirectionCosine1, ActualDirectionCosine2, ActualDirectionCosine3,
                                        Entry1.TelescopeDirection, Entry2.TelescopeDirection, Entry3.TelescopeDirection,
-                                       pActualToApparentTransform, pApparentToActualTransform);
+                                       ActualToApparentTransform, &ApparentToActualTransform);
             return true;
         }
 
@@ -224,17 +221,9 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
             if (!pInMemoryDatabase->GetDatabaseReferencePosition(Position))
                 return false;
 
-            // Compute Hulls etc.
-            ActualConvexHull.Reset();
-            ApparentConvexHull.Reset();
-            ActualDirectionCosines.clear();
-
-            // Add a dummy point at the nadir
-            ActualConvexHull.MakeNewVertex(0.0, 0.0, -1.0, 0);
-            ApparentConvexHull.MakeNewVertex(0.0, 0.0, -1.0, 0);
-
-            int VertexNumber = 1;
-            // Add the rest of the vertices
+            // Compute the actual direction cosines of the sync points
+            std::vector<TelescopeDirectionVector> SyncPointDirectionCosines;
+            SyncPointDirectionCosines.reserve(SyncPoints.size());
             for (InMemoryDatabase::AlignmentDatabaseType::const_iterator Itr = SyncPoints.begin();
                     Itr != SyncPoints.end(); Itr++)
             {
@@ -253,20 +242,60 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
                 {
                     ActualDirectionCosine = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec);
                 }
+                SyncPointDirectionCosines.push_back(ActualDirectionCosine);
+            }
+
+            // If sync points were only appended since the hulls were made, add just the new ones to them.
+            // Otherwise the hulls are made again from scratch.
+            auto SameDirection = [](const TelescopeDirectionVector &A, const TelescopeDirectionVector &B)
+            {
+                return A.x == B.x && A.y == B.y && A.z == B.z;
+            };
+            size_t HullPoints = ActualDirectionCosines.size();
+            bool Extend = (nullptr != ActualConvexHull.faces) && (nullptr != ApparentConvexHull.faces) &&
+                          (HullPoints <= SyncPoints.size());
+            for (size_t Point = 0; Extend && Point < HullPoints; Point++)
+                Extend = SameDirection(ActualDirectionCosines[Point], SyncPointDirectionCosines[Point]) &&
+                         SameDirection(ApparentDirectionCosines[Point], SyncPoints[Point].TelescopeDirection);
+
+            if (!Extend)
+            {
+                // Compute Hulls etc.
+                ActualConvexHull.Reset();
+                ApparentConvexHull.Reset();
+                ActualDirectionCosines.clear();
+                ApparentDirectionCosines.clear();
+                HullPoints = 0;
+
+                // Add a dummy point at the nadir
+                ActualConvexHull.MakeNewVertex(0.0, 0.0, -1.0, 0);
+                ApparentConvexHull.MakeNewVertex(0.0, 0.0, -1.0, 0);
+            }
+#ifdef CONVEX_HULL_DEBUGGING
+            ASSDEBUGF("Initialise - %s hulls with %d sync points", Extend ? "Extending" : "Making",
+                      static_cast<int>(SyncPoints.size() - HullPoints));
+#endif
+
+            // Add the rest of the vertices
+            for (size_t Point = HullPoints; Point < SyncPoints.size(); Point++)
+            {
+                const TelescopeDirectionVector &ActualDirectionCosine   = SyncPointDirectionCosines[Point];
+                const TelescopeDirectionVector &ApparentDirectionCosine = SyncPoints[Point].TelescopeDirection;
                 ActualDirectionCosines.push_back(ActualDirectionCosine);
+                ApparentDirectionCosines.push_back(ApparentDirectionCosine);
                 ActualConvexHull.MakeNewVertex(ActualDirectionCosine.x, ActualDirectionCosine.y,
-                                               ActualDirectionCosine.z, VertexNumber);
-                ApparentConvexHull.MakeNewVertex((*Itr).TelescopeDirection.x, (*Itr).TelescopeDirection.y,
-                                                 (*Itr).TelescopeDirection.z, VertexNumber);
-                VertexNumber++;
+                                               ActualDirectionCosine.z, static_cast<int>(Point) + 1);
+                ApparentConvexHull.MakeNewVertex(ApparentDirectionCosine.x, ApparentDirectionCosine.y,
+                                                 ApparentDirectionCosine.z, static_cast<int>(Point) + 1);
             }
             // I should only need to do this once but it is easier to do it twice
-            if (!ActualConvexHull.DoubleTriangle())
+            // ConstructHull only adds the vertices not yet processed, so extended hulls keep their faces
+            if (!Extend && !ActualConvexHull.DoubleTriangle())
                 return false;
             ActualConvexHull.ConstructHull();
             ActualConvexHull.EdgeOrderOnFaces();
 
-            if (!ApparentConvexHull.DoubleTriangle())
+            if (!Extend && !ApparentConvexHull.DoubleTriangle())
                 return false;
 
             ApparentConvexHull.ConstructHull();
@@ -291,7 +320,7 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
                         ASSDEBUGF("Initialise - Ignoring actual face %d", ActualFaces);
 #endif
                     }
-                    else
+                    else if (!CurrentFace->MatrixValid)
                     {
 #ifdef CONVEX_HULL_DEBUGGING
                         ASSDEBUGF("Initialise - Processing actual face %d v1 %d v2 %d v3 %d", ActualFaces,
@@ -304,7 +333,8 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
                                                    SyncPoints[CurrentFace->vertex[0]->vnum - 1].TelescopeDirection,
                                                    SyncPoints[CurrentFace->vertex[1]->vnum - 1].TelescopeDirection,
                                                    SyncPoints[CurrentFace->vertex[2]->vnum - 1].TelescopeDirection,
-                                                   CurrentFace->pMatrix, nullptr);
+                                                   CurrentFace->Matrix, nullptr);
+                        CurrentFace->MatrixValid = true;
                     }
                     CurrentFace = CurrentFace->next;
                 }
@@ -330,7 +360,7 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
                         ASSDEBUGF("Initialise - Ignoring apparent face %d", ApparentFaces);
 #endif
                     }
-                    else
+                    else if (!CurrentFace->MatrixValid)
                     {
 #ifdef CONVEX_HULL_DEBUGGING
                         ASSDEBUGF("Initialise - Processing apparent face %d v1 %d v2 %d v3 %d", ApparentFaces,
@@ -343,13 +373,17 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
                                                    ActualDirectionCosines[CurrentFace->vertex[0]->vnum - 1],
                                                    ActualDirectionCosines[CurrentFace->vertex[1]->vnum - 1],
                                                    ActualDirectionCosines[CurrentFace->vertex[2]->vnum - 1],
-                                                   CurrentFace->pMatrix, nullptr);
+                                                   CurrentFace->Matrix, nullptr);
+                        CurrentFace->MatrixValid = true;
                     }
                     CurrentFace = CurrentFace->next;
                 }
                 while (CurrentFace != ApparentConvexHull.faces);
             }
 
+            ActualFaceGrid.Build(ActualConvexHull, ActualDirectionCosines);
+            ApparentFaceGrid.Build(ApparentConvexHull, ApparentDirectionCosines);
+
 #ifdef CONVEX_HULL_DEBUGGING
             ASSDEBUGF("Initialise - ActualFaces %d ApparentFaces %d", ActualFaces, ApparentFaces);
             ActualConvexHull.PrintObj("ActualHull.obj");
@@ -366,15 +400,96 @@ bool BasicMathPlugin::TransformCelestialToTelescope(const double RightAscension,
         double JulianOffset,
         TelescopeDirectionVector &ApparentTelescopeDirectionVector)
 {
-    INDI::IEquatorialCoordinates ActualRaDec;
-    ActualRaDec.rightascension  = RightAscension;
-    ActualRaDec.declination = Declination;
     IGeographicCoordinates Position { 0, 0, 0 };
 
     // Should check that this the same as the current observing position
     if ((nullptr == pInMemoryDatabase) || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
         return false;
 
+    return CelestialToTelescope(RightAscension, Declination, Position, ln_get_julian_from_sys() + JulianOffset,
+                                ApparentTelescopeDirectionVector);
+}
+
+bool BasicMathPlugin::TransformCelestialToTelescopeBatch(const double *RightAscensions, const double *Declinations,
+        size_t Count, double JulianOffset,
+        TelescopeDirectionVector *ApparentTelescopeDirectionVectors, bool *Succeeded)
+{
+    IGeographicCoordinates Position { 0, 0, 0 };
+
+    // Look the position and the date up once for all the coordinates
+    if ((nullptr == pInMemoryDatabase) || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
+    {
+        for (size_t i = 0; nullptr != Succeeded && i < Count; i++)
+            Succeeded[i] = false;
+        return false;
+    }
+    double JulianDate = ln_get_julian_from_sys() + JulianOffset;
+
+    bool AllSucceeded = true;
+    for (size_t i = 0; i < Count; i++)
+    {
+        bool Result = CelestialToTelescope(RightAscensions[i], Declinations[i], Position, JulianDate,
+                                           ApparentTelescopeDirectionVectors[i]);
+        if (nullptr != Succeeded)
+            Succeeded[i] = Result;
+        AllSucceeded = AllSucceeded && Result;
+    }
+    return AllSucceeded;
+}
+
+bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
+        double &RightAscension, double &Declination)
+{
+    IGeographicCoordinates Position;
+
+    if ((nullptr == pInMemoryDatabase) || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
+    {
+        // Should check that this the same as the current observing position
+        ASSDEBUG("No database or no position in database");
+        return false;
+    }
+    return TelescopeToCelestial(ApparentTelescopeDirectionVector, Position, ln_get_julian_from_sys(), RightAscension,
+                                Declination);
+}
+
+bool BasicMathPlugin::TransformTelescopeToCelestialBatch(const TelescopeDirectionVector *ApparentTelescopeDirectionVectors,
+        size_t Count, double *RightAscensions, double *Declinations,
+        bool *Succeeded)
+{
+    IGeographicCoordinates Position;
+
+    // Look the position and the date up once for all the directions
+    if ((nullptr == pInMemoryDatabase) || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
+    {
+        ASSDEBUG("No database or no position in database");
+        for (size_t i = 0; nullptr != Succeeded && i < Count; i++)
+            Succeeded[i] = false;
+        return false;
+    }
+    double JulianDate = ln_get_julian_from_sys();
+
+    bool AllSucceeded = true;
+    for (size_t i = 0; i < Count; i++)
+    {
+        bool Result = TelescopeToCelestial(ApparentTelescopeDirectionVectors[i], Position, JulianDate,
+                                           RightAscensions[i], Declinations[i]);
+        if (nullptr != Succeeded)
+            Succeeded[i] = Result;
+        AllSucceeded = AllSucceeded && Result;
+    }
+    return AllSucceeded;
+}
+
+// Private methods
+
+bool BasicMathPlugin::CelestialToTelescope(const double RightAscension, const double Declination,
+        IGeographicCoordinates &Position, double JulianDate,
+        TelescopeDirectionVector &ApparentTelescopeDirectionVector)
+{
+    INDI::IEquatorialCoordinates ActualRaDec;
+    ActualRaDec.rightascension  = RightAscension;
+    ActualRaDec.declination = Declination;
+
     InMemoryDatabase::AlignmentDatabaseType &SyncPoints = pInMemoryDatabase->GetAlignmentDatabase();
     switch (SyncPoints.size())
     {
@@ -385,7 +500,7 @@ bool BasicMathPlugin::TransformCelestialToTelescope(const double RightAscension,
             {
                 case ZENITH:
                     INDI::IHorizontalCoordinates ActualAltAz;
-                    EquatorialToHorizontal(&ActualRaDec, &Position, ln_get_julian_from_sys() + JulianOffset, &ActualAltAz);
+                    EquatorialToHorizontal(&ActualRaDec, &Position, JulianDate, &ActualAltAz);
                     ApparentTelescopeDirectionVector = TelescopeDirectionVectorFromAltitudeAzimuth(ActualAltAz);
                     ASSDEBUGF("Celestial to telescope - Actual Az %lf Alt %lf", ActualAltAz.azimuth, ActualAltAz.altitude);
                     break;
@@ -411,25 +526,15 @@ bool BasicMathPlugin::TransformCelestialToTelescope(const double RightAscension,
             if (ApproximateMountAlignment == ZENITH)
             {
                 INDI::IHorizontalCoordinates ActualAltAz;
-                EquatorialToHorizontal(&ActualRaDec, &Position, ln_get_julian_from_sys() + JulianOffset, &ActualAltAz);
+                EquatorialToHorizontal(&ActualRaDec, &Position, JulianDate, &ActualAltAz);
                 ActualVector = TelescopeDirectionVectorFromAltitudeAzimuth(ActualAltAz);
             }
             else
             {
                 ActualVector = TelescopeDirectionVectorFromEquatorialCoordinates(ActualRaDec);
             }
-            gsl_vector *pGSLActualVector = gsl_vector_alloc(3);
-            gsl_vector_set(pGSLActualVector, 0, ActualVector.x);
-            gsl_vector_set(pGSLActualVector, 1, ActualVector.y);
-            gsl_vector_set(pGSLActualVector, 2, ActualVector.z);
-            gsl_vector *pGSLApparentVector = gsl_vector_alloc(3);
-            MatrixVectorMultiply(pActualToApparentTransform, pGSLActualVector, pGSLApparentVector);
-            ApparentTelescopeDirectionVector.x = gsl_vector_get(pGSLApparentVector, 0);
-            ApparentTelescopeDirectionVector.y = gsl_vector_get(pGSLApparentVector, 1);
-            ApparentTelescopeDirectionVector.z = gsl_vector_get(pGSLApparentVector, 2);
+            ApparentTelescopeDirectionVector = ActualToApparentTransform * ActualVector;
             ApparentTelescopeDirectionVector.Normalise();
-            gsl_vector_free(pGSLActualVector);
-            gsl_vector_free(pGSLApparentVector);
             break;
         }
 
@@ -439,7 +544,7 @@ bool BasicMathPlugin::TransformCelestialToTelescope(const double RightAscension,
             if (ApproximateMountAlignment == ZENITH)
             {
                 INDI::IHorizontalCoordinates ActualAltAz;
-                EquatorialToHorizontal(&ActualRaDec, &Position, ln_get_julian_from_sys() + JulianOffset, &ActualAltAz);
+                EquatorialToHorizontal(&ActualRaDec, &Position, JulianDate, &ActualAltAz);
                 ActualVector = TelescopeDirectionVectorFromAltitudeAzimuth(ActualAltAz);
             }
             else
@@ -447,138 +552,34 @@ bool BasicMathPlugin::TransformCelestialToTelescope(const double RightAscension,
                 ActualVector = TelescopeDirectionVectorFromEquatorialCoordinates(ActualRaDec);
             }
 
-            gsl_matrix *pTransform;
-            gsl_matrix *pComputedTransform = nullptr;
+            if (nullptr == ActualConvexHull.faces)
+                return false;
+
+            const Matrix3x3 *pTransform;
+            Matrix3x3 ComputedTransform;
             // Scale the actual telescope direction vector to make sure it traverses the unit sphere.
             TelescopeDirectionVector ScaledActualVector = ActualVector * 2.0;
-            // Shoot the scaled vector in the into the list of actual facets
-            // and use the conversuion matrix from the one it intersects
-            ConvexHull::tFace CurrentFace = ActualConvexHull.faces;
-#ifdef CONVEX_HULL_DEBUGGING
-            int ActualFaces = 0;
-#endif
-            if (nullptr != CurrentFace)
+            // Shoot the scaled vector into the actual facets it may cross
+            // and use the conversion matrix from the one it intersects
+            ConvexHull::tFace CurrentFace = FindFace(ActualFaceGrid, ActualDirectionCosines,
+                                            ScaledActualVector, LastActualFace);
+            if (nullptr == CurrentFace)
             {
-                do
-                {
-#ifdef CONVEX_HULL_DEBUGGING
-                    ActualFaces++;
-#endif
-                    // Ignore faces containing vertex 0 (nadir).
-                    if ((0 == CurrentFace->vertex[0]->vnum) || (0 == CurrentFace->vertex[1]->vnum) ||
-                            (0 == CurrentFace->vertex[2]->vnum))
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Celestial to telescope - Ignoring actual face %d", ActualFaces);
-#endif
-                    }
-                    else
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Celestial to telescope - Processing actual face %d v1 %d v2 %d v3 %d", ActualFaces,
-                                  CurrentFace->vertex[0]->vnum, CurrentFace->vertex[1]->vnum,
-                                  CurrentFace->vertex[2]->vnum);
-#endif
-                        if (RayTriangleIntersection(ScaledActualVector,
-                                                    ActualDirectionCosines[CurrentFace->vertex[0]->vnum - 1],
-                                                    ActualDirectionCosines[CurrentFace->vertex[1]->vnum - 1],
-                                                    ActualDirectionCosines[CurrentFace->vertex[2]->vnum - 1]))
-                            break;
-                    }
-                    CurrentFace = CurrentFace->next;
-                }
-                while (CurrentFace != ActualConvexHull.faces);
-                if (CurrentFace == ActualConvexHull.faces)
-                {
-                    // Find the three nearest points and build a transform
-                    std::map<double, const AlignmentDatabaseEntry *> NearestMap;
-                    for (InMemoryDatabase::AlignmentDatabaseType::const_iterator Itr = SyncPoints.begin();
-                            Itr != SyncPoints.end(); Itr++)
-                    {
-                        INDI::IEquatorialCoordinates RaDec;
-                        TelescopeDirectionVector ActualDirectionCosine;
-                        RaDec.rightascension  = (*Itr).RightAscension;
-                        RaDec.declination = (*Itr).Declination;
-                        if (ApproximateMountAlignment == ZENITH)
-                        {
-                            INDI::IHorizontalCoordinates ActualPoint;
-                            EquatorialToHorizontal(&RaDec, &Position, (*Itr).ObservationJulianDate, &ActualPoint);
-                            ActualDirectionCosine = TelescopeDirectionVectorFromAltitudeAzimuth(ActualPoint);
-                        }
-                        else
-                        {
-                            ActualDirectionCosine = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec);
-                        }
-                        NearestMap[(ActualDirectionCosine - ActualVector).Length()] = &(*Itr);
-                    }
-                    // First compute local horizontal coordinates for the three sync points
-                    std::map<double, const AlignmentDatabaseEntry *>::const_iterator Nearest = NearestMap.begin();
-                    const AlignmentDatabaseEntry *pEntry1                                    = (*Nearest).second;
-                    Nearest++;
-                    const AlignmentDatabaseEntry *pEntry2 = (*Nearest).second;
-                    Nearest++;
-                    const AlignmentDatabaseEntry *pEntry3 = (*Nearest).second;
-                    INDI::IEquatorialCoordinates RaDec1;
-                    INDI::IEquatorialCoordinates RaDec2;
-                    INDI::IEquatorialCoordinates RaDec3;
-                    TelescopeDirectionVector ActualDirectionCosine1;
-                    TelescopeDirectionVector ActualDirectionCosine2;
-                    TelescopeDirectionVector ActualDirectionCosine3;
-                    RaDec1.declination = pEntry1->Declination;
-                    RaDec1.rightascension  = pEntry1->RightAscension;
-                    RaDec2.declination = pEntry2->Declination;
-                    RaDec2.rightascension  = pEntry2->RightAscension;
-                    RaDec3.declination = pEntry3->Declination;
-                    RaDec3.rightascension = pEntry3->RightAscension;
-
-                    if (ApproximateMountAlignment == ZENITH)
-                    {
-                        INDI::IHorizontalCoordinates ActualSyncPoint1;
-                        INDI::IHorizontalCoordinates ActualSyncPoint2;
-                        INDI::IHorizontalCoordinates ActualSyncPoint3;
-                        EquatorialToHorizontal(&RaDec1, &Position, pEntry1->ObservationJulianDate, &ActualSyncPoint1);
-                        EquatorialToHorizontal(&RaDec2, &Position, pEntry2->ObservationJulianDate, &ActualSyncPoint2);
-                        EquatorialToHorizontal(&RaDec3, &Position, pEntry3->ObservationJulianDate, &ActualSyncPoint3);
-
-                        // Now express these coordinates as normalised direction vectors (a.k.a direction cosines)
-                        ActualDirectionCosine1 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint1);
-                        ActualDirectionCosine2 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint2);
-                        ActualDirectionCosine3 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint3);
-                    }
-                    else
-                    {
-                        ActualDirectionCosine1 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec1);
-                        ActualDirectionCosine2 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec2);
-                        ActualDirectionCosine3 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec3);
-                    }
-
-                    pComputedTransform = gsl_matrix_alloc(3, 3);
-                    CalculateTransformMatrices(ActualDirectionCosine1, ActualDirectionCosine2, ActualDirectionCosine3,
-                                               pEntry1->TelescopeDirection, pEntry2->TelescopeDirection,
-                                               pEntry3->TelescopeDirection, pComputedTransform, nullptr);
-                    pTransform = pComputedTransform;
-                }
-                else
-                    pTransform = CurrentFace->pMatrix;
+                // Find the three nearest points and build a transform
+                int Nearest[3];
+                FindNearestThree(ActualDirectionCosines, ActualVector, Nearest);
+                CalculateTransformMatrices(ActualDirectionCosines[Nearest[0]], ActualDirectionCosines[Nearest[1]],
+                                           ActualDirectionCosines[Nearest[2]], SyncPoints[Nearest[0]].TelescopeDirection,
+                                           SyncPoints[Nearest[1]].TelescopeDirection,
+                                           SyncPoints[Nearest[2]].TelescopeDirection, ComputedTransform, nullptr);
+                pTransform = &ComputedTransform;
             }
             else
-                return false;
+                pTransform = &CurrentFace->Matrix;
 
-            // OK - got an intersection - CurrentFace is pointing at the face
-            gsl_vector *pGSLActualVector = gsl_vector_alloc(3);
-            gsl_vector_set(pGSLActualVector, 0, ActualVector.x);
-            gsl_vector_set(pGSLActualVector, 1, ActualVector.y);
-            gsl_vector_set(pGSLActualVector, 2, ActualVector.z);
-            gsl_vector *pGSLApparentVector = gsl_vector_alloc(3);
-            MatrixVectorMultiply(pTransform, pGSLActualVector, pGSLApparentVector);
-            ApparentTelescopeDirectionVector.x = gsl_vector_get(pGSLApparentVector, 0);
-            ApparentTelescopeDirectionVector.y = gsl_vector_get(pGSLApparentVector, 1);
-            ApparentTelescopeDirectionVector.z = gsl_vector_get(pGSLApparentVector, 2);
+            // OK - got a transform, from the face pointed at by CurrentFace if any
+            ApparentTelescopeDirectionVector = *pTransform * ActualVector;
             ApparentTelescopeDirectionVector.Normalise();
-            gsl_vector_free(pGSLActualVector);
-            gsl_vector_free(pGSLApparentVector);
-            if (nullptr != pComputedTransform)
-                gsl_matrix_free(pComputedTransform);
             break;
         }
     }
@@ -590,11 +591,10 @@ bool BasicMathPlugin::TransformCelestialToTelescope(const double RightAscension,
     return true;
 }
 
-bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
-        double &RightAscension, double &Declination)
+bool BasicMathPlugin::TelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
+        IGeographicCoordinates &Position, double JulianDate, double &RightAscension,
+        double &Declination)
 {
-    IGeographicCoordinates Position;
-
     //INDI::IHorizontalCoordinates ApparentAltAz;
     INDI::IHorizontalCoordinates ActualAltAz;
     INDI::IEquatorialCoordinates ActualRaDec;
@@ -602,12 +602,6 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
     //    AltitudeAzimuthFromTelescopeDirectionVector(ApparentTelescopeDirectionVector, ApparentAltAz);
     //    ASSDEBUGF("Telescope to celestial - Apparent  Az %lf Alt %lf", ApparentAltAz.azimuth, ApparentAltAz.altitude);
 
-    if ((nullptr == pInMemoryDatabase) || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
-    {
-        // Should check that this the same as the current observing position
-        ASSDEBUG("No database or no position in database");
-        return false;
-    }
     InMemoryDatabase::AlignmentDatabaseType &SyncPoints = pInMemoryDatabase->GetAlignmentDatabase();
     switch (SyncPoints.size())
     {
@@ -625,7 +619,7 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
                               ApparentTelescopeDirectionVector.y, ApparentTelescopeDirectionVector.z);
                     //ASSDEBUGF("ActualVector x %lf y %lf z %lf", RotatedTDV.x, RotatedTDV.y, RotatedTDV.z);
                     AltitudeAzimuthFromTelescopeDirectionVector(ApparentTelescopeDirectionVector, ActualAltAz);
-                    HorizontalToEquatorial(&ActualAltAz, &Position, ln_get_julian_from_sys(), &ActualRaDec);
+                    HorizontalToEquatorial(&ActualAltAz, &Position, JulianDate, &ActualRaDec);
                 }
                 break;
 
@@ -645,25 +639,17 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
         case 2:
         case 3:
         {
-            gsl_vector *pGSLApparentVector = gsl_vector_alloc(3);
-            gsl_vector_set(pGSLApparentVector, 0, ApparentTelescopeDirectionVector.x);
-            gsl_vector_set(pGSLApparentVector, 1, ApparentTelescopeDirectionVector.y);
-            gsl_vector_set(pGSLApparentVector, 2, ApparentTelescopeDirectionVector.z);
-            gsl_vector *pGSLActualVector = gsl_vector_alloc(3);
-            MatrixVectorMultiply(pApparentToActualTransform, pGSLApparentVector, pGSLActualVector);
-
-            Dump3("ApparentVector", pGSLApparentVector);
-            Dump3("ActualVector", pGSLActualVector);
-
-            TelescopeDirectionVector ActualTelescopeDirectionVector;
-            ActualTelescopeDirectionVector.x = gsl_vector_get(pGSLActualVector, 0);
-            ActualTelescopeDirectionVector.y = gsl_vector_get(pGSLActualVector, 1);
-            ActualTelescopeDirectionVector.z = gsl_vector_get(pGSLActualVector, 2);
+            TelescopeDirectionVector ActualTelescopeDirectionVector = ApparentToActualTransform *
+                    ApparentTelescopeDirectionVector;
+
+            Dump3("ApparentVector", ApparentTelescopeDirectionVector);
+            Dump3("ActualVector", ActualTelescopeDirectionVector);
+
             ActualTelescopeDirectionVector.Normalise();
             if (ApproximateMountAlignment == ZENITH)
             {
                 AltitudeAzimuthFromTelescopeDirectionVector(ActualTelescopeDirectionVector, ActualAltAz);
-                HorizontalToEquatorial(&ActualAltAz, &Position, ln_get_julian_from_sys(), &ActualRaDec);
+                HorizontalToEquatorial(&ActualAltAz, &Position, JulianDate, &ActualRaDec);
             }
             else
             {
@@ -671,132 +657,43 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
             }
             RightAscension = ActualRaDec.rightascension;
             Declination    = ActualRaDec.declination;
-            gsl_vector_free(pGSLActualVector);
-            gsl_vector_free(pGSLApparentVector);
             break;
         }
 
         default:
         {
-            gsl_matrix *pTransform;
-            gsl_matrix *pComputedTransform = nullptr;
+            if (nullptr == ApparentConvexHull.faces)
+                return false;
+
+            const Matrix3x3 *pTransform;
+            Matrix3x3 ComputedTransform;
             // Scale the apparent telescope direction vector to make sure it traverses the unit sphere.
             TelescopeDirectionVector ScaledApparentVector = ApparentTelescopeDirectionVector * 2.0;
-            // Shoot the scaled vector in the into the list of apparent facets
-            // and use the conversuion matrix from the one it intersects
-            ConvexHull::tFace CurrentFace = ApparentConvexHull.faces;
-#ifdef CONVEX_HULL_DEBUGGING
-            int ApparentFaces = 0;
-#endif
-            if (nullptr != CurrentFace)
+            // Shoot the scaled vector into the apparent facets it may cross
+            // and use the conversion matrix from the one it intersects
+            ConvexHull::tFace CurrentFace = FindFace(ApparentFaceGrid, ApparentDirectionCosines,
+                                            ScaledApparentVector, LastApparentFace);
+            if (nullptr == CurrentFace)
             {
-                do
-                {
-#ifdef CONVEX_HULL_DEBUGGING
-                    ApparentFaces++;
-#endif
-                    // Ignore faces containing vertex 0 (nadir).
-                    if ((0 == CurrentFace->vertex[0]->vnum) || (0 == CurrentFace->vertex[1]->vnum) ||
-                            (0 == CurrentFace->vertex[2]->vnum))
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Celestial to telescope - Ignoring apparent face %d", ApparentFaces);
-#endif
-                    }
-                    else
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("TelescopeToCelestial - Processing apparent face %d v1 %d v2 %d v3 %d", ApparentFaces,
-                                  CurrentFace->vertex[0]->vnum, CurrentFace->vertex[1]->vnum,
-                                  CurrentFace->vertex[2]->vnum);
-#endif
-                        if (RayTriangleIntersection(ScaledApparentVector,
-                                                    SyncPoints[CurrentFace->vertex[0]->vnum - 1].TelescopeDirection,
-                                                    SyncPoints[CurrentFace->vertex[1]->vnum - 1].TelescopeDirection,
-                                                    SyncPoints[CurrentFace->vertex[2]->vnum - 1].TelescopeDirection))
-                            break;
-                    }
-                    CurrentFace = CurrentFace->next;
-                }
-                while (CurrentFace != ApparentConvexHull.faces);
-                if (CurrentFace == ApparentConvexHull.faces)
-                {
-                    // Find the three nearest points and build a transform
-                    std::map<double, const AlignmentDatabaseEntry *> NearestMap;
-                    for (InMemoryDatabase::AlignmentDatabaseType::const_iterator Itr = SyncPoints.begin();
-                            Itr != SyncPoints.end(); Itr++)
-                    {
-                        NearestMap[((*Itr).TelescopeDirection - ApparentTelescopeDirectionVector).Length()] = &(*Itr);
-                    }
-                    // First compute local horizontal coordinates for the three sync points
-                    std::map<double, const AlignmentDatabaseEntry *>::const_iterator Nearest = NearestMap.begin();
-                    const AlignmentDatabaseEntry *pEntry1                                    = (*Nearest).second;
-                    Nearest++;
-                    const AlignmentDatabaseEntry *pEntry2 = (*Nearest).second;
-                    Nearest++;
-                    const AlignmentDatabaseEntry *pEntry3 = (*Nearest).second;
-                    INDI::IEquatorialCoordinates RaDec1;
-                    INDI::IEquatorialCoordinates RaDec2;
-                    INDI::IEquatorialCoordinates RaDec3;
-                    TelescopeDirectionVector ActualDirectionCosine1;
-                    TelescopeDirectionVector ActualDirectionCosine2;
-                    TelescopeDirectionVector ActualDirectionCosine3;
-                    RaDec1.declination = pEntry1->Declination;
-                    RaDec1.rightascension  = pEntry1->RightAscension;
-                    RaDec2.declination = pEntry2->Declination;
-                    RaDec2.rightascension  = pEntry2->RightAscension;
-                    RaDec3.declination = pEntry3->Declination;
-                    RaDec3.rightascension = pEntry3->RightAscension;
-
-                    if (ApproximateMountAlignment == ZENITH)
-                    {
-                        INDI::IHorizontalCoordinates ActualSyncPoint1;
-                        INDI::IHorizontalCoordinates ActualSyncPoint2;
-                        INDI::IHorizontalCoordinates ActualSyncPoint3;
-                        EquatorialToHorizontal(&RaDec1, &Position, pEntry1->ObservationJulianDate, &ActualSyncPoint1);
-                        EquatorialToHorizontal(&RaDec2, &Position, pEntry2->ObservationJulianDate, &ActualSyncPoint2);
-                        EquatorialToHorizontal(&RaDec3, &Position, pEntry3->ObservationJulianDate, &ActualSyncPoint3);
-
-                        // Now express these coordinates as normalised direction vectors (a.k.a direction cosines)
-                        ActualDirectionCosine1 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint1);
-                        ActualDirectionCosine2 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint2);
-                        ActualDirectionCosine3 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint3);
-                    }
-                    else
-                    {
-                        ActualDirectionCosine1 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec1);
-                        ActualDirectionCosine2 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec2);
-                        ActualDirectionCosine3 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec3);
-                    }
-                    pComputedTransform = gsl_matrix_alloc(3, 3);
-                    CalculateTransformMatrices(pEntry1->TelescopeDirection, pEntry2->TelescopeDirection,
-                                               pEntry3->TelescopeDirection, ActualDirectionCosine1,
-                                               ActualDirectionCosine2, ActualDirectionCosine3, pComputedTransform,
-                                               nullptr);
-                    pTransform = pComputedTransform;
-                }
-                else
-                    pTransform = CurrentFace->pMatrix;
+                // Find the three nearest points and build a transform
+                int Nearest[3];
+                FindNearestThree(ApparentDirectionCosines, ApparentTelescopeDirectionVector, Nearest);
+                CalculateTransformMatrices(SyncPoints[Nearest[0]].TelescopeDirection, SyncPoints[Nearest[1]].TelescopeDirection,
+                                           SyncPoints[Nearest[2]].TelescopeDirection, ActualDirectionCosines[Nearest[0]],
+                                           ActualDirectionCosines[Nearest[1]], ActualDirectionCosines[Nearest[2]],
+                                           ComputedTransform, nullptr);
+                pTransform = &ComputedTransform;
             }
             else
-                return false;
+                pTransform = &CurrentFace->Matrix;
 
-            // OK - got an intersection - CurrentFace is pointing at the face
-            gsl_vector *pGSLApparentVector = gsl_vector_alloc(3);
-            gsl_vector_set(pGSLApparentVector, 0, ApparentTelescopeDirectionVector.x);
-            gsl_vector_set(pGSLApparentVector, 1, ApparentTelescopeDirectionVector.y);
-            gsl_vector_set(pGSLApparentVector, 2, ApparentTelescopeDirectionVector.z);
-            gsl_vector *pGSLActualVector = gsl_vector_alloc(3);
-            MatrixVectorMultiply(pTransform, pGSLApparentVector, pGSLActualVector);
-            TelescopeDirectionVector ActualTelescopeDirectionVector;
-            ActualTelescopeDirectionVector.x = gsl_vector_get(pGSLActualVector, 0);
-            ActualTelescopeDirectionVector.y = gsl_vector_get(pGSLActualVector, 1);
-            ActualTelescopeDirectionVector.z = gsl_vector_get(pGSLActualVector, 2);
+            // OK - got a transform, from the face pointed at by CurrentFace if any
+            TelescopeDirectionVector ActualTelescopeDirectionVector = *pTransform * ApparentTelescopeDirectionVector;
             ActualTelescopeDirectionVector.Normalise();
             if (ApproximateMountAlignment == ZENITH)
             {
                 AltitudeAzimuthFromTelescopeDirectionVector(ActualTelescopeDirectionVector, ActualAltAz);
-                HorizontalToEquatorial(&ActualAltAz, &Position, ln_get_julian_from_sys(), &ActualRaDec);
+                HorizontalToEquatorial(&ActualAltAz, &Position, JulianDate, &ActualRaDec);
             }
             else
             {
@@ -805,10 +702,6 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
             // libnova works in decimal degrees so conversion is needed here
             RightAscension = ActualRaDec.rightascension;
             Declination    = ActualRaDec.declination;
-            gsl_vector_free(pGSLActualVector);
-            gsl_vector_free(pGSLApparentVector);
-            if (nullptr != pComputedTransform)
-                gsl_matrix_free(pComputedTransform);
             break;
         }
     }
@@ -816,89 +709,71 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
     return true;
 }
 
-// Private methods
-
-void BasicMathPlugin::Dump3(const char *Label, gsl_vector *pVector)
-{
-    ASSDEBUGF("Vector dump - %s", Label);
-    ASSDEBUGF("%lf %lf %lf", gsl_vector_get(pVector, 0), gsl_vector_get(pVector, 1), gsl_vector_get(pVector, 2));
-}
-
-void BasicMathPlugin::Dump3x3(const char *Label, gsl_matrix *pMatrix)
+ConvexHull::tFace BasicMathPlugin::FindFace(const HullFaceGrid &Grid,
+        std::vector<TelescopeDirectionVector> &Vertices, TelescopeDirectionVector &Ray,
+        ConvexHull::tFace &LastFace)
 {
-    ASSDEBUGF("Matrix dump - %s", Label);
-    ASSDEBUGF("Row 0 %lf %lf %lf", gsl_matrix_get(pMatrix, 0, 0), gsl_matrix_get(pMatrix, 0, 1),
-              gsl_matrix_get(pMatrix, 0, 2));
-    ASSDEBUGF("Row 1 %lf %lf %lf", gsl_matrix_get(pMatrix, 1, 0), gsl_matrix_get(pMatrix, 1, 1),
-              gsl_matrix_get(pMatrix, 1, 2));
-    ASSDEBUGF("Row 2 %lf %lf %lf", gsl_matrix_get(pMatrix, 2, 0), gsl_matrix_get(pMatrix, 2, 1),
-              gsl_matrix_get(pMatrix, 2, 2));
-}
-
-/// Use gsl to compute the determinant of a 3x3 matrix
-double BasicMathPlugin::Matrix3x3Determinant(gsl_matrix *pMatrix)
-{
-    gsl_permutation *pPermutation = gsl_permutation_alloc(3);
-    gsl_matrix *pDecomp           = gsl_matrix_alloc(3, 3);
-    int Signum;
-    double Determinant;
-
-    gsl_matrix_memcpy(pDecomp, pMatrix);
-
-    gsl_linalg_LU_decomp(pDecomp, pPermutation, &Signum);
-
-    Determinant = gsl_linalg_LU_det(pDecomp, Signum);
+    if (nullptr != LastFace &&
+            RayTriangleIntersection(Ray, Vertices[LastFace->vertex[0]->vnum - 1], Vertices[LastFace->vertex[1]->vnum - 1],
+                                    Vertices[LastFace->vertex[2]->vnum - 1]))
+        return LastFace;
 
-    gsl_matrix_free(pDecomp);
-    gsl_permutation_free(pPermutation);
-
-    return Determinant;
+    const std::vector<ConvexHull::tFace> &Candidates = Grid.Candidates(Ray);
+#ifdef CONVEX_HULL_DEBUGGING
+    ASSDEBUGF("FindFace - %d candidate faces", static_cast<int>(Candidates.size()));
+#endif
+    for (ConvexHull::tFace CurrentFace : Candidates)
+    {
+        if (RayTriangleIntersection(Ray, Vertices[CurrentFace->vertex[0]->vnum - 1],
+                                    Vertices[CurrentFace->vertex[1]->vnum - 1], Vertices[CurrentFace->vertex[2]->vnum - 1]))
+        {
+            LastFace = CurrentFace;
+            return CurrentFace;
+        }
+    }
+    return nullptr;
 }
 
-/// Use gsl to compute the inverse of a 3x3 matrix
-bool BasicMathPlugin::MatrixInvert3x3(gsl_matrix *pInput, gsl_matrix *pInversion)
+void BasicMathPlugin::FindNearestThree(const std::vector<TelescopeDirectionVector> &Vertices,
+                                       const TelescopeDirectionVector &Direction, int Nearest[3])
 {
-    bool Retcode                  = true;
-    gsl_permutation *pPermutation = gsl_permutation_alloc(3);
-    gsl_matrix *pDecomp           = gsl_matrix_alloc(3, 3);
-    int Signum;
-
-    gsl_matrix_memcpy(pDecomp, pInput);
-
-    gsl_linalg_LU_decomp(pDecomp, pPermutation, &Signum);
-
-    // Test for singularity
-    if (0 == gsl_linalg_LU_det(pDecomp, Signum))
+    double Distances[3] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                            std::numeric_limits<double>::max()
+                          };
+    Nearest[0] = Nearest[1] = Nearest[2] = 0;
+    for (size_t i = 0; i < Vertices.size(); i++)
     {
-        Retcode = false;
+        double Distance = (Vertices[i] - Direction).Length();
+        int Slot = 3;
+        while (Slot > 0 && Distance < Distances[Slot - 1])
+        {
+            if (Slot < 3)
+            {
+                Distances[Slot] = Distances[Slot - 1];
+                Nearest[Slot]   = Nearest[Slot - 1];
+            }
+            Slot--;
+        }
+        if (Slot < 3)
+        {
+            Distances[Slot] = Distance;
+            Nearest[Slot]   = static_cast<int>(i);
+        }
     }
-    else
-        gsl_linalg_LU_invert(pDecomp, pPermutation, pInversion);
-
-    gsl_matrix_free(pDecomp);
-    gsl_permutation_free(pPermutation);
-
-    return Retcode;
 }
 
-/// Use gsl blas support to multiply two matrices together and put the result in a third.
-/// For our purposes all the matrices should be 3 by 3.
-void BasicMathPlugin::MatrixMatrixMultiply(gsl_matrix *pA, gsl_matrix *pB, gsl_matrix *pC)
+void BasicMathPlugin::Dump3(const char *Label, const TelescopeDirectionVector &Vector)
 {
-    // Zeroise the output matrix
-    gsl_matrix_set_zero(pC);
-
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, pA, pB, 0.0, pC);
+    ASSDEBUGF("Vector dump - %s", Label);
+    ASSDEBUGF("%lf %lf %lf", Vector.x, Vector.y, Vector.z);
 }
 
-/// Use gsl blas support to multiply a matrix by a vector and put the result in another vector
-/// For our purposes the the matrix should be 3x3 and vector 3.
-void BasicMathPlugin::MatrixVectorMultiply(gsl_matrix *pA, gsl_vector *pB, gsl_vector *pC)
+void BasicMathPlugin::Dump3x3(const char *Label, const Matrix3x3 &Matrix)
 {
-    // Zeroise the output vector
-    gsl_vector_set_zero(pC);
-
-    gsl_blas_dgemv(CblasNoTrans, 1.0, pA, pB, 0.0, pC);
+    ASSDEBUGF("Matrix dump - %s", Label);
+    ASSDEBUGF("Row 0 %lf %lf %lf", Matrix.m[0][0], Matrix.m[0][1], Matrix.m[0][2]);
+    ASSDEBUGF("Row 1 %lf %lf %lf", Matrix.m[1][0], Matrix.m[1][1], Matrix.m[1][2]);
+    ASSDEBUGF("Row 2 %lf %lf %lf", Matrix.m[2][0], Matrix.m[2][1], Matrix.m[2][2]);
 }
 
 bool BasicMathPlugin::RayTriangleIntersection(TelescopeDirectionVector &Ray, TelescopeDirectionVector &TriangleVertex1,
@@ -953,5 +828,89 @@ bool BasicMathPlugin::RayTriangleIntersection(TelescopeDirectionVector &Ray, Tel
     return false;
 }
 
+void HullFaceGrid::Build(ConvexHull &Hull, const std::vector<TelescopeDirectionVector> &Vertices)
+{
+    Clear();
+    Cells.resize(Longitudes * Latitudes);
+
+    // Each cell and each face lies within a spherical cap, a face is listed in the cells whose caps meet its own
+    std::vector<TelescopeDirectionVector> CellCentres;
+    std::vector<double> CellRadii;
+    for (int Latitude = 0; Latitude < Latitudes; Latitude++)
+    {
+        for (int Longitude = 0; Longitude < Longitudes; Longitude++)
+        {
+            auto Direction = [](double Lon, double Lat)
+            {
+                return TelescopeDirectionVector(cos(Lat) * cos(Lon), cos(Lat) * sin(Lon), sin(Lat));
+            };
+            double Lon0 = -M_PI + 2 * M_PI * Longitude / Longitudes, Lon1 = -M_PI + 2 * M_PI * (Longitude + 1) / Longitudes;
+            double Lat0 = -M_PI / 2 + M_PI * Latitude / Latitudes, Lat1 = -M_PI / 2 + M_PI * (Latitude + 1) / Latitudes;
+            TelescopeDirectionVector Centre = Direction((Lon0 + Lon1) / 2, (Lat0 + Lat1) / 2);
+            double Radius = 0;
+            for (double Lon : { Lon0, Lon1 })
+                for (double Lat : { Lat0, Lat1 })
+                    Radius = std::max(Radius, acos(std::min(1.0, Centre ^ Direction(Lon, Lat))));
+            CellCentres.push_back(Centre);
+            CellRadii.push_back(Radius);
+        }
+    }
+
+    ConvexHull::tFace CurrentFace = Hull.faces;
+    if (nullptr == CurrentFace)
+        return;
+    do
+    {
+        // Ignore faces containing vertex 0 (nadir).
+        if ((0 != CurrentFace->vertex[0]->vnum) && (0 != CurrentFace->vertex[1]->vnum) &&
+                (0 != CurrentFace->vertex[2]->vnum))
+        {
+            const TelescopeDirectionVector &Vertex1 = Vertices[CurrentFace->vertex[0]->vnum - 1];
+            const TelescopeDirectionVector &Vertex2 = Vertices[CurrentFace->vertex[1]->vnum - 1];
+            const TelescopeDirectionVector &Vertex3 = Vertices[CurrentFace->vertex[2]->vnum - 1];
+            TelescopeDirectionVector Centre(Vertex1.x + Vertex2.x + Vertex3.x, Vertex1.y + Vertex2.y + Vertex3.y,
+                                            Vertex1.z + Vertex2.z + Vertex3.z);
+            double Radius = M_PI;
+            if (Centre.Length() > std::numeric_limits<double>::epsilon())
+            {
+                Centre.Normalise();
+                Radius = 0;
+                for (const TelescopeDirectionVector *Vertex : { &Vertex1, &Vertex2, &Vertex3 })
+                    Radius = std::max(Radius, acos(std::max(-1.0, std::min(1.0, (Centre ^ *Vertex) / Vertex->Length()))));
+            }
+            // A face is within the cap of its vertices only if the cap is smaller than a hemisphere.
+            bool Everywhere = Radius >= M_PI / 2;
+            for (size_t Cell = 0; Cell < Cells.size(); Cell++)
+            {
+                // The margin keeps directions on the cell and face borders
+                if (Everywhere ||
+                        acos(std::max(-1.0, std::min(1.0, Centre ^ CellCentres[Cell]))) <= Radius + CellRadii[Cell] + 1e-6)
+                    Cells[Cell].push_back(CurrentFace);
+            }
+        }
+        CurrentFace = CurrentFace->next;
+    }
+    while (CurrentFace != Hull.faces);
+}
+
+const std::vector<ConvexHull::tFace> &HullFaceGrid::Candidates(const TelescopeDirectionVector &Direction) const
+{
+    static const std::vector<ConvexHull::tFace> None;
+    double Length = Direction.Length();
+    if (Cells.empty() || Length <= 0)
+        return None;
+
+    double Lon = atan2(Direction.y, Direction.x);
+    double Lat = asin(std::max(-1.0, std::min(1.0, Direction.z / Length)));
+    int Longitude = std::min(Longitudes - 1, std::max(0, static_cast<int>((Lon + M_PI) * Longitudes / (2 * M_PI))));
+    int Latitude  = std::min(Latitudes - 1, std::max(0, static_cast<int>((Lat + M_PI / 2) * Latitudes / M_PI)));
+    return Cells[Longitude + Latitude * Longitudes];
+}
+
+void HullFaceGrid::Clear()
+{
+    Cells.clear();
+}
+
 } // namespace AlignmentSubsystem
 } // namespace INDI
@@ -11,12 +11,38 @@
 #include "AlignmentSubsystemForMathPlugins.h"
 #include "ConvexHull.h"
 
-#include <gsl/gsl_matrix.h>
+#include <vector>
 
 namespace INDI
 {
 namespace AlignmentSubsystem
 {
+/// \class HullFaceGrid
+/// \brief Splits the directions from the origin into cells of latitude and longitude, each listing
+/// the convex hull faces a ray along one of its directions may go through
+class HullFaceGrid
+{
+    public:
+        /// \brief Make the lists of the faces of a hull, leaving out the faces on the nadir vertex
+        /// \param[in] Hull The convex hull
+        /// \param[in] Vertices The directions of the hull vertices, vertex n being Vertices[n - 1]
+        void Build(ConvexHull &Hull, const std::vector<TelescopeDirectionVector> &Vertices);
+
+        /// \brief Get the faces a ray along a direction may go through, in the order of the hull faces
+        /// \param[in] Direction The ray direction
+        /// \return The candidate faces, empty before Build
+        const std::vector<ConvexHull::tFace> &Candidates(const TelescopeDirectionVector &Direction) const;
+
+        /// \brief Forget the faces
+        void Clear();
+
+    private:
+        static constexpr int Longitudes = 36;
+        static constexpr int Latitudes  = 18;
+
+        std::vector<std::vector<ConvexHull::tFace>> Cells;
+};
+
 /// \class BasicMathPlugin
 /// \brief This class implements the common functionality for the built in
 /// and SVD math plugins
@@ -41,6 +67,16 @@ class BasicMathPlugin : public AlignmentSubsystemForMathPlugins
         virtual bool TransformTelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
                 double &RightAscension, double &Declination);
 
+        /// \brief Override for the base class virtual function
+        virtual bool TransformCelestialToTelescopeBatch(const double *RightAscensions, const double *Declinations,
+                size_t Count, double JulianOffset,
+                TelescopeDirectionVector *ApparentTelescopeDirectionVectors, bool *Succeeded);
+
+        /// \brief Override for the base class virtual function
+        virtual bool TransformTelescopeToCelestialBatch(const TelescopeDirectionVector *ApparentTelescopeDirectionVectors,
+                size_t Count, double *RightAscensions, double *Declinations,
+                bool *Succeeded);
+
     protected:
         /// \brief Calculate transformation matrices from the supplied vectors
         /// \param[in] Alpha1 Pointer to the first coordinate in the alpha reference frame
@@ -49,40 +85,23 @@ class BasicMathPlugin : public AlignmentSubsystemForMathPlugins
         /// \param[in] Beta1 Pointer to the first coordinate in the beta reference frame
         /// \param[in] Beta2 Pointer to the second coordinate in the beta reference frame
         /// \param[in] Beta3 Pointer to the third coordinate in the beta reference frame
-        /// \param[in] pAlphaToBeta Pointer to a matrix to receive the Alpha to Beta transformation matrix
-        /// \param[in] pBetaToAlpha Pointer to a matrix to receive the Beta to Alpha transformation matrix
+        /// \param[out] AlphaToBeta The matrix to receive the Alpha to Beta transformation matrix
+        /// \param[out] pBetaToAlpha Pointer to a matrix to receive the Beta to Alpha transformation matrix, or nullptr
         virtual void
         CalculateTransformMatrices(const TelescopeDirectionVector &Alpha1, const TelescopeDirectionVector &Alpha2,
                                    const TelescopeDirectionVector &Alpha3, const TelescopeDirectionVector &Beta1,
                                    const TelescopeDirectionVector &Beta2, const TelescopeDirectionVector &Beta3,
-                                   gsl_matrix *pAlphaToBeta, gsl_matrix *pBetaToAlpha) = 0;
+                                   Matrix3x3 &AlphaToBeta, Matrix3x3 *pBetaToAlpha) = 0;
 
         /// \brief Print out a 3 vector to debug
         /// \param[in] Label A label to identify the vector
-        /// \param[in] pVector The vector to print
-        void Dump3(const char *Label, gsl_vector *pVector);
+        /// \param[in] Vector The vector to print
+        void Dump3(const char *Label, const TelescopeDirectionVector &Vector);
 
         /// \brief Print out a 3x3 matrix to debug
         /// \param[in] Label A label to identify the matrix
-        /// \param[in] pMatrix The matrix to print
-        void Dump3x3(const char *Label, gsl_matrix *pMatrix);
-
-        /// \brief Calculate the determinant of the supplied matrix
-        /// \param[in] pMatrix Pointer to the 3x3 matrix
-        /// \return The determinant
-        double Matrix3x3Determinant(gsl_matrix *pMatrix);
-
-        /// \brief Calculate the inverse of the supplied matrix
-        /// \param[in] pInput Pointer to the input matrix
-        /// \param[in] pInversion Pointer to a matrix to receive the inversion
-        /// \return False if input matrix is singular (not invertable) otherwise true
-        bool MatrixInvert3x3(gsl_matrix *pInput, gsl_matrix *pInversion);
-
-        /// \brief Multiply matrix A by matrix B and put the result in C
-        void MatrixMatrixMultiply(gsl_matrix *pA, gsl_matrix *pB, gsl_matrix *pC);
-
-        /// \brief Multiply matrix A by vector B and put the result in vector C
-        void MatrixVectorMultiply(gsl_matrix *pA, gsl_vector *pB, gsl_vector *pC);
+        /// \param[in] Matrix The matrix to print
+        void Dump3x3(const char *Label, const Matrix3x3 &Matrix);
 
         /// \brief Test if a ray intersects a triangle in 3d space
         /// \param[in] Ray The ray vector
@@ -95,14 +114,60 @@ class BasicMathPlugin : public AlignmentSubsystemForMathPlugins
                                      TelescopeDirectionVector &TriangleVertex2, TelescopeDirectionVector &TriangleVertex3);
 
         // Transformation matrixes for 1, 2 and 3 sync points case
-        gsl_matrix *pActualToApparentTransform;
-        gsl_matrix *pApparentToActualTransform;
+        Matrix3x3 ActualToApparentTransform;
+        Matrix3x3 ApparentToActualTransform;
 
         // Convex hulls for 4+ sync points case
         ConvexHull ActualConvexHull;
         ConvexHull ApparentConvexHull;
         // Actual direction cosines for the 4+ case
         std::vector<TelescopeDirectionVector> ActualDirectionCosines;
+        // Apparent direction cosines for the 4+ case
+        std::vector<TelescopeDirectionVector> ApparentDirectionCosines;
+        // Faces each transform direction may go through for the 4+ case
+        HullFaceGrid ActualFaceGrid;
+        HullFaceGrid ApparentFaceGrid;
+        // Faces the last transforms went through, tried first since the mount moves little between calls
+        ConvexHull::tFace LastActualFace { nullptr };
+        ConvexHull::tFace LastApparentFace { nullptr };
+
+    private:
+        /// \brief Transform celestial coordinates once the reference position is known
+        /// \param[in] RightAscension Right Ascension (Decimal Hours).
+        /// \param[in] Declination Declination (Decimal Degrees).
+        /// \param[in] Position The database reference position
+        /// \param[in] JulianDate The julian date of the transform
+        /// \param[out] ApparentTelescopeDirectionVector Parameter to receive the corrected telescope direction
+        /// \return True if successful
+        bool CelestialToTelescope(const double RightAscension, const double Declination, IGeographicCoordinates &Position,
+                                  double JulianDate, TelescopeDirectionVector &ApparentTelescopeDirectionVector);
+
+        /// \brief Transform a telescope direction once the reference position is known
+        /// \param[in] ApparentTelescopeDirectionVector The telescope direction
+        /// \param[in] Position The database reference position
+        /// \param[in] JulianDate The julian date of the transform
+        /// \param[out] RightAscension Parameter to receive the Right Ascension (Decimal Hours).
+        /// \param[out] Declination Parameter to receive the Declination (Decimal Degrees).
+        /// \return True if successful
+        bool TelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
+                                  IGeographicCoordinates &Position, double JulianDate, double &RightAscension,
+                                  double &Declination);
+
+        /// \brief Find the face of a hull a ray goes through
+        /// \param[in] Grid The candidate faces of the hull
+        /// \param[in] Vertices The directions of the hull vertices, vertex n being Vertices[n - 1]
+        /// \param[in] Ray The ray, long enough to cross the unit sphere
+        /// \param[in,out] LastFace The face found by the previous call, tried first, then replaced with the result
+        /// \return The face, or nullptr if the ray goes through none
+        ConvexHull::tFace FindFace(const HullFaceGrid &Grid, std::vector<TelescopeDirectionVector> &Vertices,
+                                   TelescopeDirectionVector &Ray, ConvexHull::tFace &LastFace);
+
+        /// \brief Find the three vertices nearest to a direction
+        /// \param[in] Vertices The vertex directions
+        /// \param[in] Direction The direction
+        /// \param[out] Nearest The indices of the nearest vertices, nearest first
+        void FindNearestThree(const std::vector<TelescopeDirectionVector> &Vertices, const TelescopeDirectionVector &Direction,
+                              int Nearest[3]);
 };
 
 } // namespace AlignmentSubsystem
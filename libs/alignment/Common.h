@@ -68,10 +68,10 @@ enum AlignmentPointSetEnum
 struct TelescopeDirectionVector
 {
     /// \brief Default constructor
-    TelescopeDirectionVector() : x(0), y(0), z(0) {}
+    constexpr TelescopeDirectionVector() : x(0), y(0), z(0) {}
 
     /// \brief Copy constructor
-    TelescopeDirectionVector(double X, double Y, double Z) : x(X), y(Y), z(Z) {}
+    constexpr TelescopeDirectionVector(double X, double Y, double Z) : x(X), y(Y), z(Z) {}
 
     double x;
     double y;
@@ -143,6 +143,103 @@ struct TelescopeDirectionVector
     void RotateAroundY(double Angle);
 };
 
+/*!
+ * \struct Matrix3x3
+ * \brief Holds a 3x3 matrix by value, row by row
+ *
+ * The alignment transforms are all 3x3, so they are kept on the stack and
+ * multiplied and inverted inline rather than through a general matrix library.
+ */
+struct Matrix3x3
+{
+    double m[3][3] { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+
+    /// \brief Return the identity matrix
+    static constexpr Matrix3x3 Identity()
+    {
+        Matrix3x3 Result;
+        Result.m[0][0] = Result.m[1][1] = Result.m[2][2] = 1;
+        return Result;
+    }
+
+    /// \brief Return the matrix whose columns are the supplied vectors
+    static constexpr Matrix3x3 FromColumns(const TelescopeDirectionVector &Column0,
+                                           const TelescopeDirectionVector &Column1,
+                                           const TelescopeDirectionVector &Column2)
+    {
+        Matrix3x3 Result;
+        Result.m[0][0] = Column0.x;
+        Result.m[1][0] = Column0.y;
+        Result.m[2][0] = Column0.z;
+        Result.m[0][1] = Column1.x;
+        Result.m[1][1] = Column1.y;
+        Result.m[2][1] = Column1.z;
+        Result.m[0][2] = Column2.x;
+        Result.m[1][2] = Column2.y;
+        Result.m[2][2] = Column2.z;
+        return Result;
+    }
+
+    /// \brief Override the * operator to return a matrix product
+    constexpr Matrix3x3 operator*(const Matrix3x3 &RHS) const
+    {
+        Matrix3x3 Result;
+        for (int Row = 0; Row < 3; Row++)
+            for (int Column = 0; Column < 3; Column++)
+                Result.m[Row][Column] = m[Row][0] * RHS.m[0][Column] + m[Row][1] * RHS.m[1][Column] +
+                                        m[Row][2] * RHS.m[2][Column];
+        return Result;
+    }
+
+    /// \brief Override the * operator to return the product of the matrix and a column vector
+    constexpr TelescopeDirectionVector operator*(const TelescopeDirectionVector &RHS) const
+    {
+        return TelescopeDirectionVector(m[0][0] * RHS.x + m[0][1] * RHS.y + m[0][2] * RHS.z,
+                                        m[1][0] * RHS.x + m[1][1] * RHS.y + m[1][2] * RHS.z,
+                                        m[2][0] * RHS.x + m[2][1] * RHS.y + m[2][2] * RHS.z);
+    }
+
+    /// \brief Return the transpose of the matrix
+    constexpr Matrix3x3 Transpose() const
+    {
+        Matrix3x3 Result;
+        for (int Row = 0; Row < 3; Row++)
+            for (int Column = 0; Column < 3; Column++)
+                Result.m[Row][Column] = m[Column][Row];
+        return Result;
+    }
+
+    /// \brief Return the determinant of the matrix
+    constexpr double Determinant() const
+    {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+               m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    }
+
+    /// \brief Calculate the inverse of the matrix
+    /// \param[out] Inversion The matrix to receive the inversion, left untouched if the matrix is singular
+    /// \return False if the matrix is singular (not invertable) otherwise true
+    constexpr bool Invert(Matrix3x3 &Inversion) const
+    {
+        double Det = Determinant();
+        if (0 == Det)
+            return false;
+        double InverseDet = 1.0 / Det;
+        Matrix3x3 Result;
+        Result.m[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * InverseDet;
+        Result.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * InverseDet;
+        Result.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * InverseDet;
+        Result.m[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * InverseDet;
+        Result.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * InverseDet;
+        Result.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * InverseDet;
+        Result.m[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * InverseDet;
+        Result.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * InverseDet;
+        Result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * InverseDet;
+        Inversion = Result;
+        return true;
+    }
+};
+
 /*!
  * \struct AlignmentDatabaseEntry
  * \brief Entry in the in memory alignment database
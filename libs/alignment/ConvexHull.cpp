@@ -658,7 +658,8 @@ ConvexHull::tFace ConvexHull::MakeNullFace()
         f->edge[i]   = nullptr;
         f->vertex[i] = nullptr;
     }
-    f->visible = !VISIBLE;
+    f->visible     = !VISIBLE;
+    f->MatrixValid = false;
     add<tFace>(faces, f);
     return f;
 }
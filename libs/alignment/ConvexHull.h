@@ -41,7 +41,7 @@ not removed.
 --------------------------------------------------------------------
 */
 
-#include <gsl/gsl_matrix.h>
+#include "Common.h"
 
 #include <cmath>
 #include <cstring>
@@ -145,19 +145,12 @@ class ConvexHull
 
         struct tFaceStructure
         {
-            tFaceStructure()
-            {
-                pMatrix = gsl_matrix_alloc(3, 3);
-            }
-            ~tFaceStructure()
-            {
-                gsl_matrix_free(pMatrix);
-            }
             tEdge edge[3];
             tVertex vertex[3];
             bool visible; // True iff face visible from new point.
             tFace next, prev;
-            gsl_matrix *pMatrix;
+            Matrix3x3 Matrix;
+            bool MatrixValid; // True iff Matrix was computed for the face vertices.
         };
 
         /* Define flags */
@@ -12,14 +12,42 @@
 #include "indicom.h"
 
 #include <cerrno>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 namespace INDI
 {
 namespace AlignmentSubsystem
 {
+namespace
+{
+// The binary database is a header followed by Count entries, all in host byte order
+const char BinaryDatabaseMagic[8]    = { 'I', 'N', 'D', 'I', 'A', 'L', 'D', 'B' };
+const uint32_t BinaryDatabaseVersion = 1;
+
+struct BinaryDatabaseHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t ReferencePositionIsValid;
+    double Latitude;
+    double Longitude;
+    uint64_t Count;
+};
+
+struct BinaryDatabaseEntry
+{
+    double ObservationJulianDate;
+    double RightAscension;
+    double Declination;
+    double TelescopeDirection[3];
+};
+}
+
 InMemoryDatabase::InMemoryDatabase() : DatabaseReferencePositionIsValid(false),
     LoadDatabaseCallback(nullptr), LoadDatabaseCallbackThisPointer(nullptr)
 {
@@ -68,6 +96,136 @@ bool InMemoryDatabase::GetDatabaseReferencePosition(IGeographicCoordinates &Posi
 bool InMemoryDatabase::LoadDatabase(const char *DeviceName)
 {
     char DatabaseFileName[MAXRBUF];
+    char Errmsg[MAXRBUF];
+    BinaryDatabaseHeader Header;
+
+    snprintf(DatabaseFileName, MAXRBUF, "%s/.indi/%s_alignment_database.bin", getenv("HOME"), DeviceName);
+
+    int fd = open(DatabaseFileName, O_RDONLY);
+    if (fd < 0)
+    {
+        if (errno != ENOENT)
+            return false;
+        // Fall back to the XML database of earlier versions, the next save converts it
+        snprintf(DatabaseFileName, MAXRBUF, "%s/.indi/%s_alignment_database.xml", getenv("HOME"), DeviceName);
+        return ImportDatabase(DatabaseFileName);
+    }
+
+    // The file is read at once, header first and then the entries
+    struct stat Status;
+    std::vector<BinaryDatabaseEntry> Entries;
+    bool Valid = (fstat(fd, &Status) == 0) && (static_cast<size_t>(Status.st_size) >= sizeof(Header)) &&
+                 (read(fd, &Header, sizeof(Header)) == static_cast<ssize_t>(sizeof(Header))) &&
+                 (memcmp(Header.Magic, BinaryDatabaseMagic, sizeof(Header.Magic)) == 0) &&
+                 (Header.Version == BinaryDatabaseVersion) &&
+                 (static_cast<size_t>(Status.st_size) == sizeof(Header) + Header.Count * sizeof(BinaryDatabaseEntry));
+    if (Valid)
+    {
+        Entries.resize(Header.Count);
+        size_t Size = Entries.size() * sizeof(BinaryDatabaseEntry);
+        Valid = (Size == 0) || (read(fd, Entries.data(), Size) == static_cast<ssize_t>(Size));
+    }
+    close(fd);
+    if (!Valid)
+    {
+        snprintf(Errmsg, MAXRBUF, "Alignment database file %s is not a version %u database", DatabaseFileName,
+                 BinaryDatabaseVersion);
+        return false;
+    }
+
+    if (Header.ReferencePositionIsValid)
+    {
+        DatabaseReferencePosition.latitude  = Header.Latitude;
+        DatabaseReferencePosition.longitude = Header.Longitude;
+        DatabaseReferencePositionIsValid    = true;
+    }
+
+    MySyncPoints.clear();
+    MySyncPoints.reserve(Entries.size());
+    for (const BinaryDatabaseEntry &Entry : Entries)
+    {
+        AlignmentDatabaseEntry CurrentValues;
+        CurrentValues.ObservationJulianDate = Entry.ObservationJulianDate;
+        CurrentValues.RightAscension        = Entry.RightAscension;
+        CurrentValues.Declination           = Entry.Declination;
+        CurrentValues.TelescopeDirection    = TelescopeDirectionVector(Entry.TelescopeDirection[0],
+                                              Entry.TelescopeDirection[1], Entry.TelescopeDirection[2]);
+        MySyncPoints.push_back(CurrentValues);
+    }
+
+    if (nullptr != LoadDatabaseCallback)
+        (*LoadDatabaseCallback)(LoadDatabaseCallbackThisPointer);
+
+    return true;
+}
+
+bool InMemoryDatabase::SaveDatabase(const char *DeviceName)
+{
+    char ConfigDir[MAXRBUF];
+    char DatabaseFileName[MAXRBUF];
+    char TemporaryFileName[MAXRBUF];
+    char Errmsg[MAXRBUF];
+    struct stat Status;
+
+    snprintf(ConfigDir, MAXRBUF, "%s/.indi/", getenv("HOME"));
+    snprintf(DatabaseFileName, MAXRBUF, "%s%s_alignment_database.bin", ConfigDir, DeviceName);
+    snprintf(TemporaryFileName, MAXRBUF, "%s.tmp", DatabaseFileName);
+
+    if (stat(ConfigDir, &Status) != 0)
+    {
+        if (mkdir(ConfigDir, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) < 0)
+        {
+            snprintf(Errmsg, MAXRBUF, "Unable to create config directory. Error %s: %s\n", ConfigDir, strerror(errno));
+            return false;
+        }
+    }
+
+    BinaryDatabaseHeader Header;
+    memcpy(Header.Magic, BinaryDatabaseMagic, sizeof(Header.Magic));
+    Header.Version                  = BinaryDatabaseVersion;
+    Header.ReferencePositionIsValid = DatabaseReferencePositionIsValid ? 1 : 0;
+    Header.Latitude                 = DatabaseReferencePosition.latitude;
+    Header.Longitude                = DatabaseReferencePosition.longitude;
+    Header.Count                    = MySyncPoints.size();
+
+    std::vector<BinaryDatabaseEntry> Entries;
+    Entries.reserve(MySyncPoints.size());
+    for (const AlignmentDatabaseEntry &CurrentValues : MySyncPoints)
+    {
+        BinaryDatabaseEntry Entry;
+        Entry.ObservationJulianDate = CurrentValues.ObservationJulianDate;
+        Entry.RightAscension        = CurrentValues.RightAscension;
+        Entry.Declination           = CurrentValues.Declination;
+        Entry.TelescopeDirection[0] = CurrentValues.TelescopeDirection.x;
+        Entry.TelescopeDirection[1] = CurrentValues.TelescopeDirection.y;
+        Entry.TelescopeDirection[2] = CurrentValues.TelescopeDirection.z;
+        Entries.push_back(Entry);
+    }
+
+    // Write a temporary file and rename it over the database, so a crash never leaves half a database
+    FILE *fp = fopen(TemporaryFileName, "wb");
+    if (fp == nullptr)
+    {
+        snprintf(Errmsg, MAXRBUF, "Unable to open database file. Error opening file %s: %s\n", TemporaryFileName,
+                 strerror(errno));
+        return false;
+    }
+    bool Written = (fwrite(&Header, sizeof(Header), 1, fp) == 1) &&
+                   (Entries.empty() || fwrite(Entries.data(), sizeof(BinaryDatabaseEntry), Entries.size(), fp) == Entries.size()) &&
+                   (fflush(fp) == 0) && (fsync(fileno(fp)) == 0);
+    Written = (fclose(fp) == 0) && Written;
+    if (!Written || rename(TemporaryFileName, DatabaseFileName) != 0)
+    {
+        snprintf(Errmsg, MAXRBUF, "Unable to write database file %s: %s\n", DatabaseFileName, strerror(errno));
+        unlink(TemporaryFileName);
+        return false;
+    }
+
+    return true;
+}
+
+bool InMemoryDatabase::ImportDatabase(const char *DatabaseFileName)
+{
     char Errmsg[MAXRBUF];
     XMLEle *FileRoot    = nullptr;
     XMLEle *EntriesRoot = nullptr;
@@ -78,8 +236,6 @@ bool InMemoryDatabase::LoadDatabase(const char *DeviceName)
 
     FILE *fp = nullptr;
 
-    snprintf(DatabaseFileName, MAXRBUF, "%s/.indi/%s_alignment_database.xml", getenv("HOME"), DeviceName);
-
     fp = fopen(DatabaseFileName, "r");
     if (fp == nullptr)
     {
@@ -174,26 +330,11 @@ bool InMemoryDatabase::LoadDatabase(const char *DeviceName)
     return true;
 }
 
-bool InMemoryDatabase::SaveDatabase(const char *DeviceName)
+bool InMemoryDatabase::ExportDatabase(const char *DatabaseFileName)
 {
-    char ConfigDir[MAXRBUF];
-    char DatabaseFileName[MAXRBUF];
     char Errmsg[MAXRBUF];
-    struct stat Status;
     FILE *fp;
 
-    snprintf(ConfigDir, MAXRBUF, "%s/.indi/", getenv("HOME"));
-    snprintf(DatabaseFileName, MAXRBUF, "%s%s_alignment_database.xml", ConfigDir, DeviceName);
-
-    if (stat(ConfigDir, &Status) != 0)
-    {
-        if (mkdir(ConfigDir, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) < 0)
-        {
-            snprintf(Errmsg, MAXRBUF, "Unable to create config directory. Error %s: %s\n", ConfigDir, strerror(errno));
-            return false;
-        }
-    }
-
     fp = fopen(DatabaseFileName, "w");
     if (fp == nullptr)
     {
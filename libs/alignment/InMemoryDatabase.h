@@ -59,13 +59,26 @@ class InMemoryDatabase
         /// \brief Load the database from persistent storage
         /// \param[in] DeviceName The name of the current device.
         /// \return True if successful
+        /// \note The database is kept in a versioned binary file. If there is none, the XML file of
+        /// earlier versions is imported instead.
         bool LoadDatabase(const char *DeviceName);
 
         /// \brief Save the database to persistent storage
         /// \param[in] DeviceName The name of the current device.
         /// \return True if successful
+        /// \note The binary file is written aside and renamed over the previous one, so it is never left half written.
         bool SaveDatabase(const char *DeviceName);
 
+        /// \brief Load the database from an XML file
+        /// \param[in] DatabaseFileName The path of the file.
+        /// \return True if successful
+        bool ImportDatabase(const char *DatabaseFileName);
+
+        /// \brief Save the database to an XML file
+        /// \param[in] DatabaseFileName The path of the file.
+        /// \return True if successful
+        bool ExportDatabase(const char *DatabaseFileName);
+
         /// \brief Set the database reference position
         /// \param[in] Latitude
         /// \param[in] Longitude
@@ -18,5 +18,37 @@ bool MathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
     return true;
 }
 
+bool MathPlugin::TransformCelestialToTelescopeBatch(const double *RightAscensions, const double *Declinations,
+        size_t Count, double JulianOffset,
+        TelescopeDirectionVector *ApparentTelescopeDirectionVectors, bool *Succeeded)
+{
+    bool AllSucceeded = true;
+    for (size_t i = 0; i < Count; i++)
+    {
+        bool Result = TransformCelestialToTelescope(RightAscensions[i], Declinations[i], JulianOffset,
+                      ApparentTelescopeDirectionVectors[i]);
+        if (nullptr != Succeeded)
+            Succeeded[i] = Result;
+        AllSucceeded = AllSucceeded && Result;
+    }
+    return AllSucceeded;
+}
+
+bool MathPlugin::TransformTelescopeToCelestialBatch(const TelescopeDirectionVector *ApparentTelescopeDirectionVectors,
+        size_t Count, double *RightAscensions, double *Declinations,
+        bool *Succeeded)
+{
+    bool AllSucceeded = true;
+    for (size_t i = 0; i < Count; i++)
+    {
+        bool Result = TransformTelescopeToCelestial(ApparentTelescopeDirectionVectors[i], RightAscensions[i],
+                      Declinations[i]);
+        if (nullptr != Succeeded)
+            Succeeded[i] = Result;
+        AllSucceeded = AllSucceeded && Result;
+    }
+    return AllSucceeded;
+}
+
 } // namespace AlignmentSubsystem
 } // namespace INDI
@@ -75,6 +75,32 @@ class MathPlugin
         virtual bool TransformTelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
                 double &RightAscension, double &Declination) = 0;
 
+        /// \brief Get the alignment corrected telescope pointing directions for an array of celestial coordinates
+        /// \param[in] RightAscensions Count Right Ascensions (Decimal Hours).
+        /// \param[in] Declinations Count Declinations (Decimal Degrees).
+        /// \param[in] Count Number of coordinates to transform.
+        /// \param[in] JulianOffset to be applied to the current julian date, read once for all the coordinates.
+        /// \param[out] ApparentTelescopeDirectionVectors Array of Count to receive the corrected telescope directions
+        /// \param[out] Succeeded Array of Count to receive whether each transform succeeded, or nullptr
+        /// \return True if all the transforms succeeded
+        /// \note The default implementation calls TransformCelestialToTelescope for each coordinate. Plugins
+        /// override it to look the database and the reference position up once for the whole array.
+        virtual bool TransformCelestialToTelescopeBatch(const double *RightAscensions, const double *Declinations,
+                size_t Count, double JulianOffset,
+                TelescopeDirectionVector *ApparentTelescopeDirectionVectors, bool *Succeeded);
+
+        /// \brief Get the true celestial coordinates for an array of telescope pointing directions
+        /// \param[in] ApparentTelescopeDirectionVectors Count telescope directions
+        /// \param[in] Count Number of directions to transform.
+        /// \param[out] RightAscensions Array of Count to receive the Right Ascensions (Decimal Hours).
+        /// \param[out] Declinations Array of Count to receive the Declinations (Decimal Degrees).
+        /// \param[out] Succeeded Array of Count to receive whether each transform succeeded, or nullptr
+        /// \return True if all the transforms succeeded
+        /// \note The default implementation calls TransformTelescopeToCelestial for each direction.
+        virtual bool TransformTelescopeToCelestialBatch(const TelescopeDirectionVector *ApparentTelescopeDirectionVectors,
+                size_t Count, double *RightAscensions, double *Declinations,
+                bool *Succeeded);
+
     protected:
         // Protected properties
         /// \brief Describe the approximate alignment of the mount. This information is normally used in a one star alignment
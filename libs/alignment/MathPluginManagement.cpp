@@ -22,6 +22,8 @@ MathPluginManagement::MathPluginManagement() : CurrentInMemoryDatabase(nullptr),
     pSetApproximateMountAlignment(&MathPlugin::SetApproximateMountAlignment),
     pTransformCelestialToTelescope(&MathPlugin::TransformCelestialToTelescope),
     pTransformTelescopeToCelestial(&MathPlugin::TransformTelescopeToCelestial),
+    pTransformCelestialToTelescopeBatch(&MathPlugin::TransformCelestialToTelescopeBatch),
+    pTransformTelescopeToCelestialBatch(&MathPlugin::TransformTelescopeToCelestialBatch),
     pLoadedMathPlugin(&BuiltInPlugin), LoadedMathPluginHandle(nullptr)
 {
     memset(&AlignmentSubsystemCurrentMathPlugin, 0, sizeof(IText));
@@ -387,6 +389,32 @@ bool MathPluginManagement::TransformTelescopeToCelestial(
         return false;
 }
 
+bool MathPluginManagement::TransformCelestialToTelescopeBatch(const double *RightAscensions,
+        const double *Declinations, size_t Count, double JulianOffset,
+        TelescopeDirectionVector *ApparentTelescopeDirectionVectors, bool *Succeeded)
+{
+    if (AlignmentSubsystemActive.s == ISS_ON)
+        return (pLoadedMathPlugin->*pTransformCelestialToTelescopeBatch)(RightAscensions, Declinations, Count,
+                JulianOffset, ApparentTelescopeDirectionVectors, Succeeded);
+
+    for (size_t i = 0; nullptr != Succeeded && i < Count; i++)
+        Succeeded[i] = false;
+    return false;
+}
+
+bool MathPluginManagement::TransformTelescopeToCelestialBatch(
+    const TelescopeDirectionVector *ApparentTelescopeDirectionVectors, size_t Count, double *RightAscensions,
+    double *Declinations, bool *Succeeded)
+{
+    if (AlignmentSubsystemActive.s == ISS_ON)
+        return (pLoadedMathPlugin->*pTransformTelescopeToCelestialBatch)(ApparentTelescopeDirectionVectors, Count,
+                RightAscensions, Declinations, Succeeded);
+
+    for (size_t i = 0; nullptr != Succeeded && i < Count; i++)
+        Succeeded[i] = false;
+    return false;
+}
+
 void MathPluginManagement::EnumeratePlugins()
 {
     MathPluginFiles.clear();
@@ -134,6 +134,34 @@ class MathPluginManagement : private MathPlugin // Derive from MathPluign to for
         bool TransformTelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
                                            double &RightAscension, double &Declination);
 
+        /**
+         * @brief TransformCelestialToTelescopeBatch Transforms an array of Celestial (Sky) Coords to Mount Coordinates
+         * @param RightAscensions Count Sky Right Ascensions in hours.
+         * @param Declinations Count Sky Declinations in degrees
+         * @param Count Number of coordinates
+         * @param JulianOffset Julian time Offset in days
+         * @param ApparentTelescopeDirectionVectors Output Count Apparent Telescope Direction Vectors
+         * @param Succeeded Output Count flags telling which transformations are successful, or nullptr
+         * @return True if all transformations are successful, false otherwise.
+         */
+        bool TransformCelestialToTelescopeBatch(const double *RightAscensions, const double *Declinations, size_t Count,
+                                                double JulianOffset,
+                                                TelescopeDirectionVector *ApparentTelescopeDirectionVectors,
+                                                bool *Succeeded = nullptr);
+
+        /**
+         * @brief TransformTelescopeToCelestialBatch Transforms an array of Mount Coords to Celestial (Sky) Coordinates
+         * @param ApparentTelescopeDirectionVectors Input Count Apparent Telescope Direction Vectors
+         * @param Count Number of directions
+         * @param RightAscensions Output Count Celestial Right Ascensions
+         * @param Declinations Output Count Celestial Declinations
+         * @param Succeeded Output Count flags telling which transformations are successful, or nullptr
+         * @return True if all transformations are successful, false otherwise.
+         */
+        bool TransformTelescopeToCelestialBatch(const TelescopeDirectionVector *ApparentTelescopeDirectionVectors,
+                                                size_t Count, double *RightAscensions, double *Declinations,
+                                                bool *Succeeded = nullptr);
+
     private:
         void EnumeratePlugins();
         void HandlePluginLoading(Telescope *pTelescope, int CurrentPlugin, int NewPlugin);
@@ -163,6 +191,11 @@ class MathPluginManagement : private MathPlugin // Derive from MathPluign to for
                 TelescopeDirectionVector &TelescopeDirectionVector);
         bool (MathPlugin::*pTransformTelescopeToCelestial)(const TelescopeDirectionVector &TelescopeDirectionVector,
                 double &RightAscension, double &Declination);
+        bool (MathPlugin::*pTransformCelestialToTelescopeBatch)(const double *RightAscensions, const double *Declinations,
+                size_t Count, double JulianOffset,
+                TelescopeDirectionVector *TelescopeDirectionVectors, bool *Succeeded);
+        bool (MathPlugin::*pTransformTelescopeToCelestialBatch)(const TelescopeDirectionVector *TelescopeDirectionVectors,
+                size_t Count, double *RightAscensions, double *Declinations, bool *Succeeded);
         MathPlugin *pLoadedMathPlugin;
         void *LoadedMathPluginHandle;
 
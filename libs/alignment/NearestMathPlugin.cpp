@@ -22,6 +22,9 @@
 
 #include <libnova/julian_day.h>
 
+#include <algorithm>
+#include <numeric>
+
 namespace INDI
 {
 namespace AlignmentSubsystem
@@ -80,6 +83,8 @@ bool NearestMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
     const auto &SyncPoints = pInMemoryDatabase->GetAlignmentDatabase();
     // Clear all extended alignment points so we can re-create them.
     ExtendedAlignmentPoints.clear();
+    CelestialTree.Clear();
+    TelescopeTree.Clear();
 
     IGeographicCoordinates Position;
     if (!pInMemoryDatabase->GetDatabaseReferencePosition(Position))
@@ -124,6 +129,23 @@ bool NearestMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
         ExtendedAlignmentPoints.push_back(oneEntry);
     }
 
+    // Index the points once, transforms then look up the nearest one without visiting them all.
+    std::vector<double> Azimuths, Altitudes;
+    for (auto &oneEntry : ExtendedAlignmentPoints)
+    {
+        Azimuths.push_back(oneEntry.CelestialAzimuth);
+        Altitudes.push_back(oneEntry.CelestialAltitude);
+    }
+    CelestialTree.Build(Azimuths, Altitudes);
+    Azimuths.clear();
+    Altitudes.clear();
+    for (auto &oneEntry : ExtendedAlignmentPoints)
+    {
+        Azimuths.push_back(oneEntry.TelescopeAzimuth);
+        Altitudes.push_back(oneEntry.TelescopeAltitude);
+    }
+    TelescopeTree.Build(Azimuths, Altitudes);
+
     return true;
 }
 
@@ -138,9 +160,47 @@ bool NearestMathPlugin::TransformCelestialToTelescope(const double RightAscensio
     if (!pInMemoryDatabase || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
         return false;
 
+    // Get Julian date from system and apply Julian Offset if any.
+    return CelestialToTelescope(RightAscension, Declination, Position, ln_get_julian_from_sys() + JulianOffset,
+                                ApparentTelescopeDirectionVector);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+bool NearestMathPlugin::TransformCelestialToTelescopeBatch(const double *RightAscensions, const double *Declinations,
+        size_t Count, double JulianOffset, TelescopeDirectionVector *ApparentTelescopeDirectionVectors, bool *Succeeded)
+{
+    // Get Position once for all the coordinates
+    IGeographicCoordinates Position;
+    if (!pInMemoryDatabase || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
+    {
+        for (size_t i = 0; Succeeded && i < Count; i++)
+            Succeeded[i] = false;
+        return false;
+    }
+
     // Get Julian date from system and apply Julian Offset if any.
     double JDD = ln_get_julian_from_sys() + JulianOffset;
 
+    bool AllSucceeded = true;
+    for (size_t i = 0; i < Count; i++)
+    {
+        bool Result = CelestialToTelescope(RightAscensions[i], Declinations[i], Position, JDD,
+                                           ApparentTelescopeDirectionVectors[i]);
+        if (Succeeded)
+            Succeeded[i] = Result;
+        AllSucceeded = AllSucceeded && Result;
+    }
+    return AllSucceeded;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+bool NearestMathPlugin::CelestialToTelescope(const double RightAscension, const double Declination,
+        IGeographicCoordinates &Position, double JDD, TelescopeDirectionVector &ApparentTelescopeDirectionVector)
+{
     // Compute CURRENT horizontal coords.
     INDI::IEquatorialCoordinates CelestialRADE {RightAscension, Declination};
     INDI::IHorizontalCoordinates CelestialAltAz;
@@ -219,8 +279,45 @@ bool NearestMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVe
     if (!pInMemoryDatabase || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
         return false;
 
+    return TelescopeToCelestial(ApparentTelescopeDirectionVector, Position, ln_get_julian_from_sys(), RightAscension,
+                                Declination);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+bool NearestMathPlugin::TransformTelescopeToCelestialBatch(const TelescopeDirectionVector *ApparentTelescopeDirectionVectors,
+        size_t Count, double *RightAscensions, double *Declinations, bool *Succeeded)
+{
+    // Get Position once for all the directions
+    IGeographicCoordinates Position;
+    if (!pInMemoryDatabase || !pInMemoryDatabase->GetDatabaseReferencePosition(Position))
+    {
+        for (size_t i = 0; Succeeded && i < Count; i++)
+            Succeeded[i] = false;
+        return false;
+    }
+
     double JDD = ln_get_julian_from_sys();
 
+    bool AllSucceeded = true;
+    for (size_t i = 0; i < Count; i++)
+    {
+        bool Result = TelescopeToCelestial(ApparentTelescopeDirectionVectors[i], Position, JDD, RightAscensions[i],
+                                           Declinations[i]);
+        if (Succeeded)
+            Succeeded[i] = Result;
+        AllSucceeded = AllSucceeded && Result;
+    }
+    return AllSucceeded;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+bool NearestMathPlugin::TelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
+        IGeographicCoordinates &Position, double JDD, double &RightAscension, double &Declination)
+{
     // Telescope Equatorial Coordinates
     INDI::IEquatorialCoordinates TelescopeRADE;
 
@@ -295,38 +392,111 @@ bool NearestMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVe
 ExtendedAlignmentDatabaseEntry NearestMathPlugin::GetNearestPoint(const double Azimuth, const double Altitude,
         bool isCelestial)
 {
-    ExtendedAlignmentDatabaseEntry nearest;
-    double distance = 1e6;
+    int index = (isCelestial ? CelestialTree : TelescopeTree).Nearest(Azimuth, Altitude);
+    if (index < 0)
+        return ExtendedAlignmentDatabaseEntry();
 
-    for (auto &oneEntry : ExtendedAlignmentPoints)
-    {
-        double oneDistance = 0;
+    return ExtendedAlignmentPoints[index];
+}
 
-        if (isCelestial)
-            oneDistance = SphereUnitDistance(Azimuth, oneEntry.CelestialAzimuth, Altitude, oneEntry.CelestialAltitude);
-        else
-            oneDistance = SphereUnitDistance(Azimuth, oneEntry.TelescopeAzimuth, Altitude, oneEntry.TelescopeAltitude);
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+std::array<double, 3> NearestMathPlugin::UnitVectorTree::UnitVector(double Azimuth, double Altitude)
+{
+    double az = Azimuth * (M_PI / 180), alt = Altitude * (M_PI / 180);
+    return {{ cos(alt) * cos(az), cos(alt) * sin(az), sin(alt) }};
+}
 
-        if (oneDistance < distance)
-        {
-            nearest = oneEntry;
-            distance = oneDistance;
-        }
-    }
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+void NearestMathPlugin::UnitVectorTree::Clear()
+{
+    Vectors.clear();
+    Order.clear();
+}
 
-    return nearest;
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+void NearestMathPlugin::UnitVectorTree::Build(const std::vector<double> &Azimuths, const std::vector<double> &Altitudes)
+{
+    Clear();
+    for (size_t i = 0; i < Azimuths.size(); i++)
+        Vectors.push_back(UnitVector(Azimuths[i], Altitudes[i]));
+    Order.resize(Vectors.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    BuildRange(0, Order.size(), 0);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////
-/// Using haversine: http://en.wikipedia.org/wiki/Haversine_formula
+///
 //////////////////////////////////////////////////////////////////////////////////////
-double NearestMathPlugin::SphereUnitDistance(double theta1, double theta2, double phi1, double phi2)
+void NearestMathPlugin::UnitVectorTree::BuildRange(size_t Begin, size_t End, int Axis)
 {
-    double sqrt_haversin_lat  = sin(((phi2 - phi1) / 2) * (M_PI / 180));
-    double sqrt_haversin_long = sin(((theta2 - theta1) / 2) * (M_PI / 180));
-    return (2 *
-            asin(sqrt((sqrt_haversin_lat * sqrt_haversin_lat) + cos(phi1 * (M_PI / 180)) * cos(phi2 * (M_PI / 180)) *
-                      (sqrt_haversin_long * sqrt_haversin_long))));
+    if (End - Begin < 2)
+        return;
+
+    size_t Middle = Begin + (End - Begin) / 2;
+    std::nth_element(Order.begin() + Begin, Order.begin() + Middle, Order.begin() + End, [&](int a, int b)
+    {
+        return Vectors[a][Axis] < Vectors[b][Axis];
+    });
+    BuildRange(Begin, Middle, (Axis + 1) % 3);
+    BuildRange(Middle + 1, End, (Axis + 1) % 3);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+int NearestMathPlugin::UnitVectorTree::Nearest(double Azimuth, double Altitude) const
+{
+    int Best = -1;
+    // The squared chord, 2 - 2 * dot product, orders points as their angular distance does
+    // and is measured without cancellation between close points
+    double BestDistance = 1e6;
+    Search(0, Order.size(), 0, UnitVector(Azimuth, Altitude), Best, BestDistance);
+    return Best;
 }
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+void NearestMathPlugin::UnitVectorTree::Search(size_t Begin, size_t End, int Axis, const std::array<double, 3> &Target,
+        int &Best, double &BestDistance) const
+{
+    if (Begin >= End)
+        return;
+
+    size_t Middle = Begin + (End - Begin) / 2;
+    int Index = Order[Middle];
+    const std::array<double, 3> &Point = Vectors[Index];
+    double Distance = 0;
+    for (int i = 0; i < 3; i++)
+        Distance += (Point[i] - Target[i]) * (Point[i] - Target[i]);
+    if (Distance < BestDistance || (Distance == BestDistance && Index < Best))
+    {
+        Best = Index;
+        BestDistance = Distance;
+    }
+
+    // Visit the side of the split the target is on first, the other one only if it may hold a nearer point
+    double Offset = Target[Axis] - Point[Axis];
+    int Next = (Axis + 1) % 3;
+    if (Offset < 0)
+    {
+        Search(Begin, Middle, Next, Target, Best, BestDistance);
+        if (Offset * Offset <= BestDistance)
+            Search(Middle + 1, End, Next, Target, Best, BestDistance);
+    }
+    else
+    {
+        Search(Middle + 1, End, Next, Target, Best, BestDistance);
+        if (Offset * Offset <= BestDistance)
+            Search(Begin, Middle, Next, Target, Best, BestDistance);
+    }
+}
+
 } // namespace AlignmentSubsystem
 } // namespace INDI
@@ -23,6 +23,9 @@
 #include "AlignmentSubsystemForMathPlugins.h"
 #include "ConvexHull.h"
 
+#include <array>
+#include <vector>
+
 namespace INDI
 {
 namespace AlignmentSubsystem
@@ -109,22 +112,80 @@ class NearestMathPlugin : public AlignmentSubsystemForMathPlugins
         virtual bool TransformTelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
                 double &RightAscension, double &Declination);
 
+        virtual bool TransformCelestialToTelescopeBatch(const double *RightAscensions, const double *Declinations,
+                size_t Count, double JulianOffset,
+                TelescopeDirectionVector *ApparentTelescopeDirectionVectors, bool *Succeeded);
+
+        virtual bool TransformTelescopeToCelestialBatch(const TelescopeDirectionVector *ApparentTelescopeDirectionVectors,
+                size_t Count, double *RightAscensions, double *Declinations, bool *Succeeded);
+
     private:
+        /**
+         * @brief CelestialToTelescope Transform celestial coordinates once the position and date are known.
+         * @param RightAscension Celestial RA in hours.
+         * @param Declination Celestial DE in degrees.
+         * @param Position Database reference position.
+         * @param JDD Julian date of the transform.
+         * @param ApparentTelescopeDirectionVector Output telescope direction.
+         * @return True if successful.
+         */
+        bool CelestialToTelescope(const double RightAscension, const double Declination, IGeographicCoordinates &Position,
+                                  double JDD, TelescopeDirectionVector &ApparentTelescopeDirectionVector);
+
+        /**
+         * @brief TelescopeToCelestial Transform a telescope direction once the position and date are known.
+         * @param ApparentTelescopeDirectionVector Telescope direction.
+         * @param Position Database reference position.
+         * @param JDD Julian date of the transform.
+         * @param RightAscension Output celestial RA in hours.
+         * @param Declination Output celestial DE in degrees.
+         * @return True if successful.
+         */
+        bool TelescopeToCelestial(const TelescopeDirectionVector &ApparentTelescopeDirectionVector,
+                                  IGeographicCoordinates &Position, double JDD, double &RightAscension, double &Declination);
 
-        std::vector<ExtendedAlignmentDatabaseEntry> ExtendedAlignmentPoints;
 
         /**
-         * @brief SphereUnitDistance Get distance between two points on a sphere.
-         * @param theta1 latitudal angle of object 1
-         * @param theta2 latitudal angle of object 2
-         * @param phi1 longitudal angle of object 1
-         * @param phi2 longitudal angle of object 2
-         * @return disatnce in degrees.
+         * @brief The UnitVectorTree class is a k-d tree of points on the unit sphere. The nearest point to a
+         * direction is the one with the smallest chord, that is the largest dot product, found in logarithmic time.
          */
-        double SphereUnitDistance(double theta1, double theta2, double phi1, double phi2);
+        class UnitVectorTree
+        {
+            public:
+                /**
+                 * @brief Build Index the points.
+                 * @param Azimuths Point azimuths in degrees.
+                 * @param Altitudes Point altitudes in degrees, as many as the azimuths.
+                 */
+                void Build(const std::vector<double> &Azimuths, const std::vector<double> &Altitudes);
+
+                /**
+                 * @brief Nearest Find the point nearest to a direction.
+                 * @param Azimuth Direction azimuth in degrees.
+                 * @param Altitude Direction altitude in degrees.
+                 * @return Index of the nearest point as passed to Build, of the first one on ties, or -1 if there are none.
+                 */
+                int Nearest(double Azimuth, double Altitude) const;
+
+                void Clear();
+
+            private:
+                static std::array<double, 3> UnitVector(double Azimuth, double Altitude);
+                void BuildRange(size_t Begin, size_t End, int Axis);
+                void Search(size_t Begin, size_t End, int Axis, const std::array<double, 3> &Target, int &Best,
+                            double &BestDistance) const;
+
+                std::vector<std::array<double, 3>> Vectors;
+                // Point indices, each range is split at its middle point along the axis of its depth
+                std::vector<int> Order;
+        };
+
+        std::vector<ExtendedAlignmentDatabaseEntry> ExtendedAlignmentPoints;
+        UnitVectorTree CelestialTree;
+        UnitVectorTree TelescopeTree;
 
         /**
-         * @brief GetNearestPoint Traverses the ExtendedAlignmentPoints to find the closest point in horizontal coordinates on
+         * @brief GetNearestPoint Searches the ExtendedAlignmentPoints for the closest point in horizontal coordinates on
          * a sphere.
          * @param Azimuth Object azimuth in degrees.
          * @param Altitude Object altitude in degrees.
@@ -27,12 +27,12 @@ class SVDMathPlugin : public BasicMathPlugin
         /// \param[in] Beta1 Pointer to the first coordinate in the beta reference frame
         /// \param[in] Beta2 Pointer to the second coordinate in the beta reference frame
         /// \param[in] Beta3 Pointer to the third coordinate in the beta reference frame
-        /// \param[in] pAlphaToBeta Pointer to a matrix to receive the Alpha to Beta transformation matrix
-        /// \param[in] pBetaToAlpha Pointer to a matrix to receive the Beta to Alpha transformation matrix
+        /// \param[out] AlphaToBeta The matrix to receive the Alpha to Beta transformation matrix
+        /// \param[out] pBetaToAlpha Pointer to a matrix to receive the Beta to Alpha transformation matrix, or nullptr
         void CalculateTransformMatrices(const TelescopeDirectionVector &Alpha1, const TelescopeDirectionVector &Alpha2,
                                         const TelescopeDirectionVector &Alpha3, const TelescopeDirectionVector &Beta1,
                                         const TelescopeDirectionVector &Beta2, const TelescopeDirectionVector &Beta3,
-                                        gsl_matrix *pAlphaToBeta, gsl_matrix *pBetaToAlpha);
+                                        Matrix3x3 &AlphaToBeta, Matrix3x3 *pBetaToAlpha);
 };
 
 } // namespace AlignmentSubsystem
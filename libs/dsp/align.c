@@ -256,12 +256,72 @@ dsp_triangle *dsp_align_calc_triangle(dsp_star* stars, int num_stars)
     return triangle;
 }
 
+/* Triangles match when their side ratios agree within this, whatever the scale and rotation */
+#define DSP_ALIGN_RATIO_TOLERANCE 0.01
+/* Brightest stars of each frame that triangles are made of, unless changed with dsp_align_max_stars */
+#define DSP_ALIGN_MAX_STARS 50
+
+static int DSP_ALIGN_STARS = DSP_ALIGN_MAX_STARS;
+
+int dsp_align_max_stars(int value)
+{
+    if(value > 0)
+        DSP_ALIGN_STARS = value;
+    return DSP_ALIGN_STARS;
+}
+
+typedef struct {
+    double ratio;
+    int index;
+} dsp_align_key;
+
+static int dsp_qsort_align_key_asc(const void *arg1, const void *arg2)
+{
+    const dsp_align_key* a = (const dsp_align_key*)arg1;
+    const dsp_align_key* b = (const dsp_align_key*)arg2;
+    return (a->ratio > b->ratio) - (a->ratio < b->ratio);
+}
+
+static void dsp_align_make_triangles(dsp_stream_p stream, dsp_star *stars, int num_stars)
+{
+    int x, y;
+    int stars_count = Min(stream->stars_count, DSP_ALIGN_STARS);
+    while(stream->triangles_count > 0)
+        dsp_stream_del_triangle(stream, stream->triangles_count-1);
+    for(x = 0; x < stars_count * (stars_count-num_stars+1) / 2; x++) {
+        for(y = 0; y < num_stars; y++) {
+            stars[y] = stream->stars[(x + y * (x / stars_count + 1)) % stars_count];
+        }
+        dsp_triangle *t = dsp_align_calc_triangle(stars, num_stars);
+        dsp_stream_add_triangle(stream, *t);
+        dsp_align_free_triangle(t);
+    }
+}
+
+static void dsp_align_try_match(dsp_stream_p stream1, dsp_stream_p stream2, int t1, int t2, double decimals)
+{
+    dsp_align_info *align_info = dsp_align_fill_info(stream1->triangles[t1], stream2->triangles[t2]);
+    if(align_info->score < stream2->align_info.score) {
+        memcpy(stream2->align_info.center, align_info->center, sizeof(double)*stream2->align_info.dims);
+        memcpy(stream2->align_info.factor, align_info->factor, sizeof(double)*stream2->align_info.dims);
+        memcpy(stream2->align_info.offset, align_info->offset, sizeof(double)*stream2->align_info.dims);
+        memcpy(stream2->align_info.radians, align_info->radians, sizeof(double)*(stream2->align_info.dims-1));
+        memcpy(stream2->align_info.triangles, align_info->triangles, sizeof(dsp_triangle)*2);
+        stream2->align_info.score = align_info->score;
+        stream2->align_info.decimals = decimals;
+    }
+    free(align_info->center);
+    free(align_info->factor);
+    free(align_info->offset);
+    free(align_info->radians);
+    free(align_info);
+}
+
 int dsp_align_get_offset(dsp_stream_p stream1, dsp_stream_p stream2, double tolerance, double target_score, int num_stars)
 {
-    dsp_align_info *align_info;
     double decimals = pow(10, tolerance);
     double div = 0.0;
-    int d, t1, t2, x, y;
+    int d, t1, t2, x;
     double phi = 0.0;
     double ratio = decimals*1600.0/div;
     dsp_star *stars = (dsp_star*)malloc(sizeof(dsp_star)*num_stars);
@@ -276,50 +336,45 @@ int dsp_align_get_offset(dsp_stream_p stream1, dsp_stream_p stream2, double tole
     stream2->align_info.score = 1.0;
     stream2->align_info.decimals = decimals;
     pgarb("creating triangles for reference frame...\n");
-    while(stream1->triangles_count > 0)
-        dsp_stream_del_triangle(stream1, stream1->triangles_count-1);
-    for(x = 0; x < stream1->stars_count * (stream1->stars_count-num_stars+1) / 2; x++) {
-        for(y = 0; y < num_stars; y++) {
-            stars[y] = stream1->stars[(x + y * (x / stream1->stars_count + 1)) % stream1->stars_count];
-        }
-        dsp_triangle *t = dsp_align_calc_triangle(stars, num_stars);
-        dsp_stream_add_triangle(stream1, *t);
-        dsp_align_free_triangle(t);
-    }
+    dsp_align_make_triangles(stream1, stars, num_stars);
     pgarb("creating triangles for current frame...\n");
-    while(stream2->triangles_count > 0)
-        dsp_stream_del_triangle(stream2, stream2->triangles_count-1);
-    for(x = 0; x < stream2->stars_count * (stream2->stars_count-num_stars+1) / 2; x++) {
-        for(y = 0; y < num_stars; y++) {
-            stars[y] = stream2->stars[(x + y * (x / stream2->stars_count + 1)) % stream2->stars_count];
-        }
-        dsp_triangle *t = dsp_align_calc_triangle(stars, num_stars);
-        dsp_stream_add_triangle(stream2, *t);
-        dsp_align_free_triangle(t);
-    }
+    dsp_align_make_triangles(stream2, stars, num_stars);
     free(stars);
     stream2->align_info.center = (double*)malloc(sizeof(double)*stream2->align_info.dims);
     stream2->align_info.factor = (double*)malloc(sizeof(double)*stream2->align_info.dims);
     stream2->align_info.offset = (double*)malloc(sizeof(double)*stream2->align_info.dims);
     stream2->align_info.radians = (double*)malloc(sizeof(double)*(stream2->align_info.dims-1));
-    for(t1 = 0; t1 < stream1->triangles_count; t1++) {
+    if(num_stars < 3) {
+        for(t1 = 0; t1 < stream1->triangles_count; t1++)
+            for(t2 = 0; t2 < stream2->triangles_count; t2++)
+                dsp_align_try_match(stream1, stream2, t1, t2, decimals);
+    } else {
+        // side ratios do not change with scale and rotation: only triangles of the current frame
+        // whose two first ratios are close to those of a reference triangle are scored
+        dsp_align_key *keys = (dsp_align_key*)malloc(sizeof(dsp_align_key)*Max(1, stream2->triangles_count));
         for(t2 = 0; t2 < stream2->triangles_count; t2++) {
-            align_info = dsp_align_fill_info(stream1->triangles[t1], stream2->triangles[t2]);
-            if(align_info->score < stream2->align_info.score) {
-                memcpy(stream2->align_info.center, align_info->center, sizeof(double)*stream2->align_info.dims);
-                memcpy(stream2->align_info.factor, align_info->factor, sizeof(double)*stream2->align_info.dims);
-                memcpy(stream2->align_info.offset, align_info->offset, sizeof(double)*stream2->align_info.dims);
-                memcpy(stream2->align_info.radians, align_info->radians, sizeof(double)*(stream2->align_info.dims-1));
-                memcpy(stream2->align_info.triangles, align_info->triangles, sizeof(dsp_triangle)*2);
-                stream2->align_info.score = align_info->score;
-                stream2->align_info.decimals = decimals;
+            keys[t2].ratio = stream2->triangles[t2].ratios[1];
+            keys[t2].index = t2;
+        }
+        qsort(keys, stream2->triangles_count, sizeof(dsp_align_key), dsp_qsort_align_key_asc);
+        for(t1 = 0; t1 < stream1->triangles_count; t1++) {
+            double *ratios = stream1->triangles[t1].ratios;
+            int low = 0, high = stream2->triangles_count;
+            while(low < high) {
+                int mid = (low + high) / 2;
+                if(keys[mid].ratio < ratios[1] - DSP_ALIGN_RATIO_TOLERANCE)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            for(x = low; x < stream2->triangles_count && keys[x].ratio <= ratios[1] + DSP_ALIGN_RATIO_TOLERANCE; x++) {
+                t2 = keys[x].index;
+                if(fabs(stream2->triangles[t2].ratios[2] - ratios[2]) > DSP_ALIGN_RATIO_TOLERANCE)
+                    continue;
+                dsp_align_try_match(stream1, stream2, t1, t2, decimals);
             }
-            free(align_info->center);
-            free(align_info->factor);
-            free(align_info->offset);
-            free(align_info->radians);
-            free(align_info);
         }
+        free(keys);
     }
     double radians = stream2->align_info.radians[0];
     for(d = 0; d < stream1->dims; d++) {
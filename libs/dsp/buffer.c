@@ -27,8 +27,11 @@ void dsp_buffer_shift(dsp_stream_p stream)
         return;
     dsp_t* tmp = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
     int x, d;
+    int cur[stream->dims], pos[stream->dims];
+    dsp_stream_fill_position(stream, 0, cur);
     for(x = 0; x < stream->len/2; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+        memcpy(pos, cur, sizeof(int) * stream->dims);
+        dsp_stream_next_position(stream, cur);
         for(d = 0; d < stream->dims; d++) {
             if(pos[d]<stream->sizes[d] / 2) {
                 pos[d] += stream->sizes[d] / 2;
@@ -38,7 +41,6 @@ void dsp_buffer_shift(dsp_stream_p stream)
         }
         tmp[x] = stream->buf[dsp_stream_set_position(stream, pos)];
         tmp[dsp_stream_set_position(stream, pos)] = stream->buf[x];
-        free(pos);
     }
     memcpy(stream->buf, tmp, stream->len * sizeof(dsp_t));
     free(tmp);
@@ -47,8 +49,10 @@ void dsp_buffer_shift(dsp_stream_p stream)
 void dsp_buffer_removemean(dsp_stream_p stream)
 {
     int k;
+    double sum;
 
-    dsp_t mean = dsp_stats_mean(stream->buf, stream->len);
+    dsp_stats_reduce(stream->buf, stream->len, NULL, NULL, &sum, NULL);
+    dsp_t mean = sum / stream->len;
     for(k = 0; k < stream->len; k++)
         stream->buf[k] = stream->buf[k] - mean;
 
@@ -232,156 +236,182 @@ static int compare( const void* a, const void* b)
      else return 1;
 }
 
-static void* dsp_buffer_median_th(void* arg)
+struct dsp_buffer_window_args {
+    int size;
+    int median;
+    dsp_stream_p stream;
+    dsp_stream_p box;
+};
+
+static void dsp_buffer_median_range(int start, int end, void* arg)
 {
-    struct {
-        int cur_th;
-        int size;
-        int median;
-        dsp_stream_p stream;
-        dsp_stream_p box;
-     } *arguments = arg;
+    struct dsp_buffer_window_args *arguments = arg;
     dsp_stream_p stream = arguments->stream;
     dsp_stream_p box = arguments->box;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
     int size = arguments->size;
     int median = arguments->median;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int x, y, dim, idx;
+    int cur[stream->dims], pos[stream->dims], mat[stream->dims];
+    dsp_stream_fill_position(stream, start, cur);
     dsp_t* sorted = (dsp_t*)malloc(pow(size, stream->dims) * sizeof(dsp_t));
     int len = pow(size, in->dims);
     for(x = start; x < end; x++) {
         dsp_t* buf = sorted;
+        memset(mat, 0, sizeof(int) * stream->dims);
         for(y = 0; y < box->len; y++) {
-            int *pos = dsp_stream_get_position(stream, x);
-            int *mat = dsp_stream_get_position(box, y);
             for(dim = 0; dim < stream->dims; dim++) {
-                pos[dim] += mat[dim] - size / 2;
+                pos[dim] = cur[dim] + mat[dim] - size / 2;
             }
+            dsp_stream_next_position(box, mat);
             idx = dsp_stream_set_position(stream, pos);
             if(idx >= 0 && idx < in->len) {
                 *buf++ = in->buf[idx];
             }
-            free(pos);
-            free(mat);
         }
+        dsp_stream_next_position(stream, cur);
         qsort(sorted, len, sizeof(dsp_t), compare);
         stream->buf[x] = sorted[median*box->len/size];
     }
-    dsp_stream_free_buffer(box);
-    dsp_stream_free(box);
     free(sorted);
-    return NULL;
+}
+
+/* k-th smallest of n values, partially reordering them (Hoare's selection) */
+static dsp_t dsp_buffer_select(dsp_t *values, int n, int k)
+{
+    int left = 0, right = n - 1;
+    while(left < right) {
+        dsp_t pivot = values[(left + right) / 2];
+        int i = left, j = right;
+        while(i <= j) {
+            while(values[i] < pivot) i++;
+            while(values[j] > pivot) j--;
+            if(i <= j) {
+                dsp_t tmp = values[i];
+                values[i++] = values[j];
+                values[j--] = tmp;
+            }
+        }
+        if(k <= j) right = j;
+        else if(k >= i) left = i;
+        else break;
+    }
+    return values[k];
+}
+
+/* 2-D windows are read through row pointers, edges repeat the border pixels */
+static void dsp_buffer_median_2d_range(int start, int end, void* arg)
+{
+    struct dsp_buffer_window_args *arguments = arg;
+    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p in = stream->parent;
+    int size = arguments->size;
+    int w = stream->sizes[0];
+    int h = stream->sizes[1];
+    int n = size * size;
+    int rank = Max(0, Min(n - 1, arguments->median * n / size));
+    int x, y, dx, dy;
+    dsp_t* window = (dsp_t*)malloc(sizeof(dsp_t) * n);
+    dsp_t** rows = (dsp_t**)malloc(sizeof(dsp_t*) * size);
+    for(y = start; y < end; y++) {
+        for(dy = 0; dy < size; dy++)
+            rows[dy] = in->buf + Max(0, Min(h - 1, y + dy - size / 2)) * w;
+        for(x = 0; x < w; x++) {
+            dsp_t *value = window;
+            int first = x - size / 2;
+            if(first >= 0 && first + size <= w) {
+                for(dy = 0; dy < size; dy++)
+                    for(dx = 0; dx < size; dx++)
+                        *value++ = rows[dy][first + dx];
+            } else {
+                for(dy = 0; dy < size; dy++)
+                    for(dx = 0; dx < size; dx++)
+                        *value++ = rows[dy][Max(0, Min(w - 1, first + dx))];
+            }
+            stream->buf[y * w + x] = dsp_buffer_select(window, n, rank);
+        }
+    }
+    free(rows);
+    free(window);
+}
+
+static void dsp_buffer_median_2d(dsp_stream_p in, int size, int median)
+{
+    dsp_stream_p stream = dsp_stream_copy(in);
+    stream->parent = in;
+    struct dsp_buffer_window_args arguments = { size, median, stream, NULL };
+    dsp_parallel_for(stream->sizes[1], 1, dsp_buffer_median_2d_range, &arguments);
+    stream->parent = NULL;
+    dsp_buffer_copy(stream->buf, in->buf, stream->len);
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
 }
 
 void dsp_buffer_median(dsp_stream_p in, int size, int median)
 {
-    size_t y;
+    if(in->dims == 2 && size > 0) {
+        dsp_buffer_median_2d(in, size, median);
+        return;
+    }
     int d;
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    pthread_t *th = (pthread_t *)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       int size;
-       int median;
-       dsp_stream_p stream;
-       dsp_stream_p box;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++)
-    {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].size = size;
-        thread_arguments[y].median = median;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].box = dsp_stream_new();
-        for(d = 0; d < stream->dims; d++)
-            dsp_stream_add_dim(thread_arguments[y].box, size);
-        dsp_stream_alloc_buffer(thread_arguments[y].box, thread_arguments[y].box->len);
-        pthread_create(&th[y], NULL, dsp_buffer_median_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_stream_p box = dsp_stream_new();
+    for(d = 0; d < stream->dims; d++)
+        dsp_stream_add_dim(box, size);
+    struct dsp_buffer_window_args arguments = { size, median, stream, box };
+    dsp_parallel_for(stream->len, 64, dsp_buffer_median_range, &arguments);
+    dsp_stream_free(box);
     stream->parent = NULL;
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
 }
 
-static void* dsp_buffer_sigma_th(void* arg)
+static void dsp_buffer_sigma_range(int start, int end, void* arg)
 {
-    struct {
-        int cur_th;
-        int size;
-        dsp_stream_p stream;
-        dsp_stream_p box;
-     } *arguments = arg;
+    struct dsp_buffer_window_args *arguments = arg;
     dsp_stream_p stream = arguments->stream;
     dsp_stream_p in = stream->parent;
     dsp_stream_p box = arguments->box;
-    int cur_th = arguments->cur_th;
     int size = arguments->size;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int x, y, dim, idx;
+    int cur[stream->dims], pos[stream->dims], mat[stream->dims];
+    dsp_stream_fill_position(stream, start, cur);
     dsp_t* sigma = (dsp_t*)malloc(pow(size, stream->dims) * sizeof(dsp_t));
     int len = pow(size, in->dims);
     for(x = start; x < end; x++) {
         dsp_t* buf = sigma;
+        memset(mat, 0, sizeof(int) * stream->dims);
         for(y = 0; y < box->len; y++) {
-            int *pos = dsp_stream_get_position(stream, x);
-            int *mat = dsp_stream_get_position(box, y);
             for(dim = 0; dim < stream->dims; dim++) {
-                pos[dim] += mat[dim] - size / 2;
+                pos[dim] = cur[dim] + mat[dim] - size / 2;
             }
+            dsp_stream_next_position(box, mat);
             idx = dsp_stream_set_position(stream, pos);
             if(idx >= 0 && idx < in->len) {
                 buf[y] = in->buf[idx];
             }
-            free(pos);
-            free(mat);
         }
+        dsp_stream_next_position(stream, cur);
         stream->buf[x] = dsp_stats_stddev(buf, len);
     }
-    dsp_stream_free_buffer(box);
-    dsp_stream_free(box);
     free(sigma);
-    return NULL;
 }
 
 void dsp_buffer_sigma(dsp_stream_p in, int size)
 {
-    size_t y;
     int d;
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    pthread_t *th = (pthread_t *)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       int size;
-       dsp_stream_p stream;
-       dsp_stream_p box;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++)
-    {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].size = size;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].box = dsp_stream_new();
-        for(d = 0; d < stream->dims; d++)
-            dsp_stream_add_dim(thread_arguments[y].box, size);
-        pthread_create(&th[y], NULL, dsp_buffer_sigma_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_stream_p box = dsp_stream_new();
+    for(d = 0; d < stream->dims; d++)
+        dsp_stream_add_dim(box, size);
+    struct dsp_buffer_window_args arguments = { size, 0, stream, box };
+    dsp_parallel_for(stream->len, 64, dsp_buffer_sigma_range, &arguments);
+    dsp_stream_free(box);
     stream->parent = NULL;
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
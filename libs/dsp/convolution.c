@@ -21,16 +21,17 @@
 
 void dsp_convolution_convolution(dsp_stream_p stream, dsp_stream_p matrix) {
     int x, y, d;
-    dsp_t mn = dsp_stats_min(stream->buf, stream->len);
-    dsp_t mx = dsp_stats_max(stream->buf, stream->len);
+    dsp_t mn, mx;
+    dsp_stats_reduce(stream->buf, stream->len, &mn, &mx, NULL, NULL);
     int* d_pos = (int*)malloc(sizeof(int)*stream->dims);
+    int pos[matrix->dims];
+    dsp_stream_fill_position(matrix, 0, pos);
     for(y = 0; y < matrix->len; y++) {
-        int* pos = dsp_stream_get_position(matrix, y);
         for(d = 0; d < stream->dims; d++) {
             d_pos[d] = stream->sizes[d]/2+pos[d]-matrix->sizes[d]/2;
         }
+        dsp_stream_next_position(matrix, pos);
         x = dsp_stream_set_position(stream, d_pos);
-        free(pos);
         if(x >= 0 && x < stream->magnitude->len)
             stream->magnitude->buf[x] *= sqrt(matrix->magnitude->buf[y]);
     }
@@ -41,17 +42,18 @@ void dsp_convolution_convolution(dsp_stream_p stream, dsp_stream_p matrix) {
 
 void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p matrix) {
     int x, y, d;
-    dsp_t mn = dsp_stats_min(stream->buf, stream->len);
-    dsp_t mx = dsp_stats_max(stream->buf, stream->len);
+    dsp_t mn, mx;
+    dsp_stats_reduce(stream->buf, stream->len, &mn, &mx, NULL, NULL);
     int* d_pos = (int*)malloc(sizeof(int)*stream->dims);
     dsp_buffer_shift(matrix->magnitude);
+    int pos[matrix->dims];
+    dsp_stream_fill_position(matrix, 0, pos);
     for(y = 0; y < matrix->len; y++) {
-        int* pos = dsp_stream_get_position(matrix, y);
         for(d = 0; d < stream->dims; d++) {
             d_pos[d] = stream->sizes[d]/2+pos[d]-matrix->sizes[d]/2;
         }
+        dsp_stream_next_position(matrix, pos);
         x = dsp_stream_set_position(stream, d_pos);
-        free(pos);
         stream->magnitude->buf[x] *= sqrt(matrix->magnitude->buf[y]);
     }
     dsp_buffer_shift(matrix->magnitude);
@@ -59,3 +61,189 @@ void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p matrix) {
     dsp_fourier_idft(stream);
     dsp_buffer_stretch(stream->buf, stream->len, mn, mx);
 }
+
+/* Kernels with at most this many taps, or separable ones with at most this many taps per pass,
+ * are applied directly rather than through the Fourier transform */
+#define DSP_CONVOLUTION_DIRECT_TAPS 225
+
+struct dsp_convolution_args {
+    dsp_stream_p stream;
+    dsp_stream_p matrix;
+    dsp_t *src;
+    dsp_t *dst;
+    dsp_t *row;
+    dsp_t *column;
+};
+
+/* acc[x] += sum of kernel[k] * src[x - k + size / 2], edges repeat the border samples */
+static void dsp_convolution_row(const dsp_t *src, int w, const dsp_t *kernel, int size, dsp_t *restrict acc)
+{
+    int c = size / 2;
+    int first = Min(w, size - 1 - c);
+    int last = Max(first, w - c);
+    int k, x;
+    for(k = 0; k < size; k++) {
+        dsp_t weight = kernel[k];
+        int shift = c - k;
+        if(weight == 0)
+            continue;
+        const dsp_t *restrict s = src + shift;
+        for(x = first; x < last; x++)
+            acc[x] += weight * s[x];
+        for(x = 0; x < first; x++)
+            acc[x] += weight * src[Max(0, Min(w - 1, x + shift))];
+        for(x = last; x < w; x++)
+            acc[x] += weight * src[Max(0, Min(w - 1, x + shift))];
+    }
+}
+
+/* Splits a 2-D kernel into a column and a row whose outer product it is, returns 0 if it is not one */
+static int dsp_convolution_separate(dsp_stream_p matrix, dsp_t *column, dsp_t *row)
+{
+    int kw = matrix->sizes[0];
+    int kh = matrix->sizes[1];
+    int x, y, pivot = 0;
+    for(x = 1; x < matrix->len; x++)
+        if(fabs(matrix->buf[x]) > fabs(matrix->buf[pivot]))
+            pivot = x;
+    dsp_t peak = matrix->buf[pivot];
+    if(peak == 0)
+        return 0;
+    for(x = 0; x < kw; x++)
+        row[x] = matrix->buf[pivot / kw * kw + x] / peak;
+    for(y = 0; y < kh; y++)
+        column[y] = matrix->buf[y * kw + pivot % kw];
+    for(y = 0; y < kh; y++)
+        for(x = 0; x < kw; x++)
+            if(fabs(column[y] * row[x] - matrix->buf[y * kw + x]) > fabs(peak) * 1e-6)
+                return 0;
+    return 1;
+}
+
+static void dsp_convolution_horizontal_range(int start, int end, void *arg)
+{
+    struct dsp_convolution_args *arguments = arg;
+    int w = arguments->stream->sizes[0];
+    int y;
+    for(y = start; y < end; y++) {
+        dsp_t *acc = arguments->dst + y * w;
+        dsp_buffer_set(acc, w, 0);
+        dsp_convolution_row(arguments->src + y * w, w, arguments->row, arguments->matrix->sizes[0], acc);
+    }
+}
+
+static void dsp_convolution_vertical_range(int start, int end, void *arg)
+{
+    struct dsp_convolution_args *arguments = arg;
+    int w = arguments->stream->sizes[0];
+    int h = arguments->stream->sizes[1];
+    int size = arguments->matrix->sizes[1];
+    int x, y, k;
+    for(y = start; y < end; y++) {
+        dsp_t *restrict acc = arguments->dst + y * w;
+        dsp_buffer_set(acc, w, 0);
+        for(k = 0; k < size; k++) {
+            dsp_t weight = arguments->column[k];
+            const dsp_t *restrict s = arguments->src + Max(0, Min(h - 1, y - k + size / 2)) * w;
+            if(weight == 0)
+                continue;
+            for(x = 0; x < w; x++)
+                acc[x] += weight * s[x];
+        }
+    }
+}
+
+static void dsp_convolution_2d_range(int start, int end, void *arg)
+{
+    struct dsp_convolution_args *arguments = arg;
+    dsp_stream_p matrix = arguments->matrix;
+    int w = arguments->stream->sizes[0];
+    int h = arguments->stream->sizes[1];
+    int kw = matrix->sizes[0];
+    int kh = matrix->sizes[1];
+    int y, k;
+    for(y = start; y < end; y++) {
+        dsp_t *acc = arguments->dst + y * w;
+        dsp_buffer_set(acc, w, 0);
+        // the kernel is mirrored along x by dsp_convolution_row, along y here
+        for(k = 0; k < kh; k++)
+            dsp_convolution_row(arguments->src + Max(0, Min(h - 1, y - k + kh / 2)) * w, w, matrix->buf + k * kw, kw, acc);
+    }
+}
+
+static void dsp_convolution_nd_range(int start, int end, void *arg)
+{
+    struct dsp_convolution_args *arguments = arg;
+    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p matrix = arguments->matrix;
+    int x, y, d;
+    int cur[stream->dims], pos[stream->dims], mat[stream->dims];
+    dsp_stream_fill_position(stream, start, cur);
+    for(x = start; x < end; x++) {
+        dsp_t sum = 0;
+        memset(mat, 0, sizeof(int) * stream->dims);
+        for(y = 0; y < matrix->len; y++) {
+            for(d = 0; d < stream->dims; d++)
+                pos[d] = Max(0, Min(stream->sizes[d] - 1, cur[d] - mat[d] + matrix->sizes[d] / 2));
+            dsp_stream_next_position(matrix, mat);
+            sum += matrix->buf[y] * arguments->src[dsp_stream_set_position(stream, pos)];
+        }
+        dsp_stream_next_position(stream, cur);
+        arguments->dst[x] = sum;
+    }
+}
+
+void dsp_convolution_direct(dsp_stream_p stream, dsp_stream_p matrix)
+{
+    if(stream->dims != matrix->dims || stream->dims < 1)
+        return;
+    struct dsp_convolution_args arguments = { stream, matrix, stream->buf, NULL, NULL, NULL };
+    dsp_t *out = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
+    arguments.dst = out;
+    if(stream->dims == 1) {
+        dsp_buffer_set(out, stream->len, 0);
+        dsp_convolution_row(stream->buf, stream->len, matrix->buf, matrix->len, out);
+    } else if(stream->dims == 2) {
+        dsp_t *row = (dsp_t*)malloc(sizeof(dsp_t) * matrix->sizes[0]);
+        dsp_t *column = (dsp_t*)malloc(sizeof(dsp_t) * matrix->sizes[1]);
+        if(dsp_convolution_separate(matrix, column, row)) {
+            dsp_t *tmp = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
+            arguments.row = row;
+            arguments.column = column;
+            arguments.dst = tmp;
+            dsp_parallel_for(stream->sizes[1], 1, dsp_convolution_horizontal_range, &arguments);
+            arguments.src = tmp;
+            arguments.dst = out;
+            dsp_parallel_for(stream->sizes[1], 1, dsp_convolution_vertical_range, &arguments);
+            free(tmp);
+        } else {
+            dsp_parallel_for(stream->sizes[1], 1, dsp_convolution_2d_range, &arguments);
+        }
+        free(column);
+        free(row);
+    } else {
+        dsp_parallel_for(stream->len, 64, dsp_convolution_nd_range, &arguments);
+    }
+    memcpy(stream->buf, out, sizeof(dsp_t) * stream->len);
+    free(out);
+}
+
+void dsp_convolution_filter(dsp_stream_p stream, dsp_stream_p matrix)
+{
+    int taps = matrix->len;
+    if(stream->dims == 2 && matrix->dims == 2) {
+        dsp_t *row = (dsp_t*)malloc(sizeof(dsp_t) * matrix->sizes[0]);
+        dsp_t *column = (dsp_t*)malloc(sizeof(dsp_t) * matrix->sizes[1]);
+        if(dsp_convolution_separate(matrix, column, row))
+            taps = Max(matrix->sizes[0], matrix->sizes[1]);
+        free(column);
+        free(row);
+    }
+    if(stream->dims == matrix->dims && taps <= DSP_CONVOLUTION_DIRECT_TAPS) {
+        dsp_convolution_direct(stream, matrix);
+        return;
+    }
+    dsp_fourier_dft(stream, 1);
+    dsp_fourier_dft(matrix, 1);
+    dsp_convolution_convolution(stream, matrix);
+}
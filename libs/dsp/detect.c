@@ -0,0 +1,372 @@
+/*
+*   DSP API - a digital signal processing library for astronomy usage
+*   Copyright © 2017-2022  Ilia Platone
+*
+*   This program is free software; you can redistribute it and/or
+*   modify it under the terms of the GNU Lesser General Public
+*   License as published by the Free Software Foundation; either
+*   version 3 of the License, or (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*   Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program; if not, write to the Free Software Foundation,
+*   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "dsp.h"
+
+/* Stars are found in four passes: the background and its noise are estimated on a grid of tiles,
+ * each row is cut into runs of pixels above the background by threshold times the noise, runs
+ * touching on adjacent rows are joined into objects, and the pixels of each object are summed into
+ * its flux, centroid and moments. Only runs are stored, so the cost beyond the first two passes
+ * depends on how much of the frame the stars cover, not on its size. */
+
+/* Side of the background tiles, large compared to stars, small compared to gradients */
+#define DSP_DETECT_TILE 64
+/* Background samples are taken every this many pixels along both axes of a tile */
+#define DSP_DETECT_SUBSAMPLE 4
+/* Pixels sharing one interpolated threshold */
+#define DSP_DETECT_STEP 8
+
+typedef struct {
+    int y;
+    int start;
+    int end;
+    int parent;
+} dsp_detect_run;
+
+typedef struct {
+    double flux;
+    double peak;
+    double sx, sy;
+    double sxx, syy, sxy;
+    double radius;
+    int area;
+    int x0, y0, x1, y1;
+} dsp_detect_object;
+
+struct dsp_detect_args {
+    dsp_stream_p stream;
+    double threshold;
+    int grid_w, grid_h;
+    double *background;
+    double *noise;
+    int *row_runs;
+    dsp_detect_run **chunks;
+};
+
+/* k-th smallest of n values, partially reordering them */
+static double dsp_detect_select(double *values, int n, int k)
+{
+    int left = 0, right = n - 1;
+    while(left < right) {
+        double pivot = values[(left + right) / 2];
+        int i = left, j = right;
+        while(i <= j) {
+            while(values[i] < pivot) i++;
+            while(values[j] > pivot) j--;
+            if(i <= j) {
+                double tmp = values[i];
+                values[i++] = values[j];
+                values[j--] = tmp;
+            }
+        }
+        if(k <= j) right = j;
+        else if(k >= i) left = i;
+        else break;
+    }
+    return values[k];
+}
+
+/* Median and median absolute deviation of the samples of each tile */
+static void dsp_detect_background_range(int start, int end, void *arg)
+{
+    struct dsp_detect_args *arguments = arg;
+    dsp_stream_p stream = arguments->stream;
+    int w = stream->sizes[0];
+    int h = stream->sizes[1];
+    int tile, x, y, n;
+    double *samples = (double*)malloc(sizeof(double) * (DSP_DETECT_TILE / DSP_DETECT_SUBSAMPLE) * (DSP_DETECT_TILE / DSP_DETECT_SUBSAMPLE));
+    for(tile = start; tile < end; tile++) {
+        int x0 = (tile % arguments->grid_w) * DSP_DETECT_TILE;
+        int y0 = (tile / arguments->grid_w) * DSP_DETECT_TILE;
+        n = 0;
+        for(y = y0; y < Min(h, y0 + DSP_DETECT_TILE); y += DSP_DETECT_SUBSAMPLE)
+            for(x = x0; x < Min(w, x0 + DSP_DETECT_TILE); x += DSP_DETECT_SUBSAMPLE)
+                samples[n++] = stream->buf[x + y * w];
+        double median = dsp_detect_select(samples, n, n / 2);
+        for(x = 0; x < n; x++)
+            samples[x] = fabs(samples[x] - median);
+        arguments->background[tile] = median;
+        // MAD to standard deviation of a normal distribution, never zero on flat or quantized tiles
+        arguments->noise[tile] = Max(dsp_detect_select(samples, n, n / 2) * 1.4826, 1e-6 * Max(1.0, fabs(median)));
+    }
+    free(samples);
+}
+
+/* Bilinear interpolation of a tile grid at the center of a pixel */
+static double dsp_detect_interpolate(struct dsp_detect_args *arguments, const double *grid, int x, int y)
+{
+    double gx = Max(0.0, Min(arguments->grid_w - 1.0, (x + 0.5) / DSP_DETECT_TILE - 0.5));
+    double gy = Max(0.0, Min(arguments->grid_h - 1.0, (y + 0.5) / DSP_DETECT_TILE - 0.5));
+    int ix = Min(arguments->grid_w - 2, (int)gx);
+    int iy = Min(arguments->grid_h - 2, (int)gy);
+    ix = Max(0, ix);
+    iy = Max(0, iy);
+    double fx = arguments->grid_w > 1 ? gx - ix : 0;
+    double fy = arguments->grid_h > 1 ? gy - iy : 0;
+    int nx = Min(arguments->grid_w - 1, ix + 1);
+    int ny = Min(arguments->grid_h - 1, iy + 1);
+    double top = grid[ix + iy * arguments->grid_w] * (1 - fx) + grid[nx + iy * arguments->grid_w] * fx;
+    double bottom = grid[ix + ny * arguments->grid_w] * (1 - fx) + grid[nx + ny * arguments->grid_w] * fx;
+    return top * (1 - fy) + bottom * fy;
+}
+
+/* Threshold of every DSP_DETECT_STEP pixels of a row: the tile grid is interpolated along y once
+ * per tile column, then along x */
+static void dsp_detect_levels(struct dsp_detect_args *arguments, int y, double *columns, double *levels)
+{
+    int w = arguments->stream->sizes[0];
+    int gw = arguments->grid_w;
+    double gy = Max(0.0, Min(arguments->grid_h - 1.0, (y + 0.5) / DSP_DETECT_TILE - 0.5));
+    int iy = Max(0, Min(arguments->grid_h - 2, (int)gy));
+    int ny = Min(arguments->grid_h - 1, iy + 1);
+    double fy = gy - iy;
+    int i, x;
+    for(i = 0; i < gw; i++) {
+        double background = arguments->background[i + iy * gw] * (1 - fy) + arguments->background[i + ny * gw] * fy;
+        double noise = arguments->noise[i + iy * gw] * (1 - fy) + arguments->noise[i + ny * gw] * fy;
+        columns[i] = background + arguments->threshold * noise;
+    }
+    for(x = 0; x < w; x += DSP_DETECT_STEP) {
+        double gx = Max(0.0, Min(gw - 1.0, (x + 0.5) / DSP_DETECT_TILE - 0.5));
+        int ix = Max(0, Min(gw - 2, (int)gx));
+        int nx = Min(gw - 1, ix + 1);
+        double fx = gx - ix;
+        levels[x / DSP_DETECT_STEP] = columns[ix] * (1 - fx) + columns[nx] * fx;
+    }
+}
+
+/* Cuts rows into runs of pixels above the threshold, kept in a chunk per range of rows */
+static void dsp_detect_runs_range(int start, int end, void *arg)
+{
+    struct dsp_detect_args *arguments = arg;
+    dsp_stream_p stream = arguments->stream;
+    int w = stream->sizes[0];
+    int x, y;
+    int count = 0, size = 64;
+    dsp_detect_run *runs = (dsp_detect_run*)malloc(sizeof(dsp_detect_run) * size);
+    double *columns = (double*)malloc(sizeof(double) * arguments->grid_w);
+    double *levels = (double*)malloc(sizeof(double) * (w / DSP_DETECT_STEP + 1));
+    for(y = start; y < end; y++) {
+        const dsp_t *row = stream->buf + y * w;
+        int first = count;
+        int inside = 0;
+        dsp_detect_levels(arguments, y, columns, levels);
+        for(x = 0; x <= w; x++) {
+            int above = x < w && row[x] > levels[x / DSP_DETECT_STEP];
+            if(above == inside)
+                continue;
+            if(above) {
+                if(count == size) {
+                    size *= 2;
+                    runs = (dsp_detect_run*)realloc(runs, sizeof(dsp_detect_run) * size);
+                }
+                runs[count].y = y;
+                runs[count].start = x;
+            } else {
+                runs[count++].end = x;
+            }
+            inside = above;
+        }
+        arguments->row_runs[y] = count - first;
+    }
+    free(levels);
+    free(columns);
+    arguments->chunks[start] = runs;
+}
+
+static int dsp_detect_root(dsp_detect_run *runs, int i)
+{
+    while(runs[i].parent != i) {
+        runs[i].parent = runs[runs[i].parent].parent;
+        i = runs[i].parent;
+    }
+    return i;
+}
+
+static void dsp_detect_join(dsp_detect_run *runs, int a, int b)
+{
+    a = dsp_detect_root(runs, a);
+    b = dsp_detect_root(runs, b);
+    if(a < b)
+        runs[b].parent = a;
+    else if(b < a)
+        runs[a].parent = b;
+}
+
+static int dsp_detect_flux_desc(const void *arg1, const void *arg2)
+{
+    const dsp_star* a = (const dsp_star*)arg1;
+    const dsp_star* b = (const dsp_star*)arg2;
+    return (a->flux < b->flux) - (a->flux > b->flux);
+}
+
+int dsp_detect_stars(dsp_stream_p stream, double threshold, int min_area)
+{
+    int i, j, x, y;
+    if(stream->dims != 2 || stream->len < 1)
+        return 0;
+    int w = stream->sizes[0];
+    int h = stream->sizes[1];
+    struct dsp_detect_args arguments;
+    arguments.stream = stream;
+    arguments.threshold = threshold;
+    arguments.grid_w = (w + DSP_DETECT_TILE - 1) / DSP_DETECT_TILE;
+    arguments.grid_h = (h + DSP_DETECT_TILE - 1) / DSP_DETECT_TILE;
+    arguments.background = (double*)malloc(sizeof(double) * arguments.grid_w * arguments.grid_h);
+    arguments.noise = (double*)malloc(sizeof(double) * arguments.grid_w * arguments.grid_h);
+    arguments.row_runs = (int*)malloc(sizeof(int) * (h + 1));
+    arguments.chunks = (dsp_detect_run**)calloc(h, sizeof(dsp_detect_run*));
+    dsp_parallel_for(arguments.grid_w * arguments.grid_h, 1, dsp_detect_background_range, &arguments);
+
+    // the chunks of runs are gathered in row order, a chunk starts at the first row of its range
+    dsp_parallel_for(h, 16, dsp_detect_runs_range, &arguments);
+    int total = 0;
+    for(y = 0; y < h; y++)
+        total += arguments.row_runs[y];
+    dsp_detect_run *runs = (dsp_detect_run*)malloc(sizeof(dsp_detect_run) * Max(1, total));
+    dsp_detect_run *chunk = NULL, *next = NULL;
+    total = 0;
+    for(y = 0; y < h; y++) {
+        int count = arguments.row_runs[y];
+        if(arguments.chunks[y] != NULL) {
+            free(chunk);
+            chunk = next = arguments.chunks[y];
+        }
+        memcpy(runs + total, next, sizeof(dsp_detect_run) * count);
+        next += count;
+        arguments.row_runs[y] = total;
+        total += count;
+    }
+    free(chunk);
+    free(arguments.chunks);
+    arguments.row_runs[h] = total;
+
+    // runs overlapping or touching diagonally on the previous row belong to the same object
+    for(i = 0; i < total; i++)
+        runs[i].parent = i;
+    for(y = 1; y < h; y++) {
+        int a = arguments.row_runs[y - 1], a_end = arguments.row_runs[y];
+        int b = arguments.row_runs[y], b_end = arguments.row_runs[y + 1];
+        while(a < a_end && b < b_end) {
+            if(runs[a].end < runs[b].start)
+                a++;
+            else if(runs[b].end < runs[a].start)
+                b++;
+            else {
+                dsp_detect_join(runs, a, b);
+                if(runs[a].end < runs[b].end)
+                    a++;
+                else
+                    b++;
+            }
+        }
+    }
+
+    int objects_count = 0;
+    int *object = (int*)malloc(sizeof(int) * Max(1, total));
+    for(i = 0; i < total; i++) {
+        int root = dsp_detect_root(runs, i);
+        object[i] = root == i ? objects_count++ : object[root];
+    }
+    dsp_detect_object *objects = (dsp_detect_object*)calloc(Max(1, objects_count), sizeof(dsp_detect_object));
+    for(i = 0; i < objects_count; i++) {
+        objects[i].x0 = w;
+        objects[i].y0 = h;
+        objects[i].x1 = -1;
+        objects[i].y1 = -1;
+    }
+    for(i = 0; i < total; i++) {
+        dsp_detect_object *o = &objects[object[i]];
+        y = runs[i].y;
+        for(x = runs[i].start; x < runs[i].end; x++) {
+            double v = stream->buf[x + y * w] - dsp_detect_interpolate(&arguments, arguments.background, x, y);
+            if(v <= 0)
+                continue;
+            o->flux += v;
+            o->peak = Max(o->peak, v);
+            o->sx += v * x;
+            o->sy += v * y;
+            o->sxx += v * x * x;
+            o->syy += v * y * y;
+            o->sxy += v * x * y;
+        }
+        o->area += runs[i].end - runs[i].start;
+        o->x0 = Min(o->x0, runs[i].start);
+        o->x1 = Max(o->x1, runs[i].end - 1);
+        o->y0 = Min(o->y0, y);
+        o->y1 = Max(o->y1, y);
+    }
+    // second pass over the pixels for the half flux radius, now that the centroids are known
+    for(i = 0; i < total; i++) {
+        dsp_detect_object *o = &objects[object[i]];
+        if(o->flux <= 0)
+            continue;
+        double cx = o->sx / o->flux;
+        double cy = o->sy / o->flux;
+        y = runs[i].y;
+        for(x = runs[i].start; x < runs[i].end; x++) {
+            double v = stream->buf[x + y * w] - dsp_detect_interpolate(&arguments, arguments.background, x, y);
+            if(v > 0)
+                o->radius += v * sqrt((x - cx) * (x - cx) + (y - cy) * (y - cy));
+        }
+    }
+
+    for(i = 0; i < stream->stars_count; i++)
+        free(stream->stars[i].center.location);
+    free(stream->stars);
+    stream->stars = NULL;
+    stream->stars_count = 0;
+    double location[2];
+    for(i = 0; i < objects_count; i++) {
+        dsp_detect_object *o = &objects[i];
+        // objects cut by the frame edges have wrong centroids and profiles
+        if(o->area < min_area || o->flux <= 0 || o->x0 == 0 || o->y0 == 0 || o->x1 == w - 1 || o->y1 == h - 1)
+            continue;
+        dsp_star star;
+        double cx = o->sx / o->flux;
+        double cy = o->sy / o->flux;
+        double vxx = Max(0.0, o->sxx / o->flux - cx * cx);
+        double vyy = Max(0.0, o->syy / o->flux - cy * cy);
+        double vxy = o->sxy / o->flux - cx * cy;
+        location[0] = cx;
+        location[1] = cy;
+        star.center.location = location;
+        star.center.dims = 2;
+        star.flux = o->flux;
+        star.peak = o->peak;
+        star.hfr = o->radius / o->flux;
+        star.diameter = star.hfr * 2;
+        // gaussian profile of the same second moments
+        star.fwhm = 2.0 * sqrt(2.0 * log(2.0)) * sqrt((vxx + vyy) / 2);
+        star.theta = 0.5 * atan2(2 * vxy, vxx - vyy);
+        snprintf(star.name, DSP_NAME_SIZE, "%d", stream->stars_count);
+        dsp_stream_add_star(stream, star);
+    }
+    qsort(stream->stars, stream->stars_count, sizeof(dsp_star), dsp_detect_flux_desc);
+    for(j = 0; j < stream->stars_count; j++)
+        snprintf(stream->stars[j].name, DSP_NAME_SIZE, "%d", j);
+
+    free(objects);
+    free(object);
+    free(runs);
+    free(arguments.row_runs);
+    free(arguments.noise);
+    free(arguments.background);
+    return stream->stars_count;
+}
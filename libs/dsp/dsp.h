@@ -48,6 +48,7 @@ extern "C" {
 #include <assert.h>
 #include <pthread.h>
 #include <time.h>
+#include "dspconfig.h"
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
 #endif
@@ -73,7 +74,14 @@ extern "C" {
 */
 /**\{*/
 #define DSP_MAX_STARS 200
+/* Samples are single precision when libindi was built with INDI_DSP_SINGLE_PRECISION, as recorded in
+ * dspconfig.h: streams take half the memory and the kernels move half the data, while 24 bits of
+ * mantissa still hold 16 bit frames exactly */
+#ifdef DSP_SINGLE_PRECISION
+typedef float dsp_t;
+#else
 typedef double dsp_t;
+#endif
 typedef double complex_t[2];
 #define dsp_t_max 255
 #define dsp_t_min -dsp_t_max
@@ -86,6 +94,17 @@ typedef double complex_t[2];
 */
 DLL_EXPORT unsigned long int dsp_max_threads(unsigned long value);
 
+/**
+* \brief Run a loop over count items on the library thread pool
+* \param count number of items, fn is called with ranges covering 0 to count
+* \param grain the smallest range handed to a thread
+* \param fn called with the start and end of each range, and arg
+* \param arg user data passed to fn
+* Workers are kept across calls and take ranges as they get free, the calling thread works along.
+* Calls made while the pool is busy, or from within fn, run on the calling thread.
+*/
+DLL_EXPORT void dsp_parallel_for(int count, int grain, void (*fn)(int start, int end, void *arg), void *arg);
+
 #ifndef DSP_DEBUG
 #define DSP_DEBUG
 /**
@@ -254,6 +273,10 @@ typedef struct dsp_star_t
     double flux;
     /// The deviation of the star
     double theta;
+    /// The half flux radius of the star
+    double hfr;
+    /// The full width at half maximum of the star
+    double fwhm;
     /// The name of the star
     char name[DSP_NAME_SIZE];
 } dsp_star;
@@ -462,6 +485,26 @@ DLL_EXPORT void dsp_fourier_dft(dsp_stream_p stream, int exp);
 */
 DLL_EXPORT void dsp_fourier_idft(dsp_stream_p stream);
 
+/**
+* \brief Power spectrum of a one dimensional dsp_stream, with the cached plan of its length
+* Unlike dsp_fourier_dft, the magnitude and phase streams are neither made nor filled, so it is cheap
+* enough to run on every block of a stream of samples.
+* \param stream the stream, its samples are only read. stream->dft is overwritten.
+* \param power filled with the squared magnitude of the stream->len / 2 + 1 bins, the continuous component first.
+*/
+DLL_EXPORT void dsp_fourier_power(dsp_stream_p stream, double *power);
+
+/**
+* \brief Load FFTW wisdom from a file and save the wisdom of new plans to it
+* Plans made afterwards are measured rather than estimated: the first transform of each shape takes
+* longer, the following ones run faster, and the wisdom saved spares the measure the next time.
+* The file named by the DSP_FFTW_WISDOM environment variable is used the same way unless this is called
+* before the first transform.
+* \param filename the wisdom file, NULL to estimate plans and save no wisdom.
+* \return 1 if wisdom was read from the file, 0 otherwise.
+*/
+DLL_EXPORT int dsp_fourier_set_wisdom_file(const char *filename);
+
 /**
 * \brief Fill the magnitude and phase buffers with the current data in stream->dft
 * \param stream the inout stream.
@@ -482,7 +525,7 @@ DLL_EXPORT void dsp_fourier_2complex_t(dsp_stream_p stream);
 * \param len the input arrays length.
 * \return the array filled with the complex numbers
 */
-DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t *out, int len);
+DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(dsp_t* mag, dsp_t* phi, complex_t *out, int len);
 
 /**
 * \brief Obtain a complex number's array magnitudes
@@ -490,7 +533,7 @@ DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi
 * \param len the input array length.
 * \return the array filled with the magnitudes
 */
-DLL_EXPORT double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len);
+DLL_EXPORT dsp_t* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len);
 
 /**
 * \brief Obtain a complex number's array phases
@@ -498,7 +541,7 @@ DLL_EXPORT double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int l
 * \param len the input array length.
 * \return the array filled with the phases
 */
-DLL_EXPORT double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len);
+DLL_EXPORT dsp_t* dsp_fourier_complex_array_get_phase(dsp_complex in, int len);
 
 /**\}*/
 /**
@@ -562,6 +605,24 @@ DLL_EXPORT void dsp_convolution_convolution(dsp_stream_p stream, dsp_stream_p ma
 */
 DLL_EXPORT void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p matrix);
 
+/**
+* \brief Convolve a stream with a matrix in the spatial domain, keeping the range of the result.
+* Edges repeat the border samples, separable 2-D matrices are applied as a row and a column pass.
+* \param stream the input stream, replaced with the result.
+* \param matrix the convolution matrix stream, with as many dimensions as stream.
+*/
+DLL_EXPORT void dsp_convolution_direct(dsp_stream_p stream, dsp_stream_p matrix);
+
+/**
+* \brief Convolve a stream with a matrix in the spatial domain when the matrix is small,
+* through the Fourier transforms of both otherwise.
+* \param stream the input stream, replaced with the result.
+* \param matrix the convolution matrix stream.
+* \sa dsp_convolution_direct
+* \sa dsp_convolution_convolution
+*/
+DLL_EXPORT void dsp_convolution_filter(dsp_stream_p stream, dsp_stream_p matrix);
+
 /**\}*/
 /**
  * \defgroup dsp_Stats DSP API Buffer statistics functions
@@ -770,6 +831,17 @@ DLL_EXPORT void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p ma
     })
 #endif
 
+/**
+* \brief Minimum, maximum, sum and sum of the squares of a buffer, in a single pass
+* \param buf the input buffer
+* \param len the length in elements of the buffer.
+* \param min where the minimum value goes, or NULL.
+* \param max where the maximum value goes, or NULL.
+* \param sum where the sum of the values goes, or NULL.
+* \param sumsq where the sum of the squared values goes, or NULL.
+*/
+DLL_EXPORT void dsp_stats_reduce(dsp_t *buf, int len, dsp_t *min, dsp_t *max, double *sum, double *sumsq);
+
 /**
 * \brief Histogram of the inut stream
 * \param stream the stream on which execute
@@ -808,8 +880,12 @@ DLL_EXPORT void dsp_buffer_removemean(dsp_stream_p stream);
 #define dsp_buffer_stretch(buf, len, _mn, _mx)\
 ({\
     int k;\
-    __typeof(buf[0]) __mn = dsp_stats_min(buf, len);\
-    __typeof(buf[0]) __mx = dsp_stats_max(buf, len);\
+    __typeof(buf[0]) __mn = buf[0];\
+    __typeof(buf[0]) __mx = buf[0];\
+    for(k = 0; k < len; k++) {\
+        __mn = Min(buf[k], __mn);\
+        __mx = Max(buf[k], __mx);\
+    }\
     double oratio = (_mx - _mn);\
     double iratio = (__mx - __mn);\
     if(iratio == 0) iratio = 1;\
@@ -1252,6 +1328,24 @@ DLL_EXPORT int dsp_stream_set_position(dsp_stream_p stream, int *pos);
 */
 DLL_EXPORT int* dsp_stream_get_position(dsp_stream_p stream, int index);
 
+/**
+* \brief Write the multidimensional positional indexes of a linear index into an array, without allocating it
+* \param stream the target DSP stream.
+* \param index the position of the index on a single dimension.
+* \param pos the array receiving the position on each dimension, stream->dims long.
+* \sa dsp_stream_get_position
+* \sa dsp_stream_next_position
+*/
+DLL_EXPORT void dsp_stream_fill_position(dsp_stream_p stream, int index, int *pos);
+
+/**
+* \brief Advance multidimensional positional indexes to the next linear index, for walking a stream in order
+* \param stream the target DSP stream.
+* \param pos the position on each dimension, moved to the following element.
+* \sa dsp_stream_fill_position
+*/
+DLL_EXPORT void dsp_stream_next_position(dsp_stream_p stream, int *pos);
+
 /**
 * \brief Execute the function callback pointed by the func field of the passed stream
 * \param stream the target DSP stream.
@@ -1557,12 +1651,32 @@ DLL_EXPORT dsp_align_info *dsp_align_fill_info(dsp_triangle t1, dsp_triangle t2)
 */
 DLL_EXPORT dsp_triangle *dsp_align_calc_triangle(dsp_star* stars, int num_stars);
 
+/**
+* \brief Find the stars of a 2-D stream and replace its stars with them, brightest first
+* \param stream the input stream.
+* \param threshold how many times the background noise a pixel must rise above the background.
+* \param min_area the fewest pixels above the threshold an object needs to be a star.
+* \return The number of stars found.
+* The background and its noise are estimated over tiles. Each star gets its centroid, flux and peak
+* above the background, half flux radius, full width at half maximum and, as theta, the angle of its
+* major axis. Objects touching the frame edges are left out.
+*/
+DLL_EXPORT int dsp_detect_stars(dsp_stream_p stream, double threshold, int min_area);
+
 /**
 * \brief Free a dsp_triangle struct pointer
 * \param triangle pointer to an allocated dsp_triangle struct
 */
 DLL_EXPORT void dsp_align_free_triangle(dsp_triangle *triangle);
 
+/**
+* \brief Set how many stars of each stream alignment builds its triangles from
+* \param value if greater than 0, the number of stars taken, the first ones of the stars arrays
+* \return The current or new number of stars
+* \sa dsp_align_get_offset
+*/
+DLL_EXPORT int dsp_align_max_stars(int value);
+
 /**
 * \brief Calculate offsets, rotation and scaling of two streams giving reference alignment point
 * \param ref the reference stream
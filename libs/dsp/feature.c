@@ -26,16 +26,17 @@ void dsp_feature_align(dsp_stream_p stream, dsp_stream_p matrix)
     for(z = 0; z < matrix->sizes[stream->dims]; z++) {
         dsp_fourier_dft(stream, 1);
         int x, y, d;
-        dsp_t mn = dsp_stats_min(stream->buf, stream->len);
-        dsp_t mx = dsp_stats_max(stream->buf, stream->len);
+        dsp_t mn, mx;
+        dsp_stats_reduce(stream->buf, stream->len, &mn, &mx, NULL, NULL);
         int* d_pos = (int*)malloc(sizeof(int)*stream->dims);
+        int pos[matrix->dims];
+        dsp_stream_fill_position(matrix, z*stream->len, pos);
         for(y = z*stream->len; y < z*stream->len+stream->len; y++) {
-            int* pos = dsp_stream_get_position(matrix, y);
             for(d = 0; d < stream->dims; d++) {
                 d_pos[d] = stream->sizes[d]/2+pos[d]-matrix->sizes[d]/2;
             }
+            dsp_stream_next_position(matrix, pos);
             x = dsp_stream_set_position(stream, d_pos);
-            free(pos);
             stream->magnitude->buf[x] *= sqrt(matrix->magnitude->buf[y]);
         }
         free(d_pos);
@@ -39,15 +39,13 @@ void dsp_fourier_2dsp(dsp_stream_p stream)
     memcpy(dft, stream->dft.pairs, sizeof(complex_t) * stream->len);
     y = 0;
     for(x = 0; x < stream->len && y < stream->len; x++) {
-        int *pos = dsp_stream_get_position(stream, x);
-        if(pos[0] <= stream->sizes[0] / 2) {
+        if(x % stream->sizes[0] <= stream->sizes[0] / 2) {
             stream->dft.pairs[x][0] = dft[y][0];
             stream->dft.pairs[x][1] = dft[y][1];
             stream->dft.pairs[stream->len-1-x][0] = dft[y][0];
             stream->dft.pairs[stream->len-1-x][1] = dft[y][1];
             y++;
         }
-        free(pos);
     }
     dsp_fourier_dft_magnitude(stream);
     dsp_buffer_shift(stream->magnitude);
@@ -67,21 +65,19 @@ void dsp_fourier_2complex_t(dsp_stream_p stream)
     dsp_buffer_set(stream->dft.buf, stream->len*2, 0);
     y = 0;
     for(x = 0; x < stream->len; x++) {
-        int *pos = dsp_stream_get_position(stream, x);
-        if(pos[0] <= stream->sizes[0] / 2) {
+        if(x % stream->sizes[0] <= stream->sizes[0] / 2) {
             stream->dft.pairs[y][0] = dft[x][0];
             stream->dft.pairs[y][1] = dft[x][1];
             y++;
         }
-        free(pos);
     }
     free(dft);
 }
 
-double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
+dsp_t* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
 {
     int i;
-    double* out = (double*)malloc(sizeof(double) * len);
+    dsp_t* out = (dsp_t*)malloc(sizeof(dsp_t) * len);
     for(i = 0; i < len; i++) {
         double real = in.complex[i].real;
         double imaginary = in.complex[i].imaginary;
@@ -90,10 +86,10 @@ double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
     return out;
 }
 
-double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
+dsp_t* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
 {
     int i;
-    double* out = (double*)malloc(sizeof(double) * len);
+    dsp_t* out = (dsp_t*)malloc(sizeof(dsp_t) * len);
     for(i = 0; i < len; i++) {
         out [i] = 0;
         if (in.complex[i].real != 0) {
@@ -112,7 +108,7 @@ double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
     return out;
 }
 
-void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t* out, int len)
+void dsp_fourier_phase_mag_array_get_complex(dsp_t* mag, dsp_t* phi, complex_t* out, int len)
 {
     int i;
     for(i = 0; i < len; i++) {
@@ -123,70 +119,192 @@ void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t
     }
 }
 
-static void* dsp_stream_dft_th(void* arg)
+/* Plans of the shapes transformed so far. They are made once, then executed on the arrays of any
+ * stream of the same shape, from any thread. Shapes beyond the cache get a plan for the call. */
+#define DSP_FOURIER_PLANS 32
+
+typedef struct {
+    int inverse;
+    int dims;
+    int *sizes;
+    fftw_plan plan;
+} dsp_fourier_plan;
+
+static dsp_fourier_plan dsp_fourier_plans[DSP_FOURIER_PLANS];
+static int dsp_fourier_plans_count = 0;
+/* The FFTW planner is not thread safe, plans and wisdom are only touched under this lock */
+static pthread_mutex_t dsp_fourier_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char *dsp_fourier_wisdom = NULL;
+static int dsp_fourier_wisdom_checked = 0;
+
+static int dsp_fourier_load_wisdom(const char *filename)
+{
+    free(dsp_fourier_wisdom);
+    dsp_fourier_wisdom = filename != NULL ? strdup(filename) : NULL;
+    return filename != NULL && fftw_import_wisdom_from_filename(filename);
+}
+
+int dsp_fourier_set_wisdom_file(const char *filename)
+{
+    pthread_mutex_lock(&dsp_fourier_mutex);
+    dsp_fourier_wisdom_checked = 1;
+    int loaded = dsp_fourier_load_wisdom(filename);
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+    return loaded;
+}
+
+static fftw_plan dsp_fourier_make_plan(dsp_stream_p stream, int inverse)
+{
+    int d;
+    int *sizes = (int*)malloc(sizeof(int) * stream->dims);
+    for(d = 0; d < stream->dims; d++)
+        sizes[d] = stream->sizes[stream->dims - 1 - d];
+    // Planned on scratch arrays: measuring overwrites them, unaligned plans run on any stream
+    unsigned flags = (dsp_fourier_wisdom != NULL ? FFTW_MEASURE : FFTW_ESTIMATE_PATIENT) | FFTW_UNALIGNED;
+    double *real = (double*)fftw_malloc(sizeof(double) * stream->len);
+    fftw_complex *spectrum = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * stream->len);
+    fftw_plan plan = inverse ?
+        fftw_plan_dft_c2r(stream->dims, sizes, spectrum, real, flags) :
+        fftw_plan_dft_r2c(stream->dims, sizes, real, spectrum, flags);
+    fftw_free(real);
+    fftw_free(spectrum);
+    free(sizes);
+    if(plan != NULL && dsp_fourier_wisdom != NULL)
+        fftw_export_wisdom_to_filename(dsp_fourier_wisdom);
+    return plan;
+}
+
+/* Returns the cached plan of the shape of stream, or a new plan with *owned set that the caller destroys */
+static fftw_plan dsp_fourier_get_plan(dsp_stream_p stream, int inverse, int *owned)
+{
+    int i, d;
+    fftw_plan plan = NULL;
+    *owned = 0;
+    pthread_mutex_lock(&dsp_fourier_mutex);
+    if(!dsp_fourier_wisdom_checked) {
+        dsp_fourier_wisdom_checked = 1;
+        if(getenv("DSP_FFTW_WISDOM") != NULL)
+            dsp_fourier_load_wisdom(getenv("DSP_FFTW_WISDOM"));
+    }
+    for(i = 0; i < dsp_fourier_plans_count && plan == NULL; i++) {
+        dsp_fourier_plan *cached = &dsp_fourier_plans[i];
+        if(cached->inverse != inverse || cached->dims != stream->dims)
+            continue;
+        for(d = 0; d < stream->dims && cached->sizes[d] == stream->sizes[d]; d++);
+        if(d == stream->dims)
+            plan = cached->plan;
+    }
+    if(plan == NULL) {
+        plan = dsp_fourier_make_plan(stream, inverse);
+        if(plan != NULL && dsp_fourier_plans_count < DSP_FOURIER_PLANS) {
+            dsp_fourier_plan *cached = &dsp_fourier_plans[dsp_fourier_plans_count++];
+            cached->inverse = inverse;
+            cached->dims = stream->dims;
+            cached->sizes = (int*)malloc(sizeof(int) * stream->dims);
+            memcpy(cached->sizes, stream->sizes, sizeof(int) * stream->dims);
+            cached->plan = plan;
+        } else {
+            *owned = 1;
+        }
+    }
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+    return plan;
+}
+
+static void dsp_fourier_release_plan(fftw_plan plan, int owned)
+{
+    if(!owned || plan == NULL)
+        return;
+    pthread_mutex_lock(&dsp_fourier_mutex);
+    fftw_destroy_plan(plan);
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+}
+
+/* Transforms the phase, then the magnitude of the stream */
+static void dsp_stream_dft_range(int start, int end, void* arg)
 {
     struct {
         int exp;
-       dsp_stream_p stream;
+        dsp_stream_p stream;
     } *arguments = arg;
-    dsp_fourier_dft(arguments->stream, arguments->exp);
-    return NULL;
+    int x;
+    for(x = start; x < end; x++)
+        dsp_fourier_dft(x == 0 ? arguments->stream->phase : arguments->stream->magnitude, arguments->exp);
 }
+
 void dsp_fourier_dft(dsp_stream_p stream, int exp)
 {
     if(exp < 1)
         return;
-    double* buf = (double*)malloc(sizeof(double) * stream->len);
+    int owned;
     if(stream->phase == NULL)
         stream->phase = dsp_stream_copy(stream);
     if(stream->magnitude == NULL)
         stream->magnitude = dsp_stream_copy(stream);
     dsp_buffer_set(stream->dft.buf, stream->len * 2, 0);
-    dsp_buffer_copy(stream->buf, buf, stream->len);
-    int *sizes = (int*)malloc(sizeof(int)*stream->dims);
-    dsp_buffer_copy(stream->sizes, sizes, stream->dims);
-    dsp_buffer_reverse(sizes, stream->dims);
-    fftw_plan plan = fftw_plan_dft_r2c(stream->dims, sizes, buf, stream->dft.pairs, FFTW_ESTIMATE_PATIENT);
-    fftw_execute(plan);
-    fftw_free(plan);
-    free(sizes);
-    free(buf);
+    // Real to complex transforms keep their input, the samples are read in place
+    fftw_plan plan = dsp_fourier_get_plan(stream, 0, &owned);
+    if(plan == NULL)
+        return;
+#ifdef DSP_SINGLE_PRECISION
+    // FFTW transforms doubles, single precision samples go through a scratch copy
+    double *real = (double*)malloc(sizeof(double) * stream->len);
+    dsp_buffer_copy(stream->buf, real, stream->len);
+    fftw_execute_dft_r2c(plan, real, stream->dft.pairs);
+    free(real);
+#else
+    fftw_execute_dft_r2c(plan, stream->buf, stream->dft.pairs);
+#endif
+    dsp_fourier_release_plan(plan, owned);
     dsp_fourier_2dsp(stream);
     if(exp > 1) {
-        exp--;
-        pthread_t th[2];
         struct {
            int exp;
            dsp_stream_p stream;
-        } thread_arguments[2];
-        thread_arguments[0].exp = exp;
-        thread_arguments[0].stream = stream->phase;
-        pthread_create(&th[0], NULL, dsp_stream_dft_th, &thread_arguments[0]);
-        thread_arguments[1].exp = exp;
-        thread_arguments[1].stream = stream->magnitude;
-        pthread_create(&th[1], NULL, dsp_stream_dft_th, &thread_arguments[1]);
-        pthread_join(th[0], NULL);
-        pthread_join(th[1], NULL);
+        } arguments = { exp - 1, stream };
+        dsp_parallel_for(2, 1, dsp_stream_dft_range, &arguments);
     }
 }
 
+void dsp_fourier_power(dsp_stream_p stream, double *power)
+{
+    int owned, x;
+    fftw_plan plan = dsp_fourier_get_plan(stream, 0, &owned);
+    if(plan == NULL)
+        return;
+#ifdef DSP_SINGLE_PRECISION
+    double *real = (double*)malloc(sizeof(double) * stream->len);
+    dsp_buffer_copy(stream->buf, real, stream->len);
+    fftw_execute_dft_r2c(plan, real, stream->dft.pairs);
+    free(real);
+#else
+    fftw_execute_dft_r2c(plan, stream->buf, stream->dft.pairs);
+#endif
+    dsp_fourier_release_plan(plan, owned);
+    for(x = 0; x <= stream->len / 2; x++)
+        power[x] = stream->dft.pairs[x][0] * stream->dft.pairs[x][0] + stream->dft.pairs[x][1] * stream->dft.pairs[x][1];
+}
+
 void dsp_fourier_idft(dsp_stream_p stream)
 {
-    double *buf = (double*)malloc(sizeof(double)*stream->len);
-    dsp_t mn = dsp_stats_min(stream->buf, stream->len);
-    dsp_t mx = dsp_stats_max(stream->buf, stream->len);
-    dsp_buffer_set(buf, stream->len, 0);
+    int owned;
+    dsp_t mn, mx;
+    dsp_stats_reduce(stream->buf, stream->len, &mn, &mx, NULL, NULL);
     dsp_fourier_2complex_t(stream);
-    int *sizes = (int*)malloc(sizeof(int)*stream->dims);
-    dsp_buffer_copy(stream->sizes, sizes, stream->dims);
-    dsp_buffer_reverse(sizes, stream->dims);
-    fftw_plan plan = fftw_plan_dft_c2r(stream->dims, sizes, stream->dft.pairs, buf, FFTW_ESTIMATE_PATIENT);
-    fftw_execute(plan);
-    fftw_free(plan);
-    free(sizes);
-    dsp_buffer_stretch(buf, stream->len, mn, mx);
-    dsp_buffer_copy(buf, stream->buf, stream->len);
+    fftw_plan plan = dsp_fourier_get_plan(stream, 1, &owned);
+    if(plan == NULL)
+        return;
+    // The transform writes every sample, straight into the stream
+#ifdef DSP_SINGLE_PRECISION
+    double *real = (double*)malloc(sizeof(double) * stream->len);
+    fftw_execute_dft_c2r(plan, stream->dft.pairs, real);
+    dsp_buffer_copy(real, stream->buf, stream->len);
+    free(real);
+#else
+    fftw_execute_dft_c2r(plan, stream->dft.pairs, stream->buf);
+#endif
+    dsp_fourier_release_plan(plan, owned);
+    dsp_buffer_stretch(stream->buf, stream->len, mn, mx);
     dsp_buffer_shift(stream->magnitude);
     dsp_buffer_shift(stream->phase);
-    free(buf);
 }
@@ -24,7 +24,9 @@ void dsp_filter_squarelaw(dsp_stream_p stream)
     dsp_t* in = stream->buf;
     dsp_t *out = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
     int len = stream->len;
-    dsp_t mean = dsp_stats_mean(stream->buf, stream->len);
+    double sum;
+    dsp_stats_reduce(stream->buf, stream->len, NULL, NULL, &sum, NULL);
+    dsp_t mean = sum / len;
     int val = 0;
     int i;
     for(i = 0; i < len; i++) {
@@ -44,13 +46,14 @@ void dsp_filter_lowpass(dsp_stream_p stream, double Frequency)
     }
     radius = sqrt(radius);
     dsp_fourier_dft(stream, 1);
+    int pos[stream->dims];
+    dsp_stream_fill_position(stream, 0, pos);
     for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
+        dsp_stream_next_position(stream, pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist>Frequency)
@@ -68,13 +71,14 @@ void dsp_filter_highpass(dsp_stream_p stream, double Frequency)
     }
     radius = sqrt(radius);
     dsp_fourier_dft(stream, 1);
+    int pos[stream->dims];
+    dsp_stream_fill_position(stream, 0, pos);
     for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
+        dsp_stream_next_position(stream, pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist<Frequency)
@@ -92,13 +96,14 @@ void dsp_filter_bandreject(dsp_stream_p stream, double LowFrequency, double High
     }
     radius = sqrt(radius);
     dsp_fourier_dft(stream, 1);
+    int pos[stream->dims];
+    dsp_stream_fill_position(stream, 0, pos);
     for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
+        dsp_stream_next_position(stream, pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist<HighFrequency&&dist>LowFrequency)
@@ -116,13 +121,14 @@ void dsp_filter_bandpass(dsp_stream_p stream, double LowFrequency, double HighFr
     }
     radius = sqrt(radius);
     dsp_fourier_dft(stream, 1);
+    int pos[stream->dims];
+    dsp_stream_fill_position(stream, 0, pos);
     for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
+        dsp_stream_next_position(stream, pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist>HighFrequency||dist<LowFrequency)
@@ -0,0 +1,140 @@
+/*
+*   DSP API - a digital signal processing library for astronomy usage
+*   Copyright © 2017-2022  Ilia Platone
+*
+*   This program is free software; you can redistribute it and/or
+*   modify it under the terms of the GNU Lesser General Public
+*   License as published by the Free Software Foundation; either
+*   version 3 of the License, or (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*   Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program; if not, write to the Free Software Foundation,
+*   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "dsp.h"
+
+/* Workers are started on the first parallel loop and live until the thread count changes. The
+ * caller of a loop works along with them, and every thread takes the next chunk when it is done with
+ * its own, so uneven chunks even out. One loop runs on the pool at a time: loops started meanwhile,
+ * from another thread or from within a loop, run on their calling thread. */
+
+/* Chunks per thread, enough to balance uneven work without contending for the next index */
+#define DSP_POOL_CHUNKS_PER_THREAD 8
+
+static pthread_mutex_t dsp_pool_busy = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dsp_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dsp_pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t dsp_pool_done = PTHREAD_COND_INITIALIZER;
+static pthread_t *dsp_pool_threads = NULL;
+static int dsp_pool_size = 0;
+static int dsp_pool_quit = 0;
+static unsigned long dsp_pool_generation = 0;
+static int dsp_pool_finished = 0;
+
+static struct {
+    void (*fn)(int start, int end, void *arg);
+    void *arg;
+    int count;
+    int chunk;
+    int next;
+} dsp_pool_job;
+
+static void dsp_pool_run_chunks(void)
+{
+    int start;
+    while((start = __atomic_fetch_add(&dsp_pool_job.next, dsp_pool_job.chunk, __ATOMIC_RELAXED)) < dsp_pool_job.count)
+        dsp_pool_job.fn(start, Min(dsp_pool_job.count, start + dsp_pool_job.chunk), dsp_pool_job.arg);
+}
+
+static void* dsp_pool_worker(void* arg)
+{
+    unsigned long seen = 0;
+    (void)arg;
+    pthread_mutex_lock(&dsp_pool_lock);
+    while(1) {
+        while(!dsp_pool_quit && dsp_pool_generation == seen)
+            pthread_cond_wait(&dsp_pool_wake, &dsp_pool_lock);
+        if(dsp_pool_quit)
+            break;
+        seen = dsp_pool_generation;
+        pthread_mutex_unlock(&dsp_pool_lock);
+        dsp_pool_run_chunks();
+        pthread_mutex_lock(&dsp_pool_lock);
+        if(++dsp_pool_finished == dsp_pool_size)
+            pthread_cond_signal(&dsp_pool_done);
+    }
+    pthread_mutex_unlock(&dsp_pool_lock);
+    return NULL;
+}
+
+/* Called with dsp_pool_busy held, no loop is running */
+static void dsp_pool_resize(int size)
+{
+    int t;
+    if(size == dsp_pool_size)
+        return;
+    if(dsp_pool_size > 0) {
+        pthread_mutex_lock(&dsp_pool_lock);
+        dsp_pool_quit = 1;
+        pthread_cond_broadcast(&dsp_pool_wake);
+        pthread_mutex_unlock(&dsp_pool_lock);
+        for(t = 0; t < dsp_pool_size; t++)
+            pthread_join(dsp_pool_threads[t], NULL);
+        free(dsp_pool_threads);
+        dsp_pool_threads = NULL;
+        dsp_pool_quit = 0;
+    }
+    dsp_pool_size = 0;
+    if(size < 1)
+        return;
+    dsp_pool_threads = (pthread_t*)malloc(sizeof(pthread_t) * size);
+    // workers start waiting for the next loop, not the last one
+    for(t = 0; t < size; t++) {
+        if(pthread_create(&dsp_pool_threads[t], NULL, dsp_pool_worker, NULL) != 0)
+            break;
+        dsp_pool_size++;
+    }
+}
+
+void dsp_parallel_for(int count, int grain, void (*fn)(int start, int end, void *arg), void *arg)
+{
+    int threads = (int)dsp_max_threads(0);
+    if(count <= 0)
+        return;
+    grain = Max(1, grain);
+    if(threads <= 1 || count <= grain || pthread_mutex_trylock(&dsp_pool_busy) != 0) {
+        fn(0, count, arg);
+        return;
+    }
+    dsp_pool_resize(threads - 1);
+    if(dsp_pool_size < 1) {
+        pthread_mutex_unlock(&dsp_pool_busy);
+        fn(0, count, arg);
+        return;
+    }
+
+    pthread_mutex_lock(&dsp_pool_lock);
+    dsp_pool_job.fn = fn;
+    dsp_pool_job.arg = arg;
+    dsp_pool_job.count = count;
+    dsp_pool_job.chunk = Max(grain, count / (threads * DSP_POOL_CHUNKS_PER_THREAD));
+    dsp_pool_job.next = 0;
+    dsp_pool_finished = 0;
+    dsp_pool_generation++;
+    pthread_cond_broadcast(&dsp_pool_wake);
+    pthread_mutex_unlock(&dsp_pool_lock);
+
+    dsp_pool_run_chunks();
+
+    pthread_mutex_lock(&dsp_pool_lock);
+    while(dsp_pool_finished < dsp_pool_size)
+        pthread_cond_wait(&dsp_pool_done, &dsp_pool_lock);
+    pthread_mutex_unlock(&dsp_pool_lock);
+    pthread_mutex_unlock(&dsp_pool_busy);
+}
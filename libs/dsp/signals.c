@@ -83,8 +83,8 @@ void dsp_modulation_frequency(dsp_stream_p stream, double samplefreq, double fre
 {
     dsp_stream_p carrier = dsp_stream_new();
     dsp_signals_sinewave(carrier, samplefreq, freq);
-    double mn = dsp_stats_min(stream->buf, stream->len);
-    double mx = dsp_stats_max(stream->buf, stream->len);
+    dsp_t mn, mx;
+    dsp_stats_reduce(stream->buf, stream->len, &mn, &mx, NULL, NULL);
     double lo = mn * bandwidth * 1.5 / samplefreq;
     double hi = mx * bandwidth * 0.5 / samplefreq;
     dsp_t *deviation = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
@@ -19,26 +19,102 @@
 
 #include "dsp.h"
 
+/* Independent accumulators the compiler turns into vector registers, one lane each */
+#define DSP_STATS_LANES 8
+
+void dsp_stats_reduce(dsp_t *buf, int len, dsp_t *min, dsp_t *max, double *sum, double *sumsq)
+{
+    const dsp_t *restrict in = buf;
+    dsp_t mn[DSP_STATS_LANES], mx[DSP_STATS_LANES];
+    double s[DSP_STATS_LANES], q[DSP_STATS_LANES];
+    int i, l;
+    for(l = 0; l < DSP_STATS_LANES; l++) {
+        mn[l] = mx[l] = len > 0 ? in[0] : 0;
+        s[l] = q[l] = 0.0;
+    }
+    for(i = 0; i + DSP_STATS_LANES <= len; i += DSP_STATS_LANES) {
+        for(l = 0; l < DSP_STATS_LANES; l++) {
+            dsp_t v = in[i + l];
+            mn[l] = v < mn[l] ? v : mn[l];
+            mx[l] = v > mx[l] ? v : mx[l];
+            s[l] += v;
+            q[l] += (double)v * v;
+        }
+    }
+    for(; i < len; i++) {
+        dsp_t v = in[i];
+        mn[0] = v < mn[0] ? v : mn[0];
+        mx[0] = v > mx[0] ? v : mx[0];
+        s[0] += v;
+        q[0] += (double)v * v;
+    }
+    for(l = 1; l < DSP_STATS_LANES; l++) {
+        mn[0] = Min(mn[0], mn[l]);
+        mx[0] = Max(mx[0], mx[l]);
+        s[0] += s[l];
+        q[0] += q[l];
+    }
+    if(min != NULL)
+        *min = mn[0];
+    if(max != NULL)
+        *max = mx[0];
+    if(sum != NULL)
+        *sum = s[0];
+    if(sumsq != NULL)
+        *sumsq = q[0];
+}
+
+struct dsp_stats_histogram_args {
+    dsp_t *buf;
+    dsp_t min;
+    double oratio;
+    double iratio;
+    int size;
+    double *out;
+    pthread_mutex_t lock;
+};
+
+static void dsp_stats_histogram_range(int start, int end, void *arg)
+{
+    struct dsp_stats_histogram_args *args = arg;
+    int *bins = (int*)calloc(args->size, sizeof(int));
+    int k;
+    for(k = start; k < end; k++) {
+        // the bin the value would get stretched to, in the same order of operations as dsp_buffer_stretch
+        long i = (long)((dsp_t)((double)(args->buf[k] - args->min) * args->oratio / args->iratio));
+        if(i > 0 && i < args->size)
+            bins[i] ++;
+    }
+    pthread_mutex_lock(&args->lock);
+    for(k = 0; k < args->size; k++)
+        args->out[k] += bins[k];
+    pthread_mutex_unlock(&args->lock);
+    free(bins);
+}
+
 double* dsp_stats_histogram(dsp_stream_p stream, int size)
 {
     if(stream == NULL)
         return NULL;
-    int k;
-    long i = 0;
+    struct dsp_stats_histogram_args args;
     double* out = (double*)malloc(sizeof(double)*size);
-    dsp_t* tmp = (dsp_t*)malloc(sizeof(dsp_t)*stream->len);
     dsp_buffer_set(out, size, 0.0);
-    memcpy(tmp, stream->buf, sizeof(dsp_t)*stream->len);
-    dsp_buffer_stretch(tmp, stream->len, 0, size-1);
-    for(k = 0; k < stream->len; k++) {
-        i = (long)tmp[k];
-        if(i > 0 && i < size)
-            out[i] ++;
-    }
-    free(tmp);
-    dsp_t mn = dsp_stats_min(out, size);
-    dsp_t mx = dsp_stats_max(out, size);
-    if(mn < mx)
+    dsp_t mx;
+    // values are binned as they are read, the samples are neither copied nor stretched
+    dsp_stats_reduce(stream->buf, stream->len, &args.min, &mx, NULL, NULL);
+    args.buf = stream->buf;
+    args.oratio = size - 1;
+    args.iratio = mx - args.min;
+    if(args.iratio == 0)
+        args.iratio = 1;
+    args.size = size;
+    args.out = out;
+    pthread_mutex_init(&args.lock, NULL);
+    dsp_parallel_for(stream->len, 65536, dsp_stats_histogram_range, &args);
+    pthread_mutex_destroy(&args.lock);
+    double mn = dsp_stats_min(out, size);
+    double omx = dsp_stats_max(out, size);
+    if(mn < omx)
         dsp_buffer_stretch(out, size, 0, size);
     return out;
 }
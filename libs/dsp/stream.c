@@ -343,6 +343,8 @@ void dsp_stream_add_star(dsp_stream_p stream, dsp_star star)
     stream->stars[stream->stars_count].peak = star.peak;
     stream->stars[stream->stars_count].flux = star.flux;
     stream->stars[stream->stars_count].theta = star.theta;
+    stream->stars[stream->stars_count].hfr = star.hfr;
+    stream->stars[stream->stars_count].fwhm = star.fwhm;
     stream->stars[stream->stars_count].center.dims = star.center.dims;
     stream->stars[stream->stars_count].center.location = (double*)malloc(sizeof(double)*star.center.dims);
     for(d = 0; d < star.center.dims; d++)
@@ -449,17 +451,37 @@ void dsp_stream_del_triangle(dsp_stream_p stream, int index)
  * @return
  */
 int* dsp_stream_get_position(dsp_stream_p stream, int index) {
-    int dim = 0;
-    int y = 0;
-    int m = 1;
     int* pos = (int*)malloc(sizeof(int) * stream->dims);
+    dsp_stream_fill_position(stream, index, pos);
+    return pos;
+}
+
+/**
+ * @brief dsp_stream_fill_position
+ * @param stream
+ * @param index
+ * @param pos
+ */
+void dsp_stream_fill_position(dsp_stream_p stream, int index, int* pos) {
+    int dim = 0;
     for (dim = 0; dim < stream->dims; dim++) {
-        y = index / m;
-        y %= stream->sizes[dim];
-        m *= stream->sizes[dim];
-        pos[dim] = y;
+        pos[dim] = index % stream->sizes[dim];
+        index /= stream->sizes[dim];
+    }
+}
+
+/**
+ * @brief dsp_stream_next_position
+ * @param stream
+ * @param pos
+ */
+void dsp_stream_next_position(dsp_stream_p stream, int* pos) {
+    int dim = 0;
+    for (dim = 0; dim < stream->dims; dim++) {
+        if (++pos[dim] < stream->sizes[dim])
+            return;
+        pos[dim] = 0;
     }
-    return pos;
 }
 
 /**
@@ -479,22 +501,17 @@ int dsp_stream_set_position(dsp_stream_p stream, int* pos) {
     return index;
 }
 
-static void* dsp_stream_align_th(void* arg)
+static void dsp_stream_align_range(int start, int end, void* arg)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y;
+    int cur[stream->dims], pos[stream->dims];
+    dsp_stream_fill_position(stream, start, cur);
     for(y = start; y < end; y++)
     {
-        int *pos = dsp_stream_get_position(stream, y);
+        memcpy(pos, cur, sizeof(int) * stream->dims);
+        dsp_stream_next_position(stream, cur);
         int dim;
         for (dim = 1; dim < stream->dims; dim++) {
             pos[dim] -= stream->align_info.center[dim];
@@ -516,11 +533,9 @@ static void* dsp_stream_align_th(void* arg)
             pos[dim-1] += stream->align_info.center[dim-1];
         }
         int x = dsp_stream_set_position(in, pos);
-        free(pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] = in->buf[x];
     }
-    return NULL;
 }
 
 void dsp_stream_align(dsp_stream_p in)
@@ -528,20 +543,7 @@ void dsp_stream_align(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_align_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, 64, dsp_stream_align_range, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -552,22 +554,17 @@ void dsp_stream_align(dsp_stream_p in)
  * @param in
  */
 
-static void* dsp_stream_crop_th(void* arg)
+static void dsp_stream_crop_range(int start, int end, void* arg)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y;
+    int cur[stream->dims], pos[stream->dims];
+    dsp_stream_fill_position(stream, start, cur);
     for(y = start; y < end; y++)
     {
-        int *pos = dsp_stream_get_position(stream, y);
+        memcpy(pos, cur, sizeof(int) * stream->dims);
+        dsp_stream_next_position(stream, cur);
         int dim;
         int allow = 1;
         for (dim = 0; dim < stream->dims; dim++) {
@@ -581,9 +578,7 @@ static void* dsp_stream_crop_th(void* arg)
         }
         else
             stream->buf[y] = 0;
-        free(pos);
     }
-    return NULL;
 }
 
 void dsp_stream_crop(dsp_stream_p in)
@@ -591,20 +586,7 @@ void dsp_stream_crop(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_crop_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, 64, dsp_stream_crop_range, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -630,26 +612,22 @@ void dsp_stream_translate(dsp_stream_p in)
 }
 
 /**
- * @brief dsp_stream_scale_th
+ * @brief dsp_stream_scale_range
+ * @param start
+ * @param end
  * @param arg
- * @return
  */
-static void* dsp_stream_scale_th(void* arg)
+static void dsp_stream_scale_range(int start, int end, void* arg)
 {
-    struct {
-        int cur_th;
-        dsp_stream_p stream;
-     } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y, d;
+    int cur[stream->dims], pos[stream->dims];
+    dsp_stream_fill_position(stream, start, cur);
     for(y = start; y < end; y++)
     {
-        int* pos = dsp_stream_get_position(stream, y);
+        memcpy(pos, cur, sizeof(int) * stream->dims);
+        dsp_stream_next_position(stream, cur);
         double factor = 0.0;
         for(d = 0; d < stream->dims; d++) {
             pos[d] -= stream->align_info.center[d];
@@ -661,9 +639,7 @@ static void* dsp_stream_scale_th(void* arg)
         int x = dsp_stream_set_position(in, pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] += in->buf[x]/(factor*stream->dims);
-        free(pos);
     }
-    return NULL;
 }
 
 void dsp_stream_scale(dsp_stream_p in)
@@ -671,41 +647,23 @@ void dsp_stream_scale(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_scale_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, 64, dsp_stream_scale_range, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
 }
 
-static void* dsp_stream_rotate_th(void* arg)
+static void dsp_stream_rotate_range(int start, int end, void* arg)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y;
+    int cur[stream->dims], pos[stream->dims];
+    dsp_stream_fill_position(stream, start, cur);
     for(y = start; y < end; y++)
     {
-        int *pos = dsp_stream_get_position(stream, y);
+        memcpy(pos, cur, sizeof(int) * stream->dims);
+        dsp_stream_next_position(stream, cur);
         int dim;
         for (dim = 1; dim < stream->dims; dim++) {
             pos[dim] -= stream->align_info.center[dim];
@@ -721,11 +679,9 @@ static void* dsp_stream_rotate_th(void* arg)
             pos[dim-1] += stream->align_info.center[dim-1];
         }
         int x = dsp_stream_set_position(in, pos);
-        free(pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] = in->buf[x];
     }
-    return NULL;
 }
 
 void dsp_stream_rotate(dsp_stream_p in)
@@ -733,20 +689,7 @@ void dsp_stream_rotate(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_rotate_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, 64, dsp_stream_rotate_range, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -767,52 +710,35 @@ static double stack_delegate_subtraction(double x, double y)
     return fmax(0.0, x - y);
 }
 
-static void* dsp_stream_stack_th(void* arg)
+struct dsp_stream_stack_args {
+    dsp_stream_p stream;
+    double(*delegate)(double, double);
+};
+
+static void dsp_stream_stack_range(int start, int end, void* arg)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } *arguments = arg;
+    struct dsp_stream_stack_args *arguments = arg;
     double(*delegate)(double, double) = arguments->delegate;
     dsp_stream_p stream = arguments->stream;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y;
+    int pos[stream->dims];
+    dsp_stream_fill_position(stream, start, pos);
     for(y = start; y < end; y++)
     {
-        int *pos = dsp_stream_get_position(stream, y);
         int x = dsp_stream_set_position(in, pos);
-        free(pos);
+        dsp_stream_next_position(stream, pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] = delegate(stream->buf[y], in->buf[x]);
     }
-    return NULL;
 }
 
 void dsp_stream_sum(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_sum;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    struct dsp_stream_stack_args arguments = { stream, stack_delegate_sum };
+    dsp_parallel_for(stream->len, 64, dsp_stream_stack_range, &arguments);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -822,22 +748,8 @@ void dsp_stream_multiply(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_multiply;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    struct dsp_stream_stack_args arguments = { stream, stack_delegate_multiply };
+    dsp_parallel_for(stream->len, 64, dsp_stream_stack_range, &arguments);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -847,22 +759,8 @@ void dsp_stream_subtract(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_subtraction;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    struct dsp_stream_stack_args arguments = { stream, stack_delegate_subtraction };
+    dsp_parallel_for(stream->len, 64, dsp_stream_stack_range, &arguments);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -32,7 +32,7 @@
  #define MAIN_TEST for a stand-alone test program.
  */
 
-#include <math.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,7 +41,15 @@
 #include <sys/types.h>
 #include <sys/time.h>
 
-#if defined(_WIN32) || defined(__CYGWIN__)
+#if defined(__linux__)
+#define EVENTLOOP_EPOLL
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define EVENTLOOP_KQUEUE
+#include <sys/event.h>
+#else
+#define EVENTLOOP_SELECT
 #include <sys/select.h>
 #endif
 
@@ -57,29 +65,37 @@ typedef struct
     int fd;     /* fd descriptor to watch for read */
     void *ud;   /* user's data handle */
     CBF *fp;    /* callback function */
+    int pfd;    /* fd registered to the poller, a dup of fd if another callback watches it, -1 if none */
+    int ready;  /* set by waitCallbacks() when fd will not block */
 } CB;
 static CB *cback;    /* malloced list of callbacks */
 static int ncback;   /* n entries in cback[] */
 static int ncbinuse; /* n entries in cback[] marked in_use */
 static int lastcb;   /* cback index of last cb called */
+static int nalways;  /* n callbacks in use the poller refused, eg regular files: always ready, as with select */
 
 /* info about one registered timer function.
- * the entries are kept sorted by increasing time from epoch, ie,
- *   the next entry to fire is at the begin of the list.
+ * pending timers are kept in a binary heap on their trigger time, ie, the
+ * next entry to fire is timerHeap[0]. all timers are also hashed by id.
  */
 typedef struct TF
 {
-    double tgo;       /* trigger time, ms from epoch */
-    int interval;     /* repeat timer if interval > 0, ms */
+    int64_t tgo;      /* trigger time, monotonic ns */
+    int64_t interval; /* repeat timer if interval > 0, ns */
     void *ud;         /* user's data handle */
     TCF *fp;          /* timer function */
     int tid;          /* unique id for this timer */
-    struct TF *next;  /* pointer to next item */
+    int hindex;       /* index in timerHeap, -1 while running */
+    int removed;      /* rmTimer() was called while running */
+    struct TF *hnext; /* next item in the same id bucket */
 } TF;
-static TF  timefunc_null = {0, 0, NULL, NULL, 0, NULL};
-static TF *timefunc = &timefunc_null;  /* list of timer functions */
-static int tid = 0;    /* source of unique timer ids */
-#define EPOCHDT(tp) /* ms from epoch to timeval *tp */ (((tp)->tv_usec) / 1000.0 + ((tp)->tv_sec) * 1000.0)
+static TF **timerHeap;    /* malloced heap of pending timers */
+static int ntimers;       /* n entries in timerHeap[] */
+static int atimers;       /* n entries allocated in timerHeap[] */
+static TF **timerIds;     /* malloced id hash buckets, size is a power of 2 */
+static int nids;          /* n buckets in timerIds[] */
+static int nidsinuse;     /* n timers in timerIds[] */
+static int tid = 0;       /* source of unique timer ids */
 
 /* info about one registered work procedure.
  * the malloced array wproc is never shrunk, entries are reused. new id's are
@@ -97,12 +113,20 @@ static int nwpinuse; /* n entries in wproc[] marked in-use */
 static int lastwp;   /* wproc index of last workproc called*/
 
 static void runWorkProc(void);
-static void callCallback(fd_set *rfdp);
+static void callCallback(void);
 static void checkTimer();
 static void oneLoop(void);
 static void deferTO(void *p);
 static void runImmediates();
 
+/* monotonic time, ns */
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 /* inf loop to dispatch callbacks, work procs and timers as necessary.
  * never returns.
  */
@@ -159,6 +183,223 @@ int deferLoop0(int maxms, int *flagp)
     return (0);
 }
 
+/* the poller: epoll on Linux, kqueue on the BSDs and macOS, select elsewhere.
+ * callbacks are registered to it with their index in cback[].
+ */
+#if defined(EVENTLOOP_EPOLL) || defined(EVENTLOOP_KQUEUE)
+static int poller = -1;
+#endif
+
+#if defined(EVENTLOOP_EPOLL)
+/* epoll_wait() only takes ms: the timers are waited for on a timerfd, to the ns.
+ * it is registered with an index no callback has.
+ */
+#define TIMERFD_INDEX UINT32_MAX
+static int timerFd = -2; /* -2 until created, -1 if it could not be */
+#endif
+
+#if defined(EVENTLOOP_EPOLL) || defined(EVENTLOOP_KQUEUE)
+
+static int pollerFd()
+{
+    if (poller == -1)
+    {
+#if defined(EVENTLOOP_EPOLL)
+        poller = epoll_create1(EPOLL_CLOEXEC);
+#else
+        poller = kqueue();
+#endif
+        if (poller == -1)
+        {
+            perror("eventloop poller");
+            exit(1);
+        }
+    }
+    return poller;
+}
+#endif
+
+/* watch cp->fd. return -1 if the poller refuses it */
+static int pollerAdd(CB *cp, int index)
+{
+#if defined(EVENTLOOP_EPOLL) || defined(EVENTLOOP_KQUEUE)
+    CB *other;
+    int ret;
+
+    /* the poller holds one registration per fd */
+    cp->pfd = cp->fd;
+    for (other = cback; other < &cback[ncback]; other++)
+    {
+        if (other != cp && other->in_use && other->fd == cp->fd)
+        {
+            cp->pfd = dup(cp->fd);
+            break;
+        }
+    }
+    if (cp->pfd == -1)
+        return -1;
+
+#if defined(EVENTLOOP_EPOLL)
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = EPOLLIN;
+    ev.data.u32 = index;
+    ret = epoll_ctl(pollerFd(), EPOLL_CTL_ADD, cp->pfd, &ev);
+#else
+    struct kevent ev;
+    EV_SET(&ev, cp->pfd, EVFILT_READ, EV_ADD, 0, 0, (void *)(intptr_t)index);
+    ret = kevent(pollerFd(), &ev, 1, NULL, 0, NULL);
+#endif
+    if (ret == -1)
+    {
+        if (cp->pfd != cp->fd)
+            close(cp->pfd);
+        cp->pfd = -1;
+    }
+    return ret;
+#else
+    (void)index;
+    cp->pfd = cp->fd;
+    return 0;
+#endif
+}
+
+static void pollerRemove(CB *cp)
+{
+#if defined(EVENTLOOP_EPOLL) || defined(EVENTLOOP_KQUEUE)
+    if (cp->pfd == -1)
+        return;
+
+    /* fails if the fd was already closed, which also removed it */
+#if defined(EVENTLOOP_EPOLL)
+    struct epoll_event ev;
+    epoll_ctl(poller, EPOLL_CTL_DEL, cp->pfd, &ev);
+#else
+    struct kevent ev;
+    EV_SET(&ev, cp->pfd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    kevent(poller, &ev, 1, NULL, 0, NULL);
+#endif
+    if (cp->pfd != cp->fd)
+        close(cp->pfd);
+#endif
+    cp->pfd = -1;
+}
+
+#if defined(EVENTLOOP_EPOLL)
+/* make the poller wake at the monotonic time deadline, ns. return -1 if there is no timerfd */
+static int armTimerFd(int64_t deadline)
+{
+    struct itimerspec its;
+
+    if (timerFd == -2)
+    {
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timerFd != -1)
+        {
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events   = EPOLLIN;
+            ev.data.u32 = TIMERFD_INDEX;
+            if (epoll_ctl(pollerFd(), EPOLL_CTL_ADD, timerFd, &ev) == -1)
+            {
+                close(timerFd);
+                timerFd = -1;
+            }
+        }
+    }
+    if (timerFd == -1)
+        return -1;
+
+    /* setting the time also clears the expirations not read, there is nothing to read */
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec  = deadline / 1000000000;
+    its.it_value.tv_nsec = deadline % 1000000000;
+    return timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+#endif
+
+/* wait at most timeout ns, forever if < 0, and mark the callbacks that will not block.
+ * return their count, or -1 on error.
+ */
+static int waitCallbacks(int64_t timeout)
+{
+    CB *cp;
+    int ns = 0;
+
+    if (nalways > 0)
+        timeout = 0;
+
+#if defined(EVENTLOOP_EPOLL)
+    struct epoll_event events[64];
+    /* round up: waking before the timer is due would only spin */
+    int ms = timeout < 0 ? -1 : (int)((timeout + 999999) / 1000000);
+    if (timeout > 0 && armTimerFd(nowNs() + timeout) == 0)
+        ms = -1;
+    int ret = epoll_wait(pollerFd(), events, 64, ms);
+    if (ret < 0)
+        return (errno == EINTR ? 0 : -1);
+    for (int i = 0; i < ret; i++)
+    {
+        if (events[i].data.u32 == TIMERFD_INDEX)
+            continue;
+        cback[events[i].data.u32].ready = 1;
+        ns++;
+    }
+#elif defined(EVENTLOOP_KQUEUE)
+    struct kevent events[64];
+    struct timespec ts, *tsp = NULL;
+    if (timeout >= 0)
+    {
+        ts.tv_sec  = timeout / 1000000000;
+        ts.tv_nsec = timeout % 1000000000;
+        tsp        = &ts;
+    }
+    int ret = kevent(pollerFd(), NULL, 0, events, 64, tsp);
+    if (ret < 0)
+        return (errno == EINTR ? 0 : -1);
+    for (int i = 0; i < ret; i++)
+        cback[(intptr_t)events[i].udata].ready = 1;
+    ns = ret;
+#else
+    struct timeval tv, *tvp = NULL;
+    fd_set rfd;
+    int maxfd = -1;
+
+    FD_ZERO(&rfd);
+    for (cp = cback; cp < &cback[ncback]; cp++)
+    {
+        if (cp->in_use)
+        {
+            FD_SET(cp->fd, &rfd);
+            if (cp->fd > maxfd)
+                maxfd = cp->fd;
+        }
+    }
+    if (timeout >= 0)
+    {
+        tv.tv_sec  = timeout / 1000000000;
+        tv.tv_usec = (timeout % 1000000000) / 1000;
+        tvp        = &tv;
+    }
+    ns = select(maxfd + 1, &rfd, NULL, NULL, tvp);
+    if (ns <= 0)
+        return (ns < 0 && errno == EINTR ? 0 : ns);
+    for (cp = cback; cp < &cback[ncback]; cp++)
+        if (cp->in_use && FD_ISSET(cp->fd, &rfd))
+            cp->ready = 1;
+#endif
+
+    for (cp = cback; cp < &cback[ncback]; cp++)
+    {
+        if (cp->in_use && cp->pfd == -1)
+        {
+            cp->ready = 1;
+            ns++;
+        }
+    }
+    return ns;
+}
+
 /* register a new callback, fp, to be called with ud as arg when fd is ready.
  * return a unique callback id for use with rmCallback().
  */
@@ -181,8 +422,12 @@ int addCallback(int fd, CBF *fp, void *ud)
     cp->fp     = fp;
     cp->ud     = ud;
     cp->fd     = fd;
+    cp->ready  = 0;
     ncbinuse++;
 
+    if (pollerAdd(cp, cp - cback) == -1)
+        nalways++;
+
     /* id is index into array */
     return (cp - cback);
 }
@@ -201,39 +446,138 @@ void rmCallback(int cid)
     if (!cp->in_use)
         return;
 
+    if (cp->pfd == -1)
+        nalways--;
+    pollerRemove(cp);
+
     /* mark for reuse */
     cp->in_use = 0;
+    cp->ready  = 0;
     ncbinuse--;
 }
 
-/* insert maintaining sort */
-static void insertTimer(TF *node)
+/* timer heap, ordered on tgo */
+static void heapSet(int index, TF *node)
 {
-    TF *it = timefunc;
+    timerHeap[index] = node;
+    node->hindex     = index;
+}
 
-    for(; ; it = it->next)
+static void heapUp(int index)
+{
+    TF *node = timerHeap[index];
+    while (index > 0)
     {
-        if (it->next == NULL || node->tgo < it->next->tgo)
-        {
-            node->next = it->next;
-            it->next = node;
+        int parent = (index - 1) / 2;
+        if (timerHeap[parent]->tgo <= node->tgo)
             break;
+        heapSet(index, timerHeap[parent]);
+        index = parent;
+    }
+    heapSet(index, node);
+}
+
+static void heapDown(int index)
+{
+    TF *node = timerHeap[index];
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= ntimers)
+            break;
+        if (child + 1 < ntimers && timerHeap[child + 1]->tgo < timerHeap[child]->tgo)
+            child++;
+        if (node->tgo <= timerHeap[child]->tgo)
+            break;
+        heapSet(index, timerHeap[child]);
+        index = child;
+    }
+    heapSet(index, node);
+}
+
+static void heapInsert(TF *node)
+{
+    if (ntimers == atimers)
+    {
+        atimers   = atimers ? 2 * atimers : 16;
+        timerHeap = (TF **)realloc(timerHeap, atimers * sizeof(TF *));
+    }
+    heapSet(ntimers++, node);
+    heapUp(ntimers - 1);
+}
+
+static void heapRemove(TF *node)
+{
+    int index = node->hindex;
+    TF *last  = timerHeap[--ntimers];
+
+    node->hindex = -1;
+    if (last == node)
+        return;
+    heapSet(index, last);
+    heapUp(index);
+    heapDown(last->hindex);
+}
+
+/* timer id hash */
+static void idInsert(TF *node)
+{
+    if (nidsinuse >= nids)
+    {
+        int n    = nids ? 2 * nids : 64;
+        TF **ids = (TF **)calloc(n, sizeof(TF *));
+        for (int i = 0; i < nids; i++)
+        {
+            TF *it, *next;
+            for (it = timerIds[i]; it != NULL; it = next)
+            {
+                next      = it->hnext;
+                it->hnext = ids[it->tid & (n - 1)];
+                ids[it->tid & (n - 1)] = it;
+            }
+        }
+        free(timerIds);
+        timerIds = ids;
+        nids     = n;
+    }
+    node->hnext = timerIds[node->tid & (nids - 1)];
+    timerIds[node->tid & (nids - 1)] = node;
+    nidsinuse++;
+}
+
+static void idRemove(TF *node)
+{
+    TF **it = &timerIds[node->tid & (nids - 1)];
+    for (; *it != NULL; it = &(*it)->hnext)
+    {
+        if (*it == node)
+        {
+            *it = node->hnext;
+            nidsinuse--;
+            return;
         }
     }
 }
 
-/* register a new timer function, fp, to be called with ud as arg after ms
- * milliseconds. add to list in order of increasing time from epoch, ie,
- * first entry runs soonest. return id for use with rmTimer().
+/* find the timer by id */
+static TF *findTimer(int timer_id)
+{
+    TF *it;
+    if (nids == 0)
+        return NULL;
+    for (it = timerIds[timer_id & (nids - 1)]; it != NULL; it = it->hnext)
+        if (it->tid == timer_id)
+            return it;
+    return NULL;
+}
+
+/* register a new timer function, fp, to be called with ud as arg after delay
+ * ns, then every interval ns if > 0. return id for use with rmTimer().
  */
-static int addTimerImpl(int delay, int interval, TCF *fp, void *ud)
+static int addTimerImpl(int64_t delay, int64_t interval, TCF *fp, void *ud)
 {
-    struct timeval t;
     TF *node;
 
-    /* get time now */
-    gettimeofday(&t, NULL);
-
     /* create entry */
     node = (TF*)malloc(sizeof(TF));
 
@@ -241,47 +585,34 @@ static int addTimerImpl(int delay, int interval, TCF *fp, void *ud)
     node->ud  = ud;
     node->fp  = fp;
     node->tid = ++tid; /* store new unique id */
-    node->tgo = EPOCHDT(&t) + delay;
+    node->tgo = nowNs() + delay;
     node->interval = interval;
+    node->removed  = 0;
 
-    insertTimer(node);
+    idInsert(node);
+    heapInsert(node);
 
     return node->tid;
 }
 
 int addTimer(int ms, TCF *fp, void *ud)
 {
-    return addTimerImpl(ms, 0, fp, ud);
+    return addTimerImpl((int64_t)ms * 1000000, 0, fp, ud);
 }
 
 int addPeriodicTimer(int ms, TCF *fp, void *ud)
 {
-    return addTimerImpl(ms, ms, fp, ud);
+    return addTimerImpl((int64_t)ms * 1000000, (int64_t)ms * 1000000, fp, ud);
 }
 
-/* find the timer and remove from list */
-static TF *dettachTimer(TF *node)
+int addTimerUs(int64_t us, TCF *fp, void *ud)
 {
-    TF *it = timefunc;
-    for(; it->next != NULL; it = it->next)
-    {
-        if (it->next == node)
-        {
-            it->next = node->next;
-            return node;
-        }
-    }
-    return NULL;
+    return addTimerImpl(us * 1000, 0, fp, ud);
 }
 
-/* find the timer by id */
-static TF *findTimer(int timer_id)
+int addPeriodicTimerUs(int64_t us, TCF *fp, void *ud)
 {
-    TF *it = timefunc->next;
-    for(; it != NULL; it = it->next)
-        if (it->tid == timer_id)
-            return it;
-    return NULL;
+    return addTimerImpl(us * 1000, us * 1000, fp, ud);
 }
 
 /* remove the timer with the given id, as returned from addTimer().
@@ -289,24 +620,26 @@ static TF *findTimer(int timer_id)
  */
 void rmTimer(int timer_id)
 {
-    TF *node, *it = timefunc;
-    for(; (node = it->next) != NULL; it = it->next)
+    TF *node = findTimer(timer_id);
+    if (node == NULL)
+        return;
+
+    /* a running timer is freed by checkTimer() */
+    if (node->hindex == -1)
     {
-        if (node->tid == timer_id)
-        {
-            it->next = node->next;
-            free(node);
-            break;
-        }
+        node->removed = 1;
+        return;
     }
+
+    heapRemove(node);
+    idRemove(node);
+    free(node);
 }
 
-/* Returns the timer's remaining value in milliseconds left until the timeout. */
-static double remainingTimerNode(TF *node)
+/* Returns the timer's remaining value in nanoseconds left until the timeout. */
+static int64_t remainingTimerNode(TF *node)
 {
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    return (node->tgo - EPOCHDT(&now));
+    return node->tgo - nowNs();
 }
 
 /* Returns the timer's remaining value in milliseconds left until the timeout.
@@ -315,7 +648,7 @@ static double remainingTimerNode(TF *node)
 int remainingTimer(int timer_id)
 {
     TF *it = findTimer(timer_id);
-    return it == NULL ? -1 : remainingTimerNode(it);
+    return it == NULL ? -1 : (int)(remainingTimerNode(it) / 1000000);
 }
 
 /* Returns the timer's remaining value in nanoseconds left until the timeout.
@@ -324,7 +657,7 @@ int remainingTimer(int timer_id)
 int64_t nsecsRemainingTimer(int timer_id)
 {
     TF *it = findTimer(timer_id);
-    return it == NULL ? -1 : remainingTimerNode(it) * 1000000;
+    return it == NULL ? -1 : remainingTimerNode(it);
 }
 
 /* add a new work procedure, fp, to be called with ud when nothing else to do.
@@ -393,49 +726,55 @@ static void runWorkProc()
     (*wp->fp)(wp->ud);
 }
 
-/* run next callback whose fd is listed as ready to go in rfdp */
-static void callCallback(fd_set *rfdp)
+/* run next callback marked ready by waitCallbacks(). the others are cleared: the
+ * poller reports them again next time if they still will not block.
+ */
+static void callCallback()
 {
-    CB *cp;
+    CB *cp, *next = NULL;
+    int i;
 
     /* skip if list is empty */
     if (!ncbinuse)
         return;
 
     /* find next */
-    do
+    for (i = 1; i <= ncback; i++)
     {
-        lastcb = (lastcb + 1) % ncback;
-        cp     = &cback[lastcb];
-    } while (!cp->in_use || !FD_ISSET(cp->fd, rfdp));
+        cp = &cback[(lastcb + i) % ncback];
+        if (cp->in_use && cp->ready && next == NULL)
+        {
+            next   = cp;
+            lastcb = (lastcb + i) % ncback;
+        }
+        cp->ready = 0;
+    }
 
     /* run */
-    (*cp->fp)(cp->fd, cp->ud);
+    if (next != NULL)
+        (*next->fp)(next->fd, next->ud);
 }
 
 /* run the next timer callback whose time has come, if any. all we have to do
- * is is check the first entry in timefunc because it is sorted in increasing
- * order of time from epoch to run, ie, first entry runs soonest.
+ * is check the top of the heap, it runs soonest.
  */
 static void checkTimer()
 {
-    TF *node = timefunc->next;
+    TF *node = ntimers ? timerHeap[0] : NULL;
 
     if (node == NULL || remainingTimerNode(node) > 0)
         return;
 
-    (*node->fp)(node->ud);
-
-    node = dettachTimer(node);
+    heapRemove(node);
 
-    if (node == NULL)
-        return;
+    (*node->fp)(node->ud);
 
-    if (node->interval > 0)
+    if (node->interval > 0 && !node->removed)
     {
         node->tgo += node->interval;
-        insertTimer(node);
+        heapInsert(node);
     } else {
+        idRemove(node);
         free(node);
     }
 }
@@ -445,23 +784,8 @@ static void checkTimer()
  */
 static void oneLoop()
 {
-    struct timeval tv, *tvp;
-    fd_set rfd;
-    CB *cp;
-    int maxfd, ns;
-
-    /* build list of callback file descriptors to check */
-    FD_ZERO(&rfd);
-    maxfd = -1;
-    for (cp = cback; cp < &cback[ncback]; cp++)
-    {
-        if (cp->in_use)
-        {
-            FD_SET(cp->fd, &rfd);
-            if (cp->fd > maxfd)
-                maxfd = cp->fd;
-        }
-    }
+    int64_t timeout;
+    int ns;
 
     /* determine timeout:
 	 * if there are work procs
@@ -472,28 +796,21 @@ static void oneLoop()
 	 *   set delay = forever
 	 */
     if (nwpinuse > 0)
+        timeout = 0;
+    else if (ntimers > 0)
     {
-        tvp         = &tv;
-        tvp->tv_sec = tvp->tv_usec = 0;
-    }
-    else if (timefunc->next != NULL)
-    {
-        double late = remainingTimerNode(timefunc->next); /* ms late */
-        if (late < 0)
-            late = 0;
-        late /= 1000.0; /* secs late */
-        tvp          = &tv;
-        tvp->tv_sec  = (long)floor(late);
-        tvp->tv_usec = (long)floor((late - tvp->tv_sec) * 1000000.0);
+        timeout = remainingTimerNode(timerHeap[0]);
+        if (timeout < 0)
+            timeout = 0;
     }
     else
-        tvp = NULL;
+        timeout = -1;
 
     /* check file descriptors, timeout depending on pending work */
-    ns = select(maxfd + 1, &rfd, NULL, NULL, tvp);
+    ns = waitCallbacks(timeout);
     if (ns < 0)
     {
-        perror("select");
+        perror("eventloop wait");
         return;
     }
 
@@ -502,7 +819,7 @@ static void oneLoop()
     if (ns == 0)
         runWorkProc();
     else
-        callCallback(&rfd);
+        callCallback();
 
     runImmediates();
 }
@@ -593,6 +910,16 @@ int IEAddPeriodicTimer(int millisecs, IE_TCF *fp, void *p)
     return (addPeriodicTimer(millisecs, (TCF *)fp, p));
 }
 
+int IEAddTimerUs(int64_t microsecs, IE_TCF *fp, void *p)
+{
+    return (addTimerUs(microsecs, (TCF *)fp, p));
+}
+
+int IEAddPeriodicTimerUs(int64_t microsecs, IE_TCF *fp, void *p)
+{
+    return (addPeriodicTimerUs(microsecs, (TCF *)fp, p));
+}
+
 int IERemainingTimer(int timerid)
 {
     return (remainingTimer(timerid));
@@ -25,6 +25,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
 
+#include <stdint.h>
+
 /** \file eventloop.h
     \brief Public interface to INDI's eventloop mechanism.
     \author Elwood C. Downey
@@ -103,6 +105,25 @@ extern int addTimer(int ms, TCF *fp, void *ud);
 */
 extern int addPeriodicTimer(int ms, TCF *fp, void *ud);
 
+/** Register a new single-shot timer function, \e fp, to be called with \e ud as argument after \e us.
+* Timers are kept on the monotonic clock, the loop wakes for them to the microsecond on Linux.
+*
+* \param us timer period in microseconds.
+* \param fp a pointer to the callback function.
+* \param ud a pointer to be passed to the callback function when called.
+* \return a unique id for use with rmTimer().
+*/
+extern int addTimerUs(int64_t us, TCF *fp, void *ud);
+
+/** Register a new periodic timer function, \e fp, to be called with \e ud as argument every \e us.
+*
+* \param us timer period in microseconds.
+* \param fp a pointer to the callback function.
+* \param ud a pointer to be passed to the callback function when called.
+* \return a unique id for use with rmTimer().
+*/
+extern int addPeriodicTimerUs(int64_t us, TCF *fp, void *ud);
+
 /** Returns the timer's remaining value in milliseconds left until the timeout.
  *
  * \param tid the timer callback ID returned from addTimer() or addPeriodicTimer()
@@ -115,7 +136,7 @@ extern int remainingTimer(int tid);
  * \param tid the timer callback ID returned from addTimer() or addPeriodicTimer()
  * \return  If the timer not exists, the returned value will be -1.
  */
-extern int nsecRemainingTimer(int tid);
+extern int64_t nsecsRemainingTimer(int tid);
 
 /** Remove the timer with the given \e id, as returned from addTimer() or addPeriodicTimer().
 *
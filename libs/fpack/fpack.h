@@ -174,6 +174,19 @@ int fp_pack_data_to_data (const char *inputBuffer, size_t inputBufferSize, unsig
                           size_t *outputBufferSize,
                           fpstate fpvar,
                           int *islossless);
+/* Same as fp_pack_data_to_data, the output buffer being grown with mem_realloc */
+int fp_pack_data_to_data_realloc (const char *inputBuffer, size_t inputBufferSize, unsigned char **outputBuffer,
+                                  size_t *outputBufferSize,
+                                  void *(*mem_realloc)(void *p, size_t newsize),
+                                  fpstate fpvar,
+                                  int *islossless);
+/* Same as fp_pack_data_to_data_realloc for lossless RICE_1 of one integer image, tiles compressed on nthreads more threads.
+   Returns 1 if the input does not qualify */
+int fp_pack_data_to_data_threaded (const char *inputBuffer, size_t inputBufferSize, unsigned char **outputBuffer,
+                                   size_t *outputBufferSize,
+                                   void *(*mem_realloc)(void *p, size_t newsize),
+                                   fpstate fpvar,
+                                   int nthreads);
 /* Pack input fits file to in-memory fits file */
 int fp_pack_fits_to_fits (fitsfile *infptr, fitsfile **outfits, fpstate fpvar, int *islossless);
 
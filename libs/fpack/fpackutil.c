@@ -17,6 +17,7 @@
 #endif
 
 #include <math.h>
+#include <pthread.h>
 #include <fitsio.h>
 #include <fitsio2.h>
 #include "fpack.h"
@@ -1030,6 +1031,17 @@ int fp_pack_data_to_fits (const char *inputBuffer, size_t inputBufferSize, fitsf
  */
 int fp_pack_data_to_data (const char *inputBuffer, size_t inputBufferSize, unsigned char **outputBuffer, size_t *outputBufferSize,
                           fpstate fpvar, int *islossless)
+{
+    return fp_pack_data_to_data_realloc(inputBuffer, inputBufferSize, outputBuffer, outputBufferSize, realloc, fpvar,
+                                        islossless);
+}
+
+/*--------------------------------------------------------------------------*/
+/*
+ */
+int fp_pack_data_to_data_realloc (const char *inputBuffer, size_t inputBufferSize, unsigned char **outputBuffer,
+                                  size_t *outputBufferSize, void *(*mem_realloc)(void *p, size_t newsize), fpstate fpvar,
+                                  int *islossless)
 {
     fitsfile *infptr, *outfptr;
     int	stat=0;
@@ -1043,7 +1055,7 @@ int fp_pack_data_to_data (const char *inputBuffer, size_t inputBufferSize, unsig
     }
 
     void *outbuffer = (void *)(outputBuffer);
-    fits_create_memfile(&outfptr, outbuffer, outputBufferSize, 2880, realloc, &stat);
+    fits_create_memfile(&outfptr, outbuffer, outputBufferSize, 2880, mem_realloc, &stat);
     if (stat)
     {
         fp_abort_output(infptr, outfptr, stat);
@@ -1094,6 +1106,252 @@ int fp_pack_data_to_data (const char *inputBuffer, size_t inputBufferSize, unsig
     return(0);
 }
 
+/*--------------------------------------------------------------------------*/
+/* Rice compression of row tiles on several threads, see fp_pack_data_to_data_threaded */
+
+#define FP_RICE_BLOCKSIZE 32
+
+typedef struct
+{
+    const unsigned char *data;  /* big endian image data */
+    long tilepix;               /* pixels per tile (one row) */
+    long ntiles;
+    int bytepix;
+    long nexttile;              /* next tile to compress, under lock */
+    pthread_mutex_t lock;
+    unsigned char **tiles;      /* compressed tiles */
+    int *tilelen;               /* their length, < 0 on error */
+} fp_tile_job;
+
+static void *fp_compress_tiles(void *arg)
+{
+    fp_tile_job *job = (fp_tile_job *)arg;
+    int clen = (int)(job->tilepix * job->bytepix * 2 + 64);
+    void *pixels = malloc(job->tilepix * (job->bytepix == 1 ? 1 : job->bytepix));
+
+    for (;;)
+    {
+        long tile, ii;
+
+        pthread_mutex_lock(&job->lock);
+        tile = job->nexttile++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (tile >= job->ntiles)
+            break;
+
+        const unsigned char *in = job->data + tile * job->tilepix * job->bytepix;
+        unsigned char *out = (unsigned char *)malloc(clen);
+
+        if (pixels == NULL || out == NULL)
+        {
+            free(out);
+            job->tilelen[tile] = -1;
+            continue;
+        }
+
+        /* FITS data is big endian, the compressors want native integers */
+        switch (job->bytepix)
+        {
+            case 1:
+                memcpy(pixels, in, job->tilepix);
+                job->tilelen[tile] = fits_rcomp_byte((signed char *)pixels, job->tilepix, out, clen, FP_RICE_BLOCKSIZE);
+                break;
+            case 2:
+                for (ii = 0; ii < job->tilepix; ii++)
+                    ((short *)pixels)[ii] = (short)((in[2 * ii] << 8) | in[2 * ii + 1]);
+                job->tilelen[tile] = fits_rcomp_short((short *)pixels, job->tilepix, out, clen, FP_RICE_BLOCKSIZE);
+                break;
+            default:
+                for (ii = 0; ii < job->tilepix; ii++)
+                    ((int *)pixels)[ii] = (int)(((unsigned int)in[4 * ii] << 24) | ((unsigned int)in[4 * ii + 1] << 16) |
+                                                ((unsigned int)in[4 * ii + 2] << 8) | (unsigned int)in[4 * ii + 3]);
+                job->tilelen[tile] = fits_rcomp((int *)pixels, job->tilepix, out, clen, FP_RICE_BLOCKSIZE);
+                break;
+        }
+
+        job->tiles[tile] = out;
+    }
+
+    free(pixels);
+    return NULL;
+}
+
+/* write the tiles of job as a RICE_1 tile compressed image after the primary image of infptr */
+static int fp_write_rice_tiles(fitsfile *infptr, fitsfile *outfptr, int bitpix, int naxis, long *naxes,
+                               fp_tile_job *job, int *stat)
+{
+    char *ttype[] = {"COMPRESSED_DATA"};
+    char *tform[] = {"1PB"};
+    char keyname[FLEN_KEYWORD], card[FLEN_CARD];
+    int ii, nkeys = 0, logical = 1;
+    long value;
+
+    /* null primary array, the image goes to the first extension like fits_img_compress does */
+    fits_create_img(outfptr, BYTE_IMG, 0, NULL, stat);
+    fits_create_tbl(outfptr, BINARY_TBL, 0, 1, ttype, tform, NULL, "COMPRESSED_IMAGE", stat);
+
+    fits_write_key_log(outfptr, "ZIMAGE", logical, "extension contains compressed image", stat);
+    fits_write_key_log(outfptr, "ZSIMPLE", logical, "file does conform to FITS standard", stat);
+    fits_write_key_lng(outfptr, "ZBITPIX", bitpix, "data type of original image", stat);
+    fits_write_key_lng(outfptr, "ZNAXIS", naxis, "dimension of original image", stat);
+    for (ii = 0; ii < naxis; ii++)
+    {
+        snprintf(keyname, FLEN_KEYWORD, "ZNAXIS%d", ii + 1);
+        fits_write_key_lng(outfptr, keyname, naxes[ii], "length of original image axis", stat);
+    }
+    for (ii = 0; ii < naxis; ii++)
+    {
+        value = ii == 0 ? naxes[0] : 1;
+        snprintf(keyname, FLEN_KEYWORD, "ZTILE%d", ii + 1);
+        fits_write_key_lng(outfptr, keyname, value, "size of tiles to be compressed", stat);
+    }
+    fits_write_key_str(outfptr, "ZCMPTYPE", "RICE_1", "compression algorithm", stat);
+    fits_write_key_str(outfptr, "ZNAME1", "BLOCKSIZE", "compression block size", stat);
+    fits_write_key_lng(outfptr, "ZVAL1", FP_RICE_BLOCKSIZE, "pixels per block", stat);
+    fits_write_key_str(outfptr, "ZNAME2", "BYTEPIX", "bytes per pixel (1, 2, 4, or 8)", stat);
+    fits_write_key_lng(outfptr, "ZVAL2", job->bytepix, "bytes per pixel (1, 2, 4, or 8)", stat);
+
+    /* everything but the structure of the original header, scaling keywords included */
+    fits_get_hdrspace(infptr, &nkeys, NULL, stat);
+    for (ii = 1; ii <= nkeys && !*stat; ii++)
+    {
+        fits_read_record(infptr, ii, card, stat);
+        switch (fits_get_keyclass(card))
+        {
+            case TYP_STRUC_KEY:
+            case TYP_CMPRS_KEY:
+            case TYP_CKSUM_KEY:
+                break;
+            default:
+                fits_write_record(outfptr, card, stat);
+        }
+    }
+
+    for (ii = 0; ii < job->ntiles && !*stat; ii++)
+        fits_write_col(outfptr, TBYTE, ii + 1, 1, job->tilelen[ii], job->tiles[ii], stat);
+
+    return *stat;
+}
+
+/* Same as fp_pack_data_to_data_realloc for a lossless RICE_1 compression of a single integer image,
+ * with the row tiles compressed on nthreads threads. Return 1 if the image does not qualify,
+ * the caller should then use fp_pack_data_to_data_realloc.
+ */
+int fp_pack_data_to_data_threaded(const char *inputBuffer, size_t inputBufferSize, unsigned char **outputBuffer,
+                                  size_t *outputBufferSize, void *(*mem_realloc)(void *p, size_t newsize),
+                                  fpstate fpvar, int nthreads)
+{
+    fitsfile *infptr, *outfptr;
+    int stat = 0, bitpix = 0, naxis = 0, hdunum = 0, ii;
+    long naxes[9] = {0};
+    LONGLONG headstart, datastart, dataend;
+    void *inbuffer = (void *)(inputBuffer);
+    fp_tile_job job;
+    pthread_t *threads;
+    int nstarted = 0;
+
+    if (fpvar.comptype != RICE_1 || fpvar.int_to_float || fpvar.rescale_noise != 0. || fpvar.ntile[0] != -1)
+        return 1;
+
+    fits_open_memfile(&infptr, "", READONLY, &inbuffer, &inputBufferSize, 2880, NULL, &stat);
+    if (stat)
+    {
+        fits_report_error (stderr, stat);
+        return -1;
+    }
+
+    fits_get_img_param(infptr, 9, &bitpix, &naxis, naxes, &stat);
+    fits_get_num_hdus(infptr, &hdunum, &stat);
+    fits_get_hduaddrll(infptr, &headstart, &datastart, &dataend, &stat);
+
+    if (stat || hdunum != 1 || bitpix <= 0 || bitpix > LONG_IMG || naxis < 2 || naxis > 3 || naxes[0] == 0 ||
+            (size_t)datastart > inputBufferSize)
+    {
+        fits_close_file(infptr, &stat);
+        return 1;
+    }
+
+    job.data     = (const unsigned char *)inputBuffer + datastart;
+    job.bytepix  = bitpix / 8;
+    job.tilepix  = naxes[0];
+    job.ntiles   = naxes[1] * (naxis == 3 ? naxes[2] : 1);
+    job.nexttile = 0;
+
+    if ((size_t)(datastart + job.tilepix * job.ntiles * job.bytepix) > inputBufferSize)
+    {
+        fits_close_file(infptr, &stat);
+        return 1;
+    }
+
+    job.tiles   = (unsigned char **)calloc(job.ntiles, sizeof(unsigned char *));
+    job.tilelen = (int *)calloc(job.ntiles, sizeof(int));
+    threads     = (pthread_t *)calloc(nthreads, sizeof(pthread_t));
+    pthread_mutex_init(&job.lock, NULL);
+
+    if (job.tiles && job.tilelen && threads)
+    {
+        for (nstarted = 0; nstarted < nthreads; nstarted++)
+            if (pthread_create(&threads[nstarted], NULL, fp_compress_tiles, &job) != 0)
+                break;
+        /* the calling thread works too, so a failed pthread_create only costs speed */
+        fp_compress_tiles(&job);
+        for (ii = 0; ii < nstarted; ii++)
+            pthread_join(threads[ii], NULL);
+    }
+    else
+        stat = MEMORY_ALLOCATION;
+
+    for (ii = 0; ii < job.ntiles && !stat; ii++)
+        if (job.tilelen[ii] <= 0)
+            stat = DATA_COMPRESSION_ERR;
+
+    if (!stat)
+    {
+        void *outbuffer = (void *)(outputBuffer);
+        fits_create_memfile(&outfptr, outbuffer, outputBufferSize, 2880, mem_realloc, &stat);
+        if (!stat)
+        {
+            fp_write_rice_tiles(infptr, outfptr, bitpix, naxis, naxes, &job, &stat);
+            if (fpvar.do_checksums)
+            {
+                fits_write_chksum(outfptr, &stat);
+                fits_movabs_hdu(outfptr, 1, NULL, &stat);
+                fits_write_chksum(outfptr, &stat);
+            }
+            if (stat)
+            {
+                /* closes both files */
+                fp_abort_output(infptr, outfptr, stat);
+                infptr = NULL;
+            }
+            else
+                fits_close_file(outfptr, &stat); /* the memory stays with the caller */
+        }
+    }
+
+    for (ii = 0; job.tiles && ii < job.ntiles; ii++)
+        free(job.tiles[ii]);
+    free(job.tiles);
+    free(job.tilelen);
+    free(threads);
+    pthread_mutex_destroy(&job.lock);
+
+    if (infptr == NULL)
+        return -1;
+
+    if (stat)
+    {
+        fits_report_error (stderr, stat);
+        stat = 0;
+        fits_close_file(infptr, &stat);
+        return -1;
+    }
+
+    fits_close_file(infptr, &stat);
+    return(0);
+}
+
 /*--------------------------------------------------------------------------*/
 /*
  */
@@ -29,6 +29,8 @@
 #include "locale_compat.h"
 #include "indistandardproperty.h"
 
+#include <algorithm>
+
 #if defined(_MSC_VER)
 #define snprintf _snprintf
 #pragma warning(push)
@@ -49,7 +51,7 @@ AbstractBaseClientPrivate::AbstractBaseClientPrivate(AbstractBaseClient *parent)
     io.write = [](void *user, const void * ptr, size_t count) -> ssize_t
     {
         auto self = static_cast<AbstractBaseClientPrivate *>(user);
-        return self->sendData(ptr, count);
+        return self->writeData(ptr, count);
     };
 
     io.vprintf = [](void *user, const char * format, va_list ap) -> int
@@ -57,7 +59,7 @@ AbstractBaseClientPrivate::AbstractBaseClientPrivate(AbstractBaseClient *parent)
         auto self = static_cast<AbstractBaseClientPrivate *>(user);
         char message[MAXRBUF];
         vsnprintf(message, MAXRBUF, format, ap);
-        return int(self->sendData(message, strlen(message)));
+        return int(self->writeData(message, strlen(message)));
     };
 }
 
@@ -65,40 +67,102 @@ void AbstractBaseClientPrivate::clear()
 {
     watchDevice.clearDevices();
     blobModes.clear();
+    blobModesChanged(false);
+
+    std::lock_guard<std::mutex> lock(batchLock);
+    for (auto &batch : batches)
+        batch.done.set_value(false);
+    batches.clear();
+}
+
+ssize_t AbstractBaseClientPrivate::writeData(const void *data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(batchLock);
+    if (!batching)
+        return sendData(data, size);
+
+    batchBuffer.append(static_cast<const char *>(data), size);
+    return size;
+}
+
+void AbstractBaseClientPrivate::batchProperty(const INDI::Property &property)
+{
+    std::lock_guard<std::mutex> lock(batchLock);
+    if (batching)
+        batchProperties.emplace(property.getDeviceName(), property.getName());
+}
+
+void AbstractBaseClientPrivate::batchPropertyUpdated(const LilXmlElement &root)
+{
+    IPState state;
+    if (crackIPState(root.getAttribute("state"), &state) != 0 || state == IPS_BUSY)
+        return;
+
+    std::lock_guard<std::mutex> lock(batchLock);
+    const auto property = std::make_pair(root.getAttribute("device").toString(), root.getAttribute("name").toString());
+    for (auto it = batches.begin(); it != batches.end();)
+    {
+        if (it->properties.erase(property) == 0)
+        {
+            ++it;
+            continue;
+        }
+
+        it->ok = it->ok && state != IPS_ALERT;
+        if (!it->properties.empty())
+        {
+            ++it;
+            continue;
+        }
+
+        it->done.set_value(it->ok);
+        it = batches.erase(it);
+    }
 }
 
 int AbstractBaseClientPrivate::dispatchCommand(const LilXmlElement &root, char *errmsg)
 {
+    // Protocol tags are interned by the parser: compare pointers
+    static const char *pingRequest   = internXMLName("pingRequest");
+    static const char *pingReply     = internXMLName("pingReply");
+    static const char *message       = internXMLName("message");
+    static const char *delProperty   = internXMLName("delProperty");
+    static const char *getProperties = internXMLName("getProperties");
+    static const char *defBLOBVector = internXMLName("defBLOBVector");
+    static const char *setBLOBVector = internXMLName("setBLOBVector");
+
+    const char *tag = tagXMLEle(root.handle());
+
     // Ignore echoed newXXX
-    if (root.tagName().find("new") == 0)
+    if (strncmp(tag, "new", 3) == 0)
     {
         return 0;
     }
 
-    if (root.tagName() == "pingRequest")
+    if (tag == pingRequest)
     {
         parent->sendPingReply(root.getAttribute("uid"));
         return 0;
     }
 
-    if (root.tagName() == "pingReply")
+    if (tag == pingReply)
     {
         parent->newPingReply(root.getAttribute("uid").toString());
         return 0;
     }
 
-    if (root.tagName() == "message")
+    if (tag == message)
     {
         return messageCmd(root, errmsg);
     }
 
-    if (root.tagName() == "delProperty")
+    if (tag == delProperty)
     {
         return delPropertyCmd(root, errmsg);
     }
 
     // Just ignore any getProperties we might get
-    if (root.tagName() == "getProperties")
+    if (tag == getProperties)
     {
         return INDI_PROPERTY_DUPLICATED;
     }
@@ -107,19 +171,24 @@ int AbstractBaseClientPrivate::dispatchCommand(const LilXmlElement &root, char *
     // not related to blobs
     if (
         parent->getBLOBMode(root.getAttribute("device")) == B_ONLY &&
-        root.tagName() != "defBLOBVector" &&
-        root.tagName() != "setBLOBVector"
+        tag != defBLOBVector &&
+        tag != setBLOBVector
     )
     {
         return 0;
     }
 
-    return watchDevice.processXml(root, errmsg, [this]  // create new device if nessesery
+    int result = watchDevice.processXml(root, errmsg, [this]  // create new device if nessesery
     {
         ParentDevice device(ParentDevice::Valid);
         device.setMediator(parent);
         return device;
     });
+
+    if (result == 0 && strncmp(tag, "set", 3) == 0)
+        batchPropertyUpdated(root);
+
+    return result;
 }
 
 int AbstractBaseClientPrivate::deleteDevice(const char *devName, char *errmsg)
@@ -252,6 +321,16 @@ void AbstractBaseClientPrivate::userIoGetProperties()
     }
 }
 
+void AbstractBaseClientPrivate::userIoWatch(const char *deviceName, const char *propertyName)
+{
+    // Watches added later extend the subscription the server filters on
+    if (!sConnected)
+        return;
+
+    IUUserIOGetProperties(&io, this, deviceName, propertyName);
+    if (verbose)
+        IUUserIOGetProperties(userio_file(), stderr, deviceName, propertyName);
+}
 
 void AbstractBaseClientPrivate::setDriverConnection(bool status, const char *deviceName)
 {
@@ -365,18 +444,21 @@ void AbstractBaseClient::watchDevice(const char *deviceName)
 {
     D_PTR(AbstractBaseClient);
     d->watchDevice.watchDevice(deviceName);
+    d->userIoWatch(deviceName, nullptr);
 }
 
 void AbstractBaseClient::watchDevice(const char *deviceName, const std::function<void (BaseDevice)> &callback)
 {
     D_PTR(AbstractBaseClient);
     d->watchDevice.watchDevice(deviceName, callback);
+    d->userIoWatch(deviceName, nullptr);
 }
 
 void AbstractBaseClient::watchProperty(const char *deviceName, const char *propertyName)
 {
     D_PTR(AbstractBaseClient);
     d->watchDevice.watchProperty(deviceName, propertyName);
+    d->userIoWatch(deviceName, propertyName);
 }
 
 void AbstractBaseClient::connectDevice(const char *deviceName)
@@ -442,6 +524,12 @@ void AbstractBaseClient::setBLOBMode(BLOBHandling blobH, const char *dev, const
     }
 
     IUUserIOEnableBLOB(&d->io, d, dev, prop, blobH);
+
+    bool wantsBlobs = std::any_of(d->blobModes.begin(), d->blobModes.end(), [](const BLOBMode & mode)
+    {
+        return mode.blobMode != B_NEVER;
+    });
+    d->blobModesChanged(wantsBlobs);
 }
 
 BLOBHandling AbstractBaseClient::getBLOBMode(const char *dev, const char *prop)
@@ -461,6 +549,7 @@ void AbstractBaseClient::sendNewProperty(INDI::Property pp)
 {
     D_PTR(AbstractBaseClient);
     pp.setState(IPS_BUSY);
+    d->batchProperty(pp);
     // #PS: TODO more generic
     switch (pp.getType())
     {
@@ -491,6 +580,7 @@ void AbstractBaseClient::sendNewText(INDI::Property pp)
     AutoCNumeric locale;
 
     pp.setState(IPS_BUSY);
+    d->batchProperty(pp);
     IUUserIONewText(&d->io, d, pp.getText()->cast());
 }
 
@@ -517,6 +607,7 @@ void AbstractBaseClient::sendNewNumber(INDI::Property pp)
     D_PTR(AbstractBaseClient);
     AutoCNumeric locale;
     pp.setState(IPS_BUSY);
+    d->batchProperty(pp);
     IUUserIONewNumber(&d->io, d, pp.getNumber()->cast());
 }
 
@@ -542,6 +633,7 @@ void AbstractBaseClient::sendNewSwitch(INDI::Property pp)
 {
     D_PTR(AbstractBaseClient);
     pp.setState(IPS_BUSY);
+    d->batchProperty(pp);
     IUUserIONewSwitch(&d->io, d, pp.getSwitch()->cast());
 }
 
@@ -598,6 +690,34 @@ void AbstractBaseClient::finishBlob()
     IUUserIONewBLOBFinish(&d->io, d);
 }
 
+void AbstractBaseClient::startBatch()
+{
+    D_PTR(AbstractBaseClient);
+    std::lock_guard<std::mutex> lock(d->batchLock);
+    d->batching = true;
+}
+
+std::future<bool> AbstractBaseClient::finishBatch()
+{
+    D_PTR(AbstractBaseClient);
+    std::lock_guard<std::mutex> lock(d->batchLock);
+    AbstractBaseClientPrivate::Batch batch;
+    auto done = batch.done.get_future();
+
+    d->batching = false;
+    batch.properties.swap(d->batchProperties);
+
+    bool sent = d->batchBuffer.empty() || d->sendData(d->batchBuffer.data(), d->batchBuffer.size()) >= 0;
+    d->batchBuffer.clear();
+
+    if (!sent || batch.properties.empty())
+        batch.done.set_value(sent);
+    else
+        d->batches.push_back(std::move(batch));
+
+    return done;
+}
+
 void AbstractBaseClient::sendPingRequest(const char * uuid)
 {
     D_PTR(AbstractBaseClient);
@@ -29,6 +29,7 @@
 #include <memory>
 #include <vector>
 #include <functional>
+#include <future>
 
 namespace INDI
 {
@@ -105,7 +106,9 @@ class AbstractBaseClient : public INDI::BaseMediator
          *
          *  The client calls <getProperties device=deviceName property=propertyName/> so that only a particular
          *  property (or list of properties if more than one) are defined back to the client. This function
-         *  will call watchDevice(deviceName) as well to limit the traffic to this device.
+         *  will call watchDevice(deviceName) as well to limit the traffic to this device. The server only
+         *  routes the watched properties, and device wide messages, to the client.
+         *  If the client is already connected, getProperties is sent right away.
          *
          *  @param propertyName Property to watch for.
          */
@@ -198,6 +201,21 @@ class AbstractBaseClient : public INDI::BaseMediator
         /** @brief Send closing tag for BLOB command to server */
         void finishBlob();
 
+    public:
+        /** @brief Start collecting commands sent to the server instead of writing them one by one.
+         *  Everything sent until finishBatch() is buffered and written at once, so a group of related
+         *  property changes costs a single write and a single routing pass in the server.
+         *  @note The batch belongs to the client, commands sent meanwhile from other threads are buffered too.
+         */
+        void startBatch();
+
+        /** @brief Send the commands collected since startBatch() in one write.
+         *  @return A future that becomes true once every property sent in the batch has been updated
+         *  by its driver with a state other than Busy, or false if any of them reported Alert or the
+         *  client disconnected first.
+         */
+        std::future<bool> finishBatch();
+
     public:
         /** @brief Send one ping request, the server will answer back with the same uuid
          *  @param uid This string will server as identifier for the reply
@@ -27,6 +27,9 @@
 #include "indililxml.h"
 
 #include <atomic>
+#include <future>
+#include <list>
+#include <mutex>
 #include <string>
 #include <map>
 #include <set>
@@ -51,9 +54,25 @@ class AbstractBaseClientPrivate
     public:
         virtual ssize_t sendData(const void *data, size_t size) = 0;
 
+        /** @brief The BLOB modes changed, wantsBlobs is true if the server sends BLOBs of any device or property */
+        virtual void blobModesChanged(bool wantsBlobs)
+        {
+            (void)wantsBlobs;
+        }
+
     public:
         void clear();
 
+    public:
+        /** @brief Send data to the server, or buffer it while a batch is open */
+        ssize_t writeData(const void *data, size_t size);
+
+        /** @brief Remember a property sent while a batch is open */
+        void batchProperty(const INDI::Property &property);
+
+        /** @brief Complete committed batches waiting for the property updated by root */
+        void batchPropertyUpdated(const INDI::LilXmlElement &root);
+
     public:
         /** @brief Dispatch command received from INDI server to respective devices handled by the client */
         int dispatchCommand(const INDI::LilXmlElement &root, char *errmsg);
@@ -70,6 +89,9 @@ class AbstractBaseClientPrivate
     public:
         void userIoGetProperties();
 
+        /** @brief Ask the server for deviceName, or only its propertyName, if already connected */
+        void userIoWatch(const char *deviceName, const char *propertyName);
+
     public:
         /** @brief Connect/Disconnect to INDI driver
             @param status If true, the client will attempt to turn on CONNECTION property within the driver (i.e. turn on the device).
@@ -97,6 +119,19 @@ class AbstractBaseClientPrivate
 
         WatchDeviceProperty watchDevice;
 
+        struct Batch
+        {
+            std::set<std::pair<std::string, std::string>> properties;
+            bool ok {true};
+            std::promise<bool> done;
+        };
+
+        std::mutex batchLock;
+        bool batching {false};
+        std::string batchBuffer;
+        std::set<std::pair<std::string, std::string>> batchProperties;
+        std::list<Batch> batches; // sent, waiting for their properties
+
         static userio io;
 };
 
@@ -0,0 +1,329 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "computebackend.h"
+#include "indidevapi.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#ifdef HAVE_OPENCL
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+
+namespace
+{
+
+// Under this many pixels, the transfers cost more than the CPU loops
+const size_t MIN_PIXELS = 1 << 18;
+
+// Contraction is off so that the gamma index rounds as on the CPU
+const char *kernelSource = R"CLC(
+#pragma OPENCL FP_CONTRACT OFF
+
+__kernel void gamma16(__global const ushort *source, uint width, uint stride, ushort black, float scale,
+                      float lutMax, __global const uint *lookUpTable, __global uchar *destination)
+{
+    uint x = get_global_id(0), y = get_global_id(1);
+    ushort value = source[y * stride + x];
+    float index = (float)(value > black ? value - black : 0) * scale;
+    destination[y * width + x] = (uchar)lookUpTable[(uint)(fmin(index, lutMax) + 0.5f)];
+}
+
+__kernel void binBayer16(__global const ushort *raw, uint rawW, uint rawH, int binX, int binY,
+                         __global ushort *out, uint outW)
+{
+    uint x = get_global_id(0), y = get_global_id(1);
+    uint sum = 0;
+    for (int k = 0; k < binY; k++)
+    {
+        uint rawY = (y & ~1u) * binY + (y & 1u) + 2 * k;
+        if (rawY >= rawH)
+            break;
+        __global const ushort *row = raw + rawY * rawW;
+        for (int l = 0; l < binX; l++)
+        {
+            uint rawX = (x & ~1u) * binX + (x & 1u) + 2 * l;
+            if (rawX < rawW)
+                sum += row[rawX];
+        }
+    }
+    out[y * outW + x] = (ushort)min(sum, 65535u);
+}
+)CLC";
+
+class OpenCLBackend : public INDI::ComputeBackend
+{
+    public:
+        ~OpenCLBackend();
+
+        bool init();
+
+        virtual const char *name() const override
+        {
+            return deviceName.c_str();
+        }
+
+        virtual bool gamma16(const uint16_t *source, size_t width, size_t height, size_t stride,
+                             const uint32_t *lookUpTable, size_t tableSize, uint16_t black, float scale,
+                             uint8_t *destination) override;
+        virtual bool binBayer16(const uint16_t *raw, uint32_t rawW, uint32_t rawH, int binX, int binY,
+                                uint16_t *out) override;
+
+    private:
+        struct Buffer
+        {
+            cl_mem mem {nullptr};
+            size_t size {0};
+        };
+
+        bool check(cl_int error, const char *what);
+        bool reserve(Buffer &buffer, size_t size, cl_mem_flags flags);
+        bool run(cl_kernel kernel, size_t width, size_t height, const void *input, size_t inputSize,
+                 void *output, size_t outputSize);
+
+        std::mutex mutex;
+        std::string deviceName;
+        bool failed {false};
+
+        cl_context context {nullptr};
+        cl_command_queue queue {nullptr};
+        cl_program program {nullptr};
+        cl_kernel gammaKernel {nullptr};
+        cl_kernel binKernel {nullptr};
+
+        Buffer input, output, table;
+        // The gamma curve on the device
+        std::vector<uint32_t> uploadedTable;
+};
+
+OpenCLBackend::~OpenCLBackend()
+{
+    for (auto kernel : { gammaKernel, binKernel })
+        if (kernel)
+            clReleaseKernel(kernel);
+    if (program)
+        clReleaseProgram(program);
+    for (auto buffer : { &input, &output, &table })
+        if (buffer->mem)
+            clReleaseMemObject(buffer->mem);
+    if (queue)
+        clReleaseCommandQueue(queue);
+    if (context)
+        clReleaseContext(context);
+}
+
+bool OpenCLBackend::init()
+{
+    cl_uint count = 0;
+    if (clGetPlatformIDs(0, nullptr, &count) != CL_SUCCESS || count == 0)
+        return false;
+
+    std::vector<cl_platform_id> platforms(count);
+    clGetPlatformIDs(count, platforms.data(), nullptr);
+
+    cl_device_id device = nullptr;
+    for (auto platform : platforms)
+        if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, nullptr) == CL_SUCCESS)
+            break;
+        else
+            device = nullptr;
+    if (device == nullptr)
+        return false;
+
+    char deviceInfo[256] = {0};
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceInfo) - 1, deviceInfo, nullptr);
+    deviceName = deviceInfo;
+
+    cl_int error = CL_SUCCESS;
+    context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &error);
+    if (!check(error, "context"))
+        return false;
+    queue = clCreateCommandQueue(context, device, 0, &error);
+    if (!check(error, "queue"))
+        return false;
+    program = clCreateProgramWithSource(context, 1, &kernelSource, nullptr, &error);
+    if (!check(error, "program"))
+        return false;
+
+    if (clBuildProgram(program, 1, &device, "", nullptr, nullptr) != CL_SUCCESS)
+    {
+        char log[4096] = {0};
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, sizeof(log) - 1, log, nullptr);
+        IDLog("OpenCL kernels failed to build on %s: %s\n", deviceInfo, log);
+        return false;
+    }
+
+    gammaKernel = clCreateKernel(program, "gamma16", &error);
+    if (!check(error, "gamma kernel"))
+        return false;
+    binKernel = clCreateKernel(program, "binBayer16", &error);
+    if (!check(error, "binning kernel"))
+        return false;
+
+    return true;
+}
+
+// Log a device error and fall back to the CPU from then on
+bool OpenCLBackend::check(cl_int error, const char *what)
+{
+    if (error == CL_SUCCESS)
+        return true;
+
+    IDLog("OpenCL %s failed on %s (%d), image kernels run on the CPU.\n", what, deviceName.c_str(), error);
+    if (queue)
+        clFinish(queue);
+    failed = true;
+    return false;
+}
+
+// Device buffers only grow, frames of the same size reuse them
+bool OpenCLBackend::reserve(Buffer &buffer, size_t size, cl_mem_flags flags)
+{
+    if (buffer.size >= size)
+        return true;
+
+    if (buffer.mem)
+        clReleaseMemObject(buffer.mem);
+    buffer.size = 0;
+
+    cl_int error = CL_SUCCESS;
+    buffer.mem = clCreateBuffer(context, flags, size, nullptr, &error);
+    if (!check(error, "buffer"))
+    {
+        buffer.mem = nullptr;
+        return false;
+    }
+    buffer.size = size;
+    return true;
+}
+
+// Upload the input, run the kernel over width x height items and read the output back
+bool OpenCLBackend::run(cl_kernel kernel, size_t width, size_t height, const void *source, size_t inputSize,
+                        void *destination, size_t outputSize)
+{
+    const size_t global[2] = { width, height };
+    return check(clEnqueueWriteBuffer(queue, input.mem, CL_FALSE, 0, inputSize, source, 0, nullptr, nullptr), "upload") &&
+           check(clEnqueueNDRangeKernel(queue, kernel, 2, nullptr, global, nullptr, 0, nullptr, nullptr), "kernel") &&
+           check(clEnqueueReadBuffer(queue, output.mem, CL_TRUE, 0, outputSize, destination, 0, nullptr, nullptr), "download");
+}
+
+bool OpenCLBackend::gamma16(const uint16_t *source, size_t width, size_t height, size_t stride,
+                            const uint32_t *lookUpTable, size_t tableSize, uint16_t black, float scale,
+                            uint8_t *destination)
+{
+    if (width * height < MIN_PIXELS || tableSize == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failed)
+        return false;
+
+    const size_t inputSize  = ((height - 1) * stride + width) * sizeof(uint16_t);
+    const size_t outputSize = width * height;
+    if (!reserve(input, inputSize, CL_MEM_READ_ONLY) || !reserve(output, outputSize, CL_MEM_WRITE_ONLY) ||
+            !reserve(table, tableSize * sizeof(uint32_t), CL_MEM_READ_ONLY))
+        return false;
+
+    if (uploadedTable.size() != tableSize || !std::equal(uploadedTable.begin(), uploadedTable.end(), lookUpTable))
+    {
+        if (!check(clEnqueueWriteBuffer(queue, table.mem, CL_TRUE, 0, tableSize * sizeof(uint32_t), lookUpTable, 0,
+                                        nullptr, nullptr), "upload"))
+            return false;
+        uploadedTable.assign(lookUpTable, lookUpTable + tableSize);
+    }
+
+    cl_uint clWidth = width, clStride = stride;
+    cl_ushort clBlack = black;
+    cl_float clScale = scale, lutMax = tableSize - 1;
+    cl_int error = clSetKernelArg(gammaKernel, 0, sizeof(cl_mem), &input.mem);
+    error |= clSetKernelArg(gammaKernel, 1, sizeof(cl_uint), &clWidth);
+    error |= clSetKernelArg(gammaKernel, 2, sizeof(cl_uint), &clStride);
+    error |= clSetKernelArg(gammaKernel, 3, sizeof(cl_ushort), &clBlack);
+    error |= clSetKernelArg(gammaKernel, 4, sizeof(cl_float), &clScale);
+    error |= clSetKernelArg(gammaKernel, 5, sizeof(cl_float), &lutMax);
+    error |= clSetKernelArg(gammaKernel, 6, sizeof(cl_mem), &table.mem);
+    error |= clSetKernelArg(gammaKernel, 7, sizeof(cl_mem), &output.mem);
+
+    return check(error == CL_SUCCESS ? CL_SUCCESS : CL_INVALID_KERNEL_ARGS, "gamma arguments") &&
+           run(gammaKernel, width, height, source, inputSize, destination, outputSize);
+}
+
+bool OpenCLBackend::binBayer16(const uint16_t *raw, uint32_t rawW, uint32_t rawH, int binX, int binY, uint16_t *out)
+{
+    const uint32_t outW = rawW / binX, outH = rawH / binY;
+    if (static_cast<size_t>(rawW) * rawH < MIN_PIXELS || outW == 0 || outH == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failed)
+        return false;
+
+    const size_t inputSize  = static_cast<size_t>(rawW) * rawH * sizeof(uint16_t);
+    const size_t outputSize = static_cast<size_t>(outW) * outH * sizeof(uint16_t);
+    if (!reserve(input, inputSize, CL_MEM_READ_ONLY) || !reserve(output, outputSize, CL_MEM_WRITE_ONLY))
+        return false;
+
+    cl_uint clRawW = rawW, clRawH = rawH, clOutW = outW;
+    cl_int clBinX = binX, clBinY = binY;
+    cl_int error = clSetKernelArg(binKernel, 0, sizeof(cl_mem), &input.mem);
+    error |= clSetKernelArg(binKernel, 1, sizeof(cl_uint), &clRawW);
+    error |= clSetKernelArg(binKernel, 2, sizeof(cl_uint), &clRawH);
+    error |= clSetKernelArg(binKernel, 3, sizeof(cl_int), &clBinX);
+    error |= clSetKernelArg(binKernel, 4, sizeof(cl_int), &clBinY);
+    error |= clSetKernelArg(binKernel, 5, sizeof(cl_mem), &output.mem);
+    error |= clSetKernelArg(binKernel, 6, sizeof(cl_uint), &clOutW);
+
+    return check(error == CL_SUCCESS ? CL_SUCCESS : CL_INVALID_KERNEL_ARGS, "binning arguments") &&
+           run(binKernel, outW, outH, raw, inputSize, out, outputSize);
+}
+
+}
+#endif
+
+namespace INDI
+{
+
+ComputeBackend *ComputeBackend::instance()
+{
+    static const std::unique_ptr<ComputeBackend> backend = []() -> std::unique_ptr<ComputeBackend>
+    {
+        const char *choice = getenv("INDI_COMPUTE");
+        if (choice != nullptr && strcmp(choice, "cpu") == 0)
+            return nullptr;
+
+#ifdef HAVE_OPENCL
+        std::unique_ptr<OpenCLBackend> opencl(new OpenCLBackend());
+        if (opencl->init())
+        {
+            IDLog("Image kernels run on %s.\n", opencl->name());
+            return opencl;
+        }
+#endif
+        return nullptr;
+    }();
+    return backend.get();
+}
+
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace INDI
+{
+
+/**
+ * \class ComputeBackend
+ * \brief Image kernels of the stream and binning pipelines offloaded to a GPU.
+ *
+ * The backend is chosen once per process. With INDI built with INDI_BUILD_OPENCL, the first OpenCL GPU
+ * found is used, unless the INDI_COMPUTE environment variable is set to "cpu".
+ *
+ * Every kernel gives the same result as the CPU loop it replaces. A kernel returns false when it did not
+ * run, for frames too small to be worth the transfer or after a device error, and the caller then runs its
+ * CPU loop.
+ */
+class ComputeBackend
+{
+    public:
+        virtual ~ComputeBackend() = default;
+
+        /** @return The backend of this process, nullptr when image kernels run on the CPU. */
+        static ComputeBackend *instance();
+
+        /** @return The name of the device the kernels run on. */
+        virtual const char *name() const = 0;
+
+        /**
+         * @brief Downscale 16 bit samples to 8 bit as GammaLut16 does.
+         * @param source first sample of the frame.
+         * @param width samples per row.
+         * @param height number of rows.
+         * @param stride samples from one row to the next in source.
+         * @param lookUpTable gamma curve, indexed by the stretched sample.
+         * @param tableSize number of entries of the curve.
+         * @param black samples at or under black map to the first entry.
+         * @param scale entries per sample above black.
+         * @param destination width * height samples, rows packed.
+         */
+        virtual bool gamma16(const uint16_t *source, size_t width, size_t height, size_t stride,
+                             const uint32_t *lookUpTable, size_t tableSize, uint16_t black, float scale,
+                             uint8_t *destination) = 0;
+
+        /**
+         * @brief Bin a 16 bit Bayer frame keeping its 2x2 matrix, as CCDChip::binBayerFrame does.
+         * @param raw rawW * rawH pixels.
+         * @param out (rawW / binX) * (rawH / binY) pixels, sums saturated to 16 bits.
+         */
+        virtual bool binBayer16(const uint16_t *raw, uint32_t rawW, uint32_t rawH, int binX, int binY,
+                                uint16_t *out) = 0;
+};
+
+}
@@ -192,6 +192,8 @@ bool Serial::Connect()
     // Important, disconnect from port immediately
     // to release the lock, otherwise another driver will find it busy.
     tty_disconnect(PortFD);
+    PortFD = -1;
+    m_Broker.close();
 
     // Start auto-search if option was selected and IF we have system ports to try connecting to
     if (AutoSearchS[0].s == ISS_ON && SystemPortS != nullptr && SystemPortSP.nsp > 1)
@@ -262,6 +264,8 @@ bool Serial::Connect()
             }
 
             tty_disconnect(PortFD);
+            PortFD = -1;
+            m_Broker.close();
             // sleep randomly anytime between 0.5s and ~1.5s
             // This enables different competing devices to connect
             std::this_thread::sleep_for(std::chrono::milliseconds(500 + (rand() % 1000)));
@@ -300,6 +304,18 @@ bool Serial::Connect(const char *port, uint32_t baud)
 
     LOGF_DEBUG("Connecting to %s @ %d", port, baud);
 
+    if (m_Shared)
+    {
+        if ((connectrc = m_Broker.open(port, baud, wordSize, parity, stopBits)) != TTY_OK)
+        {
+            tty_error_msg(connectrc, errorMsg, MAXRBUF);
+            LOGF_ERROR("Failed to share port (%s). Error: %s", port, errorMsg);
+            return false;
+        }
+        LOGF_DEBUG("Port %s is shared", port);
+        return true;
+    }
+
     if ((connectrc = tty_connect(port, baud, wordSize, parity, stopBits, &PortFD)) != TTY_OK)
     {
         if (connectrc == TTY_PORT_BUSY)
@@ -325,9 +341,18 @@ bool Serial::Disconnect()
         tty_disconnect(PortFD);
         PortFD = -1;
     }
+    m_Broker.close();
     return true;
 }
 
+int Serial::transact(const std::string &command, std::string &reply, int terminator, size_t replyLength, int timeout,
+                     PortBroker::Priority priority)
+{
+    if (m_Shared)
+        return m_Broker.transact(command, reply, terminator, replyLength, timeout, priority);
+    return PortBroker::exchange(PortFD, command, reply, terminator, replyLength, timeout);
+}
+
 void Serial::Activated()
 {
     if (m_Permission != IP_RO)
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "connectioninterface.h"
+#include "portbroker.h"
 
 #include <string>
 #include <vector>
@@ -103,6 +104,27 @@ class Serial : public Interface
             return PortFD;
         }
 
+        /**
+         * @brief setShared Share the port with the other drivers of a multi-function device, through a
+         * Connection::PortBroker. Call it in initProperties() of a driver talking to the device with
+         * transact() only: a shared port has no PortFD.
+         */
+        void setShared(bool shared)
+        {
+            m_Shared = shared;
+        }
+        bool isShared() const
+        {
+            return m_Shared;
+        }
+
+        /**
+         * @brief transact Write a command and read its reply, on the shared port or on PortFD.
+         * @see PortBroker::transact
+         */
+        int transact(const std::string &command, std::string &reply, int terminator = '#', size_t replyLength = 0,
+                     int timeout = 3000, PortBroker::Priority priority = PortBroker::PRIORITY_NORMAL);
+
         virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
         virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
         virtual bool saveConfigItems(FILE *fp) override;
@@ -187,6 +209,9 @@ class Serial : public Interface
 
         int PortFD = -1;
 
+        bool m_Shared {false};
+        PortBroker m_Broker;
+
         // Default 8N1 parameters
         uint8_t wordSize = 8;
         uint8_t parity = 0;
@@ -0,0 +1,497 @@
+/*******************************************************************************
+ Serial port shared by several drivers.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "portbroker.h"
+
+#include "indicom.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Longest command or reply of a transaction
+#define PORT_BROKER_MAX_MESSAGE 65536
+// Attempts to connect to a broker that is starting
+#define PORT_BROKER_CONNECT_RETRIES 20
+
+namespace Connection
+{
+
+namespace
+{
+
+// Transactions on the broker socket, in host order as both ends are on the same machine
+struct RequestHeader
+{
+    uint32_t length;
+    uint32_t replyLength;
+    int32_t timeout;
+    int32_t terminator;
+    uint32_t priority;
+};
+
+struct ReplyHeader
+{
+    int32_t rc;
+    uint32_t length;
+};
+
+// In the abstract namespace on Linux, so that no socket file outlives its broker
+socklen_t address(const std::string &port, sockaddr_un &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::string name = "indi-port-" + port;
+    std::replace(name.begin(), name.end(), '/', '_');
+#ifdef __linux__
+    size_t length = std::min(name.size(), sizeof(addr.sun_path) - 1);
+    memcpy(addr.sun_path + 1, name.data(), length);
+    return offsetof(sockaddr_un, sun_path) + 1 + length;
+#else
+    name = "/tmp/" + name;
+    strncpy(addr.sun_path, name.c_str(), sizeof(addr.sun_path) - 1);
+    return sizeof(addr);
+#endif
+}
+
+bool sendAll(int fd, const void *data, size_t size)
+{
+    const char *p = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool receiveAll(int fd, void *data, size_t size)
+{
+    char *p = static_cast<char *>(data);
+    while (size > 0)
+    {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// The listening socket of a new broker, -1 with errno set if the port has one already
+int listenOn(const std::string &port)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    sockaddr_un addr;
+    socklen_t length = address(port, addr);
+#ifndef __linux__
+    // A socket file nobody listens on is left over by a broker that died
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr *>(&addr), length) < 0 && errno == ECONNREFUSED)
+        unlink(addr.sun_path);
+    if (probe >= 0)
+        ::close(probe);
+#endif
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), length) < 0 || listen(fd, 16) < 0)
+    {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+class Server
+{
+    public:
+        Server(const std::string &port, int listener, int device) : m_Port(port), m_Listener(listener), m_Device(device) {}
+
+        void run()
+        {
+            bool served = false;
+            while (!served || !m_Clients.empty())
+            {
+                std::vector<pollfd> fds;
+                fds.push_back({m_Listener, POLLIN, 0});
+                for (auto &client : m_Clients)
+                    fds.push_back({client.fd, POLLIN, 0});
+
+                // Without waiting when a transaction is due, but only after the requests that came meanwhile
+                if (poll(fds.data(), fds.size(), m_Queue.empty() ? -1 : 0) < 0 && errno != EINTR)
+                    break;
+
+                if (fds[0].revents & POLLIN)
+                {
+                    int fd = accept(m_Listener, nullptr, nullptr);
+                    if (fd >= 0)
+                    {
+                        m_Clients.push_back({fd, m_NextClient++, std::string()});
+                        served = true;
+                    }
+                }
+
+                for (size_t i = 1; i < fds.size(); i++)
+                    if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                        receive(fds[i].fd);
+                m_Clients.erase(std::remove_if(m_Clients.begin(), m_Clients.end(), [](const Client & client)
+                {
+                    return client.fd < 0;
+                }), m_Clients.end());
+
+                if (!m_Queue.empty())
+                    runNext();
+            }
+
+            tty_disconnect(m_Device);
+            ::close(m_Listener);
+#ifndef __linux__
+            sockaddr_un addr;
+            address(m_Port, addr);
+            unlink(addr.sun_path);
+#endif
+        }
+
+    private:
+        struct Client
+        {
+            int fd;
+            uint64_t id;
+            std::string input;
+        };
+
+        struct Transaction
+        {
+            uint64_t client;
+            uint64_t sequence;
+            uint32_t priority;
+            RequestHeader header;
+            std::string command;
+        };
+
+        void receive(int fd)
+        {
+            auto client = std::find_if(m_Clients.begin(), m_Clients.end(), [fd](const Client & one)
+            {
+                return one.fd == fd;
+            });
+
+            char buffer[4096];
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && (errno == EINTR || errno == EAGAIN))
+                return;
+            if (n <= 0)
+            {
+                drop(*client);
+                return;
+            }
+            client->input.append(buffer, n);
+
+            while (client->input.size() >= sizeof(RequestHeader))
+            {
+                RequestHeader header;
+                memcpy(&header, client->input.data(), sizeof(header));
+                if (header.length > PORT_BROKER_MAX_MESSAGE || header.replyLength > PORT_BROKER_MAX_MESSAGE)
+                {
+                    drop(*client);
+                    return;
+                }
+                if (client->input.size() < sizeof(header) + header.length)
+                    break;
+
+                m_Queue.push_back({client->id, m_NextSequence++, header.priority, header,
+                                   client->input.substr(sizeof(header), header.length)});
+                client->input.erase(0, sizeof(header) + header.length);
+            }
+        }
+
+        void drop(Client &client)
+        {
+            ::close(client.fd);
+            client.fd = -1;
+            m_Queue.erase(std::remove_if(m_Queue.begin(), m_Queue.end(), [&client](const Transaction & transaction)
+            {
+                return transaction.client == client.id;
+            }), m_Queue.end());
+        }
+
+        void runNext()
+        {
+            auto next = std::min_element(m_Queue.begin(), m_Queue.end(), [](const Transaction & a, const Transaction & b)
+            {
+                return a.priority != b.priority ? a.priority > b.priority : a.sequence < b.sequence;
+            });
+            Transaction transaction = std::move(*next);
+            m_Queue.erase(next);
+
+            std::string reply;
+            ReplyHeader header;
+            header.rc = PortBroker::exchange(m_Device, transaction.command, reply, transaction.header.terminator,
+                                             transaction.header.replyLength, transaction.header.timeout);
+            header.length = reply.size();
+
+            // The driver may have left while its transaction ran
+            auto client = std::find_if(m_Clients.begin(), m_Clients.end(), [&transaction](const Client & one)
+            {
+                return one.id == transaction.client && one.fd >= 0;
+            });
+            if (client != m_Clients.end() && (!sendAll(client->fd, &header, sizeof(header)) ||
+                                              !sendAll(client->fd, reply.data(), reply.size())))
+                drop(*client);
+        }
+
+        std::string m_Port;
+        int m_Listener;
+        int m_Device;
+        std::vector<Client> m_Clients;
+        std::vector<Transaction> m_Queue;
+        uint64_t m_NextClient {0};
+        uint64_t m_NextSequence {0};
+};
+
+void serve(const std::string &port, int listener, int device)
+{
+    std::thread([port, listener, device]()
+    {
+        Server(port, listener, device).run();
+    }).detach();
+}
+
+}
+
+PortBroker::~PortBroker()
+{
+    close();
+}
+
+int PortBroker::open(const std::string &port, uint32_t baud, uint8_t wordSize, uint8_t parity, uint8_t stopBits)
+{
+    std::lock_guard<std::mutex> guard(m_Lock);
+    if (m_Socket >= 0)
+    {
+        ::close(m_Socket);
+        m_Socket = -1;
+    }
+    m_Port = port;
+    m_Baud = baud;
+    m_WordSize = wordSize;
+    m_Parity = parity;
+    m_StopBits = stopBits;
+    return connect();
+}
+
+void PortBroker::close()
+{
+    std::lock_guard<std::mutex> guard(m_Lock);
+    if (m_Socket >= 0)
+        ::close(m_Socket);
+    m_Socket = -1;
+    m_Port.clear();
+}
+
+int PortBroker::connect()
+{
+    sockaddr_un addr;
+    socklen_t length = address(m_Port, addr);
+
+    for (int attempt = 0; attempt < PORT_BROKER_CONNECT_RETRIES; attempt++)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return TTY_ERRNO;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), length) == 0)
+        {
+            m_Socket = fd;
+            return TTY_OK;
+        }
+        ::close(fd);
+
+        // No broker yet: this driver becomes the broker, unless another one is starting
+        int listener = listenOn(m_Port);
+        if (listener >= 0)
+        {
+            int device = -1;
+            int rc = tty_connect(m_Port.c_str(), m_Baud, m_WordSize, m_Parity, m_StopBits, &device);
+            if (rc != TTY_OK)
+            {
+                ::close(listener);
+                return rc;
+            }
+            serve(m_Port, listener, device);
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return TTY_PORT_FAILURE;
+}
+
+int PortBroker::transact(const std::string &command, std::string &reply, int terminator, size_t replyLength, int timeout,
+                         Priority priority)
+{
+    std::lock_guard<std::mutex> guard(m_Lock);
+    reply.clear();
+    if (command.size() > PORT_BROKER_MAX_MESSAGE || replyLength > PORT_BROKER_MAX_MESSAGE)
+        return TTY_OVERFLOW;
+
+    // The broker sends nothing between transactions: anything to read is the end of a broker that exited
+    if (m_Socket >= 0)
+    {
+        pollfd fd = {m_Socket, POLLIN, 0};
+        if (poll(&fd, 1, 0) > 0)
+        {
+            ::close(m_Socket);
+            m_Socket = -1;
+        }
+    }
+    if (m_Socket < 0)
+    {
+        if (m_Port.empty())
+            return TTY_ERRNO;
+        int rc = connect();
+        if (rc != TTY_OK)
+            return rc;
+    }
+
+    RequestHeader request;
+    request.length = command.size();
+    request.replyLength = replyLength;
+    request.timeout = timeout;
+    request.terminator = terminator;
+    request.priority = priority;
+
+    ReplyHeader header;
+    if (!sendAll(m_Socket, &request, sizeof(request)) || !sendAll(m_Socket, command.data(), command.size()) ||
+            !receiveAll(m_Socket, &header, sizeof(header)) || header.length > PORT_BROKER_MAX_MESSAGE)
+    {
+        ::close(m_Socket);
+        m_Socket = -1;
+        return TTY_READ_ERROR;
+    }
+
+    reply.resize(header.length);
+    if (!receiveAll(m_Socket, &reply[0], header.length))
+    {
+        ::close(m_Socket);
+        m_Socket = -1;
+        reply.clear();
+        return TTY_READ_ERROR;
+    }
+    return header.rc;
+}
+
+bool PortBroker::share(const std::string &port, int fd)
+{
+    int listener = listenOn(port);
+    if (listener < 0)
+        return false;
+    serve(port, listener, fd);
+    return true;
+}
+
+int PortBroker::exchange(int fd, const std::string &command, std::string &reply, int terminator, size_t replyLength,
+                         int timeout)
+{
+    reply.clear();
+
+    // Replies to earlier transactions that timed out, or the rest of longer replies
+    tcflush(fd, TCIFLUSH);
+    pollfd stale = {fd, POLLIN, 0};
+    char discarded[256];
+    while (poll(&stale, 1, 0) > 0 && (stale.revents & POLLIN) && read(fd, discarded, sizeof(discarded)) > 0)
+        ;
+
+    size_t written = 0;
+    while (written < command.size())
+    {
+        ssize_t n = write(fd, command.data() + written, command.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return TTY_WRITE_ERROR;
+        written += n;
+    }
+
+    if (terminator < 0 && replyLength == 0)
+        return TTY_OK;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while (true)
+    {
+        int remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        pollfd readable = {fd, POLLIN, 0};
+        int ready = poll(&readable, 1, std::max(0, remaining));
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready < 0)
+            return TTY_SELECT_ERROR;
+        if (ready == 0)
+            return TTY_TIME_OUT;
+
+        char buffer[256];
+        size_t wanted = replyLength > 0 ? std::min(sizeof(buffer), replyLength - reply.size()) : sizeof(buffer);
+        ssize_t n = read(fd, buffer, wanted);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return TTY_READ_ERROR;
+
+        if (replyLength > 0)
+        {
+            reply.append(buffer, n);
+            if (reply.size() >= replyLength)
+                return TTY_OK;
+        }
+        else
+        {
+            const char *end = static_cast<const char *>(memchr(buffer, terminator, n));
+            reply.append(buffer, end ? end - buffer + 1 : n);
+            if (end)
+                return TTY_OK;
+        }
+
+        if (reply.size() > PORT_BROKER_MAX_MESSAGE)
+            return TTY_OVERFLOW;
+    }
+}
+
+}
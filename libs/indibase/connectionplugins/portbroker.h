@@ -0,0 +1,109 @@
+/*******************************************************************************
+ Serial port shared by several drivers.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace Connection
+{
+/**
+ * @brief The PortBroker class shares a serial port between the drivers of a multi-function device, such as
+ * a power box with a focuser, or a mount with a focuser on the same line.
+ *
+ * The first driver to open the port becomes its broker: a thread of that driver owns the port and serves
+ * a local socket named after it. Every driver, the broker's included, connects to that socket and sends
+ * whole transactions, a command and the reply it expects. The broker runs them on the port one at a time,
+ * higher priorities first and in order of arrival within a priority, and sends each reply back to the
+ * driver that asked for it. The port stays open for as long as one driver uses it, and when the driver
+ * owning the port exits, the next transaction of another driver makes it the broker.
+ *
+ * \code{cpp}
+ * bool MyFocuser::Handshake()
+ * {
+ *     std::string reply;
+ *     return serialConnection->transact("P#", reply, '\n') == TTY_OK;
+ * }
+ * \endcode
+ */
+class PortBroker
+{
+    public:
+        typedef enum { PRIORITY_LOW, PRIORITY_NORMAL, PRIORITY_HIGH } Priority;
+
+        PortBroker() = default;
+        ~PortBroker();
+
+        PortBroker(const PortBroker &) = delete;
+        PortBroker &operator=(const PortBroker &) = delete;
+
+        /**
+         * @brief open Connect to the broker of a port, becoming its broker if there is none.
+         * @return TTY_OK, or the TTY error opening the port failed with.
+         */
+        int open(const std::string &port, uint32_t baud, uint8_t wordSize = 8, uint8_t parity = 0, uint8_t stopBits = 1);
+
+        /** @brief close Leave the port, which is closed when the last driver leaves. */
+        void close();
+
+        bool isOpen() const
+        {
+            return m_Socket >= 0;
+        }
+
+        /**
+         * @brief transact Run a command on the port and wait for its reply.
+         * @param command Bytes to write to the device.
+         * @param reply Set to the reply, including its terminator.
+         * @param terminator Last character of the reply, or -1 if it is replyLength bytes or there is none.
+         * @param replyLength Bytes of a fixed length reply, 0 for a reply ended by the terminator.
+         * @param timeout Milliseconds to wait for the full reply after the command was written.
+         * @param priority Transactions of higher priorities, waiting for the port, run first.
+         * @return TTY_OK, or the TTY error of the transaction, e.g. TTY_TIME_OUT with the partial reply.
+         */
+        int transact(const std::string &command, std::string &reply, int terminator = '#', size_t replyLength = 0,
+                     int timeout = 3000, Priority priority = PRIORITY_NORMAL);
+
+        /**
+         * @brief share Serve an open device as the named port, for drivers that opened it some other way,
+         * or for tests. The broker closes fd when the last driver leaves.
+         * @return False if the port already has a broker.
+         */
+        static bool share(const std::string &port, int fd);
+
+        /**
+         * @brief exchange What the broker does for a transaction, on a device it owns: write the command,
+         * then read the reply. Drivers not sharing their port may call it on their own descriptor.
+         */
+        static int exchange(int fd, const std::string &command, std::string &reply, int terminator, size_t replyLength,
+                            int timeout);
+
+    private:
+        int connect();
+
+        std::mutex m_Lock;
+        std::string m_Port;
+        uint32_t m_Baud {9600};
+        uint8_t m_WordSize {8};
+        uint8_t m_Parity {0};
+        uint8_t m_StopBits {1};
+        int m_Socket {-1};
+};
+}
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ Request queue over a connection file descriptor.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "requestqueue.h"
+
+#include "eventloop.h"
+#include "indicom.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+// Longest reply collected before the request fails with TTY_OVERFLOW
+#define REQUEST_QUEUE_MAX_REPLY 4096
+
+namespace Connection
+{
+
+RequestQueue::~RequestQueue()
+{
+    // The owner is going away, do not call back into it
+    if (m_TimerID >= 0)
+        rmTimer(m_TimerID);
+    if (m_CallbackID >= 0)
+        rmCallback(m_CallbackID);
+}
+
+void RequestQueue::attach(int fd)
+{
+    if (m_FD >= 0)
+        detach();
+
+    m_FD = fd;
+    m_CallbackID = addCallback(fd, readableCallback, this);
+    sendNext();
+}
+
+void RequestQueue::detach()
+{
+    drop(TTY_ERRNO);
+}
+
+void RequestQueue::drop(int rc)
+{
+    if (m_TimerID >= 0)
+        rmTimer(m_TimerID);
+    if (m_CallbackID >= 0)
+        rmCallback(m_CallbackID);
+    m_TimerID = m_CallbackID = m_FD = -1;
+    m_InFlight = false;
+    m_Reply.clear();
+
+    // Requests queued by the callbacks below wait for the next attach
+    std::deque<Request> requests;
+    requests.swap(m_Requests);
+    for (auto &request : requests)
+        if (request.callback)
+            request.callback(rc, std::string());
+}
+
+void RequestQueue::send(const std::string &command, Callback callback, char terminator, int timeout)
+{
+    m_Requests.push_back({command, std::move(callback), terminator, timeout});
+    sendNext();
+}
+
+void RequestQueue::sendNext()
+{
+    while (!m_InFlight && m_FD >= 0 && !m_Requests.empty())
+    {
+        const Request &request = m_Requests.front();
+        int nbytes = 0;
+        int rc = tty_write(m_FD, request.command.data(), static_cast<int>(request.command.size()), &nbytes);
+        if (rc != TTY_OK || request.terminator == 0)
+        {
+            complete(rc);
+            continue;
+        }
+
+        m_InFlight = true;
+        m_Reply.clear();
+        m_TimerID = addTimer(request.timeout, timeoutCallback, this);
+    }
+}
+
+void RequestQueue::complete(int rc)
+{
+    if (m_TimerID >= 0)
+    {
+        rmTimer(m_TimerID);
+        m_TimerID = -1;
+    }
+    m_InFlight = false;
+
+    Request request = std::move(m_Requests.front());
+    m_Requests.pop_front();
+    std::string reply;
+    reply.swap(m_Reply);
+
+    if (request.callback)
+        request.callback(rc, reply);
+}
+
+void RequestQueue::onReadable()
+{
+    char buffer[256];
+    ssize_t n = read(m_FD, buffer, sizeof(buffer));
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (n <= 0)
+    {
+        // Closed or broken, the descriptor would stay readable forever
+        drop(TTY_READ_ERROR);
+        return;
+    }
+
+    // Nothing asked for it, a late reply of a request that timed out
+    if (!m_InFlight)
+        return;
+
+    char terminator = m_Requests.front().terminator;
+    for (ssize_t i = 0; i < n; i++)
+    {
+        m_Reply += buffer[i];
+        if (buffer[i] == terminator)
+        {
+            // Whatever follows was not asked for by the next request, which is not even written yet
+            complete(TTY_OK);
+            sendNext();
+            return;
+        }
+    }
+
+    if (m_Reply.size() > REQUEST_QUEUE_MAX_REPLY)
+    {
+        complete(TTY_OVERFLOW);
+        sendNext();
+    }
+}
+
+void RequestQueue::onTimeout()
+{
+    // The one shot timer is gone once it fired
+    m_TimerID = -1;
+    complete(TTY_TIME_OUT);
+    sendNext();
+}
+
+void RequestQueue::readableCallback(int fd, void *userpointer)
+{
+    (void)fd;
+    static_cast<RequestQueue *>(userpointer)->onReadable();
+}
+
+void RequestQueue::timeoutCallback(void *userpointer)
+{
+    static_cast<RequestQueue *>(userpointer)->onTimeout();
+}
+
+}
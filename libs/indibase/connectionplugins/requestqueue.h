@@ -0,0 +1,131 @@
+/*******************************************************************************
+ Request queue over a connection file descriptor.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+
+namespace Connection
+{
+/**
+ * @brief The RequestQueue class sends commands to a device without blocking the driver event loop.
+ *
+ * Commands are queued and written one at a time to the file descriptor of a Connection::Serial or
+ * Connection::TCP plugin. The reply is collected from the event loop as it arrives, up to and including
+ * the terminator of the request, and handed to the request callback. A request the device does not answer
+ * within its timeout completes with TTY_TIME_OUT and the next one is sent, so the driver keeps serving
+ * its clients while a device is slow or gone.
+ *
+ * The queue must not be mixed with blocking tty_read/tty_write calls on the same descriptor while
+ * requests are pending.
+ *
+ * \code{cpp}
+ * bool MyMount::Handshake()
+ * {
+ *     m_Requests.attach(PortFD);
+ *     return true;
+ * }
+ *
+ * m_Requests.send(":GR#", [this](int rc, const std::string &reply)
+ * {
+ *     if (rc == TTY_OK)
+ *         ...
+ * });
+ * \endcode
+ */
+class RequestQueue
+{
+    public:
+        /**
+         * @brief Callback called when a request completes.
+         * @param rc TTY_OK, or the TTY error the request failed with, e.g. TTY_TIME_OUT.
+         * @param reply The reply including its terminator, empty for requests that expect no reply.
+         */
+        using Callback = std::function<void(int rc, const std::string &reply)>;
+
+        RequestQueue() = default;
+        ~RequestQueue();
+
+        RequestQueue(const RequestQueue &) = delete;
+        RequestQueue &operator=(const RequestQueue &) = delete;
+
+        /**
+         * @brief attach Start sending the queued requests to a connected file descriptor.
+         * @param fd File descriptor returned by the connection plugin.
+         */
+        void attach(int fd);
+
+        /**
+         * @brief detach Stop watching the file descriptor, the pending requests complete with TTY_ERRNO.
+         * Call it before the connection is closed.
+         */
+        void detach();
+
+        /**
+         * @brief send Queue a command.
+         * @param command Bytes to write to the device.
+         * @param callback Called with the reply, may be empty.
+         * @param terminator Last character of the reply, or 0 if the command expects no reply.
+         * @param timeout Milliseconds to wait for the full reply after the command was written.
+         */
+        void send(const std::string &command, Callback callback, char terminator = '#', int timeout = 3000);
+
+        /**
+         * @return Requests queued or in flight.
+         */
+        size_t pending() const
+        {
+            return m_Requests.size();
+        }
+
+        /**
+         * @return True if the requests are sent to a file descriptor.
+         */
+        bool isAttached() const
+        {
+            return m_FD >= 0;
+        }
+
+    private:
+        struct Request
+        {
+            std::string command;
+            Callback callback;
+            char terminator;
+            int timeout;
+        };
+
+        void sendNext();
+        void complete(int rc);
+        void drop(int rc);
+        void onReadable();
+        void onTimeout();
+
+        static void readableCallback(int fd, void *userpointer);
+        static void timeoutCallback(void *userpointer);
+
+        std::deque<Request> m_Requests;
+        std::string m_Reply;
+        int m_FD { -1 };
+        int m_CallbackID { -1 };
+        int m_TimerID { -1 };
+        bool m_InFlight { false };
+};
+}
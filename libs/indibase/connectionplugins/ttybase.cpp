@@ -27,6 +27,7 @@
 #endif
 
 #include "ttybase.h"
+#include "indicom.h"
 
 #include "locale_compat.h"
 
@@ -130,6 +131,9 @@ TTYBase::TTY_RESPONSE TTYBase::write(const uint8_t *buffer, uint32_t nbytes, uin
     int bytes_w     = 0;
     *nbytes_written = 0;
 
+    if (m_ReadAhead)
+        tty_discard_read_ahead(m_PortFD);
+
     while (nbytes > 0)
     {
         bytes_w = ::write(m_PortFD, buffer + (*nbytes_written), nbytes);
@@ -175,6 +179,15 @@ TTYBase::TTY_RESPONSE TTYBase::read(uint8_t *buffer, uint32_t nbytes, uint8_t ti
     DEBUGFDEVICE(m_DriverName, m_DebugChannel, "%s: Request to read %d bytes with %d timeout for m_PortFD %d", __FUNCTION__,
                  nbytes, timeout, m_PortFD);
 
+    if (m_ReadAhead)
+    {
+        int bytesAhead = 0;
+        tty_set_read_ahead(m_PortFD, 1);
+        auto rc = static_cast<TTY_RESPONSE>(tty_read(m_PortFD, reinterpret_cast<char *>(buffer), nbytes, timeout, &bytesAhead));
+        *nbytes_read = bytesAhead;
+        return rc;
+    }
+
     while (numBytesToRead > 0)
     {
         if ((timeoutResponse = checkTimeout(timeout)))
@@ -219,6 +232,17 @@ TTYBase::TTY_RESPONSE TTYBase::readSection(uint8_t *buffer, uint32_t nsize, uint
     DEBUGFDEVICE(m_DriverName, m_DebugChannel, "%s: Request to read until stop char '%#02X' with %d timeout for m_PortFD %d",
                  __FUNCTION__, stop_byte, timeout, m_PortFD);
 
+    if (m_ReadAhead)
+    {
+        int bytesAhead = 0;
+        tty_set_read_ahead(m_PortFD, 1);
+        auto rc = static_cast<TTY_RESPONSE>(tty_nread_section(m_PortFD, reinterpret_cast<char *>(buffer), nsize, stop_byte,
+                                            timeout, &bytesAhead));
+        *nbytes_read = bytesAhead;
+        DEBUGFDEVICE(m_DriverName, m_DebugChannel, "%s: %d bytes read ahead", __FUNCTION__, bytesAhead);
+        return rc;
+    }
+
     for (;;)
     {
         if ((timeoutResponse = checkTimeout(timeout)))
@@ -685,6 +709,13 @@ TTYBase::TTY_RESPONSE TTYBase::connect(const char *device, uint32_t bit_rate, ui
 
 #endif
 
+void TTYBase::setReadAhead(bool enabled)
+{
+    m_ReadAhead = enabled;
+    if (!enabled && m_PortFD != -1)
+        tty_set_read_ahead(m_PortFD, 0);
+}
+
 TTYBase::TTY_RESPONSE TTYBase::disconnect()
 {
     if (m_PortFD == -1)
@@ -694,6 +725,7 @@ TTYBase::TTY_RESPONSE TTYBase::disconnect()
     return TTY_ERRNO;
 #else
     tcflush(m_PortFD, TCIOFLUSH);
+    tty_set_read_ahead(m_PortFD, 0);
     int err = close(m_PortFD);
 
     if (err != 0)
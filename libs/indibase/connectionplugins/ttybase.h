@@ -121,6 +121,12 @@ class TTYBase
          */
         void setDebug(INDI::Logger::VerbosityLevel channel);
 
+        /**
+         * @brief setReadAhead Read sections in blocks through the read ahead buffer of the port, see tty_set_read_ahead().
+         * @param enabled If true, the bytes read past a stop byte are kept for the next read, until the next write.
+         */
+        void setReadAhead(bool enabled);
+
         /** \brief Retrieve the tty error message
             \param err_code the error code return by any TTY function.
             \return Error message string
@@ -138,6 +144,7 @@ class TTYBase
 
         int m_PortFD { -1 };
         bool m_Debug { false };
+        bool m_ReadAhead { false };
         INDI::Logger::VerbosityLevel m_DebugChannel { INDI::Logger::DBG_IGNORE };
         const char *m_DriverName;
 };
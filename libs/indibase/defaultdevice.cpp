@@ -30,10 +30,19 @@
 #include "indipropertynumber.h"
 #include "indipropertyblob.h"
 
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
 #include <assert.h>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
 
 const char *COMMUNICATION_TAB = "Communication";
 const char *MAIN_CONTROL_TAB  = "Main Control";
@@ -67,7 +76,11 @@ extern "C"
         const std::unique_lock<std::recursive_mutex> lock(INDI::DefaultDevicePrivate::devicesLock);
         for(auto &it : INDI::DefaultDevicePrivate::devices)
             if (dev == nullptr || strcmp(dev, it->defaultDevice->getDeviceName()) == 0)
+            {
+                it->wakeUp();
+                INDI::HandlerProfile::Scope scope(it->profiler(), "ISNewSwitch", name);
                 it->defaultDevice->ISNewSwitch(dev, name, states, names, n);
+            }
     }
 
     void ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
@@ -75,7 +88,11 @@ extern "C"
         const std::unique_lock<std::recursive_mutex> lock(INDI::DefaultDevicePrivate::devicesLock);
         for(auto &it : INDI::DefaultDevicePrivate::devices)
             if (dev == nullptr || strcmp(dev, it->defaultDevice->getDeviceName()) == 0)
+            {
+                it->wakeUp();
+                INDI::HandlerProfile::Scope scope(it->profiler(), "ISNewNumber", name);
                 it->defaultDevice->ISNewNumber(dev, name, values, names, n);
+            }
     }
 
     void ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
@@ -83,7 +100,11 @@ extern "C"
         const std::unique_lock<std::recursive_mutex> lock(INDI::DefaultDevicePrivate::devicesLock);
         for(auto &it : INDI::DefaultDevicePrivate::devices)
             if (dev == nullptr || strcmp(dev, it->defaultDevice->getDeviceName()) == 0)
+            {
+                it->wakeUp();
+                INDI::HandlerProfile::Scope scope(it->profiler(), "ISNewText", name);
                 it->defaultDevice->ISNewText(dev, name, texts, names, n);
+            }
     }
 
     void ISNewBLOB(const char *dev, const char *name,
@@ -93,14 +114,25 @@ extern "C"
         const std::unique_lock<std::recursive_mutex> lock(INDI::DefaultDevicePrivate::devicesLock);
         for(auto &it : INDI::DefaultDevicePrivate::devices)
             if (dev == nullptr || strcmp(dev, it->defaultDevice->getDeviceName()) == 0)
+            {
+                it->wakeUp();
+                INDI::HandlerProfile::Scope scope(it->profiler(), "ISNewBLOB", name);
                 it->defaultDevice->ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, n);
+            }
     }
 
     void ISSnoopDevice(XMLEle *root)
     {
         const std::unique_lock<std::recursive_mutex> lock(INDI::DefaultDevicePrivate::devicesLock);
         for(auto &it : INDI::DefaultDevicePrivate::devices)
+        {
+            // Snoops are told apart by the device and property snooped
+            INDI::HandlerProfile *profile = it->profiler();
+            std::string snooped = profile ? std::string(findXMLAttValu(root, "device")) + "." + findXMLAttValu(root, "name") : "";
+            INDI::HandlerProfile::Scope scope(profile, "ISSnoopDevice", profile ? snooped.c_str() : nullptr);
+            it->snoops.dispatch(root);
             it->defaultDevice->ISSnoopDevice(root);
+        }
     }
 
 } // extern "C"
@@ -162,6 +194,237 @@ void timerfunc(void *t)
 namespace INDI
 {
 
+// Shorter polls are not worth aligning
+static const uint32_t MIN_ALIGNED_PERIOD = 250;
+
+static std::string configFilePath(const char *deviceName)
+{
+    char configFileName[MAXRBUF];
+    IUGetConfigFileName(nullptr, deviceName, configFileName);
+    return configFileName;
+}
+
+/* Writes configuration snapshots queued by DefaultDevice::saveConfig() when a save delay is set.
+ * A snapshot is written as soon as it is complete, unless the file was written less than the delay
+ * ago: then it is due once the delay has elapsed, and the snapshots queued meanwhile replace it.
+ * indiserver kills drivers, so what waits is at most one delay of changes. Each write goes to a
+ * temporary file that is synced and renamed over the configuration. */
+class ConfigWriter
+{
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static ConfigWriter &instance()
+        {
+            static ConfigWriter writer;
+            return writer;
+        }
+
+        void schedule(const std::string &path, const std::string &device, std::string content, std::chrono::milliseconds delay)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = pending.find(path);
+            if (it == pending.end())
+            {
+                auto last = written.find(path);
+                auto due = last == written.end() ? Clock::now() : std::max(Clock::now(), last->second + delay);
+                pending.emplace(path, Pending{due, device, std::move(content)});
+            }
+            else
+                it->second.content = std::move(content);
+
+            if (!thread.joinable())
+                thread = std::thread(&ConfigWriter::run, this);
+            wakeup.notify_one();
+        }
+
+        /* write the pending snapshot of path now, and wait for one in progress */
+        void flush(const std::string &path)
+        {
+            std::lock_guard<std::mutex> writing(writeLock);
+            Pending item;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = pending.find(path);
+                if (it == pending.end())
+                    return;
+                item = std::move(it->second);
+                pending.erase(it);
+                written[path] = Clock::now();
+            }
+            write(path, item);
+        }
+
+        void cancel(const std::string &path)
+        {
+            std::lock_guard<std::mutex> writing(writeLock);
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.erase(path);
+        }
+
+        ~ConfigWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                quit = true;
+            }
+            wakeup.notify_one();
+            if (thread.joinable())
+                thread.join();
+
+            for (auto &it : pending)
+                write(it.first, it.second);
+        }
+
+    private:
+        struct Pending
+        {
+            Clock::time_point due;
+            std::string device;
+            std::string content;
+        };
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!quit)
+            {
+                auto next = std::min_element(pending.begin(), pending.end(), [](const auto & a, const auto & b)
+                {
+                    return a.second.due < b.second.due;
+                });
+
+                if (next == pending.end())
+                {
+                    wakeup.wait(lock);
+                    continue;
+                }
+
+                if (Clock::now() < next->second.due)
+                {
+                    wakeup.wait_until(lock, next->second.due);
+                    continue;
+                }
+
+                // writeLock is taken before mutex everywhere, so writes of one file keep their order
+                std::string path = next->first;
+                lock.unlock();
+                std::lock_guard<std::mutex> writing(writeLock);
+                lock.lock();
+
+                auto it = pending.find(path);
+                if (it == pending.end())
+                    continue;
+                Pending item = std::move(it->second);
+                pending.erase(it);
+                written[path] = Clock::now();
+
+                lock.unlock();
+                write(path, item);
+                lock.lock();
+            }
+        }
+
+        static void write(const std::string &path, const Pending &item)
+        {
+            std::string temporary = path + ".tmp";
+            FILE *fp = fopen(temporary.c_str(), "w");
+            if (fp == nullptr && errno == ENOENT)
+            {
+                std::string configDir = path.substr(0, path.find_last_of('/'));
+                mkdir(configDir.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+                fp = fopen(temporary.c_str(), "w");
+            }
+
+            if (fp == nullptr)
+            {
+                DEBUGFDEVICE(item.device.c_str(), Logger::DBG_WARNING, "Failed to save configuration. Unable to open %s: %s",
+                             temporary.c_str(), strerror(errno));
+                return;
+            }
+
+            bool written = fwrite(item.content.data(), 1, item.content.size(), fp) == item.content.size();
+            written = fflush(fp) == 0 && written;
+            written = fsync(fileno(fp)) == 0 && written;
+            written = fclose(fp) == 0 && written;
+
+            if (!written || rename(temporary.c_str(), path.c_str()) != 0)
+            {
+                DEBUGFDEVICE(item.device.c_str(), Logger::DBG_WARNING, "Failed to save configuration to %s: %s",
+                             path.c_str(), strerror(errno));
+                unlink(temporary.c_str());
+                return;
+            }
+
+            DEBUGDEVICE(item.device.c_str(), Logger::DBG_DEBUG, "Configuration successfully saved.");
+        }
+
+    private:
+        std::mutex mutex;
+        std::mutex writeLock;
+        std::condition_variable wakeup;
+        std::map<std::string, Pending> pending;
+        std::map<std::string, Clock::time_point> written;
+        std::thread thread;
+        bool quit {false};
+};
+
+void DefaultDevicePrivate::logProfile()
+{
+    const char *deviceName = defaultDevice->getDeviceName();
+    std::vector<HandlerProfile::Entry> entries = profile.report();
+    if (entries.empty())
+    {
+        DEBUGDEVICE(deviceName, Logger::DBG_SESSION, "Profile: no handler was called.");
+        return;
+    }
+
+    DEBUGFDEVICE(deviceName, Logger::DBG_SESSION, "Profile of %zu handlers, the most total time first:", entries.size());
+    for (const auto &entry : entries)
+        DEBUGFDEVICE(deviceName, Logger::DBG_SESSION,
+                     "%s: %llu calls, %.3f ms total, median %.3f ms, 99%% %.3f ms, max %.3f ms",
+                     entry.handler.c_str(), static_cast<unsigned long long>(entry.count), entry.total, entry.median,
+                     entry.p99, entry.max);
+}
+
+// SIGUSR1 is turned into a byte on this pipe, the main loop logs the profiles when it reads it
+static int profileSignalPipe[2] = { -1, -1 };
+
+static void profileSignal(int)
+{
+    char byte = 0;
+    ssize_t written = write(profileSignalPipe[1], &byte, 1);
+    INDI_UNUSED(written);
+}
+
+static void profileSignalCallback(int fd, void *)
+{
+    char bytes[64];
+    while (read(fd, bytes, sizeof(bytes)) > 0) {}
+
+    const std::unique_lock<std::recursive_mutex> lock(DefaultDevicePrivate::devicesLock);
+    for (auto &it : DefaultDevicePrivate::devices)
+        if (it->isProfiling)
+            it->logProfile();
+}
+
+static void installProfileSignal()
+{
+    if (profileSignalPipe[0] >= 0 || pipe(profileSignalPipe) != 0)
+        return;
+
+    for (int fd : profileSignalPipe)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    IEAddCallback(profileSignalPipe[0], profileSignalCallback, nullptr);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = profileSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, nullptr);
+}
+
 DefaultDevicePrivate::DefaultDevicePrivate(DefaultDevice *defaultDevice)
     : defaultDevice(defaultDevice)
 {
@@ -181,7 +444,11 @@ DefaultDevice::DefaultDevice()
     D_PTR(DefaultDevice);
     d->m_MainLoopTimer.setSingleShot(true);
     d->m_MainLoopTimer.setInterval(getPollingPeriod());
-    d->m_MainLoopTimer.callOnTimeout(std::bind(&DefaultDevice::TimerHit, this));
+    d->m_MainLoopTimer.callOnTimeout([this, d]()
+    {
+        HandlerProfile::Scope scope(d->profiler(), "TimerHit");
+        TimerHit();
+    });
 }
 
 bool DefaultDevice::loadConfig(INDI::Property &property)
@@ -193,6 +460,8 @@ bool DefaultDevice::loadConfig(bool silent, const char *property)
 {
     D_PTR(DefaultDevice);
     char errmsg[MAXRBUF] = {0};
+    if (d->configSaveDelay > 0)
+        ConfigWriter::instance().flush(configFilePath(getDeviceName()));
     d->isConfigLoading = true;
     bool pResult = IUReadConfig(nullptr, getDeviceName(), property, silent ? 1 : 0, errmsg) == 0 ? true : false;
     d->isConfigLoading = false;
@@ -253,6 +522,7 @@ bool DefaultDevice::saveAllConfigItems(FILE *fp)
 bool DefaultDevice::purgeConfig()
 {
     char errmsg[MAXRBUF];
+    ConfigWriter::instance().cancel(configFilePath(getDeviceName()));
     if (IUPurgeConfig(nullptr, getDeviceName(), errmsg) == -1)
     {
         LOGF_WARN("%s", errmsg);
@@ -273,11 +543,44 @@ bool DefaultDevice::saveConfig(bool silent, const char *property)
     D_PTR(DefaultDevice);
     if (d->isConfigLoading)
         return false;
+    HandlerProfile::Scope scope(d->profiler(), "saveConfig", property);
     silent = false;
     char errmsg[MAXRBUF] = {0};
 
     FILE *fp = nullptr;
 
+    if (d->configSaveDelay > 0)
+    {
+        // Snapshot everything in memory, the writer replaces the whole file anyway.
+        char *buffer = nullptr;
+        size_t size = 0;
+        fp = open_memstream(&buffer, &size);
+        if (fp == nullptr)
+        {
+            LOGF_WARN("Failed to save configuration. %s", strerror(errno));
+            return false;
+        }
+
+        IUSaveConfigTag(fp, 0, getDeviceName(), silent ? 1 : 0);
+
+        saveConfigItems(fp);
+
+        IUSaveConfigTag(fp, 1, getDeviceName(), silent ? 1 : 0);
+
+        fclose(fp);
+        std::string content(buffer, size);
+        free(buffer);
+
+        if (d->isDefaultConfigLoaded == false)
+        {
+            d->isDefaultConfigLoaded = IUSaveDefaultConfig(nullptr, nullptr, getDeviceName()) == 0;
+        }
+
+        ConfigWriter::instance().schedule(configFilePath(getDeviceName()), getDeviceName(), std::move(content),
+                                          std::chrono::milliseconds(d->configSaveDelay));
+        return true;
+    }
+
     if (property == nullptr)
     {
         fp = IUGetConfigFP(nullptr, getDeviceName(), "w", errmsg);
@@ -574,10 +877,37 @@ void DefaultDevice::watchDevice(const char *name, const std::function<void (Base
     IDSnoopDevice(name, nullptr);
 }
 
+int DefaultDevice::snoopProperty(INDI::SnoopRouter::Type type, const char *device, const char *property,
+                                 const std::vector<std::string> &elements, const INDI::SnoopRouter::Handler &handler)
+{
+    D_PTR(DefaultDevice);
+    int id = d->snoops.add(type, device ? device : "", property, elements, handler);
+    if (device != nullptr && device[0] != '\0')
+        IDSnoopDevice(device, property);
+    return id;
+}
+
+void DefaultDevice::setSnoopDevice(int id, const char *device)
+{
+    D_PTR(DefaultDevice);
+    std::string previous = d->snoops.device(id);
+    if (!d->snoops.setDevice(id, device ? device : "") || device == nullptr || device[0] == '\0' || previous == device)
+        return;
+
+    IDSnoopDevice(device, d->snoops.property(id).c_str());
+}
+
+void DefaultDevice::removeSnoop(int id)
+{
+    D_PTR(DefaultDevice);
+    d->snoops.remove(id);
+}
+
 void DefaultDevice::addDebugControl()
 {
     D_PTR(DefaultDevice);
     registerProperty(d->DebugSP);
+    registerProperty(d->ProfilingSP);
     d->isDebug = false;
 }
 
@@ -638,6 +968,29 @@ void DefaultDevice::setDebug(bool enable)
     d->DebugSP.apply();
 }
 
+void DefaultDevice::setProfiling(bool enable)
+{
+    D_PTR(DefaultDevice);
+    d->ProfilingSP.reset();
+    d->ProfilingSP[enable ? INDI_ENABLED : INDI_DISABLED].setState(ISS_ON);
+
+    if (enable && !d->isProfiling)
+    {
+        d->profile.reset();
+        d->isProfiling = true;
+        installProfileSignal();
+        LOGF_INFO("Profiling is enabled. Statistics are logged when it is disabled or on SIGUSR1 to process %d.", getpid());
+    }
+    else if (!enable && d->isProfiling)
+    {
+        d->logProfile();
+        d->isProfiling = false;
+    }
+
+    d->ProfilingSP.setState(IPS_OK);
+    d->ProfilingSP.apply();
+}
+
 void DefaultDevice::setSimulation(bool enable)
 {
     D_PTR(DefaultDevice);
@@ -803,6 +1156,18 @@ void DefaultDevice::setConnected(bool status, IPState state, const char *msg)
 int DefaultDevice::SetTimer(uint32_t ms)
 {
     D_PTR(DefaultDevice);
+    // Regular polls of a device with an activity wake up on multiples of their period, polls of the
+    // same period across the drivers of a host then come together
+    if (d->activity >= 0 && ms >= MIN_ALIGNED_PERIOD && ms == d->activityPeriod(d->activity))
+    {
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+        uint32_t delay = ms - static_cast<uint32_t>(now % ms);
+        // a poll that fired just before its multiple waits for the next one
+        if (delay < ms / 4)
+            delay += ms;
+        ms = delay;
+    }
     d->m_MainLoopTimer.start(ms);
     return 1;
 }
@@ -957,6 +1322,17 @@ bool DefaultDevice::initProperties()
         setDebug(sp->isNameMatch("ENABLE") ? true : false);
     });
 
+    // Profiling
+    d->ProfilingSP[INDI_ENABLED ].fill("ENABLE",  "Enable",  ISS_OFF);
+    d->ProfilingSP[INDI_DISABLED].fill("DISABLE", "Disable", ISS_ON);
+    d->ProfilingSP.fill(getDeviceName(), "PROFILING", "Profiling", "Options", IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+    d->ProfilingSP.onUpdate([this, d]()
+    {
+        auto sp = d->ProfilingSP.findOnSwitch();
+        assert(sp != nullptr);
+        setProfiling(sp->isNameMatch("ENABLE"));
+    });
+
     // Simulation
     d->SimulationSP[INDI_ENABLED ].fill("ENABLE",  "Enable",  ISS_OFF);
     d->SimulationSP[INDI_DISABLED].fill("DISABLE", "Disable", ISS_ON);
@@ -1195,6 +1571,54 @@ bool DefaultDevice::unRegisterConnection(Connection::Interface *existingConnecti
     return false;
 }
 
+uint32_t DefaultDevicePrivate::activityPeriod(int activity) const
+{
+    if (activityPeriods[activity] > 0)
+        return activityPeriods[activity];
+
+    switch (activity)
+    {
+        case DefaultDevice::ACTIVITY_IDLE:
+            return pollingPeriod * 5;
+        case DefaultDevice::ACTIVITY_MOVING:
+            return std::max(std::min<uint32_t>(pollingPeriod, 100), pollingPeriod / 2);
+        default:
+            return pollingPeriod;
+    }
+}
+
+void DefaultDevicePrivate::wakeUp()
+{
+    if (activity == DefaultDevice::ACTIVITY_IDLE)
+        pollWithin(activityPeriod(DefaultDevice::ACTIVITY_BUSY));
+}
+
+void DefaultDevicePrivate::pollWithin(uint32_t msec)
+{
+    if (m_MainLoopTimer.isActive() && static_cast<uint32_t>(m_MainLoopTimer.remainingTime()) > msec)
+        defaultDevice->SetTimer(msec);
+}
+
+void DefaultDevice::setActivity(Activity activity)
+{
+    D_PTR(DefaultDevice);
+    if (d->activity == activity)
+        return;
+
+    d->activity = activity;
+    LOGF_DEBUG("Polling every %u ms while %s.", d->activityPeriod(activity),
+               activity == ACTIVITY_IDLE ? "idle" : activity == ACTIVITY_MOVING ? "moving" : "busy");
+    d->pollWithin(d->activityPeriod(activity));
+}
+
+void DefaultDevice::setActivityPollingPeriod(Activity activity, uint32_t msec)
+{
+    D_PTR(DefaultDevice);
+    d->activityPeriods[activity] = msec;
+    if (d->activity == activity)
+        d->pollWithin(d->activityPeriod(activity));
+}
+
 void DefaultDevice::setCurrentPollingPeriod(uint32_t msec)
 {
     D_PTR(DefaultDevice);
@@ -1204,7 +1628,7 @@ void DefaultDevice::setCurrentPollingPeriod(uint32_t msec)
 uint32_t DefaultDevice::getCurrentPollingPeriod() const
 {
     D_PTR(const DefaultDevice);
-    return d->pollingPeriod;
+    return d->activity >= 0 ? d->activityPeriod(d->activity) : d->pollingPeriod;
 }
 
 uint32_t &DefaultDevice::refCurrentPollingPeriod()
@@ -1300,6 +1724,20 @@ uint16_t DefaultDevice::getMinorVersion() const
     return d->minorVersion;
 }
 
+void DefaultDevice::setConfigSaveDelay(uint32_t milliseconds)
+{
+    D_PTR(DefaultDevice);
+    if (milliseconds == 0 && d->configSaveDelay > 0)
+        ConfigWriter::instance().flush(configFilePath(getDeviceName()));
+    d->configSaveDelay = milliseconds;
+}
+
+uint32_t DefaultDevice::getConfigSaveDelay() const
+{
+    D_PTR(const DefaultDevice);
+    return d->configSaveDelay;
+}
+
 void DefaultDevice::setDynamicPropertiesBehavior(bool defineEnabled, bool deleteEnabled)
 {
     D_PTR(DefaultDevice);
@@ -1307,6 +1745,11 @@ void DefaultDevice::setDynamicPropertiesBehavior(bool defineEnabled, bool delete
     d->deleteDynamicProperties = deleteEnabled;
 }
 
+void DefaultDevice::setGroupLazy(const char *group, bool lazy)
+{
+    IDSetLazyGroup(getDeviceName(), group, lazy);
+}
+
 Connection::Interface *DefaultDevice::getActiveConnection()
 {
     D_PTR(DefaultDevice);
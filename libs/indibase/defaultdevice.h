@@ -21,6 +21,7 @@
 #include "parentdevice.h"
 #include "indidriver.h"
 #include "indilogger.h"
+#include "snooprouter.h"
 
 #include <stdint.h>
 
@@ -327,6 +328,41 @@ class DefaultDevice : public ParentDevice
          */
         void watchDevice(const char *deviceName, const std::function<void (INDI::BaseDevice)> &callback);
 
+        /**
+         * @brief snoopProperty Snoop a property of another device and receive its elements already parsed.
+         *
+         * Unlike ISSnoopDevice, which is called with every snooped message, the handler is only called with
+         * the messages of this device and property, and the elements are parsed once for it.
+         *
+         * \code{cpp}
+         * snoopProperty(INDI::SnoopRouter::NUMBER, "Telescope Simulator", "EQUATORIAL_EOD_COORD", {"RA", "DEC"},
+         *               [this](const INDI::SnoopUpdate &update)
+         * {
+         *     if (update.has(0) && update.has(1))
+         *         ...
+         * });
+         * \endcode
+         *
+         * @param type Property type, NUMBER, TEXT, SWITCH or LIGHT.
+         * @param device The snooped device, may be empty for a device selected later with setSnoopDevice.
+         * @param property The snooped property.
+         * @param elements The elements the handler reads, by index in this list. Empty for all elements.
+         * @param handler Called from the driver event loop with each update of the property.
+         * @return The subscription identifier.
+         */
+        int snoopProperty(INDI::SnoopRouter::Type type, const char *device, const char *property,
+                          const std::vector<std::string> &elements, const INDI::SnoopRouter::Handler &handler);
+
+        /**
+         * @brief setSnoopDevice Point a snoop subscription to another device and snoop its property.
+         */
+        void setSnoopDevice(int id, const char *device);
+
+        /**
+         * @brief removeSnoop Stop calling the handler of a snoop subscription.
+         */
+        void removeSnoop(int id);
+
     protected:
         /**
          * @brief setDynamicPropertiesBehavior controls handling of dynamic properties. Dynamic properties
@@ -344,6 +380,17 @@ class DefaultDevice : public ParentDevice
          */
         void setDynamicPropertiesBehavior(bool defineEnabled, bool deleteEnabled);
 
+        /**
+         * @brief setGroupLazy Define the properties of a group only when a client asks for them.
+         * Drivers with many properties can mark the groups a client seldom opens, such as the
+         * settings of an advanced tab. Instead of their properties, clients get one switch in the
+         * group, and setting it defines the whole group. See IDSetLazyGroup().
+         * @param group name of the group, e.g. OPTIONS_TAB.
+         * @param lazy True to withhold the properties of the group, false to define them now.
+         * @note Call it in initProperties(), before the properties of the group are defined.
+         */
+        void setGroupLazy(const char *group, bool lazy = true);
+
         // Configuration
 
         /**
@@ -381,6 +428,22 @@ class DefaultDevice : public ParentDevice
          */
         bool saveConfig(INDI::Property &property);
 
+        /**
+         * @brief setConfigSaveDelay Save the configuration from a background thread. saveConfig() then
+         * only takes a snapshot of the properties. A snapshot is written right away unless the file was
+         * written within the delay, and the snapshots taken meanwhile are written once, when it elapses.
+         * Writes go through a temporary file renamed over the configuration.
+         * @param milliseconds Shortest interval between two writes. 0 (default) saves synchronously.
+         * @note Partial saves are written as full snapshots in this mode. loadConfig() writes a pending
+         * snapshot first.
+         */
+        void setConfigSaveDelay(uint32_t milliseconds);
+
+        /**
+         * @return Delay in milliseconds before a configuration snapshot is written, 0 if saves are synchronous.
+         */
+        uint32_t getConfigSaveDelay() const;
+
         /**
          * @brief purgeConfig Remove config file from disk.
          * @return True if successful, false otherwise.
@@ -426,6 +489,15 @@ class DefaultDevice : public ParentDevice
          */
         void setSimulation(bool enable);
 
+        /**
+         * \brief Toggle profiling of the driver handlers
+         * While enabled, the calls of TimerHit, ISNew* of each property, ISSnoopDevice and saveConfig are
+         * counted and timed. The statistics are logged when profiling is disabled, and whenever the driver
+         * receives SIGUSR1.
+         * \param enable If true, the Profiling option is set to ON and earlier statistics are dropped.
+         */
+        void setProfiling(bool enable);
+
         /**
          * \brief Inform driver that the debug option was triggered.
          * This function is called after setDebug is triggered by the client. Reimplement this
@@ -537,6 +609,33 @@ class DefaultDevice : public ParentDevice
          */
         uint32_t getCurrentPollingPeriod() const;
 
+        /**
+         * @brief Activity states of a device, each polled at its own period once the driver declares one.
+         */
+        enum Activity
+        {
+            ACTIVITY_IDLE,   /*!< Parked, stopped or waiting for a command, polled 5 times slower by default */
+            ACTIVITY_BUSY,   /*!< Exposing, tracking or otherwise at work, polled at the current polling period */
+            ACTIVITY_MOVING  /*!< Slewing, focusing or rotating, polled twice faster by default */
+        };
+
+        /**
+         * @brief setActivity Declare what the device is doing, typically from TimerHit().
+         * Once an activity is declared, getCurrentPollingPeriod() returns the period of that activity, and
+         * SetTimer() with that period aligns the wakeup on a multiple of it so that the drivers of a host
+         * poll together. Moving to a faster activity brings a pending poll forward, and any client command
+         * brings forward the next poll of an idle device.
+         * @param activity current activity of the device.
+         */
+        void setActivity(Activity activity);
+
+        /**
+         * @brief setActivityPollingPeriod Change the polling period of an activity.
+         * @param activity activity to change.
+         * @param msec period in milliseconds, 0 to derive it from the current polling period.
+         */
+        void setActivityPollingPeriod(Activity activity, uint32_t msec);
+
         /* direct access to POLLMS is deprecated, please use setCurrentPollingPeriod/getCurrentPollingPeriod */
         uint32_t &refCurrentPollingPeriod() __attribute__((deprecated));
         uint32_t  refCurrentPollingPeriod() const __attribute__((deprecated));
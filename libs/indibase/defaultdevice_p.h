@@ -21,7 +21,9 @@
 #include "parentdevice_p.h"
 #include "defaultdevice.h"
 #include "watchdeviceproperty.h"
+#include "handlerprofile.h"
 
+#include <atomic>
 #include <cstring>
 #include <list>
 #include <mutex>
@@ -58,6 +60,7 @@ class DefaultDevicePrivate: public ParentDevicePrivate
         PropertyNumber PollPeriodNP     { 1 };
         PropertyText   DriverInfoTP     { 4 };
         PropertySwitch ConnectionModeSP { 0 }; // dynamic count of switches
+        PropertySwitch ProfilingSP      { 2 };
 
         std::vector<Connection::Interface *> connections;
         Connection::Interface *activeConnection = nullptr;
@@ -67,17 +70,51 @@ class DefaultDevicePrivate: public ParentDevicePrivate
          */
         uint32_t pollingPeriod = 1000;
 
+        /**
+         * @brief activity Activity declared by the driver, -1 until it declares one.
+         */
+        int activity = -1;
+        uint32_t activityPeriods[3] = {0, 0, 0};
+
+        /** @return The polling period of an activity, derived from pollingPeriod unless the driver set it. */
+        uint32_t activityPeriod(int activity) const;
+
+        /** @brief Poll within msec if the pending poll is later. */
+        void pollWithin(uint32_t msec);
+
+        /** @brief Poll an idle device as a busy one, for a client command. */
+        void wakeUp();
+
+                /**
+         * @brief configSaveDelay Delay in milliseconds of background configuration writes, 0 to save synchronously.
+         */
+        uint32_t configSaveDelay = 0;
+
         bool defineDynamicProperties {true};
         bool deleteDynamicProperties {true};
 
         // TimerHit timer
         INDI::Timer m_MainLoopTimer;
 
+        // Handler statistics, gathered while profiling is on
+        HandlerProfile profile;
+        std::atomic<bool> isProfiling {false};
+
+        /** @return The profile handlers add their calls to, nullptr while profiling is off. */
+        HandlerProfile *profiler()
+        {
+            return isProfiling ? &profile : nullptr;
+        }
+
+        /** @brief Log the statistics of every handler called since profiling was enabled. */
+        void logProfile();
+
     public:
         static std::list<DefaultDevicePrivate*> devices;
         static std::recursive_mutex             devicesLock;
 
         WatchDeviceProperty watchDevice;
+        SnoopRouter snoops;
 };
 
 }
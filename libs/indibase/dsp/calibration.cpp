@@ -0,0 +1,429 @@
+/*******************************************************************************
+  Copyright(c) 2017 Ilia Platone, Jasem Mutlaq. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "calibration.h"
+#include "indistandardproperty.h"
+#include "indicom.h"
+#include "indilogger.h"
+#include "defaultdevice.h"
+#include "indithreadpool.h"
+
+#include <fitsio.h>
+
+#include <dirent.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// A dark without the bias in it is only used for exposures this close to its own
+#define CALIBRATION_DARK_EXPOSURE_RATIO 0.05
+// Rows of a frame calibrated by each task of the thread pool
+#define CALIBRATION_ROWS_PER_TASK 16
+
+namespace DSP
+{
+extern const char *DSP_TAB;
+
+namespace
+{
+
+// The same, but for a NAN temperature on either side which matches anything
+bool sameTemperature(double a, double b, double tolerance)
+{
+    return std::isnan(a) || std::isnan(b) || std::fabs(a - b) <= tolerance;
+}
+
+// Branch free, so the compiler vectorizes the loop over a row
+template <typename T>
+void calibrateRow(T *pixels, const float *offset, const float *gain, size_t count, float pedestal)
+{
+    if constexpr (std::is_floating_point<T>::value)
+    {
+        for (size_t i = 0; i < count; i++)
+            pixels[i] = static_cast<T>((pixels[i] - offset[i]) * gain[i] + pedestal);
+        return;
+    }
+
+    const float top = static_cast<float>(std::numeric_limits<T>::max());
+    for (size_t i = 0; i < count; i++)
+    {
+        float value = (static_cast<float>(pixels[i]) - offset[i]) * gain[i] + pedestal + 0.5f;
+        value = std::min(std::max(value, 0.0f), top);
+        pixels[i] = static_cast<T>(value);
+    }
+}
+
+}
+
+Calibration::Calibration(INDI::DefaultDevice *dev) : Interface(dev, DSP_CALIBRATION, "CALIBRATION", "Calibration")
+{
+    IUFillText(&DirectoryT[0], "CALIBRATION_DIR", "Directory", "");
+    IUFillTextVector(&DirectoryTP, DirectoryT, 1, m_Device->getDeviceName(), "CALIBRATION_MASTERS_DIR", "Masters", DSP_TAB,
+                     IP_RW, 60, IPS_IDLE);
+
+    IUFillNumber(&SettingsN[CALIBRATION_TOLERANCE], "CALIBRATION_TOLERANCE", "Temperature tolerance (C)", "%3.1f", 0.0, 20.0,
+                 0.5, 2.0);
+    IUFillNumber(&SettingsN[CALIBRATION_PEDESTAL], "CALIBRATION_PEDESTAL", "Pedestal (ADU)", "%.f", 0.0, 10000.0, 10.0, 0.0);
+    IUFillNumberVector(&SettingsNP, SettingsN, CALIBRATION_N, m_Device->getDeviceName(), "CALIBRATION_SETTINGS", "Calibration",
+                       DSP_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillText(&MastersT[MASTER_BIAS], "CALIBRATION_BIAS", "Bias", "");
+    IUFillText(&MastersT[MASTER_DARK], "CALIBRATION_DARK", "Dark", "");
+    IUFillText(&MastersT[MASTER_FLAT], "CALIBRATION_FLAT", "Flat", "");
+    IUFillTextVector(&MastersTP, MastersT, MASTER_N, m_Device->getDeviceName(), "CALIBRATION_MASTERS", "Applied", DSP_TAB,
+                     IP_RO, 60, IPS_IDLE);
+}
+
+Calibration::~Calibration()
+{
+}
+
+void Calibration::Activated()
+{
+    m_Device->defineProperty(&DirectoryTP);
+    m_Device->defineProperty(&SettingsNP);
+    m_Device->defineProperty(&MastersTP);
+    scan();
+}
+
+void Calibration::Deactivated()
+{
+    m_Device->deleteProperty(DirectoryTP.name);
+    m_Device->deleteProperty(SettingsNP.name);
+    m_Device->deleteProperty(MastersTP.name);
+
+    // The masters may be hundreds of megabytes
+    std::lock_guard<std::mutex> guard(lock);
+    masters.clear();
+    masters.shrink_to_fit();
+    offset.clear();
+    offset.shrink_to_fit();
+    gain.clear();
+    gain.shrink_to_fit();
+    combined.clear();
+}
+
+bool Calibration::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (!strcmp(dev, getDeviceName()) && !strcmp(name, DirectoryTP.name))
+    {
+        IUUpdateText(&DirectoryTP, texts, names, n);
+        if (PluginActive)
+            scan();
+        else
+            IDSetText(&DirectoryTP, nullptr);
+        return true;
+    }
+    return false;
+}
+
+bool Calibration::ISNewNumber(const char *dev, const char *name, double *values, char *names[], int n)
+{
+    if (!strcmp(dev, getDeviceName()) && !strcmp(name, SettingsNP.name))
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        IUUpdateNumber(&SettingsNP, values, names, n);
+        combined.clear();
+        SettingsNP.s = IPS_OK;
+        IDSetNumber(&SettingsNP, nullptr);
+        return true;
+    }
+    return false;
+}
+
+bool Calibration::saveConfigItems(FILE *fp)
+{
+    IUSaveConfigText(fp, &DirectoryTP);
+    IUSaveConfigNumber(fp, &SettingsNP);
+    return true;
+}
+
+bool Calibration::processBLOB(uint8_t *out, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    INDI_UNUSED(out);
+    INDI_UNUSED(dims);
+    INDI_UNUSED(sizes);
+    INDI_UNUSED(bits_per_sample);
+    return false;
+}
+
+void Calibration::scan()
+{
+    std::vector<Master> found;
+    const char *directory = DirectoryT[0].text;
+    DIR *dir = (directory != nullptr && directory[0] != '\0') ? opendir(directory) : nullptr;
+    if (dir == nullptr)
+    {
+        if (directory != nullptr && directory[0] != '\0')
+            LOGF_WARN("%s: cannot open %s: %s", m_Label, directory, strerror(errno));
+        DirectoryTP.s = IPS_ALERT;
+    }
+    else
+    {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr)
+        {
+            std::string path = std::string(directory) + "/" + entry->d_name;
+            const char *dot = strrchr(entry->d_name, '.');
+            if (dot == nullptr || (strcasecmp(dot, ".fits") && strcasecmp(dot, ".fit") && strcasecmp(dot, ".fts")))
+                continue;
+
+            fitsfile *fptr = nullptr;
+            int status = 0, naxis = 0;
+            long naxes[2] = {0, 0};
+            char type[FLEN_VALUE] = "", filter[FLEN_VALUE] = "";
+            if (fits_open_diskfile(&fptr, path.c_str(), READONLY, &status))
+                continue;
+            fits_get_img_dim(fptr, &naxis, &status);
+            fits_get_img_size(fptr, 2, naxes, &status);
+            fits_read_key(fptr, TSTRING, "IMAGETYP", type, nullptr, &status);
+            if (status || naxis != 2)
+            {
+                status = 0;
+                fits_close_file(fptr, &status);
+                continue;
+            }
+
+            Master master;
+            master.path = path;
+            master.width = naxes[0];
+            master.height = naxes[1];
+            if (strcasestr(type, "bias"))
+                master.type = MASTER_BIAS;
+            else if (strcasestr(type, "dark"))
+                master.type = MASTER_DARK;
+            else if (strcasestr(type, "flat"))
+                master.type = MASTER_FLAT;
+            else
+            {
+                fits_close_file(fptr, &status);
+                continue;
+            }
+
+            // Keywords a master may lack: no binning is 1x1, no temperature matches any
+            int binning = 1;
+            master.binX = fits_read_key(fptr, TINT, "XBINNING", &binning, nullptr, &status) ? 1 : binning;
+            status = 0;
+            master.binY = fits_read_key(fptr, TINT, "YBINNING", &binning, nullptr, &status) ? 1 : binning;
+            status = 0;
+            double value = 0;
+            master.exposure = fits_read_key(fptr, TDOUBLE, "EXPTIME", &value, nullptr, &status) ? 0 : value;
+            status = 0;
+            master.temperature = fits_read_key(fptr, TDOUBLE, "CCD-TEMP", &value, nullptr, &status) ? NAN : value;
+            status = 0;
+            if (!fits_read_key(fptr, TSTRING, "FILTER", filter, nullptr, &status))
+                master.filter = filter;
+            status = 0;
+            fits_close_file(fptr, &status);
+
+            found.push_back(std::move(master));
+        }
+        closedir(dir);
+        DirectoryTP.s = IPS_OK;
+        LOGF_INFO("%s: %zu masters in %s.", m_Label, found.size(), directory);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    masters = std::move(found);
+    combined.clear();
+    IDSetText(&DirectoryTP, nullptr);
+}
+
+const Calibration::Master *Calibration::match(MasterType type, const Frame &frame, const Master *bias)
+{
+    const double tolerance = SettingsN[CALIBRATION_TOLERANCE].value;
+    const Master *best = nullptr;
+    double bestScore = 0;
+
+    for (const auto &master : masters)
+    {
+        if (master.type != type || master.binX != frame.binX || master.binY != frame.binY ||
+                master.width < frame.x + frame.width || master.height < frame.y + frame.height)
+            continue;
+
+        double score = 0;
+        if (type == MASTER_FLAT)
+        {
+            // Flats of the filter of the frame first, then those that name none
+            if (!master.filter.empty() && !frame.filter.empty() && master.filter != frame.filter)
+                continue;
+            score = master.filter.empty() ? 1 : 0;
+        }
+        else
+        {
+            if (!sameTemperature(master.temperature, frame.temperature, tolerance))
+                continue;
+            score = std::isnan(master.temperature) || std::isnan(frame.temperature) ? tolerance + 1 :
+                    std::fabs(master.temperature - frame.temperature);
+            if (type == MASTER_DARK)
+            {
+                // Without the bias, the dark can not be scaled to another exposure
+                double ratio = master.exposure > 0 ? std::fabs(frame.exposure / master.exposure - 1) : 1;
+                if (bias == nullptr && ratio > CALIBRATION_DARK_EXPOSURE_RATIO)
+                    continue;
+                score += ratio * 1000;
+            }
+        }
+
+        if (best == nullptr || score < bestScore)
+        {
+            best = &master;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+bool Calibration::load(Master &master)
+{
+    if (!master.pixels.empty())
+        return true;
+
+    fitsfile *fptr = nullptr;
+    int status = 0, anynul = 0;
+    std::vector<float> pixels(static_cast<size_t>(master.width) * master.height);
+    fits_open_diskfile(&fptr, master.path.c_str(), READONLY, &status);
+    fits_read_img(fptr, TFLOAT, 1, pixels.size(), nullptr, pixels.data(), &anynul, &status);
+    if (status)
+    {
+        char message[FLEN_STATUS];
+        fits_get_errstatus(status, message);
+        LOGF_ERROR("%s: cannot read %s: %s", m_Label, master.path.c_str(), message);
+        status = 0;
+        if (fptr)
+            fits_close_file(fptr, &status);
+        return false;
+    }
+    fits_close_file(fptr, &status);
+    master.pixels = std::move(pixels);
+    return true;
+}
+
+void Calibration::combine(const Master *bias, const Master *dark, const Master *flat, const Frame &frame)
+{
+    const size_t count = static_cast<size_t>(frame.width) * frame.height;
+    offset.assign(count, 0.0f);
+    gain.assign(count, 1.0f);
+
+    // The dark of the frame is the dark current of the master scaled to the exposure, over the bias
+    double scale = 1;
+    if (dark != nullptr && bias != nullptr && dark->exposure > 0)
+        scale = frame.exposure / dark->exposure;
+
+    auto crop = [&frame](const Master * master, int y)
+    {
+        return master->pixels.data() + static_cast<size_t>(frame.y + y) * master->width + frame.x;
+    };
+
+    double flatSum = 0;
+    for (int y = 0; y < frame.height; y++)
+    {
+        float *o = offset.data() + static_cast<size_t>(y) * frame.width;
+        float *g = gain.data() + static_cast<size_t>(y) * frame.width;
+        const float *b = bias ? crop(bias, y) : nullptr;
+        const float *d = dark ? crop(dark, y) : nullptr;
+        const float *f = flat ? crop(flat, y) : nullptr;
+        for (int x = 0; x < frame.width; x++)
+        {
+            float level = b ? b[x] : 0.0f;
+            o[x] = d ? (b ? level + static_cast<float>((d[x] - level) * scale) : d[x]) : level;
+            if (f)
+            {
+                g[x] = f[x] - level;
+                flatSum += g[x];
+            }
+        }
+    }
+
+    // The flat is normalized to its mean, so the calibrated frame keeps the level of the light
+    if (flat != nullptr && flatSum > 0)
+    {
+        float mean = static_cast<float>(flatSum / count);
+        for (auto &g : gain)
+            g = g > 0 ? mean / g : 1.0f;
+    }
+    else
+        std::fill(gain.begin(), gain.end(), 1.0f);
+}
+
+bool Calibration::calibrate(uint8_t *buf, int bits_per_sample, const Frame &frame)
+{
+    if (!PluginActive || frame.width <= 0 || frame.height <= 0)
+        return false;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    const Master *bias = match(MASTER_BIAS, frame, nullptr);
+    const Master *dark = match(MASTER_DARK, frame, bias);
+    const Master *flat = match(MASTER_FLAT, frame, bias);
+    for (const Master *master : {bias, dark, flat})
+        if (master != nullptr && !load(const_cast<Master &>(*master)))
+            return false;
+
+    // Combined again only when the masters or the frame they apply to change
+    char key[256];
+    snprintf(key, sizeof(key), "%p %p %p %dx%d+%d+%d %g", static_cast<const void *>(bias), static_cast<const void *>(dark),
+             static_cast<const void *>(flat), frame.width, frame.height, frame.x, frame.y,
+             dark && bias ? frame.exposure : 0.0);
+    if (combined != key)
+    {
+        if (bias == nullptr && dark == nullptr && flat == nullptr)
+            return false;
+        combine(bias, dark, flat, frame);
+        combined = key;
+
+        IUSaveText(&MastersT[MASTER_BIAS], bias ? bias->path.c_str() : "");
+        IUSaveText(&MastersT[MASTER_DARK], dark ? dark->path.c_str() : "");
+        IUSaveText(&MastersT[MASTER_FLAT], flat ? flat->path.c_str() : "");
+        MastersTP.s = IPS_OK;
+        IDSetText(&MastersTP, nullptr);
+    }
+
+    const float pedestal = SettingsN[CALIBRATION_PEDESTAL].value;
+    const size_t width = frame.width;
+    const float *o = offset.data(), *g = gain.data();
+    auto rows = [&](auto pixels)
+    {
+        INDI::ThreadPool::global().forEach(frame.height, CALIBRATION_ROWS_PER_TASK, [ = ](size_t first, size_t last)
+        {
+            for (size_t y = first; y < last; y++)
+                calibrateRow(pixels + y * width, o + y * width, g + y * width, width, pedestal);
+        });
+    };
+    switch (bits_per_sample)
+    {
+        case 8:
+            rows(buf);
+            break;
+        case 16:
+            rows(reinterpret_cast<uint16_t *>(buf));
+            break;
+        case 32:
+            rows(reinterpret_cast<uint32_t *>(buf));
+            break;
+        case -32:
+            rows(reinterpret_cast<float *>(buf));
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+}
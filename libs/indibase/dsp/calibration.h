@@ -0,0 +1,132 @@
+/*******************************************************************************
+  Copyright(c) 2017 Ilia Platone, Jasem Mutlaq. All rights reserved.
+
+ DSP calibration plugin
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include "dspinterface.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DSP
+{
+/**
+ * @brief The Calibration class subtracts the master bias and dark frames from the light frames and divides
+ * them by the master flat, in place, before the other plugins and the upload see them.
+ *
+ * The masters are the 2-D FITS files of a directory, told apart by their IMAGETYP and matched to each frame
+ * by binning, size, CCD-TEMP within a tolerance and, for flats, FILTER. They are read once, when first
+ * matched, and kept in memory. The dark nearest in exposure is scaled to the frame when the bias is known.
+ */
+class Calibration : public Interface
+{
+    public:
+        /** @brief What a frame is matched to the masters on. */
+        struct Frame
+        {
+            // Binned pixels of the frame and its offset from the binned full frame
+            int width {0};
+            int height {0};
+            int x {0};
+            int y {0};
+            int binX {1};
+            int binY {1};
+            double exposure {0};
+            // NAN if the camera has no temperature
+            double temperature {0};
+            std::string filter;
+        };
+
+        Calibration(INDI::DefaultDevice *dev);
+        bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
+        bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+        bool saveConfigItems(FILE *fp) override;
+
+        /** @brief Not one of the plugins publishing a result: frames go through calibrate() instead. */
+        virtual bool processBLOB(uint8_t *out, uint32_t dims, int *sizes, int bits_per_sample) override;
+
+        /**
+         * @brief calibrate Calibrate a light frame in place, when the plugin is active.
+         * @param buf Pixels of the frame, rows packed.
+         * @param bits_per_sample 8, 16, 32 or -32.
+         * @return True if a master was applied.
+         */
+        bool calibrate(uint8_t *buf, int bits_per_sample, const Frame &frame);
+
+    protected:
+        ~Calibration();
+        void Activated() override;
+        void Deactivated() override;
+
+    private:
+        enum MasterType
+        {
+            MASTER_BIAS,
+            MASTER_DARK,
+            MASTER_FLAT,
+            MASTER_N
+        };
+        struct Master
+        {
+            std::string path;
+            MasterType type;
+            int width;
+            int height;
+            int binX;
+            int binY;
+            double exposure;
+            double temperature;
+            std::string filter;
+            // Read on first use
+            std::vector<float> pixels;
+        };
+
+        void scan();
+        const Master *match(MasterType type, const Frame &frame, const Master *bias);
+        bool load(Master &master);
+        void combine(const Master *bias, const Master *dark, const Master *flat, const Frame &frame);
+
+        ITextVectorProperty DirectoryTP;
+        IText DirectoryT[1] {};
+
+        enum
+        {
+            CALIBRATION_TOLERANCE,
+            CALIBRATION_PEDESTAL,
+            CALIBRATION_N
+        };
+        INumberVectorProperty SettingsNP;
+        INumber SettingsN[CALIBRATION_N];
+
+        // The masters applied to the last frame
+        ITextVectorProperty MastersTP;
+        IText MastersT[MASTER_N] {};
+
+        std::mutex lock;
+        std::vector<Master> masters;
+
+        // Offset subtracted from and gain applied to each pixel, for the masters and frame they were combined for
+        std::vector<float> offset;
+        std::vector<float> gain;
+        std::string combined;
+};
+}
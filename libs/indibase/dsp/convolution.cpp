@@ -93,9 +93,7 @@ bool Convolution::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_
     if(!PluginActive) return false;
     if(!matrix_loaded) return false;
     setStream(buf, dims, sizes, bits_per_sample);
-    dsp_fourier_dft(stream, 1);
-    dsp_fourier_dft(matrix, 1);
-    dsp_convolution_convolution(stream, matrix);
+    dsp_convolution_filter(stream, matrix);
     return Interface::processBLOB(getStream(), stream->dims, stream->sizes, bits_per_sample);
 }
 
@@ -154,17 +152,19 @@ bool Wavelets::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per
         dsp_stream_add_dim(matrix, size);
         dsp_stream_add_dim(matrix, size);
         dsp_stream_alloc_buffer(matrix, matrix->len);
+        double sum = 0;
         for(int y = 0; y < size; y++)
         {
             for(int x = 0; x < size; x++)
             {
                 matrix->buf[x + y * size] = sin(static_cast<double>(x) * M_PI / static_cast<double>(size)) * sin(static_cast<double>
                                             (y) * M_PI / static_cast<double>(size));
+                sum += matrix->buf[x + y * size];
             }
         }
-        dsp_fourier_dft(tmp, 1);
-        dsp_fourier_dft(matrix, 1);
-        dsp_convolution_convolution(tmp, matrix);
+        // Unit gain keeps the smoothed frame in the range of the input
+        dsp_buffer_div1(matrix, sum);
+        dsp_convolution_filter(tmp, matrix);
         dsp_buffer_sub(tmp, matrix->buf, matrix->len);
         dsp_buffer_mul1(tmp, WaveletsNP.np[i].value / 8.0);
         dsp_buffer_sum(out, tmp->buf, tmp->len);
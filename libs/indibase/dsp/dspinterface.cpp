@@ -26,6 +26,7 @@
 #include "indicom.h"
 #include "libastro.h"
 #include "indiutility.h"
+#include "sharedblob.h"
 
 #include <fitsio.h>
 
@@ -431,21 +432,21 @@ bool Interface::sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture)
 
     //  Now we have to send fits format data to the client
     memsize = 5760;
-    memptr  = malloc(memsize);
+    memptr  = IDSharedBlobAlloc(memsize);
     if (!memptr)
     {
         LOGF_ERROR("Error: failed to allocate memory: %lu", memsize);
         return false;
     }
 
-    fits_create_memfile(&fptr, &memptr, &memsize, 2880, realloc, &status);
+    fits_create_memfile(&fptr, &memptr, &memsize, 2880, IDSharedBlobRealloc, &status);
 
     if (status)
     {
         fits_report_error(stderr, status); /* print out any error messages */
         fits_get_errstatus(status, error_status);
         fits_close_file(fptr, &status);
-        free(memptr);
+        IDSharedBlobFree(memptr);
         LOGF_ERROR("FITS Error: %s", error_status);
         return false;
     }
@@ -457,7 +458,7 @@ bool Interface::sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture)
         fits_report_error(stderr, status); /* print out any error messages */
         fits_get_errstatus(status, error_status);
         fits_close_file(fptr, &status);
-        free(memptr);
+        IDSharedBlobFree(memptr);
         LOGF_ERROR("FITS Error: %s", error_status);
         return false;
     }
@@ -471,7 +472,7 @@ bool Interface::sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture)
         fits_report_error(stderr, status); /* print out any error messages */
         fits_get_errstatus(status, error_status);
         fits_close_file(fptr, &status);
-        free(memptr);
+        IDSharedBlobFree(memptr);
         LOGF_ERROR("FITS Error: %s", error_status);
         return false;
     }
@@ -479,7 +480,7 @@ bool Interface::sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture)
 
     uploadFile(memptr, memsize, sendCapture, saveCapture, captureExtention);
 
-    free(memptr);
+    IDSharedBlobFree(memptr);
     return true;
 }
 
@@ -572,10 +573,6 @@ int Interface::getFileIndex(const char *dir, const char *prefix, const char *ext
 {
     INDI_UNUSED(ext);
 
-    DIR *dpdf = nullptr;
-    struct dirent *epdf = nullptr;
-    std::vector<std::string> files = std::vector<std::string>();
-
     std::string prefixIndex = prefix;
     prefixIndex             = regex_replace_compat(prefixIndex, "_ISO8601", "");
     prefixIndex             = regex_replace_compat(prefixIndex, "_XXX", "");
@@ -590,37 +587,7 @@ int Interface::getFileIndex(const char *dir, const char *prefix, const char *ext
             LOGF_ERROR("Error creating directory %s (%s)", dir, strerror(errno));
     }
 
-    dpdf = opendir(dir);
-    if (dpdf != nullptr)
-    {
-        while ((epdf = readdir(dpdf)))
-        {
-            if (strstr(epdf->d_name, prefixIndex.c_str()))
-                files.push_back(epdf->d_name);
-        }
-        closedir(dpdf);
-    }
-    else
-        return -1;
-
-    int maxIndex = 0;
-
-    for (unsigned long i = 0; i < static_cast<unsigned long>(files.size()); i++)
-    {
-        int index = -1;
-
-        std::string file  = files.at(i);
-        std::size_t start = file.find_last_of("_");
-        std::size_t end   = file.find_last_of(".");
-        if (start != std::string::npos)
-        {
-            index = atoi(file.substr(start + 1, end).c_str());
-            if (index > maxIndex)
-                maxIndex = index;
-        }
-    }
-
-    return (maxIndex + 1);
+    return INDI::nextFileIndex(dir, prefixIndex);
 }
 
 bool Interface::setStream(void *buf, uint32_t dims, int *sizes, int bits_per_sample)
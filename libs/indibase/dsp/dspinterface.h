@@ -78,6 +78,9 @@ class Interface
             DSP_WAVELETS,
             DSP_SPECTRUM,
             DSP_HISTOGRAM,
+            DSP_STACKER,
+            DSP_POWER_SPECTRUM,
+            DSP_CALIBRATION,
         } Type;
 
         virtual void ISGetProperties(const char *dev);
@@ -89,9 +92,18 @@ class Interface
         virtual bool saveConfigItems(FILE *fp);
         virtual bool updateProperties();
 
+        /**
+         * @brief isActive Whether the plugin was activated by the client.
+         * @return True if processBLOB would process a buffer, false otherwise.
+         */
+        bool isActive() const
+        {
+            return PluginActive;
+        }
+
         /**
          * @brief processBLOB Propagate to Callback and generate BLOBs for parent device.
-         * @param buf The input buffer
+         * @param buf The input buffer, only read, so a frame buffer can be passed without copying it first.
          * @param ndims Number of the dimensions of the input buffer
          * @param dims Sizes of the dimensions of the input buffer
          * @param bits_per_sample original bit depth of the input buffer
@@ -175,7 +187,7 @@ class Interface
          */
         dsp_stream_p loadFITS(char* buf, int len);
 
-        bool PluginActive;
+        bool PluginActive { false };
 
         IBLOBVectorProperty FitsBP;
         IBLOB FitsB;
@@ -38,7 +38,10 @@ Manager::Manager(INDI::DefaultDevice *dev)
     idft = new InverseFourierTransform(dev);
     spectrum = new Spectrum(dev);
     histogram = new Histogram(dev);
+    powerSpectrum = new PowerSpectrum(dev);
     wavelets = new Wavelets(dev);
+    stacker = new Stacker(dev);
+    calibration = new Calibration(dev);
 }
 
 Manager::~Manager()
@@ -52,7 +55,10 @@ void Manager::ISGetProperties(const char *dev)
     idft->ISGetProperties(dev);
     spectrum->ISGetProperties(dev);
     histogram->ISGetProperties(dev);
+    powerSpectrum->ISGetProperties(dev);
     wavelets->ISGetProperties(dev);
+    stacker->ISGetProperties(dev);
+    calibration->ISGetProperties(dev);
 }
 
 bool Manager::updateProperties()
@@ -63,7 +69,10 @@ bool Manager::updateProperties()
     r |= idft->updateProperties();
     r |= spectrum->updateProperties();
     r |= histogram->updateProperties();
+    r |= powerSpectrum->updateProperties();
     r |= wavelets->updateProperties();
+    r |= stacker->updateProperties();
+    r |= calibration->updateProperties();
     return r;
 }
 
@@ -75,7 +84,10 @@ bool Manager::ISNewSwitch(const char *dev, const char *name, ISState *states, ch
     r |= idft->ISNewSwitch(dev, name, states, names, num);
     r |= spectrum->ISNewSwitch(dev, name, states, names, num);
     r |= histogram->ISNewSwitch(dev, name, states, names, num);
+    r |= powerSpectrum->ISNewSwitch(dev, name, states, names, num);
     r |= wavelets->ISNewSwitch(dev, name, states, names, num);
+    r |= stacker->ISNewSwitch(dev, name, states, names, num);
+    r |= calibration->ISNewSwitch(dev, name, states, names, num);
     return r;
 }
 
@@ -87,7 +99,10 @@ bool Manager::ISNewText(const char *dev, const char *name, char *texts[], char *
     r |= idft->ISNewText(dev, name, texts, names, num);
     r |= spectrum->ISNewText(dev, name, texts, names, num);
     r |= histogram->ISNewText(dev, name, texts, names, num);
+    r |= powerSpectrum->ISNewText(dev, name, texts, names, num);
     r |= wavelets->ISNewText(dev, name, texts, names, num);
+    r |= stacker->ISNewText(dev, name, texts, names, num);
+    r |= calibration->ISNewText(dev, name, texts, names, num);
     return r;
 }
 
@@ -99,7 +114,10 @@ bool Manager::ISNewNumber(const char *dev, const char *name, double values[], ch
     r |= idft->ISNewNumber(dev, name, values, names, num);
     r |= spectrum->ISNewNumber(dev, name, values, names, num);
     r |= histogram->ISNewNumber(dev, name, values, names, num);
+    r |= powerSpectrum->ISNewNumber(dev, name, values, names, num);
     r |= wavelets->ISNewNumber(dev, name, values, names, num);
+    r |= stacker->ISNewNumber(dev, name, values, names, num);
+    r |= calibration->ISNewNumber(dev, name, values, names, num);
     return r;
 }
 
@@ -112,7 +130,10 @@ bool Manager::ISNewBLOB(const char *dev, const char *name, int sizes[], int blob
     r |= idft->ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, num);
     r |= spectrum->ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, num);
     r |= histogram->ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, num);
+    r |= powerSpectrum->ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, num);
     r |= wavelets->ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, num);
+    r |= stacker->ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, num);
+    r |= calibration->ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, num);
     return r;
 }
 
@@ -124,10 +145,19 @@ bool Manager::saveConfigItems(FILE *fp)
     r |= idft->saveConfigItems(fp);
     r |= spectrum->saveConfigItems(fp);
     r |= histogram->saveConfigItems(fp);
+    r |= powerSpectrum->saveConfigItems(fp);
     r |= wavelets->saveConfigItems(fp);
+    r |= stacker->saveConfigItems(fp);
+    r |= calibration->saveConfigItems(fp);
     return r;
 }
 
+bool Manager::isActive() const
+{
+    return convolution->isActive() || dft->isActive() || idft->isActive() || spectrum->isActive() ||
+           histogram->isActive() || powerSpectrum->isActive() || wavelets->isActive() || stacker->isActive();
+}
+
 bool Manager::processBLOB(uint8_t* buf, uint32_t ndims, int* dims, int bits_per_sample)
 {
     bool r = false;
@@ -136,9 +166,22 @@ bool Manager::processBLOB(uint8_t* buf, uint32_t ndims, int* dims, int bits_per_
     r |= idft->processBLOB(buf, ndims, dims, bits_per_sample);
     r |= spectrum->processBLOB(buf, ndims, dims, bits_per_sample);
     r |= histogram->processBLOB(buf, ndims, dims, bits_per_sample);
+    r |= powerSpectrum->processBLOB(buf, ndims, dims, bits_per_sample);
     r |= wavelets->processBLOB(buf, ndims, dims, bits_per_sample);
+    r |= stacker->processBLOB(buf, ndims, dims, bits_per_sample);
     return r;
 }
+
+bool Manager::calibrate(uint8_t *buf, int bits_per_sample, const Calibration::Frame &frame)
+{
+    return calibration->calibrate(buf, bits_per_sample, frame);
+}
+
+bool Manager::processStream(uint8_t* buf, int len, int bits_per_sample)
+{
+    return powerSpectrum->processStream(buf, len, bits_per_sample);
+}
+
 void Manager::setCaptureFileExtension(const char *ext)
 {
     convolution->setCaptureFileExtension(ext);
@@ -146,6 +189,8 @@ void Manager::setCaptureFileExtension(const char *ext)
     idft->setCaptureFileExtension(ext);
     spectrum->setCaptureFileExtension(ext);
     histogram->setCaptureFileExtension(ext);
+    powerSpectrum->setCaptureFileExtension(ext);
     wavelets->setCaptureFileExtension(ext);
+    stacker->setCaptureFileExtension(ext);
 }
 }
@@ -23,10 +23,13 @@
 #include "indidevapi.h"
 #include "convolution.h"
 #include "transforms.h"
+#include "stacker.h"
+#include "calibration.h"
 
 #include <fitsio.h>
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace INDI
 {
@@ -50,17 +53,52 @@ class Manager
         virtual bool saveConfigItems(FILE *fp);
         virtual bool updateProperties();
 
+        /**
+         * @brief isActive Whether any plugin was activated by the client.
+         * @return True if processBLOB has something to do, false otherwise.
+         */
+        bool isActive() const;
+
+        /**
+         * @brief processBLOB Hand a buffer to the active plugins. Each plugin converts it to its own stream, so
+         * the buffer is only read and does not need to outlive the call.
+         * @param buf The input buffer
+         * @param ndims Number of the dimensions of the input buffer
+         * @param dims Sizes of the dimensions of the input buffer
+         * @param bits_per_sample original bit depth of the input buffer
+         * @return True if any plugin processed the buffer, false otherwise.
+         */
         bool processBLOB(uint8_t* buf, uint32_t ndims, int* dims, int bits_per_sample);
 
-        inline void setSizes(uint32_t num, int* sizes)
+        /**
+         * @brief calibrate Calibrate a light frame in place with the masters of the calibration plugin, before
+         * processBLOB and the upload. Not counted by isActive, which is about the plugins publishing a result.
+         * @param buf Pixels of the frame, rows packed.
+         * @param bits_per_sample 8, 16, 32 or -32.
+         * @param frame Geometry, exposure, temperature and filter of the frame.
+         * @return True if the frame was calibrated, false otherwise.
+         */
+        bool calibrate(uint8_t *buf, int bits_per_sample, const Calibration::Frame &frame);
+
+        /**
+         * @brief processStream Hand samples of a continuous capture to the plugins integrating them as they
+         * come. The buffer is only read.
+         * @param buf The samples
+         * @param len Number of samples
+         * @param bits_per_sample Sample size
+         * @return True if any plugin published a result, false otherwise.
+         */
+        bool processStream(uint8_t* buf, int len, int bits_per_sample);
+
+        // The sizes are copied
+        inline void setSizes(uint32_t num, const int* sizes)
         {
-            BufferSizes = sizes;
-            BufferSizesQty = num;
+            BufferSizes.assign(sizes, sizes + num);
         }
         inline void getSizes(uint32_t *num, int** sizes)
         {
-            *sizes = BufferSizes;
-            *num = BufferSizesQty;
+            *sizes = BufferSizes.data();
+            *num = BufferSizes.size();
         }
 
         inline void setBPS(int bps)
@@ -80,9 +118,11 @@ class Manager
         InverseFourierTransform *idft;
         Spectrum *spectrum;
         Histogram *histogram;
+        PowerSpectrum *powerSpectrum;
         Wavelets *wavelets;
-        uint32_t BufferSizesQty;
-        int *BufferSizes;
-        int BPS;
+        Stacker *stacker;
+        Calibration *calibration;
+        std::vector<int> BufferSizes;
+        int BPS { 16 };
 };
 }
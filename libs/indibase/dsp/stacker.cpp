@@ -0,0 +1,195 @@
+/*******************************************************************************
+  Copyright(c) 2017 Ilia Platone, Jasem Mutlaq. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "stacker.h"
+#include "indistandardproperty.h"
+#include "indicom.h"
+#include "indilogger.h"
+#include "defaultdevice.h"
+
+#include <cmath>
+#include <cstring>
+
+// Smallest objects taken as stars, in pixels
+#define STACKER_MIN_AREA 5
+// Decimals and score in percent the stars of a frame must match those of the reference with
+#define STACKER_ALIGN_TOLERANCE 3
+#define STACKER_ALIGN_SCORE 90
+// Frames a pixel is taken from before its deviation is trusted for clipping
+#define STACKER_CLIP_FRAMES 3
+
+namespace DSP
+{
+extern const char *DSP_TAB;
+
+Stacker::Stacker(INDI::DefaultDevice *dev) : Interface(dev, DSP_STACKER, "STACKER", "Live Stacking")
+{
+    IUFillNumber(&StackerN[STACKER_THRESHOLD], "STACKER_THRESHOLD", "Star threshold (sigma)", "%3.1f", 1.0, 100.0, 0.5, 5.0);
+    IUFillNumber(&StackerN[STACKER_KAPPA], "STACKER_KAPPA", "Clipping (sigma, 0 = off)", "%3.1f", 0.0, 10.0, 0.5, 3.0);
+    IUFillNumber(&StackerN[STACKER_PUBLISH], "STACKER_PUBLISH", "Publish every (frames)", "%.f", 1.0, 1000.0, 1.0, 1.0);
+    IUFillNumberVector(&StackerNP, StackerN, STACKER_N, m_Device->getDeviceName(), "STACKER_SETTINGS", "Stacking", DSP_TAB,
+                       IP_RW, 60, IPS_IDLE);
+
+    IUFillSwitch(&ResetS[0], "STACKER_RESET", "Reset", ISS_OFF);
+    IUFillSwitchVector(&ResetSP, ResetS, 1, m_Device->getDeviceName(), "STACKER_RESET", "Stack", DSP_TAB, IP_RW,
+                       ISR_ATMOST1, 60, IPS_IDLE);
+
+    IUFillNumber(&FramesN[0], "STACKER_STACKED", "Stacked", "%.f", 0.0, 1.0e9, 0.0, 0.0);
+    IUFillNumber(&FramesN[1], "STACKER_DROPPED", "Dropped", "%.f", 0.0, 1.0e9, 0.0, 0.0);
+    IUFillNumberVector(&FramesNP, FramesN, 2, m_Device->getDeviceName(), "STACKER_FRAMES", "Frames", DSP_TAB, IP_RO, 60,
+                       IPS_IDLE);
+}
+
+Stacker::~Stacker()
+{
+    Reset();
+}
+
+void Stacker::Activated()
+{
+    m_Device->defineProperty(&StackerNP);
+    m_Device->defineProperty(&ResetSP);
+    m_Device->defineProperty(&FramesNP);
+    Interface::Activated();
+}
+
+void Stacker::Deactivated()
+{
+    m_Device->deleteProperty(StackerNP.name);
+    m_Device->deleteProperty(ResetSP.name);
+    m_Device->deleteProperty(FramesNP.name);
+    Reset();
+    Interface::Deactivated();
+}
+
+bool Stacker::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    Interface::ISNewSwitch(dev, name, states, names, n);
+    if (!strcmp(dev, getDeviceName()) && !strcmp(name, ResetSP.name))
+    {
+        Reset();
+        ResetS[0].s = ISS_OFF;
+        ResetSP.s = IPS_OK;
+        IDSetSwitch(&ResetSP, nullptr);
+        IDSetNumber(&FramesNP, nullptr);
+        return true;
+    }
+    return false;
+}
+
+bool Stacker::ISNewNumber(const char *dev, const char *name, double *values, char *names[], int n)
+{
+    if (!strcmp(dev, getDeviceName()) && !strcmp(name, StackerNP.name))
+    {
+        IUUpdateNumber(&StackerNP, values, names, n);
+        StackerNP.s = IPS_OK;
+        IDSetNumber(&StackerNP, nullptr);
+        return true;
+    }
+    return false;
+}
+
+void Stacker::Reset()
+{
+    if (reference != nullptr)
+    {
+        dsp_stream_free_buffer(reference);
+        dsp_stream_free(reference);
+        reference = nullptr;
+    }
+    mean.clear();
+    mean.shrink_to_fit();
+    deviation.clear();
+    deviation.shrink_to_fit();
+    count.clear();
+    count.shrink_to_fit();
+    FramesN[0].value = 0;
+    FramesN[1].value = 0;
+}
+
+bool Stacker::Align()
+{
+    if (dsp_detect_stars(stream, StackerN[STACKER_THRESHOLD].value, STACKER_MIN_AREA) < 3)
+        return false;
+    // The first frame with enough stars is the reference the next ones are aligned to
+    if (reference == nullptr)
+    {
+        reference = dsp_stream_copy(stream);
+        mean.assign(stream->len, 0.0);
+        deviation.assign(stream->len, 0.0);
+        count.assign(stream->len, 0);
+        return true;
+    }
+    if (reference->dims != stream->dims)
+        return false;
+    for (int d = 0; d < stream->dims; d++)
+        if (reference->sizes[d] != stream->sizes[d])
+            return false;
+    int err = dsp_align_get_offset(reference, stream, STACKER_ALIGN_TOLERANCE, STACKER_ALIGN_SCORE, 3);
+    bool matched = !(err & DSP_ALIGN_NO_MATCH);
+    if (matched && (err & (DSP_ALIGN_TRANSLATED | DSP_ALIGN_SCALED | DSP_ALIGN_ROTATED)))
+        dsp_stream_align(stream);
+    free(stream->align_info.center);
+    free(stream->align_info.factor);
+    free(stream->align_info.offset);
+    free(stream->align_info.radians);
+    memset(&stream->align_info, 0, sizeof(dsp_align_info));
+    return matched;
+}
+
+void Stacker::Accumulate()
+{
+    double kappa = StackerN[STACKER_KAPPA].value;
+    for (int i = 0; i < stream->len; i++)
+    {
+        double value = stream->buf[i];
+        uint32_t n = count[i];
+        double delta = value - mean[i];
+        if (kappa > 0.0 && n >= STACKER_CLIP_FRAMES)
+        {
+            double sigma = sqrt(deviation[i] / (n - 1));
+            if (fabs(delta) > kappa * sigma)
+                continue;
+        }
+        // Welford's update keeps the mean and the squared deviations exact without the frames
+        count[i] = ++n;
+        mean[i] += delta / n;
+        deviation[i] += delta * (value - mean[i]);
+    }
+}
+
+bool Stacker::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    if(!PluginActive) return false;
+    setStream(buf, dims, sizes, bits_per_sample);
+    if (!Align())
+    {
+        FramesN[1].value++;
+        IDSetNumber(&FramesNP, nullptr);
+        LOGF_WARN("%s: frame dropped, its stars do not match the reference.", m_Label);
+        return false;
+    }
+    Accumulate();
+    FramesN[0].value++;
+    IDSetNumber(&FramesNP, nullptr);
+    if (static_cast<int>(FramesN[0].value - 1) % static_cast<int>(StackerN[STACKER_PUBLISH].value) != 0)
+        return true;
+    dsp_buffer_copy(mean.data(), stream->buf, stream->len);
+    return Interface::processBLOB(getStream(), stream->dims, stream->sizes, bits_per_sample);
+}
+}
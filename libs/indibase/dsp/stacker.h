@@ -0,0 +1,77 @@
+/*******************************************************************************
+  Copyright(c) 2017 Ilia Platone, Jasem Mutlaq. All rights reserved.
+
+ DSP Live stacking plugin
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include "dspinterface.h"
+#include "dsp.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace DSP
+{
+/**
+ * @brief The Stacker class aligns every frame to the first one by its stars and keeps their running mean.
+ *
+ * Frames whose stars do not match those of the reference frame are dropped. Each pixel holds its mean, the
+ * sum of its squared deviations and the count of the frames it was taken from, so a pixel further than
+ * kappa standard deviations from its mean is left out of it. The mean is published every few frames.
+ */
+class Stacker : public Interface
+{
+    public:
+        Stacker(INDI::DefaultDevice *dev);
+        bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+        bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+        virtual bool processBLOB(uint8_t *out, uint32_t dims, int *sizes, int bits_per_sample) override;
+
+    protected:
+        ~Stacker();
+        void Activated() override;
+        void Deactivated() override;
+
+    private:
+        enum
+        {
+            STACKER_THRESHOLD,
+            STACKER_KAPPA,
+            STACKER_PUBLISH,
+            STACKER_N,
+        };
+        INumberVectorProperty StackerNP;
+        INumber StackerN[STACKER_N];
+
+        ISwitchVectorProperty ResetSP;
+        ISwitch ResetS[1];
+
+        INumberVectorProperty FramesNP;
+        INumber FramesN[2];
+
+        void Reset();
+        bool Align();
+        void Accumulate();
+
+        dsp_stream_p reference { nullptr };
+        std::vector<double> mean;
+        std::vector<double> deviation;
+        std::vector<uint32_t> count;
+};
+}
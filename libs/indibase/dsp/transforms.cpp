@@ -28,6 +28,8 @@
 #include <algorithm>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <numeric>
 
 namespace DSP
 {
@@ -128,10 +130,150 @@ bool Spectrum::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per
 
     dsp_fourier_dft(stream, 1);
     double *histo = dsp_stats_histogram(stream->magnitude, 4096);
-    return Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(histo)), 1, new int{4096}, -64);
+    int size = 4096;
+    bool rc = Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(histo)), 1, &size, -64);
+    free(histo);
+    return rc;
 }
 
 
+PowerSpectrum::PowerSpectrum(INDI::DefaultDevice *dev) : Interface(dev, DSP_POWER_SPECTRUM, "POWER_SPECTRUM",
+            "Power Spectrum")
+{
+    IUFillNumber(&PowerN[POWER_FFT_LENGTH], "POWER_FFT_LENGTH", "FFT length (samples)", "%.f", 16.0, 1048576.0, 16.0, 1024.0);
+    IUFillNumber(&PowerN[POWER_BLOCKS], "POWER_BLOCKS", "Integrate (blocks)", "%.f", 1.0, 100000.0, 1.0, 16.0);
+    IUFillNumber(&PowerN[POWER_CHANNELS], "POWER_CHANNELS", "Channels", "%.f", 1.0, 524289.0, 1.0, 256.0);
+    IUFillNumberVector(&PowerNP, PowerN, POWER_N, m_Device->getDeviceName(), "POWER_SPECTRUM_SETTINGS", "Power Spectrum",
+                       DSP_TAB, IP_RW, 60, IPS_IDLE);
+    Setup();
+}
+
+PowerSpectrum::~PowerSpectrum()
+{
+    dsp_stream_free_buffer(block);
+    dsp_stream_free(block);
+}
+
+void PowerSpectrum::Activated()
+{
+    m_Device->defineProperty(&PowerNP);
+    Interface::Activated();
+}
+
+void PowerSpectrum::Deactivated()
+{
+    m_Device->deleteProperty(PowerNP.name);
+    std::lock_guard<std::mutex> guard(lock);
+    Reset(streamed);
+    Interface::Deactivated();
+}
+
+bool PowerSpectrum::ISNewNumber(const char *dev, const char *name, double *values, char *names[], int n)
+{
+    if (!strcmp(dev, getDeviceName()) && !strcmp(name, PowerNP.name))
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        IUUpdateNumber(&PowerNP, values, names, n);
+        Setup();
+        PowerNP.s = IPS_OK;
+        IDSetNumber(&PowerNP, nullptr);
+        return true;
+    }
+    return false;
+}
+
+void PowerSpectrum::Setup()
+{
+    int length = static_cast<int>(PowerN[POWER_FFT_LENGTH].value);
+    if (block != nullptr)
+    {
+        dsp_stream_free_buffer(block);
+        dsp_stream_free(block);
+    }
+    // The transforms of a length share one cached plan
+    block = dsp_stream_new();
+    dsp_stream_add_dim(block, length);
+    dsp_stream_alloc_buffer(block, block->len);
+
+    window.resize(length);
+    for (int i = 0; i < length; i++)
+        window[i] = 0.5 * (1.0 - cos(2.0 * M_PI * i / length));
+    bins.resize(length / 2 + 1);
+    Reset(streamed);
+}
+
+void PowerSpectrum::Reset(Integration &integration)
+{
+    integration.samples.clear();
+    integration.power.assign(bins.size(), 0.0);
+    integration.blocks = 0;
+}
+
+bool PowerSpectrum::Integrate(Integration &integration, const dsp_t *samples, int len)
+{
+    bool published = false;
+    size_t length = window.size();
+    size_t used = 0;
+    integration.samples.insert(integration.samples.end(), samples, samples + len);
+    for (; integration.samples.size() - used >= length; used += length)
+    {
+        const double *s = integration.samples.data() + used;
+        // The offset of unsigned samples would swamp the first channels
+        double mean = std::accumulate(s, s + length, 0.0) / length;
+        for (size_t i = 0; i < length; i++)
+            block->buf[i] = (s[i] - mean) * window[i];
+        dsp_fourier_power(block, bins.data());
+        for (size_t k = 0; k < bins.size(); k++)
+            integration.power[k] += bins[k];
+        if (++integration.blocks >= PowerN[POWER_BLOCKS].value)
+            published |= Publish(integration);
+    }
+    integration.samples.erase(integration.samples.begin(), integration.samples.begin() + used);
+    return published;
+}
+
+bool PowerSpectrum::Publish(Integration &integration)
+{
+    int nbins = static_cast<int>(bins.size());
+    int channels = std::min(static_cast<int>(PowerN[POWER_CHANNELS].value), nbins);
+    std::vector<double> spectrum(channels);
+    for (int c = 0; c < channels; c++)
+    {
+        int first = static_cast<int>(static_cast<long>(c) * nbins / channels);
+        int last  = static_cast<int>(static_cast<long>(c + 1) * nbins / channels);
+        double sum = std::accumulate(integration.power.begin() + first, integration.power.begin() + last, 0.0);
+        spectrum[c] = sum / ((last - first) * integration.blocks);
+    }
+    std::fill(integration.power.begin(), integration.power.end(), 0.0);
+    integration.blocks = 0;
+    return Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(spectrum.data())), 1, &channels, -64);
+}
+
+bool PowerSpectrum::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    if(!PluginActive) return false;
+    std::lock_guard<std::mutex> guard(lock);
+    if (!setStream(buf, dims, sizes, bits_per_sample))
+        return false;
+
+    // A capture is integrated on its own, what is left short of the blocks asked is published too
+    Integration integration;
+    Reset(integration);
+    bool published = Integrate(integration, stream->buf, stream->len);
+    if (integration.blocks > 0)
+        published |= Publish(integration);
+    return published;
+}
+
+bool PowerSpectrum::processStream(uint8_t *buf, int len, int bits_per_sample)
+{
+    if(!PluginActive) return false;
+    std::lock_guard<std::mutex> guard(lock);
+    if (!setStream(buf, 1, &len, bits_per_sample))
+        return false;
+    return Integrate(streamed, stream->buf, stream->len);
+}
+
 Histogram::Histogram(INDI::DefaultDevice *dev) : Interface(dev, DSP_HISTOGRAM, "HISTOGRAM", "Histogram")
 {
 }
@@ -146,6 +288,9 @@ bool Histogram::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_pe
     setStream(buf, dims, sizes, bits_per_sample);
 
     double *histo = dsp_stats_histogram(stream, 4096);
-    return Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(histo)), 1, new int{4096}, -64);
+    int size = 4096;
+    bool rc = Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(histo)), 1, &size, -64);
+    free(histo);
+    return rc;
 }
 }
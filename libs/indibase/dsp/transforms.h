@@ -23,7 +23,9 @@
 #include "dspinterface.h"
 #include "dsp.h"
 
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace DSP
 {
@@ -68,6 +70,66 @@ class Spectrum : public Interface
         ~Spectrum();
 };
 
+/**
+ * @brief The PowerSpectrum class integrates the power spectrum of a stream of samples.
+ *
+ * The samples are cut into blocks of the FFT length, each block has its mean removed and is weighted
+ * by a Hann window. The power of a number of blocks is averaged, its bins are averaged down to the
+ * channels requested and the spectrum is published. Samples streamed are carried over from a call to
+ * the next, so spectra keep coming while the capture goes on.
+ */
+class PowerSpectrum : public Interface
+{
+    public:
+        PowerSpectrum(INDI::DefaultDevice *dev);
+        bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+        virtual bool processBLOB(uint8_t *out, uint32_t dims, int *sizes, int bits_per_sample) override;
+
+        /**
+         * @brief processStream Add samples of a continuous capture. A spectrum is published each time the
+         * blocks it integrates are complete.
+         * @param buf The samples, only read
+         * @param len Number of samples
+         * @param bits_per_sample Sample size
+         * @return True if a spectrum was published, false otherwise.
+         */
+        bool processStream(uint8_t *buf, int len, int bits_per_sample);
+
+    protected:
+        ~PowerSpectrum();
+        void Activated() override;
+        void Deactivated() override;
+
+    private:
+        enum
+        {
+            POWER_FFT_LENGTH,
+            POWER_BLOCKS,
+            POWER_CHANNELS,
+            POWER_N,
+        };
+        INumberVectorProperty PowerNP;
+        INumber PowerN[POWER_N];
+
+        struct Integration
+        {
+            std::vector<double> samples;    /* short of a block */
+            std::vector<double> power;
+            int blocks { 0 };
+        };
+
+        void Setup();
+        void Reset(Integration &integration);
+        bool Integrate(Integration &integration, const dsp_t *samples, int len);
+        bool Publish(Integration &integration);
+
+        std::mutex lock;
+        dsp_stream_p block { nullptr };
+        std::vector<double> window;
+        std::vector<double> bins;
+        Integration streamed;
+};
+
 class Histogram : public Interface
 {
     public:
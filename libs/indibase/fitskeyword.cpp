@@ -133,6 +133,21 @@ int FITSRecord::decimal() const
     return m_decimal;
 }
 
+bool FITSRecord::operator==(const FITSRecord &other) const
+{
+    if (m_type != other.m_type || m_key != other.m_key || val_str != other.val_str || m_comment != other.m_comment)
+        return false;
+    switch (m_type)
+    {
+        case LONGLONG:
+            return val_int64 == other.val_int64;
+        case DOUBLE:
+            return val_double == other.val_double && m_decimal == other.m_decimal;
+        default:
+            return true;
+    }
+}
+
 }
 
 
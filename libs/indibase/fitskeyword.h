@@ -52,6 +52,8 @@ public:
     double valueDouble() const;
     const std::string& comment() const;
     int decimal() const;
+    /* Same key, type, value, comment and decimals */
+    bool operator==(const FITSRecord &other) const;
 private:
     union
     {
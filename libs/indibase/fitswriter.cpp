@@ -0,0 +1,392 @@
+/**  INDI LIB
+ *   Simple FITS image writer
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "fitswriter.h"
+
+#include "sharedblob.h"
+#include "indithreadpool.h"
+
+#include <fitsio.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace INDI
+{
+
+namespace
+{
+constexpr size_t BlockSize = 2880;
+constexpr size_t CardSize  = 80;
+
+// Samples per thread, below that swapping is faster than waking threads up
+constexpr size_t MinSamplesPerTask = 1 << 20;
+
+size_t padded(size_t size)
+{
+    return (size + BlockSize - 1) / BlockSize * BlockSize;
+}
+
+// The card padded to 80 columns
+std::string fitCard(const char *card)
+{
+    std::string out(card, strnlen(card, CardSize));
+    out.resize(CardSize, ' ');
+    return out;
+}
+
+std::string makeCard(const char *key, const char *value, const char *comment)
+{
+    char card[FLEN_CARD] = "";
+    int status = 0;
+    fits_make_key(key, value, comment, card, &status);
+    return fitCard(card);
+}
+
+// Name of a value card, empty for commentary ones which are never replaced
+std::string cardKey(const std::string &card)
+{
+    if (card.size() < 10 || card[8] != '=' || card[9] != ' ')
+        return "";
+    std::string key = card.substr(0, 8);
+    key.erase(key.find_last_not_of(' ') + 1);
+    return key;
+}
+
+/* Big endian samples, stored signed: the BZERO offset of 2^(bits - 1) flips the top bit */
+
+// Scalar loops, from sample first to last
+void swap16(const uint16_t *in, uint8_t *out, size_t first, size_t last)
+{
+    for (size_t i = first; i < last; i++)
+    {
+        uint16_t v = in[i] ^ 0x8000;
+        out[2 * i]     = v >> 8;
+        out[2 * i + 1] = v & 0xff;
+    }
+}
+
+void swap32(const uint32_t *in, uint8_t *out, size_t first, size_t last)
+{
+    for (size_t i = first; i < last; i++)
+    {
+        uint32_t v = in[i] ^ 0x80000000u;
+        out[4 * i]     = v >> 24;
+        out[4 * i + 1] = (v >> 16) & 0xff;
+        out[4 * i + 2] = (v >> 8) & 0xff;
+        out[4 * i + 3] = v & 0xff;
+    }
+}
+
+// SIMD loops return the first sample they did not do
+using SwapFn16 = size_t (*)(const uint16_t *, uint8_t *, size_t, size_t);
+using SwapFn32 = size_t (*)(const uint32_t *, uint8_t *, size_t, size_t);
+
+size_t swapNone16(const uint16_t *, uint8_t *, size_t first, size_t)
+{
+    return first;
+}
+
+size_t swapNone32(const uint32_t *, uint8_t *, size_t first, size_t)
+{
+    return first;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SWAP_X86
+
+__attribute__((target("sse2")))
+size_t swapSse2_16(const uint16_t *in, uint8_t *out, size_t first, size_t last)
+{
+    const __m128i sign = _mm_set1_epi16(-0x8000);
+    size_t i = first;
+    for (; i + 8 <= last; i += 8)
+    {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), sign);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+size_t swapSsse3_32(const uint32_t *in, uint8_t *out, size_t first, size_t last)
+{
+    const __m128i sign    = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i reverse = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = first;
+    for (; i + 4 <= last; i += 4)
+    {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), sign);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * i), _mm_shuffle_epi8(v, reverse));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t swapAvx2_16(const uint16_t *in, uint8_t *out, size_t first, size_t last)
+{
+    const __m256i sign    = _mm256_set1_epi16(-0x8000);
+    const __m256i reverse = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                             1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    size_t i = first;
+    for (; i + 16 <= last; i += 16)
+    {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)), sign);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i), _mm256_shuffle_epi8(v, reverse));
+    }
+    return swapSse2_16(in, out, i, last);
+}
+
+__attribute__((target("avx2")))
+size_t swapAvx2_32(const uint32_t *in, uint8_t *out, size_t first, size_t last)
+{
+    const __m256i sign    = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                             3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = first;
+    for (; i + 8 <= last; i += 8)
+    {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)), sign);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 4 * i), _mm256_shuffle_epi8(v, reverse));
+    }
+    return swapSsse3_32(in, out, i, last);
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define SWAP_NEON
+
+size_t swapNeon16(const uint16_t *in, uint8_t *out, size_t first, size_t last)
+{
+    const uint16x8_t sign = vdupq_n_u16(0x8000);
+    size_t i = first;
+    for (; i + 8 <= last; i += 8)
+    {
+        uint16x8_t v = veorq_u16(vld1q_u16(in + i), sign);
+        vst1q_u8(out + 2 * i, vrev16q_u8(vreinterpretq_u8_u16(v)));
+    }
+    return i;
+}
+
+size_t swapNeon32(const uint32_t *in, uint8_t *out, size_t first, size_t last)
+{
+    const uint32x4_t sign = vdupq_n_u32(0x80000000u);
+    size_t i = first;
+    for (; i + 4 <= last; i += 4)
+    {
+        uint32x4_t v = veorq_u32(vld1q_u32(in + i), sign);
+        vst1q_u8(out + 4 * i, vrev32q_u8(vreinterpretq_u8_u32(v)));
+    }
+    return i;
+}
+#endif
+
+// pick the swap loops for this CPU, once
+struct SwapLoops
+{
+    SwapFn16 swap16 { swapNone16 };
+    SwapFn32 swap32 { swapNone32 };
+
+    SwapLoops()
+    {
+#if defined(SWAP_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            swap16 = swapAvx2_16;
+            swap32 = swapAvx2_32;
+        }
+        else
+        {
+            if (__builtin_cpu_supports("sse2"))
+                swap16 = swapSse2_16;
+            if (__builtin_cpu_supports("ssse3"))
+                swap32 = swapSsse3_32;
+        }
+#elif defined(SWAP_NEON)
+        swap16 = swapNeon16;
+        swap32 = swapNeon32;
+#endif
+    }
+};
+
+const SwapLoops &swapLoops()
+{
+    static const SwapLoops loops;
+    return loops;
+}
+}
+
+FITSImageWriter::FITSImageWriter(uint32_t width, uint32_t height, uint32_t channels, int bpp)
+    : m_Width(width), m_Height(height), m_Channels(channels), m_BPP(bpp)
+{
+}
+
+void FITSImageWriter::setCards(const std::vector<std::string> &cards)
+{
+    m_Cards = cards;
+}
+
+bool FITSImageWriter::supported(uint32_t channels, int bpp)
+{
+    return (channels == 1 || channels == 3) && (bpp == 8 || bpp == 16 || bpp == 32);
+}
+
+std::string FITSImageWriter::card(const FITSRecord &keyword, int &status)
+{
+    char value[FLEN_VALUE] = "";
+    switch (keyword.type())
+    {
+        case FITSRecord::VOID:
+            return "";
+
+        case FITSRecord::COMMENT:
+        {
+            // 72 characters per card, like fits_write_comment
+            const std::string &text = keyword.comment();
+            std::string cards;
+            size_t offset = 0;
+            do
+            {
+                cards += fitCard(("COMMENT " + text.substr(offset, 72)).c_str());
+                offset += 72;
+            }
+            while (offset < text.size());
+            return cards;
+        }
+
+        case FITSRecord::STRING:
+            ffs2c(keyword.valueString().c_str(), value, &status);
+            break;
+        case FITSRecord::LONGLONG:
+            ffi2c(keyword.valueInt(), value, &status);
+            break;
+        case FITSRecord::DOUBLE:
+            ffd2e(keyword.valueDouble(), keyword.decimal(), value, &status);
+            break;
+    }
+
+    char card[FLEN_CARD] = "";
+    fits_make_key(keyword.key().c_str(), value, keyword.comment().c_str(), card, &status);
+    return status ? "" : fitCard(card);
+}
+
+std::string FITSImageWriter::header() const
+{
+    // What fits_create_img writes for the primary image
+    std::vector<std::string> cards;
+    cards.push_back(makeCard("SIMPLE", "T", "file does conform to FITS standard"));
+    cards.push_back(makeCard("BITPIX", std::to_string(m_BPP).c_str(), "number of bits per data pixel"));
+    cards.push_back(makeCard("NAXIS", m_Channels == 3 ? "3" : "2", "number of data axes"));
+    cards.push_back(makeCard("NAXIS1", std::to_string(m_Width).c_str(), "length of data axis 1"));
+    cards.push_back(makeCard("NAXIS2", std::to_string(m_Height).c_str(), "length of data axis 2"));
+    if (m_Channels == 3)
+        cards.push_back(makeCard("NAXIS3", "3", "length of data axis 3"));
+    cards.push_back(makeCard("EXTEND", "T", "FITS dataset may contain extensions"));
+    cards.push_back(fitCard("COMMENT   FITS (Flexible Image Transport System) format is defined in 'Astronomy"));
+    cards.push_back(fitCard("COMMENT   and Astrophysics', volume 376, page 359; bibcode: 2001A&A...376..359H"));
+    if (m_BPP == 16)
+        cards.push_back(makeCard("BZERO", "32768", "offset data range to that of unsigned short"));
+    else if (m_BPP == 32)
+        cards.push_back(makeCard("BZERO", "2147483648", "offset data range to that of unsigned long"));
+    if (m_BPP != 8)
+        cards.push_back(makeCard("BSCALE", "1", "default scaling factor"));
+
+    for (auto &group : m_Cards)
+    {
+        for (size_t offset = 0; offset < group.size(); offset += CardSize)
+        {
+            std::string card = group.substr(offset, CardSize);
+            std::string key  = cardKey(card);
+            auto existing = key.empty() ? cards.end() : std::find_if(cards.begin(), cards.end(), [&key](const std::string & c)
+            {
+                return cardKey(c) == key;
+            });
+            if (existing != cards.end())
+                *existing = card;
+            else
+                cards.push_back(card);
+        }
+    }
+    cards.push_back(fitCard("END"));
+
+    std::string out;
+    out.reserve(padded(cards.size() * CardSize));
+    for (auto &card : cards)
+        out += card;
+    out.resize(padded(out.size()), ' ');
+    return out;
+}
+
+bool FITSImageWriter::write(const void *pixels, void **data, size_t *size)
+{
+    if (!supported(m_Channels, m_BPP))
+    {
+        m_Error = "Unsupported image: " + std::to_string(m_Channels) + " channels of " + std::to_string(m_BPP) + " bits";
+        return false;
+    }
+
+    const std::string head = header();
+    const size_t samples   = static_cast<size_t>(m_Width) * m_Height * m_Channels;
+    const size_t bytes     = samples * (m_BPP / 8);
+    const size_t total     = head.size() + padded(bytes);
+
+    uint8_t *file = static_cast<uint8_t *>(IDSharedBlobAlloc(total));
+    if (file == nullptr)
+    {
+        m_Error = "Failed to allocate memory for FITS file.";
+        return false;
+    }
+
+    memcpy(file, head.data(), head.size());
+    uint8_t *out = file + head.size();
+    switch (m_BPP)
+    {
+        case 8:
+            memcpy(out, pixels, bytes);
+            break;
+
+        case 16:
+            ThreadPool::global().forEach(samples, MinSamplesPerTask, [pixels, out](size_t first, size_t last)
+            {
+                const uint16_t *in = static_cast<const uint16_t *>(pixels);
+                swap16(in, out, swapLoops().swap16(in, out, first, last), last);
+            });
+            break;
+
+        case 32:
+            ThreadPool::global().forEach(samples, MinSamplesPerTask, [pixels, out](size_t first, size_t last)
+            {
+                const uint32_t *in = static_cast<const uint32_t *>(pixels);
+                swap32(in, out, swapLoops().swap32(in, out, first, last), last);
+            });
+            break;
+    }
+    memset(out + bytes, 0, total - head.size() - bytes);
+
+    *data = file;
+    *size = total;
+    return true;
+}
+
+}
@@ -0,0 +1,92 @@
+/**  INDI LIB
+ *   Simple FITS image writer
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+#include "fitskeyword.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The FITSImageWriter class writes a FITS file made of a single primary image of unsigned samples.
+ *
+ * Such a file is only header blocks followed by the big endian samples, so it is built straight into
+ * a shared blob: the header cards are copied, then the samples are byte swapped, with the BZERO offset
+ * of 16 and 32 bit images applied in the same pass, on several threads. The mandatory cards are the
+ * ones cfitsio writes for the same image, anything more complex is left to cfitsio.
+ */
+class FITSImageWriter
+{
+    public:
+        /**
+         * @param width image width in pixels
+         * @param height image height in pixels
+         * @param channels 1 for gray, 3 for planar RGB
+         * @param bpp 8, 16 or 32 bits unsigned samples
+         */
+        FITSImageWriter(uint32_t width, uint32_t height, uint32_t channels, int bpp);
+
+        /**
+         * @brief setCards Header cards following the mandatory ones, as rendered by card(). A card with
+         * the key of an earlier one replaces it, like fits_update_card does.
+         */
+        void setCards(const std::vector<std::string> &cards);
+
+        /**
+         * @brief write Encode the image.
+         * @param pixels width * height * channels samples.
+         * @param data set to a buffer from IDSharedBlobAlloc holding the file, free it with IDSharedBlobFree.
+         * @param size set to the file size.
+         * @return True on success, false otherwise with errorMessage() set.
+         */
+        bool write(const void *pixels, void **data, size_t *size);
+
+        const std::string &errorMessage() const
+        {
+            return m_Error;
+        }
+
+        /**
+         * @return True if images with these channels and bits per sample can be written.
+         */
+        static bool supported(uint32_t channels, int bpp);
+
+        /**
+         * @brief card Render keyword the way fits_update_key_* and fits_write_comment do.
+         * @return the header cards, 80 columns each, or nothing with status set on error.
+         */
+        static std::string card(const FITSRecord &keyword, int &status);
+
+    private:
+        std::string header() const;
+
+        uint32_t m_Width;
+        uint32_t m_Height;
+        uint32_t m_Channels;
+        int m_BPP;
+        std::vector<std::string> m_Cards;
+        std::string m_Error;
+};
+
+}
@@ -0,0 +1,251 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "fxcorrelator.h"
+#include "indithreadpool.h"
+
+#include <fftw3.h>
+
+#include <algorithm>
+#include <mutex>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FX_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define FX_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+// Blocks transformed before their baselines are accumulated
+const size_t BATCH_BLOCKS = 32;
+
+// Below this many values, a thread costs more than it saves
+const size_t MIN_WORK_PER_THREAD = 65536;
+
+// The FFTW planner is not thread safe
+std::mutex planMutex;
+
+// Loops of acc += a * conj(b) on interleaved complex values, returning the number of values done
+
+#if defined(FX_X86)
+__attribute__((target("sse2")))
+size_t macSse2(const double *a, const double *b, double *acc, size_t count)
+{
+    const __m128d sign = _mm_set_pd(-0.0, 0.0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128d x = _mm_loadu_pd(a + 2 * i);
+        __m128d y = _mm_loadu_pd(b + 2 * i);
+        // [ar br, ai br] + [ai bi, -ar bi]
+        __m128d re = _mm_mul_pd(x, _mm_unpacklo_pd(y, y));
+        __m128d im = _mm_mul_pd(_mm_shuffle_pd(x, x, 1), _mm_unpackhi_pd(y, y));
+        _mm_storeu_pd(acc + 2 * i, _mm_add_pd(_mm_loadu_pd(acc + 2 * i), _mm_add_pd(re, _mm_xor_pd(im, sign))));
+    }
+    return count;
+}
+
+__attribute__((target("avx2,fma")))
+size_t macAvx2(const double *a, const double *b, double *acc, size_t count)
+{
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256d x = _mm256_loadu_pd(a + 2 * i);
+        __m256d y = _mm256_loadu_pd(b + 2 * i);
+        __m256d im = _mm256_mul_pd(_mm256_permute_pd(x, 0x5), _mm256_permute_pd(y, 0xf));
+        // even lanes ar br + ai bi, odd lanes ai br - ar bi
+        __m256d product = _mm256_fmsubadd_pd(x, _mm256_movedup_pd(y), im);
+        _mm256_storeu_pd(acc + 2 * i, _mm256_add_pd(_mm256_loadu_pd(acc + 2 * i), product));
+    }
+    return i;
+}
+#elif defined(FX_NEON)
+size_t macNeon(const double *a, const double *b, double *acc, size_t count)
+{
+    const double signs[2] = { 1.0, -1.0 };
+    const float64x2_t sign = vld1q_f64(signs);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float64x2_t x = vld1q_f64(a + 2 * i);
+        float64x2_t y = vld1q_f64(b + 2 * i);
+        float64x2_t im = vmulq_f64(vmulq_f64(vextq_f64(x, x, 1), vdupq_laneq_f64(y, 1)), sign);
+        vst1q_f64(acc + 2 * i, vaddq_f64(vld1q_f64(acc + 2 * i), vfmaq_f64(im, x, vdupq_laneq_f64(y, 0))));
+    }
+    return count;
+}
+#endif
+
+typedef size_t (*MacFn)(const double *, const double *, double *, size_t);
+
+size_t macNone(const double *, const double *, double *, size_t)
+{
+    return 0;
+}
+
+// pick the SIMD loop for this CPU, once
+MacFn macLoop()
+{
+    static const MacFn loop = []()
+    {
+#if defined(FX_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return macAvx2;
+        if (__builtin_cpu_supports("sse2"))
+            return macSse2;
+#elif defined(FX_NEON)
+        return macNeon;
+#endif
+        return macNone;
+    }();
+    return loop;
+}
+
+void multiplyAccumulate(const double *a, const double *b, double *acc, size_t count)
+{
+    for (size_t i = macLoop()(a, b, acc, count); i < count; i++)
+    {
+        double ar = a[2 * i], ai = a[2 * i + 1];
+        double br = b[2 * i], bi = b[2 * i + 1];
+        acc[2 * i]     += ar * br + ai * bi;
+        acc[2 * i + 1] += ai * br - ar * bi;
+    }
+}
+
+}
+
+namespace INDI
+{
+
+FXCorrelator::FXCorrelator(size_t inputs, size_t lags)
+    : inputs(std::max<size_t>(inputs, 2)), lags(std::max<size_t>(lags, 1))
+{
+    spectra.resize(BATCH_BLOCKS * this->inputs * (this->lags + 1) * 2);
+    visibilities.assign(getBaselines() * this->lags * 2, 0.0);
+
+    // Out of place real transforms keep their input, unaligned ones take any block of any input
+    std::vector<double> block(getBlockSize());
+    std::lock_guard<std::mutex> lock(planMutex);
+    plan = fftw_plan_dft_r2c_1d(static_cast<int>(getBlockSize()), block.data(),
+                                reinterpret_cast<fftw_complex *>(spectra.data()), FFTW_ESTIMATE | FFTW_UNALIGNED);
+}
+
+FXCorrelator::~FXCorrelator()
+{
+    std::lock_guard<std::mutex> lock(planMutex);
+    fftw_destroy_plan(plan);
+}
+
+void FXCorrelator::setThreads(unsigned int t)
+{
+    threads = t;
+}
+
+template <typename Fn>
+void FXCorrelator::forEachRange(size_t count, size_t minPerThread, Fn fn) const
+{
+    ThreadPool::global().forEach(count, minPerThread, fn, threads);
+}
+
+size_t FXCorrelator::accumulate(const double *const *samples, size_t count)
+{
+    const size_t blockSize = getBlockSize();
+    const size_t bins      = lags + 1;
+    const size_t total     = count / blockSize;
+
+    for (size_t first = 0; first < total; first += BATCH_BLOCKS)
+    {
+        const size_t batch = std::min(BATCH_BLOCKS, total - first);
+
+        // F: the spectrum of every block of every input
+        forEachRange(batch * inputs, MIN_WORK_PER_THREAD / blockSize, [&](size_t begin, size_t end)
+        {
+            for (size_t job = begin; job < end; job++)
+            {
+                const double *block = samples[job % inputs] + (first + job / inputs) * blockSize;
+                fftw_execute_dft_r2c(plan, const_cast<double *>(block),
+                                     reinterpret_cast<fftw_complex *>(&spectra[job * bins * 2]));
+            }
+        });
+
+        // X: multiply and accumulate the spectra of every baseline
+        forEachRange(getBaselines(), MIN_WORK_PER_THREAD / (batch * lags), [&](size_t begin, size_t end)
+        {
+            size_t baseline = 0;
+            for (size_t a = 0; a < inputs; a++)
+                for (size_t b = a + 1; b < inputs; b++, baseline++)
+                {
+                    if (baseline < begin || baseline >= end)
+                        continue;
+
+                    double *acc = &visibilities[baseline * lags * 2];
+                    for (size_t block = 0; block < batch; block++)
+                        multiplyAccumulate(&spectra[(block * inputs + a) * bins * 2],
+                                           &spectra[(block * inputs + b) * bins * 2], acc, lags);
+                }
+        });
+
+        blocks += batch;
+    }
+
+    return total;
+}
+
+std::vector<double> FXCorrelator::getVisibilities(size_t baseline) const
+{
+    std::vector<double> result(lags * 2, 0.0);
+    if (baseline >= getBaselines() || blocks == 0)
+        return result;
+
+    const double scale = 1.0 / blocks;
+    const double *acc  = &visibilities[baseline * lags * 2];
+    for (size_t i = 0; i < result.size(); i++)
+        result[i] = acc[i] * scale;
+    return result;
+}
+
+std::vector<double> FXCorrelator::getVisibilities() const
+{
+    std::vector<double> result;
+    result.reserve(visibilities.size());
+    for (size_t baseline = 0; baseline < getBaselines(); baseline++)
+    {
+        auto values = getVisibilities(baseline);
+        result.insert(result.end(), values.begin(), values.end());
+    }
+    return result;
+}
+
+void FXCorrelator::reset()
+{
+    std::fill(visibilities.begin(), visibilities.end(), 0.0);
+    blocks = 0;
+}
+
+size_t FXCorrelator::getBaseline(size_t a, size_t b) const
+{
+    if (a > b)
+        std::swap(a, b);
+    return a * (2 * inputs - a - 1) / 2 + (b - a - 1);
+}
+
+}
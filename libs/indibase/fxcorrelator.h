@@ -0,0 +1,135 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct fftw_plan_s;
+
+namespace INDI
+{
+
+/**
+ * \class FXCorrelator
+ * \brief Cross-correlation of several streams of real samples, Fourier transforming each input
+ * then multiplying and accumulating the spectra of every baseline.
+ *
+ * Samples are cut in blocks of twice the lag count. The spectrum of a block gives one complex
+ * visibility per lag channel, the Nyquist bin is left out. Visibilities are accumulated over blocks
+ * until reset(), and averaged when read.
+ *
+ * Blocks are processed in batches: the inputs of a batch are transformed in parallel, then the
+ * baselines are shared among threads. The multiply-accumulate loop uses AVX2/FMA, SSE2 or NEON
+ * where available.
+ */
+class FXCorrelator
+{
+    public:
+        /**
+         * @param inputs number of sample streams, at least 2
+         * @param lags visibility channels per baseline, blocks of 2 * lags samples are transformed
+         */
+        FXCorrelator(size_t inputs, size_t lags);
+        ~FXCorrelator();
+
+        FXCorrelator(const FXCorrelator &) = delete;
+        FXCorrelator &operator=(const FXCorrelator &) = delete;
+
+    public:
+        /**
+         * @brief Accumulate the visibilities of the whole blocks of samples of every input
+         * @param samples one array of count samples per input
+         * @param count samples per input, trailing samples short of a block are ignored
+         * @return the number of blocks accumulated
+         */
+        size_t accumulate(const double *const *samples, size_t count);
+
+        /**
+         * @brief Visibilities of one baseline averaged over the accumulated blocks
+         * @return lags complex values, real and imaginary parts interleaved
+         */
+        std::vector<double> getVisibilities(size_t baseline) const;
+
+        /**
+         * @brief Visibilities of all baselines in baseline order, as getVisibilities(baseline)
+         */
+        std::vector<double> getVisibilities() const;
+
+        /**
+         * @brief Drop the accumulated visibilities
+         */
+        void reset();
+
+        /**
+         * @brief Index of the baseline between inputs a and b, a < b. Baselines are ordered
+         * (0,1), (0,2) ... (0,n-1), (1,2) ...
+         */
+        size_t getBaseline(size_t a, size_t b) const;
+
+        /**
+         * @brief Number of threads used, 0 (the default) for all those of ThreadPool::global()
+         */
+        void setThreads(unsigned int threads);
+
+        size_t getInputs() const
+        {
+            return inputs;
+        }
+
+        size_t getLags() const
+        {
+            return lags;
+        }
+
+        size_t getBaselines() const
+        {
+            return inputs * (inputs - 1) / 2;
+        }
+
+        size_t getBlockSize() const
+        {
+            return 2 * lags;
+        }
+
+        /**
+         * @brief Number of blocks accumulated since the last reset
+         */
+        uint64_t getBlocks() const
+        {
+            return blocks;
+        }
+
+    protected:
+        template <typename Fn>
+        void forEachRange(size_t count, size_t minPerThread, Fn fn) const;
+
+        size_t inputs;
+        size_t lags;
+        unsigned int threads {0};
+        uint64_t blocks {0};
+
+        // FFTW plan of one block, executed on any input
+        fftw_plan_s *plan {nullptr};
+        // Spectra of a batch of blocks, block after block, input after input, lags + 1 bins each
+        std::vector<double> spectra;
+        // Accumulated visibilities, baseline after baseline
+        std::vector<double> visibilities;
+};
+
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "handlerprofile.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace INDI
+{
+
+void HandlerProfile::add(const std::string &handler, double ms)
+{
+    double us = std::max(ms, 0.0) * 1000;
+    size_t bucket = us < 2 ? 0 : std::min<size_t>(BUCKETS - 1, static_cast<size_t>(std::log2(us)));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats &stats = mStats[handler];
+    stats.count++;
+    stats.total += ms;
+    stats.max = std::max(stats.max, ms);
+    stats.histogram[bucket]++;
+}
+
+void HandlerProfile::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.clear();
+}
+
+std::vector<HandlerProfile::Entry> HandlerProfile::report() const
+{
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto &it : mStats)
+        {
+            const Stats &stats = it.second;
+            // Upper bound of the bucket holding the given fraction of the calls, no more than the slowest call
+            auto percentile = [&stats](double fraction)
+            {
+                uint64_t rank = std::max<uint64_t>(1, std::ceil(fraction * stats.count));
+                uint64_t count = 0;
+                size_t bucket = 0;
+                for (; bucket < BUCKETS - 1; bucket++)
+                    if ((count += stats.histogram[bucket]) >= rank)
+                        break;
+                return std::min(std::ldexp(1.0, bucket + 1) / 1000, stats.max);
+            };
+
+            Entry entry;
+            entry.handler = it.first;
+            entry.count   = stats.count;
+            entry.total   = stats.total;
+            entry.median  = percentile(0.5);
+            entry.p99     = percentile(0.99);
+            entry.max     = stats.max;
+            entries.push_back(entry);
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+    {
+        return a.total > b.total;
+    });
+    return entries;
+}
+
+HandlerProfile::Scope::Scope(HandlerProfile *profile, const char *handler, const char *name)
+    : mProfile(profile)
+{
+    if (mProfile == nullptr)
+        return;
+    mHandler = handler;
+    if (name != nullptr)
+        mHandler.append(" ").append(name);
+    mStart = std::chrono::steady_clock::now();
+}
+
+HandlerProfile::Scope::~Scope()
+{
+    if (mProfile != nullptr)
+        mProfile->add(mHandler, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count());
+}
+
+}
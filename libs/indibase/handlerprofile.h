@@ -0,0 +1,105 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief Call counts and latency histograms of the handlers of a driver, such as TimerHit or
+ * the ISNewNumber of one property. Calls are added from any thread.
+ *
+ * Latencies are counted in power of two buckets of microseconds, percentiles are reported as the
+ * upper bound of their bucket.
+ */
+class HandlerProfile
+{
+    public:
+        /**
+         * @brief Add one call of a handler
+         * @param handler name of the handler
+         * @param ms time spent in the call in milliseconds
+         */
+        void add(const std::string &handler, double ms);
+
+        /**
+         * @brief Forget all calls
+         */
+        void reset();
+
+    public:
+        struct Entry
+        {
+            std::string handler;
+            uint64_t count = 0;
+            double total = 0;
+            double median = 0;
+            double p99 = 0;
+            double max = 0;
+        };
+
+        /**
+         * @brief Statistics of every handler called, the most total time first
+         */
+        std::vector<Entry> report() const;
+
+    public:
+        /**
+         * @brief Times its scope and adds it to the profile as handler, followed by name when given.
+         * Does nothing without a profile.
+         */
+        class Scope
+        {
+            public:
+                Scope(HandlerProfile *profile, const char *handler, const char *name = nullptr);
+                ~Scope();
+
+                Scope(const Scope &) = delete;
+                Scope &operator=(const Scope &) = delete;
+
+            private:
+                HandlerProfile *mProfile;
+                std::string mHandler;
+                std::chrono::steady_clock::time_point mStart;
+        };
+
+    private:
+        // 1 us to 16 s, slower calls land in the last bucket
+        static constexpr size_t BUCKETS = 25;
+
+        struct Stats
+        {
+            uint64_t count = 0;
+            double total = 0;
+            double max = 0;
+            std::array<uint64_t, BUCKETS> histogram {};
+        };
+
+        mutable std::mutex mMutex;
+        std::map<std::string, Stats> mStats;
+};
+
+}
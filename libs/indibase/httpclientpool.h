@@ -0,0 +1,163 @@
+/*******************************************************************************
+ HTTP client pool for the HTTP and Alpaca based drivers.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <httplib.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace INDI
+{
+/**
+ * @brief The HTTPClientPool class keeps the httplib clients of a driver alive between requests.
+ *
+ * A client is leased for one or more requests and goes back to the pool when the lease is destroyed.
+ * The clients are kept per host with keep-alive enabled, so the next request to the same host
+ * reuses the open TCP connection, and TLS session for https, instead of connecting again.
+ * httplib reconnects on its own when the server closed an idle connection.
+ *
+ * A lease is used by one thread at a time, requests made in parallel get their own clients.
+ *
+ * \code{cpp}
+ * auto cli = INDI::HTTPClientPool::instance().acquire(tcpConnection->host(), tcpConnection->port());
+ * auto result = cli->Get("/mount/stop");
+ * \endcode
+ */
+class HTTPClientPool
+{
+    public:
+        /** Connection and read timeout of new clients in seconds, a lease may change them. */
+        static constexpr time_t DefaultTimeout = 5;
+        /** Idle clients kept per host. */
+        static constexpr size_t MaxIdleClients = 4;
+
+        class Lease
+        {
+            public:
+                Lease(Lease &&) = default;
+                Lease &operator=(Lease &&) = default;
+                ~Lease()
+                {
+                    if (m_Pool != nullptr && m_Client)
+                        m_Pool->release(m_Key, std::move(m_Client));
+                }
+
+                httplib::Client *operator->()
+                {
+                    return m_Client.get();
+                }
+                httplib::Client &operator*()
+                {
+                    return *m_Client;
+                }
+
+            private:
+                friend class HTTPClientPool;
+                Lease(HTTPClientPool *pool, const std::string &key, std::unique_ptr<httplib::Client> client)
+                    : m_Pool(pool), m_Key(key), m_Client(std::move(client)) {}
+
+                HTTPClientPool *m_Pool {nullptr};
+                std::string m_Key;
+                std::unique_ptr<httplib::Client> m_Client;
+        };
+
+        /** @return The pool shared by the devices of the driver. */
+        static HTTPClientPool &instance()
+        {
+            static HTTPClientPool pool;
+            return pool;
+        }
+
+        /**
+         * @brief acquire Lease a client for a host.
+         * @param host Host name or address.
+         * @param port TCP port.
+         */
+        Lease acquire(const std::string &host, int port)
+        {
+            std::string key = host + ":" + std::to_string(port);
+            return lease(key, [&]()
+            {
+                return std::unique_ptr<httplib::Client>(new httplib::Client(host, port));
+            });
+        }
+
+        /**
+         * @brief acquire Lease a client for a base URL.
+         * @param schemeHostPort e.g. "https://api.example.com" or "http://192.168.1.10:8080".
+         */
+        Lease acquire(const std::string &schemeHostPort)
+        {
+            return lease(schemeHostPort, [&]()
+            {
+                return std::unique_ptr<httplib::Client>(new httplib::Client(schemeHostPort));
+            });
+        }
+
+        /**
+         * @brief clear Close the idle clients of a host, e.g. when the driver disconnects from it.
+         */
+        void clear(const std::string &host, int port)
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Idle.erase(host + ":" + std::to_string(port));
+        }
+
+    private:
+        HTTPClientPool() = default;
+
+        template <typename Factory>
+        Lease lease(const std::string &key, Factory create)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Lock);
+                auto &idle = m_Idle[key];
+                if (!idle.empty())
+                {
+                    std::unique_ptr<httplib::Client> client = std::move(idle.back());
+                    idle.pop_back();
+                    return Lease(this, key, std::move(client));
+                }
+            }
+
+            std::unique_ptr<httplib::Client> client = create();
+            client->set_keep_alive(true);
+            // Requests with a body are written in two parts, do not let the second wait for the ACK of the first
+            client->set_tcp_nodelay(true);
+            client->set_connection_timeout(DefaultTimeout);
+            client->set_read_timeout(DefaultTimeout);
+            return Lease(this, key, std::move(client));
+        }
+
+        void release(const std::string &key, std::unique_ptr<httplib::Client> client)
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            auto &idle = m_Idle[key];
+            if (idle.size() < MaxIdleClients)
+                idle.push_back(std::move(client));
+        }
+
+        std::mutex m_Lock;
+        std::map<std::string, std::vector<std::unique_ptr<httplib::Client>>> m_Idle;
+};
+}
@@ -0,0 +1,245 @@
+/**  INDI LIB
+ *   Quick look JPEG previews of frames
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "imagepreview.h"
+#include "indithreadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <jpeglib.h>
+
+namespace
+{
+
+// Sky background of the preview, as a fraction of the range
+const double targetBackground = 0.25;
+// The black point is this many normalized MADs under the median
+const double shadowsClipping = 2.8;
+// Samples of a plane its median and deviation are estimated from
+const size_t statisticsSamples = 65536;
+
+// Midtones transfer function of balance m: 0, m and 1 go to 0, 0.5 and 1
+inline double mtf(double m, double x)
+{
+    if (x <= 0)
+        return 0;
+    if (x >= 1)
+        return 1;
+    return (m - 1) * x / ((2 * m - 1) * x - m);
+}
+
+// Destination manager growing a vector as libjpeg fills it
+struct VectorDestination
+{
+    jpeg_destination_mgr manager;
+    std::vector<uint8_t> *jpeg;
+};
+
+void initDestination(j_compress_ptr cinfo)
+{
+    auto destination = reinterpret_cast<VectorDestination *>(cinfo->dest);
+    destination->manager.next_output_byte = destination->jpeg->data();
+    destination->manager.free_in_buffer = destination->jpeg->size();
+}
+
+boolean emptyOutputBuffer(j_compress_ptr cinfo)
+{
+    auto destination = reinterpret_cast<VectorDestination *>(cinfo->dest);
+    size_t used = destination->jpeg->size();
+    destination->jpeg->resize(used * 2);
+    destination->manager.next_output_byte = destination->jpeg->data() + used;
+    destination->manager.free_in_buffer = destination->jpeg->size() - used;
+    return TRUE;
+}
+
+void termDestination(j_compress_ptr cinfo)
+{
+    auto destination = reinterpret_cast<VectorDestination *>(cinfo->dest);
+    destination->jpeg->resize(destination->jpeg->size() - destination->manager.free_in_buffer);
+}
+
+}
+
+namespace INDI
+{
+
+ImagePreview::ImagePreview(uint32_t width, uint32_t height, uint32_t channels, int bpp)
+    : m_Width(width), m_Height(height), m_Channels(channels), m_BPP(bpp)
+{
+}
+
+void ImagePreview::setMaxWidth(uint32_t maxWidth)
+{
+    m_MaxWidth = std::max(1u, maxWidth);
+}
+
+void ImagePreview::setQuality(int quality)
+{
+    m_Quality = std::min(100, std::max(1, quality));
+}
+
+void ImagePreview::setBayer(bool bayer)
+{
+    m_Bayer = bayer;
+}
+
+bool ImagePreview::supported(uint32_t channels, int bpp)
+{
+    return (channels == 1 || channels == 3) && (bpp == 8 || bpp == 16 || bpp == 32);
+}
+
+template <typename T>
+void ImagePreview::bin(const T *pixels, uint32_t factor)
+{
+    const size_t planeSize = size_t(m_Width) * m_Height;
+    const size_t previewSize = size_t(m_PreviewWidth) * m_PreviewHeight;
+    const float scale = 1.0f / (factor * factor);
+
+    for (uint32_t channel = 0; channel < m_Channels; channel++)
+    {
+        const T *plane = pixels + channel * planeSize;
+        float *binned = m_Binned.data() + channel * previewSize;
+        INDI::ThreadPool::global().forEach(m_PreviewHeight, 8, [&](size_t first, size_t last)
+        {
+            for (size_t y = first; y < last; y++)
+            {
+                float *out = binned + y * m_PreviewWidth;
+                std::fill(out, out + m_PreviewWidth, 0.0f);
+                for (uint32_t row = 0; row < factor; row++)
+                {
+                    const T *in = plane + (y * factor + row) * m_Width;
+                    for (uint32_t x = 0; x < m_PreviewWidth; x++, in += factor)
+                    {
+                        float sum = 0;
+                        for (uint32_t column = 0; column < factor; column++)
+                            sum += in[column];
+                        out[x] += sum;
+                    }
+                }
+                for (uint32_t x = 0; x < m_PreviewWidth; x++)
+                    out[x] *= scale;
+            }
+        });
+    }
+}
+
+void ImagePreview::stretch(const float *plane, size_t count, uint8_t *out, size_t step)
+{
+    // Median and deviation of an even sampling of the plane
+    size_t stride = std::max<size_t>(1, count / statisticsSamples);
+    std::vector<float> samples;
+    samples.reserve(count / stride + 1);
+    for (size_t i = 0; i < count; i += stride)
+        samples.push_back(plane[i]);
+
+    auto middle = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), middle, samples.end());
+    double median = *middle;
+    for (auto &sample : samples)
+        sample = std::fabs(sample - median);
+    std::nth_element(samples.begin(), middle, samples.end());
+    double deviation = 1.4826 * *middle;
+
+    double white = *std::max_element(plane, plane + count);
+    double black = std::max(static_cast<double>(*std::min_element(plane, plane + count)),
+                            median - shadowsClipping * deviation);
+    if (white <= black)
+        white = black + 1;
+    double range = white - black;
+    double balance = mtf(targetBackground, (median - black) / range);
+
+    // The curve is looked up, the preview is small but the curve is costly
+    const int levels = 4096;
+    uint8_t curve[levels + 1];
+    for (int i = 0; i <= levels; i++)
+        curve[i] = static_cast<uint8_t>(std::lround(255 * mtf(balance, double(i) / levels)));
+
+    const float offset = black, gain = levels / range;
+    for (size_t i = 0; i < count; i++)
+    {
+        float level = std::min(std::max((plane[i] - offset) * gain, 0.0f), static_cast<float>(levels));
+        out[i * step] = curve[static_cast<int>(level + 0.5f)];
+    }
+}
+
+bool ImagePreview::encode(const void *pixels, std::vector<uint8_t> &jpeg)
+{
+    if (!supported(m_Channels, m_BPP) || m_Width == 0 || m_Height == 0)
+        return false;
+
+    uint32_t factor = (m_Width + m_MaxWidth - 1) / m_MaxWidth;
+    if (m_Bayer && m_Channels == 1 && factor % 2)
+        factor++;
+    m_PreviewWidth = m_Width / factor;
+    m_PreviewHeight = m_Height / factor;
+    if (m_PreviewWidth == 0 || m_PreviewHeight == 0)
+        return false;
+
+    const size_t previewSize = size_t(m_PreviewWidth) * m_PreviewHeight;
+    m_Binned.resize(previewSize * m_Channels);
+    switch (m_BPP)
+    {
+        case 8:
+            bin(static_cast<const uint8_t *>(pixels), factor);
+            break;
+        case 16:
+            bin(static_cast<const uint16_t *>(pixels), factor);
+            break;
+        default:
+            bin(static_cast<const uint32_t *>(pixels), factor);
+            break;
+    }
+
+    // JPEG wants interleaved samples
+    m_Stretched.resize(previewSize * m_Channels);
+    for (uint32_t channel = 0; channel < m_Channels; channel++)
+        stretch(m_Binned.data() + channel * previewSize, previewSize, m_Stretched.data() + channel, m_Channels);
+
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    VectorDestination destination;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+
+    jpeg.resize(previewSize * m_Channels / 4 + 4096);
+    destination.jpeg = &jpeg;
+    destination.manager.init_destination = initDestination;
+    destination.manager.empty_output_buffer = emptyOutputBuffer;
+    destination.manager.term_destination = termDestination;
+    cinfo.dest = &destination.manager;
+
+    cinfo.image_width = m_PreviewWidth;
+    cinfo.image_height = m_PreviewHeight;
+    cinfo.input_components = m_Channels;
+    cinfo.in_color_space = m_Channels == 3 ? JCS_RGB : JCS_GRAYSCALE;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, m_Quality, TRUE);
+
+    jpeg_start_compress(&cinfo, TRUE);
+    const size_t stride = size_t(m_PreviewWidth) * m_Channels;
+    while (cinfo.next_scanline < cinfo.image_height)
+    {
+        JSAMPROW row = m_Stretched.data() + cinfo.next_scanline * stride;
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+}
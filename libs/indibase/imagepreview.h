@@ -0,0 +1,99 @@
+/**  INDI LIB
+ *   Quick look JPEG previews of frames
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The ImagePreview class encodes a small, stretched JPEG of a frame, for clients that only show it.
+ *
+ * The frame is binned by the smallest integer factor that fits the preview width, by an even factor on a
+ * colour filter array so that each binned pixel covers whole Bayer cells. Each channel is then stretched
+ * on its own the way an automatic screen transfer function does: the black point goes just under the sky
+ * background and a midtones curve brings the background to a quarter of the range.
+ */
+class ImagePreview
+{
+    public:
+        /**
+         * @param width frame width in pixels
+         * @param height frame height in pixels
+         * @param channels 1 for gray, 3 for planar RGB
+         * @param bpp 8, 16 or 32 bits unsigned samples
+         */
+        ImagePreview(uint32_t width, uint32_t height, uint32_t channels, int bpp);
+
+        /** @brief Largest width of the preview, in pixels. */
+        void setMaxWidth(uint32_t maxWidth);
+
+        /** @brief JPEG quality, 1 to 100. */
+        void setQuality(int quality);
+
+        /** @brief Whether a mono frame is the raw frame of a colour filter array. */
+        void setBayer(bool bayer);
+
+        /**
+         * @brief encode Bin, stretch and compress the frame.
+         * @param pixels width * height * channels samples.
+         * @param jpeg set to the JPEG file.
+         * @return False if the frame is empty or not supported.
+         */
+        bool encode(const void *pixels, std::vector<uint8_t> &jpeg);
+
+        /** @brief Size of the last preview. */
+        uint32_t previewWidth() const
+        {
+            return m_PreviewWidth;
+        }
+        uint32_t previewHeight() const
+        {
+            return m_PreviewHeight;
+        }
+
+        /**
+         * @return True if frames with these channels and bits per sample can be previewed.
+         */
+        static bool supported(uint32_t channels, int bpp);
+
+    private:
+        template <typename T>
+        void bin(const T *pixels, uint32_t factor);
+        void stretch(const float *plane, size_t count, uint8_t *out, size_t step);
+
+        uint32_t m_Width;
+        uint32_t m_Height;
+        uint32_t m_Channels;
+        int m_BPP;
+        uint32_t m_MaxWidth {800};
+        int m_Quality {75};
+        bool m_Bayer {false};
+
+        uint32_t m_PreviewWidth {0};
+        uint32_t m_PreviewHeight {0};
+        // Binned planes, then the 8 bit interleaved preview
+        std::vector<float> m_Binned;
+        std::vector<uint8_t> m_Stretched;
+};
+
+}
@@ -30,12 +30,23 @@
 #include "indiccd.h"
 
 #include "fpack/fpack.h"
+#include "cfacodec.h"
+#include "sharedblob.h"
 #include "indicom.h"
 #include "locale_compat.h"
 #include "indiutility.h"
+#include "fitswriter.h"
+#include "xisfwriter.h"
+#include "imagepreview.h"
+#include "pixel/pixelkernels.h"
+#include "indiprobes.h"
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
-#ifdef HAVE_XISF
-#include <libxisf.h>
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
 #endif
 
 #include <fitsio.h>
@@ -50,13 +61,18 @@
 #include <iomanip>
 #include <cmath>
 #include <regex>
+#include <algorithm>
 #include <iterator>
 #include <variant>
 
 #include <dirent.h>
 #include <cerrno>
 #include <cstdlib>
+#include <deque>
+#include <functional>
 #include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 const char * IMAGE_SETTINGS_TAB = "Image Settings";
@@ -76,6 +92,174 @@ std::string join(std::vector<std::string> const &strings, std::string delim)
 namespace INDI
 {
 
+/* Writes locally saved images in order on a thread of its own. Frames are copied in, so the caller's
+ * buffer is free once write() returns, and write() only blocks while depth frames are already waiting.
+ * Files are preallocated, and large ones can bypass the page cache with O_DIRECT.
+ */
+class LocalImageWriter
+{
+    public:
+        using Done = std::function<void(const std::string &path, int error, size_t pendingFrames, size_t pendingBytes)>;
+
+        explicit LocalImageWriter(Done done) : done(std::move(done)) {}
+
+        ~LocalImageWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                quit = true;
+            }
+            wakeup.notify_one();
+            // the queue is drained first
+            if (thread.joinable())
+                thread.join();
+        }
+
+        /* queue size bytes of data for path, O_DIRECT if size is at least directBytes (> 0).
+         * waited tells whether the queue was full. False if the frame could not be copied.
+         */
+        bool write(const std::string &path, const void *data, size_t size, size_t depth, size_t directBytes,
+                   bool &waited, size_t &pendingFrames, size_t &pendingBytes)
+        {
+            void *buffer = nullptr;
+            if (posix_memalign(&buffer, Alignment, std::max<size_t>(Alignment, (size + Alignment - 1) / Alignment * Alignment)))
+                return false;
+            memcpy(buffer, data, size);
+
+            Job job;
+            job.path   = path;
+            job.data   = std::unique_ptr<uint8_t, decltype(&free)>(static_cast<uint8_t *>(buffer), &free);
+            job.size   = size;
+            job.direct = directBytes > 0 && size >= directBytes;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            waited = queue.size() >= depth;
+            room.wait(lock, [&]
+            {
+                return queue.size() < std::max<size_t>(depth, 1);
+            });
+            queue.push_back(std::move(job));
+            pendingFrames = ++frames;
+            pendingBytes  = bytes += size;
+
+            if (!thread.joinable())
+                thread = std::thread(&LocalImageWriter::run, this);
+            wakeup.notify_one();
+            return true;
+        }
+
+    private:
+        static constexpr size_t Alignment = 4096;
+
+        struct Job
+        {
+            std::string path;
+            std::unique_ptr<uint8_t, decltype(&free)> data {nullptr, &free};
+            size_t size {0};
+            bool direct {false};
+        };
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;)
+            {
+                wakeup.wait(lock, [this]
+                {
+                    return quit || !queue.empty();
+                });
+                if (queue.empty())
+                    return;
+
+                Job job = std::move(queue.front());
+                queue.pop_front();
+                room.notify_all();
+
+                lock.unlock();
+                int error = writeFile(job);
+                lock.lock();
+
+                size_t pendingFrames = --frames;
+                size_t pendingBytes  = bytes -= job.size;
+                lock.unlock();
+                done(job.path, error, pendingFrames, pendingBytes);
+                lock.lock();
+            }
+        }
+
+        /* 0 or errno */
+        static int writeFile(const Job &job)
+        {
+            int flags = O_WRONLY | O_CREAT | O_TRUNC;
+            int fd    = -1;
+            bool direct = false;
+#ifdef O_DIRECT
+            if (job.direct)
+            {
+                fd = open(job.path.c_str(), flags | O_DIRECT, 0644);
+                direct = fd >= 0;
+            }
+#endif
+            if (fd < 0)
+                fd = open(job.path.c_str(), flags, 0644);
+            if (fd < 0)
+                return errno;
+
+#ifdef __linux__
+            // Reserve the whole extent first, unsupported by some file systems which is fine
+            if (job.size > 0)
+                fallocate(fd, 0, 0, job.size);
+#endif
+
+            // O_DIRECT takes whole blocks, the tail goes through the page cache
+            size_t aligned = direct ? job.size / Alignment * Alignment : 0;
+            int error = writeAll(fd, job.data.get(), 0, aligned);
+#ifdef O_DIRECT
+            if (direct && (error == EINVAL || aligned < job.size))
+            {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+                if (error == EINVAL)
+                    aligned = 0;
+                error = 0;
+            }
+#endif
+            if (error == 0)
+                error = writeAll(fd, job.data.get() + aligned, aligned, job.size - aligned);
+
+            if (close(fd) != 0 && error == 0)
+                error = errno;
+            return error;
+        }
+
+        static int writeAll(int fd, const uint8_t *data, off_t offset, size_t size)
+        {
+            while (size > 0)
+            {
+                ssize_t n = pwrite(fd, data, size, offset);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return errno;
+                }
+                data += n;
+                offset += n;
+                size -= n;
+            }
+            return 0;
+        }
+
+        Done done;
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::condition_variable room;
+        std::deque<Job> queue;
+        size_t frames {0};
+        size_t bytes {0};
+        bool quit {false};
+        std::thread thread;
+};
+
 CCD::CCD() : GI(this)
 {
     //ctor
@@ -122,12 +306,16 @@ CCD::CCD() : GI(this)
     m_TemperatureCheckTimer.setInterval(5000);
     m_TemperatureCheckTimer.callOnTimeout(std::bind(&CCD::checkTemperatureTarget, this));
 
-    exposureStartTime[0] = 0;
-    exposureDuration = 0.0;
+    m_SyncTimer.setSingleShot(true);
+    m_SyncTimer.callOnTimeout(std::bind(&CCD::startSyncExposure, this));
+
 }
 
 CCD::~CCD()
 {
+    // Finish the queued local saves while the properties they report to still exist
+    m_LocalWriter.reset();
+
     // Only update if index is different.
     if (m_ConfigFastExposureIndex != FastExposureToggleSP.findOnSwitchIndex())
         saveConfig(FastExposureToggleSP);
@@ -253,6 +441,26 @@ bool CCD::initProperties()
     PrimaryCCD.ResetSP.fill(getDeviceName(), "CCD_FRAME_RESET", "Frame Values",
                             IMAGE_SETTINGS_TAB, IP_WO, ISR_1OFMANY, 0, IPS_IDLE);
 
+    // Guide ROI
+    PrimaryCCD.GuideROISP[CCDChip::GUIDE_ROI_OFF].fill("GUIDE_ROI_OFF", "Off", ISS_ON);
+    PrimaryCCD.GuideROISP[CCDChip::GUIDE_ROI_DATA].fill("GUIDE_ROI_DATA", "Star only", ISS_OFF);
+    PrimaryCCD.GuideROISP[CCDChip::GUIDE_ROI_IMAGE].fill("GUIDE_ROI_IMAGE", "Star and image", ISS_OFF);
+    PrimaryCCD.GuideROISP.fill(getDeviceName(), "CCD_GUIDE_ROI", "Guide ROI", IMAGE_SETTINGS_TAB, IP_RW,
+                               ISR_1OFMANY, 0, IPS_IDLE);
+
+    PrimaryCCD.GuideROINP[CCDChip::ROI_STAR_X].fill("ROI_STAR_X", "Star X", "%4.0f", 0, 0, 0, 0);
+    PrimaryCCD.GuideROINP[CCDChip::ROI_STAR_Y].fill("ROI_STAR_Y", "Star Y", "%4.0f", 0, 0, 0, 0);
+    PrimaryCCD.GuideROINP[CCDChip::ROI_BOX].fill("ROI_BOX", "Box", "%4.0f", 8, 256, 8, 32);
+    PrimaryCCD.GuideROINP.fill(getDeviceName(), "CCD_GUIDE_ROI_SETTINGS", "Guide ROI", IMAGE_SETTINGS_TAB, IP_RW,
+                               60, IPS_IDLE);
+
+    PrimaryCCD.GuideStarNP[CCDChip::GUIDESTAR_X].fill("GUIDESTAR_X", "X", "%.3f", 0, 16000, 0, 0);
+    PrimaryCCD.GuideStarNP[CCDChip::GUIDESTAR_Y].fill("GUIDESTAR_Y", "Y", "%.3f", 0, 16000, 0, 0);
+    PrimaryCCD.GuideStarNP[CCDChip::GUIDESTAR_SNR].fill("GUIDESTAR_SNR", "SNR", "%.1f", 0, 1e6, 0, 0);
+    PrimaryCCD.GuideStarNP[CCDChip::GUIDESTAR_HFR].fill("GUIDESTAR_HFR", "HFR", "%.2f", 0, 256, 0, 0);
+    PrimaryCCD.GuideStarNP.fill(getDeviceName(), "CCD_GUIDE_STAR", "Guide Star", IMAGE_SETTINGS_TAB, IP_RO, 60,
+                                IPS_IDLE);
+
     /**********************************************/
     /********* Primary Chip Rapid Guide  **********/
     /**********************************************/
@@ -329,6 +537,25 @@ bool CCD::initProperties()
     GuideCCD.FitsBP.fill(getDeviceName(), "CCD2", "Image Data", IMAGE_INFO_TAB, IP_RO,
                          60, IPS_IDLE);
 
+    GuideCCD.GuideROISP[CCDChip::GUIDE_ROI_OFF].fill("GUIDE_ROI_OFF", "Off", ISS_ON);
+    GuideCCD.GuideROISP[CCDChip::GUIDE_ROI_DATA].fill("GUIDE_ROI_DATA", "Star only", ISS_OFF);
+    GuideCCD.GuideROISP[CCDChip::GUIDE_ROI_IMAGE].fill("GUIDE_ROI_IMAGE", "Star and image", ISS_OFF);
+    GuideCCD.GuideROISP.fill(getDeviceName(), "GUIDER_GUIDE_ROI", "Guide ROI", GUIDE_HEAD_TAB, IP_RW,
+                             ISR_1OFMANY, 0, IPS_IDLE);
+
+    GuideCCD.GuideROINP[CCDChip::ROI_STAR_X].fill("ROI_STAR_X", "Star X", "%4.0f", 0, 0, 0, 0);
+    GuideCCD.GuideROINP[CCDChip::ROI_STAR_Y].fill("ROI_STAR_Y", "Star Y", "%4.0f", 0, 0, 0, 0);
+    GuideCCD.GuideROINP[CCDChip::ROI_BOX].fill("ROI_BOX", "Box", "%4.0f", 8, 256, 8, 32);
+    GuideCCD.GuideROINP.fill(getDeviceName(), "GUIDER_GUIDE_ROI_SETTINGS", "Guide ROI", GUIDE_HEAD_TAB, IP_RW,
+                             60, IPS_IDLE);
+
+    GuideCCD.GuideStarNP[CCDChip::GUIDESTAR_X].fill("GUIDESTAR_X", "X", "%.3f", 0, 16000, 0, 0);
+    GuideCCD.GuideStarNP[CCDChip::GUIDESTAR_Y].fill("GUIDESTAR_Y", "Y", "%.3f", 0, 16000, 0, 0);
+    GuideCCD.GuideStarNP[CCDChip::GUIDESTAR_SNR].fill("GUIDESTAR_SNR", "SNR", "%.1f", 0, 1e6, 0, 0);
+    GuideCCD.GuideStarNP[CCDChip::GUIDESTAR_HFR].fill("GUIDESTAR_HFR", "HFR", "%.2f", 0, 256, 0, 0);
+    GuideCCD.GuideStarNP.fill(getDeviceName(), "GUIDER_GUIDE_STAR", "Guide Star", GUIDE_HEAD_TAB, IP_RO, 60,
+                              IPS_IDLE);
+
     /**********************************************/
     /********* Guider Chip Rapid Guide  ***********/
     // Deprecated. Will be removed in future release
@@ -420,6 +647,48 @@ bool CCD::initProperties()
     UploadSettingsTP.fill(getDeviceName(), "UPLOAD_SETTINGS", "Upload Settings",
                           OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
 
+    // Local saves are queued for a background writer, up to Depth frames. 0 writes them before the upload completes.
+    // Frames of at least Direct MB are written with O_DIRECT, 0 never.
+    LocalWriteNP[LOCAL_WRITE_DEPTH].fill("QUEUE_DEPTH", "Depth", "%.f", 0, 64, 1, 4);
+    LocalWriteNP[LOCAL_WRITE_DIRECT].fill("DIRECT_MB", "Direct MB", "%.f", 0, 4096, 1, 0);
+    LocalWriteNP.fill(getDeviceName(), "CCD_LOCAL_WRITE", "Local Write", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    // Frames waiting to be written. Alert when a save had to wait for room or failed.
+    LocalWriteQueueNP[LOCAL_QUEUE_FRAMES].fill("FRAMES", "Frames", "%.f", 0, 64, 1, 0);
+    LocalWriteQueueNP[LOCAL_QUEUE_MB].fill("MB", "MB", "%.1f", 0, 1e6, 1, 0);
+    LocalWriteQueueNP.fill(getDeviceName(), "CCD_LOCAL_WRITE_QUEUE", "Write Queue", OPTIONS_TAB, IP_RO, 60, IPS_IDLE);
+
+    m_LocalWriter.reset(new LocalImageWriter([this](const std::string & path, int error, size_t frames, size_t bytes)
+    {
+        if (error)
+            LOGF_ERROR("Unable to save image file (%s). %s", path.c_str(), strerror(error));
+        else
+        {
+            LOGF_INFO("Image saved to %s", path.c_str());
+            std::lock_guard<std::mutex> lock(m_LocalWriteLock);
+            FileNameTP[0].setText(path);
+            FileNameTP.setState(IPS_OK);
+            FileNameTP.apply();
+        }
+        updateLocalWriteQueue(frames, bytes, error ? IPS_ALERT : frames ? IPS_BUSY : IPS_OK);
+    }));
+
+    // Exposures started together with other cameras. A camera with a lead starts its exposures that much
+    // later, when its followers start theirs. Each camera waits its upload delay before uploading.
+    SyncLeaderTP[0].fill("SYNC_LEADER", "Leader", "");
+    SyncLeaderTP.fill(getDeviceName(), "CCD_SYNC_LEADER", "Sync With", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    SyncNP[SYNC_LEAD].fill("SYNC_LEAD", "Lead (s)", "%.2f", 0, 10, 0.1, 0);
+    SyncNP[SYNC_UPLOAD_DELAY].fill("SYNC_UPLOAD_DELAY", "Upload Delay (s)", "%.1f", 0, 600, 1, 0);
+    SyncNP.fill(getDeviceName(), "CCD_SYNC", "Sync", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    SyncStartNP[SYNC_TIME].fill("SYNC_TIME", "Start (UTC s)", "%.3f", 0, 1e10, 0, 0);
+    SyncStartNP[SYNC_DURATION].fill("SYNC_DURATION", "Duration (s)", "%.3f", 0, 86400, 0, 0);
+    SyncStartNP.fill(getDeviceName(), "CCD_SYNC_START", "Sync Start", OPTIONS_TAB, IP_RO, 60, IPS_IDLE);
+    m_SyncSnoop = snoopProperty(INDI::SnoopRouter::NUMBER, "", "CCD_SYNC_START", {"SYNC_TIME", "SYNC_DURATION"},
+                                [this](const INDI::SnoopUpdate & update)
+    {
+        followSyncStart(update);
+    });
+
     // Upload File Path
     // @INDI_STANDARD_PROPERTY@
     FileNameTP[0].fill("FILE_PATH", "Path", "");
@@ -454,6 +723,70 @@ bool CCD::initProperties()
     FastExposureCountNP.fill(getDeviceName(), "CCD_FAST_COUNT", "Fast Count",
                              OPTIONS_TAB, IP_RW, 0, IPS_IDLE);
 
+    // Threads used to Rice compress FITS tiles. 1 compresses on the calling thread only.
+    CompressionThreadsNP[0].fill("THREADS", "Threads", "%.f", 1, 64, 1, 1);
+    CompressionThreadsNP.fill(getDeviceName(), "CCD_COMPRESSION_THREADS", "Compress Threads",
+                              OPTIONS_TAB, IP_RW, 0, IPS_IDLE);
+
+    // Codec used when compressing images that are not FITS, or when fpack is not used.
+    CompressionCodecSP[CODEC_ZLIB].fill("CODEC_ZLIB", "zlib", ISS_ON);
+    CompressionCodecSP[CODEC_ZSTD].fill("CODEC_ZSTD", "zstd", ISS_OFF);
+    CompressionCodecSP[CODEC_LZ4].fill("CODEC_LZ4", "lz4", ISS_OFF);
+    // Native raw frames only, others go with zlib
+    CompressionCodecSP[CODEC_CFA].fill("CODEC_CFA", "cfa", ISS_OFF);
+    CompressionCodecSP.fill(getDeviceName(), "CCD_COMPRESSION_CODEC", "Codec",
+                            OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    // Codec level, clamped to the range supported by the selected codec.
+    CompressionLevelNP[0].fill("LEVEL", "Level", "%.f", 1, 22, 1, 9);
+    CompressionLevelNP.fill(getDeviceName(), "CCD_COMPRESSION_LEVEL", "Codec Level",
+                            OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    /**********************************************/
+    /************** Image Statistics **************/
+    /**********************************************/
+
+    ImageStatsToggleSP[INDI_ENABLED].fill("INDI_ENABLED", "Enabled", ISS_OFF);
+    ImageStatsToggleSP[INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    ImageStatsToggleSP.fill(getDeviceName(), "CCD_IMAGE_STATS_CONTROL", "Statistics",
+                            IMAGE_SETTINGS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    // Statistics of the last mono frame, computed before upload
+    ImageStatsNP[STATS_MIN].fill("STATS_MIN", "Min", "%.f", 0, 4294967295., 0, 0);
+    ImageStatsNP[STATS_MAX].fill("STATS_MAX", "Max", "%.f", 0, 4294967295., 0, 0);
+    ImageStatsNP[STATS_MEAN].fill("STATS_MEAN", "Mean", "%.2f", 0, 4294967295., 0, 0);
+    ImageStatsNP[STATS_STDDEV].fill("STATS_STDDEV", "StdDev", "%.2f", 0, 4294967295., 0, 0);
+    ImageStatsNP[STATS_MEDIAN].fill("STATS_MEDIAN", "Median", "%.f", 0, 4294967295., 0, 0);
+    ImageStatsNP.fill(getDeviceName(), "CCD_IMAGE_STATS", "Statistics", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Histogram of the same frame, 256 little endian uint32 counts of equal bins from STATS_MIN to STATS_MAX
+    ImageHistogramBP[0].fill("HISTOGRAM", "Histogram", "");
+    ImageHistogramBP.fill(getDeviceName(), "CCD_IMAGE_HISTOGRAM", "Histogram", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
+    /**********************************************/
+    /**************** Image Preview ***************/
+    /**********************************************/
+
+    ImagePreviewToggleSP[INDI_ENABLED].fill("INDI_ENABLED", "Enabled", ISS_OFF);
+    ImagePreviewToggleSP[INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    ImagePreviewToggleSP.fill(getDeviceName(), "CCD_PREVIEW_CONTROL", "Preview",
+                              IMAGE_SETTINGS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    ImagePreviewNP[PREVIEW_WIDTH].fill("PREVIEW_WIDTH", "Max width", "%.f", 64, 4096, 64, 800);
+    ImagePreviewNP[PREVIEW_QUALITY].fill("PREVIEW_QUALITY", "Quality", "%.f", 1, 100, 5, 75);
+    ImagePreviewNP.fill(getDeviceName(), "CCD_PREVIEW_SETTINGS", "Preview", IMAGE_SETTINGS_TAB, IP_RW, 60, IPS_IDLE);
+
+    // Binned and stretched JPEG of each frame, so clients can enableBLOB it alone and skip the full frames
+    ImagePreviewBP[0].fill("PREVIEW", "Preview", "");
+    ImagePreviewBP.fill(getDeviceName(), "CCD_PREVIEW", "Preview", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Stars of the last frame the active focuser asked for an autofocus, the frame is not uploaded
+    FrameStarsNP[FRAME_STARS_COUNT].fill("STARS_COUNT", "Stars", "%.f", 0, 1e6, 0, 0);
+    FrameStarsNP[FRAME_STARS_HFR].fill("STARS_HFR", "HFR", "%.2f", 0, 1000, 0, 0);
+    FrameStarsNP[FRAME_STARS_FWHM].fill("STARS_FWHM", "FWHM", "%.2f", 0, 1000, 0, 0);
+    FrameStarsNP[FRAME_STARS_FRAME].fill("STARS_FRAME", "Frame", "%.f", 0, 4294967295., 0, 0);
+    FrameStarsNP.fill(getDeviceName(), "CCD_FRAME_STARS", "Stars", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
     /**********************************************/
     /**************** Snooping ********************/
     /**********************************************/
@@ -481,30 +814,8 @@ bool CCD::initProperties()
                    "Main Control", IP_RW,
                    60, IPS_IDLE);
 
-    // Snoop properties of interest
-
-    // Snoop mount
-    IDSnoopDevice(mount, "EQUATORIAL_EOD_COORD");
-    IDSnoopDevice(mount, "EQUATORIAL_COORD");
-    IDSnoopDevice(mount, "TELESCOPE_INFO");
-    IDSnoopDevice(mount, "GEOGRAPHIC_COORD");
-    IDSnoopDevice(mount, "TELESCOPE_PIER_SIDE");
-
-    // Snoop Rotator
-    IDSnoopDevice(ActiveDeviceTP[ACTIVE_ROTATOR].getText(), "ABS_ROTATOR_ANGLE");
-
-    // JJ ed 2019-12-10
-    // Snoop Focuser
-    IDSnoopDevice(ActiveDeviceTP[ACTIVE_FOCUSER].getText(), "ABS_FOCUS_POSITION");
-    IDSnoopDevice(ActiveDeviceTP[ACTIVE_FOCUSER].getText(), "FOCUS_TEMPERATURE");
-    //
-
-    // Snoop Filter Wheel
-    IDSnoopDevice(ActiveDeviceTP[ACTIVE_FILTER].getText(), "FILTER_SLOT");
-    IDSnoopDevice(ActiveDeviceTP[ACTIVE_FILTER].getText(), "FILTER_NAME");
-
-    // Snoop Sky Quality Meter
-    IDSnoopDevice(ActiveDeviceTP[ACTIVE_SKYQUALITY].getText(), "SKY_QUALITY");
+    // Snoop properties of interest of the mount, rotator, focuser, filter wheel and sky quality meter
+    addActiveSnoops();
 
     // Guider Interface
     GI::initProperties(GUIDE_CONTROL_TAB);
@@ -583,6 +894,19 @@ bool CCD::updateProperties()
         }
         defineProperty(PrimaryCCD.CompressSP);
         defineProperty(PrimaryCCD.FitsBP);
+        defineProperty(ImageStatsToggleSP);
+        if (ImageStatsToggleSP[INDI_ENABLED].getState() == ISS_ON)
+        {
+            defineProperty(ImageStatsNP);
+            defineProperty(ImageHistogramBP);
+        }
+        defineProperty(ImagePreviewToggleSP);
+        if (ImagePreviewToggleSP[INDI_ENABLED].getState() == ISS_ON)
+        {
+            defineProperty(ImagePreviewNP);
+            defineProperty(ImagePreviewBP);
+        }
+        defineProperty(FrameStarsNP);
         if (HasGuideHead())
         {
             defineProperty(GuideCCD.CompressSP);
@@ -597,6 +921,22 @@ bool CCD::updateProperties()
         if (HasGuideHead())
             defineProperty(GuideCCD.FrameTypeSP);
 
+        if (CanSubFrame())
+        {
+            defineProperty(PrimaryCCD.GuideROISP);
+            defineProperty(PrimaryCCD.GuideROINP);
+            if (PrimaryCCD.getGuideROIMode() != CCDChip::GUIDE_ROI_OFF)
+                defineProperty(PrimaryCCD.GuideStarNP);
+
+            if (HasGuideHead())
+            {
+                defineProperty(GuideCCD.GuideROISP);
+                defineProperty(GuideCCD.GuideROINP);
+                if (GuideCCD.getGuideROIMode() != CCDChip::GUIDE_ROI_OFF)
+                    defineProperty(GuideCCD.GuideStarNP);
+            }
+        }
+
         if (HasBayer())
             defineProperty(BayerTP);
 
@@ -625,9 +965,17 @@ bool CCD::updateProperties()
         if (UploadSettingsTP[UPLOAD_DIR].isEmpty())
             UploadSettingsTP[UPLOAD_DIR].setText(getenv("HOME"));
         defineProperty(UploadSettingsTP);
+        defineProperty(LocalWriteNP);
+        defineProperty(LocalWriteQueueNP);
+        defineProperty(SyncLeaderTP);
+        defineProperty(SyncNP);
+        defineProperty(SyncStartNP);
 
         defineProperty(FastExposureToggleSP);
         defineProperty(FastExposureCountNP);
+        defineProperty(CompressionThreadsNP);
+        defineProperty(CompressionCodecSP);
+        defineProperty(CompressionLevelNP);
     }
     else
     {
@@ -635,6 +983,14 @@ bool CCD::updateProperties()
         if (CanBin() || CanSubFrame())
             deleteProperty(PrimaryCCD.ResetSP);
 
+        if (CanSubFrame())
+        {
+            deleteProperty(PrimaryCCD.GuideROISP);
+            deleteProperty(PrimaryCCD.GuideROINP);
+            if (PrimaryCCD.getGuideROIMode() != CCDChip::GUIDE_ROI_OFF)
+                deleteProperty(PrimaryCCD.GuideStarNP);
+        }
+
         deleteProperty(PrimaryCCD.ImagePixelSizeNP);
 
         deleteProperty(CaptureFormatSP.getName());
@@ -648,6 +1004,19 @@ bool CCD::updateProperties()
             deleteProperty(PrimaryCCD.AbortExposureSP);
         deleteProperty(PrimaryCCD.FitsBP);
         deleteProperty(PrimaryCCD.CompressSP);
+        deleteProperty(ImageStatsToggleSP);
+        if (ImageStatsToggleSP[INDI_ENABLED].getState() == ISS_ON)
+        {
+            deleteProperty(ImageStatsNP);
+            deleteProperty(ImageHistogramBP);
+        }
+        deleteProperty(ImagePreviewToggleSP);
+        if (ImagePreviewToggleSP[INDI_ENABLED].getState() == ISS_ON)
+        {
+            deleteProperty(ImagePreviewNP);
+            deleteProperty(ImagePreviewBP);
+        }
+        deleteProperty(FrameStarsNP);
 
 #if 0
         deleteProperty(PrimaryCCD.RapidGuideSP.name);
@@ -673,6 +1042,13 @@ bool CCD::updateProperties()
                 deleteProperty(GuideCCD.ImageBinNP);
             deleteProperty(GuideCCD.CompressSP);
             deleteProperty(GuideCCD.FrameTypeSP);
+            if (CanSubFrame())
+            {
+                deleteProperty(GuideCCD.GuideROISP);
+                deleteProperty(GuideCCD.GuideROINP);
+                if (GuideCCD.getGuideROIMode() != CCDChip::GUIDE_ROI_OFF)
+                    deleteProperty(GuideCCD.GuideStarNP);
+            }
 
 #if 0
             deleteProperty(GuideCCD.RapidGuideSP.name);
@@ -704,9 +1080,18 @@ bool CCD::updateProperties()
         deleteProperty(WorldCoordSP);
         deleteProperty(UploadSP);
         deleteProperty(UploadSettingsTP);
+        cancelSyncExposure();
+        deleteProperty(LocalWriteNP);
+        deleteProperty(LocalWriteQueueNP);
+        deleteProperty(SyncLeaderTP);
+        deleteProperty(SyncNP);
+        deleteProperty(SyncStartNP);
 
         deleteProperty(FastExposureToggleSP);
         deleteProperty(FastExposureCountNP);
+        deleteProperty(CompressionThreadsNP);
+        deleteProperty(CompressionCodecSP);
+        deleteProperty(CompressionLevelNP);
     }
 
     // Streamer
@@ -725,166 +1110,131 @@ bool CCD::updateProperties()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool CCD::ISSnoopDevice(XMLEle * root)
 {
-    XMLEle * ep           = nullptr;
-    auto propName = findXMLAttValu(root, "name");
-    auto deviceName = std::string(findXMLAttValu(root, "device"));
+    // The properties of the active devices are handled by the subscriptions of addActiveSnoops()
+    return DefaultDevice::ISSnoopDevice(root);
+}
+
+void CCD::addActiveSnoops()
+{
+    auto &mountSnoops = m_ActiveSnoops[ACTIVE_TELESCOPE];
+    const char *mount = ActiveDeviceTP[ACTIVE_TELESCOPE].getText();
 
-    if ((EqNP.snoop(root)))
+    mountSnoops.push_back(snoopProperty(INDI::SnoopRouter::NUMBER, mount, "EQUATORIAL_EOD_COORD", {"RA", "DEC"},
+                                        [this](const INDI::SnoopUpdate & update)
     {
-        double newra, newdec;
-        newra  = EqNP[Ra].getValue();
-        newdec = EqNP[DEC].getValue();
-        if ((newra != RA) || (newdec != Dec))
-        {
-            //IDLog("RA %4.2f  Dec %4.2f Snooped RA %4.2f  Dec %4.2f\n",RA,Dec,newra,newdec);
-            RA  = newra;
-            Dec = newdec;
-        }
-    }
-    else if (J2000EqNP.snoop(root))
+        if (!update.has(0) || !update.has(1))
+            return;
+        EqNP[Ra].setValue(update.number(0));
+        EqNP[DEC].setValue(update.number(1));
+        EqNP.setState(update.state());
+        RA  = update.number(0);
+        Dec = update.number(1);
+    }));
+
+    mountSnoops.push_back(snoopProperty(INDI::SnoopRouter::NUMBER, mount, "EQUATORIAL_COORD", {"RA", "DEC"},
+                                        [this](const INDI::SnoopUpdate & update)
     {
-        float newra, newdec;
-        newra  = J2000EqNP[Ra].getValue();
-        newdec = J2000EqNP[DEC].getValue();
-        if ((newra != J2000RA) || (newdec != J2000DE))
-        {
-            //    	    IDLog("J2000 RA %4.2f  Dec %4.2f Snooped RA %4.2f  Dec %4.2f\n",J2000RA,J2000DE,newra,newdec);
-            J2000RA = newra;
-            J2000DE = newdec;
-        }
+        if (!update.has(0) || !update.has(1))
+            return;
+        J2000EqNP[Ra].setValue(update.number(0));
+        J2000EqNP[DEC].setValue(update.number(1));
+        J2000EqNP.setState(update.state());
+        J2000RA = update.number(0);
+        J2000DE = update.number(1);
         J2000Valid = true;
-    }
-    else if (!strcmp("TELESCOPE_PIER_SIDE", propName) && deviceName == ActiveDeviceTP[ACTIVE_TELESCOPE].getText())
+    }));
+
+    mountSnoops.push_back(snoopProperty(INDI::SnoopRouter::SWITCH, mount, "TELESCOPE_PIER_SIDE", {"PIER_EAST", "PIER_WEST"},
+                                        [this](const INDI::SnoopUpdate & update)
     {
         // set default to say we have no valid information from mount
-        pierSide = -1;
-        //  crack the message
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
-        {
-            const char * elemName = findXMLAttValu(ep, "name");
+        pierSide = update.isOn(0) ? 1 : update.isOn(1) ? 0 : -1;
+    }));
 
-            if (!strcmp(elemName, "PIER_EAST") && !strcmp(pcdataXMLEle(ep), "On"))
-                pierSide = 1;
-            else if (!strcmp(elemName, "PIER_WEST") && !strcmp(pcdataXMLEle(ep), "On"))
-                pierSide = 0;
-        }
-    }
     // Deprecated
-    else if (!strcmp(propName, "TELESCOPE_INFO") && deviceName == ActiveDeviceTP[ACTIVE_TELESCOPE].getText())
-    {
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
-        {
-            const char * name = findXMLAttValu(ep, "name");
-
-            if (!strcmp(name, "TELESCOPE_APERTURE"))
-            {
-                snoopedAperture = atof(pcdataXMLEle(ep));
-            }
-            else if (!strcmp(name, "TELESCOPE_FOCAL_LENGTH"))
-            {
-                snoopedFocalLength = atof(pcdataXMLEle(ep));
-            }
-        }
-    }
-    else if (!strcmp(propName, "FILTER_NAME") && deviceName == ActiveDeviceTP[ACTIVE_FILTER].getText())
+    mountSnoops.push_back(snoopProperty(INDI::SnoopRouter::NUMBER, mount, "TELESCOPE_INFO",
+    {"TELESCOPE_APERTURE", "TELESCOPE_FOCAL_LENGTH"}, [this](const INDI::SnoopUpdate & update)
     {
-        auto newFilterNames = std::vector<std::string>();
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
-            newFilterNames.push_back(pcdataXMLEle(ep));
-        if (newFilterNames != FilterNames)
-        {
-            FilterNames = newFilterNames;
-            LOGF_DEBUG("SNOOP: FILTER_NAME -> %s", join(FilterNames, ", ").c_str());
-        }
-
-    }
-    else if (!strcmp(propName, "FILTER_SLOT") && deviceName == ActiveDeviceTP[ACTIVE_FILTER].getText())
+        if (update.has(0))
+            snoopedAperture = update.number(0);
+        if (update.has(1))
+            snoopedFocalLength = update.number(1);
+    }));
+
+    mountSnoops.push_back(snoopProperty(INDI::SnoopRouter::NUMBER, mount, "GEOGRAPHIC_COORD", {"LAT", "LONG"},
+                                        [this](const INDI::SnoopUpdate & update)
     {
-        auto newFilterSlot = -1;
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
-            newFilterSlot = atoi(pcdataXMLEle(ep));
-        if (newFilterSlot != CurrentFilterSlot)
+        if (update.has(0))
+            Latitude = update.number(0);
+        if (update.has(1))
         {
-            CurrentFilterSlot = newFilterSlot;
-            LOGF_DEBUG("SNOOP: FILTER_SLOT is %d", CurrentFilterSlot);
+            Longitude = update.number(1);
+            if (Longitude > 180)
+                Longitude -= 360;
         }
-    }
-    else if (!strcmp(propName, "SKY_QUALITY") && deviceName == ActiveDeviceTP[ACTIVE_SKYQUALITY].getText())
-    {
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
-        {
-            const char * name = findXMLAttValu(ep, "name");
+    }));
 
-            if (!strcmp(name, "SKY_BRIGHTNESS"))
-            {
-                MPSAS = atof(pcdataXMLEle(ep));
-                break;
-            }
-        }
-    }
-    else if (!strcmp(propName, "ABS_ROTATOR_ANGLE") && deviceName == ActiveDeviceTP[ACTIVE_ROTATOR].getText())
+    m_ActiveSnoops[ACTIVE_ROTATOR].push_back(snoopProperty(INDI::SnoopRouter::NUMBER, ActiveDeviceTP[ACTIVE_ROTATOR].getText(),
+            "ABS_ROTATOR_ANGLE", {"ANGLE"}, [this](const INDI::SnoopUpdate & update)
     {
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
-        {
-            const char * name = findXMLAttValu(ep, "name");
-
-            if (!strcmp(name, "ANGLE"))
-            {
-                RotatorAngle = atof(pcdataXMLEle(ep));
-                break;
-            }
-        }
-    }
+        if (update.has(0))
+            RotatorAngle = update.number(0);
+    }));
 
     // JJ ed 2019-12-10
-    else if (!strcmp(propName, "ABS_FOCUS_POSITION") && deviceName == ActiveDeviceTP[ACTIVE_FOCUSER].getText())
+    const char *focuser = ActiveDeviceTP[ACTIVE_FOCUSER].getText();
+    m_ActiveSnoops[ACTIVE_FOCUSER].push_back(snoopProperty(INDI::SnoopRouter::NUMBER, focuser, "ABS_FOCUS_POSITION",
+    {"FOCUS_ABSOLUTE_POSITION"}, [this](const INDI::SnoopUpdate & update)
     {
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
-        {
-            const char * name = findXMLAttValu(ep, "name");
+        if (update.has(0))
+            FocuserPos = static_cast<long>(update.number(0));
+    }));
+    m_ActiveSnoops[ACTIVE_FOCUSER].push_back(snoopProperty(INDI::SnoopRouter::NUMBER, focuser, "FOCUS_TEMPERATURE",
+    {"TEMPERATURE"}, [this](const INDI::SnoopUpdate & update)
+    {
+        if (update.has(0))
+            FocuserTemp = update.number(0);
+    }));
+    // The focuser asks for a frame at each autofocus position, and reads its stars back from CCD_FRAME_STARS
+    m_ActiveSnoops[ACTIVE_FOCUSER].push_back(snoopProperty(INDI::SnoopRouter::NUMBER, focuser, "FOCUS_AUTOFOCUS_FRAME",
+    {"AF_FRAME", "AF_EXPOSURE"}, [this](const INDI::SnoopUpdate & update)
+    {
+        if (update.state() == IPS_BUSY && update.has(0) && update.has(1))
+            startFocusFrame(static_cast<uint32_t>(update.number(0)), update.number(1));
+    }));
+    //
 
-            if (!strcmp(name, "FOCUS_ABSOLUTE_POSITION"))
-            {
-                FocuserPos = atol(pcdataXMLEle(ep));
-                break;
-            }
-        }
-    }
-    else if (!strcmp(propName, "FOCUS_TEMPERATURE") && deviceName == ActiveDeviceTP[ACTIVE_FOCUSER].getText())
+    const char *filterWheel = ActiveDeviceTP[ACTIVE_FILTER].getText();
+    m_ActiveSnoops[ACTIVE_FILTER].push_back(snoopProperty(INDI::SnoopRouter::NUMBER, filterWheel, "FILTER_SLOT", {},
+                                            [this](const INDI::SnoopUpdate & update)
     {
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
+        auto newFilterSlot = update.count() > 0 ? static_cast<int>(update.number(update.count() - 1)) : -1;
+        if (newFilterSlot != CurrentFilterSlot)
         {
-            const char * name = findXMLAttValu(ep, "name");
-
-            if (!strcmp(name, "TEMPERATURE"))
-            {
-                FocuserTemp = atof(pcdataXMLEle(ep));
-                break;
-            }
+            CurrentFilterSlot = newFilterSlot;
+            LOGF_DEBUG("SNOOP: FILTER_SLOT is %d", CurrentFilterSlot);
         }
-    }
-    //
-
-    else if (!strcmp(propName, "GEOGRAPHIC_COORD") && deviceName == ActiveDeviceTP[ACTIVE_TELESCOPE].getText())
+    }));
+    m_ActiveSnoops[ACTIVE_FILTER].push_back(snoopProperty(INDI::SnoopRouter::TEXT, filterWheel, "FILTER_NAME", {},
+                                            [this](const INDI::SnoopUpdate & update)
     {
-        for (ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
+        auto newFilterNames = std::vector<std::string>();
+        for (size_t i = 0; i < update.count(); i++)
+            newFilterNames.push_back(update.text(i));
+        if (newFilterNames != FilterNames)
         {
-            const char * name = findXMLAttValu(ep, "name");
-
-            if (!strcmp(name, "LONG"))
-            {
-                Longitude = atof(pcdataXMLEle(ep));
-                if (Longitude > 180)
-                    Longitude -= 360;
-            }
-            else if (!strcmp(name, "LAT"))
-            {
-                Latitude = atof(pcdataXMLEle(ep));
-            }
+            FilterNames = newFilterNames;
+            LOGF_DEBUG("SNOOP: FILTER_NAME -> %s", join(FilterNames, ", ").c_str());
         }
-    }
+    }));
 
-    return DefaultDevice::ISSnoopDevice(root);
+    m_ActiveSnoops[ACTIVE_SKYQUALITY].push_back(snoopProperty(INDI::SnoopRouter::NUMBER,
+            ActiveDeviceTP[ACTIVE_SKYQUALITY].getText(), "SKY_QUALITY", {"SKY_BRIGHTNESS"},
+            [this](const INDI::SnoopUpdate & update)
+    {
+        if (update.has(0))
+            MPSAS = update.number(0);
+    }));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -896,6 +1246,26 @@ bool CCD::ISNewText(const char * dev, const char * name, char * texts[], char *
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
     {
         //  Now lets see if it's something we process here
+        if (SyncLeaderTP.isNameMatch(name))
+        {
+            if (n > 0 && texts[0] != nullptr && !strcmp(texts[0], getDeviceName()))
+            {
+                LOG_ERROR("A camera cannot follow itself.");
+                SyncLeaderTP.setState(IPS_ALERT);
+                SyncLeaderTP.apply();
+                return false;
+            }
+
+            SyncLeaderTP.update(texts, names, n);
+            SyncLeaderTP.setState(IPS_OK);
+            SyncLeaderTP.apply();
+            saveConfig(SyncLeaderTP);
+
+            m_SyncFollowed = 0;
+            setSnoopDevice(m_SyncSnoop, SyncLeaderTP[0].getText());
+            return true;
+        }
+
         if (ActiveDeviceTP.isNameMatch(name))
         {
             std::vector<std::string> prevValues;
@@ -934,13 +1304,11 @@ bool CCD::ISNewText(const char * dev, const char * name, char * texts[], char *
             {
                 EqNP.setDeviceName(newMount);
                 J2000EqNP.setDeviceName(newMount);
+                for (int id : m_ActiveSnoops[ACTIVE_TELESCOPE])
+                    setSnoopDevice(id, newMount);
                 if (strlen(newMount) > 0)
                 {
                     LOGF_DEBUG("Snopping on Mount %s", newMount);
-                    IDSnoopDevice(newMount, "EQUATORIAL_EOD_COORD");
-                    IDSnoopDevice(newMount, "EQUATORIAL_COORD");
-                    IDSnoopDevice(newMount, "TELESCOPE_INFO");
-                    IDSnoopDevice(newMount, "GEOGRAPHIC_COORD");
                 }
                 else if (!std::isnan(RA))
                 {
@@ -954,10 +1322,11 @@ bool CCD::ISNewText(const char * dev, const char * name, char * texts[], char *
             auto newRotator = ActiveDeviceTP[ACTIVE_ROTATOR].getText();
             if (newRotator != prevValues[ACTIVE_ROTATOR])
             {
+                for (int id : m_ActiveSnoops[ACTIVE_ROTATOR])
+                    setSnoopDevice(id, newRotator);
                 if (strlen(newRotator) > 0)
                 {
                     LOGF_DEBUG("Snopping on Rotator %s", newRotator);
-                    IDSnoopDevice(newRotator, "ABS_ROTATOR_ANGLE");
                 }
                 else if (!std::isnan(MPSAS))
                 {
@@ -970,11 +1339,11 @@ bool CCD::ISNewText(const char * dev, const char * name, char * texts[], char *
             auto newFocuser = ActiveDeviceTP[ACTIVE_FOCUSER].getText();
             if (newFocuser != prevValues[ACTIVE_FOCUSER])
             {
+                for (int id : m_ActiveSnoops[ACTIVE_FOCUSER])
+                    setSnoopDevice(id, newFocuser);
                 if (strlen(newFocuser) > 0)
                 {
                     LOGF_DEBUG("Snopping on Focuser %s", newFocuser);
-                    IDSnoopDevice(newFocuser, "ABS_FOCUS_POSITION");
-                    IDSnoopDevice(newFocuser, "FOCUS_TEMPERATURE");
                 }
                 else if (!std::isnan(FocuserTemp))
                 {
@@ -988,11 +1357,11 @@ bool CCD::ISNewText(const char * dev, const char * name, char * texts[], char *
             auto newFilterWheel = ActiveDeviceTP[ACTIVE_FILTER].getText();
             if (newFilterWheel != prevValues[ACTIVE_FILTER])
             {
+                for (int id : m_ActiveSnoops[ACTIVE_FILTER])
+                    setSnoopDevice(id, newFilterWheel);
                 if (strlen(newFilterWheel) > 0)
                 {
                     LOGF_DEBUG("Snopping on Filter Wheel %s", newFilterWheel);
-                    IDSnoopDevice(newFilterWheel, "FILTER_SLOT");
-                    IDSnoopDevice(newFilterWheel, "FILTER_NAME");
                 }
                 else if (CurrentFilterSlot != -1)
                 {
@@ -1003,8 +1372,9 @@ bool CCD::ISNewText(const char * dev, const char * name, char * texts[], char *
 
             // Sky Quality
             auto newSkyQuality = ActiveDeviceTP[ACTIVE_SKYQUALITY].getText();
-            if (newSkyQuality != prevValues[ACTIVE_SKYQUALITY] && strlen(newSkyQuality) > 0)
-                IDSnoopDevice(newSkyQuality, "SKY_QUALITY");
+            if (newSkyQuality != prevValues[ACTIVE_SKYQUALITY])
+                for (int id : m_ActiveSnoops[ACTIVE_SKYQUALITY])
+                    setSnoopDevice(id, newSkyQuality);
 
             activeDevicesUpdated();
             saveConfig(ActiveDeviceTP);
@@ -1153,12 +1523,26 @@ bool CCD::ISNewNumber(const char * dev, const char * name, double values[], char
 
             // Only abort when busy if we are not already in an exposure loops
             //if (PrimaryCCD.ImageExposureNP.s == IPS_BUSY && FastExposureToggleS[INDI_DISABLED].s == ISS_ON)
-            if (PrimaryCCD.ImageExposureNP.getState() == IPS_BUSY)
+            if (cancelSyncExposure())
+                LOG_DEBUG("Synchronized exposure replaced.");
+            else if (PrimaryCCD.ImageExposureNP.getState() == IPS_BUSY)
             {
                 if (CanAbort() && AbortExposure() == false)
                     DEBUG(Logger::DBG_WARNING, "Warning: Aborting exposure failed.");
             }
 
+            // A client exposure replaces an autofocus frame, the focuser times out on it
+            m_FocusFrame = 0;
+
+            // A leader starts later, together with the cameras following it
+            if (SyncNP[SYNC_LEAD].getValue() > 0)
+            {
+                auto now = std::chrono::system_clock::now().time_since_epoch();
+                armSyncExposure(std::chrono::duration<double>(now).count() + SyncNP[SYNC_LEAD].getValue(), ExposureTime);
+                return true;
+            }
+            m_SyncUpload = false;
+
             if (StartExposure(ExposureTime))
             {
                 PrimaryCCD.ImageExposureNP.setState(IPS_BUSY);
@@ -1367,6 +1751,20 @@ bool CCD::ISNewNumber(const char * dev, const char * name, double values[], char
             return true;
         }
 
+        // Guide ROI settings
+        for (CCDChip * targetChip : {&PrimaryCCD, &GuideCCD})
+        {
+            if (targetChip->GuideROINP.isNameMatch(name))
+            {
+                targetChip->GuideROINP.update(values, names, n);
+                targetChip->GuideROINP.setState(IPS_OK);
+                if (targetChip->getGuideROIMode() != CCDChip::GUIDE_ROI_OFF && !setGuideROIFrame(targetChip, false))
+                    targetChip->GuideROINP.setState(IPS_ALERT);
+                targetChip->GuideROINP.apply();
+                return true;
+            }
+        }
+
 #if 0
         if (!strcmp(name, "CCD_GUIDESTAR"))
         {
@@ -1393,6 +1791,54 @@ bool CCD::ISNewNumber(const char * dev, const char * name, double values[], char
             return true;
         }
 
+        // Compression Threads
+        if (CompressionThreadsNP.isNameMatch(name))
+        {
+            CompressionThreadsNP.update(values, names, n);
+            CompressionThreadsNP.setState(IPS_OK);
+            CompressionThreadsNP.apply();
+            saveConfig(CompressionThreadsNP);
+            return true;
+        }
+
+        // Local Write
+        if (SyncNP.isNameMatch(name))
+        {
+            SyncNP.update(values, names, n);
+            SyncNP.setState(IPS_OK);
+            SyncNP.apply();
+            saveConfig(SyncNP);
+            return true;
+        }
+
+        if (LocalWriteNP.isNameMatch(name))
+        {
+            LocalWriteNP.update(values, names, n);
+            LocalWriteNP.setState(IPS_OK);
+            LocalWriteNP.apply();
+            saveConfig(LocalWriteNP);
+            return true;
+        }
+
+        // Compression Level
+        if (CompressionLevelNP.isNameMatch(name))
+        {
+            CompressionLevelNP.update(values, names, n);
+            CompressionLevelNP.setState(IPS_OK);
+            CompressionLevelNP.apply();
+            saveConfig(CompressionLevelNP);
+            return true;
+        }
+
+        if (ImagePreviewNP.isNameMatch(name))
+        {
+            ImagePreviewNP.update(values, names, n);
+            ImagePreviewNP.setState(IPS_OK);
+            ImagePreviewNP.apply();
+            saveConfig(ImagePreviewNP);
+            return true;
+        }
+
         // CCD TEMPERATURE
         if (TemperatureNP.isNameMatch(name))
         {
@@ -1566,6 +2012,82 @@ bool CCD::ISNewSwitch(const char * dev, const char * name, ISState * states, cha
             return true;
         }
 
+        // Compression Codec
+        if (CompressionCodecSP.isNameMatch(name))
+        {
+            int prevCodec = CompressionCodecSP.findOnSwitchIndex();
+            CompressionCodecSP.update(states, names, n);
+
+            int codec = CompressionCodecSP.findOnSwitchIndex();
+            bool supported = true;
+#ifndef HAVE_ZSTD
+            if (codec == CODEC_ZSTD)
+                supported = false;
+#endif
+#ifndef HAVE_LZ4
+            if (codec == CODEC_LZ4)
+                supported = false;
+#endif
+            if (supported)
+            {
+                CompressionCodecSP.setState(IPS_OK);
+                saveConfig(CompressionCodecSP);
+            }
+            else
+            {
+                LOGF_ERROR("%s compression is not supported by this build.", CompressionCodecSP[codec].getLabel());
+                CompressionCodecSP.reset();
+                CompressionCodecSP[prevCodec].setState(ISS_ON);
+                CompressionCodecSP.setState(IPS_ALERT);
+            }
+            CompressionCodecSP.apply();
+            return true;
+        }
+
+        // Image Statistics Toggle
+        if (ImageStatsToggleSP.isNameMatch(name))
+        {
+            bool wasEnabled = ImageStatsToggleSP[INDI_ENABLED].getState() == ISS_ON;
+            ImageStatsToggleSP.update(states, names, n);
+            bool enabled = ImageStatsToggleSP[INDI_ENABLED].getState() == ISS_ON;
+            if (enabled && !wasEnabled)
+            {
+                defineProperty(ImageStatsNP);
+                defineProperty(ImageHistogramBP);
+            }
+            else if (!enabled && wasEnabled)
+            {
+                deleteProperty(ImageStatsNP);
+                deleteProperty(ImageHistogramBP);
+            }
+            ImageStatsToggleSP.setState(IPS_OK);
+            ImageStatsToggleSP.apply();
+            saveConfig(ImageStatsToggleSP);
+            return true;
+        }
+
+        // Image Preview Toggle
+        if (ImagePreviewToggleSP.isNameMatch(name))
+        {
+            bool wasEnabled = ImagePreviewToggleSP[INDI_ENABLED].getState() == ISS_ON;
+            ImagePreviewToggleSP.update(states, names, n);
+            bool enabled = ImagePreviewToggleSP[INDI_ENABLED].getState() == ISS_ON;
+            if (enabled && !wasEnabled)
+            {
+                defineProperty(ImagePreviewNP);
+                defineProperty(ImagePreviewBP);
+            }
+            else if (!enabled && wasEnabled)
+            {
+                deleteProperty(ImagePreviewNP);
+                deleteProperty(ImagePreviewBP);
+            }
+            ImagePreviewToggleSP.setState(IPS_OK);
+            ImagePreviewToggleSP.apply();
+            saveConfig(ImagePreviewToggleSP);
+            return true;
+        }
+
         // Fast Exposure Toggle
         if (FastExposureToggleSP.isNameMatch(name))
         {
@@ -1611,14 +2133,43 @@ bool CCD::ISNewSwitch(const char * dev, const char * name, ISState * states, cha
         }
 
         // Primary Chip Frame Reset
-        if (PrimaryCCD.ResetSP.isNameMatch(name))
+        // Guide ROI mode
+        for (CCDChip * targetChip : {&PrimaryCCD, &GuideCCD})
         {
-            PrimaryCCD.ResetSP.reset();
-            PrimaryCCD.ResetSP.setState(IPS_OK);
-            if (CanBin())
-                UpdateCCDBin(1, 1);
-            if (CanSubFrame())
-                UpdateCCDFrame(0, 0, PrimaryCCD.getXRes(), PrimaryCCD.getYRes());
+            if (targetChip->GuideROISP.isNameMatch(name))
+            {
+                bool wasOn = targetChip->getGuideROIMode() != CCDChip::GUIDE_ROI_OFF;
+                targetChip->GuideROISP.update(states, names, n);
+                bool on = targetChip->getGuideROIMode() != CCDChip::GUIDE_ROI_OFF;
+                targetChip->GuideROISP.setState(IPS_OK);
+
+                // Back to full frames when the mode is turned off
+                if ((on || wasOn) && !setGuideROIFrame(targetChip, !on) && on)
+                {
+                    targetChip->GuideROISP.reset();
+                    targetChip->GuideROISP[CCDChip::GUIDE_ROI_OFF].setState(ISS_ON);
+                    targetChip->GuideROISP.setState(IPS_ALERT);
+                    on = false;
+                }
+
+                if (on && !wasOn)
+                    defineProperty(targetChip->GuideStarNP);
+                else if (!on && wasOn)
+                    deleteProperty(targetChip->GuideStarNP);
+
+                targetChip->GuideROISP.apply();
+                return true;
+            }
+        }
+
+        if (PrimaryCCD.ResetSP.isNameMatch(name))
+        {
+            PrimaryCCD.ResetSP.reset();
+            PrimaryCCD.ResetSP.setState(IPS_OK);
+            if (CanBin())
+                UpdateCCDBin(1, 1);
+            if (CanSubFrame())
+                UpdateCCDFrame(0, 0, PrimaryCCD.getXRes(), PrimaryCCD.getYRes());
 
             PrimaryCCD.ResetSP.apply();
             return true;
@@ -1629,7 +2180,8 @@ bool CCD::ISNewSwitch(const char * dev, const char * name, ISState * states, cha
         {
             PrimaryCCD.AbortExposureSP.reset();
 
-            if (AbortExposure())
+            // An exposure waiting for its synchronized start did not start yet
+            if (cancelSyncExposure() || AbortExposure())
             {
                 PrimaryCCD.AbortExposureSP.setState(IPS_OK);
                 PrimaryCCD.ImageExposureNP.setState(IPS_IDLE);
@@ -1973,6 +2525,39 @@ bool CCD::UpdateGuiderFrame(int x, int y, int w, int h)
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CCD::setGuideROIFrame(CCDChip * targetChip, bool fullFrame)
+{
+    int xRes = targetChip->getXRes(), yRes = targetChip->getYRes();
+    int x = 0, y = 0, w = xRes, h = yRes;
+    if (!fullFrame)
+    {
+        int box = targetChip->GuideROINP[CCDChip::ROI_BOX].getValue();
+        w = std::min(box, xRes);
+        h = std::min(box, yRes);
+        x = std::max(0, std::min(xRes - w,
+                                 static_cast<int>(std::lround(targetChip->GuideROINP[CCDChip::ROI_STAR_X].getValue() - w / 2.0))));
+        y = std::max(0, std::min(yRes - h,
+                                 static_cast<int>(std::lround(targetChip->GuideROINP[CCDChip::ROI_STAR_Y].getValue() - h / 2.0))));
+    }
+
+    bool rc = (targetChip == &PrimaryCCD) ? UpdateCCDFrame(x, y, w, h) : UpdateGuiderFrame(x, y, w, h);
+    if (rc)
+    {
+        targetChip->ImageFrameNP[CCDChip::FRAME_X].setValue(x);
+        targetChip->ImageFrameNP[CCDChip::FRAME_Y].setValue(y);
+        targetChip->ImageFrameNP[CCDChip::FRAME_W].setValue(w);
+        targetChip->ImageFrameNP[CCDChip::FRAME_H].setValue(h);
+        targetChip->ImageFrameNP.setState(IPS_OK);
+    }
+    else
+        targetChip->ImageFrameNP.setState(IPS_ALERT);
+    targetChip->ImageFrameNP.apply();
+    return rc;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1986,7 +2571,10 @@ bool CCD::UpdateCCDBin(int hor, int ver)
 
     // DSP
     if (HasDSP())
-        DSP->setSizes(2, new int[2] { PrimaryCCD.getSubW() / hor, PrimaryCCD.getSubH() / ver });
+    {
+        int sizes[2] = { PrimaryCCD.getSubW() / hor, PrimaryCCD.getSubH() / ver };
+        DSP->setSizes(2, sizes);
+    }
 
     return true;
 }
@@ -2062,10 +2650,10 @@ void CCD::addFITSKeywords(CCDChip * targetChip, std::vector<FITSRecord> &fitsKey
 
     strncpy(dev_name, getDeviceName(), MAXINDINAME);
 
-    fitsKeywords.push_back({"EXPTIME", exposureDuration, 6, "Total Exposure Time (s)"});
+    fitsKeywords.push_back({"EXPTIME", targetChip->m_CompletedDuration, 6, "Total Exposure Time (s)"});
 
     if (targetChip->getFrameType() == CCDChip::DARK_FRAME)
-        fitsKeywords.push_back({"DARKTIME", exposureDuration, 6, "Total Dark Exposure Time (s)"});
+        fitsKeywords.push_back({"DARKTIME", targetChip->m_CompletedDuration, 6, "Total Dark Exposure Time (s)"});
 
     // If the camera has a cooler OR if the temperature permission was explicitly set to Read-Only, then record the temperature
     if (HasCooler() || TemperatureNP.getPermission() == IP_RO)
@@ -2106,14 +2694,20 @@ void CCD::addFITSKeywords(CCDChip * targetChip, std::vector<FITSRecord> &fitsKey
         fitsKeywords.push_back({"FILTER", FilterNames.at(CurrentFilterSlot - 1).c_str(), "Filter"});
     }
 
+    const ImageStatistics &stats = targetChip->m_ImageStats;
+    if (targetChip->m_ImageStatsValid)
+    {
+        fitsKeywords.push_back({"DATAMIN", stats.min, 6, "Minimum value"});
+        fitsKeywords.push_back({"DATAMAX", stats.max, 6, "Maximum value"});
+        fitsKeywords.push_back({"DATAMEAN", stats.mean, 6, "Mean value"});
+        fitsKeywords.push_back({"DATAMED", stats.median, 6, "Median value"});
+        fitsKeywords.push_back({"DATASTD", stats.stddev, 6, "Standard deviation"});
+    }
 #ifdef WITH_MINMAX
-    if (targetChip->getNAxis() == 2)
+    else if (targetChip->m_CompletedMinMaxValid)
     {
-        double min_val, max_val;
-        getMinMax(&min_val, &max_val, targetChip);
-
-        fitsKeywords.push_back({"DATAMIN", min_val, 6, "Minimum value"});
-        fitsKeywords.push_back({"DATAMAX", max_val, 6, "Maximum value"});
+        fitsKeywords.push_back({"DATAMIN", targetChip->m_CompletedMin, 6, "Minimum value"});
+        fitsKeywords.push_back({"DATAMAX", targetChip->m_CompletedMax, 6, "Maximum value"});
     }
 #endif
 
@@ -2303,7 +2897,7 @@ void CCD::addFITSKeywords(CCDChip * targetChip, std::vector<FITSRecord> &fitsKey
         }
     }
 
-    fitsKeywords.push_back({"DATE-OBS", exposureStartTime, "UTC start date of observation"});
+    fitsKeywords.push_back({"DATE-OBS", targetChip->m_CompletedStartTime, "UTC start date of observation"});
     fitsKeywords.push_back(FITSRecord("Generated by INDI"));
 }
 
@@ -2325,42 +2919,553 @@ bool CCD::ExposureComplete(CCDChip * targetChip)
     // Reset POLLMS to default value
     setCurrentPollingPeriod(getPollingPeriod());
 
+    if (targetChip == &PrimaryCCD && m_FocusFrame != 0)
+    {
+        measureFrameStars(targetChip, targetChip->getFrameBuffer());
+        targetChip->setExposureComplete();
+        return true;
+    }
+
+    // The guide star is measured before returning, while the frame buffer still holds this frame
+    if (targetChip->getGuideROIMode() != CCDChip::GUIDE_ROI_OFF)
+    {
+        measureGuideStar(targetChip, targetChip->getFrameBuffer());
+        if (targetChip->getGuideROIMode() == CCDChip::GUIDE_ROI_DATA)
+        {
+            // No image to encode nor upload, the next exposure may start right away
+            if (processFastExposure(targetChip) && FastExposureToggleSP[INDI_ENABLED].getState() != ISS_ON)
+                targetChip->setExposureComplete();
+            return true;
+        }
+    }
+
+    if (m_PipelinedExposures)
+    {
+        // Copy the frame now, the driver may read the next one into the buffer as soon as we return.
+        // With a frame ring this waits for a buffer while all of them are still being uploaded.
+        uint8_t *ring = targetChip->acquireFrame();
+
+        std::unique_lock<std::mutex> guard(targetChip->getBufferLock());
+        size_t frameSize = targetChip->getFrameBufferSize();
+        std::shared_ptr<const uint8_t> frame;
+        if (ring)
+        {
+            memcpy(ring, targetChip->getFrameBuffer(), frameSize);
+            frame.reset(ring, [targetChip](const uint8_t * buffer)
+            {
+                targetChip->releaseFrame(const_cast<uint8_t *>(buffer));
+            });
+        }
+        else
+        {
+            auto copy = std::make_shared<std::vector<uint8_t>>(targetChip->getFrameBuffer(),
+                        targetChip->getFrameBuffer() + frameSize);
+            frame = std::shared_ptr<const uint8_t>(copy, copy->data());
+        }
+        guard.unlock();
+
+        pipelineFrame(targetChip, frame, frameSize);
+        return true;
+    }
+
     // Run async
     std::thread(&CCD::ExposureCompletePrivate, this, targetChip).detach();
 
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CCD::FrameComplete(CCDChip * targetChip, uint8_t * frame)
+{
+    // Reset POLLMS to default value
+    setCurrentPollingPeriod(getPollingPeriod());
+
+    if (targetChip == &PrimaryCCD && m_FocusFrame != 0)
+    {
+        measureFrameStars(targetChip, frame);
+        targetChip->releaseFrame(frame);
+        targetChip->setExposureComplete();
+        return true;
+    }
+
+    if (targetChip->getGuideROIMode() != CCDChip::GUIDE_ROI_OFF)
+    {
+        measureGuideStar(targetChip, frame);
+        if (targetChip->getGuideROIMode() == CCDChip::GUIDE_ROI_DATA)
+        {
+            targetChip->releaseFrame(frame);
+            if (processFastExposure(targetChip) && FastExposureToggleSP[INDI_ENABLED].getState() != ISS_ON)
+                targetChip->setExposureComplete();
+            return true;
+        }
+    }
+
+    pipelineFrame(targetChip, std::shared_ptr<const uint8_t>(frame, [targetChip](const uint8_t * buffer)
+    {
+        targetChip->releaseFrame(const_cast<uint8_t *>(buffer));
+    }), targetChip->getFrameBufferSize());
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::pipelineFrame(CCDChip * targetChip, std::shared_ptr<const uint8_t> frame, size_t frameSize)
+{
+    std::unique_lock<std::mutex> pipelineGuard(targetChip->m_PipelineLock);
+    uint64_t ticket = targetChip->m_PipelineNext++;
+    pipelineGuard.unlock();
+
+    std::thread(&CCD::PipelinedExposureComplete, this, targetChip, std::move(frame), frameSize,
+                targetChip->getExposureDuration(), std::string(targetChip->getExposureStartTime()), ticket).detach();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
 {
     LOG_DEBUG("Exposure complete");
+    INDI_PROBE2(exposure_complete, getDeviceName(), targetChip->getFrameBufferSize());
 
     // save information used for the fits header
-    exposureDuration = targetChip->getExposureDuration();
-    strncpy(exposureStartTime, targetChip->getExposureStartTime(), MAXINDINAME);
+    targetChip->m_CompletedDuration = targetChip->getExposureDuration();
+    strncpy(targetChip->m_CompletedStartTime, targetChip->getExposureStartTime(), MAXINDINAME - 1);
 
-    if(HasDSP())
+    if (HasDSP() && targetChip->getFrameType() == CCDChip::LIGHT_FRAME)
     {
-        uint8_t* buf = static_cast<uint8_t*>(malloc(targetChip->getFrameBufferSize()));
-        memcpy(buf, targetChip->getFrameBuffer(), targetChip->getFrameBufferSize());
-        DSP->processBLOB(buf, 2, new int[2] { targetChip->getXRes() / targetChip->getBinX(), targetChip->getYRes() / targetChip->getBinY() },
-                         targetChip->getBPP());
-        free(buf);
+        std::lock_guard<std::mutex> calibrationGuard(targetChip->getBufferLock());
+        calibrateFrame(targetChip, targetChip->getFrameBuffer(), targetChip->m_CompletedDuration);
+        INDI_PROBE2(exposure_calibrated, getDeviceName(), targetChip->getFrameBufferSize());
     }
 
-    if (processFastExposure(targetChip) == false)
+    // DSP plugins read the frame buffer in place while it is uploaded, so the driver must not read
+    // the next frame into it until both are done.
+    std::unique_lock<std::mutex> guard(targetChip->getBufferLock(), std::defer_lock);
+    std::thread dsp;
+    if (HasDSP() && DSP->isActive())
+    {
+        guard.lock();
+        dsp = std::thread(&CCD::processDSP, this, targetChip, targetChip->getFrameBuffer());
+    }
+
+    INDI_PROBE2(exposure_upload, getDeviceName(), targetChip->getFrameBufferSize());
+    bool rc = processFastExposure(targetChip) &&
+              uploadExposure(targetChip, targetChip->getFrameBuffer(), targetChip->getFrameBufferSize(), !guard.owns_lock());
+
+    if (dsp.joinable())
+        dsp.join();
+    INDI_PROBE2(exposure_done, getDeviceName(), rc);
+    return rc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::publishPreview(CCDChip * targetChip, const uint8_t * frame)
+{
+    uint32_t channels = targetChip->getNAxis() == 3 ? 3 : 1;
+    ImagePreview preview(targetChip->getSubW() / targetChip->getBinX(), targetChip->getSubH() / targetChip->getBinY(),
+                         channels, targetChip->getBPP());
+    if (!ImagePreview::supported(channels, targetChip->getBPP()))
+        return;
+
+    preview.setMaxWidth(ImagePreviewNP[PREVIEW_WIDTH].getValue());
+    preview.setQuality(ImagePreviewNP[PREVIEW_QUALITY].getValue());
+    preview.setBayer(channels == 1 && HasBayer());
+    if (!preview.encode(frame, m_PreviewJPEG))
+    {
+        ImagePreviewBP.setState(IPS_ALERT);
+        ImagePreviewBP.apply();
+        return;
+    }
+
+    ImagePreviewBP[0].setBlob(m_PreviewJPEG.data());
+    ImagePreviewBP[0].setBlobLen(m_PreviewJPEG.size());
+    ImagePreviewBP[0].setSize(m_PreviewJPEG.size());
+    ImagePreviewBP[0].setFormat(".jpg");
+    ImagePreviewBP.setState(IPS_OK);
+    ImagePreviewBP.apply();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::measureGuideStar(CCDChip * targetChip, const uint8_t * frame)
+{
+    int binX = targetChip->getBinX(), binY = targetChip->getBinY();
+    GuideStar star;
+    if (targetChip->getNAxis() != 2 || !findGuideStar(frame, targetChip->getSubW() / binX, targetChip->getSubH() / binY,
+            targetChip->getBPP(), star))
+    {
+        targetChip->GuideStarNP.setState(IPS_ALERT);
+        targetChip->GuideStarNP.apply();
+        return;
+    }
+
+    // From the binned pixels of the box to the unbinned pixels of the full frame
+    targetChip->GuideStarNP[CCDChip::GUIDESTAR_X].setValue(targetChip->getSubX() + star.x * binX + (binX - 1) / 2.0);
+    targetChip->GuideStarNP[CCDChip::GUIDESTAR_Y].setValue(targetChip->getSubY() + star.y * binY + (binY - 1) / 2.0);
+    targetChip->GuideStarNP[CCDChip::GUIDESTAR_SNR].setValue(star.snr);
+    targetChip->GuideStarNP[CCDChip::GUIDESTAR_HFR].setValue(star.hfr * binX);
+    targetChip->GuideStarNP.setState(IPS_OK);
+    targetChip->GuideStarNP.apply();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::startFocusFrame(uint32_t frame, double duration)
+{
+    // Each request is served once, the focuser asks again with a new frame number
+    if (frame == 0 || frame == m_FocusFrame || frame == m_FocusFrameServed)
+        return;
+
+    bool started = false;
+    if (PrimaryCCD.ImageExposureNP.getState() == IPS_BUSY)
+        LOGF_WARN("Autofocus frame %u not taken, an exposure is in progress.", frame);
+    else
+    {
+        m_FocusFrame = frame;
+        ExposureTime = std::max(duration, PrimaryCCD.ImageExposureNP[0].getMin());
+        started = StartExposure(ExposureTime);
+    }
+
+    if (started)
+    {
+        LOGF_DEBUG("Autofocus frame %u, %g seconds.", frame, ExposureTime);
+        PrimaryCCD.ImageExposureNP.setState(IPS_BUSY);
+        if (ExposureTime * 1000 < getCurrentPollingPeriod())
+            setCurrentPollingPeriod(ExposureTime * 950);
+        PrimaryCCD.ImageExposureNP.apply();
+        return;
+    }
+
+    // The focuser gives up on this frame when it reads the alert
+    m_FocusFrame = 0;
+    m_FocusFrameServed = frame;
+    FrameStarsNP[FRAME_STARS_FRAME].setValue(frame);
+    FrameStarsNP.setState(IPS_ALERT);
+    FrameStarsNP.apply();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::armSyncExposure(double startTime, double duration)
+{
+    ExposureTime = duration;
+    PrimaryCCD.ImageExposureNP[0].setValue(duration);
+    m_SyncArmed = startTime;
+
+    double wait = startTime - std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (wait < 0)
+        LOGF_WARN("Synchronized exposure starting %.0f ms late.", -wait * 1000);
+    else
+        LOGF_DEBUG("Synchronized exposure of %g seconds starting in %.0f ms.", duration, wait * 1000);
+    m_SyncTimer.start(std::max(0L, std::lround(wait * 1000)));
+
+    // Followers start at the same time
+    SyncStartNP[SYNC_TIME].setValue(startTime);
+    SyncStartNP[SYNC_DURATION].setValue(duration);
+    SyncStartNP.setState(IPS_BUSY);
+    SyncStartNP.apply();
+
+    PrimaryCCD.ImageExposureNP.setState(IPS_BUSY);
+    PrimaryCCD.ImageExposureNP.apply();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::startSyncExposure()
+{
+    if (m_SyncArmed == 0)
+        return;
+    m_SyncArmed = 0;
+
+    bool started = StartExposure(ExposureTime);
+    m_SyncUpload = started;
+    SyncStartNP.setState(started ? IPS_OK : IPS_ALERT);
+    SyncStartNP.apply();
+
+    if (started)
+    {
+        PrimaryCCD.ImageExposureNP.setState(IPS_BUSY);
+        if (ExposureTime * 1000 < getCurrentPollingPeriod())
+            setCurrentPollingPeriod(ExposureTime * 950);
+    }
+    else
+        PrimaryCCD.ImageExposureNP.setState(IPS_ALERT);
+    PrimaryCCD.ImageExposureNP.apply();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CCD::cancelSyncExposure()
+{
+    if (m_SyncArmed == 0)
         return false;
 
+    m_SyncTimer.stop();
+    m_SyncArmed = 0;
+    SyncStartNP.setState(IPS_IDLE);
+    SyncStartNP.apply();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::followSyncStart(const INDI::SnoopUpdate &update)
+{
+    if (!update.has(0) || !update.has(1) || !isConnected())
+        return;
+
+    double startTime = update.number(0);
+    if (update.state() != IPS_BUSY)
+    {
+        // The leader gave up its exposure before it started
+        if (update.state() == IPS_IDLE && startTime == m_SyncArmed && cancelSyncExposure())
+        {
+            LOG_INFO("Synchronized exposure aborted by the leader.");
+            PrimaryCCD.ImageExposureNP.setState(IPS_IDLE);
+            PrimaryCCD.ImageExposureNP.apply();
+        }
+        return;
+    }
+
+    // Each start is followed once
+    if (startTime == m_SyncFollowed)
+        return;
+    m_SyncFollowed = startTime;
+
+    if (PrimaryCCD.ImageExposureNP.getState() == IPS_BUSY)
+    {
+        LOGF_WARN("Synchronized exposure of %s not taken, an exposure is in progress.", SyncLeaderTP[0].getText());
+        return;
+    }
+
+    m_FocusFrame = 0;
+    double duration = PrimaryCCD.getFrameType() == CCDChip::BIAS_FRAME ? PrimaryCCD.ImageExposureNP[0].getMin() :
+                      std::max(PrimaryCCD.ImageExposureNP[0].getMin(), std::min(PrimaryCCD.ImageExposureNP[0].getMax(),
+                               update.number(1)));
+    armSyncExposure(startTime, duration);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::measureFrameStars(CCDChip * targetChip, const uint8_t * frame)
+{
+    int binX = targetChip->getBinX();
+    int width = targetChip->getSubW() / binX, height = targetChip->getSubH() / targetChip->getBinY();
+    std::vector<double> hfr, fwhm;
+
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, width);
+    dsp_stream_add_dim(stream, height);
+    dsp_stream_alloc_buffer(stream, stream->len);
+    bool copied = targetChip->getNAxis() == 2;
+    switch (targetChip->getBPP())
+    {
+        case 8:
+            dsp_buffer_copy(frame, stream->buf, stream->len);
+            break;
+        case 16:
+            dsp_buffer_copy(reinterpret_cast<const uint16_t *>(frame), stream->buf, stream->len);
+            break;
+        case 32:
+            dsp_buffer_copy(reinterpret_cast<const uint32_t *>(frame), stream->buf, stream->len);
+            break;
+        default:
+            copied = false;
+    }
+    if (copied)
+    {
+        int count = dsp_detect_stars(stream, 5, 5);
+        for (int i = 0; i < count; i++)
+        {
+            hfr.push_back(stream->stars[i].hfr);
+            fwhm.push_back(stream->stars[i].fwhm);
+        }
+    }
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+
+    // Medians resist the odd hot pixel cluster or galaxy, in unbinned pixels like the guide star
+    auto median = [binX](std::vector<double> &values)
+    {
+        if (values.empty())
+            return 0.0;
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        return values[values.size() / 2] * binX;
+    };
+    FrameStarsNP[FRAME_STARS_COUNT].setValue(hfr.size());
+    FrameStarsNP[FRAME_STARS_HFR].setValue(median(hfr));
+    FrameStarsNP[FRAME_STARS_FWHM].setValue(median(fwhm));
+    FrameStarsNP[FRAME_STARS_FRAME].setValue(m_FocusFrame);
+    FrameStarsNP.setState(copied ? IPS_OK : IPS_ALERT);
+    FrameStarsNP.apply();
+
+    m_FocusFrameServed = m_FocusFrame;
+    m_FocusFrame = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::calibrateFrame(CCDChip * targetChip, uint8_t * frame, double duration)
+{
+    DSP::Calibration::Frame info;
+    info.binX = targetChip->getBinX();
+    info.binY = targetChip->getBinY();
+    info.width = targetChip->getSubW() / info.binX;
+    info.height = targetChip->getSubH() / info.binY;
+    info.x = targetChip->getSubX() / info.binX;
+    info.y = targetChip->getSubY() / info.binY;
+    info.exposure = duration;
+    info.temperature = (HasCooler() || TemperatureNP.getPermission() == IP_RO) ? TemperatureNP[0].getValue() : NAN;
+    if (CurrentFilterSlot >= 1 && CurrentFilterSlot <= static_cast<int>(FilterNames.size()))
+        info.filter = FilterNames[CurrentFilterSlot - 1];
+
+    std::lock_guard<std::mutex> lock(m_DSPLock);
+    DSP->calibrate(frame, targetChip->getBPP(), info);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::processDSP(CCDChip * targetChip, const uint8_t * frame)
+{
+    int sizes[2] = { targetChip->getSubW() / targetChip->getBinX(), targetChip->getSubH() / targetChip->getBinY() };
+    // The plugins are shared by both chips
+    std::lock_guard<std::mutex> lock(m_DSPLock);
+    DSP->processBLOB(const_cast<uint8_t *>(frame), 2, sizes, targetChip->getBPP());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::PipelinedExposureComplete(CCDChip * targetChip, std::shared_ptr<const uint8_t> frame, size_t frameSize,
+                                    double duration, std::string startTime, uint64_t ticket)
+{
+    LOG_DEBUG("Exposure complete");
+    INDI_PROBE2(exposure_complete, getDeviceName(), frameSize);
+
+    // Start the next fast exposure right away, uploads of this frame and the previous ones may still be running
+    bool armed = processFastExposure(targetChip);
+
+    // Frames of the chip are encoded and uploaded one at a time, in the order they completed
+    std::unique_lock<std::mutex> pipelineGuard(targetChip->m_PipelineLock);
+    targetChip->m_PipelineTurn.wait(pipelineGuard, [&] { return targetChip->m_PipelineServing == ticket; });
+    pipelineGuard.unlock();
+
+    // save information used for the fits header
+    targetChip->m_CompletedDuration = duration;
+    strncpy(targetChip->m_CompletedStartTime, startTime.c_str(), MAXINDINAME - 1);
+
+    // The copy is ours: calibrated in place, then DSP plugins and the upload both read it
+    if (HasDSP() && targetChip->getFrameType() == CCDChip::LIGHT_FRAME)
+    {
+        calibrateFrame(targetChip, const_cast<uint8_t *>(frame.get()), duration);
+        INDI_PROBE2(exposure_calibrated, getDeviceName(), frameSize);
+    }
+
+    std::thread dsp;
+    if (HasDSP() && DSP->isActive())
+        dsp = std::thread(&CCD::processDSP, this, targetChip, frame.get());
+
+    INDI_PROBE2(exposure_upload, getDeviceName(), frameSize);
+    bool rc = armed && uploadExposure(targetChip, frame.get(), frameSize, false);
+    INDI_UNUSED(rc);
+
+    if (dsp.joinable())
+        dsp.join();
+    INDI_PROBE2(exposure_done, getDeviceName(), rc);
+
+    pipelineGuard.lock();
+    targetChip->m_PipelineServing++;
+    pipelineGuard.unlock();
+    targetChip->m_PipelineTurn.notify_all();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CCD::uploadExposure(CCDChip * targetChip, const uint8_t * frame, size_t frameSize, bool lockBuffer)
+{
+    // Cameras exposing together take turns to upload
+    if (targetChip == &PrimaryCCD && m_SyncUpload.exchange(false) && SyncNP[SYNC_UPLOAD_DELAY].getValue() > 0)
+        std::this_thread::sleep_for(std::chrono::duration<double>(SyncNP[SYNC_UPLOAD_DELAY].getValue()));
+
+    // The frame buffer is shared with the driver unless it is a pipelined copy
+    std::unique_lock<std::mutex> guard(targetChip->getBufferLock(), std::defer_lock);
+
     bool sendImage = (UploadSP[UPLOAD_CLIENT].getState() == ISS_ON || UploadSP[UPLOAD_BOTH].getState() == ISS_ON);
     bool saveImage = (UploadSP[UPLOAD_LOCAL].getState() == ISS_ON || UploadSP[UPLOAD_BOTH].getState() == ISS_ON);
 
     // Do not send or save an empty image.
-    if (targetChip->getFrameBufferSize() == 0)
+    if (frameSize == 0)
         sendImage = saveImage = false;
 
+    // Statistics are published even when the frame itself is not sent
+    ImageStatistics &stats = targetChip->m_ImageStats;
+    targetChip->m_ImageStatsValid = false;
+    if (frameSize > 0 && targetChip->getNAxis() == 2 && ImageStatsToggleSP[INDI_ENABLED].getState() == ISS_ON)
+    {
+        if (lockBuffer)
+            guard.lock();
+        targetChip->m_ImageStatsValid = computeImageStatistics(frame, targetChip->getSubW() / targetChip->getBinX(),
+                                        targetChip->getSubH() / targetChip->getBinY(), targetChip->getBPP(), stats);
+        if (lockBuffer)
+            guard.unlock();
+
+        if (targetChip->m_ImageStatsValid && targetChip == &PrimaryCCD)
+        {
+            ImageStatsNP[STATS_MIN].setValue(stats.min);
+            ImageStatsNP[STATS_MAX].setValue(stats.max);
+            ImageStatsNP[STATS_MEAN].setValue(stats.mean);
+            ImageStatsNP[STATS_STDDEV].setValue(stats.stddev);
+            ImageStatsNP[STATS_MEDIAN].setValue(stats.median);
+            ImageStatsNP.setState(IPS_OK);
+            ImageStatsNP.apply();
+
+            ImageHistogramBP[0].setBlob(stats.histogram.data());
+            ImageHistogramBP[0].setBlobLen(stats.histogram.size() * sizeof(uint32_t));
+            ImageHistogramBP[0].setSize(stats.histogram.size() * sizeof(uint32_t));
+            ImageHistogramBP[0].setFormat(".histogram");
+            ImageHistogramBP.setState(IPS_OK);
+            ImageHistogramBP.apply();
+        }
+    }
+
+#ifdef WITH_MINMAX
+    // Taken from the frame being uploaded, the chip buffer may already hold the next pipelined exposure
+    targetChip->m_CompletedMinMaxValid = false;
+    if ((sendImage || saveImage) && !targetChip->m_ImageStatsValid && targetChip->getNAxis() == 2)
+    {
+        if (lockBuffer)
+            guard.lock();
+        getMinMax(&targetChip->m_CompletedMin, &targetChip->m_CompletedMax, targetChip, frame);
+        if (lockBuffer)
+            guard.unlock();
+        targetChip->m_CompletedMinMaxValid = true;
+    }
+#endif
+
+    if (frameSize > 0 && targetChip == &PrimaryCCD && ImagePreviewToggleSP[INDI_ENABLED].getState() == ISS_ON)
+    {
+        if (lockBuffer)
+            guard.lock();
+        publishPreview(targetChip, frame);
+        if (lockBuffer)
+            guard.unlock();
+    }
+
     if (sendImage || saveImage)
     {
         if (EncodeFormatSP[FORMAT_FITS].getState() == ISS_ON)
@@ -2410,32 +3515,6 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
             /*DEBUGF(Logger::DBG_DEBUG, "Exposure complete. Image Depth: %s. Width: %d Height: %d nelements: %d", bit_depth.c_str(), naxes[0],
                     naxes[1], nelements);*/
 
-            std::unique_lock<std::mutex> guard(ccdBufferLock);
-
-            // 8640 = 2880 * 3 which is sufficient for most cases.
-            uint32_t size = 8640 + nelements * (targetChip->getBPP() / 8);
-            //  Initialize FITS file.
-            if (targetChip->openFITSFile(size, status) == false)
-            {
-                fits_report_error(stderr, status); /* print out any error messages */
-                fits_get_errstatus(status, error_status);
-                LOGF_ERROR("FITS Error: %s", error_status);
-                return false;
-            }
-
-            auto fptr = *targetChip->fitsFilePointer();
-
-            fits_create_img(fptr, img_type, naxis, naxes, &status);
-
-            if (status)
-            {
-                fits_report_error(stderr, status); /* print out any error messages */
-                fits_get_errstatus(status, error_status);
-                LOGF_ERROR("FITS Error: %s", error_status);
-                targetChip->closeFITSFile();
-                return false;
-            }
-
             std::vector<FITSRecord> fitsKeywords;
 
             addFITSKeywords(targetChip, fitsKeywords);
@@ -2444,146 +3523,179 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
             for (auto &record : m_CustomFITSKeywords)
                 fitsKeywords.push_back(record.second);
 
-            for (auto &keyword : fitsKeywords)
+            // Simple images are written directly, without a cfitsio memory file
+            uint32_t channels = naxis == 3 ? 3 : (naxis == 2 ? 1 : 0);
+            if (FITSImageWriter::supported(channels, targetChip->getBPP()))
             {
-                int key_status = 0;
-                switch(keyword.type())
-                {
-                    case INDI::FITSRecord::VOID:
-                        break;
-                    case INDI::FITSRecord::COMMENT:
-                        fits_write_comment(fptr, keyword.comment().c_str(), &key_status);
-                        break;
-                    case INDI::FITSRecord::STRING:
-                        fits_update_key_str(fptr, keyword.key().c_str(), keyword.valueString().c_str(), keyword.comment().c_str(), &key_status);
-                        break;
-                    case INDI::FITSRecord::LONGLONG:
-                        fits_update_key_lng(fptr, keyword.key().c_str(), keyword.valueInt(), keyword.comment().c_str(), &key_status);
-                        break;
-                    case INDI::FITSRecord::DOUBLE:
-                        fits_update_key_dbl(fptr, keyword.key().c_str(), keyword.valueDouble(), keyword.decimal(), keyword.comment().c_str(),
-                                            &key_status);
-                        break;
-                }
-                if (key_status)
+                std::vector<std::string> cards;
+                std::vector<std::pair<std::string, int>> failedKeywords;
+                targetChip->renderFITSCards(fitsKeywords, cards, failedKeywords);
+                for (auto &failed : failedKeywords)
                 {
-                    fits_get_errstatus(key_status, error_status);
-                    LOGF_ERROR("FITS key %s Error: %s", keyword.key().c_str(), error_status);
+                    fits_get_errstatus(failed.second, error_status);
+                    LOGF_ERROR("FITS key %s Error: %s", failed.first.c_str(), error_status);
                 }
-            }
 
-            fits_write_img(fptr, byte_type, 1, nelements, targetChip->getFrameBuffer(), &status);
-            targetChip->finishFITSFile(status);
-            if (status)
-            {
-                fits_report_error(stderr, status); /* print out any error messages */
-                fits_get_errstatus(status, error_status);
-                LOGF_ERROR("FITS Error: %s", error_status);
-                targetChip->closeFITSFile();
-                return false;
-            }
-
-
-            bool rc = uploadFile(targetChip, *(targetChip->fitsMemoryBlockPointer()), *(targetChip->fitsMemorySizePointer()), sendImage,
-                                 saveImage);
+                FITSImageWriter fits(naxes[0], naxes[1], channels, targetChip->getBPP());
+                fits.setCards(cards);
 
-            targetChip->closeFITSFile();
+                if (lockBuffer)
+                    guard.lock();
+                void *fitsFile = nullptr;
+                size_t fitsSize = 0;
+                bool rc = fits.write(frame, &fitsFile, &fitsSize);
+                if (guard.owns_lock())
+                    guard.unlock();
 
-            guard.unlock();
+                if (rc == false)
+                {
+                    LOGF_ERROR("FITS Error: %s", fits.errorMessage().c_str());
+                    targetChip->setExposureFailed();
+                    return false;
+                }
 
-            if (rc == false)
-            {
-                targetChip->setExposureFailed();
-                return false;
+                rc = uploadFile(targetChip, fitsFile, fitsSize, sendImage, saveImage);
+                IDSharedBlobFree(fitsFile);
+                if (rc == false)
+                {
+                    targetChip->setExposureFailed();
+                    return false;
+                }
             }
-        }
-#ifdef HAVE_XISF
-        else if (EncodeFormatSP[FORMAT_XISF].getState() == ISS_ON)
-        {
-            std::vector<FITSRecord> fitsKeywords;
-            addFITSKeywords(targetChip, fitsKeywords);
-            targetChip->setImageExtension("xisf");
-
-            try
+            else
             {
-                AutoCNumeric locale;
-                LibXISF::Image image;
-                LibXISF::XISFWriter xisfWriter;
+                if (lockBuffer)
+                    guard.lock();
 
-                for (auto &keyword : fitsKeywords)
+                // 8640 = 2880 * 3 which is sufficient for most cases.
+                uint32_t size = 8640 + nelements * (targetChip->getBPP() / 8);
+                //  Initialize FITS file.
+                if (targetChip->openFITSFile(size, status) == false)
                 {
-                    image.addFITSKeyword({keyword.key().c_str(), keyword.valueString().c_str(), keyword.comment().c_str()});
-                    image.addFITSKeywordAsProperty(keyword.key().c_str(), keyword.valueString());
+                    fits_report_error(stderr, status); /* print out any error messages */
+                    fits_get_errstatus(status, error_status);
+                    LOGF_ERROR("FITS Error: %s", error_status);
+                    return false;
                 }
 
-                image.setGeometry(targetChip->getSubW() / targetChip->getBinX(),
-                                  targetChip->getSubH() / targetChip->getBinY(),
-                                  targetChip->getNAxis() == 2 ? 1 : 3);
-                switch(targetChip->getBPP())
+                auto fptr = *targetChip->fitsFilePointer();
+
+                fits_create_img(fptr, img_type, naxis, naxes, &status);
+
+                if (status)
                 {
-                    case 8:
-                        image.setSampleFormat(LibXISF::Image::UInt8);
-                        break;
-                    case 16:
-                        image.setSampleFormat(LibXISF::Image::UInt16);
-                        break;
-                    case 32:
-                        image.setSampleFormat(LibXISF::Image::UInt32);
-                        break;
-                    default:
-                        LOGF_ERROR("Unsupported bits per pixel value %d", targetChip->getBPP());
-                        return false;
+                    fits_report_error(stderr, status); /* print out any error messages */
+                    fits_get_errstatus(status, error_status);
+                    LOGF_ERROR("FITS Error: %s", error_status);
+                    targetChip->closeFITSFile();
+                    return false;
                 }
 
-                switch(targetChip->getFrameType())
+                // Unchanged keywords keep the cards rendered for the previous frame
+                std::vector<std::pair<std::string, int>> failedKeywords;
+                targetChip->writeFITSKeywords(fitsKeywords, failedKeywords);
+                for (auto &failed : failedKeywords)
                 {
-                    case CCDChip::LIGHT_FRAME:
-                        image.setImageType(LibXISF::Image::Light);
-                        break;
-                    case CCDChip::BIAS_FRAME:
-                        image.setImageType(LibXISF::Image::Bias);
-                        break;
-                    case CCDChip::DARK_FRAME:
-                        image.setImageType(LibXISF::Image::Dark);
-                        break;
-                    case CCDChip::FLAT_FRAME:
-                        image.setImageType(LibXISF::Image::Flat);
-                        break;
+                    fits_get_errstatus(failed.second, error_status);
+                    LOGF_ERROR("FITS key %s Error: %s", failed.first.c_str(), error_status);
                 }
 
-                if (targetChip->SendCompressed)
+                fits_write_img(fptr, byte_type, 1, nelements, const_cast<uint8_t *>(frame), &status);
+                targetChip->finishFITSFile(status);
+                if (status)
                 {
-                    if(LibXISF::DataBlock::CompressionCodecSupported(LibXISF::DataBlock::ZSTD))
-                        image.setCompression(LibXISF::DataBlock::ZSTD);
-                    else
-                        image.setCompression(LibXISF::DataBlock::LZ4);
-                    image.setByteshuffling(targetChip->getBPP() / 8);
+                    fits_report_error(stderr, status); /* print out any error messages */
+                    fits_get_errstatus(status, error_status);
+                    LOGF_ERROR("FITS Error: %s", error_status);
+                    targetChip->closeFITSFile();
+                    return false;
                 }
 
-                if (HasBayer())
-                    image.setColorFilterArray({2, 2, BayerTP[2].getText()});
 
-                if (targetChip->getNAxis() == 3)
-                {
-                    image.setColorSpace(LibXISF::Image::RGB);
-                }
+                bool rc = uploadFile(targetChip, *(targetChip->fitsMemoryBlockPointer()), *(targetChip->fitsMemorySizePointer()), sendImage,
+                                     saveImage);
+
+                targetChip->closeFITSFile();
 
-                std::unique_lock<std::mutex> guard(ccdBufferLock);
-                std::memcpy(image.imageData(), targetChip->getFrameBuffer(), image.imageDataSize());
-                xisfWriter.writeImage(image);
+                if (guard.owns_lock())
+                    guard.unlock();
 
-                LibXISF::ByteArray xisfFile;
-                xisfWriter.save(xisfFile);
-                bool rc = uploadFile(targetChip, xisfFile.data(), xisfFile.size(), sendImage, saveImage);
                 if (rc == false)
                 {
                     targetChip->setExposureFailed();
                     return false;
                 }
             }
-            catch (LibXISF::Error &error)
+        }
+#ifdef HAVE_XISF
+        else if (EncodeFormatSP[FORMAT_XISF].getState() == ISS_ON)
+        {
+            std::vector<FITSRecord> fitsKeywords;
+            addFITSKeywords(targetChip, fitsKeywords);
+            targetChip->setImageExtension("xisf");
+
+            XISFImageWriter xisf(targetChip->getSubW() / targetChip->getBinX(), targetChip->getSubH() / targetChip->getBinY(),
+                                 targetChip->getNAxis() == 2 ? 1 : 3, targetChip->getBPP());
+            xisf.setFITSKeywords(fitsKeywords);
+
+            switch(targetChip->getFrameType())
+            {
+                case CCDChip::LIGHT_FRAME:
+                    xisf.setImageType("Light");
+                    break;
+                case CCDChip::BIAS_FRAME:
+                    xisf.setImageType("Bias");
+                    break;
+                case CCDChip::DARK_FRAME:
+                    xisf.setImageType("Dark");
+                    break;
+                case CCDChip::FLAT_FRAME:
+                    xisf.setImageType("Flat");
+                    break;
+            }
+
+            if (targetChip->SendCompressed)
             {
-                LOGF_ERROR("XISF Error: %s", error.what());
+                // Byte shuffled zstd, else lz4, unless the BLOB codec names one of them. On the compression threads
+                XISFImageWriter::Codec codec = XISFImageWriter::codecSupported(XISFImageWriter::CODEC_ZSTD) ?
+                                               XISFImageWriter::CODEC_ZSTD : XISFImageWriter::CODEC_LZ4;
+                switch (CompressionCodecSP.findOnSwitchIndex())
+                {
+                    case CODEC_ZSTD:
+                        codec = XISFImageWriter::CODEC_ZSTD;
+                        break;
+                    case CODEC_LZ4:
+                        codec = XISFImageWriter::CODEC_LZ4;
+                        break;
+                }
+                if (!XISFImageWriter::codecSupported(codec))
+                    codec = XISFImageWriter::CODEC_ZLIB;
+                xisf.setCompression(codec, CompressionLevelNP[0].getValue(), CompressionThreadsNP[0].getValue());
+            }
+
+            if (HasBayer())
+                xisf.setColorFilterArray(BayerTP[2].getText(), 2, 2);
+
+            if (lockBuffer)
+                guard.lock();
+            void *xisfFile = nullptr;
+            size_t xisfSize = 0;
+            bool rc = xisf.write(frame, &xisfFile, &xisfSize);
+            if (guard.owns_lock())
+                guard.unlock();
+
+            if (rc == false)
+            {
+                LOGF_ERROR("XISF Error: %s", xisf.errorMessage().c_str());
+                targetChip->setExposureFailed();
+                return false;
+            }
+
+            rc = uploadFile(targetChip, xisfFile, xisfSize, sendImage, saveImage);
+            IDSharedBlobFree(xisfFile);
+            if (rc == false)
+            {
+                targetChip->setExposureFailed();
                 return false;
             }
         }
@@ -2593,10 +3705,11 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
             // If image extension was set to fits (default), change if bin if not already set to another format by the driver.
             if (!strcmp(targetChip->getImageExtension(), "fits"))
                 targetChip->setImageExtension("bin");
-            std::unique_lock<std::mutex> guard(ccdBufferLock);
-            bool rc = uploadFile(targetChip, targetChip->getFrameBuffer(), targetChip->getFrameBufferSize(), sendImage,
-                                 saveImage);
-            guard.unlock();
+            if (lockBuffer)
+                guard.lock();
+            bool rc = uploadFile(targetChip, frame, frameSize, sendImage, saveImage);
+            if (guard.owns_lock())
+                guard.unlock();
 
             if (rc == false)
             {
@@ -2606,6 +3719,9 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
         }
     }
 
+    if (guard.owns_lock())
+        guard.unlock();
+
     if (FastExposureToggleSP[INDI_ENABLED].getState() != ISS_ON)
         targetChip->setExposureComplete();
 
@@ -2635,7 +3751,8 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
         std::string prefix = UploadSettingsTP[UPLOAD_PREFIX].getText();
         std::string directory = UploadSettingsTP[UPLOAD_DIR].getText();
 
-
+        // Until the file is created or queued, the other chip would pick the same index
+        std::lock_guard<std::mutex> saveGuard(m_LocalSaveLock);
         int maxIndex       = getFileIndex(directory, prefix,
                                           targetChip->FitsBP[0].getFormat());
 
@@ -2672,27 +3789,46 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
         std::string imageFileName = std::string(UploadSettingsTP[UPLOAD_DIR].getText()) + "/" + prefix + std::string(
                                         targetChip->FitsBP[0].getFormat());
 
-        fp = fopen(imageFileName.c_str(), "w");
-        if (fp == nullptr)
+        size_t depth = LocalWriteNP[LOCAL_WRITE_DEPTH].getValue();
+        if (depth > 0)
         {
-            LOGF_ERROR("Unable to save image file (%s). %s", imageFileName.c_str(), strerror(errno));
-            return false;
+            bool waited = false;
+            size_t frames = 0, bytes = 0;
+            if (!m_LocalWriter->write(imageFileName, fitsData, totalBytes, depth,
+                                      LocalWriteNP[LOCAL_WRITE_DIRECT].getValue() * 1024 * 1024, waited, frames, bytes))
+            {
+                LOG_ERROR("Error: Ran out of memory queuing image for saving");
+                return false;
+            }
+            if (waited)
+                LOG_WARN("Local write queue is full, waited for the disk before saving the next image.");
+            updateLocalWriteQueue(frames, bytes, waited ? IPS_ALERT : IPS_BUSY);
         }
+        else
+        {
+            fp = fopen(imageFileName.c_str(), "w");
+            if (fp == nullptr)
+            {
+                LOGF_ERROR("Unable to save image file (%s). %s", imageFileName.c_str(), strerror(errno));
+                return false;
+            }
 
-        int n = 0;
-        auto len = targetChip->FitsBP[0].getBlobLen();
-        auto buffer = static_cast<char *>(targetChip->FitsBP[0].getBlob());
-        for (int nr = 0; nr < len; nr += n)
-            n = fwrite(buffer + nr, 1, len - nr, fp);
+            int n = 0;
+            auto len = targetChip->FitsBP[0].getBlobLen();
+            auto buffer = static_cast<char *>(targetChip->FitsBP[0].getBlob());
+            for (int nr = 0; nr < len; nr += n)
+                n = fwrite(buffer + nr, 1, len - nr, fp);
 
-        fclose(fp);
+            fclose(fp);
 
-        // Save image file path
-        FileNameTP[0].setText(imageFileName);
+            std::lock_guard<std::mutex> lock(m_LocalWriteLock);
+            // Save image file path
+            FileNameTP[0].setText(imageFileName);
 
-        LOGF_INFO("Image saved to %s", imageFileName.c_str());
-        FileNameTP.setState(IPS_OK);
-        FileNameTP.apply();
+            LOGF_INFO("Image saved to %s", imageFileName.c_str());
+            FileNameTP.setState(IPS_OK);
+            FileNameTP.apply();
+        }
     }
 
     if (targetChip->SendCompressed && EncodeFormatSP[FORMAT_XISF].getState() != ISS_ON)
@@ -2703,10 +3839,19 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
             fp_init (&fpvar);
             size_t compressedBytes = 0;
             int islossless = 0;
-            if (fp_pack_data_to_data(reinterpret_cast<const char *>(fitsData), totalBytes, &compressedData, &compressedBytes, fpvar,
-                                     &islossless) < 0)
+            int threads = static_cast<int>(CompressionThreadsNP[0].getValue());
+            // Row tiles are compressed in parallel, the calling thread being one of the workers.
+            // Images the threaded packer does not handle fall back to the regular one.
+            int rc = 1;
+            if (threads > 1)
+                rc = fp_pack_data_to_data_threaded(reinterpret_cast<const char *>(fitsData), totalBytes, &compressedData,
+                                                   &compressedBytes, IDSharedBlobRealloc, fpvar, threads - 1);
+            if (rc == 1)
+                rc = fp_pack_data_to_data_realloc(reinterpret_cast<const char *>(fitsData), totalBytes, &compressedData,
+                                                  &compressedBytes, IDSharedBlobRealloc, fpvar, &islossless);
+            if (rc < 0)
             {
-                free(compressedData);
+                IDSharedBlobFree(compressedData);
                 LOG_ERROR("Error: Ran out of memory compressing image");
                 return false;
             }
@@ -2718,29 +3863,18 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
         }
         else
         {
-            uLong compressedBytes = sizeof(char) * totalBytes + totalBytes / 64 + 16 + 3;
-            compressedData  = new uint8_t[compressedBytes];
-
-            if (fitsData == nullptr || compressedData == nullptr)
-            {
-                if (compressedData)
-                    delete [] compressedData;
-                LOG_ERROR("Error: Ran out of memory compressing image");
-                return false;
-            }
-
-            int r = compress2(compressedData, &compressedBytes, (const Bytef *)fitsData, totalBytes, 9);
-            if (r != Z_OK)
+            size_t compressedBytes = 0;
+            const char *suffix = ".cfa";
+            if (CompressionCodecSP.findOnSwitchIndex() != CODEC_CFA
+                    || !compressFrame(targetChip, fitsData, totalBytes, &compressedData, &compressedBytes))
             {
-                /* this should NEVER happen */
-                LOG_ERROR("Error: Failed to compress image");
-                delete [] compressedData;
-                return false;
+                if (fitsData == nullptr || !compressImage(fitsData, totalBytes, &compressedData, &compressedBytes, &suffix))
+                    return false;
             }
 
             targetChip->FitsBP[0].setBlob(compressedData);
             targetChip->FitsBP[0].setBlobLen(compressedBytes);
-            std::string format = "." + std::string(targetChip->getImageExtension()) + ".z";
+            std::string format = "." + std::string(targetChip->getImageExtension()) + suffix;
             targetChip->FitsBP[0].setFormat(format);
 
         }
@@ -2766,13 +3900,151 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
     }
 
     if (compressedData)
-        delete [] compressedData;
+        IDSharedBlobFree(compressedData);
 
     DEBUG(Logger::DBG_DEBUG, "Upload complete");
 
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CCD::updateLocalWriteQueue(size_t frames, size_t bytes, IPState state)
+{
+    std::lock_guard<std::mutex> lock(m_LocalWriteLock);
+    LocalWriteQueueNP[LOCAL_QUEUE_FRAMES].setValue(frames);
+    LocalWriteQueueNP[LOCAL_QUEUE_MB].setValue(bytes / (1024.0 * 1024.0));
+    // An alert stays until the queue empties
+    if (state == IPS_ALERT || LocalWriteQueueNP.getState() != IPS_ALERT || frames == 0)
+        LocalWriteQueueNP.setState(state);
+    LocalWriteQueueNP.apply();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CCD::compressFrame(CCDChip * targetChip, const void * data, size_t size, uint8_t ** compressed,
+                        size_t * compressedBytes)
+{
+    uint32_t width = targetChip->getSubW() / targetChip->getBinX();
+    uint32_t height = targetChip->getSubH() / targetChip->getBinY();
+    int bpp = targetChip->getBPP();
+
+    // Only the pixels of a native frame, not a file the driver encoded
+    if (data == nullptr || EncodeFormatSP[FORMAT_NATIVE].getState() != ISS_ON || targetChip->getNAxis() != 2
+            || (bpp != 8 && bpp != 16) || size != size_t(width) * height * (bpp / 8))
+        return false;
+
+    // Binned pixels mix the colours
+    bool bayer = HasBayer() && targetChip->getBinX() == 1 && targetChip->getBinY() == 1;
+
+    size_t bound = CFACodec::compressBound(width, height, bpp);
+    *compressed = static_cast<uint8_t *>(IDSharedBlobAlloc(bound));
+    if (*compressed == nullptr)
+    {
+        LOG_ERROR("Error: Ran out of memory compressing image");
+        return false;
+    }
+
+    *compressedBytes = CFACodec::compress(data, width, height, bpp, bayer, *compressed, bound);
+    if (*compressedBytes == 0)
+    {
+        LOG_ERROR("Error: Failed to compress image");
+        IDSharedBlobFree(*compressed);
+        *compressed = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CCD::compressImage(const void * data, size_t size, uint8_t ** compressed, size_t * compressedBytes,
+                        const char ** suffix)
+{
+    int codec = CompressionCodecSP.findOnSwitchIndex();
+    int level = static_cast<int>(CompressionLevelNP[0].getValue());
+    size_t bound = 0;
+
+    switch (codec)
+    {
+#ifdef HAVE_ZSTD
+        case CODEC_ZSTD:
+            bound = ZSTD_compressBound(size);
+            break;
+#endif
+#ifdef HAVE_LZ4
+        case CODEC_LZ4:
+            bound = LZ4F_compressFrameBound(size, nullptr);
+            break;
+#endif
+        default:
+            codec = CODEC_ZLIB;
+            bound = compressBound(size);
+            break;
+    }
+
+    // Same sized frames get the same sized buffer, which the shared blob pool hands back while unsealed.
+    *compressed = static_cast<uint8_t *>(IDSharedBlobAlloc(bound));
+    if (*compressed == nullptr)
+    {
+        LOG_ERROR("Error: Ran out of memory compressing image");
+        return false;
+    }
+
+    bool ok = false;
+    switch (codec)
+    {
+#ifdef HAVE_ZSTD
+        case CODEC_ZSTD:
+        {
+            size_t r = ZSTD_compress(*compressed, bound, data, size, std::min(level, ZSTD_maxCLevel()));
+            ok = !ZSTD_isError(r);
+            *compressedBytes = r;
+            *suffix = ".zst";
+            break;
+        }
+#endif
+#ifdef HAVE_LZ4
+        case CODEC_LZ4:
+        {
+            // LZ4 frame format, readable by the lz4 command line tool
+            LZ4F_preferences_t prefs;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.contentSize = size;
+            prefs.compressionLevel = std::min(level, LZ4F_compressionLevel_max());
+            size_t r = LZ4F_compressFrame(*compressed, bound, data, size, &prefs);
+            ok = !LZ4F_isError(r);
+            *compressedBytes = r;
+            *suffix = ".lz4";
+            break;
+        }
+#endif
+        default:
+        {
+            uLongf zBytes = bound;
+            ok = compress2(*compressed, &zBytes, static_cast<const Bytef *>(data), size, std::min(level, Z_BEST_COMPRESSION)) == Z_OK;
+            *compressedBytes = zBytes;
+            *suffix = ".z";
+            break;
+        }
+    }
+
+    if (!ok)
+    {
+        /* this should NEVER happen */
+        LOG_ERROR("Error: Failed to compress image");
+        IDSharedBlobFree(*compressed);
+        *compressed = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2879,7 +4151,16 @@ bool CCD::saveConfigItems(FILE * fp)
     ActiveDeviceTP.save(fp);
     UploadSP.save(fp);
     UploadSettingsTP.save(fp);
+    LocalWriteNP.save(fp);
+    SyncLeaderTP.save(fp);
+    SyncNP.save(fp);
     FastExposureToggleSP.save(fp);
+    ImageStatsToggleSP.save(fp);
+    ImagePreviewToggleSP.save(fp);
+    ImagePreviewNP.save(fp);
+    CompressionThreadsNP.save(fp);
+    CompressionCodecSP.save(fp);
+    CompressionLevelNP.save(fp);
 
     PrimaryCCD.CompressSP.save(fp);
 
@@ -2963,66 +4244,21 @@ IPState CCD::GuideWest(uint32_t ms)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void CCD::getMinMax(double * min, double * max, CCDChip * targetChip)
+void CCD::getMinMax(double * min, double * max, CCDChip * targetChip, const uint8_t * frame)
 {
-    int ind         = 0, i, j;
-    int imageHeight = targetChip->getSubH() / targetChip->getBinY();
-    int imageWidth  = targetChip->getSubW() / targetChip->getBinX();
+    const size_t pixels = static_cast<size_t>(targetChip->getSubW() / targetChip->getBinX()) *
+                          (targetChip->getSubH() / targetChip->getBinY());
     double lmin = 0, lmax = 0;
 
-    switch (targetChip->getBPP())
+    Pixel::withUnsignedPixelType(targetChip->getBPP(), [&](auto tag)
     {
-        case 8:
-        {
-            uint8_t * imageBuffer = targetChip->getFrameBuffer();
-            lmin = lmax = imageBuffer[0];
-
-            for (i = 0; i < imageHeight; i++)
-                for (j = 0; j < imageWidth; j++)
-                {
-                    ind = (i * imageWidth) + j;
-                    if (imageBuffer[ind] < lmin)
-                        lmin = imageBuffer[ind];
-                    else if (imageBuffer[ind] > lmax)
-                        lmax = imageBuffer[ind];
-                }
-        }
-        break;
-
-        case 16:
-        {
-            uint16_t * imageBuffer = reinterpret_cast<uint16_t*>(targetChip->getFrameBuffer());
-            lmin = lmax = imageBuffer[0];
-
-            for (i = 0; i < imageHeight; i++)
-                for (j = 0; j < imageWidth; j++)
-                {
-                    ind = (i * imageWidth) + j;
-                    if (imageBuffer[ind] < lmin)
-                        lmin = imageBuffer[ind];
-                    else if (imageBuffer[ind] > lmax)
-                        lmax = imageBuffer[ind];
-                }
-        }
-        break;
-
-        case 32:
-        {
-            uint32_t * imageBuffer = reinterpret_cast<uint32_t*>(targetChip->getFrameBuffer());
-            lmin = lmax = imageBuffer[0];
+        using T = typename decltype(tag)::type;
+        T low {}, high {};
+        Pixel::minMax(reinterpret_cast<const T *>(frame), pixels, low, high);
+        lmin = low;
+        lmax = high;
+    });
 
-            for (i = 0; i < imageHeight; i++)
-                for (j = 0; j < imageWidth; j++)
-                {
-                    ind = (i * imageWidth) + j;
-                    if (imageBuffer[ind] < lmin)
-                        lmin = imageBuffer[ind];
-                    else if (imageBuffer[ind] > lmax)
-                        lmax = imageBuffer[ind];
-                }
-        }
-        break;
-    }
     *min = lmin;
     *max = lmax;
 }
@@ -3044,10 +4280,6 @@ int CCD::getFileIndex(const std::string &dir, const std::string &prefix, const s
 {
     INDI_UNUSED(ext);
 
-    DIR * dpdf = nullptr;
-    struct dirent * epdf = nullptr;
-    std::vector<std::string> files = std::vector<std::string>();
-
     std::string prefixIndex = prefix;
     prefixIndex             = regex_replace_compat(prefixIndex, "_ISO8601", "");
     prefixIndex             = regex_replace_compat(prefixIndex, "_XXX", "");
@@ -3070,39 +4302,7 @@ int CCD::getFileIndex(const std::string &dir, const std::string &prefix, const s
         }
     }
 
-    dpdf = opendir(dir.c_str());
-    if (dpdf != nullptr)
-    {
-        while ((epdf = readdir(dpdf)))
-        {
-            if (strstr(epdf->d_name, prefixIndex.c_str()))
-                files.push_back(epdf->d_name);
-        }
-    }
-    else
-    {
-        closedir(dpdf);
-        return -1;
-    }
-    int maxIndex = 0;
-
-    for (uint32_t i = 0; i < files.size(); i++)
-    {
-        int index = -1;
-
-        std::string file  = files.at(i);
-        std::size_t start = file.find_last_of("_");
-        std::size_t end   = file.find_last_of(".");
-        if (start != std::string::npos)
-        {
-            index = atoi(file.substr(start + 1, end).c_str());
-            if (index > maxIndex)
-                maxIndex = index;
-        }
-    }
-
-    closedir(dpdf);
-    return (maxIndex + 1);
+    return INDI::nextFileIndex(dir, prefixIndex);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -44,6 +44,9 @@
 #include <cstring>
 #include <chrono>
 #include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -61,6 +64,7 @@ namespace INDI
 
 class StreamManager;
 class XISFWrapper;
+class LocalImageWriter;
 
 /**
  * \class CCD
@@ -98,6 +102,9 @@ class XISFWrapper;
  * Similarly, before calling Streamer->newFrame, the buffer needs to be protected in a similar fashion using
  * the same ccdBufferLock mutex.
  *
+ * ccdBufferLock is the lock of the primary chip. The guide chip buffer has its own, GuideCCD.getBufferLock(),
+ * so that a guide frame is completed and uploaded while a primary frame still is.
+ *
  * \example CCD Simulator
  * \version 1.1
  * \author Jasem Mutlaq
@@ -296,6 +303,16 @@ class CCD : public DefaultDevice, GuiderInterface
          */
         virtual bool ExposureComplete(CCDChip * targetChip);
 
+        /**
+         * \brief Uploads a frame the driver read into a buffer of the chip frame ring, see CCDChip::acquireFrame().
+         * The frame is uploaded in the background like pipelined exposures and released back to the ring once done,
+         * so the driver can go on reading frames into the other buffers meanwhile.
+         * @param targetChip chip the frame was acquired from
+         * @param frame buffer from targetChip->acquireFrame() holding getFrameBufferSize() bytes of the binned frame.
+         * Software binning only applies to the chip frame buffer, so the driver bins into frame itself.
+         */
+        bool FrameComplete(CCDChip * targetChip, uint8_t * frame);
+
         /**
          * \brief Abort ongoing exposure
          * \return true is abort is successful, false otherwise.
@@ -538,6 +555,19 @@ class CCD : public DefaultDevice, GuiderInterface
          */
         virtual bool processFastExposure(CCDChip * targetChip);
 
+        /**
+         * @brief setPipelinedExposures Copy the frame buffer in ExposureComplete() and encode, compress and
+         * upload the copy in the background, so the driver can read the next frame into the buffer meanwhile.
+         * Frames are still uploaded one at a time, in the order they completed.
+         * @param enable True to pipeline exposure completion. Each frame waiting for upload holds a copy of the buffer.
+         * The copies are taken from the chip frame ring when it is enabled, ExposureComplete() then waits for a
+         * buffer to be released if all are still being uploaded.
+         */
+        void setPipelinedExposures(bool enable)
+        {
+            m_PipelinedExposures = enable;
+        }
+
         /**
          * @brief addCaptureFormat Add a supported camera native capture format (e.g. Mono, Bayer8..etc)
          * @param name Name of format (e.g. FORMAT_MONO)
@@ -558,10 +588,6 @@ class CCD : public DefaultDevice, GuiderInterface
         double J2000DE;
         bool J2000Valid;
 
-        // exposure information
-        char exposureStartTime[MAXINDINAME];
-        double exposureDuration;
-
         double snoopedFocalLength, snoopedAperture;
         bool InExposure;
         bool InGuideExposure;
@@ -600,9 +626,6 @@ class CCD : public DefaultDevice, GuiderInterface
         INDI::Timer m_TemperatureCheckTimer;
         INDI::ElapsedTimer m_TemperatureElapsedTimer;
 
-        // Threading
-        std::mutex ccdBufferLock;
-
         std::vector<std::string> FilterNames;
         int CurrentFilterSlot {-1};
 
@@ -613,6 +636,9 @@ class CCD : public DefaultDevice, GuiderInterface
         CCDChip PrimaryCCD;
         CCDChip GuideCCD;
 
+        // Threading: the buffer lock of the primary chip, see CCDChip::getBufferLock() for the guide chip
+        std::mutex &ccdBufferLock {PrimaryCCD.getBufferLock()};
+
         ///////////////////////////////////////////////////////////////////////////////
         /// Properties
         ///////////////////////////////////////////////////////////////////////////////
@@ -732,6 +758,80 @@ class CCD : public DefaultDevice, GuiderInterface
 
         // Fast Exposure Frame Count
         INDI::PropertyNumber FastExposureCountNP {1};
+
+        // Threads used for FITS tile compression
+        INDI::PropertyNumber CompressionThreadsNP {1};
+
+        // Codec for non fpack compression, and its level
+        INDI::PropertySwitch CompressionCodecSP {4};
+        enum
+        {
+            CODEC_ZLIB,
+            CODEC_ZSTD,
+            CODEC_LZ4,
+            CODEC_CFA
+        };
+        INDI::PropertyNumber CompressionLevelNP {1};
+
+        // Background writing of local saves
+        INDI::PropertyNumber LocalWriteNP {2};
+        enum
+        {
+            LOCAL_WRITE_DEPTH,
+            LOCAL_WRITE_DIRECT
+        };
+        INDI::PropertyNumber LocalWriteQueueNP {2};
+        enum
+        {
+            LOCAL_QUEUE_FRAMES,
+            LOCAL_QUEUE_MB
+        };
+
+        // Image statistics
+        INDI::PropertySwitch ImageStatsToggleSP {2};
+        INDI::PropertyNumber ImageStatsNP {5};
+        enum
+        {
+            STATS_MIN,
+            STATS_MAX,
+            STATS_MEAN,
+            STATS_STDDEV,
+            STATS_MEDIAN
+        };
+        INDI::PropertyBlob ImageHistogramBP {1};
+        // Quick look JPEG of the primary chip frames
+        INDI::PropertySwitch ImagePreviewToggleSP {2};
+        INDI::PropertyNumber ImagePreviewNP {2};
+        enum
+        {
+            PREVIEW_WIDTH,
+            PREVIEW_QUALITY
+        };
+        INDI::PropertyBlob ImagePreviewBP {1};
+        std::vector<uint8_t> m_PreviewJPEG;
+        // Exposures started with other cameras, see armSyncExposure()
+        INDI::PropertyText SyncLeaderTP {1};
+        INDI::PropertyNumber SyncNP {2};
+        enum
+        {
+            SYNC_LEAD,
+            SYNC_UPLOAD_DELAY
+        };
+        INDI::PropertyNumber SyncStartNP {2};
+        enum
+        {
+            SYNC_TIME,
+            SYNC_DURATION
+        };
+        // Stars of the autofocus frames, see FocuserInterface
+        INDI::PropertyNumber FrameStarsNP {4};
+        enum
+        {
+            FRAME_STARS_COUNT,
+            FRAME_STARS_HFR,
+            FRAME_STARS_FWHM,
+            FRAME_STARS_FRAME
+        };
         double m_UploadTime = { 0 };
         std::chrono::system_clock::time_point FastExposureToggleStartup;
 
@@ -746,6 +846,10 @@ class CCD : public DefaultDevice, GuiderInterface
     private:
         uint32_t capability;
 
+        // Snoop subscriptions of each of the ActiveDeviceTP devices
+        std::vector<int> m_ActiveSnoops[5];
+        void addActiveSnoops();
+
         bool m_ValidCCDRotation {false};
         std::string m_ConfigCaptureFormatName;
         int m_ConfigEncodeFormatIndex {-1};
@@ -753,13 +857,57 @@ class CCD : public DefaultDevice, GuiderInterface
 
         std::map<std::string, FITSRecord> m_CustomFITSKeywords;
 
+        // Local saves queued for writing, see LocalWriteNP
+        std::unique_ptr<LocalImageWriter> m_LocalWriter;
+        std::mutex m_LocalWriteLock;
+        void updateLocalWriteQueue(size_t frames, size_t bytes, IPState state);
+
+        // Local saves of both chips pick their file index one at a time
+        std::mutex m_LocalSaveLock;
+        std::mutex m_DSPLock;
+
+        // Pipelined exposure completion, see setPipelinedExposures(). The order is kept by each chip
+        std::atomic_bool m_PipelinedExposures {false};
+
         ///////////////////////////////////////////////////////////////////////////////
         /// Utility Functions
         ///////////////////////////////////////////////////////////////////////////////
         bool uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, bool sendImage, bool saveImage);
-        void getMinMax(double * min, double * max, CCDChip * targetChip);
+        bool compressImage(const void * data, size_t size, uint8_t ** compressed, size_t * compressedBytes, const char ** suffix);
+        // Lossless CFA codec of native 8 or 16 bits frames. False if the frame is not one, or on error.
+        bool compressFrame(CCDChip * targetChip, const void * data, size_t size, uint8_t ** compressed, size_t * compressedBytes);
+        void getMinMax(double * min, double * max, CCDChip * targetChip, const uint8_t * frame);
         int getFileIndex(const std::string &dir, const std::string &prefix, const std::string &ext);
         bool ExposureCompletePrivate(CCDChip * targetChip);
+        void PipelinedExposureComplete(CCDChip * targetChip, std::shared_ptr<const uint8_t> frame, size_t frameSize,
+                                       double duration, std::string startTime, uint64_t ticket);
+        void pipelineFrame(CCDChip * targetChip, std::shared_ptr<const uint8_t> frame, size_t frameSize);
+        bool uploadExposure(CCDChip * targetChip, const uint8_t * frame, size_t frameSize, bool lockBuffer);
+        // Calibrates a light frame in place with the masters of the DSP calibration plugin
+        void calibrateFrame(CCDChip * targetChip, uint8_t * frame, double duration);
+        // Runs the active DSP plugins on a binned frame, which they only read
+        void processDSP(CCDChip * targetChip, const uint8_t * frame);
+        // Guide ROI mode: frames the box around the guide star, or the full frame, and publishes the star of a frame
+        bool setGuideROIFrame(CCDChip * targetChip, bool fullFrame);
+        void measureGuideStar(CCDChip * targetChip, const uint8_t * frame);
+        // Publishes the preview of a frame of the primary chip
+        void publishPreview(CCDChip * targetChip, const uint8_t * frame);
+        // Autofocus frames of the active focuser: exposed on request, measured and never uploaded
+        void startFocusFrame(uint32_t frame, double duration);
+        void measureFrameStars(CCDChip * targetChip, const uint8_t * frame);
+        uint32_t m_FocusFrame {0};
+        uint32_t m_FocusFrameServed {0};
+        // Synchronized exposures of the primary chip: started at a time shared with the cameras following this
+        // one, as published in SyncStartNP. The time is UTC to reach other hosts, waited for on the timer.
+        void armSyncExposure(double startTime, double duration);
+        void startSyncExposure();
+        bool cancelSyncExposure();
+        void followSyncStart(const INDI::SnoopUpdate &update);
+        INDI::Timer m_SyncTimer;
+        int m_SyncSnoop {-1};
+        double m_SyncArmed {0};             // start of the exposure waiting for its time, 0 if none
+        double m_SyncFollowed {0};          // last start of the leader
+        std::atomic_bool m_SyncUpload {false};  // the exposure to upload was synchronized
 
         /////////////////////////////////////////////////////////////////////////////
         /// Misc.
@@ -16,12 +16,22 @@
  Boston, MA 02110-1301, USA.
 *******************************************************************************/
 #include "indiccdchip.h"
+#include "computebackend.h"
+#include "fitswriter.h"
 #include "indidevapi.h"
 #include "sharedblob.h"
 #include "locale_compat.h"
+#include "pixel/pixelbinning.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <ctime>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <vector>
+
 
 namespace INDI
 {
@@ -35,6 +45,8 @@ CCDChip::~CCDChip()
 {
     IDSharedBlobFree(RawFrame);
     IDSharedBlobFree(BinFrame);
+    for (auto &frame : m_FrameRing)
+        IDSharedBlobFree(frame.data);
     IDSharedBlobFree(m_FITSMemoryBlock);
 }
 
@@ -83,6 +95,93 @@ void CCDChip::closeFITSFile()
     m_FITSMemoryBlock = nullptr;
 }
 
+const std::string &CCDChip::cachedFITSCard(size_t index, const FITSRecord &keyword, int &status)
+{
+    if (m_FITSCards.size() <= index)
+        m_FITSCards.resize(index + 1);
+    auto &cached = m_FITSCards[index];
+    if (cached.second.empty() || !(cached.first == keyword))
+    {
+        cached.first = keyword;
+        cached.second = FITSImageWriter::card(keyword, status);
+    }
+    if (status)
+        cached.second.clear();
+    return cached.second;
+}
+
+void CCDChip::renderFITSCards(const std::vector<FITSRecord> &keywords, std::vector<std::string> &cards,
+                              std::vector<std::pair<std::string, int>> &failed)
+{
+    m_FITSCards.resize(keywords.size());
+    for (size_t i = 0; i < keywords.size(); i++)
+    {
+        if (keywords[i].type() == FITSRecord::VOID)
+            continue;
+        int status = 0;
+        const std::string &card = cachedFITSCard(i, keywords[i], status);
+        if (status)
+            failed.emplace_back(keywords[i].key(), status);
+        else
+            cards.push_back(card);
+    }
+}
+
+void CCDChip::writeFITSKeywords(const std::vector<FITSRecord> &keywords, std::vector<std::pair<std::string, int>> &failed)
+{
+    auto upper = [](std::string s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(), ::toupper);
+        return s;
+    };
+
+    // Keys already in the header: the mandatory ones, then those written here
+    std::vector<std::string> present;
+    int status = 0, count = 0, more = 0;
+    fits_get_hdrspace(m_FITSFilePointer, &count, &more, &status);
+    for (int i = 1; i <= count && status == 0; i++)
+    {
+        char name[FLEN_KEYWORD], value[FLEN_VALUE], comment[FLEN_COMMENT];
+        fits_read_keyn(m_FITSFilePointer, i, name, value, comment, &status);
+        present.push_back(upper(name));
+    }
+
+    m_FITSCards.resize(keywords.size());
+    for (size_t i = 0; i < keywords.size(); i++)
+    {
+        const auto &keyword = keywords[i];
+        int keyStatus = 0;
+
+        if (keyword.type() == FITSRecord::VOID)
+            continue;
+        if (keyword.type() == FITSRecord::COMMENT)
+        {
+            if (fits_write_comment(m_FITSFilePointer, keyword.comment().c_str(), &keyStatus))
+                failed.emplace_back(keyword.key(), keyStatus);
+            continue;
+        }
+
+        const std::string &card = cachedFITSCard(i, keyword, keyStatus);
+        if (keyStatus == 0)
+        {
+            std::string name = upper(keyword.key());
+            if (std::find(present.begin(), present.end(), name) == present.end())
+            {
+                present.push_back(name);
+                fits_write_record(m_FITSFilePointer, card.c_str(), &keyStatus);
+            }
+            else
+                fits_update_card(m_FITSFilePointer, keyword.key().c_str(), card.c_str(), &keyStatus);
+        }
+
+        if (keyStatus)
+        {
+            m_FITSCards[i].second.clear();
+            failed.emplace_back(keyword.key(), keyStatus);
+        }
+    }
+}
+
 void CCDChip::setFrameType(CCD_FRAME type)
 {
     FrameType = type;
@@ -205,6 +304,116 @@ void CCDChip::setFrameBufferSize(uint32_t nbuf, bool allocMem)
         if (BinFrame == nullptr)
             BinFrame = static_cast<uint8_t*>(IDSharedBlobAlloc(RawFrameSize));
     }
+
+    // Frames in use are resized when they are acquired again
+    std::lock_guard<std::mutex> lock(m_FrameRingLock);
+    for (auto &frame : m_FrameRing)
+    {
+        if (frame.busy)
+            continue;
+        IDSharedBlobFree(frame.data);
+        frame.data = static_cast<uint8_t*>(IDSharedBlobAlloc(RawFrameSize));
+        frame.size = frame.data ? RawFrameSize : 0;
+    }
+}
+
+void CCDChip::setFrameRingSize(uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(m_FrameRingLock);
+    m_FrameRingSize = count;
+
+    // Drop free frames beyond count, busy ones go when released
+    for (auto it = m_FrameRing.begin(); it != m_FrameRing.end() && m_FrameRing.size() > count;)
+    {
+        if (it->busy)
+            ++it;
+        else
+        {
+            IDSharedBlobFree(it->data);
+            it = m_FrameRing.erase(it);
+        }
+    }
+
+    while (m_FrameRing.size() < count)
+    {
+        RingFrame frame;
+        if (RawFrameSize > 0)
+        {
+            frame.data = static_cast<uint8_t*>(IDSharedBlobAlloc(RawFrameSize));
+            frame.size = frame.data ? RawFrameSize : 0;
+        }
+        m_FrameRing.push_back(frame);
+    }
+    m_FrameRingReleased.notify_all();
+}
+
+uint32_t CCDChip::getFrameRingSize()
+{
+    std::lock_guard<std::mutex> lock(m_FrameRingLock);
+    return m_FrameRingSize;
+}
+
+uint8_t *CCDChip::acquireFrame(int timeout)
+{
+    std::unique_lock<std::mutex> lock(m_FrameRingLock);
+
+    RingFrame *free = nullptr;
+    auto released = [&]
+    {
+        if (m_FrameRingSize == 0)
+            return true;
+        for (size_t i = 0; i < m_FrameRing.size() && i < m_FrameRingSize; i++)
+            if (!m_FrameRing[i].busy)
+            {
+                free = &m_FrameRing[i];
+                return true;
+            }
+        return false;
+    };
+
+    if (timeout < 0)
+        m_FrameRingReleased.wait(lock, released);
+    else
+        m_FrameRingReleased.wait_for(lock, std::chrono::milliseconds(timeout), released);
+
+    if (free == nullptr)
+        return nullptr;
+
+    if (RawFrameSize == 0)
+        return nullptr;
+
+    if (free->size != RawFrameSize || free->data == nullptr)
+    {
+        IDSharedBlobFree(free->data);
+        free->data = static_cast<uint8_t*>(IDSharedBlobAlloc(RawFrameSize));
+        free->size = free->data ? RawFrameSize : 0;
+        if (free->data == nullptr)
+            return nullptr;
+    }
+
+    free->busy = true;
+    return free->data;
+}
+
+void CCDChip::releaseFrame(uint8_t *frame)
+{
+    std::unique_lock<std::mutex> lock(m_FrameRingLock);
+    for (auto it = m_FrameRing.begin(); it != m_FrameRing.end(); ++it)
+    {
+        if (it->data != frame)
+            continue;
+
+        if (m_FrameRing.size() > m_FrameRingSize)
+        {
+            IDSharedBlobFree(it->data);
+            m_FrameRing.erase(it);
+        }
+        else
+            it->busy = false;
+        lock.unlock();
+        m_FrameRingReleased.notify_one();
+        return;
+    }
 }
 
 void CCDChip::setExposureLeft(double duration)
@@ -295,82 +504,58 @@ void CCDChip::binFrame()
             BinFrame = static_cast<uint8_t*>(IDSharedBlobAlloc(RawFrameSize));
     }
 
-    memset(BinFrame, 0, RawFrameSize);
-
+    const int bin = BinX;
     switch (getBPP())
     {
         case 8:
         {
-            uint8_t *bin_buf = BinFrame;
             // Try to average pixels since in 8bit they get saturated pretty quickly
-            double factor      = (BinX * BinX) / 2;
-            double accumulator;
-
-            for (uint32_t i = 0; i < SubH; i += BinX)
-                for (uint32_t j = 0; j < SubW; j += BinX)
+            const uint32_t factor = (bin * bin) / 2;
+            auto store = [factor](uint32_t sum)
+            {
+                return static_cast<uint8_t>(std::min<uint32_t>(sum / factor, UINT8_MAX));
+            };
+            if (bin == 2)
+                Pixel::bin2x2Frame<uint8_t>(RawFrame, BinFrame, SubW, SubH, Pixel::bin2x2Loops().bin8, store);
+            else
+                Pixel::binFrameRows<uint8_t, uint32_t>(RawFrame, BinFrame, SubW, SubH, bin, bin, false, [](uint8_t v)
                 {
-                    accumulator = 0;
-                    for (int k = 0; k < BinX; k++)
-                    {
-                        for (int l = 0; l < BinX; l++)
-                        {
-                            accumulator += *(RawFrame + j + (i + k) * SubW + l);
-                        }
-                    }
-
-                    accumulator /= factor;
-                    if (accumulator > UINT8_MAX)
-                        *bin_buf = UINT8_MAX;
-                    else
-                        *bin_buf += static_cast<uint8_t>(accumulator);
-                    bin_buf++;
-                }
+                    return static_cast<uint32_t>(v);
+                }, store);
         }
         break;
 
         case 16:
-        {
-            uint16_t *bin_buf    = reinterpret_cast<uint16_t *>(BinFrame);
-            uint16_t *RawFrame16 = reinterpret_cast<uint16_t *>(RawFrame);
-            uint16_t val;
-
-            for (uint32_t i = 0; i < SubH; i += BinX)
-                for (uint32_t j = 0; j < SubW; j += BinX)
+            if (bin == 2)
+                Pixel::bin2x2Frame<uint16_t>(RawFrame, BinFrame, SubW, SubH, Pixel::bin2x2Loops().bin16, [](uint32_t sum)
                 {
-                    for (int k = 0; k < BinX; k++)
-                    {
-                        for (int l = 0; l < BinX; l++)
-                        {
-                            val = *(RawFrame16 + j + (i + k) * SubW + l);
-                            if (val + *bin_buf > UINT16_MAX)
-                                *bin_buf = UINT16_MAX;
-                            else
-                                *bin_buf += val;
-                        }
-                    }
-                    bin_buf++;
-                }
-        }
-        break;
+                    return static_cast<uint16_t>(std::min<uint32_t>(sum, UINT16_MAX));
+                });
+            else
+                Pixel::binFrameSaturated<uint16_t, uint32_t>(RawFrame, BinFrame, SubW, SubH, bin, bin, false);
+            break;
+
+        case 32:
+            Pixel::binFrameSaturated<uint32_t, uint64_t>(RawFrame, BinFrame, SubW, SubH, bin, bin, false);
+            break;
 
         default:
             return;
     }
 
-    // Swap frame pointers
+    // Swap frame pointers. Every binned pixel was written, nothing needs clearing next time
     uint8_t *rawFramePointer = RawFrame;
     RawFrame                 = BinFrame;
-    // We just memset it next time we use it
     BinFrame = rawFramePointer;
 }
 
 
 // Thx8411:
 // Binning Bayer frames
-// Each raw frame pixel is mapped and summed onto the binned frame
-// The right place of each pixel in the 2x2 Bayer matrix is found by :
-// (((i/BinX) & 0xFFFFFFFE) + (i & 0x00000001))
-// and
+// Each binned pixel sums the raw pixels of the same color within a (2 * BinX) x (2 * BinY) cell, so
+// the binned frame keeps the 2x2 Bayer matrix. Raw row i and column j land on binned row
+// (((i/BinY) & 0xFFFFFFFE) + (i & 0x00000001))
+// and column
 // ((j/BinX) & 0xFFFFFFFE) + (j & 0x00000001)
 //
 void CCDChip::binBayerFrame()
@@ -388,42 +573,25 @@ void CCDChip::binBayerFrame()
             BinFrame = static_cast<uint8_t*>(IDSharedBlobAlloc(RawFrameSize));
     }
 
-    memset(BinFrame, 0, RawFrameSize);
-
+    const int binX = BinX;
+    const int binY = BinY;
     switch (getBPP())
     {
         // 8 bpp frame
         case 8:
         {
-            uint32_t BinFrameOffset;
-            uint32_t val;
-            uint32_t BinW = SubW / BinX;
-            uint8_t BinFactor = BinX * BinY;
-            uint32_t RawOffset = 0;
-            uint32_t BinOffsetH;
-
-            // for each raw frame row
-            for (uint32_t i = 0; i < SubH; i++)
+            // each raw value is averaged before being added, and the sum capped
+            uint8_t binFactor = std::max(1, binX * binY);
+            uint8_t averaged[256];
+            for (int v = 0; v < 256; v++)
+                averaged[v] = v / binFactor;
+            Pixel::binFrameRows<uint8_t, uint32_t>(RawFrame, BinFrame, SubW, SubH, binX, binY, true, [averaged](uint8_t v)
             {
-                // find the binned frame row
-                BinOffsetH = (((i / BinY) & 0xFFFFFFFE) + (i & 0x00000001)) * BinW;
-                // for each raw column
-                for (uint32_t j = 0; j < SubW; j++)
-                {
-                    // find the proper position in the binned frame
-                    BinFrameOffset = BinOffsetH + ((j / BinX) & 0xFFFFFFFE) + (j & 0x00000001);
-                    // get the existing value in the binned frame
-                    val = BinFrame[BinFrameOffset];
-                    // add the new value, averaged and caped
-                    val += RawFrame[RawOffset] / BinFactor;
-                    if(val > UINT8_MAX)
-                        val = UINT8_MAX;
-                    // write back into the binned frame
-                    BinFrame[BinFrameOffset] = static_cast<uint8_t>(val);
-                    // next binned frame pixel
-                    RawOffset++;
-                }
-            }
+                return static_cast<uint32_t>(averaged[v]);
+            }, [](uint32_t sum)
+            {
+                return static_cast<uint8_t>(std::min<uint32_t>(sum, UINT8_MAX));
+            });
         }
         break;
 
@@ -431,42 +599,208 @@ void CCDChip::binBayerFrame()
         case 16:
         {
             // works the same as the 8 bits version, without averaging but
-            // mapped onto 16 bits pixel
-            uint16_t *RawFrame16 = reinterpret_cast<uint16_t *>(RawFrame);
-            uint16_t *BinFrame16 = reinterpret_cast<uint16_t *>(BinFrame);
-
-            uint32_t BinFrameOffset;
-            uint32_t val;
-            uint32_t BinW = SubW / BinX;
-            uint32_t RawOffset = 0;
-
-            for (uint32_t i = 0; i < SubH; i++)
-            {
-                uint32_t BinOffsetH = (((i / BinY) & 0xFFFFFFFE) + (i & 0x00000001)) * BinW;
-                for (uint32_t j = 0; j < SubW; j++)
-                {
-                    BinFrameOffset = BinOffsetH + ((j / BinX) & 0xFFFFFFFE) + (j & 0x00000001);
-                    val = BinFrame16[BinFrameOffset];
-                    val += RawFrame16[RawOffset];
-                    if(val > UINT16_MAX)
-                        val = UINT16_MAX;
-                    BinFrame16[BinFrameOffset] = (uint16_t)val;
-                    RawOffset++;
-                }
-            }
-
+            // mapped onto 16 bits pixel, on the GPU when there is one
+            ComputeBackend *backend = ComputeBackend::instance();
+            if (backend == nullptr || !backend->binBayer16(reinterpret_cast<const uint16_t *>(RawFrame), SubW, SubH, binX, binY,
+                    reinterpret_cast<uint16_t *>(BinFrame)))
+                Pixel::binFrameSaturated<uint16_t, uint32_t>(RawFrame, BinFrame, SubW, SubH, binX, binY, true);
         }
         break;
 
+        case 32:
+            Pixel::binFrameSaturated<uint32_t, uint64_t>(RawFrame, BinFrame, SubW, SubH, binX, binY, true);
+            break;
+
         default:
             return;
     }
 
-    // Swap frame pointers
+    // Swap frame pointers. Every binned pixel was written, nothing needs clearing next time
     uint8_t *rawFramePointer = RawFrame;
     RawFrame                 = BinFrame;
-    // We just memset it next time we use it
     BinFrame = rawFramePointer;
 }
 
+/* The full histogram of the frame gives everything else: min and max are its ends, mean and stddev its
+ * moments and the median where it crosses half counts. 32 bits pixels are counted by their upper 16
+ * bits, summed and bounded directly.
+ */
+bool computeImageStatistics(const uint8_t *buffer, uint32_t width, uint32_t height, int bpp, ImageStatistics &stats,
+                            uint32_t bins)
+{
+    if (buffer == nullptr || width == 0 || height == 0 || bins == 0 || (bpp != 8 && bpp != 16 && bpp != 32))
+        return false;
+
+    const size_t levels = bpp == 8 ? 256 : 65536;
+    const int shift     = bpp == 32 ? 16 : 0;
+
+    std::vector<uint64_t> histogram(levels, 0);
+    uint64_t sum = 0;
+    long double sumSquares = 0;
+    uint32_t min = UINT32_MAX, max = 0;
+    std::mutex lock;
+
+    Pixel::forEachRowRange(height, [&](uint32_t first, uint32_t last)
+    {
+        // Four interleaved tables so that runs of equal pixels do not wait on the same counter
+        std::vector<uint32_t> counts(4 * levels, 0);
+        uint64_t partSum = 0;
+        long double partSquares = 0;
+        uint32_t partMin = UINT32_MAX, partMax = 0;
+
+        size_t begin = static_cast<size_t>(first) * width;
+        size_t end   = static_cast<size_t>(last) * width;
+        auto count = [&](auto *pixels)
+        {
+            size_t i = begin;
+            for (; i + 4 <= end; i += 4)
+            {
+                counts[4 * (pixels[i] >> shift)]++;
+                counts[4 * (pixels[i + 1] >> shift) + 1]++;
+                counts[4 * (pixels[i + 2] >> shift) + 2]++;
+                counts[4 * (pixels[i + 3] >> shift) + 3]++;
+            }
+            for (; i < end; i++)
+                counts[4 * (pixels[i] >> shift)]++;
+
+            if (shift)
+                for (i = begin; i < end; i++)
+                {
+                    uint32_t v = pixels[i];
+                    partSum += v;
+                    partSquares += static_cast<long double>(v) * v;
+                    partMin = std::min(partMin, v);
+                    partMax = std::max(partMax, v);
+                }
+        };
+
+        Pixel::withUnsignedPixelType(bpp, [&](auto tag)
+        {
+            count(reinterpret_cast<const typename decltype(tag)::type *>(buffer));
+        });
+
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t v = 0; v < levels; v++)
+            histogram[v] += counts[4 * v] + counts[4 * v + 1] + counts[4 * v + 2] + counts[4 * v + 3];
+        sum += partSum;
+        sumSquares += partSquares;
+        min = std::min(min, partMin);
+        max = std::max(max, partMax);
+    });
+
+    const uint64_t pixels = static_cast<uint64_t>(width) * height;
+    if (!shift)
+    {
+        min = 0;
+        while (histogram[min] == 0)
+            min++;
+        max = levels - 1;
+        while (histogram[max] == 0)
+            max--;
+        for (uint32_t v = min; v <= max; v++)
+        {
+            sum += histogram[v] * v;
+            sumSquares += static_cast<long double>(histogram[v]) * v * v;
+        }
+    }
+
+    // lower median
+    uint64_t seen = 0;
+    uint32_t level = 0;
+    while ((seen += histogram[level]) <= (pixels - 1) / 2)
+        level++;
+    double median = shift ? (static_cast<double>(level) * 65536 + 32768) : level;
+
+    stats.min    = min;
+    stats.max    = max;
+    stats.mean   = static_cast<double>(sum) / pixels;
+    stats.median = std::min<double>(std::max<double>(median, min), max);
+    long double variance = sumSquares / pixels - static_cast<long double>(stats.mean) * stats.mean;
+    stats.stddev = variance > 0 ? std::sqrt(static_cast<double>(variance)) : 0;
+
+    // Coarse bins from the fine ones. For 32 bits pixels, a fine bin straddling two coarse ones is counted in the first.
+    stats.histogram.assign(bins, 0);
+    const double binWidth = (static_cast<double>(max) - min + 1) / bins;
+    for (size_t v = min >> shift; v <= (max >> shift); v++)
+    {
+        double value = std::max<double>(static_cast<double>(v) * (1u << shift), min);
+        stats.histogram[std::min<uint32_t>(static_cast<uint32_t>((value - min) / binWidth), bins - 1)] += histogram[v];
+    }
+
+    return true;
+}
+
+/* The box is expected to hold one star well inside it. Its two outer rows and columns give the sky, and
+ * only the pixels above three times the sky noise weigh in so that the sky around the star does not pull
+ * the centroid towards the center of the box.
+ */
+bool findGuideStar(const uint8_t *buffer, uint32_t width, uint32_t height, int bpp, GuideStar &star)
+{
+    if (buffer == nullptr || width < 5 || height < 5 || (bpp != 8 && bpp != 16 && bpp != 32))
+        return false;
+
+    std::vector<double> pixels(static_cast<size_t>(width) * height);
+    Pixel::withUnsignedPixelType(bpp, [&](auto tag)
+    {
+        std::copy_n(reinterpret_cast<const typename decltype(tag)::type *>(buffer), pixels.size(), pixels.begin());
+    });
+
+    std::vector<double> border;
+    border.reserve(4 * (width + height));
+    for (uint32_t y = 0; y < height; y++)
+        for (uint32_t x = 0; x < width; x++)
+            if (x < 2 || y < 2 || x >= width - 2 || y >= height - 2)
+                border.push_back(pixels[y * width + x]);
+
+    auto median = [](std::vector<double> &values)
+    {
+        auto middle = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    };
+    double background = median(border);
+    for (auto &value : border)
+        value = std::fabs(value - background);
+    // One ADU at least, the border of a quantized flat sky does not deviate
+    double noise = std::max(1.4826 * median(border), 1.0);
+    double threshold = background + 3 * noise;
+
+    double flux = 0, sumX = 0, sumY = 0;
+    uint32_t count = 0;
+    for (uint32_t y = 0; y < height; y++)
+        for (uint32_t x = 0; x < width; x++)
+        {
+            double value = pixels[y * width + x];
+            if (value <= threshold)
+                continue;
+            value -= background;
+            flux += value;
+            sumX += value * x;
+            sumY += value * y;
+            count++;
+        }
+
+    if (count == 0)
+        return false;
+
+    star.x = sumX / flux;
+    star.y = sumY / flux;
+
+    double sumRadius = 0;
+    for (uint32_t y = 0; y < height; y++)
+        for (uint32_t x = 0; x < width; x++)
+        {
+            double value = pixels[y * width + x];
+            if (value > threshold)
+                sumRadius += (value - background) * std::hypot(x - star.x, y - star.y);
+        }
+
+    star.hfr        = sumRadius / flux;
+    star.snr        = flux / (noise * std::sqrt(static_cast<double>(count)));
+    star.flux       = flux;
+    star.background = background;
+    star.noise      = noise;
+    return true;
+}
+
 }
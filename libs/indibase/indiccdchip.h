@@ -24,14 +24,33 @@
 #include "indipropertyblob.h"
 
 #include "indipropertynumber.h"
+#include "fitskeyword.h"
 
 #include <sys/time.h>
 #include <stdint.h>
 #include <fitsio.h>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
 
 namespace INDI
 {
 
+/**
+ * @brief The ImageStatistics struct holds the statistics of a mono frame.
+ */
+struct ImageStatistics
+{
+    double min {0};
+    double max {0};
+    double mean {0};
+    double stddev {0};
+    /// Exact for 8 and 16 bits, within 1/65536 of the range for 32 bits.
+    double median {0};
+    /// Pixel counts of equal width bins from min to max.
+    std::vector<uint32_t> histogram;
+};
+
 /**
  * @brief The CCDChip class provides functionality of a CCD Chip within a CCD.
  */
@@ -53,6 +72,9 @@ class CCDChip
             CCD_PIXEL_SIZE_Y,
             CCD_BITSPERPIXEL
         } CCD_INFO_INDEX;
+        typedef enum { GUIDE_ROI_OFF, GUIDE_ROI_DATA, GUIDE_ROI_IMAGE } GUIDE_ROI_MODE;
+        typedef enum { ROI_STAR_X, ROI_STAR_Y, ROI_BOX } GUIDE_ROI_INDEX;
+        typedef enum { GUIDESTAR_X, GUIDESTAR_Y, GUIDESTAR_SNR, GUIDESTAR_HFR } GUIDE_STAR_INDEX;
 
         /**
          * @brief openFITSFile Allocate memory buffer for internal FITS file structure and open
@@ -74,6 +96,26 @@ class CCDChip
          */
         void closeFITSFile();
 
+        /**
+         * @brief writeFITSKeywords Write keywords to the header of the open FITS file, after its image is created.
+         * Each keyword is rendered to its card once: while it is the same as the one at the same position on the
+         * previous frame, the card is reused. Cards are appended without searching the header, except for keywords
+         * already there, like BITPIX, which are updated in place.
+         * @param keywords to write, in header order.
+         * @param failed receives the keys that could not be written, with their FITS status.
+         */
+        void writeFITSKeywords(const std::vector<FITSRecord> &keywords, std::vector<std::pair<std::string, int>> &failed);
+
+        /**
+         * @brief renderFITSCards Render keywords to header cards for FITSImageWriter, with the same cache as
+         * writeFITSKeywords.
+         * @param keywords to render, in header order.
+         * @param cards receives the cards of each keyword, 80 columns per card.
+         * @param failed receives the keys that could not be rendered, with their FITS status.
+         */
+        void renderFITSCards(const std::vector<FITSRecord> &keywords, std::vector<std::string> &cards,
+                             std::vector<std::pair<std::string, int>> &failed);
+
         /**
          * @brief getXRes Get the horizontal resolution in pixels of the CCD Chip.
          * @return the horizontal resolution of the CCD Chip.
@@ -215,6 +257,16 @@ class CCDChip
             return RawFrame;
         }
 
+        /**
+         * @brief getBufferLock Get the mutex protecting the frame buffer of the chip.
+         * @return Mutex to hold while writing the frame buffer. Frames of the other chip are completed
+         * under their own mutex, so that both chips can complete at the same time.
+         */
+        inline std::mutex &getBufferLock()
+        {
+            return m_BufferLock;
+        }
+
         /**
          * @brief setFrameBuffer Set raw frame buffer pointer.
          * @param buffer pointer to frame buffer
@@ -335,6 +387,34 @@ class CCDChip
          */
         void setFrameBufferSize(uint32_t nbuf, bool allocMem = true);
 
+        /**
+         * @brief setFrameRingSize Keep a ring of frame buffers for drivers that read frames faster than they are
+         * uploaded. The buffers are allocated right away and follow setFrameBufferSize(). Frames currently acquired
+         * are returned to the ring, or freed if it shrank, when released.
+         * @param count number of buffers, 0 to disable the ring.
+         */
+        void setFrameRingSize(uint32_t count);
+
+        /**
+         * @return Number of buffers in the frame ring, 0 if disabled.
+         */
+        uint32_t getFrameRingSize();
+
+        /**
+         * @brief acquireFrame Take a free buffer out of the frame ring. The driver reads the next frame into it,
+         * then either passes it to CCD::FrameComplete() or gives it back with releaseFrame().
+         * @param timeout milliseconds to wait for a buffer to be released when all are in use, negative to wait
+         * as long as it takes.
+         * @return buffer of getFrameBufferSize() bytes, or nullptr if the ring is disabled or none was released in time.
+         */
+        uint8_t *acquireFrame(int timeout = -1);
+
+        /**
+         * @brief releaseFrame Return a buffer obtained from acquireFrame() to the frame ring.
+         * @param frame buffer to release.
+         */
+        void releaseFrame(uint8_t *frame);
+
         /**
          * @brief setBPP Set depth of CCD chip.
          * @param bpp bits per pixel
@@ -405,6 +485,16 @@ class CCDChip
             return (ImageExposureNP.getState() == IPS_BUSY);
         }
 
+        /**
+         * @return How the frames of the chip are handled in guide ROI mode, GUIDE_ROI_OFF when they are
+         * uploaded as usual.
+         */
+        GUIDE_ROI_MODE getGuideROIMode() const
+        {
+            int mode = GuideROISP.findOnSwitchIndex();
+            return mode < 0 ? GUIDE_ROI_OFF : static_cast<GUIDE_ROI_MODE>(mode);
+        }
+
         /**
          * @brief binFrame Perform software binning on the CCD frame. Only use this function if hardware
          * binning is not supported.
@@ -481,6 +571,38 @@ class CCDChip
         void * m_FITSMemoryBlock {nullptr};
         size_t m_FITSMemorySize {2880};
         fitsfile * m_FITSFilePointer {nullptr};
+        // Keywords of the previous frame, with their rendered card. Empty card if not renderable
+        std::vector<std::pair<FITSRecord, std::string>> m_FITSCards;
+        const std::string &cachedFITSCard(size_t index, const FITSRecord &keyword, int &status);
+
+        // Frame ring, shared blobs of RawFrameSize bytes once (re)allocated
+        struct RingFrame
+        {
+            uint8_t *data {nullptr};
+            uint32_t size {0};
+            bool busy {false};
+        };
+        std::vector<RingFrame> m_FrameRing;
+        uint32_t m_FrameRingSize {0};
+        std::mutex m_FrameRingLock;
+        std::condition_variable m_FrameRingReleased;
+
+        // Frame buffer of the chip, held by the driver writing it and while it is encoded in place
+        std::mutex m_BufferLock;
+
+        // Frame being completed: exposure of the FITS header and statistics, only used by the completing thread
+        double m_CompletedDuration {0};
+        char m_CompletedStartTime[MAXINDINAME] {};
+        ImageStatistics m_ImageStats;
+        bool m_ImageStatsValid {false};
+        double m_CompletedMin {0}, m_CompletedMax {0}; // DATAMIN/DATAMAX without statistics, see WITH_MINMAX
+        bool m_CompletedMinMaxValid {false};
+
+        // Pipelined completion, frames of the chip are uploaded in the order they completed
+        std::mutex m_PipelineLock;
+        std::condition_variable m_PipelineTurn;
+        uint64_t m_PipelineNext {0};    // ticket of the next completed frame
+        uint64_t m_PipelineServing {0}; // ticket of the frame allowed to upload
 
         /////////////////////////////////////////////////////////////////////////////////////////
         /// Chip Properties
@@ -534,6 +656,13 @@ class CCDChip
         /////////////////////////////////////////////////////////////////////////////////////////
         INDI::PropertySwitch ResetSP{1};
 
+        /////////////////////////////////////////////////////////////////////////////////////////
+        /// Guide ROI: read out a box around the guide star and publish its centroid
+        /////////////////////////////////////////////////////////////////////////////////////////
+        INDI::PropertySwitch GuideROISP {3};
+        INDI::PropertyNumber GuideROINP {3};
+        INDI::PropertyNumber GuideStarNP {4};
+
         friend class CCD;
         friend class StreamRecoder;
 
@@ -550,4 +679,41 @@ class CCDChip
 
 };
 
+/**
+ * @brief computeImageStatistics Compute the statistics of a frame in one pass, on several threads for large frames.
+ * @param buffer Frame of width x height pixels.
+ * @param bpp Bits per pixel, 8, 16 or 32.
+ * @param bins Number of histogram bins.
+ * @return False if bpp is not supported or the frame is empty.
+ */
+bool computeImageStatistics(const uint8_t *buffer, uint32_t width, uint32_t height, int bpp, ImageStatistics &stats,
+                            uint32_t bins = 256);
+
+/**
+ * @brief The GuideStar struct holds the measures of the star in a guide box.
+ */
+struct GuideStar
+{
+    /// Centroid in pixels of the box, the first pixel is centered on 0,0.
+    double x {0};
+    double y {0};
+    /// Background subtracted flux over the noise of the pixels it was measured on.
+    double snr {0};
+    /// Half flux radius in pixels.
+    double hfr {0};
+    double flux {0};
+    double background {0};
+    double noise {0};
+};
+
+/**
+ * @brief findGuideStar Measure the brightest star of a small mono frame. The background and noise are
+ * the median and deviation of the frame border, the centroid and HFR are weighted by the pixels above
+ * three times the noise.
+ * @param buffer Frame of width x height pixels.
+ * @param bpp Bits per pixel, 8, 16 or 32.
+ * @return False if bpp is not supported, the frame is smaller than 5x5 or holds no star.
+ */
+bool findGuideStar(const uint8_t *buffer, uint32_t width, uint32_t height, int bpp, GuideStar &star);
+
 }
@@ -19,6 +19,7 @@
 
 #include "defaultdevice.h"
 #include "indicorrelator.h"
+#include "stream/streammanager.h"
 
 #include "indicom.h"
 #include "locale_compat.h"
@@ -231,5 +232,34 @@ void Correlator::setMinMaxStep(const char *property, const char *element, double
             IUUpdateMinMax(nvp);
     }
 }
+
+void Correlator::setupFX(size_t inputs, size_t lags)
+{
+    FX.reset(new FXCorrelator(inputs, lags));
 }
 
+size_t Correlator::correlate(const double *const *samples, size_t count)
+{
+    if (!FX)
+        return 0;
+    return FX->accumulate(samples, count);
+}
+
+void Correlator::sendVisibilities()
+{
+    if (!FX)
+        return;
+
+    std::vector<double> visibilities = FX->getVisibilities();
+    FX->reset();
+
+    setBufferSize(visibilities.size() * sizeof(double));
+    setBPS(-64);
+    memcpy(getBuffer(), visibilities.data(), getBufferSize());
+
+    if (HasStreaming() && Streamer->isBusy())
+        Streamer->newFrame(getBuffer(), getBufferSize());
+
+    IntegrationComplete();
+}
+}
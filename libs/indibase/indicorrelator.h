@@ -19,6 +19,7 @@
 #pragma once
 
 #include "indisensorinterface.h"
+#include "fxcorrelator.h"
 #include "dsp.h"
 #include <fitsio.h>
 
@@ -262,6 +263,28 @@ class Correlator : public SensorInterface
         virtual void setMinMaxStep(const char *property, const char *element, double min, double max, double step,
                                    bool sendToClient) override;
 
+        /**
+         * @brief setupFX Set up the FX correlation of the inputs, dropping the visibilities accumulated so far.
+         * @param inputs number of sample streams, one per telescope.
+         * @param lags visibility channels per baseline.
+         */
+        void setupFX(size_t inputs, size_t lags);
+
+        /**
+         * @brief correlate Accumulate the visibilities of blocks of samples of every input, see FXCorrelator::accumulate().
+         * @param samples one array of count samples per input.
+         * @param count samples per input.
+         * @return the number of blocks accumulated, 0 if setupFX() was not called.
+         */
+        size_t correlate(const double *const *samples, size_t count);
+
+        /**
+         * @brief sendVisibilities Complete the integration with the averaged visibilities of all baselines, and stream
+         * them when streaming, then start accumulating anew. The visibilities are 64 bits doubles, real and imaginary parts
+         * interleaved, lag channels of the first baseline then of the next ones in FXCorrelator::getBaseline() order.
+         */
+        void sendVisibilities();
+
         typedef enum
         {
             CORRELATOR_BASELINE_X = 0,
@@ -272,6 +295,9 @@ class Correlator : public SensorInterface
         } CORRELATOR_INFO_INDEX;
         INumberVectorProperty CorrelatorSettingsNP;
 
+    protected:
+        std::unique_ptr<FXCorrelator> FX;
+
     private:
         Baseline baseline;
         double wavelength;
@@ -0,0 +1,352 @@
+#if 0
+INDI Driver Functions
+
+This library is free software;
+you can redistribute it and / or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation;
+either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY;
+without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library;
+if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#endif
+
+#include "indidefcache.h"
+
+#include "indicom.h"
+#include "indiuserio.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* growable byte buffer */
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t size;
+} Buffer;
+
+static void buffer_reserve(Buffer *b, size_t count)
+{
+    if (b->len + count <= b->size)
+        return;
+    size_t size = b->size ? b->size : 1024;
+    while (size < b->len + count)
+        size *= 2;
+    assert_mem(b->data = (char *)realloc(b->data, size));
+    b->size = size;
+}
+
+static void buffer_append(Buffer *b, const void *ptr, size_t count)
+{
+    buffer_reserve(b, count);
+    memcpy(b->data + b->len, ptr, count);
+    b->len += count;
+}
+
+static ssize_t buffer_write(void *user, const void *ptr, size_t count)
+{
+    buffer_append((Buffer *)user, ptr, count);
+    return count;
+}
+
+static int buffer_vprintf(void *user, const char *format, va_list arg)
+{
+    Buffer *b = (Buffer *)user;
+    va_list copy;
+    va_copy(copy, arg);
+    int len = vsnprintf(b->data + b->len, b->size - b->len, format, copy);
+    va_end(copy);
+    if (len >= 0 && (size_t)len >= b->size - b->len)
+    {
+        buffer_reserve(b, len + 1);
+        len = vsnprintf(b->data + b->len, b->size - b->len, format, arg);
+    }
+    if (len > 0)
+        b->len += len;
+    return len;
+}
+
+static const userio buffer_io = { buffer_write, buffer_vprintf, NULL };
+
+/* the fields a def message is made of, strings with their nul */
+static void key_string(Buffer *key, const char *str)
+{
+    if (str == NULL)
+        buffer_append(key, "\1", 1);
+    else
+        buffer_append(key, str, strlen(str) + 1);
+}
+
+static void key_value(Buffer *key, const void *ptr, size_t count)
+{
+    buffer_append(key, ptr, count);
+}
+
+static void key_header(Buffer *key, const char *device, const char *name, const char *label, const char *group,
+                       int state)
+{
+    key_string(key, device);
+    key_string(key, name);
+    key_string(key, label);
+    key_string(key, group);
+    key_value(key, &state, sizeof(state));
+}
+
+typedef struct
+{
+    const void *ptr;           /* the property the message was made of */
+    char device[MAXINDIDEVICE];
+    char name[MAXINDINAME];
+    Buffer key;
+    Buffer xml;
+    size_t stamp;              /* offset of the timestamp value in xml */
+    size_t stampLen;
+} Entry;
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static Entry *entries = NULL;
+static int nentries = 0;
+static Buffer scratch;        /* key of the property being defined */
+
+static Entry *find(const void *ptr)
+{
+    for (int i = 0; i < nentries; i++)
+        if (entries[i].ptr == ptr)
+            return &entries[i];
+    return NULL;
+}
+
+static void locate_stamp(Entry *e)
+{
+    static const char attr[] = "timestamp='";
+    const char *end = e->xml.data + e->xml.len;
+    const char *at = NULL;
+
+    /* the attribute is in the first lines, before any text of the elements */
+    for (const char *p = e->xml.data; p + sizeof(attr) - 1 < end && *p != '>'; p++)
+    {
+        if (!memcmp(p, attr, sizeof(attr) - 1))
+        {
+            at = p + sizeof(attr) - 1;
+            break;
+        }
+    }
+
+    e->stamp = e->stampLen = 0;
+    if (at == NULL)
+        return;
+    const char *quote = memchr(at, '\'', end - at);
+    if (quote == NULL)
+        return;
+    e->stamp = at - e->xml.data;
+    e->stampLen = quote - at;
+}
+
+/* write the message of ptr, formatted again by make() only when the scratch key changed.
+ * called with cache_mutex held.
+ */
+static void emit(const userio *io, void *user, const void *ptr, const char *device, const char *name,
+                 void (*make)(const userio *, void *, const void *, ...))
+{
+    Entry *e = find(ptr);
+    if (e != NULL && e->key.len == scratch.len && !memcmp(e->key.data, scratch.data, scratch.len))
+    {
+        if (e->stampLen > 0)
+        {
+            userio_write(io, user, e->xml.data, e->stamp);
+            userio_prints(io, user, indi_timestamp());
+            userio_write(io, user, e->xml.data + e->stamp + e->stampLen, e->xml.len - e->stamp - e->stampLen);
+        }
+        else
+            userio_write(io, user, e->xml.data, e->xml.len);
+        return;
+    }
+
+    if (e == NULL)
+    {
+        assert_mem(entries = (Entry *)realloc(entries, (nentries + 1) * sizeof(Entry)));
+        e = &entries[nentries++];
+        memset(e, 0, sizeof(*e));
+        e->ptr = ptr;
+    }
+    snprintf(e->device, sizeof(e->device), "%s", device);
+    snprintf(e->name, sizeof(e->name), "%s", name);
+
+    /* keep the key, the scratch buffer takes the old one */
+    Buffer old = e->key;
+    e->key = scratch;
+    scratch = old;
+    scratch.len = 0;
+
+    e->xml.len = 0;
+    make(&buffer_io, &e->xml, ptr, NULL);
+    locate_stamp(e);
+    userio_write(io, user, e->xml.data, e->xml.len);
+}
+
+static void make_text(const userio *io, void *user, const void *ptr, ...)
+{
+    va_list ap;
+    va_start(ap, ptr);
+    IUUserIODefTextVA(io, user, (const ITextVectorProperty *)ptr, NULL, ap);
+    va_end(ap);
+}
+
+static void make_number(const userio *io, void *user, const void *ptr, ...)
+{
+    va_list ap;
+    va_start(ap, ptr);
+    IUUserIODefNumberVA(io, user, (const INumberVectorProperty *)ptr, NULL, ap);
+    va_end(ap);
+}
+
+static void make_switch(const userio *io, void *user, const void *ptr, ...)
+{
+    va_list ap;
+    va_start(ap, ptr);
+    IUUserIODefSwitchVA(io, user, (const ISwitchVectorProperty *)ptr, NULL, ap);
+    va_end(ap);
+}
+
+static void make_light(const userio *io, void *user, const void *ptr, ...)
+{
+    va_list ap;
+    va_start(ap, ptr);
+    IUUserIODefLightVA(io, user, (const ILightVectorProperty *)ptr, NULL, ap);
+    va_end(ap);
+}
+
+static void make_blob(const userio *io, void *user, const void *ptr, ...)
+{
+    va_list ap;
+    va_start(ap, ptr);
+    IUUserIODefBLOBVA(io, user, (const IBLOBVectorProperty *)ptr, NULL, ap);
+    va_end(ap);
+}
+
+/* the scratch key is shared, it is built under the lock */
+void defcache_text(const userio *io, void *user, const ITextVectorProperty *tvp)
+{
+    pthread_mutex_lock(&cache_mutex);
+    scratch.len = 0;
+    key_header(&scratch, tvp->device, tvp->name, tvp->label, tvp->group, tvp->s);
+    key_value(&scratch, &tvp->p, sizeof(tvp->p));
+    key_value(&scratch, &tvp->timeout, sizeof(tvp->timeout));
+    key_value(&scratch, &tvp->ntp, sizeof(tvp->ntp));
+    for (int i = 0; i < tvp->ntp; i++)
+    {
+        key_string(&scratch, tvp->tp[i].name);
+        key_string(&scratch, tvp->tp[i].label);
+        key_string(&scratch, tvp->tp[i].text);
+    }
+    emit(io, user, tvp, tvp->device, tvp->name, make_text);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void defcache_number(const userio *io, void *user, const INumberVectorProperty *nvp)
+{
+    pthread_mutex_lock(&cache_mutex);
+    scratch.len = 0;
+    key_header(&scratch, nvp->device, nvp->name, nvp->label, nvp->group, nvp->s);
+    key_value(&scratch, &nvp->p, sizeof(nvp->p));
+    key_value(&scratch, &nvp->timeout, sizeof(nvp->timeout));
+    key_value(&scratch, &nvp->nnp, sizeof(nvp->nnp));
+    for (int i = 0; i < nvp->nnp; i++)
+    {
+        const INumber *np = &nvp->np[i];
+        key_string(&scratch, np->name);
+        key_string(&scratch, np->label);
+        key_string(&scratch, np->format);
+        key_value(&scratch, &np->min, sizeof(np->min));
+        key_value(&scratch, &np->max, sizeof(np->max));
+        key_value(&scratch, &np->step, sizeof(np->step));
+        key_value(&scratch, &np->value, sizeof(np->value));
+    }
+    emit(io, user, nvp, nvp->device, nvp->name, make_number);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void defcache_switch(const userio *io, void *user, const ISwitchVectorProperty *svp)
+{
+    pthread_mutex_lock(&cache_mutex);
+    scratch.len = 0;
+    key_header(&scratch, svp->device, svp->name, svp->label, svp->group, svp->s);
+    key_value(&scratch, &svp->p, sizeof(svp->p));
+    key_value(&scratch, &svp->r, sizeof(svp->r));
+    key_value(&scratch, &svp->timeout, sizeof(svp->timeout));
+    key_value(&scratch, &svp->nsp, sizeof(svp->nsp));
+    for (int i = 0; i < svp->nsp; i++)
+    {
+        key_string(&scratch, svp->sp[i].name);
+        key_string(&scratch, svp->sp[i].label);
+        key_value(&scratch, &svp->sp[i].s, sizeof(svp->sp[i].s));
+    }
+    emit(io, user, svp, svp->device, svp->name, make_switch);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void defcache_light(const userio *io, void *user, const ILightVectorProperty *lvp)
+{
+    pthread_mutex_lock(&cache_mutex);
+    scratch.len = 0;
+    key_header(&scratch, lvp->device, lvp->name, lvp->label, lvp->group, lvp->s);
+    key_value(&scratch, &lvp->nlp, sizeof(lvp->nlp));
+    for (int i = 0; i < lvp->nlp; i++)
+    {
+        key_string(&scratch, lvp->lp[i].name);
+        key_string(&scratch, lvp->lp[i].label);
+        key_value(&scratch, &lvp->lp[i].s, sizeof(lvp->lp[i].s));
+    }
+    emit(io, user, lvp, lvp->device, lvp->name, make_light);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void defcache_blob(const userio *io, void *user, const IBLOBVectorProperty *bvp)
+{
+    pthread_mutex_lock(&cache_mutex);
+    scratch.len = 0;
+    key_header(&scratch, bvp->device, bvp->name, bvp->label, bvp->group, bvp->s);
+    key_value(&scratch, &bvp->p, sizeof(bvp->p));
+    key_value(&scratch, &bvp->timeout, sizeof(bvp->timeout));
+    key_value(&scratch, &bvp->nbp, sizeof(bvp->nbp));
+    for (int i = 0; i < bvp->nbp; i++)
+    {
+        key_string(&scratch, bvp->bp[i].name);
+        key_string(&scratch, bvp->bp[i].label);
+    }
+    emit(io, user, bvp, bvp->device, bvp->name, make_blob);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void defcache_remove(const char *dev, const char *name)
+{
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = 0; i < nentries;)
+    {
+        Entry *e = &entries[i];
+        if ((dev == NULL || !strcmp(e->device, dev)) && (name == NULL || !strcmp(e->name, name)))
+        {
+            free(e->key.data);
+            free(e->xml.data);
+            entries[i] = entries[--nentries];
+        }
+        else
+            i++;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
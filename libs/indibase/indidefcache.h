@@ -0,0 +1,50 @@
+#if 0
+INDI Driver Functions
+
+This library is free software;
+you can redistribute it and / or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation;
+either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY;
+without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library;
+if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#endif
+
+#pragma once
+
+#include "indiapi.h"
+#include "userio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cache of the def*Vector messages sent by IDDefXXX() without a message.
+ * Every getProperties defines all the properties again. Each message is kept as it was
+ * written, along with a copy of the fields it was made of: while they are the same, the message
+ * is written again with a new timestamp instead of being formatted from scratch.
+ */
+
+void defcache_text(const userio *io, void *user, const ITextVectorProperty *tvp);
+void defcache_number(const userio *io, void *user, const INumberVectorProperty *nvp);
+void defcache_switch(const userio *io, void *user, const ISwitchVectorProperty *svp);
+void defcache_light(const userio *io, void *user, const ILightVectorProperty *lvp);
+void defcache_blob(const userio *io, void *user, const IBLOBVectorProperty *bvp);
+
+/* Forget the messages of property name of device dev, or all those of the device if name is NULL */
+void defcache_remove(const char *dev, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
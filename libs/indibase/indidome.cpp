@@ -32,6 +32,7 @@
 #include <libnova/sidereal_time.h>
 #include <libnova/transform.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cmath>
 #include <cstring>
@@ -1328,7 +1329,6 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
 {
     point3D MountCenter, OptCenter, OptVector, DomeIntersect;
     double hourAngle;
-    double mu1, mu2;
 
     if (HaveLatLong == false)
     {
@@ -1337,8 +1337,21 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
         return false;
     }
 
-    double JD  = ln_get_julian_from_sys();
     double LST = get_local_sidereal_time(observer.longitude);
+
+    // Get hour angle in hours
+    hourAngle = get_local_hour_angle(LST, mountEquatorialCoords.rightascension);
+
+    // Away from the pole the target only depends on hour angle and declination, interpolate it
+    bool nearPole = std::abs(mountEquatorialCoords.declination) > POLE_THRESHOLD_DEC;
+    if (!nearPole && LookupTargetAz(hourAngle, mountEquatorialCoords.declination,
+                                    GetOTASide(hourAngle) * DomeMeasurementsNP[DM_OTA_OFFSET].getValue(), Az, Alt))
+    {
+        GetTargetAzRange(Az, Alt, minAz, maxAz);
+        return true;
+    }
+
+    double JD  = ln_get_julian_from_sys();
     char lstStr[64], latStr[64], lonStr[64];
     fs_sexa(lstStr, LST, 2, 3600);
     fs_sexa(latStr, observer.latitude, 2, 3600);
@@ -1351,8 +1364,6 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
     MountCenter.y = DomeMeasurementsNP[DM_NORTH_DISPLACEMENT].getValue();  // Positive to North
     MountCenter.z = DomeMeasurementsNP[DM_UP_DISPLACEMENT].getValue();    // Positive Up
 
-    // Get hour angle in hours
-    hourAngle = get_local_hour_angle(LST, mountEquatorialCoords.rightascension);
     char raStr[64], decStr[64], haStr[64];
     fs_sexa(raStr, mountEquatorialCoords.rightascension, 2, 3600);
     fs_sexa(decStr, mountEquatorialCoords.declination, 2, 3600);
@@ -1370,8 +1381,6 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
     // Near the celestial pole, HA calculated from RA can be unreliable for determining pier side.
     // Use Azimuth to infer a more reliable effective HA for the OpticalCenter calculation.
     double effectiveHourAngle = hourAngle; // Use original HA by default
-    const double poleThresholdDec = 85.0; // Degrees
-    bool nearPole = std::abs(mountEquatorialCoords.declination) > poleThresholdDec;
     if (nearPole)
     {
         // If Azimuth is near 0 (e.g., < 90 or > 270), force HA towards 0 (on meridian)
@@ -1383,18 +1392,51 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
     }
 
     // Side of the telescope with respect of the mount, 1: west, -1: east, 0: use the mid point
-    int OTASide = 0;
+    int OTASide = GetOTASide(effectiveHourAngle);
     int otaSideSelection = OTASideSP.findOnSwitchIndex(); // Get selected mode
 
+    // Use effectiveHourAngle for the calculation if near the pole
+    double otaOffset = OTASide * DomeMeasurementsNP[DM_OTA_OFFSET].getValue();
+    OpticalCenter(MountCenter, otaOffset, observer.latitude, effectiveHourAngle, OptCenter);
+
+    // Get optical axis point. This and the previous form the optical axis line
+    OpticalVector(mountHoriztonalCoords.azimuth, mountHoriztonalCoords.altitude, OptVector);
+
+    // Condensed Geometry Log
+    char effHaStr[64];
+    fs_sexa(effHaStr, effectiveHourAngle, 2, 3600);
+    LOGF_DEBUG("Geom - Mount(E:%.2f,N:%.2f,Up:%.2f) OTA(SideSel:%d, SideUsed:%d, Off:%.2f, EffHA:%s) -> OptCenter(X:%.3f,Y:%.3f,Z:%.3f) OptVec(X:%.3f,Y:%.3f,Z:%.3f)",
+               MountCenter.x, MountCenter.y, MountCenter.z,
+               otaSideSelection, OTASide, DomeMeasurementsNP[DM_OTA_OFFSET].getValue(), effHaStr,
+               OptCenter.x, OptCenter.y, OptCenter.z,
+               OptVector.x, OptVector.y, OptVector.z);
+
+
+    if (DomeIntersection(OptCenter, OptVector, DomeMeasurementsNP[DM_DOME_RADIUS].getValue(), DomeIntersect, Az, Alt))
+    {
+        LOGF_DEBUG("Intersection - Point(X:%.3f, Y:%.3f, Z:%.3f)", DomeIntersect.x, DomeIntersect.y, DomeIntersect.z);
+        GetTargetAzRange(Az, Alt, minAz, maxAz);
+        return true;
+    }
+    else
+    {
+        LOG_WARN("Optical axis does not intersect dome sphere.");
+        return false;
+    }
+}
+
+int Dome::GetOTASide(double hourAngle)
+{
+    int OTASide = 0;
+    int otaSideSelection = OTASideSP.findOnSwitchIndex();
+
     if (OTASideSP.getState() == IPS_OK)
     {
         if(otaSideSelection == DM_OTA_SIDE_HA || (UseHourAngle && otaSideSelection == DM_OTA_SIDE_MOUNT))
         {
             // Note if the telescope points West (HA > 0), OTA is at east of the pier, and vice-versa.
-            double haForSide = nearPole ? effectiveHourAngle : hourAngle; // Use effective HA near pole
-
             // Determine side based on HA. HA=0 means pointing East (OTA West), HA=12 means pointing West (OTA East)
-            if (haForSide > 0.1 && haForSide < 11.9) // Pointing West
+            if (hourAngle > 0.1 && hourAngle < 11.9) // Pointing West
                 OTASide = -1; // OTA East
             else // Pointing East (HA near 0 or 12)
                 OTASide = 1; // OTA West
@@ -1408,96 +1450,165 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
         // DM_OTA_SIDE_IGNORE results in OTASide = 0
     }
 
-    // Use effectiveHourAngle for the calculation if near the pole
-    double otaOffset = OTASide * DomeMeasurementsNP[DM_OTA_OFFSET].getValue();
-    OpticalCenter(MountCenter, otaOffset, observer.latitude, effectiveHourAngle, OptCenter);
+    return OTASide;
+}
 
-    // Get optical axis point. This and the previous form the optical axis line
-    OpticalVector(mountHoriztonalCoords.azimuth, mountHoriztonalCoords.altitude, OptVector);
+bool Dome::DomeIntersection(point3D OptCenter, point3D OptVector, double radius, point3D &DomeIntersect, double &Az,
+                            double &Alt)
+{
+    double mu1, mu2;
 
-    // Condensed Geometry Log
-    char effHaStr[64];
-    fs_sexa(effHaStr, effectiveHourAngle, 2, 3600);
-    LOGF_DEBUG("Geom - Mount(E:%.2f,N:%.2f,Up:%.2f) OTA(SideSel:%d, SideUsed:%d, Off:%.2f, EffHA:%s) -> OptCenter(X:%.3f,Y:%.3f,Z:%.3f) OptVec(X:%.3f,Y:%.3f,Z:%.3f)",
-               MountCenter.x, MountCenter.y, MountCenter.z,
-               otaSideSelection, OTASide, DomeMeasurementsNP[DM_OTA_OFFSET].getValue(), effHaStr,
-               OptCenter.x, OptCenter.y, OptCenter.z,
-               OptVector.x, OptVector.y, OptVector.z);
+    if (!Intersection(OptCenter, OptVector, radius, mu1, mu2))
+        return false;
+
+    // If telescope is pointing over the horizon, the solution is mu1, else is mu2
+    if (mu1 < 0)
+        mu1 = mu2;
+
+    DomeIntersect.x = OptCenter.x + mu1 * (OptVector.x );
+    DomeIntersect.y = OptCenter.y + mu1 * (OptVector.y );
+    DomeIntersect.z = OptCenter.z + mu1 * (OptVector.z );
 
+    // Calculate Azimuth using atan2(x, y) for robustness.
+    // atan2 returns angle in radians from +Y axis (North), range [-pi, +pi].
+    // We want Azimuth in degrees from North [0, 360).
+    Az = atan2(DomeIntersect.x, DomeIntersect.y) * 180.0 / M_PI;
 
-    if (Intersection(OptCenter, OptVector, DomeMeasurementsNP[DM_DOME_RADIUS].getValue(), mu1, mu2))
+    // Normalize Az to [0, 360) range
+    if (Az < 0)
     {
-        // If telescope is pointing over the horizon, the solution is mu1, else is mu2
-        if (mu1 < 0)
-        {
-            // LOGF_DEBUG("Intersection mu1 < 0, using mu2 (%.3f)", mu2); // Less critical
-            mu1 = mu2;
-        }
+        Az += 360.0;
+    }
+    if (Az >= 360.0)
+    {
+        Az = 0.0;    // Handle potential edge case exactly at 360
+    }
 
-        double HalfApertureChordAngle;
-        double RadiusAtAlt;
+    if ((std::abs(DomeIntersect.x) > 0.00001) || (std::abs(DomeIntersect.y) > 0.00001))
+        Alt = 180 * atan(DomeIntersect.z / sqrt((DomeIntersect.x * DomeIntersect.x) + (DomeIntersect.y * DomeIntersect.y))) /  M_PI;
+    else
+        Alt = 90; // Dome Zenith
 
-        DomeIntersect.x = OptCenter.x + mu1 * (OptVector.x );
-        DomeIntersect.y = OptCenter.y + mu1 * (OptVector.y );
-        DomeIntersect.z = OptCenter.z + mu1 * (OptVector.z );
-        LOGF_DEBUG("Intersection - Point(X:%.3f, Y:%.3f, Z:%.3f) Dist: %.3f", DomeIntersect.x, DomeIntersect.y, DomeIntersect.z,
-                   mu1);
+    return true;
+}
 
-        // Calculate Azimuth using atan2(x, y) for robustness.
-        // atan2 returns angle in radians from +Y axis (North), range [-pi, +pi].
-        // We want Azimuth in degrees from North [0, 360).
-        Az = atan2(DomeIntersect.x, DomeIntersect.y) * 180.0 / M_PI;
+void Dome::GetTargetAzRange(double Az, double Alt, double &minAz, double &maxAz)
+{
+    double HalfApertureChordAngle;
+    double RadiusAtAlt;
 
-        // Normalize Az to [0, 360) range
-        if (Az < 0)
-        {
-            Az += 360.0;
-        }
-        if (Az >= 360.0)
-        {
-            Az = 0.0;    // Handle potential edge case exactly at 360
-        }
+    // Calculate the Azimuth range in the given Altitude of the dome
+    RadiusAtAlt = DomeMeasurementsNP[DM_DOME_RADIUS].getValue() * cos(M_PI * Alt / 180); // Radius at the given altitude
 
+    if (DomeMeasurementsNP[DM_SHUTTER_WIDTH].getValue() < (2 * RadiusAtAlt))
+    {
+        HalfApertureChordAngle = 180 * asin(DomeMeasurementsNP[DM_SHUTTER_WIDTH].getValue() / (2 * RadiusAtAlt)) /
+                                 M_PI; // Angle of a chord of half aperture length
+        minAz = range360(Az - HalfApertureChordAngle); // Ensure range 0..360
+        maxAz = range360(Az + HalfApertureChordAngle); // Ensure range 0..360
+    }
+    else
+    {
+        minAz = 0;
+        maxAz = 360;
+    }
 
-        if ((std::abs(DomeIntersect.x) > 0.00001) || (std::abs(DomeIntersect.y) > 0.00001))
-            Alt = 180 * atan(DomeIntersect.z / sqrt((DomeIntersect.x * DomeIntersect.x) + (DomeIntersect.y * DomeIntersect.y))) /  M_PI;
-        else
-            Alt = 90; // Dome Zenith
+    // Final Condensed Log
+    char currentAzStr[64], targetAzStr[64], targetAltStr[64], minAzStr[64], maxAzStr[64];
+    fs_sexa(currentAzStr, DomeAbsPosNP[0].getValue(), 2, 3600);
+    fs_sexa(targetAzStr, Az, 2, 3600);
+    fs_sexa(targetAltStr, Alt, 2, 3600);
+    fs_sexa(minAzStr, minAz, 2, 3600);
+    fs_sexa(maxAzStr, maxAz, 2, 3600);
+    LOGF_DEBUG("Result - Current Az:%s , Target Az: %s, Alt: %s --> Range Min: %s, Max: %s", currentAzStr, targetAzStr,
+               targetAltStr, minAzStr, maxAzStr);
+}
 
+bool Dome::LookupTargetAz(double hourAngle, double dec, double otaOffset, double &Az, double &Alt)
+{
+    const std::array<double, 6> geometry =
+    {
+        DomeMeasurementsNP[DM_DOME_RADIUS].getValue(),
+        DomeMeasurementsNP[DM_EAST_DISPLACEMENT].getValue(),
+        DomeMeasurementsNP[DM_NORTH_DISPLACEMENT].getValue(),
+        DomeMeasurementsNP[DM_UP_DISPLACEMENT].getValue(),
+        otaOffset,
+        observer.latitude
+    };
+
+    // Tables of other measurements or latitudes are dropped as they get replaced
+    auto table = std::find_if(m_TargetTables.begin(), m_TargetTables.end(), [&geometry](const TargetTable & t)
+    {
+        return t.geometry == geometry;
+    });
+    if (table == m_TargetTables.end())
+    {
+        if (m_TargetTables.size() >= TARGET_TABLE_COUNT)
+            m_TargetTables.erase(m_TargetTables.begin());
+        m_TargetTables.push_back({geometry, std::vector<std::vector<float>>(TARGET_TABLE_ROWS)});
+        table = m_TargetTables.end() - 1;
+    }
+
+    // Hour angle -180..180 degrees in columns, declination -90..90 in rows
+    double x = (rangeHA(hourAngle) * 15 + 180) / TARGET_TABLE_STEP;
+    double y = (dec + 90) / TARGET_TABLE_STEP;
+    int column = std::max(0, std::min(static_cast<int>(x), TARGET_TABLE_COLUMNS - 2));
+    int row = std::max(0, std::min(static_cast<int>(y), TARGET_TABLE_ROWS - 2));
+    double fx = x - column, fy = y - row;
+
+    const std::vector<float> &row0 = TargetTableRow(*table, row);
+    const std::vector<float> &row1 = TargetTableRow(*table, row + 1);
+    double az[4]  = { row0[2 * column], row0[2 * column + 2], row1[2 * column], row1[2 * column + 2] };
+    double alt[4] = { row0[2 * column + 1], row0[2 * column + 3], row1[2 * column + 1], row1[2 * column + 3] };
+
+    // Around the zenith of the optical center the azimuth changes too fast to be interpolated
+    double minCorner = az[0], maxCorner = az[0];
+    for (double &corner : az)
+    {
+        if (std::isnan(corner))
+            return false;
+        if (corner - az[0] > 180)
+            corner -= 360;
+        else if (corner - az[0] < -180)
+            corner += 360;
+        minCorner = std::min(minCorner, corner);
+        maxCorner = std::max(maxCorner, corner);
+    }
+    if (maxCorner - minCorner > TARGET_TABLE_MAX_SPREAD)
+        return false;
 
-        // Calculate the Azimuth range in the given Altitude of the dome
-        RadiusAtAlt = DomeMeasurementsNP[DM_DOME_RADIUS].getValue() * cos(M_PI * Alt / 180); // Radius at the given altitude
+    Az  = range360((az[0] * (1 - fx) + az[1] * fx) * (1 - fy) + (az[2] * (1 - fx) + az[3] * fx) * fy);
+    Alt = (alt[0] * (1 - fx) + alt[1] * fx) * (1 - fy) + (alt[2] * (1 - fx) + alt[3] * fx) * fy;
+    return true;
+}
 
-        if (DomeMeasurementsNP[DM_SHUTTER_WIDTH].getValue() < (2 * RadiusAtAlt))
-        {
-            HalfApertureChordAngle = 180 * asin(DomeMeasurementsNP[DM_SHUTTER_WIDTH].getValue() / (2 * RadiusAtAlt)) /
-                                     M_PI; // Angle of a chord of half aperture length
-            minAz = range360(Az - HalfApertureChordAngle); // Ensure range 0..360
-            maxAz = range360(Az + HalfApertureChordAngle); // Ensure range 0..360
-        }
-        else
-        {
-            minAz = 0;
-            maxAz = 360;
-        }
+const std::vector<float> &Dome::TargetTableRow(TargetTable &table, int row)
+{
+    std::vector<float> &values = table.rows[row];
+    if (!values.empty())
+        return values;
 
-        // Final Condensed Log
-        char currentAzStr[64], targetAzStr[64], targetAltStr[64], minAzStr[64], maxAzStr[64];
-        fs_sexa(currentAzStr, DomeAbsPosNP[0].getValue(), 2, 3600);
-        fs_sexa(targetAzStr, Az, 2, 3600);
-        fs_sexa(targetAltStr, Alt, 2, 3600);
-        fs_sexa(minAzStr, minAz, 2, 3600);
-        fs_sexa(maxAzStr, maxAz, 2, 3600);
-        LOGF_DEBUG("Result - Current Az:%s , Target Az: %s, Alt: %s --> Range Min: %s, Max: %s", currentAzStr, targetAzStr,
-                   targetAltStr, minAzStr, maxAzStr);
+    const double radius = table.geometry[0], otaOffset = table.geometry[4], latitude = table.geometry[5];
+    point3D MountCenter = { table.geometry[1], table.geometry[2], table.geometry[3] };
+    double dec = row * TARGET_TABLE_STEP - 90;
 
-        return true;
-    }
-    else
+    values.resize(2 * TARGET_TABLE_COLUMNS);
+    for (int column = 0; column < TARGET_TABLE_COLUMNS; column++)
     {
-        LOG_WARN("Optical axis does not intersect dome sphere.");
-        return false;
+        double hourAngle = (column * TARGET_TABLE_STEP - 180) / 15;
+        double mountAlt, mountAz, Az, Alt;
+        point3D OptCenter, OptVector, DomeIntersect;
+
+        get_alt_az_coordinates(hourAngle * 15, dec, latitude, &mountAlt, &mountAz);
+        OpticalCenter(MountCenter, otaOffset, latitude, hourAngle, OptCenter);
+        OpticalVector(mountAz, mountAlt, OptVector);
+        if (std::isnan(mountAz) || !DomeIntersection(OptCenter, OptVector, radius, DomeIntersect, Az, Alt))
+            Az = Alt = std::numeric_limits<double>::quiet_NaN();
+
+        values[2 * column]     = Az;
+        values[2 * column + 1] = Alt;
     }
+    return values;
 }
 
 bool Dome::Intersection(point3D p1, point3D dp, double r, double &mu1, double &mu2)
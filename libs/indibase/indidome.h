@@ -26,7 +26,9 @@
 #include "libastro.h"
 #include "inditimer.h"
 
+#include <array>
 #include <string>
+#include <vector>
 
 // Defines a point in a 3 dimension space
 typedef struct
@@ -471,6 +473,19 @@ class Dome : public DefaultDevice
              */
         bool Intersection(point3D p1, point3D p2, double r, double &mu1, double &mu2);
 
+        /**
+             * @brief DomeIntersection Point where the optical axis meets the dome sphere, and its azimuth and altitude.
+             * @param OptCenter optical center, from OpticalCenter
+             * @param OptVector optical axis direction, from OpticalVector
+             * @param radius dome radius
+             * @param DomeIntersect Returns the point on the dome
+             * @param Az Returns its azimuth in degrees
+             * @param Alt Returns its altitude in degrees
+             * @return Returns FALSE if the optical axis doesn't intersect the dome.
+             */
+        bool DomeIntersection(point3D OptCenter, point3D OptVector, double radius, point3D &DomeIntersect, double &Az,
+                              double &Alt);
+
         /**
              * @brief OpticalCenter This function calculates the distance from the optical axis to the Dome center
              * @param MountCenter Distance from the Dome center to the point where mount axis crosses
@@ -662,10 +677,38 @@ class Dome : public DefaultDevice
         double Axis1DefaultParkPosition;
 
         bool callHandshake();
+
+        // Side of the OTA with respect of the mount from the OTA side selection, 1: west, -1: east, 0: use the mid point
+        int GetOTASide(double hourAngle);
+        // minAz and maxAz of the shutter aperture at Az, Alt
+        void GetTargetAzRange(double Az, double Alt, double &minAz, double &maxAz);
+
+        /**
+         * Dome target of the optical axis over a grid of hour angle and declination, every TARGET_TABLE_STEP degrees,
+         * for the measurements, latitude and OTA offset it was computed with. Declination rows are filled on first use.
+         */
+        struct TargetTable
+        {
+            std::array<double, 6> geometry; // radius, east, north, up, OTA offset, latitude
+            std::vector<std::vector<float>> rows; // az, alt for each hour angle, NaN where the axis misses the dome
+        };
+        std::vector<TargetTable> m_TargetTables;
+        // Interpolated target, false where the table can't be trusted
+        bool LookupTargetAz(double hourAngle, double dec, double otaOffset, double &Az, double &Alt);
+        const std::vector<float> &TargetTableRow(TargetTable &table, int row);
         uint8_t domeConnection = CONNECTION_SERIAL | CONNECTION_TCP;
 
         // How often we update horizontal coordinates (10 seconds).
         static constexpr uint32_t HORZ_UPDATE_TIMER { 10000 };
+        // Near the celestial pole, the hour angle is unreliable to tell the pier side
+        static constexpr double POLE_THRESHOLD_DEC { 85.0 };
+        // Target table grid, in degrees. Cells whose corners are further apart in azimuth are computed exactly
+        static constexpr double TARGET_TABLE_STEP { 0.5 };
+        static constexpr double TARGET_TABLE_MAX_SPREAD { 2.0 };
+        static constexpr int TARGET_TABLE_COLUMNS { static_cast<int>(360 / TARGET_TABLE_STEP) + 1 };
+        static constexpr int TARGET_TABLE_ROWS { static_cast<int>(180 / TARGET_TABLE_STEP) + 1 };
+        // OTA west, east and mid point tables
+        static constexpr size_t TARGET_TABLE_COUNT { 3 };
 };
 
 }
@@ -29,7 +29,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 #include "base64.h"
 #include "indicom.h"
 #include "indidevapi.h"
+#include "indibasetypes.h"
 #include "locale_compat.h"
+#include "sharedblob.h"
 
 #include <errno.h>
 #include <pthread.h>
@@ -45,23 +47,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 #include "userio.h"
 #include "indiuserio.h"
 #include "indidriverio.h"
+#include "indidefcache.h"
+#include "indilazygroup.h"
+#include "indiprobes.h"
 
 int verbose;      /* chatty */
 char *me = "";  /* a.out name */
 
 #define MAXRBUF 2048
 
-/*! INDI property type */
-enum
-{
-INDI_NUMBER,
-INDI_SWITCH,
-INDI_TEXT,
-INDI_LIGHT,
-INDI_BLOB,
-INDI_UNKNOWN
-};
-
 extern void waitPingReply(const char *);
 
 // TODO use fast map
@@ -127,6 +121,9 @@ void IDDeleteVA(const char *dev, const char *name, const char *fmt, va_list ap)
     IUUserIODeleteVA(&io.userio, io.user, dev, name, fmt, ap);
 
     driverio_finish(&io);
+
+    defcache_remove(dev, name);
+    lazy_remove(dev, name);
 }
 
 void IDDelete(const char *dev, const char *name, const char *fmt, ...)
@@ -172,6 +169,25 @@ void IDSnoopBLOBs(const char *snooped_device, const char *snooped_property, BLOB
     }
 }
 
+/* turn the encoding='ieee754' values of a snooped setNumberVector back to text:
+ * ISSnoopDevice implementations read them with f_scansexa or atof.
+ */
+static void decodeSnoopedNumbers(XMLEle *root)
+{
+    locale_char_t *orig = indi_locale_C_numeric_push();
+    for (XMLEle *ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        double value;
+        char buf[64];
+        if (strcmp(tagXMLEle(ep), "oneNumber") || f_scanieee754(pcdataXMLEle(ep), &value) < 0)
+            continue;
+        snprintf(buf, sizeof(buf), "%.20g", value);
+        editXMLEle(ep, buf);
+    }
+    indi_locale_C_numeric_pop(orig);
+    rmXMLAtt(root, "encoding");
+}
+
 /* crack the given INDI XML element and call driver's IS* entry points as they
  *   are recognized.
  * return 0 if ok else -1 with reason in msg[].
@@ -205,6 +221,27 @@ int dispatch(XMLEle *root, char msg[])
             exit(1);
         }
 
+        /* indiserver reads setNumberVector values as IEEE 754 bits */
+        ap = findXMLAtt(root, "numbers");
+        if (ap && !strcmp(valuXMLAtt(ap), "ieee754"))
+            driverio_set_numbers_ieee754(1);
+
+        /* indiserver offers to attach the BLOBs it sends as buffers, accept once if they can be received */
+        ap = findXMLAtt(root, "blobs");
+        if (ap && !strcmp(valuXMLAtt(ap), "attached") && driverio_is_unix_socket())
+        {
+            static int accepted = 0;
+            if (!accepted)
+            {
+                driverio io;
+                driverio_init(&io);
+                userio_xmlv1(&io.userio, io.user);
+                userio_prints(&io.userio, io.user, "<enableBLOB attached='true'/>\n");
+                driverio_finish(&io);
+                accepted = 1;
+            }
+        }
+
         // Get device
         dev = findXMLAtt(root, "device");
 
@@ -213,6 +250,10 @@ int dispatch(XMLEle *root, char msg[])
 
         if (name && dev)
         {
+            /* a lazy group, or one of its properties, is defined as a whole */
+            if (lazy_request(valuXMLAtt(dev), valuXMLAtt(name), 1))
+                return 0;
+
             pthread_mutex_lock(&rosc_mutex);
             ROSC *prop = rosc_find(valuXMLAtt(name), valuXMLAtt(dev));
             // This is unsafe... prop may be modified concurrently here
@@ -248,10 +289,22 @@ int dispatch(XMLEle *root, char msg[])
             }
         }
 
+        lazy_reset(dev ? valuXMLAtt(dev) : NULL);
         ISGetProperties(dev ? valuXMLAtt(dev) : NULL);
         return (0);
     }
 
+    /* indiserver asks when the messages sent before are handled, its cache then holds their answers */
+    if (!strcmp(rtag, "pingRequest"))
+    {
+        driverio io;
+        driverio_init(&io);
+        userio_xmlv1(&io.userio, io.user);
+        IUUserIOPingReply(&io.userio, io.user, findXMLAttValu(root, "uid"));
+        driverio_finish(&io);
+        return 0;
+    }
+
     /* other commands might be from a snooped device.
          * we don't know here which devices are being snooped so we send
          * all remaining valid messages
@@ -261,6 +314,8 @@ int dispatch(XMLEle *root, char msg[])
             !strcmp(rtag, "defTextVector") || !strcmp(rtag, "defLightVector") || !strcmp(rtag, "defSwitchVector") ||
             !strcmp(rtag, "defBLOBVector") || !strcmp(rtag, "message") || !strcmp(rtag, "delProperty"))
     {
+        if (!strcmp(rtag, "setNumberVector") && !strcmp(findXMLAttValu(root, "encoding"), "ieee754"))
+            decodeSnoopedNumbers(root);
         ISSnoopDevice(root);
         return (0);
     }
@@ -270,6 +325,10 @@ int dispatch(XMLEle *root, char msg[])
     if (crackDN(root, &dev, &name, msg) < 0)
         return (-1);
 
+    /* the switch of a lazy group asks for its properties */
+    if (!strcmp(rtag, "newSwitchVector") && lazy_request(dev, name, 0))
+        return 0;
+
     pthread_mutex_lock(&rosc_mutex);
     if (rosc_find(name, dev) == NULL)
     {
@@ -430,8 +489,7 @@ int dispatch(XMLEle *root, char msg[])
         static int *sizes = NULL;
         static int maxn = 0;
 
-        // FIXME: shared blob not supported here
-        /* pull out each name/BLOB pair, decode */
+        /* pull out each name/BLOB pair, decoded while reading, attached, or still base64 */
         for (n = 0, ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
         {
             if (strcmp(tagXMLEle(ep), "oneBLOB") == 0)
@@ -451,13 +509,19 @@ int dispatch(XMLEle *root, char msg[])
                         assert_mem(sizes = (int *)realloc(sizes, maxn * sizeof *sizes));
                         assert_mem(blobsizes = (int *)realloc(blobsizes, maxn * sizeof *blobsizes));
                     }
-                    // FIXME : here decode using shared buffer
-                    int bloblen = pcdatalenXMLEle(ep);
-                    // enclen is optional and not required by INDI protocol
-                    if (el)
-                        bloblen = atoi(valuXMLAtt(el));
-                    assert_mem(blobs[n] = (char*)malloc(3 * bloblen / 4));
-                    blobsizes[n] = from64tobits_fast(blobs[n], pcdataXMLEle(ep), bloblen);
+                    size_t decoded;
+                    blobs[n] = (char *)takeBlobXMLEle(ep, &decoded);
+                    if (blobs[n])
+                        blobsizes[n] = (int)decoded;
+                    else
+                    {
+                        int bloblen = pcdatalenXMLEle(ep);
+                        // enclen is optional and not required by INDI protocol
+                        if (el)
+                            bloblen = atoi(valuXMLAtt(el));
+                        assert_mem(blobs[n] = (char*)malloc(3 * bloblen / 4));
+                        blobsizes[n] = from64tobits_fast(blobs[n], pcdataXMLEle(ep), bloblen);
+                    }
                     names[n]     = valuXMLAtt(na);
                     formats[n]   = valuXMLAtt(fa);
                     sizes[n]     = atoi(valuXMLAtt(sa));
@@ -471,7 +535,7 @@ int dispatch(XMLEle *root, char msg[])
         {
             ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, n);
             for (int i = 0; i < n; i++)
-                free(blobs[i]);
+                IDSharedBlobFree(blobs[i]);
         }
         else
             IDMessage(dev, "[ERROR] %s: newBLOBVector with no valid members", name);
@@ -482,39 +546,181 @@ int dispatch(XMLEle *root, char msg[])
     return (1);
 }
 
-int IUReadConfig(const char *filename, const char *dev, const char *property, int silent, char errmsg[])
+/* Parsed config files, so the IUGetConfig* family doesn't reread the whole file on every call.
+ * An entry is reused while the file on disk is unchanged, and is dropped when the driver opens it for writing. */
+typedef struct ConfigCache
 {
-    char *rname, *rdev;
-    XMLEle *root = NULL, *fproot = NULL;
-    LilXML *lp = newLilXML();
+    char path[MAXRBUF];
+    XMLEle *root;
+    time_t mtime;
+    off_t size;
+    ino_t ino;
+    struct ConfigCache *next;
+} ConfigCache;
 
-    FILE *fp = IUGetConfigFP(filename, dev, "r", errmsg);
+static pthread_mutex_t config_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static ConfigCache *configCache = NULL;
+static XMLEle *configUncached = NULL;
 
+void IUGetConfigFileName(const char *filename, const char *dev, char configFileName[])
+{
+    if (filename)
+        snprintf(configFileName, MAXRBUF, "%s", filename);
+    else if (getenv("INDICONFIG"))
+        snprintf(configFileName, MAXRBUF, "%s", getenv("INDICONFIG"));
+    else
+        snprintf(configFileName, MAXRBUF, "%s/.indi/%s_config.xml", getenv("HOME"), dev);
+}
+
+/* Drop the cached tree of path, or of every file if path is NULL. Caller holds config_mutex. */
+static void configInvalidateLocked(const char *path)
+{
+    ConfigCache **link = &configCache;
+    while (*link != NULL)
+    {
+        ConfigCache *entry = *link;
+        if (path == NULL || !strcmp(entry->path, path))
+        {
+            *link = entry->next;
+            delXMLEle(entry->root);
+            free(entry);
+        }
+        else
+            link = &entry->next;
+    }
+}
+
+static void configInvalidate(const char *path)
+{
+    pthread_mutex_lock(&config_mutex);
+    configInvalidateLocked(path);
+    pthread_mutex_unlock(&config_mutex);
+}
+
+/* Return the parsed config of dev with config_mutex held, or NULL with the lock released.
+ * nextXMLEle() keeps its cursor in the tree, so the tree is only walked while the lock is held. */
+static XMLEle *configAcquire(const char *filename, const char *dev, char errmsg[])
+{
+    char configFileName[MAXRBUF];
+    struct stat st;
+    ConfigCache *entry;
+
+    IUGetConfigFileName(filename, dev, configFileName);
+
+    pthread_mutex_lock(&config_mutex);
+
+    for (entry = configCache; entry != NULL; entry = entry->next)
+        if (!strcmp(entry->path, configFileName))
+            break;
+
+    if (entry != NULL)
+    {
+        if (stat(configFileName, &st) == 0 && st.st_mtime == entry->mtime && st.st_size == entry->size &&
+                st.st_ino == entry->ino)
+            return entry->root;
+        configInvalidateLocked(configFileName);
+    }
+
+    FILE *fp = IUGetConfigFP(filename, dev, "r", errmsg);
     if (fp == NULL)
-        return -1;
+    {
+        pthread_mutex_unlock(&config_mutex);
+        return NULL;
+    }
 
     char whynot[MAXRBUF];
-    fproot = readXMLFile(fp, lp, whynot);
-
+    LilXML *lp = newLilXML();
+    XMLEle *fproot = readXMLFile(fp, lp, whynot);
     delLilXML(lp);
 
     if (fproot == NULL)
     {
         snprintf(errmsg, MAXRBUF, "Unable to parse config XML: %s", whynot);
         fclose(fp);
-        return -1;
+        pthread_mutex_unlock(&config_mutex);
+        return NULL;
     }
 
-    if (nXMLEle(fproot) > 0 && silent != 1)
-        IDMessage(dev, "[INFO] Loading device configuration...");
+    if (fstat(fileno(fp), &st) == 0)
+    {
+        assert_mem(entry = (ConfigCache *)calloc(1, sizeof *entry));
+        strcpy(entry->path, configFileName);
+        entry->root  = fproot;
+        entry->mtime = st.st_mtime;
+        entry->size  = st.st_size;
+        entry->ino   = st.st_ino;
+        entry->next  = configCache;
+        configCache  = entry;
+    }
+    else
+    {
+        /* can't tell when it changes, keep it only until configRelease() */
+        configUncached = fproot;
+    }
+
+    fclose(fp);
+    return fproot;
+}
+
+static void configRelease()
+{
+    if (configUncached != NULL)
+    {
+        delXMLEle(configUncached);
+        configUncached = NULL;
+    }
+
+    pthread_mutex_unlock(&config_mutex);
+}
+
+/* Find property of dev in a parsed config, or the first property of dev if property is NULL. */
+static XMLEle *configFindProperty(XMLEle *fproot, const char *dev, const char *property, char errmsg[])
+{
+    char *rname, *rdev;
+    XMLEle *root = NULL;
+
+    for (root = nextXMLEle(fproot, 1); root != NULL; root = nextXMLEle(fproot, 0))
+    {
+        /* pull out device and name */
+        if (crackDN(root, &rdev, &rname, errmsg) < 0)
+            return NULL;
+
+        // It doesn't belong to our device??
+        if (strcmp(dev, rdev))
+            continue;
+
+        if ((property && !strcmp(property, rname)) || property == NULL)
+            return root;
+    }
+
+    return NULL;
+}
+
+int IUReadConfig(const char *filename, const char *dev, const char *property, int silent, char errmsg[])
+{
+    char *rname, *rdev;
+    XMLEle *root = NULL, *fproot = NULL;
+    XMLEle **matches = NULL;
+    int nmatches = 0;
+
+    fproot = configAcquire(filename, dev, errmsg);
 
+    if (fproot == NULL)
+        return -1;
+
+    int nelements = nXMLEle(fproot);
+
+    /* dispatch works on copies, handlers may save or read the config again */
     for (root = nextXMLEle(fproot, 1); root != NULL; root = nextXMLEle(fproot, 0))
     {
         /* pull out device and name */
         if (crackDN(root, &rdev, &rname, errmsg) < 0)
         {
-            fclose(fp);
-            delXMLEle(fproot);
+            configRelease();
+            while (nmatches > 0)
+                delXMLEle(matches[--nmatches]);
+            free(matches);
             return -1;
         }
 
@@ -524,17 +730,27 @@ int IUReadConfig(const char *filename, const char *dev, const char *property, in
 
         if ((property && !strcmp(property, rname)) || property == NULL)
         {
-            dispatch(root, errmsg);
+            assert_mem(matches = (XMLEle **)realloc(matches, (nmatches + 1) * sizeof *matches));
+            matches[nmatches++] = cloneXMLEle(root, NULL, NULL);
             if (property)
                 break;
         }
     }
 
-    if (nXMLEle(fproot) > 0 && silent != 1)
-        IDMessage(dev, "[INFO] Device configuration applied.");
+    configRelease();
 
-    fclose(fp);
-    delXMLEle(fproot);
+    if (nelements > 0 && silent != 1)
+        IDMessage(dev, "[INFO] Loading device configuration...");
+
+    for (int i = 0; i < nmatches; i++)
+    {
+        dispatch(matches[i], errmsg);
+        delXMLEle(matches[i]);
+    }
+    free(matches);
+
+    if (nelements > 0 && silent != 1)
+        IDMessage(dev, "[INFO] Device configuration applied.");
 
     return (0);
 }
@@ -591,379 +807,199 @@ int IUSaveDefaultConfig(const char *source_config, const char *dest_config, cons
 
 int IUGetConfigOnSwitch(const ISwitchVectorProperty *property, int *index)
 {
-    char *rname, *rdev;
     XMLEle *root = NULL, *fproot = NULL;
     char errmsg[MAXRBUF];
-    LilXML *lp = newLilXML();
     int propertyFound = 0;
     *index = -1;
 
-    FILE *fp = IUGetConfigFP(NULL, property->device, "r", errmsg);
-
-    if (fp == NULL)
-    {
-        delLilXML(lp);
-        return -1;
-    }
-
-    fproot = readXMLFile(fp, lp, errmsg);
+    fproot = configAcquire(NULL, property->device, errmsg);
 
     if (fproot == NULL)
-    {
-        delLilXML(lp);
-        fclose(fp);
         return -1;
-    }
 
-    for (root = nextXMLEle(fproot, 1); root != NULL; root = nextXMLEle(fproot, 0))
-    {
-        /* pull out device and name */
-        if (crackDN(root, &rdev, &rname, errmsg) < 0)
-        {
-            fclose(fp);
-            delXMLEle(fproot);
-            return -1;
-        }
-
-        // It doesn't belong to our device??
-        if (strcmp(property->device, rdev))
-            continue;
+    root = configFindProperty(fproot, property->device, property->name, errmsg);
 
-        if (!strcmp(property->name, rname))
+    if (root != NULL)
+    {
+        propertyFound = 1;
+        XMLEle *oneSwitch = NULL;
+        int oneSwitchIndex = 0;
+        ISState oneSwitchState;
+        for (oneSwitch = nextXMLEle(root, 1); oneSwitch != NULL; oneSwitch = nextXMLEle(root, 0), oneSwitchIndex++)
         {
-            propertyFound = 1;
-            XMLEle *oneSwitch = NULL;
-            int oneSwitchIndex = 0;
-            ISState oneSwitchState;
-            for (oneSwitch = nextXMLEle(root, 1); oneSwitch != NULL; oneSwitch = nextXMLEle(root, 0), oneSwitchIndex++)
+            if (crackISState(pcdataXMLEle(oneSwitch), &oneSwitchState) == 0 && oneSwitchState == ISS_ON)
             {
-                if (crackISState(pcdataXMLEle(oneSwitch), &oneSwitchState) == 0 && oneSwitchState == ISS_ON)
-                {
-                    *index = oneSwitchIndex;
-                    break;
-                }
+                *index = oneSwitchIndex;
+                break;
             }
-            break;
         }
     }
 
-    fclose(fp);
-    delXMLEle(fproot);
-    delLilXML(lp);
+    configRelease();
 
     return (propertyFound ? 0 : -1);
 }
 
 int IUGetConfigSwitch(const char *dev, const char *property, const char *member, ISState *value)
 {
-    char *rname, *rdev;
     XMLEle *root = NULL, *fproot = NULL;
     char errmsg[MAXRBUF];
-    LilXML *lp = newLilXML();
     int valueFound = 0;
 
-    FILE *fp = IUGetConfigFP(NULL, dev, "r", errmsg);
-
-    if (fp == NULL)
-    {
-        delLilXML(lp);
-        return -1;
-    }
-
-    fproot = readXMLFile(fp, lp, errmsg);
+    fproot = configAcquire(NULL, dev, errmsg);
 
     if (fproot == NULL)
-    {
-        fclose(fp);
-        delLilXML(lp);
         return -1;
-    }
-
-    for (root = nextXMLEle(fproot, 1); root != NULL; root = nextXMLEle(fproot, 0))
-    {
-        /* pull out device and name */
-        if (crackDN(root, &rdev, &rname, errmsg) < 0)
-        {
-            fclose(fp);
-            delXMLEle(fproot);
-            return -1;
-        }
 
-        // It doesn't belong to our device??
-        if (strcmp(dev, rdev))
-            continue;
+    root = configFindProperty(fproot, dev, property, errmsg);
 
-        if ((property && !strcmp(property, rname)) || property == NULL)
+    if (root != NULL)
+    {
+        XMLEle *oneSwitch = NULL;
+        for (oneSwitch = nextXMLEle(root, 1); oneSwitch != NULL; oneSwitch = nextXMLEle(root, 0))
         {
-            XMLEle *oneSwitch = NULL;
-            for (oneSwitch = nextXMLEle(root, 1); oneSwitch != NULL; oneSwitch = nextXMLEle(root, 0))
+            if (!strcmp(member, findXMLAttValu(oneSwitch, "name")))
             {
-                if (!strcmp(member, findXMLAttValu(oneSwitch, "name")))
-                {
-                    if (crackISState(pcdataXMLEle(oneSwitch), value) == 0)
-                        valueFound = 1;
-                    break;
-                }
+                if (crackISState(pcdataXMLEle(oneSwitch), value) == 0)
+                    valueFound = 1;
+                break;
             }
-            break;
         }
     }
 
-    fclose(fp);
-    delXMLEle(fproot);
-    delLilXML(lp);
+    configRelease();
 
     return (valueFound == 1 ? 0 : -1);
 }
 
 int IUGetConfigOnSwitchIndex(const char *dev, const char *property, int *index)
 {
-    char *rname, *rdev;
     XMLEle *root = NULL, *fproot = NULL;
     char errmsg[MAXRBUF];
-    LilXML *lp = newLilXML();
     int valueFound = 0;
 
-    FILE *fp = IUGetConfigFP(NULL, dev, "r", errmsg);
-
-    if (fp == NULL)
-    {
-        delLilXML(lp);
-        return -1;
-    }
-
-    fproot = readXMLFile(fp, lp, errmsg);
+    fproot = configAcquire(NULL, dev, errmsg);
 
     if (fproot == NULL)
-    {
-        delLilXML(lp);
-        fclose(fp);
         return -1;
-    }
 
-    for (root = nextXMLEle(fproot, 1); root != NULL; root = nextXMLEle(fproot, 0))
-    {
-        /* pull out device and name */
-        if (crackDN(root, &rdev, &rname, errmsg) < 0)
-        {
-            fclose(fp);
-            delXMLEle(fproot);
-            return -1;
-        }
-
-        // It doesn't belong to our device??
-        if (strcmp(dev, rdev))
-            continue;
+    root = configFindProperty(fproot, dev, property, errmsg);
 
-        if ((property && !strcmp(property, rname)) || property == NULL)
+    if (root != NULL)
+    {
+        XMLEle *oneSwitch = NULL;
+        int currentIndex = 0;
+        for (oneSwitch = nextXMLEle(root, 1); oneSwitch != NULL; oneSwitch = nextXMLEle(root, 0), currentIndex++)
         {
-            XMLEle *oneSwitch = NULL;
-            int currentIndex = 0;
-            for (oneSwitch = nextXMLEle(root, 1); oneSwitch != NULL; oneSwitch = nextXMLEle(root, 0), currentIndex++)
+            ISState s = ISS_OFF;
+            if (crackISState(pcdataXMLEle(oneSwitch), &s) == 0 && s == ISS_ON)
             {
-                ISState s = ISS_OFF;
-                if (crackISState(pcdataXMLEle(oneSwitch), &s) == 0 && s == ISS_ON)
-                {
-                    *index = currentIndex;
-                    valueFound = 1;
-                    break;
-                }
+                *index = currentIndex;
+                valueFound = 1;
+                break;
             }
-            break;
         }
     }
 
-    fclose(fp);
-    delXMLEle(fproot);
-    delLilXML(lp);
+    configRelease();
 
     return (valueFound == 1 ? 0 : -1);
 }
 
 int IUGetConfigOnSwitchName(const char *dev, const char *property, char *name, size_t size)
 {
-    char *rname, *rdev;
     XMLEle *root = NULL, *fproot = NULL;
     char errmsg[MAXRBUF];
-    LilXML *lp = newLilXML();
     int found = -1;
 
-    FILE *fp = IUGetConfigFP(NULL, dev, "r", errmsg);
-
-    if (fp == NULL)
-    {
-        delLilXML(lp);
-        return -1;
-    }
-
-    fproot = readXMLFile(fp, lp, errmsg);
+    fproot = configAcquire(NULL, dev, errmsg);
 
     if (fproot == NULL)
-    {
-        delLilXML(lp);
-        fclose(fp);
         return -1;
-    }
 
-    for (root = nextXMLEle(fproot, 1); root != NULL; root = nextXMLEle(fproot, 0))
-    {
-        /* pull out device and name */
-        if (crackDN(root, &rdev, &rname, errmsg) < 0)
-        {
-            fclose(fp);
-            delXMLEle(fproot);
-            return -1;
-        }
+    root = configFindProperty(fproot, dev, property, errmsg);
 
-        // It doesn't belong to our device??
-        if (strcmp(dev, rdev))
-            continue;
-
-        if ((property && !strcmp(property, rname)) || property == NULL)
+    if (root != NULL)
+    {
+        XMLEle *oneSwitch = NULL;
+        int currentIndex = 0;
+        for (oneSwitch = nextXMLEle(root, 1); oneSwitch != NULL; oneSwitch = nextXMLEle(root, 0), currentIndex++)
         {
-            XMLEle *oneSwitch = NULL;
-            int currentIndex = 0;
-            for (oneSwitch = nextXMLEle(root, 1); oneSwitch != NULL; oneSwitch = nextXMLEle(root, 0), currentIndex++)
+            ISState s = ISS_OFF;
+            if (crackISState(pcdataXMLEle(oneSwitch), &s) == 0 && s == ISS_ON)
             {
-                ISState s = ISS_OFF;
-                if (crackISState(pcdataXMLEle(oneSwitch), &s) == 0 && s == ISS_ON)
-                {
-                    found = 0;
-                    strncpy(name, findXMLAttValu(oneSwitch, "name"), size);
-                    break;
-                }
+                found = 0;
+                strncpy(name, findXMLAttValu(oneSwitch, "name"), size);
+                break;
             }
-            break;
         }
     }
 
-    fclose(fp);
-    delXMLEle(fproot);
-    delLilXML(lp);
+    configRelease();
 
     return found;
 }
 
 int IUGetConfigNumber(const char *dev, const char *property, const char *member, double *value)
 {
-    char *rname, *rdev;
     XMLEle *root = NULL, *fproot = NULL;
     char errmsg[MAXRBUF];
-    LilXML *lp = newLilXML();
     int valueFound = 0;
 
-    FILE *fp = IUGetConfigFP(NULL, dev, "r", errmsg);
-
-    if (fp == NULL)
-    {
-        delLilXML(lp);
-        return -1;
-    }
-
-    fproot = readXMLFile(fp, lp, errmsg);
+    fproot = configAcquire(NULL, dev, errmsg);
 
     if (fproot == NULL)
-    {
-        fclose(fp);
-        delLilXML(lp);
         return -1;
-    }
-
-    for (root = nextXMLEle(fproot, 1); root != NULL; root = nextXMLEle(fproot, 0))
-    {
-        /* pull out device and name */
-        if (crackDN(root, &rdev, &rname, errmsg) < 0)
-        {
-            fclose(fp);
-            delXMLEle(fproot);
-            return -1;
-        }
 
-        // It doesn't belong to our device??
-        if (strcmp(dev, rdev))
-            continue;
+    root = configFindProperty(fproot, dev, property, errmsg);
 
-        if ((property && !strcmp(property, rname)) || property == NULL)
+    if (root != NULL)
+    {
+        XMLEle *oneNumber = NULL;
+        for (oneNumber = nextXMLEle(root, 1); oneNumber != NULL; oneNumber = nextXMLEle(root, 0))
         {
-            XMLEle *oneNumber = NULL;
-            for (oneNumber = nextXMLEle(root, 1); oneNumber != NULL; oneNumber = nextXMLEle(root, 0))
+            if (!strcmp(member, findXMLAttValu(oneNumber, "name")))
             {
-                if (!strcmp(member, findXMLAttValu(oneNumber, "name")))
-                {
-                    *value = atof(pcdataXMLEle(oneNumber));
-                    valueFound = 1;
-                    break;
-                }
+                *value = atof(pcdataXMLEle(oneNumber));
+                valueFound = 1;
+                break;
             }
-            break;
         }
     }
 
-    fclose(fp);
-    delXMLEle(fproot);
-    delLilXML(lp);
+    configRelease();
 
     return (valueFound == 1 ? 0 : -1);
 }
 
 int IUGetConfigText(const char *dev, const char *property, const char *member, char *value, int len)
 {
-    char *rname, *rdev;
     XMLEle *root = NULL, *fproot = NULL;
     char errmsg[MAXRBUF];
-    LilXML *lp = newLilXML();
     int valueFound = 0;
 
-    FILE *fp = IUGetConfigFP(NULL, dev, "r", errmsg);
-
-    if (fp == NULL)
-    {
-        delLilXML(lp);
-        return -1;
-    }
-
-    fproot = readXMLFile(fp, lp, errmsg);
+    fproot = configAcquire(NULL, dev, errmsg);
 
     if (fproot == NULL)
-    {
-        delLilXML(lp);
-        fclose(fp);
         return -1;
-    }
-
-    for (root = nextXMLEle(fproot, 1); root != NULL; root = nextXMLEle(fproot, 0))
-    {
-        /* pull out device and name */
-        if (crackDN(root, &rdev, &rname, errmsg) < 0)
-        {
-            fclose(fp);
-            delXMLEle(fproot);
-            return -1;
-        }
 
-        // It doesn't belong to our device??
-        if (strcmp(dev, rdev))
-            continue;
+    root = configFindProperty(fproot, dev, property, errmsg);
 
-        if ((property && !strcmp(property, rname)) || property == NULL)
+    if (root != NULL)
+    {
+        XMLEle *oneText = NULL;
+        for (oneText = nextXMLEle(root, 1); oneText != NULL; oneText = nextXMLEle(root, 0))
         {
-            XMLEle *oneText = NULL;
-            for (oneText = nextXMLEle(root, 1); oneText != NULL; oneText = nextXMLEle(root, 0))
+            if (!strcmp(member, findXMLAttValu(oneText, "name")))
             {
-                if (!strcmp(member, findXMLAttValu(oneText, "name")))
-                {
-                    strncpy(value, pcdataXMLEle(oneText), len);
-                    valueFound = 1;
-                    break;
-                }
+                strncpy(value, pcdataXMLEle(oneText), len);
+                valueFound = 1;
+                break;
             }
-            break;
         }
     }
 
-    fclose(fp);
-    delXMLEle(fproot);
-    delLilXML(lp);
+    configRelease();
 
     return (valueFound == 1 ? 0 : -1);
 }
@@ -992,19 +1028,9 @@ void IDMessage(const char *dev, const char *fmt, ...)
 int IUPurgeConfig(const char *filename, const char *dev, char errmsg[])
 {
     char configFileName[MAXRBUF];
-    char configDir[MAXRBUF];
 
-    snprintf(configDir, MAXRBUF, "%s/.indi/", getenv("HOME"));
-
-    if (filename)
-        strncpy(configFileName, filename, MAXRBUF);
-    else
-    {
-        if (getenv("INDICONFIG"))
-            strncpy(configFileName, getenv("INDICONFIG"), MAXRBUF);
-        else
-            snprintf(configFileName, MAXRBUF, "%s%s_config.xml", configDir, dev);
-    }
+    IUGetConfigFileName(filename, dev, configFileName);
+    configInvalidate(configFileName);
 
     if (remove(configFileName) != 0)
     {
@@ -1024,15 +1050,11 @@ FILE *IUGetConfigFP(const char *filename, const char *dev, const char *mode, cha
 
     snprintf(configDir, MAXRBUF, "%s/.indi/", getenv("HOME"));
 
-    if (filename)
-        strncpy(configFileName, filename, MAXRBUF);
-    else
-    {
-        if (getenv("INDICONFIG"))
-            strncpy(configFileName, getenv("INDICONFIG"), MAXRBUF);
-        else
-            snprintf(configFileName, MAXRBUF, "%s%s_config.xml", configDir, dev);
-    }
+    IUGetConfigFileName(filename, dev, configFileName);
+
+    /* the driver is about to rewrite it, drop the parsed copy */
+    if (strcmp(mode, "r"))
+        configInvalidate(configFileName);
 
     if (stat(configDir, &st) != 0)
     {
@@ -1089,11 +1111,17 @@ void IUSaveConfigTag(FILE *fp, int ctag, const char *dev, int silent)
 /* tell client to create a text vector property */
 void IDDefTextVA(const ITextVectorProperty *tvp, const char *fmt, va_list ap)
 {
+    if (lazy_withhold(tvp->device, tvp->name, tvp->group, tvp, INDI_TEXT))
+        return;
+
     driverio io;
     driverio_init(&io);
 
     userio_xmlv1(&io.userio, io.user);
-    IUUserIODefTextVA(&io.userio, io.user, tvp, fmt, ap);
+    if (fmt == NULL)
+        defcache_text(&io.userio, io.user, tvp);
+    else
+        IUUserIODefTextVA(&io.userio, io.user, tvp, fmt, ap);
 
     driverio_finish(&io);
 
@@ -1113,11 +1141,17 @@ void IDDefText(const ITextVectorProperty *tvp, const char *fmt, ...)
 /* tell client to create a new numeric vector property */
 void IDDefNumberVA(const INumberVectorProperty *nvp, const char *fmt, va_list ap)
 {
+    if (lazy_withhold(nvp->device, nvp->name, nvp->group, nvp, INDI_NUMBER))
+        return;
+
     driverio io;
     driverio_init(&io);
 
     userio_xmlv1(&io.userio, io.user);
-    IUUserIODefNumberVA(&io.userio, io.user, nvp, fmt, ap);
+    if (fmt == NULL)
+        defcache_number(&io.userio, io.user, nvp);
+    else
+        IUUserIODefNumberVA(&io.userio, io.user, nvp, fmt, ap);
 
     driverio_finish(&io);
 
@@ -1136,11 +1170,17 @@ void IDDefNumber(const INumberVectorProperty *nvp, const char *fmt, ...)
 /* tell client to create a new switch vector property */
 void IDDefSwitchVA(const ISwitchVectorProperty *svp, const char *fmt, va_list ap)
 {
+    if (lazy_withhold(svp->device, svp->name, svp->group, svp, INDI_SWITCH))
+        return;
+
     driverio io;
     driverio_init(&io);
 
     userio_xmlv1(&io.userio, io.user);
-    IUUserIODefSwitchVA(&io.userio, io.user, svp, fmt, ap);
+    if (fmt == NULL)
+        defcache_switch(&io.userio, io.user, svp);
+    else
+        IUUserIODefSwitchVA(&io.userio, io.user, svp, fmt, ap);
 
     driverio_finish(&io);
 
@@ -1159,11 +1199,17 @@ void IDDefSwitch(const ISwitchVectorProperty *svp, const char *fmt, ...)
 /* tell client to create a new lights vector property */
 void IDDefLightVA(const ILightVectorProperty *lvp, const char *fmt, va_list ap)
 {
+    if (lazy_withhold(lvp->device, lvp->name, lvp->group, lvp, INDI_LIGHT))
+        return;
+
     driverio io;
     driverio_init(&io);
 
     userio_xmlv1(&io.userio, io.user);
-    IUUserIODefLightVA(&io.userio, io.user, lvp, fmt, ap);
+    if (fmt == NULL)
+        defcache_light(&io.userio, io.user, lvp);
+    else
+        IUUserIODefLightVA(&io.userio, io.user, lvp, fmt, ap);
 
     driverio_finish(&io);
 }
@@ -1179,11 +1225,17 @@ void IDDefLight(const ILightVectorProperty *lvp, const char *fmt, ...)
 /* tell client to create a new BLOB vector property */
 void IDDefBLOBVA(const IBLOBVectorProperty *bvp, const char *fmt, va_list ap)
 {
+    if (lazy_withhold(bvp->device, bvp->name, bvp->group, bvp, INDI_BLOB))
+        return;
+
     driverio io;
     driverio_init(&io);
 
     userio_xmlv1(&io.userio, io.user);
-    IUUserIODefBLOBVA(&io.userio, io.user, bvp, fmt, ap);
+    if (fmt == NULL)
+        defcache_blob(&io.userio, io.user, bvp);
+    else
+        IUUserIODefBLOBVA(&io.userio, io.user, bvp, fmt, ap);
 
     driverio_finish(&io);
 
@@ -1203,6 +1255,9 @@ void IDDefBLOB(const IBLOBVectorProperty *bvp, const char *fmt, ...)
 /* tell client to update an existing text vector property */
 void IDSetTextVA(const ITextVectorProperty *tvp, const char *fmt, va_list ap)
 {
+    if (lazy_withheld(tvp->device, tvp->name))
+        return;
+
     driverio io;
     driverio_init(&io);
 
@@ -1223,11 +1278,17 @@ void IDSetText(const ITextVectorProperty *tvp, const char *fmt, ...)
 /* tell client to update an existing numeric vector property */
 void IDSetNumberVA(const INumberVectorProperty *nvp, const char *fmt, va_list ap)
 {
+    if (lazy_withheld(nvp->device, nvp->name))
+        return;
+
     driverio io;
     driverio_init(&io);
 
     userio_xmlv1(&io.userio, io.user);
-    IUUserIOSetNumberVA(&io.userio, io.user, nvp, fmt, ap);
+    if (driverio_numbers_ieee754())
+        IUUserIOSetNumberIEEE754VA(&io.userio, io.user, nvp, fmt, ap);
+    else
+        IUUserIOSetNumberVA(&io.userio, io.user, nvp, fmt, ap);
 
     driverio_finish(&io);
 }
@@ -1243,6 +1304,9 @@ void IDSetNumber(const INumberVectorProperty *nvp, const char *fmt, ...)
 /* tell client to update an existing switch vector property */
 void IDSetSwitchVA(const ISwitchVectorProperty *svp, const char *fmt, va_list ap)
 {
+    if (lazy_withheld(svp->device, svp->name))
+        return;
+
     driverio io;
     driverio_init(&io);
 
@@ -1263,6 +1327,9 @@ void IDSetSwitch(const ISwitchVectorProperty *svp, const char *fmt, ...)
 /* tell client to update an existing lights vector property */
 void IDSetLightVA(const ILightVectorProperty *lvp, const char *fmt, va_list ap)
 {
+    if (lazy_withheld(lvp->device, lvp->name))
+        return;
+
     driverio io;
     driverio_init(&io);
 
@@ -1283,9 +1350,23 @@ void IDSetLight(const ILightVectorProperty *lvp, const char *fmt, ...)
 static long lastBlobPingUid = 0;
 #define BLOB_PING_PATTERN "SetBLOB/%ld"
 
+/* Bytes of the BLOBs of a vector, for the blob_set probe */
+static inline size_t blob_bytes(const IBLOBVectorProperty *bvp)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < bvp->nbp; i++)
+        bytes += bvp->bp[i].bloblen;
+    return bytes;
+}
+
 /* tell client to update an existing BLOB vector property */
 void IDSetBLOBVA(const IBLOBVectorProperty *bvp, const char *fmt, va_list ap)
 {
+    if (lazy_withheld(bvp->device, bvp->name))
+        return;
+
+    INDI_PROBE3(blob_set, bvp->device, bvp->name, blob_bytes(bvp));
+
     char buffer[64];
 
     // Wait for ack of previous blob if any
@@ -1342,19 +1423,23 @@ int IUUpdateSwitch(ISwitchVectorProperty *svp, ISState *states, char *names[], i
         IUResetSwitch(svp);
     }
 
+    int *indexes;
+    assert_mem(indexes = (int *)malloc((n > 0 ? n : 1) * sizeof(*indexes)));
+    IUFindMemberIndexes(svp->sp, sizeof(*svp->sp), svp->nsp, names, n, indexes);
+
     for (int i = 0; i < n; i++)
     {
-        ISwitch *sp = IUFindSwitch(svp, names[i]);
-
-        if (!sp)
+        if (indexes[i] < 0)
         {
+            free(indexes);
             svp->s = IPS_IDLE;
             IDSetSwitch(svp, "Error: %s is not a member of %s (%s) property.", names[i], svp->label, svp->name);
             return -1;
         }
 
-        sp->s = states[i];
+        svp->sp[indexes[i]].s = states[i];
     }
+    free(indexes);
 
     /* Consistency checks for ISR_1OFMANY after update. */
     if (svp->r == ISR_1OFMANY)
@@ -1387,18 +1472,24 @@ int IUUpdateNumber(INumberVectorProperty *nvp, double values[], char *names[], i
 {
     assert(nvp != NULL && "IUUpdateNumber NVP is NULL");
 
+    int *indexes;
+    assert_mem(indexes = (int *)malloc((n > 0 ? n : 1) * sizeof(*indexes)));
+    IUFindMemberIndexes(nvp->np, sizeof(*nvp->np), nvp->nnp, names, n, indexes);
+
     for (int i = 0; i < n; i++)
     {
-        INumber *np = IUFindNumber(nvp, names[i]);
-        if (!np)
+        if (indexes[i] < 0)
         {
+            free(indexes);
             nvp->s = IPS_IDLE;
             IDSetNumber(nvp, "Error: %s is not a member of %s (%s) property.", names[i], nvp->label, nvp->name);
             return -1;
         }
 
+        INumber *np = &nvp->np[indexes[i]];
         if (values[i] < np->min || values[i] > np->max)
         {
+            free(indexes);
             nvp->s = IPS_ALERT;
             IDSetNumber(nvp, "Error: Invalid range for %s (%s). Valid range is from %g to %g. Requested value is %g",
                         np->label, np->name, np->min, np->max, values[i]);
@@ -1408,11 +1499,9 @@ int IUUpdateNumber(INumberVectorProperty *nvp, double values[], char *names[], i
 
     /* First loop checks for error, second loop set all values atomically*/
     for (int i = 0; i < n; i++)
-    {
-        INumber *np = IUFindNumber(nvp, names[i]);
-        np->value = values[i];
-    }
+        nvp->np[indexes[i]].value = values[i];
 
+    free(indexes);
     return 0;
 }
 
@@ -1421,11 +1510,15 @@ int IUUpdateText(ITextVectorProperty *tvp, char *texts[], char *names[], int n)
 {
     assert(tvp != NULL && "IUUpdateText TVP is NULL");
 
+    int *indexes;
+    assert_mem(indexes = (int *)malloc((n > 0 ? n : 1) * sizeof(*indexes)));
+    IUFindMemberIndexes(tvp->tp, sizeof(*tvp->tp), tvp->ntp, names, n, indexes);
+
     for (int i = 0; i < n; i++)
     {
-        IText *tp = IUFindText(tvp, names[i]);
-        if (!tp)
+        if (indexes[i] < 0)
         {
+            free(indexes);
             tvp->s = IPS_IDLE;
             IDSetText(tvp, "Error: %s is not a member of %s (%s) property.", names[i], tvp->label, tvp->name);
             return -1;
@@ -1434,11 +1527,9 @@ int IUUpdateText(ITextVectorProperty *tvp, char *texts[], char *names[], int n)
 
     /* First loop checks for error, second loop set all values atomically*/
     for (int i = 0; i < n; i++)
-    {
-        IText *tp = IUFindText(tvp, names[i]);
-        IUSaveText(tp, texts[i]);
-    }
+        IUSaveText(&tvp->tp[indexes[i]], texts[i]);
 
+    free(indexes);
     return 0;
 }
 
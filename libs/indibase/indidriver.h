@@ -40,6 +40,11 @@ extern char *me;       /* a.out name */
 extern int dispatch(XMLEle *root, char msg[]);
 //extern void clientMsgCB(int fd, void *arg);
 
+/* Serve indiserver on the socket fd, in place of main() for a driver built as a plugin that indiserver
+ * runs in a thread of its own process. Returns 0 once the server closes the socket.
+ */
+extern int IDPluginMain(int fd, const char *name);
+
 /**
  * @defgroup configFunctions Configuration Functions: Functions drivers call to save and load configuration options.
  * 
@@ -78,6 +83,13 @@ extern int dispatch(XMLEle *root, char msg[]);
  */
 extern FILE *IUGetConfigFP(const char *filename, const char *dev, const char *mode, char errmsg[]);
 
+/** @brief Return the path of the configuration file, the one IUGetConfigFP() opens.
+ *  @param filename full path of the configuration file, or NULL to generate it as described in the <b>Detailed Description</b> introduction.
+ *  @param dev device name. This is used if the filename parameter is NULL, and INDICONFIG environment variable is not set.
+ *  @param configFileName buffer of at least MAXRBUF bytes set to the path.
+ */
+extern void IUGetConfigFileName(const char *filename, const char *dev, char configFileName[]);
+
 /**
  *  @param filename full path of the configuration file. If set, it will be deleted from disk.
  *         If set to NULL, it will attempt to generate the filename as described in the <b>Detailed Description</b> introduction and then delete it.
@@ -36,9 +36,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #include "indidriver.h"
 #include "sharedblob.h"
+#include "sharedring.h"
 #include "userio.h"
 #include "indiuserio.h"
 #include "indidriverio.h"
+#include "indiprobes.h"
 
 
 
@@ -54,6 +56,46 @@ static void driverio_flush(driverio * dio, const void * additional, size_t add_s
 
 static pthread_mutex_t stdout_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* The socket to indiserver, see driverio_set_fd() */
+static int driverio_fd = 1;
+static FILE * driverio_file = NULL;
+/* numbers='ieee754' of the getProperties of indiserver, see driverio_set_numbers_ieee754() */
+static int driverio_numbers = 0;
+
+/* Shared memory ring given by indiserver for the messages, see driverio_ring() */
+static shared_ring * ring = NULL;
+static int ring_checked = 0;
+
+/* The ring described by INDIRING, or NULL to write to the socket. Called with stdout_mutex held */
+static shared_ring * driverio_ring()
+{
+    const char * desc;
+    int fds[SHARED_RING_FDS];
+
+    if (ring_checked)
+    {
+        return ring;
+    }
+    ring_checked = 1;
+
+    desc = getenv("INDIRING");
+    if (desc == NULL)
+    {
+        return NULL;
+    }
+    if (sscanf(desc, "%d,%d,%d", &fds[0], &fds[1], &fds[2]) == SHARED_RING_FDS)
+    {
+        ring = IDSharedRingAttach(fds);
+        if (ring == NULL)
+        {
+            perror("shared ring");
+        }
+    }
+    /* Not for the processes started by the driver */
+    unsetenv("INDIRING");
+    return ring;
+}
+
 /* Return the buffer size required for storage (rounded to next OUTPUTBUFF_ALLOC) */
 static unsigned int outBuffRequired(unsigned int storage)
 {
@@ -151,6 +193,7 @@ static void driverio_flush(driverio * dio, const void * additional, size_t add_s
         int ret = -1;
         void ** temporaryBuffers = NULL;
         int fdCount = dio->joinCount;
+        INDI_PROBE2(driverio_flush, dio->outPos + add_size, fdCount);
         if (fdCount > 0)
         {
 
@@ -221,18 +264,44 @@ static void driverio_flush(driverio * dio, const void * additional, size_t add_s
             dio->locked = 1;
         }
 
-        ret = sendmsg(1, &msgh, 0);
-        if (ret == -1)
+        if (driverio_ring() != NULL)
         {
-            perror("sendmsg");
-            // FIXME: exiting the driver seems abrupt. Is this the right thing to do ? what about cleanup ?
-            exit(1);
+            if (fdCount > 0)
+            {
+                /* The fds go first, on the socket with a blank. The server gets them before reading
+                 * the xml that refers to them from the ring */
+                iov[0].iov_base = " ";
+                iov[0].iov_len = 1;
+                msgh.msg_iovlen = 1;
+                if (sendmsg(driverio_fd, &msgh, 0) != 1)
+                {
+                    perror("sendmsg");
+                    exit(1);
+                }
+                IDSharedRingAddFds(ring, fdCount);
+            }
+            if (IDSharedRingWrite(ring, dio->outBuff, dio->outPos, 1) == -1 ||
+                    IDSharedRingWrite(ring, additional, add_size, 1) == -1)
+            {
+                perror("shared ring");
+                exit(1);
+            }
         }
-        else if ((unsigned)ret != dio->outPos + add_size)
+        else
         {
-            // This is not expected on blocking socket
-            fprintf(stderr, "short write\n");
-            exit(1);
+            ret = sendmsg(driverio_fd, &msgh, 0);
+            if (ret == -1)
+            {
+                perror("sendmsg");
+                // FIXME: exiting the driver seems abrupt. Is this the right thing to do ? what about cleanup ?
+                exit(1);
+            }
+            else if ((unsigned)ret != dio->outPos + add_size)
+            {
+                // This is not expected on blocking socket
+                fprintf(stderr, "short write\n");
+                exit(1);
+            }
         }
 
         if (fdCount > 0)
@@ -286,7 +355,7 @@ static int is_unix_io()
     int domain;
     socklen_t result = sizeof(domain);
 
-    if (getsockopt(1, SOL_SOCKET, SO_DOMAIN, (void*)&domain, &result) == -1)
+    if (getsockopt(driverio_fd, SOL_SOCKET, SO_DOMAIN, (void*)&domain, &result) == -1)
     {
         driverio_is_unix = 0;
     }
@@ -302,7 +371,7 @@ static int is_unix_io()
     struct sockaddr_un sockName;
     socklen_t sockNameLen = sizeof(sockName);
 
-    if (getsockname(1, (struct sockaddr*)&sockName, &sockNameLen) == -1)
+    if (getsockname(driverio_fd, (struct sockaddr*)&sockName, &sockNameLen) == -1)
     {
         driverio_is_unix = 0;
     }
@@ -343,17 +412,68 @@ static void driverio_finish_unix(driverio * dio)
     }
 }
 
+/* stdout, or a stream of its own on the socket given to driverio_set_fd() */
+static FILE * driverio_stream()
+{
+    if (driverio_fd == 1)
+    {
+        return stdout;
+    }
+    if (driverio_file == NULL)
+    {
+        driverio_file = fdopen(dup(driverio_fd), "w");
+        if (driverio_file == NULL)
+        {
+            perror("fdopen");
+            exit(1);
+        }
+    }
+    return driverio_file;
+}
+
 static void driverio_init_stdout(driverio * dio)
 {
-    dio->userio = *userio_file();
-    dio->user = stdout;
     pthread_mutex_lock(&stdout_mutex);
+    dio->userio = *userio_file();
+    dio->user = driverio_stream();
 }
 
 static void driverio_finish_stdout(driverio * dio)
 {
-    (void)dio;
-    fflush(stdout);
+    fflush((FILE *)dio->user);
+    pthread_mutex_unlock(&stdout_mutex);
+}
+
+int driverio_is_unix_socket(void)
+{
+    return is_unix_io();
+}
+
+void driverio_set_numbers_ieee754(int enable)
+{
+    driverio_numbers = enable;
+}
+
+int driverio_numbers_ieee754(void)
+{
+    return driverio_numbers;
+}
+
+void driverio_set_fd(int fd)
+{
+    pthread_mutex_lock(&stdout_mutex);
+    if (driverio_file != NULL)
+    {
+        fclose(driverio_file);
+        driverio_file = NULL;
+    }
+    driverio_fd = fd;
+    driverio_is_unix = -1;
+    /* a new connection negotiates again */
+    driverio_numbers = 0;
+    /* no ring: INDIRING describes the one of the server's own driver processes */
+    ring = NULL;
+    ring_checked = 1;
     pthread_mutex_unlock(&stdout_mutex);
 }
 
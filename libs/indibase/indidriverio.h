@@ -23,6 +23,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* A driverio struct is valid only for sending one xml message */
 typedef struct driverio
 {
@@ -38,3 +42,17 @@ typedef struct driverio
 
 void driverio_init(driverio * dio);
 void driverio_finish(driverio * dio);
+
+/* 1 if the driver talks to indiserver on a unix socket, where buffers can be attached to messages */
+int driverio_is_unix_socket(void);
+
+/* Talk to indiserver on fd instead of stdout, for a driver loaded as a plugin */
+void driverio_set_fd(int fd);
+
+/* Whether indiserver announced numbers='ieee754' on this connection: setNumberVector values may go encoded */
+void driverio_set_numbers_ieee754(int enable);
+int driverio_numbers_ieee754(void);
+
+#ifdef __cplusplus
+}
+#endif
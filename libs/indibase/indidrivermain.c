@@ -35,6 +35,9 @@
 #include "indidevapi.h"
 #include "indidriver.h"
 #include "lilxml.h"
+#include "sharedblob.h"
+#include "userio.h"
+#include "indidriverio.h"
 
 #include <errno.h>
 #include <stdarg.h>
@@ -50,6 +53,13 @@
 #if defined(_WIN32) || defined(__CYGWIN__)
 #include <sys/select.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#ifdef ENABLE_INDI_SHARED_MEMORY
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
 
 #define MAXRBUF 2048
 
@@ -63,6 +73,90 @@ static LilXML *clixml = NULL;
 #define PROCEED_DEFERRED 0
 static int messageHandling = PROCEED_IMMEDIATE;
 
+/* the socket to indiserver: stdin, or the one given to IDPluginMain() */
+static int serverFd = 0;
+/* a plugin stops serving when the server is gone, instead of exiting the process it shares */
+static int plugin = 0;
+static int pluginDone = 0;
+
+
+#ifdef ENABLE_INDI_SHARED_MEMORY
+#define MAXRFDS 16
+
+/* fds of the buffers attached to the messages being read, in the order of their oneBLOB */
+static int *attachedFds = NULL;
+static int nattachedFds = 0;
+
+/* read from the unix socket, keeping the fds that come along */
+static int readAttached(int fd, char *buf, size_t len)
+{
+    union
+    {
+        struct cmsghdr cmsgh;
+        char control[CMSG_SPACE(MAXRFDS * sizeof(int))];
+    } control_un;
+    struct iovec iov = { buf, len };
+    struct msghdr msgh;
+
+    memset(&msgh, 0, sizeof(msgh));
+    msgh.msg_iov = &iov;
+    msgh.msg_iovlen = 1;
+    msgh.msg_control = control_un.control;
+    msgh.msg_controllen = sizeof(control_un.control);
+
+#ifdef __linux__
+    int nr = recvmsg(fd, &msgh, MSG_CMSG_CLOEXEC);
+#else
+    int nr = recvmsg(fd, &msgh, 0);
+#endif
+    if (nr <= 0)
+        return nr;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgh); cmsg != NULL; cmsg = CMSG_NXTHDR(&msgh, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        assert_mem(attachedFds = (int *)realloc(attachedFds, (nattachedFds + count) * sizeof(int)));
+        memcpy(attachedFds + nattachedFds, CMSG_DATA(cmsg), count * sizeof(int));
+        nattachedFds += count;
+    }
+    return nr;
+}
+
+/* map the attached buffers as the decoded content of their oneBLOB */
+static void attachBlobs(XMLEle *root)
+{
+    for (XMLEle *ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        if (strcmp(tagXMLEle(ep), "oneBLOB") || strcmp(findXMLAttValu(ep, "attached"), "true"))
+            continue;
+        if (nattachedFds == 0)
+        {
+            fprintf(stderr, "%s: missing attached buffer\n", me);
+            exit(1);
+        }
+
+        int fd = attachedFds[0];
+        memmove(attachedFds, attachedFds + 1, --nattachedFds * sizeof(int));
+
+        size_t size = atol(findXMLAttValu(ep, "size"));
+        rmXMLAtt(ep, "attached");
+        if (size == 0)
+        {
+            close(fd);
+            continue;
+        }
+        void *blob = IDSharedBlobAttach(fd, size);
+        if (blob == NULL)
+        {
+            fprintf(stderr, "%s: can't map attached buffer: %s\n", me, strerror(errno));
+            exit(1);
+        }
+        setBlobXMLEle(ep, blob, size, IDSharedBlobFree);
+    }
+}
+#endif
 
 /* callback when INDI client message arrives on stdin.
  * collect and dispatch when see outer element closure.
@@ -71,16 +165,18 @@ static int messageHandling = PROCEED_IMMEDIATE;
  */
 static void clientMsgCB(int fd, void *arg)
 {
-    char buf[MAXRBUF], msg[MAXRBUF], *bp;
+    char buf[MAXRBUF], msg[MAXRBUF];
     int nr;
 
     (void) arg;
 
-    // FIXME: not ready for receiving shared buffer blobs here
-    // Also this is completely similar to indidriver code... Common code ?
-
-    /* one read */
-    nr = read(fd, buf, sizeof(buf));
+    /* one read, with the buffers attached by indiserver on a unix socket */
+#ifdef ENABLE_INDI_SHARED_MEMORY
+    if (driverio_is_unix_socket())
+        nr = readAttached(fd, buf, sizeof(buf));
+    else
+#endif
+        nr = read(fd, buf, sizeof(buf));
     if (nr < 0)
     {
         if ((errno == EAGAIN) || (errno == EINTR))
@@ -88,31 +184,47 @@ static void clientMsgCB(int fd, void *arg)
             return;
         }
         fprintf(stderr, "%s: %s\n", me, strerror(errno));
+        if (plugin)
+        {
+            pluginDone = 1;
+            return;
+        }
         exit(1);
     }
     if (nr == 0)
     {
         fprintf(stderr, "%s: EOF\n", me);
+        if (plugin)
+        {
+            pluginDone = 1;
+            return;
+        }
         exit(1);
     }
 
-    /* crack and dispatch when complete */
-    for (bp = buf; nr-- > 0; bp++)
+    /* crack and dispatch when complete, inline BLOBs are decoded while they are read */
+    XMLEle **nodes = parseXMLChunk(clixml, buf, nr, msg);
+    if (nodes == NULL)
     {
-        XMLEle *root = readXMLEle(clixml, *bp, msg);
-        if (root)
+        fprintf(stderr, "%s XML error: %s\n", me, msg);
+        return;
+    }
+
+    for (XMLEle **np = nodes; *np; np++)
+    {
+        XMLEle *root = *np;
+        if (strcmp(tagXMLEle(root), "pingReply") == 0)
         {
-            if (strcmp(tagXMLEle(root), "pingReply") == 0)
-            {
-                handlePingReply(root);
-                delXMLEle(root);
-                continue;
-            }
-            deferMessage(root);
+            handlePingReply(root);
+            delXMLEle(root);
+            continue;
         }
-        else if (msg[0])
-            fprintf(stderr, "%s XML error: %s\n", me, msg);
+#ifdef ENABLE_INDI_SHARED_MEMORY
+        attachBlobs(root);
+#endif
+        deferMessage(root);
     }
+    free(nodes);
 }
 
 typedef struct DeferredMessage
@@ -254,7 +366,7 @@ static void waitPingReplyFromEventLoopThread(const char * uid) {
 }
 
 static void waitPingReplyFromOtherThread(const char * uid) {
-    int fd = 0;
+    int fd = serverFd;
     fd_set rfd;
 
     messageHandling = PROCEED_DEFERRED;
@@ -274,7 +386,7 @@ static void waitPingReplyFromOtherThread(const char * uid) {
             exit(1);
         }
 
-        clientMsgCB(0, NULL);
+        clientMsgCB(fd, NULL);
 
         pthread_mutex_lock(&pingReplyMutex);
     }
@@ -306,6 +418,10 @@ int main(int ac, char *av[])
 
     if (geteuid() != getuid())
         exit(255);
+
+    /* indiserver asks for it with mlock in the settings of its -a option */
+    if (getenv("INDIMLOCK") && mlockall(MCL_CURRENT | MCL_FUTURE) == -1)
+        IDLog("mlockall: %s\n", strerror(errno));
 #endif
 
     eventLoopThread = pthread_self();
@@ -334,6 +450,7 @@ int main(int ac, char *av[])
 
     /* init */
     clixml = newLilXML();
+    setBlobDecodeLilXML(clixml, IDSharedBlobRealloc, IDSharedBlobFree);
     addCallback(0, clientMsgCB, clixml);
 
     /* service client */
@@ -344,6 +461,39 @@ int main(int ac, char *av[])
     return (1);
 }
 
+#ifdef __GLIBC__
+/* the thread was started by the libc of the server: the one of this link map has not set its ctype
+ * tables for it, and every isalpha() would fault */
+extern void __ctype_init(void);
+#endif
+
+int IDPluginMain(int fd, const char *name)
+{
+#ifdef __GLIBC__
+    __ctype_init();
+#endif
+    eventLoopThread = pthread_self();
+    me = strdup(name);
+    serverFd = fd;
+    plugin = 1;
+    pluginDone = 0;
+    driverio_set_fd(fd);
+
+    clixml = newLilXML();
+    setBlobDecodeLilXML(clixml, IDSharedBlobRealloc, IDSharedBlobFree);
+    int cid = addCallback(fd, clientMsgCB, clixml);
+
+    /* service the server until it closes the socket. The timers and work of the driver stay: they go on
+     * if the server calls again */
+    deferLoop(0, &pluginDone);
+
+    rmCallback(cid);
+    delLilXML(clixml);
+    clixml = NULL;
+    close(fd);
+    return 0;
+}
+
 /* print usage message and exit (1) */
 static void usage(void)
 {
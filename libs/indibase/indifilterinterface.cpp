@@ -19,7 +19,10 @@
 */
 
 #include "indifilterinterface.h"
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <ctime>
 #include "indilogger.h"
 #include "indipropertytext.h"
 #include "indipropertynumber.h"
@@ -29,6 +32,11 @@ namespace INDI
 
 FilterInterface::FilterInterface(DefaultDevice *defaultDevice) : m_defaultDevice(defaultDevice)
 {
+    m_FocusTimer.setSingleShot(true);
+    m_FocusTimer.callOnTimeout([this]()
+    {
+        focusOffsetTimeout();
+    });
 }
 
 FilterInterface::~FilterInterface()
@@ -41,6 +49,15 @@ void FilterInterface::initProperties(const char *groupName)
     FilterSlotNP[0].fill("FILTER_SLOT_VALUE", "Filter", "%.f", 1.0, 12, 1.0, 1.0);
     FilterSlotNP.fill(m_defaultDevice->getDeviceName(), "FILTER_SLOT", "Filter Slot", groupName, IP_RW, 60, IPS_IDLE);
 
+    // Focus offsets
+    FilterFocuserTP[0].fill("FOCUSER", "Focuser", "");
+    FilterFocuserTP.fill(m_defaultDevice->getDeviceName(), "FILTER_FOCUSER", "Focuser", groupName, IP_RW, 60, IPS_IDLE);
+
+    FilterFocusMoveNP[0].fill("FOCUS_REQUEST", "Request", "%.f", 0, 4294967295., 0, 0);
+    FilterFocusMoveNP[1].fill("FOCUS_OFFSET", "Steps", "%.f", -1e6, 1e6, 0, 0);
+    FilterFocusMoveNP.fill(m_defaultDevice->getDeviceName(), "FILTER_FOCUS_MOVE", "Focus Move", groupName, IP_RO, 60,
+                           IPS_IDLE);
+
     loadFilterNames();
 }
 
@@ -57,11 +74,22 @@ bool FilterInterface::updateProperties()
         }
         else
             m_defaultDevice->defineProperty(FilterNameTP);
+
+        buildFocusOffsets();
+        m_defaultDevice->defineProperty(FilterFocusOffsetsNP);
+        m_defaultDevice->defineProperty(FilterFocuserTP);
+        m_defaultDevice->defineProperty(FilterFocusMoveNP);
     }
     else
     {
+        m_FocusTimer.stop();
+        m_WheelMoving = m_FocusMoving = false;
+
         m_defaultDevice->deleteProperty(FilterSlotNP);
         m_defaultDevice->deleteProperty(FilterNameTP);
+        m_defaultDevice->deleteProperty(FilterFocusOffsetsNP);
+        m_defaultDevice->deleteProperty(FilterFocuserTP);
+        m_defaultDevice->deleteProperty(FilterFocusMoveNP);
     }
 
     return true;
@@ -69,7 +97,14 @@ bool FilterInterface::updateProperties()
 
 bool FilterInterface::processNumber(const char *dev, const char *name, double values[], char *names[], int n)
 {
-    INDI_UNUSED(n);
+    if (dev && !strcmp(dev, m_defaultDevice->getDeviceName()) && FilterFocusOffsetsNP.isNameMatch(name))
+    {
+        FilterFocusOffsetsNP.update(values, names, n);
+        FilterFocusOffsetsNP.setState(IPS_OK);
+        FilterFocusOffsetsNP.apply();
+        m_defaultDevice->saveConfig(true, FilterFocusOffsetsNP.getName());
+        return true;
+    }
 
     if (dev && !strcmp(dev, m_defaultDevice->getDeviceName()) && FilterSlotNP.isNameMatch(name))
     {
@@ -98,8 +133,14 @@ bool FilterInterface::processNumber(const char *dev, const char *name, double va
         FilterSlotNP.setState(IPS_BUSY);
         DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_SESSION, "Setting current filter to slot %d", TargetFilter);
 
+        // The focuser starts on the offset before the wheel turns, both moves overlap
+        m_FocusOutcome = IPS_OK;
+        requestFocusOffset(static_cast<int>(FilterSlotNP[0].getValue()), TargetFilter);
+
+        m_WheelMoving = true;
         if (SelectFilter(TargetFilter) == false)
         {
+            m_WheelMoving = false;
             FilterSlotNP.setState(IPS_ALERT);
         }
 
@@ -112,11 +153,40 @@ bool FilterInterface::processNumber(const char *dev, const char *name, double va
 
 bool FilterInterface::processText(const char *dev, const char *name, char *texts[], char *names[], int n)
 {
+    if (dev && !strcmp(dev, m_defaultDevice->getDeviceName()) && FilterFocuserTP.isNameMatch(name))
+    {
+        FilterFocuserTP.update(texts, names, n);
+        FilterFocuserTP.setState(IPS_OK);
+        FilterFocuserTP.apply();
+        m_defaultDevice->saveConfig(true, FilterFocuserTP.getName());
+
+        const char *focuser = FilterFocuserTP[0].getText();
+        if (focuser == nullptr || focuser[0] == '\0')
+            return true;
+        if (m_FocusSnoop < 0)
+            m_FocusSnoop = m_defaultDevice->snoopProperty(SnoopRouter::NUMBER, focuser, "FOCUS_FILTER_OFFSET",
+            {"FOCUS_REQUEST"}, [this](const SnoopUpdate & update)
+        {
+            focusOffsetDone(update);
+        });
+        else
+            m_defaultDevice->setSnoopDevice(m_FocusSnoop, focuser);
+        return true;
+    }
+
     if (dev && !strcmp(dev, m_defaultDevice->getDeviceName()) && !strcmp(name, "FILTER_NAME"))
     {
         FilterNameTP.update(texts, names, n);
         FilterNameTP.setState(IPS_OK);
 
+        // Offsets are labeled after the filters
+        if (m_defaultDevice->isConnected() && FilterFocusOffsetsNP.size() > 0)
+        {
+            m_defaultDevice->deleteProperty(FilterFocusOffsetsNP);
+            buildFocusOffsets();
+            m_defaultDevice->defineProperty(FilterFocusOffsetsNP);
+        }
+
         if (m_defaultDevice->isConfigLoading() || SetFilterNames() == true)
         {
             FilterNameTP.apply();
@@ -139,6 +209,9 @@ bool FilterInterface::saveConfigItems(FILE *fp)
     FilterSlotNP.save(fp);
     if (FilterNameTP.size() > 0)
         FilterNameTP.save(fp);
+    if (FilterFocusOffsetsNP.size() > 0)
+        FilterFocusOffsetsNP.save(fp);
+    FilterFocuserTP.save(fp);
 
     return true;
 }
@@ -147,10 +220,127 @@ void FilterInterface::SelectFilterDone(int f)
 {
     //  The hardware has finished changing  filters
     FilterSlotNP[0].setValue(f);
-    FilterSlotNP.setState(IPS_OK);
+    m_WheelMoving = false;
+    if (m_FocusMoving)
+    {
+        DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_DEBUG, "Filter %d in place, waiting for %s.", f,
+                     FilterFocuserTP[0].getText());
+        FilterSlotNP.apply();
+        return;
+    }
+    finishFilterChange(IPS_OK);
+}
+
+void FilterInterface::finishFilterChange(IPState wheelState)
+{
+    if (m_WheelMoving || m_FocusMoving)
+        return;
+
+    FilterSlotNP.setState(wheelState == IPS_ALERT || m_FocusOutcome == IPS_ALERT ? IPS_ALERT : IPS_OK);
     FilterSlotNP.apply();
 }
 
+void FilterInterface::buildFocusOffsets()
+{
+    char offsetName[MAXINDINAME];
+    char offsetLabel[MAXINDILABEL];
+    int MaxFilter = FilterSlotNP[0].getMax();
+
+    // Offsets are kept, whether set or loaded from config before the slots changed
+    std::vector<double> offsets;
+    for (auto &offset : FilterFocusOffsetsNP)
+        offsets.push_back(offset.getValue());
+
+    FilterFocusOffsetsNP.resize(0);
+    for (int i = 0; i < MaxFilter; i++)
+    {
+        snprintf(offsetName, MAXINDINAME, "FILTER_FOCUS_OFFSET_%d", i + 1);
+        if (i < static_cast<int>(FilterNameTP.size()))
+            snprintf(offsetLabel, MAXINDILABEL, "%s", FilterNameTP[i].getText());
+        else
+            snprintf(offsetLabel, MAXINDILABEL, "Filter#%d", i + 1);
+
+        INDI::WidgetNumber oneNumber;
+        oneNumber.fill(offsetName, offsetLabel, "%.f", -1e5, 1e5, 10, i < static_cast<int>(offsets.size()) ? offsets[i] : 0);
+        FilterFocusOffsetsNP.push(std::move(oneNumber));
+    }
+
+    FilterFocusOffsetsNP.fill(m_defaultDevice->getDeviceName(), "FILTER_FOCUS_OFFSETS", "Focus Offsets",
+                              FilterSlotNP.getGroupName(), IP_RW, 0, IPS_IDLE);
+    FilterFocusOffsetsNP.shrink_to_fit();
+}
+
+bool FilterInterface::requestFocusOffset(int from, int to)
+{
+    const char *focuser = FilterFocuserTP[0].getText();
+    int count = static_cast<int>(FilterFocusOffsetsNP.size());
+    if (focuser == nullptr || focuser[0] == '\0' || from < 1 || from > count || to < 1 || to > count)
+        return false;
+
+    double steps = rint(FilterFocusOffsetsNP[to - 1].getValue() - FilterFocusOffsetsNP[from - 1].getValue());
+    if (steps == 0)
+        return false;
+
+    if (m_FocusMoving)
+        DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_WARNING,
+                     "%s has not applied the previous focus offset yet.", focuser);
+
+    // Request numbers go on from the clock, so that the answer to a request of an earlier session is not taken
+    // for the answer to this one
+    m_FocusRequest = std::max(m_FocusRequest + 1, static_cast<uint32_t>(time(nullptr)));
+    m_FocusMoving = true;
+
+    DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_SESSION, "Moving %s by %.f steps for filter %d.",
+                 focuser, steps, to);
+    FilterFocusMoveNP[0].setValue(m_FocusRequest);
+    FilterFocusMoveNP[1].setValue(steps);
+    FilterFocusMoveNP.setState(IPS_BUSY);
+    FilterFocusMoveNP.apply();
+
+    // The focuser answers at once, whether it moves or not
+    m_FocusTimer.start(10000);
+    return true;
+}
+
+void FilterInterface::focusOffsetDone(const SnoopUpdate &update)
+{
+    if (!m_FocusMoving || !update.has(0) || static_cast<uint32_t>(update.number(0)) != m_FocusRequest)
+        return;
+
+    // Moving, the focuser answers again once done
+    if (update.state() == IPS_BUSY)
+    {
+        m_FocusTimer.start(300000);
+        return;
+    }
+
+    m_FocusTimer.stop();
+    m_FocusMoving = false;
+    m_FocusOutcome = update.state() == IPS_ALERT ? IPS_ALERT : IPS_OK;
+    if (m_FocusOutcome == IPS_ALERT)
+        DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_ERROR, "%s failed to apply the focus offset.",
+                     FilterFocuserTP[0].getText());
+
+    FilterFocusMoveNP.setState(m_FocusOutcome);
+    FilterFocusMoveNP.apply();
+    // A wheel that failed to turn left the slot in alert
+    finishFilterChange(FilterSlotNP.getState());
+}
+
+void FilterInterface::focusOffsetTimeout()
+{
+    if (!m_FocusMoving)
+        return;
+
+    DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_ERROR, "%s did not apply the focus offset of request %u.",
+                 FilterFocuserTP[0].getText(), m_FocusRequest);
+    m_FocusMoving = false;
+    m_FocusOutcome = IPS_ALERT;
+    FilterFocusMoveNP.setState(IPS_ALERT);
+    FilterFocusMoveNP.apply();
+    finishFilterChange(FilterSlotNP.getState());
+}
+
 void FilterInterface::generateSampleFilters()
 {
     char filterName[MAXINDINAME];
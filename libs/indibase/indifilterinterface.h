@@ -25,6 +25,10 @@
 #include "indibase.h"
 #include "indipropertytext.h"
 #include "indipropertynumber.h"
+#include "inditimer.h"
+#include "snooprouter.h"
+
+#include <cstdint>
 
 /**
  * \class FilterInterface
@@ -38,6 +42,11 @@
    \e IMPORTANT: processFilterSlot() must be called in your driver's ISNewNumber() function. processFilterSlot() will call the driver's
       SelectFilter() accordingly.
 
+   Each filter may have a focus offset, in steps of the focuser named by FILTER_FOCUSER. On a filter change, the
+   interface publishes the difference of the offsets of both filters as FILTER_FOCUS_MOVE, then selects the new
+   filter: the focuser snoops the request and moves while the wheel turns. FILTER_SLOT stays busy until both the
+   wheel and the focuser are done, and turns to alert if either failed.
+
    \note Filter position starts from 1 and \e not 0
 \author Gerry Rozema, Jasem Mutlaq
 */
@@ -125,12 +134,45 @@ class FilterInterface
         //  A text vector that stores filter names
         INDI::PropertyText FilterNameTP {0};
 
+        // Focus offset of each filter, in focuser steps
+        INDI::PropertyNumber FilterFocusOffsetsNP {0};
+
+        // The focuser applying the focus offsets, none if empty
+        INDI::PropertyText FilterFocuserTP {1};
+
+        // The move asked of the focuser on the last filter change: its request number and steps
+        INDI::PropertyNumber FilterFocusMoveNP {2};
+
         int CurrentFilter = 1;
         int TargetFilter = 1;
 
         DefaultDevice *m_defaultDevice { nullptr };
 
     private:
+        /**
+         * @brief buildFocusOffsets Size the focus offsets to the filter slots, labeled after the filter names.
+         */
+        void buildFocusOffsets();
+
+        /**
+         * @brief requestFocusOffset Ask the focuser for the change of focus between two filters.
+         * @return True if the focuser has a move to make.
+         */
+        bool requestFocusOffset(int from, int to);
+
+        void focusOffsetDone(const SnoopUpdate &update);
+        void focusOffsetTimeout();
+
+        // FILTER_SLOT turns back to OK or alert once neither the wheel nor the focuser moves
+        void finishFilterChange(IPState wheelState);
+
+        bool m_WheelMoving { false };
+        bool m_FocusMoving { false };
+        IPState m_FocusOutcome { IPS_OK };
+        uint32_t m_FocusRequest { 0 };
+        int m_FocusSnoop { -1 };
+        INDI::Timer m_FocusTimer;
+
         /**
          * @brief loadFilterNames Load filter names from config
          * @return true if successful, false otherwise.
@@ -104,7 +104,7 @@ bool FilterWheel::ISNewNumber(const char *dev, const char *name, double values[]
 {
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
     {
-        if (strcmp(name, "FILTER_SLOT") == 0)
+        if (strcmp(name, "FILTER_SLOT") == 0 || strcmp(name, "FILTER_FOCUS_OFFSETS") == 0)
         {
             FilterInterface::processNumber(dev, name, values, names, n);
             return true;
@@ -201,6 +201,9 @@ bool Focuser::ISNewSwitch(const char *dev, const char *name, ISState *states, ch
 
 bool Focuser::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
 {
+    if (FI::processText(dev, name, texts, names, n))
+        return true;
+
     controller->ISNewText(dev, name, texts, names, n);
 
     return DefaultDevice::ISNewText(dev, name, texts, names, n);
@@ -22,14 +22,26 @@
 
 #include "indilogger.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cmath>
+#include <ctime>
 
 namespace INDI
 {
 
 FocuserInterface::FocuserInterface(DefaultDevice * defaultDevice) : m_defaultDevice(defaultDevice)
 {
+    m_AutofocusTimer.setInterval(250);
+    m_AutofocusTimer.callOnTimeout([this]()
+    {
+        autofocusTick();
+    });
+    m_FilterOffsetTimer.setInterval(250);
+    m_FilterOffsetTimer.callOnTimeout([this]()
+    {
+        filterOffsetTick();
+    });
 }
 
 void FocuserInterface::initProperties(const char * groupName)
@@ -87,6 +99,42 @@ void FocuserInterface::initProperties(const char * groupName)
     // Backlash Compensation Value
     FocusBacklashNP[0].fill("FOCUS_BACKLASH_VALUE", "Steps", "%.f", 0, 1e6, 100, 0);
     FocusBacklashNP.fill(m_defaultDevice->getDeviceName(), "FOCUS_BACKLASH_STEPS", "Backlash", groupName, IP_RW, 60, IPS_OK);
+
+    // Autofocus
+    FocusAutofocusCameraTP[0].fill("CAMERA", "Camera", "CCD Simulator");
+    FocusAutofocusCameraTP.fill(m_defaultDevice->getDeviceName(), "FOCUS_AUTOFOCUS_CAMERA", "Autofocus", groupName, IP_RW, 60,
+                                IPS_IDLE);
+
+    FocusAutofocusSettingsNP[AF_STEP].fill("AF_STEP", "Step", "%.f", 1, 1e5, 10, 100);
+    FocusAutofocusSettingsNP[AF_POINTS].fill("AF_POINTS", "Points", "%.f", 5, 31, 2, 9);
+    FocusAutofocusSettingsNP[AF_EXPOSURE].fill("AF_EXPOSURE", "Exposure (s)", "%.2f", 0.001, 600, 1, 2);
+    FocusAutofocusSettingsNP.fill(m_defaultDevice->getDeviceName(), "FOCUS_AUTOFOCUS_SETTINGS", "Autofocus", groupName, IP_RW,
+                                  60, IPS_IDLE);
+
+    FocusAutofocusSP[AF_START].fill("AF_START", "Start", ISS_OFF);
+    FocusAutofocusSP[AF_ABORT].fill("AF_ABORT", "Abort", ISS_OFF);
+    FocusAutofocusSP.fill(m_defaultDevice->getDeviceName(), "FOCUS_AUTOFOCUS", "Autofocus", groupName, IP_RW, ISR_ATMOST1, 60,
+                          IPS_IDLE);
+
+    FocusAutofocusFrameNP[0].fill("AF_FRAME", "Frame", "%.f", 0, 4294967295., 0, 0);
+    FocusAutofocusFrameNP[1].fill("AF_EXPOSURE", "Exposure (s)", "%.2f", 0, 600, 0, 0);
+    FocusAutofocusFrameNP.fill(m_defaultDevice->getDeviceName(), "FOCUS_AUTOFOCUS_FRAME", "Autofocus Frame", groupName, IP_RO,
+                               60, IPS_IDLE);
+
+    FocusAutofocusResultNP[0].fill("AF_POSITION", "Position", "%.f", 0, 1e6, 0, 0);
+    FocusAutofocusResultNP[1].fill("AF_HFR", "HFR", "%.2f", 0, 1000, 0, 0);
+    FocusAutofocusResultNP.fill(m_defaultDevice->getDeviceName(), "FOCUS_AUTOFOCUS_RESULT", "Best Focus", groupName, IP_RO,
+                                60, IPS_IDLE);
+
+    // Filter offsets
+    FocusFilterWheelTP[0].fill("FILTER_WHEEL", "Filter Wheel", "");
+    FocusFilterWheelTP.fill(m_defaultDevice->getDeviceName(), "FOCUS_FILTER_WHEEL", "Filter Offsets", groupName, IP_RW, 60,
+                            IPS_IDLE);
+
+    FocusFilterOffsetNP[0].fill("FOCUS_REQUEST", "Request", "%.f", 0, 4294967295., 0, 0);
+    FocusFilterOffsetNP[1].fill("FOCUS_OFFSET", "Steps", "%.f", -1e6, 1e6, 0, 0);
+    FocusFilterOffsetNP.fill(m_defaultDevice->getDeviceName(), "FOCUS_FILTER_OFFSET", "Filter Offset", groupName, IP_RO, 60,
+                             IPS_IDLE);
 }
 
 bool FocuserInterface::updateProperties()
@@ -110,6 +158,16 @@ bool FocuserInterface::updateProperties()
         {
             m_defaultDevice->defineProperty(FocusAbsPosNP);
             m_defaultDevice->defineProperty(FocusMaxPosNP);
+            m_defaultDevice->defineProperty(FocusAutofocusCameraTP);
+            m_defaultDevice->defineProperty(FocusAutofocusSettingsNP);
+            m_defaultDevice->defineProperty(FocusAutofocusSP);
+            m_defaultDevice->defineProperty(FocusAutofocusFrameNP);
+            m_defaultDevice->defineProperty(FocusAutofocusResultNP);
+        }
+        if (CanAbsMove() || CanRelMove())
+        {
+            m_defaultDevice->defineProperty(FocusFilterWheelTP);
+            m_defaultDevice->defineProperty(FocusFilterOffsetNP);
         }
         if (CanAbort())
             m_defaultDevice->defineProperty(FocusAbortSP);
@@ -137,8 +195,22 @@ bool FocuserInterface::updateProperties()
             m_defaultDevice->deleteProperty(FocusRelPosNP);
         if (CanAbsMove())
         {
+            if (m_AutofocusStage != AUTOFOCUS_IDLE)
+                stopAutofocus(IPS_ALERT, "Autofocus aborted, the focuser is disconnected.");
             m_defaultDevice->deleteProperty(FocusAbsPosNP);
             m_defaultDevice->deleteProperty(FocusMaxPosNP);
+            m_defaultDevice->deleteProperty(FocusAutofocusCameraTP);
+            m_defaultDevice->deleteProperty(FocusAutofocusSettingsNP);
+            m_defaultDevice->deleteProperty(FocusAutofocusSP);
+            m_defaultDevice->deleteProperty(FocusAutofocusFrameNP);
+            m_defaultDevice->deleteProperty(FocusAutofocusResultNP);
+        }
+        if (CanAbsMove() || CanRelMove())
+        {
+            m_FilterOffsetTimer.stop();
+            m_FilterOffsetMoving = false;
+            m_defaultDevice->deleteProperty(FocusFilterWheelTP);
+            m_defaultDevice->deleteProperty(FocusFilterOffsetNP);
         }
         if (CanAbort())
             m_defaultDevice->deleteProperty(FocusAbortSP);
@@ -199,6 +271,8 @@ bool FocuserInterface::processNumber(const char * dev, const char * name, double
                 FocusSpeedNP.setState(IPS_ALERT);
                 m_defaultDevice->saveConfig(true, FocusSpeedNP.getName());
             }
+            else if (FocusSpeedNP[0].getValue() != current_speed)
+                resetMotionModel();
 
             //  Update client display
             FocusSpeedNP.apply();
@@ -260,6 +334,16 @@ bool FocuserInterface::processNumber(const char * dev, const char * name, double
             return true;
         }
 
+        // Autofocus settings, for the next run
+        if (FocusAutofocusSettingsNP.isNameMatch(name))
+        {
+            FocusAutofocusSettingsNP.update(values, names, n);
+            FocusAutofocusSettingsNP.setState(IPS_OK);
+            FocusAutofocusSettingsNP.apply();
+            m_defaultDevice->saveConfig(true, FocusAutofocusSettingsNP.getName());
+            return true;
+        }
+
         // Set backlash value
         if (FocusBacklashNP.isNameMatch(name))
         {
@@ -310,6 +394,7 @@ bool FocuserInterface::processNumber(const char * dev, const char * name, double
             }
 
             IPState ret;
+            uint32_t from = FocusAbsPosNP[0].getValue();
 
             if ((ret = MoveAbsFocuser(newPos)) == IPS_OK)
             {
@@ -321,6 +406,7 @@ bool FocuserInterface::processNumber(const char * dev, const char * name, double
             }
             else if (ret == IPS_BUSY)
             {
+                motionStarted(from, newPos);
                 FocusAbsPosNP.setState(IPS_BUSY);
                 DEBUGFDEVICE(dev, Logger::DBG_SESSION, "Focuser is moving to position %d", newPos);
                 FocusAbsPosNP.apply();
@@ -374,6 +460,7 @@ bool FocuserInterface::processNumber(const char * dev, const char * name, double
                 }
             }
 
+            uint32_t from = FocusAbsPosNP[0].getValue();
             if ((ret = MoveRelFocuser((FocusMotionSP[FOCUS_INWARD].getState() == ISS_ON ? FOCUS_INWARD : FOCUS_OUTWARD),
                                       newPos)) == IPS_OK)
             {
@@ -387,6 +474,9 @@ bool FocuserInterface::processNumber(const char * dev, const char * name, double
             }
             else if (ret == IPS_BUSY)
             {
+                if (CanAbsMove())
+                    motionStarted(from, FocusMotionSP[FOCUS_INWARD].getState() == ISS_ON ?
+                                  (from > static_cast<uint32_t>(newPos) ? from - newPos : 0) : from + newPos);
                 FocusRelPosNP.update(values, names, n);
                 FocusRelPosNP.setState(IPS_BUSY);
                 FocusAbsPosNP.setState(IPS_BUSY);
@@ -448,6 +538,9 @@ bool FocuserInterface::processSwitch(const char * dev, const char * name, ISStat
 
             if (SetFocuserBacklashEnabled(FocusBacklashSP.findOnSwitchIndex() == DefaultDevice::INDI_ENABLED))
             {
+                // Moves that change direction take longer now, or no longer
+                if (FocusBacklashSP.findOnSwitchIndex() != prevIndex)
+                    resetMotionModel();
                 FocusBacklashSP.update(states, names, n);
                 FocusBacklashSP.setState(IPS_OK);
                 m_defaultDevice->saveConfig(true, FocusBacklashSP.getName());
@@ -463,6 +556,34 @@ bool FocuserInterface::processSwitch(const char * dev, const char * name, ISStat
             return true;
         }
 
+        // Autofocus
+        else if (FocusAutofocusSP.isNameMatch(name))
+        {
+            FocusAutofocusSP.update(states, names, n);
+            int index = FocusAutofocusSP.findOnSwitchIndex();
+
+            if (index == AF_ABORT)
+            {
+                if (m_AutofocusStage == AUTOFOCUS_MOVING && CanAbort() && AbortFocuser())
+                {
+                    motionFinished(false);
+                    FocusAbsPosNP.setState(IPS_IDLE);
+                    FocusAbsPosNP.apply();
+                }
+                stopAutofocus(IPS_IDLE, m_AutofocusStage != AUTOFOCUS_IDLE ? "Autofocus aborted." : nullptr);
+            }
+            else if (index == AF_START && m_AutofocusStage == AUTOFOCUS_IDLE)
+                startAutofocus();
+            else
+            {
+                // Already running, the switch shows the run as it is
+                FocusAutofocusSP.reset();
+                FocusAutofocusSP[AF_START].setState(m_AutofocusStage != AUTOFOCUS_IDLE ? ISS_ON : ISS_OFF);
+                FocusAutofocusSP.apply();
+            }
+            return true;
+        }
+
         // Abort Focuser
         else if (FocusAbortSP.isNameMatch(name))
         {
@@ -470,6 +591,7 @@ bool FocuserInterface::processSwitch(const char * dev, const char * name, ISStat
 
             if (AbortFocuser())
             {
+                motionFinished(false);
                 FocusAbortSP.setState(IPS_OK);
                 if (CanAbsMove() && FocusAbsPosNP.getState() != IPS_IDLE)
                 {
@@ -515,6 +637,44 @@ bool FocuserInterface::processSwitch(const char * dev, const char * name, ISStat
     return false;
 }
 
+bool FocuserInterface::processText(const char * dev, const char * name, char * texts[], char * names[], int n)
+{
+    if (dev && !strcmp(dev, m_defaultDevice->getDeviceName()))
+    {
+        if (FocusAutofocusCameraTP.isNameMatch(name))
+        {
+            FocusAutofocusCameraTP.update(texts, names, n);
+            FocusAutofocusCameraTP.setState(IPS_OK);
+            FocusAutofocusCameraTP.apply();
+            m_defaultDevice->saveConfig(true, FocusAutofocusCameraTP.getName());
+            return true;
+        }
+
+        if (FocusFilterWheelTP.isNameMatch(name))
+        {
+            FocusFilterWheelTP.update(texts, names, n);
+            FocusFilterWheelTP.setState(IPS_OK);
+            FocusFilterWheelTP.apply();
+            m_defaultDevice->saveConfig(true, FocusFilterWheelTP.getName());
+
+            const char *wheel = FocusFilterWheelTP[0].getText();
+            if (wheel == nullptr || wheel[0] == '\0')
+                return true;
+            if (m_FilterOffsetSnoop < 0)
+                m_FilterOffsetSnoop = m_defaultDevice->snoopProperty(SnoopRouter::NUMBER, wheel, "FILTER_FOCUS_MOVE",
+                {"FOCUS_REQUEST", "FOCUS_OFFSET"}, [this](const SnoopUpdate & update)
+            {
+                filterOffsetRequest(update);
+            });
+            else
+                m_defaultDevice->setSnoopDevice(m_FilterOffsetSnoop, wheel);
+            return true;
+        }
+    }
+
+    return false;
+}
+
 IPState FocuserInterface::MoveFocuser(FocusDirection dir, int speed, uint16_t duration)
 {
     INDI_UNUSED(dir);
@@ -590,10 +750,111 @@ bool FocuserInterface::SetFocuserBacklashEnabled(bool enabled)
         return SetFocuserBacklash(0);
 }
 
+void FocuserInterface::motionStarted(uint32_t from, uint32_t to)
+{
+    m_MotionFrom   = from;
+    m_MotionTo     = to;
+    m_MotionStart  = std::chrono::steady_clock::now();
+    m_MotionActive = true;
+}
+
+void FocuserInterface::motionFinished(bool completed)
+{
+    if (!m_MotionActive)
+        return;
+    m_MotionActive = false;
+
+    double steps = std::abs(static_cast<double>(m_MotionTo) - m_MotionFrom);
+    if (!completed || steps == 0)
+        return;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_MotionStart).count();
+    // The last moves are the ones that tell the speed the focuser runs at now
+    if (m_MotionSamples.size() < 16)
+        m_MotionSamples.push_back({steps, seconds});
+    else
+        m_MotionSamples[m_NextMotionSample] = {steps, seconds};
+    m_NextMotionSample = (m_NextMotionSample + 1) % 16;
+
+    // Least squares fit of the duration against the steps, the intercept is the time spent on the ramps and the commands
+    double n = m_MotionSamples.size(), sumSteps = 0, sumSeconds = 0;
+    for (const auto &sample : m_MotionSamples)
+    {
+        sumSteps   += sample.steps;
+        sumSeconds += sample.seconds;
+    }
+    double meanSteps = sumSteps / n, meanSeconds = sumSeconds / n, covariance = 0, variance = 0;
+    for (const auto &sample : m_MotionSamples)
+    {
+        covariance += (sample.steps - meanSteps) * (sample.seconds - meanSeconds);
+        variance   += (sample.steps - meanSteps) * (sample.steps - meanSteps);
+    }
+
+    double slope = variance > 0 ? covariance / variance : 0;
+    double intercept = meanSeconds - slope * meanSteps;
+    if (slope > 0 && intercept >= 0)
+    {
+        m_MotionSpeed    = 1.0 / slope;
+        m_MotionOverhead = intercept;
+    }
+    else if (sumSeconds > 0)
+    {
+        // Moves of one length only, or too noisy to fit, take the average speed
+        m_MotionSpeed    = sumSteps / sumSeconds;
+        m_MotionOverhead = 0;
+    }
+}
+
+void FocuserInterface::resetMotionModel()
+{
+    m_MotionSamples.clear();
+    m_NextMotionSample = 0;
+    m_MotionSpeed      = 0;
+    m_MotionOverhead   = 0;
+}
+
+bool FocuserInterface::predictMotion(uint32_t &position, uint32_t &remaining) const
+{
+    if (!m_MotionActive || m_MotionSpeed <= 0)
+        return false;
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_MotionStart).count();
+    double steps = std::abs(static_cast<double>(m_MotionTo) - m_MotionFrom);
+    double cruise = steps / m_MotionSpeed;
+
+    // Half of the overhead is taken before the focuser gets going
+    double progress = cruise > 0 ? std::min(1.0, std::max(0.0, (elapsed - m_MotionOverhead / 2) / cruise)) : 1.0;
+    position  = static_cast<uint32_t>(std::lround(m_MotionFrom + (static_cast<double>(m_MotionTo) - m_MotionFrom) * progress));
+    remaining = static_cast<uint32_t>(std::max(0.0, (m_MotionOverhead + cruise - elapsed) * 1000));
+    return true;
+}
+
+bool FocuserInterface::updatePredictedPosition(uint32_t &nextPoll)
+{
+    uint32_t position = 0, remaining = 0;
+    if (!predictMotion(position, remaining) || remaining == 0)
+        return false;
+
+    if (FocusAbsPosNP[0].getValue() != position)
+    {
+        FocusAbsPosNP[0].setValue(position);
+        FocusAbsPosNP.apply();
+    }
+
+    nextPoll = std::min(m_defaultDevice->getCurrentPollingPeriod(), remaining);
+    return true;
+}
+
 bool FocuserInterface::saveConfigItems(FILE * fp)
 {
     if (CanAbsMove())
+    {
         FocusMaxPosNP.save(fp);
+        FocusAutofocusCameraTP.save(fp);
+        FocusAutofocusSettingsNP.save(fp);
+    }
+    if (CanAbsMove() || CanRelMove())
+        FocusFilterWheelTP.save(fp);
     if (CanReverse())
         FocusReverseSP.save(fp);
     if (HasBacklash())
@@ -605,4 +866,367 @@ bool FocuserInterface::saveConfigItems(FILE * fp)
     return true;
 }
 
+void FocuserInterface::startAutofocus()
+{
+    const char *camera = FocusAutofocusCameraTP[0].getText();
+    if (camera == nullptr || camera[0] == '\0')
+    {
+        stopAutofocus(IPS_ALERT, "Autofocus needs the camera that measures the stars.");
+        return;
+    }
+
+    if (m_AutofocusSnoop < 0)
+        m_AutofocusSnoop = m_defaultDevice->snoopProperty(SnoopRouter::NUMBER, camera, "CCD_FRAME_STARS",
+        {"STARS_COUNT", "STARS_HFR", "STARS_FRAME"}, [this](const SnoopUpdate & update)
+    {
+        autofocusStars(update);
+    });
+    else
+        m_defaultDevice->setSnoopDevice(m_AutofocusSnoop, camera);
+
+    // The points are centered on the current position, shifted to fit in the travel
+    double step   = FocusAutofocusSettingsNP[AF_STEP].getValue();
+    int points    = static_cast<int>(FocusAutofocusSettingsNP[AF_POINTS].getValue());
+    double span   = step * (points - 1);
+    double minPos = FocusAbsPosNP[0].getMin(), maxPos = FocusAbsPosNP[0].getMax();
+    double first  = std::max(minPos, std::min(FocusAbsPosNP[0].getValue() - span / 2, maxPos - span));
+    if (first < minPos)
+    {
+        stopAutofocus(IPS_ALERT, "Autofocus points span more than the focuser travel.");
+        return;
+    }
+
+    // Every point is reached moving outward, so that the backlash is the same at each
+    m_AutofocusMoves.clear();
+    if (first - step >= minPos)
+        m_AutofocusMoves.push_back({static_cast<uint32_t>(first - step), false});
+    for (int i = 0; i < points; i++)
+        m_AutofocusMoves.push_back({static_cast<uint32_t>(rint(first + i * step)), true});
+
+    m_AutofocusNext = 0;
+    m_AutofocusFinal = false;
+    m_AutofocusStart = FocusAbsPosNP[0].getValue();
+    m_AutofocusPositions.clear();
+    m_AutofocusHFRs.clear();
+    // Frame numbers go on from the clock, so that a camera that served an earlier run does not take
+    // the first frame of this one for a request it already answered
+    m_AutofocusFrame = std::max(m_AutofocusFrame, static_cast<uint32_t>(time(nullptr)));
+
+    DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_SESSION,
+                 "Autofocus with %s, %d points from %.f to %.f.", camera, points, first, first + span);
+    FocusAutofocusSP.reset();
+    FocusAutofocusSP[AF_START].setState(ISS_ON);
+    FocusAutofocusSP.setState(IPS_BUSY);
+    FocusAutofocusSP.apply();
+    FocusAutofocusResultNP.setState(IPS_BUSY);
+    FocusAutofocusResultNP.apply();
+
+    m_AutofocusTimer.start();
+    autofocusNextMove();
+}
+
+void FocuserInterface::autofocusNextMove()
+{
+    if (m_AutofocusNext == m_AutofocusMoves.size())
+    {
+        if (m_AutofocusFinal)
+            stopAutofocus(m_AutofocusOutcome);
+        else
+            autofocusFit();
+        return;
+    }
+
+    uint32_t target = m_AutofocusMoves[m_AutofocusNext].position;
+    uint32_t from = FocusAbsPosNP[0].getValue();
+    m_AutofocusStage = AUTOFOCUS_MOVING;
+
+    // As a client move would, autofocusTick waits for the driver to complete it
+    IPState state = MoveAbsFocuser(target);
+    if (state == IPS_ALERT)
+    {
+        FocusAbsPosNP.setState(IPS_ALERT);
+        FocusAbsPosNP.apply();
+        stopAutofocus(IPS_ALERT, "Autofocus failed to move the focuser.");
+        return;
+    }
+    if (state == IPS_BUSY)
+        motionStarted(from, target);
+    else
+        FocusAbsPosNP[0].setValue(target);
+    FocusAbsPosNP.setState(state);
+    FocusAbsPosNP.apply();
+}
+
+void FocuserInterface::autofocusTick()
+{
+    if (m_AutofocusStage == AUTOFOCUS_MOVING)
+    {
+        if (FocusAbsPosNP.getState() == IPS_BUSY)
+            return;
+        if (FocusAbsPosNP.getState() == IPS_ALERT)
+        {
+            stopAutofocus(IPS_ALERT, "Autofocus stopped, the focuser failed to reach its position.");
+            return;
+        }
+
+        if (!m_AutofocusMoves[m_AutofocusNext].measure)
+        {
+            m_AutofocusNext++;
+            autofocusNextMove();
+            return;
+        }
+
+        // The camera exposes once it sees the request, and should answer well within a minute of the exposure
+        double exposure = FocusAutofocusSettingsNP[AF_EXPOSURE].getValue();
+        m_AutofocusStage = AUTOFOCUS_EXPOSING;
+        m_AutofocusDeadline = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(static_cast<int64_t>(exposure * 1000) + 60000);
+        FocusAutofocusFrameNP[0].setValue(++m_AutofocusFrame);
+        FocusAutofocusFrameNP[1].setValue(exposure);
+        FocusAutofocusFrameNP.setState(IPS_BUSY);
+        FocusAutofocusFrameNP.apply();
+    }
+    else if (m_AutofocusStage == AUTOFOCUS_EXPOSING && std::chrono::steady_clock::now() > m_AutofocusDeadline)
+    {
+        DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_ERROR,
+                     "Autofocus stopped, %s did not measure frame %u.", FocusAutofocusCameraTP[0].getText(), m_AutofocusFrame);
+        stopAutofocus(IPS_ALERT);
+    }
+}
+
+void FocuserInterface::autofocusStars(const SnoopUpdate &update)
+{
+    if (m_AutofocusStage != AUTOFOCUS_EXPOSING || !update.has(2) || static_cast<uint32_t>(update.number(2)) != m_AutofocusFrame)
+        return;
+
+    if (update.state() == IPS_ALERT)
+    {
+        stopAutofocus(IPS_ALERT, "Autofocus stopped, the camera could not take its frame.");
+        return;
+    }
+
+    // Far from focus, stars may melt into the background: the point is left out of the fit
+    uint32_t position = m_AutofocusMoves[m_AutofocusNext].position;
+    int stars = static_cast<int>(update.number(0));
+    if (stars > 0)
+    {
+        m_AutofocusPositions.push_back(position);
+        m_AutofocusHFRs.push_back(update.number(1));
+    }
+    DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_SESSION, "Autofocus at %u: %d stars, HFR %.2f.", position,
+                 stars, update.number(1));
+
+    FocusAutofocusFrameNP.setState(IPS_OK);
+    FocusAutofocusFrameNP.apply();
+
+    m_AutofocusNext++;
+    autofocusNextMove();
+}
+
+void FocuserInterface::autofocusFit()
+{
+    double position = 0, hfr = 0;
+    uint32_t target;
+
+    if (fitFocusCurve(m_AutofocusPositions, m_AutofocusHFRs, position, hfr))
+    {
+        target = static_cast<uint32_t>(rint(position));
+        DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_SESSION, "Autofocus: best focus at %u, HFR %.2f.", target, hfr);
+        FocusAutofocusResultNP[0].setValue(target);
+        FocusAutofocusResultNP[1].setValue(hfr);
+        FocusAutofocusResultNP.setState(IPS_OK);
+        m_AutofocusOutcome = IPS_OK;
+    }
+    else
+    {
+        target = m_AutofocusStart;
+        DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_ERROR,
+                     "Autofocus found no best focus in the %zu points with stars, back to %u.", m_AutofocusPositions.size(), target);
+        FocusAutofocusResultNP.setState(IPS_ALERT);
+        m_AutofocusOutcome = IPS_ALERT;
+    }
+    FocusAutofocusResultNP.apply();
+
+    // The last move is outward too
+    double step = FocusAutofocusSettingsNP[AF_STEP].getValue();
+    m_AutofocusMoves.clear();
+    if (target - step >= FocusAbsPosNP[0].getMin())
+        m_AutofocusMoves.push_back({static_cast<uint32_t>(target - step), false});
+    m_AutofocusMoves.push_back({target, false});
+    m_AutofocusNext = 0;
+    m_AutofocusFinal = true;
+    autofocusNextMove();
+}
+
+void FocuserInterface::stopAutofocus(IPState state, const char *reason)
+{
+    if (reason != nullptr)
+        DEBUGFDEVICE(m_defaultDevice->getDeviceName(), state == IPS_ALERT ? Logger::DBG_ERROR : Logger::DBG_SESSION, "%s",
+                     reason);
+
+    m_AutofocusStage = AUTOFOCUS_IDLE;
+    m_AutofocusTimer.stop();
+
+    if (FocusAutofocusFrameNP.getState() == IPS_BUSY)
+    {
+        FocusAutofocusFrameNP.setState(IPS_IDLE);
+        FocusAutofocusFrameNP.apply();
+    }
+    if (FocusAutofocusResultNP.getState() == IPS_BUSY)
+    {
+        FocusAutofocusResultNP.setState(IPS_IDLE);
+        FocusAutofocusResultNP.apply();
+    }
+    FocusAutofocusSP.reset();
+    FocusAutofocusSP.setState(state);
+    FocusAutofocusSP.apply();
+}
+
+bool fitFocusCurve(const std::vector<double> &positions, const std::vector<double> &hfrs, double &bestPosition,
+                   double &bestHFR)
+{
+    size_t n = std::min(positions.size(), hfrs.size());
+    if (n < 4)
+        return false;
+
+    // Positions about their mean and scaled to their spread, for a well conditioned system
+    double mean = 0, spread = 0;
+    for (size_t i = 0; i < n; i++)
+        mean += positions[i];
+    mean /= n;
+    for (size_t i = 0; i < n; i++)
+        spread = std::max(spread, std::abs(positions[i] - mean));
+    if (spread == 0)
+        return false;
+
+    // Normal equations of y = c0 + c1 u + c2 u^2, y = HFR^2
+    double s[5] = {0}, t[3] = {0};
+    for (size_t i = 0; i < n; i++)
+    {
+        double u = (positions[i] - mean) / spread, y = hfrs[i] * hfrs[i], p = 1;
+        for (int k = 0; k < 5; k++, p *= u)
+        {
+            s[k] += p;
+            if (k < 3)
+                t[k] += p * y;
+        }
+    }
+    double m[3][4] =
+    {
+        {s[0], s[1], s[2], t[0]},
+        {s[1], s[2], s[3], t[1]},
+        {s[2], s[3], s[4], t[2]}
+    };
+    for (int col = 0; col < 3; col++)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < 3; row++)
+            if (std::abs(m[row][col]) > std::abs(m[pivot][col]))
+                pivot = row;
+        if (std::abs(m[pivot][col]) < 1e-12)
+            return false;
+        std::swap(m[col], m[pivot]);
+        for (int row = 0; row < 3; row++)
+        {
+            if (row == col)
+                continue;
+            double f = m[row][col] / m[col][col];
+            for (int k = col; k < 4; k++)
+                m[row][k] -= f * m[col][k];
+        }
+    }
+    double c0 = m[0][3] / m[0][0], c1 = m[1][3] / m[1][1], c2 = m[2][3] / m[2][2];
+
+    // A minimum, between the extreme points
+    if (c2 <= 0)
+        return false;
+    double u = -c1 / (2 * c2);
+    double low = *std::min_element(positions.begin(), positions.begin() + n);
+    double high = *std::max_element(positions.begin(), positions.begin() + n);
+    bestPosition = mean + u * spread;
+    if (bestPosition < low || bestPosition > high)
+        return false;
+    bestHFR = std::sqrt(std::max(0.0, c0 + u * (c1 + u * c2)));
+    return true;
+}
+
+void FocuserInterface::filterOffsetRequest(const SnoopUpdate &update)
+{
+    if (update.state() != IPS_BUSY || !update.has(0) || !update.has(1) || !m_defaultDevice->isConnected())
+        return;
+
+    // A request is seen again when the wheel defines its properties again
+    uint32_t request = static_cast<uint32_t>(update.number(0));
+    if (request == m_FilterOffsetRequest)
+        return;
+    m_FilterOffsetRequest = request;
+
+    int steps = static_cast<int>(rint(update.number(1)));
+    FocusFilterOffsetNP[0].setValue(request);
+    FocusFilterOffsetNP[1].setValue(steps);
+
+    if (m_AutofocusStage != AUTOFOCUS_IDLE || m_FilterOffsetMoving)
+    {
+        DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_WARNING,
+                     "Focus offset of %d steps ignored, the focuser is busy.", steps);
+        filterOffsetAnswer(IPS_ALERT);
+        return;
+    }
+    if (steps == 0)
+    {
+        filterOffsetAnswer(IPS_OK);
+        return;
+    }
+
+    DEBUGFDEVICE(m_defaultDevice->getDeviceName(), Logger::DBG_SESSION, "Applying a focus offset of %d steps for %s.",
+                 steps, FocusFilterWheelTP[0].getText());
+
+    // As a client move would, filterOffsetTick waits for the driver to complete it
+    IPState state;
+    if (CanAbsMove())
+    {
+        uint32_t from = FocusAbsPosNP[0].getValue();
+        uint32_t target = std::max(FocusAbsPosNP[0].getMin(), std::min(FocusAbsPosNP[0].getValue() + steps,
+                                   FocusAbsPosNP[0].getMax()));
+        state = MoveAbsFocuser(target);
+        if (state == IPS_BUSY)
+            motionStarted(from, target);
+        else if (state == IPS_OK)
+            FocusAbsPosNP[0].setValue(target);
+        FocusAbsPosNP.setState(state);
+        FocusAbsPosNP.apply();
+    }
+    else
+    {
+        state = MoveRelFocuser(steps > 0 ? FOCUS_OUTWARD : FOCUS_INWARD, static_cast<uint32_t>(std::abs(steps)));
+        FocusRelPosNP[0].setValue(std::abs(steps));
+        FocusRelPosNP.setState(state);
+        FocusRelPosNP.apply();
+    }
+
+    if (state == IPS_BUSY)
+    {
+        m_FilterOffsetMoving = true;
+        m_FilterOffsetTimer.start();
+    }
+    filterOffsetAnswer(state);
+}
+
+void FocuserInterface::filterOffsetTick()
+{
+    IPState state = CanAbsMove() ? FocusAbsPosNP.getState() : FocusRelPosNP.getState();
+    if (state == IPS_BUSY)
+        return;
+
+    m_FilterOffsetTimer.stop();
+    m_FilterOffsetMoving = false;
+    filterOffsetAnswer(state == IPS_ALERT ? IPS_ALERT : IPS_OK);
+}
+
+void FocuserInterface::filterOffsetAnswer(IPState state)
+{
+    FocusFilterOffsetNP.setState(state);
+    FocusFilterOffsetNP.apply();
+}
+
 }
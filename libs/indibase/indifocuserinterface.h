@@ -24,7 +24,11 @@
 #include "indipropertynumber.h"
 #include "indipropertyswitch.h"
 #include "indipropertytext.h"
+#include "inditimer.h"
+#include "snooprouter.h"
 #include <stdint.h>
+#include <chrono>
+#include <vector>
 
 // Alias
 using FI = INDI::FocuserInterface;
@@ -48,6 +52,7 @@ namespace INDI
    <tr><td>FI::updateProperties</td><td>updateProperties()</td></tr>
    <tr><td>FI::processNumber</td><td>ISNewNumber(...) Check if the property name contains FOCUS_* and then call FI::processNumber(..) for such properties</td></tr>
    <tr><td>FI::processSwitch</td><td>ISNewSwitch(...)</td></tr>
+   <tr><td>FI::processText</td><td>ISNewText(...)</td></tr>
    </table>
 
    The interface supports three types of focusers:
@@ -58,6 +63,14 @@ namespace INDI
    + **DC Motor**: Focusers without any position feedback. The only way to reliably control them is by using timers and moving them for specific pulses in or
    out.
 
+   Absolute focusers also get an autofocus that leaves the images in the camera: at each point, the camera
+   named in FOCUS_AUTOFOCUS_CAMERA exposes and publishes the stars of the frame (see INDI::CCD, whose active
+   focuser must be this device). The best focus is fitted from the HFR of the points.
+
+   Absolute and relative focusers apply the focus offsets of the filter wheel named in FOCUS_FILTER_WHEEL (see
+   INDI::FilterInterface): on each filter change they move by the steps the wheel asks for in FILTER_FOCUS_MOVE,
+   while the wheel turns, and answer with FOCUS_FILTER_OFFSET.
+
    Implement and overwrite the rest of the virtual functions as needed. INDI GPhoto driver is a good example to check for an actual implementation
    of a focuser interface within a CCD driver.
 \author Jasem Mutlaq
@@ -178,6 +191,9 @@ class FocuserInterface
         /** \brief Process focus switch properties */
         bool processSwitch(const char * dev, const char * name, ISState * states, char * names[], int n);
 
+        /** \brief Process text properties */
+        bool processText(const char * dev, const char * name, char * texts[], char * names[], int n);
+
         /**
          * @brief SetFocuserSpeed Set Focuser speed
          * @param speed focuser speed
@@ -266,6 +282,47 @@ class FocuserInterface
          */
         bool saveConfigItems(FILE * fp);
 
+        /**
+         * @brief motionStarted Record the start of a move for the motion model. The interface calls it when
+         * MoveAbsFocuser or MoveRelFocuser return IPS_BUSY, drivers that start moves on their own may call it too.
+         * @param from Position the move starts at.
+         * @param to Target position.
+         */
+        void motionStarted(uint32_t from, uint32_t to);
+
+        /**
+         * @brief motionFinished Call when the device reports the move complete, so the duration of the move
+         * teaches the motion model. The interface calls it with completed false when the move is aborted.
+         * @param completed False if the move did not reach its target, it is not learned then.
+         */
+        void motionFinished(bool completed = true);
+
+        /**
+         * @brief resetMotionModel Forget the moves learned, e.g. when the speed or step mode changed.
+         * The interface calls it when the focuser speed is set.
+         */
+        void resetMotionModel();
+
+        /**
+         * @brief predictMotion Predict the move in progress from the moves learned before.
+         *
+         * The duration of a move is fitted as a fixed start and stop time, which covers the acceleration ramps,
+         * plus the steps divided by the cruise speed.
+         * @param position Predicted position now.
+         * @param remaining Milliseconds until the move should be complete, 0 if it should be.
+         * @return False if no move is in progress or nothing was learned yet.
+         */
+        bool predictMotion(uint32_t &position, uint32_t &remaining) const;
+
+        /**
+         * @brief updatePredictedPosition Publish the predicted position of a move in progress instead of polling the device.
+         * @param nextPoll Milliseconds until the driver should call again, the polling period or when the move
+         * should be complete if that is sooner.
+         * @return True if the device does not need to be polled now. False if the move should be complete or
+         * cannot be predicted, the driver polls the device as usual then.
+         */
+        bool updatePredictedPosition(uint32_t &nextPoll);
+
         // Focuser Speed (if variable speeds are supported)
         INDI::PropertyNumber FocusSpeedNP {1};
 
@@ -301,10 +358,117 @@ class FocuserInterface
         // Backlash steps
         INDI::PropertyNumber FocusBacklashNP {1};
 
+        // Autofocus: the camera whose stars are measured, the points of the run, start and abort
+        INDI::PropertyText FocusAutofocusCameraTP {1};
+        INDI::PropertyNumber FocusAutofocusSettingsNP {3};
+        enum
+        {
+            AF_STEP,
+            AF_POINTS,
+            AF_EXPOSURE
+        };
+        INDI::PropertySwitch FocusAutofocusSP {2};
+        enum
+        {
+            AF_START,
+            AF_ABORT
+        };
+        // The frame the camera should take now, it answers with CCD_FRAME_STARS
+        INDI::PropertyNumber FocusAutofocusFrameNP {2};
+        // Position and HFR of the best focus found by the last run
+        INDI::PropertyNumber FocusAutofocusResultNP {2};
+
+        // The filter wheel whose focus offsets are applied
+        INDI::PropertyText FocusFilterWheelTP {1};
+        // The last request of the wheel and the steps moved for it, busy while moving
+        INDI::PropertyNumber FocusFilterOffsetNP {2};
+
         uint32_t capability;
 
         double lastTimerValue = { 0 };
 
         DefaultDevice * m_defaultDevice { nullptr };
+
+    private:
+        struct MotionSample
+        {
+            double steps;
+            double seconds;
+        };
+        // Moves learned, the oldest is replaced first
+        std::vector<MotionSample> m_MotionSamples;
+        size_t m_NextMotionSample { 0 };
+        // Fitted seconds of a move = m_MotionOverhead + steps / m_MotionSpeed
+        double m_MotionOverhead { 0 };
+        double m_MotionSpeed { 0 };
+        bool m_MotionActive { false };
+        uint32_t m_MotionFrom { 0 };
+        uint32_t m_MotionTo { 0 };
+        std::chrono::steady_clock::time_point m_MotionStart;
+
+        /* Autofocus. The focuser steps outward through the points and, once each move is complete, asks the
+         * camera for a frame through FocusAutofocusFrameNP. The camera snoops it, exposes and publishes the
+         * stars of the frame as CCD_FRAME_STARS, which the focuser snoops in turn. No image is transferred.
+         */
+        struct AutofocusMove
+        {
+            uint32_t position;
+            bool measure;
+        };
+        enum AutofocusStage
+        {
+            AUTOFOCUS_IDLE,
+            AUTOFOCUS_MOVING,
+            AUTOFOCUS_EXPOSING
+        };
+        void startAutofocus();
+        void autofocusNextMove();
+        void autofocusTick();
+        void autofocusStars(const SnoopUpdate &update);
+        void autofocusFit();
+        void stopAutofocus(IPState state, const char *reason = nullptr);
+
+        AutofocusStage m_AutofocusStage { AUTOFOCUS_IDLE };
+        std::vector<AutofocusMove> m_AutofocusMoves;
+        size_t m_AutofocusNext { 0 };
+        // The moves to the best focus, or back to the start if there is none, after the points
+        bool m_AutofocusFinal { false };
+        IPState m_AutofocusOutcome { IPS_IDLE };
+        uint32_t m_AutofocusStart { 0 };
+        uint32_t m_AutofocusFrame { 0 };
+        std::vector<double> m_AutofocusPositions;
+        std::vector<double> m_AutofocusHFRs;
+        std::chrono::steady_clock::time_point m_AutofocusDeadline;
+        int m_AutofocusSnoop { -1 };
+        INDI::Timer m_AutofocusTimer;
+
+        /* Filter offsets. On a filter change, the wheel publishes the steps between the focus of both filters
+         * with a request number (FILTER_FOCUS_MOVE) and turns. The focuser snoops the request, moves, and
+         * publishes the number in FocusFilterOffsetNP, busy until its move is complete.
+         */
+        void filterOffsetRequest(const SnoopUpdate &update);
+        void filterOffsetTick();
+        void filterOffsetAnswer(IPState state);
+
+        uint32_t m_FilterOffsetRequest { 0 };
+        bool m_FilterOffsetMoving { false };
+        int m_FilterOffsetSnoop { -1 };
+        INDI::Timer m_FilterOffsetTimer;
 };
+
+/**
+ * @brief fitFocusCurve Find the best focus from the HFR of the stars at several focuser positions.
+ *
+ * Out of focus, the HFR of a star grows linearly with the distance to the focus, and the seeing rounds
+ * the bottom of the V: the curve is a hyperbola, HFR^2 = a (x - focus)^2 + b, a parabola in HFR^2
+ * which is fitted by least squares.
+ * @param positions Focuser positions.
+ * @param hfrs HFR measured at each position.
+ * @param bestPosition Fitted position of the best focus.
+ * @param bestHFR Fitted HFR at the best focus.
+ * @return False if there are fewer than 4 points, or the curve has no minimum between the first and
+ * last positions, when the points did not bracket the focus.
+ */
+bool fitFocusCurve(const std::vector<double> &positions, const std::vector<double> &hfrs, double &bestPosition,
+                   double &bestHFR);
 }
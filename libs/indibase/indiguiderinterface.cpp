@@ -19,8 +19,13 @@
 */
 
 #include "indiguiderinterface.h"
+#include "inditelescope.h"
 
+#include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace INDI
 {
@@ -37,6 +42,21 @@ GuiderInterface::GuiderInterface(DefaultDevice *device) : m_defaultDevice(device
 /////////////////////////////////////////////////////////////////////////////////////////////
 GuiderInterface::~GuiderInterface()
 {
+    if (m_GuidePulseThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_GuidePulseMutex);
+            m_GuidePulseQuit = true;
+        }
+        m_GuidePulseCondition.notify_one();
+        m_GuidePulseThread.join();
+    }
+
+    if (m_GuidePulseCallback != -1)
+        IERmCallback(m_GuidePulseCallback);
+    for (int fd : m_GuidePulsePipe)
+        if (fd != -1)
+            close(fd);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -53,6 +73,11 @@ void GuiderInterface::initProperties(const char *groupName)
     GuideWENP[DIRECTION_WEST].fill("TIMED_GUIDE_W", "West (ms)", "%.f", 0, 60000, 100, 0);
     GuideWENP[DIRECTION_EAST].fill("TIMED_GUIDE_E", "East (ms)", "%.f", 0, 60000, 100, 0);
     GuideWENP.fill(m_defaultDevice->getDeviceName(), "TELESCOPE_TIMED_GUIDE_WE", "Guide E/W", groupName, IP_RW, 60, IPS_IDLE);
+
+    GuidePulseAppliedNP[AXIS_DE].fill("APPLIED_NS", "N/S (ms)", "%.3f", 0, 60000, 0, 0);
+    GuidePulseAppliedNP[AXIS_RA].fill("APPLIED_WE", "E/W (ms)", "%.3f", 0, 60000, 0, 0);
+    GuidePulseAppliedNP.fill(m_defaultDevice->getDeviceName(), "GUIDE_PULSE_APPLIED", "Applied pulse", groupName, IP_RO, 60,
+                             IPS_IDLE);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -69,6 +94,11 @@ bool GuiderInterface::updateProperties()
     {
         m_defaultDevice->deleteProperty(GuideNSNP);
         m_defaultDevice->deleteProperty(GuideWENP);
+        if (m_GuidePulseAppliedDefined)
+        {
+            m_defaultDevice->deleteProperty(GuidePulseAppliedNP);
+            m_GuidePulseAppliedDefined = false;
+        }
     }
 
     return true;
@@ -86,6 +116,7 @@ bool GuiderInterface::processNumber(const char *dev, const char *name, double va
             //  We are being asked to send a guide pulse north/south on the st4 port
             GuideNSNP.update(values, names, n);
 
+            std::lock_guard<std::recursive_mutex> guard(m_GuideLock);
             if (GuideNSNP[DIRECTION_NORTH].getValue() != 0)
             {
                 GuideNSNP[DIRECTION_SOUTH].setValue(0);
@@ -103,13 +134,25 @@ bool GuiderInterface::processNumber(const char *dev, const char *name, double va
             //  We are being asked to send a guide pulse north/south on the st4 port
             GuideWENP.update(values, names, n);
 
+            double pulse = 0;
+            std::unique_lock<std::recursive_mutex> guard(m_GuideLock);
             if (GuideWENP[DIRECTION_WEST].getValue() != 0)
             {
                 GuideWENP[DIRECTION_EAST].setValue(0);
                 GuideWENP.setState(GuideWest(GuideWENP[DIRECTION_WEST].getValue()));
+                pulse = GuideWENP[DIRECTION_WEST].getValue();
             }
             else if (GuideWENP[DIRECTION_EAST].getValue() != 0)
+            {
                 GuideWENP.setState(GuideEast(GuideWENP[DIRECTION_EAST].getValue()));
+                pulse = -GuideWENP[DIRECTION_EAST].getValue();
+            }
+            guard.unlock();
+
+            // Mounts playing back PEC record the corrections
+            auto telescope = dynamic_cast<Telescope *>(m_defaultDevice);
+            if (telescope && pulse != 0 && GuideWENP.getState() != IPS_ALERT)
+                telescope->PECGuidePulse(pulse);
 
             GuideWENP.apply();
             return true;
@@ -119,6 +162,188 @@ bool GuiderInterface::processNumber(const char *dev, const char *name, double va
     return false;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////////////
+static int64_t timespecNs(const struct timespec &ts)
+{
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////////////
+void GuiderInterface::scheduleGuideStop(INDI_EQ_AXIS axis, uint32_t ms, const std::function<void()> &stopPulse)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (m_GuidePulseCallback == -1)
+    {
+        if (pipe(m_GuidePulsePipe) == -1)
+        {
+            IDLog("GuiderInterface: cannot create the guide pulse pipe: %s\n", strerror(errno));
+            return;
+        }
+        for (int fd : m_GuidePulsePipe)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        m_GuidePulseCallback = IEAddCallback(m_GuidePulsePipe[0], guidePulseDoneHelper, this);
+        m_GuidePulseThread = std::thread(&GuiderInterface::guidePulseThread, this);
+    }
+
+    int64_t deadline = timespecNs(start) + int64_t(ms) * 1000000;
+
+    std::lock_guard<std::recursive_mutex> guard(m_GuideLock);
+    {
+        std::lock_guard<std::mutex> lock(m_GuidePulseMutex);
+        GuidePulse &pulse = m_GuidePulse[axis];
+        pulse.pending = true;
+        pulse.done = false;
+        pulse.generation++;
+        pulse.start = start;
+        pulse.deadline.tv_sec = deadline / 1000000000;
+        pulse.deadline.tv_nsec = deadline % 1000000000;
+        pulse.stop = stopPulse;
+    }
+    m_GuidePulseCondition.notify_one();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////////////
+void GuiderInterface::cancelGuideStop(INDI_EQ_AXIS axis)
+{
+    // Waits for a stopPulse already running
+    std::lock_guard<std::recursive_mutex> guard(m_GuideLock);
+    std::lock_guard<std::mutex> lock(m_GuidePulseMutex);
+    GuidePulse &pulse = m_GuidePulse[axis];
+    pulse.pending = false;
+    pulse.done = false;
+    pulse.generation++;
+    pulse.stop = nullptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////////////
+bool GuiderInterface::isGuidePending(INDI_EQ_AXIS axis) const
+{
+    std::lock_guard<std::mutex> lock(m_GuidePulseMutex);
+    return m_GuidePulse[axis].pending || m_GuidePulse[axis].done;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////////////
+void GuiderInterface::guidePulseThread()
+{
+    std::unique_lock<std::mutex> lock(m_GuidePulseMutex);
+    while (!m_GuidePulseQuit)
+    {
+        int axis = -1;
+        for (int i = 0; i < 2; i++)
+            if (m_GuidePulse[i].pending && (axis == -1 ||
+                                            timespecNs(m_GuidePulse[i].deadline) < timespecNs(m_GuidePulse[axis].deadline)))
+                axis = i;
+
+        if (axis == -1)
+        {
+            m_GuidePulseCondition.wait(lock);
+            continue;
+        }
+
+        // Wait on the condition until shortly before the end, so that new pulses are noticed,
+        // then sleep to the end on the monotonic clock itself
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t remaining = timespecNs(m_GuidePulse[axis].deadline) - timespecNs(now);
+        if (remaining > GUIDE_PULSE_SLEEP_NS)
+        {
+            m_GuidePulseCondition.wait_for(lock, std::chrono::nanoseconds(remaining - GUIDE_PULSE_SLEEP_NS));
+            continue;
+        }
+
+        uint64_t generation = m_GuidePulse[axis].generation;
+        struct timespec deadline = m_GuidePulse[axis].deadline;
+        lock.unlock();
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+            ;
+
+        std::unique_lock<std::recursive_mutex> guard(m_GuideLock);
+        lock.lock();
+        GuidePulse &pulse = m_GuidePulse[axis];
+        // Replaced or cancelled meanwhile
+        if (!pulse.pending || pulse.generation != generation)
+            continue;
+
+        std::function<void()> stop = std::move(pulse.stop);
+        pulse.stop = nullptr;
+        pulse.pending = false;
+        lock.unlock();
+        if (stop)
+            stop();
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        guard.unlock();
+
+        lock.lock();
+        if (pulse.generation == generation)
+        {
+            pulse.done = true;
+            pulse.applied = (timespecNs(now) - timespecNs(pulse.start)) / 1e6;
+            if (write(m_GuidePulsePipe[1], "", 1) == -1 && errno != EAGAIN)
+                IDLog("GuiderInterface: cannot signal the guide pulse end: %s\n", strerror(errno));
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////////////
+void GuiderInterface::guidePulseDoneHelper(int fd, void *context)
+{
+    char buffer[16];
+    while (read(fd, buffer, sizeof(buffer)) > 0)
+        ;
+    static_cast<GuiderInterface *>(context)->guidePulseDone();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////////////
+void GuiderInterface::guidePulseDone()
+{
+    bool done[2] {};
+    {
+        std::lock_guard<std::mutex> lock(m_GuidePulseMutex);
+        for (int axis = 0; axis < 2; axis++)
+        {
+            done[axis] = m_GuidePulse[axis].done;
+            m_GuidePulse[axis].done = false;
+            if (done[axis])
+                GuidePulseAppliedNP[axis].setValue(m_GuidePulse[axis].applied);
+        }
+    }
+
+    if (!done[AXIS_RA] && !done[AXIS_DE])
+        return;
+
+    GuidePulseAppliedNP.setState(IPS_OK);
+    if (m_GuidePulseAppliedDefined)
+        GuidePulseAppliedNP.apply();
+    else if (m_defaultDevice->isConnected())
+    {
+        m_defaultDevice->defineProperty(GuidePulseAppliedNP);
+        m_GuidePulseAppliedDefined = true;
+    }
+
+    for (int axis = 0; axis < 2; axis++)
+        if (done[axis])
+            GuideComplete(static_cast<INDI_EQ_AXIS>(axis));
+}
+
 void GuiderInterface::GuideComplete(INDI_EQ_AXIS axis)
 {
     switch (axis)
@@ -41,11 +41,22 @@
  * GuideXXXX functions according to the driver. If there are no guide functions to process, the function will return
  * false so you can continue processing the properties down the chain.
  *
+ * Drivers timing the pulses themselves can start the pulse in GuideXXXX, call
+ * scheduleGuideStop() and return IPS_BUSY: the pulse is then ended by a dedicated thread
+ * sleeping on the monotonic clock, so a busy event loop does not lengthen it. The duration
+ * actually applied is reported in GUIDE_PULSE_APPLIED.
+ *
  * @author Jasem Mutlaq
  */
 
 #include <stdint.h>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include "defaultdevice.h"
+#include "inditimer.h"
 
 // Alias
 using GI = INDI::GuiderInterface;
@@ -120,10 +131,66 @@ class GuiderInterface
          */
         bool processNumber(const char *dev, const char *name, double values[], char *names[], int n);
 
+        /**
+         * @brief Ends the pulse just started on axis after ms milliseconds, counted from this call.
+         * When the pulse is due, stopPulse is called from the guide pulse thread to end it on the hardware,
+         * then GuideComplete(axis) is called from the event loop.
+         * A pulse still pending on the axis is cancelled first, without calling its stopPulse.
+         * stopPulse never runs while processNumber() is in a GuideXXXX function, so both can use the
+         * device without locking it.
+         * @param axis Axis of the pulse.
+         * @param ms Duration of the pulse in milliseconds.
+         * @param stopPulse Function ending the pulse.
+         */
+        void scheduleGuideStop(INDI_EQ_AXIS axis, uint32_t ms, const std::function<void()> &stopPulse);
+
+        /**
+         * @brief Cancels the pulse pending on axis, its stopPulse function is not called.
+         */
+        void cancelGuideStop(INDI_EQ_AXIS axis);
+
+        /**
+         * @return True while a pulse scheduled on axis has not ended.
+         */
+        bool isGuidePending(INDI_EQ_AXIS axis) const;
+
         INDI::PropertyNumber GuideNSNP {2};
         INDI::PropertyNumber GuideWENP {2};
+        // Duration of the last pulses ended by scheduleGuideStop(), defined with the first one
+        INDI::PropertyNumber GuidePulseAppliedNP {2};
 
     private:
+        struct GuidePulse
+        {
+            bool pending { false };
+            bool done { false };
+            uint64_t generation { 0 };
+            struct timespec start {};
+            struct timespec deadline {};
+            std::function<void()> stop;
+            double applied { 0 };
+        };
+
+        void guidePulseThread();
+        static void guidePulseDoneHelper(int fd, void *context);
+        void guidePulseDone();
+
         DefaultDevice *m_defaultDevice { nullptr };
+
+        // Held around the GuideXXXX functions and stopPulse, taken before m_GuidePulseMutex
+        std::recursive_mutex m_GuideLock;
+        mutable std::mutex m_GuidePulseMutex;
+        std::condition_variable m_GuidePulseCondition;
+        std::thread m_GuidePulseThread;
+        bool m_GuidePulseQuit { false };
+        // Indexed by INDI_EQ_AXIS
+        GuidePulse m_GuidePulse[2];
+        // Wakes the event loop when pulses are done
+        int m_GuidePulsePipe[2] { -1, -1 };
+        int m_GuidePulseCallback { -1 };
+        bool m_GuidePulseAppliedDefined { false };
+
+        // The last part of a pulse is slept with clock_nanosleep, a new pulse can be late by as much
+        static constexpr int64_t GUIDE_PULSE_SLEEP_NS { 1000000 };
 };
 }
@@ -0,0 +1,297 @@
+#if 0
+INDI Driver Functions
+
+This library is free software;
+you can redistribute it and / or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation;
+either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY;
+without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library;
+if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#endif
+
+#include "indilazygroup.h"
+
+#include "indibasetypes.h"
+#include "indicom.h"
+#include "indidevapi.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    char device[MAXINDIDEVICE];
+    char group[MAXINDIGROUP];
+    int lazy;
+    int defined;                /* a client asked for the properties */
+    int announced;              /* the switch was sent since the last getProperties */
+    ISwitch sw;
+    ISwitchVectorProperty svp;  /* the switch standing for the group */
+} Group;
+
+typedef struct
+{
+    Group *group;
+    char name[MAXINDINAME];
+    const void *ptr;
+    int type;
+    int withheld;
+} Member;
+
+static pthread_mutex_t lazy_mutex = PTHREAD_MUTEX_INITIALIZER;
+static Group **groups = NULL;   /* allocated one by one, the switches are sent by address */
+static atomic_int ngroups = 0;
+static Member *members = NULL;
+static int nmembers = 0;
+
+static Group *find_group(const char *dev, const char *group)
+{
+    for (int i = 0; i < ngroups; i++)
+        if (!strcmp(groups[i]->device, dev) && !strcmp(groups[i]->group, group))
+            return groups[i];
+    return NULL;
+}
+
+static Member *find_member(const char *dev, const char *name)
+{
+    for (int i = 0; i < nmembers; i++)
+        if (!strcmp(members[i].group->device, dev) && !strcmp(members[i].name, name))
+            return &members[i];
+    return NULL;
+}
+
+static int group_empty(const Group *g)
+{
+    for (int i = 0; i < nmembers; i++)
+        if (members[i].group == g)
+            return 0;
+    return 1;
+}
+
+static void define(const void *ptr, int type)
+{
+    switch (type)
+    {
+        case INDI_NUMBER:
+            IDDefNumber((const INumberVectorProperty *)ptr, NULL);
+            break;
+        case INDI_SWITCH:
+            IDDefSwitch((const ISwitchVectorProperty *)ptr, NULL);
+            break;
+        case INDI_TEXT:
+            IDDefText((const ITextVectorProperty *)ptr, NULL);
+            break;
+        case INDI_LIGHT:
+            IDDefLight((const ILightVectorProperty *)ptr, NULL);
+            break;
+        case INDI_BLOB:
+            IDDefBLOB((const IBLOBVectorProperty *)ptr, NULL);
+            break;
+        default:
+            break;
+    }
+}
+
+/* define the withheld properties of g in the order they came. called with lazy_mutex held, releases it. */
+static void define_group(Group *g)
+{
+    Member *pending = NULL;
+    int npending = 0;
+    int announced = g->announced;
+
+    g->defined = 1;
+    g->announced = 0;
+    for (int i = 0; i < nmembers; i++)
+    {
+        if (members[i].group != g || !members[i].withheld)
+            continue;
+        members[i].withheld = 0;
+        assert_mem(pending = (Member *)realloc(pending, (npending + 1) * sizeof(Member)));
+        pending[npending++] = members[i];
+    }
+    pthread_mutex_unlock(&lazy_mutex);
+
+    if (announced)
+        IDDelete(g->device, g->svp.name, NULL);
+    for (int i = 0; i < npending; i++)
+        define(pending[i].ptr, pending[i].type);
+    free(pending);
+}
+
+int lazy_withhold(const char *dev, const char *name, const char *group, const void *ptr, int type)
+{
+    if (ngroups == 0)
+        return 0;
+
+    pthread_mutex_lock(&lazy_mutex);
+    Group *g = find_group(dev, group);
+    if (g == NULL || !g->lazy || ptr == &g->svp)
+    {
+        pthread_mutex_unlock(&lazy_mutex);
+        return 0;
+    }
+
+    Member *m = find_member(dev, name);
+    if (m == NULL)
+    {
+        assert_mem(members = (Member *)realloc(members, (nmembers + 1) * sizeof(Member)));
+        m = &members[nmembers++];
+        snprintf(m->name, sizeof(m->name), "%s", name);
+    }
+    m->group    = g;
+    m->ptr      = ptr;
+    m->type     = type;
+    m->withheld = !g->defined;
+
+    int withhold = m->withheld;
+    int announce = withhold && !g->announced;
+    if (announce)
+        g->announced = 1;
+    pthread_mutex_unlock(&lazy_mutex);
+
+    if (announce)
+        IDDefSwitch(&g->svp, NULL);
+    return withhold;
+}
+
+int lazy_withheld(const char *dev, const char *name)
+{
+    if (ngroups == 0)
+        return 0;
+
+    pthread_mutex_lock(&lazy_mutex);
+    Member *m = find_member(dev, name);
+    int withheld = m != NULL && m->withheld;
+    pthread_mutex_unlock(&lazy_mutex);
+    return withheld;
+}
+
+int lazy_request(const char *dev, const char *name, int withMembers)
+{
+    if (ngroups == 0)
+        return 0;
+
+    pthread_mutex_lock(&lazy_mutex);
+    for (int i = 0; i < ngroups; i++)
+    {
+        Group *g = groups[i];
+        if (strcmp(g->device, dev) || strcmp(g->svp.name, name))
+            continue;
+        /* the switch only exists while the group is not defined */
+        if (g->defined)
+            pthread_mutex_unlock(&lazy_mutex);
+        else
+            define_group(g);
+        return 1;
+    }
+
+    Member *m = withMembers ? find_member(dev, name) : NULL;
+    if (m == NULL || !m->withheld)
+    {
+        pthread_mutex_unlock(&lazy_mutex);
+        return 0;
+    }
+    define_group(m->group);
+    return 1;
+}
+
+void lazy_reset(const char *dev)
+{
+    if (ngroups == 0)
+        return;
+
+    pthread_mutex_lock(&lazy_mutex);
+    for (int i = 0; i < ngroups; i++)
+        if (dev == NULL || !strcmp(groups[i]->device, dev))
+            groups[i]->announced = 0;
+    pthread_mutex_unlock(&lazy_mutex);
+}
+
+void lazy_remove(const char *dev, const char *name)
+{
+    if (ngroups == 0)
+        return;
+
+    char stub[MAXINDINAME] = "";
+    Group *g = NULL;
+
+    pthread_mutex_lock(&lazy_mutex);
+    for (int i = 0; i < nmembers;)
+    {
+        Member *m = &members[i];
+        if ((dev == NULL || !strcmp(m->group->device, dev)) && (name == NULL || !strcmp(m->name, name)))
+        {
+            g = m->group;
+            memmove(m, m + 1, (--nmembers - i) * sizeof(Member));
+        }
+        else
+            i++;
+    }
+
+    /* a group left without properties is lazy again, and its switch goes away with them */
+    for (int i = 0; i < ngroups; i++)
+    {
+        Group *other = groups[i];
+        if ((dev != NULL && strcmp(other->device, dev)) || (name != NULL && other != g) || !group_empty(other))
+            continue;
+        if (other->announced && name != NULL)
+            snprintf(stub, sizeof(stub), "%s", other->svp.name);
+        other->defined = other->announced = 0;
+    }
+    pthread_mutex_unlock(&lazy_mutex);
+
+    if (stub[0])
+        IDDelete(dev, stub, NULL);
+}
+
+void IDSetLazyGroup(const char *dev, const char *group, int lazy)
+{
+    pthread_mutex_lock(&lazy_mutex);
+    Group *g = find_group(dev, group);
+    if (g == NULL)
+    {
+        if (!lazy)
+        {
+            pthread_mutex_unlock(&lazy_mutex);
+            return;
+        }
+
+        assert_mem(g = (Group *)calloc(1, sizeof(Group)));
+        snprintf(g->device, sizeof(g->device), "%s", dev);
+        snprintf(g->group, sizeof(g->group), "%s", group);
+
+        char name[MAXINDINAME];
+        int len = snprintf(name, sizeof(name), "LAZY_%s", group);
+        for (int i = 5; i < len && i < (int)sizeof(name) - 1; i++)
+            if (!isalnum((unsigned char)name[i]))
+                name[i] = '_';
+        IUFillSwitch(&g->sw, "DEFINE", "Show", ISS_OFF);
+        IUFillSwitchVector(&g->svp, &g->sw, 1, dev, name, "Properties", group, IP_RW, ISR_NOFMANY, 0, IPS_IDLE);
+
+        assert_mem(groups = (Group **)realloc(groups, (ngroups + 1) * sizeof(Group *)));
+        groups[ngroups] = g;
+        ngroups++;
+    }
+
+    g->lazy = lazy;
+    if (lazy)
+        pthread_mutex_unlock(&lazy_mutex);
+    else
+        define_group(g);
+}
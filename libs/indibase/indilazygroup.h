@@ -0,0 +1,57 @@
+#if 0
+INDI Driver Functions
+
+This library is free software;
+you can redistribute it and / or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation;
+either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY;
+without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library;
+if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#endif
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Groups of properties defined when a client asks for them, see IDSetLazyGroup().
+ * The properties of a lazy group are remembered as they are defined, and the client is sent instead
+ * one switch vector per group. Setting that switch, or naming it or one of the properties in a
+ * getProperties, defines the properties of the group with their current values.
+ */
+
+/* Return 1 if the definition of property name of device dev, of the given type, is withheld,
+ * having sent the switch of its group if needed.
+ */
+int lazy_withhold(const char *dev, const char *name, const char *group, const void *ptr, int type);
+
+/* Return 1 if property name of device dev is in a lazy group that was not defined yet */
+int lazy_withheld(const char *dev, const char *name);
+
+/* Define the group of the switch name of device dev, or with members also the group of the
+ * withheld property name. Return 1 if there was such a group.
+ */
+int lazy_request(const char *dev, const char *name, int members);
+
+/* A getProperties for device dev, or all devices if NULL: the switches are sent again */
+void lazy_reset(const char *dev);
+
+/* Forget property name of device dev, or all those of the device if name is NULL */
+void lazy_remove(const char *dev, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -20,12 +20,22 @@
 
 #include "indilogger.h"
 #include "indiutility.h"
+#include "userio.h"
+#include "indiuserio.h"
+#include "indidriverio.h"
 
 #include <dirent.h>
+#include <algorithm>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <sys/stat.h>
 
 namespace INDI
@@ -60,10 +70,10 @@ ISwitch Logger::ConfigurationS[2];
 ISwitchVectorProperty Logger::ConfigurationSP;
 
 INDI::DefaultDevice *Logger::parentDevice  = nullptr;
-unsigned int Logger::fileVerbosityLevel_   = Logger::defaultlevel;
-unsigned int Logger::screenVerbosityLevel_ = Logger::defaultlevel;
+std::atomic<unsigned int> Logger::fileVerbosityLevel_ {Logger::defaultlevel};
+std::atomic<unsigned int> Logger::screenVerbosityLevel_ {Logger::defaultlevel};
 unsigned int Logger::rememberscreenlevel_  = Logger::defaultlevel;
-Logger::loggerConf Logger::configuration_  = Logger::screen_on | Logger::file_off;
+std::atomic<Logger::loggerConf> Logger::configuration_ {Logger::screen_on | Logger::file_off};
 std::string Logger::logDir_;
 std::string Logger::logFile_;
 unsigned int Logger::nDevices    = 0;
@@ -227,21 +237,18 @@ bool Logger::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
 
         bool wasFileOff = configuration_ & file_off;
 
-        configuration_ = (loggerConf)0;
-
-        if (ConfigurationS[1].s == ISS_ON)
-            configuration_ = configuration_ | file_on;
-        else
-            configuration_ = configuration_ | file_off;
+        loggerConf configuration = (ConfigurationS[1].s == ISS_ON) ? file_on : file_off;
 
         if (ConfigurationS[0].s == ISS_ON)
-            configuration_ = configuration_ | screen_on;
+            configuration = configuration | screen_on;
         else
-            configuration_ = configuration_ | screen_off;
+            configuration = configuration | screen_off;
+
+        configuration_ = configuration;
 
         // If file was off, then on again
-        if (wasFileOff && (configuration_ & file_on))
-            Logger::getInstance().configure(logFile_, configuration_, fileVerbosityLevel_, screenVerbosityLevel_);
+        if (wasFileOff && (configuration & file_on))
+            Logger::getInstance().configure(logFile_, configuration, fileVerbosityLevel_, screenVerbosityLevel_);
 
         ConfigurationSP.s = IPS_OK;
         IDSetSwitch(&ConfigurationSP, nullptr);
@@ -275,16 +282,230 @@ void Logger::unlock()
 }
 #endif
 
+struct Logger::LogEntry
+{
+    uint64_t sequence;
+    struct timeval time;
+    unsigned int level;
+    bool file;
+    bool screen;
+    char device[MAXINDIDEVICE];
+    char message[257];
+};
+
+namespace
+{
+// Debug messages of one thread waiting for the writer, and lock-free: the thread only moves head, the writer only tail
+struct LogRing
+{
+    static constexpr size_t Size = 256;
+    std::unique_ptr<Logger::LogEntry[]> entries {new Logger::LogEntry[Size]};
+    std::atomic<size_t> head {0};
+    std::atomic<size_t> tail {0};
+    std::atomic<unsigned int> dropped {0};
+    // The thread exited, the ring goes once it is empty
+    std::atomic<bool> orphaned {false};
+};
+
+struct LogQueue
+{
+    // Held while writing, so messages come out in order
+    std::mutex writeLock;
+    std::condition_variable wake;
+    std::atomic<uint64_t> sequence {0};
+
+    std::mutex ringsLock;
+    std::vector<std::shared_ptr<LogRing>> rings;
+
+    // Reused by drain()
+    std::vector<std::pair<std::shared_ptr<LogRing>, size_t>> draining;
+    std::vector<const Logger::LogEntry *> pending;
+    std::string text;
+};
+
+// Never destroyed, the writer thread and the rings of other threads may outlive the statics at exit
+LogQueue &logQueue()
+{
+    static LogQueue *queue = new LogQueue;
+    return *queue;
+}
+
+class RingHolder
+{
+    public:
+        ~RingHolder()
+        {
+            if (m_Ring)
+                m_Ring->orphaned = true;
+        }
+
+        template <typename StartWriter>
+        LogRing *get(std::once_flag &writerStarted, StartWriter startWriter)
+        {
+            if (!m_Ring)
+            {
+                std::call_once(writerStarted, startWriter);
+                m_Ring = std::make_shared<LogRing>();
+                LogQueue &queue = logQueue();
+                std::lock_guard<std::mutex> lock(queue.ringsLock);
+                queue.rings.push_back(m_Ring);
+            }
+            return m_Ring.get();
+        }
+
+    private:
+        std::shared_ptr<LogRing> m_Ring;
+};
+
+thread_local RingHolder threadRing;
+std::once_flag writerStarted;
+}
+
 Logger::Logger() : configured_(false)
 {
     gettimeofday(&initialTime_, nullptr);
 }
 
+void Logger::writer()
+{
+    LogQueue &queue = logQueue();
+    std::unique_lock<std::mutex> lock(queue.writeLock);
+    for (;;)
+    {
+        // Woken early when a ring fills up, otherwise messages wait at most this long
+        queue.wake.wait_for(lock, std::chrono::milliseconds(20));
+        drain();
+    }
+}
+
+void Logger::flush()
+{
+    std::lock_guard<std::mutex> lock(logQueue().writeLock);
+    drain();
+}
+
+void Logger::drain()
+{
+    LogQueue &queue = logQueue();
+    queue.draining.clear();
+    queue.pending.clear();
+    unsigned int dropped = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(queue.ringsLock);
+        auto &rings = queue.rings;
+        for (auto it = rings.begin(); it != rings.end();)
+        {
+            LogRing &ring = **it;
+            size_t head = ring.head.load(std::memory_order_acquire);
+            size_t tail = ring.tail.load(std::memory_order_relaxed);
+            if (head == tail && ring.orphaned)
+            {
+                it = rings.erase(it);
+                continue;
+            }
+            for (size_t i = tail; i != head; i++)
+                queue.pending.push_back(&ring.entries[i % LogRing::Size]);
+            dropped += ring.dropped.exchange(0);
+            queue.draining.emplace_back(*it, head);
+            ++it;
+        }
+    }
+
+    std::sort(queue.pending.begin(), queue.pending.end(), [](const LogEntry * a, const LogEntry * b)
+    {
+        return a->sequence < b->sequence;
+    });
+
+    if (!queue.pending.empty())
+        output(queue.pending.data(), queue.pending.size());
+
+    // The entries written can now be reused by their threads
+    for (auto &ring : queue.draining)
+        ring.first->tail.store(ring.second, std::memory_order_release);
+    queue.draining.clear();
+
+    if (dropped > 0)
+    {
+        LogEntry entry;
+        entry.sequence = queue.sequence++;
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        timersub(&now, &initialTime_, &entry.time);
+        entry.level = DBG_WARNING;
+        entry.file = (configuration_ & file_on) && (fileVerbosityLevel_ & DBG_WARNING);
+        entry.screen = (configuration_ & screen_on) && (screenVerbosityLevel_ & DBG_WARNING);
+        entry.device[0] = '\0';
+        if (parentDevice != nullptr)
+            strncpy(entry.device, parentDevice->getDeviceName(), MAXINDIDEVICE - 1);
+        entry.device[MAXINDIDEVICE - 1] = '\0';
+        snprintf(entry.message, sizeof(entry.message), "%u debug messages were dropped, logging could not keep up.", dropped);
+        const LogEntry *one = &entry;
+        output(&one, 1);
+    }
+}
+
+void Logger::output(const LogEntry *const *entries, size_t count)
+{
+    LogQueue &queue = logQueue();
+    std::string &text = queue.text;
+    text.clear();
+    bool screen = false;
+    char prefix[64];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const LogEntry *entry = entries[i];
+        screen |= entry->screen;
+        if (!entry->file || !out_.is_open())
+            continue;
+
+        snprintf(prefix, sizeof(prefix), "\t%ld.%06ld sec\t: ", static_cast<long>(entry->time.tv_sec),
+                 static_cast<long>(entry->time.tv_usec));
+        text += Tags[rank(entry->level)];
+        text += prefix;
+        if (nDevices != 1)
+        {
+            text += '[';
+            text += entry->device;
+            text += "] ";
+        }
+        text += entry->message;
+        text += '\n';
+    }
+
+    if (!text.empty())
+    {
+        out_ << text;
+        out_.flush();
+    }
+
+    if (!screen)
+        return;
+
+    // All the messages go to the clients in one write
+    driverio io;
+    driverio_init(&io);
+    userio_xmlv1(&io.userio, io.user);
+    for (size_t i = 0; i < count; i++)
+    {
+        const LogEntry *entry = entries[i];
+        if (entry->screen)
+            IDUserIOMessage(&io.userio, io.user, entry->device[0] ? entry->device : nullptr, "[%s] %s",
+                            Tags[rank(entry->level)], entry->message);
+    }
+    driverio_finish(&io);
+}
+
 void Logger::configure(const std::string &outputFile, const loggerConf configuration, const int fileVerbosityLevel,
                        const int screenVerbosityLevel)
 {
     Logger::lock();
 
+    // Buffered messages go where they were meant to
+    std::lock_guard<std::mutex> guard(logQueue().writeLock);
+    drain();
+
     fileVerbosityLevel_   = fileVerbosityLevel;
     screenVerbosityLevel_ = screenVerbosityLevel;
     rememberscreenlevel_  = screenVerbosityLevel_;
@@ -379,48 +600,83 @@ void Logger::print(const char *devicename, const unsigned int verbosityLevel, co
 
     INDI_UNUSED(file);
     INDI_UNUSED(line);
-    bool filelog   = (verbosityLevel & fileVerbosityLevel_) != 0;
-    bool screenlog = (verbosityLevel & screenVerbosityLevel_) != 0;
+    loggerConf configuration = configuration_.load(std::memory_order_relaxed);
+    bool filelog   = (configuration & file_on) && (verbosityLevel & fileVerbosityLevel_.load(std::memory_order_relaxed)) != 0;
+    bool screenlog = (configuration & screen_on) && (verbosityLevel & screenVerbosityLevel_.load(std::memory_order_relaxed)) != 0;
 
-    va_list ap;
-    char msg[257];
-    char usec[7];
+    // Nothing to format when the message goes nowhere, debug logging in loops costs nothing while it is off
+    if (configured_ && !filelog && !screenlog)
+        return;
 
-    msg[256] = '\0';
-    va_start(ap, message);
-    vsnprintf(msg, 257, message, ap);
-    va_end(ap);
+    va_list ap;
 
     if (!configured_)
     {
+        char msg[257];
+        va_start(ap, message);
+        vsnprintf(msg, sizeof(msg), message, ap);
+        va_end(ap);
         //std::cerr << "Warning! Logger not configured!" << std::endl;
         std::cerr << msg << std::endl;
         return;
     }
-    struct timeval currentTime, resTime;
-    usec[6] = '\0';
-    gettimeofday(&currentTime, nullptr);
-    timersub(&currentTime, &initialTime_, &resTime);
-#if defined(__APPLE__)
-    snprintf(usec, 7, "%06d", resTime.tv_usec);
-#else
-    snprintf(usec, 7, "%06ld", resTime.tv_usec);
-#endif
-    Logger::lock();
 
-    if ((configuration_ & file_on) && filelog)
+    LogQueue &queue = logQueue();
+    bool buffered = rank(verbosityLevel) > rank(DBG_SESSION);
+
+    // Errors, warnings and session messages are written right away, debug messages go to the ring of the thread
+    LogEntry local;
+    LogRing *ring = nullptr;
+    size_t head = 0, used = 0;
+    LogEntry *entry = &local;
+    if (buffered)
     {
-        if (nDevices == 1)
-            out_ << Tags[rank(verbosityLevel)] << "\t" << (resTime.tv_sec) << "." << (usec) << " sec"
-                 << "\t: " << msg << std::endl;
-        else
-            out_ << Tags[rank(verbosityLevel)] << "\t" << (resTime.tv_sec) << "." << (usec) << " sec"
-                 << "\t: [" << devicename << "] " << msg << std::endl;
+        ring = threadRing.get(writerStarted, [this]()
+        {
+            std::thread(&Logger::writer, this).detach();
+            std::atexit([]()
+            {
+                if (m_ != nullptr)
+                    m_->flush();
+            });
+        });
+        head = ring->head.load(std::memory_order_relaxed);
+        used = head - ring->tail.load(std::memory_order_acquire);
+        if (used >= LogRing::Size)
+        {
+            ring->dropped++;
+            queue.wake.notify_one();
+            return;
+        }
+        entry = &ring->entries[head % LogRing::Size];
     }
 
-    if ((configuration_ & screen_on) && screenlog)
-        IDMessage(devicename, "[%s] %s", Tags[rank(verbosityLevel)], msg);
+    va_start(ap, message);
+    vsnprintf(entry->message, sizeof(entry->message), message, ap);
+    va_end(ap);
 
-    Logger::unlock();
+    struct timeval currentTime;
+    gettimeofday(&currentTime, nullptr);
+    timersub(&currentTime, &initialTime_, &entry->time);
+    entry->sequence = queue.sequence.fetch_add(1, std::memory_order_relaxed);
+    entry->level = verbosityLevel;
+    entry->file = filelog;
+    entry->screen = screenlog;
+    strncpy(entry->device, devicename ? devicename : "", MAXINDIDEVICE - 1);
+    entry->device[MAXINDIDEVICE - 1] = '\0';
+
+    if (buffered)
+    {
+        ring->head.store(head + 1, std::memory_order_release);
+        if (used + 1 >= LogRing::Size / 2)
+            queue.wake.notify_one();
+        return;
+    }
+
+    // Debug messages logged before this one come out first
+    std::lock_guard<std::mutex> guard(queue.writeLock);
+    drain();
+    const LogEntry *one = entry;
+    output(&one, 1);
 }
 }
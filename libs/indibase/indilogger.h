@@ -24,6 +24,7 @@
 #include "defaultdevice.h"
 
 #include <stdarg.h>
+#include <atomic>
 #include <fstream>
 #include <ostream>
 #include <string>
@@ -109,10 +110,20 @@ namespace INDI
  *
  * To add a new debug level, call addDebugLevel(). You can add an additional 4 custom debug/logging levels.
  *
+ * Errors, warnings and session messages are written as they are logged. Messages of the debug levels are only
+ * formatted into a buffer of the thread logging them, a background thread writes them to the log file and sends
+ * them to the clients in batches, so debug logging does not slow the driver down. Each thread buffers up to
+ * 256 debug messages, more are dropped and counted until the writer catches up.
+ *
  * Check INDI Tutorial two for an example simple implementation.
  */
 class Logger
 {
+    public:
+        /// A formatted message waiting to be written, internal to print()
+        struct LogEntry;
+
+    private:
         /** Type used for the configuration */
         enum loggerConf_
         {
@@ -149,16 +160,16 @@ class Logger
          * file is enabled, it means that the logger has been already configured, therefore the
          * stream is already open.
          */
-        static loggerConf_ configuration_;
+        static std::atomic<loggerConf_> configuration_;
 
         /// Stream used when logging on a file
         std::ofstream out_;
         /// Initial time (used to print relative times)
         struct timeval initialTime_;
         /// Verbosity threshold for files
-        static unsigned int fileVerbosityLevel_;
+        static std::atomic<unsigned int> fileVerbosityLevel_;
         /// Verbosity threshold for screen
-        static unsigned int screenVerbosityLevel_;
+        static std::atomic<unsigned int> screenVerbosityLevel_;
         static unsigned int rememberscreenlevel_;
 
         /**
@@ -185,6 +196,13 @@ class Logger
 
         static INDI::DefaultDevice *parentDevice;
 
+        /** Write the debug messages buffered by the threads, in the order they were logged. The write lock must be held. */
+        void drain();
+        /** Write messages to the log file and send them to the clients at once. */
+        void output(const LogEntry *const *entries, size_t count);
+        /** Body of the background writer thread. */
+        void writer();
+
     public:
         enum VerbosityLevel
         {
@@ -267,6 +285,11 @@ class Logger
         void configure(const std::string &outputFile, const loggerConf configuration, const int fileVerbosityLevel,
                        const int screenVerbosityLevel);
 
+        /**
+         * @brief flush Write the buffered debug messages now, e.g. before the driver exits.
+         */
+        void flush();
+
         static struct switchinit DebugLevelSInit[nlevels];
         static ISwitch DebugLevelS[nlevels];
         static ISwitchVectorProperty DebugLevelSP;
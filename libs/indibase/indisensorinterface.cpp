@@ -27,6 +27,8 @@
 #include "stream/streammanager.h"
 #include "locale_compat.h"
 #include "indiutility.h"
+#include "sharedblob.h"
+#include "pixel/pixelkernels.h"
 
 #include <fitsio.h>
 
@@ -104,6 +106,7 @@ bool SensorInterface::updateProperties()
         defineProperty(&TelescopeTypeSP);
 
         defineProperty(&UploadSP);
+        defineProperty(&TransferFormatSP);
 
         if (UploadSettingsT[UPLOAD_DIR].text == nullptr)
             IUSaveText(&UploadSettingsT[UPLOAD_DIR], getenv("HOME"));
@@ -124,6 +127,7 @@ bool SensorInterface::updateProperties()
         deleteProperty(TelescopeTypeSP.name);
 
         deleteProperty(UploadSP.name);
+        deleteProperty(TransferFormatSP.name);
         deleteProperty(UploadSettingsTP.name);
     }
 
@@ -328,6 +332,14 @@ bool SensorInterface::processSwitch(const char *dev, const char *name, ISState *
             return true;
         }
 
+        if (!strcmp(name, TransferFormatSP.name))
+        {
+            IUUpdateSwitch(&TransferFormatSP, states, names, n);
+            TransferFormatSP.s = IPS_OK;
+            IDSetSwitch(&TransferFormatSP, nullptr);
+            return true;
+        }
+
         if (!strcmp(name, TelescopeTypeSP.name))
         {
             IUUpdateSwitch(&TelescopeTypeSP, states, names, n);
@@ -421,6 +433,12 @@ bool SensorInterface::initProperties()
     IUFillSwitchVector(&UploadSP, UploadS, 3, getDeviceName(), "UPLOAD_MODE", "Upload", OPTIONS_TAB, IP_RW, ISR_1OFMANY,
                        0, IPS_IDLE);
 
+    // Transfer Format
+    IUFillSwitch(&TransferFormatS[FORMAT_FITS], "FORMAT_FITS", "FITS", ISS_ON);
+    IUFillSwitch(&TransferFormatS[FORMAT_RAW], "FORMAT_RAW", "Raw", ISS_OFF);
+    IUFillSwitchVector(&TransferFormatSP, TransferFormatS, 2, getDeviceName(), "SENSOR_TRANSFER_FORMAT", "Transfer",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
     // Upload Settings
     IUFillText(&UploadSettingsT[UPLOAD_DIR], "UPLOAD_DIR", "Dir", "");
     IUFillText(&UploadSettingsT[UPLOAD_PREFIX], "UPLOAD_PREFIX", "Prefix", "INTEGRATION_XXX");
@@ -547,7 +565,10 @@ void SensorInterface::setBufferSize(int nbuf, bool allocMem)
 
     // DSP
     if (HasDSP())
-        DSP->setSizes(1, new int[1] { BufferSize * 8 / getBPS() });
+    {
+        int size = BufferSize * 8 / abs(getBPS());
+        DSP->setSizes(1, &size);
+    }
 
     if (allocMem == false)
         return;
@@ -753,10 +774,8 @@ void SensorInterface::fits_update_key_s(fitsfile *fptr, int type, std::string na
     fits_update_key(fptr, type, name.c_str(), p, const_cast<char *>(explanation.c_str()), status);
 }
 
-void* SensorInterface::sendFITS(uint8_t *buf, int len)
+void* SensorInterface::sendFITS(uint8_t *buf, int len, bool sendIntegration, bool saveIntegration)
 {
-    bool sendIntegration = (UploadS[0].s == ISS_ON || UploadS[2].s == ISS_ON);
-    bool saveIntegration = (UploadS[1].s == ISS_ON || UploadS[2].s == ISS_ON);
     fitsfile *fptr = nullptr;
     void *memptr;
     size_t memsize;
@@ -820,13 +839,13 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
 
     //  Now we have to send fits format data to the client
     memsize = 5760;
-    memptr  = malloc(memsize);
+    memptr  = IDSharedBlobAlloc(memsize);
     if (!memptr)
     {
         DEBUGF(Logger::DBG_ERROR, "Error: failed to allocate memory: %lu", static_cast<unsigned long>(memsize));
     }
 
-    fits_create_memfile(&fptr, &memptr, &memsize, 2880, realloc, &status);
+    fits_create_memfile(&fptr, &memptr, &memsize, 2880, IDSharedBlobRealloc, &status);
 
     if (status)
     {
@@ -834,7 +853,7 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
         fits_get_errstatus(status, error_status);
         DEBUGF(Logger::DBG_ERROR, "FITS Error: %s", error_status);
         if(memptr != nullptr)
-            free(memptr);
+            IDSharedBlobFree(memptr);
         return nullptr;
     }
 
@@ -846,7 +865,7 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
         fits_get_errstatus(status, error_status);
         DEBUGF(Logger::DBG_ERROR, "FITS Error: %s", error_status);
         if(memptr != nullptr)
-            free(memptr);
+            IDSharedBlobFree(memptr);
         return nullptr;
     }
 
@@ -860,7 +879,7 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
         fits_get_errstatus(status, error_status);
         DEBUGF(Logger::DBG_ERROR, "FITS Error: %s", error_status);
         if(memptr != nullptr)
-            free(memptr);
+            IDSharedBlobFree(memptr);
         return nullptr;
     }
 
@@ -876,12 +895,11 @@ bool SensorInterface::IntegrationComplete()
     // Reset POLLMS to default value
     setCurrentPollingPeriod(getPollingPeriod());
 
-    if(HasDSP())
+    // The plugins only read the buffer
+    if (HasDSP() && DSP->isActive())
     {
-        uint8_t* buf = (uint8_t*)malloc(getBufferSize());
-        memcpy(buf, getBuffer(), getBufferSize());
-        DSP->processBLOB(buf, 1, new int[1] { getBufferSize() * 8 / getBPS() }, getBPS());
-        free(buf);
+        int size = getBufferSize() * 8 / abs(getBPS());
+        DSP->processBLOB(getBuffer(), 1, &size, getBPS());
     }
     // Run async
     std::thread(&SensorInterface::IntegrationCompletePrivate, this).detach();
@@ -898,9 +916,19 @@ bool SensorInterface::IntegrationCompletePrivate()
     if (sendIntegration || saveIntegration)
     {
         void* blob = nullptr;
+        void* raw  = nullptr;
         if (!strcmp(getIntegrationFileExtension(), "fits"))
         {
-            blob = sendFITS(getBuffer(), getBufferSize() * 8 / abs(getBPS()));
+            int len = getBufferSize() * 8 / abs(getBPS());
+            if (sendIntegration && TransferFormatS[FORMAT_RAW].s == ISS_ON)
+            {
+                // FITS is only built to save the integration, the client gets the raw block
+                if (saveIntegration)
+                    blob = sendFITS(getBuffer(), len, false, true);
+                raw = sendRaw(getBuffer(), len);
+            }
+            else
+                blob = sendFITS(getBuffer(), len, sendIntegration, saveIntegration);
         }
         else
         {
@@ -911,7 +939,9 @@ bool SensorInterface::IntegrationCompletePrivate()
         if (sendIntegration)
             IDSetBLOB(&FitsBP, nullptr);
         if(blob != nullptr)
-            free(blob);
+            IDSharedBlobFree(blob);
+        if(raw != nullptr)
+            IDSharedBlobFree(raw);
 
         DEBUG(Logger::DBG_DEBUG, "Upload complete");
     }
@@ -938,6 +968,41 @@ bool SensorInterface::IntegrationCompletePrivate()
     return true;
 }
 
+void* SensorInterface::sendRaw(uint8_t *buf, int len)
+{
+    static_assert(sizeof(RawBlockHeader) == 56, "RawBlockHeader is part of the transfer format");
+
+    size_t bytes = static_cast<size_t>(len) * abs(getBPS()) / 8;
+    uint8_t *block = static_cast<uint8_t *>(IDSharedBlobAlloc(sizeof(RawBlockHeader) + bytes));
+    if (block == nullptr)
+    {
+        DEBUGF(Logger::DBG_ERROR, "Error: failed to allocate memory: %lu",
+               static_cast<unsigned long>(sizeof(RawBlockHeader) + bytes));
+        return nullptr;
+    }
+
+    RawBlockHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "INDR", 4);
+    header.byteOrder = 0x0102;
+    header.version   = 1;
+    header.bps       = getBPS();
+    header.dims      = 1;
+    header.sizes[0]  = len;
+    header.timestamp = startIntegrationTime;
+    header.duration  = getIntegrationTime();
+
+    memcpy(block, &header, sizeof(header));
+    memcpy(block + sizeof(header), buf, bytes);
+
+    FitsB.blob    = block;
+    FitsB.bloblen = FitsB.size = sizeof(header) + bytes;
+    snprintf(FitsB.format, MAXINDIBLOBFMT, ".raw");
+    FitsBP.s = IPS_OK;
+
+    return block;
+}
+
 bool SensorInterface::uploadFile(const void *fitsData, size_t totalBytes, bool sendIntegration,
                                  bool saveIntegration)
 {
@@ -1039,6 +1104,7 @@ bool SensorInterface::saveConfigItems(FILE *fp)
 
     IUSaveConfigText(fp, &ActiveDeviceTP);
     IUSaveConfigSwitch(fp, &UploadSP);
+    IUSaveConfigSwitch(fp, &TransferFormatSP);
     IUSaveConfigText(fp, &UploadSettingsTP);
     IUSaveConfigSwitch(fp, &TelescopeTypeSP);
 
@@ -1053,115 +1119,17 @@ bool SensorInterface::saveConfigItems(FILE *fp)
 
 void SensorInterface::getMinMax(double *min, double *max, uint8_t *buf, int len, int bpp)
 {
-    int ind         = 0, i, j;
-    int integrationHeight = 1;
-    int integrationWidth  = len;
     double lmin = 0, lmax = 0;
 
-    switch (bpp)
+    Pixel::withPixelType(bpp, [&](auto tag)
     {
-        case 8:
-        {
-            uint8_t *integrationBuffer = static_cast<uint8_t *>(buf);
-            lmin = lmax = integrationBuffer[0];
-
-            for (i = 0; i < integrationHeight; i++)
-                for (j = 0; j < integrationWidth; j++)
-                {
-                    ind = (i * integrationWidth) + j;
-                    if (integrationBuffer[ind] < lmin)
-                        lmin = integrationBuffer[ind];
-                    else if (integrationBuffer[ind] > lmax)
-                        lmax = integrationBuffer[ind];
-                }
-        }
-        break;
+        using T = typename decltype(tag)::type;
+        T low {}, high {};
+        Pixel::minMax(reinterpret_cast<const T *>(buf), len > 0 ? len : 0, low, high);
+        lmin = low;
+        lmax = high;
+    });
 
-        case 16:
-        {
-            uint16_t *integrationBuffer = reinterpret_cast<uint16_t *>(buf);
-            lmin = lmax = integrationBuffer[0];
-
-            for (i = 0; i < integrationHeight; i++)
-                for (j = 0; j < integrationWidth; j++)
-                {
-                    ind = (i * integrationWidth) + j;
-                    if (integrationBuffer[ind] < lmin)
-                        lmin = integrationBuffer[ind];
-                    else if (integrationBuffer[ind] > lmax)
-                        lmax = integrationBuffer[ind];
-                }
-        }
-        break;
-
-        case 32:
-        {
-            uint32_t *integrationBuffer = reinterpret_cast<uint32_t *>(buf);
-            lmin = lmax = integrationBuffer[0];
-
-            for (i = 0; i < integrationHeight; i++)
-                for (j = 0; j < integrationWidth; j++)
-                {
-                    ind = (i * integrationWidth) + j;
-                    if (integrationBuffer[ind] < lmin)
-                        lmin = integrationBuffer[ind];
-                    else if (integrationBuffer[ind] > lmax)
-                        lmax = integrationBuffer[ind];
-                }
-        }
-        break;
-
-        case 64:
-        {
-            unsigned long *integrationBuffer = reinterpret_cast<unsigned long *>(buf);
-            lmin = lmax = integrationBuffer[0];
-
-            for (i = 0; i < integrationHeight; i++)
-                for (j = 0; j < integrationWidth; j++)
-                {
-                    ind = (i * integrationWidth) + j;
-                    if (integrationBuffer[ind] < lmin)
-                        lmin = integrationBuffer[ind];
-                    else if (integrationBuffer[ind] > lmax)
-                        lmax = integrationBuffer[ind];
-                }
-        }
-        break;
-
-        case -32:
-        {
-            double *integrationBuffer = reinterpret_cast<double *>(buf);
-            lmin = lmax = integrationBuffer[0];
-
-            for (i = 0; i < integrationHeight; i++)
-                for (j = 0; j < integrationWidth; j++)
-                {
-                    ind = (i * integrationWidth) + j;
-                    if (integrationBuffer[ind] < lmin)
-                        lmin = integrationBuffer[ind];
-                    else if (integrationBuffer[ind] > lmax)
-                        lmax = integrationBuffer[ind];
-                }
-        }
-        break;
-
-        case -64:
-        {
-            double *integrationBuffer = reinterpret_cast<double *>(buf);
-            lmin = lmax = integrationBuffer[0];
-
-            for (i = 0; i < integrationHeight; i++)
-                for (j = 0; j < integrationWidth; j++)
-                {
-                    ind = (i * integrationWidth) + j;
-                    if (integrationBuffer[ind] < lmin)
-                        lmin = integrationBuffer[ind];
-                    else if (integrationBuffer[ind] > lmax)
-                        lmax = integrationBuffer[ind];
-                }
-        }
-        break;
-    }
     *min = lmin;
     *max = lmax;
 }
@@ -1177,10 +1145,6 @@ int SensorInterface::getFileIndex(const char *dir, const char *prefix, const cha
 {
     INDI_UNUSED(ext);
 
-    DIR *dpdf = nullptr;
-    struct dirent *epdf = nullptr;
-    std::vector<std::string> files = std::vector<std::string>();
-
     std::string prefixIndex = prefix;
     prefixIndex             = regex_replace_compat2(prefixIndex, "_ISO8601", "");
     prefixIndex             = regex_replace_compat2(prefixIndex, "_XXX", "");
@@ -1195,50 +1159,23 @@ int SensorInterface::getFileIndex(const char *dir, const char *prefix, const cha
             LOGF_ERROR("Error creating directory %s (%s)", dir, strerror(errno));
     }
 
-    dpdf = opendir(dir);
-    if (dpdf != nullptr)
-    {
-        while ((epdf = readdir(dpdf)))
-        {
-            if (strstr(epdf->d_name, prefixIndex.c_str()))
-                files.push_back(epdf->d_name);
-        }
-        closedir(dpdf);
-    }
-    else
-        return -1;
-
-    int maxIndex = 0;
-
-    for (int i = 0; i < static_cast<int>(files.size()); i++)
-    {
-        int index = -1;
-
-        std::string file  = files.at(i);
-        std::size_t start = file.find_last_of("_");
-        std::size_t end   = file.find_last_of(".");
-        if (start != std::string::npos)
-        {
-            index = atoi(file.substr(start + 1, end).c_str());
-            if (index > maxIndex)
-                maxIndex = index;
-        }
-    }
-
-    return (maxIndex + 1);
+    return INDI::nextFileIndex(dir, prefixIndex);
 }
 
 void SensorInterface::setBPS(int bps)
 {
     BPS = bps;
 
-    // Reset size
+    // Reset size, negative BPS are floating point samples
     if (HasStreaming())
-        Streamer->setSize(getBufferSize() * 8 / BPS);
+        Streamer->setSize(getBufferSize() * 8 / abs(BPS));
 
     // DSP
     if (HasDSP())
-        DSP->setSizes(1, new int[1] { getBufferSize() * 8 / BPS });
+    {
+        int size = getBufferSize() * 8 / abs(BPS);
+        DSP->setSizes(1, &size);
+    }
 
 }
 
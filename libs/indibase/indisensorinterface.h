@@ -94,6 +94,24 @@ class SensorInterface : public DefaultDevice
             CONNECTION_TCP    = 1 << 2  /** For Wired and WiFI connections */
         } SensorConnection;
 
+        /**
+         * \struct RawBlockHeader
+         * \brief Header of the integrations sent in the raw transfer format, followed by the samples as they
+         * are in the buffer. Fields and samples are in the byte order of the driver host, byteOrder reads
+         * 0x0102 on a host of the same order.
+         */
+        struct RawBlockHeader
+        {
+            char magic[4];      /*!< "INDR" */
+            uint16_t byteOrder; /*!< 0x0102 */
+            uint16_t version;   /*!< 1 */
+            int32_t bps;        /*!< bits per sample, negative for floating point samples as FITS BITPIX */
+            uint32_t dims;      /*!< number of sizes in use */
+            uint64_t sizes[3];  /*!< samples along each dimension */
+            double timestamp;   /*!< start of integration, seconds since the Unix epoch */
+            double duration;    /*!< integration time in seconds */
+        };
+
         bool initProperties();
         bool updateProperties();
         bool processNumber(const char *dev, const char *name, double values[], char *names[], int n);
@@ -475,6 +493,15 @@ class SensorInterface : public DefaultDevice
         ISwitch TelescopeTypeS[2];
         ISwitchVectorProperty TelescopeTypeSP;
 
+        // Transfer format of the integrations sent to the client, saved integrations are always FITS
+        ISwitch TransferFormatS[2];
+        ISwitchVectorProperty TransferFormatSP;
+        enum
+        {
+            FORMAT_FITS,
+            FORMAT_RAW
+        };
+
         // FITS Header
         IText FITSHeaderT[2] {};
         ITextVectorProperty FITSHeaderTP;
@@ -553,6 +580,7 @@ class SensorInterface : public DefaultDevice
         int getFileIndex(const char *dir, const char *prefix, const char *ext);
 
         bool IntegrationCompletePrivate();
-        void* sendFITS(uint8_t* buf, int len);
+        void* sendFITS(uint8_t* buf, int len, bool sendIntegration, bool saveIntegration);
+        void* sendRaw(uint8_t* buf, int len);
 };
 }
@@ -52,6 +52,9 @@ Telescope::Telescope()
 
     currentPECState = PEC_OFF;
     lastPECState    = PEC_UNKNOWN;
+
+    m_PECTimer.setInterval(PEC_UPDATE_INTERVAL);
+    m_PECTimer.callOnTimeout(std::bind(&Telescope::PECUpdate, this));
 }
 
 Telescope::~Telescope()
@@ -138,6 +141,27 @@ bool Telescope::initProperties()
     PECStateSP.fill(getDeviceName(), "PEC", "PEC Playback", MOTION_TAB, IP_RW, ISR_1OFMANY, 0,
                     IPS_IDLE);
 
+    // PEC playback through the custom track rate
+    PECPlaybackSP[INDI_ENABLED].fill("PEC_PLAYBACK_ON", "On", ISS_OFF);
+    PECPlaybackSP[INDI_DISABLED].fill("PEC_PLAYBACK_OFF", "Off", ISS_ON);
+    PECPlaybackSP.fill(getDeviceName(), "TELESCOPE_PEC_PLAYBACK", "PEC Playback", MOTION_TAB, IP_RW, ISR_1OFMANY, 0,
+                       IPS_IDLE);
+
+    PECRecordSP[0].fill("PEC_RECORD", "Record", ISS_OFF);
+    PECRecordSP.fill(getDeviceName(), "TELESCOPE_PEC_RECORD", "PEC Record", MOTION_TAB, IP_RW, ISR_NOFMANY, 0, IPS_IDLE);
+
+    PECSettingsNP[PEC_WORM_PERIOD].fill("PEC_WORM_PERIOD", "Worm period (s)", "%.2f", 1, 3600, 1, m_PEC.wormPeriod());
+    PECSettingsNP[PEC_GUIDE_RATE].fill("PEC_GUIDE_RATE", "Guide rate (x sidereal)", "%.2f", 0.01, 2, 0.05, 0.5);
+    PECSettingsNP.fill(getDeviceName(), "TELESCOPE_PEC_SETTINGS", "PEC Settings", MOTION_TAB, IP_RW, 60, IPS_IDLE);
+
+    PECStatusNP[PEC_PHASE].fill("PEC_PHASE", "Worm phase", "%.3f", 0, 1, 0, 0);
+    PECStatusNP[PEC_CORRECTION].fill("PEC_CORRECTION", "Correction (arcsecs/s)", "%.4f", -100, 100, 0, 0);
+    PECStatusNP[PEC_RECORDED].fill("PEC_RECORDED", "Recorded (%)", "%.0f", 0, 100, 0, 0);
+    PECStatusNP.fill(getDeviceName(), "TELESCOPE_PEC_STATUS", "PEC Status", MOTION_TAB, IP_RO, 60, IPS_IDLE);
+
+    PECTableTP[0].fill("PEC_TABLE", "Corrections (arcsecs/s)", m_PEC.toString().c_str());
+    PECTableTP.fill(getDeviceName(), "TELESCOPE_PEC_TABLE", "PEC Table", MOTION_TAB, IP_RW, 60, IPS_IDLE);
+
     // Track Mode. Child class must call AddTrackMode to add members
     // @INDI_STANDARD_PROPERTY@
     TrackModeSP.fill(getDeviceName(), "TELESCOPE_TRACK_MODE", "Track Mode", MAIN_CONTROL_TAB,
@@ -398,6 +422,16 @@ bool Telescope::updateProperties()
 
         if (HasPECState())
             defineProperty(PECStateSP);
+
+        if (HasPECPlayback())
+        {
+            defineProperty(PECPlaybackSP);
+            defineProperty(PECRecordSP);
+            defineProperty(PECSettingsNP);
+            defineProperty(PECStatusNP);
+            defineProperty(PECTableTP);
+            m_PECTimer.start();
+        }
     }
     else
     {
@@ -459,6 +493,20 @@ bool Telescope::updateProperties()
 
         if (HasPECState())
             deleteProperty(PECStateSP);
+
+        if (HasPECPlayback())
+        {
+            m_PECTimer.stop();
+            m_PEC.stopRecording();
+            m_PECAppliedCorrection = 0;
+            PECRecordSP.reset();
+            PECRecordSP.setState(IPS_IDLE);
+            deleteProperty(PECPlaybackSP);
+            deleteProperty(PECRecordSP);
+            deleteProperty(PECSettingsNP);
+            deleteProperty(PECStatusNP);
+            deleteProperty(PECTableTP);
+        }
     }
 
     if (CanGOTO())
@@ -639,6 +687,11 @@ bool Telescope::saveConfigItems(FILE *fp)
         TrackModeSP.save(fp);
     if (HasTrackRate())
         TrackRateNP.save(fp);
+    if (HasPECPlayback())
+    {
+        PECSettingsNP.save(fp);
+        PECTableTP.save(fp);
+    }
 
     controller->saveConfigItems(fp);
     MotionControlModeTP.save(fp);
@@ -758,6 +811,25 @@ bool Telescope::ISNewText(const char *dev, const char *name, char *texts[], char
             saveConfig(ActiveDeviceTP);
             return true;
         }
+
+        if (PECTableTP.isNameMatch(name))
+        {
+            if (n < 1 || m_PEC.fromString(texts[0]) == false)
+            {
+                LOG_ERROR("Invalid PEC table, expecting comma separated corrections in arcsecs/s.");
+                PECTableTP.setState(IPS_ALERT);
+                PECTableTP.apply();
+                return false;
+            }
+
+            PECRecordSP.reset();
+            PECRecordSP.setState(IPS_IDLE);
+            PECRecordSP.apply();
+            PECTableTP[0].setText(m_PEC.toString());
+            PECTableTP.setState(IPS_OK);
+            PECTableTP.apply();
+            return true;
+        }
     }
 
     controller->ISNewText(dev, name, texts, names, n);
@@ -950,7 +1022,11 @@ bool Telescope::ISNewNumber(const char *dev, const char *name, double values[],
                     TrackRateNP.setState(IPS_ALERT);
                 }
                 else
+                {
                     TrackRateNP.setState(IPS_OK);
+                    // The next PEC update adds its correction to the new rate
+                    m_PECAppliedCorrection = 0;
+                }
             }
 
             // If we are already tracking but tracking mode is NOT custom
@@ -965,6 +1041,28 @@ bool Telescope::ISNewNumber(const char *dev, const char *name, double values[],
             TrackRateNP.apply();
             return true;
         }
+
+        ///////////////////////////////////
+        // PEC Settings
+        ///////////////////////////////////
+        if (PECSettingsNP.isNameMatch(name))
+        {
+            double previousPeriod = m_PEC.wormPeriod();
+            PECSettingsNP.update(values, names, n);
+            m_PEC.setWormPeriod(PECSettingsNP[PEC_WORM_PERIOD].getValue());
+            // The phases being recorded are no longer those of the worm
+            if (m_PEC.wormPeriod() != previousPeriod && m_PEC.isRecording())
+            {
+                LOG_WARN("Worm period changed, PEC recording is stopped.");
+                m_PEC.stopRecording();
+                PECRecordSP.reset();
+                PECRecordSP.setState(IPS_ALERT);
+                PECRecordSP.apply();
+            }
+            PECSettingsNP.setState(IPS_OK);
+            PECSettingsNP.apply();
+            return true;
+        }
     }
 
     return DefaultDevice::ISNewNumber(dev, name, values, names, n);
@@ -1417,6 +1515,62 @@ bool Telescope::ISNewSwitch(const char *dev, const char *name, ISState *states,
             return true;
         }
 
+        ///////////////////////////////////
+        // PEC Playback
+        ///////////////////////////////////
+        if (PECPlaybackSP.isNameMatch(name))
+        {
+            PECPlaybackSP.update(states, names, n);
+            if (PECPlaybackSP[INDI_ENABLED].getState() == ISS_ON)
+            {
+                LOG_INFO("PEC playback is enabled.");
+                if (!PECCustomRate())
+                    LOG_INFO("PEC corrections are played back while tracking mode is Custom.");
+                PECPlaybackSP.setState(IPS_OK);
+            }
+            else
+            {
+                PECStopPlayback();
+                PECPlaybackSP.setState(IPS_IDLE);
+            }
+            PECPlaybackSP.apply();
+            return true;
+        }
+
+        ///////////////////////////////////
+        // PEC Record
+        ///////////////////////////////////
+        if (PECRecordSP.isNameMatch(name))
+        {
+            PECRecordSP.update(states, names, n);
+            if (PECRecordSP[0].getState() == ISS_ON)
+            {
+                if (TrackState != SCOPE_TRACKING)
+                {
+                    LOG_ERROR("Mount must be tracking to record PEC.");
+                    PECRecordSP.reset();
+                    PECRecordSP.setState(IPS_ALERT);
+                }
+                else
+                {
+                    bool refine = PECPlaybackSP[INDI_ENABLED].getState() == ISS_ON && PECCustomRate();
+                    m_PEC.startRecording(PECPhase(), refine);
+                    LOGF_INFO("Recording PEC over a %.0f seconds worm period%s. Keep guiding.", m_PEC.wormPeriod(),
+                              refine ? ", refining the table played back" : "");
+                    PECRecordSP.setState(IPS_BUSY);
+                }
+            }
+            else
+            {
+                if (m_PEC.isRecording())
+                    LOG_INFO("PEC recording is stopped.");
+                m_PEC.stopRecording();
+                PECRecordSP.setState(IPS_IDLE);
+            }
+            PECRecordSP.apply();
+            return true;
+        }
+
         ///////////////////////////////////
         // Park Options
         ///////////////////////////////////
@@ -1616,6 +1770,22 @@ void Telescope::TimerHit()
             EqNP.apply();
         }
 
+        // Slewing mounts are polled faster and parked ones slower. An unparked mount keeps the polling
+        // period, it may be moved from a hand controller without the driver knowing.
+        switch (TrackState)
+        {
+            case SCOPE_SLEWING:
+            case SCOPE_PARKING:
+                setActivity(ACTIVITY_MOVING);
+                break;
+            case SCOPE_PARKED:
+                setActivity(ACTIVITY_IDLE);
+                break;
+            default:
+                setActivity(ACTIVITY_BUSY);
+                break;
+        }
+
         SetTimer(getCurrentPollingPeriod());
     }
 }
@@ -2727,6 +2897,100 @@ void Telescope::setPECState(TelescopePECState state)
     }
 }
 
+double Telescope::PECPhase()
+{
+    double lst = get_local_sidereal_time(LocationNP[LOCATION_LONGITUDE].getValue());
+    double ha  = get_local_hour_angle(lst, EqNP[AXIS_RA].getValue());
+    // The axis is half a turn away on the other side of the pier
+    return m_PEC.phase(ha + (currentPierSide == PIER_WEST ? 12 : 0));
+}
+
+bool Telescope::PECCustomRate()
+{
+    // Custom rates are only used in the custom tracking mode
+    auto mode = TrackModeSP.findOnSwitch();
+    return !HasTrackMode() || (mode && mode->isNameMatch("TRACK_CUSTOM"));
+}
+
+void Telescope::PECGuidePulse(double ms)
+{
+    if (!HasPECPlayback() || !m_PEC.isRecording())
+        return;
+
+    double arcsecs = ms / 1000.0 * PECSettingsNP[PEC_GUIDE_RATE].getValue() * TRACKRATE_SIDEREAL;
+    m_PEC.addCorrection(PECPhase(), arcsecs);
+}
+
+void Telescope::PECStopPlayback()
+{
+    if (m_PECAppliedCorrection != 0 && TrackState == SCOPE_TRACKING)
+        SetTrackRate(TrackRateNP[AXIS_RA].getValue(), TrackRateNP[AXIS_DE].getValue());
+    m_PECAppliedCorrection = 0;
+}
+
+void Telescope::PECUpdate()
+{
+    double phase  = PECPhase();
+    bool tracking = TrackState == SCOPE_TRACKING;
+
+    if (m_PEC.isRecording())
+    {
+        PECPlayback::RecordState state = tracking ? m_PEC.updateRecording(phase) : PECPlayback::RECORD_ABORTED;
+        if (state == PECPlayback::RECORD_DONE)
+        {
+            LOG_INFO("PEC recording is complete.");
+            PECTableTP[0].setText(m_PEC.toString());
+            PECTableTP.setState(IPS_OK);
+            PECTableTP.apply();
+            saveConfig(PECTableTP);
+            PECRecordSP.reset();
+            PECRecordSP.setState(IPS_OK);
+            PECRecordSP.apply();
+        }
+        else if (state == PECPlayback::RECORD_ABORTED)
+        {
+            LOG_WARN("Mount stopped tracking or slewed, PEC recording is aborted.");
+            m_PEC.stopRecording();
+            PECRecordSP.reset();
+            PECRecordSP.setState(IPS_ALERT);
+            PECRecordSP.apply();
+        }
+    }
+
+    double correction = 0;
+    if (PECPlaybackSP[INDI_ENABLED].getState() == ISS_ON && tracking && PECCustomRate())
+        correction = m_PEC.correction(phase);
+
+    if (!tracking)
+        m_PECAppliedCorrection = 0;
+    else if (std::abs(correction - m_PECAppliedCorrection) >= PEC_RATE_THRESHOLD
+             || (correction == 0 && m_PECAppliedCorrection != 0))
+    {
+        if (SetTrackRate(TrackRateNP[AXIS_RA].getValue() + correction, TrackRateNP[AXIS_DE].getValue()))
+            m_PECAppliedCorrection = correction;
+        else
+        {
+            LOG_ERROR("Failed to set the PEC tracking rate, PEC playback is disabled.");
+            m_PECAppliedCorrection = 0;
+            PECPlaybackSP.reset();
+            PECPlaybackSP[INDI_DISABLED].setState(ISS_ON);
+            PECPlaybackSP.setState(IPS_ALERT);
+            PECPlaybackSP.apply();
+        }
+    }
+
+    // Status once a second
+    if (++m_PECStatusTicks >= PEC_STATUS_TICKS)
+    {
+        m_PECStatusTicks = 0;
+        PECStatusNP[PEC_PHASE].setValue(phase);
+        PECStatusNP[PEC_CORRECTION].setValue(m_PECAppliedCorrection);
+        PECStatusNP[PEC_RECORDED].setValue(m_PEC.recordingProgress() * 100);
+        PECStatusNP.setState(m_PEC.isRecording() ? IPS_BUSY : IPS_OK);
+        PECStatusNP.apply();
+    }
+}
+
 std::string Telescope::GetHomeDirectory() const
 {
     // Check first the HOME environmental variable
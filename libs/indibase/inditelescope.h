@@ -21,6 +21,8 @@
 #include "defaultdevice.h"
 #include "libastro.h"
 #include "indipropertyswitch.h"
+#include "inditimer.h"
+#include "pecplayback.h"
 #include <libnova/julian_day.h>
 
 #include <string>
@@ -189,6 +191,7 @@ class Telescope : public DefaultDevice
             TELESCOPE_CAN_HOME_FIND               = 1 << 14, /** Can the telescope find home position? */
             TELESCOPE_CAN_HOME_SET                = 1 << 15, /** Can the telescope set the current position as the new home position? */
             TELESCOPE_CAN_HOME_GO                 = 1 << 16, /** Can the telescope slew to home position? */
+            TELESCOPE_HAS_PEC_PLAYBACK            = 1 << 17, /** Should the base class play back a PEC table through SetTrackRate? */
         } TelescopeCapability;
 
         Telescope();
@@ -328,6 +331,23 @@ class Telescope : public DefaultDevice
             return capability & TELESCOPE_HAS_TRACK_RATE;
         }
 
+        /**
+         * @return True if the base class plays back a periodic error correction table. This requires custom
+         * tracking rates.
+         */
+        bool HasPECPlayback()
+        {
+            return (capability & TELESCOPE_HAS_PEC_PLAYBACK) && HasTrackRate();
+        }
+
+        /**
+         * @brief PECGuidePulse Record a guide pulse sent on the RA axis while the PEC table is being recorded.
+         * GuiderInterface calls it for the timed guide properties, drivers receiving guide corrections
+         * by other means can call it too.
+         * @param ms pulse duration in milliseconds, positive for west (faster than sidereal) and negative for east.
+         */
+        void PECGuidePulse(double ms);
+
         /**
          * @return True if telescope can search for home position.
          */
@@ -910,6 +930,24 @@ class Telescope : public DefaultDevice
         // PEC State
         INDI::PropertySwitch PECStateSP {2};
 
+        // PEC playback by the base class, see TELESCOPE_HAS_PEC_PLAYBACK
+        INDI::PropertySwitch PECPlaybackSP {2};
+        INDI::PropertySwitch PECRecordSP {1};
+        INDI::PropertyNumber PECSettingsNP {2};
+        INDI::PropertyNumber PECStatusNP {3};
+        INDI::PropertyText PECTableTP {1};
+        enum
+        {
+            PEC_WORM_PERIOD,
+            PEC_GUIDE_RATE
+        };
+        enum
+        {
+            PEC_PHASE,
+            PEC_CORRECTION,
+            PEC_RECORDED
+        };
+
         // Track Mode
         INDI::PropertySwitch TrackModeSP {0};
 
@@ -949,6 +987,19 @@ class Telescope : public DefaultDevice
         void triggerSnoop(const char *driverName, const char *propertyName);
         void generateCoordSet();
 
+        // Worm phase of the RA axis now
+        double PECPhase();
+        // Follow the recording and apply the correction of the current phase
+        void PECUpdate();
+        void PECStopPlayback();
+        bool PECCustomRate();
+
+        PECPlayback m_PEC;
+        INDI::Timer m_PECTimer;
+        // Correction included in the last rate given to SetTrackRate
+        double m_PECAppliedCorrection {0};
+        int m_PECStatusTicks {0};
+
         /**
          * @brief LoadParkXML Read and process park XML data.
          * @return error string if there is problem opening the file
@@ -980,6 +1031,10 @@ class Telescope : public DefaultDevice
 
         // 100 millisecond of arc or time.
         static constexpr double EQ_NOTIFY_THRESHOLD {1.0 / (60 * 60 * 10)};
+        // PEC playback updates the rate 4 times a second, when it changed by more than 1 milliarcsec/s
+        static constexpr uint32_t PEC_UPDATE_INTERVAL {250};
+        static constexpr double PEC_RATE_THRESHOLD {0.001};
+        static constexpr int PEC_STATUS_TICKS {4};
 };
 
 }
@@ -21,8 +21,17 @@
 
 #include "indiusbdevice.h"
 
+#include "eventloop.h"
+
 #include <config-usb.h>
 
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
 #ifndef USB1_HAS_LIBUSB_ERROR_NAME
 const char *LIBUSB_CALL libusb_error_name(int errcode)
 {
@@ -33,6 +42,60 @@ const char *LIBUSB_CALL libusb_error_name(int errcode)
 #endif
 
 static libusb_context *ctx = nullptr;
+static int ctxUsers = 0;
+
+/* One thread completes the asynchronous transfers of all the devices, while any is reading */
+static std::mutex eventMutex;
+static std::thread eventThread;
+static std::atomic<bool> eventQuit {false};
+static int eventUsers = 0;
+
+static void eventThreadRun()
+{
+    while (!eventQuit)
+    {
+        // The timeout lets the thread see eventQuit, transfers complete as soon as they are done
+        struct timeval tv = { 0, 100000 };
+        libusb_handle_events_timeout_completed(ctx, &tv, nullptr);
+    }
+}
+
+static void eventThreadAcquire()
+{
+    std::lock_guard<std::mutex> lock(eventMutex);
+    if (eventUsers++ == 0)
+    {
+        eventQuit = false;
+        eventThread = std::thread(eventThreadRun);
+    }
+}
+
+static void eventThreadRelease()
+{
+    std::lock_guard<std::mutex> lock(eventMutex);
+    if (--eventUsers == 0)
+    {
+        eventQuit = true;
+        eventThread.join();
+    }
+}
+
+static int transferError(int status)
+{
+    switch (status)
+    {
+        case LIBUSB_TRANSFER_STALL:
+            return LIBUSB_ERROR_PIPE;
+        case LIBUSB_TRANSFER_NO_DEVICE:
+            return LIBUSB_ERROR_NO_DEVICE;
+        case LIBUSB_TRANSFER_OVERFLOW:
+            return LIBUSB_ERROR_OVERFLOW;
+        case LIBUSB_TRANSFER_TIMED_OUT:
+            return LIBUSB_ERROR_TIMEOUT;
+        default:
+            return LIBUSB_ERROR_IO;
+    }
+}
 
 namespace INDI
 {
@@ -52,11 +115,19 @@ USBDevice::USBDevice()
             fprintf(stderr, "USBDevice: Can't initialize libusb\n");
         }
     }
+    ctxUsers++;
 }
 
 USBDevice::~USBDevice()
 {
-    libusb_exit(ctx);
+    StopAsyncRead();
+
+    // The context is shared by all the devices
+    if (--ctxUsers == 0)
+    {
+        libusb_exit(ctx);
+        ctx = nullptr;
+    }
 }
 
 libusb_device *USBDevice::FindDevice(int vendor, int product, int searchindex)
@@ -223,4 +294,151 @@ int USBDevice::ControlMessage(unsigned char request_type, unsigned char request,
     return rc;
 }
 
+int USBDevice::StartAsyncRead(int size, const std::function<void(const unsigned char *data, int len)> &callback,
+                              int transfers)
+{
+    if (usb_handle == nullptr || !m_AsyncTransfers.empty() || transfers < 1)
+        return LIBUSB_ERROR_INVALID_PARAM;
+
+    if (pipe(m_AsyncPipe) == -1)
+    {
+        fprintf(stderr, "USBDevice: pipe -> %s\n", strerror(errno));
+        return LIBUSB_ERROR_OTHER;
+    }
+    for (int fd : m_AsyncPipe)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    m_AsyncCallbackId = IEAddCallback(m_AsyncPipe[0], asyncReceivedHelper, this);
+    m_AsyncCallback = callback;
+    m_AsyncStopping = false;
+
+    eventThreadAcquire();
+
+    m_AsyncBuffers.assign(transfers, std::vector<unsigned char>(size));
+    for (int i = 0; i < transfers; i++)
+    {
+        libusb_transfer *transfer = libusb_alloc_transfer(0);
+        if (transfer == nullptr)
+        {
+            StopAsyncRead();
+            return LIBUSB_ERROR_NO_MEM;
+        }
+        m_AsyncTransfers.push_back(transfer);
+
+        if (InputType == LIBUSB_TRANSFER_TYPE_INTERRUPT)
+            libusb_fill_interrupt_transfer(transfer, usb_handle, InputEndpoint, m_AsyncBuffers[i].data(), size,
+                                           asyncTransferDone, this, 0);
+        else
+            libusb_fill_bulk_transfer(transfer, usb_handle, InputEndpoint, m_AsyncBuffers[i].data(), size,
+                                      asyncTransferDone, this, 0);
+
+        std::unique_lock<std::mutex> lock(m_AsyncMutex);
+        int rc = libusb_submit_transfer(transfer);
+        if (rc < 0)
+        {
+            lock.unlock();
+            fprintf(stderr, "USBDevice: libusb_submit_transfer -> %s\n", libusb_error_name(rc));
+            StopAsyncRead();
+            return rc;
+        }
+        m_AsyncPending++;
+    }
+    return 0;
+}
+
+void USBDevice::StopAsyncRead()
+{
+    if (m_AsyncCallbackId == -1)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(m_AsyncMutex);
+        m_AsyncStopping = true;
+        for (libusb_transfer *transfer : m_AsyncTransfers)
+            libusb_cancel_transfer(transfer);
+        // The cancelled transfers still complete, on the event thread
+        m_AsyncIdle.wait(lock, [this] { return m_AsyncPending == 0; });
+        m_AsyncPackets.clear();
+    }
+
+    for (libusb_transfer *transfer : m_AsyncTransfers)
+        libusb_free_transfer(transfer);
+    m_AsyncTransfers.clear();
+    m_AsyncBuffers.clear();
+
+    eventThreadRelease();
+
+    IERmCallback(m_AsyncCallbackId);
+    m_AsyncCallbackId = -1;
+    for (int &fd : m_AsyncPipe)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+void LIBUSB_CALL USBDevice::asyncTransferDone(libusb_transfer *transfer)
+{
+    USBDevice *self = static_cast<USBDevice *>(transfer->user_data);
+    std::lock_guard<std::mutex> lock(self->m_AsyncMutex);
+
+    if (!self->m_AsyncStopping && transfer->status != LIBUSB_TRANSFER_CANCELLED)
+    {
+        int error = 0;
+        if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
+        {
+            self->m_AsyncPackets.push_back({ std::vector<unsigned char>(transfer->buffer,
+                                             transfer->buffer + transfer->actual_length), 0 });
+            // Queued again at once, the other transfers cover the time it takes
+            error = libusb_submit_transfer(transfer);
+        }
+        else
+            error = transferError(transfer->status);
+
+        if (error < 0)
+            self->m_AsyncPackets.push_back({ {}, error });
+
+        // Wake the event loop, a full pipe already does
+        char wake = 0;
+        if (write(self->m_AsyncPipe[1], &wake, 1) < 0 && errno != EAGAIN)
+            fprintf(stderr, "USBDevice: write -> %s\n", strerror(errno));
+
+        if (error == 0)
+            return;
+    }
+
+    self->m_AsyncPending--;
+    self->m_AsyncIdle.notify_all();
+}
+
+void USBDevice::asyncReceivedHelper(int fd, void *context)
+{
+    char buffer[64];
+    while (read(fd, buffer, sizeof(buffer)) > 0)
+        ;
+    static_cast<USBDevice *>(context)->asyncReceived();
+}
+
+void USBDevice::asyncReceived()
+{
+    std::deque<AsyncPacket> packets;
+    {
+        std::lock_guard<std::mutex> lock(m_AsyncMutex);
+        packets.swap(m_AsyncPackets);
+    }
+
+    // The callback may stop the reading, the packets after it are dropped then
+    for (const AsyncPacket &packet : packets)
+    {
+        if (m_AsyncCallbackId == -1)
+            break;
+        if (packet.error < 0)
+            m_AsyncCallback(nullptr, packet.error);
+        else
+            m_AsyncCallback(packet.data.data(), static_cast<int>(packet.data.size()));
+    }
+}
+
 }
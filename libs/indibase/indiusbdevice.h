@@ -25,6 +25,12 @@
 
 #include <libusb.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
 /**
  * \class USBDevice
    \brief Class to provide general functionality of a generic USB device.
@@ -60,8 +66,50 @@ class USBDevice
         int FindEndpoints();
         int Open();
         void Close();
+
+        /**
+         * @brief Read the input endpoint continuously with asynchronous transfers.
+         *
+         * The transfers are kept queued on the endpoint and completed by a libusb event thread shared
+         * by all the devices, so nothing is polled. The received bytes are given to the callback from
+         * the driver event loop, in order.
+         * @param size bytes per transfer, at least the packet size of the endpoint.
+         * @param callback called with each transfer received, or with nullptr and a libusb error code
+         * once the reading stopped on an error, e.g. LIBUSB_ERROR_NO_DEVICE when the device is unplugged.
+         * @param transfers number of transfers kept queued, so none is lost while one is being resubmitted.
+         * @return 0 if the reading started, a libusb error code otherwise.
+         */
+        int StartAsyncRead(int size, const std::function<void(const unsigned char *data, int len)> &callback,
+                           int transfers = 2);
+
+        /** @brief Cancel the asynchronous reading and wait for its transfers. Received data not delivered yet is dropped. */
+        void StopAsyncRead();
+
         USBDevice();
         USBDevice(libusb_device *dev);
         virtual ~USBDevice();
+
+    private:
+        static void LIBUSB_CALL asyncTransferDone(libusb_transfer *transfer);
+        static void asyncReceivedHelper(int fd, void *context);
+        void asyncReceived();
+
+        struct AsyncPacket
+        {
+            std::vector<unsigned char> data;
+            int error;
+        };
+
+        std::function<void(const unsigned char *, int)> m_AsyncCallback;
+        std::vector<libusb_transfer *> m_AsyncTransfers;
+        std::vector<std::vector<unsigned char>> m_AsyncBuffers;
+        // Received on the libusb event thread, delivered on the event loop
+        std::deque<AsyncPacket> m_AsyncPackets;
+        std::mutex m_AsyncMutex;
+        std::condition_variable m_AsyncIdle;
+        int m_AsyncPending {0};
+        bool m_AsyncStopping {false};
+        int m_AsyncPipe[2] {-1, -1};
+        int m_AsyncCallbackId {-1};
 };
 }
@@ -21,8 +21,89 @@
 #include "indiweatherinterface.h"
 
 #include "indilogger.h"
+#include "indiutility.h"
 
 #include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+struct CachedResponse
+{
+    time_t fetched {0};
+    std::string body;
+};
+
+std::mutex cacheLock;
+std::map<std::string, CachedResponse> cachedResponses;
+std::map<std::string, std::shared_ptr<std::mutex>> fetchLocks;
+
+std::string cacheDirectory()
+{
+    const char *directory = getenv("INDI_WEATHER_CACHE_DIR");
+    if (directory != nullptr && directory[0] != '\0')
+        return directory;
+    const char *home = getenv("HOME");
+    return std::string(home ? home : "/tmp") + "/.indi/cache/weather";
+}
+
+// FNV-1a, the file name must not depend on the standard library the driver was built with
+uint64_t hashKey(const std::string &key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool findCachedResponse(const std::string &key, int ttl, std::string &response)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    auto cached = cachedResponses.find(key);
+    if (cached == cachedResponses.end() || time(nullptr) - cached->second.fetched >= ttl)
+        return false;
+    response = cached->second.body;
+    return true;
+}
+
+bool readCacheFile(const std::string &path, int ttl, std::string &response, time_t &fetched)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || time(nullptr) - info.st_mtime >= ttl)
+        return false;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    response.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    fetched = info.st_mtime;
+    return true;
+}
+
+void writeCacheFile(const std::string &path, const std::string &response)
+{
+    // Readers never see a partial file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(response.data(), response.size()))
+            return;
+    }
+    rename(temporary.c_str(), path.c_str());
+}
+}
 
 namespace INDI
 {
@@ -521,4 +602,64 @@ bool WeatherInterface::saveConfigItems(FILE *fp)
 }
 
 
+bool WeatherInterface::fetchCached(const std::string &key, int ttl, const std::function<bool(std::string &)> &fetch,
+                                   std::string &response)
+{
+    if (findCachedResponse(key, ttl, response))
+        return true;
+
+    std::shared_ptr<std::mutex> keyLock;
+    {
+        std::lock_guard<std::mutex> lock(cacheLock);
+        auto &fetchLock = fetchLocks[key];
+        if (!fetchLock)
+            fetchLock = std::make_shared<std::mutex>();
+        keyLock = fetchLock;
+    }
+
+    // One fetch per key at a time, whoever waited takes the response of the one before
+    std::lock_guard<std::mutex> fetching(*keyLock);
+    if (findCachedResponse(key, ttl, response))
+        return true;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hashKey(key)));
+    std::string directory = cacheDirectory();
+    std::string path = directory + "/" + name;
+
+    // The lock file coalesces the drivers of the other processes
+    int lockFD = -1;
+    if (mkpath(directory, 0755) == 0)
+    {
+        lockFD = open((path + ".lock").c_str(), O_CREAT | O_RDWR, 0644);
+        if (lockFD >= 0)
+            flock(lockFD, LOCK_EX);
+    }
+
+    time_t fetched = 0;
+    bool available = readCacheFile(path, ttl, response, fetched);
+    if (available)
+        LOG_DEBUG("Weather data taken from the shared cache.");
+    else
+    {
+        fetched = time(nullptr);
+        available = fetch(response);
+        if (available && lockFD >= 0)
+            writeCacheFile(path, response);
+    }
+
+    if (lockFD >= 0)
+    {
+        flock(lockFD, LOCK_UN);
+        close(lockFD);
+    }
+
+    if (available)
+    {
+        std::lock_guard<std::mutex> lock(cacheLock);
+        cachedResponses[key] = {fetched, response};
+    }
+    return available;
+}
+
 }
@@ -27,6 +27,7 @@
 #include "inditimer.h"
 
 #include <stdint.h>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -278,6 +279,23 @@ class WeatherInterface
          */
         bool syncCriticalParameters();
 
+        /**
+         * @brief fetchCached Fetch a web service response through the weather cache shared by all the
+         * weather drivers of the host.
+         *
+         * The responses are kept in memory and under ~/.indi/cache/weather, or INDI_WEATHER_CACHE_DIR if set.
+         * While a response is younger than ttl it is returned without calling fetch. Otherwise one caller,
+         * in this process or another, calls fetch while the others of the same key wait and take its response,
+         * so each upstream request is sent at most once per ttl however many drivers ask for it.
+         * @param key Identifies the request, e.g. its URL. It is only stored hashed.
+         * @param ttl Seconds a response is reused for.
+         * @param fetch Gets a fresh response from the service, returns false on failure. Failures are not cached.
+         * @param response The cached or fetched response.
+         * @return True if a response is available.
+         */
+        bool fetchCached(const std::string &key, int ttl, const std::function<bool(std::string &)> &fetch,
+                         std::string &response);
+
         // Parameters
         INDI::PropertyNumber ParametersNP {0};
 
@@ -0,0 +1,161 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "pecplayback.h"
+
+#include "indicom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+
+namespace INDI
+{
+
+namespace
+{
+// Largest phase step between two updates of a recording, the axis jumped beyond that
+constexpr double MaxRecordingStep = 0.05;
+}
+
+PECPlayback::PECPlayback(size_t bins) : m_Table(std::max<size_t>(bins, 2), 0.0)
+{
+}
+
+void PECPlayback::setWormPeriod(double seconds)
+{
+    if (seconds > 0)
+        m_WormPeriod = seconds;
+}
+
+double PECPlayback::phase(double axisHours) const
+{
+    // arcsecs of sidereal tracking per worm turn
+    double turn = m_WormPeriod * TRACKRATE_SIDEREAL;
+    double p = std::fmod(axisHours * 15 * 3600 / turn, 1.0);
+    return p < 0 ? p + 1 : p;
+}
+
+size_t PECPlayback::bin(double phase) const
+{
+    return std::min(static_cast<size_t>(phase * m_Table.size()), m_Table.size() - 1);
+}
+
+double PECPlayback::correction(double phase) const
+{
+    // Bin values are at their centers
+    double x = phase * m_Table.size() - 0.5;
+    if (x < 0)
+        x += m_Table.size();
+    size_t i  = std::min(static_cast<size_t>(x), m_Table.size() - 1);
+    double fx = x - i;
+    return m_Table[i] * (1 - fx) + m_Table[(i + 1) % m_Table.size()] * fx;
+}
+
+void PECPlayback::clear()
+{
+    std::fill(m_Table.begin(), m_Table.end(), 0.0);
+}
+
+std::string PECPlayback::toString() const
+{
+    std::string text;
+    char value[32];
+    for (size_t i = 0; i < m_Table.size(); i++)
+    {
+        snprintf(value, sizeof(value), i ? ",%.4f" : "%.4f", m_Table[i]);
+        text += value;
+    }
+    return text;
+}
+
+bool PECPlayback::fromString(const std::string &text)
+{
+    std::vector<double> table;
+    const char *p = text.c_str();
+    while (*p)
+    {
+        char *end = nullptr;
+        double value = strtod(p, &end);
+        if (end == p || !std::isfinite(value))
+            return false;
+        table.push_back(value);
+        p = end;
+        while (*p == ',' || *p == ' ')
+            p++;
+    }
+    if (table.size() < 2)
+        return false;
+
+    stopRecording();
+    m_Table = std::move(table);
+    return true;
+}
+
+void PECPlayback::startRecording(double phase, bool refine)
+{
+    m_Recording = true;
+    m_Refine    = refine;
+    m_LastPhase = phase;
+    m_Covered   = 0;
+    m_Recorded.assign(m_Table.size(), 0.0);
+}
+
+void PECPlayback::stopRecording()
+{
+    m_Recording = false;
+    m_Recorded.clear();
+}
+
+void PECPlayback::addCorrection(double phase, double arcsecs)
+{
+    if (m_Recording)
+        m_Recorded[bin(phase)] += arcsecs;
+}
+
+PECPlayback::RecordState PECPlayback::updateRecording(double phase)
+{
+    if (!m_Recording)
+        return RECORD_IDLE;
+
+    double step = phase - m_LastPhase;
+    if (step < -0.5)
+        step += 1;
+    if (step < 0 || step > MaxRecordingStep)
+    {
+        stopRecording();
+        return RECORD_ABORTED;
+    }
+    m_LastPhase = phase;
+    m_Covered += step;
+    if (m_Covered < 1)
+        return RECORD_BUSY;
+
+    // arcsecs per bin to arcsecs/s, without the drift
+    const double binSeconds = m_WormPeriod / m_Table.size();
+    const double mean = std::accumulate(m_Recorded.begin(), m_Recorded.end(), 0.0) / m_Recorded.size();
+    for (size_t i = 0; i < m_Table.size(); i++)
+    {
+        double rate = (m_Recorded[i] - mean) / binSeconds;
+        m_Table[i] = m_Refine ? m_Table[i] + rate : rate;
+    }
+    stopRecording();
+    return RECORD_DONE;
+}
+
+}
@@ -0,0 +1,130 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The PECPlayback class holds a periodic error correction table over one worm period.
+ *
+ * The worm phase is derived from the mechanical angle of the RA axis, so it survives slews: while
+ * tracking the axis turns at the sidereal rate and the worm completes one turn per worm period.
+ * The table holds, for each of its bins, the RA rate correction in arcsecs/s to add to the tracking rate.
+ *
+ * Recording sums the guide corrections, in arcsecs, issued over one full worm turn. Their mean,
+ * which is drift rather than periodic error, is removed. When the table is played back while recording,
+ * the recorded residual refines it instead of replacing it.
+ */
+class PECPlayback
+{
+    public:
+        enum RecordState
+        {
+            RECORD_IDLE,
+            RECORD_BUSY,
+            RECORD_DONE,    /** A worm turn was recorded and the table updated */
+            RECORD_ABORTED  /** The axis jumped, e.g. on a slew, before the turn was complete */
+        };
+
+        explicit PECPlayback(size_t bins = 100);
+
+        /**
+         * @param seconds worm period in seconds of sidereal tracking.
+         */
+        void setWormPeriod(double seconds);
+        double wormPeriod() const
+        {
+            return m_WormPeriod;
+        }
+
+        /**
+         * @param axisHours mechanical angle of the RA axis, in hours.
+         * @return worm phase in [0, 1).
+         */
+        double phase(double axisHours) const;
+
+        /**
+         * @return RA rate correction in arcsecs/s at phase, linearly interpolated between bins.
+         */
+        double correction(double phase) const;
+
+        const std::vector<double> &table() const
+        {
+            return m_Table;
+        }
+        void clear();
+
+        /**
+         * @brief toString The table as comma separated corrections.
+         */
+        std::string toString() const;
+
+        /**
+         * @brief fromString Load a table from toString(). Its size becomes the number of bins.
+         * @return False if text is not a valid table, which is then unchanged.
+         */
+        bool fromString(const std::string &text);
+
+        /**
+         * @brief startRecording Record a worm turn from phase.
+         * @param refine True if the table is being played back, the recording is then added to it.
+         */
+        void startRecording(double phase, bool refine);
+        void stopRecording();
+        bool isRecording() const
+        {
+            return m_Recording;
+        }
+
+        /**
+         * @brief addCorrection Add a guide correction issued at phase while recording.
+         * @param arcsecs correction on the RA axis, positive when it adds to the tracking rate.
+         */
+        void addCorrection(double phase, double arcsecs);
+
+        /**
+         * @brief updateRecording Follow the axis while recording.
+         * @return RECORD_DONE once, when the turn is complete, RECORD_ABORTED if phase jumped.
+         */
+        RecordState updateRecording(double phase);
+
+        /**
+         * @return Fraction of the worm turn recorded so far.
+         */
+        double recordingProgress() const
+        {
+            return m_Recording ? m_Covered : 0;
+        }
+
+    private:
+        size_t bin(double phase) const;
+
+        std::vector<double> m_Table;
+        double m_WormPeriod {480};
+
+        bool m_Recording {false};
+        bool m_Refine {false};
+        double m_LastPhase {0};
+        double m_Covered {0};
+        std::vector<double> m_Recorded;
+};
+
+}
@@ -0,0 +1,347 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include "pixelkernels.h"
+#include "indithreadpool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace INDI
+{
+namespace Pixel
+{
+
+/* Software binning kernels.
+ * Each output row is produced by summing the bin rows under it into an accumulator row, then
+ * saturating (or averaging, for 8 bits) into the output. Output rows are independent, so large
+ * frames are split across threads. 2x2 has SIMD loops doing both steps at once; 3x3 and 4x4 get
+ * compile time block sizes that the compiler unrolls and vectorizes.
+ * Only whole blocks are binned: the output is (SubW / BinX) x (SubH / BinY), as the FITS header says.
+ */
+
+// Process rows [first, last) of the output, in parallel when there are enough of them
+template <typename Fn>
+void forEachRowRange(uint32_t rows, Fn fn)
+{
+    constexpr uint32_t minRowsPerThread = 64;
+    INDI::ThreadPool::global().forEach(rows, minRowsPerThread, [&fn](size_t first, size_t last)
+    {
+        fn(static_cast<uint32_t>(first), static_cast<uint32_t>(last));
+    });
+}
+
+// 2x2 loops, returning the number of output pixels written
+using Bin2x2Fn8  = uint32_t (*)(const uint8_t *, const uint8_t *, uint8_t *, uint32_t);
+using Bin2x2Fn16 = uint32_t (*)(const uint16_t *, const uint16_t *, uint16_t *, uint32_t);
+
+inline uint32_t bin2x2None8(const uint8_t *, const uint8_t *, uint8_t *, uint32_t)
+{
+    return 0;
+}
+
+inline uint32_t bin2x2None16(const uint16_t *, const uint16_t *, uint16_t *, uint32_t)
+{
+    return 0;
+}
+
+#if defined(INDI_PIXEL_X86)
+
+// min(255, sum / 2) of 16 output pixels
+__attribute__((target("sse2")))
+inline uint32_t bin2x2Sse2_8(const uint8_t *row0, const uint8_t *row1, uint8_t *out, uint32_t outW)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    uint32_t x = 0;
+    for (; x + 16 <= outW; x += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 2 * x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 2 * x + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 2 * x));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 2 * x + 16));
+        __m128i s0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, lo), _mm_srli_epi16(a, 8)),
+                                   _mm_add_epi16(_mm_and_si128(c, lo), _mm_srli_epi16(c, 8)));
+        __m128i s1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(b, lo), _mm_srli_epi16(b, 8)),
+                                   _mm_add_epi16(_mm_and_si128(d, lo), _mm_srli_epi16(d, 8)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x),
+                         _mm_packus_epi16(_mm_srli_epi16(s0, 1), _mm_srli_epi16(s1, 1)));
+    }
+    return x;
+}
+
+// min(65535, sum) of 8 output pixels. packs_epi32 saturates signed, hence the 32768 bias
+__attribute__((target("sse2")))
+inline uint32_t bin2x2Sse2_16(const uint16_t *row0, const uint16_t *row1, uint16_t *out, uint32_t outW)
+{
+    const __m128i lo   = _mm_set1_epi32(0xffff);
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    uint32_t x = 0;
+    for (; x + 8 <= outW; x += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 2 * x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 2 * x + 8));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 2 * x));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 2 * x + 8));
+        __m128i s0 = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a, lo), _mm_srli_epi32(a, 16)),
+                                   _mm_add_epi32(_mm_and_si128(c, lo), _mm_srli_epi32(c, 16)));
+        __m128i s1 = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(b, lo), _mm_srli_epi32(b, 16)),
+                                   _mm_add_epi32(_mm_and_si128(d, lo), _mm_srli_epi32(d, 16)));
+        __m128i packed = _mm_packs_epi32(_mm_sub_epi32(s0, bias), _mm_sub_epi32(s1, bias));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_xor_si128(packed, _mm_set1_epi16(-0x8000)));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+inline uint32_t bin2x2Avx2_8(const uint8_t *row0, const uint8_t *row1, uint8_t *out, uint32_t outW)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00ff);
+    uint32_t x = 0;
+    for (; x + 32 <= outW; x += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 2 * x));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 2 * x + 32));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 2 * x));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 2 * x + 32));
+        __m256i s0 = _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(a, lo), _mm256_srli_epi16(a, 8)),
+                                      _mm256_add_epi16(_mm256_and_si256(c, lo), _mm256_srli_epi16(c, 8)));
+        __m256i s1 = _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(b, lo), _mm256_srli_epi16(b, 8)),
+                                      _mm256_add_epi16(_mm256_and_si256(d, lo), _mm256_srli_epi16(d, 8)));
+        // packus works within 128 bit lanes, put the quarters back in order
+        __m256i packed = _mm256_packus_epi16(_mm256_srli_epi16(s0, 1), _mm256_srli_epi16(s1, 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    return x + bin2x2Sse2_8(row0 + 2 * x, row1 + 2 * x, out + x, outW - x);
+}
+
+__attribute__((target("avx2")))
+inline uint32_t bin2x2Avx2_16(const uint16_t *row0, const uint16_t *row1, uint16_t *out, uint32_t outW)
+{
+    uint32_t x = 0;
+    for (; x + 16 <= outW; x += 16)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 2 * x));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 2 * x + 16));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 2 * x));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 2 * x + 16));
+        const __m256i lo = _mm256_set1_epi32(0xffff);
+        __m256i s0 = _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(a, lo), _mm256_srli_epi32(a, 16)),
+                                      _mm256_add_epi32(_mm256_and_si256(c, lo), _mm256_srli_epi32(c, 16)));
+        __m256i s1 = _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(b, lo), _mm256_srli_epi32(b, 16)),
+                                      _mm256_add_epi32(_mm256_and_si256(d, lo), _mm256_srli_epi32(d, 16)));
+        // AVX2 has the unsigned 32 bit pack
+        __m256i packed = _mm256_packus_epi32(s0, s1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    return x + bin2x2Sse2_16(row0 + 2 * x, row1 + 2 * x, out + x, outW - x);
+}
+
+#elif defined(INDI_PIXEL_NEON)
+
+inline uint32_t bin2x2Neon8(const uint8_t *row0, const uint8_t *row1, uint8_t *out, uint32_t outW)
+{
+    uint32_t x = 0;
+    for (; x + 8 <= outW; x += 8)
+    {
+        uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(row0 + 2 * x)), vpaddlq_u8(vld1q_u8(row1 + 2 * x)));
+        vst1_u8(out + x, vqmovn_u16(vshrq_n_u16(sum, 1)));
+    }
+    return x;
+}
+
+inline uint32_t bin2x2Neon16(const uint16_t *row0, const uint16_t *row1, uint16_t *out, uint32_t outW)
+{
+    uint32_t x = 0;
+    for (; x + 4 <= outW; x += 4)
+    {
+        uint32x4_t sum = vaddq_u32(vpaddlq_u16(vld1q_u16(row0 + 2 * x)), vpaddlq_u16(vld1q_u16(row1 + 2 * x)));
+        vst1_u16(out + x, vqmovn_u32(sum));
+    }
+    return x;
+}
+#endif
+
+// pick the 2x2 loops for this CPU, once
+struct Bin2x2Loops
+{
+    Bin2x2Fn8 bin8 { bin2x2None8 };
+    Bin2x2Fn16 bin16 { bin2x2None16 };
+
+    Bin2x2Loops()
+    {
+#if defined(INDI_PIXEL_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            bin8  = bin2x2Avx2_8;
+            bin16 = bin2x2Avx2_16;
+        }
+        else if (__builtin_cpu_supports("sse2"))
+        {
+            bin8  = bin2x2Sse2_8;
+            bin16 = bin2x2Sse2_16;
+        }
+#elif defined(INDI_PIXEL_NEON)
+        bin8  = bin2x2Neon8;
+        bin16 = bin2x2Neon16;
+#endif
+    }
+};
+
+inline const Bin2x2Loops &bin2x2Loops()
+{
+    static const Bin2x2Loops loops;
+    return loops;
+}
+
+// Sum each group of bin adjacent pixels of a raw row into acc. B is bin when known at compile time.
+template <int B, typename T, typename Acc, typename Load>
+void sumRow(const T *row, uint32_t outW, int bin, Acc *acc, Load load)
+{
+    const int n = B > 0 ? B : bin;
+    for (uint32_t x = 0; x < outW; x++)
+    {
+        Acc sum = 0;
+        for (int l = 0; l < n; l++)
+            sum += load(row[x * n + l]);
+        acc[x] += sum;
+    }
+}
+
+// Same for a Bayer row: output column x takes the raw columns of its color, 2 apart, within its 2 * bin cell.
+// When outW is odd the last cell may be cut by the frame edge.
+template <int B, typename T, typename Acc, typename Load>
+void sumBayerRow(const T *row, uint32_t rawW, uint32_t outW, int bin, Acc *acc, Load load)
+{
+    const int n = B > 0 ? B : bin;
+    const uint32_t whole = outW & ~1u;
+    for (uint32_t x = 0; x < whole; x++)
+    {
+        const T *cell = row + (x & ~1u) * n + (x & 1u);
+        Acc sum = 0;
+        for (int l = 0; l < n; l++)
+            sum += load(cell[2 * l]);
+        acc[x] += sum;
+    }
+    for (uint32_t x = whole; x < outW; x++)
+        for (uint32_t j = x * n; j < rawW && j < (x + 2) * n; j += 2)
+            acc[x] += load(row[j]);
+}
+
+template <typename T, typename Acc, typename Load, typename Store>
+void binRows(const T *raw, T *out, uint32_t rawW, uint32_t rawH, uint32_t outW, uint32_t first, uint32_t last,
+             int binX, int binY, bool bayer, Load load, Store store)
+{
+    std::vector<Acc> acc(outW);
+    for (uint32_t y = first; y < last; y++)
+    {
+        std::fill(acc.begin(), acc.end(), 0);
+        for (int k = 0; k < binY; k++)
+        {
+            // Bayer output row y takes the raw rows of its color, 2 apart, within its 2 * binY cell
+            uint32_t rawY = bayer ? (y & ~1u) * binY + (y & 1u) + 2 * k : y * binY + k;
+            if (rawY >= rawH)
+                break;
+            const T *row = raw + static_cast<size_t>(rawY) * rawW;
+            switch (bayer ? -binX : binX)
+            {
+                case 2:
+                    sumRow<2>(row, outW, binX, acc.data(), load);
+                    break;
+                case 3:
+                    sumRow<3>(row, outW, binX, acc.data(), load);
+                    break;
+                case 4:
+                    sumRow<4>(row, outW, binX, acc.data(), load);
+                    break;
+                case -2:
+                    sumBayerRow<2>(row, rawW, outW, binX, acc.data(), load);
+                    break;
+                case -3:
+                    sumBayerRow<3>(row, rawW, outW, binX, acc.data(), load);
+                    break;
+                case -4:
+                    sumBayerRow<4>(row, rawW, outW, binX, acc.data(), load);
+                    break;
+                default:
+                    if (bayer)
+                        sumBayerRow<0>(row, rawW, outW, binX, acc.data(), load);
+                    else
+                        sumRow<0>(row, outW, binX, acc.data(), load);
+                    break;
+            }
+        }
+
+        T *dst = out + static_cast<size_t>(y) * outW;
+        for (uint32_t x = 0; x < outW; x++)
+            dst[x] = store(acc[x]);
+    }
+}
+
+// Bin with the given load and store of each pixel, in parallel over rows
+template <typename T, typename Acc, typename Load, typename Store>
+void binFrameRows(const uint8_t *rawFrame, uint8_t *binFrame, uint32_t rawW, uint32_t rawH, int binX, int binY,
+                  bool bayer, Load load, Store store)
+{
+    const T *raw        = reinterpret_cast<const T *>(rawFrame);
+    T *out              = reinterpret_cast<T *>(binFrame);
+    const uint32_t outW = rawW / binX;
+    forEachRowRange(rawH / binY, [ = ](uint32_t first, uint32_t last)
+    {
+        binRows<T, Acc>(raw, out, rawW, rawH, outW, first, last, binX, binY, bayer, load, store);
+    });
+}
+
+// Bin summing pixels, saturated to the pixel type
+template <typename T, typename Acc>
+void binFrameSaturated(const uint8_t *rawFrame, uint8_t *binFrame, uint32_t rawW, uint32_t rawH, int binX, int binY,
+                       bool bayer)
+{
+    binFrameRows<T, Acc>(rawFrame, binFrame, rawW, rawH, binX, binY, bayer, [](T v)
+    {
+        return static_cast<Acc>(v);
+    }, [](Acc sum)
+    {
+        return static_cast<T>(std::min<Acc>(sum, std::numeric_limits<T>::max()));
+    });
+}
+
+// 2x2 with the SIMD loop, the remaining pixels of each row summed here
+template <typename T, typename Loop, typename Store>
+void bin2x2Frame(const uint8_t *rawFrame, uint8_t *binFrame, uint32_t rawW, uint32_t rawH, Loop loop, Store store)
+{
+    const T *raw        = reinterpret_cast<const T *>(rawFrame);
+    T *out              = reinterpret_cast<T *>(binFrame);
+    const uint32_t outW = rawW / 2;
+    forEachRowRange(rawH / 2, [ = ](uint32_t first, uint32_t last)
+    {
+        for (uint32_t y = first; y < last; y++)
+        {
+            const T *row0 = raw + static_cast<size_t>(2 * y) * rawW;
+            const T *row1 = row0 + rawW;
+            T *dst        = out + static_cast<size_t>(y) * outW;
+            for (uint32_t x = loop(row0, row1, dst, outW); x < outW; x++)
+                dst[x] = store(static_cast<uint32_t>(row0[2 * x]) + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1]);
+        }
+    });
+}
+
+}
+}
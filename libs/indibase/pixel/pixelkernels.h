@@ -0,0 +1,328 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INDI_PIXEL_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define INDI_PIXEL_NEON
+#include <arm_neon.h>
+#endif
+
+/* Pixel kernels shared by the CCD, sensor and stream code.
+ * Buffers come with their bits per pixel (8, 16, 32 or the FITS -32 / -64 for floating point), the
+ * dispatch helpers turn that into a pixel type once so that the loops are written for a type only.
+ * Kernels taking 8 or 16 bits pixels have SIMD versions picked at run time, the others are plain loops
+ * the compiler vectorizes.
+ */
+namespace INDI
+{
+namespace Pixel
+{
+
+template <typename T>
+struct PixelTag
+{
+    using type = T;
+};
+
+/** Call fn(PixelTag<T>()) with the unsigned pixel type of 8, 16 or 32 bits per pixel.
+ *  @return false if bpp is none of those.
+ */
+template <typename Fn>
+bool withUnsignedPixelType(int bpp, Fn &&fn)
+{
+    switch (bpp)
+    {
+        case 8:
+            fn(PixelTag<uint8_t>());
+            return true;
+        case 16:
+            fn(PixelTag<uint16_t>());
+            return true;
+        case 32:
+            fn(PixelTag<uint32_t>());
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** Same as withUnsignedPixelType, plus 64 bits unsigned and the float (-32) and double (-64) pixels of FITS. */
+template <typename Fn>
+bool withPixelType(int bpp, Fn &&fn)
+{
+    switch (bpp)
+    {
+        case 64:
+            fn(PixelTag<uint64_t>());
+            return true;
+        case -32:
+            fn(PixelTag<float>());
+            return true;
+        case -64:
+            fn(PixelTag<double>());
+            return true;
+        default:
+            return withUnsignedPixelType(bpp, fn);
+    }
+}
+
+/** Smallest and largest of count pixels. Leaves min and max alone when count is 0. */
+template <typename T>
+void minMax(const T *pixels, size_t count, T &min, T &max)
+{
+    if (count == 0)
+        return;
+    T lo = pixels[0], hi = pixels[0];
+    for (size_t i = 1; i < count; i++)
+    {
+        lo = std::min(lo, pixels[i]);
+        hi = std::max(hi, pixels[i]);
+    }
+    min = lo;
+    max = hi;
+}
+
+namespace detail
+{
+
+// Each loop handles a multiple of its vector width, returning how many pixels it looked at
+using MinMaxFn8  = size_t (*)(const uint8_t *, size_t, uint8_t &, uint8_t &);
+using MinMaxFn16 = size_t (*)(const uint16_t *, size_t, uint16_t &, uint16_t &);
+
+inline size_t minMaxNone8(const uint8_t *, size_t, uint8_t &, uint8_t &)
+{
+    return 0;
+}
+
+inline size_t minMaxNone16(const uint16_t *, size_t, uint16_t &, uint16_t &)
+{
+    return 0;
+}
+
+#if defined(INDI_PIXEL_X86)
+
+__attribute__((target("sse2")))
+inline size_t minMaxSse2_8(const uint8_t *pixels, size_t count, uint8_t &min, uint8_t &max)
+{
+    size_t n = count & ~size_t(15);
+    if (n == 0)
+        return 0;
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels)), hi = lo;
+    for (size_t i = 16; i < n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        lo = _mm_min_epu8(lo, v);
+        hi = _mm_max_epu8(hi, v);
+    }
+    alignas(16) uint8_t los[16], his[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(los), lo);
+    _mm_store_si128(reinterpret_cast<__m128i *>(his), hi);
+    min = *std::min_element(los, los + 16);
+    max = *std::max_element(his, his + 16);
+    return n;
+}
+
+// SSE2 only compares signed 16 bits words, flipping the sign bit keeps the order of unsigned ones
+__attribute__((target("sse2")))
+inline size_t minMaxSse2_16(const uint16_t *pixels, size_t count, uint16_t &min, uint16_t &max)
+{
+    size_t n = count & ~size_t(7);
+    if (n == 0)
+        return 0;
+    const __m128i sign = _mm_set1_epi16(static_cast<short>(0x8000));
+    __m128i lo = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels)), sign), hi = lo;
+    for (size_t i = 8; i < n; i += 8)
+    {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i)), sign);
+        lo = _mm_min_epi16(lo, v);
+        hi = _mm_max_epi16(hi, v);
+    }
+    alignas(16) uint16_t los[8], his[8];
+    _mm_store_si128(reinterpret_cast<__m128i *>(los), _mm_xor_si128(lo, sign));
+    _mm_store_si128(reinterpret_cast<__m128i *>(his), _mm_xor_si128(hi, sign));
+    min = *std::min_element(los, los + 8);
+    max = *std::max_element(his, his + 8);
+    return n;
+}
+
+__attribute__((target("avx2")))
+inline size_t minMaxAvx2_8(const uint8_t *pixels, size_t count, uint8_t &min, uint8_t &max)
+{
+    size_t n = count & ~size_t(31);
+    if (n == 0)
+        return 0;
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels)), hi = lo;
+    for (size_t i = 32; i < n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+        lo = _mm256_min_epu8(lo, v);
+        hi = _mm256_max_epu8(hi, v);
+    }
+    alignas(32) uint8_t los[32], his[32];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(los), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(his), hi);
+    min = *std::min_element(los, los + 32);
+    max = *std::max_element(his, his + 32);
+    return n;
+}
+
+__attribute__((target("avx2")))
+inline size_t minMaxAvx2_16(const uint16_t *pixels, size_t count, uint16_t &min, uint16_t &max)
+{
+    size_t n = count & ~size_t(15);
+    if (n == 0)
+        return 0;
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels)), hi = lo;
+    for (size_t i = 16; i < n; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+        lo = _mm256_min_epu16(lo, v);
+        hi = _mm256_max_epu16(hi, v);
+    }
+    alignas(32) uint16_t los[16], his[16];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(los), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(his), hi);
+    min = *std::min_element(los, los + 16);
+    max = *std::max_element(his, his + 16);
+    return n;
+}
+
+#elif defined(INDI_PIXEL_NEON)
+
+inline size_t minMaxNeon8(const uint8_t *pixels, size_t count, uint8_t &min, uint8_t &max)
+{
+    size_t n = count & ~size_t(15);
+    if (n == 0)
+        return 0;
+    uint8x16_t lo = vld1q_u8(pixels), hi = lo;
+    for (size_t i = 16; i < n; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(pixels + i);
+        lo = vminq_u8(lo, v);
+        hi = vmaxq_u8(hi, v);
+    }
+    min = vminvq_u8(lo);
+    max = vmaxvq_u8(hi);
+    return n;
+}
+
+inline size_t minMaxNeon16(const uint16_t *pixels, size_t count, uint16_t &min, uint16_t &max)
+{
+    size_t n = count & ~size_t(7);
+    if (n == 0)
+        return 0;
+    uint16x8_t lo = vld1q_u16(pixels), hi = lo;
+    for (size_t i = 8; i < n; i += 8)
+    {
+        uint16x8_t v = vld1q_u16(pixels + i);
+        lo = vminq_u16(lo, v);
+        hi = vmaxq_u16(hi, v);
+    }
+    min = vminvq_u16(lo);
+    max = vmaxvq_u16(hi);
+    return n;
+}
+
+#endif
+
+struct MinMaxLoops
+{
+    MinMaxFn8 loop8   = minMaxNone8;
+    MinMaxFn16 loop16 = minMaxNone16;
+
+    MinMaxLoops()
+    {
+#if defined(INDI_PIXEL_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            loop8  = minMaxAvx2_8;
+            loop16 = minMaxAvx2_16;
+        }
+        else if (__builtin_cpu_supports("sse2"))
+        {
+            loop8  = minMaxSse2_8;
+            loop16 = minMaxSse2_16;
+        }
+#elif defined(INDI_PIXEL_NEON)
+        loop8  = minMaxNeon8;
+        loop16 = minMaxNeon16;
+#endif
+    }
+};
+
+inline const MinMaxLoops &minMaxLoops()
+{
+    static const MinMaxLoops loops;
+    return loops;
+}
+
+// The vector loop, then the pixels left over
+template <typename T, typename Loop>
+void minMaxWith(Loop loop, const T *pixels, size_t count, T &min, T &max)
+{
+    T lo, hi;
+    size_t done = loop(pixels, count, lo, hi);
+    if (done == 0)
+    {
+        Pixel::minMax<T>(pixels, count, min, max);
+        return;
+    }
+    for (size_t i = done; i < count; i++)
+    {
+        lo = std::min(lo, pixels[i]);
+        hi = std::max(hi, pixels[i]);
+    }
+    min = lo;
+    max = hi;
+}
+
+}
+
+inline void minMax(const uint8_t *pixels, size_t count, uint8_t &min, uint8_t &max)
+{
+    detail::minMaxWith(detail::minMaxLoops().loop8, pixels, count, min, max);
+}
+
+inline void minMax(const uint16_t *pixels, size_t count, uint16_t &min, uint16_t &max)
+{
+    detail::minMaxWith(detail::minMaxLoops().loop16, pixels, count, min, max);
+}
+
+/** Copy rows of rowBytes bytes between two buffers of different strides, in one block when both are packed. */
+inline void copyRows(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride, size_t rowBytes,
+                     size_t rows)
+{
+    if (srcStride == rowBytes && dstStride == rowBytes)
+    {
+        std::memcpy(dst, src, rowBytes * rows);
+        return;
+    }
+    for (size_t row = 0; row < rows; row++)
+        std::memcpy(dst + row * dstStride, src + row * srcStride, rowBytes);
+}
+
+}
+}
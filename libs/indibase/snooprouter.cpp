@@ -0,0 +1,248 @@
+/*******************************************************************************
+ Routing of snooped properties to typed handlers.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "snooprouter.h"
+
+#include "indicom.h"
+#include "indidevapi.h"
+#include "locale_compat.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace INDI
+{
+
+static const char *vectorTag(SnoopRouter::Type type)
+{
+    switch (type)
+    {
+        case SnoopRouter::NUMBER:
+            return "NumberVector";
+        case SnoopRouter::TEXT:
+            return "TextVector";
+        case SnoopRouter::SWITCH:
+            return "SwitchVector";
+        case SnoopRouter::LIGHT:
+            return "LightVector";
+    }
+    return "";
+}
+
+bool SnoopUpdate::isOn(size_t index) const
+{
+    return has(index) && !strcmp(m_Texts[index], "On");
+}
+
+int SnoopRouter::add(Type type, const std::string &device, const std::string &property,
+                     const std::vector<std::string> &elements, const Handler &handler)
+{
+    int id = m_NextID++;
+    Subscription &subscription = m_Subscriptions[id];
+    subscription.type = type;
+    subscription.device = device;
+    subscription.property = property;
+    subscription.elements = elements;
+    subscription.positions.assign(elements.size(), -1);
+    subscription.handler = handler;
+    link(id, subscription);
+    return id;
+}
+
+void SnoopRouter::remove(int id)
+{
+    auto it = m_Subscriptions.find(id);
+    if (it == m_Subscriptions.end())
+        return;
+    unlink(id, it->second);
+    // The handler being called may be the one removed, it is erased once the message is dispatched
+    if (m_Dispatching)
+    {
+        it->second.removed = true;
+        m_Removed.push_back(id);
+    }
+    else
+        m_Subscriptions.erase(it);
+}
+
+bool SnoopRouter::setDevice(int id, const std::string &device)
+{
+    auto it = m_Subscriptions.find(id);
+    if (it == m_Subscriptions.end() || it->second.removed)
+        return false;
+    unlink(id, it->second);
+    it->second.device = device;
+    std::fill(it->second.positions.begin(), it->second.positions.end(), -1);
+    link(id, it->second);
+    return true;
+}
+
+std::string SnoopRouter::device(int id) const
+{
+    auto it = m_Subscriptions.find(id);
+    return it == m_Subscriptions.end() || it->second.removed ? std::string() : it->second.device;
+}
+
+std::string SnoopRouter::property(int id) const
+{
+    auto it = m_Subscriptions.find(id);
+    return it == m_Subscriptions.end() || it->second.removed ? std::string() : it->second.property;
+}
+
+const std::string &SnoopRouter::key(const std::string &device, const std::string &property)
+{
+    m_Key.assign(device);
+    m_Key += '\n';
+    m_Key += property;
+    return m_Key;
+}
+
+void SnoopRouter::link(int id, const Subscription &subscription)
+{
+    m_Index[key(subscription.device, subscription.property)].push_back(id);
+}
+
+void SnoopRouter::unlink(int id, const Subscription &subscription)
+{
+    auto it = m_Index.find(key(subscription.device, subscription.property));
+    if (it == m_Index.end())
+        return;
+    it->second.erase(std::remove(it->second.begin(), it->second.end(), id), it->second.end());
+    if (it->second.empty())
+        m_Index.erase(it);
+}
+
+bool SnoopRouter::dispatch(XMLEle *root)
+{
+    if (m_Index.empty())
+        return false;
+
+    const char *device = findXMLAttValu(root, "device");
+    const char *name = findXMLAttValu(root, "name");
+    m_Key.assign(device);
+    m_Key += '\n';
+    m_Key += name;
+    auto it = m_Index.find(m_Key);
+    if (it == m_Index.end())
+        return false;
+
+    // delProperty and messages without elements carry nothing to hand over
+    const char *tag = tagXMLEle(root);
+    if (strncmp(tag, "set", 3) && strncmp(tag, "def", 3))
+        return false;
+
+    m_Children.clear();
+    for (XMLEle *ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
+        m_Children.push_back(ep);
+
+    // Handlers may subscribe and unsubscribe while they run
+    m_Matching = it->second;
+    m_Dispatching = true;
+    bool handled = false;
+    for (int id : m_Matching)
+    {
+        auto subscription = m_Subscriptions.find(id);
+        if (subscription == m_Subscriptions.end() || subscription->second.removed ||
+                strcmp(tag + 3, vectorTag(subscription->second.type)))
+            continue;
+
+        parse(subscription->second, root);
+        subscription->second.handler(subscription->second.update);
+        handled = true;
+    }
+    m_Dispatching = false;
+
+    for (int id : m_Removed)
+        m_Subscriptions.erase(id);
+    m_Removed.clear();
+    return handled;
+}
+
+void SnoopRouter::parse(Subscription &subscription, XMLEle *root)
+{
+    SnoopUpdate &update = subscription.update;
+    update.m_Device = findXMLAttValu(root, "device");
+    update.m_Name = findXMLAttValu(root, "name");
+    IPState state = IPS_IDLE;
+    if (crackIPState(findXMLAttValu(root, "state"), &state) == 0)
+        update.m_State = state;
+
+    bool all = subscription.elements.empty();
+    size_t count = all ? m_Children.size() : subscription.elements.size();
+    update.m_Elements.resize(count);
+    update.m_Texts.assign(count, "");
+    update.m_Numbers.assign(count, 0);
+    update.m_Found.assign(count, 0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        XMLEle *element = nullptr;
+        if (all)
+        {
+            element = m_Children[i];
+            update.m_Elements[i] = findXMLAttValu(element, "name");
+        }
+        else
+        {
+            const char *wanted = subscription.elements[i].c_str();
+            update.m_Elements[i] = wanted;
+
+            // Try where the element was last time before looking through the message
+            int position = subscription.positions[i];
+            if (position >= 0 && position < static_cast<int>(m_Children.size()) &&
+                    !strcmp(findXMLAttValu(m_Children[position], "name"), wanted))
+                element = m_Children[position];
+            else
+            {
+                for (size_t j = 0; j < m_Children.size(); j++)
+                {
+                    if (!strcmp(findXMLAttValu(m_Children[j], "name"), wanted))
+                    {
+                        element = m_Children[j];
+                        subscription.positions[i] = static_cast<int>(j);
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (element == nullptr)
+            continue;
+
+        update.m_Texts[i] = pcdataXMLEle(element);
+        update.m_Found[i] = 1;
+    }
+
+    if (subscription.type != NUMBER)
+        return;
+
+    // values may come as IEEE 754 bits, see fs_ieee754()
+    bool ieee754 = !strcmp(findXMLAttValu(root, "encoding"), "ieee754");
+    locale_char_t *orig = indi_locale_C_numeric_push();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!update.m_Found[i])
+            continue;
+        if ((ieee754 ? f_scanieee754(update.m_Texts[i], &update.m_Numbers[i]) :
+                f_scansexa(update.m_Texts[i], &update.m_Numbers[i])) < 0)
+            update.m_Found[i] = 0;
+    }
+    indi_locale_C_numeric_pop(orig);
+}
+
+}
@@ -0,0 +1,189 @@
+/*******************************************************************************
+ Routing of snooped properties to typed handlers.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include "indiapi.h"
+#include "lilxml.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The SnoopUpdate class holds the elements of one snooped message a handler subscribed to.
+ *
+ * Elements are indexed in the order they were given to the subscription, or in the order of the
+ * message for subscriptions to every element. Texts and names point into the message and are only
+ * valid while the handler runs.
+ */
+class SnoopUpdate
+{
+    public:
+        /** @return The device that sent the property. */
+        const char *device() const
+        {
+            return m_Device;
+        }
+        /** @return The property name. */
+        const char *name() const
+        {
+            return m_Name;
+        }
+        /** @return The state of the property. */
+        IPState state() const
+        {
+            return m_State;
+        }
+        /** @return The number of elements. */
+        size_t count() const
+        {
+            return m_Found.size();
+        }
+        /** @return True if the message carried the element. */
+        bool has(size_t index) const
+        {
+            return index < m_Found.size() && m_Found[index];
+        }
+        /** @return The name of the element. */
+        const char *elementName(size_t index) const
+        {
+            return m_Elements[index];
+        }
+        /** @return The value of a number element, 0 if it was not in the message. */
+        double number(size_t index) const
+        {
+            return has(index) ? m_Numbers[index] : 0;
+        }
+        /** @return The text of a text, switch or light element, an empty string if it was not in the message. */
+        const char *text(size_t index) const
+        {
+            return has(index) ? m_Texts[index] : "";
+        }
+        /** @return True if the switch element is On. */
+        bool isOn(size_t index) const;
+
+    private:
+        friend class SnoopRouter;
+
+        const char *m_Device {nullptr};
+        const char *m_Name {nullptr};
+        IPState m_State {IPS_IDLE};
+        std::vector<const char *> m_Elements;
+        std::vector<const char *> m_Texts;
+        std::vector<double> m_Numbers;
+        std::vector<char> m_Found;
+};
+
+/**
+ * @brief The SnoopRouter class hands snooped properties to the handlers subscribed to them.
+ *
+ * Subscriptions are keyed by device and property, so a snooped message nobody subscribed to costs one
+ * lookup and is never parsed. A matching message is parsed once for all its subscriptions: the
+ * position of each element in the message is remembered, which the next messages of the property
+ * almost always share, and only the values of the subscribed elements are converted.
+ */
+class SnoopRouter
+{
+    public:
+        enum Type
+        {
+            NUMBER,
+            TEXT,
+            SWITCH,
+            LIGHT
+        };
+
+        using Handler = std::function<void(const SnoopUpdate &update)>;
+
+        /**
+         * @brief add Subscribe to a snooped property.
+         * @param type The type of the property, messages of other types are ignored.
+         * @param device The snooped device.
+         * @param property The snooped property.
+         * @param elements The elements the handler needs, empty for every element of each message.
+         * @param handler Called with the elements of every message of the property.
+         * @return The subscription identifier.
+         */
+        int add(Type type, const std::string &device, const std::string &property,
+                const std::vector<std::string> &elements, const Handler &handler);
+
+        /**
+         * @brief remove Drop a subscription, may be called from a handler.
+         */
+        void remove(int id);
+
+        /**
+         * @brief setDevice Follow another device with a subscription, e.g. when the user selected another mount.
+         * @return False if there is no such subscription.
+         */
+        bool setDevice(int id, const std::string &device);
+
+        /**
+         * @return The device a subscription follows, empty if there is no such subscription.
+         */
+        std::string device(int id) const;
+
+        /**
+         * @return The property a subscription follows, empty if there is no such subscription.
+         */
+        std::string property(int id) const;
+
+        /**
+         * @brief dispatch Call the handlers of a snooped message.
+         * @return True if at least one handler was called.
+         */
+        bool dispatch(XMLEle *root);
+
+    private:
+        struct Subscription
+        {
+            Type type;
+            std::string device;
+            std::string property;
+            std::vector<std::string> elements;
+            // Position of each element in the last message, -1 until seen
+            std::vector<int> positions;
+            Handler handler;
+            SnoopUpdate update;
+            bool removed {false};
+        };
+
+        const std::string &key(const std::string &device, const std::string &property);
+        void link(int id, const Subscription &subscription);
+        void unlink(int id, const Subscription &subscription);
+        void parse(Subscription &subscription, XMLEle *root);
+
+        std::map<int, Subscription> m_Subscriptions;
+        std::unordered_map<std::string, std::vector<int>> m_Index;
+        int m_NextID {0};
+        bool m_Dispatching {false};
+        std::vector<int> m_Removed;
+
+        // Reused between messages
+        std::string m_Key;
+        std::vector<int> m_Matching;
+        std::vector<XMLEle *> m_Children;
+};
+
+}
@@ -92,6 +92,8 @@ void ccvt_420p_rgb24(int width, int height, const void *src, void *dst);
 void ccvt_420p_bgr32(int width, int height, const void *src, void *dst);
 /** 4:2:0 YUV planar to RGB/BGR     */
 void ccvt_420p_rgb32(int width, int height, const void *src, void *dst);
+/** 4:2:0 YUV planar to RGB24, the planes apart, e.g. a band of rows of a frame */
+void ccvt_420p_rgb24_planes(int width, int height, const void *srcy, const void *srcu, const void *srcv, void *dst);
 
 /** 4:2:2 YUYV interlaced to RGB/BGR */
 //void ccvt_yuyv_rgb32(int width, int height, const void *src, void *dst);
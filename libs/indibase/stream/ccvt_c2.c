@@ -22,6 +22,7 @@
 
 #include "ccvt.h"
 #include "ccvt_types.h"
+#include "ccvt_simd.h"
 
 /* by suitable definition of PIXTYPE, can do yuv to rgb or bgr, with or
 without word alignment */
@@ -116,9 +117,69 @@ void ccvt_420p_bgr32(int width, int height, const void *src, void *dst)
     WHOLE_FUNC2RGB(bgr32)
 }
 
+/* 24 bit RGB or BGR, the row kernels doing the start of each pair of rows */
+static void p420_24(int width, int height, const unsigned char *y1, const unsigned char *u, const unsigned char *v,
+                    unsigned char *dst, int bgr)
+{
+    const unsigned char *y2;
+    unsigned char *l1, *l2;
+    int r, g, b, cr, cg, cb, yp, j, i, k, done;
+
+    if ((width & 1) || (height & 1))
+        return;
+
+    l1 = dst;
+    l2 = l1 + 3 * width;
+    y2 = y1 + width;
+    j  = height / 2;
+    while (j--)
+    {
+        done = ccvt_row_420p_rgb24(y1, y2, u, v, l1, l2, width, bgr);
+        y1 += done;
+        y2 += done;
+        u += done / 2;
+        v += done / 2;
+        l1 += 3 * done;
+        l2 += 3 * done;
+        i = (width - done) / 2;
+        while (i--)
+        {
+            /* Since U & V are valid for 4 pixels, repeat code 4 times for different Y */
+            cb = ((*u - 128) * 454) >> 8;
+            cr = ((*v - 128) * 359) >> 8;
+            cg = ((*v - 128) * 183 + (*u - 128) * 88) >> 8;
+
+            for (k = 0; k < 4; k++)
+            {
+                unsigned char **l = k < 2 ? &l1 : &l2;
+
+                yp = k < 2 ? *(y1++) : *(y2++);
+                r  = yp + cr;
+                b  = yp + cb;
+                g  = yp - cg;
+                SAT(r);
+                SAT(g);
+                SAT(b);
+                *(*l)++ = bgr ? b : r;
+                *(*l)++ = g;
+                *(*l)++ = bgr ? r : b;
+            }
+
+            u++;
+            v++;
+        }
+        y1 = y2;
+        y2 += width;
+        l1 = l2;
+        l2 += 3 * width;
+    }
+}
+
 void ccvt_420p_bgr24(int width, int height, const void *src, void *dst)
 {
-    WHOLE_FUNC2RGB(bgr24)
+    const unsigned char *y = (const unsigned char *)src;
+
+    p420_24(width, height, y, y + width * height, y + width * height + (width * height) / 4, dst, 1);
 }
 
 void ccvt_420p_rgb32(int width, int height, const void *src, void *dst)
@@ -128,5 +189,12 @@ void ccvt_420p_rgb32(int width, int height, const void *src, void *dst)
 
 void ccvt_420p_rgb24(int width, int height, const void *src, void *dst)
 {
-    WHOLE_FUNC2RGB(rgb24)
+    const unsigned char *y = (const unsigned char *)src;
+
+    p420_24(width, height, y, y + width * height, y + width * height + (width * height) / 4, dst, 0);
+}
+
+void ccvt_420p_rgb24_planes(int width, int height, const void *srcy, const void *srcu, const void *srcv, void *dst)
+{
+    p420_24(width, height, srcy, srcu, srcv, dst, 0);
 }
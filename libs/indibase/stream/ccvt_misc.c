@@ -59,6 +59,7 @@
 
 #include "ccvt.h"
 #include "ccvt_types.h"
+#include "ccvt_simd.h"
 //#include "indidevapi.h"
 #include "jpegutils.h"
 
@@ -124,11 +125,12 @@ void ccvt_yuyv_bgr32(int width, int height, const void *src, void *dst)
     }
 }
 
-void ccvt_yuyv_bgr24(int width, int height, const void *src, void *dst)
+/* YUYV to 24 bit RGB, or BGR, the row kernels doing the start of each row */
+static void yuyv_24(int width, int height, const void *src, void *dst, int bgr)
 {
     const unsigned char *s;
-    PIXTYPE_bgr24 *d;
-    int l, c;
+    unsigned char *d;
+    int l, c, done;
     int r, g, b, cr, cg, cb, y1, y2;
 
     l = height;
@@ -136,7 +138,10 @@ void ccvt_yuyv_bgr24(int width, int height, const void *src, void *dst)
     d = dst;
     while (l--)
     {
-        c = width >> 1;
+        done = ccvt_row_yuyv_rgb24(s, d, 2 * (width >> 1), bgr);
+        s += 2 * done;
+        d += 3 * done;
+        c = (width >> 1) - done / 2;
         while (c--)
         {
             y1 = *s++;
@@ -152,73 +157,35 @@ void ccvt_yuyv_bgr24(int width, int height, const void *src, void *dst)
             SAT(r);
             SAT(g);
             SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
+            *d++ = bgr ? b : r;
+            *d++ = g;
+            *d++ = bgr ? r : b;
             r = y2 + cr;
             b = y2 + cb;
             g = y2 - cg;
             SAT(r);
             SAT(g);
             SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
+            *d++ = bgr ? b : r;
+            *d++ = g;
+            *d++ = bgr ? r : b;
         }
     }
 }
 
-void ccvt_yuyv_rgb24(int width, int height, const void *src, void *dst)
+void ccvt_yuyv_bgr24(int width, int height, const void *src, void *dst)
 {
-    const unsigned char *s;
-    PIXTYPE_rgb24 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
-    {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
+    yuyv_24(width, height, src, dst, 1);
+}
 
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->r = r;
-            d->g = g;
-            d->b = b;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->r = r;
-            d->g = g;
-            d->b = b;
-            d++;
-        }
-    }
+void ccvt_yuyv_rgb24(int width, int height, const void *src, void *dst)
+{
+    yuyv_24(width, height, src, dst, 0);
 }
 
 void ccvt_yuyv_420p(int width, int height, const void *src, void *dsty, void *dstu, void *dstv)
 {
-    int n, l, j;
+    int l, j, done;
     const unsigned char *s1, *s2;
     unsigned char *dy, *du, *dv;
 
@@ -230,22 +197,30 @@ void ccvt_yuyv_420p(int width, int height, const void *src, void *dsty, void *ds
     du = (unsigned char *)dstu;
     dv = (unsigned char *)dstv;
     s1 = (unsigned char *)src;
-    s2 = s1; /* keep pointer */
-    n  = width * height;
-    for (; n > 0; n--)
+    for (l = 0; l < height; l++)
     {
-        *dy = *s1;
-        dy++;
-        s1 += 2;
+        done = ccvt_row_yuyv_y(s1, dy, width);
+        dy += done;
+        s1 += 2 * done;
+        for (j = done; j < width; j++)
+        {
+            *dy = *s1;
+            dy++;
+            s1 += 2;
+        }
     }
 
     /* Two options here: average U/V values, or skip every second row */
-    s1 = s2; /* restore pointer */
-    s1++;    /* point to U */
+    s1 = (unsigned char *)src;
     for (l = 0; l < height; l += 2)
     {
-        s2 = s1 + width * 2; /* odd line */
-        for (j = 0; j < width; j += 2)
+        s2   = s1 + width * 2; /* odd line */
+        done = ccvt_row_yuyv_uv(s1, s2, du, dv, width);
+        du += done / 2;
+        dv += done / 2;
+        s1 += 2 * done + 1; /* point to U */
+        s2 += 2 * done + 1;
+        for (j = done; j < width; j += 2)
         {
             *du = (*s1 + *s2) / 2;
             du++;
@@ -256,7 +231,7 @@ void ccvt_yuyv_420p(int width, int height, const void *src, void *dsty, void *ds
             s1 += 2;
             s2 += 2;
         }
-        s1 = s2;
+        s1 = s2 - 1;
     }
 }
 
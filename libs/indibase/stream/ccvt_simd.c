@@ -0,0 +1,517 @@
+/*  CCVT: ColourConVerT: simple library for converting colourspaces
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* SIMD row kernels of the YUV conversions.
+ *
+ * The scalar loops compute, for each U/V pair shared by two pixels,
+ *   cb = ((u - 128) * 454) >> 8, cr = ((v - 128) * 359) >> 8, cg = ((u - 128) * 88 + (v - 128) * 183) >> 8
+ * and then r = y + cr, g = y - cg, b = y + cb saturated to 0..255.
+ * On x86 the (u - 128, v - 128) pairs sit in 32 bit lanes so that one madd per coefficient pair gives
+ * the exact 32 bit sums; NEON widens with vmull. Output is identical to the scalar loops.
+ */
+
+#include "ccvt_simd.h"
+
+static int yuyv_rgb24_none(const unsigned char *src, unsigned char *dst, int width, int bgr)
+{
+    (void)src;
+    (void)dst;
+    (void)width;
+    (void)bgr;
+    return 0;
+}
+
+static int p420_rgb24_none(const unsigned char *y1, const unsigned char *y2, const unsigned char *u,
+                           const unsigned char *v, unsigned char *dst1, unsigned char *dst2, int width, int bgr)
+{
+    (void)y1;
+    (void)y2;
+    (void)u;
+    (void)v;
+    (void)dst1;
+    (void)dst2;
+    (void)width;
+    (void)bgr;
+    return 0;
+}
+
+static int yuyv_y_none(const unsigned char *src, unsigned char *dsty, int width)
+{
+    (void)src;
+    (void)dsty;
+    (void)width;
+    return 0;
+}
+
+static int yuyv_uv_none(const unsigned char *src1, const unsigned char *src2, unsigned char *dstu,
+                        unsigned char *dstv, int width)
+{
+    (void)src1;
+    (void)src2;
+    (void)dstu;
+    (void)dstv;
+    (void)width;
+    return 0;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CCVT_X86
+#include <immintrin.h>
+
+/* 8 pixels of chroma from 4 (u, v) pairs as 16 bit lanes, each pair value written twice */
+__attribute__((target("ssse3")))
+static inline void chroma_ssse3(__m128i uv, __m128i *cb, __m128i *cr, __m128i *cg)
+{
+    const __m128i lo = _mm_set1_epi32(0xffff);
+    __m128i b, r, g;
+
+    uv = _mm_sub_epi16(uv, _mm_set1_epi16(128));
+    b  = _mm_srai_epi32(_mm_madd_epi16(uv, _mm_set1_epi32(454)), 8);
+    r  = _mm_srai_epi32(_mm_madd_epi16(uv, _mm_set1_epi32(359 << 16)), 8);
+    g  = _mm_srai_epi32(_mm_madd_epi16(uv, _mm_set1_epi32(88 | (183 << 16))), 8);
+
+    *cb = _mm_or_si128(_mm_and_si128(b, lo), _mm_slli_epi32(b, 16));
+    *cr = _mm_or_si128(_mm_and_si128(r, lo), _mm_slli_epi32(r, 16));
+    *cg = _mm_or_si128(_mm_and_si128(g, lo), _mm_slli_epi32(g, 16));
+}
+
+/* interleave 16 pixels of planar r, g, b into 48 bytes */
+__attribute__((target("ssse3")))
+static inline void store_rgb24_ssse3(unsigned char *dst, __m128i r, __m128i g, __m128i b)
+{
+    const __m128i r0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+    const __m128i g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+    const __m128i b0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const __m128i r1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+    const __m128i g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+    const __m128i b1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+    const __m128i r2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+    const __m128i g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+    const __m128i b2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+    _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r0), _mm_shuffle_epi8(g, g0)),
+                     _mm_shuffle_epi8(b, b0)));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r1), _mm_shuffle_epi8(g, g1)),
+                     _mm_shuffle_epi8(b, b1)));
+    _mm_storeu_si128((__m128i *)(dst + 32), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r2), _mm_shuffle_epi8(g, g2)),
+                     _mm_shuffle_epi8(b, b2)));
+}
+
+/* 16 YUYV pixels */
+__attribute__((target("ssse3")))
+static int yuyv_rgb24_ssse3(const unsigned char *src, unsigned char *dst, int width, int bgr)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 2 * x));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 2 * x + 16));
+        __m128i ya = _mm_and_si128(a, lo), yc = _mm_and_si128(c, lo);
+        __m128i cba, cra, cga, cbc, crc, cgc, r, g, b;
+
+        chroma_ssse3(_mm_srli_epi16(a, 8), &cba, &cra, &cga);
+        chroma_ssse3(_mm_srli_epi16(c, 8), &cbc, &crc, &cgc);
+        r = _mm_packus_epi16(_mm_add_epi16(ya, cra), _mm_add_epi16(yc, crc));
+        g = _mm_packus_epi16(_mm_sub_epi16(ya, cga), _mm_sub_epi16(yc, cgc));
+        b = _mm_packus_epi16(_mm_add_epi16(ya, cba), _mm_add_epi16(yc, cbc));
+        if (bgr)
+            store_rgb24_ssse3(dst + 3 * x, b, g, r);
+        else
+            store_rgb24_ssse3(dst + 3 * x, r, g, b);
+    }
+    return x;
+}
+
+/* 16 pixels of each row */
+__attribute__((target("ssse3")))
+static int p420_rgb24_ssse3(const unsigned char *y1, const unsigned char *y2, const unsigned char *u,
+                            const unsigned char *v, unsigned char *dst1, unsigned char *dst2, int width, int bgr)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i uv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(u + x / 2)),
+                                       _mm_loadl_epi64((const __m128i *)(v + x / 2)));
+        __m128i cbl, crl, cgl, cbh, crh, cgh;
+        int row;
+
+        chroma_ssse3(_mm_unpacklo_epi8(uv, zero), &cbl, &crl, &cgl);
+        chroma_ssse3(_mm_unpackhi_epi8(uv, zero), &cbh, &crh, &cgh);
+        for (row = 0; row < 2; row++)
+        {
+            __m128i y  = _mm_loadu_si128((const __m128i *)((row ? y2 : y1) + x));
+            __m128i yl = _mm_unpacklo_epi8(y, zero), yh = _mm_unpackhi_epi8(y, zero);
+            __m128i r  = _mm_packus_epi16(_mm_add_epi16(yl, crl), _mm_add_epi16(yh, crh));
+            __m128i g  = _mm_packus_epi16(_mm_sub_epi16(yl, cgl), _mm_sub_epi16(yh, cgh));
+            __m128i b  = _mm_packus_epi16(_mm_add_epi16(yl, cbl), _mm_add_epi16(yh, cbh));
+            unsigned char *dst = (row ? dst2 : dst1) + 3 * x;
+
+            if (bgr)
+                store_rgb24_ssse3(dst, b, g, r);
+            else
+                store_rgb24_ssse3(dst, r, g, b);
+        }
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static inline void chroma_avx2(__m256i uv, __m256i *cb, __m256i *cr, __m256i *cg)
+{
+    const __m256i lo = _mm256_set1_epi32(0xffff);
+    __m256i b, r, g;
+
+    uv = _mm256_sub_epi16(uv, _mm256_set1_epi16(128));
+    b  = _mm256_srai_epi32(_mm256_madd_epi16(uv, _mm256_set1_epi32(454)), 8);
+    r  = _mm256_srai_epi32(_mm256_madd_epi16(uv, _mm256_set1_epi32(359 << 16)), 8);
+    g  = _mm256_srai_epi32(_mm256_madd_epi16(uv, _mm256_set1_epi32(88 | (183 << 16))), 8);
+
+    *cb = _mm256_or_si256(_mm256_and_si256(b, lo), _mm256_slli_epi32(b, 16));
+    *cr = _mm256_or_si256(_mm256_and_si256(r, lo), _mm256_slli_epi32(r, 16));
+    *cg = _mm256_or_si256(_mm256_and_si256(g, lo), _mm256_slli_epi32(g, 16));
+}
+
+/* 16 bit pixels 0..7 | 8..15 and 16..23 | 24..31 to bytes 0..31 in order */
+__attribute__((target("avx2")))
+static inline __m256i pack_avx2(__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+}
+
+/* interleave 32 pixels, the shuffles work within 128 bit lanes so each lane makes half of the output */
+__attribute__((target("avx2")))
+static inline void store_rgb24_avx2(unsigned char *dst, __m256i r, __m256i g, __m256i b)
+{
+    const __m256i r0 = _mm256_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5,
+                                        0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+    const __m256i g0 = _mm256_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1,
+                                        -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+    const __m256i b0 = _mm256_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1,
+                                        -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const __m256i r1 = _mm256_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1,
+                                        -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+    const __m256i g1 = _mm256_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10,
+                                        5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+    const __m256i b1 = _mm256_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1,
+                                        -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+    const __m256i r2 = _mm256_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1,
+                                        -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+    const __m256i g2 = _mm256_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1,
+                                        -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+    const __m256i b2 = _mm256_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15,
+                                        10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+    __m256i o0 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, r0), _mm256_shuffle_epi8(g, g0)),
+                                 _mm256_shuffle_epi8(b, b0));
+    __m256i o1 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, r1), _mm256_shuffle_epi8(g, g1)),
+                                 _mm256_shuffle_epi8(b, b1));
+    __m256i o2 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, r2), _mm256_shuffle_epi8(g, g2)),
+                                 _mm256_shuffle_epi8(b, b2));
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_permute2x128_si256(o0, o1, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 32), _mm256_permute2x128_si256(o2, o0, 0x30));
+    _mm256_storeu_si256((__m256i *)(dst + 64), _mm256_permute2x128_si256(o1, o2, 0x31));
+}
+
+/* 32 YUYV pixels */
+__attribute__((target("avx2")))
+static int yuyv_rgb24_avx2(const unsigned char *src, unsigned char *dst, int width, int bgr)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00ff);
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + 2 * x));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + 2 * x + 32));
+        __m256i ya = _mm256_and_si256(a, lo), yc = _mm256_and_si256(c, lo);
+        __m256i cba, cra, cga, cbc, crc, cgc, r, g, b;
+
+        chroma_avx2(_mm256_srli_epi16(a, 8), &cba, &cra, &cga);
+        chroma_avx2(_mm256_srli_epi16(c, 8), &cbc, &crc, &cgc);
+        r = pack_avx2(_mm256_add_epi16(ya, cra), _mm256_add_epi16(yc, crc));
+        g = pack_avx2(_mm256_sub_epi16(ya, cga), _mm256_sub_epi16(yc, cgc));
+        b = pack_avx2(_mm256_add_epi16(ya, cba), _mm256_add_epi16(yc, cbc));
+        if (bgr)
+            store_rgb24_avx2(dst + 3 * x, b, g, r);
+        else
+            store_rgb24_avx2(dst + 3 * x, r, g, b);
+    }
+    return x + yuyv_rgb24_ssse3(src + 2 * x, dst + 3 * x, width - x, bgr);
+}
+
+/* 32 pixels of each row */
+__attribute__((target("avx2")))
+static int p420_rgb24_avx2(const unsigned char *y1, const unsigned char *y2, const unsigned char *u,
+                           const unsigned char *v, unsigned char *dst1, unsigned char *dst2, int width, int bgr)
+{
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        __m128i u8 = _mm_loadu_si128((const __m128i *)(u + x / 2));
+        __m128i v8 = _mm_loadu_si128((const __m128i *)(v + x / 2));
+        __m256i cba, cra, cga, cbc, crc, cgc;
+        int row;
+
+        chroma_avx2(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, v8)), &cba, &cra, &cga);
+        chroma_avx2(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(u8, v8)), &cbc, &crc, &cgc);
+        for (row = 0; row < 2; row++)
+        {
+            __m256i y  = _mm256_loadu_si256((const __m256i *)((row ? y2 : y1) + x));
+            __m256i ya = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(y));
+            __m256i yc = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(y, 1));
+            __m256i r  = pack_avx2(_mm256_add_epi16(ya, cra), _mm256_add_epi16(yc, crc));
+            __m256i g  = pack_avx2(_mm256_sub_epi16(ya, cga), _mm256_sub_epi16(yc, cgc));
+            __m256i b  = pack_avx2(_mm256_add_epi16(ya, cba), _mm256_add_epi16(yc, cbc));
+            unsigned char *dst = (row ? dst2 : dst1) + 3 * x;
+
+            if (bgr)
+                store_rgb24_avx2(dst, b, g, r);
+            else
+                store_rgb24_avx2(dst, r, g, b);
+        }
+    }
+    return x + p420_rgb24_ssse3(y1 + x, y2 + x, u + x / 2, v + x / 2, dst1 + 3 * x, dst2 + 3 * x, width - x, bgr);
+}
+
+/* 16 pixels */
+__attribute__((target("sse2")))
+static int yuyv_y_sse2(const unsigned char *src, unsigned char *dsty, int width)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 2 * x));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 2 * x + 16));
+        _mm_storeu_si128((__m128i *)(dsty + x), _mm_packus_epi16(_mm_and_si128(a, lo), _mm_and_si128(c, lo)));
+    }
+    return x;
+}
+
+/* (a + b) / 2 rounded down, as the scalar loop */
+__attribute__((target("sse2")))
+static inline __m128i average_sse2(__m128i a, __m128i b)
+{
+    return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+
+/* 16 pixels of two rows */
+__attribute__((target("sse2")))
+static int yuyv_uv_sse2(const unsigned char *src1, const unsigned char *src2, unsigned char *dstu,
+                        unsigned char *dstv, int width)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a  = average_sse2(_mm_loadu_si128((const __m128i *)(src1 + 2 * x)),
+                                  _mm_loadu_si128((const __m128i *)(src2 + 2 * x)));
+        __m128i c  = average_sse2(_mm_loadu_si128((const __m128i *)(src1 + 2 * x + 16)),
+                                  _mm_loadu_si128((const __m128i *)(src2 + 2 * x + 16)));
+        __m128i uv = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(c, 8));
+
+        _mm_storel_epi64((__m128i *)(dstu + x / 2), _mm_packus_epi16(_mm_and_si128(uv, lo), lo));
+        _mm_storel_epi64((__m128i *)(dstv + x / 2), _mm_packus_epi16(_mm_srli_epi16(uv, 8), lo));
+    }
+    return x;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define CCVT_NEON
+#include <arm_neon.h>
+
+/* 8 (u, v) pairs */
+static inline void chroma_neon(uint8x8_t u, uint8x8_t v, int16x8_t *cb, int16x8_t *cr, int16x8_t *cg)
+{
+    int16x8_t su = vreinterpretq_s16_u16(vsubl_u8(u, vdup_n_u8(128)));
+    int16x8_t sv = vreinterpretq_s16_u16(vsubl_u8(v, vdup_n_u8(128)));
+
+    *cb = vcombine_s16(vshrn_n_s32(vmull_n_s16(vget_low_s16(su), 454), 8),
+                       vshrn_n_s32(vmull_n_s16(vget_high_s16(su), 454), 8));
+    *cr = vcombine_s16(vshrn_n_s32(vmull_n_s16(vget_low_s16(sv), 359), 8),
+                       vshrn_n_s32(vmull_n_s16(vget_high_s16(sv), 359), 8));
+    *cg = vcombine_s16(vshrn_n_s32(vmlal_n_s16(vmull_n_s16(vget_low_s16(su), 88), vget_low_s16(sv), 183), 8),
+                       vshrn_n_s32(vmlal_n_s16(vmull_n_s16(vget_high_s16(su), 88), vget_high_s16(sv), 183), 8));
+}
+
+/* 16 pixels from the even and odd Y of the 8 pairs */
+static inline void store_rgb24_neon(unsigned char *dst, uint8x8_t y0, uint8x8_t y1, int16x8_t cb, int16x8_t cr,
+                                    int16x8_t cg, int bgr)
+{
+    int16x8_t e = vreinterpretq_s16_u16(vmovl_u8(y0));
+    int16x8_t o = vreinterpretq_s16_u16(vmovl_u8(y1));
+    uint8x8x2_t r = vzip_u8(vqmovun_s16(vaddq_s16(e, cr)), vqmovun_s16(vaddq_s16(o, cr)));
+    uint8x8x2_t g = vzip_u8(vqmovun_s16(vsubq_s16(e, cg)), vqmovun_s16(vsubq_s16(o, cg)));
+    uint8x8x2_t b = vzip_u8(vqmovun_s16(vaddq_s16(e, cb)), vqmovun_s16(vaddq_s16(o, cb)));
+    uint8x16x3_t rgb;
+
+    rgb.val[0] = vcombine_u8(r.val[0], r.val[1]);
+    rgb.val[1] = vcombine_u8(g.val[0], g.val[1]);
+    rgb.val[2] = vcombine_u8(b.val[0], b.val[1]);
+    if (bgr)
+    {
+        uint8x16_t t = rgb.val[0];
+        rgb.val[0]   = rgb.val[2];
+        rgb.val[2]   = t;
+    }
+    vst3q_u8(dst, rgb);
+}
+
+static int yuyv_rgb24_neon(const unsigned char *src, unsigned char *dst, int width, int bgr)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x8x4_t p = vld4_u8(src + 2 * x);
+        int16x8_t cb, cr, cg;
+
+        chroma_neon(p.val[1], p.val[3], &cb, &cr, &cg);
+        store_rgb24_neon(dst + 3 * x, p.val[0], p.val[2], cb, cr, cg, bgr);
+    }
+    return x;
+}
+
+static int p420_rgb24_neon(const unsigned char *y1, const unsigned char *y2, const unsigned char *u,
+                           const unsigned char *v, unsigned char *dst1, unsigned char *dst2, int width, int bgr)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x8x2_t a = vld2_u8(y1 + x);
+        uint8x8x2_t c = vld2_u8(y2 + x);
+        int16x8_t cb, cr, cg;
+
+        chroma_neon(vld1_u8(u + x / 2), vld1_u8(v + x / 2), &cb, &cr, &cg);
+        store_rgb24_neon(dst1 + 3 * x, a.val[0], a.val[1], cb, cr, cg, bgr);
+        store_rgb24_neon(dst2 + 3 * x, c.val[0], c.val[1], cb, cr, cg, bgr);
+    }
+    return x;
+}
+
+static int yuyv_y_neon(const unsigned char *src, unsigned char *dsty, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+        vst1q_u8(dsty + x, vld2q_u8(src + 2 * x).val[0]);
+    return x;
+}
+
+static int yuyv_uv_neon(const unsigned char *src1, const unsigned char *src2, unsigned char *dstu,
+                        unsigned char *dstv, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x8x4_t a = vld4_u8(src1 + 2 * x);
+        uint8x8x4_t c = vld4_u8(src2 + 2 * x);
+        /* vhadd rounds down like the scalar loop */
+        vst1_u8(dstu + x / 2, vhadd_u8(a.val[1], c.val[1]));
+        vst1_u8(dstv + x / 2, vhadd_u8(a.val[3], c.val[3]));
+    }
+    return x;
+}
+#endif
+
+static int yuyv_rgb24_select(const unsigned char *src, unsigned char *dst, int width, int bgr);
+static int p420_rgb24_select(const unsigned char *y1, const unsigned char *y2, const unsigned char *u,
+                             const unsigned char *v, unsigned char *dst1, unsigned char *dst2, int width, int bgr);
+static int yuyv_y_select(const unsigned char *src, unsigned char *dsty, int width);
+static int yuyv_uv_select(const unsigned char *src1, const unsigned char *src2, unsigned char *dstu,
+                          unsigned char *dstv, int width);
+
+int (*ccvt_row_yuyv_rgb24)(const unsigned char *, unsigned char *, int, int) = yuyv_rgb24_select;
+int (*ccvt_row_420p_rgb24)(const unsigned char *, const unsigned char *, const unsigned char *, const unsigned char *,
+                           unsigned char *, unsigned char *, int, int) = p420_rgb24_select;
+int (*ccvt_row_yuyv_y)(const unsigned char *, unsigned char *, int) = yuyv_y_select;
+int (*ccvt_row_yuyv_uv)(const unsigned char *, const unsigned char *, unsigned char *, unsigned char *,
+                        int) = yuyv_uv_select;
+
+/* pick the loops for this CPU, once */
+static void ccvt_select(void)
+{
+    int (*yuyv_rgb24)(const unsigned char *, unsigned char *, int, int) = yuyv_rgb24_none;
+    int (*p420_rgb24)(const unsigned char *, const unsigned char *, const unsigned char *, const unsigned char *,
+                      unsigned char *, unsigned char *, int, int) = p420_rgb24_none;
+    int (*yuyv_y)(const unsigned char *, unsigned char *, int) = yuyv_y_none;
+    int (*yuyv_uv)(const unsigned char *, const unsigned char *, unsigned char *, unsigned char *, int) = yuyv_uv_none;
+
+#if defined(CCVT_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        yuyv_y  = yuyv_y_sse2;
+        yuyv_uv = yuyv_uv_sse2;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        yuyv_rgb24 = yuyv_rgb24_avx2;
+        p420_rgb24 = p420_rgb24_avx2;
+    }
+    else if (__builtin_cpu_supports("ssse3"))
+    {
+        yuyv_rgb24 = yuyv_rgb24_ssse3;
+        p420_rgb24 = p420_rgb24_ssse3;
+    }
+#elif defined(CCVT_NEON)
+    yuyv_rgb24 = yuyv_rgb24_neon;
+    p420_rgb24 = p420_rgb24_neon;
+    yuyv_y     = yuyv_y_neon;
+    yuyv_uv    = yuyv_uv_neon;
+#endif
+
+    ccvt_row_yuyv_rgb24 = yuyv_rgb24;
+    ccvt_row_420p_rgb24 = p420_rgb24;
+    ccvt_row_yuyv_y     = yuyv_y;
+    ccvt_row_yuyv_uv    = yuyv_uv;
+}
+
+static int yuyv_rgb24_select(const unsigned char *src, unsigned char *dst, int width, int bgr)
+{
+    ccvt_select();
+    return ccvt_row_yuyv_rgb24(src, dst, width, bgr);
+}
+
+static int p420_rgb24_select(const unsigned char *y1, const unsigned char *y2, const unsigned char *u,
+                             const unsigned char *v, unsigned char *dst1, unsigned char *dst2, int width, int bgr)
+{
+    ccvt_select();
+    return ccvt_row_420p_rgb24(y1, y2, u, v, dst1, dst2, width, bgr);
+}
+
+static int yuyv_y_select(const unsigned char *src, unsigned char *dsty, int width)
+{
+    ccvt_select();
+    return ccvt_row_yuyv_y(src, dsty, width);
+}
+
+static int yuyv_uv_select(const unsigned char *src1, const unsigned char *src2, unsigned char *dstu,
+                          unsigned char *dstv, int width)
+{
+    ccvt_select();
+    return ccvt_row_yuyv_uv(src1, src2, dstu, dstv, width);
+}
@@ -0,0 +1,40 @@
+/*  CCVT: ColourConVerT: simple library for converting colourspaces
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+/* Row kernels of the ccvt conversions, private to ccvt_misc.c and ccvt_c2.c.
+ *
+ * Each one converts the start of a row and returns the number of pixels done, always even,
+ * leaving the rest to the scalar loop of the caller. The results are the same as the scalar
+ * loops bit for bit. On x86 the widest instruction set is picked at run time, NEON is used
+ * on aarch64, other CPUs do everything in the scalar loops.
+ */
+
+/* YUYV row to RGB24 (or BGR24 if bgr is set) */
+extern int (*ccvt_row_yuyv_rgb24)(const unsigned char *src, unsigned char *dst, int width, int bgr);
+
+/* two 4:2:0 planar rows sharing one row of U and V to RGB24 (or BGR24) */
+extern int (*ccvt_row_420p_rgb24)(const unsigned char *y1, const unsigned char *y2, const unsigned char *u,
+                                  const unsigned char *v, unsigned char *dst1, unsigned char *dst2, int width, int bgr);
+
+/* Y of a YUYV row */
+extern int (*ccvt_row_yuyv_y)(const unsigned char *src, unsigned char *dsty, int width);
+
+/* U and V of two YUYV rows, averaged */
+extern int (*ccvt_row_yuyv_uv)(const unsigned char *src1, const unsigned char *src2, unsigned char *dstu,
+                               unsigned char *dstv, int width);
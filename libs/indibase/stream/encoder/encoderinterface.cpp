@@ -30,6 +30,8 @@
 #include "indiccd.h"
 #include "indidetector.h"
 
+#include <algorithm>
+
 namespace INDI
 {
 
@@ -50,6 +52,16 @@ bool EncoderInterface::setSize(uint16_t width, uint16_t height)
     return true;
 }
 
+void EncoderInterface::setQuality(int quality)
+{
+    this->quality = std::max(1, std::min(100, quality));
+}
+
+void EncoderInterface::setDownscale(int downscale)
+{
+    this->downscale = std::max(1, downscale);
+}
+
 bool EncoderInterface::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth)
 {
     this->pixelFormat = pixelFormat;
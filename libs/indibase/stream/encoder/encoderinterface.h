@@ -57,12 +57,20 @@ class EncoderInterface
 
         const char *getName();
 
+        /** @brief JPEG like quality, 1 to 100, of lossy encoders. Lowered while clients fall behind. */
+        void setQuality(int quality);
+
+        /** @brief Further downscale of the frames, by an integer factor, for encoders whose frames carry their size. */
+        void setDownscale(int downscale);
+
     protected:
         INDI::DefaultDevice *currentDevice;
         const char *name;
         INDI_PIXEL_FORMAT pixelFormat;            // INDI Pixel Format
         uint8_t pixelDepth = 8;                   // Bits per Pixels
         uint16_t rawWidth, rawHeight;
+        int quality = 85;
+        int downscale = 1;
 };
 
 }
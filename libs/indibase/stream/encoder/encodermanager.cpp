@@ -22,6 +22,9 @@
 #include "encodermanager.h"
 #include "rawencoder.h"
 #include "mjpegencoder.h"
+#ifdef HAVE_V4L2_M2M
+#include "v4l2m2mencoder.h"
+#endif
 
 namespace INDI
 {
@@ -30,6 +33,13 @@ EncoderManager::EncoderManager()
 {
     encoder_list.push_back(new RawEncoder());
     encoder_list.push_back(new MJPEGEncoder());
+#ifdef HAVE_V4L2_M2M
+    // Hardware encoders, only listed when the system has one
+    if (!V4L2M2MEncoder::findDevice(V4L2M2MEncoder::CODEC_H264).empty())
+        encoder_list.push_back(new V4L2M2MEncoder(V4L2M2MEncoder::CODEC_H264));
+    if (!V4L2M2MEncoder::findDevice(V4L2M2MEncoder::CODEC_HEVC).empty())
+        encoder_list.push_back(new V4L2M2MEncoder(V4L2M2MEncoder::CODEC_HEVC));
+#endif
     default_encoder = encoder_list.at(0);
 }
 
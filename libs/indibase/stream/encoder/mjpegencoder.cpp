@@ -22,7 +22,9 @@
 #include "mjpegencoder.h"
 #include "stream/streammanager.h"
 #include "indiccd.h"
+#include <algorithm>
 #include <cmath>
+#include <thread>
 #include <zlib.h>
 #include <jpeglib.h>
 #include <jerror.h>
@@ -46,6 +48,29 @@ static void term_destination(j_compress_ptr cinfo)
     /* no work necessary here */
 }
 
+// Offset of the entropy coded data following the SOS header, 0 if not found. sof is set to the SOF marker offset.
+static size_t findScanData(const uint8_t *jpeg, size_t size, size_t *sof)
+{
+    size_t pos = 2;
+    while (pos + 4 <= size && jpeg[pos] == 0xFF)
+    {
+        uint8_t marker = jpeg[pos + 1];
+        if (marker == 0xFF)
+        {
+            pos++;
+            continue;
+        }
+
+        size_t length = (jpeg[pos + 2] << 8) | jpeg[pos + 3];
+        if (marker >= 0xC0 && marker <= 0xC2)
+            *sof = pos;
+        if (marker == 0xDA)
+            return pos + 2 + length;
+        pos += 2 + length;
+    }
+    return 0;
+}
+
 namespace INDI
 {
 
@@ -56,7 +81,11 @@ MJPEGEncoder::MJPEGEncoder()
 
 MJPEGEncoder::~MJPEGEncoder()
 {
-    delete [] jpegBuffer;
+}
+
+void MJPEGEncoder::setThreads(unsigned threads)
+{
+    this->threads = threads;
 }
 
 const char *MJPEGEncoder::getDeviceName()
@@ -74,23 +103,37 @@ bool MJPEGEncoder::upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint3
     }
 
     INDI_UNUSED(nbytes);
-    int bufsize = rawWidth * rawHeight * ((pixelFormat == INDI_RGB) ? 3 : 1);
-    if (bufsize != jpegBufferSize)
-    {
-        delete [] jpegBuffer;
-        jpegBuffer = new uint8_t[bufsize];
-        jpegBufferSize = bufsize;
-    }
+    int components = (pixelFormat == INDI_RGB) ? 3 : 1;
+    int bufsize = rawWidth * rawHeight * components + HEADER_SIZE;
 
     // Scale image DOWN by this factor
     // 640 is now selected arbitrary to test mpeg streaming performance
-    int scale = std::max(1, static_cast<int>(std::floor(rawWidth / SCALE_WIDTH)));
-    if (pixelFormat == INDI_RGB)
-        jpeg_compress_8u_rgb(buffer, rawWidth, rawHeight, rawWidth * 3, scale, jpegBuffer, &bufsize, 85);
-    else
-        jpeg_compress_8u_gray(buffer, rawWidth, rawHeight, rawWidth, scale, jpegBuffer, &bufsize, 85);
+    int scale = std::max(1, static_cast<int>(std::floor(rawWidth / SCALE_WIDTH))) * downscale;
 
-    bp->setBlob(jpegBuffer);
+    // An MCU row is 8 lines in gray, 16 in color as chroma is subsampled, times the scale
+    uint32_t mcuSize = (components == 3) ? 16 : 8;
+    uint32_t mcuRows = (rawHeight + mcuSize * scale - 1) / (mcuSize * scale);
+    uint32_t strips = std::min(threads > 0 ? threads : std::thread::hardware_concurrency(), mcuRows / MIN_STRIP_MCU_ROWS);
+    if (strips > 1)
+    {
+        // A strip is one restart interval, at most 65535 MCUs
+        uint32_t mcusPerRow = (rawWidth + mcuSize - 1) / mcuSize;
+        uint32_t stripRows = std::min((mcuRows + strips - 1) / strips, std::max(1u, 65535 / mcusPerRow));
+        strips = (mcuRows + stripRows - 1) / stripRows;
+        if (!compressStrips(buffer, components, scale, stripRows * mcuSize * scale, stripRows, strips, &bufsize))
+            strips = 1;
+    }
+
+    if (strips <= 1)
+    {
+        jpegBuffer.resize(bufsize);
+        if (pixelFormat == INDI_RGB)
+            jpeg_compress_8u_rgb(buffer, rawWidth, rawHeight, rawWidth * 3, scale, jpegBuffer.data(), &bufsize, quality);
+        else
+            jpeg_compress_8u_gray(buffer, rawWidth, rawHeight, rawWidth, scale, jpegBuffer.data(), &bufsize, quality);
+    }
+
+    bp->setBlob(jpegBuffer.data());
     bp->setBlobLen(bufsize);
     bp->setSize(bufsize);
     bp->setFormat(".stream_jpg");
@@ -98,6 +141,76 @@ bool MJPEGEncoder::upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint3
     return true;
 }
 
+bool MJPEGEncoder::compressStrips(const uint8_t *buffer, int components, int scale, uint32_t stripLines,
+                                  uint32_t stripRows, uint32_t strips, int *destsize)
+{
+    stripBuffers.resize(strips);
+    std::vector<int> sizes(strips);
+    int stride = rawWidth * components;
+
+    auto compress = [&](uint32_t strip)
+    {
+        uint32_t first = strip * stripLines;
+        uint32_t lines = std::min<uint32_t>(stripLines, rawHeight - first);
+        sizes[strip] = lines * stride + HEADER_SIZE;
+        stripBuffers[strip].resize(sizes[strip]);
+        if (components == 3)
+            jpeg_compress_8u_rgb(buffer + first * stride, rawWidth, lines, stride, scale, stripBuffers[strip].data(),
+                                 &sizes[strip], quality, stripRows);
+        else
+            jpeg_compress_8u_gray(buffer + first * stride, rawWidth, lines, stride, scale, stripBuffers[strip].data(),
+                                  &sizes[strip], quality, stripRows);
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t strip = 1; strip < strips; strip++)
+        workers.emplace_back(compress, strip);
+    compress(0);
+    for (auto &worker : workers)
+        worker.join();
+
+    // The first strip brings the headers, the others their scan data after a restart marker
+    size_t sof = 0, total = 0;
+    uint32_t height = 0;
+    std::vector<size_t> scanData(strips);
+    for (uint32_t strip = 0; strip < strips; strip++)
+    {
+        const uint8_t *jpeg = stripBuffers[strip].data();
+        size_t size = sizes[strip];
+        sof = 0;
+        scanData[strip] = findScanData(jpeg, size, &sof);
+        if (scanData[strip] == 0 || sof == 0 || size < scanData[strip] + 2 || jpeg[size - 2] != 0xFF || jpeg[size - 1] != 0xD9)
+            return false;
+        height += (jpeg[sof + 5] << 8) | jpeg[sof + 6];
+        total += strip == 0 ? size : size - scanData[strip];
+    }
+
+    findScanData(stripBuffers[0].data(), sizes[0], &sof);
+    jpegBuffer.resize(total);
+    uint8_t *out = jpegBuffer.data();
+    for (uint32_t strip = 0; strip < strips; strip++)
+    {
+        const uint8_t *jpeg = stripBuffers[strip].data();
+        if (strip == 0)
+        {
+            memcpy(out, jpeg, sizes[0] - 2);
+            out += sizes[0] - 2;
+            continue;
+        }
+        *out++ = 0xFF;
+        *out++ = 0xD0 + ((strip - 1) & 7);
+        memcpy(out, jpeg + scanData[strip], sizes[strip] - scanData[strip] - 2);
+        out += sizes[strip] - scanData[strip] - 2;
+    }
+    *out++ = 0xFF;
+    *out++ = 0xD9;
+
+    jpegBuffer[sof + 5] = height >> 8;
+    jpegBuffer[sof + 6] = height & 0xFF;
+    *destsize = total;
+    return true;
+}
+
 /*
 FROM: https://svn.csail.mit.edu/rrg_pods/jpeg-utils/
 
@@ -121,7 +234,7 @@ Requirements:
 
 int MJPEGEncoder::jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale,
         uint8_t * dest,
-        int * destsize, int quality)
+        int * destsize, int quality, int restartRows)
 {
     struct jpeg_compress_struct cinfo;
     struct jpeg_error_mgr jerr;
@@ -148,6 +261,7 @@ int MJPEGEncoder::jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, ui
     cinfo.in_color_space = JCS_GRAYSCALE;
     jpeg_set_defaults (&cinfo);
     jpeg_set_quality (&cinfo, quality, TRUE);
+    cinfo.restart_in_rows = restartRows;
 
     jpeg_start_compress (&cinfo, TRUE);
     while (cinfo.next_scanline < height)
@@ -163,7 +277,7 @@ int MJPEGEncoder::jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, ui
 }
 
 int MJPEGEncoder::jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale,
-                                        uint8_t * dest, int * destsize, int quality)
+                                        uint8_t * dest, int * destsize, int quality, int restartRows)
 {
     struct jpeg_compress_struct cinfo;
     struct jpeg_error_mgr jerr;
@@ -190,6 +304,7 @@ int MJPEGEncoder::jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uin
     cinfo.in_color_space = JCS_RGB;
     jpeg_set_defaults (&cinfo);
     jpeg_set_quality (&cinfo, quality, TRUE);
+    cinfo.restart_in_rows = restartRows;
 
     jpeg_start_compress (&cinfo, TRUE);
     while (cinfo.next_scanline < height)
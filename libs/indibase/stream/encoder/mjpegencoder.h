@@ -23,13 +23,18 @@
 
 #include "encoderinterface.h"
 
+#include <vector>
+
 namespace INDI
 {
 
 /**
  * @brief The MJPEGEncoder class encodes frames in JPEG format before transmitting them to the client.
  *
- * The quality is now hard-coded at 70 when encoding the JPEG image. Further compression is not supported.
+ * The quality is 85, lowered by the stream manager while clients fall behind. Further compression is not supported.
+ *
+ * Large frames are encoded in horizontal strips on several threads. Each strip is one restart interval,
+ * so the strips are joined into a single baseline JPEG with restart markers between them.
  */
 class MJPEGEncoder : public EncoderInterface
 {
@@ -39,16 +44,31 @@ class MJPEGEncoder : public EncoderInterface
 
         virtual bool upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed = false) override;
 
+        /**
+         * @brief setThreads Most threads encoding a frame, 0 for one per core.
+         */
+        void setThreads(unsigned threads);
+
     private:
         const char *getDeviceName();
         int jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale, uint8_t * dest,
-                                   int * destsize, int quality);
+                                   int * destsize, int quality, int restartRows = 0);
         int jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale, uint8_t * dest,
-                                  int * destsize, int quality);
-        uint8_t *jpegBuffer = nullptr;
-        uint16_t jpegBufferSize = 1;
+                                  int * destsize, int quality, int restartRows = 0);
+
+        // Encode stripLines high strips in parallel and join them into jpegBuffer
+        bool compressStrips(const uint8_t *buffer, int components, int scale, uint32_t stripLines, uint32_t stripRows,
+                            uint32_t strips, int *destsize);
+
+        unsigned threads = 0;
+        std::vector<uint8_t> jpegBuffer;
+        std::vector<std::vector<uint8_t>> stripBuffers;
 
         static const int SCALE_WIDTH = 640;
+        // Fewest MCU rows worth encoding on a thread of their own
+        static const uint32_t MIN_STRIP_MCU_ROWS = 16;
+        // Room for the JPEG headers on top of the encoded data
+        static const int HEADER_SIZE = 4096;
 
 };
 
@@ -0,0 +1,433 @@
+/*
+    V4L2 memory to memory H.264 / HEVC Encoder
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "v4l2m2mencoder.h"
+#include "defaultdevice.h"
+#include "indilogger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <linux/videodev2.h>
+
+// Longest wait for the encoder to take a picture or return a packet
+static const int ENCODER_TIMEOUT_MS = 1000;
+
+static int xioctl(int fd, unsigned long request, void *arg)
+{
+    int r;
+    do
+    {
+        r = ioctl(fd, request, arg);
+    }
+    while (r == -1 && errno == EINTR);
+    return r;
+}
+
+static uint32_t pixelFormatOf(INDI::V4L2M2MEncoder::Codec codec)
+{
+    return codec == INDI::V4L2M2MEncoder::CODEC_H264 ? V4L2_PIX_FMT_H264 : V4L2_PIX_FMT_HEVC;
+}
+
+static bool hasFormat(int fd, uint32_t type, uint32_t pixelFormat)
+{
+    v4l2_fmtdesc desc {};
+    desc.type = type;
+    for (desc.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &desc) == 0; ++desc.index)
+        if (desc.pixelformat == pixelFormat)
+            return true;
+    return false;
+}
+
+namespace INDI
+{
+
+V4L2M2MEncoder::V4L2M2MEncoder(Codec codec) : codec(codec)
+{
+    name = codec == CODEC_H264 ? "H264" : "HEVC";
+}
+
+V4L2M2MEncoder::~V4L2M2MEncoder()
+{
+    close();
+}
+
+const char *V4L2M2MEncoder::getDeviceName()
+{
+    return currentDevice->getDeviceName();
+}
+
+std::string V4L2M2MEncoder::findDevice(Codec codec)
+{
+    for (int i = 0; i < 64; ++i)
+    {
+        std::string path = "/dev/video" + std::to_string(i);
+        int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+        if (fd < 0)
+            continue;
+
+        v4l2_capability cap {};
+        bool found = false;
+        if (xioctl(fd, VIDIOC_QUERYCAP, &cap) == 0)
+        {
+            uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+            found = (caps & V4L2_CAP_VIDEO_M2M_MPLANE) &&
+                    hasFormat(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, pixelFormatOf(codec)) &&
+                    hasFormat(fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, V4L2_PIX_FMT_YUV420);
+        }
+        ::close(fd);
+
+        if (found)
+            return path;
+    }
+    return std::string();
+}
+
+void V4L2M2MEncoder::init(INDI::DefaultDevice *mainDevice)
+{
+    EncoderInterface::init(mainDevice);
+    mjpeg.init(mainDevice);
+}
+
+bool V4L2M2MEncoder::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth)
+{
+    EncoderInterface::setPixelFormat(pixelFormat, pixelDepth);
+    return mjpeg.setPixelFormat(pixelFormat, pixelDepth);
+}
+
+bool V4L2M2MEncoder::setSize(uint16_t width, uint16_t height)
+{
+    // Set the encoder up again on the next frame, and try the hardware again
+    if (width != rawWidth || height != rawHeight)
+    {
+        close();
+        failed = false;
+    }
+
+    EncoderInterface::setSize(width, height);
+    return mjpeg.setSize(width, height);
+}
+
+bool V4L2M2MEncoder::requestBuffers(uint32_t type, uint32_t count, std::vector<Buffer> &buffers)
+{
+    v4l2_requestbuffers request {};
+    request.count  = count;
+    request.type   = type;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd, VIDIOC_REQBUFS, &request) < 0 || request.count == 0)
+        return false;
+
+    buffers.resize(request.count);
+    for (uint32_t i = 0; i < request.count; ++i)
+    {
+        v4l2_plane plane {};
+        v4l2_buffer buffer {};
+        buffer.type     = type;
+        buffer.memory   = V4L2_MEMORY_MMAP;
+        buffer.index    = i;
+        buffer.m.planes = &plane;
+        buffer.length   = 1;
+        if (xioctl(fd, VIDIOC_QUERYBUF, &buffer) < 0)
+            return false;
+
+        void *data = mmap(nullptr, plane.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, plane.m.mem_offset);
+        if (data == MAP_FAILED)
+            return false;
+        buffers[i].data   = data;
+        buffers[i].length = plane.length;
+    }
+    return true;
+}
+
+void V4L2M2MEncoder::releaseBuffers(uint32_t type, std::vector<Buffer> &buffers)
+{
+    for (auto &buffer : buffers)
+        if (buffer.data != nullptr)
+            munmap(buffer.data, buffer.length);
+    buffers.clear();
+
+    v4l2_requestbuffers request {};
+    request.type   = type;
+    request.memory = V4L2_MEMORY_MMAP;
+    xioctl(fd, VIDIOC_REQBUFS, &request);
+}
+
+bool V4L2M2MEncoder::queueBuffer(uint32_t type, uint32_t index, uint32_t bytesUsed)
+{
+    v4l2_plane plane {};
+    plane.bytesused = bytesUsed;
+    v4l2_buffer buffer {};
+    buffer.type     = type;
+    buffer.memory   = V4L2_MEMORY_MMAP;
+    buffer.index    = index;
+    buffer.m.planes = &plane;
+    buffer.length   = 1;
+    return xioctl(fd, VIDIOC_QBUF, &buffer) == 0;
+}
+
+bool V4L2M2MEncoder::open()
+{
+    if (fd >= 0)
+        return true;
+
+    std::string path = findDevice(codec);
+    if (path.empty())
+        return false;
+
+    fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd < 0)
+        return false;
+
+    // 4:2:0 needs even sizes
+    width  = rawWidth & ~1;
+    height = rawHeight & ~1;
+
+    v4l2_format format {};
+    format.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    format.fmt.pix_mp.width       = width;
+    format.fmt.pix_mp.height      = height;
+    format.fmt.pix_mp.pixelformat = V4L2_PIX_FMT_YUV420;
+    format.fmt.pix_mp.field       = V4L2_FIELD_NONE;
+    format.fmt.pix_mp.num_planes  = 1;
+    if (xioctl(fd, VIDIOC_S_FMT, &format) < 0 || format.fmt.pix_mp.pixelformat != V4L2_PIX_FMT_YUV420 ||
+            format.fmt.pix_mp.width < width || format.fmt.pix_mp.height < height)
+    {
+        LOGF_DEBUG("%s: %s does not take %dx%d YUV 4:2:0 pictures.", name, path.c_str(), width, height);
+        close();
+        return false;
+    }
+    // The encoder may pad the rows and the planes
+    lineLength  = format.fmt.pix_mp.plane_fmt[0].bytesperline;
+    planeHeight = format.fmt.pix_mp.height;
+
+    format = v4l2_format {};
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    format.fmt.pix_mp.width       = width;
+    format.fmt.pix_mp.height      = height;
+    format.fmt.pix_mp.pixelformat = pixelFormatOf(codec);
+    format.fmt.pix_mp.field       = V4L2_FIELD_NONE;
+    format.fmt.pix_mp.num_planes  = 1;
+    format.fmt.pix_mp.plane_fmt[0].sizeimage = std::max<uint32_t>(width * height, 512 * 1024);
+    if (xioctl(fd, VIDIOC_S_FMT, &format) < 0 || format.fmt.pix_mp.pixelformat != pixelFormatOf(codec))
+    {
+        close();
+        return false;
+    }
+
+    // Not every encoder has every control, the defaults do then
+    v4l2_control control {};
+    control = {V4L2_CID_MPEG_VIDEO_BITRATE, BITRATE};
+    xioctl(fd, VIDIOC_S_CTRL, &control);
+    control = {V4L2_CID_MPEG_VIDEO_GOP_SIZE, KEYFRAME_PERIOD};
+    xioctl(fd, VIDIOC_S_CTRL, &control);
+    control = {V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, KEYFRAME_PERIOD};
+    if (codec == CODEC_H264)
+        xioctl(fd, VIDIOC_S_CTRL, &control);
+    control = {V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, 1};
+    xioctl(fd, VIDIOC_S_CTRL, &control);
+    control = {V4L2_CID_MPEG_VIDEO_B_FRAMES, 0};
+    xioctl(fd, VIDIOC_S_CTRL, &control);
+
+    if (!requestBuffers(V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, 2, pictures) ||
+            !requestBuffers(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, 4, packets))
+    {
+        close();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < packets.size(); ++i)
+    {
+        if (!queueBuffer(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, i, 0))
+        {
+            close();
+            return false;
+        }
+        packets[i].queued = true;
+    }
+
+    int type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    int captureType = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    if (xioctl(fd, VIDIOC_STREAMON, &type) < 0 || xioctl(fd, VIDIOC_STREAMON, &captureType) < 0)
+    {
+        close();
+        return false;
+    }
+
+    LOGF_INFO("%s stream encoded by %s.", name, path.c_str());
+    return true;
+}
+
+void V4L2M2MEncoder::close()
+{
+    if (fd < 0)
+        return;
+
+    int type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    xioctl(fd, VIDIOC_STREAMOFF, &type);
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    xioctl(fd, VIDIOC_STREAMOFF, &type);
+
+    releaseBuffers(V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, pictures);
+    releaseBuffers(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, packets);
+
+    ::close(fd);
+    fd = -1;
+}
+
+void V4L2M2MEncoder::fillPicture(const uint8_t *buffer, uint8_t *picture)
+{
+    uint8_t *luma = picture;
+    uint8_t *cb   = picture + lineLength * planeHeight;
+    uint8_t *cr   = cb + (lineLength / 2) * (planeHeight / 2);
+    uint32_t chromaLength = lineLength / 2;
+
+    if (pixelFormat != INDI_RGB)
+    {
+        // Mono and bayer frames are sent as gray
+        for (uint32_t y = 0; y < height; ++y)
+            memcpy(luma + y * lineLength, buffer + y * rawWidth, width);
+        for (uint32_t y = 0; y < height / 2u; ++y)
+        {
+            memset(cb + y * chromaLength, 128, width / 2);
+            memset(cr + y * chromaLength, 128, width / 2);
+        }
+        return;
+    }
+
+    // BT.601 limited range, chroma averaged over each 2x2 block
+    for (uint32_t y = 0; y < height; y += 2)
+    {
+        for (uint32_t x = 0; x < width; x += 2)
+        {
+            int sumR = 0, sumG = 0, sumB = 0;
+            for (uint32_t k = 0; k < 2; ++k)
+                for (uint32_t l = 0; l < 2; ++l)
+                {
+                    const uint8_t *rgb = buffer + ((y + k) * rawWidth + x + l) * 3;
+                    luma[(y + k) * lineLength + x + l] = ((66 * rgb[0] + 129 * rgb[1] + 25 * rgb[2] + 128) >> 8) + 16;
+                    sumR += rgb[0];
+                    sumG += rgb[1];
+                    sumB += rgb[2];
+                }
+            cb[(y / 2) * chromaLength + x / 2] = ((-38 * sumR - 74 * sumG + 112 * sumB + 512) >> 10) + 128;
+            cr[(y / 2) * chromaLength + x / 2] = ((112 * sumR - 94 * sumG - 18 * sumB + 512) >> 10) + 128;
+        }
+    }
+}
+
+bool V4L2M2MEncoder::encode(const uint8_t *buffer)
+{
+    v4l2_plane plane {};
+    v4l2_buffer dequeued {};
+    dequeued.memory   = V4L2_MEMORY_MMAP;
+    dequeued.m.planes = &plane;
+    dequeued.length   = 1;
+
+    // Take back the pictures the encoder is done with, waiting if it still holds all of them
+    auto reclaimPictures = [&]()
+    {
+        dequeued.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+        while (xioctl(fd, VIDIOC_DQBUF, &dequeued) == 0)
+            pictures[dequeued.index].queued = false;
+        return errno == EAGAIN;
+    };
+    if (!reclaimPictures())
+        return false;
+
+    auto picture = std::find_if(pictures.begin(), pictures.end(), [](const Buffer & one)
+    {
+        return !one.queued;
+    });
+    if (picture == pictures.end())
+    {
+        pollfd pfd {fd, POLLOUT, 0};
+        if (poll(&pfd, 1, ENCODER_TIMEOUT_MS) <= 0 || !reclaimPictures())
+            return false;
+        picture = std::find_if(pictures.begin(), pictures.end(), [](const Buffer & one)
+        {
+            return !one.queued;
+        });
+        if (picture == pictures.end())
+            return false;
+    }
+
+    uint32_t pictureSize = lineLength * planeHeight * 3 / 2;
+    if (picture->length < pictureSize)
+        return false;
+    fillPicture(buffer, static_cast<uint8_t *>(picture->data));
+    if (!queueBuffer(V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, picture - pictures.begin(), pictureSize))
+        return false;
+    picture->queued = true;
+
+    // Without B frames every picture comes back as a packet, gather what the encoder has
+    stream.clear();
+    pollfd pfd {fd, POLLIN, 0};
+    if (poll(&pfd, 1, ENCODER_TIMEOUT_MS) < 0)
+        return false;
+
+    dequeued.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    while (xioctl(fd, VIDIOC_DQBUF, &dequeued) == 0)
+    {
+        const uint8_t *packet = static_cast<const uint8_t *>(packets[dequeued.index].data) + plane.data_offset;
+        stream.insert(stream.end(), packet, packet + plane.bytesused - plane.data_offset);
+        if (!queueBuffer(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, dequeued.index, 0))
+            return false;
+    }
+    return errno == EAGAIN;
+}
+
+bool V4L2M2MEncoder::upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed)
+{
+    if (isCompressed)
+    {
+        LOGF_ERROR("Compression is not supported in %s stream.", name);
+        return false;
+    }
+
+    if (!failed)
+    {
+        if (open() && encode(buffer))
+        {
+            // Nothing out of the encoder yet
+            if (stream.empty())
+                return false;
+
+            bp->setBlob(stream.data());
+            bp->setBlobLen(stream.size());
+            bp->setSize(stream.size());
+            bp->setFormat(codec == CODEC_H264 ? ".stream_h264" : ".stream_hevc");
+            return true;
+        }
+
+        LOGF_WARN("%s hardware encoder is not available, streaming MJPEG instead.", name);
+        close();
+        failed = true;
+    }
+
+    return mjpeg.upload(bp, buffer, nbytes, isCompressed);
+}
+
+}
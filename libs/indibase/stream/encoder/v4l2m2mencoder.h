@@ -0,0 +1,94 @@
+/*
+    V4L2 memory to memory H.264 / HEVC Encoder
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include "encoderinterface.h"
+#include "mjpegencoder.h"
+
+#include <string>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The V4L2M2MEncoder class encodes frames to H.264 or HEVC on a hardware V4L2 memory to memory
+ * encoder, such as the Raspberry Pi bcm2835-codec, for streams over slow links.
+ *
+ * Frames are converted to YUV 4:2:0 and sent as 8 bit. Each BLOB holds the access units the encoder
+ * produced for a frame, headers are repeated on key frames so that clients can join at any time.
+ * If the encoder cannot be set up or fails, frames are sent as MJPEG instead.
+ */
+class V4L2M2MEncoder : public EncoderInterface
+{
+    public:
+        enum Codec
+        {
+            CODEC_H264,
+            CODEC_HEVC
+        };
+
+        explicit V4L2M2MEncoder(Codec codec);
+        ~V4L2M2MEncoder();
+
+        /** @return The path of a memory to memory encoder to codec, empty if there is none. */
+        static std::string findDevice(Codec codec);
+
+        virtual void init(INDI::DefaultDevice *mainDevice) override;
+        virtual bool setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth) override;
+        virtual bool setSize(uint16_t width, uint16_t height) override;
+        virtual bool upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed = false) override;
+
+    private:
+        struct Buffer
+        {
+            void *data {nullptr};
+            size_t length {0};
+            bool queued {false};
+        };
+
+        const char *getDeviceName();
+        bool open();
+        void close();
+        bool encode(const uint8_t *buffer);
+        bool requestBuffers(uint32_t type, uint32_t count, std::vector<Buffer> &buffers);
+        bool queueBuffer(uint32_t type, uint32_t index, uint32_t bytesUsed);
+        void releaseBuffers(uint32_t type, std::vector<Buffer> &buffers);
+        void fillPicture(const uint8_t *buffer, uint8_t *picture);
+
+        Codec codec;
+        int fd {-1};
+        bool failed {false};
+
+        uint16_t width {0}, height {0};
+        uint32_t lineLength {0}, planeHeight {0};
+        std::vector<Buffer> pictures;
+        std::vector<Buffer> packets;
+        std::vector<uint8_t> stream;
+
+        // Software fallback
+        MJPEGEncoder mjpeg;
+
+        // Something an LTE uplink carries comfortably
+        static const int BITRATE = 2000000;
+        static const int KEYFRAME_PERIOD = 30;
+};
+
+}
@@ -21,16 +21,154 @@
 
 */
 #include "gammalut16.h"
+#include "computebackend.h"
+
+#include <algorithm>
 #include <cmath>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GAMMA_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define GAMMA_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+// 4096 steps keep the output within one level of the 65536 entry curve
+const int LUT_SIZE = 4096;
+const float LUT_MAX = LUT_SIZE - 1;
+
+// Histogram of the top 12 bits, on about this many samples
+const size_t HISTOGRAM_SAMPLES = 1 << 18;
+
+// Levels as histogram fractions, and the weight of a new frame in the running levels
+const double BLACK_FRACTION = 0.01;
+const double WHITE_FRACTION = 0.999;
+const double LEVELS_WEIGHT = 0.3;
+
+inline uint32_t lookUp(const uint32_t *lookUpTable, uint16_t value, uint16_t black, float scale)
+{
+    float index = static_cast<float>(value > black ? value - black : 0) * scale;
+    return lookUpTable[static_cast<uint32_t>(std::min(index, LUT_MAX) + 0.5f)];
+}
+
+#if defined(GAMMA_X86)
+size_t applySse2(const uint16_t *source, size_t count, uint8_t *destination, uint16_t black, float scale,
+                 const uint32_t *lookUpTable)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i levelBlack = _mm_set1_epi16(static_cast<short>(black));
+    const __m128 levelScale = _mm_set1_ps(scale);
+    const __m128 max = _mm_set1_ps(LUT_MAX);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    alignas(16) uint32_t index[8];
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i value = _mm_subs_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i)), levelBlack);
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(value, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(value, zero));
+        _mm_store_si128(reinterpret_cast<__m128i *>(index),
+                        _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_mul_ps(lo, levelScale), max), half)));
+        _mm_store_si128(reinterpret_cast<__m128i *>(index + 4),
+                        _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_mul_ps(hi, levelScale), max), half)));
+        for (int k = 0; k < 8; ++k)
+            destination[i + k] = lookUpTable[index[k]];
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t applyAvx2(const uint16_t *source, size_t count, uint8_t *destination, uint16_t black, float scale,
+                 const uint32_t *lookUpTable)
+{
+    const __m256i levelBlack = _mm256_set1_epi16(static_cast<short>(black));
+    const __m256 levelScale = _mm256_set1_ps(scale);
+    const __m256 max = _mm256_set1_ps(LUT_MAX);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const int *table = reinterpret_cast<const int *>(lookUpTable);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i value = _mm256_subs_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i)), levelBlack);
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(value)));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(value, 1)));
+        __m256i gammaLo = _mm256_i32gather_epi32(table,
+                          _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_mul_ps(lo, levelScale), max), half)), 4);
+        __m256i gammaHi = _mm256_i32gather_epi32(table,
+                          _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_mul_ps(hi, levelScale), max), half)), 4);
+        // packus works within 128 bit lanes, put the quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(gammaLo, gammaHi), 0xd8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i),
+                         _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1)));
+    }
+    return i;
+}
+#elif defined(GAMMA_NEON)
+size_t applyNeon(const uint16_t *source, size_t count, uint8_t *destination, uint16_t black, float scale,
+                 const uint32_t *lookUpTable)
+{
+    const uint16x8_t levelBlack = vdupq_n_u16(black);
+    const float32x4_t max = vdupq_n_f32(LUT_MAX);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+
+    uint32_t index[8];
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        uint16x8_t value = vqsubq_u16(vld1q_u16(source + i), levelBlack);
+        float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(value)));
+        float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(value)));
+        vst1q_u32(index,     vcvtq_u32_f32(vaddq_f32(vminq_f32(vmulq_n_f32(lo, scale), max), half)));
+        vst1q_u32(index + 4, vcvtq_u32_f32(vaddq_f32(vminq_f32(vmulq_n_f32(hi, scale), max), half)));
+        for (int k = 0; k < 8; ++k)
+            destination[i + k] = lookUpTable[index[k]];
+    }
+    return i;
+}
+#endif
+
+typedef size_t (*ApplyFn)(const uint16_t *, size_t, uint8_t *, uint16_t, float, const uint32_t *);
+
+size_t applyNone(const uint16_t *, size_t, uint8_t *, uint16_t, float, const uint32_t *)
+{
+    return 0;
+}
+
+// pick the SIMD loop for this CPU, once
+ApplyFn applyLoop()
+{
+    static const ApplyFn loop = []()
+    {
+#if defined(GAMMA_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return applyAvx2;
+        if (__builtin_cpu_supports("sse2"))
+            return applySse2;
+#elif defined(GAMMA_NEON)
+        return applyNeon;
+#endif
+        return applyNone;
+    }();
+    return loop;
+}
+
+}
+
 GammaLut16::GammaLut16(double gamma, double a, double b, double Ii)
 {
-    mLookUpTable.resize(65536);
+    mLookUpTable.resize(LUT_SIZE);
 
     unsigned int i = 0;
     for (auto &value : mLookUpTable)
     {
-        double I = static_cast<double>(i++) / 65535.0;
+        double I = static_cast<double>(i++) / LUT_MAX;
         double p;
         if (I <= Ii)
             p = a * I;
@@ -38,6 +176,67 @@ GammaLut16::GammaLut16(double gamma, double a, double b, double Ii)
             p = (1 + b) * powf(I, 1.0 / gamma) - b;
         value = round(255.0 * p);
     }
+
+    resetLevels();
+}
+
+void GammaLut16::setLevels(uint16_t black, uint16_t white)
+{
+    mBlack = std::min<uint16_t>(black, 65534);
+    mWhite = std::max<uint16_t>(white, mBlack + 1);
+    mScale = LUT_MAX / (mWhite - mBlack);
+}
+
+void GammaLut16::resetLevels()
+{
+    setLevels(0, 65535);
+    mStretched = false;
+}
+
+void GammaLut16::autoLevels(const uint16_t *source, size_t width, size_t height, size_t stride)
+{
+    if (width == 0 || height == 0)
+        return;
+
+    // Sample a grid of rows and columns, the levels need no more
+    size_t step = std::max<size_t>(1, std::sqrt(static_cast<double>(width) * height / HISTOGRAM_SAMPLES));
+    mHistogram.assign(LUT_SIZE, 0);
+    size_t samples = 0;
+    for (size_t y = 0; y < height; y += step)
+    {
+        const uint16_t *row = source + y * stride;
+        for (size_t x = 0; x < width; x += step, ++samples)
+            ++mHistogram[row[x] >> 4];
+    }
+
+    size_t blackCount = samples * BLACK_FRACTION;
+    size_t whiteCount = samples * WHITE_FRACTION;
+    size_t count = 0;
+    double black = 0, white = 65535;
+    bool blackFound = false;
+    for (int bin = 0; bin < LUT_SIZE; ++bin)
+    {
+        count += mHistogram[bin];
+        if (!blackFound && count > blackCount)
+        {
+            black = bin << 4;
+            blackFound = true;
+        }
+        if (count > whiteCount)
+        {
+            white = (bin << 4) + 15;
+            break;
+        }
+    }
+
+    if (mStretched)
+    {
+        black = mBlack + LEVELS_WEIGHT * (black - mBlack);
+        white = mWhite + LEVELS_WEIGHT * (white - mWhite);
+    }
+
+    setLevels(std::lround(black), std::lround(white));
+    mStretched = true;
 }
 
 void GammaLut16::apply(const uint16_t *source, size_t count, uint8_t *destination) const
@@ -48,8 +247,27 @@ void GammaLut16::apply(const uint16_t *source, size_t count, uint8_t *destinatio
 
 void GammaLut16::apply(const uint16_t *first, const uint16_t *last, uint8_t *destination) const
 {
-    const uint8_t *lookUpTable = mLookUpTable.data();
+    const uint32_t *lookUpTable = mLookUpTable.data();
+    size_t count = last - first;
+
+    size_t i = applyLoop()(first, count, destination, mBlack, mScale, lookUpTable);
+    for (; i < count; ++i)
+        destination[i] = lookUp(lookUpTable, first[i], mBlack, mScale);
+}
+
+void GammaLut16::apply(const uint16_t *source, size_t width, size_t height, size_t stride, uint8_t *destination) const
+{
+    INDI::ComputeBackend *backend = INDI::ComputeBackend::instance();
+    if (backend && backend->gamma16(source, width, height, stride, mLookUpTable.data(), mLookUpTable.size(), mBlack, mScale,
+                                    destination))
+        return;
+
+    if (stride == width)
+    {
+        apply(source, width * height, destination);
+        return;
+    }
 
-    while (first != last)
-        *destination++ = lookUpTable[*first++];
+    for (size_t i = 0; i < height; ++i)
+        apply(source + i * stride, width, destination + i * width);
 }
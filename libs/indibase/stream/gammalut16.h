@@ -26,6 +26,13 @@
 #include <cstdint>
 #include <cstddef>
 
+/**
+ * @brief The GammaLut16 class downscales 16 bit samples to 8 bit through a gamma curve.
+ *
+ * Samples are first stretched between the black and white levels, which default to the whole
+ * 16 bit range, then looked up in a table small enough to stay in the L1 cache.
+ * The stretch runs on SIMD lanes where the CPU has them.
+ */
 class GammaLut16
 {
     public:
@@ -35,6 +42,45 @@ class GammaLut16
         void apply(const uint16_t *source, size_t count, uint8_t *destination) const;
         void apply(const uint16_t *first, const uint16_t *last, uint8_t *destination) const;
 
+        /**
+         * @brief Downscale a frame whose rows are stride samples apart into packed rows, on the
+         * GPU when INDI::ComputeBackend has one.
+         */
+        void apply(const uint16_t *source, size_t width, size_t height, size_t stride, uint8_t *destination) const;
+
+    public:
+        /** @brief Map black and below to 0 and white and above to 255. */
+        void setLevels(uint16_t black, uint16_t white);
+
+        /** @brief Restore the full 16 bit range. */
+        void resetLevels();
+
+        /**
+         * @brief autoLevels Set the levels from the histogram of a frame, for faint targets.
+         * Black goes just under the sky background and white to the brightest stars.
+         * The levels follow the previous ones smoothly so that the preview does not flicker.
+         * @param source first sample of the frame.
+         * @param width samples per row.
+         * @param height number of rows.
+         * @param stride samples from one row to the next.
+         */
+        void autoLevels(const uint16_t *source, size_t width, size_t height, size_t stride);
+
+        uint16_t black() const
+        {
+            return mBlack;
+        }
+        uint16_t white() const
+        {
+            return mWhite;
+        }
+
     protected:
-        std::vector<uint8_t> mLookUpTable;
+        // 32 bit entries so that AVX2 can gather them
+        std::vector<uint32_t> mLookUpTable;
+        std::vector<uint32_t> mHistogram;
+        uint16_t mBlack {0};
+        uint16_t mWhite {65535};
+        float mScale {0};
+        bool mStretched {false};
 };
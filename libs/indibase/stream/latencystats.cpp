@@ -0,0 +1,77 @@
+/*
+    Stream Latency Statistics
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+#include "latencystats.h"
+
+#include <algorithm>
+
+namespace INDI
+{
+
+LatencyStats::LatencyStats(size_t window)
+    : mWindow(std::max<size_t>(window, 1))
+{
+    mSamples.reserve(mWindow);
+}
+
+void LatencyStats::add(double ms)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSamples.size() < mWindow)
+        mSamples.push_back(ms);
+    else
+        mSamples[mNext] = ms;
+    mNext = (mNext + 1) % mWindow;
+}
+
+void LatencyStats::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSamples.clear();
+    mNext = 0;
+}
+
+LatencyStats::Summary LatencyStats::summary() const
+{
+    std::vector<double> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        sorted = mSamples;
+    }
+
+    Summary result;
+    if (sorted.empty())
+        return result;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    // Nearest rank
+    auto percentile = [&sorted](double p)
+    {
+        size_t rank = static_cast<size_t>(p * sorted.size() + 0.999999);
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    };
+
+    result.median = percentile(0.5);
+    result.p99 = percentile(0.99);
+    result.max = sorted.back();
+    result.count = sorted.size();
+    return result;
+}
+
+}
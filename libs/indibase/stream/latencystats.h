@@ -0,0 +1,71 @@
+/*
+    Stream Latency Statistics
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace INDI
+{
+/**
+ * @brief Percentiles of the time the latest frames spent in one stage of the stream pipeline.
+ * Samples are added from any thread.
+ */
+class LatencyStats
+{
+    public:
+        /**
+         * @param window Number of latest samples the percentiles are computed over
+         */
+        explicit LatencyStats(size_t window = 256);
+
+    public:
+        /**
+         * @brief Add the time a frame spent in the stage
+         * @param ms time in milliseconds
+         */
+        void add(double ms);
+
+        /**
+         * @brief Forget all samples
+         */
+        void reset();
+
+    public:
+        struct Summary
+        {
+            double median = 0;
+            double p99 = 0;
+            double max = 0;
+            size_t count = 0;
+        };
+
+        /**
+         * @brief Median, 99th percentile and maximum of the samples in the window, zero without samples
+         */
+        Summary summary() const;
+
+    private:
+        mutable std::mutex mMutex;
+        std::vector<double> mSamples;
+        size_t mWindow;
+        size_t mNext = 0;
+};
+}
@@ -79,10 +79,21 @@ class RecorderInterface
         // and no need to do any further subframing operations. Otherwise, subframing must be done.
         // This is to reduce process time and save memory for a dedicated subframe buffer
         virtual void setStreamEnabled(bool enable) = 0;
+        // Frames expected in the next recording, 0 when unknown, so that the file can be preallocated
+        virtual void setExpectedFrames(uint32_t frames)
+        {
+            m_ExpectedFrames = frames;
+        }
+        // Frames dropped in the last recording because the storage did not keep up
+        virtual uint32_t getDroppedFrames() const
+        {
+            return 0;
+        }
 
     protected:
         const char *name;
         float m_FPS = 1;
+        uint32_t m_ExpectedFrames = 0;
 };
 
 }
@@ -0,0 +1,249 @@
+/*
+    SER File Reader
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "serreader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Bytes before the first frame
+#define SER_HEADER_SIZE 178
+
+namespace
+{
+
+uint32_t get32(const uint8_t *p)
+{
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+uint64_t get64(const uint8_t *p)
+{
+    return uint64_t(get32(p)) | uint64_t(get32(p + 4)) << 32;
+}
+
+// Whole file mapped read only, nullptr if it could not be
+const uint8_t *mapFile(const std::string &path, size_t *size)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return nullptr;
+
+    void *mapped = MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        *size = static_cast<size_t>(st.st_size);
+        mapped = mmap(nullptr, *size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // The mapping holds the file
+    ::close(fd);
+    return mapped == MAP_FAILED ? nullptr : static_cast<const uint8_t *>(mapped);
+}
+
+}
+
+namespace INDI
+{
+
+const char SER_Reader::indexMagic[8] = {'I', 'N', 'D', 'I', 'S', 'E', 'R', '1'};
+
+SER_Reader::~SER_Reader()
+{
+    close();
+}
+
+bool SER_Reader::open(const std::string &path)
+{
+    close();
+    mError.clear();
+
+    mData = mapFile(path, &mSize);
+    if (mData == nullptr)
+    {
+        mError = "cannot map " + path + ": " + strerror(errno);
+        return false;
+    }
+
+    if (!parseHeader())
+    {
+        mError = path + " is not a SER file";
+        close();
+        return false;
+    }
+
+    useIndex(indexPath(path));
+    if (mIndex != nullptr)
+        return true;
+
+    if (mFrameSize == 0)
+    {
+        mError = path + " has no frame size and no index";
+        close();
+        return false;
+    }
+
+    // Without an index: frames one after the other, then the timestamps once the recording was closed
+    uint64_t frames = (mSize - SER_HEADER_SIZE) / mFrameSize;
+    if (mHeader.FrameCount > 0 && mHeader.FrameCount <= frames)
+    {
+        mFrameCount = mHeader.FrameCount;
+        uint64_t trailer = SER_HEADER_SIZE + mFrameCount * mFrameSize;
+        if (trailer + mFrameCount * sizeof(uint64_t) <= mSize)
+            mTrailer = mData + trailer;
+    }
+    else
+        mFrameCount = static_cast<uint32_t>(std::min<uint64_t>(frames, UINT32_MAX));
+    return true;
+}
+
+void SER_Reader::close()
+{
+    if (mData != nullptr)
+        munmap(const_cast<uint8_t *>(mData), mSize);
+    if (mIndex != nullptr)
+        munmap(const_cast<uint8_t *>(mIndex), mIndexSize);
+    mData = mIndex = mTrailer = nullptr;
+    mSize = mIndexSize = 0;
+    mHeader = ser_header {};
+    mFrameSize = 0;
+    mFrameCount = 0;
+}
+
+bool SER_Reader::parseHeader()
+{
+    if (mSize < SER_HEADER_SIZE)
+        return false;
+
+    const uint8_t *p = mData;
+    memcpy(mHeader.FileID, p, 14);
+    mHeader.LuID         = get32(p + 14);
+    mHeader.ColorID      = get32(p + 18);
+    mHeader.LittleEndian = get32(p + 22);
+    mHeader.ImageWidth   = get32(p + 26);
+    mHeader.ImageHeight  = get32(p + 30);
+    mHeader.PixelDepth   = get32(p + 34);
+    mHeader.FrameCount   = get32(p + 38);
+    memcpy(mHeader.Observer, p + 42, 40);
+    memcpy(mHeader.Instrume, p + 82, 40);
+    memcpy(mHeader.Telescope, p + 122, 40);
+    mHeader.DateTime     = get64(p + 162);
+    mHeader.DateTime_UTC = get64(p + 170);
+
+    // "LUCAM-RECORDER" by the specification, "INDI-RECORDER" for files of SER_Recorder
+    if (memcmp(mHeader.FileID, "LUCAM-RECORDER", 14) && memcmp(mHeader.FileID, "INDI-RECORDER", 13))
+        return false;
+    if (mHeader.PixelDepth == 0 || mHeader.PixelDepth > 16)
+        return false;
+
+    uint64_t planes = (mHeader.ColorID == SER_RGB || mHeader.ColorID == SER_BGR) ? 3 : 1;
+    mFrameSize = uint64_t(mHeader.ImageWidth) * mHeader.ImageHeight * (mHeader.PixelDepth <= 8 ? 1 : 2) * planes;
+    return true;
+}
+
+void SER_Reader::useIndex(const std::string &path)
+{
+    size_t size = 0;
+    const uint8_t *index = mapFile(path, &size);
+    if (index == nullptr)
+        return;
+
+    // Only the records of frames in the file, a reader may open a recording still going on
+    size_t records = size < sizeof(indexMagic) ? 0 : (size - sizeof(indexMagic)) / indexRecordSize;
+    while (records > 0)
+    {
+        const uint8_t *last = index + sizeof(indexMagic) + (records - 1) * indexRecordSize;
+        if (get64(last) + get64(last + 8) <= mSize)
+            break;
+        records--;
+    }
+
+    // The index of another recording, or one that could not be written to the end
+    bool valid = size >= sizeof(indexMagic) && !memcmp(index, indexMagic, sizeof(indexMagic)) &&
+                 (records == 0 || get64(index + sizeof(indexMagic)) == SER_HEADER_SIZE) &&
+                 (mHeader.FrameCount == 0 || records >= mHeader.FrameCount);
+    if (!valid)
+    {
+        munmap(const_cast<uint8_t *>(index), size);
+        return;
+    }
+
+    mIndex = index;
+    mIndexSize = size;
+    mFrameCount = static_cast<uint32_t>(mHeader.FrameCount > 0 ? mHeader.FrameCount : std::min<size_t>(records, UINT32_MAX));
+}
+
+const uint8_t *SER_Reader::frame(uint32_t index, size_t *size) const
+{
+    if (index >= mFrameCount)
+        return nullptr;
+
+    uint64_t offset = SER_HEADER_SIZE + index * mFrameSize;
+    uint64_t bytes = mFrameSize;
+    if (mIndex != nullptr)
+    {
+        const uint8_t *record = mIndex + sizeof(indexMagic) + size_t(index) * indexRecordSize;
+        offset = get64(record);
+        bytes = get64(record + 8);
+    }
+    if (offset + bytes > mSize)
+        return nullptr;
+    if (size)
+        *size = bytes;
+    return mData + offset;
+}
+
+uint64_t SER_Reader::timestamp(uint32_t index) const
+{
+    if (index >= mFrameCount)
+        return 0;
+    if (mIndex != nullptr)
+        return get64(mIndex + sizeof(indexMagic) + size_t(index) * indexRecordSize + 16);
+    if (mTrailer != nullptr)
+        return get64(mTrailer + size_t(index) * sizeof(uint64_t));
+    return 0;
+}
+
+uint32_t SER_Reader::frameAt(uint64_t timestamp) const
+{
+    if (!hasTimestamps())
+        return mFrameCount;
+
+    // Timestamps of a recording go forward
+    uint32_t first = 0, count = mFrameCount;
+    while (count > 0)
+    {
+        uint32_t step = count / 2;
+        if (this->timestamp(first + step) < timestamp)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+            count = step;
+    }
+    return first;
+}
+
+}
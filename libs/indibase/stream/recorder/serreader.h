@@ -0,0 +1,119 @@
+/*
+    SER File Reader
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include "serrecorder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace INDI
+{
+
+/**
+ * @brief The SER_Reader class gives random access to the frames of a SER file, mapped in memory.
+ *
+ * Opening costs the same whatever the size of the file: nothing is scanned. Offsets and timestamps
+ * come from the sidecar index written by SER_Recorder next to the file when there is one, else from
+ * the frame size and the timestamps trailer.
+ *
+ * The index is the file name followed by ".idx": the 8 bytes "INDISER1", then a record for each frame
+ * written, its 64 bits offset in the SER file, size and timestamp, little endian. The recorder appends
+ * records, about every second, only once their frames are in the file: a recording cut short by a crash
+ * keeps the timestamps of the frames it has, the trailer is only written when the recording is closed.
+ */
+class SER_Reader
+{
+    public:
+        static const char indexMagic[8];
+        static const size_t indexRecordSize = 24;
+
+        SER_Reader() = default;
+        ~SER_Reader();
+
+        SER_Reader(const SER_Reader &) = delete;
+        SER_Reader &operator=(const SER_Reader &) = delete;
+
+        static std::string indexPath(const std::string &path)
+        {
+            return path + ".idx";
+        }
+
+        bool open(const std::string &path);
+        void close();
+
+        bool isOpen() const
+        {
+            return mData != nullptr;
+        }
+
+        /** @brief Why open() failed. */
+        const std::string &error() const
+        {
+            return mError;
+        }
+
+        /** @brief The header of the file, its FrameCount is 0 for a recording that was not closed. */
+        const ser_header &header() const
+        {
+            return mHeader;
+        }
+
+        uint32_t frameCount() const
+        {
+            return mFrameCount;
+        }
+
+        /** @brief Whether the frames have timestamps, from the index or the trailer. */
+        bool hasTimestamps() const
+        {
+            return mIndex != nullptr || mTrailer != nullptr;
+        }
+
+        /**
+         * @brief Data of a frame, in the mapping: valid until the reader is closed.
+         * @return nullptr past the last frame.
+         */
+        const uint8_t *frame(uint32_t index, size_t *size = nullptr) const;
+
+        /** @brief Timestamp of a frame, in 100 ns since Jan 1, 1 AD as in SER files, 0 if unknown. */
+        uint64_t timestamp(uint32_t index) const;
+
+        /** @brief First frame taken at or after a timestamp, frameCount() if none or without timestamps. */
+        uint32_t frameAt(uint64_t timestamp) const;
+
+    private:
+        bool parseHeader();
+        void useIndex(const std::string &path);
+
+        const uint8_t *mData {nullptr};
+        size_t mSize {0};
+        const uint8_t *mIndex {nullptr};
+        size_t mIndexSize {0};
+        const uint8_t *mTrailer {nullptr};
+
+        ser_header mHeader {};
+        uint64_t mFrameSize {0};
+        uint32_t mFrameCount {0};
+        std::string mError;
+};
+
+}
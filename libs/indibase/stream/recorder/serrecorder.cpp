@@ -26,16 +26,32 @@
 */
 
 #include "serrecorder.h"
+#include "serreader.h"
 #include "jpegutils.h"
 
+#include <algorithm>
+#include <chrono>
 #include <ctime>
 #include <cerrno>
 #include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/time.h>
 
 
 #define ERRMSGSIZ 1024
 
+// Bytes before the first frame
+#define SER_HEADER_SIZE 178
+
+// The ring holds at least this much, and this many frames
+static const size_t RING_MIN_SIZE   = 64 * 1024 * 1024;
+static const size_t RING_MIN_FRAMES = 8;
+// Largest single write, so that space frees up while a large frame is written
+static const size_t WRITE_CHUNK_SIZE = 8 * 1024 * 1024;
+// The index gets the frames written at least this often
+static const std::chrono::milliseconds INDEX_FLUSH_INTERVAL(1000);
+
 namespace INDI
 {
 
@@ -60,7 +76,9 @@ SER_Recorder::SER_Recorder()
 
 SER_Recorder::~SER_Recorder()
 {
+    close();
     free(jpegBuffer);
+    free(ring);
 }
 
 bool SER_Recorder::is_little_endian()
@@ -185,9 +203,56 @@ bool SER_Recorder::open(const char *filename, char *errmsg)
     serh.DateTime_UTC = getUTCTimeStamp();
     write_header(&serh);
     frame_size        = serh.ImageWidth * serh.ImageHeight * (serh.PixelDepth <= 8 ? 1 : 2) * number_of_planes;
-    isRecordingActive = true;
+
+    // Page aligned, keep it across recordings of the same size
+    size_t size = std::max(RING_MIN_SIZE, RING_MIN_FRAMES * frame_size);
+    size = (size + 4095) & ~static_cast<size_t>(4095);
+    if (size != ringSize)
+    {
+        free(ring);
+        ring = nullptr;
+        ringSize = 0;
+        void *buffer = nullptr;
+        if (posix_memalign(&buffer, 4096, size) != 0)
+        {
+            snprintf(errmsg, ERRMSGSIZ, "recorder cannot allocate a %zu MB buffer\n", size / 1024 / 1024);
+            fclose(f);
+            f = nullptr;
+            return false;
+        }
+        ring = static_cast<uint8_t *>(buffer);
+        ringSize = size;
+    }
+    ringHead = ringUsed = 0;
+    writerStop = writeFailed = false;
+    droppedFrames = 0;
+
+    // Without an index the recording is still readable, only slower to open
+    indexQueue.clear();
+    queuedOffset = SER_HEADER_SIZE;
+    indexFile = fopen(SER_Reader::indexPath(filename).c_str(), "wb");
+    if (indexFile && fwrite(SER_Reader::indexMagic, 1, sizeof(SER_Reader::indexMagic), indexFile) != sizeof(SER_Reader::indexMagic))
+    {
+        fclose(indexFile);
+        indexFile = nullptr;
+    }
 
     frameStamps.clear();
+    frameStamps.reserve(m_ExpectedFrames);
+
+#ifdef __linux__
+    // Reserve the blocks up front without changing the file size, close() gives back what is left.
+    // Not every file system can, exFAT may not.
+    if (m_ExpectedFrames > 0)
+    {
+        fflush(f);
+        off_t length = SER_HEADER_SIZE + static_cast<off_t>(m_ExpectedFrames) * (frame_size + sizeof(uint64_t));
+        fallocate(fileno(f), FALLOC_FL_KEEP_SIZE, 0, length);
+    }
+#endif
+
+    writer = std::thread(&SER_Recorder::writerThread, this);
+    isRecordingActive = true;
 
     return true;
 }
@@ -196,12 +261,34 @@ bool SER_Recorder::close()
 {
     if (f)
     {
+        // Write the frames still in the ring
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            writerStop = true;
+        }
+        ringCondition.notify_one();
+        if (writer.joinable())
+            writer.join();
+
+        if (indexFile)
+        {
+            fclose(indexFile);
+            indexFile = nullptr;
+        }
+
         // Write all timestamps
         for (auto value : frameStamps)
             write_long_int_le(&value);
 
         frameStamps.clear();
 
+#ifdef __linux__
+        // Release the preallocated blocks past the end
+        fflush(f);
+        if (m_ExpectedFrames > 0 && ftruncate(fileno(f), ftell(f)) != 0)
+            perror("SER recorder truncate");
+#endif
+
         fseek(f, 0L, SEEK_SET);
         write_header(&serh);
         fclose(f);
@@ -212,51 +299,118 @@ bool SER_Recorder::close()
     return true;
 }
 
-bool SER_Recorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t timestamp)
+void SER_Recorder::writerThread()
 {
-    if (!isRecordingActive)
-        return false;
+    uint64_t position = SER_HEADER_SIZE;
+    std::vector<uint8_t> records;
+    auto flushed = std::chrono::steady_clock::now();
 
-#if 0
-    if (serh.ColorID == SER_MONO)
+    std::unique_lock<std::mutex> lock(ringMutex);
+    for (;;)
     {
-        if (isStreamingActive == false &&
-                (offsetX > 0 || offsetY > 0 || serh.ImageWidth != rawWidth || serh.ImageHeight != rawHeight))
+        ringCondition.wait_for(lock, INDEX_FLUSH_INTERVAL, [this]()
         {
-            int offset = ((rawWidth * offsetY) + offsetX);
+            return ringUsed > 0 || writerStop;
+        });
 
-            uint8_t *srcBuffer  = frame + offset;
-            uint8_t *destBuffer = frame;
-            int imageWidth      = serh.ImageWidth;
-            int imageHeight     = serh.ImageHeight;
+        // Frames now whole in the file
+        while (!indexQueue.empty() && indexQueue.front().offset + indexQueue.front().size <= position)
+        {
+            for (uint64_t value : {indexQueue.front().offset, indexQueue.front().size, indexQueue.front().timestamp})
+                for (int i = 0; i < 8; i++)
+                    records.push_back(static_cast<uint8_t>(value >> (8 * i)));
+            indexQueue.pop_front();
+        }
 
-            for (int i = 0; i < imageHeight; i++)
-                memcpy(destBuffer + i * imageWidth, srcBuffer + rawWidth * i, imageWidth);
+        bool drained = writerStop && ringUsed == 0;
+        auto now = std::chrono::steady_clock::now();
+        if (!records.empty() && (drained || now - flushed >= INDEX_FLUSH_INTERVAL))
+        {
+            lock.unlock();
+            writeIndex(records);
+            lock.lock();
+            records.clear();
+            flushed = now;
+        }
+
+        // Stopped and drained
+        if (drained)
+            break;
+        if (ringUsed == 0)
+            continue;
+
+        size_t tail  = (ringHead + ringSize - ringUsed) % ringSize;
+        size_t chunk = std::min({ringUsed, ringSize - tail, WRITE_CHUNK_SIZE});
+
+        lock.unlock();
+        bool written = fwrite(ring + tail, 1, chunk, f) == chunk;
+        lock.lock();
+
+        ringUsed -= chunk;
+        position += chunk;
+        if (!written)
+        {
+            writeFailed = true;
+            ringUsed = 0;
         }
     }
-    else
+}
+
+bool SER_Recorder::writeIndex(const std::vector<uint8_t> &records)
+{
+    if (indexFile == nullptr)
+        return false;
+
+    // The frames reach the file before the records pointing at them
+    if (fflush(f) != 0 || fwrite(records.data(), 1, records.size(), indexFile) != records.size() || fflush(indexFile) != 0)
     {
-        if (isStreamingActive == false &&
-                (offsetX > 0 || offsetY > 0 || serh.ImageWidth != rawWidth || serh.ImageHeight != rawHeight))
-        {
-            int offset = ((rawWidth * offsetY) + offsetX);
+        fclose(indexFile);
+        indexFile = nullptr;
+        return false;
+    }
+    return true;
+}
 
-            uint8_t *srcBuffer  = frame + offset * 3;
-            uint8_t *destBuffer = frame;
-            int imageWidth      = serh.ImageWidth;
-            int imageHeight     = serh.ImageHeight;
+bool SER_Recorder::queueFrame(const uint8_t *frame, size_t nbytes, uint64_t timestamp)
+{
+    size_t head;
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        if (writeFailed)
+            return false;
 
-            // RGB
-            for (int i = 0; i < imageHeight; i++)
-                memcpy(destBuffer + i * imageWidth * 3, srcBuffer + rawWidth * 3 * i, imageWidth * 3);
+        if (ringSize - ringUsed < nbytes)
+        {
+            droppedFrames++;
+            return true;
         }
+        head = ringHead;
     }
-#endif
 
-    if(timestamp)
-        frameStamps.push_back(timestamp * m_sepaseconds_per_microsecond);
-    else
-        frameStamps.push_back(getUTCTimeStamp());
+    // Only this thread writes past the used part of the ring, copy without the lock
+    size_t first = std::min(nbytes, ringSize - head);
+    memcpy(ring + head, frame, first);
+    memcpy(ring, frame + first, nbytes - first);
+
+    uint64_t stamp = timestamp ? timestamp * m_sepaseconds_per_microsecond : getUTCTimeStamp();
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        ringHead = (head + nbytes) % ringSize;
+        ringUsed += nbytes;
+        indexQueue.push_back({queuedOffset, nbytes, stamp});
+        queuedOffset += nbytes;
+    }
+    ringCondition.notify_one();
+
+    frameStamps.push_back(stamp);
+    serh.FrameCount += 1;
+    return true;
+}
+
+bool SER_Recorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t timestamp)
+{
+    if (!isRecordingActive)
+        return false;
 
     // Not technically pixel format, but let's use this for now.
     if (m_PixelFormat == INDI_JPG)
@@ -269,12 +423,10 @@ bool SER_Recorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t ti
         serh.ImageWidth = w;
         serh.ImageHeight = h;
         serh.ColorID = (naxis == 3) ? SER_RGB : SER_MONO;
-        fwrite(jpegBuffer, 1, memsize, f);
+        return queueFrame(jpegBuffer, memsize, timestamp);
     }
-    else
-        fwrite(frame, 1, nbytes, f);
-    serh.FrameCount += 1;
-    return true;
+
+    return queueFrame(frame, nbytes, timestamp);
 }
 
 // Copyright (C) 2015 Chris Garry
@@ -23,8 +23,12 @@
 
 #include "recorderinterface.h"
 
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <mutex>
 #include <stdio.h>
+#include <thread>
 
 typedef struct ser_header
 {
@@ -66,6 +70,10 @@ namespace INDI
 
 /**
  * @brief The SER_Recorder class implements recording of video streams in SER format.
+ *
+ * Frames are copied into a large ring buffer and written out by a writer thread, so that slow
+ * storage does not hold the stream thread. When the ring is full the frame is dropped and counted.
+ * The writer thread also keeps the sidecar index of the recording, see SER_Reader.
  */
 class SER_Recorder : public RecorderInterface
 {
@@ -87,6 +95,10 @@ class SER_Recorder : public RecorderInterface
         {
             isStreamingActive = enable;
         }
+        virtual uint32_t getDroppedFrames() const
+        {
+            return droppedFrames;
+        }
 
         // Public constants
         static const uint64_t C_SEPASECONDS_PER_SECOND = 10000000;
@@ -131,5 +143,32 @@ class SER_Recorder : public RecorderInterface
 
         uint8_t *jpegBuffer = nullptr;
         INDI_PIXEL_FORMAT m_PixelFormat;
+
+        // Queue a frame for the writer thread
+        bool queueFrame(const uint8_t *frame, size_t nbytes, uint64_t timestamp);
+        void writerThread();
+        bool writeIndex(const std::vector<uint8_t> &records);
+
+        uint8_t *ring = nullptr;
+        size_t ringSize = 0;
+        size_t ringHead = 0;
+        size_t ringUsed = 0;
+        std::mutex ringMutex;
+        std::condition_variable ringCondition;
+        std::thread writer;
+        bool writerStop = false;
+        bool writeFailed = false;
+        uint32_t droppedFrames = 0;
+
+        // Frames queued, indexed once the writer thread wrote them
+        struct IndexEntry
+        {
+            uint64_t offset;
+            uint64_t size;
+            uint64_t timestamp;
+        };
+        std::deque<IndexEntry> indexQueue;
+        uint64_t queuedOffset = 0;
+        FILE *indexFile = nullptr;
 };
 }
@@ -25,6 +25,7 @@
 
 #define _FILE_OFFSET_BITS 64
 
+#include <algorithm>
 #include <ctime>
 #include <cerrno>
 #include <cstring>
@@ -32,6 +33,9 @@
 
 #define ERRMSGSIZ 1024
 
+// Most threads converting frames at once
+static const unsigned MAX_CONVERTERS = 4;
+
 static int ilog(unsigned _v)
 {
     int ret;
@@ -54,10 +58,7 @@ TheoraRecorder::TheoraRecorder()
 
 TheoraRecorder::~TheoraRecorder()
 {
-    delete [] ycbcr[0].data;
-    delete [] ycbcr[1].data;
-    delete [] ycbcr[2].data;
-
+    stopPipeline();
     th_encode_free(td);
 }
 
@@ -87,50 +88,150 @@ bool TheoraRecorder::allocateBuffers()
     uint16_t yuv_h = (rawHeight + 15) & ~15;
 
     /* Do we need to allocate a buffer */
-    if (!ycbcr[0].data || yuv_w != ycbcr[0].width || yuv_h != ycbcr[0].height)
+    unsigned converterCount = std::max(1u, std::min(MAX_CONVERTERS, std::thread::hardware_concurrency() - 1));
+    // Frames being converted, plus one filling and one encoding
+    size_t jobCount = converterCount + 2;
+    if (jobs.size() != jobCount || yuv_w != ycbcr[0].width || yuv_h != ycbcr[0].height)
     {
-        ycbcr[0].width = yuv_w;
-        ycbcr[0].height = yuv_h;
-        ycbcr[0].stride = yuv_w;
-#if 0
-        if (m_PixelFormat == INDI_MONO)
-        {
-            ycbcr[1].width = 0;
-            ycbcr[1].stride = 0;
-            ycbcr[1].height = 0;
-            ycbcr[2].width = 0;
-            ycbcr[2].stride = 0;
-            ycbcr[2].height = 0;
-        }
-        else
+        std::vector<Job>(jobCount).swap(jobs);
+        for (auto &job : jobs)
         {
-#endif
-            ycbcr[1].width = (chroma_format == TH_PF_444) ? yuv_w : (yuv_w >> 1);
-            ycbcr[1].stride = ycbcr[1].width;
-            ycbcr[1].height = (chroma_format == TH_PF_420) ? (yuv_h >> 1) : yuv_h;
-            ycbcr[2].width = ycbcr[1].width;
-            ycbcr[2].stride = ycbcr[1].stride;
-            ycbcr[2].height = ycbcr[1].height;
-#if 0
+            job.planes[0].width = yuv_w;
+            job.planes[0].height = yuv_h;
+            job.planes[0].stride = yuv_w;
+            job.planes[1].width = (chroma_format == TH_PF_444) ? yuv_w : (yuv_w >> 1);
+            job.planes[1].stride = job.planes[1].width;
+            job.planes[1].height = (chroma_format == TH_PF_420) ? (yuv_h >> 1) : yuv_h;
+            job.planes[2].width = job.planes[1].width;
+            job.planes[2].stride = job.planes[1].stride;
+            job.planes[2].height = job.planes[1].height;
+
+            for (int i = 0; i < 3; i++)
+            {
+                job.planeData[i].resize(job.planes[i].stride * job.planes[i].height);
+                job.planes[i].data = job.planeData[i].data();
+            }
         }
-#endif
 
-        delete [] ycbcr[0].data;
-        delete [] ycbcr[1].data;
-        delete [] ycbcr[2].data;
+        // The encoder reads ycbcr, it points at the planes of the job being encoded
+        std::copy(std::begin(jobs.front().planes), std::end(jobs.front().planes), std::begin(ycbcr));
+    }
 
-        ycbcr[0].data = new uint8_t[ycbcr[0].stride * ycbcr[0].height];
-        ycbcr[1].data = new uint8_t[ycbcr[1].stride * ycbcr[1].height];
-        ycbcr[2].data = new uint8_t[ycbcr[2].stride * ycbcr[2].height];
+    return true;
+}
 
-#if 0
-        ycbcr[0].data = new uint8_t[ycbcr[0].stride * ycbcr[0].height];
-        ycbcr[1].data = (m_PixelFormat == INDI_MONO) ? 0 : new uint8_t[ycbcr[1].stride * ycbcr[1].height];
-        ycbcr[2].data = (m_PixelFormat == INDI_MONO) ? 0 : new uint8_t[ycbcr[2].stride * ycbcr[2].height];
-#endif
+void TheoraRecorder::startPipeline()
+{
+    // BGR2YUV fills its tables on first use, do that before the converters race for it
+    uint8_t rgb[12] = {0}, y[4], u[4], v[4];
+    BGR2YUV(2, 2, rgb, y, u, v, 0);
+
+    pipelineStop = false;
+    nextSequence = encodeSequence = 0;
+    for (auto &job : jobs)
+        job.state = Job::FREE;
+
+    for (size_t i = 0; i + 2 < jobs.size(); i++)
+        converters.emplace_back(&TheoraRecorder::convertLoop, this);
+    encoder = std::thread(&TheoraRecorder::encodeLoop, this);
+}
+
+void TheoraRecorder::stopPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        pipelineStop = true;
     }
+    jobCondition.notify_all();
 
-    return true;
+    for (auto &converter : converters)
+        converter.join();
+    converters.clear();
+    if (encoder.joinable())
+        encoder.join();
+}
+
+void TheoraRecorder::convertLoop()
+{
+    std::unique_lock<std::mutex> lock(jobMutex);
+    for (;;)
+    {
+        auto queued = jobs.end();
+        jobCondition.wait(lock, [&]()
+        {
+            queued = std::find_if(jobs.begin(), jobs.end(), [](const Job & job)
+            {
+                return job.state == Job::QUEUED;
+            });
+            return queued != jobs.end() || pipelineStop;
+        });
+
+        // Stopped and nothing left to convert
+        if (queued == jobs.end())
+            return;
+
+        queued->state = Job::CONVERTING;
+        lock.unlock();
+        convert(*queued);
+        lock.lock();
+        queued->state = Job::READY;
+        jobCondition.notify_all();
+    }
+}
+
+void TheoraRecorder::encodeLoop()
+{
+    std::unique_lock<std::mutex> lock(jobMutex);
+    for (;;)
+    {
+        auto ready = jobs.end();
+        jobCondition.wait(lock, [&]()
+        {
+            ready = std::find_if(jobs.begin(), jobs.end(), [this](const Job & job)
+            {
+                return job.state == Job::READY && job.sequence == encodeSequence;
+            });
+            return ready != jobs.end() || (pipelineStop && std::all_of(jobs.begin(), jobs.end(), [](const Job & job)
+            {
+                return job.state == Job::FREE;
+            }));
+        });
+
+        // Stopped and drained
+        if (ready == jobs.end())
+            return;
+
+        lock.unlock();
+        std::copy(std::begin(ready->planes), std::end(ready->planes), std::begin(ycbcr));
+        theora_write_frame(0);
+        lock.lock();
+        ready->state = Job::FREE;
+        encodeSequence++;
+        jobCondition.notify_all();
+    }
+}
+
+void TheoraRecorder::convert(Job &job)
+{
+    uint8_t *frame = job.frame.data();
+    if (m_PixelFormat == INDI_MONO)
+    {
+        for (uint16_t row = 0; row < rawHeight; row++)
+            memcpy(job.planes[0].data + row * job.planes[0].stride, frame + row * rawWidth, rawWidth);
+        // Cb and Cr values to 0x80 (128) for grayscale image
+        memset(job.planes[1].data, 0x80, job.planes[1].stride * job.planes[1].height);
+        memset(job.planes[2].data, 0x80, job.planes[2].stride * job.planes[2].height);
+    }
+    else if (m_PixelFormat == INDI_RGB)
+    {
+        BGR2YUV(rawWidth, rawHeight, frame, job.planes[0].data, job.planes[1].data, job.planes[2].data, 0);
+    }
+    else if (m_PixelFormat == INDI_JPG)
+    {
+        std::lock_guard<std::mutex> lock(jpegMutex);
+        decode_jpeg_raw(frame, job.frame.size(), 0, 0, rawWidth, rawHeight, job.planes[0].data, job.planes[1].data,
+                        job.planes[2].data);
+    }
 }
 
 bool TheoraRecorder::open(const char *filename, char *errmsg)
@@ -356,6 +457,7 @@ bool TheoraRecorder::open(const char *filename, char *errmsg)
         }
     }
 
+    startPipeline();
     isRecordingActive = true;
 
     return true;
@@ -363,6 +465,9 @@ bool TheoraRecorder::open(const char *filename, char *errmsg)
 
 bool TheoraRecorder::close()
 {
+    // Encode the frames still in the pipeline
+    stopPipeline();
+
     theora_write_frame(1);
 
     if(passno == 1)
@@ -420,26 +525,34 @@ bool TheoraRecorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t)
     if (!isRecordingActive)
         return false;
 
-    if (m_PixelFormat == INDI_MONO)
-    {
-        memcpy(ycbcr[0].data, frame, ycbcr[0].stride * ycbcr[0].height);
-        // Cb and Cr values to 0x80 (128) for grayscale image
-        memset(ycbcr[1].data, 0x80, ycbcr[1].stride * ycbcr[1].height);
-        memset(ycbcr[2].data, 0x80, ycbcr[2].stride * ycbcr[2].height);
-    }
-    else if (m_PixelFormat == INDI_RGB)
+    if (m_PixelFormat != INDI_MONO && m_PixelFormat != INDI_RGB && m_PixelFormat != INDI_JPG)
+        return false;
+
+    // Wait for a free job, the stream queue takes up the slack meanwhile
+    Job *job;
     {
-        BGR2YUV(rawWidth, rawHeight, const_cast<uint8_t*>(frame), ycbcr[0].data, ycbcr[1].data, ycbcr[2].data, 0);
+        std::unique_lock<std::mutex> lock(jobMutex);
+        auto free = jobs.end();
+        jobCondition.wait(lock, [&]()
+        {
+            free = std::find_if(jobs.begin(), jobs.end(), [](const Job & one)
+            {
+                return one.state == Job::FREE;
+            });
+            return free != jobs.end();
+        });
+        job = &*free;
+        job->state = Job::FILLING;
     }
-    else if (m_PixelFormat == INDI_JPG)
+
+    job->frame.assign(frame, frame + nbytes);
+
     {
-        decode_jpeg_raw((const_cast<uint8_t *>(frame)), nbytes, 0, 0, rawWidth, rawHeight, ycbcr[0].data, ycbcr[1].data,
-                        ycbcr[2].data );
+        std::lock_guard<std::mutex> lock(jobMutex);
+        job->sequence = nextSequence++;
+        job->state = Job::QUEUED;
     }
-    else
-        return false;
-
-    theora_write_frame(0);
+    jobCondition.notify_all();
 
     return true;
 }
@@ -26,14 +26,21 @@
 #include <ogg/ogg.h>
 #include <theora/theoraenc.h>
 
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 namespace INDI
 {
 
 /**
  * @brief The TheoraRecorder class implemented recording of video streaming data in a libtheora OGV file.
+ *
+ * Recording is pipelined: writeFrame only copies the frame, colour conversion runs on worker threads
+ * over several frames at once, and a single encoder thread encodes and muxes them in order.
  */
 class TheoraRecorder : public RecorderInterface
 {
@@ -64,6 +71,34 @@ class TheoraRecorder : public RecorderInterface
         uint8_t m_PixelDepth = 8;
 
     private:
+        // One frame through the pipeline
+        struct Job
+        {
+            enum State { FREE, FILLING, QUEUED, CONVERTING, READY };
+            State state = FREE;
+            uint64_t sequence = 0;
+            std::vector<uint8_t> frame;
+            th_ycbcr_buffer planes;
+            std::vector<uint8_t> planeData[3];
+        };
+
+        void startPipeline();
+        void stopPipeline();
+        void convertLoop();
+        void encodeLoop();
+        void convert(Job &job);
+
+        std::vector<Job> jobs;
+        std::vector<std::thread> converters;
+        std::thread encoder;
+        std::mutex jobMutex;
+        std::condition_variable jobCondition;
+        // JPEG decoding shares static buffers
+        std::mutex jpegMutex;
+        bool pipelineStop = false;
+        uint64_t nextSequence = 0;
+        uint64_t encodeSequence = 0;
+
         bool allocateBuffers();
         //int theora_write_frame(th_ycbcr_buffer ycbcr, int last);
         int theora_write_frame(int last);
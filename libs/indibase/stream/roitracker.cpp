@@ -0,0 +1,130 @@
+/*
+    Stream ROI Tracker
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+#include "roitracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace INDI
+{
+
+void RoiTracker::setInterval(uint32_t interval)
+{
+    mInterval = std::max<uint32_t>(interval, 1);
+}
+
+void RoiTracker::setDeadband(double deadband)
+{
+    mDeadband = std::max(deadband, 0.0);
+}
+
+bool RoiTracker::isDue()
+{
+    return mFrames++ % mInterval == 0;
+}
+
+void RoiTracker::reset()
+{
+    mFrames = 0;
+}
+
+RoiTracker::Region RoiTracker::searchRegion(const Region &region, size_t width, size_t height)
+{
+    Region search;
+    search.x = region.x > region.w / 2 ? region.x - region.w / 2 : 0;
+    search.y = region.y > region.h / 2 ? region.y - region.h / 2 : 0;
+    search.w = std::min(region.x + region.w + region.w / 2, width) - std::min(search.x, width);
+    search.h = std::min(region.y + region.h + region.h / 2, height) - std::min(search.y, height);
+    return search;
+}
+
+bool RoiTracker::locate(const uint8_t *frame, size_t width, size_t height, size_t bytesPerPixel, int depth,
+                        const Region &search, double &x, double &y)
+{
+    if (frame == nullptr || search.w == 0 || search.h == 0 || search.x + search.w > width || search.y + search.h > height)
+        return false;
+
+    auto pixel = [&](size_t column, size_t row) -> uint32_t
+    {
+        const uint8_t *p = frame + (row * width + column) * bytesPerPixel;
+        if (depth <= 8)
+            return *p;
+        uint16_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    };
+
+    uint64_t sum = 0;
+    uint32_t max = 0;
+    for (size_t row = search.y; row < search.y + search.h; row++)
+        for (size_t column = search.x; column < search.x + search.w; column++)
+        {
+            uint32_t value = pixel(column, row);
+            sum += value;
+            max = std::max(max, value);
+        }
+
+    double mean = static_cast<double>(sum) / (search.w * search.h);
+    if (max <= mean)
+        return false;
+
+    // Weighted by how far above the threshold, the glow around the blob counts little
+    double threshold = (mean + max) / 2;
+    double weight = 0, sumX = 0, sumY = 0;
+    for (size_t row = search.y; row < search.y + search.h; row++)
+        for (size_t column = search.x; column < search.x + search.w; column++)
+        {
+            double value = pixel(column, row) - threshold;
+            if (value <= 0)
+                continue;
+            weight += value;
+            sumX += value * column;
+            sumY += value * row;
+        }
+
+    x = sumX / weight;
+    y = sumY / weight;
+    return true;
+}
+
+bool RoiTracker::follow(double x, double y, Region &region, size_t width, size_t height) const
+{
+    double dx = x - (region.x + (region.w - 1) / 2.0);
+    double dy = y - (region.y + (region.h - 1) / 2.0);
+    if (std::hypot(dx, dy) <= mDeadband || region.w > width || region.h > height)
+        return false;
+
+    auto center = [](double position, size_t size, size_t limit)
+    {
+        double origin = std::round(position - (size - 1) / 2.0);
+        return static_cast<size_t>(std::min(std::max(origin, 0.0), static_cast<double>(limit - size)));
+    };
+
+    Region moved = region;
+    moved.x = center(x, region.w, width);
+    moved.y = center(y, region.h, height);
+    if (moved.x == region.x && moved.y == region.y)
+        return false;
+
+    region = moved;
+    return true;
+}
+
+}
@@ -0,0 +1,86 @@
+/*
+    Stream ROI Tracker
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace INDI
+{
+/**
+ * @brief Keeps a region of the frames centered on their brightest blob, such as a planet drifting
+ * through a stream. The blob is located every few frames and the region only moves once the blob
+ * is further than the dead band from its center, so that seeing does not shake it.
+ */
+class RoiTracker
+{
+    public:
+        struct Region
+        {
+            size_t x = 0, y = 0, w = 0, h = 0;
+        };
+
+    public:
+        /**
+         * @param interval Frames between two locations of the blob
+         * @param deadband Distance in pixels the blob may drift from the center before the region moves
+         */
+        void setInterval(uint32_t interval);
+        void setDeadband(double deadband);
+
+        /**
+         * @brief Count a frame
+         * @return True if the blob should be located in this frame
+         */
+        bool isDue();
+
+        /**
+         * @brief Start counting frames again, the next one is due
+         */
+        void reset();
+
+        /**
+         * @brief The part of the frame the blob is looked for in: the region and half its size around it
+         */
+        static Region searchRegion(const Region &region, size_t width, size_t height);
+
+        /**
+         * @brief Locate the brightest blob of a frame, the centroid of the pixels above half way from
+         * the mean to the maximum of the search region.
+         * @param frame width x height pixels of bytesPerPixel bytes, only the first 8 or 16 bits
+         * component of each pixel is read
+         * @param depth 8 or 16
+         * @param x,y centroid in pixels of the frame
+         * @return False if the search region is flat or empty
+         */
+        static bool locate(const uint8_t *frame, size_t width, size_t height, size_t bytesPerPixel, int depth,
+                           const Region &search, double &x, double &y);
+
+        /**
+         * @brief Center the region on the blob if it drifted out of the dead band, within width x height
+         * @return True if the region was moved
+         */
+        bool follow(double x, double y, Region &region, size_t width, size_t height) const;
+
+    private:
+        uint32_t mInterval = 10;
+        uint32_t mFrames = 0;
+        double mDeadband = 8;
+};
+}
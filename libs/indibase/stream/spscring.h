@@ -0,0 +1,343 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * \class SPSCRing template
+ * \brief The SPSCRing class is a bounded lock-free FIFO between one producer and one consumer thread.
+ *
+ * Pushing and popping only touch atomics. The mutex is taken only to sleep on an empty (or full, with
+ * OVERFLOW_BLOCK) ring and to wake a sleeping thread, so a producer and a consumer both busy never contend.
+ * Each slot carries a sequence number, as in the bounded queue of D. Vyukov: a slot being read is not
+ * overwritten, and the producer can drop the oldest item itself when the ring is full.
+ *
+ * Like UniqueQueue, data is moved in and out, so keep T cheap to move, e.g. a std::vector.
+ */
+template <typename T>
+class SPSCRing
+{
+    public:
+        enum OverflowPolicy
+        {
+            OVERFLOW_BLOCK,       /*!< push waits for the consumer to make room */
+            OVERFLOW_DROP_OLDEST, /*!< push discards the oldest item */
+            OVERFLOW_DROP_NEWEST  /*!< push refuses the new item */
+        };
+
+        /**
+         * @param capacity most items in the ring, rounded up to a power of two
+         * @param policy what push does when the ring is full
+         */
+        explicit SPSCRing(size_t capacity, OverflowPolicy policy = OVERFLOW_BLOCK);
+
+    public:
+        /**
+         * @brief Move data to the ring. Producer thread only.
+         * @param data the data, moved only if it is queued
+         * @param dropped with OVERFLOW_DROP_OLDEST, receives the item discarded to make room, if any
+         * @return false if data was not queued: the ring is full with OVERFLOW_DROP_NEWEST, or aborted
+         */
+        bool push(T &&data, T *dropped = nullptr);
+
+        /**
+         * @brief Pop data from the ring, waiting for some
+         * @param dest the data will be swapped and destroyed
+         * @return returns false if the abort function was called
+         */
+        bool pop(T &dest);
+
+        /**
+         * @brief Pop data from the ring
+         * @param dest the data will be swapped and destroyed
+         * @param msecs timeout in milliseconds
+         * @return returns false if timeout or the abort function was called
+         */
+        bool pop(T &dest, uint32_t msecs);
+
+        /**
+         * @brief Wait for an empty ring
+         */
+        void waitForEmpty() const;
+
+        /**
+         * @brief Wait for an empty ring
+         * @param msecs timeout in milliseconds
+         * @return returns false if timeout
+         */
+        bool waitForEmpty(uint32_t msecs) const;
+
+        /**
+         * @brief Discard all items
+         */
+        void clear();
+
+        /**
+         * @brief Discard all items and make waiting and further push and pop calls return false
+         */
+        void abort();
+
+        /**
+         * @brief Return the number of items in the ring
+         */
+        size_t size() const;
+
+        size_t capacity() const
+        {
+            return mask + 1;
+        }
+
+    protected:
+        struct Slot
+        {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        // Take the oldest item, from any thread
+        bool tryPop(T &dest);
+        // Wake threads sleeping in wait
+        void notify() const;
+        template <typename Predicate>
+        bool wait(Predicate predicate, const std::chrono::milliseconds *timeout) const;
+
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+        OverflowPolicy policy;
+
+        alignas(64) std::atomic<size_t> head {0};
+        alignas(64) std::atomic<size_t> tail {0};
+        alignas(64) std::atomic<bool> aborted {false};
+
+        mutable std::atomic<int> waiters {0};
+        mutable std::mutex mutex;
+        mutable std::condition_variable changed;
+};
+
+// implementation
+template <typename T>
+inline SPSCRing<T>::SPSCRing(size_t capacity, OverflowPolicy policy)
+    : policy(policy)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    mask = size - 1;
+    slots.reset(new Slot[size]);
+    for (size_t i = 0; i < size; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline bool SPSCRing<T>::push(T &&data, T *dropped)
+{
+    for (;;)
+    {
+        if (aborted.load(std::memory_order_acquire))
+            return false;
+
+        size_t position = tail.load(std::memory_order_relaxed);
+        Slot &slot = slots[position & mask];
+        if (slot.sequence.load(std::memory_order_acquire) == position)
+        {
+            slot.data = std::move(data);
+            slot.sequence.store(position + 1, std::memory_order_release);
+            tail.store(position + 1, std::memory_order_release);
+            notify();
+            return true;
+        }
+
+        // Full, or the consumer is still moving the oldest item out of the slot
+        switch (policy)
+        {
+            case OVERFLOW_DROP_NEWEST:
+                if (position - head.load(std::memory_order_acquire) > mask)
+                    return false;
+                std::this_thread::yield();
+                break;
+
+            case OVERFLOW_DROP_OLDEST:
+            {
+                T oldest;
+                if (tryPop(oldest) && dropped != nullptr)
+                    *dropped = std::move(oldest);
+                else
+                    std::this_thread::yield();
+                break;
+            }
+
+            case OVERFLOW_BLOCK:
+                wait([this, position]()
+                {
+                    return aborted.load(std::memory_order_acquire) ||
+                           slots[position & mask].sequence.load(std::memory_order_acquire) == position;
+                }, nullptr);
+                break;
+        }
+    }
+}
+
+template <typename T>
+inline bool SPSCRing<T>::tryPop(T &dest)
+{
+    size_t position = head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot &slot = slots[position & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != position + 1)
+        {
+            // Empty, or another thread took the slot meanwhile
+            size_t current = head.load(std::memory_order_relaxed);
+            if (current == position)
+                return false;
+            position = current;
+            continue;
+        }
+
+        if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+            std::swap(dest, slot.data);
+            slot.data = T();
+            slot.sequence.store(position + mask + 1, std::memory_order_release);
+            notify();
+            return true;
+        }
+    }
+}
+
+template <typename T>
+inline bool SPSCRing<T>::pop(T &dest)
+{
+    for (;;)
+    {
+        if (aborted.load(std::memory_order_acquire))
+            return false;
+
+        if (tryPop(dest))
+            return true;
+
+        wait([this]()
+        {
+            return aborted.load(std::memory_order_acquire) || size() > 0;
+        }, nullptr);
+    }
+}
+
+template <typename T>
+inline bool SPSCRing<T>::pop(T &dest, uint32_t msecs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(msecs);
+    for (;;)
+    {
+        if (aborted.load(std::memory_order_acquire))
+            return false;
+
+        if (tryPop(dest))
+            return true;
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        auto ready = [this]()
+        {
+            return aborted.load(std::memory_order_acquire) || size() > 0;
+        };
+        if (left.count() <= 0 || !wait(ready, &left))
+            return false; // timeout
+    }
+}
+
+template <typename T>
+inline size_t SPSCRing<T>::size() const
+{
+    size_t first = head.load(std::memory_order_acquire);
+    size_t last = tail.load(std::memory_order_acquire);
+    return last > first ? last - first : 0;
+}
+
+template <typename T>
+inline void SPSCRing<T>::clear()
+{
+    T item;
+    while (tryPop(item))
+        item = T();
+}
+
+template <typename T>
+inline void SPSCRing<T>::waitForEmpty() const
+{
+    wait([this]()
+    {
+        return size() == 0;
+    }, nullptr);
+}
+
+template <typename T>
+inline bool SPSCRing<T>::waitForEmpty(uint32_t msecs) const
+{
+    std::chrono::milliseconds timeout(msecs);
+    return wait([this]()
+    {
+        return size() == 0;
+    }, &timeout);
+}
+
+template <typename T>
+inline void SPSCRing<T>::abort()
+{
+    aborted.store(true, std::memory_order_release);
+    clear();
+    notify();
+}
+
+template <typename T>
+inline void SPSCRing<T>::notify() const
+{
+    // Pairs with the fence in wait: either the sleeper sees the change, or we see the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        changed.notify_all();
+    }
+}
+
+template <typename T>
+template <typename Predicate>
+inline bool SPSCRing<T>::wait(Predicate predicate, const std::chrono::milliseconds *timeout) const
+{
+    if (predicate())
+        return true;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    bool result = true;
+    if (timeout == nullptr)
+        changed.wait(lock, predicate);
+    else
+        result = changed.wait_for(lock, *timeout, predicate);
+
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+}
@@ -30,19 +30,41 @@
 #include "indiutility.h"
 #include "indisinglethreadpool.h"
 #include "indielapsedtimer.h"
+#include "pixel/pixelkernels.h"
+#include "indiprobes.h"
 
 #include <cerrno>
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <cmath>
 
 static const char * STREAM_TAB = "Streaming";
 
+// Frames waiting for the stream thread, on top of the LIMITS_BUFFER_MAX size limit
+static const size_t MAX_QUEUED_FRAMES = 1024;
+
+// Released frame buffers kept for reuse
+static const size_t MAX_POOLED_FRAMES = 8;
+
+// FPS, stream delay and buffer usage publish rate
+static const int TELEMETRY_PERIOD_MS = 250;
+
+// Previews between two auto stretch histograms
+static const int STRETCH_INTERVAL_FRAMES = 10;
+
+// Frames the tracker waits for the camera frame to move, drivers may keep it where it was
+static const uint32_t TRACK_SETTLE_FRAMES = 100;
+
+// Frames kept for local readers, who have that many frame times to read one
+static const uint32_t SHARED_FRAMES_SLOTS = 4;
+
 namespace INDI
 {
 
 StreamManagerPrivate::StreamManagerPrivate(DefaultDevice *defaultDevice)
     : currentDevice(defaultDevice)
+    , framesIncoming(MAX_QUEUED_FRAMES, SPSCRing<TimeFrame>::OVERFLOW_DROP_NEWEST)
 {
     FPSAverage.setTimeWindow(1000);
 #ifdef __arm__
@@ -62,6 +84,16 @@ StreamManagerPrivate::StreamManagerPrivate(DefaultDevice *defaultDevice)
     LOGF_DEBUG("Using default encoder (%s)", encoder->getName());
 
     framesThread = std::thread(&StreamManagerPrivate::asyncStreamThread, this);
+
+    // A lighter stream for remote viewers, off until given a rate
+    addOutput("REMOTE");
+
+    telemetryTimer.callOnTimeout([this]
+    {
+        moveCameraFrame();
+        publishTelemetry();
+    });
+    telemetryTimer.start(TELEMETRY_PERIOD_MS);
 }
 
 StreamManagerPrivate::~StreamManagerPrivate()
@@ -72,6 +104,7 @@ StreamManagerPrivate::~StreamManagerPrivate()
         framesIncoming.abort();
         framesThread.join();
     }
+    closeSharedFrames();
 }
 
 StreamManager::StreamManager(DefaultDevice *mainDevice)
@@ -120,6 +153,11 @@ bool StreamManagerPrivate::initProperties()
     FpsNP[FPS_AVERAGE].fill("AVG_FPS", "Average (1 sec.)", "%.2f", 0.0, 999.0, 0.0, 30);
     FpsNP.fill(getDeviceName(), "FPS", "FPS", STREAM_TAB, IP_RO, 60, IPS_IDLE);
 
+    /* Stream buffer usage */
+    StreamBufferNP[BUFFER_FRAMES].fill("BUFFER_FRAMES", "Frames", "%.0f", 0, 100000, 0, 0);
+    StreamBufferNP[BUFFER_MB    ].fill("BUFFER_MB",     "Size (MB)", "%.1f", 0, 1024 * 64, 0, 0);
+    StreamBufferNP.fill(getDeviceName(), "STREAM_BUFFER", "Stream Buffer", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+
     /* Record Frames */
     /* File */
     // @INDI_STANDARD_PROPERTY@
@@ -154,12 +192,29 @@ bool StreamManagerPrivate::initProperties()
         StreamFrameNP[3].fill("HEIGHT", "Height", "%.f", 0, 0, 0, 0);
         StreamFrameNP.fill(getDeviceName(), "CCD_STREAM_FRAME", "Frame", STREAM_TAB, IP_RW,
                            60, IPS_IDLE);
+
+        // Tracking of the brightest blob of the stream
+        StreamTrackSP[TRACK_OFF   ].fill("TRACK_OFF",    "Off",          ISS_ON);
+        StreamTrackSP[TRACK_STREAM].fill("TRACK_STREAM", "Stream frame", ISS_OFF);
+        StreamTrackSP[TRACK_CAMERA].fill("TRACK_CAMERA", "Camera frame", ISS_OFF);
+        StreamTrackSP.fill(getDeviceName(), "CCD_STREAM_TRACK", "Tracking", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+        StreamTrackNP[TRACK_INTERVAL].fill("TRACK_INTERVAL", "Every (frames)", "%.f", 1, 1000, 1, 10);
+        StreamTrackNP[TRACK_DEADBAND].fill("TRACK_DEADBAND", "Dead band (px)", "%.f", 0, 1000, 1, 8);
+        StreamTrackNP.fill(getDeviceName(), "CCD_STREAM_TRACK_SETTINGS", "Tracking", STREAM_TAB, IP_RW, 60, IPS_IDLE);
     }
 
     // Encoder Selection
     // @INDI_STANDARD_PROPERTY@
     EncoderSP[ENCODER_RAW  ].fill("RAW",   "RAW",   ISS_ON);
     EncoderSP[ENCODER_MJPEG].fill("MJPEG", "MJPEG", ISS_OFF);
+    // Hardware encoders found on this system follow
+    EncoderSP.resize(encoderManager.getEncoderList().size());
+    for (size_t i = ENCODER_MAX; i < EncoderSP.size(); i++)
+    {
+        const char *encoderName = encoderManager.getEncoderList().at(i)->getName();
+        EncoderSP[i].fill(encoderName, encoderName, ISS_OFF);
+    }
     if(currentDevice->getDriverInterface() & INDI::DefaultDevice::SENSOR_INTERFACE)
         EncoderSP.fill(getDeviceName(), "SENSOR_STREAM_ENCODER", "Encoder", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
     else
@@ -184,6 +239,49 @@ bool StreamManagerPrivate::initProperties()
     LimitsNP[LIMITS_BUFFER_MAX ].fill("LIMITS_BUFFER_MAX",  "Maximum Buffer Size (MB)", "%.0f", 1, 1024 * 64, 1, 512);
     LimitsNP[LIMITS_PREVIEW_FPS].fill("LIMITS_PREVIEW_FPS", "Maximum Preview FPS",      "%.0f", 1, 120,     1,  10);
     LimitsNP.fill(getDeviceName(), "LIMITS", "Limits", STREAM_TAB, IP_RW, 0, IPS_IDLE);
+
+    // Preview stretch of frames deeper than 8 bits
+    PreviewStretchSP[STRETCH_OFF ].fill("STRETCH_OFF",  "Off",  ISS_ON);
+    PreviewStretchSP[STRETCH_AUTO].fill("STRETCH_AUTO", "Auto", ISS_OFF);
+    PreviewStretchSP.fill(getDeviceName(), "PREVIEW_STRETCH", "Preview Stretch", STREAM_TAB, IP_RW, ISR_1OFMANY, 0,
+                          IPS_IDLE);
+
+    // Stage latencies
+    const char *stages[STAGE_MAX][2] =
+    {
+        {"QUEUE",   "Queue"},
+        {"PROCESS", "Process"},
+        {"RECORD",  "Record"},
+        {"ENCODE",  "Encode"},
+        {"UPLOAD",  "Upload"}
+    };
+    for (int i = 0; i < STAGE_MAX; i++)
+    {
+        std::string name = stages[i][0], label = stages[i][1];
+        StreamLatencyNP[2 * i    ].fill(name + "_P50", label + " median (ms)", "%.3f", 0, 60000, 0, 0);
+        StreamLatencyNP[2 * i + 1].fill(name + "_P99", label + " 99% (ms)",    "%.3f", 0, 60000, 0, 0);
+    }
+    StreamLatencyNP.fill(getDeviceName(), "STREAM_LATENCY", "Latency", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Per frame timing trace of recordings
+    StreamTraceSP[TRACE_ON ].fill("TRACE_ON",  "On",  ISS_OFF);
+    StreamTraceSP[TRACE_OFF].fill("TRACE_OFF", "Off", ISS_ON);
+    StreamTraceSP.fill(getDeviceName(), "RECORD_TRACE", "Record Trace", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    // Frames shared in memory with local processes, while streaming
+    StreamSharedSP[SHARED_ON ].fill("SHARED_ON",  "On",  ISS_OFF);
+    StreamSharedSP[SHARED_OFF].fill("SHARED_OFF", "Off", ISS_ON);
+    StreamSharedSP.fill(getDeviceName(), "STREAM_SHARED", "Shared Frames", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    StreamSharedTP[0].fill("SHARED_PATH", "Path", "");
+    StreamSharedTP.fill(getDeviceName(), "STREAM_SHARED_PATH", "Shared Frames", STREAM_TAB, IP_RO, 0, IPS_IDLE);
+
+    // Set by indiserver, see ClInfo::q2Clients
+    StreamBacklogNP[0].fill("BACKLOG", "Slowest Client", "%.2f", 0, 1, 0.25, 0);
+    StreamBacklogNP.fill(getDeviceName(), "STREAM_BACKLOG", "Backlog", STREAM_TAB, IP_RO, 0, IPS_IDLE);
+
+    for (auto &output : outputs)
+        output->initProperties(STREAM_TAB);
     return true;
 }
 
@@ -204,14 +302,26 @@ void StreamManagerPrivate::ISGetProperties(const char *dev)
         if (hasStreamingExposure)
             currentDevice->defineProperty(StreamExposureNP);
         currentDevice->defineProperty(FpsNP);
+        currentDevice->defineProperty(StreamBufferNP);
         currentDevice->defineProperty(RecordStreamSP);
         currentDevice->defineProperty(RecordFileTP);
         currentDevice->defineProperty(RecordOptionsNP);
         currentDevice->defineProperty(StreamFrameNP);
+        currentDevice->defineProperty(StreamTrackSP);
+        currentDevice->defineProperty(StreamTrackNP);
         currentDevice->defineProperty(EncoderSP);
         currentDevice->defineProperty(RecorderSP);
         currentDevice->defineProperty(LimitsNP);
+        currentDevice->defineProperty(PreviewStretchSP);
+        currentDevice->defineProperty(StreamLatencyNP);
+        currentDevice->defineProperty(StreamTraceSP);
+        currentDevice->defineProperty(StreamSharedSP);
+        currentDevice->defineProperty(StreamSharedTP);
+        currentDevice->defineProperty(StreamBacklogNP);
     }
+
+    for (auto &output : outputs)
+        output->ISGetProperties();
 }
 
 void StreamManager::ISGetProperties(const char * dev)
@@ -238,30 +348,52 @@ bool StreamManagerPrivate::updateProperties()
         if (hasStreamingExposure)
             currentDevice->defineProperty(StreamExposureNP);
         currentDevice->defineProperty(FpsNP);
+        currentDevice->defineProperty(StreamBufferNP);
         currentDevice->defineProperty(RecordStreamSP);
         currentDevice->defineProperty(RecordFileTP);
         currentDevice->defineProperty(RecordOptionsNP);
         currentDevice->defineProperty(StreamFrameNP);
+        currentDevice->defineProperty(StreamTrackSP);
+        currentDevice->defineProperty(StreamTrackNP);
         currentDevice->defineProperty(EncoderSP);
         currentDevice->defineProperty(RecorderSP);
         currentDevice->defineProperty(LimitsNP);
+        currentDevice->defineProperty(PreviewStretchSP);
+        currentDevice->defineProperty(StreamLatencyNP);
+        currentDevice->defineProperty(StreamTraceSP);
+        currentDevice->defineProperty(StreamSharedSP);
+        currentDevice->defineProperty(StreamSharedTP);
+        currentDevice->defineProperty(StreamBacklogNP);
     }
     else
     {
+        closeSharedFrames();
         currentDevice->deleteProperty(StreamSP.getName());
         currentDevice->deleteProperty(StreamTimeNP.getName());
         if (hasStreamingExposure)
             currentDevice->deleteProperty(StreamExposureNP.getName());
         currentDevice->deleteProperty(FpsNP.getName());
+        currentDevice->deleteProperty(StreamBufferNP.getName());
         currentDevice->deleteProperty(RecordFileTP.getName());
         currentDevice->deleteProperty(RecordStreamSP.getName());
         currentDevice->deleteProperty(RecordOptionsNP.getName());
         currentDevice->deleteProperty(StreamFrameNP.getName());
+        currentDevice->deleteProperty(StreamTrackSP.getName());
+        currentDevice->deleteProperty(StreamTrackNP.getName());
         currentDevice->deleteProperty(EncoderSP.getName());
         currentDevice->deleteProperty(RecorderSP.getName());
         currentDevice->deleteProperty(LimitsNP.getName());
+        currentDevice->deleteProperty(PreviewStretchSP.getName());
+        currentDevice->deleteProperty(StreamLatencyNP.getName());
+        currentDevice->deleteProperty(StreamTraceSP.getName());
+        currentDevice->deleteProperty(StreamSharedSP.getName());
+        currentDevice->deleteProperty(StreamSharedTP.getName());
+        currentDevice->deleteProperty(StreamBacklogNP.getName());
     }
 
+    for (auto &output : outputs)
+        output->updateProperties();
+
     return true;
 }
 
@@ -277,6 +409,63 @@ bool StreamManager::updateProperties()
  * Therefore nbytes is expected to be SubW/BinX * SubH/BinY * Bytes_Per_Pixels * Number_Color_Components
  * Binned frame must be sent from the camera driver for this to work consistentaly for all drivers.*/
 void StreamManagerPrivate::newFrame(const uint8_t * buffer, uint32_t nbytes, uint64_t timestamp)
+{
+    std::vector<uint8_t> frame;
+    queueFrame(frame, buffer, nbytes, timestamp);
+    releaseFrameBuffer(std::move(frame));
+}
+
+void StreamManagerPrivate::newFrame(std::vector<uint8_t> &&frame, uint64_t timestamp)
+{
+    queueFrame(frame, nullptr, frame.size(), timestamp);
+    releaseFrameBuffer(std::move(frame));
+}
+
+void StreamManagerPrivate::newFrame(const uint8_t * buffer, uint32_t nbytes, uint64_t timestamp,
+                                    std::function<void()> release)
+{
+    // Released once the last user lets go, right away if the frame is skipped
+    std::shared_ptr<const uint8_t> view(buffer, [release](const uint8_t *)
+    {
+        release();
+    });
+    std::vector<uint8_t> frame;
+    queueFrame(frame, nullptr, nbytes, timestamp, std::move(view));
+}
+
+std::vector<uint8_t> StreamManagerPrivate::acquireFrameBuffer(size_t nbytes)
+{
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(framePoolMutex);
+        // Frames usually keep their size, any buffer large enough will do
+        auto it = std::find_if(framePool.rbegin(), framePool.rend(), [nbytes](const std::vector<uint8_t> &frame)
+        {
+            return frame.capacity() >= nbytes;
+        });
+        if (it != framePool.rend())
+        {
+            buffer = std::move(*it);
+            framePool.erase(std::next(it).base());
+        }
+    }
+    buffer.resize(nbytes);
+    return buffer;
+}
+
+void StreamManagerPrivate::releaseFrameBuffer(std::vector<uint8_t> &&buffer)
+{
+    if (buffer.capacity() == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(framePoolMutex);
+    if (framePool.size() >= MAX_POOLED_FRAMES)
+        framePool.erase(framePool.begin());
+    framePool.push_back(std::move(buffer));
+}
+
+void StreamManagerPrivate::queueFrame(std::vector<uint8_t> &frame, const uint8_t * buffer, uint32_t nbytes,
+                                      uint64_t timestamp, std::shared_ptr<const uint8_t> view)
 {
     // close the data stream on the same thread as the data stream
     // manually triggered to stop recording.
@@ -306,26 +495,34 @@ void StreamManagerPrivate::newFrame(const uint8_t * buffer, uint32_t nbytes, uin
     if (FPSFast.newFrame())
     {
         FpsNP[0].setValue(FPSFast.framesPerSecond());
-        if (fastFPSUpdate.try_lock()) // don't block stream thread / record thread
-            std::thread([&]()
-        {
-            FpsNP.apply();
-            fastFPSUpdate.unlock();
-        }).detach();
     }
 
     if (isStreaming || (isRecording && !isRecordingAboutToClose))
     {
-        size_t allocatedSize = nbytes * framesIncoming.size() / 1024 / 1024; // allocated size in MB
+        size_t allocatedSize = queuedBytes / 1024 / 1024; // allocated size in MB
         if (allocatedSize > LimitsNP[LIMITS_BUFFER_MAX].getValue())
         {
             LOG_WARN("Frame buffer is full, skipping frame...");
             return;
         }
 
-        std::vector<uint8_t> copyBuffer(buffer, buffer + nbytes); // copy the frame
+        if (buffer != nullptr)
+        {
+            frame = acquireFrameBuffer(nbytes);
+            memcpy(frame.data(), buffer, nbytes); // copy the frame
+        }
 
-        framesIncoming.push(TimeFrame{FPSFast.deltaTime(), timestamp, std::move(copyBuffer)}); // push it into the queue
+        size_t frameSize = view ? nbytes : frame.size();
+        queuedBytes += frameSize;
+        TimeFrame timeFrame {FPSFast.deltaTime(), timestamp, std::move(frame), std::chrono::steady_clock::now(), std::move(view), nbytes};
+        if (framesIncoming.push(std::move(timeFrame)) == false) // push it into the queue
+        {
+            queuedBytes -= frameSize;
+            frame = std::move(timeFrame.frame);
+            LOG_WARN("Frame queue is full, skipping frame...");
+            return;
+        }
+        INDI_PROBE3(frame_enqueue, getDeviceName(), frameSize, timestamp);
     }
 
     if (isRecording && !isRecordingAboutToClose)
@@ -364,6 +561,173 @@ void StreamManager::newFrame(const uint8_t * buffer, uint32_t nbytes, uint64_t t
     d->newFrame(buffer, nbytes, timestamp);
 }
 
+void StreamManager::newFrame(const uint8_t * buffer, uint32_t nbytes, uint64_t timestamp,
+                             std::function<void()> release)
+{
+    D_PTR(StreamManager);
+    d->newFrame(buffer, nbytes, timestamp, std::move(release));
+}
+
+void StreamManager::newFrame(std::vector<uint8_t> &&frame, uint64_t timestamp)
+{
+    D_PTR(StreamManager);
+    d->newFrame(std::move(frame), timestamp);
+}
+
+uint64_t StreamManager::getTimestamp(const struct timeval &utc)
+{
+    // Seconds from Jan 1, 1 AD to the Unix epoch, the origin of SER timestamps
+    const uint64_t epochOffset = 62135596800ULL;
+    return (static_cast<uint64_t>(utc.tv_sec) + epochOffset) * 1000000ULL + utc.tv_usec;
+}
+
+std::vector<uint8_t> StreamManager::acquireFrameBuffer(uint32_t nbytes)
+{
+    D_PTR(StreamManager);
+    return d->acquireFrameBuffer(nbytes);
+}
+
+void StreamManagerPrivate::addOutput(const char *name)
+{
+    outputs.emplace_back(new StreamOutput(currentDevice, name));
+}
+
+void StreamManager::addOutput(const char *name)
+{
+    D_PTR(StreamManager);
+    d->addOutput(name);
+}
+
+
+void StreamManagerPrivate::publishTelemetry()
+{
+    if (!currentDevice->isConnected())
+        return;
+
+    // The frame and preview threads only set the values, send the ones that changed
+    if (FpsNP[FPS_INSTANT].getValue() != publishedFps[FPS_INSTANT] ||
+            FpsNP[FPS_AVERAGE].getValue() != publishedFps[FPS_AVERAGE])
+    {
+        publishedFps[FPS_INSTANT] = FpsNP[FPS_INSTANT].getValue();
+        publishedFps[FPS_AVERAGE] = FpsNP[FPS_AVERAGE].getValue();
+        FpsNP.apply();
+    }
+
+    if (StreamTimeNP[0].getValue() != publishedStreamTime)
+    {
+        publishedStreamTime = StreamTimeNP[0].getValue();
+        StreamTimeNP.apply();
+    }
+
+    double frames = framesIncoming.size();
+    double mb = queuedBytes / 1024.0 / 1024.0;
+    if (frames != publishedBuffer[BUFFER_FRAMES] || mb != publishedBuffer[BUFFER_MB])
+    {
+        publishedBuffer[BUFFER_FRAMES] = frames;
+        publishedBuffer[BUFFER_MB] = mb;
+        StreamBufferNP[BUFFER_FRAMES].setValue(frames);
+        StreamBufferNP[BUFFER_MB].setValue(mb);
+        StreamBufferNP.apply();
+    }
+
+    // Stream frame moved by the tracker
+    if (StreamFrameNP[CCDChip::FRAME_X].getValue() != publishedStreamFrame[0] ||
+            StreamFrameNP[CCDChip::FRAME_Y].getValue() != publishedStreamFrame[1])
+    {
+        publishedStreamFrame[0] = StreamFrameNP[CCDChip::FRAME_X].getValue();
+        publishedStreamFrame[1] = StreamFrameNP[CCDChip::FRAME_Y].getValue();
+        StreamFrameNP.apply();
+    }
+
+    bool latencyChanged = false;
+    for (int i = 0; i < STAGE_MAX; i++)
+    {
+        LatencyStats::Summary summary = stageLatency[i].summary();
+        latencyChanged |= summary.median != publishedLatency[2 * i] || summary.p99 != publishedLatency[2 * i + 1];
+        publishedLatency[2 * i    ] = summary.median;
+        publishedLatency[2 * i + 1] = summary.p99;
+    }
+    if (latencyChanged)
+    {
+        for (int i = 0; i < 2 * STAGE_MAX; i++)
+            StreamLatencyNP[i].setValue(publishedLatency[i]);
+        StreamLatencyNP.apply();
+    }
+
+    // Ring made again by the stream thread for larger frames, or closed
+    std::string sharedPath;
+    {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (sharedFrames != nullptr)
+            sharedPath = IDSharedFramesGetPath(sharedFrames);
+    }
+    if (sharedPath != publishedSharedPath)
+    {
+        publishedSharedPath = sharedPath;
+        StreamSharedTP[0].setText(sharedPath);
+        StreamSharedTP.setState(sharedPath.empty() ? IPS_IDLE : IPS_OK);
+        StreamSharedTP.apply();
+    }
+}
+
+void StreamManagerPrivate::shareFrame(const uint8_t *source, size_t size, const FrameInfo &srcFrameInfo,
+                                      bool subframed, uint64_t timestamp)
+{
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (!isSharing)
+        return;
+
+    // Sources may be larger than their frame, JPEG frames are shared whole
+    const FrameInfo &frameInfo = subframed ? dstFrameInfo : srcFrameInfo;
+    if (PixelFormat != INDI_JPG)
+        size = frameInfo.totalSize();
+
+    if (sharedFrames == nullptr || size > IDSharedFramesGetSlotSize(sharedFrames))
+    {
+        // Readers see the old ring closed, and find the new one in STREAM_SHARED_PATH
+        IDSharedFramesFree(sharedFrames);
+        sharedFrames = IDSharedFramesCreate(SHARED_FRAMES_SLOTS, size);
+        if (sharedFrames == nullptr)
+        {
+            LOGF_ERROR("Failed to share frames in memory: %s", strerror(errno));
+            isSharing = false;
+            return;
+        }
+    }
+
+    // A subframe is cut out of the source straight into the ring
+    uint8_t *slot = static_cast<uint8_t *>(IDSharedFramesBegin(sharedFrames, size));
+    if (subframed)
+        subframe(source, srcFrameInfo, slot, dstFrameInfo);
+    else
+        memcpy(slot, source, size);
+
+    shared_frame_info info {};
+    info.timestamp = timestamp;
+    info.width = frameInfo.w;
+    info.height = frameInfo.h;
+    info.format = PixelFormat;
+    info.depth = PixelDepth;
+    IDSharedFramesCommit(sharedFrames, &info);
+}
+
+void StreamManagerPrivate::closeSharedFrames()
+{
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    IDSharedFramesFree(sharedFrames);
+    sharedFrames = nullptr;
+}
+
+void StreamManagerPrivate::writeTrace(uint64_t timestamp, double queueMs, double processMs, double recordMs,
+                                      bool previewed)
+{
+    std::lock_guard<std::mutex> lock(recordMutex);
+    if (traceFile == nullptr || !isRecording)
+        return;
+
+    fprintf(traceFile, "%llu,%llu,%.3f,%.3f,%.3f,%d\n", static_cast<unsigned long long>(traceFrames++),
+            static_cast<unsigned long long>(timestamp), queueMs, processMs, recordMs, previewed ? 1 : 0);
+}
 
 StreamManagerPrivate::FrameInfo StreamManagerPrivate::updateSourceFrameInfo()
 {
@@ -414,15 +778,7 @@ void StreamManagerPrivate::subframe(
     uint32_t srcStride = srcFrameInfo.lineSize();
     uint32_t dstStride = dstFrameInfo.lineSize();
 
-    srcBuffer += srcOffset;
-
-    // Copy line-by-line
-    for (size_t i = 0; i < dstFrameInfo.h; ++i)
-    {
-        memcpy(dstBuffer, srcBuffer, dstStride);
-        dstBuffer += dstStride;
-        srcBuffer += srcStride;
-    }
+    Pixel::copyRows(srcBuffer + srcOffset, srcStride, dstBuffer, dstStride, dstStride, dstFrameInfo.h);
 }
 
 void StreamManagerPrivate::asyncStreamThread()
@@ -430,90 +786,283 @@ void StreamManagerPrivate::asyncStreamThread()
     TimeFrame sourceTimeFrame;
     sourceTimeFrame.time = 0;
 
-    std::vector<uint8_t> subframeBuffer;  // Subframe buffer for recording/streaming
-    std::vector<uint8_t> downscaleBuffer; // Downscale buffer for streaming
-
     INDI::SingleThreadPool previewThreadPool;
     INDI::ElapsedTimer previewElapsed;
+    // Time spent subframing, downscaling and recording
+    INDI::ElapsedTimer stageElapsed, downscaleElapsed;
+    int stretchFrames = 0;
 
     while(!framesThreadTerminate)
     {
         if (framesIncoming.pop(sourceTimeFrame) == false)
             continue;
 
-        FrameInfo srcFrameInfo = updateSourceFrameInfo();
+        std::vector<uint8_t> &sourceBuffer = sourceTimeFrame.frame;
+
+        // Frames lent by the driver are read in place
+        const uint8_t *sourceData = sourceTimeFrame.view ? sourceTimeFrame.view.get() : sourceBuffer.data();
+        size_t sourceSize = sourceTimeFrame.view ? sourceTimeFrame.viewSize : sourceBuffer.size();
 
-        std::vector<uint8_t> *sourceBuffer = &sourceTimeFrame.frame;
+        queuedBytes -= sourceSize;
+
+        double queueMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                         sourceTimeFrame.queued).count();
+        stageLatency[STAGE_QUEUE].add(queueMs);
+        INDI_PROBE3(frame_dequeue, getDeviceName(), sourceSize, static_cast<uint64_t>(queueMs * 1000));
+
+        FrameInfo srcFrameInfo = updateSourceFrameInfo();
 
         // Source buffer size may be equal or larger than frame info size
         // as some driver still retain full unbinned window size even when binning the output
         // frame
-        if (PixelFormat != INDI_JPG && sourceBuffer->size() < srcFrameInfo.totalSize())
+        if (PixelFormat != INDI_JPG && sourceSize < srcFrameInfo.totalSize())
         {
-            LOGF_ERROR("Source buffer size %d is less than frame size %d, skipping frame...", sourceBuffer->size(),
+            LOGF_ERROR("Source buffer size %d is less than frame size %d, skipping frame...", sourceSize,
                        srcFrameInfo.totalSize());
+            releaseFrameBuffer(std::move(sourceBuffer));
+            sourceTimeFrame.view.reset();
             continue;
         }
 
-        // Check if we need to subframe
-        if (
-            PixelFormat != INDI_JPG &&
-            dstFrameInfo.pixels() != 0 &&
-            dstFrameInfo != srcFrameInfo
-        )
-        {
-            subframeBuffer.resize(dstFrameInfo.totalSize());
-            subframe(sourceBuffer->data(), srcFrameInfo, subframeBuffer.data(), dstFrameInfo);
+        // Follow the blob before the frame is cut out of the source
+        if (trackMode != TRACK_OFF && PixelFormat != INDI_JPG)
+            trackBlob(sourceData, srcFrameInfo);
 
-            sourceBuffer = &subframeBuffer;
-        }
+        // Check if we need to subframe. The subframe is only copied out of the source for consumers that need it contiguous.
+        bool subframed = PixelFormat != INDI_JPG && dstFrameInfo.pixels() != 0 && dstFrameInfo != srcFrameInfo;
+        std::vector<uint8_t> subframeBuffer;
+        double processMs = 0;
+        auto contiguousFrame = [&]() -> FrameView
+        {
+            if (!subframed)
+                return FrameView{sourceData, sourceSize};
+            if (subframeBuffer.empty())
+            {
+                stageElapsed.start();
+                subframeBuffer = acquireFrameBuffer(dstFrameInfo.totalSize());
+                subframe(sourceData, srcFrameInfo, subframeBuffer.data(), dstFrameInfo);
+                processMs += stageElapsed.nsecsElapsed() / 1000000.0;
+            }
+            return FrameView{subframeBuffer.data(), subframeBuffer.size()};
+        };
 
         // For recording, save immediately.
+        bool recorded = false;
+        double recordMs = 0;
         {
             std::lock_guard<std::mutex> lock(recordMutex);
-            if (
-                isRecording && !isRecordingAboutToClose &&
-                recordStream(sourceBuffer->data(), sourceBuffer->size(), sourceTimeFrame.time, sourceTimeFrame.timestamp) == false
-            )
+            if (isRecording && !isRecordingAboutToClose)
             {
-                LOG_ERROR("Recording failed.");
-                isRecordingAboutToClose = true;
+                FrameView frame = contiguousFrame();
+                stageElapsed.start();
+                if (recordStream(frame.data, frame.size, sourceTimeFrame.time, sourceTimeFrame.timestamp) == false)
+                {
+                    LOG_ERROR("Recording failed.");
+                    isRecordingAboutToClose = true;
+                }
+                recordMs = stageElapsed.nsecsElapsed() / 1000000.0;
+                stageLatency[STAGE_RECORD].add(recordMs);
+                recorded = true;
             }
         }
 
+        // Local readers get every frame, whatever the preview rate
+        if (isSharing && isStreaming)
+        {
+            if (!subframeBuffer.empty())
+                shareFrame(subframeBuffer.data(), subframeBuffer.size(), dstFrameInfo, false, sourceTimeFrame.timestamp);
+            else
+                shareFrame(sourceData, sourceSize, srcFrameInfo, subframed, sourceTimeFrame.timestamp);
+        }
+
         // For streaming, downscale to 8bit if higher than 8bit to reduce bandwidth
         // You can reduce the number of frames by setting a frame limit.
-        if (isStreaming && FPSPreview.newFrame())
+        bool previewDue = isStreaming && FPSPreview.newFrame();
+
+        std::vector<StreamOutput *> dueOutputs;
+        if (isStreaming && PixelFormat != INDI_JPG)
+            for (auto &output : outputs)
+                if (output->isDue())
+                    dueOutputs.push_back(output.get());
+
+        // The 8 bit frame is computed once for the preview and every output
+        std::vector<uint8_t> downscaleBuffer;
+        auto downscaledFrame = [&]() -> FrameView
         {
             // Downscale to 8bit always for streaming to reduce bandwidth
-            if (PixelFormat != INDI_JPG && PixelDepth > 8)
+            if (PixelFormat == INDI_JPG || PixelDepth <= 8)
+                return contiguousFrame();
+            if (!downscaleBuffer.empty())
+                return FrameView{downscaleBuffer.data(), downscaleBuffer.size()};
+
+            downscaleBuffer = acquireFrameBuffer(dstFrameInfo.pixels());
+
+            // Apply gamma, reading mono subframes in place
+            bool inPlace = subframed && subframeBuffer.empty() && srcFrameInfo.bytesPerColor == 2;
+            const uint8_t *source = inPlace ? sourceData + srcFrameInfo.bytesPerColor *
+                                    (dstFrameInfo.y * srcFrameInfo.w + dstFrameInfo.x) : contiguousFrame().data;
+            downscaleElapsed.start();
+
+            if (!isAutoStretch)
+            {
+                if (stretchFrames != 0)
+                    gammaLut16.resetLevels();
+                stretchFrames = 0;
+            }
+            else if (stretchFrames++ % STRETCH_INTERVAL_FRAMES == 0)
             {
-                // Allocale new buffer if size changes
-                downscaleBuffer.resize(dstFrameInfo.pixels());
+                gammaLut16.autoLevels(reinterpret_cast<const uint16_t*>(source), dstFrameInfo.w, dstFrameInfo.h,
+                                      inPlace ? srcFrameInfo.w : dstFrameInfo.w);
+            }
+
+            gammaLut16.apply(reinterpret_cast<const uint16_t*>(source), dstFrameInfo.w, dstFrameInfo.h,
+                             inPlace ? srcFrameInfo.w : dstFrameInfo.w, downscaleBuffer.data());
+            processMs += downscaleElapsed.nsecsElapsed() / 1000000.0;
+            return FrameView{downscaleBuffer.data(), downscaleBuffer.size()};
+        };
 
-                // Apply gamma
-                gammaLut16.apply(
-                    reinterpret_cast<const uint16_t*>(sourceBuffer->data()),
-                    downscaleBuffer.size(),
-                    downscaleBuffer.data()
-                );
+        uint32_t components = (PixelFormat == INDI_RGB) ? 3 : 1;
+        for (auto output : dueOutputs)
+        {
+            if (output->wantsFullDepth())
+                output->send(contiguousFrame().data, dstFrameInfo.w, dstFrameInfo.h, components, PixelDepth);
+            else
+                output->send(downscaledFrame().data, dstFrameInfo.w, dstFrameInfo.h, components, 8);
+        }
 
-                sourceBuffer = &downscaleBuffer;
+        if (previewDue)
+        {
+            // Take over whichever buffer holds the 8 bit frame, a lent frame is copied to be given back early
+            FrameView preview = downscaledFrame();
+            std::vector<uint8_t> previewBuffer;
+            if (!downscaleBuffer.empty())
+                previewBuffer = std::move(downscaleBuffer);
+            else if (!subframeBuffer.empty())
+                previewBuffer = std::move(subframeBuffer);
+            else if (!sourceTimeFrame.view)
+                previewBuffer = std::move(sourceBuffer);
+            else
+            {
+                previewBuffer = acquireFrameBuffer(preview.size);
+                memcpy(previewBuffer.data(), preview.data, preview.size);
             }
 
-            //uploadStream(sourceBuffer->data(), sourceBuffer->size());
-            previewThreadPool.start(std::bind([this, &previewElapsed](const std::atomic_bool & isAboutToQuit,
-                                              std::vector<uint8_t> frame)
+            // Shared so that handing the task to the pool does not copy the frame
+            auto frame = std::make_shared<std::vector<uint8_t>>(std::move(previewBuffer));
+            previewThreadPool.start([this, &previewElapsed, frame](const std::atomic_bool & isAboutToQuit)
             {
                 INDI_UNUSED(isAboutToQuit);
                 previewElapsed.start();
-                uploadStream(frame.data(), frame.size());
+                uploadStream(frame->data(), frame->size());
                 StreamTimeNP[0].setValue(previewElapsed.nsecsElapsed() / 1000000000.0);
-                StreamTimeNP.apply();
-
-            }, std::placeholders::_1, std::move(*sourceBuffer)));
+                releaseFrameBuffer(std::move(*frame));
+            });
         }
+
+        if (!subframeBuffer.empty() || !downscaleBuffer.empty() || previewDue)
+            stageLatency[STAGE_PROCESS].add(processMs);
+
+        if (recorded)
+            writeTrace(sourceTimeFrame.timestamp, queueMs, processMs, recordMs, previewDue);
+
+        releaseFrameBuffer(std::move(downscaleBuffer));
+        releaseFrameBuffer(std::move(subframeBuffer));
+        releaseFrameBuffer(std::move(sourceBuffer));
+        // Give the lent frame back to the driver
+        sourceTimeFrame.view.reset();
+    }
+}
+
+void StreamManagerPrivate::trackBlob(const uint8_t *frame, const FrameInfo &srcFrameInfo)
+{
+    std::lock_guard<std::mutex> lock(trackMutex);
+    int depth = PixelDepth > 8 ? 16 : 8;
+
+    if (trackMode == TRACK_STREAM)
+    {
+        if (!roiTracker.isDue())
+            return;
+
+        RoiTracker::Region window { dstFrameInfo.x, dstFrameInfo.y, dstFrameInfo.w, dstFrameInfo.h };
+        double x, y;
+        if (!RoiTracker::locate(frame, srcFrameInfo.w, srcFrameInfo.h, srcFrameInfo.bytesPerColor, depth,
+                                RoiTracker::searchRegion(window, srcFrameInfo.w, srcFrameInfo.h), x, y) ||
+                !roiTracker.follow(x, y, window, srcFrameInfo.w, srcFrameInfo.h))
+            return;
+
+        // Published from the main loop
+        dstFrameInfo.x = window.x;
+        dstFrameInfo.y = window.y;
+        StreamFrameNP[CCDChip::FRAME_X].setValue(window.x);
+        StreamFrameNP[CCDChip::FRAME_Y].setValue(window.y);
+        return;
+    }
+
+    // A stream frame spanning the whole camera frame goes with it
+    if (dstFrameInfo.w == srcFrameInfo.w && dstFrameInfo.h == srcFrameInfo.h)
+    {
+        dstFrameInfo.x = srcFrameInfo.x;
+        dstFrameInfo.y = srcFrameInfo.y;
+    }
+
+    // Frames read before the camera frame moved would move it again
+    if (trackCameraMoving)
+    {
+        if (srcFrameInfo.x == trackCameraFrom.x && srcFrameInfo.y == trackCameraFrom.y &&
+                ++trackCameraWaited < TRACK_SETTLE_FRAMES)
+            return;
+        trackCameraMoving = false;
+        roiTracker.reset();
     }
+
+    if (!roiTracker.isDue())
+        return;
+
+    const CCDChip &chip = dynamic_cast<const INDI::CCD*>(currentDevice)->PrimaryCCD;
+    RoiTracker::Region window { srcFrameInfo.x, srcFrameInfo.y, srcFrameInfo.w, srcFrameInfo.h };
+    double x, y;
+    if (!RoiTracker::locate(frame, srcFrameInfo.w, srcFrameInfo.h, srcFrameInfo.bytesPerColor, depth,
+                            RoiTracker::Region{0, 0, srcFrameInfo.w, srcFrameInfo.h}, x, y) ||
+            !roiTracker.follow(srcFrameInfo.x + x, srcFrameInfo.y + y, window,
+                               chip.getXRes() / chip.getBinX(), chip.getYRes() / chip.getBinY()))
+        return;
+
+    trackCameraFrom = RoiTracker::Region { srcFrameInfo.x, srcFrameInfo.y, srcFrameInfo.w, srcFrameInfo.h };
+    trackCameraFrame = window;
+    trackCameraPending = true;
+    trackCameraMoving = true;
+    trackCameraWaited = 0;
+}
+
+void StreamManagerPrivate::moveCameraFrame()
+{
+    RoiTracker::Region frame;
+    {
+        std::lock_guard<std::mutex> lock(trackMutex);
+        if (!trackCameraPending)
+            return;
+        trackCameraPending = false;
+        frame = trackCameraFrame;
+    }
+
+    auto ccd = dynamic_cast<INDI::CCD*>(currentDevice);
+    CCDChip &chip = ccd->PrimaryCCD;
+    int binX = chip.getBinX(), binY = chip.getBinY();
+    // The driver sets the frame it could set
+    if (ccd->UpdateCCDFrame(frame.x * binX, frame.y * binY, frame.w * binX, frame.h * binY))
+        return;
+
+    LOG_WARN("Camera frame cannot be moved, tracking the stream frame instead.");
+    {
+        std::lock_guard<std::mutex> lock(trackMutex);
+        trackCameraMoving = false;
+        roiTracker.reset();
+    }
+    trackMode = TRACK_STREAM;
+    StreamTrackSP.reset();
+    StreamTrackSP[TRACK_STREAM].setState(ISS_ON);
+    StreamTrackSP.setState(IPS_ALERT);
+    StreamTrackSP.apply();
 }
 
 void StreamManagerPrivate::setSize(uint16_t width, uint16_t height)
@@ -585,6 +1134,9 @@ bool StreamManagerPrivate::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t
         LOGF_DEBUG("Pixel format %d is supported by %s encoder.", pixelFormat, encoder->getName());
     }
 
+    for (auto &output : outputs)
+        output->setPixelFormat(pixelFormat);
+
     PixelFormat = pixelFormat;
     PixelDepth  = pixelDepth;
     return true;
@@ -660,6 +1212,14 @@ bool StreamManagerPrivate::startRecording()
 
     recorder->setFPS(FpsNP[FPS_AVERAGE].getValue());
 
+    // Lets the recorder preallocate the file
+    if (RecordStreamSP[RECORD_FRAME].getState() == ISS_ON)
+        recorder->setExpectedFrames(RecordOptionsNP[1].getValue());
+    else if (RecordStreamSP[RECORD_TIME].getState() == ISS_ON)
+        recorder->setExpectedFrames(RecordOptionsNP[0].getValue() * FpsNP[FPS_AVERAGE].getValue());
+    else
+        recorder->setExpectedFrames(0);
+
     /* pattern substitution */
     recordfiledir.assign(RecordFileTP[0].getText());
     expfiledir = expand(recordfiledir, patterns);
@@ -707,6 +1267,21 @@ bool StreamManagerPrivate::startRecording()
             recorder->setDefaultColor();
     }
 #endif
+    if (StreamTraceSP[TRACE_ON].getState() == ISS_ON)
+    {
+        std::string tracename = filename.substr(0, filename.size() - strlen(recorder->getExtension())) + ".trace.csv";
+        std::lock_guard<std::mutex> lock(recordMutex);
+        traceFile = fopen(tracename.c_str(), "w");
+        traceFrames = 0;
+        if (traceFile == nullptr)
+            LOGF_WARN("Can not open trace file %s: %s", tracename.c_str(), strerror(errno));
+        else
+            fprintf(traceFile, "frame,timestamp,queue_ms,process_ms,record_ms,preview\n");
+    }
+
+    for (auto &stage : stageLatency)
+        stage.reset();
+
     FPSRecorder.reset();
     frameCountDivider = 0;
 
@@ -765,6 +1340,11 @@ bool StreamManagerPrivate::stopRecording(bool force)
     {
         std::lock_guard<std::mutex> lock(recordMutex);
         recorder->close();
+        if (traceFile != nullptr)
+        {
+            fclose(traceFile);
+            traceFile = nullptr;
+        }
     }
 
     if (force)
@@ -776,6 +1356,9 @@ bool StreamManagerPrivate::stopRecording(bool force)
         FPSRecorder.totalFrames()
     );
 
+    if (recorder->getDroppedFrames() > 0)
+        LOGF_WARN("Storage did not keep up, %u frames were dropped.", recorder->getDroppedFrames());
+
     return true;
 }
 
@@ -874,6 +1457,7 @@ bool StreamManagerPrivate::ISNewSwitch(const char * dev, const char * name, ISSt
             {
                 encoderManager.setEncoder(oneEncoder);
 
+                oneEncoder->init(currentDevice);
                 oneEncoder->setPixelFormat(PixelFormat, PixelDepth);
 
                 encoder = oneEncoder;
@@ -910,6 +1494,67 @@ bool StreamManagerPrivate::ISNewSwitch(const char * dev, const char * name, ISSt
         return true;
     }
 
+    for (auto &output : outputs)
+        if (output->ISNewSwitch(name, states, names, n))
+            return true;
+
+    // Preview Stretch
+    if (PreviewStretchSP.isNameMatch(name))
+    {
+        PreviewStretchSP.update(states, names, n);
+        isAutoStretch = PreviewStretchSP[STRETCH_AUTO].getState() == ISS_ON;
+        PreviewStretchSP.setState(IPS_OK);
+        PreviewStretchSP.apply();
+        return true;
+    }
+
+    // Stream Tracking
+    if (StreamTrackSP.isNameMatch(name))
+    {
+        StreamTrackSP.update(states, names, n);
+        StreamTrackSP.setState(IPS_OK);
+
+        int mode = StreamTrackSP.findOnSwitchIndex();
+        auto ccd = dynamic_cast<INDI::CCD*>(currentDevice);
+        if (mode == TRACK_CAMERA && (ccd == nullptr || !ccd->CanSubFrame()))
+        {
+            LOG_WARN("Camera frame cannot be moved, tracking the stream frame instead.");
+            StreamTrackSP.reset();
+            StreamTrackSP[TRACK_STREAM].setState(ISS_ON);
+            mode = TRACK_STREAM;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(trackMutex);
+            roiTracker.reset();
+            trackCameraPending = trackCameraMoving = false;
+        }
+        trackMode = mode < 0 ? TRACK_OFF : mode;
+        StreamTrackSP.apply();
+        return true;
+    }
+
+    // Record Trace, taken into account by the next recording
+    if (StreamTraceSP.isNameMatch(name))
+    {
+        StreamTraceSP.update(states, names, n);
+        StreamTraceSP.setState(IPS_OK);
+        StreamTraceSP.apply();
+        return true;
+    }
+
+    // Shared frames, the ring is made with the first frame and its path published then
+    if (StreamSharedSP.isNameMatch(name))
+    {
+        StreamSharedSP.update(states, names, n);
+        isSharing = StreamSharedSP[SHARED_ON].getState() == ISS_ON;
+        if (!isSharing)
+            closeSharedFrames();
+        StreamSharedSP.setState(isSharing ? IPS_OK : IPS_IDLE);
+        StreamSharedSP.apply();
+        return true;
+    }
+
     // No properties were processed
     return false;
 }
@@ -956,6 +1601,10 @@ bool StreamManagerPrivate::ISNewNumber(const char * dev, const char * name, doub
     if (dev != nullptr && strcmp(getDeviceName(), dev))
         return false;
 
+    for (auto &output : outputs)
+        if (output->ISNewNumber(name, values, names, n))
+            return true;
+
     if (StreamExposureNP.isNameMatch(name))
     {
         StreamExposureNP.update(values, names, n);
@@ -969,7 +1618,7 @@ bool StreamManagerPrivate::ISNewNumber(const char * dev, const char * name, doub
     {
         LimitsNP.update(values, names, n);
 
-        FPSPreview.setTimeWindow(1000.0 / LimitsNP[LIMITS_PREVIEW_FPS].getValue());
+        FPSPreview.setTimeWindow(previewInterval());
         FPSPreview.reset();
 
         LimitsNP.setState(IPS_OK);
@@ -977,6 +1626,23 @@ bool StreamManagerPrivate::ISNewNumber(const char * dev, const char * name, doub
         return true;
     }
 
+    /* Backlog of the clients */
+    if (StreamBacklogNP.isNameMatch(name))
+    {
+        StreamBacklogNP.update(values, names, n);
+        double backlog = std::max(0.0, std::min(1.0, StreamBacklogNP[0].getValue()));
+        bool changed = backlog != streamBacklog;
+        streamBacklog = backlog;
+        FPSPreview.setTimeWindow(previewInterval());
+        if (changed)
+            LOGF_DEBUG("Clients are %.0f%% of the way to frames being dropped, preview at %.1f FPS",
+                       backlog * 100, 1000.0 / previewInterval());
+
+        StreamBacklogNP.setState(backlog == 0 ? IPS_OK : backlog < 1 ? IPS_BUSY : IPS_ALERT);
+        StreamBacklogNP.apply();
+        return true;
+    }
+
     /* Record Options */
     if (RecordOptionsNP.isNameMatch(name))
     {
@@ -992,6 +1658,20 @@ bool StreamManagerPrivate::ISNewNumber(const char * dev, const char * name, doub
         return true;
     }
 
+    /* Stream Tracking Settings */
+    if (StreamTrackNP.isNameMatch(name))
+    {
+        StreamTrackNP.update(values, names, n);
+        {
+            std::lock_guard<std::mutex> lock(trackMutex);
+            roiTracker.setInterval(StreamTrackNP[TRACK_INTERVAL].getValue());
+            roiTracker.setDeadband(StreamTrackNP[TRACK_DEADBAND].getValue());
+        }
+        StreamTrackNP.setState(IPS_OK);
+        StreamTrackNP.apply();
+        return true;
+    }
+
     /* Stream Frame */
     if (StreamFrameNP.isNameMatch(name))
     {
@@ -1058,7 +1738,9 @@ bool StreamManagerPrivate::setStream(bool enable)
             FPSAverage.reset();
             FPSFast.reset();
             FPSPreview.reset();
-            FPSPreview.setTimeWindow(1000.0 / LimitsNP[LIMITS_PREVIEW_FPS].getValue());
+            FPSPreview.setTimeWindow(previewInterval());
+            for (auto &stage : stageLatency)
+                stage.reset();
             frameCountDivider = 0;
 
             if(currentDevice->getDriverInterface() & INDI::DefaultDevice::CCD_INTERFACE)
@@ -1155,6 +1837,12 @@ bool StreamManager::saveConfigItems(FILE * fp)
     d->RecordOptionsNP.save(fp);
     d->RecorderSP.save(fp);
     d->LimitsNP.save(fp);
+    d->PreviewStretchSP.save(fp);
+    d->StreamTraceSP.save(fp);
+    d->StreamSharedSP.save(fp);
+    d->StreamTrackNP.save(fp);
+    for (auto &output : d->outputs)
+        output->saveConfigItems(fp);
     return true;
 }
 
@@ -1185,8 +1873,16 @@ void StreamManager::getStreamFrame(uint16_t * x, uint16_t * y, uint16_t * w, uin
     d->getStreamFrame(x, y, w, h);
 }
 
+double StreamManagerPrivate::previewInterval() const
+{
+    // Down to a quarter of the preview rate when frames are dropped
+    return 1000.0 * (1 + 3 * streamBacklog) / LimitsNP[LIMITS_PREVIEW_FPS].getValue();
+}
+
 bool StreamManagerPrivate::uploadStream(const uint8_t * buffer, uint32_t nbytes)
 {
+    INDI::ElapsedTimer elapsed;
+
     // Send as is, already encoded.
     if (PixelFormat == INDI_JPG)
     {
@@ -1196,6 +1892,7 @@ bool StreamManagerPrivate::uploadStream(const uint8_t * buffer, uint32_t nbytes)
         imageBP[0].setFormat(".stream_jpg");
         imageBP.setState(IPS_OK);
         imageBP.apply();
+        stageLatency[STAGE_UPLOAD].add(elapsed.nsecsElapsed() / 1000000.0);
         return true;
     }
 
@@ -1209,24 +1906,38 @@ bool StreamManagerPrivate::uploadStream(const uint8_t * buffer, uint32_t nbytes)
     }
 #endif
 
+    // Smaller frames in a lower quality while the clients fall behind
+    double backlog = streamBacklog;
+    encoder->setQuality(std::lround(85 - (85 - BACKLOG_WORST_QUALITY) * backlog));
+    encoder->setDownscale(backlog >= 0.5 ? 2 : 1);
+
     if(currentDevice->getDriverInterface() & INDI::DefaultDevice::CCD_INTERFACE)
     {
-        if (encoder->upload(&imageBP[0], buffer, nbytes, dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.isCompressed()))
+        bool encoded = encoder->upload(&imageBP[0], buffer, nbytes,
+                                       dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.isCompressed());
+        stageLatency[STAGE_ENCODE].add(elapsed.nsecsElapsed() / 1000000.0);
+        if (encoded)
         {
             // Upload to client now
+            elapsed.start();
             imageBP.setState(IPS_OK);
             imageBP.apply();
+            stageLatency[STAGE_UPLOAD].add(elapsed.nsecsElapsed() / 1000000.0);
             return true;
         }
     }
     else if(currentDevice->getDriverInterface() & INDI::DefaultDevice::SENSOR_INTERFACE)
     {
-        if (encoder->upload(&imageBP[0], buffer, nbytes,
-                            false))//dynamic_cast<INDI::SensorInterface*>(currentDevice)->isCompressed()))
+        bool encoded = encoder->upload(&imageBP[0], buffer, nbytes,
+                                       false);//dynamic_cast<INDI::SensorInterface*>(currentDevice)->isCompressed()))
+        stageLatency[STAGE_ENCODE].add(elapsed.nsecsElapsed() / 1000000.0);
+        if (encoded)
         {
             // Upload to client now
+            elapsed.start();
             imageBP.setState(IPS_OK);
             imageBP.apply();
+            stageLatency[STAGE_UPLOAD].add(elapsed.nsecsElapsed() / 1000000.0);
             return true;
         }
     }
@@ -27,7 +27,10 @@
 #include "indibasetypes.h"
 #include "indimacros.h"
 #include <cstdint>
+#include <functional>
+#include <sys/time.h>
 #include <memory>
+#include <vector>
 
 /**
  * \class StreamManager
@@ -115,9 +118,39 @@ class StreamManager
     public:
         /**
          * @brief newFrame CCD drivers call this function when a new frame is received. It is then streamed, or recorded, or both according to the settings in the streamer.
+         * @param timestamp UTC time the frame was captured, in microseconds from Jan 1, 1 AD (see getTimestamp()),
+         * 0 for the time it is recorded.
+         * @note Frames are queued without locking, call newFrame from one thread at a time.
          */
         void newFrame(const uint8_t *buffer, uint32_t nbytes, uint64_t timestamp = 0);
 
+        /**
+         * @brief newFrame Same as above, without copying the frame. The streamer takes frame over, usually a buffer
+         * from acquireFrameBuffer() the driver read the frame into.
+         */
+        void newFrame(std::vector<uint8_t> &&frame, uint64_t timestamp = 0);
+
+        /**
+         * @brief newFrame Same as above, for a frame the driver lends rather than copies, e.g. a mapped V4L2 buffer.
+         * @param release called, possibly from another thread, once the streamer does not use buffer anymore,
+         * right away if the frame is skipped. The buffer must stay valid until then.
+         */
+        void newFrame(const uint8_t *buffer, uint32_t nbytes, uint64_t timestamp, std::function<void()> release);
+
+        /**
+         * @brief acquireFrameBuffer Get a buffer of nbytes from the pool of buffers the streamer recycles, for the
+         * driver to read a frame into before passing it to newFrame(). Its content is undefined.
+         */
+        std::vector<uint8_t> acquireFrameBuffer(uint32_t nbytes);
+
+        /**
+         * @brief addOutput Add a named stream output next to the preview, with its own region, scale, bit depth,
+         * encoder, rate and STREAM_<name> BLOB property. A REMOTE output is always there.
+         * @param name output name, upper case.
+         * @note Call it before initProperties().
+         */
+        void addOutput(const char *name);
+
         bool close();
 
     public:
@@ -142,6 +175,12 @@ class StreamManager
         bool isRecording() const;
         bool isBusy() const;
 
+    public:
+        /**
+         * @brief getTimestamp Frame timestamp of a UTC time, as newFrame() takes it.
+         */
+        static uint64_t getTimestamp(const struct timeval &utc);
+
     public:
         double getTargetFPS() const;
         double getTargetExposure() const;
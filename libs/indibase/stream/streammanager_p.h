@@ -27,13 +27,23 @@
 #include "recorder/recordermanager.h"
 #include "encoder/encodermanager.h"
 #include "fpsmeter.h"
-#include "uniquequeue.h"
+#include "latencystats.h"
+#include "roitracker.h"
+#include "spscring.h"
 #include "gammalut16.h"
+#include "inditimer.h"
+#include "streamoutput.h"
+#include "sharedframes.h"
 
 #include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
 #include <string>
 #include <map>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "indiccdchip.h"
 #include "indisensorinterface.h"
@@ -111,6 +121,17 @@ class StreamManagerPrivate
         bool ISNewNumber(const char * dev, const char * name, double values[], char * names[], int n);
 
         void newFrame(const uint8_t * buffer, uint32_t nbytes, uint64_t timestamp);
+        void newFrame(std::vector<uint8_t> &&frame, uint64_t timestamp);
+        void newFrame(const uint8_t * buffer, uint32_t nbytes, uint64_t timestamp, std::function<void()> release);
+
+        // Queue frame, or a pooled copy of buffer if not null, or view of nbytes if set.
+        // frame is left alone when the frame is skipped.
+        void queueFrame(std::vector<uint8_t> &frame, const uint8_t * buffer, uint32_t nbytes, uint64_t timestamp,
+                        std::shared_ptr<const uint8_t> view = nullptr);
+
+        // Frame buffers are recycled rather than allocated for every frame
+        std::vector<uint8_t> acquireFrameBuffer(size_t nbytes);
+        void releaseFrameBuffer(std::vector<uint8_t> &&buffer);
 
         bool updateProperties();
         bool setStream(bool enable);
@@ -195,18 +216,40 @@ class StreamManagerPrivate
         INDI::PropertyNumber FpsNP {2};
         enum { FPS_INSTANT, FPS_AVERAGE };
 
+        /* Frames waiting for the stream thread */
+        INDI::PropertyNumber StreamBufferNP {2};
+        enum { BUFFER_FRAMES, BUFFER_MB };
+
         /* Record Options */
         INDI::PropertyNumber RecordOptionsNP {2};
 
         // Stream Frame
         INDI::PropertyNumber StreamFrameNP {4};
 
+        // Stream frame kept centered on the brightest blob, by moving the stream frame or the camera frame
+        INDI::PropertySwitch StreamTrackSP {3};
+        enum { TRACK_OFF, TRACK_STREAM, TRACK_CAMERA };
+        INDI::PropertyNumber StreamTrackNP {2};
+        enum { TRACK_INTERVAL, TRACK_DEADBAND };
+        std::atomic<int> trackMode { TRACK_OFF };
+        void trackBlob(const uint8_t *frame, const FrameInfo &srcFrameInfo);
+
+        // The tracker and the camera frame the stream thread asks for, set on the main loop
+        std::mutex trackMutex;
+        RoiTracker roiTracker;
+        RoiTracker::Region trackCameraFrame, trackCameraFrom;
+        bool trackCameraPending = false;
+        bool trackCameraMoving = false;
+        uint32_t trackCameraWaited = 0;
+        void moveCameraFrame();
+        double publishedStreamFrame[2] {0, 0};
+
         /* BLOBs */
         INDI::PropertyBlob imageBP{INDI::Property()};
 
         // Encoder Selector. It's static now but should this implemented as plugin interface?
         INDI::PropertySwitch EncoderSP {2};
-        enum { ENCODER_RAW, ENCODER_MJPEG };
+        enum { ENCODER_RAW, ENCODER_MJPEG, ENCODER_MAX };
 
         // Recorder Selector. Static but should be implemented as a dynamic plugin interface
         INDI::PropertySwitch RecorderSP {2};
@@ -216,6 +259,48 @@ class StreamManagerPrivate
         INDI::PropertyNumber LimitsNP {2};
         enum { LIMITS_BUFFER_MAX, LIMITS_PREVIEW_FPS };
 
+        // Streams next to the preview, each with its own region, scale, encoder and rate
+        std::vector<std::unique_ptr<StreamOutput>> outputs;
+        void addOutput(const char *name);
+
+        // Preview stretch. Auto sets black and white levels from the frame histogram
+        INDI::PropertySwitch PreviewStretchSP {2};
+        enum { STRETCH_OFF, STRETCH_AUTO };
+        std::atomic<bool> isAutoStretch { false };
+
+        // Time frames spend in each stage, 50th and 99th percentiles in milliseconds
+        INDI::PropertyNumber StreamLatencyNP {10};
+        enum { STAGE_QUEUE, STAGE_PROCESS, STAGE_RECORD, STAGE_ENCODE, STAGE_UPLOAD, STAGE_MAX };
+        LatencyStats stageLatency[STAGE_MAX];
+        double publishedLatency[2 * STAGE_MAX] {};
+
+        // Per frame trace written next to the recording
+        INDI::PropertySwitch StreamTraceSP {2};
+        enum { TRACE_ON, TRACE_OFF };
+        FILE *traceFile = nullptr;
+        uint64_t traceFrames = 0;
+        void writeTrace(uint64_t timestamp, double queueMs, double processMs, double recordMs, bool previewed);
+
+        // Frames of the stream shared with local processes, at the full rate, see sharedframes.h
+        INDI::PropertySwitch StreamSharedSP {2};
+        enum { SHARED_ON, SHARED_OFF };
+        INDI::PropertyText StreamSharedTP {1};
+        std::atomic<bool> isSharing { false };
+        // Written by the stream thread, which makes the ring bigger for larger frames
+        std::mutex sharedMutex;
+        shared_frames *sharedFrames = nullptr;
+        std::string publishedSharedPath;
+        void shareFrame(const uint8_t *source, size_t size, const FrameInfo &srcFrameInfo, bool subframed,
+                        uint64_t timestamp);
+        void closeSharedFrames();
+
+        // Backlog of the slowest client of the stream, 0 to 1 when indiserver drops its frames, as set by indiserver.
+        // The preview then goes slower, smaller and in a lower quality, so that frames are not encoded to be dropped
+        INDI::PropertyNumber StreamBacklogNP {1};
+        std::atomic<double> streamBacklog { 0 };
+        static constexpr int BACKLOG_WORST_QUALITY = 40;
+        double previewInterval() const;
+
         std::atomic<bool> isStreaming { false };
         std::atomic<bool> isRecording { false };
         std::atomic<bool> isRecordingAboutToClose { false };
@@ -250,15 +335,36 @@ class StreamManagerPrivate
             double time;
             uint64_t timestamp;
             std::vector<uint8_t> frame;
+            std::chrono::steady_clock::time_point queued;
+            // Frame lent by the driver instead of frame, given back when reset
+            std::shared_ptr<const uint8_t> view;
+            size_t viewSize;
         } TimeFrame;
 
+        // A frame as read by the recorder, the outputs and the preview
+        struct FrameView
+        {
+            const uint8_t *data;
+            size_t size;
+        };
+
         std::thread              framesThread;   // async incoming frames processing
         std::atomic<bool>        framesThreadTerminate {false};
-        UniqueQueue<TimeFrame>   framesIncoming;
+        SPSCRing<TimeFrame>      framesIncoming;
 
-        std::mutex               fastFPSUpdate;
         std::mutex               recordMutex;
 
+        // Telemetry is published from the main loop at a fixed rate, never from the frame path
+        void publishTelemetry();
+        INDI::Timer              telemetryTimer;
+        std::atomic<size_t>      queuedBytes {0};
+        double                   publishedFps[2] {0, 0};
+        double                   publishedStreamTime {0};
+        double                   publishedBuffer[2] {0, 0};
+
+        std::mutex                        framePoolMutex;
+        std::vector<std::vector<uint8_t>> framePool;
+
         GammaLut16               gammaLut16;
 };
 
@@ -0,0 +1,234 @@
+/*
+    Stream Output
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "streamoutput.h"
+#include "defaultdevice.h"
+#include "indilogger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace INDI
+{
+
+StreamOutput::StreamOutput(DefaultDevice *device, const std::string &name)
+    : currentDevice(device)
+    , name(name)
+{
+    for (auto oneEncoder : encoderManager.getEncoderList())
+        oneEncoder->init(currentDevice);
+    encoder = encoderManager.getDefaultEncoder();
+}
+
+StreamOutput::~StreamOutput()
+{
+    uploadThreadPool.quit();
+}
+
+void StreamOutput::initProperties(const char *group)
+{
+    const char *deviceName = currentDevice->getDeviceName();
+    std::string propertyName = "STREAM_" + name;
+
+    // Whole stream frame, 640 pixels wide, off
+    SettingsNP[OUTPUT_X        ].fill("X",         "Left",            "%.0f", 0, 65535, 1, 0);
+    SettingsNP[OUTPUT_Y        ].fill("Y",         "Top",             "%.0f", 0, 65535, 1, 0);
+    SettingsNP[OUTPUT_W        ].fill("WIDTH",     "Width (0 all)",   "%.0f", 0, 65535, 1, 0);
+    SettingsNP[OUTPUT_H        ].fill("HEIGHT",    "Height (0 all)",  "%.0f", 0, 65535, 1, 0);
+    SettingsNP[OUTPUT_MAX_WIDTH].fill("MAX_WIDTH", "Max Width (0 any)", "%.0f", 0, 65535, 1, 640);
+    SettingsNP[OUTPUT_FPS      ].fill("FPS",       "FPS (0 off)",     "%.0f", 0, 120, 1, 0);
+    SettingsNP[OUTPUT_DEPTH    ].fill("DEPTH",     "Bit Depth",       "%.0f", 8, 16, 8, 8);
+    SettingsNP.fill(deviceName, (propertyName + "_SETTINGS").c_str(), (name + " Stream").c_str(), group, IP_RW, 60,
+                    IPS_IDLE);
+
+    EncoderSP.resize(encoderManager.getEncoderList().size());
+    for (size_t i = 0; i < EncoderSP.size(); i++)
+    {
+        const char *encoderName = encoderManager.getEncoderList().at(i)->getName();
+        EncoderSP[i].fill(encoderName, encoderName, encoderManager.getEncoderList().at(i) == encoder ? ISS_ON : ISS_OFF);
+    }
+    EncoderSP.fill(deviceName, (propertyName + "_ENCODER").c_str(), (name + " Encoder").c_str(), group, IP_RW,
+                   ISR_1OFMANY, 0, IPS_IDLE);
+
+    StreamBP[0].fill("DATA", "Stream", "");
+    StreamBP.fill(deviceName, propertyName.c_str(), (name + " Stream Data").c_str(), group, IP_RO, 60, IPS_IDLE);
+}
+
+void StreamOutput::ISGetProperties()
+{
+    if (!currentDevice->isConnected())
+        return;
+
+    currentDevice->defineProperty(SettingsNP);
+    currentDevice->defineProperty(EncoderSP);
+    currentDevice->defineProperty(StreamBP);
+}
+
+void StreamOutput::updateProperties()
+{
+    if (currentDevice->isConnected())
+    {
+        currentDevice->defineProperty(SettingsNP);
+        currentDevice->defineProperty(EncoderSP);
+        currentDevice->defineProperty(StreamBP);
+    }
+    else
+    {
+        currentDevice->deleteProperty(SettingsNP.getName());
+        currentDevice->deleteProperty(EncoderSP.getName());
+        currentDevice->deleteProperty(StreamBP.getName());
+    }
+}
+
+bool StreamOutput::ISNewNumber(const char *name, double values[], char *names[], int n)
+{
+    if (!SettingsNP.isNameMatch(name))
+        return false;
+
+    SettingsNP.update(values, names, n);
+    // 8 or 16 bits only
+    SettingsNP[OUTPUT_DEPTH].setValue(SettingsNP[OUTPUT_DEPTH].getValue() > 8 ? 16 : 8);
+    if (SettingsNP[OUTPUT_FPS].getValue() > 0)
+        rate.setTimeWindow(1000.0 / SettingsNP[OUTPUT_FPS].getValue());
+    rate.reset();
+    SettingsNP.setState(IPS_OK);
+    SettingsNP.apply();
+    return true;
+}
+
+bool StreamOutput::ISNewSwitch(const char *name, ISState *states, char *names[], int n)
+{
+    if (!EncoderSP.isNameMatch(name))
+        return false;
+
+    EncoderSP.update(states, names, n);
+    EncoderSP.setState(IPS_ALERT);
+
+    const char *selectedEncoder = EncoderSP.findOnSwitch()->getName();
+    for (EncoderInterface *oneEncoder : encoderManager.getEncoderList())
+    {
+        if (!strcmp(selectedEncoder, oneEncoder->getName()))
+        {
+            std::lock_guard<std::mutex> lock(encoderMutex);
+            encoderManager.setEncoder(oneEncoder);
+            encoder = oneEncoder;
+            EncoderSP.setState(IPS_OK);
+        }
+    }
+    EncoderSP.apply();
+    return true;
+}
+
+void StreamOutput::saveConfigItems(FILE *fp)
+{
+    SettingsNP.save(fp);
+    EncoderSP.save(fp);
+}
+
+void StreamOutput::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat)
+{
+    this->pixelFormat = pixelFormat;
+}
+
+bool StreamOutput::isDue()
+{
+    return SettingsNP[OUTPUT_FPS].getValue() > 0 && rate.newFrame();
+}
+
+bool StreamOutput::wantsFullDepth() const
+{
+    // Only the raw encoder sends 16 bits
+    return SettingsNP[OUTPUT_DEPTH].getValue() > 8 && !strcmp(encoder->getName(), "RAW");
+}
+
+void StreamOutput::send(const uint8_t *frame, uint32_t width, uint32_t height, uint32_t components, uint32_t depth)
+{
+    // Region of the stream frame
+    uint32_t x = std::min<uint32_t>(SettingsNP[OUTPUT_X].getValue(), width - 1);
+    uint32_t y = std::min<uint32_t>(SettingsNP[OUTPUT_Y].getValue(), height - 1);
+    uint32_t w = SettingsNP[OUTPUT_W].getValue();
+    uint32_t h = SettingsNP[OUTPUT_H].getValue();
+    w = (w == 0) ? width - x : std::min(w, width - x);
+    h = (h == 0) ? height - y : std::min(h, height - y);
+
+    // Integer scale to fit the width, bayer frames are averaged over whole 2x2 cells into gray
+    uint32_t maxWidth = SettingsNP[OUTPUT_MAX_WIDTH].getValue();
+    uint32_t scale = (maxWidth > 0 && w > maxWidth) ? (w + maxWidth - 1) / maxWidth : 1;
+    bool bayer = pixelFormat >= INDI_BAYER_RGGB && pixelFormat <= INDI_BAYER_MYYC;
+    INDI_PIXEL_FORMAT outputFormat = pixelFormat;
+    if (bayer && scale > 1)
+    {
+        scale += scale & 1;
+        x &= ~1u;
+        y &= ~1u;
+        outputFormat = INDI_MONO;
+    }
+
+    uint32_t outputWidth = w / scale;
+    uint32_t outputHeight = h / scale;
+    if (outputWidth == 0 || outputHeight == 0)
+        return;
+
+    uint32_t bytesPerSample = depth > 8 ? 2 : 1;
+    auto buffer = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(outputWidth) * outputHeight * components *
+                  bytesPerSample);
+
+    // Box average over scale x scale pixels
+    auto render = [&](auto * output, const auto * input)
+    {
+        for (uint32_t row = 0; row < outputHeight; ++row)
+        {
+            for (uint32_t column = 0; column < outputWidth; ++column)
+            {
+                for (uint32_t c = 0; c < components; ++c)
+                {
+                    uint32_t sum = 0;
+                    for (uint32_t k = 0; k < scale; ++k)
+                    {
+                        const auto *line = input + (static_cast<size_t>(y + row * scale + k) * width + x + column * scale) *
+                                           components + c;
+                        for (uint32_t l = 0; l < scale; ++l)
+                            sum += line[l * components];
+                    }
+                    *output++ = sum / (scale * scale);
+                }
+            }
+        }
+    };
+    if (bytesPerSample == 2)
+        render(reinterpret_cast<uint16_t *>(buffer->data()), reinterpret_cast<const uint16_t *>(frame));
+    else
+        render(buffer->data(), frame);
+
+    // Skip the frame if the previous one is still on its way
+    uploadThreadPool.tryStart([this, buffer, outputWidth, outputHeight, outputFormat, depth](const std::atomic_bool &)
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        encoder->setSize(outputWidth, outputHeight);
+        encoder->setPixelFormat(outputFormat, depth);
+        if (encoder->upload(&StreamBP[0], buffer->data(), buffer->size(), false))
+        {
+            StreamBP.setState(IPS_OK);
+            StreamBP.apply();
+        }
+    });
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+    Stream Output
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+#pragma once
+
+#include "indibasetypes.h"
+#include "indipropertyblob.h"
+#include "indipropertynumber.h"
+#include "indipropertyswitch.h"
+#include "indisinglethreadpool.h"
+#include "encoder/encodermanager.h"
+#include "fpsmeter.h"
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace INDI
+{
+
+class DefaultDevice;
+
+/**
+ * @brief The StreamOutput class is one more stream sent next to the preview, for example a small
+ * MJPEG stream for remote viewers.
+ *
+ * Each output has its own region of the stream frame, width limit, bit depth, encoder, rate and BLOB
+ * property. The stream manager computes the 8 bit frame once and hands it to every output, which then
+ * crops and scales it on the stream thread and encodes and uploads it on its own thread.
+ */
+class StreamOutput
+{
+    public:
+        StreamOutput(DefaultDevice *device, const std::string &name);
+        ~StreamOutput();
+
+        const std::string &getName() const
+        {
+            return name;
+        }
+
+        void initProperties(const char *group);
+        void ISGetProperties();
+        void updateProperties();
+        bool ISNewNumber(const char *name, double values[], char *names[], int n);
+        bool ISNewSwitch(const char *name, ISState *states, char *names[], int n);
+        void saveConfigItems(FILE *fp);
+
+        void setPixelFormat(INDI_PIXEL_FORMAT pixelFormat);
+
+        /** @return True when a frame is due, call once per frame. */
+        bool isDue();
+
+        /** @return True if the output takes the frame at the full bit depth rather than 8 bits. */
+        bool wantsFullDepth() const;
+
+        /**
+         * @brief send Crop and scale the stream frame, then encode and upload it.
+         * @param frame stream frame, contiguous.
+         * @param width stream frame width.
+         * @param height stream frame height.
+         * @param components 1 or 3 samples per pixel.
+         * @param depth 8 or 16 bits per sample.
+         */
+        void send(const uint8_t *frame, uint32_t width, uint32_t height, uint32_t components, uint32_t depth);
+
+    private:
+        DefaultDevice *currentDevice;
+        std::string name;
+
+        // Region of the stream frame, width limit, rate and bit depth
+        INDI::PropertyNumber SettingsNP {7};
+        enum { OUTPUT_X, OUTPUT_Y, OUTPUT_W, OUTPUT_H, OUTPUT_MAX_WIDTH, OUTPUT_FPS, OUTPUT_DEPTH };
+
+        INDI::PropertySwitch EncoderSP {0};
+        INDI::PropertyBlob StreamBP {1};
+
+        EncoderManager encoderManager;
+        // Encoder switches come from the main thread, frames from the stream thread
+        std::mutex encoderMutex;
+        EncoderInterface *encoder {nullptr};
+        INDI_PIXEL_FORMAT pixelFormat {INDI_MONO};
+
+        FPSMeter rate;
+        SingleThreadPool uploadThreadPool;
+};
+
+}
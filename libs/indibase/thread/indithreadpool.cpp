@@ -0,0 +1,210 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "indithreadpool.h"
+#include "indithreadpool_p.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace INDI
+{
+
+ThreadPoolPrivate::ThreadPoolPrivate(size_t count, const std::vector<int> &cpus)
+{
+    if (count == 0)
+        count = std::max(1u, std::thread::hardware_concurrency());
+
+    threads.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        threads.emplace_back([this] { run(); });
+#ifdef __linux__
+        if (!cpus.empty())
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu : cpus)
+                if (cpu >= 0 && cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &set);
+            pthread_setaffinity_np(threads.back().native_handle(), sizeof(set), &set);
+        }
+#endif
+    }
+}
+
+ThreadPoolPrivate::~ThreadPoolPrivate()
+{
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        isAboutToQuit = true;
+        acquire.notify_all();
+    }
+    for (auto &thread : threads)
+        if (thread.joinable())
+            thread.join();
+}
+
+void ThreadPoolPrivate::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for(;;)
+    {
+        acquire.wait(guard, [this]
+        {
+            return !queue.empty() || isAboutToQuit;
+        });
+        // The queue is emptied before quitting
+        if (queue.empty())
+            break;
+
+        std::function<void()> function = std::move(const_cast<Task &>(queue.top()).function);
+        queue.pop();
+        running++;
+
+        guard.unlock();
+        try
+        {
+            function();
+        }
+        catch (...)
+        {
+            // Nobody to report to, submit() hands the exceptions over through the future
+        }
+        function = nullptr;
+        guard.lock();
+
+        if (--running == 0 && queue.empty())
+            done.notify_all();
+    }
+}
+
+ThreadPool::ThreadPool(size_t threads, const std::vector<int> &cpus)
+    : d_ptr(new ThreadPoolPrivate(threads, cpus))
+{ }
+
+ThreadPool::~ThreadPool()
+{ }
+
+ThreadPool &ThreadPool::global()
+{
+    // Never destroyed, tasks may still be queued by static destructors
+    static ThreadPool *pool = []
+    {
+        const char *size = getenv("INDI_THREAD_POOL_SIZE");
+        return new ThreadPool(size ? static_cast<size_t>(std::max(0, atoi(size))) : 0);
+    }();
+    return *pool;
+}
+
+void ThreadPool::post(const std::function<void()> &task, Priority priority)
+{
+    D_PTR(ThreadPool);
+    std::unique_lock<std::mutex> guard(d->lock);
+    d->queue.push({priority, d->sequence++, task});
+    d->acquire.notify_one();
+}
+
+void ThreadPool::forEach(size_t count, size_t minPerTask, const std::function<void(size_t, size_t)> &fn,
+                         size_t maxTasks)
+{
+    if (maxTasks == 0)
+        maxTasks = threadCount() + 1;
+    size_t tasks = std::max<size_t>(1, std::min(maxTasks, count / std::max<size_t>(minPerTask, 1)));
+    if (tasks == 1)
+    {
+        fn(0, count);
+        return;
+    }
+
+    // Ranges are taken by whoever comes first, the threads of the pool or the caller
+    struct State
+    {
+        const std::function<void(size_t, size_t)> *fn;
+        size_t count, chunk, chunks;
+        std::atomic<size_t> next {0};
+        size_t finished {0};
+        std::exception_ptr error;
+        std::mutex lock;
+        std::condition_variable done;
+
+        void work()
+        {
+            for (size_t index; (index = next++) < chunks;)
+            {
+                std::exception_ptr caught;
+                try
+                {
+                    (*fn)(index * chunk, std::min(count, (index + 1) * chunk));
+                }
+                catch (...)
+                {
+                    caught = std::current_exception();
+                }
+
+                std::unique_lock<std::mutex> guard(lock);
+                if (caught && !error)
+                    error = caught;
+                if (++finished == chunks)
+                    done.notify_all();
+            }
+        }
+    };
+
+    auto state = std::make_shared<State>();
+    state->fn = &fn;
+    state->count = count;
+    state->chunk = (count + tasks - 1) / tasks;
+    state->chunks = (count + state->chunk - 1) / state->chunk;
+
+    for (size_t i = 1; i < state->chunks; i++)
+        post([state] { state->work(); }, HighPriority);
+    state->work();
+
+    std::unique_lock<std::mutex> guard(state->lock);
+    state->done.wait(guard, [&state] { return state->finished == state->chunks; });
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+
+size_t ThreadPool::threadCount() const
+{
+    D_PTR(const ThreadPool);
+    return d->threads.size();
+}
+
+size_t ThreadPool::pending() const
+{
+    D_PTR(const ThreadPool);
+    std::unique_lock<std::mutex> guard(d->lock);
+    return d->queue.size();
+}
+
+void ThreadPool::waitForDone()
+{
+    D_PTR(ThreadPool);
+    std::unique_lock<std::mutex> guard(d->lock);
+    d->done.wait(guard, [&d] { return d->queue.empty() && d->running == 0; });
+}
+
+}
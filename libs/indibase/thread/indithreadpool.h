@@ -0,0 +1,113 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include "indimacros.h"
+#include <memory>
+#include <functional>
+#include <future>
+#include <type_traits>
+#include <vector>
+
+namespace INDI
+{
+
+class ThreadPoolPrivate;
+/**
+ * @brief Fixed number of threads running queued tasks.
+ *
+ * Unlike SingleThreadPool, a new task never interrupts a running one: tasks wait in a queue,
+ * higher priorities first and in order of submission within a priority.
+ * The threads can be pinned to a set of CPUs (Linux only, ignored elsewhere).
+ *
+ * ThreadPool::global() is shared by the library and the drivers, so that the threads of the
+ * CCD, stream and DSP pipelines of all the devices of a driver stay within one limit. Its size is
+ * the number of CPUs, or the INDI_THREAD_POOL_SIZE environment variable when set.
+ *
+ * Tasks run on the global pool must not wait for other tasks of the pool, a full pool would
+ * deadlock. forEach() is safe there: the calling thread processes the ranges no thread has taken.
+ */
+class ThreadPool
+{
+        DECLARE_PRIVATE(ThreadPool)
+    public:
+        enum Priority
+        {
+            LowPriority,
+            NormalPriority,
+            HighPriority
+        };
+
+    public:
+        /**
+         * @param threads number of threads, 0 for one per CPU.
+         * @param cpus CPUs the threads may run on, all of them when empty.
+         */
+        explicit ThreadPool(size_t threads = 0, const std::vector<int> &cpus = {});
+        /** @brief Runs the tasks still queued and joins the threads. */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+    public:
+        /** @brief The pool shared by the whole driver, created on first use. */
+        static ThreadPool &global();
+
+    public:
+        /** @brief Queues a task, with no way to wait for it but waitForDone(). */
+        void post(const std::function<void()> &task, Priority priority = NormalPriority);
+
+        /**
+         * @brief Queues a task and returns a future of its result.
+         * An exception thrown by the task is rethrown by std::future::get().
+         */
+        template <typename Fn>
+        auto submit(Fn &&fn, Priority priority = NormalPriority) -> std::future<typename std::result_of<Fn()>::type>
+        {
+            using Result = typename std::result_of<Fn()>::type;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+            std::future<Result> result = task->get_future();
+            post([task]()
+            {
+                (*task)();
+            }, priority);
+            return result;
+        }
+
+        /**
+         * @brief Calls fn(first, last) on ranges covering [0, count) and returns once they are all done.
+         * The ranges are at least minPerTask items long and at most maxTasks are made, 0 for threadCount() + 1.
+         * The calling thread takes its part of the work, so this may be called from a task of the pool.
+         */
+        void forEach(size_t count, size_t minPerTask, const std::function<void(size_t first, size_t last)> &fn,
+                     size_t maxTasks = 0);
+
+    public:
+        /** @brief Number of threads of the pool. */
+        size_t threadCount() const;
+
+        /** @brief Number of queued tasks not started yet. */
+        size_t pending() const;
+
+        /** @brief Waits until the queue is empty and no task is running. */
+        void waitForDone();
+
+    protected:
+        std::shared_ptr<ThreadPoolPrivate> d_ptr;
+};
+
+}
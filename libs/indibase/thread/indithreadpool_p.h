@@ -0,0 +1,62 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include "indithreadpool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace INDI
+{
+
+class ThreadPoolPrivate
+{
+    public:
+        ThreadPoolPrivate(size_t threads, const std::vector<int> &cpus);
+        virtual ~ThreadPoolPrivate();
+
+        struct Task
+        {
+            ThreadPool::Priority priority;
+            uint64_t sequence;
+            std::function<void()> function;
+
+            // Highest priority on top, then the oldest
+            bool operator<(const Task &other) const
+            {
+                return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+            }
+        };
+
+        void run();
+
+        std::priority_queue<Task> queue;
+        uint64_t sequence {0};
+        size_t running {0};
+        bool isAboutToQuit {false};
+
+        mutable std::mutex lock;
+        std::condition_variable acquire;
+        std::condition_variable done;
+        std::vector<std::thread> threads;
+};
+
+}
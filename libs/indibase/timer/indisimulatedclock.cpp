@@ -0,0 +1,105 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "indisimulatedclock.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include <sys/time.h>
+
+namespace INDI
+{
+
+namespace
+{
+
+struct Clock
+{
+    std::atomic<double> speed {1};
+    std::atomic<double> epoch {0};
+};
+
+double wallNow()
+{
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+Clock &clock()
+{
+    static Clock instance;
+    static std::once_flag once;
+    std::call_once(once, []()
+    {
+        const char *speed = getenv("INDI_SIMULATION_SPEED");
+        const char *epoch = getenv("INDI_SIMULATION_EPOCH");
+        double value = speed ? atof(speed) : 1;
+        instance.speed = value > 0 ? value : 1;
+        instance.epoch = epoch ? atof(epoch) : wallNow();
+    });
+    return instance;
+}
+
+}
+
+double SimulatedClock::speed()
+{
+    return clock().speed;
+}
+
+double SimulatedClock::now()
+{
+    Clock &c = clock();
+    double epoch = c.epoch;
+    return epoch + (wallNow() - epoch) * c.speed;
+}
+
+void SimulatedClock::gettimeofday(struct timeval *tv)
+{
+    double time = now();
+    tv->tv_sec  = static_cast<time_t>(floor(time));
+    tv->tv_usec = static_cast<suseconds_t>((time - floor(time)) * 1e6);
+}
+
+double SimulatedClock::julianDate()
+{
+    return now() / 86400.0 + 2440587.5;
+}
+
+uint32_t SimulatedClock::toWallMs(double simulatedMs)
+{
+    double ms = simulatedMs / speed();
+    return ms < 1 ? 1 : static_cast<uint32_t>(lround(ms));
+}
+
+void SimulatedClock::sleep(double simulatedSeconds)
+{
+    if (simulatedSeconds > 0)
+        std::this_thread::sleep_for(std::chrono::duration<double>(simulatedSeconds / speed()));
+}
+
+void SimulatedClock::set(double speed, double epoch)
+{
+    Clock &c = clock();
+    c.speed = speed > 0 ? speed : 1;
+    c.epoch = epoch;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <cstdint>
+
+struct timeval;
+
+namespace INDI
+{
+
+/**
+ * @class SimulatedClock
+ * @brief The SimulatedClock class is the time of the simulators, which may run faster than the wall clock
+ * so that automated tests do not wait for slews and exposures.
+ *
+ * The speed is read from INDI_SIMULATION_SPEED, 1 by default. From INDI_SIMULATION_EPOCH, in seconds since
+ * the Unix epoch, simulated time goes that many times faster than the wall clock: simulators given the same
+ * epoch, as the drivers of an indiserver started with both variables, share the same time. Without an epoch,
+ * each process starts its own clock at the wall time it first reads it.
+ *
+ * Simulators read the time, and scale their timers and sleeps, through this class.
+ */
+class SimulatedClock
+{
+    public:
+        /** @brief Simulated seconds per wall clock second. */
+        static double speed();
+
+        /** @brief Simulated seconds since the Unix epoch. */
+        static double now();
+
+        /** @brief Simulated time, as gettimeofday would give it. */
+        static void gettimeofday(struct timeval *tv);
+
+        /** @brief Simulated Julian date, for ln_get_julian_from_sys. */
+        static double julianDate();
+
+        /** @brief Wall clock milliseconds of a simulated duration, at least 1, for timers. */
+        static uint32_t toWallMs(double simulatedMs);
+
+        /** @brief Sleep for a simulated duration. */
+        static void sleep(double simulatedSeconds);
+
+        /** @brief Run at another speed from an epoch, instead of the environment. For tests. */
+        static void set(double speed, double epoch);
+};
+
+}
@@ -38,7 +38,7 @@ void TimerPrivate::start()
 {
     if (singleShot)
     {
-        timerId = addTimer(interval, [](void *arg)
+        timerId = addTimerUs(interval, [](void *arg)
         {
             TimerPrivate *d = static_cast<TimerPrivate*>(arg);
             d->timerId = -1;
@@ -47,7 +47,7 @@ void TimerPrivate::start()
     }
     else
     {
-        timerId = addPeriodicTimer(interval, [](void *arg)
+        timerId = addPeriodicTimerUs(interval, [](void *arg)
         {
             TimerPrivate *d = static_cast<TimerPrivate*>(arg);
             d->p->timeout();
@@ -87,10 +87,15 @@ void Timer::start()
 }
 
 void Timer::start(int msec)
+{
+    startUs(int64_t(msec) * 1000);
+}
+
+void Timer::startUs(int64_t usec)
 {
     D_PTR(Timer);
     d->stop();
-    d->interval = msec;
+    d->interval = usec;
     d->start();
 }
 
@@ -101,9 +106,14 @@ void Timer::stop()
 }
 
 void Timer::setInterval(int msec)
+{
+    setIntervalUs(int64_t(msec) * 1000);
+}
+
+void Timer::setIntervalUs(int64_t usec)
 {
     D_PTR(Timer);
-    d->interval = msec;
+    d->interval = usec;
 }
 
 void Timer::setSingleShot(bool singleShot)
@@ -130,7 +140,19 @@ int Timer::remainingTime() const
     return d->timerId != -1 ? std::max(remainingTimer(d->timerId), 0) : 0;
 }
 
+int64_t Timer::remainingTimeUs() const
+{
+    D_PTR(const Timer);
+    return d->timerId != -1 ? std::max<int64_t>(nsecsRemainingTimer(d->timerId) / 1000, 0) : 0;
+}
+
 int Timer::interval() const
+{
+    D_PTR(const Timer);
+    return static_cast<int>(d->interval / 1000);
+}
+
+int64_t Timer::intervalUs() const
 {
     D_PTR(const Timer);
     return d->interval;
@@ -144,10 +166,15 @@ void Timer::timeout()
 }
 
 void Timer::singleShot(int msec, const std::function<void()> &callback)
+{
+    singleShotUs(int64_t(msec) * 1000, callback);
+}
+
+void Timer::singleShotUs(int64_t usec, const std::function<void()> &callback)
 {
     Timer *timer = new Timer();
     timer->setSingleShot(true);
-    timer->setInterval(msec);
+    timer->setIntervalUs(usec);
     timer->callOnTimeout([callback, timer]()
     {
         callback();
@@ -21,6 +21,7 @@
 #include "indimacros.h"
 #include <memory>
 #include <functional>
+#include <cstdint>
 
 namespace INDI
 {
@@ -36,6 +37,9 @@ class TimerPrivate;
  *
  * You can set a timer to time out only once by calling setSingleShot(true).
  * You can also use the static Timer::singleShot() function to call a function after a specified interval.
+ *
+ * Timers run on the monotonic clock, clock changes do not move them. The Us functions take
+ * microseconds, the event loop waits for them to the microsecond on Linux.
  */
 class Timer
 {
@@ -52,6 +56,9 @@ class Timer
         /** @brief Starts or restarts the timer with a timeout interval of msec milliseconds. */
         void start(int msec);
 
+        /** @brief Starts or restarts the timer with a timeout interval of usec microseconds. */
+        void startUs(int64_t usec);
+
         /** @brief Stops the timer. */
         void stop();
 
@@ -62,6 +69,9 @@ class Timer
         /** @brief Set the timeout interval in milliseconds. */
         void setInterval(int msec);
 
+        /** @brief Set the timeout interval in microseconds. */
+        void setIntervalUs(int64_t usec);
+
         /** @brief Set whether the timer is a single-shot timer. */
         void setSingleShot(bool singleShot);
 
@@ -77,13 +87,22 @@ class Timer
          */
         int remainingTime() const;
 
+        /** @brief Returns the timer's remaining value in microseconds left until the timeout, 0 if it is not active. */
+        int64_t remainingTimeUs() const;
+
         /** @brief Returns the timeout interval in milliseconds. */
         int interval() const;
 
+        /** @brief Returns the timeout interval in microseconds. */
+        int64_t intervalUs() const;
+
     public:
         /** @brief This static function calls a the given function after a given time interval. */
         static void singleShot(int msec, const std::function<void()> &callback);
 
+        /** @brief This static function calls a the given function after a given time interval in microseconds. */
+        static void singleShotUs(int64_t usec, const std::function<void()> &callback);
+
     public:
         /** @brief This function is called when the timer times out. */
         virtual void timeout();
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
 
 namespace INDI
@@ -37,7 +38,7 @@ class TimerPrivate
 
     public:
         Timer *p;
-        int interval {1000};
+        int64_t interval {1000000}; // us
 
         std::atomic<int> timerId {-1};
         bool singleShot {false};
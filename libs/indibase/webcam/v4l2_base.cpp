@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 #include <stdio.h>
 #include <cerrno>
 #include <sys/mman.h>
@@ -45,6 +46,7 @@
 #include <ctime>
 #include <cmath>
 #include <sys/time.h>
+#include <chrono>
 
 #ifdef __linux__
 #include <asm/types.h> /* for videodev2.h */
@@ -184,6 +186,7 @@ V4L2_Base::V4L2_Base()
 
 V4L2_Base::~V4L2_Base()
 {
+    stopCaptureThreads();
     delete v4l2_decode;
 }
 
@@ -388,6 +391,8 @@ int V4L2_Base::connectCam(const char * devpath, char * errmsg, int pixelFormat,
 
 void V4L2_Base::disconnectCam(bool stopcapture)
 {
+    stopCaptureThreads();
+
     if (selectCallBackID != -1)
         rmCallback(selectCallBackID);
 
@@ -543,125 +548,8 @@ int V4L2_Base::read_frame(char * errmsg)
                         return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_DQBUF", errmsg);
                 }
 
-            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: buffer #%d dequeued from fd:%d\n", __FUNCTION__,
-                         buf.index, fd);
-
-            if (buf.flags & V4L2_BUF_FLAG_ERROR)
-            {
-                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
-                             "%s: recoverable error with DQBUF ioctl (BUF_FLAG_ERROR) - frame should be dropped",
-                             __FUNCTION__);
-                if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
-                    return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
-                buf.bytesused = 0;
-                return 0;
-            }
-
-            if (!is_compressed() && buf.bytesused != fmt.fmt.pix.sizeimage)
-            {
-                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
-                             "%s: frame is %d-byte long, expected %d - frame should be dropped", __FUNCTION__,
-                             buf.bytesused, fmt.fmt.pix.sizeimage);
-
-                if (false)
-                {
-                    unsigned char const * b   = (unsigned char const *)buffers[buf.index].start;
-                    unsigned char const * end = b + buf.bytesused;
-
-                    do
-                        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
-                                     "%s: [%p] %02X%02X%02X%02X %02X%02X%02X%02X %02X%02X%02X%02X %02X%02X%02X%02X",
-                                     __FUNCTION__, b, b[0 * 4 + 0], b[0 * 4 + 1], b[0 * 4 + 2], b[0 * 4 + 3],
-                                     b[1 * 4 + 0], b[1 * 4 + 1], b[1 * 4 + 2], b[1 * 4 + 3], b[2 * 4 + 0], b[2 * 4 + 1],
-                                     b[2 * 4 + 2], b[2 * 4 + 3], b[3 * 4 + 0], b[3 * 4 + 1], b[3 * 4 + 2],
-                                     b[3 * 4 + 3]);
-                    while ((b += 16) < end);
-                }
-
-                if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
-                    return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
-                buf.bytesused = 0;
-                return 0;
-            }
-
-#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 15, 0))
-            /* TODO: the timestamp can be checked against the expected exposure to validate the frame - doesn't work, yet */
-            switch (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK)
-            {
-                case V4L2_BUF_FLAG_TIMESTAMP_UNKNOWN:
-                /* FIXME: try monotonic clock when timestamp clock type is unknown */
-                case V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC:
-                {
-                    struct timespec uptime = { 0, 0 };
-                    clock_gettime(CLOCK_MONOTONIC, &uptime);
-
-                    struct timeval epochtime = { 0, 0 };
-                    /*gettimeofday(&epochtime, nullptr); uncomment this to get the timestamp from epoch start */
-
-                    float const secs =
-                        (epochtime.tv_sec - uptime.tv_sec + buf.timestamp.tv_sec) +
-                        (epochtime.tv_usec - uptime.tv_nsec / 1000.0f + buf.timestamp.tv_usec) / 1000000.0f;
-
-                    if (V4L2_BUF_FLAG_TSTAMP_SRC_SOE == (buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK))
-                    {
-                        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
-                                     "%s: frame exposure started %.03f seconds ago", __FUNCTION__, -secs);
-                    }
-                    else if (V4L2_BUF_FLAG_TSTAMP_SRC_EOF == (buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK))
-                    {
-                        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
-                                     "%s: frame finished capturing %.03f seconds ago", __FUNCTION__, -secs);
-                    }
-                    else
-                        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: unsupported timestamp in frame",
-                                     __FUNCTION__);
-
-                    break;
-                }
-
-                case V4L2_BUF_FLAG_TIMESTAMP_COPY:
-                default:
-                    DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: no usable timestamp found in frame",
-                                 __FUNCTION__);
-            }
-#endif
-
-            /* TODO: there is probably a better error handling than asserting the buffer index */
-            assert(buf.index < n_buffers);
-
-            if (dodecode)
-            {
-                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: [%p] decoding %d-byte buffer %p cropset %c",
-                             __FUNCTION__, decoder, buf.bytesused, buffers[buf.index].start, cropset ? 'Y' : 'N');
-                decoder->decode((unsigned char *)(buffers[buf.index].start), &buf, m_Native);
-            }
-
-            /*
-            if (dorecord)
-            {
-                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: [%p] recording %d-byte buffer %p", __FUNCTION__,
-                             recorder, buf.bytesused, buffers[buf.index].start);
-                recorder->writeFrame((unsigned char *)(buffers[buf.index].start));
-            }
-            */
-
-            //DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,"lxstate is %d, dropFrame %c\n", lxstate, (dropFrame?'Y':'N'));
-
-            /* Requeue buffer */
-            if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
-                return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
-
-            if (lxstate == LX_ACTIVE)
-            {
-                /* Call provided callback function if any */
-                //if (callback && !dorecord)
-                if (callback)
-                    (*callback)(uptr);
-            }
-
-            if (lxstate == LX_TRIGGERED)
-                lxstate = LX_ACTIVE;
-
+            if (process_mmap_buffer(errmsg) < 0)
+                return -1;
             break;
 
         case IO_METHOD_USERPTR:
@@ -702,6 +590,313 @@ int V4L2_Base::read_frame(char * errmsg)
     return 0;
 }
 
+/* @internal UTC time a frame was captured: its monotonic kernel timestamp shifted by the offset measured
+ * at capture start, so that the time does not depend on when the frame is processed */
+struct timeval V4L2_Base::frameUTC(const struct v4l2_buffer &b) const
+{
+    struct timeval utc = { 0, 0 };
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 15, 0))
+    if ((b.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC &&
+            (b.timestamp.tv_sec != 0 || b.timestamp.tv_usec != 0))
+    {
+        int64_t us = b.timestamp.tv_sec * 1000000LL + b.timestamp.tv_usec + monotonicToUTC;
+        utc.tv_sec  = us / 1000000;
+        utc.tv_usec = us % 1000000;
+        return utc;
+    }
+#else
+    INDI_UNUSED(b);
+#endif
+    gettimeofday(&utc, nullptr);
+    return utc;
+}
+
+/* @internal Process the MMAP buffer just dequeued into buf: decode or lend it, requeue it, call the frame callback */
+int V4L2_Base::process_mmap_buffer(char * errmsg)
+{
+    DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: buffer #%d dequeued from fd:%d\n", __FUNCTION__,
+                 buf.index, fd);
+
+    if (buf.flags & V4L2_BUF_FLAG_ERROR)
+    {
+        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
+                     "%s: recoverable error with DQBUF ioctl (BUF_FLAG_ERROR) - frame should be dropped",
+                     __FUNCTION__);
+        if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
+            return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
+        buf.bytesused = 0;
+        return 0;
+    }
+
+    if (!is_compressed() && buf.bytesused != fmt.fmt.pix.sizeimage)
+    {
+        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
+                     "%s: frame is %d-byte long, expected %d - frame should be dropped", __FUNCTION__,
+                     buf.bytesused, fmt.fmt.pix.sizeimage);
+
+        if (false)
+        {
+            unsigned char const * b   = (unsigned char const *)buffers[buf.index].start;
+            unsigned char const * end = b + buf.bytesused;
+
+            do
+                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
+                             "%s: [%p] %02X%02X%02X%02X %02X%02X%02X%02X %02X%02X%02X%02X %02X%02X%02X%02X",
+                             __FUNCTION__, b, b[0 * 4 + 0], b[0 * 4 + 1], b[0 * 4 + 2], b[0 * 4 + 3],
+                             b[1 * 4 + 0], b[1 * 4 + 1], b[1 * 4 + 2], b[1 * 4 + 3], b[2 * 4 + 0], b[2 * 4 + 1],
+                             b[2 * 4 + 2], b[2 * 4 + 3], b[3 * 4 + 0], b[3 * 4 + 1], b[3 * 4 + 2],
+                             b[3 * 4 + 3]);
+            while ((b += 16) < end);
+        }
+
+        if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
+            return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
+        buf.bytesused = 0;
+        return 0;
+    }
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 15, 0))
+    /* TODO: the timestamp can be checked against the expected exposure to validate the frame - doesn't work, yet */
+    switch (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK)
+    {
+        case V4L2_BUF_FLAG_TIMESTAMP_UNKNOWN:
+        /* FIXME: try monotonic clock when timestamp clock type is unknown */
+        case V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC:
+        {
+            struct timespec uptime = { 0, 0 };
+            clock_gettime(CLOCK_MONOTONIC, &uptime);
+
+            struct timeval epochtime = { 0, 0 };
+            /*gettimeofday(&epochtime, nullptr); uncomment this to get the timestamp from epoch start */
+
+            float const secs =
+                (epochtime.tv_sec - uptime.tv_sec + buf.timestamp.tv_sec) +
+                (epochtime.tv_usec - uptime.tv_nsec / 1000.0f + buf.timestamp.tv_usec) / 1000000.0f;
+
+            if (V4L2_BUF_FLAG_TSTAMP_SRC_SOE == (buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK))
+            {
+                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
+                             "%s: frame exposure started %.03f seconds ago", __FUNCTION__, -secs);
+            }
+            else if (V4L2_BUF_FLAG_TSTAMP_SRC_EOF == (buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK))
+            {
+                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
+                             "%s: frame finished capturing %.03f seconds ago", __FUNCTION__, -secs);
+            }
+            else
+                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: unsupported timestamp in frame",
+                             __FUNCTION__);
+
+            break;
+        }
+
+        case V4L2_BUF_FLAG_TIMESTAMP_COPY:
+        default:
+            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: no usable timestamp found in frame",
+                         __FUNCTION__);
+    }
+#endif
+
+    frameTime = frameUTC(buf);
+
+    /* TODO: there is probably a better error handling than asserting the buffer index */
+    assert(buf.index < n_buffers);
+
+    {
+        /* Lend the buffer to the callback, keeping two queued to capture into */
+        std::unique_lock<std::mutex> lock(lendMutex);
+        if (lending && callback && lxstate == LX_ACTIVE && lentCount + 2 < n_buffers)
+        {
+            lentIndex = buf.index;
+            lentSize  = buf.bytesused;
+            lock.unlock();
+
+            (*callback)(uptr);
+
+            lock.lock();
+            if (lentIndex != -1)
+            {
+                /* Not taken, requeue at once */
+                lentIndex = -1;
+                lock.unlock();
+                if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
+                    return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
+            }
+            return 0;
+        }
+    }
+
+    if (dodecode)
+    {
+        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: [%p] decoding %d-byte buffer %p cropset %c",
+                     __FUNCTION__, decoder, buf.bytesused, buffers[buf.index].start, cropset ? 'Y' : 'N');
+        decoder->decode((unsigned char *)(buffers[buf.index].start), &buf, m_Native);
+    }
+
+    /*
+    if (dorecord)
+    {
+        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: [%p] recording %d-byte buffer %p", __FUNCTION__,
+                     recorder, buf.bytesused, buffers[buf.index].start);
+        recorder->writeFrame((unsigned char *)(buffers[buf.index].start));
+    }
+    */
+
+    //DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,"lxstate is %d, dropFrame %c\n", lxstate, (dropFrame?'Y':'N'));
+
+    /* Requeue buffer */
+    if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
+        return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
+
+    if (lxstate == LX_ACTIVE)
+    {
+        /* Call provided callback function if any */
+        //if (callback && !dorecord)
+        if (callback)
+            (*callback)(uptr);
+    }
+
+    if (lxstate == LX_TRIGGERED)
+        lxstate = LX_ACTIVE;
+
+    return 0;
+}
+
+/* @internal Dequeue MMAP buffers as they are filled and hand the latest one to the decode thread */
+void V4L2_Base::captureLoop()
+{
+    struct pollfd fds[2] = { { fd, POLLIN, 0 }, { wakePipe[0], POLLIN, 0 } };
+
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(captureMutex);
+            if (captureStop)
+                return;
+        }
+
+        int rc = poll(fds, 2, 1000);
+        if (rc < 0 && errno != EINTR)
+        {
+            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_WARNING, "%s: poll failed (%s), capture stopped", __FUNCTION__,
+                         strerror(errno));
+            return;
+        }
+        if (rc <= 0 || fds[1].revents)
+            continue;
+
+        struct v4l2_buffer frame;
+        CLEAR(frame);
+        frame.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        frame.memory = V4L2_MEMORY_MMAP;
+
+        if (-1 == XIOCTL(fd, VIDIOC_DQBUF, &frame))
+        {
+            /* Frame not ready, or transitory error: wait for the next one */
+            if (errno == EAGAIN || errno == EIO)
+                continue;
+
+            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_WARNING, "%s: VIDIOC_DQBUF failed (%s), capture stopped",
+                         __FUNCTION__, strerror(errno));
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(captureMutex);
+        if (pendingIndex != -1)
+        {
+            /* The decoder is still busy, the older frame is dropped so that the latest one is shown */
+            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: decoder busy, dropping frame #%d", __FUNCTION__,
+                         pendingIndex);
+            XIOCTL(fd, VIDIOC_QBUF, &pendingBuf);
+        }
+        pendingBuf   = frame;
+        pendingIndex = frame.index;
+        captureCondition.notify_one();
+    }
+}
+
+/* @internal Decode the buffers handed by the capture thread, calling the frame callback from this thread */
+void V4L2_Base::decodeLoop()
+{
+    char errmsg[ERRMSGSIZ] = {0};
+
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(captureMutex);
+        captureCondition.wait(lock, [this]()
+        {
+            return captureStop || pendingIndex != -1;
+        });
+
+        /* A buffer still pending is given back by VIDIOC_STREAMOFF */
+        if (captureStop)
+            return;
+
+        buf          = pendingBuf;
+        pendingIndex = -1;
+        lock.unlock();
+
+        if (process_mmap_buffer(errmsg) < 0)
+            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_WARNING, "%s: %s", __FUNCTION__, errmsg);
+    }
+}
+
+bool V4L2_Base::startCaptureThreads()
+{
+    /* Join threads left over by a capture stopped from one of them */
+    stopCaptureThreads();
+
+    if (pipe(wakePipe) == -1)
+    {
+        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: no wake pipe (%s), capturing from the event loop",
+                     __FUNCTION__, strerror(errno));
+        wakePipe[0] = wakePipe[1] = -1;
+        return false;
+    }
+
+    captureStop  = false;
+    pendingIndex = -1;
+    captureThread = std::thread(&V4L2_Base::captureLoop, this);
+    decodeThread  = std::thread(&V4L2_Base::decodeLoop, this);
+    return true;
+}
+
+void V4L2_Base::stopCaptureThreads()
+{
+    if (!captureThread.joinable() && !decodeThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        captureStop = true;
+    }
+    captureCondition.notify_all();
+
+    char wake = 0;
+    if (write(wakePipe[1], &wake, 1) < 0)
+        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: can not wake the capture thread", __FUNCTION__);
+
+    /* Stopped on an error from one of the threads: they are joined by the next start, stop or disconnect */
+    auto self = std::this_thread::get_id();
+    if (self == captureThread.get_id() || self == decodeThread.get_id())
+        return;
+
+    if (captureThread.joinable())
+        captureThread.join();
+    if (decodeThread.joinable())
+        decodeThread.join();
+
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+    wakePipe[0] = wakePipe[1] = -1;
+    pendingIndex = -1;
+}
+
+void V4L2_Base::setThreadedCapture(bool enable)
+{
+    threadedCapture = enable;
+}
+
 int V4L2_Base::stop_capturing(char * errmsg)
 {
     enum v4l2_buf_type type;
@@ -722,6 +917,7 @@ int V4L2_Base::stop_capturing(char * errmsg)
             // long time ago. I recently tried taking this hack off, and it worked fine!
 
             type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            stopCaptureThreads();
             if (selectCallBackID != -1)
             {
                 IERmCallback(selectCallBackID);
@@ -745,6 +941,12 @@ int V4L2_Base::start_capturing(char * errmsg)
     if (!streamedonce)
         init_device(errmsg);
 
+    /* Offset from the monotonic frame timestamps to UTC, measured once per capture */
+    struct timespec monotonic = { 0, 0 }, realtime = { 0, 0 };
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    monotonicToUTC = (realtime.tv_sec - monotonic.tv_sec) * 1000000LL + (realtime.tv_nsec - monotonic.tv_nsec) / 1000;
+
     switch (io)
     {
         case IO_METHOD_READ:
@@ -771,8 +973,9 @@ int V4L2_Base::start_capturing(char * errmsg)
             if (-1 == XIOCTL(fd, VIDIOC_STREAMON, &type))
                 return errno_exit("VIDIOC_STREAMON", errmsg);
 
-            selectCallBackID = IEAddCallback(fd, newFrame, this);
-            streamactive     = true;
+            streamactive = true;
+            if (!threadedCapture || !startCaptureThreads())
+                selectCallBackID = IEAddCallback(fd, newFrame, this);
 
             break;
 
@@ -821,10 +1024,28 @@ int V4L2_Base::uninit_device(char * errmsg)
             break;
 
         case IO_METHOD_MMAP:
+        {
+            /* Lent buffers are read downstream until released */
+            std::unique_lock<std::mutex> lock(lendMutex);
+            auto released = [this]()
+            {
+                return lentCount == 0;
+            };
+            if (!lendReleased.wait_for(lock, std::chrono::seconds(2), released))
+                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_WARNING, "%s: %u buffers still lent, unmapping them anyway",
+                             __FUNCTION__, lentCount);
+            lentCount = 0;
+            lock.unlock();
+
             for (unsigned int i = 0; i < n_buffers; ++i)
+            {
+                if (buffers[i].dmabuf != -1)
+                    close(buffers[i].dmabuf);
                 if (-1 == munmap(buffers[i].start, buffers[i].length))
                     return errno_exit("munmap", errmsg);
+            }
             break;
+        }
 
         case IO_METHOD_USERPTR:
             for (unsigned int i = 0; i < n_buffers; ++i)
@@ -863,7 +1084,8 @@ int V4L2_Base::init_mmap(char * errmsg)
 
     CLEAR(req);
 
-    req.count = 4;
+    /* Room for the buffers lent to the streamer */
+    req.count = 8;
     //req.count               = 1;
     req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     req.memory = V4L2_MEMORY_MMAP;
@@ -917,11 +1139,85 @@ int V4L2_Base::init_mmap(char * errmsg)
 
         if (MAP_FAILED == buffers[n_buffers].start)
             return errno_exit("mmap", errmsg);
+
+        /* For consumers importing the frames, e.g. hardware encoders */
+        buffers[n_buffers].dmabuf = -1;
+#ifdef VIDIOC_EXPBUF
+        struct v4l2_exportbuffer expbuf;
+        CLEAR(expbuf);
+        expbuf.type  = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        expbuf.index = n_buffers;
+        expbuf.flags = O_RDONLY | O_CLOEXEC;
+        if (0 == ioctl(fd, VIDIOC_EXPBUF, &expbuf))
+            buffers[n_buffers].dmabuf = expbuf.fd;
+#endif
     }
 
     return 0;
 }
 
+void V4L2_Base::setLending(bool enable)
+{
+    /* Only frames the streamer uses as they are: native JPEG, or unpadded and uncropped 8 bits gray */
+    bool passthrough = false;
+    switch (fmt.fmt.pix.pixelformat)
+    {
+        case V4L2_PIX_FMT_MJPEG:
+        case V4L2_PIX_FMT_JPEG:
+            passthrough = m_Native;
+            break;
+
+        case V4L2_PIX_FMT_GREY:
+            passthrough = !cropset && fmt.fmt.pix.bytesperline == fmt.fmt.pix.width;
+            break;
+    }
+
+    std::lock_guard<std::mutex> lock(lendMutex);
+    lending = enable && passthrough && io == IO_METHOD_MMAP;
+}
+
+const uint8_t *V4L2_Base::takeLentFrame(uint32_t &size, int &index)
+{
+    std::lock_guard<std::mutex> lock(lendMutex);
+    if (lentIndex == -1)
+        return nullptr;
+
+    index     = lentIndex;
+    size      = lentSize;
+    lentIndex = -1;
+    lentCount++;
+    return static_cast<const uint8_t *>(buffers[index].start);
+}
+
+void V4L2_Base::releaseFrame(int index)
+{
+    std::lock_guard<std::mutex> lock(lendMutex);
+    if (lentCount == 0)
+        return;
+
+    /* After VIDIOC_STREAMOFF, start_capturing queues all buffers again */
+    if (streamactive)
+    {
+        struct v4l2_buffer release;
+        CLEAR(release);
+        release.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        release.memory = V4L2_MEMORY_MMAP;
+        release.index  = index;
+        if (-1 == XIOCTL(fd, VIDIOC_QBUF, &release))
+            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: can not requeue buffer #%d", __FUNCTION__, index);
+    }
+
+    lentCount--;
+    lendReleased.notify_all();
+}
+
+int V4L2_Base::getDmabufFd(int index) const
+{
+    if (io != IO_METHOD_MMAP || index < 0 || static_cast<unsigned int>(index) >= n_buffers)
+        return -1;
+    return buffers[index].dmabuf;
+}
+
 void V4L2_Base::init_userp(unsigned int buffer_size)
 {
     struct v4l2_requestbuffers req;
@@ -36,7 +36,10 @@
 
 #include <stdio.h>
 #include <cstdlib>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <thread>
 
 #include <dirent.h>
 #ifdef __OpenBSD__
@@ -71,6 +74,7 @@ class V4L2_Base
         {
             void *start;
             size_t length;
+            int dmabuf; // exported dmabuf file descriptor, -1 if none
         };
 
         /* Connection */
@@ -157,11 +161,37 @@ class V4L2_Base
 
         void doDecode(bool);
 
+        /* Zero copy */
+        // Lend dequeued MMAP buffers to the frame callback instead of decoding them and requeuing them at once.
+        // Only native JPEG and uncropped GREY frames are lent, call once the format and native flag are set.
+        void setLending(bool enable);
+        // From the frame callback, take the buffer lent to it. nullptr if the frame was decoded as usual.
+        // The buffer is requeued by releaseFrame, or when the callback returns if it is not taken.
+        const uint8_t *takeLentFrame(uint32_t &size, int &index);
+        // Give a taken buffer back to the driver, from any thread
+        void releaseFrame(int index);
+        // dmabuf file descriptor of a buffer exported with VIDIOC_EXPBUF, -1 if the driver can not export it
+        int getDmabufFd(int index) const;
+        // UTC time the last frame was captured, from its kernel timestamp when the driver gives one
+        struct timeval getFrameTime() const
+        {
+            return frameTime;
+        }
+        // Dequeue and decode MMAP frames on their own threads instead of the event loop, from the next start_capturing
+        void setThreadedCapture(bool enable);
+
     protected:
         int xioctl(int fd, int request, void *arg, char const *const request_str);
         int ioctl_set_format(struct v4l2_format new_fmt, char *errmsg);
 
         int read_frame(char *errsg);
+        int process_mmap_buffer(char *errmsg);
+        struct timeval frameUTC(const struct v4l2_buffer &b) const;
+
+        bool startCaptureThreads();
+        void stopCaptureThreads();
+        void captureLoop();
+        void decodeLoop();
         int uninit_device(char *errmsg);
         int open_device(const char *devpath, char *errmsg);
         int check_device(char *errmsg);
@@ -189,6 +219,9 @@ class V4L2_Base
         struct v4l2_format fmt;
         struct v4l2_input input;
         struct v4l2_buffer buf;
+        struct timeval frameTime { 0, 0 };
+        // CLOCK_REALTIME - CLOCK_MONOTONIC in microseconds, measured when capture starts
+        int64_t monotonicToUTC { 0 };
 
         bool cancrop;
         bool cropset;
@@ -223,6 +256,25 @@ class V4L2_Base
         int selectCallBackID;
         //unsigned char * YBuf,*UBuf,*VBuf, *yuvBuffer, *colorBuffer, *rgb24_buffer, *cropbuf;
 
+        // Buffers lent downstream, kept mapped and out of the capture queue until released
+        bool lending {false};
+        int lentIndex {-1};
+        uint32_t lentSize {0};
+        unsigned int lentCount {0};
+        std::mutex lendMutex;
+        std::condition_variable lendReleased;
+
+        // Threaded capture: the capture thread dequeues, the decode thread works on the latest pending buffer
+        bool threadedCapture {false};
+        std::thread captureThread;
+        std::thread decodeThread;
+        std::mutex captureMutex;
+        std::condition_variable captureCondition;
+        bool captureStop {false};
+        struct v4l2_buffer pendingBuf;
+        int pendingIndex {-1};
+        int wakePipe[2] { -1, -1 };
+
         V4L2_Decode *v4l2_decode;
         V4L2_Decoder *decoder;
         bool dodecode;
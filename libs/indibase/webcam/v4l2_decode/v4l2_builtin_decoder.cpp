@@ -63,7 +63,10 @@
 #include "ccvt.h"
 #include "v4l2_colorspace.h"
 
+#include <algorithm>
 #include <cstring> // memcpy
+#include <thread>
+#include <vector>
 
 V4L2_Builtin_Decoder::V4L2_Builtin_Decoder()
 {
@@ -631,6 +634,46 @@ void V4L2_Builtin_Decoder::allocBuffers()
     IDLog("Decoder allocBuffers cropping %s\n", (doCrop ? "true" : "false"));
 }
 
+void V4L2_Builtin_Decoder::setThreads(unsigned int t)
+{
+    threads = t;
+}
+
+template <typename Fn>
+void V4L2_Builtin_Decoder::forEachRowPairs(unsigned int pairs, Fn fn) const
+{
+    constexpr unsigned int minPairsPerThread = 32;
+    unsigned int n = threads ? threads : std::thread::hardware_concurrency();
+    n = std::max(1u, std::min(n, pairs / minPairsPerThread));
+    if (n == 1)
+    {
+        fn(0, pairs);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    unsigned int chunk = (pairs + n - 1) / n;
+    for (unsigned int first = chunk; first < pairs; first += chunk)
+        workers.emplace_back(fn, first, std::min(pairs, first + chunk));
+    fn(0, std::min(pairs, chunk));
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void V4L2_Builtin_Decoder::makeLinearLut()
+{
+    if (linearLutColorspace == static_cast<int>(fmt.fmt.pix.colorspace))
+        return;
+
+    // Y only takes 256 values, linearize them once rather than each pixel
+    for (unsigned int i = 0; i < 256; i++)
+        linearLut[i] = i / 255.0;
+    linearize(linearLut, 256, &fmt);
+    for (unsigned int i = 0; i < 256; i++)
+        linearLut16[i] = (unsigned short)(linearLut[i] * 65535.0);
+    linearLutColorspace = fmt.fmt.pix.colorspace;
+}
+
 void V4L2_Builtin_Decoder::makeLinearY()
 {
     unsigned char *src = YBuf;
@@ -640,10 +683,10 @@ void V4L2_Builtin_Decoder::makeLinearY()
     {
         linearBuffer = new float[(bufwidth * bufheight)];
     }
+    makeLinearLut();
     dest = linearBuffer;
     for (i = 0; i < bufwidth * bufheight; i++)
-        *dest++ = (*src++) / 255.0;
-    linearize(linearBuffer, bufwidth * bufheight, &fmt);
+        *dest++ = linearLut[*src++];
 }
 void V4L2_Builtin_Decoder::makeY()
 {
@@ -668,8 +711,16 @@ void V4L2_Builtin_Decoder::makeY()
         case V4L2_PIX_FMT_UYVY:
         case V4L2_PIX_FMT_VYUY:
         case V4L2_PIX_FMT_YVYU:
-            // todo handcopy only Ybuf using an int, byfwidth should be even
-            ccvt_yuyv_420p(bufwidth, bufheight, yuyvBuffer, YBuf, UBuf, VBuf);
+            if ((bufwidth | bufheight) & 1)
+            {
+                ccvt_yuyv_420p(bufwidth, bufheight, yuyvBuffer, YBuf, UBuf, VBuf);
+                break;
+            }
+            forEachRowPairs(bufheight / 2, [this](unsigned int first, unsigned int last)
+            {
+                ccvt_yuyv_420p(bufwidth, 2 * (last - first), yuyvBuffer + 4 * first * bufwidth, YBuf + 2 * first * bufwidth,
+                               UBuf + first * (bufwidth / 2), VBuf + first * (bufwidth / 2));
+            });
             break;
     }
 }
@@ -684,15 +735,15 @@ unsigned char *V4L2_Builtin_Decoder::getY()
     if (doLinearization)
     {
         unsigned int i;
-        float *src;
+        unsigned char *src;
         unsigned short *dest;
         if (!yuyvBuffer)
             yuyvBuffer = new unsigned char[(bufwidth * bufheight) * 2];
-        makeLinearY();
-        src  = linearBuffer;
+        makeLinearLut();
+        src  = YBuf;
         dest = (unsigned short *)yuyvBuffer;
         for (i = 0; i < bufwidth * bufheight; i++)
-            *dest++ = (unsigned short)(*src++ * 65535.0);
+            *dest++ = linearLut16[*src++];
         return yuyvBuffer;
     }
     return YBuf;
@@ -826,7 +877,7 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
         case V4L2_PIX_FMT_YVU420:
         case V4L2_PIX_FMT_NV12:
         case V4L2_PIX_FMT_NV21:
-            ccvt_420p_rgb24(bufwidth, bufheight, (void *)yuvBuffer, (void *)rgb24_buffer);
+            yuv420ToRGB();
             break;
         case V4L2_PIX_FMT_YUYV:
         case V4L2_PIX_FMT_UYVY:
@@ -835,7 +886,13 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
             //if (!colorBuffer) colorBuffer = new unsigned char[(bufwidth * bufheight) * 4];
             //ccvt_yuyv_bgr32(bufwidth, bufheight, yuyvBuffer, rgb24_buffer);
             //ccvt_bgr32_rgb24(bufwidth, bufheight, colorBuffer, (void*)rgb24_buffer);
-            ccvt_yuyv_rgb24(bufwidth, bufheight, yuyvBuffer, (void *)rgb24_buffer);
+            forEachRowPairs(bufheight / 2, [this](unsigned int first, unsigned int last)
+            {
+                // the last row of an odd height goes with the last band
+                unsigned int rows = (last == bufheight / 2 ? bufheight : 2 * last) - 2 * first;
+                ccvt_yuyv_rgb24(bufwidth, rows, yuyvBuffer + 8 * first * (bufwidth / 2),
+                                rgb24_buffer + 12 * first * (bufwidth / 2));
+            });
             break;
         case V4L2_PIX_FMT_RGB24:
         case V4L2_PIX_FMT_RGB555:
@@ -846,12 +903,27 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
         case V4L2_PIX_FMT_SBGGR16:
             break;
         default:
-            ccvt_420p_rgb24(bufwidth, bufheight, (void *)yuvBuffer, (void *)rgb24_buffer);
+            yuv420ToRGB();
             break;
     }
     return rgb24_buffer;
 }
 
+void V4L2_Builtin_Decoder::yuv420ToRGB()
+{
+    if ((bufwidth | bufheight) & 1)
+    {
+        ccvt_420p_rgb24(bufwidth, bufheight, (void *)yuvBuffer, (void *)rgb24_buffer);
+        return;
+    }
+
+    forEachRowPairs(bufheight / 2, [this](unsigned int first, unsigned int last)
+    {
+        ccvt_420p_rgb24_planes(bufwidth, 2 * (last - first), YBuf + 2 * first * bufwidth, UBuf + first * (bufwidth / 2),
+                               VBuf + first * (bufwidth / 2), rgb24_buffer + 6 * first * bufwidth);
+    });
+}
+
 int V4L2_Builtin_Decoder::getBpp()
 {
     return (int)(bpp);
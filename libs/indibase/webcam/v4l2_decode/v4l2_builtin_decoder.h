@@ -59,6 +59,12 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
         virtual void setQuantization(bool);
         virtual void setLinearization(bool);
 
+        /**
+         * @brief setThreads Number of threads converting large frames, by bands of rows.
+         * @param threads 0 for one per core (default), 1 to convert on the calling thread only.
+         */
+        void setThreads(unsigned int threads);
+
     protected:
         void init_supported_formats();
         std::map<unsigned int, struct format *> supported_formats;
@@ -66,6 +72,13 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
         void allocBuffers();
         void makeY();
         void makeLinearY();
+        // Call fn(first, last) on bands of the row pairs [0, pairs), in parallel for large frames
+        template <typename Fn>
+        void forEachRowPairs(unsigned int pairs, Fn fn) const;
+        // Linear value of each 8 bits Y for the current colorspace
+        void makeLinearLut();
+        // 4:2:0 planes to rgb24_buffer
+        void yuv420ToRGB();
 
         struct v4l2_crop crop;
         struct v4l2_format fmt;
@@ -82,6 +95,10 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
         unsigned char *colorBuffer;
         unsigned char *rgb24_buffer;
         float *linearBuffer;
+        float linearLut[256];
+        unsigned short linearLut16[256];
+        int linearLutColorspace {-1};
+        unsigned int threads {0};
         //unsigned char *cropbuf;
         unsigned int bufwidth;
         unsigned int bufheight;
@@ -0,0 +1,490 @@
+/**  INDI LIB
+ *   XISF image writer
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "xisfwriter.h"
+
+#include "sharedblob.h"
+#include "indimacros.h"
+#include "indithreadpool.h"
+#include "locale_compat.h"
+
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <set>
+
+namespace INDI
+{
+
+namespace
+{
+// Attachments start on a block boundary
+constexpr size_t BlockAlignment = 4096;
+
+// Keeps lz4 inputs below LZ4_MAX_INPUT_SIZE
+constexpr size_t MaxSubblockSize = 1u << 30;
+
+// Runs fn(first, last) on count items split over threads
+template <typename Fn>
+void forEachRange(size_t count, int threads, Fn fn)
+{
+    ThreadPool::global().forEach(count, 1, fn, static_cast<size_t>(std::max(threads, 1)));
+}
+
+std::string escape(const std::string &text)
+{
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+            case '&':
+                out += "&amp;";
+                break;
+            case '<':
+                out += "&lt;";
+                break;
+            case '>':
+                out += "&gt;";
+                break;
+            case '"':
+                out += "&quot;";
+                break;
+            case '\'':
+                out += "&apos;";
+                break;
+            default:
+                out += c;
+        }
+    }
+    return out;
+}
+
+// The XISF properties standing for FITS keywords, in the units of the XISF specification
+struct KeywordProperty
+{
+    const char *keyword;
+    const char *id;
+    const char *type;
+    double scale;
+};
+
+const KeywordProperty keywordProperties[] =
+{
+    { "OBJECT",   "Observation:Object:Name",          "String",    1 },
+    { "OBSERVER", "Observer:Name",                    "String",    1 },
+    { "TELESCOP", "Instrument:Telescope:Name",        "String",    1 },
+    { "INSTRUME", "Instrument:Camera:Name",           "String",    1 },
+    { "FILTER",   "Instrument:Filter:Name",           "String",    1 },
+    { "FOCALLEN", "Instrument:Telescope:FocalLength", "Float32",   0.001 },
+    { "APTDIA",   "Instrument:Telescope:Aperture",    "Float32",   0.001 },
+    { "EXPTIME",  "Instrument:ExposureTime",          "Float32",   1 },
+    { "CCD-TEMP", "Instrument:Sensor:Temperature",    "Float32",   1 },
+    { "PIXSIZE1", "Instrument:Sensor:XPixelSize",     "Float32",   1 },
+    { "PIXSIZE2", "Instrument:Sensor:YPixelSize",     "Float32",   1 },
+    { "XBINNING", "Instrument:Camera:XBinning",       "Int32",     1 },
+    { "YBINNING", "Instrument:Camera:YBinning",       "Int32",     1 },
+    { "GAIN",     "Instrument:Camera:Gain",           "Float32",   1 },
+    { "ISOSPEED", "Instrument:Camera:ISOSpeed",       "Int32",     1 },
+    { "FOCUSPOS", "Instrument:Focuser:Position",      "Float32",   1 },
+    { "RA",       "Observation:Center:RA",            "Float64",   1 },
+    { "DEC",      "Observation:Center:Dec",           "Float64",   1 },
+    { "EQUINOX",  "Observation:Equinox",              "Float64",   1 },
+    { "SITELAT",  "Observation:Location:Latitude",    "Float64",   1 },
+    { "SITELONG", "Observation:Location:Longitude",   "Float64",   1 },
+    { "DATE-OBS", "Observation:Time:Start",           "TimePoint", 1 },
+};
+
+// The Property element of keyword, empty if none stands for it or its value does not fit
+std::string keywordProperty(const FITSRecord &keyword, std::set<std::string> &ids)
+{
+    for (auto &property : keywordProperties)
+    {
+        if (keyword.key() != property.keyword || !ids.insert(property.id).second)
+            continue;
+
+        const std::string &text = keyword.valueString();
+        std::string type = property.type;
+        std::string xml = std::string("<Property id=\"") + property.id + "\" type=\"" + property.type + "\"";
+        if (type == "String")
+            return xml + ">" + escape(text) + "</Property>\n";
+        if (type == "TimePoint")
+            return xml + " value=\"" + escape(text) + (text.find('Z') == std::string::npos ? "Z" : "") + "\"/>\n";
+
+        double value = keyword.type() == FITSRecord::DOUBLE ? keyword.valueDouble() :
+                       keyword.type() == FITSRecord::LONGLONG ? keyword.valueInt() : 0;
+        if (keyword.type() == FITSRecord::STRING)
+        {
+            char *end = nullptr;
+            value = strtod(text.c_str(), &end);
+            if (end == text.c_str())
+                return std::string();
+        }
+
+        char number[32];
+        AutoCNumeric locale;
+        if (type == "Int32")
+            snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+        else
+            snprintf(number, sizeof(number), type == "Float32" ? "%.9g" : "%.17g", value * property.scale);
+        return xml + " value=\"" + number + "\"/>\n";
+    }
+    return std::string();
+}
+
+#ifdef HAVE_ZSTD
+// zstd only compresses on worker threads when built with ZSTD_MULTITHREAD
+bool zstdWorkersSupported()
+{
+    static const bool supported = []
+    {
+        ZSTD_CCtx *cctx = ZSTD_createCCtx();
+        bool rc = cctx && !ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, 2));
+        ZSTD_freeCCtx(cctx);
+        return rc;
+    }();
+    return supported;
+}
+#endif
+}
+
+XISFImageWriter::XISFImageWriter(uint32_t width, uint32_t height, uint32_t channels, int bpp) :
+    m_Width(width), m_Height(height), m_Channels(channels), m_BPP(bpp)
+{
+}
+
+void XISFImageWriter::setImageType(const std::string &type)
+{
+    m_ImageType = type;
+}
+
+void XISFImageWriter::setColorFilterArray(const std::string &pattern, int width, int height)
+{
+    m_CFAPattern = pattern;
+    m_CFAWidth   = width;
+    m_CFAHeight  = height;
+}
+
+void XISFImageWriter::setFITSKeywords(const std::vector<FITSRecord> &keywords)
+{
+    m_Keywords = keywords;
+}
+
+void XISFImageWriter::setCompression(Codec codec, int level, int threads, bool byteShuffle)
+{
+    m_Codec       = codec;
+    m_Level       = level;
+    m_Threads     = std::max(threads, 1);
+    m_ByteShuffle = byteShuffle;
+}
+
+bool XISFImageWriter::codecSupported(Codec codec)
+{
+    switch (codec)
+    {
+        case CODEC_NONE:
+        case CODEC_ZLIB:
+            return true;
+#ifdef HAVE_ZSTD
+        case CODEC_ZSTD:
+            return true;
+#endif
+#ifdef HAVE_LZ4
+        case CODEC_LZ4:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+size_t XISFImageWriter::compressBound(size_t size) const
+{
+    switch (m_Codec)
+    {
+        case CODEC_ZLIB:
+            return ::compressBound(size);
+#ifdef HAVE_ZSTD
+        case CODEC_ZSTD:
+            return ZSTD_compressBound(size);
+#endif
+#ifdef HAVE_LZ4
+        case CODEC_LZ4:
+            return LZ4_compressBound(static_cast<int>(size));
+#endif
+        default:
+            return size;
+    }
+}
+
+bool XISFImageWriter::compressBlock(const uint8_t *in, size_t size, uint8_t *out, size_t capacity, size_t *compressed,
+                                    bool multithreaded)
+{
+#ifndef HAVE_ZSTD
+    INDI_UNUSED(multithreaded);
+#endif
+    switch (m_Codec)
+    {
+        case CODEC_ZLIB:
+        {
+            uLongf length = capacity;
+            if (compress2(out, &length, in, size, std::min(std::max(m_Level, 1), 9)) != Z_OK)
+                return false;
+            *compressed = length;
+            return true;
+        }
+#ifdef HAVE_ZSTD
+        case CODEC_ZSTD:
+        {
+            ZSTD_CCtx *cctx = ZSTD_createCCtx();
+            if (cctx == nullptr)
+                return false;
+            ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, std::min(std::max(m_Level, 1), ZSTD_maxCLevel()));
+            if (multithreaded)
+                ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, m_Threads);
+            size_t rc = ZSTD_compress2(cctx, out, capacity, in, size);
+            ZSTD_freeCCtx(cctx);
+            if (ZSTD_isError(rc))
+                return false;
+            *compressed = rc;
+            return true;
+        }
+#endif
+#ifdef HAVE_LZ4
+        case CODEC_LZ4:
+        {
+            int rc = LZ4_compress_default(reinterpret_cast<const char *>(in), reinterpret_cast<char *>(out),
+                                          static_cast<int>(size), static_cast<int>(capacity));
+            if (rc <= 0)
+                return false;
+            *compressed = rc;
+            return true;
+        }
+#endif
+        default:
+            memcpy(out, in, size);
+            *compressed = size;
+            return true;
+    }
+}
+
+std::string XISFImageWriter::header(size_t position, size_t size,
+                                    const std::vector<std::pair<size_t, size_t>> &subblocks) const
+{
+    const char *sampleFormat = m_BPP == 8 ? "UInt8" : m_BPP == 16 ? "UInt16" : "UInt32";
+    size_t itemSize = m_BPP / 8;
+    size_t rawSize  = static_cast<size_t>(m_Width) * m_Height * m_Channels * itemSize;
+    bool shuffled   = m_ByteShuffle && itemSize > 1;
+
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<xisf version=\"1.0\" xmlns=\"http://www.pixinsight.com/xisf\" "
+                      "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+                      "xsi:schemaLocation=\"http://www.pixinsight.com/xisf http://pixinsight.com/xisf/xisf-1.0.xsd\">\n";
+
+    xml += "<Image geometry=\"" + std::to_string(m_Width) + ":" + std::to_string(m_Height) + ":" +
+           std::to_string(m_Channels) + "\" sampleFormat=\"" + sampleFormat + "\" colorSpace=\"" +
+           (m_Channels == 3 ? "RGB" : "Gray") + "\"";
+    if (!m_ImageType.empty())
+        xml += " imageType=\"" + escape(m_ImageType) + "\"";
+    xml += " location=\"attachment:" + std::to_string(position) + ":" + std::to_string(size) + "\"";
+
+    if (m_Codec != CODEC_NONE)
+    {
+        const char *codec = m_Codec == CODEC_ZLIB ? "zlib" : m_Codec == CODEC_ZSTD ? "zstd" : "lz4";
+        xml += std::string(" compression=\"") + codec + (shuffled ? "+sh:" : ":") + std::to_string(rawSize);
+        if (shuffled)
+            xml += ":" + std::to_string(itemSize);
+        xml += "\"";
+
+        if (subblocks.size() > 1)
+        {
+            xml += " subblocks=\"";
+            for (size_t i = 0; i < subblocks.size(); i++)
+                xml += (i ? ":" : "") + std::to_string(subblocks[i].first) + "," + std::to_string(subblocks[i].second);
+            xml += "\"";
+        }
+    }
+    xml += ">\n";
+
+    std::set<std::string> ids;
+    for (auto &keyword : m_Keywords)
+    {
+        std::string value = keyword.type() == FITSRecord::STRING ? "'" + keyword.valueString() + "'" : keyword.valueString();
+        xml += "<FITSKeyword name=\"" + escape(keyword.key()) + "\" value=\"" + escape(value) + "\" comment=\"" +
+               escape(keyword.comment()) + "\"/>\n";
+        xml += keywordProperty(keyword, ids);
+    }
+
+    if (!m_CFAPattern.empty())
+        xml += "<ColorFilterArray pattern=\"" + escape(m_CFAPattern) + "\" width=\"" + std::to_string(m_CFAWidth) +
+               "\" height=\"" + std::to_string(m_CFAHeight) + "\"/>\n";
+    xml += "</Image>\n";
+
+    char creationTime[32];
+    time_t now = time(nullptr);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(creationTime, sizeof(creationTime), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    xml += "<Metadata>\n"
+           "<Property id=\"XISF:CreationTime\" type=\"TimePoint\" value=\"" + std::string(creationTime) + "\"/>\n"
+           "<Property id=\"XISF:CreatorApplication\" type=\"String\">INDI</Property>\n"
+           "</Metadata>\n"
+           "</xisf>";
+    return xml;
+}
+
+bool XISFImageWriter::write(const void *pixels, void **data, size_t *size)
+{
+    *data = nullptr;
+    *size = 0;
+
+    if (m_BPP != 8 && m_BPP != 16 && m_BPP != 32)
+    {
+        m_Error = "Unsupported bits per pixel value " + std::to_string(m_BPP);
+        return false;
+    }
+    if (!codecSupported(m_Codec))
+    {
+        m_Error = "Compression codec is not supported by this build";
+        return false;
+    }
+
+    size_t itemSize = m_BPP / 8;
+    size_t samples  = static_cast<size_t>(m_Width) * m_Height * m_Channels;
+    size_t rawSize  = samples * itemSize;
+    auto in         = static_cast<const uint8_t *>(pixels);
+    if (rawSize == 0)
+    {
+        m_Error = "Empty image";
+        return false;
+    }
+
+    // Byte planes compress far better than interleaved samples
+    std::unique_ptr<uint8_t[]> shuffled;
+    if (m_Codec != CODEC_NONE && m_ByteShuffle && itemSize > 1)
+    {
+        shuffled.reset(new uint8_t[rawSize]);
+        uint8_t *out = shuffled.get();
+        forEachRange(samples, m_Threads, [ = ](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; i++)
+                for (size_t b = 0; b < itemSize; b++)
+                    out[b * samples + i] = in[i * itemSize + b];
+        });
+        in = out;
+    }
+
+    // One block compressed by zstd workers, or subblocks compressed in parallel
+    bool multithreaded = false;
+#ifdef HAVE_ZSTD
+    multithreaded = m_Codec == CODEC_ZSTD && m_Threads > 1 && zstdWorkersSupported();
+#endif
+    size_t blocks = m_Codec == CODEC_NONE || multithreaded ? 1 : static_cast<size_t>(m_Threads);
+    if (m_Codec != CODEC_NONE)
+        blocks = std::max(blocks, (rawSize + MaxSubblockSize - 1) / MaxSubblockSize);
+    blocks = std::max<size_t>(1, std::min(blocks, rawSize));
+    size_t blockSize = (rawSize + blocks - 1) / blocks;
+    blocks = std::max<size_t>(1, (rawSize + blockSize - 1) / std::max<size_t>(blockSize, 1));
+
+    std::vector<std::pair<size_t, size_t>> subblocks(blocks);
+    std::vector<size_t> offsets(blocks);
+    size_t capacity = 0;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        size_t length = std::min(blockSize, rawSize - i * blockSize);
+        subblocks[i]  = { compressBound(length), length };
+        offsets[i]    = capacity;
+        capacity += subblocks[i].first;
+    }
+
+    // The header is written last, once the sizes are known, into room left for its largest version
+    size_t position = (16 + header(999999999999ull, capacity, subblocks).size() + BlockAlignment - 1) / BlockAlignment *
+                      BlockAlignment;
+    auto file = static_cast<uint8_t *>(IDSharedBlobAlloc(position + capacity));
+    if (file == nullptr)
+    {
+        m_Error = "Not enough memory for the XISF file";
+        return false;
+    }
+    uint8_t *attachment = file + position;
+
+    bool ok = true;
+    if (blocks == 1)
+        ok = compressBlock(in, rawSize, attachment, capacity, &subblocks[0].first, multithreaded);
+    else
+    {
+        std::vector<char> blockOk(blocks, 0);
+        forEachRange(blocks, static_cast<int>(blocks), [&](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; i++)
+                blockOk[i] = compressBlock(in + i * blockSize, subblocks[i].second, attachment + offsets[i], subblocks[i].first,
+                                           &subblocks[i].first, false);
+        });
+        ok = std::all_of(blockOk.begin(), blockOk.end(), [](char rc)
+        {
+            return rc != 0;
+        });
+
+        // Close the gaps left by the bounds
+        size_t end = subblocks[0].first;
+        for (size_t i = 1; ok && i < blocks; i++)
+        {
+            memmove(attachment + end, attachment + offsets[i], subblocks[i].first);
+            end += subblocks[i].first;
+        }
+    }
+    if (!ok)
+    {
+        IDSharedBlobFree(file);
+        m_Error = "Failed to compress the XISF data block";
+        return false;
+    }
+
+    size_t attachmentSize = 0;
+    for (auto &subblock : subblocks)
+        attachmentSize += subblock.first;
+
+    std::string xml = header(position, attachmentSize, subblocks);
+    uint32_t headerLength = xml.size();
+    memcpy(file, "XISF0100", 8);
+    for (int i = 0; i < 4; i++)
+        file[8 + i] = (headerLength >> (8 * i)) & 0xff;
+    memset(file + 12, 0, 4);
+    memcpy(file + 16, xml.data(), xml.size());
+    memset(file + 16 + xml.size(), 0, position - 16 - xml.size());
+
+    *data = file;
+    *size = position + attachmentSize;
+    return true;
+}
+
+}
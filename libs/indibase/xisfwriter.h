@@ -0,0 +1,119 @@
+/**  INDI LIB
+ *   XISF image writer
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+#include "fitskeyword.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The XISFImageWriter class encodes a single image as a monolithic XISF 1.0 file.
+ *
+ * The pixels are byte shuffled and compressed on several threads straight into a shared blob
+ * which holds the whole file, ready to be uploaded. zstd uses its own worker threads when the
+ * library supports them, otherwise the data block is split into subblocks compressed in parallel,
+ * as zlib and lz4 always are.
+ */
+class XISFImageWriter
+{
+    public:
+        enum Codec
+        {
+            CODEC_NONE,
+            CODEC_ZLIB,
+            CODEC_ZSTD,
+            CODEC_LZ4
+        };
+
+        /**
+         * @param width image width in pixels
+         * @param height image height in pixels
+         * @param channels 1 for gray, 3 for planar RGB
+         * @param bpp 8, 16 or 32 bits unsigned samples
+         */
+        XISFImageWriter(uint32_t width, uint32_t height, uint32_t channels, int bpp);
+
+        /**
+         * @param type XISF image type, e.g. Light, Bias, Dark or Flat.
+         */
+        void setImageType(const std::string &type);
+        void setColorFilterArray(const std::string &pattern, int width, int height);
+
+        /**
+         * @brief setFITSKeywords Write the keywords as FITSKeyword elements. Those that stand for an XISF
+         * property, like OBJECT, EXPTIME or DATE-OBS, are written as that Property too.
+         */
+        void setFITSKeywords(const std::vector<FITSRecord> &keywords);
+
+        /**
+         * @brief setCompression Compress the data block.
+         * @param codec codec, must be supported by the build.
+         * @param level codec compression level, clamped to its range.
+         * @param threads number of threads compressing.
+         * @param byteShuffle byte shuffle samples wider than 8 bits first, which helps compression a lot.
+         */
+        void setCompression(Codec codec, int level, int threads, bool byteShuffle = true);
+
+        /**
+         * @brief write Encode the image.
+         * @param pixels width * height * channels samples.
+         * @param data set to a buffer from IDSharedBlobAlloc holding the file, free it with IDSharedBlobFree.
+         * @param size set to the file size.
+         * @return True on success, false otherwise with errorMessage() set.
+         */
+        bool write(const void *pixels, void **data, size_t *size);
+
+        const std::string &errorMessage() const
+        {
+            return m_Error;
+        }
+
+        /**
+         * @return True if the build supports codec.
+         */
+        static bool codecSupported(Codec codec);
+
+    private:
+        std::string header(size_t position, size_t size, const std::vector<std::pair<size_t, size_t>> &subblocks) const;
+        size_t compressBound(size_t size) const;
+        bool compressBlock(const uint8_t *in, size_t size, uint8_t *out, size_t capacity, size_t *compressed, bool multithreaded);
+
+        uint32_t m_Width;
+        uint32_t m_Height;
+        uint32_t m_Channels;
+        int m_BPP;
+        std::string m_ImageType;
+        std::string m_CFAPattern;
+        int m_CFAWidth {0};
+        int m_CFAHeight {0};
+        std::vector<FITSRecord> m_Keywords;
+        Codec m_Codec {CODEC_NONE};
+        int m_Level {0};
+        int m_Threads {1};
+        bool m_ByteShuffle {true};
+        std::string m_Error;
+};
+
+}
@@ -27,6 +27,7 @@
 #define MAXFD_PER_MESSAGE 16 /* No more than 16 buffer attached to a message */
 
 #ifdef ENABLE_INDI_SHARED_MEMORY
+# include "sharedblob.h"
 # include "sharedblob_parse.h"
 # include <sys/socket.h>
 # include <sys/un.h>
@@ -219,6 +220,14 @@ void TcpSocketSharedBlobs::readyRead()
 BaseClientPrivate::BaseClientPrivate(BaseClient *parent)
     : AbstractBaseClientPrivate(parent)
 {
+    // BLOBs are decoded as they arrive, setBLOB adopts the buffers
+#ifdef ENABLE_INDI_SHARED_MEMORY
+    // in shared memory, so that their views can be handed to other processes
+    xmlParser.setBlobDecoding(IDSharedBlobRealloc, IDSharedBlobFree);
+#else
+    xmlParser.setBlobDecoding(realloc, free);
+#endif
+
     clientSocket.onData([this](const char *data, size_t size)
     {
         char msg[MAXRBUF];
@@ -233,7 +242,7 @@ BaseClientPrivate::BaseClientPrivate(BaseClient *parent)
             return;
         }
 
-        for (const auto &doc : documents)
+        for (auto &doc : documents)
         {
             LilXmlElement root = doc.root();
 
@@ -241,15 +250,29 @@ BaseClientPrivate::BaseClientPrivate(BaseClient *parent)
                 root.print(stderr, 0);
 
 #ifdef ENABLE_INDI_SHARED_MEMORY
-            ClientSharedBlobs::Blobs blobs;
+            std::unique_ptr<ClientSharedBlobs::Blobs> blobs(new ClientSharedBlobs::Blobs);
 
-            if (!clientSocket.sharedBlobs.parseAttachedBlobs(root, blobs))
+            if (!clientSocket.sharedBlobs.parseAttachedBlobs(root, *blobs))
             {
                 IDLog("Missing attachment from %s/%d\n", cServer.c_str(), cPort);
                 return;
             }
 #endif
 
+            if (asyncBlobs)
+            {
+                BaseDevice device = blobDevice(root);
+                if (device.isValid())
+                {
+                    PendingBlob blob(device, std::move(doc));
+#ifdef ENABLE_INDI_SHARED_MEMORY
+                    blob.blobs = std::move(blobs);
+#endif
+                    queueBlob(std::move(blob));
+                    continue;
+                }
+            }
+
             int err_code = dispatchCommand(root, msg);
 
             if (err_code < 0)
@@ -283,6 +306,76 @@ ssize_t BaseClientPrivate::sendData(const void *data, size_t size)
     return clientSocket.write(static_cast<const char *>(data), size);
 }
 
+void BaseClientPrivate::blobModesChanged(bool wantsBlobs)
+{
+    clientSocket.setSocketProfile(wantsBlobs ? TcpSocket::BulkProfile : TcpSocket::ControlProfile);
+}
+
+BaseDevice BaseClientPrivate::blobDevice(const LilXmlElement &root)
+{
+    static const char *setBLOBVector = internXMLName("setBLOBVector");
+
+    if (tagXMLEle(root.handle()) != setBLOBVector)
+        return BaseDevice();
+
+    // Only BLOBs of known properties, anything else takes the regular path and its error handling
+    BaseDevice device = watchDevice.getDeviceByName(root.getAttribute("device"));
+    if (!device.isValid() || !device.getProperty(root.getAttribute("name"), INDI_BLOB).isValid())
+        return BaseDevice();
+    return device;
+}
+
+void BaseClientPrivate::queueBlob(PendingBlob &&blob)
+{
+    // The worker may take it as soon as it is in
+    std::lock_guard<std::mutex> lock(blobLock);
+    pendingBlobs.push_back(std::move(blob));
+    if (!blobThread.joinable())
+        blobThread = std::thread(&BaseClientPrivate::blobWorker, this);
+    blobWakeup.notify_one();
+}
+
+void BaseClientPrivate::blobWorker()
+{
+    char msg[MAXRBUF];
+    std::unique_lock<std::mutex> lock(blobLock);
+    while (!blobQuit)
+    {
+        if (pendingBlobs.empty())
+        {
+            blobWakeup.wait(lock);
+            continue;
+        }
+
+        PendingBlob blob = std::move(pendingBlobs.front());
+        pendingBlobs.pop_front();
+        lock.unlock();
+
+        LilXmlElement root = blob.document.root();
+        if (blob.device.setValue(root, msg) < 0)
+        {
+            IDLog("Dispatch command error: %s\n", msg);
+            root.print(stderr, 0);
+        }
+        else
+            batchPropertyUpdated(root);
+
+        lock.lock();
+    }
+}
+
+void BaseClientPrivate::stopBlobWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(blobLock);
+        blobQuit = true;
+        pendingBlobs.clear();
+    }
+    blobWakeup.notify_one();
+    if (blobThread.joinable())
+        blobThread.join();
+}
+
 // BaseClient
 
 BaseClient::BaseClient()
@@ -292,6 +385,7 @@ BaseClient::BaseClient()
 BaseClient::~BaseClient()
 {
     D_PTR(BaseClient);
+    d->stopBlobWorker();
     d->clear();
 }
 
@@ -357,6 +451,12 @@ bool BaseClient::disconnectServer(int exit_code)
     return ret;
 }
 
+void BaseClient::enableAsyncBlobDelivery(bool enable)
+{
+    D_PTR(BaseClient);
+    d->asyncBlobs = enable;
+}
+
 void BaseClient::enableDirectBlobAccess(const char * dev, const char * prop)
 {
 #ifdef ENABLE_INDI_SHARED_MEMORY
@@ -81,4 +81,11 @@ class INDI::BaseClient : public INDI::AbstractBaseClient
          *  @param prop property name, can be NULL to activate for all property of dev
          */
         void enableDirectBlobAccess(const char * dev = nullptr, const char * prop = nullptr);
+
+        /** @brief Process setBLOBVector messages on a separate thread.
+         * BLOB properties are then updated, and updateProperty() called for them, from that thread in the
+         * order they arrived, while other messages keep being handled as soon as they are parsed.
+         * @param enable True to deliver BLOBs from the separate thread, false to handle them in place.
+         */
+        void enableAsyncBlobDelivery(bool enable = true);
 };
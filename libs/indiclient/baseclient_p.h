@@ -1,10 +1,17 @@
 #pragma once
 
 #include "abstractbaseclient_p.h"
+#include "basedevice.h"
 #include "indililxml.h"
 
 #include <tcpsocket.h>
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 namespace INDI
 {
 
@@ -60,6 +67,37 @@ class BaseClientPrivate : public AbstractBaseClientPrivate
 
     public:
         ssize_t sendData(const void *data, size_t size) override;
+        void blobModesChanged(bool wantsBlobs) override;
+
+    public:
+        struct PendingBlob
+        {
+            PendingBlob(const BaseDevice &device, LilXmlDocument &&document)
+                : device(device), document(std::move(document))
+            { }
+
+            BaseDevice device;
+            LilXmlDocument document;
+#ifdef ENABLE_INDI_SHARED_MEMORY
+            std::unique_ptr<ClientSharedBlobs::Blobs> blobs;
+#endif
+        };
+
+        /** @brief The device of a setBLOBVector the BLOB thread can take, invalid if it has to be dispatched in place */
+        BaseDevice blobDevice(const LilXmlElement &root);
+
+        /** @brief Hand a setBLOBVector, complete with its attachments, to the BLOB thread */
+        void queueBlob(PendingBlob &&blob);
+
+        void blobWorker();
+        void stopBlobWorker();
+
+        bool asyncBlobs {false};
+        std::mutex blobLock;
+        std::condition_variable blobWakeup;
+        std::deque<PendingBlob> pendingBlobs;
+        std::thread blobThread;
+        bool blobQuit {false};
 
 #ifdef ENABLE_INDI_SHARED_MEMORY
         TcpSocketSharedBlobs clientSocket;
@@ -0,0 +1,667 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fitsdecompress.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+namespace
+{
+
+const size_t blockSize = 2880;
+const size_t cardSize = 80;
+
+size_t blocks(uint64_t bytes)
+{
+    return (bytes + blockSize - 1) / blockSize * blockSize;
+}
+
+uint64_t getBE(const uint8_t *p, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value = value << 8 | p[i];
+    return value;
+}
+
+void trimRight(std::string &value)
+{
+    value.erase(value.find_last_not_of(' ') + 1);
+}
+
+// Cards of a header, and the values of its keywords, the first one of each
+struct Header
+{
+    std::vector<const char *> cards;
+    std::map<std::string, std::string> values;
+    size_t end {0};
+
+    bool has(const std::string &key) const
+    {
+        return values.count(key) != 0;
+    }
+
+    std::string text(const std::string &key) const
+    {
+        auto it = values.find(key);
+        return it == values.end() ? std::string() : it->second;
+    }
+
+    long long number(const std::string &key, long long fallback) const
+    {
+        auto it = values.find(key);
+        if (it == values.end())
+            return fallback;
+        char *stop = nullptr;
+        long long value = strtoll(it->second.c_str(), &stop, 10);
+        return stop == it->second.c_str() ? fallback : value;
+    }
+};
+
+std::string keyOf(const char *card)
+{
+    std::string key(card, 8);
+    trimRight(key);
+    return key;
+}
+
+bool valueOf(const char *card, std::string &value)
+{
+    if (card[8] != '=' || card[9] != ' ')
+        return false;
+
+    const char *p = card + 10, *end = card + cardSize;
+    while (p < end && *p == ' ')
+        p++;
+    value.clear();
+    if (p < end && *p == '\'')
+    {
+        // Quotes in strings are doubled
+        for (++p; p < end; ++p)
+        {
+            if (*p == '\'')
+            {
+                if (p + 1 < end && p[1] == '\'')
+                {
+                    value += *p++;
+                    continue;
+                }
+                break;
+            }
+            value += *p;
+        }
+    }
+    else
+        value.assign(p, std::find(p, end, '/'));
+    trimRight(value);
+    return true;
+}
+
+bool readHeader(const uint8_t *data, size_t size, size_t offset, Header &header)
+{
+    for (size_t at = offset; at + cardSize <= size; at += cardSize)
+    {
+        const char *card = reinterpret_cast<const char *>(data + at);
+        std::string key = keyOf(card);
+        if (key == "END")
+        {
+            header.end = offset + blocks(at + cardSize - offset);
+            return header.end <= size;
+        }
+        header.cards.push_back(card);
+        std::string value;
+        if (!key.empty() && !header.has(key) && valueOf(card, value))
+            header.values[key] = value;
+    }
+    return false;
+}
+
+// Keywords of the structure of the HDUs or of the compression, not copied to the plain file
+bool isStructural(const std::string &key)
+{
+    static const char *const keys[] =
+    {
+        "SIMPLE", "BITPIX", "NAXIS", "EXTEND", "XTENSION", "PCOUNT", "GCOUNT", "TFIELDS", "THEAP", "EXTNAME",
+        "CHECKSUM", "DATASUM", "ZIMAGE", "ZSIMPLE", "ZBITPIX", "ZNAXIS", "ZCMPTYPE", "ZEXTEND", "ZBLOCKED",
+        "ZPCOUNT", "ZGCOUNT", "ZHECKSUM", "ZDATASUM", "ZTENSION", "ZQUANTIZ", "ZDITHER0"
+    };
+    static const char *const indexed[] =
+    {
+        "NAXIS", "ZNAXIS", "ZTILE", "ZNAME", "ZVAL", "TTYPE", "TFORM", "TUNIT", "TDIM", "TSCAL", "TZERO", "TNULL", "TDISP"
+    };
+
+    for (const char *name : keys)
+        if (key == name)
+            return true;
+    for (const char *prefix : indexed)
+    {
+        size_t length = strlen(prefix);
+        if (key.size() > length && !key.compare(0, length, prefix) &&
+                key.find_first_not_of("0123456789", length) == std::string::npos)
+            return true;
+    }
+    return false;
+}
+
+std::string makeCard(const char *key, const std::string &value)
+{
+    char card[cardSize + 1];
+    snprintf(card, sizeof(card), "%-8.8s= %20s", key, value.c_str());
+    std::string result(card);
+    result.resize(cardSize, ' ');
+    return result;
+}
+
+// Bytes of an element of a binary table column type
+int typeSize(char type)
+{
+    switch (type)
+    {
+        case 'L':
+        case 'X':
+        case 'B':
+        case 'A':
+            return 1;
+        case 'I':
+            return 2;
+        case 'J':
+        case 'E':
+            return 4;
+        case 'K':
+        case 'D':
+        case 'C':
+        case 'P':
+            return 8;
+        case 'M':
+        case 'Q':
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+enum Codec { RICE, GZIP1, GZIP2, NONE };
+
+// A tile compressed image, the tiles in the rows of a binary table
+struct Compressed
+{
+    int bitpix {0};
+    int pixelBytes {0};
+    uint64_t axes[3] {1, 1, 1};
+    uint64_t tile[3] {1, 1, 1};
+    uint64_t tiles[3] {1, 1, 1};
+    uint64_t tileCount {0};
+
+    Codec codec {RICE};
+    int riceBlock {32};
+    int ricePixel {4};
+
+    const uint8_t *rows {nullptr};
+    uint64_t rowBytes {0};
+    uint64_t column {0};
+    bool longDescriptors {false};
+    int elementSize {1};
+    const uint8_t *heap {nullptr};
+    uint64_t heapSize {0};
+
+    std::vector<std::string> cards;
+    size_t headerBytes {0};
+    uint64_t dataBytes {0};
+};
+
+bool parse(const uint8_t *data, size_t size, Compressed &image)
+{
+    if (size < blockSize || memcmp(data, "SIMPLE  =", 9))
+        return false;
+
+    Header primary;
+    if (!readHeader(data, size, 0, primary))
+        return false;
+
+    // A null primary array usually, fpack moves the image to the first extension
+    uint64_t primaryBytes = 0;
+    if (primary.number("NAXIS", 0) > 0)
+    {
+        primaryBytes = std::abs(primary.number("BITPIX", 8)) / 8;
+        for (long long i = 1; i <= primary.number("NAXIS", 0); i++)
+            primaryBytes *= primary.number("NAXIS" + std::to_string(i), 0);
+    }
+
+    Header table;
+    size_t tableStart = primary.end + blocks(primaryBytes);
+    if (tableStart >= size || !readHeader(data, size, tableStart, table))
+        return false;
+    if (table.text("XTENSION") != "BINTABLE" || table.text("ZIMAGE") != "T")
+        return false;
+
+    image.bitpix = static_cast<int>(table.number("ZBITPIX", 0));
+    if (image.bitpix != 8 && image.bitpix != 16 && image.bitpix != 32)
+        return false;
+    image.pixelBytes = image.bitpix / 8;
+
+    long long naxis = table.number("ZNAXIS", 0);
+    if (naxis < 1 || naxis > 3)
+        return false;
+    image.tileCount = 1;
+    image.dataBytes = image.pixelBytes;
+    for (int i = 0; i < naxis; i++)
+    {
+        std::string n = std::to_string(i + 1);
+        long long axis = table.number("ZNAXIS" + n, 0);
+        long long tile = table.number("ZTILE" + n, i == 0 ? axis : 1);
+        if (axis <= 0 || tile <= 0)
+            return false;
+        image.axes[i] = axis;
+        image.tile[i] = std::min(tile, axis);
+        image.tiles[i] = (image.axes[i] + image.tile[i] - 1) / image.tile[i];
+        image.tileCount *= image.tiles[i];
+        image.dataBytes *= image.axes[i];
+    }
+
+    std::string codec = table.text("ZCMPTYPE");
+    if (codec == "RICE_1" || codec == "RICE_ONE")
+        image.codec = RICE;
+    else if (codec == "GZIP_1")
+        image.codec = GZIP1;
+    else if (codec == "GZIP_2")
+        image.codec = GZIP2;
+    else if (codec == "NOCOMPRESS")
+        image.codec = NONE;
+    else
+        return false;
+    for (int i = 1; table.has("ZNAME" + std::to_string(i)); i++)
+    {
+        std::string name = table.text("ZNAME" + std::to_string(i));
+        long long value = table.number("ZVAL" + std::to_string(i), 0);
+        if (name == "BLOCKSIZE")
+            image.riceBlock = static_cast<int>(value);
+        else if (name == "BYTEPIX")
+            image.ricePixel = static_cast<int>(value);
+    }
+    if (image.riceBlock <= 0 || (image.ricePixel != 1 && image.ricePixel != 2 && image.ricePixel != 4))
+        return false;
+
+    // The descriptors of the tiles, in the compressed data column
+    long long fields = table.number("TFIELDS", 0);
+    bool found = false;
+    for (long long i = 1; i <= fields && !found; i++)
+    {
+        std::string form = table.text("TFORM" + std::to_string(i));
+        size_t letter = form.find_first_not_of("0123456789");
+        if (letter == std::string::npos)
+            return false;
+        long long repeat = letter == 0 ? 1 : atoll(form.c_str());
+        char type = form[letter];
+        if (table.text("TTYPE" + std::to_string(i)) == "COMPRESSED_DATA")
+        {
+            if ((type != 'P' && type != 'Q') || letter + 1 >= form.size() || typeSize(form[letter + 1]) == 0)
+                return false;
+            image.longDescriptors = type == 'Q';
+            image.elementSize = typeSize(form[letter + 1]);
+            found = true;
+        }
+        else if (typeSize(type) == 0)
+            return false;
+        else
+            image.column += type == 'X' ? (repeat + 7) / 8 : repeat * typeSize(type);
+    }
+
+    image.rowBytes = table.number("NAXIS1", 0);
+    uint64_t rowCount = table.number("NAXIS2", 0);
+    uint64_t heapStart = table.number("THEAP", image.rowBytes * rowCount);
+    image.heapSize = table.number("PCOUNT", 0);
+    if (!found || rowCount != image.tileCount || image.column + (image.longDescriptors ? 16 : 8) > image.rowBytes ||
+            heapStart < image.rowBytes * rowCount || table.end + heapStart + image.heapSize > size)
+        return false;
+    image.rows = data + table.end;
+    image.heap = image.rows + heapStart;
+
+    // The plain header: the image structure, then the keywords of both headers
+    image.cards.push_back(makeCard("SIMPLE", "T"));
+    image.cards.push_back(makeCard("BITPIX", std::to_string(image.bitpix)));
+    image.cards.push_back(makeCard("NAXIS", std::to_string(naxis)));
+    for (int i = 0; i < naxis; i++)
+        image.cards.push_back(makeCard(("NAXIS" + std::to_string(i + 1)).c_str(), std::to_string(image.axes[i])));
+    for (const Header *header : {&primary, &table})
+        for (const char *card : header->cards)
+            if (!isStructural(keyOf(card)))
+                image.cards.emplace_back(card, cardSize);
+    image.cards.push_back(std::string("END").append(cardSize - 3, ' '));
+    image.headerBytes = blocks(image.cards.size() * cardSize);
+    return true;
+}
+
+// Rice decoding as in cfitsio, values modulo the bits of the pixels
+bool riceDecode(const uint8_t *in, size_t size, uint32_t *out, uint64_t count, int blockLength, int bytepix)
+{
+    int fsbits, fsmax, bbits;
+    switch (bytepix)
+    {
+        case 1:
+            fsbits = 3, fsmax = 6, bbits = 8;
+            break;
+        case 2:
+            fsbits = 4, fsmax = 14, bbits = 16;
+            break;
+        default:
+            fsbits = 5, fsmax = 25, bbits = 32;
+            break;
+    }
+    const uint32_t mask = bbits == 32 ? 0xffffffffu : (1u << bbits) - 1;
+
+    const uint8_t *c = in, *end = in + size;
+    bool overrun = false;
+    auto next = [&]() -> uint64_t
+    {
+        if (c == end)
+        {
+            overrun = true;
+            return 0;
+        }
+        return *c++;
+    };
+
+    if (size < static_cast<size_t>(bytepix) + 1)
+        return false;
+    uint32_t last = static_cast<uint32_t>(getBE(c, bytepix));
+    c += bytepix;
+
+    uint64_t b = next();
+    int nbits = 8;
+    for (uint64_t i = 0; i < count && !overrun;)
+    {
+        nbits -= fsbits;
+        while (nbits < 0)
+        {
+            b = b << 8 | next();
+            nbits += 8;
+        }
+        int fs = static_cast<int>(b >> nbits) - 1;
+        b &= (uint64_t(1) << nbits) - 1;
+
+        uint64_t blockEnd = std::min<uint64_t>(i + blockLength, count);
+        if (fs < 0)
+        {
+            // Low entropy: the block repeats the last pixel
+            for (; i < blockEnd; i++)
+                out[i] = last;
+        }
+        else if (fs == fsmax)
+        {
+            // High entropy: the differences in full
+            for (; i < blockEnd; i++)
+            {
+                int k = bbits - nbits;
+                uint64_t diff = b << k;
+                for (k -= 8; k >= 0; k -= 8)
+                    diff |= next() << k;
+                if (nbits > 0)
+                {
+                    b = next();
+                    diff |= b >> (-k);
+                    b &= (uint64_t(1) << nbits) - 1;
+                }
+                else
+                    b = 0;
+                uint32_t value = static_cast<uint32_t>(diff) & mask;
+                value = (value & 1) ? ~(value >> 1) : value >> 1;
+                last = out[i] = (value + last) & mask;
+            }
+        }
+        else if (fs > fsmax)
+            return false;
+        else
+        {
+            for (; i < blockEnd; i++)
+            {
+                // Quotient in unary, ended by a one, then the fs low bits
+                while (b == 0 && !overrun)
+                {
+                    nbits += 8;
+                    b = next();
+                }
+                int length = 0;
+                while (b >> length)
+                    length++;
+                int zeros = nbits - length;
+                nbits -= zeros + 1;
+                b ^= uint64_t(1) << nbits;
+                nbits -= fs;
+                while (nbits < 0)
+                {
+                    b = b << 8 | next();
+                    nbits += 8;
+                }
+                uint32_t value = static_cast<uint32_t>((uint64_t(zeros) << fs) | (b >> nbits)) & mask;
+                b &= (uint64_t(1) << nbits) - 1;
+                value = (value & 1) ? ~(value >> 1) : value >> 1;
+                last = out[i] = (value + last) & mask;
+            }
+        }
+    }
+    return !overrun;
+}
+
+bool inflateTile(const uint8_t *in, size_t size, uint8_t *out, size_t outSize)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // gzip or zlib headers
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+        return false;
+    stream.next_in = const_cast<Bytef *>(in);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = out;
+    stream.avail_out = static_cast<uInt>(outSize);
+    int rc = ::inflate(&stream, Z_FINISH);
+    bool ok = rc == Z_STREAM_END && stream.total_out == outSize;
+    inflateEnd(&stream);
+    return ok;
+}
+
+struct Job
+{
+    const Compressed &image;
+    uint8_t *data;
+    std::atomic<uint64_t> next {0};
+    std::atomic_bool failed {false};
+
+    explicit Job(const Compressed &image, uint8_t *data) : image(image), data(data) {}
+};
+
+// Scratch buffers of a thread
+struct Scratch
+{
+    std::vector<uint32_t> values;
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> shuffled;
+};
+
+bool decodeTile(Job &job, uint64_t index, Scratch &scratch)
+{
+    const Compressed &image = job.image;
+    const int pb = image.pixelBytes;
+
+    const uint8_t *descriptor = image.rows + index * image.rowBytes + image.column;
+    int width = image.longDescriptors ? 8 : 4;
+    uint64_t length = getBE(descriptor, width) * image.elementSize;
+    uint64_t offset = getBE(descriptor + width, width);
+    if (offset > image.heapSize || length > image.heapSize - offset)
+        return false;
+    const uint8_t *in = image.heap + offset;
+
+    uint64_t origin[3], extent[3];
+    uint64_t rest = index;
+    for (int i = 0; i < 3; i++)
+    {
+        origin[i] = rest % image.tiles[i] * image.tile[i];
+        extent[i] = std::min(image.tile[i], image.axes[i] - origin[i]);
+        rest /= image.tiles[i];
+    }
+    uint64_t pixels = extent[0] * extent[1] * extent[2];
+    size_t bytes = pixels * pb;
+
+    // Whole rows of the image, and whole planes if more than one: decoded in place
+    uint64_t start = ((origin[2] * image.axes[1] + origin[1]) * image.axes[0] + origin[0]) * pb;
+    bool inPlace = extent[0] == image.axes[0] && (extent[2] == 1 || extent[1] == image.axes[1]);
+    uint8_t *out = job.data + start;
+    if (!inPlace)
+    {
+        scratch.bytes.resize(bytes);
+        out = scratch.bytes.data();
+    }
+
+    switch (image.codec)
+    {
+        case RICE:
+        {
+            scratch.values.resize(pixels);
+            if (!riceDecode(in, length, scratch.values.data(), pixels, image.riceBlock, image.ricePixel))
+                return false;
+            int shift = 32 - 8 * image.ricePixel;
+            for (uint64_t i = 0; i < pixels; i++)
+            {
+                // Unsigned bytes, signed integers otherwise
+                uint32_t value = scratch.values[i];
+                if (image.ricePixel > 1)
+                    value = static_cast<uint32_t>(static_cast<int32_t>(value << shift) >> shift);
+                for (int k = 0; k < pb; k++)
+                    out[i * pb + k] = static_cast<uint8_t>(value >> (8 * (pb - 1 - k)));
+            }
+            break;
+        }
+        case GZIP1:
+            if (!inflateTile(in, length, out, bytes))
+                return false;
+            break;
+        case GZIP2:
+            // The bytes of the pixels by significance, the most significant first
+            scratch.shuffled.resize(bytes);
+            if (!inflateTile(in, length, scratch.shuffled.data(), bytes))
+                return false;
+            for (uint64_t i = 0; i < pixels; i++)
+                for (int k = 0; k < pb; k++)
+                    out[i * pb + k] = scratch.shuffled[k * pixels + i];
+            break;
+        case NONE:
+            if (length != bytes)
+                return false;
+            memcpy(out, in, bytes);
+            break;
+    }
+
+    if (!inPlace)
+    {
+        size_t run = extent[0] * pb;
+        for (uint64_t z = 0; z < extent[2]; z++)
+            for (uint64_t y = 0; y < extent[1]; y++)
+            {
+                uint64_t at = (((origin[2] + z) * image.axes[1] + origin[1] + y) * image.axes[0] + origin[0]) * pb;
+                memcpy(job.data + at, out + (z * extent[1] + y) * run, run);
+            }
+    }
+    return true;
+}
+
+void decodeTiles(Job &job)
+{
+    Scratch scratch;
+    for (;;)
+    {
+        uint64_t index = job.next++;
+        if (index >= job.image.tileCount || job.failed)
+            break;
+        if (!decodeTile(job, index, scratch))
+            job.failed = true;
+    }
+}
+
+}
+
+namespace INDI
+{
+namespace FitsDecompress
+{
+
+size_t unpackedSize(const void *data, size_t size)
+{
+    Compressed image;
+    if (data == nullptr || !parse(static_cast<const uint8_t *>(data), size, image))
+        return 0;
+    return image.headerBytes + blocks(image.dataBytes);
+}
+
+bool unpack(const void *data, size_t size, void *fits, size_t fitsSize, unsigned threads)
+{
+    Compressed image;
+    if (data == nullptr || !parse(static_cast<const uint8_t *>(data), size, image) ||
+            fitsSize < image.headerBytes + blocks(image.dataBytes))
+        return false;
+
+    uint8_t *out = static_cast<uint8_t *>(fits);
+    for (size_t i = 0; i < image.cards.size(); i++)
+        memcpy(out + i * cardSize, image.cards[i].data(), cardSize);
+    memset(out + image.cards.size() * cardSize, ' ', image.headerBytes - image.cards.size() * cardSize);
+
+    Job job(image, out + image.headerBytes);
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<uint64_t>(threads, image.tileCount));
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; i++)
+    {
+        try
+        {
+            workers.emplace_back(decodeTiles, std::ref(job));
+        }
+        catch (const std::system_error &)
+        {
+            // The calling thread works too, fewer threads only cost speed
+            break;
+        }
+    }
+    decodeTiles(job);
+    for (auto &worker : workers)
+        worker.join();
+
+    memset(out + image.headerBytes + image.dataBytes, 0, blocks(image.dataBytes) - image.dataBytes);
+    return !job.failed;
+}
+
+bool inflate(const void *data, size_t size, void *out, size_t outSize, size_t *outBytes)
+{
+    uLongf bytes = outSize;
+    if (uncompress(static_cast<Bytef *>(out), &bytes, static_cast<const Bytef *>(data), size) != Z_OK)
+        return false;
+    if (outBytes)
+        *outBytes = bytes;
+    return true;
+}
+
+}
+}
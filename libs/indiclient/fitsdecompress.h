@@ -0,0 +1,62 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Decompression of the compressed image BLOBs of INDI::CCD, without cfitsio.
+ *
+ * ".fits.fz" BLOBs are tile compressed FITS files, as written by fpack: the image is in a binary
+ * table, a compressed tile in each row. unpack() writes the plain FITS file the driver would have
+ * sent, the image as the primary HDU, decompressing the tiles on several threads straight into the
+ * buffer of the caller. Integer images are supported, with RICE_1, GZIP_1, GZIP_2 or NOCOMPRESS
+ * tiles: what fpack writes for lossless compression. Quantized floating point images are not.
+ *
+ *  size_t size = INDI::FitsDecompress::unpackedSize(blob, blobLen);
+ *  std::vector<uint8_t> fits(size);
+ *  if (size && INDI::FitsDecompress::unpack(blob, blobLen, fits.data(), fits.size()))
+ *      ...
+ *
+ * ".z" BLOBs are a single zlib stream, which cannot be split across threads: inflate() only saves
+ * the copy. INDI::BaseDevice already inflates them as they are received.
+ */
+namespace INDI
+{
+namespace FitsDecompress
+{
+
+/** @brief Size of the FITS file of a tile compressed one, 0 if data is not a supported one. */
+size_t unpackedSize(const void *data, size_t size);
+
+/**
+ * @brief Decompress a tile compressed FITS file.
+ * @param fits at least unpackedSize() bytes.
+ * @param threads threads decompressing tiles, the calling one included, 0 for one per core.
+ * @return false if data is not a supported tile compressed file, or is corrupted.
+ */
+bool unpack(const void *data, size_t size, void *fits, size_t fitsSize, unsigned threads = 0);
+
+/**
+ * @brief Inflate a zlib stream, of a ".z" BLOB.
+ * @param outSize the size of the BLOB before compression, as sent with it.
+ * @param outBytes set to the bytes inflated, if not null.
+ */
+bool inflate(const void *data, size_t size, void *out, size_t outSize, size_t *outBytes = nullptr);
+
+}
+}
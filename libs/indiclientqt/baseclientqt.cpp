@@ -23,6 +23,10 @@
 
 #include "abstractbaseclient.h"
 #include "abstractbaseclient_p.h"
+#include "sharedblob.h"
+
+#include <QMetaObject>
+
 namespace INDI
 {
 
@@ -37,17 +41,31 @@ ssize_t BaseClientQtPrivate::sendData(const void *data, size_t size)
     return clientSocket.write(static_cast<const char *>(data), size);
 }
 
-void BaseClientQtPrivate::listenINDI()
+void BaseClientQtPrivate::blobModesChanged(bool)
 {
-    char msg[MAXRBUF];
+    // Qt sizes its own buffers, only the small messages need to go without delay
+    clientSocket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+}
 
+void BaseClientQtPrivate::listenINDI()
+{
     if (sConnected == false)
         return;
 
     while (clientSocket.bytesAvailable() > 0)
     {
         const QByteArray data = clientSocket.readAll();
-        
+
+        if (parserContext != nullptr)
+        {
+            unsigned current = generation;
+            QMetaObject::invokeMethod(parserContext, [this, data, current]()
+            {
+                parseOnThread(data, current);
+            }, Qt::QueuedConnection);
+            continue;
+        }
+
         auto documents = xmlParser.parseChunk(data.constData(), data.size());
 
         if (documents.size() == 0)
@@ -59,28 +77,89 @@ void BaseClientQtPrivate::listenINDI()
             break;
         }
 
-        for (const auto &doc: documents)
-        {
-            LilXmlElement root = doc.root();
+        dispatchDocuments(documents);
+    }
+}
+
+void BaseClientQtPrivate::dispatchDocuments(const std::list<LilXmlDocument> &documents)
+{
+    char msg[MAXRBUF];
+
+    for (const auto &doc: documents)
+    {
+        LilXmlElement root = doc.root();
 
-            if (verbose)
-                    root.print(stderr, 0);
+        if (verbose)
+            root.print(stderr, 0);
 
-            int err_code = dispatchCommand(root, msg);
+        int err_code = dispatchCommand(root, msg);
 
-            if (err_code < 0)
+        if (err_code < 0)
+        {
+            // Silently ignore property duplication errors
+            if (err_code != INDI_PROPERTY_DUPLICATED)
             {
-                // Silently ignore property duplication errors
-                if (err_code != INDI_PROPERTY_DUPLICATED)
-                {
-                    IDLog("Dispatch command error(%d): %s\n", err_code, msg);
-                    root.print(stderr, 0);
-                }
+                IDLog("Dispatch command error(%d): %s\n", err_code, msg);
+                root.print(stderr, 0);
             }
         }
     }
 }
 
+void BaseClientQtPrivate::startParserThread()
+{
+    if (parserContext != nullptr)
+        return;
+
+    parserContext = new QObject;
+    parserContext->moveToThread(&parserThread);
+    parserThread.start();
+}
+
+void BaseClientQtPrivate::stopParserThread()
+{
+    if (parserContext == nullptr)
+        return;
+
+    // What was not dispatched yet is dropped along with the parser
+    generation++;
+    parserThread.quit();
+    parserThread.wait();
+    delete parserContext;
+    parserContext = nullptr;
+    threadParser.reset();
+}
+
+void BaseClientQtPrivate::parseOnThread(const QByteArray &data, unsigned current)
+{
+    // A new connection starts a new document
+    if (threadParser == nullptr || threadParserGeneration != current)
+    {
+        threadParser.reset(new LilXmlParser);
+        threadParser->setBlobDecoding(IDSharedBlobRealloc, IDSharedBlobFree);
+        threadParserGeneration = current;
+    }
+
+    auto documents = std::make_shared<std::list<LilXmlDocument>>(threadParser->parseChunk(data.constData(), data.size()));
+
+    if (documents->size() == 0)
+    {
+        if (threadParser->hasErrorMessage())
+        {
+            IDLog("Bad XML from %s/%d: %s\n%.*s\n", cServer.c_str(), cPort, threadParser->errorMessage(), data.size(), data.constData());
+        }
+        return;
+    }
+
+    // Queued in order to the thread of the client, which owns the devices
+    auto q = static_cast<BaseClientQt *>(parent);
+    QMetaObject::invokeMethod(q, [this, documents, current]()
+    {
+        if (sConnected && generation == current)
+            dispatchDocuments(*documents);
+    }, Qt::QueuedConnection);
+}
+
 // BaseClientQt
 
 BaseClientQt::BaseClientQt(QObject *parent)
@@ -115,9 +194,25 @@ BaseClientQt::BaseClientQt(QObject *parent)
 BaseClientQt::~BaseClientQt()
 {
     D_PTR(BaseClientQt);
+    d->stopParserThread();
     d->clear();
 }
 
+void BaseClientQt::setParserThread(bool enable)
+{
+    D_PTR(BaseClientQt);
+    if (enable)
+        d->startParserThread();
+    else
+        d->stopParserThread();
+}
+
+bool BaseClientQt::isParserThread() const
+{
+    D_PTR(const BaseClientQt);
+    return d->parserContext != nullptr;
+}
+
 bool BaseClientQt::connectServer()
 {
     D_PTR(BaseClientQt);
@@ -131,6 +226,7 @@ bool BaseClientQt::connectServer()
 
     d->clear();
 
+    d->generation++;
     d->sConnected = true;
 
     serverConnected();
@@ -148,6 +244,7 @@ bool BaseClientQt::disconnectServer(int exit_code)
         return true;
 
     d->sConnected = false;
+    d->generation++;
 
     d->clientSocket.close();
 
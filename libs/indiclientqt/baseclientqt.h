@@ -65,6 +65,19 @@ class INDI::BaseClientQt : public QObject, public INDI::AbstractBaseClient
          *  @return True if disconnection is successful, false otherwise.
          */
         bool disconnectServer(int exit_code = 0) override;
+
+        /** @brief Read the XML from the server on a thread of its own.
+         *  The data received is handed to that thread, which parses it and decodes the BLOBs, then the thread
+         *  of the client applies the messages and notifies the client, in the order they were received.
+         *  The thread of the client is left free for the user interface while many properties or large
+         *  BLOBs come in.
+         *  @param enable True to parse on the thread, false to parse on the thread of the client, the default.
+         *  @note Call it while disconnected.
+         */
+        void setParserThread(bool enable);
+
+        /** @return True if the XML is parsed on a thread of its own, see setParserThread(). */
+        bool isParserThread() const;
     
     private:
         void enableDirectBlobAccess(const char * dev = nullptr, const char * prop = nullptr) = delete; // not implemented
@@ -24,6 +24,11 @@
 #include "indililxml.h"
 
 #include <QTcpSocket>
+#include <QThread>
+
+#include <atomic>
+#include <list>
+#include <memory>
 
 namespace INDI
 {
@@ -36,13 +41,25 @@ class BaseClientQtPrivate : public AbstractBaseClientPrivate
 
     public:
         ssize_t sendData(const void *data, size_t size) override;
+        void blobModesChanged(bool wantsBlobs) override;
 
     public:
         void listenINDI();
+        void dispatchDocuments(const std::list<LilXmlDocument> &documents);
+
+        // parser thread, see BaseClientQt::setParserThread
+        void startParserThread();
+        void stopParserThread();
+        void parseOnThread(const QByteArray &data, unsigned generation);
 
     public:
         QTcpSocket clientSocket;
         LilXmlParser xmlParser;
 
+        QThread parserThread;
+        QObject *parserContext {nullptr};          // lives in parserThread, runs the parsing
+        std::unique_ptr<LilXmlParser> threadParser;  // only used from parserThread
+        unsigned threadParserGeneration {0};
+        std::atomic<unsigned> generation {0};        // connection the data belongs to
 };
 }
@@ -56,6 +56,303 @@
 
 #define  IS_LITTLE_ENDIAN  (!IS_BIG_ENDIAN)
 
+/* Vectorized loops over whole groups: 3 raw bytes <-> 4 base64 chars.
+ * The encoders return the number of raw bytes done, the decoder the number of
+ * groups done, stopping before anything that is not plain base64 (padding,
+ * newline, invalid char). The scalar loops below do the rest.
+ * On x86 the widest instruction set is picked at run time, NEON is used on aarch64.
+ */
+typedef int (*base64_enc_fn)(unsigned char *out, const unsigned char *in, int inlen);
+typedef int (*base64_dec_fn)(char *out, const char *in, int ngroups);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_X86
+#include <immintrin.h>
+
+/* spread 12 bytes to 16 6-bit values, one per byte (W. Mula, A. Klomp) */
+__attribute__((target("ssse3")))
+static inline __m128i enc_reshuffle_ssse3(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t0, t1);
+}
+
+/* 6-bit values to base64 digits */
+__attribute__((target("ssse3")))
+static inline __m128i enc_translate_ssse3(__m128i in)
+{
+    const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    __m128i indices   = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    indices           = _mm_sub_epi8(indices, _mm_cmpgt_epi8(in, _mm_set1_epi8(25)));
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+}
+
+__attribute__((target("ssse3")))
+static int enc_ssse3(unsigned char *out, const unsigned char *in, int inlen)
+{
+    int done = 0;
+    /* 16 bytes are read for 12 */
+    for (; inlen - done >= 16; done += 12, out += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + done));
+        _mm_storeu_si128((__m128i *)out, enc_translate_ssse3(enc_reshuffle_ssse3(v)));
+    }
+    return done;
+}
+
+__attribute__((target("avx2")))
+static int enc_avx2(unsigned char *out, const unsigned char *in, int inlen)
+{
+    const __m256i shuf = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                         10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i lut  = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                                          65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    int done = 0;
+    /* two lanes of 12 bytes, the second one loaded at +12 reads up to +28 */
+    for (; inlen - done >= 28; done += 24, out += 32)
+    {
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + done))),
+                                            _mm_loadu_si128((const __m128i *)(in + done + 12)), 1);
+        v = _mm256_shuffle_epi8(v, shuf);
+        const __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        const __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t0, t1);
+
+        __m256i indices = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        indices         = _mm256_sub_epi8(indices, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut, indices));
+
+        _mm256_storeu_si256((__m256i *)out, v);
+    }
+    return done;
+}
+
+/* 16 base64 chars to 12 bytes in the low part, 0 if one char is not a digit */
+__attribute__((target("ssse3")))
+static inline int dec_block_ssse3(__m128i *v)
+{
+    const __m128i lut_lo   = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi   = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f  = _mm_set1_epi8(0x2f);
+
+    __m128i str              = *v;
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+    const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+    const __m128i hi         = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m128i lo         = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())))
+        return 0;
+
+    const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+    str = _mm_add_epi8(str, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles)));
+
+    str = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+    str = _mm_madd_epi16(str, _mm_set1_epi32(0x00011000));
+    *v  = _mm_shuffle_epi8(str, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    return 1;
+}
+
+__attribute__((target("ssse3")))
+static int dec_ssse3(char *out, const char *in, int ngroups)
+{
+    int done = 0;
+    /* 16 bytes are written for 12, at least 2 more groups must follow */
+    for (; ngroups - done >= 4 + 2; done += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + 4 * done));
+        if (!dec_block_ssse3(&v))
+            break;
+        _mm_storeu_si128((__m128i *)(out + 3 * done), v);
+    }
+    return done;
+}
+
+__attribute__((target("avx2")))
+static int dec_avx2(char *out, const char *in, int ngroups)
+{
+    const __m256i lut_lo   = _mm256_broadcastsi128_si256(_mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A));
+    const __m256i lut_hi   = _mm256_broadcastsi128_si256(_mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10));
+    const __m256i lut_roll = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+    const __m256i shuf     = _mm256_broadcastsi128_si256(_mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    const __m256i mask_2f  = _mm256_set1_epi8(0x2f);
+
+    int done = 0;
+    /* 32 bytes are written for 24, at least 3 more groups must follow */
+    for (; ngroups - done >= 8 + 3; done += 8)
+    {
+        __m256i str              = _mm256_loadu_si256((const __m256i *)(in + 4 * done));
+        const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+        const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+        const __m256i hi         = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m256i lo         = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+
+        const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+        str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles)));
+
+        str = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        str = _mm256_madd_epi16(str, _mm256_set1_epi32(0x00011000));
+        str = _mm256_shuffle_epi8(str, shuf);
+        str = _mm256_permutevar8x32_epi32(str, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+        _mm256_storeu_si256((__m256i *)(out + 3 * done), str);
+    }
+    return done;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define BASE64_NEON
+#include <arm_neon.h>
+
+/* value of each ASCII char, 0xff if not a base64 digit */
+static const uint8_t neon_rbase64[128] =
+{
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static int enc_neon(unsigned char *out, const unsigned char *in, int inlen)
+{
+    uint8x16x4_t lut;
+    lut.val[0] = vld1q_u8((const uint8_t *)base64digits);
+    lut.val[1] = vld1q_u8((const uint8_t *)base64digits + 16);
+    lut.val[2] = vld1q_u8((const uint8_t *)base64digits + 32);
+    lut.val[3] = vld1q_u8((const uint8_t *)base64digits + 48);
+
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+    int done = 0;
+    for (; inlen - done >= 48; done += 48, out += 64)
+    {
+        uint8x16x3_t s = vld3q_u8(in + done);
+        uint8x16x4_t r;
+        r.val[0] = vshrq_n_u8(s.val[0], 2);
+        r.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(s.val[0], 4), vshrq_n_u8(s.val[1], 4)), mask);
+        r.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(s.val[1], 2), vshrq_n_u8(s.val[2], 6)), mask);
+        r.val[3] = vandq_u8(s.val[2], mask);
+
+        r.val[0] = vqtbl4q_u8(lut, r.val[0]);
+        r.val[1] = vqtbl4q_u8(lut, r.val[1]);
+        r.val[2] = vqtbl4q_u8(lut, r.val[2]);
+        r.val[3] = vqtbl4q_u8(lut, r.val[3]);
+        vst4q_u8(out, r);
+    }
+    return done;
+}
+
+static int dec_neon(char *out, const char *in, int ngroups)
+{
+    uint8x16x4_t lut_lo, lut_hi;
+    lut_lo.val[0] = vld1q_u8(neon_rbase64);
+    lut_lo.val[1] = vld1q_u8(neon_rbase64 + 16);
+    lut_lo.val[2] = vld1q_u8(neon_rbase64 + 32);
+    lut_lo.val[3] = vld1q_u8(neon_rbase64 + 48);
+    lut_hi.val[0] = vld1q_u8(neon_rbase64 + 64);
+    lut_hi.val[1] = vld1q_u8(neon_rbase64 + 80);
+    lut_hi.val[2] = vld1q_u8(neon_rbase64 + 96);
+    lut_hi.val[3] = vld1q_u8(neon_rbase64 + 112);
+
+    const uint8x16_t offset = vdupq_n_u8(0x40);
+    int done = 0;
+    for (; ngroups - done >= 16; done += 16)
+    {
+        uint8x16x4_t s = vld4q_u8((const uint8_t *)in + 4 * done);
+        uint8x16_t bad = vdupq_n_u8(0);
+        int i;
+
+        for (i = 0; i < 4; i++)
+        {
+            /* chars from 64 miss the first table and hit the second one */
+            uint8x16_t v = vqtbl4q_u8(lut_lo, s.val[i]);
+            v = vqtbx4q_u8(v, lut_hi, vsubq_u8(s.val[i], offset));
+            /* non ASCII chars and invalid values have the high bit set */
+            bad = vorrq_u8(bad, vorrq_u8(v, s.val[i]));
+            s.val[i] = v;
+        }
+        if (vmaxvq_u8(bad) & 0x80)
+            break;
+
+        uint8x16x3_t r;
+        r.val[0] = vorrq_u8(vshlq_n_u8(s.val[0], 2), vshrq_n_u8(s.val[1], 4));
+        r.val[1] = vorrq_u8(vshlq_n_u8(s.val[1], 4), vshrq_n_u8(s.val[2], 2));
+        r.val[2] = vorrq_u8(vshlq_n_u8(s.val[2], 6), s.val[3]);
+        vst3q_u8((uint8_t *)out + 3 * done, r);
+    }
+    return done;
+}
+#endif
+
+static int enc_select(unsigned char *out, const unsigned char *in, int inlen);
+static int dec_select(char *out, const char *in, int ngroups);
+
+static base64_enc_fn enc_simd = enc_select;
+static base64_dec_fn dec_simd = dec_select;
+
+static int enc_none(unsigned char *out, const unsigned char *in, int inlen)
+{
+    (void)out;
+    (void)in;
+    (void)inlen;
+    return 0;
+}
+
+static int dec_none(char *out, const char *in, int ngroups)
+{
+    (void)out;
+    (void)in;
+    (void)ngroups;
+    return 0;
+}
+
+/* pick the loops for this CPU, once */
+static void base64_select(void)
+{
+    base64_enc_fn enc = enc_none;
+    base64_dec_fn dec = dec_none;
+
+#if defined(BASE64_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        enc = enc_avx2;
+        dec = dec_avx2;
+    }
+    else if (__builtin_cpu_supports("ssse3"))
+    {
+        enc = enc_ssse3;
+        dec = dec_ssse3;
+    }
+#elif defined(BASE64_NEON)
+    enc = enc_neon;
+    dec = dec_neon;
+#endif
+
+    enc_simd = enc;
+    dec_simd = dec;
+}
+
+static int enc_select(unsigned char *out, const unsigned char *in, int inlen)
+{
+    base64_select();
+    return enc_simd(out, in, inlen);
+}
+
+static int dec_select(char *out, const char *in, int ngroups)
+{
+    base64_select();
+    return dec_simd(out, in, ngroups);
+}
+
 /* convert inlen raw bytes at in to base64 string (NUL-terminated) at out. 
  * out size should be at least 4*inlen/3 + 4.
  * return length of out (sans trailing NUL).
@@ -78,7 +375,11 @@ int to64frombits(unsigned char *out, const unsigned char *in, int inlen)
 {
     uint16_t *b64lut = (uint16_t *)base64lut;
     int dlen         = ((inlen + 2) / 3) * 4; /* 4/3, rounded up */
-    uint16_t *wbuf   = (uint16_t *)out;
+    int done         = enc_simd(out, in, inlen);
+    uint16_t *wbuf   = (uint16_t *)(out + done / 3 * 4);
+
+    in += done;
+    inlen -= done;
 
     for (; inlen > 2; inlen -= 3)
     {
@@ -131,6 +432,17 @@ int from64tobits_fast(char *out, const char *in, int inlen)
 
     for (j = 0; j < n; j++)
     {
+        /* as many groups as possible at once, one by one from a newline or padding */
+        int k = dec_simd(out, in, n - j);
+        if (k)
+        {
+            in += 4 * k;
+            out += 3 * k;
+            j += k;
+            if (j == n)
+                break;
+        }
+
         if (in[0] == '\n')
             in++;
         inp = (uint16_t *)in;
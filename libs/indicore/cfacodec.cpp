@@ -0,0 +1,341 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "cfacodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace INDI
+{
+namespace CFACodec
+{
+
+/* Stream layout, integers little endian:
+ *   "ICFA", version, bpp, flags, 0, width (4 bytes), height (4 bytes)
+ * then the residuals in raster order, by blocks of blockLength: the Rice parameter k of the block
+ * in 5 bits, then for each residual its quotient in unary (zeros ended by a one) and its k low bits.
+ * A quotient of escapeLength zeros or more is written as escapeLength zeros and the raw residual.
+ */
+static const uint8_t magic[4] = {'I', 'C', 'F', 'A'};
+static const uint8_t version = 1;
+static const uint8_t flagBayer = 1;
+static const size_t headerLength = 16;
+static const int blockLength = 32;
+static const int parameterBits = 5;
+static const int escapeLength = 20;
+
+namespace
+{
+
+class BitWriter
+{
+    public:
+        BitWriter(uint8_t *out, uint8_t *end) : out(out), end(end) {}
+
+        // n <= 32
+        void put(uint32_t value, int n)
+        {
+            acc = (acc << n) | value;
+            bits += n;
+            while (bits >= 8)
+            {
+                bits -= 8;
+                if (out == end)
+                {
+                    overflow = true;
+                    return;
+                }
+                *out++ = static_cast<uint8_t>(acc >> bits);
+            }
+            acc &= (uint64_t(1) << bits) - 1;
+        }
+
+        // Pads the last byte with zeros
+        void flush()
+        {
+            if (bits > 0)
+                put(0, 8 - bits);
+        }
+
+        uint8_t *out;
+        uint8_t *end;
+        bool overflow {false};
+
+    private:
+        uint64_t acc {0};
+        int bits {0};
+};
+
+class BitReader
+{
+    public:
+        BitReader(const uint8_t *data, size_t size) : p(data), end(data + size), size(size) {}
+
+        uint32_t get(int n)
+        {
+            if (n == 0)
+                return 0;
+            refill();
+            uint32_t value = static_cast<uint32_t>(acc >> (64 - n));
+            acc <<= n;
+            bits -= n;
+            return value;
+        }
+
+        // Leading zeros, the one ending them consumed, or limit if there are that many
+        int zeros(int limit)
+        {
+            refill();
+            int count = leadingZeros(acc);
+            if (count >= limit)
+            {
+                acc <<= limit;
+                bits -= limit;
+                return limit;
+            }
+            acc <<= count + 1;
+            bits -= count + 1;
+            return count;
+        }
+
+        // false if more was read than there is
+        bool valid() const
+        {
+            return (read * 8 - bits) <= size * 8;
+        }
+
+    private:
+        void refill()
+        {
+            while (bits <= 56)
+            {
+                uint64_t byte = p < end ? *p++ : 0;
+                acc |= byte << (56 - bits);
+                bits += 8;
+                read++;
+            }
+        }
+
+        static int leadingZeros(uint64_t value)
+        {
+            if (value == 0)
+                return 64;
+#if defined(__GNUC__)
+            return __builtin_clzll(value);
+#else
+            int count = 0;
+            while (!(value & (uint64_t(1) << 63)))
+            {
+                value <<= 1;
+                count++;
+            }
+            return count;
+#endif
+        }
+
+        const uint8_t *p;
+        const uint8_t *end;
+        size_t size;
+        size_t read {0};
+        uint64_t acc {0};
+        int bits {0};
+};
+
+void putLE32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint32_t getLE32(const uint8_t *in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (uint32_t(in[3]) << 24);
+}
+
+/* Median edge detector of LOCO-I, on the neighbours of the same colour: left, above and above left,
+ * step pixels away. Along the first rows and columns of a plane, the one neighbour there is */
+template <typename T>
+inline uint32_t predict(const T *row, const T *up, uint32_t x, uint32_t step)
+{
+    if (up == nullptr)
+        return x >= step ? row[x - step] : 0;
+    if (x < step)
+        return up[x];
+
+    int a = row[x - step], b = up[x], c = up[x - step];
+    if (c >= std::max(a, b))
+        return std::min(a, b);
+    if (c <= std::min(a, b))
+        return std::max(a, b);
+    return a + b - c;
+}
+
+// Smallest k with the block mean below 2^(k+1)
+inline int riceParameter(const uint32_t *values, int count, int bpp)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < count; i++)
+        sum += values[i];
+    int k = 0;
+    while (k < bpp && (uint64_t(count) << (k + 1)) <= sum)
+        k++;
+    return k;
+}
+
+void putBlock(BitWriter &writer, const uint32_t *values, int count, int bpp)
+{
+    int k = riceParameter(values, count, bpp);
+    writer.put(k, parameterBits);
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t q = values[i] >> k;
+        if (q < static_cast<uint32_t>(escapeLength))
+        {
+            writer.put(1, q + 1);
+            if (k > 0)
+                writer.put(values[i] & ((uint32_t(1) << k) - 1), k);
+        }
+        else
+        {
+            writer.put(0, escapeLength);
+            writer.put(values[i], bpp);
+        }
+    }
+}
+
+template <typename T>
+bool compressPixels(const T *pixels, uint32_t width, uint32_t height, int bpp, uint32_t step, BitWriter &writer)
+{
+    const int32_t half = 1 << (bpp - 1);
+    const int32_t mask = (1 << bpp) - 1;
+    uint32_t block[blockLength];
+    int count = 0;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const T *row = pixels + size_t(y) * width;
+        const T *up = y >= step ? row - size_t(step) * width : nullptr;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            // Residual modulo 2^bpp, centered, then zigzag to an unsigned
+            int32_t e = ((static_cast<int32_t>(row[x]) - static_cast<int32_t>(predict(row, up, x, step)) + half) & mask) - half;
+            block[count++] = e >= 0 ? uint32_t(e) << 1 : (uint32_t(-e) << 1) - 1;
+            if (count == blockLength)
+            {
+                putBlock(writer, block, count, bpp);
+                count = 0;
+                if (writer.overflow)
+                    return false;
+            }
+        }
+    }
+    if (count > 0)
+        putBlock(writer, block, count, bpp);
+    writer.flush();
+    return !writer.overflow;
+}
+
+template <typename T>
+bool decompressPixels(BitReader &reader, T *pixels, uint32_t width, uint32_t height, int bpp, uint32_t step)
+{
+    const uint32_t mask = (uint32_t(1) << bpp) - 1;
+    int k = 0, left = 0;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        T *row = pixels + size_t(y) * width;
+        const T *up = y >= step ? row - size_t(step) * width : nullptr;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            if (left == 0)
+            {
+                k = reader.get(parameterBits);
+                if (k > bpp)
+                    return false;
+                left = blockLength;
+            }
+            left--;
+
+            uint32_t u;
+            int q = reader.zeros(escapeLength);
+            if (q < escapeLength)
+                u = (uint32_t(q) << k) | reader.get(k);
+            else
+                u = reader.get(bpp);
+
+            int32_t e = (u & 1) ? -static_cast<int32_t>((u + 1) >> 1) : static_cast<int32_t>(u >> 1);
+            row[x] = static_cast<T>((predict(row, up, x, step) + e) & mask);
+        }
+        if (!reader.valid())
+            return false;
+    }
+    return true;
+}
+
+}
+
+size_t compressBound(uint32_t width, uint32_t height, int bpp)
+{
+    uint64_t pixels = uint64_t(width) * height;
+    uint64_t blocks = (pixels + blockLength - 1) / blockLength;
+    return headerLength + (blocks * parameterBits + pixels * (escapeLength + std::max(bpp, 0)) + 7) / 8;
+}
+
+size_t compress(const void *pixels, uint32_t width, uint32_t height, int bpp, bool bayer, uint8_t *out, size_t outSize)
+{
+    if ((bpp != 8 && bpp != 16) || outSize < headerLength)
+        return 0;
+
+    memcpy(out, magic, sizeof(magic));
+    out[4] = version;
+    out[5] = static_cast<uint8_t>(bpp);
+    out[6] = bayer ? flagBayer : 0;
+    out[7] = 0;
+    putLE32(out + 8, width);
+    putLE32(out + 12, height);
+
+    BitWriter writer(out + headerLength, out + outSize);
+    uint32_t step = bayer ? 2 : 1;
+    bool ok = bpp == 8 ? compressPixels(static_cast<const uint8_t *>(pixels), width, height, bpp, step, writer)
+                : compressPixels(static_cast<const uint16_t *>(pixels), width, height, bpp, step, writer);
+    return ok ? static_cast<size_t>(writer.out - out) : 0;
+}
+
+size_t decodedSize(const uint8_t *data, size_t size)
+{
+    if (size < headerLength || memcmp(data, magic, sizeof(magic)) || data[4] != version || (data[5] != 8 && data[5] != 16))
+        return 0;
+    return size_t(getLE32(data + 8)) * getLE32(data + 12) * (data[5] / 8);
+}
+
+bool decompress(const uint8_t *data, size_t size, void *pixels, size_t pixelsSize)
+{
+    size_t frameSize = decodedSize(data, size);
+    if (frameSize == 0 || pixelsSize < frameSize)
+        return false;
+
+    int bpp = data[5];
+    uint32_t step = (data[6] & flagBayer) ? 2 : 1;
+    uint32_t width = getLE32(data + 8), height = getLE32(data + 12);
+
+    BitReader reader(data + headerLength, size - headerLength);
+    return bpp == 8 ? decompressPixels(reader, static_cast<uint8_t *>(pixels), width, height, bpp, step)
+           : decompressPixels(reader, static_cast<uint16_t *>(pixels), width, height, bpp, step);
+}
+
+}
+}
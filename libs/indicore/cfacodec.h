@@ -0,0 +1,55 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Lossless codec of raw frames, sent with a ".cfa" suffix to the BLOB format.
+ *
+ * Each pixel is predicted from its neighbours of the same colour, two pixels away on a 2x2 colour
+ * filter array, one away for a mono frame: this is the prediction within the planes of the CFA
+ * channels, without splitting the frame. Residuals are Rice coded by blocks, each with its own
+ * parameter. The colour of each plane does not matter to the coding, so the stream does not
+ * record the Bayer pattern or its offsets: they travel with the frame as usual.
+ *
+ * Pixels are 8 or 16 bits, in host order as drivers hand them.
+ */
+namespace INDI
+{
+namespace CFACodec
+{
+
+/** @brief Largest compressed size of a frame, to size the output buffer. */
+size_t compressBound(uint32_t width, uint32_t height, int bpp);
+
+/**
+ * @brief Compress a frame.
+ * @param pixels width x height pixels of bpp bits, rows packed.
+ * @param bayer true for a 2x2 colour filter array, false for a mono frame.
+ * @return the compressed size, or 0 if out is too small or bpp is neither 8 nor 16.
+ */
+size_t compress(const void *pixels, uint32_t width, uint32_t height, int bpp, bool bayer, uint8_t *out, size_t outSize);
+
+/** @brief Size of the frame in data, 0 if data is not a CFA stream. */
+size_t decodedSize(const uint8_t *data, size_t size);
+
+/** @brief Decompress data to pixels, of at least decodedSize bytes. @return false if data is corrupted. */
+bool decompress(const uint8_t *data, size_t size, void *pixels, size_t pixelsSize);
+
+}
+}
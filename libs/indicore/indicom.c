@@ -30,6 +30,7 @@
 #include "indidevapi.h"
 #include "locale_compat.h"
 #include "base64.h"
+#include "numberformat.h"
 
 #include "config.h"
 
@@ -40,8 +41,10 @@
 #include <libnova/transform.h>
 #endif // HAVE_LIBNOVA
 
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <math.h>
 #include <stdarg.h>
 #include <stdint.h>
@@ -107,6 +110,24 @@ static int tty_generic_udp_format = 0;
 static int tty_sequence_number = 1;
 static int tty_clear_trailing_lf = 0;
 
+#define TTY_READ_AHEAD_FDS  1024
+#define TTY_READ_AHEAD_SIZE 512
+
+/* Bytes read past the stop char of a section, kept for the next read of the fd */
+typedef struct
+{
+    int start;
+    int end;
+    char data[TTY_READ_AHEAD_SIZE];
+} tty_read_ahead_buffer;
+
+static tty_read_ahead_buffer *tty_read_ahead[TTY_READ_AHEAD_FDS];
+
+static tty_read_ahead_buffer *tty_read_ahead_of(int fd)
+{
+    return (fd >= 0 && fd < TTY_READ_AHEAD_FDS) ? tty_read_ahead[fd] : NULL;
+}
+
 #if defined(HAVE_LIBNOVA)
 int extractISOTime(const char *timestr, struct ln_date *iso_date)
 {
@@ -128,6 +149,33 @@ int extractISOTime(const char *timestr, struct ln_date *iso_date)
 }
 #endif
 
+/* write the len characters of str into out, right aligned on w spaces or left aligned on -w */
+static char *sexa_field(char *out, const char *str, int len, int w)
+{
+    int pad = (w < 0 ? -w : w) - len;
+
+    /* out is MAXINDIFORMAT long */
+    if (pad > MAXINDIFORMAT / 2)
+        pad = MAXINDIFORMAT / 2;
+
+    if (w > 0)
+        for (; pad > 0; pad--)
+            *out++ = ' ';
+    memcpy(out, str, len);
+    out += len;
+    for (; pad > 0; pad--)
+        *out++ = ' ';
+    return out;
+}
+
+/* write v, 0 <= v < 100, on 2 digits */
+static char *sexa_2digits(char *out, int v)
+{
+    *out++ = (char)('0' + v / 10);
+    *out++ = (char)('0' + v % 10);
+    return out;
+}
+
 /* sprint the variable a in sexagesimal format into out[].
  * w is the number of spaces for the whole part.
  * fracbase is the number of pieces a whole is to broken into; valid options:
@@ -141,7 +189,10 @@ int extractISOTime(const char *timestr, struct ln_date *iso_date)
 int fs_sexa(char *out, double a, int w, int fracbase)
 {
     char *out0 = out;
+    char whole[16];
+    char *digits = whole + sizeof(whole);
     unsigned long n;
+    long v, uv;
     int d;
     int f;
     int m;
@@ -160,39 +211,69 @@ int fs_sexa(char *out, double a, int w, int fracbase)
 
     /* form the whole part; "negative 0" is a special case */
     if (isneg && d == 0)
-        out += snprintf(out, MAXINDIFORMAT, "%*s-0", w - 2, "");
+    {
+        out = sexa_field(out, "", 0, w - 2);
+        *out++ = '-';
+        *out++ = '0';
+    }
     else
-        out += snprintf(out, MAXINDIFORMAT, "%*d", w, isneg ? -d : d);
+    {
+        v = isneg ? -(long)d : d;
+        for (uv = v < 0 ? -v : v; digits == whole + sizeof(whole) || uv != 0; uv /= 10)
+            *--digits = (char)('0' + uv % 10);
+        if (v < 0)
+            *--digits = '-';
+        out = sexa_field(out, digits, (int)(whole + sizeof(whole) - digits), w);
+    }
 
     /* do the rest */
     switch (fracbase)
     {
     case 60: /* dd:mm */
         m = f / (fracbase / 60);
-        out += snprintf(out, MAXINDIFORMAT, ":%02d", m);
+        *out++ = ':';
+        out = sexa_2digits(out, m);
         break;
     case 600: /* dd:mm.m */
-        out += snprintf(out, MAXINDIFORMAT, ":%02d.%1d", f / 10, f % 10);
+        *out++ = ':';
+        out = sexa_2digits(out, f / 10);
+        *out++ = '.';
+        *out++ = (char)('0' + f % 10);
         break;
     case 3600: /* dd:mm:ss */
         m = f / (fracbase / 60);
         s = f % (fracbase / 60);
-        out += snprintf(out, MAXINDIFORMAT, ":%02d:%02d", m, s);
+        *out++ = ':';
+        out = sexa_2digits(out, m);
+        *out++ = ':';
+        out = sexa_2digits(out, s);
         break;
     case 36000: /* dd:mm:ss.s*/
         m = f / (fracbase / 60);
         s = f % (fracbase / 60);
-        out += snprintf(out, MAXINDIFORMAT, ":%02d:%02d.%1d", m, s / 10, s % 10);
+        *out++ = ':';
+        out = sexa_2digits(out, m);
+        *out++ = ':';
+        out = sexa_2digits(out, s / 10);
+        *out++ = '.';
+        *out++ = (char)('0' + s % 10);
         break;
     case 360000: /* dd:mm:ss.ss */
         m = f / (fracbase / 60);
         s = f % (fracbase / 60);
-        out += snprintf(out, MAXINDIFORMAT, ":%02d:%02d.%02d", m, s / 100, s % 100);
+        *out++ = ':';
+        out = sexa_2digits(out, m);
+        *out++ = ':';
+        out = sexa_2digits(out, s / 100);
+        *out++ = '.';
+        out = sexa_2digits(out, s % 100);
         break;
     default:
+        *out = '\0';
         printf("fs_sexa: unknown fracbase: %d\n", fracbase);
         return -1;
     }
+    *out = '\0';
 
     return (int)(out - out0);
 }
@@ -205,6 +286,10 @@ int fs_sexa(char *out, double a, int w, int fracbase)
 int f_scansexa(const char *str0, /* input string */
                double *dp)       /* cracked value, if return 0 */
 {
+    /* most are plain numbers */
+    if (indi_scan_number(str0, dp) == 0)
+        return (0);
+
     locale_char_t *orig = indi_locale_C_numeric_push();
 
     double a = 0, b = 0, c = 0;
@@ -251,6 +336,36 @@ int f_scansexa(const char *str0, /* input string */
     return (0);
 }
 
+int fs_ieee754(char *out, double a)
+{
+    static const char digits[] = "0123456789abcdef";
+    uint64_t bits;
+
+    memcpy(&bits, &a, sizeof(bits));
+    for (int i = 15; i >= 0; i--, bits >>= 4)
+        out[i] = digits[bits & 0xf];
+    out[16] = '\0';
+    return 16;
+}
+
+int f_scanieee754(const char *str, double *dp)
+{
+    uint64_t bits = 0;
+    int n = 0;
+
+    while (isspace((unsigned char)*str))
+        str++;
+    for (; isxdigit((unsigned char)*str); str++, n++)
+        bits = (bits << 4) | (uint64_t)(isdigit((unsigned char)*str) ? *str - '0' : (tolower((unsigned char)*str) - 'a' + 10));
+    while (isspace((unsigned char)*str))
+        str++;
+
+    if (n != 16 || *str)
+        return (-1);
+    memcpy(dp, &bits, sizeof(bits));
+    return (0);
+}
+
 void getSexComponents(double value, int *d, int *m, int *s)
 {
     *d = (int32_t)fabs(value);
@@ -284,13 +399,96 @@ void getSexComponentsIID(double value, int *d, int *m, double *s)
         *d *= -1;
 }
 
+/* read an int as sscanf %d would, advancing *str past it. return 0 if ok, -1 if there is none */
+static int scan_int(const char **str, int *v)
+{
+    const char *p = *str;
+    int neg = 0;
+    long n = 0;
+
+    while (isspace((unsigned char)*p))
+        p++;
+    if (*p == '-' || *p == '+')
+        neg = (*p++ == '-');
+    if (!isdigit((unsigned char)*p))
+        return (-1);
+    for (; isdigit((unsigned char)*p); p++)
+        if (n < INT_MAX)
+            n = n * 10 + (*p - '0');
+    *v = (int)(neg ? -n : n);
+    *str = p;
+    return (0);
+}
+
+/* printf the value with the one conversion of format, converted to what it takes. return length,
+ * an empty string for formats that do not take one number
+ */
+static int format_number_printf(char *buf, const char *format, double value)
+{
+    const char *p = format;
+    char conversion = '\0';
+    int longs = 0;
+
+    for (; *p != '\0'; p++)
+    {
+        if (*p != '%')
+            continue;
+        if (p[1] == '%')
+        {
+            p++;
+            continue;
+        }
+        /* a second conversion would read past the value */
+        if (conversion != '\0')
+            conversion = '?';
+        else
+        {
+            for (p++; *p != '\0' && strchr("-+ #0", *p) != NULL; p++);
+            for (; isdigit((unsigned char)*p) || *p == '.'; p++);
+            for (; *p == 'h' || *p == 'l' || *p == 'L'; p++)
+                longs += (*p == 'l') ? 1 : (*p == 'L') ? 2 : 0;
+            if (*p == '\0')
+            {
+                conversion = '?';
+                break;
+            }
+            conversion = *p;
+        }
+    }
+
+    switch (conversion)
+    {
+    case '\0':
+        return (snprintf(buf, MAXINDIFORMAT, format, value));
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        if (longs >= 2)
+            return (snprintf(buf, MAXINDIFORMAT, format, (long double)value));
+        return (snprintf(buf, MAXINDIFORMAT, format, value));
+    case 'd': case 'i': case 'c':
+        if (longs >= 2)
+            return (snprintf(buf, MAXINDIFORMAT, format, (long long)value));
+        if (longs == 1)
+            return (snprintf(buf, MAXINDIFORMAT, format, (long)value));
+        return (snprintf(buf, MAXINDIFORMAT, format, (int)value));
+    case 'o': case 'u': case 'x': case 'X':
+        if (longs >= 2)
+            return (snprintf(buf, MAXINDIFORMAT, format, (unsigned long long)(long long)value));
+        if (longs == 1)
+            return (snprintf(buf, MAXINDIFORMAT, format, (unsigned long)(long)value));
+        return (snprintf(buf, MAXINDIFORMAT, format, (unsigned int)(int)value));
+    default:
+        buf[0] = '\0';
+        return (0);
+    }
+}
+
 /* fill buf with properly formatted INumber string. return length */
 int numberFormat(char *buf, const char *format, double value)
 {
-    int w, f, s;
-    char m;
+    const char *p = format;
+    int w, f, s, len;
 
-    if (sscanf(format, "%%%d.%d%c", &w, &f, &m) == 3 && m == 'm')
+    if (*p++ == '%' && scan_int(&p, &w) == 0 && *p++ == '.' && scan_int(&p, &f) == 0 && *p == 'm')
     {
         /* INDI sexi format */
         switch (f)
@@ -305,8 +503,11 @@ int numberFormat(char *buf, const char *format, double value)
     }
     else
     {
-        /* normal printf format */
-        return (snprintf(buf, MAXINDIFORMAT, format, value));
+        /* normal printf format, the common ones without printf */
+        len = indi_format_printf(buf, MAXINDIFORMAT, format, value);
+        if (len >= 0)
+            return len;
+        return (format_number_printf(buf, format, value));
     }
 }
 
@@ -362,6 +563,28 @@ void tty_set_debug(int debug)
     tty_debug = debug;
 }
 
+/* Dump buf[start..end) in one write per block, stderr is unbuffered and a write per byte slows the device down */
+static void tty_dump(const char *func, const char *buf, int start, int end)
+{
+    char block[4096];
+    int len = 0;
+    int i;
+
+    for (i = start; i < end; i++)
+    {
+        if (len > (int)sizeof(block) - 128)
+        {
+            IDLog("%s", block);
+            len = 0;
+        }
+        len += snprintf(block + len, sizeof(block) - len, "%s: buffer[%d]=%#X (%c)\n", func, i, (unsigned char)buf[i], buf[i]);
+        if (len >= (int)sizeof(block))
+            len = sizeof(block) - 1;
+    }
+    if (len > 0)
+        IDLog("%s", block);
+}
+
 void tty_set_gemini_udp_format(int enabled)
 {
     tty_gemini_udp_format = enabled;
@@ -377,6 +600,27 @@ void tty_clr_trailing_read_lf(int enabled)
     tty_clear_trailing_lf = enabled;
 }
 
+void tty_set_read_ahead(int fd, int enabled)
+{
+    if (fd < 0 || fd >= TTY_READ_AHEAD_FDS)
+        return;
+
+    if (enabled && tty_read_ahead[fd] == NULL)
+        tty_read_ahead[fd] = (tty_read_ahead_buffer *)calloc(1, sizeof(tty_read_ahead_buffer));
+    else if (!enabled)
+    {
+        free(tty_read_ahead[fd]);
+        tty_read_ahead[fd] = NULL;
+    }
+}
+
+void tty_discard_read_ahead(int fd)
+{
+    tty_read_ahead_buffer *ahead = tty_read_ahead_of(fd);
+    if (ahead != NULL)
+        ahead->start = ahead->end = 0;
+}
+
 int tty_timeout(int fd, int timeout)
 {
     return tty_timeout_microseconds(fd, timeout, 0);
@@ -445,12 +689,11 @@ int tty_write(int fd, const char *buf, int nbytes, int *nbytes_written)
     int bytes_w     = 0;
     *nbytes_written = 0;
 
+    // A new command, the bytes left from the last reply are stale
+    tty_discard_read_ahead(fd);
+
     if (tty_debug)
-    {
-        int i = 0;
-        for (i = 0; i < nbytes; i++)
-            IDLog("%s: buffer[%d]=%#X (%c)\n", __FUNCTION__, i, (unsigned char)buf[i], buf[i]);
-    }
+        tty_dump(__FUNCTION__, buf, 0, nbytes);
 
     while (nbytes > 0)
     {
@@ -512,6 +755,22 @@ int tty_read_expanded(int fd, char *buf, int nbytes, long timeout_seconds, long
         numBytesToRead = nbytes + 8;
         buffer = geminiBuffer;
     }
+    else
+    {
+        tty_read_ahead_buffer *ahead = tty_read_ahead_of(fd);
+        if (ahead != NULL && ahead->start < ahead->end && tty_clear_trailing_lf && ahead->data[ahead->start] == 0x0A)
+            ahead->start++;
+        if (ahead != NULL && ahead->start < ahead->end)
+        {
+            int count = ahead->end - ahead->start;
+            if (count > numBytesToRead)
+                count = numBytesToRead;
+            memcpy(buffer, ahead->data + ahead->start, count);
+            ahead->start += count;
+            *nbytes_read += count;
+            numBytesToRead -= count;
+        }
+    }
 
     while (numBytesToRead > 0)
     {
@@ -526,9 +785,7 @@ int tty_read_expanded(int fd, char *buf, int nbytes, long timeout_seconds, long
         if (tty_debug)
         {
             IDLog("%d bytes read and %d bytes remaining...\n", bytesRead, numBytesToRead - bytesRead);
-            int i = 0;
-            for (i = *nbytes_read; i < (*nbytes_read + bytesRead); i++)
-                IDLog("%s: buffer[%d]=%#X (%c)\n", __FUNCTION__, i, (unsigned char)buf[i], buf[i]);
+            tty_dump(__FUNCTION__, buf, *nbytes_read, *nbytes_read + bytesRead);
         }
 
         if (*nbytes_read == 0 && tty_clear_trailing_lf && *buffer == 0x0A)
@@ -563,6 +820,60 @@ int tty_read_expanded(int fd, char *buf, int nbytes, long timeout_seconds, long
 #endif
 }
 
+/* Reads a section through the read ahead buffer of fd, nsize < 0 for no limit */
+static int tty_read_ahead_section(tty_read_ahead_buffer *ahead, int fd, char *buf, int nsize, char stop_char,
+                                  long timeout_seconds, long timeout_microseconds, int *nbytes_read)
+{
+    for (;;)
+    {
+        if (ahead->start == ahead->end)
+        {
+            int err = tty_timeout_microseconds(fd, timeout_seconds, timeout_microseconds);
+            if (err)
+                return err;
+
+            int bytesRead = read(fd, ahead->data, TTY_READ_AHEAD_SIZE);
+            if (bytesRead < 0)
+                return TTY_READ_ERROR;
+
+            ahead->start = 0;
+            ahead->end   = bytesRead;
+            continue;
+        }
+
+        char *first = ahead->data + ahead->start;
+        if (tty_clear_trailing_lf && *first == 0x0A && *nbytes_read == 0)
+        {
+            if (tty_debug)
+                IDLog("%s: Cleared LF char left in buf\n", __FUNCTION__);
+            ahead->start++;
+            if (stop_char == 0x0A)
+                return TTY_OK;
+            continue;
+        }
+
+        int available = ahead->end - ahead->start;
+        char *stop = (char *)memchr(first, stop_char, available);
+        int count = (stop != NULL) ? (int)(stop - first) + 1 : available;
+        if (nsize >= 0 && count > nsize - *nbytes_read)
+        {
+            count = nsize - *nbytes_read;
+            stop  = NULL;
+        }
+
+        memcpy(buf + *nbytes_read, first, count);
+        if (tty_debug)
+            tty_dump(__FUNCTION__, buf, *nbytes_read, *nbytes_read + count);
+        ahead->start += count;
+        *nbytes_read += count;
+
+        if (stop != NULL)
+            return TTY_OK;
+        else if (nsize >= 0 && *nbytes_read >= nsize)
+            return TTY_OVERFLOW;
+    }
+}
+
 int tty_read_section(int fd, char *buf, char stop_char, int timeout, int *nbytes_read)
 {
     return tty_read_section_expanded(fd, buf, stop_char, (long) timeout, (long) 0, nbytes_read);
@@ -633,6 +944,11 @@ int tty_read_section_expanded(int fd, char *buf, char stop_char, long timeout_se
             }
         }
     }
+    else if (tty_read_ahead_of(fd) != NULL)
+    {
+        return tty_read_ahead_section(tty_read_ahead_of(fd), fd, buf, -1, stop_char, timeout_seconds, timeout_microseconds,
+                                      nbytes_read);
+    }
     else
     {
         for (;;)
@@ -689,6 +1005,9 @@ int tty_nread_section(int fd, char *buf, int nsize, char stop_char, int timeout,
     if (tty_debug)
         IDLog("%s: Request to read until stop char '%#02X' with %d timeout for fd %d\n", __FUNCTION__, stop_char, timeout, fd);
 
+    if (tty_read_ahead_of(fd) != NULL)
+        return tty_read_ahead_section(tty_read_ahead_of(fd), fd, buf, nsize, stop_char, timeout, 0, nbytes_read);
+
     for (;;)
     {
         if ((err = tty_timeout(fd, timeout)))
@@ -1159,6 +1478,7 @@ int tty_disconnect(int fd)
 #else
     int err;
     tcflush(fd, TCIOFLUSH);
+    tty_set_read_ahead(fd, 0);
     err = close(fd);
 
     if (err != 0)
@@ -282,6 +282,20 @@ void tty_set_gemini_udp_format(int enabled);
 void tty_set_generic_udp_format(int enabled);
 void tty_clr_trailing_read_lf(int enabled);
 
+/** \brief tty_set_read_ahead Read the sections of fd in blocks, keeping the bytes past the stop char for the next read,
+ *  rather than with a select() and a read() for every byte.
+ *  \param fd file descriptor
+ *  \param enabled 1 to enable, 0 to disable and drop the bytes kept
+ *  \note The bytes kept are dropped when the next command is written to fd, or by tty_discard_read_ahead(), as tcflush()
+ *  cannot drop them. Leave it off for devices that send on their own between the commands.
+ */
+void tty_set_read_ahead(int fd, int enabled);
+
+/** \brief tty_discard_read_ahead Drop the bytes read ahead on fd, along with the input flushed by tcflush()
+ *  \param fd file descriptor
+ */
+void tty_discard_read_ahead(int fd);
+
 int tty_timeout(int fd, int timeout);
 
 int tty_timeout_microseconds(int fd, long timeout_seconds, long timeout_microseconds);
@@ -309,6 +323,21 @@ int tty_timeout_microseconds(int fd, long timeout_seconds, long timeout_microsec
  */
 int fs_sexa(char *out, double a, int w, int fracbase);
 
+/** \brief Write the IEEE 754 bits of a double as 16 hex digits, the encoding='ieee754' content of oneNumber.
+ *  Exact, and much cheaper than printf and strtod at both ends.
+ *  \param out at least 17 chars, for the digits and the final null terminator.
+ *  \param a the number to write.
+ *  \return number of characters written to out, not counting final null terminator.
+ */
+int fs_ieee754(char *out, double a);
+
+/** \brief Read a double written by fs_ieee754(). Spaces around the digits are ignored.
+ *  \param str string holding the 16 hex digits.
+ *  \param dp pointer to a double to store the number.
+ *  \return return 0 if ok, -1 if str does not hold exactly 16 hex digits.
+ */
+int f_scanieee754(const char *str, double *dp);
+
 /** \brief convert sexagesimal string str AxBxC to double.
  *  x can be anything non-numeric. Any missing A, B or C will be assumed 0. Optional - and + can be anywhere.
  *  \param str0 string containing sexagesimal number.
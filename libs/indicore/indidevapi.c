@@ -331,6 +331,82 @@ int IUFindIndex(const char *needle, char **hay, unsigned int n)
     return -1;
 }
 
+/* a name table is only worth building for large vectors */
+#define MEMBER_TABLE_MIN 8
+
+static unsigned int member_hash(const char *name)
+{
+    unsigned int h = 2166136261u;
+    while (*name)
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    return h;
+}
+
+int IUFindMemberIndexes(const void *members, size_t size, int count, char *names[], int n, int indexes[])
+{
+#define MEMBER_NAME(i) ((const char *)members + (size_t)(i) * size)
+    int *table  = NULL;
+    unsigned int mask = 0;
+    int found = 0;
+    int next  = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        int index = -1;
+
+        /* most updates name the members in definition order */
+        if (next < count && !strcmp(MEMBER_NAME(next), names[i]))
+            index = next;
+        else if (count < MEMBER_TABLE_MIN)
+        {
+            for (int j = 0; j < count && index < 0; j++)
+                if (!strcmp(MEMBER_NAME(j), names[i]))
+                    index = j;
+        }
+        else
+        {
+            if (table == NULL)
+            {
+                /* open addressing, at most half full. the first of duplicate names wins as with IUFind */
+                unsigned int slots = 1;
+                while (slots < 2 * (unsigned int)count)
+                    slots <<= 1;
+                mask = slots - 1;
+                assert_mem(table = (int *)malloc(slots * sizeof(*table)));
+                memset(table, -1, slots * sizeof(*table));
+                for (int j = 0; j < count; j++)
+                {
+                    unsigned int h = member_hash(MEMBER_NAME(j)) & mask;
+                    while (table[h] >= 0 && strcmp(MEMBER_NAME(table[h]), MEMBER_NAME(j)))
+                        h = (h + 1) & mask;
+                    if (table[h] < 0)
+                        table[h] = j;
+                }
+            }
+
+            for (unsigned int h = member_hash(names[i]) & mask; table[h] >= 0; h = (h + 1) & mask)
+            {
+                if (!strcmp(MEMBER_NAME(table[h]), names[i]))
+                {
+                    index = table[h];
+                    break;
+                }
+            }
+        }
+
+        indexes[i] = index;
+        if (index >= 0)
+        {
+            found++;
+            next = index + 1;
+        }
+    }
+
+    free(table);
+    return found;
+#undef MEMBER_NAME
+}
+
 /* Find index of the ON member of an ISwitchVectorProperty */
 int IUFindOnSwitchIndex(const ISwitchVectorProperty *svp)
 {
@@ -553,6 +629,9 @@ int IUSnoopNumber(XMLEle *root, INumberVectorProperty *nvp)
         return (-1); /* not this property */
     (void)crackIPState(findXMLAttValu(root, "state"), &nvp->s);
 
+    /* values may come as IEEE 754 bits, see fs_ieee754() */
+    int ieee754 = !strcmp(findXMLAttValu(root, "encoding"), "ieee754");
+
     /* match each INumber with a oneNumber */
     locale_char_t *orig = indi_locale_C_numeric_push();
     for (int i = 0; i < nvp->nnp; i++)
@@ -561,7 +640,8 @@ int IUSnoopNumber(XMLEle *root, INumberVectorProperty *nvp)
         {
             if (!strcmp(tagXMLEle(ep) + 3, "Number") && !strcmp(nvp->np[i].name, findXMLAttValu(ep, "name")))
             {
-                if (f_scansexa(pcdataXMLEle(ep), &nvp->np[i].value) < 0)
+                if ((ieee754 ? f_scanieee754(pcdataXMLEle(ep), &nvp->np[i].value) :
+                        f_scansexa(pcdataXMLEle(ep), &nvp->np[i].value)) < 0)
                 {
                     indi_locale_C_numeric_pop(orig);
                     return (-1); /* bad number format */
@@ -737,9 +817,21 @@ int IUSnoopBLOB(XMLEle *root, IBLOBVectorProperty *bvp)
             XMLAtt *sa = findXMLAtt(ep, "size");
             if (fa && sa)
             {
-                int base64datalen = pcdatalenXMLEle(ep);
-                assert_mem(bp->blob = realloc(bp->blob, 3 * base64datalen / 4));
-                bp->bloblen = from64tobits_fast(bp->blob, pcdataXMLEle(ep), base64datalen);
+                size_t decoded;
+                void *blob = blobXMLEle(ep, &decoded);
+                if (blob)
+                {
+                    /* decoded while read, or attached by indiserver */
+                    assert_mem(bp->blob = realloc(bp->blob, decoded ? decoded : 1));
+                    memcpy(bp->blob, blob, decoded);
+                    bp->bloblen = decoded;
+                }
+                else
+                {
+                    int base64datalen = pcdatalenXMLEle(ep);
+                    assert_mem(bp->blob = realloc(bp->blob, 3 * base64datalen / 4));
+                    bp->bloblen = from64tobits_fast(bp->blob, pcdataXMLEle(ep), base64datalen);
+                }
                 indi_strlcpy(bp->format, valuXMLAtt(fa), MAXINDIFORMAT);
                 bp->size = atoi(valuXMLAtt(sa));
             }
@@ -94,6 +94,7 @@
  */
 
 #include <stdarg.h>
+#include <stdint.h>
 #include "indiapi.h"
 #include "lilxml.h"
 
@@ -245,6 +246,16 @@ extern void IDMessageVA(const char *dev, const char *msg, va_list arg) ATTRIBUTE
 extern void IDDelete(const char *dev, const char *name, const char *msg, ...) ATTRIBUTE_FORMAT_PRINTF(3, 4);
 extern void IDDeleteVA(const char *dev, const char *name, const char *msg, va_list arg) ATTRIBUTE_FORMAT_PRINTF(3, 0);
 
+/** @brief Function Drivers call to define the properties of a group only when a Client asks for them.
+ *  While a group is lazy, defining one of its properties sends nothing but, once per getProperties, a switch
+ *  vector named LAZY_<group> in that group. The properties are then defined when a Client sets that switch, or
+ *  names it or one of the properties in a getProperties. Until then their IDSetXXX() updates are not sent.
+ *  @param dev device name.
+ *  @param group name of the group.
+ *  @param lazy 1 to withhold the properties of the group, 0 to define those withheld and stop.
+ */
+extern void IDSetLazyGroup(const char *dev, const char *group, int lazy);
+
 /** @brief Function Drivers call to log a message locally.
  *  The message is not sent to any Clients.
  *  @param msg message in printf style to send to the client.
@@ -340,6 +351,22 @@ extern int IEAddTimer(int millisecs, IE_TCF *fp, void *userpointer);
  */
 extern int IEAddPeriodicTimer(int millisecs, IE_TCF *fp, void *userpointer);
 
+/** @brief Register a new single-shot timer function, \e fp, to be called with \e ud as argument after \e microsecs.
+ *  @param microsecs timer period in microseconds.
+ *  @param fp a pointer to the callback function.
+ *  @param userpointer a pointer to be passed to the callback function when called.
+ *  @return a unique id for use with IERmTimer().
+ */
+extern int IEAddTimerUs(int64_t microsecs, IE_TCF *fp, void *userpointer);
+
+/** @brief Register a new periodic timer function, \e fp, to be called with \e ud as argument every \e microsecs.
+ *  @param microsecs timer period in microseconds.
+ *  @param fp a pointer to the callback function.
+ *  @param userpointer a pointer to be passed to the callback function when called.
+ *  @return a unique id for use with IERmTimer().
+ */
+extern int IEAddPeriodicTimerUs(int64_t microsecs, IE_TCF *fp, void *userpointer);
+
 /** @brief Returns the timer's remaining value in milliseconds left until the timeout.
  *  @param timerid the timer callback ID returned from IEAddTimer() or IEAddPeriodicTimer()
  *  @return  If the timer not exists, the returned value will be -1.
@@ -350,7 +377,7 @@ extern int IERemainingTimer(int timerid);
  *  @param tid the timer callback ID returned from addTimer() or addPeriodicTimer()
  *  @return  If the timer not exists, the returned value will be -1.
  */
-extern int IENSecRemainingTimer(int tid);
+extern int64_t IENSecsRemainingTimer(int tid);
 
 /** @brief Remove the timer with the given \e timerid, as returned from IEAddTimer() or IEAddPeriodicTimer().
  *  @param timerid the timer callback ID returned from IEAddTimer() or IEAddPeriodicTimer().
@@ -501,6 +528,19 @@ extern ISwitch *IUFindOnSwitch(const ISwitchVectorProperty *sp);
  */
 extern int IUFindIndex(const char *needle, char **hay, unsigned int n);
 
+/** @brief Find the members of a vector property named in an update.
+ *  @note Names sent in the order the members were defined are matched with one comparison each. Other
+ *  names are looked up in a table of the member names, built once for the whole call.
+ *  @param members pointer to the first member: IText, INumber, ISwitch, ILight or IBLOB, each starting with its name.
+ *  @param size size of one member.
+ *  @param count number of members.
+ *  @param names names of the members to find.
+ *  @param n number of names.
+ *  @param indexes filled with the index of the member of each name, or -1 if there is none.
+ *  @return the number of names found.
+ */
+extern int IUFindMemberIndexes(const void *members, size_t size, int count, char *names[], int n, int indexes[]);
+
 /** @brief Returns the index of first ON switch it finds in the vector switch property.
  *  @note This is only valid for ISR_1OFMANY mode. That is, when only one switch out of many is allowed to be ON. Do not use this function if you can have multiple ON switches in the same vector property.
  *  @param sp a pointer to a switch vector property.
@@ -22,6 +22,7 @@
 #include "indibase.h"
 #include "indicom.h"
 #include "indidevapi.h"
+#include "numberformat.h"
 
 #include <string>
 #include <functional>
@@ -74,8 +75,8 @@ class LilXmlValue
         std::size_t indexOf(const char *needle, size_t from = 0) const;
         std::size_t indexOf(const std::string &needle, size_t from = 0) const;
 
-        std::size_t lastIndexOf(const char *needle, size_t from = 0) const;
-        std::size_t lastIndexOf(const std::string &needle, size_t from = 0) const;
+        std::size_t lastIndexOf(const char *needle, size_t from = std::string::npos) const;
+        std::size_t lastIndexOf(const std::string &needle, size_t from = std::string::npos) const;
 
         bool startsWith(const char *needle) const;
         bool startsWith(const std::string &needle) const;
@@ -142,6 +143,9 @@ class LilXmlElement
         LilXmlValue context() const;
         void setContext(const char *data);
 
+        // content decoded while parsing, the caller owns it. See LilXmlParser::setBlobDecoding
+        void *takeBlob(size_t *len) const;
+
         void print(FILE *f, int level = 0) const;
 
     public:
@@ -189,6 +193,9 @@ class LilXmlParser
     public:
         std::list<LilXmlDocument> parseChunk(const char *data, size_t size);
 
+        // decode the base64 content of oneBLOB elements while parsing, see setBlobDecodeLilXML
+        void setBlobDecoding(void *(*blobRealloc)(void *, size_t), void (*blobFree)(void *));
+
     public:
         bool hasErrorMessage() const;
         const char *errorMessage() const;
@@ -248,6 +255,11 @@ inline double LilXmlValue::toDoubleSexa(safe_ptr<bool> ok) const
 inline double LilXmlValue::toDouble(safe_ptr<bool> ok) const
 {
     double result = 0;
+    if (isValid() && indi_scan_number(mValue, &result) == 0)
+    {
+        *ok = true;
+        return result;
+    }
     try {
         result = std::stod(toString());
         *ok = true;
@@ -297,22 +309,22 @@ inline IPerm LilXmlValue::toIPerm(safe_ptr<bool> ok) const
 
 inline std::size_t LilXmlValue::indexOf(const char *needle, size_t from) const
 {
-    return toString().find_first_of(needle, from);
+    return toString().find(needle, from);
 }
 
 inline std::size_t LilXmlValue::indexOf(const std::string &needle, size_t from) const
 {
-    return toString().find_first_of(needle, from);
+    return toString().find(needle, from);
 }
 
 inline std::size_t LilXmlValue::lastIndexOf(const char *needle, size_t from) const
 {
-    return toString().find_last_of(needle, from);
+    return toString().rfind(needle, from);
 }
 
 inline std::size_t LilXmlValue::lastIndexOf(const std::string &needle, size_t from) const
 {
-    return toString().find_last_of(needle, from);
+    return toString().rfind(needle, from);
 }
 
 inline bool LilXmlValue::startsWith(const char *needle) const
@@ -327,12 +339,13 @@ inline bool LilXmlValue::startsWith(const std::string &needle) const
 
 inline bool LilXmlValue::endsWith(const char *needle) const
 {
-    return lastIndexOf(needle) == (size() - strlen(needle));
+    size_t length = strlen(needle);
+    return size() >= length && lastIndexOf(needle) == (size() - length);
 }
 
 inline bool LilXmlValue::endsWith(const std::string &needle) const
 {
-    return lastIndexOf(needle) == (size() - needle.size());
+    return size() >= needle.size() && lastIndexOf(needle) == (size() - needle.size());
 }
 
 // LilXmlAttribute Implementation
@@ -427,6 +440,11 @@ inline void LilXmlElement::setContext(const char *data)
     editXMLEle(mHandle, data);
 }
 
+inline void *LilXmlElement::takeBlob(size_t *len) const
+{
+    return takeBlobXMLEle(mHandle, len);
+}
+
 inline void LilXmlElement::print(FILE *f, int level) const
 {
     prXMLEle(f, handle(), level);
@@ -497,6 +515,11 @@ inline std::list<LilXmlDocument> LilXmlParser::parseChunk(const char *data, size
     return result;
 }
 
+inline void LilXmlParser::setBlobDecoding(void *(*blobRealloc)(void *, size_t), void (*blobFree)(void *))
+{
+    setBlobDecodeLilXML(mHandle.get(), blobRealloc, blobFree);
+}
+
 inline bool LilXmlParser::hasErrorMessage() const
 {
     return mErrorMessage[0] != '\0';
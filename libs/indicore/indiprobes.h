@@ -0,0 +1,33 @@
+#pragma once
+
+/* Static probes (USDT) of the "indi" provider, for perf, bpftrace or SystemTap.
+ * They cost a nop when nothing is attached, and are compiled out without sys/sdt.h.
+ * Arguments are only pointers and sizes already at hand: strings are read by the tracer.
+ *
+ *  bpftrace -e 'usdt:/usr/bin/indiserver:indi:msg_push { @[str(arg2), str(arg3)] = sum(arg4); }'
+ *  perf probe -x /usr/lib/libindidriver.so sdt_indi:blob_set
+ *
+ * Server:  msg_parsed(msg, tag, device, name, bytes), msg_push(queue, msg, device, name, bytes),
+ *          msg_pop(queue, msg, device, name), serialize_start/serialize_done(msg, device, name, bytes)
+ * Driver:  driverio_flush(bytes, fds), blob_set(device, name, bytes)
+ * CCD:     exposure_complete(device, bytes), exposure_calibrated(device, bytes),
+ *          exposure_upload(device, bytes), exposure_done(device, ok)
+ * Stream:  frame_enqueue(device, bytes, timestamp), frame_dequeue(device, bytes, queue_us)
+ */
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define INDI_PROBE(name) DTRACE_PROBE(indi, name)
+#define INDI_PROBE1(name, a1) DTRACE_PROBE1(indi, name, a1)
+#define INDI_PROBE2(name, a1, a2) DTRACE_PROBE2(indi, name, a1, a2)
+#define INDI_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(indi, name, a1, a2, a3)
+#define INDI_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(indi, name, a1, a2, a3, a4)
+#define INDI_PROBE5(name, a1, a2, a3, a4, a5) DTRACE_PROBE5(indi, name, a1, a2, a3, a4, a5)
+#else
+#define INDI_PROBE(name) do {} while (0)
+#define INDI_PROBE1(name, a1) do {} while (0)
+#define INDI_PROBE2(name, a1, a2) do {} while (0)
+#define INDI_PROBE3(name, a1, a2, a3) do {} while (0)
+#define INDI_PROBE4(name, a1, a2, a3, a4) do {} while (0)
+#define INDI_PROBE5(name, a1, a2, a3, a4, a5) do {} while (0)
+#endif
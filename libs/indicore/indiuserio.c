@@ -21,6 +21,7 @@
 #include "indicom.h"
 #include "locale_compat.h"
 #include "base64.h"
+#include "numberformat.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +40,16 @@ static void s_userio_xml_message_vprintf(const userio *io, void *user, const cha
 }
 
 
+/* print value in the shortest form that reads back as the same double */
+static void s_userio_double(const userio *io, void *user, double value)
+{
+    char buf[32];
+    if (indi_format_shortest(buf, sizeof(buf), value) >= 0)
+        userio_prints(io, user, buf);
+    else
+        userio_printf(io, user, "%.20g", value); // safe
+}
+
 void IUUserIONumberContext(const userio *io, void *user, const INumberVectorProperty *nvp)
 {
     for (int i = 0; i < nvp->nnp; i++)
@@ -47,8 +58,25 @@ void IUUserIONumberContext(const userio *io, void *user, const INumberVectorProp
         userio_prints    (io, user, "  <oneNumber name='");
         userio_xml_escape(io, user, np->name);
         userio_prints    (io, user, "'>\n");
-        userio_printf    (io, user, "      %.20g\n", np->value); // safe
-        userio_prints    (io, user, "  </oneNumber>\n");
+        userio_prints    (io, user, "      ");
+        s_userio_double  (io, user, np->value);
+        userio_prints    (io, user, "\n"
+                                    "  </oneNumber>\n");
+    }
+}
+
+static void s_userio_number_context_ieee754(const userio *io, void *user, const INumberVectorProperty *nvp)
+{
+    char bits[17];
+    for (int i = 0; i < nvp->nnp; i++)
+    {
+        INumber *np = &nvp->np[i];
+        userio_prints    (io, user, "  <oneNumber name='");
+        userio_xml_escape(io, user, np->name);
+        userio_prints    (io, user, "'>");
+        fs_ieee754(bits, np->value);
+        userio_prints    (io, user, bits);
+        userio_prints    (io, user, "</oneNumber>\n");
     }
 }
 
@@ -323,7 +351,8 @@ void IUUserIOGetProperties(
         userio_xml_escape(io, user, name);
         userio_prints    (io, user, "'");
     }
-    userio_prints    (io, user, "/>\n");
+    // the client library and the driver dispatch read setNumberVector with encoding='ieee754'
+    userio_prints    (io, user, " numbers='ieee754'/>\n");
 }
 
 // temporary
@@ -486,10 +515,18 @@ void IUUserIODefNumberVA(
                                     "    format='");
         userio_xml_escape(io, user, np->format);
         userio_prints    (io, user, "'\n");
-        userio_printf    (io, user, "    min='%.20g'\n", np->min); // safe
-        userio_printf    (io, user, "    max='%.20g'\n", np->max); // safe
-        userio_printf    (io, user, "    step='%.20g'>\n", np->step); // safe
-        userio_printf    (io, user, "      %.20g\n", np->value); // safe
+        userio_prints    (io, user, "    min='");
+        s_userio_double  (io, user, np->min);
+        userio_prints    (io, user, "'\n"
+                                    "    max='");
+        s_userio_double  (io, user, np->max);
+        userio_prints    (io, user, "'\n"
+                                    "    step='");
+        s_userio_double  (io, user, np->step);
+        userio_prints    (io, user, "'>\n"
+                                    "      ");
+        s_userio_double  (io, user, np->value);
+        userio_prints    (io, user, "\n");
 
         userio_prints    (io, user, "  </defNumber>\n");
     }
@@ -651,9 +688,9 @@ void IUUserIOSetTextVA(
     indi_locale_C_numeric_pop(orig);
 }
 
-void IUUserIOSetNumberVA(
+static void s_userio_set_number(
     const userio *io, void *user,
-    const INumberVectorProperty *nvp, const char *fmt, va_list ap
+    const INumberVectorProperty *nvp, int ieee754, const char *fmt, va_list ap
 )
 {
     locale_char_t *orig = indi_locale_C_numeric_push();
@@ -668,14 +705,37 @@ void IUUserIOSetNumberVA(
     userio_printf    (io, user, "  timeout='%g'\n", nvp->timeout); // safe
     userio_printf    (io, user, "  timestamp='%s'\n", indi_timestamp()); // safe
     s_userio_xml_message_vprintf(io, user, fmt, ap);
-    userio_prints    (io, user, ">\n");
-
-    IUUserIONumberContext(io, user, nvp);
+    if (ieee754)
+    {
+        userio_prints    (io, user, "  encoding='ieee754'\n>\n");
+        s_userio_number_context_ieee754(io, user, nvp);
+    }
+    else
+    {
+        userio_prints    (io, user, ">\n");
+        IUUserIONumberContext(io, user, nvp);
+    }
 
     userio_prints    (io, user, "</setNumberVector>\n");
     indi_locale_C_numeric_pop(orig);
 }
 
+void IUUserIOSetNumberVA(
+    const userio *io, void *user,
+    const INumberVectorProperty *nvp, const char *fmt, va_list ap
+)
+{
+    s_userio_set_number(io, user, nvp, 0, fmt, ap);
+}
+
+void IUUserIOSetNumberIEEE754VA(
+    const userio *io, void *user,
+    const INumberVectorProperty *nvp, const char *fmt, va_list ap
+)
+{
+    s_userio_set_number(io, user, nvp, 1, fmt, ap);
+}
+
 void IUUserIOSetSwitchVA(
     const userio *io, void *user,
     const ISwitchVectorProperty *svp, const char *fmt, va_list ap
@@ -73,6 +73,11 @@ void IUUserIODefBLOBVA(const userio *io, void *user, const struct _IBLOBVectorPr
 void IUUserIOSetTextVA(const userio *io, void *user, const struct _ITextVectorProperty *tvp, const char *fmt, va_list ap);
 void IUUserIOSetNumberVA(const userio *io, void *user, const struct _INumberVectorProperty *nvp, const char *fmt,
                          va_list ap);
+/** \brief Like IUUserIOSetNumberVA(), with the values as encoding='ieee754' (see fs_ieee754()).
+ *  Only for a peer that announced numbers='ieee754' in its getProperties.
+ */
+void IUUserIOSetNumberIEEE754VA(const userio *io, void *user, const struct _INumberVectorProperty *nvp, const char *fmt,
+                                va_list ap);
 void IUUserIOSetSwitchVA(const userio *io, void *user, const struct _ISwitchVectorProperty *svp, const char *fmt,
                          va_list ap);
 void IUUserIOSetLightVA(const userio *io, void *user, const struct _ILightVectorProperty *lvp, const char *fmt, va_list ap);
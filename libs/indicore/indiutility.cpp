@@ -21,7 +21,17 @@
 
 */
 #include "indiutility.h"
+#include <algorithm>
 #include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#ifndef _MSC_VER
+#include <dirent.h>
+#endif
 
 #ifdef _MSC_VER
 
@@ -102,4 +112,61 @@ void replace_all(std::string &subject, const std::string &search, const std::str
     }
 }
 
+
+int nextFileIndex(const std::string &dir, const std::string &pattern)
+{
+    struct FileIndex
+    {
+        dev_t device;
+        ino_t inode;
+        time_t modified;
+        time_t scanned;
+        int index;
+    };
+    static std::mutex lock;
+    static std::map<std::pair<std::string, std::string>, FileIndex> cache;
+
+    struct stat st;
+    if (stat(dir.c_str(), &st) == -1)
+        return -1;
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto key = std::make_pair(dir, pattern);
+    auto it  = cache.find(key);
+    bool same = it != cache.end() && it->second.device == st.st_dev && it->second.inode == st.st_ino;
+    // A change within the second of the scan may not show in the modification time: scan again then
+    if (same && it->second.modified == st.st_mtime && it->second.modified < it->second.scanned)
+        return ++it->second.index;
+
+#ifdef _MSC_VER
+    return -1;
+#else
+    DIR *dpdf = opendir(dir.c_str());
+    if (dpdf == nullptr)
+        return -1;
+
+    int maxIndex = 0;
+    struct dirent *epdf;
+    while ((epdf = readdir(dpdf)))
+    {
+        if (!strstr(epdf->d_name, pattern.c_str()))
+            continue;
+
+        const char *start = strrchr(epdf->d_name, '_');
+        if (start != nullptr)
+        {
+            int index = atoi(start + 1);
+            if (index > maxIndex)
+                maxIndex = index;
+        }
+    }
+    closedir(dpdf);
+
+    // The files of the indexes returned may not be written yet
+    int index = same ? std::max(maxIndex, it->second.index) + 1 : maxIndex + 1;
+    cache[key] = {st.st_dev, st.st_ino, st.st_mtime, time(nullptr), index};
+    return index;
+#endif
+}
+
 }
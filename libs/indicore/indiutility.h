@@ -91,6 +91,15 @@ std::string format_time(const std::tm &tm, const char *format);
  */
 void replace_all(std::string &subject, const std::string &search, const std::string &replace);
 
+/**
+ * @brief Returns the index following the highest one among the files of dir whose name contains pattern,
+ * the index being the number after the last '_' of the name. Later calls for the same dir and pattern count
+ * up from the last index returned, expecting each one to be used. The directory is scanned again when it
+ * was modified since, by another process for instance, or removed or replaced.
+ * @return The next index, or -1 if dir cannot be read.
+ */
+int nextFileIndex(const std::string &dir, const std::string &pattern);
+
 /**
  * @brief The strlcpy() function copy strings respectively.
  * They are designed to be safer, more consistent, and less error prone replacements for strncpy.
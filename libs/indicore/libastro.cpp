@@ -43,32 +43,122 @@
 namespace INDI
 {
 
+namespace
+{
+// The J2000 to observed conversion of an epoch, reused for the epochs up to jnowCacheInterval away.
+// Precession and nutation make a rotation and the annual aberration a shift of the direction, both
+// change by well under a milliarcsecond in a minute.
+struct JNowCache
+{
+    bool valid { false };
+    double jd { 0 };
+    double rotation[3][3];  // J2000 to JNow, precession and nutation
+    double aberration[3];   // shift of a JNow direction by the annual aberration
+};
+
+thread_local JNowCache jnowCache;
+double jnowCacheInterval = 60.0 / 86400.0;
+
+void toVector(const ln_equ_posn &posn, double vector[3])
+{
+    double ra = DEG_TO_RAD(posn.ra), dec = DEG_TO_RAD(posn.dec);
+    vector[0] = cos(dec) * cos(ra);
+    vector[1] = cos(dec) * sin(ra);
+    vector[2] = sin(dec);
+}
+
+void toPosition(const double vector[3], ln_equ_posn *posn)
+{
+    posn->ra = range360(RAD_TO_DEG(atan2(vector[1], vector[0])));
+    posn->dec = RAD_TO_DEG(atan2(vector[2], sqrt(vector[0] * vector[0] + vector[1] * vector[1])));
+}
+
+void normalise(double vector[3])
+{
+    double length = sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+    for (int i = 0; i < 3; i++)
+        vector[i] /= length;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+/// Get the conversion of the epoch jd, sampling libnova on the equator where its
+/// nutation and aberration formulae are well behaved
+//////////////////////////////////////////////////////////////////////////////////////////////
+const JNowCache &getJNowCache(double jd)
+{
+    JNowCache &cache = jnowCache;
+    if (cache.valid && fabs(jd - cache.jd) <= jnowCacheInterval)
+        return cache;
+
+    // Rotation columns are the JNow directions of the J2000 x and y axes, made orthonormal, and their cross product
+    double column[2][3];
+    for (int axis = 0; axis < 2; axis++)
+    {
+        struct ln_equ_posn J2000Pos = {axis * 90.0, 0}, observed;
+        ln_get_equ_prec2(&J2000Pos, JD2000, jd, &observed);
+        INDI::ln_get_equ_nut(&observed, jd, false);
+        toVector(observed, column[axis]);
+    }
+    normalise(column[0]);
+    double dot = column[0][0] * column[1][0] + column[0][1] * column[1][1] + column[0][2] * column[1][2];
+    for (int i = 0; i < 3; i++)
+        column[1][i] -= dot * column[0][i];
+    normalise(column[1]);
+    for (int i = 0; i < 3; i++)
+    {
+        cache.rotation[i][0] = column[0][i];
+        cache.rotation[i][1] = column[1][i];
+    }
+    cache.rotation[0][2] = column[0][1] * column[1][2] - column[0][2] * column[1][1];
+    cache.rotation[1][2] = column[0][2] * column[1][0] - column[0][0] * column[1][2];
+    cache.rotation[2][2] = column[0][0] * column[1][1] - column[0][1] * column[1][0];
+
+    // Aberration moves a direction u to about u + v - (u.v)u, v being the velocity of the earth over c
+    double shift[2][3];
+    for (int axis = 0; axis < 2; axis++)
+    {
+        struct ln_equ_posn mean = {axis * 90.0, 0}, apparent;
+        ln_get_equ_aber(&mean, jd, &apparent);
+        toVector(apparent, shift[axis]);
+        shift[axis][axis] -= 1.0;
+    }
+    cache.aberration[0] = shift[1][0];
+    cache.aberration[1] = shift[0][1];
+    cache.aberration[2] = (shift[0][2] + shift[1][2]) / 2;
+
+    cache.jd = jd;
+    cache.valid = true;
+    return cache;
+}
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 // converts the Observed (JNow) position to a J2000 catalogue position by removing
-// aberration, nutation and precession using the libnova library
+// aberration, nutation and precession
 //////////////////////////////////////////////////////////////////////////////////////////////
 void ObservedToJ2000(IEquatorialCoordinates * observed, double jd, IEquatorialCoordinates * J2000pos)
 {
-    ln_equ_posn tempPos;
+    const JNowCache &cache = getJNowCache(jd);
+
     // RA Hours --> Degrees
     struct ln_equ_posn libnova_observed = {observed->rightascension * 15.0, observed->declination};
+    double now[3];
+    toVector(libnova_observed, now);
+
     // remove the aberration
-    ln_get_equ_aber(&libnova_observed, jd, &tempPos);
-    // this conversion has added the aberration, we want to subtract it
-    tempPos.ra = libnova_observed.ra - (tempPos.ra - libnova_observed.ra);
-    tempPos.dec = libnova_observed.dec * 2 - tempPos.dec;
+    for (int i = 0; i < 3; i++)
+        now[i] -= cache.aberration[i];
+    normalise(now);
 
-    // remove the nutation
-    ln_get_equ_nut(&tempPos, jd, true);
+    // remove the nutation and precess from now to J2000, the inverse rotation being its transpose
+    double catalogue[3];
+    for (int i = 0; i < 3; i++)
+        catalogue[i] = cache.rotation[0][i] * now[0] + cache.rotation[1][i] * now[1] + cache.rotation[2][i] * now[2];
 
     struct ln_equ_posn libnova_J2000Pos;
-    // precess from now to J2000
-    ln_get_equ_prec2(&tempPos, jd, JD2000, &libnova_J2000Pos);
-
+    toPosition(catalogue, &libnova_J2000Pos);
     J2000pos->rightascension = libnova_J2000Pos.ra / 15.0;
     J2000pos->declination = libnova_J2000Pos.dec;
-
-
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -79,23 +169,37 @@ void ObservedToJ2000(IEquatorialCoordinates * observed, double jd, IEquatorialCo
 //////////////////////////////////////////////////////////////////////////////////////////////
 void J2000toObserved(IEquatorialCoordinates *J2000pos, double jd, IEquatorialCoordinates *observed)
 {
-    ln_equ_posn tempPosn;
-    struct ln_equ_posn libnova_J2000Pos = {J2000pos->rightascension * 15.0, J2000pos->declination };
+    const JNowCache &cache = getJNowCache(jd);
 
-    // apply precession from J2000 to jd
-    ln_get_equ_prec2(&libnova_J2000Pos, JD2000, jd, &tempPosn);
+    struct ln_equ_posn libnova_J2000Pos = {J2000pos->rightascension * 15.0, J2000pos->declination };
+    double catalogue[3];
+    toVector(libnova_J2000Pos, catalogue);
 
-    // apply nutation
-    ln_get_equ_nut(&tempPosn, jd, false);
+    // apply precession from J2000 to jd and nutation
+    double now[3];
+    for (int i = 0; i < 3; i++)
+        now[i] = cache.rotation[i][0] * catalogue[0] + cache.rotation[i][1] * catalogue[1] + cache.rotation[i][2] * catalogue[2];
 
-    struct ln_equ_posn libnova_observed;
     // apply aberration
-    ln_get_equ_aber(&tempPosn, jd, &libnova_observed);
+    for (int i = 0; i < 3; i++)
+        now[i] += cache.aberration[i];
+    normalise(now);
 
+    struct ln_equ_posn libnova_observed;
+    toPosition(now, &libnova_observed);
     observed->rightascension = libnova_observed.ra / 15.0;
     observed->declination = libnova_observed.dec;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////////////
+void SetJNowCacheInterval(double seconds)
+{
+    jnowCacheInterval = seconds / 86400.0;
+    jnowCache.valid = false;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 /// apply or remove nutation
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -93,6 +93,14 @@ void ObservedToJ2000(IEquatorialCoordinates *observed, double jd, IEquatorialCoo
 */
 void J2000toObserved(IEquatorialCoordinates *J2000pos, double jd, IEquatorialCoordinates * observed);
 
+/**
+* \brief SetJNowCacheInterval sets how far apart two epochs can be for ObservedToJ2000 and J2000toObserved
+*  to share their precession, nutation and aberration
+* \param seconds interval in seconds, 60 by default, 0 to compute them for every epoch
+* \note The conversion is kept per thread. Over a minute it changes by well under a milliarcsecond.
+*/
+void SetJNowCacheInterval(double seconds);
+
 /**
  * @brief EquatorialToHorizontal Calculate horizontal coordinates from equatorial coordinates.
  * @param object Equatorial Object Coordinates in INDI standaard (RA Hours, DE degrees).
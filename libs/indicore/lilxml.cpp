@@ -35,6 +35,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/stat.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #if defined(_MSC_VER)
 #define snprintf _snprintf
@@ -44,30 +51,76 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 #endif
 
 #include "lilxml.h"
+#include "base64.h"
+
+typedef struct XMLArena_ XMLArena;
 
 /* used to efficiently manage growing malloced string space */
 typedef struct
 {
-    char *s; /* malloced memory for string */
+    char *s; /* malloced memory for string, or interned name */
     int sl;  /* string length, sans trailing \0 */
-    int sm;  /* total malloced bytes */
+    int sm;  /* total malloced bytes, 0 when s is interned: it is then never modified */
+    XMLArena *arena; /* where s is allocated, NULL for heap */
 } String;
 #define MINMEM 64 /* starting string length */
 
+/* bump allocator holding a whole parsed tree. See setArenaLilXML() */
+typedef struct XMLArenaChunk_
+{
+    struct XMLArenaChunk_ *next;
+    size_t size; /* usable bytes after this header */
+    size_t used;
+} XMLArenaChunk;
+
+/* header of a block too large for the chunks: malloced on its own so it can be resized and freed */
+typedef struct XMLArenaLarge_
+{
+    struct XMLArenaLarge_ *prev;
+    struct XMLArenaLarge_ *next;
+} XMLArenaLarge;
+
+struct XMLArena_
+{
+    XMLArenaChunk *chunks; /* current chunk first */
+    XMLArenaLarge *large;  /* large blocks */
+    XMLEle *root;          /* deleting it releases the arena */
+    int nchunks;
+};
+#define ARENA_CHUNK 4096 /* first chunk size, later ones grow up to 16 times that */
+#define ARENA_LARGE 1024 /* blocks from that size get their own malloc */
+
 static int oneXMLchar(LilXML *lp, int c, char ynot[]);
 static void initParser(LilXML *lp);
 static void pushXMLEle(LilXML *lp);
 static void popXMLEle(LilXML *lp);
 static void resetEndTag(LilXML *lp);
 static XMLAtt *growAtt(XMLEle *e);
-static XMLEle *growEle(XMLEle *pe);
+static XMLEle *growEle(XMLEle *pe, XMLArena *arena);
+static void *growArray(XMLArena *arena, void *array, int n, size_t elsize);
 static void freeAtt(XMLAtt *a);
 static int isTokenChar(int start, int c);
 static void growString(String *sp, int c);
 static void appendString(String *sp, const char *str);
+static void appendChars(String *sp, const char *str, int n);
+static int plainXMLRun(LilXML *lp, const char *p, int n, char ynot[]);
+static void startBlob(LilXML *lp);
+static void openEvent(LilXML *lp);
+static void closeEvent(LilXML *lp);
+static int decodeBlob(LilXML *lp, const char *p, int n, char ynot[]);
+static int endBlob(LilXML *lp, char ynot[]);
+static int rawXMLRun(LilXML *lp, const char *p, int n, char ynot[]);
 static void freeString(String *sp);
 static void newString(String *sp);
+static void resizeString(String *sp, int n);
 static void *moremem(void *old, size_t n);
+static const char *internName(const char *name, int n);
+static void setName(String *sp, const char *name, int n);
+static XMLArena *newArena();
+static void delArena(XMLArena *arena);
+static void *xmlAlloc(XMLArena *arena, size_t n);
+static void *xmlRealloc(XMLArena *arena, void *old, size_t oldn, size_t n);
+static void xmlFree(XMLArena *arena, void *p, size_t n);
 static void appXMLEle(XMLEle *ep, XMLEle *newep);
 
 typedef enum
@@ -97,10 +150,24 @@ struct LilXML_
     XMLEle *ce;    /* current element being built */
     String endtag; /* to check for match with opening tag*/
     String entity; /* collect entity seq */
+    String token;  /* collect tag or attr name, until it is interned or copied */
     int delim;     /* attribute value delimiter */
     int lastc;     /* last char (just used with skipping)*/
     int skipping;  /* in comment or declaration */
     int inblob;    /* in oneBLOB element */
+    int arena;     /* allocate each tree from its own arena */
+    void *(*blobrealloc)(void *ptr, size_t size); /* when set, oneBLOB content is decoded */
+    void (*blobfree)(void *ptr);
+    int decoding;    /* ce content goes to ce->blob */
+    void *(*cerealloc)(void *ptr, size_t size); /* allocator of ce->blob, latched by startBlob */
+    void (*cefree)(void *ptr);
+    size_t blobexpect; /* size announced for ce->blob */
+    char quad[4];    /* base64 chars waiting for a whole group */
+    int nquad;
+    size_t rawleft;  /* bytes of binary oneBLOB content still to come */
+    int rawnl;       /* the newline ending the opening tag may come first */
+    const XMLHandler *handler; /* when set, elements are reported then deleted */
+    void *self;                /* passed to handler */
 };
 
 /* internal representation of a (possibly nested) XML element */
@@ -116,6 +183,11 @@ struct xml_ele_
     int eit;           /* used to iterate over el[] */
     String pcdata;     /* character data in this element */
     int pcdata_hasent; /* 1 if pcdata contains an entity char*/
+    XMLArena *arena;   /* arena of the tree, NULL for heap */
+    void *blob;        /* content decoded while parsing, see setBlobDecodeLilXML() */
+    size_t bloblen;    /* decoded bytes */
+    size_t blobsize;   /* allocated bytes */
+    void (*blobfree)(void *ptr);
 };
 
 /* internal representation of an attribute */
@@ -126,9 +198,126 @@ struct xml_att_
     XMLEle *ce;  /* containing element */
 };
 
-/* characters that need escaping as "entities" in attr values and pcdata
+/* length of the leading run of s without the characters that need escaping
+ * as "entities" in attr values and pcdata: & < > ' "
+ * 16 bytes are checked at a time with SSE2 or NEON when available.
  */
-static char entities[] = "&<>'\"";
+static size_t entityFreeLength(const char *s, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i amp  = _mm_set1_epi8('&');
+    const __m128i lt   = _mm_set1_epi8('<');
+    const __m128i gt   = _mm_set1_epi8('>');
+    const __m128i apos = _mm_set1_epi8('\'');
+    const __m128i quot = _mm_set1_epi8('"');
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, lt));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, gt));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, apos));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, quot));
+
+        int bits = _mm_movemask_epi8(m);
+        if (bits)
+            return i + __builtin_ctz(bits);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t v = vld1q_u8((const uint8_t *)s + i);
+        uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8('&')), vceqq_u8(v, vdupq_n_u8('<')));
+        m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('>')));
+        m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\'')));
+        m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('"')));
+
+        /* one nibble per byte */
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (bits)
+            return i + (__builtin_ctzll(bits) >> 2);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        char c = s[i];
+        if (c == '&' || c == '<' || c == '>' || c == '\'' || c == '"')
+            break;
+    }
+    return i;
+}
+
+/* entity encoding of one of these characters, of *len bytes */
+static const char *entityOf(char c, size_t *len)
+{
+    switch (c)
+    {
+        case '&':
+            *len = 5;
+            return "&amp;";
+        case '<':
+            *len = 4;
+            return "&lt;";
+        case '>':
+            *len = 4;
+            return "&gt;";
+        case '\'':
+            *len = 6;
+            return "&apos;";
+        default:
+            *len = 6;
+            return "&quot;";
+    }
+}
+
+/* tags and attribute names of the INDI protocol, interned by the parser */
+static const char *const vocabulary[] =
+{
+    "getProperties", "delProperty", "message", "enableBLOB", "pingRequest", "pingReply",
+    "defTextVector", "defNumberVector", "defSwitchVector", "defLightVector", "defBLOBVector",
+    "setTextVector", "setNumberVector", "setSwitchVector", "setLightVector", "setBLOBVector",
+    "newTextVector", "newNumberVector", "newSwitchVector", "newBLOBVector",
+    "defText", "defNumber", "defSwitch", "defLight", "defBLOB",
+    "oneText", "oneNumber", "oneSwitch", "oneLight", "oneBLOB",
+    "version", "device", "name", "label", "group", "state", "perm", "rule", "timeout",
+    "timestamp", "format", "min", "max", "step", "size", "enclen", "attached", "uid",
+};
+#define VOCABSLOTS 256 /* power of two, well above the vocabulary size */
+
+/* open addressing table of the vocabulary, over writable copies of the names */
+struct Vocabulary
+{
+    char pool[1024];
+    char *slot[VOCABSLOTS];
+    int len[VOCABSLOTS];
+
+    static unsigned hash(const char *name, int n)
+    {
+        unsigned h = 2166136261u; /* FNV-1a */
+        for (int i = 0; i < n; i++)
+            h = (h ^ (unsigned char)name[i]) * 16777619u;
+        return h;
+    }
+
+    Vocabulary() : slot(), len()
+    {
+        char *p = pool;
+        for (const char *name : vocabulary)
+        {
+            int n = (int)strlen(name);
+            unsigned h = hash(name, n) & (VOCABSLOTS - 1);
+            while (slot[h])
+                h = (h + 1) & (VOCABSLOTS - 1);
+            memcpy(p, name, n + 1);
+            slot[h] = p;
+            len[h]  = n;
+            p += n + 1;
+        }
+    }
+};
 
 /* default memory managers, override with lilxmlMalloc() */
 static void *(*mymalloc)(size_t size)             = malloc;
@@ -155,14 +344,115 @@ LilXML *newLilXML()
     return (lp);
 }
 
+/* allocate trees parsed from now on from arenas, or from the heap */
+void setArenaLilXML(LilXML *lp, int enable)
+{
+    lp->arena = enable;
+}
+
+/* decode oneBLOB content while parsing, or stop if blobrealloc is NULL.
+ * the oneBLOB being parsed keeps the allocator it was started with */
+void setBlobDecodeLilXML(LilXML *lp, void *(*blobrealloc)(void *ptr, size_t size), void (*blobfree)(void *ptr))
+{
+    lp->blobrealloc = blobrealloc;
+    lp->blobfree    = blobfree;
+}
+
+/* bytes of the oneBLOB being parsed still to come, as announced by its attributes */
+size_t pendingContentLilXML(LilXML *lp)
+{
+    if (lp->rawleft)
+        return lp->rawleft;
+
+    XMLEle *ep = lp->ce;
+    if (!ep || lp->cs != INCON || strcmp(ep->tag.s, "oneBLOB"))
+        return 0;
+
+    if (lp->decoding)
+        return lp->blobexpect > ep->bloblen ? 4 * ((lp->blobexpect - ep->bloblen + 2) / 3) : 0;
+
+    /* base64 of enclen chars, or of size bytes */
+    long expect = atol(findXMLAttValu(ep, "enclen"));
+    if (expect <= 0)
+        expect = 4 * ((atol(findXMLAttValu(ep, "size")) + 2) / 3);
+    return expect > ep->pcdata.sl ? (size_t)(expect - ep->pcdata.sl) : 0;
+}
+
+/* free the decoded content of ep if any */
+static void freeBlob(XMLEle *ep)
+{
+    if (ep->blob)
+        (*ep->blobfree)(ep->blob);
+    ep->blob     = NULL;
+    ep->bloblen  = 0;
+    ep->blobsize = 0;
+}
+
+/* delete the whole tree ep belongs to */
+static void delXMLTree(XMLEle *ep)
+{
+    while (ep && ep->pe)
+        ep = ep->pe;
+    delXMLEle(ep);
+}
+
+/* report elements to handler instead of returning them */
+void setHandlerLilXML(LilXML *lp, const XMLHandler *handler, void *self)
+{
+    lp->handler = handler;
+    lp->self    = self;
+}
+
 /* discard */
 void delLilXML(LilXML *lp)
 {
-    delXMLEle(lp->ce);
+    delXMLTree(lp->ce);
     freeString(&lp->endtag);
+    freeString(&lp->token);
     (*myfree)(lp);
 }
 
+/* remove ep from parent's list if known */
+static void unlinkXMLEle(XMLEle *ep)
+{
+    int i;
+
+    if (ep->pe)
+    {
+        XMLEle *pe = ep->pe;
+        for (i = 0; i < pe->nel; i++)
+        {
+            if (pe->el[i] == ep)
+            {
+                memmove(&pe->el[i], &pe->el[i + 1], (--pe->nel - i) * sizeof(XMLEle *));
+                break;
+            }
+        }
+    }
+}
+
+/* free what ep and its children hold outside of arena: decoded content and
+ * children added from another tree
+ */
+static void delForeignXMLEle(XMLEle *ep, XMLArena *arena)
+{
+    int i;
+
+    freeBlob(ep);
+    for (i = 0; i < ep->nel; i++)
+    {
+        XMLEle *child = ep->el[i];
+        if (child->arena != arena)
+        {
+            /* forget parent so deleting doesn't modify _this_ el[] */
+            child->pe = NULL;
+            delXMLEle(child);
+        }
+        else
+            delForeignXMLEle(child, arena);
+    }
+}
+
 /* delete ep and all its children and remove from parent's list if known */
 void delXMLEle(XMLEle *ep)
 {
@@ -172,7 +462,19 @@ void delXMLEle(XMLEle *ep)
     if (!ep)
         return;
 
+    if (ep->arena)
+    {
+        unlinkXMLEle(ep);
+        delForeignXMLEle(ep, ep->arena);
+
+        /* an element within the tree goes away with its root */
+        if (ep->arena->root == ep)
+            delArena(ep->arena);
+        return;
+    }
+
     /* delete all parts of ep */
+    freeBlob(ep);
     freeString(&ep->tag);
     freeString(&ep->pcdata);
     if (ep->at)
@@ -193,19 +495,7 @@ void delXMLEle(XMLEle *ep)
         (*myfree)(ep->el);
     }
 
-    /* remove from parent's list if known */
-    if (ep->pe)
-    {
-        XMLEle *pe = ep->pe;
-        for (i = 0; i < pe->nel; i++)
-        {
-            if (pe->el[i] == ep)
-            {
-                memmove(&pe->el[i], &pe->el[i + 1], (--pe->nel - i) * sizeof(XMLEle *));
-                break;
-            }
-        }
-    }
+    unlinkXMLEle(ep);
 
     /* delete ep itself */
     (*myfree)(ep);
@@ -237,8 +527,7 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
         char *ltpos = memchr(buf, '<', size);
         if (!ltpos)
         {
-            lp->ce->pcdata.s = (char *)moremem(lp->ce->pcdata.s, lp->ce->pcdata.sm + size);
-            lp->ce->pcdata.sm += size;
+            resizeString(&lp->ce->pcdata, lp->ce->pcdata.sm + size);
             memcpy((void *)(lp->ce->pcdata.s + lp->ce->pcdata.sl), (const void *)buf, size);
             lp->ce->pcdata.sl += size;
             return nodes;
@@ -252,7 +541,7 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
         if (lp->ce)
         {
             char *ctag = tagXMLEle(lp->ce);
-            if (ctag && !(strcmp(ctag, "oneBLOB")) && (lp->cs == INCON))
+            if (ctag && !(strcmp(ctag, "oneBLOB")) && (lp->cs == INCON) && !lp->decoding)
             {
 #ifdef WITH_ENCLEN
                 XMLAtt *blenatt = findXMLAtt(lp->ce, "enclen");
@@ -264,8 +553,7 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
                     // Add room for those '\n' on every 72 character line + extra half-full line.
                     blen += (blen / 72) + 1;
 
-                    lp->ce->pcdata.s  = (char *)moremem(lp->ce->pcdata.s, blen);
-                    lp->ce->pcdata.sm = blen; // always set sm
+                    resizeString(&lp->ce->pcdata, blen); // always set sm
 
                     if (size <= blen - lp->ce->pcdata.sl)
                     {
@@ -280,8 +568,7 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
                 char *ltpos = memchr(buf, '<', size);
                 if (!ltpos)
                 {
-                    lp->ce->pcdata.s = (char *)moremem(lp->ce->pcdata.s, lp->ce->pcdata.sm + size);
-                    lp->ce->pcdata.sm += size;
+                    resizeString(&lp->ce->pcdata, lp->ce->pcdata.sm + size);
                     memcpy((void *)(lp->ce->pcdata.s + lp->ce->pcdata.sl), (const void *)buf, size);
                     lp->ce->pcdata.sl += size;
                     lp->inblob = 1;
@@ -295,6 +582,20 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
     }
     while (curr - buf < size)
     {
+        /* binary content is not XML at all */
+        if (lp->rawleft)
+        {
+            int n = rawXMLRun(lp, curr, size - (curr - buf), ynot);
+            if (n < 0)
+            {
+                initParser(lp);
+                curr++;
+                continue;
+            }
+            curr += n;
+            continue;
+        }
+
         char newc = *curr;
         /* EOF? */
         if (newc == 0)
@@ -332,6 +633,23 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
             continue;
         }
 
+        /* take whole runs of content, attribute values or names at once */
+        if (lp->lastc != '<')
+        {
+            int n = plainXMLRun(lp, curr, size - (curr - buf), ynot);
+            if (n > 0)
+            {
+                curr += n;
+                continue;
+            }
+            if (n < 0)
+            {
+                initParser(lp);
+                curr++;
+                continue;
+            }
+        }
+
         /* do a pending '<' first then newc */
         if (lp->lastc == '<')
         {
@@ -359,6 +677,14 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
             continue;
         }
 
+        /* reported elements are not kept */
+        if (lp->handler)
+        {
+            initParser(lp);
+            curr++;
+            continue;
+        }
+
         /* Ok! store ce in nodes and we start over.
          * N.B. up to caller to call delXMLEle with what we return.
          */
@@ -390,6 +716,14 @@ XMLEle *readXMLEle(LilXML *lp, int newc, char ynot[])
     /* start optimistic */
     ynot[0] = '\0';
 
+    if (lp->rawleft)
+    {
+        char c = newc;
+        if (rawXMLRun(lp, &c, 1, ynot) < 0)
+            initParser(lp);
+        return (NULL);
+    }
+
     /* EOF? */
     if (newc == 0)
     {
@@ -446,6 +780,13 @@ XMLEle *readXMLEle(LilXML *lp, int newc, char ynot[])
         return (NULL);
     }
 
+    /* reported elements are not kept */
+    if (lp->handler)
+    {
+        initParser(lp);
+        return (NULL);
+    }
+
     /* Ok! return ce and we start over.
      * N.B. up to caller to call delXMLEle with what we return.
      */
@@ -523,8 +864,18 @@ XMLEle * cloneXMLEle(XMLEle * ep, int (*replace)(void * self, XMLEle * source, X
  */
 XMLAtt *findXMLAtt(XMLEle *ep, const char *name)
 {
+    const char *in = internXMLName(name);
     int i;
 
+    /* a vocabulary name can only be held interned */
+    if (in)
+    {
+        for (i = 0; i < ep->nat; i++)
+            if (ep->at[i]->name.s == in)
+                return (ep->at[i]);
+        return (NULL);
+    }
+
     for (i = 0; i < ep->nat; i++)
         if (!strcmp(ep->at[i]->name.s, name))
             return (ep->at[i]);
@@ -537,8 +888,17 @@ XMLAtt *findXMLAtt(XMLEle *ep, const char *name)
 XMLEle *findXMLEle(XMLEle *ep, const char *tag)
 {
     int tl = (int)strlen(tag);
+    const char *in = internName(tag, tl);
     int i;
 
+    if (in)
+    {
+        for (i = 0; i < ep->nel; i++)
+            if (ep->el[i]->tag.s == in)
+                return (ep->el[i]);
+        return (NULL);
+    }
+
     for (i = 0; i < ep->nel; i++)
     {
         String *sp = &ep->el[i]->tag;
@@ -614,6 +974,35 @@ int pcdatalenXMLEle(XMLEle *ep)
     return (ep->pcdata.sl);
 }
 
+/* return the content of the given element decoded while parsing, or NULL */
+void *blobXMLEle(XMLEle *ep, size_t *len)
+{
+    if (len)
+        *len = ep->bloblen;
+    return (ep->blob);
+}
+
+/* same as blobXMLEle, but the caller becomes the owner of the returned buffer */
+void *takeBlobXMLEle(XMLEle *ep, size_t *len)
+{
+    void *blob = blobXMLEle(ep, len);
+
+    ep->blob     = NULL;
+    ep->bloblen  = 0;
+    ep->blobsize = 0;
+    return (blob);
+}
+
+/* make blob the decoded content of ep, freed with it */
+void setBlobXMLEle(XMLEle *ep, void *blob, size_t len, void (*blobfree)(void *ptr))
+{
+    freeBlob(ep);
+    ep->blob     = blob;
+    ep->bloblen  = len;
+    ep->blobsize = len;
+    ep->blobfree = blobfree;
+}
+
 /* return the name of the given attribute */
 char *nameXMLAtt(XMLAtt *ap)
 {
@@ -647,21 +1036,64 @@ const char *findXMLAttValu(XMLEle *ep, const char *name)
     return (a ? a->valu.s : "");
 }
 
+#define READ_XML_FILE_BLOCK 65536 /* bytes of a regular file parsed at once */
+
+static int isRegularFile(FILE *fp)
+{
+#if defined(_MSC_VER)
+    struct _stat st;
+    return _fstat(_fileno(fp), &st) == 0 && (st.st_mode & _S_IFREG);
+#else
+    struct stat st;
+    return fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode);
+#endif
+}
+
 /* handy wrapper to read one xml file.
  * return root element else NULL with report in ynot[]
+ * regular files are read and parsed by blocks, so anything after the root element may be
+ * consumed too. pipes and terminals are read one character at a time, to leave it unread.
  */
 XMLEle *readXMLFile(FILE *fp, LilXML *lp, char ynot[])
 {
+    XMLEle *root = NULL;
+    char *buf;
+    size_t n;
     int c;
 
-    while ((c = fgetc(fp)) != EOF)
+    ynot[0] = '\0';
+    if (!isRegularFile(fp))
     {
-        XMLEle *root = readXMLEle(lp, c, ynot);
-        if (root || ynot[0])
-            return (root);
+        while ((c = fgetc(fp)) != EOF)
+        {
+            root = readXMLEle(lp, c, ynot);
+            if (root || ynot[0])
+                return (root);
+        }
+        return (NULL);
     }
 
-    return (NULL);
+    buf = (char *)malloc(READ_XML_FILE_BLOCK);
+    while (!root && (n = fread(buf, 1, READ_XML_FILE_BLOCK, fp)) > 0)
+    {
+        XMLEle **nodes = parseXMLChunk(lp, buf, (int)n, ynot);
+        if (!nodes)
+            break;
+
+        /* only the first root is wanted, as one character at a time would have stopped there */
+        root = nodes[0];
+        for (int i = 1; root && nodes[i]; i++)
+            delXMLEle(nodes[i]);
+        free(nodes);
+
+        if (ynot[0])
+            break;
+    }
+    free(buf);
+
+    if (root)
+        ynot[0] = '\0';
+    return (root);
 }
 
 /* add an element with the given tag to the given element.
@@ -669,8 +1101,8 @@ XMLEle *readXMLFile(FILE *fp, LilXML *lp, char ynot[])
  */
 XMLEle *addXMLEle(XMLEle *parent, const char *tag)
 {
-    XMLEle *ep = growEle(parent);
-    appendString(&ep->tag, tag);
+    XMLEle *ep = growEle(parent, parent ? parent->arena : NULL);
+    setName(&ep->tag, tag, (int)strlen(tag));
     return (ep);
 }
 
@@ -679,7 +1111,7 @@ XMLEle *addXMLEle(XMLEle *parent, const char *tag)
  */
 static void appXMLEle(XMLEle *ep, XMLEle *newep)
 {
-    ep->el            = (XMLEle **)moremem(ep->el, (ep->nel + 1) * sizeof(XMLEle *));
+    ep->el            = (XMLEle **)growArray(ep->arena, ep->el, ep->nel, sizeof(XMLEle *));
     ep->el[ep->nel++] = newep;
 }
 
@@ -688,8 +1120,7 @@ static void appXMLEle(XMLEle *ep, XMLEle *newep)
 XMLEle *setXMLEleTag(XMLEle *ep, const char * tag)
 {
     freeString(&ep->tag);
-    newString(&ep->tag);
-    appendString(&ep->tag, tag);
+    setName(&ep->tag, tag, (int)strlen(tag));
     return ep;
 }
 
@@ -699,14 +1130,14 @@ void editXMLEle(XMLEle *ep, const char *pcdata)
 {
     freeString(&ep->pcdata);
     appendString(&ep->pcdata, pcdata);
-    ep->pcdata_hasent = (strpbrk(pcdata, entities) != NULL);
+    ep->pcdata_hasent = entityFreeLength(ep->pcdata.s, ep->pcdata.sl) != (size_t)ep->pcdata.sl;
 }
 
 /* add an attribute to the given XML element */
 XMLAtt *addXMLAtt(XMLEle *ep, const char *name, const char *valu)
 {
     XMLAtt *ap = growAtt(ep);
-    appendString(&ap->name, name);
+    setName(&ap->name, name, (int)strlen(name));
     appendString(&ap->valu, valu);
     return (ap);
 }
@@ -714,11 +1145,12 @@ XMLAtt *addXMLAtt(XMLEle *ep, const char *name, const char *valu)
 /* remove the named attribute from ep, if any */
 void rmXMLAtt(XMLEle *ep, const char *name)
 {
+    XMLAtt *ap = findXMLAtt(ep, name);
     int i;
 
     for (i = 0; i < ep->nat; i++)
     {
-        if (strcmp(ep->at[i]->name.s, name) == 0)
+        if (ep->at[i] == ap)
         {
             freeAtt(ep->at[i]);
             memmove(&ep->at[i], &ep->at[i + 1], (--ep->nat - i) * sizeof(XMLAtt *));
@@ -763,6 +1195,14 @@ class XMLOutput
         {
             (void)ele;
         };
+        /* output the pcdata of ele */
+        virtual void putCData(XMLEle * ele)
+        {
+            if (ele->pcdata_hasent)
+                putEntityXML(ele->pcdata.s, ele->pcdata.sl);
+            else
+                put(ele->pcdata.s, ele->pcdata.sl);
+        }
     public:
         virtual void put(const char * str, size_t len) = 0;
         void put(const char * str)
@@ -773,7 +1213,7 @@ class XMLOutput
         {
             for(int i = 0 ; i < indent; ++i) put(PRINDENTSTR, PRINDENT);
         }
-        void putEntityXML(const char * str);
+        void putEntityXML(const char * str, size_t len);
 
         /* output a XML node */
         void putXML(XMLEle * el, int level);
@@ -791,7 +1231,7 @@ void XMLOutput::putXML(XMLEle *ep, int level)
         put(" ");
         put(ep->at[i]->name.s);
         put("=\"");
-        putEntityXML(ep->at[i]->valu.s);
+        putEntityXML(ep->at[i]->valu.s, ep->at[i]->valu.sl);
         put("\"");
     }
 
@@ -807,10 +1247,7 @@ void XMLOutput::putXML(XMLEle *ep, int level)
             put(">\n");
         // Declare the cdata offset
         cdataCb(ep);
-        if (ep->pcdata_hasent)
-            putEntityXML(ep->pcdata.s);
-        else
-            put(ep->pcdata.s);
+        putCData(ep);
         if (ep->pcdata.s[ep->pcdata.sl - 1] != '\n')
             put("\n");
     }
@@ -926,6 +1363,92 @@ size_t sprlXMLEle(XMLEle *ep, int level)
     return bxo.size();
 }
 
+/* XML Output to a growing buffer, referring to large pcdata instead of copying it */
+class VectorXMLOutput: public XMLOutput
+{
+        char * buffer;
+        size_t offset;
+        size_t room;
+        size_t minref;
+        XMLSpan * spans;
+        int nspans;
+        size_t spanStart; /* where the markup after the last referenced pcdata starts */
+
+        void addSpan(XMLEle * ele, size_t start, size_t len)
+        {
+            if (!(nspans & (nspans - 1)))
+                spans = (XMLSpan *)moremem(spans, (nspans ? 2 * nspans : 4) * sizeof(XMLSpan));
+            spans[nspans].ele    = ele;
+            spans[nspans].offset = start;
+            spans[nspans].len    = len;
+            nspans++;
+        }
+
+        /* close the markup span in progress, if any */
+        void endMarkup()
+        {
+            if (offset > spanStart)
+                addSpan(NULL, spanStart, offset - spanStart);
+            spanStart = offset;
+        }
+
+    protected:
+        virtual void putCData(XMLEle * ele)
+        {
+            if (ele->pcdata_hasent || (size_t)ele->pcdata.sl < minref)
+            {
+                XMLOutput::putCData(ele);
+                return;
+            }
+            endMarkup();
+            addSpan(ele, offset, ele->pcdata.sl);
+        }
+
+    public:
+        VectorXMLOutput(size_t minref) : XMLOutput(), buffer(nullptr), offset(0), room(0), minref(minref),
+            spans(nullptr), nspans(0), spanStart(0) {};
+        virtual ~VectorXMLOutput() {};
+        virtual void put(const char * str, size_t len)
+        {
+            if (offset + len + 1 > room)
+            {
+                room   = 2 * (offset + len + 1) > 1024 ? 2 * (offset + len + 1) : 1024;
+                buffer = (char *)moremem(buffer, room);
+            }
+            memcpy(buffer + offset, str, len);
+            offset += len;
+        }
+
+        /* the printed buffer, NUL terminated */
+        char * finish(size_t * len, XMLSpan ** outSpans, int * outNspans)
+        {
+            put("", 0);
+            buffer[offset] = '\0';
+            if (outSpans)
+            {
+                endMarkup();
+                *outSpans  = spans;
+                *outNspans = nspans;
+            }
+            if (len)
+                *len = offset;
+            return buffer;
+        }
+};
+
+/* print ep in a single pass into a malloced buffer, returned. With spans,
+ * pcdata without entities of at least minref bytes is not copied: the output
+ * is the malloced list of spans, in order, either from the buffer or from
+ * the pcdata of an element.
+ * N.B. set level = 0 on first call
+ */
+char *sprvXMLEle(XMLEle *ep, int level, size_t minref, XMLSpan **spans, int *nspans, size_t *len)
+{
+    VectorXMLOutput vxo(spans ? minref : (size_t) -1);
+    vxo.putXML(ep, level);
+    return vxo.finish(len, spans, nspans);
+}
+
 /* Return the exact starting offset of the CDATA of ep in the printed representation */
 size_t sprXMLCDataOffset(XMLEle * root, XMLEle * ep, int level)
 {
@@ -935,37 +1458,23 @@ size_t sprXMLCDataOffset(XMLEle * root, XMLEle * ep, int level)
     return bxo.cdataFound();
 }
 
-void XMLOutput::putEntityXML(const char * s)
+void XMLOutput::putEntityXML(const char * s, size_t n)
 {
-    const char *ep = NULL;
-    for (; (ep = strpbrk(s, entities)) != NULL; s = ep + 1)
+    for (;;)
     {
-        /* found another entity, copy preceding to malloced buffer */
-        size_t nnew = size_t(ep - s); /* all but entity itself */
-        put(s, nnew);
+        /* most values have no entities at all: they go out in one block */
+        size_t plain = entityFreeLength(s, n);
+        if (plain > 0)
+            put(s, plain);
+        if (plain == n)
+            return;
 
-        /* replace with entity encoding */
-        switch (*ep)
-        {
-            case '&':
-                put("&amp;");
-                break;
-            case '<':
-                put("&lt;");
-                break;
-            case '>':
-                put("&gt;");
-                break;
-            case '\'':
-                put("&apos;");
-                break;
-            case '"':
-                put("&quot;");
-                break;
-        }
+        size_t len;
+        const char *entity = entityOf(s[plain], &len);
+        put(entity, len);
+        s += plain + 1;
+        n -= plain + 1;
     }
-
-    put(s);
 }
 
 /* return a string with all xml-sensitive characters within the passed string s
@@ -976,60 +1485,40 @@ char *entityXML(char *s)
 {
     // FIXME: this is not thread safe. Signature must be changed (deprecate ?)
     static char *malbuf;
-    size_t nmalbuf = 0;
-    char *sret = NULL;
-    char *ep = NULL;
-
-    /* scan for each entity, if any */
-    for (sret = s; (ep = strpbrk(s, entities)) != NULL; s = ep + 1)
-    {
-        /* found another entity, copy preceding to malloced buffer */
-        size_t nnew = size_t(ep - s); /* all but entity itself */
-        sret = malbuf = (char*)moremem(malbuf, nmalbuf + nnew + 10);
-        memcpy(malbuf + nmalbuf, s, nnew);
-        nmalbuf += nnew;
+    static size_t nmalbuf;
 
-        /* replace with entity encoding */
-        switch (*ep)
-        {
-            case '&':
-                nmalbuf += sprintf(malbuf + nmalbuf, "&amp;");
-                break;
-            case '<':
-                nmalbuf += sprintf(malbuf + nmalbuf, "&lt;");
-                break;
-            case '>':
-                nmalbuf += sprintf(malbuf + nmalbuf, "&gt;");
-                break;
-            case '\'':
-                nmalbuf += sprintf(malbuf + nmalbuf, "&apos;");
-                break;
-            case '"':
-                nmalbuf += sprintf(malbuf + nmalbuf, "&quot;");
-                break;
-        }
-    }
+    /* return s if no entities */
+    size_t n = strlen(s);
+    size_t plain = entityFreeLength(s, n);
+    if (plain == n)
+        return s;
 
-    /* return s if no entities, else malloc cleaned-up copy */
-    if (sret == s)
+    /* else a cleaned-up copy in malbuf, kept from call to call: each char takes at most 6 */
+    if (nmalbuf < 6 * n + 1)
     {
-        /* using s, so free any alloced memory from last time */
-        if (malbuf)
-        {
-            free(malbuf);
-            malbuf = NULL;
-        }
-        return s;
+        nmalbuf = 6 * n + 1;
+        malbuf = (char *)moremem(malbuf, nmalbuf);
     }
-    else
+
+    char *out = malbuf;
+    for (;;)
     {
-        /* put remaining part of s into malbuf */
-        size_t nleft = strlen(s) + 1; /* include \0 */
-        sret = malbuf = (char*)moremem(malbuf, nmalbuf + nleft);
-        memcpy(malbuf + nmalbuf, s, nleft);
+        memcpy(out, s, plain);
+        out += plain;
+        if (plain == n)
+            break;
+
+        size_t len;
+        const char *entity = entityOf(s[plain], &len);
+        memcpy(out, entity, len);
+        out += len;
+        s += plain + 1;
+        n -= plain + 1;
+        plain = entityFreeLength(s, n);
     }
+    *out = '\0';
 
-    return (sret);
+    return malbuf;
 }
 
 /* if ent is a recognized xml entity sequence, set *cp to char and return 1
@@ -1078,7 +1567,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
         case LOOK4TAG: /* looking for element tag */
             if (isTokenChar(1, c))
             {
-                growString(&lp->ce->tag, c);
+                growString(&lp->token, c);
                 lp->cs = INTAG;
             }
             else if (!isspace(c))
@@ -1090,9 +1579,19 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
 
         case INTAG: /* reading tag */
             if (isTokenChar(0, c))
-                growString(&lp->ce->tag, c);
-            else if (c == '>')
+            {
+                growString(&lp->token, c);
+                break;
+            }
+            setName(&lp->ce->tag, lp->token.s, lp->token.sl);
+            lp->token.sl   = 0;
+            lp->token.s[0] = '\0';
+            if (c == '>')
+            {
+                startBlob(lp);
+                openEvent(lp);
                 lp->cs = LOOK4CON;
+            }
             else if (c == '/')
                 lp->cs = SAWSLASH;
             else
@@ -1101,13 +1600,17 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
 
         case LOOK4ATTRN: /* looking for attr name, > or / */
             if (c == '>')
+            {
+                startBlob(lp);
+                openEvent(lp);
                 lp->cs = LOOK4CON;
+            }
             else if (c == '/')
                 lp->cs = SAWSLASH;
             else if (isTokenChar(1, c))
             {
-                XMLAtt *ap = growAtt(lp->ce);
-                growString(&ap->name, c);
+                growAtt(lp->ce);
+                growString(&lp->token, c);
                 lp->cs = INATTRN;
             }
             else if (!isspace(c))
@@ -1120,6 +1623,8 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
         case SAWSLASH: /* saw / in element opening */
             if (c == '>')
             {
+                openEvent(lp);
+                closeEvent(lp);
                 if (!lp->ce->pe)
                     return (1); /* root has no content */
                 popXMLEle(lp);
@@ -1134,9 +1639,14 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
 
         case INATTRN: /* reading attr name */
             if (isTokenChar(0, c))
-                growString(&lp->ce->at[lp->ce->nat - 1]->name, c);
+                growString(&lp->token, c);
             else if (isspace(c) || c == '=')
-                lp->cs = LOOK4ATTRV;
+            {
+                setName(&lp->ce->at[lp->ce->nat - 1]->name, lp->token.s, lp->token.sl);
+                lp->token.sl   = 0;
+                lp->token.s[0] = '\0';
+                lp->cs         = LOOK4ATTRV;
+            }
             else
             {
                 sprintf(ynot, "Line %d: Bogus attr name char: %c", lp->ln, c);
@@ -1188,10 +1698,21 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
 
         case LOOK4CON: /* skipping leading content whitespace*/
             if (c == '<')
+            {
+                if (lp->decoding && endBlob(lp, ynot) < 0)
+                    return (-1);
                 lp->cs = SAWLTINCON;
+            }
             else if (!isspace(c))
             {
-                growString(&lp->ce->pcdata, c);
+                if (lp->decoding)
+                {
+                    char cc = c;
+                    if (decodeBlob(lp, &cc, 1, ynot) < 0)
+                        return (-1);
+                }
+                else
+                    growString(&lp->ce->pcdata, c);
                 lp->cs = INCON;
             }
             break;
@@ -1205,11 +1726,19 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
             }
             else if (c == '<')
             {
+                if (lp->decoding && endBlob(lp, ynot) < 0)
+                    return (-1);
                 /* chomp trailing whitespace */
                 while (lp->ce->pcdata.sl > 0 && isspace(lp->ce->pcdata.s[lp->ce->pcdata.sl - 1]))
                     lp->ce->pcdata.s[--(lp->ce->pcdata.sl)] = '\0';
                 lp->cs = SAWLTINCON;
             }
+            else if (lp->decoding)
+            {
+                char cc = c;
+                if (decodeBlob(lp, &cc, 1, ynot) < 0)
+                    return (-1);
+            }
             else
             {
                 growString(&lp->ce->pcdata, c);
@@ -1250,7 +1779,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
                 pushXMLEle(lp);
                 if (isTokenChar(1, c))
                 {
-                    growString(&lp->ce->tag, c);
+                    growString(&lp->token, c);
                     lp->cs = INTAG;
                 }
                 else
@@ -1281,7 +1810,8 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
                     sprintf(ynot, "Line %d: closing tag %s does not match %s", lp->ln, lp->endtag.s, lp->ce->tag.s);
                     return (-1);
                 }
-                else if (lp->ce->pe)
+                closeEvent(lp);
+                if (lp->ce->pe)
                 {
                     popXMLEle(lp);
                     lp->cs = LOOK4CON; /* back to content after nested elem */
@@ -1300,15 +1830,316 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
     return (0);
 }
 
+/* length of the leading run of p without '<', '&', delim or control chars.
+ * 16 bytes are checked at a time with SSE2 or NEON when available.
+ */
+static int plainLength(const char *p, int n, char delim)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i lt  = _mm_set1_epi8('<');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i dl  = _mm_set1_epi8(delim);
+    const __m128i ctl = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(0x7f);
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, amp));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, dl));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, del));
+
+        int bits = _mm_movemask_epi8(m);
+        if (bits)
+            return i + __builtin_ctz(bits);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t v = vld1q_u8((const uint8_t *)p + i);
+        uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8('<')), vceqq_u8(v, vdupq_n_u8('&')));
+        m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8((uint8_t)delim)));
+        m = vorrq_u8(m, vcltq_u8(v, vdupq_n_u8(0x20)));
+        m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8(0x7f)));
+
+        /* one nibble per byte */
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (bits)
+            return i + (__builtin_ctzll(bits) >> 2);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        unsigned char c = p[i];
+        if (c == '<' || c == '&' || c == (unsigned char)delim || c < 0x20 || c == 0x7f)
+            break;
+    }
+    return i;
+}
+
+/* length of the leading run of token chars of p */
+static int tokenLength(const char *p, int n)
+{
+    int i = 0;
+    while (i < n && isTokenChar(0, p[i]))
+        i++;
+    return i;
+}
+
+/* append the leading run of p that oneXMLchar() would only add to a string
+ * in the current state, whatever its length. Return its length, 0 when the
+ * next char needs the state machine, -1 with reason in ynot[] on error.
+ */
+static int plainXMLRun(LilXML *lp, const char *p, int n, char ynot[])
+{
+    String *sp;
+    int l;
+
+    switch (lp->cs)
+    {
+        case INCON:
+            sp = &lp->ce->pcdata;
+            l  = plainLength(p, n, '<');
+            if (lp->decoding && l > 0)
+            {
+                if (decodeBlob(lp, p, l, ynot) < 0)
+                    return (-1);
+                lp->lastc = p[l - 1];
+                return (l);
+            }
+            break;
+
+        case INATTRV:
+            sp = &lp->ce->at[lp->ce->nat - 1]->valu;
+            l  = plainLength(p, n, lp->delim);
+            break;
+
+        case INTAG:
+        case INATTRN:
+            sp = &lp->token;
+            l  = tokenLength(p, n);
+            break;
+
+        case INCLOSETAG:
+            sp = &lp->endtag;
+            l  = tokenLength(p, n);
+            break;
+
+        default:
+            return 0;
+    }
+
+    if (l > 0)
+    {
+        appendChars(sp, p, l);
+        lp->lastc = p[l - 1];
+    }
+    return l;
+}
+
+/* start decoding the content of ce if it is a oneBLOB of known size.
+ * compressed formats are left alone: their size is not the decoded one.
+ * binary content, size bytes right after the opening tag line, is always read to ce->blob.
+ */
+static void startBlob(LilXML *lp)
+{
+    XMLEle *ep = lp->ce;
+
+    if (strcmp(ep->tag.s, "oneBLOB"))
+        return;
+
+    if (!strcmp(findXMLAttValu(ep, "binary"), "true"))
+    {
+        long size = atol(findXMLAttValu(ep, "size"));
+        if (size > 0)
+        {
+            lp->rawleft = size;
+            lp->rawnl   = 1;
+            /* the allocator may change before the content is all there */
+            lp->cerealloc = lp->blobrealloc ? lp->blobrealloc : realloc;
+            lp->cefree    = lp->blobrealloc ? lp->blobfree : free;
+        }
+        return;
+    }
+
+    if (!lp->blobrealloc)
+        return;
+
+    const char *format = findXMLAttValu(ep, "format");
+    size_t fl          = strlen(format);
+    if ((fl >= 2 && !strcmp(format + fl - 2, ".z")) || (fl >= 4 && !strcmp(format + fl - 4, ".zst")) ||
+            (fl >= 4 && !strcmp(format + fl - 4, ".lz4")))
+        return;
+
+    long size = atol(findXMLAttValu(ep, "size"));
+    if (size <= 0)
+        return;
+
+    /* allocated with the first content char, empty attached BLOBs cost nothing */
+    lp->decoding   = 1;
+    lp->blobexpect = size;
+    lp->nquad      = 0;
+    lp->cerealloc  = lp->blobrealloc;
+    lp->cefree     = lp->blobfree;
+}
+
+/* decode the n base64 chars at p to ce->blob. Whitespace is skipped between
+ * groups, not within the whole groups at p.
+ * return 0, or -1 with reason in ynot[] on error.
+ */
+static int decodeBlob(LilXML *lp, const char *p, int n, char ynot[])
+{
+    XMLEle *ep  = lp->ce;
+    size_t need = ep->bloblen + 3 * ((lp->nquad + n) / 4 + 1);
+
+    if (need > ep->blobsize)
+    {
+        size_t size = ep->blobsize ? 2 * ep->blobsize : lp->blobexpect;
+        if (size < need)
+            size = need;
+
+        void *blob = lp->cerealloc ? (*lp->cerealloc)(ep->blob, size) : NULL;
+        if (!blob)
+        {
+            sprintf(ynot, "Line %d: no memory for %lu bytes of BLOB", lp->ln, (unsigned long)size);
+            return (-1);
+        }
+        ep->blob     = blob;
+        ep->blobsize = size;
+        ep->blobfree = lp->cefree;
+    }
+
+    char *out = (char *)ep->blob + ep->bloblen;
+
+    /* complete the pending group */
+    while (lp->nquad && n > 0)
+    {
+        n--;
+        if (isspace(*p))
+        {
+            p++;
+            continue;
+        }
+        lp->quad[lp->nquad++] = *p++;
+        if (lp->nquad == 4)
+        {
+            out += from64tobits_fast(out, lp->quad, 4);
+            lp->nquad = 0;
+        }
+    }
+
+    int whole = n & ~3;
+    if (whole)
+    {
+        out += from64tobits_fast(out, p, whole);
+        p += whole;
+        n -= whole;
+    }
+
+    for (; n > 0; n--, p++)
+        if (!isspace(*p))
+            lp->quad[lp->nquad++] = *p;
+
+    ep->bloblen = out - (char *)ep->blob;
+    return (0);
+}
+
+/* copy up to n bytes of binary content at p to ce->blob, allocated with the whole size on the first one.
+ * without setBlobDecodeLilXML(), the buffer comes from realloc() and goes with free().
+ * return the count of bytes used, or -1 with reason in ynot[] on error.
+ */
+static int rawXMLRun(LilXML *lp, const char *p, int n, char ynot[])
+{
+    XMLEle *ep = lp->ce;
+
+    if (lp->rawnl)
+    {
+        lp->rawnl = 0;
+        if (*p == '\n')
+        {
+            lp->ln++;
+            return (1);
+        }
+    }
+
+    if (!ep->blob)
+    {
+        void *blob = lp->cerealloc ? (*lp->cerealloc)(NULL, lp->rawleft) : NULL;
+        if (!blob)
+        {
+            sprintf(ynot, "Line %d: no memory for %lu bytes of BLOB", lp->ln, (unsigned long)lp->rawleft);
+            return (-1);
+        }
+        ep->blob     = blob;
+        ep->blobsize = lp->rawleft;
+        ep->blobfree = lp->cefree;
+    }
+
+    if ((size_t)n > lp->rawleft)
+        n = lp->rawleft;
+    memcpy((char *)ep->blob + ep->bloblen, p, n);
+    ep->bloblen += n;
+    lp->rawleft -= n;
+    lp->lastc = 0;
+    return (n);
+}
+
+/* done with the content of ce: decode a last unpadded group and drop spare room.
+ * return 0, or -1 with reason in ynot[] on error.
+ */
+static int endBlob(LilXML *lp, char ynot[])
+{
+    XMLEle *ep = lp->ce;
+
+    lp->decoding = 0;
+
+    if (lp->nquad > 1)
+    {
+        static const char pad[] = "==";
+        int npad = 4 - lp->nquad;
+        if (decodeBlob(lp, pad, npad, ynot) < 0)
+            return (-1);
+    }
+    lp->nquad = 0;
+
+    if (ep->blob && ep->bloblen > 0 && ep->bloblen < ep->blobsize && lp->cerealloc)
+    {
+        void *blob = (*lp->cerealloc)(ep->blob, ep->bloblen);
+        if (blob)
+        {
+            ep->blob     = blob;
+            ep->blobsize = ep->bloblen;
+        }
+    }
+    return (0);
+}
+
 /* set up for a fresh start again */
 static void initParser(LilXML *lp)
 {
-    delXMLEle(lp->ce);
+    int arena = lp->arena;
+    void *(*blobrealloc)(void *ptr, size_t size) = lp->blobrealloc;
+    void (*blobfree)(void *ptr) = lp->blobfree;
+    const XMLHandler *handler = lp->handler;
+    void *self = lp->self;
+
+    delXMLTree(lp->ce);
     freeString(&lp->endtag);
+    freeString(&lp->token);
     memset(lp, 0, sizeof(*lp));
     newString(&lp->endtag);
+    newString(&lp->token);
     lp->cs = LOOK4START;
     lp->ln = 1;
+    lp->arena = arena;
+    lp->blobrealloc = blobrealloc;
+    lp->blobfree = blobfree;
+    lp->handler = handler;
+    lp->self = self;
 }
 
 /* start a new XMLEle.
@@ -1318,7 +2149,8 @@ static void initParser(LilXML *lp)
  */
 static void pushXMLEle(LilXML *lp)
 {
-    lp->ce = growEle(lp->ce);
+    XMLArena *arena = lp->ce ? lp->ce->arena : (lp->arena ? newArena() : NULL);
+    lp->ce = growEle(lp->ce, arena);
     resetEndTag(lp);
 }
 
@@ -1327,25 +2159,80 @@ static void pushXMLEle(LilXML *lp)
  */
 static void popXMLEle(LilXML *lp)
 {
+    XMLEle *done = lp->ce;
+
     lp->ce = lp->ce->pe;
     resetEndTag(lp);
+
+    /* reported: nobody wants it any more */
+    if (lp->handler)
+        delXMLEle(done);
+}
+
+/* return the number of ancestors of ep */
+static int depthXMLEle(XMLEle *ep)
+{
+    int depth = 0;
+
+    for (; ep->pe; ep = ep->pe)
+        depth++;
+    return (depth);
+}
+
+/* report the opening of ce with its attributes, if a handler is set */
+static void openEvent(LilXML *lp)
+{
+    const XMLHandler *h = lp->handler;
+    XMLEle *ep          = lp->ce;
+    int i;
+
+    if (!h)
+        return;
+    if (h->startElement)
+        (*h->startElement)(lp->self, ep->tag.s, depthXMLEle(ep));
+    if (h->attribute)
+        for (i = 0; i < ep->nat; i++)
+            (*h->attribute)(lp->self, ep->at[i]->name.s, ep->at[i]->valu.s, ep->at[i]->valu.sl);
+}
+
+/* report the content and closing of ce, if a handler is set */
+static void closeEvent(LilXML *lp)
+{
+    const XMLHandler *h = lp->handler;
+    XMLEle *ep          = lp->ce;
+
+    if (!h)
+        return;
+    if (h->text && ep->pcdata.sl > 0)
+        (*h->text)(lp->self, ep->pcdata.s, ep->pcdata.sl);
+    if (h->endElement)
+        (*h->endElement)(lp->self, ep->tag.s, depthXMLEle(ep));
 }
 
-/* return one new XMLEle, added to the given element if given */
-static XMLEle *growEle(XMLEle *pe)
+/* return one new XMLEle from arena, added to the given element if given.
+ * a new element without parent is the root of its arena.
+ */
+static XMLEle *growEle(XMLEle *pe, XMLArena *arena)
 {
-    XMLEle *newe = (XMLEle *)moremem(NULL, sizeof(XMLEle));
+    XMLEle *newe = (XMLEle *)xmlAlloc(arena, sizeof(XMLEle));
 
     memset(newe, 0, sizeof(XMLEle));
-    newString(&newe->tag);
+    newe->arena        = arena;
+    newe->tag.arena    = arena;
+    newe->pcdata.arena = arena;
+    setName(&newe->tag, "", 0);
     newString(&newe->pcdata);
     newe->pe = pe;
 
     if (pe)
     {
-        pe->el            = (XMLEle **)moremem(pe->el, (pe->nel + 1) * sizeof(XMLEle *));
+        pe->el            = (XMLEle **)growArray(pe->arena, pe->el, pe->nel, sizeof(XMLEle *));
         pe->el[pe->nel++] = newe;
     }
+    else if (arena)
+    {
+        arena->root = newe;
+    }
 
     return (newe);
 }
@@ -1353,19 +2240,31 @@ static XMLEle *growEle(XMLEle *pe)
 /* add room for and return one new XMLAtt to the given element */
 static XMLAtt *growAtt(XMLEle *ep)
 {
-    XMLAtt *newa = (XMLAtt *)moremem(NULL, sizeof * newa);
+    XMLAtt *newa = (XMLAtt *)xmlAlloc(ep->arena, sizeof * newa);
 
     memset(newa, 0, sizeof(*newa));
-    newString(&newa->name);
+    newa->name.arena = ep->arena;
+    newa->valu.arena = ep->arena;
+    setName(&newa->name, "", 0);
     newString(&newa->valu);
     newa->ce = ep;
 
-    ep->at            = (XMLAtt **)moremem(ep->at, (ep->nat + 1) * sizeof(XMLAtt *));
+    ep->at            = (XMLAtt **)growArray(ep->arena, ep->at, ep->nat, sizeof(XMLAtt *));
     ep->at[ep->nat++] = newa;
 
     return (newa);
 }
 
+/* return array, resized to hold at least n + 1 items.
+ * capacity doubles at each power of two, so it is never stored.
+ */
+static void *growArray(XMLArena *arena, void *array, int n, size_t elsize)
+{
+    if (n & (n - 1))
+        return array;
+    return xmlRealloc(arena, array, n * elsize, (n ? 2 * n : 1) * elsize);
+}
+
 /* free a and all it holds */
 static void freeAtt(XMLAtt *a)
 {
@@ -1373,7 +2272,7 @@ static void freeAtt(XMLAtt *a)
         return;
     freeString(&a->name);
     freeString(&a->valu);
-    (*myfree)(a);
+    xmlFree(a->ce ? a->ce->arena : NULL, a, sizeof(*a));
 }
 
 /* reset endtag */
@@ -1402,7 +2301,7 @@ static void growString(String *sp, int c)
             newString(sp);
         else
         {
-            sp->s = (char *)moremem(sp->s, sp->sm *= 2);
+            resizeString(sp, sp->sm ? sp->sm * 2 : MINMEM + l);
         }
     }
     sp->s[--l] = '\0';
@@ -1425,7 +2324,7 @@ static void appendString(String *sp, const char *str)
             newString(sp);
         if (l > sp->sm)
         {
-            sp->s = (char *)moremem(sp->s, (sp->sm = l));
+            resizeString(sp, l);
         }
     }
     if (sp->s)
@@ -1441,22 +2340,89 @@ static void newString(String *sp)
     if (!sp)
         return;
 
-    sp->s  = (char *)moremem(NULL, MINMEM);
+    sp->s  = (char *)xmlAlloc(sp->arena, MINMEM);
     sp->sm = MINMEM;
     *sp->s = '\0';
     sp->sl = 0;
 }
 
-/* free memory used by the given String */
+/* append the n chars at str to sp, doubling its room as needed */
+static void appendChars(String *sp, const char *str, int n)
+{
+    int l = sp->sl + n + 1; /* need room for '\0' */
+
+    if (l > sp->sm)
+    {
+        if (!sp->s)
+            newString(sp);
+        if (l > sp->sm)
+            resizeString(sp, l > 2 * sp->sm ? l : 2 * sp->sm);
+    }
+    memcpy(&sp->s[sp->sl], str, n);
+    sp->sl += n;
+    sp->s[sp->sl] = '\0';
+}
+
+/* resize the storage of the given String to n bytes */
+static void resizeString(String *sp, int n)
+{
+    if (!sp->sm)
+    {
+        /* an interned name gets its own copy first */
+        char *s = (char *)xmlAlloc(sp->arena, n);
+        memcpy(s, sp->s, sp->sl + 1);
+        sp->s  = s;
+        sp->sm = n;
+        return;
+    }
+    sp->s  = (char *)xmlRealloc(sp->arena, sp->s, sp->sm, n);
+    sp->sm = n;
+}
+
+/* free memory used by the given String. It stays in the same arena */
 static void freeString(String *sp)
 {
-    if (sp->s)
-        (*myfree)(sp->s);
+    if (sp->sm)
+        xmlFree(sp->arena, sp->s, sp->sm);
     sp->s  = NULL;
     sp->sl = 0;
     sp->sm = 0;
 }
 
+/* return the interned copy of the n chars at name, NULL if not in the vocabulary */
+static const char *internName(const char *name, int n)
+{
+    static Vocabulary table;
+    unsigned h = Vocabulary::hash(name, n) & (VOCABSLOTS - 1);
+
+    for (; table.slot[h]; h = (h + 1) & (VOCABSLOTS - 1))
+        if (table.len[h] == n && !memcmp(table.slot[h], name, n))
+            return table.slot[h];
+    return (NULL);
+}
+
+const char *internXMLName(const char *name)
+{
+    return internName(name, (int)strlen(name));
+}
+
+/* set the empty String sp to the n chars at name: interned if possible, else copied */
+static void setName(String *sp, const char *name, int n)
+{
+    static char empty[1];
+    const char *in = n ? internName(name, n) : empty;
+
+    if (in)
+    {
+        sp->s  = (char *)in;
+        sp->sl = n;
+        sp->sm = 0;
+        return;
+    }
+    newString(sp);
+    appendChars(sp, name, n);
+}
+
 /* like malloc but knows to use realloc if already started */
 static void *moremem(void *old, size_t n)
 {
@@ -1469,6 +2435,131 @@ static void *moremem(void *old, size_t n)
     return p;
 }
 
+/* new arena, living in its own first chunk */
+static XMLArena *newArena()
+{
+    XMLArenaChunk *chunk = (XMLArenaChunk *)moremem(NULL, sizeof(XMLArenaChunk) + ARENA_CHUNK);
+    chunk->next = NULL;
+    chunk->size = ARENA_CHUNK;
+    chunk->used = sizeof(XMLArena);
+
+    XMLArena *arena = (XMLArena *)(chunk + 1);
+    memset(arena, 0, sizeof(*arena));
+    arena->chunks  = chunk;
+    arena->nchunks = 1;
+    return arena;
+}
+
+/* release all the memory of arena, including itself */
+static void delArena(XMLArena *arena)
+{
+    XMLArenaLarge *large = arena->large;
+    while (large)
+    {
+        XMLArenaLarge *next = large->next;
+        (*myfree)(large);
+        large = next;
+    }
+
+    XMLArenaChunk *chunk = arena->chunks;
+    while (chunk)
+    {
+        XMLArenaChunk *next = chunk->next;
+        (*myfree)(chunk);
+        chunk = next;
+    }
+}
+
+/* n bytes from arena if given, else from the heap */
+static void *xmlAlloc(XMLArena *arena, size_t n)
+{
+    if (!arena)
+        return moremem(NULL, n);
+
+    if (n >= ARENA_LARGE)
+    {
+        XMLArenaLarge *large = (XMLArenaLarge *)moremem(NULL, sizeof(XMLArenaLarge) + n);
+        large->prev = NULL;
+        large->next = arena->large;
+        if (arena->large)
+            arena->large->prev = large;
+        arena->large = large;
+        return large + 1;
+    }
+
+    /* keep pointers aligned */
+    n = (n + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    XMLArenaChunk *chunk = arena->chunks;
+    if (chunk->used + n > chunk->size)
+    {
+        size_t size = (size_t)ARENA_CHUNK << (arena->nchunks < 4 ? arena->nchunks : 4);
+        chunk = (XMLArenaChunk *)moremem(NULL, sizeof(XMLArenaChunk) + size);
+        chunk->next = arena->chunks;
+        chunk->size = size;
+        chunk->used = 0;
+        arena->chunks = chunk;
+        arena->nchunks++;
+    }
+
+    void *p = (char *)(chunk + 1) + chunk->used;
+    chunk->used += n;
+    return p;
+}
+
+/* resize p, of oldn bytes, to n bytes */
+static void *xmlRealloc(XMLArena *arena, void *old, size_t oldn, size_t n)
+{
+    if (!arena)
+        return moremem(old, n);
+
+    if (!old)
+        return xmlAlloc(arena, n);
+
+    if (oldn >= ARENA_LARGE && n >= ARENA_LARGE)
+    {
+        XMLArenaLarge *large = (XMLArenaLarge *)old - 1;
+        XMLArenaLarge *prev  = large->prev;
+        XMLArenaLarge *next  = large->next;
+
+        large = (XMLArenaLarge *)moremem(large, sizeof(XMLArenaLarge) + n);
+        if (prev)
+            prev->next = large;
+        else
+            arena->large = large;
+        if (next)
+            next->prev = large;
+        return large + 1;
+    }
+
+    void *p = xmlAlloc(arena, n);
+    memcpy(p, old, oldn < n ? oldn : n);
+    xmlFree(arena, old, oldn);
+    return p;
+}
+
+/* free p, of n bytes. Memory from the chunks is only reclaimed with the arena */
+static void xmlFree(XMLArena *arena, void *p, size_t n)
+{
+    if (!arena)
+    {
+        (*myfree)(p);
+        return;
+    }
+
+    if (n >= ARENA_LARGE)
+    {
+        XMLArenaLarge *large = (XMLArenaLarge *)p - 1;
+        if (large->prev)
+            large->prev->next = large->next;
+        else
+            arena->large = large->next;
+        if (large->next)
+            large->next->prev = large->prev;
+        (*myfree)(large);
+    }
+}
+
 #if defined(MAIN_TST)
 int main(int ac, char *av[])
 {
@@ -92,6 +92,50 @@ extern LilXML *newLilXML();
 */
 extern void delLilXML(LilXML *lp);
 
+/** \brief Allocate the trees parsed by a lilxml parser from arenas.
+    \param lp a pointer to a lilxml parser.
+    \param enable non-zero to give each new root element its own arena, zero to use the heap.
+    \note All the elements, attributes and strings of a tree then come from its arena, which is released at once by delXMLEle() on the root. Deleting any other element of the tree only unlinks it. Trees keep working with all the editing functions.
+*/
+extern void setArenaLilXML(LilXML *lp, int enable);
+
+/** \brief Callbacks of an event driven lilxml parser, see setHandlerLilXML(). Each may be NULL. */
+typedef struct
+{
+    /** \brief An element opened. depth is 0 for a root element. */
+    void (*startElement)(void *self, const char *tag, int depth);
+    /** \brief One attribute of the element just opened. */
+    void (*attribute)(void *self, const char *name, const char *valu, int len);
+    /** \brief The whole content of the element about to close, entities decoded and whitespace trimmed. */
+    void (*text)(void *self, const char *text, int len);
+    /** \brief An element closed, after all its children. */
+    void (*endElement)(void *self, const char *tag, int depth);
+} XMLHandler;
+
+/** \brief Report elements to callbacks instead of building trees.
+    \param lp a pointer to a lilxml parser.
+    \param handler the callbacks, NULL to go back to building trees. It must stay valid while in use.
+    \param self passed to every callback.
+    \note parseXMLChunk() and readXMLEle() then return no element: each one is deleted once reported, so the parser only holds the elements still open. Names are interned (see internXMLName()), strings are only valid during the callback. Combined with setArenaLilXML(), parsing a message allocates almost nothing. Content decoded by setBlobDecodeLilXML() is not reported.
+*/
+extern void setHandlerLilXML(LilXML *lp, const XMLHandler *handler, void *self);
+
+/** \brief Decode the base64 content of oneBLOB elements while parsing.
+    \param lp a pointer to a lilxml parser.
+    \param blobrealloc allocates and resizes the decoded buffers, like realloc. NULL to keep the content as base64 pcdata.
+    \param blobfree frees the decoded buffers.
+    \note Only oneBLOB elements with a size attribute and a format not ending with .z are decoded, in a buffer of that size. Their pcdata stays empty, get the data with blobXMLEle() or takeBlobXMLEle().
+    \note May be called between chunks: a oneBLOB already started is read to its end with the functions it started with.
+    \note A oneBLOB with binary="true" holds size raw bytes after the line of its opening tag. They are always read to the buffer, with blobrealloc when set and realloc() otherwise, the caller then frees them with blobfree or free().
+*/
+extern void setBlobDecodeLilXML(LilXML *lp, void *(*blobrealloc)(void *ptr, size_t size), void (*blobfree)(void *ptr));
+
+/** \brief Return how much of the content of the oneBLOB being parsed is still to come.
+    \param lp a pointer to a lilxml parser.
+    \return the bytes announced by the size or enclen attributes not parsed yet, or 0 when not in the content of a oneBLOB. A hint to size reads, the actual content may be a little longer, e.g. with line breaks.
+*/
+extern size_t pendingContentLilXML(LilXML *lp);
+
 /**
  * @brief delXMLEle Delete XML element.
  * @param e Pointer to XML element to delete. If nullptr, no action is taken.
@@ -156,6 +200,13 @@ extern XMLEle *parentXMLEle(XMLEle *ep);
 */
 extern XMLEle *parentXMLAtt(XMLAtt *ap);
 
+/** \brief Return the interned copy of an INDI tag or attribute name.
+    \param name the tag or attribute name.
+    \return the pointer shared by all the tags and attribute names equal to name, or NULL if name is not part of the INDI vocabulary.
+    \note Tags and attribute names of the protocol share static storage: compare tagXMLEle() or nameXMLAtt() with the returned pointer instead of strcmp(). Never modify it.
+*/
+extern const char *internXMLName(const char *name);
+
 /* access functions */
 /** \brief Return the tag of an XML element.
     \param ep a pointer to an XML element.
@@ -187,6 +238,28 @@ extern char *valuXMLAtt(XMLAtt *ap);
 */
 extern int pcdatalenXMLEle(XMLEle *ep);
 
+/** \brief Return the content of an XML element decoded while parsing, see setBlobDecodeLilXML().
+    \param ep a pointer to an XML element.
+    \param len if not NULL, set to the number of decoded bytes.
+    \return the decoded data, or NULL if the content was not decoded. It is freed with the element.
+*/
+extern void *blobXMLEle(XMLEle *ep, size_t *len);
+
+/** \brief Take the content of an XML element decoded while parsing, see setBlobDecodeLilXML().
+    \param ep a pointer to an XML element.
+    \param len if not NULL, set to the number of decoded bytes.
+    \return the decoded data, or NULL if the content was not decoded. The caller must free it with the blobfree function given to the parser.
+*/
+extern void *takeBlobXMLEle(XMLEle *ep, size_t *len);
+
+/** \brief Give an XML element decoded content, as if decoded while parsing, for content received out of the XML.
+    \param ep a pointer to an XML element.
+    \param blob the content, owned by the element from now on. Any previous content is freed.
+    \param len the number of bytes in blob.
+    \param blobfree frees blob with the element.
+*/
+extern void setBlobXMLEle(XMLEle *ep, void *blob, size_t len, void (*blobfree)(void *ptr));
+
 /** \brief Return the number of nested XML elements in a parent XML element.
     \param ep a pointer to an XML element.
     \return the number of nested XML elements.
@@ -293,6 +366,26 @@ extern size_t sprXMLEle(char *s, XMLEle *ep, int level);
 */
 extern size_t sprlXMLEle(XMLEle *ep, int level);
 
+/** \brief A part of the output of sprvXMLEle(). */
+typedef struct
+{
+    XMLEle *ele;   /**< element whose pcdata is the part, NULL for a part of the printed buffer */
+    size_t offset; /**< start of the part in the printed buffer, when ele is NULL */
+    size_t len;    /**< length of the part */
+} XMLSpan;
+
+/** \brief print ep in a single pass, without measuring it first.
+*   \param ep the XML element to print.
+*   \param level the printing level, set to 0 to print the whole element.
+*   \param minref pcdata without entities of at least that many bytes is referred to by a span instead of being copied.
+*   \param spans if not NULL, set to a malloced array of the parts of the output, in order. If NULL, the buffer holds the whole output.
+*   \param nspans if spans is not NULL, set to the number of spans.
+*   \param len if not NULL, set to the length of the printed buffer (sans trailing @\0@).
+*   \return the malloced printed buffer. Free it and spans with free().
+*   N.B. referred pcdata is only valid while its element is.
+*/
+extern char *sprvXMLEle(XMLEle *ep, int level, size_t minref, XMLSpan **spans, int *nspans, size_t *len);
+
 /** \brief return exact position of cdata of child in printed representation of root
 *   N.B. set level = 0 on first call.
 */
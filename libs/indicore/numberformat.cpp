@@ -0,0 +1,171 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "numberformat.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define HAVE_FLOAT_CHARCONV
+#endif
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+int indi_format_shortest(char *out, size_t size, double value)
+{
+    if (size == 0)
+        return -1;
+#ifdef HAVE_FLOAT_CHARCONV
+    auto result = std::to_chars(out, out + size - 1, value);
+    if (result.ec != std::errc())
+        return -1;
+    *result.ptr = '\0';
+    return static_cast<int>(result.ptr - out);
+#else
+    int len = snprintf(out, size, "%.17g", value);
+    return (len < 0 || static_cast<size_t>(len) >= size) ? -1 : len;
+#endif
+}
+
+int indi_format_printf(char *out, size_t size, const char *format, double value)
+{
+#ifdef HAVE_FLOAT_CHARCONV
+    if (!std::isfinite(value))
+        return -1;
+
+    const char *spec = strchr(format, '%');
+    if (spec == nullptr)
+        return -1;
+
+    // %[flags][width][.precision][l]conversion
+    const char *p = spec + 1;
+    bool left = false, zero = false, plus = false, space = false;
+    for (;; p++)
+    {
+        if (*p == '-')
+            left = true;
+        else if (*p == '0')
+            zero = true;
+        else if (*p == '+')
+            plus = true;
+        else if (*p == ' ')
+            space = true;
+        else
+            break;
+    }
+
+    int width = 0, precision = 6;
+    for (; *p >= '0' && *p <= '9'; p++)
+        if ((width = width * 10 + (*p - '0')) > 256)
+            return -1;
+    if (*p == '.')
+    {
+        precision = 0;
+        for (p++; *p >= '0' && *p <= '9'; p++)
+            if ((precision = precision * 10 + (*p - '0')) > 64)
+                return -1;
+    }
+    if (*p == 'l')
+        p++;
+
+    std::chars_format fmt;
+    switch (*p++)
+    {
+        case 'f': fmt = std::chars_format::fixed;      break;
+        case 'e': fmt = std::chars_format::scientific; break;
+        case 'g': fmt = std::chars_format::general;    break;
+        default: return -1;
+    }
+    const char *suffix = p;
+    if (strchr(suffix, '%') != nullptr)
+        return -1;
+
+    // the digits, then the sign and the padding around them
+    char digits[128];
+    auto result = std::to_chars(digits, digits + sizeof(digits), std::fabs(value), fmt, precision);
+    if (result.ec != std::errc())
+        return -1;
+    size_t ndigits = result.ptr - digits;
+
+    char sign = std::signbit(value) ? '-' : plus ? '+' : space ? ' ' : '\0';
+    size_t len = ndigits + (sign != '\0');
+    size_t pad = static_cast<size_t>(width) > len ? width - len : 0;
+    size_t prefixLen = spec - format, suffixLen = strlen(suffix);
+    size_t total = prefixLen + len + pad + suffixLen;
+    if (total >= size)
+        return -1;
+
+    char *o = out;
+    memcpy(o, format, prefixLen);
+    o += prefixLen;
+    if (!left && !zero)
+    {
+        memset(o, ' ', pad);
+        o += pad;
+    }
+    if (sign != '\0')
+        *o++ = sign;
+    if (!left && zero)
+    {
+        memset(o, '0', pad);
+        o += pad;
+    }
+    memcpy(o, digits, ndigits);
+    o += ndigits;
+    if (left)
+    {
+        memset(o, ' ', pad);
+        o += pad;
+    }
+    memcpy(o, suffix, suffixLen + 1);
+    return static_cast<int>(total);
+#else
+    (void)out;
+    (void)size;
+    (void)format;
+    (void)value;
+    return -1;
+#endif
+}
+
+int indi_scan_number(const char *str, double *dp)
+{
+#ifdef HAVE_FLOAT_CHARCONV
+    while (isSpace(*str))
+        str++;
+    const char *end = str + strlen(str);
+
+    double value;
+    auto result = std::from_chars(str, end, value);
+    if (result.ec != std::errc())
+        return -1;
+    for (const char *p = result.ptr; p != end; p++)
+        if (!isSpace(*p))
+            return -1;
+    *dp = value;
+    return 0;
+#else
+    (void)str;
+    (void)dp;
+    return -1;
+#endif
+}
@@ -0,0 +1,46 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Locale independent number conversions, without going through printf or scanf.
+ * They handle the common cases; callers fall back to the libc functions when they return -1.
+ */
+
+/* Write value in the shortest form that reads back as the same double.
+ * return the number of characters written to out, not counting final '\0', or -1 if it does not fit.
+ */
+int indi_format_shortest(char *out, size_t size, double value);
+
+/* Write a finite value as snprintf(out, size, format, value) would, for a format made of a single
+ * %f, %e or %g conversion with optional flags, width and precision and text around it without '%'.
+ * return the number of characters written to out, or -1 for any other format or if it does not fit.
+ */
+int indi_format_printf(char *out, size_t size, const char *format, double value);
+
+/* Read a plain decimal number, with optional white space around it, into *dp.
+ * return 0 if ok, -1 if str is anything else.
+ */
+int indi_scan_number(const char *str, double *dp);
+
+#ifdef __cplusplus
+}
+#endif
@@ -44,6 +44,10 @@ static pthread_mutex_t shared_buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
 // A shared buffer will be allocated by chunk of at least 1M (must be ^ 2)
 #define BLOB_SIZE_UNIT 0x100000
 
+// Buffers freed before being shared are kept for reuse, up to that many and that many bytes
+#define BLOB_POOL_MAX 8
+#define BLOB_POOL_MAX_BYTES (64 * BLOB_SIZE_UNIT)
+
 typedef struct shared_buffer
 {
     void * mapstart;
@@ -70,10 +74,82 @@ static shared_buffer * sharedBufferRemove(void * mapstart);
 #endif
 static shared_buffer * sharedBufferFind(void * mapstart);
 
+#ifdef ENABLE_INDI_SHARED_MEMORY
+/* Unsealed buffers nobody else has seen: their fd was never given away. Those of the BLOBs sent
+ * attached are not here: IDSharedBlobGetFd() seals them, and the receivers may map them for as long
+ * as they like, so they are unmapped and closed when freed. What comes back is what was freed unshared:
+ * frames resized or dropped, BLOBs decoded then discarded, or sent as base64 to a peer that can not
+ * receive buffers.
+ */
+static shared_buffer * pool[BLOB_POOL_MAX];
+static int poolCount = 0;
+static size_t poolBytes = 0;
+
+/* Take a pooled buffer of the given allocation, NULL if none */
+static shared_buffer * poolTake(size_t allocated)
+{
+    shared_buffer * sb = NULL;
+    pthread_mutex_lock(&shared_buffer_mutex);
+    for(int i = 0; i < poolCount; ++i)
+    {
+        if (pool[i]->allocated == allocated)
+        {
+            sb = pool[i];
+            pool[i] = pool[--poolCount];
+            poolBytes -= sb->allocated;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shared_buffer_mutex);
+    return sb;
+}
+
+/* Keep an unsealed buffer for reuse. Return 0 if the pool is full */
+static int poolGive(shared_buffer * sb)
+{
+    int kept = 0;
+    pthread_mutex_lock(&shared_buffer_mutex);
+    if (poolCount < BLOB_POOL_MAX && poolBytes + sb->allocated <= BLOB_POOL_MAX_BYTES)
+    {
+        pool[poolCount++] = sb;
+        poolBytes += sb->allocated;
+        kept = 1;
+    }
+    pthread_mutex_unlock(&shared_buffer_mutex);
+    return kept;
+}
+
+/* Map a fresh buffer with all its pages at once, rather than faulting them one by one */
+static void * mapFresh(int fd, size_t allocated)
+{
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void * mapstart = mmap(0, allocated, PROT_READ | PROT_WRITE, flags, fd, 0);
+#ifdef MADV_HUGEPAGE
+    // Opt-in: only effective when shmem huge pages are set to "advise"
+    if (mapstart != MAP_FAILED && getenv("INDI_SHARED_BLOB_HUGEPAGES"))
+    {
+        madvise(mapstart, allocated, MADV_HUGEPAGE);
+    }
+#endif
+    return mapstart;
+}
+#endif
+
 void * IDSharedBlobAlloc(size_t size)
 {
 #ifdef ENABLE_INDI_SHARED_MEMORY
-    shared_buffer * sb = (shared_buffer*)malloc(sizeof(shared_buffer));
+    shared_buffer * sb = poolTake(allocation(size));
+    if (sb != NULL)
+    {
+        sb->size = size;
+        sharedBufferAdd(sb);
+        return sb->mapstart;
+    }
+
+    sb = (shared_buffer*)malloc(sizeof(shared_buffer));
     if (sb == NULL) goto ERROR;
 
     sb->size = size;
@@ -86,7 +162,7 @@ void * IDSharedBlobAlloc(size_t size)
     if (ret == -1) goto ERROR;
 
     // FIXME: try to map far more than sb->allocated, to allow efficient mremap
-    sb->mapstart = mmap(0, sb->allocated, PROT_READ | PROT_WRITE, MAP_SHARED, sb->fd, 0);
+    sb->mapstart = mapFresh(sb->fd, sb->allocated);
     if (sb->mapstart == MAP_FAILED) goto ERROR;
 
     sharedBufferAdd(sb);
@@ -147,6 +223,12 @@ void IDSharedBlobFree(void * ptr)
         return;
     }
 
+    // Once its fd was given, others may still read it: never reused
+    if (!sb->sealed && poolGive(sb))
+    {
+        return;
+    }
+
     if (munmap(sb->mapstart, sb->allocated) == -1)
     {
         perror("shared buffer munmap");
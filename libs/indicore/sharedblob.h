@@ -20,6 +20,7 @@ extern void * IDSharedBlobAttach(int fd, size_t size);
 
 /** \brief Free a buffer allocated using IDSharedBlobAlloc. Fall back to free for buffer that are not shared blob
  * Must be used for IBLOB.data
+ * A buffer that was never sealed is kept for a later IDSharedBlobAlloc of the same size.
  */
 extern void IDSharedBlobFree(void * ptr);
 
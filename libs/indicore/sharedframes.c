@@ -0,0 +1,405 @@
+/** INDI
+ *
+ *  This library is free software;
+ *  you can redistribute it and / or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation;
+ *  either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *       but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library;
+ *  if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+ */
+
+#define _GNU_SOURCE
+
+#include "sharedframes.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#if defined(ENABLE_INDI_SHARED_MEMORY) && defined(__linux__)
+
+#include "shm_open_anon.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FRAMES_MAGIC   0x52464e49 /* INFR */
+#define FRAMES_VERSION 1
+
+#define FRAMES_PAGE 4096
+#define FRAMES_MAX_SLOTS 64
+#define FRAMES_MAX_SLOT_SIZE (1ull << 32)
+
+/* In shared memory: the header, the slots, then the data of the slots, each on its own pages */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    _Atomic uint32_t closed;
+    uint64_t slotSize;
+    uint64_t dataOffset;
+    _Atomic uint64_t sequence __attribute__((aligned(64)));
+} shared_frames_header;
+
+typedef struct
+{
+    _Atomic uint64_t lock;  /* odd while written, else twice the sequence of the frame */
+    shared_frame_info info;
+} __attribute__((aligned(64))) shared_frames_slot;
+
+struct shared_frames
+{
+    shared_frames_header * header;
+    shared_frames_slot * slots;
+    char * data;
+    size_t mapped;
+    uint32_t count;
+    uint64_t slotSize;
+    int memFd;
+    int writer;
+    size_t pending;     /* bytes of the frame being written */
+    char path[64];
+};
+
+static uint64_t page_align(uint64_t size)
+{
+    return (size + FRAMES_PAGE - 1) / FRAMES_PAGE * FRAMES_PAGE;
+}
+
+static uint64_t data_offset(uint32_t slots)
+{
+    return page_align(sizeof(shared_frames_header) + slots * sizeof(shared_frames_slot));
+}
+
+static shared_frames * frames_wrap(void * mapped, size_t size, int memFd, int writer)
+{
+    shared_frames * frames = (shared_frames *)calloc(1, sizeof(shared_frames));
+    if (frames == NULL)
+    {
+        munmap(mapped, size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    frames->header = (shared_frames_header *)mapped;
+    frames->slots = (shared_frames_slot *)((char *)mapped + sizeof(shared_frames_header));
+    frames->data = (char *)mapped + frames->header->dataOffset;
+    frames->mapped = size;
+    frames->count = frames->header->slots;
+    frames->slotSize = frames->header->slotSize;
+    frames->memFd = memFd;
+    frames->writer = writer;
+    return frames;
+}
+
+shared_frames * IDSharedFramesCreate(uint32_t slots, size_t slotSize)
+{
+    if (slots < 2 || slots > FRAMES_MAX_SLOTS || slotSize == 0 || slotSize > FRAMES_MAX_SLOT_SIZE)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    uint64_t aligned = page_align(slotSize);
+    uint64_t offset = data_offset(slots);
+    size_t size = offset + slots * aligned;
+
+    int memFd = shm_open_anon();
+    if (memFd == -1)
+        return NULL;
+    fcntl(memFd, F_SETFD, FD_CLOEXEC);
+
+    void * mapped = MAP_FAILED;
+    if (ftruncate(memFd, size) != -1)
+        mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        int e = errno;
+        close(memFd);
+        errno = e;
+        return NULL;
+    }
+
+    /* The memory comes zeroed: no frame yet, every slot free */
+    shared_frames_header * header = (shared_frames_header *)mapped;
+    header->magic = FRAMES_MAGIC;
+    header->version = FRAMES_VERSION;
+    header->slots = slots;
+    header->slotSize = aligned;
+    header->dataOffset = offset;
+    atomic_init(&header->closed, 0);
+    atomic_init(&header->sequence, 0);
+
+    shared_frames * frames = frames_wrap(mapped, size, memFd, 1);
+    if (frames == NULL)
+    {
+        close(memFd);
+        return NULL;
+    }
+    /* The fd of the driver, opened again by the readers */
+    snprintf(frames->path, sizeof(frames->path), "/proc/%d/fd/%d", (int)getpid(), memFd);
+    return frames;
+}
+
+shared_frames * IDSharedFramesOpen(const char * path)
+{
+    int memFd = open(path, O_RDONLY | O_CLOEXEC);
+    if (memFd == -1)
+        return NULL;
+
+    struct stat st;
+    shared_frames_header header;
+    if (fstat(memFd, &st) == -1 || (size_t)st.st_size < sizeof(header) ||
+            pread(memFd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+    {
+        close(memFd);
+        errno = EPROTO;
+        return NULL;
+    }
+
+    /* Never trust the header beyond the size of the memory */
+    size_t size = st.st_size;
+    if (header.magic != FRAMES_MAGIC || header.version != FRAMES_VERSION || header.slots < 2 ||
+            header.slots > FRAMES_MAX_SLOTS || header.slotSize == 0 || header.slotSize > FRAMES_MAX_SLOT_SIZE ||
+            header.dataOffset != data_offset(header.slots) || header.dataOffset + header.slots * header.slotSize > size)
+    {
+        close(memFd);
+        errno = EPROTO;
+        return NULL;
+    }
+
+    void * mapped = mmap(NULL, size, PROT_READ, MAP_SHARED, memFd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        int e = errno;
+        close(memFd);
+        errno = e;
+        return NULL;
+    }
+
+    shared_frames * frames = frames_wrap(mapped, size, memFd, 0);
+    if (frames == NULL)
+    {
+        close(memFd);
+        return NULL;
+    }
+    snprintf(frames->path, sizeof(frames->path), "%s", path);
+    return frames;
+}
+
+void IDSharedFramesFree(shared_frames * frames)
+{
+    if (frames == NULL)
+        return;
+    if (frames->writer)
+        atomic_store_explicit(&frames->header->closed, 1, memory_order_release);
+    munmap(frames->header, frames->mapped);
+    close(frames->memFd);
+    free(frames);
+}
+
+const char * IDSharedFramesGetPath(const shared_frames * frames)
+{
+    return frames->path;
+}
+
+size_t IDSharedFramesGetSlotSize(const shared_frames * frames)
+{
+    return frames->slotSize;
+}
+
+static uint32_t slot_of(const shared_frames * frames, uint64_t sequence)
+{
+    return (sequence - 1) % frames->count;
+}
+
+void * IDSharedFramesBegin(shared_frames * frames, size_t size)
+{
+    if (!frames->writer || size > frames->slotSize)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    uint64_t sequence = atomic_load_explicit(&frames->header->sequence, memory_order_relaxed) + 1;
+    uint32_t slot = slot_of(frames, sequence);
+    atomic_store_explicit(&frames->slots[slot].lock, 2 * sequence - 1, memory_order_relaxed);
+    /* Readers seeing the data change see the odd lock */
+    atomic_thread_fence(memory_order_release);
+    frames->pending = size;
+    return frames->data + slot * frames->slotSize;
+}
+
+uint64_t IDSharedFramesCommit(shared_frames * frames, shared_frame_info * info)
+{
+    uint64_t sequence = atomic_load_explicit(&frames->header->sequence, memory_order_relaxed) + 1;
+    shared_frames_slot * slot = &frames->slots[slot_of(frames, sequence)];
+
+    slot->info = *info;
+    slot->info.sequence = sequence;
+    slot->info.size = frames->pending;
+    info->sequence = sequence;
+
+    atomic_store_explicit(&slot->lock, 2 * sequence, memory_order_release);
+    atomic_store_explicit(&frames->header->sequence, sequence, memory_order_release);
+    return sequence;
+}
+
+uint64_t IDSharedFramesWrite(shared_frames * frames, shared_frame_info * info, const void * ptr)
+{
+    void * slot = IDSharedFramesBegin(frames, info->size);
+    if (slot == NULL)
+        return 0;
+    memcpy(slot, ptr, info->size);
+    return IDSharedFramesCommit(frames, info);
+}
+
+uint64_t IDSharedFramesGetSequence(const shared_frames * frames)
+{
+    return atomic_load_explicit(&frames->header->sequence, memory_order_acquire);
+}
+
+int IDSharedFramesLatest(const shared_frames * frames, shared_frame_info * info, const void ** data)
+{
+    /* A writer lapping the ring while the metadata is read makes it try again */
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        uint64_t sequence = atomic_load_explicit(&frames->header->sequence, memory_order_acquire);
+        if (sequence == 0)
+            break;
+
+        uint32_t slot = slot_of(frames, sequence);
+        const shared_frames_slot * s = &frames->slots[slot];
+        uint64_t lock = atomic_load_explicit(&s->lock, memory_order_acquire);
+        if (lock != 2 * sequence)
+            continue;
+
+        *info = s->info;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s->lock, memory_order_relaxed) != lock || info->size > frames->slotSize)
+            continue;
+
+        *data = frames->data + slot * frames->slotSize;
+        return 0;
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+int IDSharedFramesIntact(const shared_frames * frames, const shared_frame_info * info)
+{
+    if (info->sequence == 0)
+        return 0;
+    /* The data read before are ordered before the lock read below */
+    atomic_thread_fence(memory_order_acquire);
+    const shared_frames_slot * s = &frames->slots[slot_of(frames, info->sequence)];
+    return atomic_load_explicit(&s->lock, memory_order_relaxed) == 2 * info->sequence;
+}
+
+int IDSharedFramesIsClosed(const shared_frames * frames)
+{
+    return atomic_load_explicit(&frames->header->closed, memory_order_acquire) != 0;
+}
+
+#else
+
+shared_frames * IDSharedFramesCreate(uint32_t slots, size_t slotSize)
+{
+    (void)slots;
+    (void)slotSize;
+    errno = ENOTSUP;
+    return NULL;
+}
+
+shared_frames * IDSharedFramesOpen(const char * path)
+{
+    (void)path;
+    errno = ENOTSUP;
+    return NULL;
+}
+
+void IDSharedFramesFree(shared_frames * frames)
+{
+    (void)frames;
+}
+
+const char * IDSharedFramesGetPath(const shared_frames * frames)
+{
+    (void)frames;
+    return "";
+}
+
+size_t IDSharedFramesGetSlotSize(const shared_frames * frames)
+{
+    (void)frames;
+    return 0;
+}
+
+void * IDSharedFramesBegin(shared_frames * frames, size_t size)
+{
+    (void)frames;
+    (void)size;
+    errno = ENOTSUP;
+    return NULL;
+}
+
+uint64_t IDSharedFramesCommit(shared_frames * frames, shared_frame_info * info)
+{
+    (void)frames;
+    (void)info;
+    return 0;
+}
+
+uint64_t IDSharedFramesWrite(shared_frames * frames, shared_frame_info * info, const void * ptr)
+{
+    (void)frames;
+    (void)info;
+    (void)ptr;
+    errno = ENOTSUP;
+    return 0;
+}
+
+uint64_t IDSharedFramesGetSequence(const shared_frames * frames)
+{
+    (void)frames;
+    return 0;
+}
+
+int IDSharedFramesLatest(const shared_frames * frames, shared_frame_info * info, const void ** data)
+{
+    (void)frames;
+    (void)info;
+    (void)data;
+    errno = ENOTSUP;
+    return -1;
+}
+
+int IDSharedFramesIntact(const shared_frames * frames, const shared_frame_info * info)
+{
+    (void)frames;
+    (void)info;
+    return 0;
+}
+
+int IDSharedFramesIsClosed(const shared_frames * frames)
+{
+    (void)frames;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/** INDI
+ *
+ *  This library is free software;
+ *  you can redistribute it and / or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation;
+ *  either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *       but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library;
+ *  if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Ring of the last frames of a stream, in shared memory, written by a driver and read in place by any
+ * local process: no copy and no INDI client needed. The driver publishes the path of the memory in its
+ * STREAM_SHARED_PATH property; readers of the same user open it with IDSharedFramesOpen.
+ *
+ * Each slot holds a frame and its metadata under a sequence lock: the writer makes the slot sequence odd
+ * while writing, then sets it to twice the frame sequence. A reader checks the slot sequence did not move
+ * while it used the frame, the writer never waits for readers.
+ *
+ *  shared_frames *frames = IDSharedFramesOpen(path);
+ *  shared_frame_info info;
+ *  const void *data;
+ *  if (IDSharedFramesLatest(frames, &info, &data) == 0)
+ *  {
+ *      process(data, &info);
+ *      if (!IDSharedFramesIntact(frames, &info))
+ *          ; // overwritten meanwhile, drop the result
+ *  }
+ *
+ * Available on Linux with ENABLE_INDI_SHARED_MEMORY, the functions fail elsewhere.
+ */
+typedef struct shared_frames shared_frames;
+
+typedef struct
+{
+    uint64_t sequence;  /* 1 for the first frame of the ring, then one more for each */
+    uint64_t timestamp; /* as given by the driver with the frame */
+    uint64_t size;      /* bytes */
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;    /* INDI_PIXEL_FORMAT */
+    uint32_t depth;     /* bits per pixel component */
+} shared_frame_info;
+
+/** \brief Create a ring of slots frames of up to slotSize bytes each.
+ *  \return null on error + errno
+ */
+extern shared_frames * IDSharedFramesCreate(uint32_t slots, size_t slotSize);
+
+/** \brief Map the ring of a path given by IDSharedFramesGetPath, read only.
+ *  \return null on error + errno, EPROTO if the path is not a frame ring
+ */
+extern shared_frames * IDSharedFramesOpen(const char * path);
+
+/** \brief Unmap the ring. Readers see the ring of a writer closed as such. */
+extern void IDSharedFramesFree(shared_frames * frames);
+
+/** \brief Path other processes open the ring with, empty on error */
+extern const char * IDSharedFramesGetPath(const shared_frames * frames);
+
+extern size_t IDSharedFramesGetSlotSize(const shared_frames * frames);
+
+/** \brief Slot of the next frame, to write size bytes to, then call IDSharedFramesCommit.
+ *  \return null if size is more than the slot size
+ */
+extern void * IDSharedFramesBegin(shared_frames * frames, size_t size);
+
+/** \brief Publish the frame written since IDSharedFramesBegin. The sequence of info is set, if not null.
+ *  \return the sequence of the frame
+ */
+extern uint64_t IDSharedFramesCommit(shared_frames * frames, shared_frame_info * info);
+
+/** \brief Copy a frame to the next slot and publish it.
+ *  \return the sequence of the frame, 0 on error + errno
+ */
+extern uint64_t IDSharedFramesWrite(shared_frames * frames, shared_frame_info * info, const void * ptr);
+
+/** \brief Sequence of the last frame published, 0 if none. Cheap enough to poll. */
+extern uint64_t IDSharedFramesGetSequence(const shared_frames * frames);
+
+/** \brief Metadata and data of the last frame published.
+ *  \return 0 if ok, -1 + EAGAIN if there is no frame yet, or the writer is too fast to read one
+ */
+extern int IDSharedFramesLatest(const shared_frames * frames, shared_frame_info * info, const void ** data);
+
+/** \brief Whether the frame of info was not overwritten since it was read, and its data was valid. */
+extern int IDSharedFramesIntact(const shared_frames * frames, const shared_frame_info * info);
+
+/** \brief Whether the writer closed the ring: no frame will follow. */
+extern int IDSharedFramesIsClosed(const shared_frames * frames);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,392 @@
+/** INDI
+ *
+ *  This library is free software;
+ *  you can redistribute it and / or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation;
+ *  either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *       but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library;
+ *  if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+ */
+
+#define _GNU_SOURCE
+
+#include "sharedring.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#if defined(ENABLE_INDI_SHARED_MEMORY) && defined(__linux__)
+
+#include "shm_open_anon.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* The data follows the header, on its own page */
+#define RING_HEADER_SIZE 4096
+
+#define RING_MIN_SIZE 4096
+#define RING_MAX_SIZE (1u << 30)
+
+/* In shared memory. Positions only grow, their difference is the amount of data.
+ * Each side sets its waiting flag before going to sleep, the other one clears it and notifies.
+ */
+typedef struct
+{
+    uint64_t size;
+    _Atomic uint64_t head __attribute__((aligned(64)));    /* written by the writer */
+    _Atomic uint32_t writerWaiting;
+    _Atomic uint64_t fds;
+    _Atomic uint64_t tail __attribute__((aligned(64)));    /* written by the reader */
+    _Atomic uint32_t readerWaiting;
+} shared_ring_header;
+
+struct shared_ring
+{
+    shared_ring_header * header;
+    char * data;
+    uint64_t mask;
+    int memFd;
+    int dataFd;      /* eventfd, the writer notifies the reader */
+    int roomFd;      /* eventfd, the reader notifies the writer */
+};
+
+static void notify(int fd)
+{
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) == -1 && errno == EINTR);
+}
+
+static void clear(int fd)
+{
+    uint64_t count;
+    while (read(fd, &count, sizeof(count)) == -1 && errno == EINTR);
+}
+
+static shared_ring * ring_map(int memFd, int dataFd, int roomFd, uint64_t size)
+{
+    void * mapped = mmap(NULL, RING_HEADER_SIZE + size, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (mapped == MAP_FAILED)
+        return NULL;
+
+    shared_ring * ring = (shared_ring *)malloc(sizeof(shared_ring));
+    if (ring == NULL)
+    {
+        munmap(mapped, RING_HEADER_SIZE + size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    ring->header = (shared_ring_header *)mapped;
+    ring->data = (char *)mapped + RING_HEADER_SIZE;
+    ring->mask = size - 1;
+    ring->memFd = memFd;
+    ring->dataFd = dataFd;
+    ring->roomFd = roomFd;
+    return ring;
+}
+
+shared_ring * IDSharedRingCreate(size_t size)
+{
+    uint64_t allocated = RING_MIN_SIZE;
+    while (allocated < size && allocated < RING_MAX_SIZE)
+        allocated *= 2;
+
+    int memFd = shm_open_anon();
+    if (memFd == -1)
+        return NULL;
+    fcntl(memFd, F_SETFD, FD_CLOEXEC);
+
+    /* blocking: the writer sleeps on roomFd. Writes never block on an eventfd */
+    int dataFd = eventfd(0, EFD_CLOEXEC);
+    int roomFd = eventfd(0, EFD_CLOEXEC);
+    shared_ring * ring = NULL;
+    if (dataFd != -1 && roomFd != -1 && ftruncate(memFd, RING_HEADER_SIZE + allocated) != -1)
+        ring = ring_map(memFd, dataFd, roomFd, allocated);
+
+    if (ring == NULL)
+    {
+        int e = errno;
+        close(memFd);
+        if (dataFd != -1)
+            close(dataFd);
+        if (roomFd != -1)
+            close(roomFd);
+        errno = e;
+        return NULL;
+    }
+
+    shared_ring_header * header = ring->header;
+    header->size = allocated;
+    atomic_init(&header->head, 0);
+    atomic_init(&header->tail, 0);
+    atomic_init(&header->fds, 0);
+    atomic_init(&header->writerWaiting, 0);
+    /* the first write wakes the reader up */
+    atomic_init(&header->readerWaiting, 1);
+    return ring;
+}
+
+shared_ring * IDSharedRingAttach(const int fds[SHARED_RING_FDS])
+{
+    struct stat st;
+    if (fstat(fds[0], &st) == -1)
+        return NULL;
+
+    uint64_t size = (uint64_t)st.st_size - RING_HEADER_SIZE;
+    if (st.st_size <= RING_HEADER_SIZE || size > RING_MAX_SIZE || (size & (size - 1)) != 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    shared_ring * ring = ring_map(fds[0], fds[1], fds[2], size);
+    if (ring != NULL && ring->header->size != size)
+    {
+        munmap(ring->header, RING_HEADER_SIZE + size);
+        free(ring);
+        errno = EINVAL;
+        return NULL;
+    }
+    if (ring != NULL)
+    {
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[2], F_SETFD, FD_CLOEXEC);
+    }
+    return ring;
+}
+
+void IDSharedRingFree(shared_ring * ring)
+{
+    if (ring == NULL)
+        return;
+    munmap(ring->header, RING_HEADER_SIZE + ring->mask + 1);
+    close(ring->memFd);
+    close(ring->dataFd);
+    close(ring->roomFd);
+    free(ring);
+}
+
+void IDSharedRingGetFds(const shared_ring * ring, int fds[SHARED_RING_FDS])
+{
+    fds[0] = ring->memFd;
+    fds[1] = ring->dataFd;
+    fds[2] = ring->roomFd;
+}
+
+int IDSharedRingGetReadFd(const shared_ring * ring)
+{
+    return ring->dataFd;
+}
+
+/* wait for the reader to make room, or for the peer to hang up */
+static int wait_room(shared_ring * ring, int peer)
+{
+    struct pollfd fds[2];
+    fds[0].fd = ring->roomFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = peer;
+    fds[1].events = 0;
+
+    for (;;)
+    {
+        int ret = poll(fds, peer == -1 ? 1 : 2, -1);
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            clear(ring->roomFd);
+            return 0;
+        }
+        if (peer != -1 && (fds[1].revents & (POLLHUP | POLLERR | POLLNVAL)))
+        {
+            errno = EPIPE;
+            return -1;
+        }
+    }
+}
+
+int IDSharedRingWrite(shared_ring * ring, const void * ptr, size_t count, int peer)
+{
+    shared_ring_header * header = ring->header;
+    const char * src = (const char *)ptr;
+    uint64_t size = ring->mask + 1;
+    uint64_t head = atomic_load_explicit(&header->head, memory_order_relaxed);
+
+    while (count > 0)
+    {
+        uint64_t room = size - (head - atomic_load(&header->tail));
+        if (room == 0)
+        {
+            atomic_store(&header->writerWaiting, 1);
+            room = size - (head - atomic_load(&header->tail));
+            if (room == 0)
+            {
+                if (wait_room(ring, peer) == -1)
+                    return -1;
+                continue;
+            }
+            atomic_store(&header->writerWaiting, 0);
+        }
+
+        /* up to the end of the buffer, the rest on the next turn */
+        uint64_t offset = head & ring->mask;
+        size_t chunk = count < room ? count : (size_t)room;
+        if (chunk > size - offset)
+            chunk = (size_t)(size - offset);
+        memcpy(ring->data + offset, src, chunk);
+        src += chunk;
+        count -= chunk;
+        head += chunk;
+
+        atomic_store(&header->head, head);
+        if (atomic_exchange(&header->readerWaiting, 0))
+            notify(ring->dataFd);
+    }
+    return 0;
+}
+
+size_t IDSharedRingRead(shared_ring * ring, void * ptr, size_t count)
+{
+    shared_ring_header * header = ring->header;
+    uint64_t size = ring->mask + 1;
+    uint64_t tail = atomic_load_explicit(&header->tail, memory_order_relaxed);
+
+    uint64_t available = atomic_load(&header->head) - tail;
+    if (available == 0)
+    {
+        atomic_store(&header->readerWaiting, 1);
+        available = atomic_load(&header->head) - tail;
+        if (available == 0)
+            return 0;
+        /* a write came in between: it may have notified already, that's a spurious wake up */
+        atomic_store(&header->readerWaiting, 0);
+    }
+
+    uint64_t offset = tail & ring->mask;
+    size_t chunk = count < available ? count : (size_t)available;
+    size_t first = chunk < size - offset ? chunk : (size_t)(size - offset);
+    memcpy(ptr, ring->data + offset, first);
+    memcpy((char *)ptr + first, ring->data, chunk - first);
+
+    atomic_store(&header->tail, tail + chunk);
+    if (atomic_exchange(&header->writerWaiting, 0))
+        notify(ring->roomFd);
+    return chunk;
+}
+
+void IDSharedRingClearReadFd(shared_ring * ring)
+{
+    clear(ring->dataFd);
+}
+
+void IDSharedRingWakeReader(shared_ring * ring)
+{
+    notify(ring->dataFd);
+}
+
+void IDSharedRingAddFds(shared_ring * ring, uint64_t count)
+{
+    atomic_fetch_add(&ring->header->fds, count);
+}
+
+uint64_t IDSharedRingGetFdCount(const shared_ring * ring)
+{
+    return atomic_load(&ring->header->fds);
+}
+
+#else
+
+shared_ring * IDSharedRingCreate(size_t size)
+{
+    (void)size;
+    errno = ENOTSUP;
+    return NULL;
+}
+
+shared_ring * IDSharedRingAttach(const int fds[SHARED_RING_FDS])
+{
+    (void)fds;
+    errno = ENOTSUP;
+    return NULL;
+}
+
+void IDSharedRingFree(shared_ring * ring)
+{
+    (void)ring;
+}
+
+void IDSharedRingGetFds(const shared_ring * ring, int fds[SHARED_RING_FDS])
+{
+    (void)ring;
+    fds[0] = fds[1] = fds[2] = -1;
+}
+
+int IDSharedRingGetReadFd(const shared_ring * ring)
+{
+    (void)ring;
+    return -1;
+}
+
+int IDSharedRingWrite(shared_ring * ring, const void * ptr, size_t count, int peer)
+{
+    (void)ring;
+    (void)ptr;
+    (void)count;
+    (void)peer;
+    errno = ENOTSUP;
+    return -1;
+}
+
+size_t IDSharedRingRead(shared_ring * ring, void * ptr, size_t count)
+{
+    (void)ring;
+    (void)ptr;
+    (void)count;
+    return 0;
+}
+
+void IDSharedRingClearReadFd(shared_ring * ring)
+{
+    (void)ring;
+}
+
+void IDSharedRingWakeReader(shared_ring * ring)
+{
+    (void)ring;
+}
+
+void IDSharedRingAddFds(shared_ring * ring, uint64_t count)
+{
+    (void)ring;
+    (void)count;
+}
+
+uint64_t IDSharedRingGetFdCount(const shared_ring * ring)
+{
+    (void)ring;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Byte ring in shared memory, written by a local driver and read by indiserver.
+ * Messages go through the memory instead of socket writes. The reader is woken by an eventfd,
+ * only when it declared it was going to wait for more data: a busy ring costs no syscall.
+ * Available on Linux with ENABLE_INDI_SHARED_MEMORY, the functions fail elsewhere.
+ */
+typedef struct shared_ring shared_ring;
+
+/* Number of fds describing a ring: the memory, the data and the room notifications */
+#define SHARED_RING_FDS 3
+
+/** \brief Create a ring of at least size bytes, rounded to a power of 2.
+ *  \return null on error + errno
+ */
+extern shared_ring * IDSharedRingCreate(size_t size);
+
+/** \brief Attach the ring of the fds given by IDSharedRingGetFds, in another process.
+ *  The ring takes ownership of the fds.
+ *  \return null on error + errno
+ */
+extern shared_ring * IDSharedRingAttach(const int fds[SHARED_RING_FDS]);
+
+/** \brief Unmap the ring and close its fds */
+extern void IDSharedRingFree(shared_ring * ring);
+
+extern void IDSharedRingGetFds(const shared_ring * ring, int fds[SHARED_RING_FDS]);
+
+/** \brief The fd that gets readable when data was written for a waiting reader */
+extern int IDSharedRingGetReadFd(const shared_ring * ring);
+
+/** \brief Write count bytes, waiting for room if needed.
+ *  peer is the fd of the connection to the reader: waiting stops with an error when it hangs up.
+ *  \return 0 if ok, -1 on error + errno
+ */
+extern int IDSharedRingWrite(shared_ring * ring, const void * ptr, size_t count, int peer);
+
+/** \brief Read up to count of the bytes available.
+ *  Returns 0 once the ring is empty and the reader is registered for the next write:
+ *  the read fd will get readable then.
+ */
+extern size_t IDSharedRingRead(shared_ring * ring, void * ptr, size_t count);
+
+/** \brief Reset the read fd after it got readable */
+extern void IDSharedRingClearReadFd(shared_ring * ring);
+
+/** \brief Make the read fd readable, for a reader that returns to its loop before the ring is empty */
+extern void IDSharedRingWakeReader(shared_ring * ring);
+
+/** \brief Count fds sent along, out of band, before writing the data that refers to them */
+extern void IDSharedRingAddFds(shared_ring * ring, uint64_t count);
+
+/** \brief Total of the fds counted with IDSharedRingAddFds */
+extern uint64_t IDSharedRingGetFdCount(const shared_ring * ring);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,481 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+const char magic[8] = {'I', 'N', 'D', 'I', 'T', 'L', 'M', '1'};
+const size_t headerSize = 5;
+
+void put32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void put64(std::vector<uint8_t> &out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void putVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void putString(std::vector<uint8_t> &out, const std::string &value)
+{
+    out.insert(out.end(), value.begin(), value.end());
+    out.push_back(0);
+}
+
+uint32_t get32(const uint8_t *p)
+{
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+uint64_t get64(const uint8_t *p)
+{
+    return uint64_t(get32(p)) | uint64_t(get32(p + 4)) << 32;
+}
+
+// Reads over a payload, failing once past its end
+struct Cursor
+{
+    const uint8_t *p;
+    const uint8_t *end;
+
+    bool has(size_t n) const
+    {
+        return size_t(end - p) >= n;
+    }
+
+    bool varint(uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7)
+        {
+            uint8_t byte = *p++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    bool string(std::string &value)
+    {
+        auto zero = static_cast<const uint8_t *>(memchr(p, 0, end - p));
+        if (zero == nullptr)
+            return false;
+        value.assign(reinterpret_cast<const char *>(p), zero - p);
+        p = zero + 1;
+        return true;
+    }
+};
+
+std::string channelKey(const std::string &device, const std::string &property, const std::string &element)
+{
+    return device + '\0' + property + '\0' + element;
+}
+
+bool truncateFile(FILE *file, long size)
+{
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), size) == 0;
+#else
+    return ftruncate(fileno(file), static_cast<off_t>(size)) == 0;
+#endif
+}
+
+}
+
+namespace INDI
+{
+namespace Telemetry
+{
+
+// Writer
+
+Writer::~Writer()
+{
+    close();
+}
+
+bool Writer::open(const std::string &path, int64_t now)
+{
+    close();
+
+    mFile = fopen(path.c_str(), "r+b");
+    if (mFile == nullptr)
+        mFile = fopen(path.c_str(), "w+b");
+    if (mFile == nullptr)
+        return false;
+
+    // Keep the whole records only: a record cut short by a crash would hide what follows
+    char head[sizeof(magic)];
+    size_t got = fread(head, 1, sizeof(head), mFile);
+    fseek(mFile, 0, SEEK_END);
+    long size = ftell(mFile);
+    long end = 0;
+    if (got == sizeof(magic) && !memcmp(head, magic, sizeof(magic)))
+    {
+        end = sizeof(magic);
+        uint8_t header[headerSize];
+        while (end + long(headerSize) <= size && fseek(mFile, end, SEEK_SET) == 0 &&
+                fread(header, 1, headerSize, mFile) == headerSize)
+        {
+            long next = end + long(headerSize) + long(get32(header + 1));
+            if (next > size)
+                break;
+            end = next;
+        }
+    }
+    else if (got != 0)
+    {
+        // Not a telemetry file, leave it alone
+        fclose(mFile);
+        mFile = nullptr;
+        return false;
+    }
+
+    if (end == 0)
+    {
+        rewind(mFile);
+        if (fwrite(magic, 1, sizeof(magic), mFile) != sizeof(magic))
+        {
+            close();
+            return false;
+        }
+        end = sizeof(magic);
+    }
+    fflush(mFile);
+    truncateFile(mFile, end);
+    fseek(mFile, 0, SEEK_END);
+
+    std::vector<uint8_t> session;
+    put64(session, static_cast<uint64_t>(now));
+    if (!writeRecord('S', session))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Writer::close()
+{
+    if (mFile == nullptr)
+        return;
+    flush();
+    fclose(mFile);
+    mFile = nullptr;
+    mPending.clear();
+    mIds.clear();
+}
+
+uint32_t Writer::channel(Kind kind, const std::string &device, const std::string &property, const std::string &element)
+{
+    auto key = channelKey(device, property, element);
+    auto it = mIds.find(key);
+    if (it != mIds.end())
+        return it->second;
+
+    uint32_t id = static_cast<uint32_t>(mPending.size());
+    mIds.emplace(key, id);
+    mPending.push_back(Pending{kind, {}, {}});
+    mPending.back().times.reserve(blockSamples);
+    mPending.back().values.reserve(blockSamples);
+
+    std::vector<uint8_t> payload;
+    put32(payload, id);
+    payload.push_back(static_cast<uint8_t>(kind));
+    putString(payload, device);
+    putString(payload, property);
+    putString(payload, element);
+    writeRecord('C', payload);
+    return id;
+}
+
+void Writer::add(uint32_t id, int64_t time, double value)
+{
+    if (id >= mPending.size())
+        return;
+
+    auto &pending = mPending[id];
+    pending.times.push_back(time);
+    pending.values.push_back(value);
+    if (pending.times.size() >= blockSamples)
+        writeBlock(id);
+}
+
+bool Writer::flush()
+{
+    if (mFile == nullptr)
+        return false;
+
+    bool ok = true;
+    for (uint32_t id = 0; id < mPending.size(); id++)
+        if (!mPending[id].times.empty())
+            ok = writeBlock(id) && ok;
+    return fflush(mFile) == 0 && ok;
+}
+
+bool Writer::writeRecord(char type, const std::vector<uint8_t> &payload)
+{
+    if (mFile == nullptr)
+        return false;
+
+    uint8_t header[headerSize];
+    header[0] = static_cast<uint8_t>(type);
+    for (int i = 0; i < 4; i++)
+        header[1 + i] = static_cast<uint8_t>(payload.size() >> (8 * i));
+    return fwrite(header, 1, headerSize, mFile) == headerSize &&
+           fwrite(payload.data(), 1, payload.size(), mFile) == payload.size();
+}
+
+bool Writer::writeBlock(uint32_t id)
+{
+    auto &pending = mPending[id];
+    size_t count = pending.times.size();
+
+    std::vector<uint8_t> payload;
+    payload.reserve(16 + count * (pending.kind == NUMBER ? 10 : 3));
+    put32(payload, id);
+    put32(payload, static_cast<uint32_t>(count));
+    put64(payload, static_cast<uint64_t>(pending.times[0]));
+
+    // Time goes forward, or the sample gets the time of the previous one
+    int64_t previous = pending.times[0];
+    for (size_t i = 1; i < count; i++)
+    {
+        int64_t time = std::max(pending.times[i], previous);
+        putVarint(payload, static_cast<uint64_t>(time - previous));
+        previous = time;
+    }
+
+    if (pending.kind == NUMBER)
+    {
+        for (double value : pending.values)
+        {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            put64(payload, bits);
+        }
+    }
+    else
+    {
+        for (double value : pending.values)
+            payload.push_back(static_cast<uint8_t>(value));
+    }
+
+    pending.times.clear();
+    pending.values.clear();
+    return writeRecord('B', payload);
+}
+
+// Reader
+
+Reader::~Reader()
+{
+    close();
+}
+
+bool Reader::open(const std::string &path)
+{
+    close();
+
+    mFile = fopen(path.c_str(), "rb");
+    if (mFile == nullptr)
+    {
+        mError = "cannot open " + path;
+        return false;
+    }
+
+    char head[sizeof(magic)];
+    if (fread(head, 1, sizeof(head), mFile) != sizeof(head) || memcmp(head, magic, sizeof(magic)))
+    {
+        mError = path + " is not a telemetry file";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Reader::close()
+{
+    if (mFile != nullptr)
+        fclose(mFile);
+    mFile = nullptr;
+    mChannels.clear();
+}
+
+bool Reader::next(Series &block)
+{
+    mError.clear();
+    if (mFile == nullptr)
+        return false;
+
+    std::vector<uint8_t> payload;
+    uint8_t header[headerSize];
+    while (fread(header, 1, headerSize, mFile) == headerSize)
+    {
+        payload.resize(get32(header + 1));
+        if (fread(payload.data(), 1, payload.size(), mFile) != payload.size())
+            return false;
+
+        Cursor in {payload.data(), payload.data() + payload.size()};
+        switch (header[0])
+        {
+            case 'S':
+                mChannels.clear();
+                break;
+
+            case 'C':
+            {
+                Channel channel;
+                if (!in.has(5))
+                {
+                    mError = "bad channel record";
+                    return false;
+                }
+                uint32_t id = get32(in.p);
+                channel.kind = static_cast<Kind>(in.p[4]);
+                in.p += 5;
+                if (!in.string(channel.device) || !in.string(channel.property) || !in.string(channel.element))
+                {
+                    mError = "bad channel record";
+                    return false;
+                }
+                if (id >= mChannels.size())
+                    mChannels.resize(id + 1);
+                mChannels[id] = channel;
+                break;
+            }
+
+            case 'B':
+            {
+                if (!in.has(16))
+                {
+                    mError = "bad block record";
+                    return false;
+                }
+                uint32_t id = get32(in.p);
+                uint32_t count = get32(in.p + 4);
+                int64_t time = static_cast<int64_t>(get64(in.p + 8));
+                in.p += 16;
+                if (id >= mChannels.size() || mChannels[id].device.empty() || count == 0)
+                {
+                    mError = "block of an undeclared channel";
+                    return false;
+                }
+
+                block.channel = mChannels[id];
+                block.times.resize(count);
+                block.values.resize(count);
+                block.times[0] = time;
+                for (uint32_t i = 1; i < count; i++)
+                {
+                    uint64_t delta;
+                    if (!in.varint(delta))
+                    {
+                        mError = "bad block record";
+                        return false;
+                    }
+                    time += static_cast<int64_t>(delta);
+                    block.times[i] = time;
+                }
+
+                size_t width = block.channel.kind == NUMBER ? 8 : 1;
+                if (!in.has(count * width))
+                {
+                    mError = "bad block record";
+                    return false;
+                }
+                for (uint32_t i = 0; i < count; i++, in.p += width)
+                {
+                    if (width == 8)
+                    {
+                        uint64_t bits = get64(in.p);
+                        memcpy(&block.values[i], &bits, sizeof(bits));
+                    }
+                    else
+                        block.values[i] = *in.p;
+                }
+                return true;
+            }
+
+            default:
+                // Records of later versions
+                break;
+        }
+    }
+    return false;
+}
+
+bool Reader::readSeries(const std::string &path, std::vector<Series> &series, std::string *error)
+{
+    Reader reader;
+    if (!reader.open(path))
+    {
+        if (error)
+            *error = reader.error();
+        return false;
+    }
+
+    std::map<std::tuple<int, std::string, std::string, std::string>, size_t> index;
+    Series block;
+    while (reader.next(block))
+    {
+        auto key = std::make_tuple(int(block.channel.kind), block.channel.device, block.channel.property,
+                                   block.channel.element);
+        auto it = index.find(key);
+        if (it == index.end())
+        {
+            it = index.emplace(key, series.size()).first;
+            series.push_back(Series{block.channel, {}, {}});
+        }
+        auto &target = series[it->second];
+        target.times.insert(target.times.end(), block.times.begin(), block.times.end());
+        target.values.insert(target.values.end(), block.values.begin(), block.values.end());
+    }
+
+    if (error)
+        *error = reader.error();
+    return reader.error().empty();
+}
+
+}
+}
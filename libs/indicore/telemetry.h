@@ -0,0 +1,147 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Telemetry files, as recorded by indiserver -o: the values of number, switch and light elements
+ * along time, in columns.
+ *
+ * The file starts with the 8 bytes "INDITLM1", then records, each a type byte, a 32 bits payload
+ * length and the payload. All integers are little endian.
+ *  'S' session: 64 bits start time. Channels of the previous sessions are forgotten.
+ *  'C' channel: 32 bits id, kind byte, then device, property and element, each 0 terminated.
+ *  'B' block: 32 bits channel id, 32 bits count, 64 bits first time, the count - 1 increments of
+ *      time as unsigned LEB128 varints, then the count values: 64 bits IEEE doubles for numbers,
+ *      a byte of ISState or IPState for switches and lights.
+ * Times are in microseconds since the epoch. Files are only appended to: a record cut short by a
+ * crash is dropped when the file is opened again for writing, and ends reading otherwise.
+ */
+namespace INDI
+{
+namespace Telemetry
+{
+
+typedef enum { NUMBER = 0, SWITCH = 1, LIGHT = 2 } Kind;
+
+struct Channel
+{
+    Kind kind;
+    std::string device;
+    std::string property;
+    std::string element;
+};
+
+/** @brief Samples of a channel, from a block or from a whole file. */
+struct Series
+{
+    Channel channel;
+    std::vector<int64_t> times;
+    std::vector<double> values;
+};
+
+class Writer
+{
+    public:
+        /* samples kept per channel until its block is written */
+        static constexpr size_t blockSamples {512};
+
+        Writer() = default;
+        ~Writer();
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        /** @brief Open a file to append a new session to, creating it if needed. */
+        bool open(const std::string &path, int64_t now);
+
+        /** @brief Write what is pending and close the file. */
+        void close();
+
+        bool isOpen() const
+        {
+            return mFile != nullptr;
+        }
+
+        /** @brief Id of a channel, declared to the file the first time. */
+        uint32_t channel(Kind kind, const std::string &device, const std::string &property, const std::string &element);
+
+        /** @brief Add a sample to a channel. Full blocks are written at once. */
+        void add(uint32_t id, int64_t time, double value);
+
+        /** @brief Write the pending samples of all channels and flush the file. */
+        bool flush();
+
+    private:
+        struct Pending
+        {
+            Kind kind;
+            std::vector<int64_t> times;
+            std::vector<double> values;
+        };
+
+        bool writeRecord(char type, const std::vector<uint8_t> &payload);
+        bool writeBlock(uint32_t id);
+
+        FILE *mFile {nullptr};
+        std::vector<Pending> mPending;
+        std::unordered_map<std::string, uint32_t> mIds;
+};
+
+class Reader
+{
+    public:
+        Reader() = default;
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        bool open(const std::string &path);
+        void close();
+
+        /**
+         * @brief Read the next block of the file.
+         * @param block set to the channel of the block and its samples.
+         * @return false at the end of the file, or on error, see error().
+         */
+        bool next(Series &block);
+
+        /** @brief Why next() stopped, empty at the end of the file. */
+        const std::string &error() const
+        {
+            return mError;
+        }
+
+        /**
+         * @brief Read a whole file, merging the blocks and the sessions of each channel.
+         * @return false if the file could not be read, series then holds what was read before the error.
+         */
+        static bool readSeries(const std::string &path, std::vector<Series> &series, std::string *error = nullptr);
+
+    private:
+        FILE *mFile {nullptr};
+        std::vector<Channel> mChannels;
+        std::string mError;
+};
+
+}
+}
@@ -20,6 +20,7 @@
 #include "basedevice_p.h"
 
 #include "base64.h"
+#include "cfacodec.h"
 #include "config.h"
 #include "indicom.h"
 #include "sharedblob.h"
@@ -69,7 +70,7 @@ BaseDevicePrivate::BaseDevicePrivate()
 
 BaseDevicePrivate::~BaseDevicePrivate()
 {
-    pAll.clear();
+    clearProperties();
 }
 
 BaseDevice::BaseDevice()
@@ -139,21 +140,8 @@ void *BaseDevice::getRawProperty(const char *name, INDI_PROPERTY_TYPE type) cons
 INDI::Property BaseDevice::getProperty(const char *name, INDI_PROPERTY_TYPE type) const
 {
     D_PTR(const BaseDevice);
-    std::lock_guard<std::mutex> lock(d->m_Lock);
-
-    for (const auto &oneProp : getProperties())
-    {
-        if (type != oneProp.getType() && type != INDI_UNKNOWN)
-            continue;
-
-        if (!oneProp.getRegistered())
-            continue;
-
-        if (oneProp.isNameMatch(name))
-            return oneProp;
-    }
-
-    return INDI::Property();
+    std::shared_lock<std::shared_mutex> lock(d->m_Lock);
+    return d->findProperty(name, type);
 }
 
 BaseDevice::Properties BaseDevice::getProperties()
@@ -173,7 +161,9 @@ int BaseDevice::removeProperty(const char *name, char *errmsg)
     D_PTR(BaseDevice);
     int result = INDI_PROPERTY_INVALID;
 
-    std::lock_guard<std::mutex> lock(d->m_Lock);
+    std::unique_lock<std::shared_mutex> lock(d->m_Lock);
+
+    d->pIndex.erase(name);
 
     d->pAll.erase_if([&name, &result](INDI::Property & prop) -> bool
     {
@@ -372,7 +362,9 @@ int BaseDevice::buildProp(const INDI::LilXmlElement &root, char *errmsg, bool is
         case INDI_NUMBER:
         {
             INDI::PropertyNumber typedProperty {0};
-            for (const auto &element : root.getElementsByTagName("defNumber"))
+            const auto elements = root.getElementsByTagName("defNumber");
+            typedProperty.reserve(elements.size()); // no slack in the widgets kept for the life of the property
+            for (const auto &element : elements)
             {
                 INDI::WidgetViewNumber widget;
 
@@ -398,7 +390,9 @@ int BaseDevice::buildProp(const INDI::LilXmlElement &root, char *errmsg, bool is
         {
             INDI::PropertySwitch typedProperty {0};
             typedProperty.setRule(root.getAttribute("rule"));
-            for (const auto &element : root.getElementsByTagName("defSwitch"))
+            const auto elements = root.getElementsByTagName("defSwitch");
+            typedProperty.reserve(elements.size());
+            for (const auto &element : elements)
             {
                 INDI::WidgetViewSwitch widget;
 
@@ -419,7 +413,9 @@ int BaseDevice::buildProp(const INDI::LilXmlElement &root, char *errmsg, bool is
         case INDI_TEXT:
         {
             INDI::PropertyText typedProperty {0};
-            for (const auto &element : root.getElementsByTagName("defText"))
+            const auto elements = root.getElementsByTagName("defText");
+            typedProperty.reserve(elements.size());
+            for (const auto &element : elements)
             {
                 INDI::WidgetViewText widget;
 
@@ -440,7 +436,9 @@ int BaseDevice::buildProp(const INDI::LilXmlElement &root, char *errmsg, bool is
         case INDI_LIGHT:
         {
             INDI::PropertyLight typedProperty {0};
-            for (const auto &element : root.getElementsByTagName("defLight"))
+            const auto elements = root.getElementsByTagName("defLight");
+            typedProperty.reserve(elements.size());
+            for (const auto &element : elements)
             {
                 INDI::WidgetViewLight widget;
 
@@ -470,7 +468,9 @@ int BaseDevice::buildProp(const INDI::LilXmlElement &root, char *errmsg, bool is
 #endif
                 blob = nullptr;
             });
-            for (const auto &element : root.getElementsByTagName("defBLOB"))
+            const auto elements = root.getElementsByTagName("defBLOB");
+            typedProperty.reserve(elements.size());
+            for (const auto &element : elements)
             {
                 INDI::WidgetViewBlob widget;
 
@@ -649,9 +649,14 @@ int BaseDevice::setValue(const INDI::LilXmlElement &root, char *errmsg)
         case INDI_NUMBER:
         {
             AutoCNumeric locale;
-            for_property<INDI::PropertyNumber>(root, property, [](const LilXmlElement & element, auto * item)
+            const bool ieee754 = root.getAttribute("encoding").toString() == "ieee754";
+            for_property<INDI::PropertyNumber>(root, property, [ieee754](const LilXmlElement & element, auto * item)
             {
-                item->setValue(element.context());
+                double value;
+                if (ieee754 && f_scanieee754(element.context().toCString(), &value) == 0)
+                    item->setValue(value);
+                else
+                    item->setValue(element.context());
 
                 // Permit changing of min/max
                 if (auto min = element.getAttribute("min")) item->setMin(min);
@@ -714,30 +719,23 @@ static bool sSharedToBlob(const INDI::LilXmlElement &element, INDI::WidgetViewBl
         return false;
     }
 
-    auto size = element.getAttribute("size");
+    size_t size = element.getAttribute("size").toInt();
     // Client mark blob that can be attached directly
 
-    // FIXME: Where is the blob data buffer freed at the end ?
+    // The buffer is released with the last view of it
     // FIXME: blobSize is not buffer size here. Must pass it all the way through
     // (while compressing shared buffer is useless)
     if (auto directAttachment = element.getAttribute("attachment-direct"))
     {
-        if (widget.getBlob())
-        {
-            IDSharedBlobFree(widget.getBlob());
-            widget.setBlobLen(0);
-        }
-        widget.setBlob(attachBlobByUid(attachementId.toString(), size));
+        widget.setBlobView(INDI::BlobView::adopt(attachBlobByUid(attachementId.toString(), size), size));
     }
     else
     {
         // For compatibility, copy to a modifiable memory area
-        widget.setBlob(realloc(widget.getBlob(), size));
         void *tmp = attachBlobByUid(attachementId.toString(), size);
-        memcpy(widget.getBlob(), tmp, size);
+        widget.setBlobView(INDI::BlobView::copy(tmp, tmp ? size : 0));
         IDSharedBlobFree(tmp);
     }
-    widget.setBlobLen(size);
 
     return true;
 }
@@ -774,11 +772,22 @@ int BaseDevicePrivate::setBLOB(INDI::PropertyBlob property, const LilXmlElement
         if (sSharedToBlob(element, *widget) == false)
 #endif
         {
-            size_t base64_encoded_size = element.context().size();
-            size_t base64_decoded_size = 3 * base64_encoded_size / 4;
-            widget->setBlob(realloc(widget->getBlob(), base64_decoded_size));
-            int blobLen = from64tobits_fast(static_cast<char *>(widget->getBlob()), element.context(), base64_encoded_size);
-            widget->setBlobLen(blobLen);
+            size_t decodedSize;
+            void *decoded = element.takeBlob(&decodedSize);
+            if (decoded)
+            {
+                // Already decoded by the parser
+                widget->setBlobView(INDI::BlobView::adopt(decoded, decodedSize));
+            }
+            else
+            {
+                // A new buffer each time: views of the previous one may still be held
+                size_t base64_encoded_size = element.context().size();
+                size_t base64_decoded_size = 3 * base64_encoded_size / 4;
+                void *data = IDSharedBlobAlloc(base64_decoded_size);
+                int blobLen = from64tobits_fast(static_cast<char *>(data), element.context(), base64_encoded_size);
+                widget->setBlobView(INDI::BlobView::adopt(data, std::max(blobLen, 0)));
+            }
         }
 
         if (format.endsWith(".z"))
@@ -803,14 +812,26 @@ int BaseDevicePrivate::setBLOB(INDI::PropertyBlob property, const LilXmlElement
                 return -1;
             }
             widget->setSize(dataSize);
-#ifdef ENABLE_INDI_SHARED_MEMORY
-            IDSharedBlobFree(widget->getBlob());
-#else
-            free(widget->getBlob());
-#endif
-            widget->setBlob(dataBuffer);
+            widget->setBlobView(INDI::BlobView::adopt(dataBuffer, dataSize));
 
         }
+        else if (format.endsWith(".cfa"))
+        {
+            widget->setFormat(format.toString().substr(0, format.lastIndexOf(".cfa")));
+
+            const uint8_t *data = static_cast<const uint8_t *>(widget->getBlob());
+            size_t dataSize = INDI::CFACodec::decodedSize(data, widget->getBlobLen());
+            void *dataBuffer = dataSize ? IDSharedBlobAlloc(dataSize) : nullptr;
+            if (dataBuffer == nullptr || !INDI::CFACodec::decompress(data, widget->getBlobLen(), dataBuffer, dataSize))
+            {
+                snprintf(errmsg, MAXRBUF, "INDI: %s.%s.%s CFA decompression error",
+                         property.getDeviceName(), property.getName(), widget->getName());
+                IDSharedBlobFree(dataBuffer);
+                return -1;
+            }
+            widget->setSize(dataSize);
+            widget->setBlobView(INDI::BlobView::adopt(dataBuffer, dataSize));
+        }
         else
         {
             widget->setFormat(format);
@@ -888,7 +909,7 @@ void BaseDevice::doMessage(XMLEle *msg)
 void BaseDevice::addMessage(const std::string &msg)
 {
     D_PTR(BaseDevice);
-    std::unique_lock<std::mutex> guard(d->m_Lock);
+    std::unique_lock<std::shared_mutex> guard(d->m_Lock);
     d->messageLog.push_back(msg);
     guard.unlock();
 
@@ -898,7 +919,7 @@ void BaseDevice::addMessage(const std::string &msg)
 const std::string &BaseDevice::messageQueue(size_t index) const
 {
     D_PTR(const BaseDevice);
-    std::lock_guard<std::mutex> lock(d->m_Lock);
+    std::shared_lock<std::shared_mutex> lock(d->m_Lock);
     assert(index < d->messageLog.size());
     return d->messageLog.at(index);
 }
@@ -906,7 +927,7 @@ const std::string &BaseDevice::messageQueue(size_t index) const
 const std::string &BaseDevice::lastMessage() const
 {
     D_PTR(const BaseDevice);
-    std::lock_guard<std::mutex> lock(d->m_Lock);
+    std::shared_lock<std::shared_mutex> lock(d->m_Lock);
     assert(d->messageLog.size() != 0);
     return d->messageLog.back();
 }
@@ -26,7 +26,9 @@
 #include <deque>
 #include <string>
 #include <mutex>
+#include <shared_mutex>
 #include <map>
+#include <unordered_map>
 #include <functional>
 
 #include "indipropertyblob.h"
@@ -62,13 +64,34 @@ class BaseDevicePrivate
         void addProperty(const INDI::Property &property)
         {
             {
-                std::unique_lock<std::mutex> lock(m_Lock);
+                std::unique_lock<std::shared_mutex> lock(m_Lock);
                 pAll.push_back(property);
+                pIndex.emplace(property.getName(), property);
             }
 
             emitWatchProperty(property, true);
         }
 
+        /** @brief Find a property by name in the index, type INDI_UNKNOWN matches any. m_Lock must be held */
+        INDI::Property findProperty(const char *name, INDI_PROPERTY_TYPE type) const
+        {
+            auto range = pIndex.equal_range(name);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                const auto &oneProp = it->second;
+                if ((type == oneProp.getType() || type == INDI_UNKNOWN) && oneProp.getRegistered() && oneProp.isNameMatch(name))
+                    return oneProp;
+            }
+            return INDI::Property();
+        }
+
+        void clearProperties()
+        {
+            std::unique_lock<std::shared_mutex> lock(m_Lock);
+            pIndex.clear();
+            pAll.clear();
+        }
+
     public: // mediator
         void mediateNewDevice(BaseDevice baseDevice)
         {
@@ -179,12 +202,13 @@ class BaseDevicePrivate
         BaseDevice self {make_shared_weak(this)}; // backward compatible (for operators as pointer)
         std::string deviceName;
         BaseDevice::Properties pAll;
+        std::unordered_multimap<std::string, INDI::Property> pIndex; // pAll by name, updated along with it
         std::map<std::string, WatchDetails> watchPropertyMap;
         LilXmlParser xmlParser;
 
         INDI::BaseMediator *mediator {nullptr};
         std::deque<std::string> messageLog;
-        mutable std::mutex m_Lock;
+        mutable std::shared_mutex m_Lock;
 
         bool valid {true};
 };
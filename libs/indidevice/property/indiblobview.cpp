@@ -0,0 +1,102 @@
+/*
+    Copyright (C) 2021 by Pawel Soja <kernel32.pl@gmail.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "indiblobview.h"
+#include "indiapi.h"
+#include "sharedblob.h"
+
+#include <cstring>
+
+namespace INDI
+{
+
+struct BlobView::Buffer
+{
+    void *data;
+    size_t size;
+
+    Buffer(void *data, size_t size): data(data), size(size) { }
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+    ~Buffer()
+    {
+        // falls back to free for the buffers that are not shared
+        IDSharedBlobFree(data);
+    }
+};
+
+BlobView BlobView::adopt(void *data, size_t size)
+{
+    BlobView result;
+    if (data != nullptr)
+        result.d = std::make_shared<Buffer>(data, size);
+    return result;
+}
+
+BlobView BlobView::copy(const void *data, size_t size)
+{
+    void *buffer = size ? IDSharedBlobAlloc(size) : nullptr;
+    if (buffer == nullptr)
+        return BlobView();
+    memcpy(buffer, data, size);
+    return adopt(buffer, size);
+}
+
+const void *BlobView::data() const
+{
+    return d ? d->data : nullptr;
+}
+
+size_t BlobView::size() const
+{
+    return d ? d->size : 0;
+}
+
+int BlobView::fd() const
+{
+    // sealed by IDSharedBlobGetFd: it won't be reused or written anymore
+    return d ? IDSharedBlobGetFd(d->data) : -1;
+}
+
+long BlobView::useCount() const
+{
+    return d.use_count();
+}
+
+BlobView BlobView::fromBlob(const IBLOB &blob)
+{
+    auto held = static_cast<const BlobView *>(blob.aux1);
+    if (held != nullptr && held->data() == blob.blob)
+        return *held;
+
+    if (blob.blob == nullptr)
+        return BlobView();
+
+    return copy(blob.blob, blob.bloblen);
+}
+
+void BlobView::setBlob(IBLOB &blob, const BlobView &view)
+{
+    BlobView *held = view ? new BlobView(view) : nullptr;
+    delete static_cast<BlobView *>(blob.aux1);
+    blob.aux1 = held;
+    blob.blob = const_cast<void *>(view.data());
+    blob.bloblen = int(view.size());
+}
+
+}
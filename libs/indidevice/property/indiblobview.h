@@ -0,0 +1,93 @@
+/*
+    Copyright (C) 2021 by Pawel Soja <kernel32.pl@gmail.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+struct _IBLOB;
+
+namespace INDI
+{
+
+/**
+ * @class INDI::BlobView
+ * @brief Reference counted data of a BLOB, shared instead of copied.
+ *
+ * The client library keeps each BLOB it receives in a BlobView. Get one with WidgetViewBlob::getBlobView():
+ * the data stays valid as long as a view refers to it, even after the property got a new BLOB, and views
+ * may be copied to other threads. Data in shared memory, as received over the local socket or decoded
+ * from the TCP stream when shared memory is available, can also be handed to another process with fd().
+ */
+class BlobView
+{
+    public:
+        BlobView() = default;
+
+        /**
+         * @brief Take a buffer allocated with malloc or IDSharedBlobAlloc. It is released with the last view.
+         */
+        static BlobView adopt(void *data, size_t size);
+
+        /**
+         * @brief Copy of the given data, in shared memory when available.
+         */
+        static BlobView copy(const void *data, size_t size);
+
+    public:
+        const void *data() const;
+        size_t size() const;
+
+        /**
+         * @brief File descriptor of the shared memory holding the data, -1 if it is not shared.
+         * It belongs to the view: dup() it to use it longer. The data is read only once its fd was asked.
+         */
+        int fd() const;
+
+        /** @brief Number of views referring to the data, including this one. */
+        long useCount() const;
+
+        bool isValid() const
+        {
+            return d != nullptr;
+        }
+
+        explicit operator bool() const
+        {
+            return isValid();
+        }
+
+    public:
+        /**
+         * @brief The view of the data of blob, held in its aux1 by setBlob(). Other data is copied.
+         */
+        static BlobView fromBlob(const _IBLOB &blob);
+
+        /**
+         * @brief Make view the data of blob, dropping the view it held before.
+         * Data blob did not get from a view is left to its owner. An empty view leaves blob empty.
+         */
+        static void setBlob(_IBLOB &blob, const BlobView &view);
+
+    private:
+        struct Buffer;
+        std::shared_ptr<Buffer> d;
+};
+
+}
@@ -18,7 +18,13 @@
 
 #include "indipropertybasic.h"
 #include "indipropertybasic_p.h"
+#include "indicom.h"
 #include <cassert>
+#include <type_traits>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <map>
 
 namespace INDI
 {
@@ -53,6 +59,120 @@ PropertyBasicPrivateTemplate<T>::PropertyBasicPrivateTemplate(RawPropertyType *r
 { }
 #endif
 
+// Sends the coalesced updates when their interval ends. The eventloop is not thread safe, so a
+// timer cannot be armed from the threads that call apply(): a single thread waits for them instead.
+class PendingApplyFlusher
+{
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static PendingApplyFlusher &instance()
+        {
+            static PendingApplyFlusher flusher;
+            return flusher;
+        }
+
+        void schedule(Clock::time_point when, std::function<void()> flush)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.emplace(when, std::move(flush));
+            if (!thread.joinable())
+                thread = std::thread(&PendingApplyFlusher::run, this);
+            wakeup.notify_one();
+        }
+
+        ~PendingApplyFlusher()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                quit = true;
+            }
+            wakeup.notify_one();
+            if (thread.joinable())
+                thread.join();
+        }
+
+    private:
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!quit)
+            {
+                if (queue.empty())
+                {
+                    wakeup.wait(lock);
+                    continue;
+                }
+
+                auto next = queue.begin();
+                if (Clock::now() < next->first)
+                {
+                    wakeup.wait_until(lock, next->first);
+                    continue;
+                }
+
+                auto flush = std::move(next->second);
+                queue.erase(next);
+                lock.unlock();
+                flush();
+                lock.lock();
+            }
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::multimap<Clock::time_point, std::function<void()>> queue;
+        std::thread thread;
+        bool quit {false};
+};
+
+template <typename T>
+void PropertyBasicPrivateTemplate<T>::limitedApply(const char *format, va_list args, const std::weak_ptr<BasicPropertyType> &self)
+{
+    auto &limit = *applyLimit;
+    std::lock_guard<std::mutex> lock(limit.lock);
+    auto now = std::chrono::steady_clock::now();
+    auto interval = std::chrono::milliseconds(applyInterval);
+
+    if (format != nullptr || this->typedProperty.getState() != limit.lastState || now - limit.lastTime >= interval)
+    {
+        this->typedProperty.vapply(format, args);
+        limit.lastTime = now;
+        limit.lastState = this->typedProperty.getState();
+        limit.pending = false;
+        return;
+    }
+
+    // keep a copy, the widgets may change before it is sent
+    limit.pendingWidgets.assign(this->typedProperty.begin(), this->typedProperty.end());
+    limit.pendingProperty = this->typedProperty;
+    limit.pendingProperty.setWidgets(limit.pendingWidgets.data(), limit.pendingWidgets.size());
+
+    if (limit.pending)
+        return;
+
+    limit.pending = true;
+    PendingApplyFlusher::instance().schedule(limit.lastTime + interval, [self]
+    {
+        if (auto d = self.lock())
+            d->flushPendingApply();
+    });
+}
+
+template <typename T>
+void PropertyBasicPrivateTemplate<T>::flushPendingApply()
+{
+    auto &limit = *applyLimit;
+    std::lock_guard<std::mutex> lock(limit.lock);
+    if (!limit.pending)
+        return;
+
+    limit.pendingProperty.apply();
+    limit.lastTime = std::chrono::steady_clock::now();
+    limit.pending = false;
+}
+
 template <typename T>
 PropertyBasicPrivateTemplate<T>::~PropertyBasicPrivateTemplate()
 {
@@ -297,7 +417,10 @@ template <typename T>
 void PropertyBasic<T>::vapply(const char *format, va_list args) const
 {
     D_PTR(const PropertyBasic);
-    d->typedProperty.vapply(format, args);
+    if (std::is_same<T, IBLOB>::value || d->applyInterval == 0)
+        d->typedProperty.vapply(format, args);
+    else
+        const_cast<PropertyBasicPrivate *>(d)->limitedApply(format, args, std::static_pointer_cast<PropertyBasicPrivate>(d_ptr));
 }
 
 template <typename T>
@@ -310,10 +433,9 @@ void PropertyBasic<T>::vdefine(const char *format, va_list args) const
 template <typename T>
 void PropertyBasic<T>::apply(const char *format, ...) const
 {
-    D_PTR(const PropertyBasic);
     va_list ap;
     va_start(ap, format);
-    d->typedProperty.vapply(format, ap);
+    vapply(format, ap);
     va_end(ap);
 }
 
@@ -329,9 +451,87 @@ void PropertyBasic<T>::define(const char *format, ...) const
 
 template <typename T>
 void PropertyBasic<T>::apply() const
+{
+    apply(nullptr);
+}
+
+static std::string appliedValue(const WidgetView<IText> &widget)
+{
+    return widget.getText() ? widget.getText() : "";
+}
+
+static std::string appliedValue(const WidgetView<INumber> &widget)
+{
+    char buffer[MAXINDIFORMAT];
+    numberFormat(buffer, widget.getFormat(), widget.getValue());
+    return buffer;
+}
+
+static std::string appliedValue(const WidgetView<ISwitch> &widget)
+{
+    return widget.getStateAsString();
+}
+
+static std::string appliedValue(const WidgetView<ILight> &widget)
+{
+    return widget.getStateAsString();
+}
+
+template <typename T>
+bool PropertyBasic<T>::vapplyChanges(const char *format, va_list args) const
 {
     D_PTR(const PropertyBasic);
-    d->typedProperty.apply();
+    const auto &property = d->typedProperty;
+
+    if constexpr (std::is_same<T, IBLOB>::value)
+    {
+        property.vapply(format, args);
+        return true;
+    }
+    else
+    {
+        size_t count = property.count();
+        bool all = !d->applied || d->appliedValues.size() != count;
+        std::vector<T> changed;
+
+        d->appliedValues.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string value = appliedValue(*property.at(i));
+            if (all || value != d->appliedValues[i])
+            {
+                changed.push_back(*property.at(i));
+                d->appliedValues[i] = std::move(value);
+            }
+        }
+
+        if (changed.empty() && d->applied && d->appliedState == property.getState() && format == nullptr)
+            return false;
+
+        d->applied = true;
+        d->appliedState = property.getState();
+
+        PropertyView<T> delta = property;
+        delta.setWidgets(static_cast<WidgetView<T>*>(changed.data()), changed.size());
+        delta.vapply(format, args);
+        return true;
+    }
+}
+
+template <typename T>
+bool PropertyBasic<T>::applyChanges(const char *format, ...) const
+{
+    va_list ap;
+    va_start(ap, format);
+    bool result = vapplyChanges(format, ap);
+    va_end(ap);
+    return result;
+}
+
+template <typename T>
+bool PropertyBasic<T>::applyChanges() const
+{
+    return applyChanges(nullptr);
 }
 
 template <typename T>
@@ -355,6 +555,23 @@ int PropertyBasic<T>::findWidgetIndexByName(const char *name) const
     return int(it == nullptr ? -1 : it - begin());
 }
 
+template <typename T>
+void PropertyBasic<T>::setApplyInterval(int milliseconds)
+{
+    D_PTR(PropertyBasic);
+    // set up before the interval is seen by apply(), and kept for good once there
+    if (milliseconds > 0 && d->applyLimit == nullptr)
+        d->applyLimit.reset(new typename PropertyBasicPrivate::ApplyLimit);
+    d->applyInterval = std::max(milliseconds, 0);
+}
+
+template <typename T>
+int PropertyBasic<T>::getApplyInterval() const
+{
+    D_PTR(const PropertyBasic);
+    return d->applyInterval;
+}
+
 template <typename T>
 size_t PropertyBasic<T>::size() const
 {
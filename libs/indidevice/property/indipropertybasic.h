@@ -118,9 +118,29 @@ class PropertyBasic : public INDI::Property
         void apply() const;
         void define() const;
 
+        /**
+         * @brief Send only the widgets whose value changed since the last applyChanges(), as formatted on the wire.
+         * Nothing is sent when neither the widgets nor the state changed and there is no message.
+         * The first call and BLOB properties send all widgets. Changes sent with apply() are not seen here.
+         * @return True if an update was sent.
+         */
+        bool vapplyChanges(const char *format, va_list args) const;
+        bool applyChanges(const char *format, ...) const ATTRIBUTE_FORMAT_PRINTF(2, 3);
+        bool applyChanges() const;
+
     protected:
         PropertyView<T> * operator &();
 
+    public:
+        /**
+         * @brief Send at most one apply() update per interval, in milliseconds. Zero, the default, disables the limit.
+         * Updates within the interval are coalesced: a copy of the last one is sent when the interval ends.
+         * Updates that carry a message or change the state are always sent at once. BLOBs are never limited.
+         * @note apply() may then be called from any thread.
+         */
+        void setApplyInterval(int milliseconds);
+        int getApplyInterval() const;
+
     public:
         size_t size() const;
         size_t count() const
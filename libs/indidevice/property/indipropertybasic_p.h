@@ -22,6 +22,11 @@
 #include "indipropertyview.h"
 
 #include <vector>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 #include <functional>
 
 #define INDI_PROPERTY_RAW_CAST
@@ -57,6 +62,29 @@ class PropertyBasicPrivateTemplate: public PropertyContainer<T>, public Property
         bool raw;
 #endif
         std::vector<WidgetView<T>>  widgets;
+
+        // widget values and state as last sent by applyChanges
+        mutable std::vector<std::string> appliedValues;
+        mutable IPState appliedState {IPS_IDLE};
+        mutable bool applied {false};
+
+    public: // apply() rate limit, see PropertyBasic::setApplyInterval
+        void limitedApply(const char *format, va_list args, const std::weak_ptr<BasicPropertyType> &self);
+        void flushPendingApply();
+
+        struct ApplyLimit
+        {
+            std::mutex lock;
+            std::chrono::steady_clock::time_point lastTime;
+            IPState lastState {IPS_IDLE};
+            bool pending {false};
+            PropertyView<T> pendingProperty;
+            std::vector<WidgetView<T>> pendingWidgets;
+        };
+
+        std::atomic<int> applyInterval {0};
+        // allocated when an interval is first set: clients and most driver properties never need it
+        std::unique_ptr<ApplyLimit> applyLimit;
 };
 
 }
@@ -30,6 +30,13 @@ PropertyBlobPrivate::~PropertyBlobPrivate()
 {
     for (auto &it: widgets)
     {
+        // the data of a view goes with the last view
+        if (it.aux1 != nullptr)
+        {
+            it.setBlobView(BlobView());
+            continue;
+        }
+
         auto blob = it.getBlob();
         if (blob != nullptr && deleter != nullptr)
         {
@@ -18,6 +18,8 @@
 
 #include "indipropertyview.h"
 
+#include <vector>
+
 void (*WeakIDSetTextVA)(const ITextVectorProperty *, const char *, va_list) = nullptr;
 void (*WeakIDDefTextVA)(const ITextVectorProperty *, const char *, va_list) = nullptr;
 void (*WeakIDSetNumberVA)(const INumberVectorProperty *, const char *, va_list) = nullptr;
@@ -268,9 +270,11 @@ void PropertyView<INumber>::updateMinMax()
 template <> template<>
 bool PropertyView<IText>::isUpdated(const char * const texts[], const char * const names[], int n) const
 {
+    std::vector<int> indexes(n);
+    IUFindMemberIndexes(widget(), sizeof(*widget()), count(), const_cast<char**>(names), n, indexes.data());
     for (int i = 0; i < n; i++)
     {
-        auto widget = findWidgetByName(names[i]);
+        auto widget = indexes[i] < 0 ? nullptr : at(indexes[i]);
         if (widget && strcmp(widget->getText(), texts[i]) != 0)
             return true;
     }
@@ -280,9 +284,11 @@ bool PropertyView<IText>::isUpdated(const char * const texts[], const char * con
 template <> template<>
 bool PropertyView<INumber>::isUpdated(const double values[], const char * const names[], int n) const
 {
+    std::vector<int> indexes(n);
+    IUFindMemberIndexes(widget(), sizeof(*widget()), count(), const_cast<char**>(names), n, indexes.data());
     for (int i = 0; i < n; i++)
     {
-        auto widget = findWidgetByName(names[i]);
+        auto widget = indexes[i] < 0 ? nullptr : at(indexes[i]);
         if (widget && widget->getValue() != values[i])
             return true;
     }
@@ -292,9 +298,11 @@ bool PropertyView<INumber>::isUpdated(const double values[], const char * const
 template <> template<>
 bool PropertyView<ISwitch>::isUpdated(const ISState states[], const char * const names[], int n) const
 {
+    std::vector<int> indexes(n);
+    IUFindMemberIndexes(widget(), sizeof(*widget()), count(), const_cast<char**>(names), n, indexes.data());
     for (int i = 0; i < n; i++)
     {
-        auto widget = findWidgetByName(names[i]);
+        auto widget = indexes[i] < 0 ? nullptr : at(indexes[i]);
         if (widget && widget->getState() != states[i])
             return true;
     }
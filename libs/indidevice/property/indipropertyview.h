@@ -22,6 +22,7 @@
 #include "indidevapi.h"
 #include "indiwidgettraits.h"
 #include "indiwidgetview.h"
+#include "indiblobview.h"
 
 #include <string>
 #include <cstring>
@@ -1017,6 +1018,13 @@ struct WidgetView<IBLOB>: PROPERTYVIEW_BASE_ACCESS IBLOB
         {
             this->bloblen = size;
         }
+        /**
+         * @brief Make the data of view the BLOB, dropping the view held before.
+         */
+        void setBlobView(const BlobView &view)
+        {
+            BlobView::setBlob(*this, view);
+        }
         void setSize(int size)
         {
             this->size = size;
@@ -1057,6 +1065,14 @@ struct WidgetView<IBLOB>: PROPERTYVIEW_BASE_ACCESS IBLOB
         {
             return this->bloblen;
         }
+        /**
+         * @brief The BLOB shared with the library: the view stays valid when the property gets a new BLOB.
+         * A BLOB that was not set from a view is copied.
+         */
+        BlobView getBlobView() const
+        {
+            return BlobView::fromBlob(*this);
+        }
         int getSize() const
         {
             return this->size;
@@ -58,7 +58,8 @@ int32_t read_fd_linux(uint8_t* buf, uint16_t count, int32_t timeout_ms, void* ar
 
         if (ret == 1)
         {
-            ssize_t r = read(fd, buf + total, 1);
+            // Take whatever arrived, nanomodbus asks for the exact length of each part of the frame
+            ssize_t r = read(fd, buf + total, count - total);
             if (r == 0)
             {
                 disconnect(arg);
@@ -106,7 +107,7 @@ int32_t write_fd_linux(const uint8_t* buf, uint16_t count, int32_t timeout_ms, v
 
         if (ret == 1)
         {
-            ssize_t w = write(fd, buf + total, count);
+            ssize_t w = write(fd, buf + total, count - total);
             if (w == 0)
             {
                 disconnect(arg);
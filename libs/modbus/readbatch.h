@@ -0,0 +1,228 @@
+/*
+    Batched Modbus reads for the nanomodbus client.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "nanomodbus.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief The ModbusReadBatch class reads the coils, inputs and registers a driver polls in as few transactions as possible.
+ *
+ * The driver adds what it needs once, then calls execute() every poll. Overlapping and adjacent addresses of the same
+ * table are merged into one multi-register read, within the limits of the function code, and the values are kept
+ * until the next execute() so the property updates of a poll cycle do not talk to the device again.
+ *
+ * \code{cpp}
+ * m_Batch.add(ModbusReadBatch::COILS, 0, 8);
+ * m_Batch.add(ModbusReadBatch::DISCRETE_INPUTS, 0, 8);
+ * ...
+ * if (m_Batch.execute(&nmbs) == NMBS_ERROR_NONE)
+ *     bool relay3 = m_Batch.bit(ModbusReadBatch::COILS, 3);
+ * \endcode
+ */
+class ModbusReadBatch
+{
+    public:
+        enum Table
+        {
+            COILS,
+            DISCRETE_INPUTS,
+            HOLDING_REGISTERS,
+            INPUT_REGISTERS,
+            TABLES
+        };
+
+        /** A run of consecutive addresses read with one function call. */
+        struct Range
+        {
+            uint16_t address;
+            uint16_t quantity;
+        };
+
+        /**
+         * @brief add Read quantity addresses of table starting at address on every execute().
+         */
+        void add(Table table, uint16_t address, uint16_t quantity = 1)
+        {
+            m_Requests[table].push_back({address, quantity});
+            m_Plan[table] = plan(m_Requests[table], maxQuantity(table));
+        }
+
+        /**
+         * @brief clear Forget the requests and the values read.
+         */
+        void clear()
+        {
+            for (int table = 0; table < TABLES; table++)
+            {
+                m_Requests[table].clear();
+                m_Plan[table].clear();
+                m_Values[table].clear();
+                m_Errors[table] = NMBS_ERROR_NONE;
+            }
+        }
+
+        /**
+         * @brief execute Read every planned range, one transaction each.
+         * @return NMBS_ERROR_NONE, or the first error. The values of a table that failed are left as they were,
+         * see error() for which one.
+         */
+        nmbs_error execute(nmbs_t *nmbs)
+        {
+            nmbs_error first = NMBS_ERROR_NONE;
+            for (int table = 0; table < TABLES; table++)
+            {
+                std::map<uint16_t, uint16_t> values;
+                m_Errors[table] = NMBS_ERROR_NONE;
+                for (const Range &range : m_Plan[table])
+                {
+                    m_Errors[table] = read(nmbs, static_cast<Table>(table), range, values);
+                    if (m_Errors[table] != NMBS_ERROR_NONE)
+                        break;
+                }
+
+                if (m_Errors[table] == NMBS_ERROR_NONE)
+                    m_Values[table].swap(values);
+                else if (first == NMBS_ERROR_NONE)
+                    first = m_Errors[table];
+            }
+            return first;
+        }
+
+        /**
+         * @return The error the last execute() read table with.
+         */
+        nmbs_error error(Table table) const
+        {
+            return m_Errors[table];
+        }
+
+        /**
+         * @return The coil or discrete input read by the last execute(), false if it was not read.
+         */
+        bool bit(Table table, uint16_t address) const
+        {
+            return value(table, address) != 0;
+        }
+
+        /**
+         * @return The register read by the last execute(), 0 if it was not read.
+         */
+        uint16_t value(Table table, uint16_t address) const
+        {
+            auto it = m_Values[table].find(address);
+            return it == m_Values[table].end() ? 0 : it->second;
+        }
+
+        /**
+         * @brief update Keep the cached value in step with a write, until the next execute() reads it back.
+         */
+        void update(Table table, uint16_t address, uint16_t newValue)
+        {
+            auto it = m_Values[table].find(address);
+            if (it != m_Values[table].end())
+                it->second = newValue;
+        }
+
+        /**
+         * @return The transactions execute() makes for table.
+         */
+        const std::vector<Range> &ranges(Table table) const
+        {
+            return m_Plan[table];
+        }
+
+        /**
+         * @brief plan Merge overlapping and adjacent ranges, none longer than maxQuantity.
+         */
+        static std::vector<Range> plan(std::vector<Range> requests, uint16_t maxQuantity)
+        {
+            std::sort(requests.begin(), requests.end(), [](const Range & a, const Range & b)
+            {
+                return a.address < b.address;
+            });
+
+            std::vector<Range> ranges;
+            for (const Range &request : requests)
+            {
+                uint32_t start = request.address;
+                uint32_t end = start + request.quantity;
+                if (!ranges.empty())
+                {
+                    Range &last = ranges.back();
+                    uint32_t lastEnd = static_cast<uint32_t>(last.address) + last.quantity;
+                    if (start <= lastEnd)
+                    {
+                        // Extend the last range as far as the function code allows, the rest starts a new one
+                        uint32_t extended = std::min<uint32_t>(std::max(end, lastEnd), last.address + maxQuantity);
+                        last.quantity = static_cast<uint16_t>(extended - last.address);
+                        start = extended;
+                    }
+                }
+                while (start < end)
+                {
+                    uint32_t quantity = std::min<uint32_t>(end - start, maxQuantity);
+                    ranges.push_back({static_cast<uint16_t>(start), static_cast<uint16_t>(quantity)});
+                    start += quantity;
+                }
+            }
+            return ranges;
+        }
+
+    private:
+        static uint16_t maxQuantity(Table table)
+        {
+            // Limits of the Modbus application protocol for FC 01/02 and FC 03/04
+            return (table == COILS || table == DISCRETE_INPUTS) ? 2000 : 125;
+        }
+
+        static nmbs_error read(nmbs_t *nmbs, Table table, const Range &range, std::map<uint16_t, uint16_t> &values)
+        {
+            nmbs_error err;
+            if (table == COILS || table == DISCRETE_INPUTS)
+            {
+                nmbs_bitfield bits = {0};
+                err = (table == COILS) ? nmbs_read_coils(nmbs, range.address, range.quantity, bits) :
+                      nmbs_read_discrete_inputs(nmbs, range.address, range.quantity, bits);
+                if (err == NMBS_ERROR_NONE)
+                    for (uint16_t i = 0; i < range.quantity; i++)
+                        values[range.address + i] = nmbs_bitfield_read(bits, i);
+            }
+            else
+            {
+                uint16_t registers[125] = {0};
+                err = (table == HOLDING_REGISTERS) ? nmbs_read_holding_registers(nmbs, range.address, range.quantity, registers) :
+                      nmbs_read_input_registers(nmbs, range.address, range.quantity, registers);
+                if (err == NMBS_ERROR_NONE)
+                    for (uint16_t i = 0; i < range.quantity; i++)
+                        values[range.address + i] = registers[i];
+            }
+            return err;
+        }
+
+        std::vector<Range> m_Requests[TABLES];
+        std::vector<Range> m_Plan[TABLES];
+        std::map<uint16_t, uint16_t> m_Values[TABLES];
+        nmbs_error m_Errors[TABLES] {NMBS_ERROR_NONE, NMBS_ERROR_NONE, NMBS_ERROR_NONE, NMBS_ERROR_NONE};
+};
@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include <algorithm>
+#include <atomic>
 
 #ifdef _WIN32
 #ifndef NOMINMAX
@@ -89,7 +90,7 @@ class EventFd
 
     private:
         int pipefd[2] = {-1, -1};
-        int total = 0;
+        std::atomic<int> total {0}; // other threads wake up the one in select
 };
 #endif
 
@@ -83,38 +83,143 @@ TcpSocket::TcpSocket(std::unique_ptr<TcpSocketPrivate> &&d)
     : d_ptr(std::move(d))
 { }
 
+ssize_t TcpSocketPrivate::sendAvailable(const char *data, size_t size)
+{
+    size_t sent = 0;
+    while (sent < size)
+    {
+        ssize_t ret = sendSocket(data + sent, size - sent);
+        if (ret >= 0)
+        {
+            sent += ret;
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        return -1;
+    }
+    return sent;
+}
+
 ssize_t TcpSocketPrivate::write(const void *data, size_t size)
 {
-    ssize_t ret;
-    do
+    static const size_t chunkSize = 65536;
+
+    if (socketState != TcpSocket::ConnectedState)
     {
-        std::unique_lock<std::mutex> locker(socketStateMutex);
-        if (socketState != TcpSocket::ConnectedState)
+        return 0;
+    }
+
+    const char *ptr = static_cast<const char *>(data);
+    size_t left = size;
+    bool wasEmpty, overflow = false;
+    {
+        std::unique_lock<std::mutex> locker(writeMutex);
+        if (socketFd == SocketInvalid)
         {
             return 0;
         }
-        ret = TcpSocketPrivate::sendSocket(data, size);
+        wasEmpty = writeQueue.empty();
+        if (wasEmpty)
+        {
+            // nothing ahead of this data, the connection may take it at once
+            ssize_t ret = sendAvailable(ptr, left);
+            if (ret < 0)
+            {
+                locker.unlock();
+                setSocketError(TcpSocket::ConnectionRefusedError);
+                return 0;
+            }
+            ptr += ret;
+            left -= ret;
+        }
+
+        if (left > 0)
+        {
+            // small writes are merged, the socket thread sends them together
+            if (!writeQueue.empty() && writeQueue.back().size() < chunkSize)
+                writeQueue.back().append(ptr, left);
+            else
+                writeQueue.emplace_back(ptr, left);
+            writeQueued += left;
+
+            if (!congested && writeQueued > highWaterMark)
+                overflow = congested = true;
+        }
     }
-    while (ret == -1 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK));
 
-    if (ret < 0)
+    // the socket thread watches for the connection to be writable again
+    if (wasEmpty && left > 0)
+        select.wakeUp();
+
+    if (overflow && onBackpressure)
+        onBackpressure(true);
+
+    return size;
+}
+
+bool TcpSocketPrivate::flushWriteQueue()
+{
+    bool drained = false;
     {
-        setSocketError(TcpSocket::ConnectionRefusedError);
-        return 0;
+        std::unique_lock<std::mutex> locker(writeMutex);
+        while (!writeQueue.empty())
+        {
+            const std::string &chunk = writeQueue.front();
+            ssize_t ret = sendAvailable(chunk.data() + writeOffset, chunk.size() - writeOffset);
+            if (ret < 0)
+            {
+                locker.unlock();
+                setSocketError(TcpSocket::ConnectionRefusedError);
+                return false;
+            }
+            writeOffset += ret;
+            writeQueued -= ret;
+            if (writeOffset < chunk.size())
+                break;
+            writeQueue.pop_front();
+            writeOffset = 0;
+        }
+
+        if (writeQueue.empty())
+        {
+            drained = congested;
+            congested = false;
+            bytesWritten.notify_all();
+        }
     }
 
-    return ret;
+    if (drained && onBackpressure)
+        onBackpressure(false);
+
+    return true;
+}
+
+void TcpSocketPrivate::clearWriteQueue()
+{
+    writeQueue.clear();
+    writeOffset = 0;
+    writeQueued = 0;
+    congested = false;
+    bytesWritten.notify_all();
 }
 
 bool TcpSocketPrivate::connectSocket(const std::string &hostName, unsigned short port)
 {
     // create socket handle
-    if (!createSocket(SocketAddress::isUnix(hostName) ? AF_UNIX : AF_INET))
+    isUnixSocket = SocketAddress::isUnix(hostName);
+    if (!createSocket(isUnixSocket ? AF_UNIX : AF_INET))
     {
         setSocketError(TcpSocket::SocketResourceError);
         return false;
     }
 
+    // before connecting, so that the buffers count in the window negotiated
+    if (!isUnixSocket)
+        setProfileSocket(socketProfile);
+
     // set non blocking mode
     if (!setNonblockSocket())
     {
@@ -166,6 +271,11 @@ bool TcpSocketPrivate::processSocket()
 {
     select.clear();
     select.setReadEvent(socketFd);
+    {
+        std::unique_lock<std::mutex> locker(writeMutex);
+        if (!writeQueue.empty())
+            select.setWriteEvent(socketFd);
+    }
 #ifndef _WIN32
     select.setTimeout(10 * 1000); // we can wake up
 #else
@@ -186,6 +296,12 @@ bool TcpSocketPrivate::processSocket()
         return true;
     }
 
+    // send what is queued
+    if (select.isWriteEvent(socketFd) && !flushWriteQueue())
+    {
+        return true;
+    }
+
     // nothing to do
     if (!select.isReadEvent(socketFd))
     {
@@ -235,7 +351,12 @@ void TcpSocketPrivate::connectToHost(const std::string &hostName, unsigned short
     {
         Finally finally([this]
         {
-            closeSocket();
+            {
+                // no write() is sending while the socket closes
+                std::unique_lock<std::mutex> locker(writeMutex);
+                clearWriteQueue();
+                closeSocket();
+            }
             setSocketState(TcpSocket::UnconnectedState);
         });
 
@@ -351,6 +472,17 @@ void TcpSocket::setConnectionTimeout(int timeout)
     d_ptr->timeout = timeout;
 }
 
+void TcpSocket::setSocketProfile(SocketProfile profile)
+{
+    if (d_ptr->socketProfile.exchange(profile) == profile)
+        return;
+
+    // no close while the options are set
+    std::unique_lock<std::mutex> locker(d_ptr->writeMutex);
+    if (d_ptr->socketFd != SocketInvalid && !d_ptr->isUnixSocket)
+        d_ptr->setProfileSocket(profile);
+}
+
 void TcpSocket::connectToHost(const std::string &hostName, uint16_t port)
 {
     d_ptr->connectToHost(hostName, port);
@@ -358,6 +490,11 @@ void TcpSocket::connectToHost(const std::string &hostName, uint16_t port)
 
 void TcpSocket::disconnectFromHost()
 {
+    // let the socket thread send what is queued, it can't wait for itself
+    if (d_ptr->thread.get_id() != std::this_thread::get_id())
+    {
+        waitForBytesWritten();
+    }
     d_ptr->aboutToClose();
 }
 
@@ -371,6 +508,18 @@ ssize_t TcpSocket::write(const std::string &data)
     return write(data.data(), data.size());
 }
 
+size_t TcpSocket::bytesToWrite() const
+{
+    std::unique_lock<std::mutex> locker(d_ptr->writeMutex);
+    return d_ptr->writeQueued;
+}
+
+void TcpSocket::setWriteBufferHighWaterMark(size_t size)
+{
+    std::unique_lock<std::mutex> locker(d_ptr->writeMutex);
+    d_ptr->highWaterMark = size;
+}
+
 static std::string sSocketErrorToString(TcpSocket::SocketError error)
 {
     switch (error)
@@ -457,6 +606,11 @@ void TcpSocket::onErrorOccurred(const std::function<void(SocketError)> &callback
     d_ptr->onErrorOccurred = callback;
 }
 
+void TcpSocket::onBackpressure(const std::function<void(bool)> &callback)
+{
+    d_ptr->onBackpressure = callback;
+}
+
 bool TcpSocket::waitForConnected(int timeout) const
 {
     if (d_ptr->thread.get_id() == std::this_thread::get_id())
@@ -489,6 +643,22 @@ bool TcpSocket::waitForDisconnected(int timeout) const
 
 }
 
+bool TcpSocket::waitForBytesWritten(int timeout) const
+{
+    if (d_ptr->thread.get_id() == std::this_thread::get_id())
+    {
+        d_ptr->setSocketError(TcpSocket::SocketError::OperationError);
+        return false;
+    }
+
+    // the queue is cleared when the connection closes
+    std::unique_lock<std::mutex> locker(d_ptr->writeMutex);
+    return d_ptr->bytesWritten.wait_for(locker, std::chrono::milliseconds(timeout), [this]
+    {
+        return d_ptr->writeQueue.empty();
+    }) && d_ptr->socketState == TcpSocket::ConnectedState;
+}
+
 int *TcpSocket::socketDescriptor() const
 {
     return reinterpret_cast<int *>(d_ptr->socketFd);
@@ -68,6 +68,13 @@ class TcpSocket
             ClosingState
         };
 
+        /** @brief TCP options of the connection, for what it mostly carries. */
+        enum SocketProfile
+        {
+            ControlProfile, /*!< Small messages sent without delay (TCP_NODELAY) */
+            BulkProfile     /*!< BLOBs too: large socket buffers on top of the control profile */
+        };
+
     public:
         TcpSocket();
         virtual ~TcpSocket();
@@ -75,14 +82,29 @@ class TcpSocket
     public:
         void setConnectionTimeout(int timeout);
 
+        /** @brief Tune the TCP options, ControlProfile by default.
+         *  Applied at once when connected, else when the connection is made. No-op on local sockets.
+         */
+        void setSocketProfile(SocketProfile profile);
+
     public:
         void connectToHost(const std::string &hostName, uint16_t port);
         void disconnectFromHost();
 
     public:
+        /** @brief Send data without blocking.
+         *  What the connection can't take at once is queued and written by the socket thread.
+         *  @return size, or 0 if the socket is not connected.
+         */
         ssize_t write(const char *data, size_t size);
         ssize_t write(const std::string &data);
 
+        /** @brief Bytes queued and not written to the connection yet. */
+        size_t bytesToWrite() const;
+
+        /** @brief Bytes queued above which onBackpressure(true) is called, 8 MiB by default. */
+        void setWriteBufferHighWaterMark(size_t size);
+
     public:
         SocketError error() const;
         std::string errorString() const;
@@ -93,9 +115,15 @@ class TcpSocket
         void onData(const std::function<void(const char *, size_t)> &callback);
         void onErrorOccurred(const std::function<void(SocketError)> &callback);
 
+        /** @brief Called with true by write() when the queue grows above the high water mark,
+         *         then with false from the socket thread once it is all written.
+         */
+        void onBackpressure(const std::function<void(bool)> &callback);
+
     public:
         bool waitForDisconnected(int timeout = 2000) const;
         bool waitForConnected(int timeout = 2000) const;
+        bool waitForBytesWritten(int timeout = 2000) const;
 
     public:
         int *socketDescriptor() const;
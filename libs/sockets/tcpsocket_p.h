@@ -25,6 +25,7 @@
 #include <cstring>
 #include <cstdio>
 
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <thread>
@@ -86,12 +87,18 @@ class TcpSocketPrivate
         ssize_t recvSocket(void *dst, size_t size);
         ssize_t sendSocket(const void *src, size_t size);
         bool setNonblockSocket();
+        bool setProfileSocket(TcpSocket::SocketProfile profile);
 
     public: // low level helpers
         bool connectSocket(const std::string &hostName, unsigned short port);
         bool waitForConnectedSockets();
         bool processSocket();
 
+        /** @brief Send what the connection takes without blocking, -1 on error. */
+        ssize_t sendAvailable(const char *data, size_t size);
+        bool flushWriteQueue();
+        void clearWriteQueue(); // with writeMutex held
+
     public: // TcpSocketPrivate API
         ssize_t write(const void *data, size_t size);
 
@@ -115,6 +122,8 @@ class TcpSocketPrivate
         SocketFileDescriptor socketFd = SocketInvalid;
         Select select;
         int timeout{30000};
+        std::atomic<TcpSocket::SocketProfile> socketProfile{TcpSocket::ControlProfile};
+        bool isUnixSocket{false};
 
         std::thread thread;
         std::atomic<bool> isAboutToClose{false};
@@ -126,9 +135,19 @@ class TcpSocketPrivate
         TcpSocket::SocketError socketError;
         std::string errorString;
 
+        // data the connection could not take yet, written by the socket thread
+        mutable std::mutex writeMutex;
+        mutable std::condition_variable bytesWritten;
+        std::deque<std::string> writeQueue;
+        size_t writeOffset {0}; // part of writeQueue.front() already written
+        size_t writeQueued {0};
+        size_t highWaterMark {8 * 1024 * 1024};
+        bool congested {false};
+
         // events
         std::function<void()> onConnected;
         std::function<void()> onDisconnected;
         std::function<void(const char *, size_t)> onData;
         std::function<void(TcpSocket::SocketError)> onErrorOccurred;
+        std::function<void(bool)> onBackpressure;
 };
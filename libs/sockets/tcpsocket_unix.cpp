@@ -19,6 +19,8 @@
 #include "tcpsocket_p.h"
 
 #include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 bool TcpSocketPrivate::createSocket(int domain)
 {
@@ -42,6 +44,44 @@ bool TcpSocketPrivate::setNonblockSocket()
     return true;
 }
 
+#ifdef __linux__
+// A buffer set by hand is no longer autotuned, and is capped by the system limit
+static bool bufferAllowed(const char *limitPath, int size)
+{
+    FILE *file = fopen(limitPath, "r");
+    if (file == nullptr)
+        return false;
+    long limit = 0;
+    if (fscanf(file, "%ld", &limit) != 1)
+        limit = 0;
+    fclose(file);
+    return limit >= size;
+}
+#endif
+
+bool TcpSocketPrivate::setProfileSocket(TcpSocket::SocketProfile profile)
+{
+    // BLOBs of several MB arrive in bursts, the buffer lets them flow at the link speed
+    static const int bulkBufferSize = 4 * 1024 * 1024;
+
+    int one = 1;
+    if (setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0)
+        return false;
+
+    if (profile != TcpSocket::BulkProfile)
+        return true;
+
+    int current = 0;
+    socklen_t len = sizeof(current);
+    if (getsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &current, &len) == 0 && current >= bulkBufferSize)
+        return true;
+#ifdef __linux__
+    if (!bufferAllowed("/proc/sys/net/core/rmem_max", bulkBufferSize))
+        return true;
+#endif
+    return setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &bulkBufferSize, sizeof(bulkBufferSize)) == 0;
+}
+
 ssize_t TcpSocketPrivate::recvSocket(void *dst, size_t size)
 {
     return ::read(socketFd, dst, size);
@@ -48,6 +48,21 @@ bool TcpSocketPrivate::setNonblockSocket()
     return iResult == NO_ERROR;
 }
 
+bool TcpSocketPrivate::setProfileSocket(TcpSocket::SocketProfile profile)
+{
+    static const int bulkBufferSize = 4 * 1024 * 1024;
+
+    BOOL one = TRUE;
+    if (setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&one), sizeof(one)) != 0)
+        return false;
+
+    if (profile != TcpSocket::BulkProfile)
+        return true;
+
+    return setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char *>(&bulkBufferSize),
+                      sizeof(bulkBufferSize)) == 0;
+}
+
 ssize_t TcpSocketPrivate::recvSocket(void *dst, size_t size)
 {
     return ::recv(socketFd, static_cast<char *>(dst), int(size), 0);
@@ -151,6 +151,44 @@ TEST(ALIGNMENT_TEST, Test_ThreeSyncPointsAltAz)
     ASSERT_DOUBLE_EQ(round(testPointAz, 1), round(roundTripAz, 1));
 }
 
+TEST(ALIGNMENT_TEST, Test_BatchTransformsMatchSingleTransforms)
+{
+    Scope s(INDI::AlignmentSubsystem::MathPluginManagement::EQUATORIAL);
+    ASSERT_TRUE(s.updateLocation(29.05, 48.15, 0));
+    s.Handshake();
+
+    ASSERT_TRUE(s.Sync(18.6156972, 38.7856944));
+    ASSERT_TRUE(s.Sync(14.2612083, 19.1872694));
+    ASSERT_TRUE(s.Sync(13.3988500, 54.9254167));
+
+    const size_t Count = 4;
+    double RightAscensions[Count] = { 18.6156972, 5.2422980, 10.1395278, 0.7123611 };
+    double Declinations[Count]    = { 38.7856944, 45.9979139, 11.9672222, -17.9866320 };
+    TelescopeDirectionVector Directions[Count];
+    bool Succeeded[Count];
+    ASSERT_TRUE(s.TransformCelestialToTelescopeBatch(RightAscensions, Declinations, Count, 0.0, Directions, Succeeded));
+
+    double RoundTripRightAscensions[Count], RoundTripDeclinations[Count];
+    ASSERT_TRUE(s.TransformTelescopeToCelestialBatch(Directions, Count, RoundTripRightAscensions,
+                RoundTripDeclinations, nullptr));
+
+    for (size_t i = 0; i < Count; i++)
+    {
+        ASSERT_TRUE(Succeeded[i]);
+
+        TelescopeDirectionVector Direction;
+        ASSERT_TRUE(s.TransformCelestialToTelescope(RightAscensions[i], Declinations[i], 0.0, Direction));
+        ASSERT_DOUBLE_EQ(Direction.x, Directions[i].x);
+        ASSERT_DOUBLE_EQ(Direction.y, Directions[i].y);
+        ASSERT_DOUBLE_EQ(Direction.z, Directions[i].z);
+
+        double RightAscension, Declination;
+        ASSERT_TRUE(s.TransformTelescopeToCelestial(Directions[i], RightAscension, Declination));
+        ASSERT_DOUBLE_EQ(RightAscension, RoundTripRightAscensions[i]);
+        ASSERT_DOUBLE_EQ(Declination, RoundTripDeclinations[i]);
+    }
+}
+
 int main(int argc, char **argv)
 {
     INDI::Logger::getInstance().configure("", INDI::Logger::file_off,
@@ -0,0 +1,620 @@
+/*******************************************************************************
+ Benchmark of the stages a CCD frame goes through once the exposure is complete.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+
+ The frame is synthetic, a noisy sky background with stars, and its geometry is set on the
+ command line before the Google Benchmark options:
+
+    bench_ccd_pipeline --width=4656 --height=3520 --bpp=16 --bin=2 --bayer
+                       --benchmark_out=hub.json --benchmark_out_format=json
+
+ Every stage reports its own time and throughput, BM_Pipeline runs them in the order of
+ CCD::uploadExposure() and adds the time of each stage in milliseconds as counters.
+*******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include "fitskeyword.h"
+#include "fpack.h"
+#include "indiccdchip.h"
+#include "indidevapi.h"
+#include "indiuserio.h"
+#include "sharedblob.h"
+#include "userio.h"
+#include "xisfwriter.h"
+
+#include <fitsio.h>
+#include <zlib.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FrameConfig
+{
+    uint32_t width {3008};
+    uint32_t height {2008};
+    int bpp {16};
+    int bin {2};
+    bool bayer {false};
+
+    uint32_t binnedWidth() const
+    {
+        return width / bin;
+    }
+    uint32_t binnedHeight() const
+    {
+        return height / bin;
+    }
+    size_t frameSize() const
+    {
+        return static_cast<size_t>(width) * height * (bpp / 8);
+    }
+    size_t binnedSize() const
+    {
+        return static_cast<size_t>(binnedWidth()) * binnedHeight() * (bpp / 8);
+    }
+};
+
+static FrameConfig config;
+
+// A sky background around a bias level with shot noise, and a few hundred stars
+static std::vector<uint8_t> syntheticFrame(const FrameConfig &frame)
+{
+    const double fullScale = std::ldexp(1.0, std::min(frame.bpp, 16)) - 1;
+    std::vector<double> pixels(static_cast<size_t>(frame.width) * frame.height);
+    uint32_t seed = 0x12345678;
+    auto uniform = [&seed]()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed / 4294967296.0;
+    };
+
+    for (double &pixel : pixels)
+        pixel = fullScale * (0.02 + 0.004 * (uniform() + uniform() + uniform() + uniform() - 2));
+
+    const int stars = std::max<int>(1, pixels.size() / 40000);
+    for (int i = 0; i < stars; i++)
+    {
+        double cx = uniform() * frame.width, cy = uniform() * frame.height;
+        double peak = fullScale * (0.05 + 0.9 * uniform() * uniform());
+        int x0 = std::max(0, static_cast<int>(cx) - 6), x1 = std::min<int>(frame.width - 1, cx + 6);
+        int y0 = std::max(0, static_cast<int>(cy) - 6), y1 = std::min<int>(frame.height - 1, cy + 6);
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                pixels[static_cast<size_t>(y) * frame.width + x] += peak * std::exp(-((x - cx) * (x - cx) + (y - cy) * (y - cy)) / 4.5);
+    }
+
+    std::vector<uint8_t> buffer(frame.frameSize());
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        double value = pixels[i];
+        // RGGB, green is the most sensitive
+        if (frame.bayer)
+        {
+            size_t x = i % frame.width, y = i / frame.width;
+            value *= ((x ^ y) & 1) ? 1.0 : ((y & 1) ? 0.6 : 0.75);
+        }
+        value = std::min(std::max(value, 0.0), fullScale);
+        switch (frame.bpp)
+        {
+            case 8:
+                buffer[i] = static_cast<uint8_t>(value);
+                break;
+            case 16:
+                reinterpret_cast<uint16_t *>(buffer.data())[i] = static_cast<uint16_t>(value);
+                break;
+            case 32:
+                reinterpret_cast<uint32_t *>(buffer.data())[i] = static_cast<uint32_t>(value) << 16;
+                break;
+        }
+    }
+    return buffer;
+}
+
+static const std::vector<uint8_t> &rawFrame()
+{
+    static std::vector<uint8_t> frame = syntheticFrame(config);
+    return frame;
+}
+
+// CCDChip publishes its settings as it is configured, nobody listens here
+class QuietStdout
+{
+    public:
+        QuietStdout()
+        {
+            fflush(stdout);
+            m_Saved = dup(STDOUT_FILENO);
+            int null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+            close(null);
+        }
+        ~QuietStdout()
+        {
+            fflush(stdout);
+            dup2(m_Saved, STDOUT_FILENO);
+            close(m_Saved);
+        }
+
+    private:
+        int m_Saved;
+};
+
+static void setupChip(INDI::CCDChip &chip)
+{
+    QuietStdout quiet;
+    chip.setResolution(config.width, config.height);
+    chip.setFrame(0, 0, config.width, config.height);
+    chip.setBPP(config.bpp);
+    chip.setBin(config.bin, config.bin);
+    chip.setFrameBufferSize(config.frameSize());
+}
+
+static void binChip(INDI::CCDChip &chip)
+{
+    if (config.bayer)
+        chip.binBayerFrame();
+    else
+        chip.binFrame();
+}
+
+// The binned frame the later stages work on
+static const std::vector<uint8_t> &binnedFrame()
+{
+    static std::vector<uint8_t> frame = []()
+    {
+        if (config.bin == 1)
+            return rawFrame();
+        INDI::CCDChip chip;
+        setupChip(chip);
+        memcpy(chip.getFrameBuffer(), rawFrame().data(), config.frameSize());
+        binChip(chip);
+        return std::vector<uint8_t>(chip.getFrameBuffer(), chip.getFrameBuffer() + config.binnedSize());
+    }();
+    return frame;
+}
+
+// What CCD::addFITSKeywords() writes for a typical setup
+static std::vector<INDI::FITSRecord> fitsKeywords()
+{
+    std::vector<INDI::FITSRecord> keywords;
+    keywords.push_back({"ROWORDER", "TOP-DOWN", "Row Order"});
+    keywords.push_back({"INSTRUME", "CCD Simulator", "Camera Name"});
+    keywords.push_back({"TELESCOP", "Telescope Simulator", "Telescope name"});
+    keywords.push_back({"OBSERVER", "Unknown", "Observer name"});
+    keywords.push_back({"OBJECT", "M42", "Object name"});
+    keywords.push_back({"EXPTIME", 120.0, 6, "Total Exposure Time (s)"});
+    keywords.push_back({"DARKTIME", 120.0, 6, "Total Dark Exposure Time (s)"});
+    keywords.push_back({"CCD-TEMP", -10.0, 3, "CCD Temperature (Celsius)"});
+    keywords.push_back({"PIXSIZE1", 3.76, 6, "Pixel Size 1 (microns)"});
+    keywords.push_back({"PIXSIZE2", 3.76, 6, "Pixel Size 2 (microns)"});
+    keywords.push_back({"XBINNING", static_cast<int64_t>(config.bin), "Binning factor in width"});
+    keywords.push_back({"YBINNING", static_cast<int64_t>(config.bin), "Binning factor in height"});
+    keywords.push_back({"XPIXSZ", 3.76 * config.bin, 6, "X binned pixel size in microns"});
+    keywords.push_back({"YPIXSZ", 3.76 * config.bin, 6, "Y binned pixel size in microns"});
+    keywords.push_back({"FRAME", "Light", "Frame Type"});
+    keywords.push_back({"IMAGETYP", "Light Frame", "Frame Type"});
+    keywords.push_back({"FILTER", "Ha", "Filter"});
+    keywords.push_back({"FOCALLEN", 400.0, 2, "Focal Length (mm)"});
+    keywords.push_back({"APTDIA", 80.0, 2, "Telescope diameter (mm)"});
+    keywords.push_back({"SCALE", 1.94, 6, "arcsecs per pixel"});
+    keywords.push_back({"SITELAT", 48.8566, 6, "Latitude of the imaging site in degrees"});
+    keywords.push_back({"SITELONG", 2.3522, 6, "Longitude of the imaging site in degrees"});
+    keywords.push_back({"AIRMASS", 1.2, 6, "Airmass"});
+    keywords.push_back({"OBJCTRA", "05 35 17.30", "Object J2000 RA in Hours"});
+    keywords.push_back({"OBJCTDEC", "-05 23 28.00", "Object J2000 DEC in Degrees"});
+    keywords.push_back({"RA", 83.82, 6, "Object J2000 RA in Degrees"});
+    keywords.push_back({"DEC", -5.39, 6, "Object J2000 DEC in Degrees"});
+    keywords.push_back({"EQUINOX", static_cast<int64_t>(2000), "Equinox"});
+    keywords.push_back({"DATE-OBS", "2024-01-01T00:00:00.000", "UTC start date of observation"});
+    keywords.push_back({"FOCUSPOS", static_cast<int64_t>(32000), "Focuser position in steps"});
+    if (config.bayer)
+    {
+        keywords.push_back({"XBAYROFF", static_cast<int64_t>(0), "X offset of Bayer array"});
+        keywords.push_back({"YBAYROFF", static_cast<int64_t>(0), "Y offset of Bayer array"});
+        keywords.push_back({"BAYERPAT", "RGGB", "Bayer color pattern"});
+    }
+    keywords.push_back(INDI::FITSRecord("Generated by INDI"));
+    return keywords;
+}
+
+// Write the binned frame as FITS the way CCD::uploadExposure() does, into a buffer from IDSharedBlobAlloc
+static bool writeFITS(const uint8_t *frame, void **data, size_t *size)
+{
+    int img_type = USHORT_IMG, byte_type = TUSHORT;
+    if (config.bpp == 8)
+    {
+        img_type = BYTE_IMG;
+        byte_type = TBYTE;
+    }
+    else if (config.bpp == 32)
+    {
+        img_type = ULONG_IMG;
+        byte_type = TULONG;
+    }
+
+    long naxes[2] = { static_cast<long>(config.binnedWidth()), static_cast<long>(config.binnedHeight()) };
+    long nelements = naxes[0] * naxes[1];
+
+    int status = 0;
+    *size = 8640 + config.binnedSize();
+    *data = IDSharedBlobAlloc(*size);
+    fitsfile *fptr = nullptr;
+    fits_create_memfile(&fptr, data, size, 2880, IDSharedBlobRealloc, &status);
+    fits_create_img(fptr, img_type, 2, naxes, &status);
+    for (auto &keyword : fitsKeywords())
+    {
+        switch (keyword.type())
+        {
+            case INDI::FITSRecord::VOID:
+                break;
+            case INDI::FITSRecord::COMMENT:
+                fits_write_comment(fptr, keyword.comment().c_str(), &status);
+                break;
+            case INDI::FITSRecord::STRING:
+                fits_update_key_str(fptr, keyword.key().c_str(), keyword.valueString().c_str(), keyword.comment().c_str(), &status);
+                break;
+            case INDI::FITSRecord::LONGLONG:
+                fits_update_key_lng(fptr, keyword.key().c_str(), keyword.valueInt(), keyword.comment().c_str(), &status);
+                break;
+            case INDI::FITSRecord::DOUBLE:
+                fits_update_key_dbl(fptr, keyword.key().c_str(), keyword.valueDouble(), keyword.decimal(),
+                                    keyword.comment().c_str(), &status);
+                break;
+        }
+    }
+    fits_write_img(fptr, byte_type, 1, nelements, const_cast<uint8_t *>(frame), &status);
+    fits_flush_file(fptr, &status);
+    fits_close_file(fptr, &status);
+    if (status)
+    {
+        IDSharedBlobFree(*data);
+        *data = nullptr;
+    }
+    return status == 0;
+}
+
+static const std::vector<uint8_t> &fitsFile()
+{
+    static std::vector<uint8_t> file = []()
+    {
+        void *data = nullptr;
+        size_t size = 0;
+        std::vector<uint8_t> copy;
+        if (writeFITS(binnedFrame().data(), &data, &size))
+        {
+            copy.assign(static_cast<uint8_t *>(data), static_cast<uint8_t *>(data) + size);
+            IDSharedBlobFree(data);
+        }
+        return copy;
+    }();
+    return file;
+}
+
+static bool fpackFITS(const void *file, size_t size, int threads, unsigned char **packed, size_t *packedSize)
+{
+    fpstate fpvar;
+    fp_init(&fpvar);
+    *packed = nullptr;
+    *packedSize = 0;
+    int islossless = 0;
+    int rc = 1;
+    if (threads > 1)
+        rc = fp_pack_data_to_data_threaded(static_cast<const char *>(file), size, packed, packedSize,
+                                           IDSharedBlobRealloc, fpvar, threads - 1);
+    if (rc == 1)
+        rc = fp_pack_data_to_data_realloc(static_cast<const char *>(file), size, packed, packedSize,
+                                          IDSharedBlobRealloc, fpvar, &islossless);
+    return rc >= 0;
+}
+
+// The client end of the upload, counting what IDSetBLOB would write
+static ssize_t countWrite(void *user, const void *, size_t count)
+{
+    *static_cast<size_t *>(user) += count;
+    return count;
+}
+
+static int countPrintf(void *user, const char *format, va_list arg)
+{
+    char buffer[4096];
+    int len = vsnprintf(buffer, sizeof(buffer), format, arg);
+    *static_cast<size_t *>(user) += len;
+    return len;
+}
+
+static const userio nullSink = { countWrite, countPrintf, nullptr };
+
+static void setBLOB(size_t *written, const IBLOBVectorProperty *bvp, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    userio_xmlv1(&nullSink, written);
+    IUUserIOSetBLOBVA(&nullSink, written, bvp, fmt, ap);
+    va_end(ap);
+}
+
+static size_t uploadBLOB(const void *data, size_t size, const char *format)
+{
+    IBLOB blob;
+    IBLOBVectorProperty bvp;
+    IUFillBLOB(&blob, "CCD1", "Image", format);
+    IUFillBLOBVector(&bvp, &blob, 1, "CCD Simulator", "CCD1", "Image Data", "Image Info", IP_RO, 60, IPS_OK);
+    blob.blob = const_cast<void *>(data);
+    blob.bloblen = size;
+    blob.size = size;
+    size_t written = 0;
+    setBLOB(&written, &bvp, nullptr);
+    return written;
+}
+
+static void BM_BinFrame(benchmark::State &state)
+{
+    INDI::CCDChip chip;
+    setupChip(chip);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        memcpy(chip.getFrameBuffer(), rawFrame().data(), config.frameSize());
+        state.ResumeTiming();
+        binChip(chip);
+    }
+    state.SetBytesProcessed(state.iterations() * config.frameSize());
+}
+
+static void BM_Statistics(benchmark::State &state)
+{
+    INDI::ImageStatistics stats;
+    for (auto _ : state)
+    {
+        if (!INDI::computeImageStatistics(binnedFrame().data(), config.binnedWidth(), config.binnedHeight(), config.bpp, stats))
+        {
+            state.SkipWithError("computeImageStatistics failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * config.binnedSize());
+}
+
+static void BM_FITSMemfile(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        void *data = nullptr;
+        size_t size = 0;
+        if (!writeFITS(binnedFrame().data(), &data, &size))
+        {
+            state.SkipWithError("FITS error");
+            break;
+        }
+        IDSharedBlobFree(data);
+    }
+    state.SetBytesProcessed(state.iterations() * config.binnedSize());
+}
+
+static void BM_Fpack(benchmark::State &state)
+{
+    int threads = state.range(0);
+    size_t packedSize = 0;
+    for (auto _ : state)
+    {
+        unsigned char *packed = nullptr;
+        bool ok = fpackFITS(fitsFile().data(), fitsFile().size(), threads, &packed, &packedSize);
+        IDSharedBlobFree(packed);
+        if (!ok)
+        {
+            state.SkipWithError("fpack failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * fitsFile().size());
+    state.counters["ratio"] = packedSize ? static_cast<double>(fitsFile().size()) / packedSize : 0;
+}
+
+static void BM_Zlib(benchmark::State &state)
+{
+    int level = state.range(0);
+    const std::vector<uint8_t> &frame = binnedFrame();
+    std::vector<Bytef> compressed(compressBound(frame.size()));
+    uLongf compressedSize = 0;
+    for (auto _ : state)
+    {
+        compressedSize = compressed.size();
+        if (compress2(compressed.data(), &compressedSize, frame.data(), frame.size(), level) != Z_OK)
+        {
+            state.SkipWithError("compress2 failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * frame.size());
+    state.counters["ratio"] = compressedSize ? static_cast<double>(frame.size()) / compressedSize : 0;
+}
+
+static void BM_XISF(benchmark::State &state)
+{
+    auto codec = static_cast<INDI::XISFImageWriter::Codec>(state.range(0));
+    if (!INDI::XISFImageWriter::codecSupported(codec))
+    {
+        state.SkipWithError("codec not supported by this build");
+        return;
+    }
+    INDI::XISFImageWriter xisf(config.binnedWidth(), config.binnedHeight(), 1, config.bpp);
+    xisf.setFITSKeywords(fitsKeywords());
+    xisf.setImageType("Light");
+    if (config.bayer)
+        xisf.setColorFilterArray("RGGB", 2, 2);
+    if (codec != INDI::XISFImageWriter::CODEC_NONE)
+        xisf.setCompression(codec, 1, state.range(1));
+
+    size_t size = 0;
+    for (auto _ : state)
+    {
+        void *data = nullptr;
+        if (!xisf.write(binnedFrame().data(), &data, &size))
+        {
+            state.SkipWithError(xisf.errorMessage().c_str());
+            break;
+        }
+        IDSharedBlobFree(data);
+    }
+    state.SetBytesProcessed(state.iterations() * config.binnedSize());
+    state.counters["ratio"] = size ? static_cast<double>(config.binnedSize()) / size : 0;
+}
+
+static void BM_Upload(benchmark::State &state)
+{
+    const std::vector<uint8_t> &file = fitsFile();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(uploadBLOB(file.data(), file.size(), ".fits"));
+    state.SetBytesProcessed(state.iterations() * file.size());
+}
+
+// Exposure complete to BLOB sent, with fpack compression as most clients ask for
+static void BM_Pipeline(benchmark::State &state)
+{
+    int threads = state.range(0);
+    INDI::CCDChip chip;
+    setupChip(chip);
+    double bin = 0, stats = 0, fits = 0, pack = 0, upload = 0;
+    auto elapsed = [](std::chrono::steady_clock::time_point & start)
+    {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+        return ms;
+    };
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        memcpy(chip.getFrameBuffer(), rawFrame().data(), config.frameSize());
+        state.ResumeTiming();
+
+        auto start = std::chrono::steady_clock::now();
+        binChip(chip);
+        bin += elapsed(start);
+
+        INDI::ImageStatistics imageStats;
+        INDI::computeImageStatistics(chip.getFrameBuffer(), config.binnedWidth(), config.binnedHeight(), config.bpp, imageStats);
+        stats += elapsed(start);
+
+        void *data = nullptr;
+        size_t size = 0;
+        if (!writeFITS(chip.getFrameBuffer(), &data, &size))
+        {
+            state.SkipWithError("FITS error");
+            break;
+        }
+        fits += elapsed(start);
+
+        unsigned char *packed = nullptr;
+        size_t packedSize = 0;
+        fpackFITS(data, size, threads, &packed, &packedSize);
+        IDSharedBlobFree(data);
+        pack += elapsed(start);
+
+        benchmark::DoNotOptimize(uploadBLOB(packed, packedSize, ".fits.fz"));
+        IDSharedBlobFree(packed);
+        upload += elapsed(start);
+    }
+
+    double n = state.iterations();
+    state.counters["bin_ms"] = bin / n;
+    state.counters["stats_ms"] = stats / n;
+    state.counters["fits_ms"] = fits / n;
+    state.counters["fpack_ms"] = pack / n;
+    state.counters["upload_ms"] = upload / n;
+    state.counters["fps"] = benchmark::Counter(n, benchmark::Counter::kIsRate);
+    state.SetBytesProcessed(state.iterations() * config.frameSize());
+}
+
+static bool parseOption(const char *arg, const char *name, std::string &value)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) || arg[len] != '=')
+        return false;
+    value = arg + len + 1;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    // Take the frame options out, the rest is for Google Benchmark
+    int kept = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string value;
+        if (parseOption(argv[i], "--width", value))
+            config.width = std::stoul(value);
+        else if (parseOption(argv[i], "--height", value))
+            config.height = std::stoul(value);
+        else if (parseOption(argv[i], "--bpp", value))
+            config.bpp = std::stoi(value);
+        else if (parseOption(argv[i], "--bin", value))
+            config.bin = std::stoi(value);
+        else if (!strcmp(argv[i], "--bayer"))
+            config.bayer = true;
+        else
+            argv[kept++] = argv[i];
+    }
+    argc = kept;
+
+    if ((config.bpp != 8 && config.bpp != 16 && config.bpp != 32) || config.bin < 1 || config.width < 2u * config.bin ||
+            config.height < 2u * config.bin || (config.bayer && config.bin != 1 && config.bin != 2))
+    {
+        fprintf(stderr, "Unsupported frame: %ux%u %d bits binned %d%s\n", config.width, config.height, config.bpp, config.bin,
+                config.bayer ? " bayer (binning 1 or 2)" : "");
+        return 1;
+    }
+
+    benchmark::AddCustomContext("frame", std::to_string(config.width) + "x" + std::to_string(config.height) + " " +
+                                std::to_string(config.bpp) + " bits" + (config.bayer ? " RGGB" : "") +
+                                " bin " + std::to_string(config.bin));
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    benchmark::RegisterBenchmark("BM_BinFrame", BM_BinFrame)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_Statistics", BM_Statistics)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_FITSMemfile", BM_FITSMemfile)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_Fpack", BM_Fpack)->Arg(1)->Arg(cores)->Unit(benchmark::kMillisecond)->UseRealTime();
+    benchmark::RegisterBenchmark("BM_Zlib", BM_Zlib)->Arg(1)->Arg(6)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_XISF", BM_XISF)
+    ->Args({INDI::XISFImageWriter::CODEC_NONE, 1})
+    ->Args({INDI::XISFImageWriter::CODEC_ZLIB, 1})
+    ->Args({INDI::XISFImageWriter::CODEC_ZLIB, static_cast<int64_t>(cores)})
+    ->Args({INDI::XISFImageWriter::CODEC_LZ4, 1})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+    benchmark::RegisterBenchmark("BM_Upload", BM_Upload)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_Pipeline", BM_Pipeline)->Arg(1)->Arg(cores)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,302 @@
+/*******************************************************************************
+ Micro-benchmarks of the indicore functions on the path of every INDI message.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+
+ To compare two builds, save the results of each one as JSON:
+
+    bench_indicore --benchmark_out=before.json --benchmark_out_format=json
+    bench_indicore --benchmark_out=after.json --benchmark_out_format=json
+
+ and diff them with tools/compare.py of Google Benchmark:
+
+    compare.py benchmarks before.json after.json
+*******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include "base64.h"
+#include "indidevapi.h"
+#include "indidriver.h"
+#include "indiuserio.h"
+#include "lilxml.h"
+#include "sharedblob.h"
+#include "userio.h"
+
+#include <cstdarg>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Traffic of a mount and a camera, as indiserver relays it
+static const char *setNumberXML =
+    "<setNumberVector device=\"Telescope Simulator\" name=\"EQUATORIAL_EOD_COORD\" state=\"Busy\" timeout=\"60\" "
+    "timestamp=\"2024-01-01T00:00:00\">\n"
+    "    <oneNumber name=\"RA\">\n      5.5913672222222224308\n    </oneNumber>\n"
+    "    <oneNumber name=\"DEC\">\n      -5.3911111111111111782\n    </oneNumber>\n"
+    "</setNumberVector>\n";
+
+static const char *defSwitchXML =
+    "<defSwitchVector device=\"CCD Simulator\" name=\"CCD_FRAME_TYPE\" label=\"Type\" group=\"Image Settings\" "
+    "state=\"Idle\" perm=\"rw\" rule=\"OneOfMany\" timeout=\"60\" timestamp=\"2024-01-01T00:00:00\">\n"
+    "    <defSwitch name=\"FRAME_LIGHT\" label=\"Light\">\nOn\n    </defSwitch>\n"
+    "    <defSwitch name=\"FRAME_BIAS\" label=\"Bias\">\nOff\n    </defSwitch>\n"
+    "    <defSwitch name=\"FRAME_DARK\" label=\"Dark\">\nOff\n    </defSwitch>\n"
+    "    <defSwitch name=\"FRAME_FLAT\" label=\"Flat\">\nOff\n    </defSwitch>\n"
+    "</defSwitchVector>\n";
+
+static std::string base64Of(size_t size)
+{
+    std::vector<unsigned char> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = static_cast<unsigned char>(i * 31 + 7);
+    std::string encoded(4 * ((size + 2) / 3) + 1, '\0');
+    int len = to64frombits_s(reinterpret_cast<unsigned char *>(&encoded[0]), data.data(), size, encoded.size());
+    encoded.resize(len);
+    return encoded;
+}
+
+static std::string setBLOBXML(size_t size)
+{
+    std::string encoded = base64Of(size);
+    return "<setBLOBVector device=\"CCD Simulator\" name=\"CCD1\" state=\"Ok\" timestamp=\"2024-01-01T00:00:00\">\n"
+           "    <oneBLOB name=\"CCD1\" size=\"" + std::to_string(size) + "\" enclen=\"" + std::to_string(encoded.size()) +
+           "\" format=\".fits\">\n" + encoded + "\n    </oneBLOB>\n</setBLOBVector>\n";
+}
+
+// Parse a whole message per iteration, the way indiserver and the clients read their sockets
+static void parseMessages(benchmark::State &state, const std::string &xml)
+{
+    LilXML *lp = newLilXML();
+    std::vector<char> buffer(xml.begin(), xml.end());
+    char errmsg[1024];
+    for (auto _ : state)
+    {
+        std::vector<char> chunk(buffer);
+        XMLEle **nodes = parseXMLChunk(lp, chunk.data(), chunk.size(), errmsg);
+        if (nodes == nullptr)
+        {
+            state.SkipWithError(errmsg);
+            break;
+        }
+        for (int i = 0; nodes[i] != nullptr; i++)
+            delXMLEle(nodes[i]);
+        free(nodes);
+    }
+    delLilXML(lp);
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+
+static void BM_ParseSetNumber(benchmark::State &state)
+{
+    parseMessages(state, setNumberXML);
+}
+BENCHMARK(BM_ParseSetNumber);
+
+static void BM_ParseDefSwitch(benchmark::State &state)
+{
+    parseMessages(state, defSwitchXML);
+}
+BENCHMARK(BM_ParseDefSwitch);
+
+static void BM_ParseSetBLOB(benchmark::State &state)
+{
+    parseMessages(state, setBLOBXML(state.range(0)));
+}
+BENCHMARK(BM_ParseSetBLOB)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+// The per character entry point of the older drivers and clients
+static void BM_ReadXMLEle(benchmark::State &state)
+{
+    LilXML *lp = newLilXML();
+    std::string xml = setNumberXML;
+    char errmsg[1024];
+    for (auto _ : state)
+    {
+        for (char c : xml)
+        {
+            XMLEle *root = readXMLEle(lp, c, errmsg);
+            if (root != nullptr)
+                delXMLEle(root);
+        }
+    }
+    delLilXML(lp);
+    state.SetBytesProcessed(state.iterations() * xml.size());
+}
+BENCHMARK(BM_ReadXMLEle);
+
+static XMLEle *parseOne(const char *xml)
+{
+    LilXML *lp = newLilXML();
+    char errmsg[1024];
+    XMLEle *root = nullptr;
+    for (const char *c = xml; *c && root == nullptr; c++)
+        root = readXMLEle(lp, *c, errmsg);
+    delLilXML(lp);
+    return root;
+}
+
+static void BM_SprXMLEle(benchmark::State &state)
+{
+    XMLEle *root = parseOne(defSwitchXML);
+    std::vector<char> output(sprlXMLEle(root, 0) + 1);
+    for (auto _ : state)
+    {
+        int len = sprXMLEle(output.data(), root, 0);
+        benchmark::DoNotOptimize(len);
+    }
+    state.SetBytesProcessed(state.iterations() * (output.size() - 1));
+    delXMLEle(root);
+}
+BENCHMARK(BM_SprXMLEle);
+
+static void BM_Base64Encode(benchmark::State &state)
+{
+    size_t size = state.range(0);
+    std::vector<unsigned char> data(size, 0x5a);
+    std::vector<unsigned char> encoded(4 * ((size + 2) / 3) + 1);
+    for (auto _ : state)
+    {
+        int len = to64frombits_s(encoded.data(), data.data(), size, encoded.size());
+        benchmark::DoNotOptimize(len);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_Base64Encode)->Arg(64)->Arg(1 << 12)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 24);
+
+static void BM_Base64Decode(benchmark::State &state)
+{
+    size_t size = state.range(0);
+    std::string encoded = base64Of(size);
+    std::vector<char> decoded(size + 3);
+    for (auto _ : state)
+    {
+        int len = from64tobits_fast(decoded.data(), encoded.data(), encoded.size());
+        benchmark::DoNotOptimize(len);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_Base64Decode)->Arg(64)->Arg(1 << 12)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 24);
+
+// One frame buffer per exposure, as the CCD drivers do
+static void BM_SharedBlobCycle(benchmark::State &state)
+{
+    size_t size = state.range(0);
+    for (auto _ : state)
+    {
+        void *buffer = IDSharedBlobAlloc(size);
+        if (buffer == nullptr)
+        {
+            state.SkipWithError("IDSharedBlobAlloc failed");
+            break;
+        }
+        // Touch the first page so the mapping is really made
+        static_cast<char *>(buffer)[0] = 1;
+        IDSharedBlobFree(buffer);
+    }
+}
+BENCHMARK(BM_SharedBlobCycle)->Arg(1 << 12)->Arg(1 << 20)->Arg(1 << 25);
+
+struct NumberVector
+{
+    explicit NumberVector(int count) : numbers(count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            names.push_back("ELEMENT_" + std::to_string(i));
+            IUFillNumber(&numbers[i], names[i].c_str(), names[i].c_str(), "%g", -1e9, 1e9, 0, 0);
+        }
+        IUFillNumberVector(&vector, numbers.data(), count, "Bench", "VECTOR", "Vector", "Main", IP_RW, 60, IPS_IDLE);
+    }
+
+    std::vector<std::string> names;
+    std::vector<INumber> numbers;
+    INumberVectorProperty vector;
+};
+
+static void BM_IUFindNumber(benchmark::State &state)
+{
+    NumberVector nv(state.range(0));
+    // The last element is the one searched the longest
+    const char *name = nv.names.back().c_str();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(IUFindNumber(&nv.vector, name));
+}
+BENCHMARK(BM_IUFindNumber)->Arg(2)->Arg(8)->Arg(32);
+
+static void BM_IUUpdateNumber(benchmark::State &state)
+{
+    int count = state.range(0);
+    NumberVector nv(count);
+    std::vector<double> values(count, 1.5);
+    std::vector<char *> names;
+    for (auto &name : nv.names)
+        names.push_back(const_cast<char *>(name.c_str()));
+    for (auto _ : state)
+    {
+        if (IUUpdateNumber(&nv.vector, values.data(), names.data(), count) != 0)
+        {
+            state.SkipWithError("IUUpdateNumber failed");
+            break;
+        }
+    }
+}
+BENCHMARK(BM_IUUpdateNumber)->Arg(2)->Arg(8)->Arg(32);
+
+// Sink counting what IDSetNumber would write to stdout
+static ssize_t countWrite(void *user, const void *, size_t count)
+{
+    *static_cast<size_t *>(user) += count;
+    return count;
+}
+
+static int countPrintf(void *user, const char *format, va_list arg)
+{
+    char buffer[4096];
+    int len = vsnprintf(buffer, sizeof(buffer), format, arg);
+    *static_cast<size_t *>(user) += len;
+    return len;
+}
+
+static const userio countIO = { countWrite, countPrintf, nullptr };
+
+static void setNumber(size_t *written, const INumberVectorProperty *nvp, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    userio_xmlv1(&countIO, written);
+    IUUserIOSetNumberVA(&countIO, written, nvp, fmt, ap);
+    va_end(ap);
+}
+
+static void BM_IDSetNumberFormat(benchmark::State &state)
+{
+    NumberVector nv(state.range(0));
+    size_t written = 0;
+    for (auto _ : state)
+        setNumber(&written, &nv.vector, nullptr);
+    state.SetBytesProcessed(written);
+}
+BENCHMARK(BM_IDSetNumberFormat)->Arg(2)->Arg(8)->Arg(32);
+
+static void BM_IDSetNumberFormatMessage(benchmark::State &state)
+{
+    NumberVector nv(2);
+    size_t written = 0;
+    for (auto _ : state)
+        setNumber(&written, &nv.vector, "Slewing to RA %s DEC %s", "05:35:29", "-05:23:28");
+    state.SetBytesProcessed(written);
+}
+BENCHMARK(BM_IDSetNumberFormatMessage);
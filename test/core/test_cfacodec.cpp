@@ -0,0 +1,112 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "cfacodec.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+// A smooth sky seen through an RGGB filter: each channel has its own level, plus some noise
+template <typename T>
+static std::vector<T> bayerFrame(uint32_t width, uint32_t height, int noise)
+{
+    static const int levels[2][2] = {{1200, 3000}, {3100, 800}};
+    std::vector<T> frame(size_t(width) * height);
+    for (uint32_t y = 0; y < height; y++)
+        for (uint32_t x = 0; x < width; x++)
+        {
+            int value = levels[y % 2][x % 2] * (sizeof(T) == 1 ? 1 : 4) / (sizeof(T) == 1 ? 16 : 1) + (x + y) / 8;
+            value += rand() % (noise + 1);
+            frame[size_t(y) * width + x] = static_cast<T>(value);
+        }
+    return frame;
+}
+
+template <typename T>
+static size_t roundTrip(const std::vector<T> &frame, uint32_t width, uint32_t height, bool bayer)
+{
+    const int bpp = sizeof(T) * 8;
+    std::vector<uint8_t> compressed(INDI::CFACodec::compressBound(width, height, bpp));
+    size_t size = INDI::CFACodec::compress(frame.data(), width, height, bpp, bayer, compressed.data(), compressed.size());
+    EXPECT_GT(size, 0u);
+
+    EXPECT_EQ(INDI::CFACodec::decodedSize(compressed.data(), size), frame.size() * sizeof(T));
+    std::vector<T> decoded(frame.size());
+    EXPECT_TRUE(INDI::CFACodec::decompress(compressed.data(), size, decoded.data(), decoded.size() * sizeof(T)));
+    EXPECT_EQ(decoded, frame);
+    return size;
+}
+
+TEST(CORE_CFACODEC, Test_roundTrip)
+{
+    srand(1);
+    // Odd sizes leave partial blocks and planes of unequal sizes
+    for (uint32_t width : {1, 2, 3, 31, 64, 101})
+        for (uint32_t height : {1, 2, 5, 40})
+        {
+            roundTrip(bayerFrame<uint16_t>(width, height, 30), width, height, true);
+            roundTrip(bayerFrame<uint8_t>(width, height, 4), width, height, true);
+            roundTrip(bayerFrame<uint16_t>(width, height, 30), width, height, false);
+        }
+}
+
+TEST(CORE_CFACODEC, Test_extremes)
+{
+    // Full scale jumps escape the Rice coding
+    srand(2);
+    std::vector<uint16_t> frame(64 * 16);
+    for (auto &pixel : frame)
+        pixel = static_cast<uint16_t>(rand() & 1 ? 0xFFFF : rand());
+    roundTrip(frame, 64, 16, true);
+
+    std::vector<uint8_t> bytes(33 * 7);
+    for (size_t i = 0; i < bytes.size(); i++)
+        bytes[i] = i % 3 ? 0 : 255;
+    roundTrip(bytes, 33, 7, false);
+}
+
+TEST(CORE_CFACODEC, Test_planesCompressBetter)
+{
+    // Predicting across colours pays the channel differences at every pixel
+    srand(3);
+    auto frame = bayerFrame<uint16_t>(256, 128, 15);
+    size_t planes = roundTrip(frame, 256, 128, true);
+    size_t mono = roundTrip(frame, 256, 128, false);
+    EXPECT_LT(planes * 2, mono);
+    EXPECT_LT(planes * 2, frame.size() * sizeof(uint16_t));
+}
+
+TEST(CORE_CFACODEC, Test_invalid)
+{
+    std::vector<uint16_t> frame(16 * 16, 100);
+    std::vector<uint8_t> compressed(INDI::CFACodec::compressBound(16, 16, 16));
+
+    // No 32 bits pixels, and the output must hold the frame
+    EXPECT_EQ(INDI::CFACodec::compress(frame.data(), 16, 16, 32, true, compressed.data(), compressed.size()), 0u);
+    EXPECT_EQ(INDI::CFACodec::compress(frame.data(), 16, 16, 16, true, compressed.data(), 20), 0u);
+
+    size_t size = INDI::CFACodec::compress(frame.data(), 16, 16, 16, true, compressed.data(), compressed.size());
+    ASSERT_GT(size, 0u);
+
+    std::vector<uint16_t> decoded(frame.size());
+    EXPECT_FALSE(INDI::CFACodec::decompress(compressed.data(), size, decoded.data(), 10));
+    EXPECT_FALSE(INDI::CFACodec::decompress(compressed.data(), size / 2, decoded.data(), decoded.size() * 2));
+
+    compressed[0] = 'X';
+    EXPECT_EQ(INDI::CFACodec::decodedSize(compressed.data(), size), 0u);
+}
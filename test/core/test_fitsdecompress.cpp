@@ -0,0 +1,318 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fitsdecompress.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+namespace
+{
+
+// Rice coding as fits_rcomp does it, blocks of 32 pixels
+std::vector<uint8_t> riceEncode(const std::vector<int32_t> &pixels, int bytepix)
+{
+    int fsbits = bytepix == 1 ? 3 : bytepix == 2 ? 4 : 5;
+    int fsmax = bytepix == 1 ? 6 : bytepix == 2 ? 14 : 25;
+    int bbits = 8 * bytepix;
+    uint32_t mask = bbits == 32 ? 0xffffffffu : (1u << bbits) - 1;
+
+    std::vector<uint8_t> out;
+    uint64_t acc = 0;
+    int bits = 0;
+    auto put = [&](uint32_t value, int n)
+    {
+        for (int i = n - 1; i >= 0; i--)
+        {
+            acc = acc << 1 | ((value >> i) & 1);
+            if (++bits == 8)
+            {
+                out.push_back(static_cast<uint8_t>(acc));
+                acc = bits = 0;
+            }
+        }
+    };
+
+    uint32_t last = static_cast<uint32_t>(pixels[0]) & mask;
+    put(last, bbits);
+    for (size_t i = 0; i < pixels.size(); i += 32)
+    {
+        size_t n = std::min<size_t>(32, pixels.size() - i);
+        std::vector<uint32_t> mapped(n);
+        uint64_t sum = 0;
+        for (size_t j = 0; j < n; j++)
+        {
+            uint32_t value = static_cast<uint32_t>(pixels[i + j]) & mask;
+            int32_t diff = static_cast<int32_t>(((value - last) & mask) << (32 - bbits)) >> (32 - bbits);
+            mapped[j] = (diff < 0 ? ~(static_cast<uint32_t>(diff) << 1) : static_cast<uint32_t>(diff) << 1) & mask;
+            sum += mapped[j];
+            last = value;
+        }
+
+        int64_t mean = (int64_t(sum) - int64_t(n / 2) - 1) / int64_t(n);
+        uint64_t psum = mean < 0 ? 0 : uint64_t(mean) >> 1;
+        int fs = 0;
+        for (; psum > 0; psum >>= 1)
+            fs++;
+
+        if (fs >= fsmax)
+        {
+            put(fsmax + 1, fsbits);
+            for (uint32_t value : mapped)
+                put(value, bbits);
+        }
+        else if (fs == 0 && sum == 0)
+            put(0, fsbits);
+        else
+        {
+            put(fs + 1, fsbits);
+            for (uint32_t value : mapped)
+            {
+                for (uint32_t top = value >> fs; top > 0; top--)
+                    put(0, 1);
+                put(1, 1);
+                if (fs > 0)
+                    put(value & ((1u << fs) - 1), fs);
+            }
+        }
+    }
+    if (bits > 0)
+        put(0, 8 - bits);
+    return out;
+}
+
+std::string card(const std::string &key, const std::string &value)
+{
+    char text[81];
+    snprintf(text, sizeof(text), "%-8s= %20s", key.c_str(), value.c_str());
+    std::string result(text);
+    result.resize(80, ' ');
+    return result;
+}
+
+void putHeader(std::vector<uint8_t> &file, const std::vector<std::string> &cards)
+{
+    for (auto &c : cards)
+        file.insert(file.end(), c.begin(), c.end());
+    std::string end = "END";
+    end.resize(80, ' ');
+    file.insert(file.end(), end.begin(), end.end());
+    file.resize((file.size() + 2879) / 2880 * 2880, ' ');
+}
+
+void putBE(std::vector<uint8_t> &out, uint64_t value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--)
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+// A tile compressed file as fpack writes it, with tiles of tileW x tileH pixels
+std::vector<uint8_t> fpack(const std::vector<int32_t> &pixels, int width, int height, int bitpix, int tileW,
+                           int tileH, const std::string &codec)
+{
+    std::vector<std::vector<uint8_t>> tiles;
+    for (int y0 = 0; y0 < height; y0 += tileH)
+        for (int x0 = 0; x0 < width; x0 += tileW)
+        {
+            std::vector<int32_t> tile;
+            for (int y = y0; y < std::min(height, y0 + tileH); y++)
+                for (int x = x0; x < std::min(width, x0 + tileW); x++)
+                    tile.push_back(pixels[y * width + x]);
+
+            if (codec == "RICE_1")
+                tiles.push_back(riceEncode(tile, bitpix / 8));
+            else
+            {
+                std::vector<uint8_t> raw;
+                for (int32_t value : tile)
+                    putBE(raw, static_cast<uint32_t>(value), bitpix / 8);
+                uLongf size = compressBound(raw.size());
+                std::vector<uint8_t> packed(size);
+                compress2(packed.data(), &size, raw.data(), raw.size(), 6);
+                packed.resize(size);
+                tiles.push_back(packed);
+            }
+        }
+
+    std::vector<uint8_t> rows, heap;
+    for (auto &tile : tiles)
+    {
+        putBE(rows, tile.size(), 4);
+        putBE(rows, heap.size(), 4);
+        heap.insert(heap.end(), tile.begin(), tile.end());
+    }
+
+    std::vector<uint8_t> file;
+    putHeader(file, {card("SIMPLE", "T"), card("BITPIX", "8"), card("NAXIS", "0"), card("EXTEND", "T"),
+                     card("OBSERVER", "'Primary'")});
+    putHeader(file,
+    {
+        card("XTENSION", "'BINTABLE'"), card("BITPIX", "8"), card("NAXIS", "2"), card("NAXIS1", "8"),
+        card("NAXIS2", std::to_string(tiles.size())), card("PCOUNT", std::to_string(heap.size())),
+        card("GCOUNT", "1"), card("TFIELDS", "1"), card("TTYPE1", "'COMPRESSED_DATA'"), card("TFORM1", "'1PB(999)'"),
+        card("ZIMAGE", "T"), card("ZBITPIX", std::to_string(bitpix)), card("ZNAXIS", "2"),
+        card("ZNAXIS1", std::to_string(width)), card("ZNAXIS2", std::to_string(height)),
+        card("ZTILE1", std::to_string(tileW)), card("ZTILE2", std::to_string(tileH)),
+        card("ZCMPTYPE", "'" + codec + "'"), card("ZNAME1", "'BLOCKSIZE'"), card("ZVAL1", "32"),
+        card("ZNAME2", "'BYTEPIX'"), card("ZVAL2", std::to_string(bitpix / 8)),
+        card("BZERO", "32768"), card("EXPTIME", "1.5"), card("OBJECT", "'M 42'"), card("EXTNAME", "'COMPRESSED_IMAGE'")
+    });
+    size_t start = file.size();
+    file.insert(file.end(), rows.begin(), rows.end());
+    file.insert(file.end(), heap.begin(), heap.end());
+    file.resize(start + (rows.size() + heap.size() + 2879) / 2880 * 2880, 0);
+    return file;
+}
+
+std::vector<int32_t> image(int width, int height, int bitpix)
+{
+    std::vector<int32_t> pixels(width * height);
+    uint32_t seed = 12345;
+    for (int i = 0; i < width * height; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        int32_t noise = static_cast<int32_t>((seed >> 16) % 64);
+        // Flat rows, rows of random values for the high entropy blocks, then noise with a few jumps
+        int row = i / width;
+        uint32_t value = row < 3 ? 1000 : row < 5 ? seed : 1000 + noise + ((i % 97) == 0 ? 20000 : 0);
+        pixels[i] = bitpix == 8 ? value & 0xff : bitpix == 16 ? static_cast<int16_t>(value - 32768 + 500) :
+                    static_cast<int32_t>(value * 3);
+    }
+    return pixels;
+}
+
+std::string header(const std::vector<uint8_t> &fits)
+{
+    std::string text(reinterpret_cast<const char *>(fits.data()), 2880);
+    return text;
+}
+
+void expectPixels(const std::vector<uint8_t> &fits, const std::vector<int32_t> &pixels, int bitpix)
+{
+    std::string head = header(fits);
+    size_t end = head.find("END     ");
+    ASSERT_NE(end, std::string::npos);
+    size_t data = (end / 2880 + 1) * 2880;
+    int bytes = bitpix / 8;
+    ASSERT_GE(fits.size(), data + pixels.size() * bytes);
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        uint32_t value = 0;
+        for (int k = 0; k < bytes; k++)
+            value = value << 8 | fits[data + i * bytes + k];
+        uint32_t expected = static_cast<uint32_t>(pixels[i]) & (bytes == 4 ? 0xffffffffu : (1u << (8 * bytes)) - 1);
+        ASSERT_EQ(value, expected) << "pixel " << i;
+    }
+}
+
+}
+
+TEST(CORE_FITSDECOMPRESS, Test_riceRowTiles)
+{
+    const int width = 61, height = 37;
+    for (int bitpix : {8, 16, 32})
+    {
+        auto pixels = image(width, height, bitpix);
+        auto packed = fpack(pixels, width, height, bitpix, width, 1, "RICE_1");
+
+        size_t size = INDI::FitsDecompress::unpackedSize(packed.data(), packed.size());
+        ASSERT_GT(size, 0u) << bitpix;
+        EXPECT_EQ(size % 2880, 0u);
+        for (unsigned threads : {1u, 4u})
+        {
+            std::vector<uint8_t> fits(size);
+            ASSERT_TRUE(INDI::FitsDecompress::unpack(packed.data(), packed.size(), fits.data(), fits.size(), threads))
+                    << bitpix;
+            expectPixels(fits, pixels, bitpix);
+        }
+    }
+}
+
+TEST(CORE_FITSDECOMPRESS, Test_plainHeader)
+{
+    auto pixels = image(20, 10, 16);
+    auto packed = fpack(pixels, 20, 10, 16, 20, 1, "RICE_1");
+    std::vector<uint8_t> fits(INDI::FitsDecompress::unpackedSize(packed.data(), packed.size()));
+    ASSERT_TRUE(INDI::FitsDecompress::unpack(packed.data(), packed.size(), fits.data(), fits.size()));
+
+    std::string head = header(fits);
+    EXPECT_EQ(head.substr(0, 80), card("SIMPLE", "T"));
+    EXPECT_EQ(head.substr(80, 80), card("BITPIX", "16"));
+    EXPECT_EQ(head.substr(160, 80), card("NAXIS", "2"));
+    EXPECT_EQ(head.substr(240, 80), card("NAXIS1", "20"));
+    EXPECT_EQ(head.substr(320, 80), card("NAXIS2", "10"));
+    EXPECT_NE(head.find(card("BZERO", "32768")), std::string::npos);
+    EXPECT_NE(head.find(card("OBJECT", "'M 42'")), std::string::npos);
+    EXPECT_NE(head.find(card("OBSERVER", "'Primary'")), std::string::npos);
+    for (const char *key : {"XTENSION", "ZIMAGE", "ZCMPTYPE", "TFORM1", "ZTILE1", "PCOUNT", "EXTNAME"})
+        EXPECT_EQ(head.find(key), std::string::npos) << key;
+}
+
+TEST(CORE_FITSDECOMPRESS, Test_gzipSquareTiles)
+{
+    // Tiles not covering whole rows, with partial ones on the edges
+    const int width = 50, height = 45;
+    auto pixels = image(width, height, 16);
+    auto packed = fpack(pixels, width, height, 16, 16, 16, "GZIP_1");
+    std::vector<uint8_t> fits(INDI::FitsDecompress::unpackedSize(packed.data(), packed.size()));
+    ASSERT_FALSE(fits.empty());
+    ASSERT_TRUE(INDI::FitsDecompress::unpack(packed.data(), packed.size(), fits.data(), fits.size(), 3));
+    expectPixels(fits, pixels, 16);
+}
+
+TEST(CORE_FITSDECOMPRESS, Test_corruptedIsRejected)
+{
+    auto pixels = image(40, 20, 16);
+    auto packed = fpack(pixels, 40, 20, 16, 40, 1, "RICE_1");
+    std::vector<uint8_t> fits(INDI::FitsDecompress::unpackedSize(packed.data(), packed.size()));
+
+    // Too small a buffer
+    EXPECT_FALSE(INDI::FitsDecompress::unpack(packed.data(), packed.size(), fits.data(), fits.size() - 1));
+
+    // A tile pointing past the heap
+    auto broken = packed;
+    broken[2 * 2880 + 4] = 0x7f;
+    EXPECT_FALSE(INDI::FitsDecompress::unpack(broken.data(), broken.size(), fits.data(), fits.size()));
+
+    // A plain FITS file is not tile compressed
+    std::vector<uint8_t> plain;
+    putHeader(plain, {card("SIMPLE", "T"), card("BITPIX", "16"), card("NAXIS", "0")});
+    EXPECT_EQ(INDI::FitsDecompress::unpackedSize(plain.data(), plain.size()), 0u);
+    EXPECT_EQ(INDI::FitsDecompress::unpackedSize("garbage", 7), 0u);
+}
+
+TEST(CORE_FITSDECOMPRESS, Test_inflate)
+{
+    std::vector<uint8_t> data(100000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<uint8_t>(i / 7);
+    uLongf size = compressBound(data.size());
+    std::vector<uint8_t> packed(size);
+    ASSERT_EQ(compress2(packed.data(), &size, data.data(), data.size(), 6), Z_OK);
+
+    std::vector<uint8_t> out(data.size());
+    size_t bytes = 0;
+    ASSERT_TRUE(INDI::FitsDecompress::inflate(packed.data(), size, out.data(), out.size(), &bytes));
+    EXPECT_EQ(bytes, data.size());
+    EXPECT_EQ(out, data);
+    EXPECT_FALSE(INDI::FitsDecompress::inflate(packed.data(), size / 2, out.data(), out.size()));
+}
@@ -0,0 +1,70 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "indiutility.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+static void touch(const std::string &path)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    ASSERT_NE(fp, nullptr);
+    fclose(fp);
+}
+
+TEST(CORE_UTILITY, Test_nextFileIndex)
+{
+    char templ[] = "/tmp/indi_fileindex_XXXXXX";
+    ASSERT_NE(mkdtemp(templ), nullptr);
+    std::string dir = templ;
+
+    touch(dir + "/IMAGE_001.fits");
+    touch(dir + "/IMAGE_007.fits");
+    touch(dir + "/FLAT_042.fits");
+
+    EXPECT_EQ(INDI::nextFileIndex(dir, "IMAGE"), 8);
+    EXPECT_EQ(INDI::nextFileIndex(dir, "FLAT"), 43);
+    EXPECT_EQ(INDI::nextFileIndex(dir, "DARK"), 1);
+
+    // Later calls count up from the cache
+    touch(dir + "/IMAGE_008.fits");
+    EXPECT_EQ(INDI::nextFileIndex(dir, "IMAGE"), 9);
+    EXPECT_EQ(INDI::nextFileIndex(dir, "IMAGE"), 10);
+
+    // Files written meanwhile by another process are not overwritten
+    touch(dir + "/IMAGE_020.fits");
+    EXPECT_EQ(INDI::nextFileIndex(dir, "IMAGE"), 21);
+
+    // A replaced directory is scanned again
+    std::string moved = dir + ".old";
+    ASSERT_EQ(rename(dir.c_str(), moved.c_str()), 0);
+    ASSERT_EQ(INDI::mkpath(dir, 0755), 0);
+    touch(dir + "/IMAGE_003.fits");
+    EXPECT_EQ(INDI::nextFileIndex(dir, "IMAGE"), 4);
+
+    EXPECT_EQ(INDI::nextFileIndex(dir + "/missing", "IMAGE"), -1);
+
+    for (auto name : {"IMAGE_001.fits", "IMAGE_007.fits", "IMAGE_008.fits", "IMAGE_020.fits", "FLAT_042.fits"})
+        unlink((moved + "/" + name).c_str());
+    unlink((dir + "/IMAGE_003.fits").c_str());
+    rmdir(moved.c_str());
+    rmdir(dir.c_str());
+}
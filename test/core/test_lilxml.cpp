@@ -0,0 +1,558 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Developers. All rights reserved.
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "base64.h"
+#include "lilxml.h"
+#include "indililxml.h"
+
+static const char *defVector =
+    "<defNumberVector device='CCD' name='EXPOSURE' label='Expose' group='Main' state='Idle' perm='rw' timeout='60'>\n"
+    "  <defNumber name='EXPOSURE_VALUE' label='Duration (s)' format='%5.2f' min='0' max='3600' step='1'>\n"
+    "    1\n"
+    "  </defNumber>\n"
+    "  <defNumber name='EXPOSURE_DELAY' label='Delay (s)' format='%5.2f' min='0' max='60' step='1'>\n"
+    "    0\n"
+    "  </defNumber>\n"
+    "</defNumberVector>\n";
+
+static std::vector<XMLEle *> parseAll(LilXML *lp, const std::string &xml)
+{
+    std::vector<XMLEle *> result;
+    char ynot[1024];
+    XMLEle **nodes = parseXMLChunk(lp, const_cast<char *>(xml.data()), xml.size(), ynot);
+    EXPECT_NE(nodes, nullptr) << ynot;
+    for (int i = 0; nodes && nodes[i]; i++)
+        result.push_back(nodes[i]);
+    free(nodes);
+    return result;
+}
+
+static std::string print(XMLEle *root)
+{
+    std::string buf(sprlXMLEle(root, 0), '\0');
+    sprXMLEle(&buf[0], root, 0);
+    return buf;
+}
+
+/* parse and edit the same documents with and without arenas, output must not differ */
+static std::string parseAndEdit(bool arena)
+{
+    LilXML *lp = newLilXML();
+    setArenaLilXML(lp, arena);
+
+    std::string blob(100000, 'A');
+    std::string xml = std::string(defVector) +
+                      "<setBLOBVector device='CCD' name='CCD1'><oneBLOB name='CCD1' size='3' format='.fits'>" +
+                      blob + "</oneBLOB></setBLOBVector>";
+
+    std::vector<XMLEle *> roots = parseAll(lp, xml);
+    EXPECT_EQ(roots.size(), 2u);
+
+    std::string out;
+    for (XMLEle *root : roots)
+    {
+        setXMLEleTag(root, "newVector");
+        rmXMLAtt(root, "label");
+        addXMLAtt(root, "message", "edited");
+        XMLEle *first = nextXMLEle(root, 1);
+        editXMLEle(first, std::string(5000, 'z').c_str());
+        for (int i = 0; i < 40; i++)
+            addXMLEle(root, "oneNumber");
+        delXMLEle(nextXMLEle(root, 1));
+        out += print(root);
+        delXMLEle(root);
+    }
+
+    /* partial element is released with the parser */
+    std::string partial = "<getProperties version='1.7'><foo a='b'>12";
+    parseAll(lp, partial);
+    delLilXML(lp);
+    return out;
+}
+
+TEST(CORE_LILXML, Test_arenaMatchesHeap)
+{
+    std::string heap  = parseAndEdit(false);
+    std::string arena = parseAndEdit(true);
+    EXPECT_FALSE(heap.empty());
+    EXPECT_EQ(heap, arena);
+}
+
+TEST(CORE_LILXML, Test_arenaHeapCopy)
+{
+    LilXML *lp = newLilXML();
+    setArenaLilXML(lp, 1);
+
+    std::vector<XMLEle *> roots = parseAll(lp, defVector);
+    ASSERT_EQ(roots.size(), 1u);
+
+    /* a copy lives on the heap, and must outlive the arena it came from */
+    XMLEle *copy = cloneXMLEle(roots[0], nullptr, nullptr);
+    std::string before = print(roots[0]);
+    delXMLEle(roots[0]);
+    EXPECT_EQ(print(copy), before);
+    delXMLEle(copy);
+
+    delLilXML(lp);
+}
+
+/* whole buffer runs take the fast path, byte by byte chunks the state machine */
+TEST(CORE_LILXML, Test_runsMatchByteByByte)
+{
+    std::string xml =
+        "<?xml version='1.0'?>\n"
+        "<setTextVector device=\"Mount &amp; Focuser\" name='INFO' message='a \"quoted\" &lt;value&gt;\ttab'>\n"
+        "  <!-- comment <with> markup -->\n"
+        "  <oneText name='SITE_NAME_LONGER_THAN_SIXTEEN_BYTES'>Observatory &quot;du Ciel&quot; &#233; \xc3\xa9t\xc3\xa9 "
+        "with a long text that spans several vectors of sixteen bytes each</oneText>\n"
+        "  <oneText name='EMPTY'/>\n"
+        "  <oneText name='MULTILINE'>line one\r\nline two\n  line three   </oneText>\n"
+        "</setTextVector>\n"
+        "<getProperties version='1.7'/>\n";
+
+    LilXML *whole = newLilXML();
+    std::string expected;
+    for (XMLEle *root : parseAll(whole, xml))
+    {
+        expected += print(root);
+        delXMLEle(root);
+    }
+    delLilXML(whole);
+
+    LilXML *bytes = newLilXML();
+    std::string result;
+    for (char c : xml)
+    {
+        for (XMLEle *root : parseAll(bytes, std::string(1, c)))
+        {
+            result += print(root);
+            delXMLEle(root);
+        }
+    }
+    delLilXML(bytes);
+
+    EXPECT_NE(expected.find("Mount &amp; Focuser"), std::string::npos);
+    EXPECT_EQ(expected, result);
+}
+
+/* BLOB content decoded while parsing must match what a later decode gives, whatever the chunking */
+TEST(CORE_LILXML, Test_blobDecode)
+{
+    std::vector<unsigned char> raw(10000 + 2);
+    for (size_t i = 0; i < raw.size(); i++)
+        raw[i] = (unsigned char)(i * 7919 + i / 13);
+
+    std::string base64(4 * raw.size() / 3 + 4, '\0');
+    base64.resize(to64frombits_s(reinterpret_cast<unsigned char *>(&base64[0]), raw.data(), raw.size(), base64.size()));
+
+    std::string lines;
+    for (size_t i = 0; i < base64.size(); i += 72)
+        lines += base64.substr(i, 72) + "\n";
+
+    std::string xml = "<setBLOBVector device='CCD' name='CCD1'>"
+                      "<oneBLOB name='CCD1' size='" + std::to_string(raw.size()) + "' format='.fits'>\n" + lines + "</oneBLOB>"
+                      "<oneBLOB name='CCD2' size='100' format='.fits.z'>" + base64.substr(0, 16) + "</oneBLOB>"
+                      "</setBLOBVector>";
+
+    for (size_t chunk : {size_t(1), size_t(7), size_t(4096), xml.size()})
+    {
+        LilXML *lp = newLilXML();
+        setBlobDecodeLilXML(lp, realloc, free);
+
+        std::vector<XMLEle *> roots;
+        for (size_t i = 0; i < xml.size(); i += chunk)
+            for (XMLEle *root : parseAll(lp, xml.substr(i, chunk)))
+                roots.push_back(root);
+        ASSERT_EQ(roots.size(), 1u);
+
+        XMLEle *blob = nextXMLEle(roots[0], 1);
+        size_t len;
+        void *data = blobXMLEle(blob, &len);
+        ASSERT_NE(data, nullptr);
+        EXPECT_EQ(pcdatalenXMLEle(blob), 0);
+        ASSERT_EQ(len, raw.size()) << "chunk " << chunk;
+        EXPECT_EQ(memcmp(data, raw.data(), len), 0) << "chunk " << chunk;
+
+        /* compressed content is kept as base64 */
+        XMLEle *compressed = nextXMLEle(roots[0], 0);
+        EXPECT_EQ(blobXMLEle(compressed, nullptr), nullptr);
+        EXPECT_EQ(std::string(pcdataXMLEle(compressed)), base64.substr(0, 16));
+
+        free(takeBlobXMLEle(blob, nullptr));
+        EXPECT_EQ(blobXMLEle(blob, nullptr), nullptr);
+        delXMLEle(roots[0]);
+        delLilXML(lp);
+    }
+}
+
+/* decoding may be switched off between chunks: the BLOB being parsed is decoded to its end, the next is not */
+TEST(CORE_LILXML, Test_blobDecodeSwitchedOff)
+{
+    std::vector<unsigned char> raw(3000);
+    for (size_t i = 0; i < raw.size(); i++)
+        raw[i] = (unsigned char)(i * 31 + i / 7);
+
+    std::string base64(4 * raw.size() / 3 + 4, '\0');
+    base64.resize(to64frombits_s(reinterpret_cast<unsigned char *>(&base64[0]), raw.data(), raw.size(), base64.size()));
+
+    std::string blob = "<oneBLOB name='CCD1' size='" + std::to_string(raw.size()) + "' format='.fits'>" + base64 + "</oneBLOB>";
+    std::string xml = "<setBLOBVector device='CCD' name='CCD1'>" + blob + "</setBLOBVector>"
+                      "<setBLOBVector device='CCD' name='CCD1'>" + blob + "</setBLOBVector>";
+    size_t half = xml.find(blob) + blob.size() / 2;
+
+    LilXML *lp = newLilXML();
+    setBlobDecodeLilXML(lp, realloc, free);
+    std::vector<XMLEle *> roots = parseAll(lp, xml.substr(0, half));
+    EXPECT_TRUE(roots.empty());
+
+    setBlobDecodeLilXML(lp, nullptr, nullptr);
+    roots = parseAll(lp, xml.substr(half));
+    ASSERT_EQ(roots.size(), 2u);
+
+    size_t len;
+    void *data = blobXMLEle(nextXMLEle(roots[0], 1), &len);
+    ASSERT_NE(data, nullptr);
+    ASSERT_EQ(len, raw.size());
+    EXPECT_EQ(memcmp(data, raw.data(), len), 0);
+
+    XMLEle *second = nextXMLEle(roots[1], 1);
+    EXPECT_EQ(blobXMLEle(second, nullptr), nullptr);
+    EXPECT_EQ(std::string(pcdataXMLEle(second)), base64);
+
+    for (XMLEle *root : roots)
+        delXMLEle(root);
+    delLilXML(lp);
+}
+
+/* binary BLOB content is taken as is, even bytes that look like XML, and the parser goes on after it */
+TEST(CORE_LILXML, Test_blobBinary)
+{
+    static const char head[] = "\n<oneBLOB>&'\0</setBLOBVector>\n";
+    std::string raw(head, sizeof(head) - 1);
+    for (int i = 0; i < 1000; i++)
+        raw += (char)(i * 7919);
+
+    std::string xml = "<setBLOBVector device='CCD' name='CCD1'>\n"
+                      "<oneBLOB name='CCD1' size='" + std::to_string(raw.size()) + "' format='.fits' binary='true'>\n" + raw +
+                      "\n</oneBLOB>\n"
+                      "</setBLOBVector>\n<message device='CCD' message='done'/>\n";
+
+    for (size_t chunk : {size_t(1), size_t(5), size_t(512), xml.size()})
+    {
+        LilXML *lp = newLilXML();
+
+        std::vector<XMLEle *> roots;
+        for (size_t i = 0; i < xml.size(); i += chunk)
+            for (XMLEle *root : parseAll(lp, xml.substr(i, chunk)))
+                roots.push_back(root);
+        ASSERT_EQ(roots.size(), 2u) << "chunk " << chunk;
+        EXPECT_STREQ(tagXMLEle(roots[1]), "message");
+
+        size_t len;
+        void *data = blobXMLEle(nextXMLEle(roots[0], 1), &len);
+        ASSERT_NE(data, nullptr);
+        ASSERT_EQ(len, raw.size()) << "chunk " << chunk;
+        EXPECT_EQ(memcmp(data, raw.data(), len), 0) << "chunk " << chunk;
+
+        for (XMLEle *root : roots)
+            delXMLEle(root);
+        delLilXML(lp);
+    }
+
+    // Byte by byte
+    LilXML *lp = newLilXML();
+    char ynot[1024];
+    XMLEle *root = nullptr;
+    for (size_t i = 0; i < xml.size() && root == nullptr; i++)
+        root = readXMLEle(lp, xml[i], ynot);
+    ASSERT_NE(root, nullptr);
+    size_t len;
+    void *data = blobXMLEle(nextXMLEle(root, 1), &len);
+    ASSERT_EQ(len, raw.size());
+    EXPECT_EQ(memcmp(data, raw.data(), len), 0);
+    delXMLEle(root);
+    delLilXML(lp);
+}
+
+/* protocol names are shared, whether parsed, added or edited */
+TEST(CORE_LILXML, Test_internedNames)
+{
+    const char *device = internXMLName("device");
+    ASSERT_NE(device, nullptr);
+    EXPECT_STREQ(device, "device");
+    EXPECT_EQ(internXMLName("notAnIndiName"), nullptr);
+
+    for (int arena = 0; arena < 2; arena++)
+    {
+        LilXML *lp = newLilXML();
+        setArenaLilXML(lp, arena);
+
+        std::vector<XMLEle *> roots = parseAll(lp, std::string(defVector) + "<custom_tag custom='1' name='x'/>");
+        ASSERT_EQ(roots.size(), 2u);
+
+        EXPECT_EQ(tagXMLEle(roots[0]), internXMLName("defNumberVector"));
+        EXPECT_EQ(nameXMLAtt(findXMLAtt(roots[0], "device")), device);
+        EXPECT_EQ(tagXMLEle(findXMLEle(roots[0], "defNumber")), internXMLName("defNumber"));
+        EXPECT_STREQ(findXMLAttValu(roots[1], "custom"), "1");
+        EXPECT_STREQ(findXMLAttValu(roots[1], "name"), "x");
+        EXPECT_STREQ(tagXMLEle(roots[1]), "custom_tag");
+
+        setXMLEleTag(roots[1], "getProperties");
+        EXPECT_EQ(tagXMLEle(roots[1]), internXMLName("getProperties"));
+        setXMLEleTag(roots[1], "another_tag");
+        EXPECT_STREQ(tagXMLEle(roots[1]), "another_tag");
+        addXMLAtt(roots[1], "version", "1.7");
+        rmXMLAtt(roots[1], "name");
+        EXPECT_EQ(print(roots[1]), "<another_tag custom=\"1\" version=\"1.7\"/>\n");
+
+        for (XMLEle *root : roots)
+            delXMLEle(root);
+        delLilXML(lp);
+    }
+}
+
+/* one pass printing gives the same output, whether pcdata is referred or copied */
+TEST(CORE_LILXML, Test_sprvMatchesSpr)
+{
+    LilXML *lp = newLilXML();
+    std::string xml = std::string(defVector) +
+                      "<setTextVector device='Mount' name='INFO'><oneText name='A'>" + std::string(3000, 'a') + "</oneText>"
+                      "<oneText name='B'>x &amp; y</oneText><oneText name='C'>short</oneText></setTextVector>";
+    std::vector<XMLEle *> roots = parseAll(lp, xml);
+    ASSERT_EQ(roots.size(), 2u);
+
+    for (XMLEle *root : roots)
+    {
+        std::string expected = print(root);
+
+        size_t len;
+        char *buf = sprvXMLEle(root, 0, 0, nullptr, nullptr, &len);
+        EXPECT_EQ(std::string(buf, len), expected);
+        EXPECT_EQ(strlen(buf), len);
+        free(buf);
+
+        for (size_t minref : {size_t(1), size_t(100)})
+        {
+            XMLSpan *spans;
+            int nspans;
+            buf = sprvXMLEle(root, 0, minref, &spans, &nspans, &len);
+
+            std::string result;
+            size_t referred = 0;
+            for (int i = 0; i < nspans; i++)
+            {
+                if (spans[i].ele)
+                {
+                    EXPECT_GE(spans[i].len, minref);
+                    result.append(pcdataXMLEle(spans[i].ele), spans[i].len);
+                    referred += spans[i].len;
+                }
+                else
+                {
+                    EXPECT_LE(spans[i].offset + spans[i].len, len);
+                    result.append(buf + spans[i].offset, spans[i].len);
+                }
+            }
+            EXPECT_EQ(result, expected) << "minref " << minref;
+            EXPECT_EQ(len + referred, expected.size());
+            free(spans);
+            free(buf);
+        }
+        delXMLEle(root);
+    }
+    delLilXML(lp);
+}
+
+/* entities are escaped wherever they fall, within or across the blocks checked at once */
+TEST(CORE_LILXML, Test_entityEscaping)
+{
+    auto escape = [](const std::string &s)
+    {
+        std::string out;
+        for (char c : s)
+            switch (c)
+            {
+                case '&': out += "&amp;"; break;
+                case '<': out += "&lt;"; break;
+                case '>': out += "&gt;"; break;
+                case '\'': out += "&apos;"; break;
+                case '"': out += "&quot;"; break;
+                default: out += c;
+            }
+        return out;
+    };
+
+    for (size_t len : {0, 1, 15, 16, 17, 31, 33, 70})
+    {
+        std::string plain(len, 'v');
+        EXPECT_EQ(entityXML(&plain[0]), &plain[0]);
+
+        for (size_t at = 0; at < len; at++)
+            for (char c : std::string("&<>'\""))
+            {
+                std::string value = plain;
+                value[at] = c;
+                if (at + 3 < len)
+                    value[at + 3] = '&';
+
+                EXPECT_EQ(std::string(entityXML(&value[0])), escape(value)) << len << " " << at;
+
+                XMLEle *root = addXMLEle(nullptr, "oneText");
+                addXMLAtt(root, "name", value.c_str());
+                editXMLEle(root, value.c_str());
+                EXPECT_EQ(print(root), "<oneText name=\"" + escape(value) + "\">\n" + escape(value) + "\n</oneText>\n");
+                delXMLEle(root);
+            }
+    }
+}
+
+/* suffixes of BLOB formats are matched as strings, not as sets of characters */
+TEST(CORE_LILXML, Test_valueSearch)
+{
+    INDI::LilXmlValue format(".fits.z");
+    EXPECT_TRUE(format.endsWith(".z"));
+    EXPECT_FALSE(format.endsWith(".cfa"));
+    EXPECT_TRUE(format.startsWith(".fits"));
+    EXPECT_EQ(format.indexOf(".z"), 5u);
+    EXPECT_EQ(format.lastIndexOf("."), 5u);
+    EXPECT_EQ(format.toString().substr(0, format.lastIndexOf(".z")), ".fits");
+
+    INDI::LilXmlValue bin(".bin");
+    EXPECT_FALSE(bin.endsWith(".cfa"));
+    EXPECT_FALSE(bin.endsWith(".z"));
+    EXPECT_FALSE(bin.endsWith("longer.bin"));
+    EXPECT_FALSE(bin.startsWith("b"));
+}
+
+/* events give what the tree would hold, in document order */
+TEST(CORE_LILXML, Test_handlerEvents)
+{
+    struct Events
+    {
+        std::string log;
+        static void start(void *self, const char *tag, int depth)
+        {
+            static_cast<Events *>(self)->log += "<" + std::to_string(depth) + tag;
+        }
+        static void attribute(void *self, const char *name, const char *valu, int len)
+        {
+            static_cast<Events *>(self)->log += std::string(" ") + name + "=" + std::string(valu, len);
+        }
+        static void text(void *self, const char *text, int len)
+        {
+            static_cast<Events *>(self)->log += "[" + std::string(text, len) + "]";
+        }
+        static void end(void *self, const char *tag, int depth)
+        {
+            static_cast<Events *>(self)->log += std::string(tag) + std::to_string(depth) + ">";
+        }
+    } events;
+    const XMLHandler handler = { Events::start, Events::attribute, Events::text, Events::end };
+
+    std::string xml = "<setNumberVector device='CCD' name='TEMP'>\n"
+                      "  <oneNumber name='T'>  -10 &amp; more  </oneNumber>\n"
+                      "  <oneNumber name='E'/>\n"
+                      "</setNumberVector>\n"
+                      "<getProperties version='1.7'/>";
+
+    for (int arena = 0; arena < 2; arena++)
+    {
+        for (size_t chunk : {size_t(1), xml.size()})
+        {
+            LilXML *lp = newLilXML();
+            setArenaLilXML(lp, arena);
+            setHandlerLilXML(lp, &handler, &events);
+            events.log.clear();
+            for (size_t i = 0; i < xml.size(); i += chunk)
+                EXPECT_TRUE(parseAll(lp, xml.substr(i, chunk)).empty());
+            delLilXML(lp);
+
+            EXPECT_EQ(events.log,
+                      "<0setNumberVector device=CCD name=TEMP"
+                      "<1oneNumber name=T[-10 & more]oneNumber1>"
+                      "<1oneNumber name=EoneNumber1>"
+                      "setNumberVector0>"
+                      "<0getProperties version=1.7getProperties0>");
+        }
+    }
+}
+
+/* regular files are parsed by blocks, pipes a character at a time: both give the first root */
+TEST(CORE_LILXML, Test_readXMLFile)
+{
+    std::string xml = "<?xml version='1.0'?>\n<INDIDriver>\n";
+    for (int i = 0; i < 3000; i++)
+        xml += "  <newNumberVector device='Focuser' name='SETTING_" + std::to_string(i) + "'>\n"
+               "    <oneNumber name='VALUE'>" + std::to_string(i * 7) + "</oneNumber>\n"
+               "  </newNumberVector>\n";
+    xml += "</INDIDriver>\n<getProperties version='1.7'/>\n";
+    ASSERT_GT(xml.size(), 3 * 65536u);
+
+    LilXML *lp = newLilXML();
+    std::vector<XMLEle *> roots = parseAll(lp, xml);
+    ASSERT_EQ(roots.size(), 2u);
+    std::string expected = print(roots[0]);
+    for (XMLEle *root : roots)
+        delXMLEle(root);
+
+    char ynot[1024];
+    FILE *fp = tmpfile();
+    ASSERT_NE(fp, nullptr);
+    fwrite(xml.data(), 1, xml.size(), fp);
+    rewind(fp);
+    XMLEle *root = readXMLFile(fp, lp, ynot);
+    ASSERT_NE(root, nullptr) << ynot;
+    EXPECT_EQ(print(root), expected);
+    EXPECT_EQ(ynot[0], '\0');
+    delXMLEle(root);
+    fclose(fp);
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::string small = "<getProperties version='1.7'/>\n<rest/>";
+    ASSERT_EQ(write(fds[1], small.data(), small.size()), static_cast<ssize_t>(small.size()));
+    close(fds[1]);
+    fp = fdopen(fds[0], "r");
+    root = readXMLFile(fp, lp, ynot);
+    ASSERT_NE(root, nullptr) << ynot;
+    EXPECT_STREQ(tagXMLEle(root), "getProperties");
+    delXMLEle(root);
+    EXPECT_EQ(fgetc(fp), '\n');
+    fclose(fp);
+
+    /* errors are reported as before */
+    fp = tmpfile();
+    fputs("<a><b></a>", fp);
+    rewind(fp);
+    EXPECT_EQ(readXMLFile(fp, lp, ynot), nullptr);
+    EXPECT_NE(ynot[0], '\0');
+    fclose(fp);
+
+    delLilXML(lp);
+}
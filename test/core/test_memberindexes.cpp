@@ -0,0 +1,87 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indidevapi.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+// A text vector with count members named T0, T1...
+class MemberIndexesTest : public ::testing::Test
+{
+    protected:
+        void fill(int count)
+        {
+            texts.resize(count);
+            for (int i = 0; i < count; i++)
+                IUFillText(&texts[i], ("T" + std::to_string(i)).c_str(), "", "");
+        }
+
+        std::vector<int> find(std::vector<std::string> names)
+        {
+            std::vector<char *> pointers;
+            for (auto &name : names)
+                pointers.push_back(&name[0]);
+            std::vector<int> indexes(names.size(), -2);
+            found = IUFindMemberIndexes(texts.data(), sizeof(IText), static_cast<int>(texts.size()), pointers.data(),
+                                        static_cast<int>(names.size()), indexes.data());
+            return indexes;
+        }
+
+        std::vector<IText> texts;
+        int found = 0;
+};
+
+TEST_F(MemberIndexesTest, Test_inOrder)
+{
+    fill(40);
+    EXPECT_EQ(find({"T0", "T1", "T2", "T39"}), std::vector<int>({0, 1, 2, 39}));
+    EXPECT_EQ(found, 4);
+}
+
+TEST_F(MemberIndexesTest, Test_anyOrder)
+{
+    for (int count : {3, 40})
+    {
+        fill(count);
+        EXPECT_EQ(find({"T2", "T0", "T1", "T0"}), std::vector<int>({2, 0, 1, 0}));
+        EXPECT_EQ(found, 4);
+    }
+}
+
+TEST_F(MemberIndexesTest, Test_missing)
+{
+    for (int count : {3, 40})
+    {
+        fill(count);
+        EXPECT_EQ(find({"T1", "X", "T2", ""}), std::vector<int>({1, -1, 2, -1}));
+        EXPECT_EQ(found, 2);
+    }
+
+    fill(0);
+    EXPECT_EQ(find({"T0"}), std::vector<int>({-1}));
+    EXPECT_EQ(found, 0);
+}
+
+TEST_F(MemberIndexesTest, Test_duplicates)
+{
+    // The first member of a name is found, as with IUFindText
+    fill(20);
+    IUFillText(&texts[15], "T3", "", "");
+    EXPECT_EQ(find({"T3", "T10", "T3"}), std::vector<int>({3, 10, 3}));
+}
@@ -0,0 +1,140 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "indicom.h"
+#include "indiapi.h"
+#include "numberformat.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::vector<double> values()
+{
+    std::vector<double> result = {0.0, -0.0, 1.0, -1.0, 0.5, 2.5, -2.5, 5.591367222222222, -89.999999, 359.9999999,
+                                  1e-6, 1.5e-7, 123456789.125, -0.0004, 1e20, 9.999999999, 0.1, 1.0 / 3
+                                 };
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(-400, 400);
+    std::uniform_int_distribution<int> exponent(-12, 12);
+    for (int i = 0; i < 2000; i++)
+        result.push_back(uniform(rng) * std::pow(10, exponent(rng)));
+    return result;
+}
+
+TEST(CORE_NUMBERFORMAT, Test_printf)
+{
+    const char *formats[] = {"%g", "%.3g", "%12.8g", "%-12.8g", "%012.8g", "%+g", "% g", "%f", "%.2f", "%8.3f", "%08.3f",
+                             "%.0f", "%e", "%.3e", "%lf", "%.4f degrees", "T=%.1f", "%.20g"
+                            };
+    char fast[MAXINDIFORMAT], expected[MAXINDIFORMAT];
+    for (const char *format : formats)
+    {
+        for (double value : values())
+        {
+            int len = snprintf(expected, sizeof(expected), format, value);
+            if (len >= static_cast<int>(sizeof(expected)))
+                continue;
+            ASSERT_EQ(indi_format_printf(fast, sizeof(fast), format, value), len) << format << " " << value;
+            ASSERT_STREQ(fast, expected) << format;
+        }
+    }
+
+    // Left to printf
+    EXPECT_EQ(indi_format_printf(fast, sizeof(fast), "%d", 1.0), -1);
+    EXPECT_EQ(indi_format_printf(fast, sizeof(fast), "%#g", 1.0), -1);
+    EXPECT_EQ(indi_format_printf(fast, sizeof(fast), "%g%%", 1.0), -1);
+    EXPECT_EQ(indi_format_printf(fast, sizeof(fast), "%g", NAN), -1);
+    EXPECT_EQ(indi_format_printf(fast, sizeof(fast), "%f", 1e300), -1);
+}
+
+TEST(CORE_NUMBERFORMAT, Test_sexagesimal)
+{
+    char buf[MAXINDIFORMAT];
+
+    numberFormat(buf, "%010.6m", 5.5913672);
+    EXPECT_STREQ(buf, "   5:35:29");
+    numberFormat(buf, "%010.6m", -0.25);
+    EXPECT_STREQ(buf, "  -0:15:00");
+    numberFormat(buf, "%09.6m", -45.5);
+    EXPECT_STREQ(buf, "-45:30:00");
+    numberFormat(buf, "%11.8m", 359.99999);
+    EXPECT_STREQ(buf, "360:00:00.0");
+    numberFormat(buf, "%12.9m", 12.3456789);
+    EXPECT_STREQ(buf, " 12:20:44.44");
+    numberFormat(buf, "%6.5m", 1.26);
+    EXPECT_STREQ(buf, "1:15.6");
+    numberFormat(buf, "%4.2m", -1.5);
+    EXPECT_STREQ(buf, "-1:30");
+    numberFormat(buf, "%3.6m", -0.5);
+    EXPECT_STREQ(buf, "     -0:30:00");
+
+    // Not sexagesimal, printf formats
+    EXPECT_EQ(numberFormat(buf, "%.6f", 1.5), 8);
+    EXPECT_STREQ(buf, "1.500000");
+
+    // Integer conversions get the value as an integer, formats without a number nothing
+    EXPECT_EQ(numberFormat(buf, "%d", 0.0), 1);
+    EXPECT_STREQ(buf, "0");
+    EXPECT_EQ(numberFormat(buf, "%5d", -42.7), 5);
+    EXPECT_STREQ(buf, "  -42");
+    numberFormat(buf, "%lx", 255.0);
+    EXPECT_STREQ(buf, "ff");
+    numberFormat(buf, "%.3Lf", 1.25);
+    EXPECT_STREQ(buf, "1.250");
+    numberFormat(buf, "%d%%", 50.0);
+    EXPECT_STREQ(buf, "50%");
+    EXPECT_EQ(numberFormat(buf, "%s", 1.0), 0);
+    EXPECT_STREQ(buf, "");
+    EXPECT_EQ(numberFormat(buf, "%d %d", 1.0), 0);
+}
+
+TEST(CORE_NUMBERFORMAT, Test_shortest)
+{
+    char buf[32];
+    for (double value : values())
+    {
+        ASSERT_GT(indi_format_shortest(buf, sizeof(buf), value), 0);
+        EXPECT_EQ(std::strtod(buf, nullptr), value) << buf;
+    }
+    indi_format_shortest(buf, sizeof(buf), 0.1);
+    EXPECT_STREQ(buf, "0.1");
+}
+
+TEST(CORE_NUMBERFORMAT, Test_scan)
+{
+    double value = 0;
+    EXPECT_EQ(indi_scan_number("\n      -12.25\n", &value), 0);
+    EXPECT_EQ(value, -12.25);
+    EXPECT_EQ(indi_scan_number("1e-06", &value), 0);
+    EXPECT_EQ(value, 1e-06);
+    EXPECT_EQ(indi_scan_number("12:30:00", &value), -1);
+    EXPECT_EQ(indi_scan_number("", &value), -1);
+
+    // Sexagesimal values still go through sscanf
+    EXPECT_EQ(f_scansexa("-12:30:36", &value), 0);
+    EXPECT_DOUBLE_EQ(value, -12.51);
+    EXPECT_EQ(f_scansexa(" 5.5 ", &value), 0);
+    EXPECT_EQ(value, 5.5);
+    EXPECT_EQ(f_scansexa("-0.5", &value), 0);
+    EXPECT_EQ(value, -0.5);
+    EXPECT_EQ(f_scansexa("abc", &value), -1);
+}
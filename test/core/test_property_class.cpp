@@ -23,6 +23,11 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
 
 #include "basedevice.h"
 
@@ -34,6 +39,8 @@
 #include "indipropertyblob.h"
 
 #include <indipropertyview.h>
+#include "indililxml.h"
+#include "sharedblob.h"
 
 TEST(CORE_PROPERTY_CLASS, Test_EmptyProperty)
 {
@@ -262,6 +269,94 @@ TEST(CORE_PROPERTY_CLASS, Test_PropertyNumber)
     ASSERT_EQ(INDI::PropertyBlob(INDI::Property(p)).isValid(), false);
 }
 
+extern void (*WeakIDSetNumberVA)(const INumberVectorProperty *, const char *, va_list);
+
+static std::vector<std::string> appliedNumbers;
+
+static void captureSetNumber(const INumberVectorProperty *nvp, const char *, va_list)
+{
+    appliedNumbers.clear();
+    for (int i = 0; i < nvp->nnp; i++)
+        appliedNumbers.push_back(nvp->np[i].name);
+}
+
+TEST(CORE_PROPERTY_CLASS, Test_PropertyNumberApplyChanges)
+{
+    INDI::PropertyNumber p{3};
+    p[0].fill("RA", "RA", "%.2f", 0, 24, 0, 1);
+    p[1].fill("DEC", "DEC", "%.2f", -90, 90, 0, 2);
+    p[2].fill("PIER", "PIER", "%.0f", 0, 1, 0, 0);
+    p.setName("COORD");
+    p.setState(IPS_OK);
+
+    WeakIDSetNumberVA = captureSetNumber;
+
+    // first update sends everything
+    ASSERT_TRUE(p.applyChanges());
+    ASSERT_EQ(appliedNumbers, (std::vector<std::string> {"RA", "DEC", "PIER"}));
+
+    // below the format precision
+    p[0].setValue(1.001);
+    ASSERT_FALSE(p.applyChanges());
+
+    p[1].setValue(2.5);
+    ASSERT_TRUE(p.applyChanges());
+    ASSERT_EQ(appliedNumbers, (std::vector<std::string> {"DEC"}));
+
+    // a state change or a message goes out without widgets
+    p.setState(IPS_BUSY);
+    ASSERT_TRUE(p.applyChanges());
+    ASSERT_TRUE(appliedNumbers.empty());
+    ASSERT_TRUE(p.applyChanges("message"));
+    ASSERT_FALSE(p.applyChanges());
+
+    WeakIDSetNumberVA = nullptr;
+}
+
+static std::mutex appliedValuesLock;
+static std::vector<double> appliedValues;
+
+static void captureSetNumberValue(const INumberVectorProperty *nvp, const char *, va_list)
+{
+    std::lock_guard<std::mutex> lock(appliedValuesLock);
+    appliedValues.push_back(nvp->np[0].value);
+}
+
+TEST(CORE_PROPERTY_CLASS, Test_PropertyNumberApplyInterval)
+{
+    INDI::PropertyNumber p{1};
+    p[0].fill("POSITION", "POSITION", "%.0f", 0, 1000, 1, 0);
+    p.setName("FOCUS");
+    p.setState(IPS_BUSY);
+    p.setApplyInterval(50);
+
+    WeakIDSetNumberVA = captureSetNumberValue;
+
+    for (int i = 1; i <= 3; i++)
+    {
+        p[0].setValue(i);
+        p.apply();
+    }
+    // the last update is coalesced and sent from a copy
+    p[0].setValue(4);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    {
+        std::lock_guard<std::mutex> lock(appliedValuesLock);
+        ASSERT_EQ(appliedValues, (std::vector<double> {1, 3}));
+    }
+
+    // a state change is not delayed
+    p.setState(IPS_OK);
+    p.apply();
+    {
+        std::lock_guard<std::mutex> lock(appliedValuesLock);
+        ASSERT_EQ(appliedValues, (std::vector<double> {1, 3, 4}));
+    }
+
+    WeakIDSetNumberVA = nullptr;
+}
+
 TEST(CORE_PROPERTY_CLASS, Test_PropertySwitch)
 {
     INDI::PropertySwitch p{1};
@@ -513,3 +608,76 @@ TEST(CORE_PROPERTY_CLASS, Test_PropertyBlob)
     ASSERT_EQ(INDI::PropertyLight(INDI::Property(p)).isValid(), false);
     ASSERT_EQ(INDI::PropertyBlob(INDI::Property(p)).isValid(), true);
 }
+
+TEST(CORE_PROPERTY_CLASS, Test_BlobView)
+{
+    INDI::PropertyBlob p{1};
+
+    p[0].setBlobView(INDI::BlobView::copy("abcd", 4));
+    INDI::BlobView first = p[0].getBlobView();
+    ASSERT_EQ(first.data(), p[0].getBlob());
+    ASSERT_EQ(first.useCount(), 2);
+
+    // the first data outlives its widget reference
+    p[0].setBlobView(INDI::BlobView::copy("efgh", 4));
+    ASSERT_EQ(first.useCount(), 1);
+    ASSERT_EQ(std::string(static_cast<const char *>(first.data()), first.size()), "abcd");
+    ASSERT_EQ(p[0].getBlobAsString(), "efgh");
+    ASSERT_EQ(p[0].getBlobLen(), 4);
+
+    // and may go to another thread
+    std::string seen;
+    std::thread([view = p[0].getBlobView(), &seen]
+    {
+        seen.assign(static_cast<const char *>(view.data()), view.size());
+    }).join();
+    ASSERT_EQ(seen, "efgh");
+
+    p[0].setBlobView(INDI::BlobView());
+    ASSERT_EQ(p[0].getBlob(), nullptr);
+    ASSERT_EQ(p[0].getBlobLen(), 0);
+}
+
+TEST(CORE_PROPERTY_CLASS, Test_BlobView_setBLOB)
+{
+    char errmsg[MAXRBUF];
+    INDI::BaseDevice device;
+    device.setDeviceName("Camera");
+
+    INDI::LilXmlParser parser;
+    const std::string def = "<defBLOBVector device='Camera' name='CCD1' state='Idle' perm='ro'>"
+                            "<defBLOB name='CCD1'/></defBLOBVector>";
+    auto defs = parser.parseChunk(def.data(), def.size());
+    ASSERT_EQ(defs.size(), 1u);
+    ASSERT_EQ(device.buildProp(defs.front().root(), errmsg), 0) << errmsg;
+
+    auto set = [&](const char *base64)
+    {
+        std::string xml = std::string("<setBLOBVector device='Camera' name='CCD1' state='Ok'>"
+                                      "<oneBLOB name='CCD1' size='4' format='.bin'>") + base64 + "</oneBLOB></setBLOBVector>";
+        auto sets = parser.parseChunk(xml.data(), xml.size());
+        ASSERT_EQ(sets.size(), 1u);
+        ASSERT_EQ(device.setValue(sets.front().root(), errmsg), 0) << errmsg;
+    };
+    auto widget = [&]
+    {
+        return INDI::PropertyBlob(device.getProperty("CCD1", INDI_BLOB))[0];
+    };
+
+    // decoded from the text, then by the parser
+    set("YWJjZA==");
+    INDI::BlobView first = widget().getBlobView();
+    parser.setBlobDecoding(IDSharedBlobRealloc, IDSharedBlobFree);
+    set("ZWZnaA==");
+    INDI::BlobView second = widget().getBlobView();
+    set("aWprbA==");
+
+    ASSERT_EQ(std::string(static_cast<const char *>(first.data()), first.size()), "abcd");
+    ASSERT_EQ(std::string(static_cast<const char *>(second.data()), second.size()), "efgh");
+    ASSERT_EQ(widget().getBlobAsString(), "ijkl");
+    ASSERT_EQ(second.useCount(), 1);
+#ifdef ENABLE_INDI_SHARED_MEMORY
+    // in shared memory, ready for another process
+    ASSERT_GE(second.fd(), 0);
+#endif
+}
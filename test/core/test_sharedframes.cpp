@@ -0,0 +1,161 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "sharedframes.h"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// A reader in the same process, opening the ring by its path like another process would
+class SharedFramesTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            writer = IDSharedFramesCreate(3, 1000);
+            if (writer == nullptr)
+                GTEST_SKIP() << "shared memory frames not available";
+
+            reader = IDSharedFramesOpen(IDSharedFramesGetPath(writer));
+            ASSERT_NE(reader, nullptr);
+        }
+
+        void TearDown() override
+        {
+            IDSharedFramesFree(reader);
+            IDSharedFramesFree(writer);
+        }
+
+        uint64_t write(uint8_t value, size_t size = 100)
+        {
+            std::vector<uint8_t> frame(size, value);
+            shared_frame_info info {};
+            info.timestamp = 1000 + value;
+            info.size = size;
+            info.width = size;
+            info.height = 1;
+            info.depth = 8;
+            return IDSharedFramesWrite(writer, &info, frame.data());
+        }
+
+        shared_frames * writer {nullptr};
+        shared_frames * reader {nullptr};
+};
+
+TEST_F(SharedFramesTest, Test_empty)
+{
+    shared_frame_info info;
+    const void *data;
+    EXPECT_EQ(IDSharedFramesGetSequence(reader), 0u);
+    EXPECT_EQ(IDSharedFramesLatest(reader, &info, &data), -1);
+    EXPECT_EQ(errno, EAGAIN);
+    EXPECT_FALSE(IDSharedFramesIsClosed(reader));
+}
+
+TEST_F(SharedFramesTest, Test_latest)
+{
+    EXPECT_EQ(write(1), 1u);
+    EXPECT_EQ(write(2, 300), 2u);
+
+    shared_frame_info info;
+    const void *data;
+    ASSERT_EQ(IDSharedFramesLatest(reader, &info, &data), 0);
+    EXPECT_EQ(info.sequence, 2u);
+    EXPECT_EQ(info.timestamp, 1002u);
+    EXPECT_EQ(info.size, 300u);
+    EXPECT_EQ(info.width, 300u);
+    EXPECT_EQ(info.depth, 8u);
+    EXPECT_EQ(static_cast<const uint8_t *>(data)[0], 2);
+    EXPECT_EQ(static_cast<const uint8_t *>(data)[299], 2);
+    EXPECT_TRUE(IDSharedFramesIntact(reader, &info));
+}
+
+TEST_F(SharedFramesTest, Test_overwritten)
+{
+    write(1);
+    shared_frame_info info;
+    const void *data;
+    ASSERT_EQ(IDSharedFramesLatest(reader, &info, &data), 0);
+
+    // The frame survives until the ring comes back to its slot
+    write(2);
+    write(3);
+    EXPECT_TRUE(IDSharedFramesIntact(reader, &info));
+    write(4);
+    EXPECT_FALSE(IDSharedFramesIntact(reader, &info));
+    EXPECT_EQ(static_cast<const uint8_t *>(data)[0], 4);
+
+    ASSERT_EQ(IDSharedFramesLatest(reader, &info, &data), 0);
+    EXPECT_EQ(info.sequence, 4u);
+}
+
+TEST_F(SharedFramesTest, Test_in_place)
+{
+    // Slots are rounded to pages
+    EXPECT_EQ(IDSharedFramesGetSlotSize(writer), 4096u);
+    EXPECT_EQ(IDSharedFramesBegin(writer, 4097), nullptr);
+    EXPECT_EQ(IDSharedFramesBegin(reader, 10), nullptr);
+
+    auto slot = static_cast<uint8_t *>(IDSharedFramesBegin(writer, 4096));
+    ASSERT_NE(slot, nullptr);
+    memset(slot, 7, 4096);
+
+    // Not published before it is committed
+    EXPECT_EQ(IDSharedFramesGetSequence(reader), 0u);
+    shared_frame_info info {};
+    info.width = 64;
+    info.height = 64;
+    EXPECT_EQ(IDSharedFramesCommit(writer, &info), 1u);
+    EXPECT_EQ(info.sequence, 1u);
+
+    const void *data;
+    ASSERT_EQ(IDSharedFramesLatest(reader, &info, &data), 0);
+    EXPECT_EQ(info.size, 4096u);
+    EXPECT_EQ(static_cast<const uint8_t *>(data)[4095], 7);
+}
+
+TEST_F(SharedFramesTest, Test_closed)
+{
+    write(1);
+    IDSharedFramesFree(writer);
+    writer = nullptr;
+
+    // The memory stays while a reader maps it
+    EXPECT_TRUE(IDSharedFramesIsClosed(reader));
+    shared_frame_info info;
+    const void *data;
+    EXPECT_EQ(IDSharedFramesLatest(reader, &info, &data), 0);
+}
+
+TEST_F(SharedFramesTest, Test_not_frames)
+{
+    char path[] = "/tmp/test_sharedframes_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(fd, -1);
+    std::string text(8192, 'x');
+    ASSERT_EQ(::write(fd, text.data(), text.size()), ssize_t(text.size()));
+    close(fd);
+
+    EXPECT_EQ(IDSharedFramesOpen(path), nullptr);
+    EXPECT_EQ(errno, EPROTO);
+    unlink(path);
+}
@@ -0,0 +1,137 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "sharedring.h"
+
+#include <gtest/gtest.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+// A writer in the same process, attached through copies of the fds like a driver
+class SharedRingTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            reader = IDSharedRingCreate(4096);
+            if (reader == nullptr)
+                GTEST_SKIP() << "shared memory ring not available";
+
+            int fds[SHARED_RING_FDS];
+            IDSharedRingGetFds(reader, fds);
+            for (int &fd : fds)
+                fd = dup(fd);
+            writer = IDSharedRingAttach(fds);
+            ASSERT_NE(writer, nullptr);
+        }
+
+        void TearDown() override
+        {
+            IDSharedRingFree(writer);
+            IDSharedRingFree(reader);
+        }
+
+        bool readable(int timeout = 0)
+        {
+            struct pollfd pfd = { IDSharedRingGetReadFd(reader), POLLIN, 0 };
+            return poll(&pfd, 1, timeout) == 1;
+        }
+
+        std::string readAll()
+        {
+            std::string result;
+            char buf[1000];
+            for (size_t n; (n = IDSharedRingRead(reader, buf, sizeof(buf))) > 0;)
+                result.append(buf, n);
+            return result;
+        }
+
+        shared_ring * reader {nullptr};
+        shared_ring * writer {nullptr};
+};
+
+TEST_F(SharedRingTest, Test_notification)
+{
+    EXPECT_FALSE(readable());
+    ASSERT_EQ(IDSharedRingWrite(writer, "<one/>", 6, -1), 0);
+    EXPECT_TRUE(readable());
+
+    // Not woken again while the reader did not find the ring empty
+    IDSharedRingClearReadFd(reader);
+    char buf[3];
+    EXPECT_EQ(IDSharedRingRead(reader, buf, sizeof(buf)), 3u);
+    ASSERT_EQ(IDSharedRingWrite(writer, "<two/>", 6, -1), 0);
+    EXPECT_FALSE(readable());
+    EXPECT_EQ(std::string(buf, 3) + readAll(), "<one/><two/>");
+
+    ASSERT_EQ(IDSharedRingWrite(writer, "<three/>", 8, -1), 0);
+    EXPECT_TRUE(readable());
+    EXPECT_EQ(readAll(), "<three/>");
+}
+
+TEST_F(SharedRingTest, Test_wrap_and_wait)
+{
+    // Many times the size of the ring: the writer waits for the reader to make room
+    std::string expected;
+    for (int i = 0; i < 5000; i++)
+        expected += "<setNumberVector device='Test' name='N" + std::to_string(i) + "'/>\n";
+
+    std::thread thread([this, &expected]
+    {
+        EXPECT_EQ(IDSharedRingWrite(writer, expected.data(), expected.size(), -1), 0);
+    });
+
+    std::string received;
+    while (received.size() < expected.size())
+    {
+        std::string chunk = readAll();
+        if (chunk.empty())
+        {
+            ASSERT_TRUE(readable(5000));
+            IDSharedRingClearReadFd(reader);
+        }
+        received += chunk;
+    }
+    thread.join();
+    EXPECT_EQ(received, expected);
+}
+
+TEST_F(SharedRingTest, Test_peer_hangup)
+{
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+
+    std::string full(4096, ' ');
+    ASSERT_EQ(IDSharedRingWrite(writer, full.data(), full.size(), sv[0]), 0);
+
+    // The ring is full and the reader is gone
+    close(sv[1]);
+    EXPECT_EQ(IDSharedRingWrite(writer, "x", 1, sv[0]), -1);
+    close(sv[0]);
+}
+
+TEST_F(SharedRingTest, Test_fd_count)
+{
+    EXPECT_EQ(IDSharedRingGetFdCount(reader), 0u);
+    IDSharedRingAddFds(writer, 2);
+    IDSharedRingAddFds(writer, 1);
+    EXPECT_EQ(IDSharedRingGetFdCount(reader), 3u);
+}
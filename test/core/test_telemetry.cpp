@@ -0,0 +1,172 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "indiapi.h"
+#include "telemetry.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+using namespace INDI::Telemetry;
+
+static std::string tempPath()
+{
+    char path[] = "/tmp/test_telemetry_XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    unlink(path);
+    return path;
+}
+
+static long fileSize(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+TEST(CORE_TELEMETRY, Test_roundTrip)
+{
+    std::string path = tempPath();
+    const size_t samples = 3 * Writer::blockSamples + 17;
+    {
+        Writer writer;
+        ASSERT_TRUE(writer.open(path, 1000));
+        uint32_t ra = writer.channel(NUMBER, "Mount", "EQUATORIAL_EOD_COORD", "RA");
+        uint32_t park = writer.channel(SWITCH, "Mount", "TELESCOPE_PARK", "PARK");
+        uint32_t state = writer.channel(LIGHT, "Focuser", "STATUS", "Moving");
+        EXPECT_EQ(ra, writer.channel(NUMBER, "Mount", "EQUATORIAL_EOD_COORD", "RA"));
+
+        for (size_t i = 0; i < samples; i++)
+        {
+            writer.add(ra, 1000 + i * 250, 5.25 + i * 0.001);
+            if (i % 100 == 0)
+                writer.add(park, 1000 + i * 250, (i / 100) % 2);
+        }
+        writer.add(state, 2000, IPS_BUSY);
+        // Times going back keep the previous one
+        writer.add(state, 1500, IPS_OK);
+        EXPECT_TRUE(writer.flush());
+    }
+
+    std::vector<Series> series;
+    std::string error;
+    ASSERT_TRUE(Reader::readSeries(path, series, &error)) << error;
+    ASSERT_EQ(series.size(), 3u);
+
+    EXPECT_EQ(series[0].channel.kind, NUMBER);
+    EXPECT_EQ(series[0].channel.device, "Mount");
+    EXPECT_EQ(series[0].channel.element, "RA");
+    ASSERT_EQ(series[0].times.size(), samples);
+    for (size_t i = 0; i < samples; i++)
+    {
+        EXPECT_EQ(series[0].times[i], int64_t(1000 + i * 250));
+        EXPECT_DOUBLE_EQ(series[0].values[i], 5.25 + i * 0.001);
+    }
+
+    EXPECT_EQ(series[1].channel.kind, SWITCH);
+    ASSERT_EQ(series[1].values.size(), (samples + 99) / 100);
+    EXPECT_EQ(series[1].values[1], 1);
+
+    EXPECT_EQ(series[2].channel.kind, LIGHT);
+    ASSERT_EQ(series[2].times.size(), 2u);
+    EXPECT_EQ(series[2].times[1], 2000);
+    EXPECT_EQ(series[2].values[0], IPS_BUSY);
+
+    // Far from a text log: about 10 bytes per number
+    EXPECT_LT(fileSize(path), long(samples * 11));
+    unlink(path.c_str());
+}
+
+TEST(CORE_TELEMETRY, Test_sessionsAreAppended)
+{
+    std::string path = tempPath();
+    for (int session = 0; session < 3; session++)
+    {
+        Writer writer;
+        ASSERT_TRUE(writer.open(path, session * 1000000));
+        // Declared in another order each time, ids differ between sessions
+        if (session == 1)
+            writer.channel(NUMBER, "CCD", "CCD_TEMPERATURE", "CCD_TEMPERATURE_VALUE");
+        uint32_t id = writer.channel(NUMBER, "Focuser", "ABS_FOCUS_POSITION", "FOCUS_ABSOLUTE_POSITION");
+        writer.add(id, session * 1000000 + 1, 100 * session);
+    }
+
+    std::vector<Series> series;
+    ASSERT_TRUE(Reader::readSeries(path, series));
+    ASSERT_EQ(series.size(), 1u);
+    ASSERT_EQ(series[0].values.size(), 3u);
+    EXPECT_EQ(series[0].values[2], 200);
+    EXPECT_EQ(series[0].times[2], 2000001);
+    unlink(path.c_str());
+}
+
+TEST(CORE_TELEMETRY, Test_cutRecordIsDropped)
+{
+    std::string path = tempPath();
+    {
+        Writer writer;
+        ASSERT_TRUE(writer.open(path, 0));
+        uint32_t id = writer.channel(NUMBER, "Weather", "WEATHER_PARAMETERS", "WEATHER_TEMPERATURE");
+        writer.add(id, 10, 12.5);
+        writer.flush();
+        writer.add(id, 20, 12.0);
+    }
+
+    // A crash in the middle of the last block
+    long size = fileSize(path);
+    ASSERT_EQ(truncate(path.c_str(), size - 3), 0);
+
+    std::vector<Series> series;
+    ASSERT_TRUE(Reader::readSeries(path, series));
+    ASSERT_EQ(series[0].values.size(), 1u);
+
+    // The next session goes after the last whole record
+    {
+        Writer writer;
+        ASSERT_TRUE(writer.open(path, 100));
+        uint32_t id = writer.channel(NUMBER, "Weather", "WEATHER_PARAMETERS", "WEATHER_TEMPERATURE");
+        writer.add(id, 110, 11.5);
+    }
+    series.clear();
+    ASSERT_TRUE(Reader::readSeries(path, series));
+    ASSERT_EQ(series[0].values.size(), 2u);
+    EXPECT_EQ(series[0].values[1], 11.5);
+    unlink(path.c_str());
+}
+
+TEST(CORE_TELEMETRY, Test_otherFilesAreLeftAlone)
+{
+    std::string path = tempPath();
+    FILE *file = fopen(path.c_str(), "wb");
+    fputs("<setNumberVector device='Mount'/>\n", file);
+    fclose(file);
+    long size = fileSize(path);
+
+    Writer writer;
+    EXPECT_FALSE(writer.open(path, 0));
+    EXPECT_EQ(fileSize(path), size);
+
+    Reader reader;
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_FALSE(reader.error().empty());
+    unlink(path.c_str());
+}
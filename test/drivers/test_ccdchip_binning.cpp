@@ -0,0 +1,165 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indiccdchip.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Binned value of output pixel (x, y), computed the slow and obvious way
+static uint64_t referencePixel(const std::vector<uint8_t> &raw, uint32_t w, uint32_t h, int bpp, int binX, int binY,
+                               bool bayer, uint32_t x, uint32_t y)
+{
+    int factor   = bayer ? binX * binY : (binX * binX) / 2;
+    uint64_t sum = 0;
+    for (int k = 0; k < binY; k++)
+        for (int l = 0; l < binX; l++)
+        {
+            uint32_t rawY = bayer ? (y & ~1u) * binY + (y & 1u) + 2 * k : y * binY + k;
+            uint32_t rawX = bayer ? (x & ~1u) * binX + (x & 1u) + 2 * l : x * binX + l;
+            if (rawY >= h || rawX >= w)
+                continue;
+            size_t i   = static_cast<size_t>(rawY) * w + rawX;
+            uint64_t v = bpp == 8 ? raw[i] : bpp == 16 ? reinterpret_cast<const uint16_t *>(raw.data())[i] :
+                         reinterpret_cast<const uint32_t *>(raw.data())[i];
+            if (bpp == 8 && bayer)
+                v /= factor;
+            sum += v;
+        }
+    if (bpp == 8 && !bayer)
+        sum /= factor;
+    uint64_t max = bpp == 8 ? UINT8_MAX : bpp == 16 ? UINT16_MAX : UINT32_MAX;
+    return std::min(sum, max);
+}
+
+static void fillFrame(INDI::CCDChip &chip, int bpp, uint32_t w, uint32_t h, int binX, int binY)
+{
+    chip.setFrame(0, 0, w, h);
+    chip.setBin(binX, binY);
+    chip.setBPP(bpp);
+    chip.setFrameBufferSize(w * h * bpp / 8);
+
+    uint8_t *buffer = chip.getFrameBuffer();
+    srand(w * h);
+    // Some saturated bytes to exercise the caps
+    for (uint32_t i = 0; i < w * h * bpp / 8; i++)
+        buffer[i] = i % 7 == 0 ? 0xff : rand();
+}
+
+static void checkBinning(int bpp, uint32_t w, uint32_t h, int binX, int binY, bool bayer)
+{
+    INDI::CCDChip chip;
+    fillFrame(chip, bpp, w, h, binX, binY);
+    std::vector<uint8_t> raw(chip.getFrameBuffer(), chip.getFrameBuffer() + chip.getFrameBufferSize());
+
+    if (bayer)
+        chip.binBayerFrame();
+    else
+        chip.binFrame();
+
+    uint32_t outW = w / binX;
+    uint32_t outH = h / binY;
+    const uint8_t *out = chip.getFrameBuffer();
+    for (uint32_t y = 0; y < outH; y++)
+        for (uint32_t x = 0; x < outW; x++)
+        {
+            size_t i   = static_cast<size_t>(y) * outW + x;
+            uint64_t v = bpp == 8 ? out[i] : bpp == 16 ? reinterpret_cast<const uint16_t *>(out)[i] :
+                         reinterpret_cast<const uint32_t *>(out)[i];
+            ASSERT_EQ(v, referencePixel(raw, w, h, bpp, binX, binY, bayer, x, y))
+                    << bpp << " bpp " << w << "x" << h << " bin " << binX << "x" << binY << (bayer ? " bayer" : "")
+                    << " at " << x << "," << y;
+        }
+}
+
+TEST(CCDCHIP_BINNING, Test_binFrame)
+{
+    for (int bpp : {8, 16, 32})
+        for (int bin = 2; bin <= 5; bin++)
+        {
+            // whole blocks, wide enough for the SIMD loops, then a frame with partial blocks at the edges
+            checkBinning(bpp, bin * 301, bin * 67, bin, bin, false);
+            checkBinning(bpp, bin * 77 + 1, bin * 13 + bin - 1, bin, bin, false);
+        }
+}
+
+TEST(CCDCHIP_BINNING, Test_binBayerFrame)
+{
+    for (int bpp : {8, 16, 32})
+        for (int bin = 2; bin <= 5; bin++)
+        {
+            checkBinning(bpp, 2 * bin * 150, 2 * bin * 34, bin, bin, true);
+            // odd number of binned columns and rows
+            checkBinning(bpp, 2 * bin * 37 + bin, 2 * bin * 6 + bin + 1, bin, bin, true);
+        }
+    checkBinning(16, 2 * 3 * 40, 2 * 2 * 30, 3, 2, true);
+}
+
+// The scalar loop binFrame used before, for 16 bits
+static void legacyBinFrame16(const uint16_t *raw, uint16_t *bin_buf, uint32_t w, uint32_t h, int bin)
+{
+    for (uint32_t i = 0; i < h; i += bin)
+        for (uint32_t j = 0; j < w; j += bin)
+        {
+            for (int k = 0; k < bin; k++)
+            {
+                for (int l = 0; l < bin; l++)
+                {
+                    uint16_t val = *(raw + j + (i + k) * w + l);
+                    if (val + *bin_buf > UINT16_MAX)
+                        *bin_buf = UINT16_MAX;
+                    else
+                        *bin_buf += val;
+                }
+            }
+            bin_buf++;
+        }
+}
+
+TEST(CCDCHIP_BINNING, Test_binFrame_time)
+{
+    const uint32_t w = 9576, h = 6388;
+
+    for (int bin : {2, 4})
+    {
+        INDI::CCDChip chip;
+        fillFrame(chip, 16, w, h, bin, bin);
+        std::vector<uint8_t> raw(chip.getFrameBuffer(), chip.getFrameBuffer() + chip.getFrameBufferSize());
+
+        // Once so that both buffers are allocated, then again on the same frame
+        chip.binFrame();
+        memcpy(chip.getFrameBuffer(), raw.data(), raw.size());
+
+        std::vector<uint16_t> legacy(static_cast<size_t>(w) * h);
+        auto start = std::chrono::steady_clock::now();
+        // binFrame used to clear the whole destination first
+        memset(legacy.data(), 0, legacy.size() * sizeof(uint16_t));
+        legacyBinFrame16(reinterpret_cast<const uint16_t *>(raw.data()), legacy.data(), w, h, bin);
+        auto scalar = std::chrono::steady_clock::now();
+        chip.binFrame();
+        auto binned = std::chrono::steady_clock::now();
+
+        ASSERT_EQ(memcmp(legacy.data(), chip.getFrameBuffer(), static_cast<size_t>(w / bin) * (h / bin) * 2), 0);
+        printf("binFrame %ux%u 16 bits %dx%d: legacy %.1f ms, now %.1f ms\n", w, h, bin, bin,
+               std::chrono::duration<double, std::milli>(scalar - start).count(),
+               std::chrono::duration<double, std::milli>(binned - scalar).count());
+    }
+}
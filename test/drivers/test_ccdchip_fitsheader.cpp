@@ -0,0 +1,117 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indiccdchip.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+// Writes the keywords to a new image of the chip, returns the number of failures
+static size_t writeFrame(INDI::CCDChip &chip, const std::vector<INDI::FITSRecord> &keywords)
+{
+    int status = 0;
+    chip.closeFITSFile();
+    EXPECT_TRUE(chip.openFITSFile(2880, status));
+    long naxes[2] = {4, 4};
+    fits_create_img(*chip.fitsFilePointer(), USHORT_IMG, 2, naxes, &status);
+    EXPECT_EQ(status, 0);
+
+    std::vector<std::pair<std::string, int>> failed;
+    chip.writeFITSKeywords(keywords, failed);
+    return failed.size();
+}
+
+static std::string readCard(INDI::CCDChip &chip, const char *key)
+{
+    char card[FLEN_CARD] = "";
+    int status = 0;
+    fits_read_card(*chip.fitsFilePointer(), key, card, &status);
+    return status ? "" : card;
+}
+
+TEST(CCDChipFITSHeaderTest, Test_cardsMatchUpdateKey)
+{
+    INDI::CCDChip chip;
+    std::vector<INDI::FITSRecord> keywords =
+    {
+        INDI::FITSRecord("INSTRUME", "CCD Simulator", "CCD Name"),
+        INDI::FITSRecord("EXPTIME", 1.5, 6, "Total Exposure Time (s)"),
+        INDI::FITSRecord("XBINNING", int64_t(2), "Binning factor in width"),
+        INDI::FITSRecord("Sample comment"),
+    };
+    ASSERT_EQ(writeFrame(chip, keywords), 0u);
+    std::vector<std::string> cards;
+    for (auto key : {"INSTRUME", "EXPTIME", "XBINNING"})
+        cards.push_back(readCard(chip, key));
+
+    // The same header written the way it was before
+    int status = 0;
+    fitsfile *fptr = *chip.fitsFilePointer();
+    fits_update_key_str(fptr, "INSTRUME", "CCD Simulator", "CCD Name", &status);
+    fits_update_key_dbl(fptr, "EXPTIME", 1.5, 6, "Total Exposure Time (s)", &status);
+    fits_update_key_lng(fptr, "XBINNING", 2, "Binning factor in width", &status);
+    ASSERT_EQ(status, 0);
+    EXPECT_EQ(readCard(chip, "INSTRUME"), cards[0]);
+    EXPECT_EQ(readCard(chip, "EXPTIME"), cards[1]);
+    EXPECT_EQ(readCard(chip, "XBINNING"), cards[2]);
+    chip.closeFITSFile();
+}
+
+TEST(CCDChipFITSHeaderTest, Test_changedKeyword)
+{
+    INDI::CCDChip chip;
+    std::vector<INDI::FITSRecord> keywords =
+    {
+        INDI::FITSRecord("EXPTIME", 1.5, 6, "Total Exposure Time (s)"),
+        INDI::FITSRecord("FRAME", "Light", "Frame Type"),
+    };
+    ASSERT_EQ(writeFrame(chip, keywords), 0u);
+
+    keywords[0] = INDI::FITSRecord("EXPTIME", 30.0, 6, "Total Exposure Time (s)");
+    ASSERT_EQ(writeFrame(chip, keywords), 0u);
+
+    int status = 0;
+    double exptime = 0;
+    char frame[FLEN_VALUE] = "";
+    fits_read_key(*chip.fitsFilePointer(), TDOUBLE, "EXPTIME", &exptime, nullptr, &status);
+    fits_read_key(*chip.fitsFilePointer(), TSTRING, "FRAME", frame, nullptr, &status);
+    EXPECT_EQ(status, 0);
+    EXPECT_DOUBLE_EQ(exptime, 30.0);
+    EXPECT_STREQ(frame, "Light");
+    chip.closeFITSFile();
+}
+
+TEST(CCDChipFITSHeaderTest, Test_existingKeyword)
+{
+    INDI::CCDChip chip;
+    // Already written by fits_create_img: updated, not duplicated
+    std::vector<INDI::FITSRecord> keywords = { INDI::FITSRecord("EXTEND", "T", "Extensions") };
+    ASSERT_EQ(writeFrame(chip, keywords), 0u);
+
+    int status = 0, count = 0, more = 0;
+    fits_get_hdrspace(*chip.fitsFilePointer(), &count, &more, &status);
+    int extend = 0;
+    for (int i = 1; i <= count; i++)
+    {
+        char name[FLEN_KEYWORD], value[FLEN_VALUE], comment[FLEN_COMMENT];
+        fits_read_keyn(*chip.fitsFilePointer(), i, name, value, comment, &status);
+        extend += std::string(name) == "EXTEND";
+    }
+    EXPECT_EQ(extend, 1);
+    chip.closeFITSFile();
+}
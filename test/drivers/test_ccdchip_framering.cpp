@@ -0,0 +1,106 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indiccdchip.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <thread>
+
+TEST(CCDCHIP_FRAMERING, Test_disabled)
+{
+    INDI::CCDChip chip;
+    chip.setFrameBufferSize(1024);
+    EXPECT_EQ(chip.getFrameRingSize(), 0u);
+    EXPECT_EQ(chip.acquireFrame(), nullptr);
+}
+
+TEST(CCDCHIP_FRAMERING, Test_acquireRelease)
+{
+    INDI::CCDChip chip;
+    chip.setFrameBufferSize(1024);
+    chip.setFrameRingSize(3);
+
+    std::set<uint8_t *> frames;
+    for (int i = 0; i < 3; i++)
+    {
+        uint8_t *frame = chip.acquireFrame(0);
+        ASSERT_NE(frame, nullptr);
+        EXPECT_NE(frame, chip.getFrameBuffer());
+        memset(frame, i, 1024);
+        frames.insert(frame);
+    }
+    EXPECT_EQ(frames.size(), 3u);
+
+    // All in use
+    EXPECT_EQ(chip.acquireFrame(10), nullptr);
+
+    // Released buffers come back
+    chip.releaseFrame(*frames.begin());
+    uint8_t *frame = chip.acquireFrame(0);
+    EXPECT_EQ(frame, *frames.begin());
+
+    for (auto released : frames)
+        chip.releaseFrame(released);
+}
+
+TEST(CCDCHIP_FRAMERING, Test_waitForRelease)
+{
+    INDI::CCDChip chip;
+    chip.setFrameBufferSize(4096);
+    chip.setFrameRingSize(1);
+
+    uint8_t *frame = chip.acquireFrame();
+    ASSERT_NE(frame, nullptr);
+
+    std::thread uploader([&]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        chip.releaseFrame(frame);
+    });
+    EXPECT_EQ(chip.acquireFrame(), frame);
+    uploader.join();
+    chip.releaseFrame(frame);
+}
+
+TEST(CCDCHIP_FRAMERING, Test_resize)
+{
+    INDI::CCDChip chip;
+    chip.setFrameBufferSize(1024);
+    chip.setFrameRingSize(2);
+
+    uint8_t *busy = chip.acquireFrame(0);
+    ASSERT_NE(busy, nullptr);
+
+    // The free buffer follows the new size right away, the busy one when acquired again
+    chip.setFrameBufferSize(1 << 20);
+    uint8_t *frame = chip.acquireFrame(0);
+    ASSERT_NE(frame, nullptr);
+    memset(frame, 0, 1 << 20);
+
+    // Shrinking frees buffers as they are released
+    chip.setFrameRingSize(1);
+    chip.releaseFrame(busy);
+    EXPECT_EQ(chip.acquireFrame(0), nullptr);
+    chip.releaseFrame(frame);
+    frame = chip.acquireFrame(0);
+    ASSERT_NE(frame, nullptr);
+    memset(frame, 0, 1 << 20);
+    chip.releaseFrame(frame);
+}
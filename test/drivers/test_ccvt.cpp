@@ -0,0 +1,146 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "stream/ccvt.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static std::vector<uint8_t> randomBytes(size_t size)
+{
+    std::vector<uint8_t> bytes(size);
+    srand(size);
+    for (auto &byte : bytes)
+        byte = rand();
+    return bytes;
+}
+
+// The conversion of one pixel, as the scalar loops always did it
+static void referencePixel(int y, int u, int v, uint8_t *rgb)
+{
+    int cb = ((u - 128) * 454) >> 8;
+    int cr = ((v - 128) * 359) >> 8;
+    int cg = ((u - 128) * 88 + (v - 128) * 183) >> 8;
+    rgb[0] = std::min(255, std::max(0, y + cr));
+    rgb[1] = std::min(255, std::max(0, y - cg));
+    rgb[2] = std::min(255, std::max(0, y + cb));
+}
+
+static void checkYUYV(int width, int height)
+{
+    int pairs = width / 2;
+    auto yuyv = randomBytes(static_cast<size_t>(4) * pairs * height);
+    std::vector<uint8_t> rgb(static_cast<size_t>(6) * pairs * height), bgr(rgb.size());
+    ccvt_yuyv_rgb24(width, height, yuyv.data(), rgb.data());
+    ccvt_yuyv_bgr24(width, height, yuyv.data(), bgr.data());
+
+    for (size_t pair = 0; pair < static_cast<size_t>(pairs) * height; pair++)
+    {
+        const uint8_t *s = yuyv.data() + 4 * pair;
+        for (int k = 0; k < 2; k++)
+        {
+            uint8_t expected[3];
+            size_t i = 3 * (2 * pair + k);
+            referencePixel(s[2 * k], s[1], s[3], expected);
+            ASSERT_TRUE(rgb[i] == expected[0] && rgb[i + 1] == expected[1] && rgb[i + 2] == expected[2])
+                    << width << "x" << height << " pixel " << 2 * pair + k;
+            ASSERT_TRUE(bgr[i] == expected[2] && bgr[i + 1] == expected[1] && bgr[i + 2] == expected[0])
+                    << width << "x" << height << " pixel " << 2 * pair + k;
+        }
+    }
+
+    // the planar conversion drops the last column and row of odd sizes
+    if ((width | height) & 1)
+        return;
+
+    std::vector<uint8_t> y(static_cast<size_t>(width) * height), u(y.size() / 4), v(y.size() / 4);
+    ccvt_yuyv_420p(width, height, yuyv.data(), y.data(), u.data(), v.data());
+    for (int row = 0; row < height; row++)
+        for (int x = 0; x < width; x++)
+            ASSERT_EQ(y[row * width + x], yuyv[(row * width + x) * 2]) << width << "x" << height;
+    for (int row = 0; row < height / 2; row++)
+        for (int x = 0; x < width / 2; x++)
+        {
+            const uint8_t *s1 = yuyv.data() + (2 * row * width + 2 * x) * 2;
+            const uint8_t *s2 = s1 + 2 * width;
+            ASSERT_EQ(u[row * width / 2 + x], (s1[1] + s2[1]) / 2) << width << "x" << height;
+            ASSERT_EQ(v[row * width / 2 + x], (s1[3] + s2[3]) / 2) << width << "x" << height;
+        }
+}
+
+static void check420p(int width, int height)
+{
+    size_t size = static_cast<size_t>(width) * height;
+    auto yuv = randomBytes(size + size / 2);
+    std::vector<uint8_t> rgb(3 * size), bgr(3 * size), planes(3 * size);
+    ccvt_420p_rgb24(width, height, yuv.data(), rgb.data());
+    ccvt_420p_bgr24(width, height, yuv.data(), bgr.data());
+    ccvt_420p_rgb24_planes(width, height, yuv.data(), yuv.data() + size, yuv.data() + size + size / 4, planes.data());
+    EXPECT_EQ(rgb, planes);
+
+    for (int row = 0; row < height; row++)
+        for (int x = 0; x < width; x++)
+        {
+            uint8_t expected[3];
+            size_t chroma = (row / 2) * (width / 2) + x / 2;
+            size_t i = 3 * (static_cast<size_t>(row) * width + x);
+            referencePixel(yuv[row * width + x], yuv[size + chroma], yuv[size + size / 4 + chroma], expected);
+            ASSERT_TRUE(rgb[i] == expected[0] && rgb[i + 1] == expected[1] && rgb[i + 2] == expected[2])
+                    << width << "x" << height << " at " << x << "," << row;
+            ASSERT_TRUE(bgr[i] == expected[2] && bgr[i + 1] == expected[1] && bgr[i + 2] == expected[0])
+                    << width << "x" << height << " at " << x << "," << row;
+        }
+}
+
+TEST(CCVT, Test_yuyv)
+{
+    // wide enough for the SIMD loops with a scalar tail, narrower than them, odd sizes
+    checkYUYV(640, 480);
+    checkYUYV(1000, 6);
+    checkYUYV(10, 4);
+    checkYUYV(643, 7);
+}
+
+TEST(CCVT, Test_420p)
+{
+    check420p(640, 480);
+    check420p(1000, 6);
+    check420p(10, 4);
+}
+
+TEST(CCVT, Test_convert_time)
+{
+    const int width = 1920, height = 1080;
+    auto yuyv = randomBytes(static_cast<size_t>(2) * width * height);
+    std::vector<uint8_t> rgb(static_cast<size_t>(3) * width * height);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; i++)
+        ccvt_yuyv_rgb24(width, height, yuyv.data(), rgb.data());
+    auto yuyvDone = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; i++)
+        ccvt_420p_rgb24(width, height, yuyv.data(), rgb.data());
+    auto yuvDone = std::chrono::steady_clock::now();
+
+    printf("%dx%d to rgb24: yuyv %.2f ms, 420p %.2f ms\n", width, height,
+           std::chrono::duration<double, std::milli>(yuyvDone - start).count() / 10,
+           std::chrono::duration<double, std::milli>(yuvDone - yuyvDone).count() / 10);
+}
@@ -0,0 +1,131 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "celestronauxpacket.h"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <vector>
+
+static std::vector<uint8_t> encode(Aux::Target source, Aux::Target destination, Aux::Command command,
+                                   std::vector<uint8_t> data = {})
+{
+    uint8_t out[Aux::MAX_PACKET];
+    size_t size = Aux::Packet::Encode(source, destination, command, data.data(), data.size(), out, sizeof(out));
+    return std::vector<uint8_t>(out, out + size);
+}
+
+TEST(CelestronAuxPacketTest, Test_encode)
+{
+    // Get the position of the focuser
+    std::vector<uint8_t> expected = {0x3b, 0x03, 0x20, 0x12, 0x01, 0xca};
+    EXPECT_EQ(encode(Aux::APP, Aux::FOCUSER, Aux::MC_GET_POSITION), expected);
+
+    // The same bytes as the allocating encoder
+    Aux::Packet packet(Aux::APP, Aux::FOCUSER, Aux::MC_GOTO_FAST, {0x01, 0x02, 0x03});
+    Aux::buffer filled;
+    packet.FillBuffer(filled);
+    EXPECT_EQ(encode(Aux::APP, Aux::FOCUSER, Aux::MC_GOTO_FAST, {0x01, 0x02, 0x03}), filled);
+
+    uint8_t small[8];
+    uint8_t data[3] = {0};
+    EXPECT_EQ(Aux::Packet::Encode(Aux::APP, Aux::FOCUSER, Aux::MC_GOTO_FAST, data, 3, small, sizeof(small)), 0u);
+}
+
+TEST(CelestronAuxPacketTest, Test_decode)
+{
+    std::vector<uint8_t> stream = {0x00, 0xff};
+    std::vector<uint8_t> reply = encode(Aux::FOCUSER, Aux::APP, Aux::MC_GET_POSITION, {0x12, 0x34, 0x56});
+    std::vector<uint8_t> corrupt = encode(Aux::ALT, Aux::APP, Aux::MC_GET_POSITION, {0x00, 0x00, 0x01});
+    corrupt[6] ^= 0x01;
+    stream.insert(stream.end(), corrupt.begin(), corrupt.end());
+    stream.insert(stream.end(), reply.begin(), reply.end());
+
+    Aux::PacketDecoder decoder;
+    Aux::PacketView packet;
+    int packets = 0;
+    for (uint8_t byte : stream)
+    {
+        if (decoder.Push(byte, packet))
+        {
+            packets++;
+            EXPECT_EQ(packet.source, Aux::FOCUSER);
+            EXPECT_EQ(packet.destination, Aux::APP);
+            EXPECT_EQ(packet.command, Aux::MC_GET_POSITION);
+            ASSERT_EQ(packet.size, 3u);
+            EXPECT_EQ(packet.data[0], 0x12);
+            EXPECT_EQ(packet.data[2], 0x56);
+        }
+    }
+
+    // Leading noise is skipped and the corrupted packet dropped
+    EXPECT_EQ(packets, 1);
+    EXPECT_EQ(decoder.Errors(), 1u);
+    EXPECT_EQ(decoder.Needed(), 1u);
+}
+
+TEST(CelestronAuxPacketTest, Test_multiplexed)
+{
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    // The axes answer in the opposite order of the requests, with an unrelated packet in between
+    std::vector<uint8_t> bus;
+    for (const auto &packet :
+            {
+                encode(Aux::ALT, Aux::APP, Aux::MC_GET_POSITION, {0x00, 0x00, 0x02}),
+                encode(Aux::HC, Aux::AZM, Aux::MC_GET_POSITION),
+                encode(Aux::AZM, Aux::APP, Aux::MC_GET_POSITION, {0x00, 0x00, 0x01}),
+                encode(Aux::AZM, Aux::APP, Aux::MC_SLEW_DONE, {0xff}),
+            })
+        bus.insert(bus.end(), packet.begin(), packet.end());
+    ASSERT_EQ(write(fds[1], bus.data(), bus.size()), static_cast<ssize_t>(bus.size()));
+
+    Aux::Communicator communicator(Aux::APP);
+    Aux::Communicator::Request requests[3];
+    requests[0].destination = Aux::AZM;
+    requests[0].command = Aux::MC_GET_POSITION;
+    requests[0].size = 0;
+    requests[1].destination = Aux::ALT;
+    requests[1].command = Aux::MC_GET_POSITION;
+    requests[1].size = 0;
+    requests[2].destination = Aux::AZM;
+    requests[2].command = Aux::MC_SLEW_DONE;
+    requests[2].size = 0;
+
+    ASSERT_TRUE(communicator.sendCommands(fds[0], requests, 3));
+    for (const auto &request : requests)
+        EXPECT_TRUE(request.done);
+    EXPECT_EQ(requests[0].reply[2], 0x01);
+    EXPECT_EQ(requests[1].reply[2], 0x02);
+    ASSERT_EQ(requests[2].replySize, 1u);
+    EXPECT_EQ(requests[2].reply[0], 0xff);
+
+    // Both axes were asked before either answered, the second command to AZM once the first was answered
+    uint8_t sent[64];
+    ssize_t n = recv(fds[1], sent, sizeof(sent), MSG_DONTWAIT);
+    ASSERT_EQ(n, 18);
+    EXPECT_EQ(sent[3], Aux::AZM);
+    EXPECT_EQ(sent[6 + 3], Aux::ALT);
+    EXPECT_EQ(sent[12 + 4], Aux::MC_SLEW_DONE);
+
+    close(fds[0]);
+    close(fds[1]);
+}
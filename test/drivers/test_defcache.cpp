@@ -0,0 +1,119 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indidevapi.h"
+#include "indiuserio.h"
+#include "userio.h"
+#include "capturestdout.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <regex>
+#include <string>
+
+// What the driver writes to stdout while fn runs, without the timestamps
+static std::string capture(const std::function<void()> &fn)
+{
+    return std::regex_replace(captureStdout(fn), std::regex("timestamp='[^']*'"), "timestamp=''");
+}
+
+static void defNumber(const INumberVectorProperty *nvp, ...)
+{
+    va_list ap;
+    va_start(ap, nvp);
+    userio_xmlv1(userio_file(), stdout);
+    IUUserIODefNumberVA(userio_file(), stdout, nvp, nullptr, ap);
+    va_end(ap);
+}
+
+// The message formatted without the cache
+static std::string uncached(const INumberVectorProperty *nvp)
+{
+    return capture([nvp] { defNumber(nvp); });
+}
+
+class DefCacheTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            IUFillNumber(&numbers[0], "RA", "RA", "%010.6m", 0, 24, 0, 5.5);
+            IUFillNumber(&numbers[1], "DEC", "Dec", "%010.6m", -90, 90, 0, -5.25);
+            IUFillNumberVector(&vector, numbers, 2, "Test", "EQUATORIAL_EOD_COORD", "Eq. Coordinates", "Main", IP_RW, 60,
+                               IPS_IDLE);
+        }
+
+        void TearDown() override
+        {
+            capture([] { IDDelete("Test", nullptr, nullptr); });
+        }
+
+        std::string define()
+        {
+            return capture([this] { IDDefNumber(&vector, nullptr); });
+        }
+
+        INumber numbers[2];
+        INumberVectorProperty vector;
+};
+
+TEST_F(DefCacheTest, Test_repeated)
+{
+    std::string first = define();
+    EXPECT_EQ(first, uncached(&vector));
+    EXPECT_EQ(define(), first);
+    EXPECT_EQ(define(), first);
+}
+
+TEST_F(DefCacheTest, Test_changes)
+{
+    define();
+
+    numbers[0].value = 12.75;
+    EXPECT_EQ(define(), uncached(&vector));
+
+    strcpy(numbers[1].label, "Declination");
+    EXPECT_EQ(define(), uncached(&vector));
+
+    vector.s = IPS_BUSY;
+    EXPECT_EQ(define(), uncached(&vector));
+
+    vector.nnp = 1;
+    EXPECT_EQ(define(), uncached(&vector));
+}
+
+TEST_F(DefCacheTest, Test_message)
+{
+    define();
+    std::string output = capture([this] { IDDefNumber(&vector, "Slewing to %s", "M42"); });
+    EXPECT_NE(output.find("message='Slewing to M42'"), std::string::npos);
+    EXPECT_EQ(define().find("message="), std::string::npos);
+}
+
+TEST_F(DefCacheTest, Test_timestamp)
+{
+    define();
+    std::string output = captureStdout([this] { IDDefNumber(&vector, nullptr); });
+
+    // The cached message gets the time it is sent at
+    std::cmatch match;
+    ASSERT_TRUE(std::regex_search(output.c_str(), match, std::regex("timestamp='([^']*)'")));
+    EXPECT_EQ(match[1].length(), 19);
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "fitswriter.h"
+#include "sharedblob.h"
+
+#include <gtest/gtest.h>
+#include <fitsio.h>
+
+#include <string>
+#include <vector>
+
+// Reads back the samples of a file made by FITSImageWriter with cfitsio
+template <typename T>
+static std::vector<T> readBack(void *data, size_t size, int type, size_t count, std::string &object)
+{
+    fitsfile *fptr = nullptr;
+    int status = 0;
+    fits_open_memfile(&fptr, "test.fits", READONLY, &data, &size, 0, nullptr, &status);
+    EXPECT_EQ(status, 0);
+
+    std::vector<T> samples(count);
+    int anynul = 0;
+    fits_read_img(fptr, type, 1, count, nullptr, samples.data(), &anynul, &status);
+    char value[FLEN_VALUE] = "";
+    fits_read_key(fptr, TSTRING, "OBJECT", value, nullptr, &status);
+    object = value;
+    EXPECT_EQ(status, 0);
+    fits_close_file(fptr, &status);
+    return samples;
+}
+
+template <typename T>
+static void roundTrip(int bpp, int type, uint32_t channels)
+{
+    const uint32_t width = 37, height = 11;
+    std::vector<T> pixels(width * height * channels);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = static_cast<T>(i * 2654435761u);
+
+    int status = 0;
+    INDI::FITSImageWriter fits(width, height, channels, bpp);
+    fits.setCards({ INDI::FITSImageWriter::card(INDI::FITSRecord("OBJECT", "M 42", "Object name"), status) });
+    ASSERT_EQ(status, 0);
+
+    void *data = nullptr;
+    size_t size = 0;
+    ASSERT_TRUE(fits.write(pixels.data(), &data, &size));
+    EXPECT_EQ(size % 2880, 0u);
+
+    std::string object;
+    EXPECT_EQ(readBack<T>(data, size, type, pixels.size(), object), pixels);
+    EXPECT_EQ(object, "M 42");
+    IDSharedBlobFree(data);
+}
+
+TEST(FITSImageWriterTest, Test_8bit)
+{
+    roundTrip<uint8_t>(8, TBYTE, 1);
+}
+
+TEST(FITSImageWriterTest, Test_16bit)
+{
+    roundTrip<uint16_t>(16, TUSHORT, 1);
+}
+
+TEST(FITSImageWriterTest, Test_32bit)
+{
+    roundTrip<uint32_t>(32, TUINT, 1);
+}
+
+TEST(FITSImageWriterTest, Test_RGB)
+{
+    roundTrip<uint16_t>(16, TUSHORT, 3);
+}
+
+TEST(FITSImageWriterTest, Test_replacedCard)
+{
+    int status = 0;
+    INDI::FITSImageWriter fits(4, 4, 1, 16);
+    fits.setCards(
+    {
+        INDI::FITSImageWriter::card(INDI::FITSRecord("EXPTIME", 1.0, 6, "Total Exposure Time (s)"), status),
+        INDI::FITSImageWriter::card(INDI::FITSRecord("Sample comment"), status),
+        INDI::FITSImageWriter::card(INDI::FITSRecord("EXPTIME", 2.0, 6, "Total Exposure Time (s)"), status),
+    });
+    ASSERT_EQ(status, 0);
+
+    void *data = nullptr;
+    size_t size = 0;
+    ASSERT_TRUE(fits.write(std::vector<uint16_t>(16).data(), &data, &size));
+
+    std::string header(static_cast<const char *>(data), 2880);
+    EXPECT_EQ(header.find("EXPTIME"), header.rfind("EXPTIME"));
+    EXPECT_NE(header.find("COMMENT Sample comment"), std::string::npos);
+
+    fitsfile *fptr = nullptr;
+    double exptime = 0;
+    fits_open_memfile(&fptr, "test.fits", READONLY, &data, &size, 0, nullptr, &status);
+    fits_read_key(fptr, TDOUBLE, "EXPTIME", &exptime, nullptr, &status);
+    fits_close_file(fptr, &status);
+    EXPECT_EQ(status, 0);
+    EXPECT_DOUBLE_EQ(exptime, 2.0);
+    IDSharedBlobFree(data);
+}
+
+TEST(FITSImageWriterTest, Test_unsupported)
+{
+    EXPECT_FALSE(INDI::FITSImageWriter::supported(2, 16));
+    EXPECT_FALSE(INDI::FITSImageWriter::supported(1, 12));
+
+    INDI::FITSImageWriter fits(4, 4, 1, 12);
+    void *data = nullptr;
+    size_t size = 0;
+    EXPECT_FALSE(fits.write(nullptr, &data, &size));
+    EXPECT_FALSE(fits.errorMessage().empty());
+}
@@ -0,0 +1,79 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indifocuserinterface.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// HFR of a star defocused by x - focus steps, with a slope in pixels per step and a seeing floor
+static double hyperbola(double x, double focus, double slope, double seeing)
+{
+    return std::sqrt(slope * slope * (x - focus) * (x - focus) + seeing * seeing);
+}
+
+TEST(FocusCurveTest, Test_exactCurve)
+{
+    std::vector<double> positions, hfrs;
+    for (int i = 0; i < 9; i++)
+    {
+        positions.push_back(20000 + i * 100);
+        hfrs.push_back(hyperbola(positions.back(), 20330, 0.01, 1.8));
+    }
+
+    double best = 0, hfr = 0;
+    ASSERT_TRUE(INDI::fitFocusCurve(positions, hfrs, best, hfr));
+    EXPECT_NEAR(best, 20330, 0.5);
+    EXPECT_NEAR(hfr, 1.8, 0.01);
+}
+
+TEST(FocusCurveTest, Test_noisyCurve)
+{
+    srand(1);
+    std::vector<double> positions, hfrs;
+    for (int i = 0; i < 11; i++)
+    {
+        positions.push_back(5000 + i * 50);
+        // 3% of measure noise
+        hfrs.push_back(hyperbola(positions.back(), 5210, 0.02, 2.5) * (1 + 0.03 * (rand() / double(RAND_MAX) - 0.5)));
+    }
+
+    double best = 0, hfr = 0;
+    ASSERT_TRUE(INDI::fitFocusCurve(positions, hfrs, best, hfr));
+    EXPECT_NEAR(best, 5210, 15);
+    EXPECT_NEAR(hfr, 2.5, 0.2);
+}
+
+TEST(FocusCurveTest, Test_notBracketed)
+{
+    // All the points on one side of the focus
+    std::vector<double> positions, hfrs;
+    for (int i = 0; i < 7; i++)
+    {
+        positions.push_back(1000 + i * 100);
+        hfrs.push_back(hyperbola(positions.back(), 3000, 0.01, 2));
+    }
+
+    double best = 0, hfr = 0;
+    EXPECT_FALSE(INDI::fitFocusCurve(positions, hfrs, best, hfr));
+
+    // Too few points, and a flat curve
+    EXPECT_FALSE(INDI::fitFocusCurve({1, 2, 3}, {3, 2, 3}, best, hfr));
+    EXPECT_FALSE(INDI::fitFocusCurve({1, 2, 3, 4, 5}, {2, 2, 2, 2, 2}, best, hfr));
+}
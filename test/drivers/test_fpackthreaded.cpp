@@ -0,0 +1,176 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// fpack.h uses the cfitsio types without including it
+#include <fitsio.h>
+#include "fpack/fpack.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// A single image FITS file in memory, as the CCD upload path hands it to fpack
+template <typename T>
+static std::vector<char> makeImage(int bitpix, int type, const std::vector<long> &naxes, const std::vector<T> &pixels)
+{
+    size_t size = 2880;
+    void *data = malloc(size);
+    fitsfile *fptr = nullptr;
+    int status = 0;
+    fits_create_memfile(&fptr, &data, &size, 2880, realloc, &status);
+    std::vector<long> axes = naxes;
+    fits_create_img(fptr, bitpix, static_cast<int>(axes.size()), axes.data(), &status);
+    fits_write_key_str(fptr, "OBJECT", "M 42", "Object name", &status);
+    fits_write_img(fptr, type, 1, pixels.size(), const_cast<T *>(pixels.data()), &status);
+    fits_close_file(fptr, &status);
+    EXPECT_EQ(status, 0);
+
+    std::vector<char> file(static_cast<char *>(data), static_cast<char *>(data) + size);
+    free(data);
+    return file;
+}
+
+// What cfitsio makes of a packed file: the header of the compressed image and its decompressed pixels
+template <typename T>
+struct Unpacked
+{
+    std::string cmptype, object;
+    long zbitpix {0}, znaxis {0}, ztile1 {0}, ztile2 {0};
+    std::vector<T> pixels;
+};
+
+template <typename T>
+static Unpacked<T> unpack(unsigned char *packed, size_t packedSize, int type, size_t count)
+{
+    Unpacked<T> result;
+    void *data = packed;
+    fitsfile *infptr = nullptr;
+    int status = 0, hdutype = 0, anynul = 0;
+    char value[FLEN_VALUE] = "";
+
+    fits_open_memfile(&infptr, "packed.fits", READONLY, &data, &packedSize, 0, nullptr, &status);
+    fits_movabs_hdu(infptr, 2, &hdutype, &status);
+    EXPECT_EQ(status, 0);
+    EXPECT_TRUE(fits_is_compressed_image(infptr, &status));
+
+    fits_read_key(infptr, TSTRING, "ZCMPTYPE", value, nullptr, &status);
+    result.cmptype = value;
+    fits_read_key(infptr, TLONG, "ZBITPIX", &result.zbitpix, nullptr, &status);
+    fits_read_key(infptr, TLONG, "ZNAXIS", &result.znaxis, nullptr, &status);
+    fits_read_key(infptr, TLONG, "ZTILE1", &result.ztile1, nullptr, &status);
+    fits_read_key(infptr, TLONG, "ZTILE2", &result.ztile2, nullptr, &status);
+    EXPECT_EQ(status, 0);
+
+    size_t size = 2880;
+    void *image = malloc(size);
+    fitsfile *outfptr = nullptr;
+    fits_create_memfile(&outfptr, &image, &size, 2880, realloc, &status);
+    fits_img_decompress(infptr, outfptr, &status);
+    EXPECT_EQ(status, 0);
+
+    result.pixels.resize(count);
+    fits_read_img(outfptr, type, 1, count, nullptr, result.pixels.data(), &anynul, &status);
+    fits_read_key(outfptr, TSTRING, "OBJECT", value, nullptr, &status);
+    result.object = value;
+    EXPECT_EQ(status, 0);
+
+    fits_close_file(outfptr, &status);
+    fits_close_file(infptr, &status);
+    free(image);
+    return result;
+}
+
+// Packs with the threaded path and the regular one, and checks cfitsio reads both back as the original
+template <typename T>
+static void roundTrip(int bitpix, int type, const std::vector<long> &naxes, const std::vector<T> &pixels)
+{
+    std::vector<char> file = makeImage<T>(bitpix, type, naxes, pixels);
+
+    fpstate fpvar;
+    fp_init(&fpvar);
+
+    unsigned char *threaded = nullptr, *single = nullptr;
+    size_t threadedSize = 0, singleSize = 0;
+    int islossless = 0;
+    ASSERT_EQ(fp_pack_data_to_data_threaded(file.data(), file.size(), &threaded, &threadedSize, realloc, fpvar, 3), 0);
+    ASSERT_EQ(fp_pack_data_to_data(file.data(), file.size(), &single, &singleSize, fpvar, &islossless), 0);
+    EXPECT_EQ(threadedSize % 2880, 0u);
+
+    Unpacked<T> fromThreaded = unpack<T>(threaded, threadedSize, type, pixels.size());
+    Unpacked<T> fromSingle = unpack<T>(single, singleSize, type, pixels.size());
+
+    EXPECT_EQ(fromThreaded.cmptype, "RICE_1");
+    EXPECT_EQ(fromThreaded.cmptype, fromSingle.cmptype);
+    EXPECT_EQ(fromThreaded.zbitpix, fromSingle.zbitpix);
+    EXPECT_EQ(fromThreaded.znaxis, fromSingle.znaxis);
+    EXPECT_EQ(fromThreaded.ztile1, fromSingle.ztile1);
+    EXPECT_EQ(fromThreaded.ztile2, fromSingle.ztile2);
+    EXPECT_EQ(fromThreaded.object, "M 42");
+
+    EXPECT_EQ(fromThreaded.pixels, pixels);
+    EXPECT_EQ(fromThreaded.pixels, fromSingle.pixels);
+
+    free(threaded);
+    free(single);
+}
+
+template <typename T>
+static std::vector<T> pattern(size_t count, uint32_t mask)
+{
+    std::vector<T> pixels(count);
+    // smooth enough for Rice to matter, with noise in the low bits
+    for (size_t i = 0; i < count; i++)
+        pixels[i] = static_cast<T>((i / 7 * 13 + ((i * 2654435761u) >> 20)) & mask);
+    return pixels;
+}
+
+TEST(FpackThreadedTest, Test_8bit)
+{
+    roundTrip<uint8_t>(BYTE_IMG, TBYTE, {61, 23}, pattern<uint8_t>(61 * 23, 0xff));
+}
+
+TEST(FpackThreadedTest, Test_16bitUnsigned)
+{
+    // BZERO scaled, as the CCD drivers upload their frames
+    roundTrip<uint16_t>(USHORT_IMG, TUSHORT, {97, 41}, pattern<uint16_t>(97 * 41, 0xffff));
+}
+
+TEST(FpackThreadedTest, Test_16bitSigned)
+{
+    std::vector<int16_t> pixels = pattern<int16_t>(64 * 16, 0xffff);
+    roundTrip<int16_t>(SHORT_IMG, TSHORT, {64, 16}, pixels);
+}
+
+TEST(FpackThreadedTest, Test_32bitColor)
+{
+    // three planes, each row of each plane a tile
+    roundTrip<int32_t>(LONG_IMG, TINT, {33, 9, 3}, pattern<int32_t>(33 * 9 * 3, 0xffffffffu));
+}
+
+TEST(FpackThreadedTest, Test_FloatNotHandled)
+{
+    std::vector<float> pixels(16 * 4, 1.5f);
+    std::vector<char> file = makeImage<float>(FLOAT_IMG, TFLOAT, {16, 4}, pixels);
+
+    fpstate fpvar;
+    fp_init(&fpvar);
+    unsigned char *packed = nullptr;
+    size_t packedSize = 0;
+    EXPECT_EQ(fp_pack_data_to_data_threaded(file.data(), file.size(), &packed, &packedSize, realloc, fpvar, 3), 1);
+    EXPECT_EQ(packed, nullptr);
+}
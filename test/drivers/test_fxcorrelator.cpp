@@ -0,0 +1,172 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "fxcorrelator.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using INDI::FXCorrelator;
+
+static std::vector<std::vector<double>> randomInputs(size_t inputs, size_t count)
+{
+    srand(inputs * count);
+    std::vector<std::vector<double>> samples(inputs, std::vector<double>(count));
+    for (auto &input : samples)
+        for (auto &sample : input)
+            sample = rand() / static_cast<double>(RAND_MAX) - 0.5;
+    return samples;
+}
+
+static std::vector<const double *> pointers(const std::vector<std::vector<double>> &samples)
+{
+    std::vector<const double *> result;
+    for (auto &input : samples)
+        result.push_back(input.data());
+    return result;
+}
+
+// Spectrum of one block by the definition of the discrete Fourier transform
+static std::vector<std::complex<double>> dft(const double *block, size_t size, size_t bins)
+{
+    std::vector<std::complex<double>> result(bins);
+    for (size_t k = 0; k < bins; k++)
+        for (size_t n = 0; n < size; n++)
+            result[k] += block[n] * std::polar(1.0, -2 * M_PI * k * n / size);
+    return result;
+}
+
+TEST(FXCorrelator, Test_baselines)
+{
+    FXCorrelator fx(4, 8);
+    EXPECT_EQ(fx.getBaselines(), 6u);
+    EXPECT_EQ(fx.getBlockSize(), 16u);
+
+    size_t expected = 0;
+    for (size_t a = 0; a < 4; a++)
+        for (size_t b = a + 1; b < 4; b++)
+        {
+            EXPECT_EQ(fx.getBaseline(a, b), expected);
+            EXPECT_EQ(fx.getBaseline(b, a), expected);
+            expected++;
+        }
+}
+
+TEST(FXCorrelator, Test_reference)
+{
+    const size_t inputs = 3, lags = 8, blocks = 5;
+    FXCorrelator fx(inputs, lags);
+    auto samples = randomInputs(inputs, blocks * 2 * lags + 3);
+    auto data = pointers(samples);
+
+    // the 3 samples short of a block are left out
+    EXPECT_EQ(fx.accumulate(data.data(), samples[0].size()), blocks);
+    EXPECT_EQ(fx.getBlocks(), blocks);
+
+    for (size_t a = 0; a < inputs; a++)
+        for (size_t b = a + 1; b < inputs; b++)
+        {
+            std::vector<std::complex<double>> expected(lags);
+            for (size_t block = 0; block < blocks; block++)
+            {
+                auto x = dft(samples[a].data() + block * 2 * lags, 2 * lags, lags);
+                auto y = dft(samples[b].data() + block * 2 * lags, 2 * lags, lags);
+                for (size_t k = 0; k < lags; k++)
+                    expected[k] += x[k] * std::conj(y[k]) / static_cast<double>(blocks);
+            }
+
+            auto visibilities = fx.getVisibilities(fx.getBaseline(a, b));
+            ASSERT_EQ(visibilities.size(), 2 * lags);
+            for (size_t k = 0; k < lags; k++)
+            {
+                EXPECT_NEAR(visibilities[2 * k], expected[k].real(), 1e-9) << a << "-" << b << " channel " << k;
+                EXPECT_NEAR(visibilities[2 * k + 1], expected[k].imag(), 1e-9) << a << "-" << b << " channel " << k;
+            }
+        }
+
+    fx.reset();
+    EXPECT_EQ(fx.getBlocks(), 0u);
+    for (double value : fx.getVisibilities())
+        EXPECT_EQ(value, 0.0);
+}
+
+TEST(FXCorrelator, Test_delay)
+{
+    // A tone delayed by some samples on the second input turns the phase of its channel
+    const size_t lags = 64, channel = 5, delay = 3, size = 2 * lags;
+    std::vector<std::vector<double>> samples(2, std::vector<double>(4 * size));
+    for (size_t n = 0; n < samples[0].size(); n++)
+    {
+        samples[0][n] = cos(2 * M_PI * channel * n / size);
+        samples[1][n] = cos(2 * M_PI * channel * (n - static_cast<double>(delay)) / size);
+    }
+
+    FXCorrelator fx(2, lags);
+    auto data = pointers(samples);
+    fx.accumulate(data.data(), samples[0].size());
+
+    auto visibilities = fx.getVisibilities(0);
+    double phase = atan2(visibilities[2 * channel + 1], visibilities[2 * channel]);
+    EXPECT_NEAR(phase, 2 * M_PI * channel * delay / size, 1e-9);
+    EXPECT_NEAR(hypot(visibilities[2 * channel], visibilities[2 * channel + 1]), lags * lags, 1e-6);
+    EXPECT_NEAR(visibilities[2 * (channel + 1)], 0.0, 1e-6);
+}
+
+TEST(FXCorrelator, Test_threads_and_batches)
+{
+    // Baselines are accumulated block after block whatever the threads and calls, bit for bit
+    const size_t inputs = 6, lags = 256, blocks = 70;
+    auto samples = randomInputs(inputs, blocks * 2 * lags);
+    auto data = pointers(samples);
+
+    FXCorrelator single(inputs, lags), parallel(inputs, lags), split(inputs, lags);
+    single.setThreads(1);
+    parallel.setThreads(4);
+    single.accumulate(data.data(), samples[0].size());
+    parallel.accumulate(data.data(), samples[0].size());
+
+    size_t half = 33 * 2 * lags;
+    split.accumulate(data.data(), half);
+    std::vector<const double *> rest;
+    for (auto pointer : data)
+        rest.push_back(pointer + half);
+    split.accumulate(rest.data(), samples[0].size() - half);
+
+    EXPECT_EQ(split.getBlocks(), blocks);
+    EXPECT_EQ(single.getVisibilities(), parallel.getVisibilities());
+    EXPECT_EQ(single.getVisibilities(), split.getVisibilities());
+}
+
+TEST(FXCorrelator, Test_correlate_time)
+{
+    const size_t inputs = 8, lags = 1024, blocks = 256;
+    auto samples = randomInputs(inputs, blocks * 2 * lags);
+    auto data = pointers(samples);
+    FXCorrelator fx(inputs, lags);
+
+    auto start = std::chrono::steady_clock::now();
+    fx.accumulate(data.data(), samples[0].size());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%zu inputs, %zu baselines, %zu lags: %.2f ms for %.3f Msamples per input\n", inputs, fx.getBaselines(), lags,
+           ms, blocks * 2 * lags / 1e6);
+}
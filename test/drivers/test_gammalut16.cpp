@@ -0,0 +1,130 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "stream/gammalut16.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// The curve GammaLut16 used to look up on all 65536 values
+static std::vector<uint8_t> legacyLookUpTable(double gamma = 2.4, double a = 12.92, double b = 0.055,
+        double Ii = 0.00304)
+{
+    std::vector<uint8_t> table(65536);
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        double I = i / 65535.0;
+        double p = I <= Ii ? a * I : (1 + b) * powf(I, 1.0 / gamma) - b;
+        table[i] = round(255.0 * p);
+    }
+    return table;
+}
+
+TEST(GAMMALUT16, Test_apply)
+{
+    auto legacy = legacyLookUpTable();
+    std::vector<uint16_t> source(65536 + 13);
+    for (size_t i = 0; i < source.size(); i++)
+        source[i] = i;
+
+    GammaLut16 gammaLut16;
+    // odd counts and offsets to run the SIMD loops and the tails
+    for (size_t offset : {0, 1, 7})
+    {
+        std::vector<uint8_t> destination(source.size() - offset);
+        gammaLut16.apply(source.data() + offset, destination.size(), destination.data());
+        for (size_t i = 0; i < destination.size(); i++)
+            ASSERT_NEAR(destination[i], legacy[source[i + offset]], 1) << "at " << source[i + offset];
+    }
+}
+
+TEST(GAMMALUT16, Test_setLevels)
+{
+    GammaLut16 gammaLut16;
+    gammaLut16.setLevels(1000, 3000);
+
+    std::vector<uint16_t> source = {0, 999, 1000, 2000, 3000, 3001, 65535, 1500, 2500, 1000, 1001, 2999, 3000, 0, 65535, 42, 2000};
+    std::vector<uint8_t> destination(source.size());
+    gammaLut16.apply(source.data(), source.size(), destination.data());
+
+    auto legacy = legacyLookUpTable();
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        uint16_t stretched = std::min(65535.0, std::max(0.0, (source[i] - 1000.0) * 65535.0 / 2000.0));
+        ASSERT_NEAR(destination[i], legacy[stretched], 1) << "at " << source[i];
+    }
+
+    gammaLut16.resetLevels();
+    EXPECT_EQ(gammaLut16.black(), 0);
+    EXPECT_EQ(gammaLut16.white(), 65535);
+}
+
+TEST(GAMMALUT16, Test_autoLevels)
+{
+    // Faint background around 2000 with a few saturated stars, in a 100 wide window of a 120 wide frame
+    const size_t width = 100, height = 80, stride = 120;
+    std::vector<uint16_t> frame(stride * height, 65535);
+    srand(width * height);
+    for (size_t y = 0; y < height; y++)
+        for (size_t x = 0; x < width; x++)
+            frame[y * stride + x] = (x * y) % 97 == 1 ? 60000 : 2000 + rand() % 200;
+
+    GammaLut16 gammaLut16;
+    gammaLut16.autoLevels(frame.data(), width, height, stride);
+    EXPECT_GE(gammaLut16.black(), 1984);
+    EXPECT_LE(gammaLut16.black(), 2016);
+    EXPECT_GE(gammaLut16.white(), 60000);
+    EXPECT_LT(gammaLut16.white(), 65535);
+
+    // Levels move towards a brighter background without jumping to it
+    for (auto &value : frame)
+        value = std::min(65535, value + 10000);
+    uint16_t black = gammaLut16.black();
+    gammaLut16.autoLevels(frame.data(), width, height, stride);
+    EXPECT_GT(gammaLut16.black(), black);
+    EXPECT_LT(gammaLut16.black(), black + 10000);
+}
+
+TEST(GAMMALUT16, Test_apply_time)
+{
+    const size_t pixels = 3840 * 2160;
+    std::vector<uint16_t> frame(pixels);
+    for (size_t i = 0; i < frame.size(); i++)
+        frame[i] = (i * 2654435761u) >> 16;
+
+    auto legacy = legacyLookUpTable();
+    std::vector<uint8_t> expected(pixels), destination(pixels);
+    GammaLut16 gammaLut16;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pixels; i++)
+        expected[i] = legacy[frame[i]];
+    auto scalar = std::chrono::steady_clock::now();
+    gammaLut16.apply(frame.data(), pixels, destination.data());
+    auto simd = std::chrono::steady_clock::now();
+
+    printf("gamma %zu pixels: legacy %.1f ms, now %.1f ms\n", pixels,
+           std::chrono::duration<double, std::milli>(scalar - start).count(),
+           std::chrono::duration<double, std::milli>(simd - scalar).count());
+
+    for (size_t i = 0; i < pixels; i++)
+        ASSERT_NEAR(destination[i], expected[i], 1) << "at " << frame[i];
+}
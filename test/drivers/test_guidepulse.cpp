@@ -0,0 +1,166 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "defaultdevice.h"
+#include "indiguiderinterface.h"
+#include "eventloop.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+class PulseGuider : public INDI::DefaultDevice, public INDI::GuiderInterface
+{
+    public:
+        PulseGuider() : GI(this) {}
+
+        const char *getDefaultName() override
+        {
+            return "Pulse Guider";
+        }
+
+        bool initProperties() override
+        {
+            INDI::DefaultDevice::initProperties();
+            GI::initProperties(MAIN_CONTROL_TAB);
+            return true;
+        }
+
+        IPState GuideNorth(uint32_t ms) override
+        {
+            return pulse(AXIS_DE, ms);
+        }
+        IPState GuideSouth(uint32_t ms) override
+        {
+            return pulse(AXIS_DE, ms);
+        }
+        IPState GuideEast(uint32_t ms) override
+        {
+            return pulse(AXIS_RA, ms);
+        }
+        IPState GuideWest(uint32_t ms) override
+        {
+            return pulse(AXIS_RA, ms);
+        }
+
+        void GuideComplete(INDI_EQ_AXIS axis) override
+        {
+            GI::GuideComplete(axis);
+            completed[axis]++;
+        }
+
+        IPState pulse(INDI_EQ_AXIS axis, uint32_t ms)
+        {
+            started[axis] = Clock::now();
+            scheduleGuideStop(axis, ms, [this, axis]()
+            {
+                stopped[axis] = Clock::now();
+                stops[axis]++;
+            });
+            return IPS_BUSY;
+        }
+
+        // Milliseconds the pulse on axis lasted
+        double duration(INDI_EQ_AXIS axis) const
+        {
+            return std::chrono::duration<double, std::milli>(stopped[axis] - started[axis]).count();
+        }
+
+        double applied(INDI_EQ_AXIS axis) const
+        {
+            return GuidePulseAppliedNP[axis].getValue();
+        }
+
+        using GI::cancelGuideStop;
+        using GI::isGuidePending;
+
+        Clock::time_point started[2], stopped[2];
+        int stops[2] {}, completed[2] {};
+};
+
+// Runs the event loop until the guider has completed count pulses on axis
+static bool waitCompleted(PulseGuider &guider, INDI_EQ_AXIS axis, int count)
+{
+    for (int i = 0; i < 20 && guider.completed[axis] < count; i++)
+    {
+        int timedOut = 0;
+        IEAddTimer(10, [](void *p)
+        {
+            *static_cast<int *>(p) = 1;
+        }, &timedOut);
+        IEDeferLoop(1000, &timedOut);
+    }
+    return guider.completed[axis] == count;
+}
+
+TEST(GuidePulseTest, Test_busyEventLoop)
+{
+    PulseGuider guider;
+    guider.initProperties();
+
+    guider.GuideNorth(20);
+    EXPECT_TRUE(guider.isGuidePending(AXIS_DE));
+    // The event loop is busy for longer than the pulse
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+
+    ASSERT_TRUE(waitCompleted(guider, AXIS_DE, 1));
+    EXPECT_EQ(guider.stops[AXIS_DE], 1);
+    EXPECT_GE(guider.duration(AXIS_DE), 20);
+    EXPECT_LT(guider.duration(AXIS_DE), 25);
+    EXPECT_FALSE(guider.isGuidePending(AXIS_DE));
+    EXPECT_GE(guider.applied(AXIS_DE), 20);
+    EXPECT_LT(guider.applied(AXIS_DE), 25);
+}
+
+TEST(GuidePulseTest, Test_axes)
+{
+    PulseGuider guider;
+    guider.initProperties();
+
+    guider.GuideWest(30);
+    guider.GuideSouth(5);
+    ASSERT_TRUE(waitCompleted(guider, AXIS_RA, 1));
+    ASSERT_TRUE(waitCompleted(guider, AXIS_DE, 1));
+
+    EXPECT_LT(guider.stopped[AXIS_DE], guider.stopped[AXIS_RA]);
+    EXPECT_GE(guider.duration(AXIS_DE), 5);
+    EXPECT_LT(guider.duration(AXIS_DE), 10);
+    EXPECT_GE(guider.duration(AXIS_RA), 30);
+    EXPECT_LT(guider.duration(AXIS_RA), 35);
+}
+
+TEST(GuidePulseTest, Test_replaceAndCancel)
+{
+    PulseGuider guider;
+    guider.initProperties();
+
+    // A new pulse replaces the pending one
+    guider.GuideEast(50);
+    guider.GuideEast(10);
+    ASSERT_TRUE(waitCompleted(guider, AXIS_RA, 1));
+    EXPECT_EQ(guider.stops[AXIS_RA], 1);
+    EXPECT_LT(guider.duration(AXIS_RA), 15);
+
+    guider.GuideNorth(10);
+    guider.cancelGuideStop(AXIS_DE);
+    EXPECT_FALSE(guider.isGuidePending(AXIS_DE));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_FALSE(waitCompleted(guider, AXIS_DE, 1));
+    EXPECT_EQ(guider.stops[AXIS_DE], 0);
+}
@@ -0,0 +1,79 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indiccdchip.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// A gaussian star of the given sigma on a noisy sky
+template <typename T>
+static std::vector<T> makeBox(uint32_t size, double x, double y, double sigma, double peak, double sky, double noise)
+{
+    std::vector<T> box(size * size);
+    srand(size);
+    for (uint32_t row = 0; row < size; row++)
+        for (uint32_t column = 0; column < size; column++)
+        {
+            double r2 = (column - x) * (column - x) + (row - y) * (row - y);
+            double value = sky + peak * std::exp(-r2 / (2 * sigma * sigma));
+            // roughly gaussian noise of the given deviation, from the sum of three uniform draws
+            value += noise * 2 * ((static_cast<double>(rand()) + rand() + rand()) / RAND_MAX - 1.5);
+            box[row * size + column] = static_cast<T>(std::max(0.0, std::round(value)));
+        }
+    return box;
+}
+
+TEST(GUIDE_STAR, Test_centroid)
+{
+    auto box = makeBox<uint16_t>(32, 14.3, 17.8, 1.5, 20000, 1000, 20);
+
+    INDI::GuideStar star;
+    ASSERT_TRUE(INDI::findGuideStar(reinterpret_cast<const uint8_t *>(box.data()), 32, 32, 16, star));
+    EXPECT_NEAR(star.x, 14.3, 0.05);
+    EXPECT_NEAR(star.y, 17.8, 0.05);
+    EXPECT_NEAR(star.background, 1000, 5);
+    // Mean radius of a gaussian is sigma * sqrt(pi / 2), a little less without its faint wings
+    EXPECT_GT(star.hfr, 1.5);
+    EXPECT_LT(star.hfr, 1.5 * std::sqrt(M_PI / 2) + 0.05);
+    EXPECT_GT(star.snr, 100);
+}
+
+TEST(GUIDE_STAR, Test_faint)
+{
+    auto bright = makeBox<uint8_t>(24, 11, 12, 1.2, 200, 20, 3);
+    auto faint  = makeBox<uint8_t>(24, 11, 12, 1.2, 30, 20, 3);
+
+    INDI::GuideStar brightStar, faintStar;
+    ASSERT_TRUE(INDI::findGuideStar(bright.data(), 24, 24, 8, brightStar));
+    ASSERT_TRUE(INDI::findGuideStar(faint.data(), 24, 24, 8, faintStar));
+    EXPECT_NEAR(faintStar.x, 11, 0.3);
+    EXPECT_NEAR(faintStar.y, 12, 0.3);
+    EXPECT_GT(brightStar.snr, faintStar.snr);
+}
+
+TEST(GUIDE_STAR, Test_no_star)
+{
+    std::vector<uint16_t> sky(32 * 32, 1000);
+    INDI::GuideStar star;
+    EXPECT_FALSE(INDI::findGuideStar(reinterpret_cast<const uint8_t *>(sky.data()), 32, 32, 16, star));
+
+    EXPECT_FALSE(INDI::findGuideStar(reinterpret_cast<const uint8_t *>(sky.data()), 4, 32, 16, star));
+    EXPECT_FALSE(INDI::findGuideStar(reinterpret_cast<const uint8_t *>(sky.data()), 32, 32, 12, star));
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+
+#include "handlerprofile.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+TEST(HANDLER_PROFILE, Test_report)
+{
+    INDI::HandlerProfile profile;
+    EXPECT_TRUE(profile.report().empty());
+
+    // 99 fast calls and a slow one
+    for (int i = 0; i < 99; i++)
+        profile.add("ISNewNumber FAST", 0.003);
+    profile.add("ISNewNumber FAST", 40);
+    profile.add("TimerHit", 100);
+    profile.add("TimerHit", 150);
+
+    auto report = profile.report();
+    ASSERT_EQ(report.size(), 2u);
+
+    // the most total time first
+    EXPECT_EQ(report[0].handler, "TimerHit");
+    EXPECT_EQ(report[0].count, 2u);
+    EXPECT_DOUBLE_EQ(report[0].total, 250);
+    EXPECT_DOUBLE_EQ(report[0].max, 150);
+    // 100 ms falls in the bucket up to 2^17 us
+    EXPECT_DOUBLE_EQ(report[0].median, 131.072);
+
+    // percentiles are the upper bound of their bucket of microseconds, the median of 3 us is under 4 us
+    EXPECT_EQ(report[1].handler, "ISNewNumber FAST");
+    EXPECT_EQ(report[1].count, 100u);
+    EXPECT_DOUBLE_EQ(report[1].median, 0.004);
+    EXPECT_DOUBLE_EQ(report[1].p99, 0.004);
+    EXPECT_DOUBLE_EQ(report[1].max, 40);
+
+    profile.reset();
+    EXPECT_TRUE(profile.report().empty());
+}
+
+TEST(HANDLER_PROFILE, Test_scope)
+{
+    INDI::HandlerProfile profile;
+    {
+        INDI::HandlerProfile::Scope scope(&profile, "ISNewSwitch", "CONNECTION");
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    {
+        // nothing is timed without a profile
+        INDI::HandlerProfile::Scope scope(nullptr, "TimerHit");
+    }
+
+    auto report = profile.report();
+    ASSERT_EQ(report.size(), 1u);
+    EXPECT_EQ(report[0].handler, "ISNewSwitch CONNECTION");
+    EXPECT_EQ(report[0].count, 1u);
+    EXPECT_GE(report[0].max, 5);
+}
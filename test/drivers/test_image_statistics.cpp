@@ -0,0 +1,99 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indiccdchip.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+template <typename T>
+static void checkStatistics(uint32_t width, uint32_t height, uint32_t range)
+{
+    std::vector<T> frame(static_cast<size_t>(width) * height);
+    srand(width * height);
+    for (auto &pixel : frame)
+        pixel = static_cast<T>(static_cast<uint64_t>(rand()) * rand() % range);
+
+    INDI::ImageStatistics stats;
+    ASSERT_TRUE(INDI::computeImageStatistics(reinterpret_cast<const uint8_t *>(frame.data()), width, height,
+                8 * sizeof(T), stats));
+
+    std::vector<T> sorted(frame);
+    std::sort(sorted.begin(), sorted.end());
+    double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    double squares = 0;
+    for (auto pixel : sorted)
+        squares += (pixel - mean) * (pixel - mean);
+
+    EXPECT_EQ(stats.min, sorted.front());
+    EXPECT_EQ(stats.max, sorted.back());
+    EXPECT_NEAR(stats.mean, mean, 1e-6 * std::max(1.0, mean));
+    EXPECT_NEAR(stats.stddev, std::sqrt(squares / sorted.size()), 1e-6 * std::max(1.0, mean));
+    if (sizeof(T) < 4)
+        EXPECT_EQ(stats.median, sorted[(sorted.size() - 1) / 2]);
+    else
+        EXPECT_NEAR(stats.median, sorted[(sorted.size() - 1) / 2], 65536);
+
+    ASSERT_EQ(stats.histogram.size(), 256u);
+    EXPECT_EQ(std::accumulate(stats.histogram.begin(), stats.histogram.end(), uint64_t(0)), frame.size());
+}
+
+TEST(IMAGE_STATISTICS, Test_computeImageStatistics)
+{
+    checkStatistics<uint8_t>(641, 479, 256);
+    checkStatistics<uint16_t>(641, 479, 65536);
+    checkStatistics<uint16_t>(1000, 1000, 4000);
+    checkStatistics<uint32_t>(641, 479, 4000000000u);
+}
+
+TEST(IMAGE_STATISTICS, Test_histogram)
+{
+    // 0..99 once each over 100 bins of the 8 bit histogram
+    std::vector<uint8_t> frame(100);
+    std::iota(frame.begin(), frame.end(), 0);
+
+    INDI::ImageStatistics stats;
+    ASSERT_TRUE(INDI::computeImageStatistics(frame.data(), 10, 10, 8, stats, 100));
+    EXPECT_EQ(stats.min, 0);
+    EXPECT_EQ(stats.max, 99);
+    EXPECT_EQ(stats.median, 49);
+    for (auto count : stats.histogram)
+        EXPECT_EQ(count, 1u);
+
+    EXPECT_FALSE(INDI::computeImageStatistics(frame.data(), 10, 10, 12, stats));
+    EXPECT_FALSE(INDI::computeImageStatistics(frame.data(), 0, 10, 8, stats));
+}
+
+TEST(IMAGE_STATISTICS, Test_computeImageStatistics_time)
+{
+    const uint32_t width = 9576, height = 6388;
+    std::vector<uint16_t> frame(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < frame.size(); i++)
+        frame[i] = (i * 2654435761u) >> 20;
+
+    INDI::ImageStatistics stats;
+    auto start = std::chrono::steady_clock::now();
+    INDI::computeImageStatistics(reinterpret_cast<const uint8_t *>(frame.data()), width, height, 16, stats);
+    auto end = std::chrono::steady_clock::now();
+    printf("statistics %ux%u 16 bits: %.1f ms\n", width, height, std::chrono::duration<double, std::milli>(end - start).count());
+}
@@ -0,0 +1,161 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "imagepreview.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <jpeglib.h>
+
+struct Decoded
+{
+    uint32_t width {0};
+    uint32_t height {0};
+    int components {0};
+    std::vector<uint8_t> pixels;
+};
+
+static Decoded decode(const std::vector<uint8_t> &jpeg)
+{
+    Decoded decoded;
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, const_cast<unsigned char *>(jpeg.data()), jpeg.size());
+    jpeg_read_header(&cinfo, TRUE);
+    jpeg_start_decompress(&cinfo);
+    decoded.width = cinfo.output_width;
+    decoded.height = cinfo.output_height;
+    decoded.components = cinfo.output_components;
+    decoded.pixels.resize(size_t(decoded.width) * decoded.height * decoded.components);
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        JSAMPROW row = decoded.pixels.data() + size_t(cinfo.output_scanline) * decoded.width * decoded.components;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return decoded;
+}
+
+// A faint sky with some noise and a few saturated stars
+template <typename T>
+static std::vector<T> skyFrame(uint32_t width, uint32_t height, uint32_t channels, int sky, int noise, int star)
+{
+    std::vector<T> frame(size_t(width) * height * channels);
+    for (auto &pixel : frame)
+        pixel = static_cast<T>(sky + rand() % (noise + 1));
+    for (uint32_t c = 0; c < channels; c++)
+        for (int i = 0; i < 20; i++)
+        {
+            uint32_t x = rand() % (width - 8), y = rand() % (height - 8);
+            for (uint32_t dy = 0; dy < 8; dy++)
+                for (uint32_t dx = 0; dx < 8; dx++)
+                    frame[c * size_t(width) * height + (y + dy) * width + x + dx] = static_cast<T>(star);
+        }
+    return frame;
+}
+
+static uint8_t median(std::vector<uint8_t> values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+TEST(ImagePreviewTest, Test_binnedAndStretched)
+{
+    srand(1);
+    auto frame = skyFrame<uint16_t>(1600, 1200, 1, 1000, 200, 60000);
+
+    INDI::ImagePreview preview(1600, 1200, 1, 16);
+    preview.setMaxWidth(400);
+    std::vector<uint8_t> jpeg;
+    ASSERT_TRUE(preview.encode(frame.data(), jpeg));
+    EXPECT_EQ(preview.previewWidth(), 400u);
+    EXPECT_EQ(preview.previewHeight(), 300u);
+
+    auto decoded = decode(jpeg);
+    EXPECT_EQ(decoded.width, 400u);
+    EXPECT_EQ(decoded.height, 300u);
+    EXPECT_EQ(decoded.components, 1);
+
+    // The sky, a few percent of the range, is brought to a quarter of it, the stars stay white
+    EXPECT_NEAR(median(decoded.pixels), 64, 8);
+    EXPECT_GE(*std::max_element(decoded.pixels.begin(), decoded.pixels.end()), 250);
+
+    // Orders of magnitude smaller than the frame
+    EXPECT_LT(jpeg.size() * 50, frame.size() * sizeof(uint16_t));
+}
+
+TEST(ImagePreviewTest, Test_bayerBinsWholeCells)
+{
+    srand(2);
+    std::vector<uint8_t> jpeg;
+
+    // A factor of 3 would mix the colours of neighbour cells
+    auto frame = skyFrame<uint16_t>(2100, 600, 1, 500, 50, 30000);
+    INDI::ImagePreview preview(2100, 600, 1, 16);
+    preview.setMaxWidth(800);
+    preview.setBayer(true);
+    ASSERT_TRUE(preview.encode(frame.data(), jpeg));
+    EXPECT_EQ(preview.previewWidth(), 525u);
+    EXPECT_EQ(preview.previewHeight(), 150u);
+
+    // And a frame narrower than the preview is still binned 2x2
+    INDI::ImagePreview small(640, 480, 1, 16);
+    small.setMaxWidth(800);
+    small.setBayer(true);
+    ASSERT_TRUE(small.encode(frame.data(), jpeg));
+    EXPECT_EQ(decode(jpeg).width, 320u);
+}
+
+TEST(ImagePreviewTest, Test_colour)
+{
+    srand(3);
+    auto frame = skyFrame<uint8_t>(300, 200, 3, 20, 10, 255);
+
+    INDI::ImagePreview preview(300, 200, 3, 8);
+    preview.setMaxWidth(800);
+    preview.setQuality(90);
+    std::vector<uint8_t> jpeg;
+    ASSERT_TRUE(preview.encode(frame.data(), jpeg));
+
+    auto decoded = decode(jpeg);
+    EXPECT_EQ(decoded.width, 300u);
+    EXPECT_EQ(decoded.height, 200u);
+    EXPECT_EQ(decoded.components, 3);
+    EXPECT_NEAR(median(decoded.pixels), 64, 12);
+}
+
+TEST(ImagePreviewTest, Test_unsupported)
+{
+    std::vector<uint16_t> frame(64 * 64, 100);
+    std::vector<uint8_t> jpeg;
+
+    EXPECT_FALSE(INDI::ImagePreview::supported(2, 16));
+    EXPECT_FALSE(INDI::ImagePreview::supported(1, 12));
+    EXPECT_FALSE(INDI::ImagePreview(64, 64, 1, 12).encode(frame.data(), jpeg));
+    EXPECT_FALSE(INDI::ImagePreview(0, 64, 1, 16).encode(frame.data(), jpeg));
+
+    // A flat frame has nothing to stretch, but still makes a preview
+    EXPECT_TRUE(INDI::ImagePreview(64, 64, 1, 16).encode(frame.data(), jpeg));
+}
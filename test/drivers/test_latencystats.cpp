@@ -0,0 +1,54 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "stream/latencystats.h"
+
+#include <gtest/gtest.h>
+
+TEST(LATENCY_STATS, Test_summary)
+{
+    INDI::LatencyStats stats(100);
+    EXPECT_EQ(stats.summary().count, 0u);
+    EXPECT_EQ(stats.summary().p99, 0);
+
+    // 1..100 shuffled
+    for (int i = 0; i < 100; i++)
+        stats.add((i * 37) % 100 + 1);
+
+    INDI::LatencyStats::Summary summary = stats.summary();
+    EXPECT_EQ(summary.count, 100u);
+    EXPECT_EQ(summary.median, 50);
+    EXPECT_EQ(summary.p99, 99);
+    EXPECT_EQ(summary.max, 100);
+}
+
+TEST(LATENCY_STATS, Test_window)
+{
+    INDI::LatencyStats stats(10);
+    for (int i = 0; i < 10; i++)
+        stats.add(1000);
+    // The latest samples replace the oldest ones
+    for (int i = 0; i < 10; i++)
+        stats.add(i + 1);
+
+    INDI::LatencyStats::Summary summary = stats.summary();
+    EXPECT_EQ(summary.count, 10u);
+    EXPECT_EQ(summary.median, 5);
+    EXPECT_EQ(summary.max, 10);
+
+    stats.reset();
+    EXPECT_EQ(stats.summary().count, 0u);
+}
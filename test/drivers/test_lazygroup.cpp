@@ -0,0 +1,167 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indidevapi.h"
+#include "indidriver.h"
+#include "lilxml.h"
+#include "capturestdout.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+// The driver receives xml from the server
+static int receive(std::string xml)
+{
+    char msg[2048];
+    LilXML *lp = newLilXML();
+    XMLEle **nodes = parseXMLChunk(lp, &xml[0], xml.size(), msg);
+    int result = -1;
+    if (nodes != nullptr && nodes[0] != nullptr)
+    {
+        result = dispatch(nodes[0], msg);
+        for (XMLEle **node = nodes; *node != nullptr; node++)
+            delXMLEle(*node);
+    }
+    free(nodes);
+    delLilXML(lp);
+    return result;
+}
+
+static bool contains(const std::string &output, const std::string &text)
+{
+    return output.find(text) != std::string::npos;
+}
+
+class LazyGroupTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            IUFillNumber(&numbers[0], "GAIN", "Gain", "%.f", 0, 100, 1, 10);
+            IUFillNumberVector(&gain, numbers, 1, "Lazy", "CCD_GAIN", "Gain", "Advanced", IP_RW, 60, IPS_IDLE);
+            IUFillText(&texts[0], "MODE", "Mode", "fast");
+            IUFillTextVector(&mode, texts, 1, "Lazy", "READ_MODE", "Read mode", "Advanced", IP_RW, 60, IPS_IDLE);
+            IUFillNumber(&numbers[1], "TEMP", "Temperature", "%.1f", -50, 50, 0, 20);
+            IUFillNumberVector(&temperature, &numbers[1], 1, "Lazy", "CCD_TEMPERATURE", "Temperature", "Main", IP_RO, 60,
+                               IPS_IDLE);
+            IDSetLazyGroup("Lazy", "Advanced", 1);
+        }
+
+        void TearDown() override
+        {
+            captureStdout([] { IDDelete("Lazy", nullptr, nullptr); });
+        }
+
+        std::string defineAll()
+        {
+            return captureStdout([this]
+            {
+                IDDefNumber(&temperature, nullptr);
+                IDDefNumber(&gain, nullptr);
+                IDDefText(&mode, nullptr);
+            });
+        }
+
+        INumber numbers[2];
+        IText texts[1];
+        INumberVectorProperty gain, temperature;
+        ITextVectorProperty mode;
+};
+
+TEST_F(LazyGroupTest, Test_withheld)
+{
+    std::string output = defineAll();
+    EXPECT_TRUE(contains(output, "name='CCD_TEMPERATURE'"));
+    EXPECT_TRUE(contains(output, "<defSwitchVector"));
+    EXPECT_TRUE(contains(output, "name='LAZY_Advanced'"));
+    EXPECT_FALSE(contains(output, "CCD_GAIN"));
+    EXPECT_FALSE(contains(output, "READ_MODE"));
+
+    // One switch per group, and no updates for what the client does not know
+    EXPECT_FALSE(contains(defineAll(), "LAZY_Advanced"));
+    EXPECT_EQ(captureStdout([this] { IDSetNumber(&gain, nullptr); }), "");
+    EXPECT_NE(captureStdout([this] { IDSetNumber(&temperature, nullptr); }), "");
+}
+
+TEST_F(LazyGroupTest, Test_switch)
+{
+    defineAll();
+    numbers[0].value = 42;
+    std::string output = captureStdout([]
+    {
+        receive("<newSwitchVector device='Lazy' name='LAZY_Advanced'><oneSwitch name='DEFINE'>On</oneSwitch>"
+                "</newSwitchVector>");
+    });
+    EXPECT_TRUE(contains(output, "<delProperty"));
+    EXPECT_TRUE(contains(output, "name='LAZY_Advanced'"));
+    EXPECT_TRUE(contains(output, "name='CCD_GAIN'"));
+    EXPECT_TRUE(contains(output, "42"));
+    EXPECT_TRUE(contains(output, "name='READ_MODE'"));
+    EXPECT_LT(output.find("CCD_GAIN"), output.find("READ_MODE"));
+
+    // From now on the group is like any other
+    EXPECT_NE(captureStdout([this] { IDSetNumber(&gain, nullptr); }), "");
+    output = defineAll();
+    EXPECT_TRUE(contains(output, "name='CCD_GAIN'"));
+    EXPECT_FALSE(contains(output, "LAZY_Advanced"));
+}
+
+TEST_F(LazyGroupTest, Test_getProperties)
+{
+    defineAll();
+    std::string output = captureStdout([] { receive("<getProperties version='1.7' device='Lazy' name='READ_MODE'/>"); });
+    EXPECT_TRUE(contains(output, "name='CCD_GAIN'"));
+    EXPECT_TRUE(contains(output, "name='READ_MODE'"));
+}
+
+TEST_F(LazyGroupTest, Test_lazy_again)
+{
+    defineAll();
+    receive("<getProperties version='1.7' device='Lazy' name='LAZY_Advanced'/>");
+
+    // Once all its properties are deleted, the group is withheld again
+    captureStdout([] { IDDelete("Lazy", "CCD_GAIN", nullptr); IDDelete("Lazy", "READ_MODE", nullptr); });
+    std::string output = captureStdout([this] { IDDefNumber(&gain, nullptr); });
+    EXPECT_TRUE(contains(output, "LAZY_Advanced"));
+    EXPECT_FALSE(contains(output, "CCD_GAIN"));
+
+    // And the switch goes with its last property
+    output = captureStdout([] { IDDelete("Lazy", "CCD_GAIN", nullptr); });
+    EXPECT_TRUE(contains(output, "<delProperty"));
+    EXPECT_TRUE(contains(output, "name='LAZY_Advanced'"));
+}
+
+TEST_F(LazyGroupTest, Test_not_lazy)
+{
+    defineAll();
+    std::string output = captureStdout([] { IDSetLazyGroup("Lazy", "Advanced", 0); });
+    EXPECT_TRUE(contains(output, "name='CCD_GAIN'"));
+    EXPECT_TRUE(contains(output, "name='READ_MODE'"));
+    EXPECT_FALSE(contains(defineAll(), "LAZY_Advanced"));
+}
+
+TEST_F(LazyGroupTest, Test_pingRequest)
+{
+    // indiserver learns the stub is all there is to the group by the reply following it
+    int result = -1;
+    std::string output = defineAll();
+    output += captureStdout([&result] { result = receive("<pingRequest uid='getProperties/1'/>"); });
+    EXPECT_EQ(result, 0);
+    EXPECT_TRUE(contains(output, "<pingReply uid='getProperties/1'"));
+    EXPECT_LT(output.find("LAZY_Advanced"), output.find("pingReply"));
+}
@@ -0,0 +1,126 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indilogger.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using INDI::Logger;
+
+static std::vector<std::string> readLog()
+{
+    std::ifstream in(Logger::getLogFile());
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        // TAG <tab> time sec <tab> : [device] message
+        line = line.substr(line.find(": ") + 2);
+        if (line.compare(0, 7, "[Test] ") == 0)
+            line = line.substr(7);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static size_t indexOf(const std::vector<std::string> &lines, const std::string &message)
+{
+    for (size_t i = 0; i < lines.size(); i++)
+        if (lines[i] == message)
+            return i;
+    return lines.size();
+}
+
+class LoggerTest : public ::testing::Test
+{
+    protected:
+        static void SetUpTestSuite()
+        {
+            char home[] = "/tmp/test_logger_XXXXXX";
+            ASSERT_NE(mkdtemp(home), nullptr);
+            setenv("HOME", home, 1);
+            Logger::getInstance().configure("test_logger", Logger::file_on | Logger::screen_off,
+                                            Logger::defaultlevel | Logger::DBG_DEBUG, 0);
+        }
+};
+
+TEST_F(LoggerTest, Test_debug_before_session)
+{
+    Logger &logger = Logger::getInstance();
+    logger.print("Test", Logger::DBG_DEBUG, __FILE__, __LINE__, "debug %d", 1);
+    logger.print("Test", Logger::DBG_SESSION, __FILE__, __LINE__, "session %d", 1);
+
+    // The session message is written right away, with the debug message before it
+    std::vector<std::string> lines = readLog();
+    size_t debug = indexOf(lines, "debug 1");
+    size_t session = indexOf(lines, "session 1");
+    ASSERT_LT(debug, lines.size());
+    ASSERT_LT(session, lines.size());
+    EXPECT_LT(debug, session);
+}
+
+TEST_F(LoggerTest, Test_threads)
+{
+    Logger &logger = Logger::getInstance();
+    const int threads = 4, messages = 100;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.emplace_back([&logger, t]()
+        {
+            for (int i = 0; i < messages; i++)
+            {
+                logger.print("Test", Logger::DBG_DEBUG, __FILE__, __LINE__, "thread %d message %d", t, i);
+                // Leave the writer time to drain, a full ring drops messages
+                if (i % 50 == 49)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        });
+    for (auto &worker : workers)
+        worker.join();
+    logger.flush();
+
+    std::vector<std::string> lines = readLog();
+    for (int t = 0; t < threads; t++)
+    {
+        size_t last = 0;
+        for (int i = 0; i < messages; i++)
+        {
+            size_t index = indexOf(lines, "thread " + std::to_string(t) + " message " + std::to_string(i));
+            ASSERT_LT(index, lines.size()) << "thread " << t << " message " << i;
+            if (i > 0)
+            {
+                EXPECT_GT(index, last);
+            }
+            last = index;
+        }
+    }
+}
+
+TEST_F(LoggerTest, Test_disabled_level)
+{
+    Logger &logger = Logger::getInstance();
+    logger.print("Test", Logger::DBG_EXTRA_1, __FILE__, __LINE__, "extra %d", 1);
+    logger.flush();
+    std::vector<std::string> lines = readLog();
+    EXPECT_EQ(indexOf(lines, "extra 1"), lines.size());
+}
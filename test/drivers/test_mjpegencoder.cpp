@@ -0,0 +1,90 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "stream/encoder/mjpegencoder.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <vector>
+
+#include <jpeglib.h>
+
+static std::vector<uint8_t> decode(const INDI::WidgetViewBlob &blob, uint32_t *width, uint32_t *height, long *warnings)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, static_cast<const unsigned char *>(blob.getBlob()), blob.getBlobLen());
+    jpeg_read_header(&cinfo, TRUE);
+    jpeg_start_decompress(&cinfo);
+
+    *width = cinfo.output_width;
+    *height = cinfo.output_height;
+    size_t stride = cinfo.output_width * cinfo.output_components;
+    std::vector<uint8_t> pixels(stride * cinfo.output_height);
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        JSAMPROW row = pixels.data() + cinfo.output_scanline * stride;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    *warnings = jerr.num_warnings;
+    jpeg_destroy_decompress(&cinfo);
+    return pixels;
+}
+
+static void checkStrips(INDI_PIXEL_FORMAT format, uint16_t width, uint16_t height)
+{
+    int components = format == INDI_RGB ? 3 : 1;
+    std::vector<uint8_t> frame(width * height * components);
+    for (uint16_t y = 0; y < height; y++)
+        for (uint16_t x = 0; x < width; x++)
+            for (int c = 0; c < components; c++)
+                frame[(y * width + x) * components + c] = (x * 255 / width + y * 255 / height + c * 40) / 2;
+
+    std::vector<uint8_t> decoded[2];
+    for (unsigned threads : {1, 4})
+    {
+        INDI::MJPEGEncoder encoder;
+        encoder.setPixelFormat(format, 8);
+        encoder.setSize(width, height);
+        encoder.setThreads(threads);
+
+        INDI::WidgetViewBlob blob;
+        ASSERT_TRUE(encoder.upload(&blob, frame.data(), frame.size()));
+
+        uint32_t decodedWidth, decodedHeight;
+        long warnings;
+        decoded[threads > 1] = decode(blob, &decodedWidth, &decodedHeight, &warnings);
+        EXPECT_EQ(decodedWidth, width);
+        EXPECT_EQ(decodedHeight, height);
+        // Misplaced restart markers are reported as warnings
+        EXPECT_EQ(warnings, 0);
+    }
+
+    // Strips hold the same blocks as the whole frame
+    EXPECT_TRUE(decoded[0] == decoded[1]);
+}
+
+TEST(MJPEG_ENCODER, Test_strips)
+{
+    checkStrips(INDI_MONO, 1000, 700);
+    checkStrips(INDI_MONO, 600, 517);
+    checkStrips(INDI_RGB, 1000, 700);
+    checkStrips(INDI_RGB, 600, 517);
+}
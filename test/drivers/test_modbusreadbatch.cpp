@@ -0,0 +1,67 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "libs/modbus/readbatch.h"
+
+#include <gtest/gtest.h>
+
+TEST(MODBUS_READ_BATCH, Test_mergeAdjacent)
+{
+    // Relays 0-7, then 8-15 and an overlapping single coil, out of order
+    auto ranges = ModbusReadBatch::plan({{8, 8}, {0, 8}, {3, 1}}, 2000);
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].address, 0);
+    EXPECT_EQ(ranges[0].quantity, 16);
+}
+
+TEST(MODBUS_READ_BATCH, Test_keepGaps)
+{
+    // Addresses in between may not exist on the device
+    auto ranges = ModbusReadBatch::plan({{0, 4}, {10, 2}}, 125);
+    ASSERT_EQ(ranges.size(), 2u);
+    EXPECT_EQ(ranges[0].address, 0);
+    EXPECT_EQ(ranges[0].quantity, 4);
+    EXPECT_EQ(ranges[1].address, 10);
+    EXPECT_EQ(ranges[1].quantity, 2);
+}
+
+TEST(MODBUS_READ_BATCH, Test_splitLongRuns)
+{
+    // 300 registers need three reads of at most 125
+    auto ranges = ModbusReadBatch::plan({{0, 100}, {100, 200}}, 125);
+    ASSERT_EQ(ranges.size(), 3u);
+    EXPECT_EQ(ranges[0].address, 0);
+    EXPECT_EQ(ranges[0].quantity, 125);
+    EXPECT_EQ(ranges[1].address, 125);
+    EXPECT_EQ(ranges[1].quantity, 125);
+    EXPECT_EQ(ranges[2].address, 250);
+    EXPECT_EQ(ranges[2].quantity, 50);
+}
+
+TEST(MODBUS_READ_BATCH, Test_tables)
+{
+    ModbusReadBatch batch;
+    batch.add(ModbusReadBatch::COILS, 0, 8);
+    batch.add(ModbusReadBatch::COILS, 8, 8);
+    batch.add(ModbusReadBatch::DISCRETE_INPUTS, 0, 8);
+    EXPECT_EQ(batch.ranges(ModbusReadBatch::COILS).size(), 1u);
+    EXPECT_EQ(batch.ranges(ModbusReadBatch::DISCRETE_INPUTS).size(), 1u);
+    EXPECT_TRUE(batch.ranges(ModbusReadBatch::HOLDING_REGISTERS).empty());
+
+    // Nothing read yet
+    EXPECT_FALSE(batch.bit(ModbusReadBatch::COILS, 3));
+    EXPECT_EQ(batch.error(ModbusReadBatch::COILS), NMBS_ERROR_NONE);
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "pecplayback.h"
+#include "indicom.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+// Axis angle, in hours, after tracking for seconds
+static double axisAfter(double seconds)
+{
+    return seconds * TRACKRATE_SIDEREAL / (15 * 3600);
+}
+
+TEST(PECPlaybackTest, Test_phase)
+{
+    INDI::PECPlayback pec(100);
+    pec.setWormPeriod(480);
+    EXPECT_NEAR(pec.phase(0), 0, 1e-9);
+    EXPECT_NEAR(pec.phase(axisAfter(120)), 0.25, 1e-9);
+    EXPECT_NEAR(pec.phase(axisAfter(480 * 3 + 240)), 0.5, 1e-9);
+    EXPECT_NEAR(pec.phase(-axisAfter(120)), 0.75, 1e-9);
+}
+
+TEST(PECPlaybackTest, Test_recording)
+{
+    INDI::PECPlayback pec(100);
+    pec.setWormPeriod(480);
+
+    // Guide pulses, twenty per bin, correcting a sine error of 5 arcsecs/s amplitude, plus a drift of 0.1 arcsecs/s
+    const double step = 0.24;
+    double start = 1.5;
+    pec.startRecording(pec.phase(axisAfter(start)), false);
+    INDI::PECPlayback::RecordState state = INDI::PECPlayback::RECORD_BUSY;
+    for (double t = start; state == INDI::PECPlayback::RECORD_BUSY; t += step)
+    {
+        double phase = pec.phase(axisAfter(t));
+        pec.addCorrection(phase, (5 * std::sin(2 * M_PI * phase) + 0.1) * step);
+        state = pec.updateRecording(pec.phase(axisAfter(t + step)));
+    }
+    ASSERT_EQ(state, INDI::PECPlayback::RECORD_DONE);
+    EXPECT_FALSE(pec.isRecording());
+
+    for (double phase = 0; phase < 1; phase += 0.0137)
+        EXPECT_NEAR(pec.correction(phase), 5 * std::sin(2 * M_PI * phase), 0.05) << "phase " << phase;
+}
+
+TEST(PECPlaybackTest, Test_refine)
+{
+    INDI::PECPlayback pec(4);
+    ASSERT_TRUE(pec.fromString("1,0,-1,0"));
+    pec.setWormPeriod(4);
+
+    // A residual of 0.5 arcsecs/s in the first bin, over bins of one second
+    pec.startRecording(0, true);
+    pec.addCorrection(0.1, 0.5);
+    for (double phase = 0.01; phase <= 1.001; phase += 0.01)
+        pec.updateRecording(std::fmod(phase, 1.0));
+    EXPECT_FALSE(pec.isRecording());
+
+    EXPECT_NEAR(pec.table()[0], 1 + 0.5 - 0.125, 1e-9);
+    EXPECT_NEAR(pec.table()[1], -0.125, 1e-9);
+    EXPECT_NEAR(pec.table()[2], -1 - 0.125, 1e-9);
+}
+
+TEST(PECPlaybackTest, Test_abortOnSlew)
+{
+    INDI::PECPlayback pec;
+    pec.startRecording(0.2, false);
+    EXPECT_EQ(pec.updateRecording(0.201), INDI::PECPlayback::RECORD_BUSY);
+    EXPECT_EQ(pec.updateRecording(0.6), INDI::PECPlayback::RECORD_ABORTED);
+    EXPECT_FALSE(pec.isRecording());
+}
+
+TEST(PECPlaybackTest, Test_interpolation)
+{
+    INDI::PECPlayback pec(4);
+    ASSERT_TRUE(pec.fromString("0, 1, 0, -1"));
+    // Bin values are at their centers, wrapping around
+    EXPECT_NEAR(pec.correction(0.125), 0, 1e-9);
+    EXPECT_NEAR(pec.correction(0.375), 1, 1e-9);
+    EXPECT_NEAR(pec.correction(0.25), 0.5, 1e-9);
+    EXPECT_NEAR(pec.correction(0), -0.5, 1e-9);
+    EXPECT_NEAR(pec.correction(0.99), -0.54, 1e-9);
+}
+
+TEST(PECPlaybackTest, Test_strings)
+{
+    INDI::PECPlayback pec(3);
+    EXPECT_FALSE(pec.fromString("1,x,2"));
+    EXPECT_FALSE(pec.fromString("1"));
+    EXPECT_EQ(pec.table().size(), 3u);
+    ASSERT_TRUE(pec.fromString("0.5,-0.25,1.125"));
+    EXPECT_EQ(pec.toString(), "0.5000,-0.2500,1.1250");
+}
@@ -0,0 +1,116 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "pixel/pixelkernels.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+template <typename T>
+static void expectMinMax(size_t count)
+{
+    std::vector<T> pixels(count);
+    for (auto &pixel : pixels)
+        pixel = static_cast<T>(rand());
+
+    T min = 0, max = 0;
+    INDI::Pixel::minMax(pixels.data(), pixels.size(), min, max);
+    auto expected = std::minmax_element(pixels.begin(), pixels.end());
+    EXPECT_EQ(min, *expected.first) << "count " << count;
+    EXPECT_EQ(max, *expected.second) << "count " << count;
+}
+
+TEST(PixelKernelsTest, Test_minMax)
+{
+    srand(1);
+    // Lengths below, at and past the vector widths, with remainders
+    for (size_t count : {1, 7, 8, 15, 16, 17, 31, 32, 33, 100, 4099})
+    {
+        expectMinMax<uint8_t>(count);
+        expectMinMax<uint16_t>(count);
+        expectMinMax<uint32_t>(count);
+        expectMinMax<float>(count);
+    }
+}
+
+TEST(PixelKernelsTest, Test_minMaxExtremes)
+{
+    // The extremes in the remainder and in the first vector, with the sign bit of 16 bits words set
+    std::vector<uint16_t> pixels(37, 0x8000);
+    pixels[36] = 0xFFFF;
+    pixels[3]  = 0x7FFF;
+    uint16_t min = 0, max = 0;
+    INDI::Pixel::minMax(pixels.data(), pixels.size(), min, max);
+    EXPECT_EQ(min, 0x7FFF);
+    EXPECT_EQ(max, 0xFFFF);
+
+    std::vector<uint8_t> bytes(64, 128);
+    bytes[0]  = 0;
+    bytes[63] = 255;
+    uint8_t low = 1, high = 1;
+    INDI::Pixel::minMax(bytes.data(), bytes.size(), low, high);
+    EXPECT_EQ(low, 0);
+    EXPECT_EQ(high, 255);
+
+    // Nothing to look at leaves them alone
+    INDI::Pixel::minMax(bytes.data(), 0, low, high);
+    EXPECT_EQ(low, 0);
+    EXPECT_EQ(high, 255);
+}
+
+TEST(PixelKernelsTest, Test_dispatch)
+{
+    auto size = [](int bpp)
+    {
+        size_t bytes = 0;
+        bool known = INDI::Pixel::withPixelType(bpp, [&](auto tag)
+        {
+            bytes = sizeof(typename decltype(tag)::type);
+        });
+        return known ? bytes : 0;
+    };
+    EXPECT_EQ(size(8), 1u);
+    EXPECT_EQ(size(16), 2u);
+    EXPECT_EQ(size(32), 4u);
+    EXPECT_EQ(size(64), 8u);
+    EXPECT_EQ(size(-32), 4u);
+    EXPECT_EQ(size(-64), 8u);
+    EXPECT_EQ(size(12), 0u);
+
+    EXPECT_TRUE(INDI::Pixel::withUnsignedPixelType(16, [](auto) {}));
+    EXPECT_FALSE(INDI::Pixel::withUnsignedPixelType(-32, [](auto) {}));
+}
+
+TEST(PixelKernelsTest, Test_copyRows)
+{
+    // A 3x2 box at (2, 1) out of an 8x4 frame of 16 bits pixels
+    std::vector<uint16_t> frame(8 * 4);
+    std::iota(frame.begin(), frame.end(), 0);
+    std::vector<uint16_t> box(3 * 2);
+    INDI::Pixel::copyRows(reinterpret_cast<const uint8_t *>(&frame[8 + 2]), 8 * sizeof(uint16_t),
+                          reinterpret_cast<uint8_t *>(box.data()), 3 * sizeof(uint16_t), 3 * sizeof(uint16_t), 2);
+    EXPECT_EQ(box, (std::vector<uint16_t> {10, 11, 12, 18, 19, 20}));
+
+    // Packed rows are one copy
+    std::vector<uint16_t> copy(frame.size());
+    INDI::Pixel::copyRows(reinterpret_cast<const uint8_t *>(frame.data()), 16, reinterpret_cast<uint8_t *>(copy.data()), 16,
+                          16, 4);
+    EXPECT_EQ(copy, frame);
+}
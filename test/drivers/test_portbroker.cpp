@@ -0,0 +1,232 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+
+#include "connectionplugins/portbroker.h"
+#include "indicom.h"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Connection::PortBroker;
+
+// Stands in for a serial device: answers each command ended by '#' with R<command>, slowly for SLOW
+// and never for MUTE, until the broker closes its end
+class FakeDevice
+{
+    public:
+        explicit FakeDevice(const std::string &port)
+        {
+            socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+            EXPECT_TRUE(PortBroker::share(port, fds[0]));
+            thread = std::thread(&FakeDevice::run, this);
+        }
+
+        ~FakeDevice()
+        {
+            thread.join();
+            close(fds[1]);
+        }
+
+        std::vector<std::string> commands()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return received;
+        }
+
+        // True once the broker closed the port
+        bool closed(int timeout)
+        {
+            return thread.joinable() && waitClosed(timeout);
+        }
+
+    private:
+        void run()
+        {
+            std::string command;
+            char c;
+            while (read(fds[1], &c, 1) == 1)
+            {
+                command += c;
+                if (c != '#')
+                    continue;
+
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    received.push_back(command);
+                }
+                if (command == "SLOW#")
+                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                if (command != "MUTE#")
+                {
+                    std::string reply = "R" + command;
+                    EXPECT_EQ(write(fds[1], reply.data(), reply.size()), static_cast<ssize_t>(reply.size()));
+                }
+                command.clear();
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            eof = true;
+        }
+
+        bool waitClosed(int timeout)
+        {
+            for (int i = 0; i < timeout / 10; i++)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (eof)
+                        return true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return false;
+        }
+
+        int fds[2];
+        std::thread thread;
+        std::mutex lock;
+        std::vector<std::string> received;
+        bool eof {false};
+};
+
+TEST(PortBrokerTest, Test_repliesToTheirDrivers)
+{
+    FakeDevice device("test-broker-replies");
+    PortBroker focuser, power;
+    ASSERT_EQ(focuser.open("test-broker-replies", 9600), TTY_OK);
+    ASSERT_EQ(power.open("test-broker-replies", 9600), TTY_OK);
+
+    std::string a, b;
+    std::thread other([&]()
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            ASSERT_EQ(power.transact("P" + std::to_string(i) + "#", b), TTY_OK);
+            EXPECT_EQ(b, "RP" + std::to_string(i) + "#");
+        }
+    });
+    for (int i = 0; i < 20; i++)
+    {
+        ASSERT_EQ(focuser.transact("F" + std::to_string(i) + "#", a), TTY_OK);
+        EXPECT_EQ(a, "RF" + std::to_string(i) + "#");
+    }
+    other.join();
+    EXPECT_EQ(device.commands().size(), 40u);
+
+    // The port is closed with the last driver leaving it
+    focuser.close();
+    EXPECT_FALSE(device.closed(100));
+    power.close();
+    EXPECT_TRUE(device.closed(2000));
+}
+
+TEST(PortBrokerTest, Test_priorities)
+{
+    FakeDevice device("test-broker-priorities");
+    PortBroker busy, low, high;
+    ASSERT_EQ(busy.open("test-broker-priorities", 9600), TTY_OK);
+    ASSERT_EQ(low.open("test-broker-priorities", 9600), TTY_OK);
+    ASSERT_EQ(high.open("test-broker-priorities", 9600), TTY_OK);
+
+    // Both wait for the slow transaction, the high priority one runs first
+    std::string reply;
+    std::thread slow([&]()
+    {
+        std::string text;
+        EXPECT_EQ(busy.transact("SLOW#", text), TTY_OK);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::thread later([&]()
+    {
+        std::string text;
+        EXPECT_EQ(low.transact("LOW#", text, '#', 0, 3000, PortBroker::PRIORITY_LOW), TTY_OK);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(high.transact("HIGH#", reply, '#', 0, 3000, PortBroker::PRIORITY_HIGH), TTY_OK);
+    EXPECT_EQ(reply, "RHIGH#");
+    slow.join();
+    later.join();
+
+    EXPECT_EQ(device.commands(), std::vector<std::string>({"SLOW#", "HIGH#", "LOW#"}));
+    busy.close();
+    low.close();
+    high.close();
+    EXPECT_TRUE(device.closed(2000));
+}
+
+TEST(PortBrokerTest, Test_replyKinds)
+{
+    FakeDevice device("test-broker-kinds");
+    PortBroker broker;
+    ASSERT_EQ(broker.open("test-broker-kinds", 9600), TTY_OK);
+
+    std::string reply;
+    EXPECT_EQ(broker.transact("MUTE#", reply, '#', 0, 100), TTY_TIME_OUT);
+    EXPECT_TRUE(reply.empty());
+
+    // Fixed length, then no reply at all
+    EXPECT_EQ(broker.transact("ABC#", reply, -1, 3), TTY_OK);
+    EXPECT_EQ(reply, "RAB");
+    EXPECT_EQ(broker.transact("MUTE#", reply, -1, 0), TTY_OK);
+    EXPECT_TRUE(reply.empty());
+
+    // The rest of the fixed length reply is discarded before the next transaction
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(broker.transact("X#", reply), TTY_OK);
+    EXPECT_EQ(reply, "RX#");
+
+    broker.close();
+    EXPECT_TRUE(device.closed(2000));
+    EXPECT_EQ(broker.transact("X#", reply), TTY_ERRNO);
+}
+
+TEST(PortBrokerTest, Test_exchange)
+{
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    // Stale input is discarded, the reply is read up to its terminator, then the leftover is stale
+    ASSERT_EQ(write(fds[1], "stale", 5), 5);
+    std::thread device([&]()
+    {
+        char command[4];
+        EXPECT_EQ(read(fds[1], command, sizeof(command)), 4);
+        EXPECT_EQ(write(fds[1], "12:34:56#+45", 12), 12);
+    });
+    std::string reply;
+    EXPECT_EQ(PortBroker::exchange(fds[0], ":GR#", reply, '#', 0, 500), TTY_OK);
+    EXPECT_EQ(reply, "12:34:56#");
+    device.join();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(PortBroker::exchange(fds[0], ":GD#", reply, '#', 0, 100), TTY_TIME_OUT);
+    EXPECT_TRUE(reply.empty());
+
+    char written[4] = {0};
+    EXPECT_EQ(read(fds[1], written, sizeof(written)), 4);
+    EXPECT_EQ(std::string(written, 4), ":GD#");
+    close(fds[0]);
+    close(fds[1]);
+}
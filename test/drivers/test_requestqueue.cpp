@@ -0,0 +1,155 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "connectionplugins/requestqueue.h"
+#include "eventloop.h"
+#include "indicom.h"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+class RequestQueueTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+            queue.attach(fds[0]);
+        }
+
+        void TearDown() override
+        {
+            queue.detach();
+            close(fds[0]);
+            close(fds[1]);
+        }
+
+        // What the queue wrote to the device so far
+        std::string received()
+        {
+            char buffer[256];
+            ssize_t n = recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT);
+            return n > 0 ? std::string(buffer, n) : std::string();
+        }
+
+        void reply(const std::string &text)
+        {
+            ASSERT_EQ(write(fds[1], text.data(), text.size()), static_cast<ssize_t>(text.size()));
+        }
+
+        int fds[2];
+        Connection::RequestQueue queue;
+};
+
+TEST_F(RequestQueueTest, Test_inOrder)
+{
+    std::vector<std::string> replies;
+    int first = 0, done = 0;
+    queue.send(":GR#", [&](int rc, const std::string & text)
+    {
+        EXPECT_EQ(rc, TTY_OK);
+        replies.push_back(text);
+        first = 1;
+    });
+    queue.send(":GD#", [&](int rc, const std::string & text)
+    {
+        EXPECT_EQ(rc, TTY_OK);
+        replies.push_back(text);
+        done = 1;
+    });
+
+    // One request is in flight at a time
+    EXPECT_EQ(received(), ":GR#");
+    EXPECT_EQ(queue.pending(), 2u);
+
+    // A reply split over two reads
+    reply("12:34");
+    reply(":56#");
+    ASSERT_EQ(deferLoop(1000, &first), 0);
+
+    EXPECT_EQ(received(), ":GD#");
+    reply("+45*30:00#");
+    ASSERT_EQ(deferLoop(1000, &done), 0);
+
+    ASSERT_EQ(replies.size(), 2u);
+    EXPECT_EQ(replies[0], "12:34:56#");
+    EXPECT_EQ(replies[1], "+45*30:00#");
+    EXPECT_EQ(queue.pending(), 0u);
+}
+
+TEST_F(RequestQueueTest, Test_timeout)
+{
+    int done = 0;
+    int timedOut = TTY_OK;
+    queue.send(":GR#", [&](int rc, const std::string &)
+    {
+        timedOut = rc;
+    }, '#', 50);
+    queue.send(":GD#", [&](int rc, const std::string & text)
+    {
+        EXPECT_EQ(rc, TTY_OK);
+        EXPECT_EQ(text, "+45*30:00#");
+        done = 1;
+    });
+
+    EXPECT_EQ(received(), ":GR#");
+    ASSERT_EQ(deferLoop(1000, &timedOut), 0);
+    EXPECT_EQ(timedOut, TTY_TIME_OUT);
+
+    // The next request goes out once the silent one gave up
+    EXPECT_EQ(received(), ":GD#");
+    reply("+45*30:00#");
+    ASSERT_EQ(deferLoop(1000, &done), 0);
+}
+
+TEST_F(RequestQueueTest, Test_noReply)
+{
+    int done = 0;
+    queue.send(":Q#", [&](int rc, const std::string & text)
+    {
+        EXPECT_EQ(rc, TTY_OK);
+        EXPECT_TRUE(text.empty());
+        done = 1;
+    }, 0);
+
+    EXPECT_EQ(done, 1);
+    EXPECT_EQ(received(), ":Q#");
+}
+
+TEST_F(RequestQueueTest, Test_detach)
+{
+    int failed = 0;
+    queue.send(":GR#", [&](int rc, const std::string &)
+    {
+        EXPECT_EQ(rc, TTY_ERRNO);
+        failed++;
+    });
+    queue.send(":GD#", [&](int rc, const std::string &)
+    {
+        EXPECT_EQ(rc, TTY_ERRNO);
+        failed++;
+    });
+
+    queue.detach();
+    EXPECT_EQ(failed, 2);
+    EXPECT_FALSE(queue.isAttached());
+    EXPECT_EQ(queue.pending(), 0u);
+}
@@ -0,0 +1,106 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "stream/roitracker.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+// A disc of the given radius on a dark sky, 16 bits
+static std::vector<uint16_t> planet(size_t width, size_t height, double x, double y, double radius)
+{
+    std::vector<uint16_t> frame(width * height, 100);
+    for (size_t row = 0; row < height; row++)
+        for (size_t column = 0; column < width; column++)
+            if ((column - x) * (column - x) + (row - y) * (row - y) <= radius * radius)
+                frame[row * width + column] = 30000;
+    return frame;
+}
+
+TEST(ROI_TRACKER, Test_locate)
+{
+    auto frame = planet(200, 100, 120, 40, 10);
+    double x = 0, y = 0;
+    ASSERT_TRUE(INDI::RoiTracker::locate(reinterpret_cast<const uint8_t *>(frame.data()), 200, 100, 2, 16,
+                                         INDI::RoiTracker::Region{0, 0, 200, 100}, x, y));
+    EXPECT_NEAR(x, 120, 0.5);
+    EXPECT_NEAR(y, 40, 0.5);
+
+    // Only the first component of RGB pixels is read
+    std::vector<uint8_t> rgb(40 * 30 * 3, 10);
+    for (int i = 0; i < 3; i++)
+        rgb[(12 * 40 + 25) * 3 + i] = i == 0 ? 200 : 0;
+    ASSERT_TRUE(INDI::RoiTracker::locate(rgb.data(), 40, 30, 3, 8, INDI::RoiTracker::Region{0, 0, 40, 30}, x, y));
+    EXPECT_DOUBLE_EQ(x, 25);
+    EXPECT_DOUBLE_EQ(y, 12);
+
+    std::vector<uint8_t> flat(40 * 30, 50);
+    EXPECT_FALSE(INDI::RoiTracker::locate(flat.data(), 40, 30, 1, 8, INDI::RoiTracker::Region{0, 0, 40, 30}, x, y));
+    EXPECT_FALSE(INDI::RoiTracker::locate(flat.data(), 40, 30, 1, 8, INDI::RoiTracker::Region{30, 0, 20, 30}, x, y));
+}
+
+TEST(ROI_TRACKER, Test_search_region)
+{
+    INDI::RoiTracker::Region search = INDI::RoiTracker::searchRegion(INDI::RoiTracker::Region{50, 40, 20, 10}, 200, 100);
+    EXPECT_EQ(search.x, 40u);
+    EXPECT_EQ(search.y, 35u);
+    EXPECT_EQ(search.w, 40u);
+    EXPECT_EQ(search.h, 20u);
+
+    search = INDI::RoiTracker::searchRegion(INDI::RoiTracker::Region{5, 90, 20, 10}, 200, 100);
+    EXPECT_EQ(search.x, 0u);
+    EXPECT_EQ(search.y, 85u);
+    EXPECT_EQ(search.w, 35u);
+    EXPECT_EQ(search.h, 15u);
+}
+
+TEST(ROI_TRACKER, Test_follow)
+{
+    INDI::RoiTracker tracker;
+    tracker.setDeadband(5);
+
+    // Within the dead band the region stays
+    INDI::RoiTracker::Region region {40, 20, 41, 21};
+    EXPECT_FALSE(tracker.follow(63, 33, region, 200, 100));
+    EXPECT_EQ(region.x, 40u);
+
+    // Then it is centered on the blob
+    EXPECT_TRUE(tracker.follow(70, 36, region, 200, 100));
+    EXPECT_EQ(region.x, 50u);
+    EXPECT_EQ(region.y, 26u);
+    EXPECT_EQ(region.w, 41u);
+
+    // Never out of the frame
+    EXPECT_TRUE(tracker.follow(195, 2, region, 200, 100));
+    EXPECT_EQ(region.x, 159u);
+    EXPECT_EQ(region.y, 0u);
+    EXPECT_FALSE(tracker.follow(199, 0, region, 200, 100));
+}
+
+TEST(ROI_TRACKER, Test_interval)
+{
+    INDI::RoiTracker tracker;
+    tracker.setInterval(3);
+    std::vector<bool> due;
+    for (int i = 0; i < 7; i++)
+        due.push_back(tracker.isDue());
+    EXPECT_EQ(due, std::vector<bool>({true, false, false, true, false, false, true}));
+
+    tracker.reset();
+    EXPECT_TRUE(tracker.isDue());
+}
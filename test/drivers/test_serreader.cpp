@@ -0,0 +1,146 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "stream/recorder/serreader.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static const uint16_t width = 16, height = 8;
+static const uint32_t frames = 50;
+static const uint64_t start = 63900000000000000ull;
+
+static std::string record()
+{
+    char path[] = "/tmp/test_serreader_XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+
+    INDI::SER_Recorder recorder;
+    recorder.setPixelFormat(INDI_MONO, 8);
+    recorder.setSize(width, height);
+    char errmsg[1024];
+    EXPECT_TRUE(recorder.open(path, errmsg)) << errmsg;
+
+    std::vector<uint8_t> frame(width * height);
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        frame.assign(frame.size(), static_cast<uint8_t>(i));
+        // A frame every 10 ms
+        EXPECT_TRUE(recorder.writeFrame(frame.data(), frame.size(), start + i * 10000));
+    }
+    recorder.close();
+    return path;
+}
+
+static void removeRecording(const std::string &path)
+{
+    unlink(path.c_str());
+    unlink(INDI::SER_Reader::indexPath(path).c_str());
+}
+
+// As left by a crash: the header never rewritten, no trailer, part of a frame
+static void crash(const std::string &path, uint32_t whole)
+{
+    ASSERT_EQ(truncate(path.c_str(), 178 + whole * width * height + 5), 0);
+    FILE *file = fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    fseek(file, 38, SEEK_SET);
+    uint8_t zero[4] = {0, 0, 0, 0};
+    fwrite(zero, 1, sizeof(zero), file);
+    fclose(file);
+}
+
+TEST(SERReader, SeeksByIndexAndTime)
+{
+    std::string path = record();
+    INDI::SER_Reader reader;
+    ASSERT_TRUE(reader.open(path)) << reader.error();
+
+    EXPECT_EQ(reader.header().ImageWidth, width);
+    ASSERT_EQ(reader.frameCount(), frames);
+    ASSERT_TRUE(reader.hasTimestamps());
+    for (uint32_t i : {0u, 17u, frames - 1})
+    {
+        size_t size = 0;
+        const uint8_t *frame = reader.frame(i, &size);
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(size, size_t(width * height));
+        EXPECT_EQ(frame[0], i);
+        EXPECT_EQ(frame[size - 1], i);
+        EXPECT_EQ(reader.timestamp(i), (start + i * 10000) * 10);
+    }
+    EXPECT_EQ(reader.frame(frames), nullptr);
+
+    EXPECT_EQ(reader.frameAt(0), 0u);
+    EXPECT_EQ(reader.frameAt((start + 20 * 10000) * 10), 20u);
+    EXPECT_EQ(reader.frameAt((start + 20 * 10000) * 10 + 1), 21u);
+    EXPECT_EQ(reader.frameAt(UINT64_MAX), frames);
+    removeRecording(path);
+}
+
+TEST(SERReader, TrailerWithoutIndex)
+{
+    std::string path = record();
+    unlink(INDI::SER_Reader::indexPath(path).c_str());
+
+    INDI::SER_Reader reader;
+    ASSERT_TRUE(reader.open(path)) << reader.error();
+    ASSERT_EQ(reader.frameCount(), frames);
+    EXPECT_EQ(reader.frame(33)[0], 33);
+    EXPECT_EQ(reader.timestamp(33), (start + 33 * 10000) * 10);
+    EXPECT_EQ(reader.frameAt((start + 33 * 10000) * 10), 33u);
+    removeRecording(path);
+}
+
+TEST(SERReader, CrashKeepsTimestamps)
+{
+    std::string path = record();
+    crash(path, 30);
+
+    INDI::SER_Reader reader;
+    ASSERT_TRUE(reader.open(path)) << reader.error();
+    ASSERT_EQ(reader.frameCount(), 30u);
+    EXPECT_EQ(reader.frame(29)[0], 29);
+    EXPECT_EQ(reader.timestamp(29), (start + 29 * 10000) * 10);
+
+    // Only the frames are left without the index
+    unlink(INDI::SER_Reader::indexPath(path).c_str());
+    ASSERT_TRUE(reader.open(path)) << reader.error();
+    ASSERT_EQ(reader.frameCount(), 30u);
+    EXPECT_FALSE(reader.hasTimestamps());
+    EXPECT_EQ(reader.frameAt(0), 30u);
+    removeRecording(path);
+}
+
+TEST(SERReader, OtherFilesAreRejected)
+{
+    char path[] = "/tmp/test_serreader_XXXXXX";
+    int fd = mkstemp(path);
+    std::string text(200, 'x');
+    ASSERT_EQ(write(fd, text.data(), text.size()), ssize_t(text.size()));
+    close(fd);
+
+    INDI::SER_Reader reader;
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_FALSE(reader.error().empty());
+    EXPECT_FALSE(reader.isOpen());
+    unlink(path);
+}
@@ -0,0 +1,65 @@
+/*
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "indisimulatedclock.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include <sys/time.h>
+
+using INDI::SimulatedClock;
+
+static double wallNow()
+{
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+TEST(SimulatedClock, Test_wall_speed)
+{
+    SimulatedClock::set(1, wallNow());
+    EXPECT_NEAR(SimulatedClock::now(), wallNow(), 0.01);
+    EXPECT_EQ(SimulatedClock::toWallMs(1000), 1000u);
+}
+
+TEST(SimulatedClock, Test_faster)
+{
+    double epoch = wallNow() - 10;
+    SimulatedClock::set(30, epoch);
+
+    // Ten seconds since the epoch are five minutes of simulated time
+    EXPECT_NEAR(SimulatedClock::now() - epoch, 300, 0.5);
+    EXPECT_EQ(SimulatedClock::toWallMs(3000), 100u);
+    EXPECT_EQ(SimulatedClock::toWallMs(1), 1u);
+
+    double start = SimulatedClock::now();
+    auto wallStart = std::chrono::steady_clock::now();
+    SimulatedClock::sleep(3);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    EXPECT_GE(SimulatedClock::now() - start, 3);
+    EXPECT_LT(wall, 1);
+
+    struct timeval tv;
+    SimulatedClock::gettimeofday(&tv);
+    EXPECT_NEAR(tv.tv_sec + tv.tv_usec / 1e6, SimulatedClock::now(), 0.1);
+
+    // Julian date 2440587.5 is the Unix epoch
+    EXPECT_NEAR((SimulatedClock::julianDate() - 2440587.5) * 86400, SimulatedClock::now(), 0.1);
+
+    SimulatedClock::set(1, wallNow());
+}
@@ -0,0 +1,145 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "defaultdevice.h"
+#include "indicom.h"
+#include "indidriver.h"
+#include "lilxml.h"
+#include "capturestdout.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+// Reads snooped values the way the dome, telescope and weather drivers do
+class Snooper : public INDI::DefaultDevice
+{
+    public:
+        Snooper()
+        {
+            IUFillNumber(&numbers[0], "RA", "RA", "%g", 0, 24, 0, 0);
+            IUFillNumber(&numbers[1], "DEC", "DEC", "%g", -90, 90, 0, 0);
+            IUFillNumberVector(&coords, numbers, 2, "Mount", "EQUATORIAL_EOD_COORD", "Coordinates", "Main", IP_RO, 60,
+                               IPS_IDLE);
+        }
+
+        const char *getDefaultName() override
+        {
+            return "Snooper";
+        }
+
+        bool ISSnoopDevice(XMLEle *root) override
+        {
+            encoding = findXMLAttValu(root, "encoding");
+            for (XMLEle *ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+            {
+                double value = 0;
+                if (!strcmp(findXMLAttValu(ep, "name"), "DEC"))
+                    f_scansexa(pcdataXMLEle(ep), &value);
+                else
+                    value = atof(pcdataXMLEle(ep));
+                raw[findXMLAttValu(ep, "name")] = value;
+            }
+            snooped = IUSnoopNumber(root, &coords);
+            return true;
+        }
+
+        std::string encoding;
+        std::map<std::string, double> raw;
+        int snooped = -1;
+        INumber numbers[2];
+        INumberVectorProperty coords;
+};
+
+// The driver receives xml from the server
+static int receive(std::string xml)
+{
+    char msg[2048];
+    LilXML *lp = newLilXML();
+    XMLEle **nodes = parseXMLChunk(lp, &xml[0], xml.size(), msg);
+    int result = -1;
+    if (nodes != nullptr && nodes[0] != nullptr)
+    {
+        result = dispatch(nodes[0], msg);
+        for (XMLEle **node = nodes; *node != nullptr; node++)
+            delXMLEle(*node);
+    }
+    free(nodes);
+    delLilXML(lp);
+    return result;
+}
+
+static std::string encoded(double value)
+{
+    char bits[17];
+    fs_ieee754(bits, value);
+    return bits;
+}
+
+TEST(SnoopNumbersTest, Test_encodedAreReadAsText)
+{
+    Snooper snooper;
+    const double ra = 1.0 / 3, dec = -12.345678901234567;
+
+    EXPECT_EQ(receive("<setNumberVector device='Mount' name='EQUATORIAL_EOD_COORD' state='Ok' encoding='ieee754'>"
+                      "<oneNumber name='RA'>" + encoded(ra) + "</oneNumber>"
+                      "<oneNumber name='DEC'>" + encoded(dec) + "</oneNumber></setNumberVector>"), 0);
+
+    // Hand-written parsers get the exact values
+    EXPECT_EQ(snooper.encoding, "");
+    EXPECT_EQ(snooper.raw["RA"], ra);
+    EXPECT_EQ(snooper.raw["DEC"], dec);
+
+    EXPECT_EQ(snooper.snooped, 0);
+    EXPECT_EQ(snooper.numbers[0].value, ra);
+    EXPECT_EQ(snooper.numbers[1].value, dec);
+}
+
+TEST(SnoopNumbersTest, Test_textIsLeftAlone)
+{
+    Snooper snooper;
+
+    EXPECT_EQ(receive("<setNumberVector device='Mount' name='EQUATORIAL_EOD_COORD' state='Ok'>"
+                      "<oneNumber name='RA'>5.5</oneNumber><oneNumber name='DEC'>-12:30:00</oneNumber>"
+                      "</setNumberVector>"), 0);
+
+    EXPECT_EQ(snooper.raw["RA"], 5.5);
+    EXPECT_EQ(snooper.raw["DEC"], -12.5);
+    EXPECT_EQ(snooper.snooped, 0);
+}
+
+TEST(SnoopNumbersTest, Test_sentEncodedOnceAnnounced)
+{
+    Snooper snooper;
+    snooper.numbers[0].value = 1.0 / 3;
+
+    // A server that did not announce numbers='ieee754' gets text
+    captureStdout([] { receive("<getProperties version='1.7'/>"); });
+    std::string output = captureStdout([&] { IDSetNumber(&snooper.coords, nullptr); });
+    EXPECT_EQ(output.find("encoding="), std::string::npos);
+
+    captureStdout([] { receive("<getProperties version='1.7' numbers='ieee754'/>"); });
+    output = captureStdout([&] { IDSetNumber(&snooper.coords, nullptr); });
+    EXPECT_NE(output.find("encoding='ieee754'"), std::string::npos);
+    EXPECT_NE(output.find(encoded(1.0 / 3)), std::string::npos);
+
+    // Its own snoop requests announce what the driver reads
+    output = captureStdout([] { IDSnoopDevice("Mount", "EQUATORIAL_EOD_COORD"); });
+    EXPECT_NE(output.find("numbers='ieee754'"), std::string::npos);
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "snooprouter.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+static XMLEle *parse(const char *xml)
+{
+    char errmsg[1024];
+    LilXML *lp = newLilXML();
+    XMLEle *root = nullptr;
+    for (const char *c = xml; *c != '\0' && root == nullptr; c++)
+        root = readXMLEle(lp, *c, errmsg);
+    delLilXML(lp);
+    return root;
+}
+
+TEST(SnoopRouterTest, Test_number)
+{
+    INDI::SnoopRouter router;
+    int calls = 0;
+    double ra = 0, dec = 0;
+    router.add(INDI::SnoopRouter::NUMBER, "Mount", "EQUATORIAL_EOD_COORD", {"RA", "DEC"},
+               [&](const INDI::SnoopUpdate & update)
+    {
+        calls++;
+        EXPECT_EQ(update.state(), IPS_BUSY);
+        ra = update.number(0);
+        dec = update.number(1);
+    });
+
+    // Elements out of the subscription order, one in sexagesimal
+    XMLEle *root = parse("<setNumberVector device='Mount' name='EQUATORIAL_EOD_COORD' state='Busy'>"
+                         "<oneNumber name='DEC'>-12:30:00</oneNumber><oneNumber name='RA'>5.5</oneNumber>"
+                         "</setNumberVector>");
+    ASSERT_NE(root, nullptr);
+    EXPECT_TRUE(router.dispatch(root));
+    delXMLEle(root);
+
+    EXPECT_EQ(calls, 1);
+    EXPECT_DOUBLE_EQ(ra, 5.5);
+    EXPECT_DOUBLE_EQ(dec, -12.5);
+
+    // Other devices, properties and types are not handed over
+    for (const char *xml :
+            {
+                "<setNumberVector device='Other' name='EQUATORIAL_EOD_COORD'><oneNumber name='RA'>1</oneNumber></setNumberVector>",
+                "<setNumberVector device='Mount' name='GEOGRAPHIC_COORD'><oneNumber name='LAT'>1</oneNumber></setNumberVector>",
+                "<setTextVector device='Mount' name='EQUATORIAL_EOD_COORD'><oneText name='RA'>1</oneText></setTextVector>",
+                "<delProperty device='Mount' name='EQUATORIAL_EOD_COORD'/>",
+            })
+    {
+        root = parse(xml);
+        ASSERT_NE(root, nullptr);
+        EXPECT_FALSE(router.dispatch(root));
+        delXMLEle(root);
+    }
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(SnoopRouterTest, Test_allElements)
+{
+    INDI::SnoopRouter router;
+    std::vector<std::string> names;
+    int id = router.add(INDI::SnoopRouter::TEXT, "Wheel", "FILTER_NAME", {}, [&](const INDI::SnoopUpdate & update)
+    {
+        names.clear();
+        for (size_t i = 0; i < update.count(); i++)
+            names.push_back(update.text(i));
+    });
+
+    XMLEle *root = parse("<defTextVector device='Wheel' name='FILTER_NAME'>"
+                         "<defText name='FILTER_SLOT_NAME_1'>Red</defText><defText name='FILTER_SLOT_NAME_2'>Green</defText>"
+                         "</defTextVector>");
+    ASSERT_NE(root, nullptr);
+    EXPECT_TRUE(router.dispatch(root));
+    EXPECT_EQ(names, (std::vector<std::string> {"Red", "Green"}));
+
+    // Following another wheel
+    EXPECT_TRUE(router.setDevice(id, "Other Wheel"));
+    EXPECT_FALSE(router.dispatch(root));
+    delXMLEle(root);
+}
+
+TEST(SnoopRouterTest, Test_removeFromHandler)
+{
+    INDI::SnoopRouter router;
+    int calls = 0;
+    int id = -1;
+    id = router.add(INDI::SnoopRouter::SWITCH, "Mount", "TELESCOPE_PIER_SIDE", {"PIER_EAST", "PIER_WEST"},
+                    [&](const INDI::SnoopUpdate & update)
+    {
+        calls++;
+        router.remove(id);
+        EXPECT_TRUE(update.isOn(1));
+        EXPECT_FALSE(update.isOn(0));
+    });
+
+    XMLEle *root = parse("<setSwitchVector device='Mount' name='TELESCOPE_PIER_SIDE'>"
+                         "<oneSwitch name='PIER_WEST'>On</oneSwitch><oneSwitch name='PIER_EAST'>Off</oneSwitch>"
+                         "</setSwitchVector>");
+    ASSERT_NE(root, nullptr);
+    EXPECT_TRUE(router.dispatch(root));
+    EXPECT_FALSE(router.dispatch(root));
+    delXMLEle(root);
+    EXPECT_EQ(calls, 1);
+}
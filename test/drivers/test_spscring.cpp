@@ -0,0 +1,124 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "stream/spscring.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(SPSC_RING, Test_order)
+{
+    SPSCRing<std::vector<int>> ring(16);
+    EXPECT_EQ(ring.capacity(), 16u);
+
+    const int count = 100000;
+    std::thread producer([&ring]()
+    {
+        for (int i = 0; i < count; i++)
+            ASSERT_TRUE(ring.push(std::vector<int>(1 + i % 3, i)));
+    });
+
+    std::vector<int> item;
+    for (int i = 0; i < count; i++)
+    {
+        ASSERT_TRUE(ring.pop(item));
+        ASSERT_EQ(item.size(), 1u + i % 3);
+        ASSERT_EQ(item[0], i);
+    }
+    producer.join();
+    EXPECT_EQ(ring.size(), 0u);
+    EXPECT_FALSE(ring.pop(item, 10));
+}
+
+TEST(SPSC_RING, Test_dropNewest)
+{
+    SPSCRing<int> ring(3, SPSCRing<int>::OVERFLOW_DROP_NEWEST);
+    EXPECT_EQ(ring.capacity(), 4u);
+    for (int i = 0; i < 4; i++)
+        EXPECT_TRUE(ring.push(int(i)));
+    EXPECT_FALSE(ring.push(4));
+    EXPECT_EQ(ring.size(), 4u);
+
+    int item;
+    EXPECT_TRUE(ring.pop(item));
+    EXPECT_EQ(item, 0);
+    EXPECT_TRUE(ring.push(5));
+    for (int expected : {1, 2, 3, 5})
+    {
+        EXPECT_TRUE(ring.pop(item, 10));
+        EXPECT_EQ(item, expected);
+    }
+}
+
+TEST(SPSC_RING, Test_dropOldest)
+{
+    SPSCRing<int> ring(4, SPSCRing<int>::OVERFLOW_DROP_OLDEST);
+    for (int i = 0; i < 4; i++)
+        EXPECT_TRUE(ring.push(int(i)));
+
+    int dropped = -1;
+    EXPECT_TRUE(ring.push(4, &dropped));
+    EXPECT_EQ(dropped, 0);
+    EXPECT_TRUE(ring.push(5, &dropped));
+    EXPECT_EQ(dropped, 1);
+
+    int item;
+    for (int expected : {2, 3, 4, 5})
+    {
+        EXPECT_TRUE(ring.pop(item, 10));
+        EXPECT_EQ(item, expected);
+    }
+}
+
+TEST(SPSC_RING, Test_block)
+{
+    SPSCRing<int> ring(2);
+    ring.push(0);
+    ring.push(1);
+
+    // The third push waits for the consumer
+    std::thread producer([&ring]()
+    {
+        EXPECT_TRUE(ring.push(2));
+    });
+
+    int item;
+    for (int expected : {0, 1, 2})
+    {
+        EXPECT_TRUE(ring.pop(item, 1000));
+        EXPECT_EQ(item, expected);
+    }
+    producer.join();
+    EXPECT_TRUE(ring.waitForEmpty(10));
+}
+
+TEST(SPSC_RING, Test_abort)
+{
+    SPSCRing<int> ring(4);
+    std::thread consumer([&ring]()
+    {
+        int item;
+        EXPECT_FALSE(ring.pop(item));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ring.abort();
+    consumer.join();
+
+    EXPECT_FALSE(ring.push(1));
+    EXPECT_EQ(ring.size(), 0u);
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indithreadpool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using INDI::ThreadPool;
+
+TEST(ThreadPoolTest, Test_submit)
+{
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.threadCount(), 4u);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; i++)
+        results.push_back(pool.submit([i] { return i * i; }));
+    for (int i = 0; i < 100; i++)
+        EXPECT_EQ(results[i].get(), i * i);
+}
+
+TEST(ThreadPoolTest, Test_exception)
+{
+    ThreadPool pool(1);
+    auto result = pool.submit([]() -> int { throw std::runtime_error("failed"); });
+    EXPECT_THROW(result.get(), std::runtime_error);
+
+    // The thread survives the exception
+    EXPECT_EQ(pool.submit([] { return 1; }).get(), 1);
+}
+
+TEST(ThreadPoolTest, Test_priority)
+{
+    ThreadPool pool(1);
+    std::mutex gate;
+    std::vector<int> order;
+
+    // Hold the only thread while the others are queued
+    gate.lock();
+    pool.post([&gate] { std::lock_guard<std::mutex> wait(gate); });
+    while (pool.pending() != 0)
+        std::this_thread::yield();
+
+    pool.post([&order] { order.push_back(1); }, ThreadPool::LowPriority);
+    pool.post([&order] { order.push_back(2); }, ThreadPool::NormalPriority);
+    pool.post([&order] { order.push_back(3); }, ThreadPool::HighPriority);
+    pool.post([&order] { order.push_back(4); }, ThreadPool::NormalPriority);
+    EXPECT_EQ(pool.pending(), 4u);
+    gate.unlock();
+    pool.waitForDone();
+
+    EXPECT_EQ(order, std::vector<int>({3, 2, 4, 1}));
+}
+
+TEST(ThreadPoolTest, Test_destructor_runs_queue)
+{
+    std::atomic<int> count {0};
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 50; i++)
+            pool.post([&count] { count++; });
+    }
+    EXPECT_EQ(count, 50);
+}
+
+TEST(ThreadPoolTest, Test_forEach)
+{
+    ThreadPool pool(3);
+    std::vector<int> items(10007, 0);
+    pool.forEach(items.size(), 100, [&items](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+            items[i]++;
+    });
+    for (size_t i = 0; i < items.size(); i++)
+        ASSERT_EQ(items[i], 1) << i;
+}
+
+TEST(ThreadPoolTest, Test_forEach_nested)
+{
+    // Every thread of the pool waits in forEach, the callers do the work themselves
+    ThreadPool pool(2);
+    std::atomic<size_t> total {0};
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < 4; i++)
+        results.push_back(pool.submit([&pool, &total]
+        {
+            pool.forEach(1000, 10, [&total](size_t first, size_t last)
+            {
+                total += last - first;
+            });
+        }));
+    for (auto &result : results)
+        result.get();
+    EXPECT_EQ(total, 4000u);
+}
+
+TEST(ThreadPoolTest, Test_forEach_exception)
+{
+    ThreadPool pool(2);
+    EXPECT_THROW(pool.forEach(100, 1, [](size_t first, size_t)
+    {
+        if (first == 0)
+            throw std::runtime_error("failed");
+    }), std::runtime_error);
+}
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "inditimer.h"
+#include "eventloop.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+using INDI::Timer;
+using Clock = std::chrono::steady_clock;
+
+static int64_t elapsedUs(Clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+TEST(TimerTest, Test_singleShotUs)
+{
+    for (int64_t usec : {300, 1500, 2750})
+    {
+        int fired = 0;
+        int64_t elapsed = 0;
+        Clock::time_point start = Clock::now();
+        Timer::singleShotUs(usec, [&]()
+        {
+            elapsed = elapsedUs(start);
+            fired = 1;
+        });
+        ASSERT_EQ(deferLoop(1000, &fired), 0) << usec;
+
+        // Never early, and not rounded up to the next millisecond
+        EXPECT_GE(elapsed, usec);
+        EXPECT_LT(elapsed, usec + 20000);
+    }
+}
+
+TEST(TimerTest, Test_order)
+{
+    std::vector<int> order;
+    int done = 0;
+    Timer::singleShotUs(1200, [&] { order.push_back(3); done = 1; });
+    Timer::singleShotUs(400, [&] { order.push_back(1); });
+    Timer::singleShotUs(800, [&] { order.push_back(2); });
+    ASSERT_EQ(deferLoop(1000, &done), 0);
+    EXPECT_EQ(order, std::vector<int>({1, 2, 3}));
+}
+
+TEST(TimerTest, Test_periodicUs)
+{
+    Timer timer;
+    int ticks = 0, done = 0;
+    Clock::time_point start = Clock::now();
+    timer.callOnTimeout([&]()
+    {
+        if (++ticks == 10)
+        {
+            timer.stop();
+            done = 1;
+        }
+    });
+    timer.startUs(500);
+    EXPECT_EQ(timer.intervalUs(), 500);
+    EXPECT_EQ(timer.interval(), 0);
+    EXPECT_LE(timer.remainingTimeUs(), 500);
+    ASSERT_EQ(deferLoop(1000, &done), 0);
+
+    // Periods are counted from the start, not from when the previous tick ran
+    EXPECT_GE(elapsedUs(start), 5000);
+    EXPECT_FALSE(timer.isActive());
+}
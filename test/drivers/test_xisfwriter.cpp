@@ -0,0 +1,165 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "xisfwriter.h"
+#include "sharedblob.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+// Header of a monolithic XISF file
+static std::string xisfHeader(const uint8_t *file, size_t size)
+{
+    EXPECT_GE(size, 16u);
+    EXPECT_EQ(memcmp(file, "XISF0100", 8), 0);
+    uint32_t length = file[8] | file[9] << 8 | file[10] << 16 | static_cast<uint32_t>(file[11]) << 24;
+    EXPECT_LE(16 + length, size);
+    return std::string(reinterpret_cast<const char *>(file) + 16, length);
+}
+
+static std::string attribute(const std::string &xml, const std::string &name)
+{
+    size_t start = xml.find(" " + name + "=\"");
+    if (start == std::string::npos)
+        return std::string();
+    start += name.size() + 3;
+    return xml.substr(start, xml.find('"', start) - start);
+}
+
+static std::vector<uint16_t> testImage(uint32_t width, uint32_t height)
+{
+    std::vector<uint16_t> image(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < image.size(); i++)
+        image[i] = 1000 + (i % width) + (i / width) % 97;
+    return image;
+}
+
+TEST(XISF_WRITER, Test_uncompressed)
+{
+    auto image = testImage(640, 480);
+    INDI::XISFImageWriter writer(640, 480, 1, 16);
+    writer.setImageType("Light");
+    writer.setFITSKeywords({INDI::FITSRecord("OBJECT", "M 42", "Object name"), INDI::FITSRecord("EXPTIME", 1.5, 6, "Exposure"),
+                            INDI::FITSRecord("FOCALLEN", 800.0, 2, "Focal length (mm)"),
+                            INDI::FITSRecord("DATE-OBS", "2024-01-02T03:04:05.678", "UTC start date of observation")});
+    writer.setColorFilterArray("RGGB", 2, 2);
+
+    void *data = nullptr;
+    size_t size = 0;
+    ASSERT_TRUE(writer.write(image.data(), &data, &size));
+    auto file = static_cast<const uint8_t *>(data);
+
+    std::string xml = xisfHeader(file, size);
+    EXPECT_EQ(attribute(xml, "geometry"), "640:480:1");
+    EXPECT_EQ(attribute(xml, "sampleFormat"), "UInt16");
+    EXPECT_EQ(attribute(xml, "imageType"), "Light");
+    EXPECT_EQ(attribute(xml, "compression"), "");
+    EXPECT_NE(xml.find("<FITSKeyword name=\"OBJECT\" value=\"&apos;M 42&apos;\" comment=\"Object name\"/>"), std::string::npos);
+    EXPECT_NE(xml.find("pattern=\"RGGB\""), std::string::npos);
+
+    // The keywords that stand for XISF properties are written as those too
+    EXPECT_NE(xml.find("<Property id=\"Observation:Object:Name\" type=\"String\">M 42</Property>"), std::string::npos);
+    EXPECT_NE(xml.find("<Property id=\"Instrument:ExposureTime\" type=\"Float32\" value=\"1.5\"/>"), std::string::npos);
+    EXPECT_NE(xml.find("<Property id=\"Instrument:Telescope:FocalLength\" type=\"Float32\" value=\"0.8\"/>"),
+              std::string::npos);
+    EXPECT_NE(xml.find("<Property id=\"Observation:Time:Start\" type=\"TimePoint\" value=\"2024-01-02T03:04:05.678Z\"/>"),
+              std::string::npos);
+
+    std::string location = attribute(xml, "location");
+    ASSERT_EQ(location.rfind("attachment:", 0), 0u);
+    size_t position = std::stoul(location.substr(11));
+    size_t length = std::stoul(location.substr(location.rfind(':') + 1));
+    EXPECT_EQ(length, image.size() * 2);
+    ASSERT_EQ(position + length, size);
+    EXPECT_EQ(memcmp(file + position, image.data(), length), 0);
+
+    IDSharedBlobFree(data);
+}
+
+TEST(XISF_WRITER, Test_zlibSubblocks)
+{
+    auto image = testImage(1001, 333);
+    for (int threads : {1, 4})
+    {
+        INDI::XISFImageWriter writer(1001, 333, 1, 16);
+        writer.setCompression(INDI::XISFImageWriter::CODEC_ZLIB, 6, threads);
+
+        void *data = nullptr;
+        size_t size = 0;
+        ASSERT_TRUE(writer.write(image.data(), &data, &size));
+        auto file = static_cast<const uint8_t *>(data);
+
+        std::string xml = xisfHeader(file, size);
+        EXPECT_EQ(attribute(xml, "compression"), "zlib+sh:" + std::to_string(image.size() * 2) + ":2");
+        std::string location = attribute(xml, "location");
+        size_t position = std::stoul(location.substr(11));
+        size_t length = std::stoul(location.substr(location.rfind(':') + 1));
+        ASSERT_EQ(position + length, size);
+        EXPECT_LT(length, image.size());
+
+        // Each subblock is a zlib stream of its part of the byte shuffled samples
+        std::vector<std::pair<size_t, size_t>> subblocks;
+        std::string list = attribute(xml, "subblocks");
+        if (threads == 1)
+        {
+            EXPECT_EQ(list, "");
+            subblocks.push_back({length, image.size() * 2});
+        }
+        else
+        {
+            for (size_t start = 0; start < list.size();)
+            {
+                size_t end = list.find(':', start);
+                std::string item = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+                subblocks.push_back({std::stoul(item), std::stoul(item.substr(item.find(',') + 1))});
+                start = end == std::string::npos ? list.size() : end + 1;
+            }
+            EXPECT_EQ(subblocks.size(), 4u);
+        }
+
+        std::vector<uint8_t> shuffled;
+        const uint8_t *block = file + position;
+        for (auto &subblock : subblocks)
+        {
+            std::vector<uint8_t> out(subblock.second);
+            uLongf outLength = out.size();
+            ASSERT_EQ(uncompress(out.data(), &outLength, block, subblock.first), Z_OK);
+            ASSERT_EQ(outLength, subblock.second);
+            shuffled.insert(shuffled.end(), out.begin(), out.end());
+            block += subblock.first;
+        }
+        ASSERT_EQ(shuffled.size(), image.size() * 2);
+        for (size_t i = 0; i < image.size(); i++)
+            ASSERT_EQ(shuffled[i] | shuffled[image.size() + i] << 8, image[i]) << "at " << i;
+
+        IDSharedBlobFree(data);
+    }
+}
+
+TEST(XISF_WRITER, Test_unsupported)
+{
+    std::vector<uint8_t> image(100);
+    INDI::XISFImageWriter writer(10, 10, 1, 12);
+    void *data = nullptr;
+    size_t size = 0;
+    EXPECT_FALSE(writer.write(image.data(), &data, &size));
+    EXPECT_EQ(data, nullptr);
+    EXPECT_FALSE(writer.errorMessage().empty());
+}
@@ -153,6 +153,25 @@ TEST(VectorTest, rotateZ)
     EXPECT_NEAR(v.secondary().Degrees(), 45, 0.00001);
 }
 
+TEST(VectorTest, rotateCosSin)
+{
+    Vector v = Vector(Angle(30), Angle(60));
+    Angle a(-20);
+    double ca = std::cos(a.radians());
+    double sa = std::sin(a.radians());
+    Vector vx = v.rotateX(a), vy = v.rotateY(a), vz = v.rotateZ(a);
+    Vector tx = v.rotateX(ca, sa), ty = v.rotateY(ca, sa), tz = v.rotateZ(ca, sa);
+    EXPECT_DOUBLE_EQ(tx.l(), vx.l());
+    EXPECT_DOUBLE_EQ(tx.m(), vx.m());
+    EXPECT_DOUBLE_EQ(tx.n(), vx.n());
+    EXPECT_DOUBLE_EQ(ty.l(), vy.l());
+    EXPECT_DOUBLE_EQ(ty.m(), vy.m());
+    EXPECT_DOUBLE_EQ(ty.n(), vy.n());
+    EXPECT_DOUBLE_EQ(tz.l(), vz.l());
+    EXPECT_DOUBLE_EQ(tz.m(), vz.m());
+    EXPECT_DOUBLE_EQ(tz.n(), vz.n());
+}
+
 // Alignment tests
 // the tuple contains:
 // Test Ha, Ra, primary, azimuth angle
@@ -3,6 +3,8 @@
  * All types but BLOBs are handled from their defXXX messages. Receipt of a
  *   defBLOB sends enableBLOB then uses setBLOBVector for the value. BLOBs
  *   are stored in a file dev.nam.elem.format. only .z compression is handled.
+ * Several servers may be queried at once with more than one -h, their replies
+ *   are read as they come from a single poll() loop.
  * exit status: 0 at least some found, 1 some not found, 2 real trouble.
  */
 
@@ -12,9 +14,11 @@
 #include "zlib.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <math.h>
 #include <netdb.h>
-#include <signal.h>
+#include <poll.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -58,20 +62,40 @@ typedef struct
     char *p;    /* property to seek */
     char *e;    /* element to seek */
     char wc; /* whether pattern uses wild cards */
-    char ok; /* something matched this query */
 } SearchDef;
 static SearchDef *srchs; /* properties to look for */
 static int nsrchs;
 
+/* one server being queried */
+typedef struct
+{
+    char *host;
+    int port;
+    int fd;          /* connection, -1 once done */
+    int connecting;  /* waiting for connect() to complete */
+    LilXML *lp;      /* XML parser context */
+    char *ok;        /* ok[i] set when something matched srchs[i] */
+    double deadline; /* when to stop waiting for more defXXX */
+    int status;      /* exit status once done, -1 while running */
+} Server;
+static Server *servers; /* servers to query */
+static int nservers;
+static Server *svr;     /* server whose traffic is being handled */
+
 static void usage(void);
 static void crackDPE(char *spec);
 static void addSearchDef(char *dev, char *prop, char *ele);
-static void openINDIServer(void);
-static void getprops(void);
+static void addServer(char *spec);
+static void openINDIServer(Server *sp);
+static void sendServer(Server *sp, const char *fmt, ...);
+static void getprops(Server *sp);
 static void listenINDI(void);
-static int finished(void);
-static void onAlarm(int dummy);
-static int readServerChar(void);
+static int finished(Server *sp);
+static void doneServer(Server *sp, int status);
+static void onTimeout(Server *sp);
+static void readServer(Server *sp);
+static double now(void);
+static void prServer(void);
 static void findDPE(XMLEle *root);
 static void findEle(XMLEle *root, char *dev, char *nam, char *defone, SearchDef *sp);
 static void enableBLOBs(char *dev, char *nam);
@@ -79,20 +103,19 @@ static void oneBLOB(XMLEle *root, char *dev, char *nam, char *enam, char *p, int
 
 static char *me;                      /* our name for usage() message */
 static char host_def[] = "localhost"; /* default host name */
-static char *host      = host_def;    /* working host name */
+static char **hosts;                  /* -h host[:port] specs */
+static int nhosts;
 #define INDIPORT 7624                 /* default port */
 static int port = INDIPORT;           /* working port number */
 #define TIMEOUT 2                     /* default timeout, secs */
 static int timeout = TIMEOUT;         /* working timeout, secs */
+static int totaltimeout;              /* overall deadline, secs, 0 for none */
 static int verbose;                   /* report extra info */
-static LilXML *lillp;                 /* XML parser context */
 #define WILDCARD '*'                  /* show all in this category */
 static int onematch;                  /* only one possible match */
 static int justvalue;                 /* if just one match show only value */
 static int monitor;                   /* keep watching even after seen def */
 static int directfd = -1;             /* direct filedes to server, if >= 0 */
-static FILE *svrwfp;                  /* FILE * to talk to server */
-static FILE *svrrfp;                  /* FILE * to read from server */
 static int wflag;                     /* show wo properties too */
 
 int main(int ac, char *av[])
@@ -131,7 +154,8 @@ int main(int ac, char *av[])
                         fprintf(stderr, "-h requires host name\n");
                         usage();
                     }
-                    host = *++av;
+                    hosts = (char **)realloc(hosts, (nhosts + 1) * sizeof(char *));
+                    hosts[nhosts++] = *++av;
                     ac--;
                     break;
                 case 'm':
@@ -161,6 +185,15 @@ int main(int ac, char *av[])
                     timeout = atoi(*++av);
                     ac--;
                     break;
+                case 'T':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-T requires timeout\n");
+                        usage();
+                    }
+                    totaltimeout = atoi(*++av);
+                    ac--;
+                    break;
                 case 'v': /* verbose */
                     verbose++;
                     break;
@@ -183,32 +216,28 @@ int main(int ac, char *av[])
         crackDPE(*av++);
     onematch = nsrchs == 1 && !srchs[0].wc;
 
-    /* open connection */
+    /* open connections */
     if (directfd >= 0)
     {
-        svrwfp = fdopen(directfd, "w");
-        svrrfp = fdopen(directfd, "r");
-        if (!svrwfp || !svrrfp)
-        {
-            fprintf(stderr, "Direct fd %d: %s\n", directfd, strerror(errno));
-            exit(1);
-        }
-        setbuf(svrrfp, NULL); /* don't absorb next guy's stuff */
+        addServer("direct");
+        servers[0].fd = directfd;
         if (verbose)
             fprintf(stderr, "Using direct fd %d\n", directfd);
     }
     else
     {
-        openINDIServer();
-        if (verbose)
-            fprintf(stderr, "Connected to %s on port %d\n", host, port);
+        if (nhosts == 0)
+            addServer(host_def);
+        for (int i = 0; i < nhosts; i++)
+            addServer(hosts[i]);
+        for (int i = 0; i < nservers; i++)
+            openINDIServer(&servers[i]);
     }
 
-    /* build a parser context for cracking XML responses */
-    lillp = newLilXML();
-
-    /* issue getProperties */
-    getprops();
+    /* issue getProperties to those already connected */
+    for (int i = 0; i < nservers; i++)
+        if (servers[i].fd >= 0 && !servers[i].connecting)
+            getprops(&servers[i]);
 
     /* listen for responses, looking for d.p.e or timeout */
     listenINDI();
@@ -233,10 +262,13 @@ static void usage()
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -1    : print just value if expecting exactly one response\n");
     fprintf(stderr, "  -d f  : use file descriptor f already open to server\n");
-    fprintf(stderr, "  -h h  : alternate host, default is %s\n", host_def);
+    fprintf(stderr, "  -h h  : alternate host[:port], default is %s\n", host_def);
+    fprintf(stderr, "          repeat to query several servers at once, output is then\n");
+    fprintf(stderr, "          prefixed with host:port/\n");
     fprintf(stderr, "  -m    : keep monitoring for more updates\n");
     fprintf(stderr, "  -p p  : alternate port, default is %d\n", INDIPORT);
     fprintf(stderr, "  -t t  : max time to wait, default is %d secs\n", TIMEOUT);
+    fprintf(stderr, "  -T t  : max time to wait for all servers, default is no limit\n");
     fprintf(stderr, "  -v    : verbose (cumulative)\n");
     fprintf(stderr, "  -w    : show write-only properties too\n");
     fprintf(stderr, "Exit status:\n");
@@ -271,52 +303,112 @@ static void addSearchDef(char *dev, char *prop, char *ele)
     srchs[nsrchs].p  = strdup(prop);
     srchs[nsrchs].e  = strdup(ele);
     srchs[nsrchs].wc = *dev == WILDCARD || *prop == WILDCARD || *ele == WILDCARD;
-    srchs[nsrchs].ok = 0;
     nsrchs++;
 }
 
-/* open a connection to the given host and port.
- * set svrwfp and svrrfp or die.
+/* grow servers[] with the one of spec, host[:port] */
+static void addServer(char *spec)
+{
+    Server *sp;
+    char *colon;
+
+    servers = (Server *)realloc(servers, (nservers + 1) * sizeof(Server));
+    sp      = &servers[nservers++];
+    memset(sp, 0, sizeof(*sp));
+    sp->host   = strdup(spec);
+    sp->port   = port;
+    sp->fd     = -1;
+    sp->lp     = newLilXML();
+    sp->ok     = (char *)calloc(nsrchs, 1);
+    sp->status = -1;
+
+    colon = strrchr(sp->host, ':');
+    if (colon)
+    {
+        *colon   = '\0';
+        sp->port = atoi(colon + 1);
+    }
+}
+
+/* start connecting to the host and port of sp without waiting.
+ * sp is done with status 2 if that fails.
  */
-static void openINDIServer(void)
+static void openINDIServer(Server *sp)
 {
     struct sockaddr_in serv_addr;
     struct hostent *hp;
     int sockfd;
 
     /* lookup host address */
-    hp = gethostbyname(host);
+    hp = gethostbyname(sp->host);
     if (!hp)
     {
-        herror("gethostbyname");
-        exit(2);
+        fprintf(stderr, "gethostbyname %s: %s\n", sp->host, hstrerror(h_errno));
+        doneServer(sp, 2);
+        return;
     }
 
     /* create a socket to the INDI server */
     (void)memset((char *)&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family      = AF_INET;
     serv_addr.sin_addr.s_addr = ((struct in_addr *)(hp->h_addr_list[0]))->s_addr;
-    serv_addr.sin_port        = htons(port);
+    serv_addr.sin_port        = htons(sp->port);
     if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
     {
         perror("socket");
-        exit(2);
+        doneServer(sp, 2);
+        return;
     }
 
-    /* connect */
+    /* connect, the others are connecting meanwhile */
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+    sp->fd = sockfd;
     if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
     {
-        perror("connect");
-        exit(2);
+        if (errno != EINPROGRESS)
+        {
+            fprintf(stderr, "connect %s:%d: %s\n", sp->host, sp->port, strerror(errno));
+            doneServer(sp, 2);
+            return;
+        }
+        sp->connecting = 1;
     }
+}
+
+/* send a printf-style message to sp */
+static void sendServer(Server *sp, const char *fmt, ...)
+{
+    char buf[1024];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
 
-    /* prepare for line-oriented i/o with client */
-    svrwfp = fdopen(sockfd, "w");
-    svrrfp = fdopen(sockfd, "r");
+    for (int sent = 0; sent < len;)
+    {
+        ssize_t n = write(sp->fd, buf + sent, len - sent);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+        {
+            struct pollfd pfd = { sp->fd, POLLOUT, 0 };
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        if (n <= 0)
+        {
+            fprintf(stderr, "write %s:%d: %s\n", sp->host, sp->port, strerror(errno));
+            doneServer(sp, 2);
+            return;
+        }
+        sent += n;
+    }
 }
 
-/* issue getProperties to svrwfp, possibly constrained to one device */
-static void getprops()
+/* issue getProperties to sp, possibly constrained to one device */
+static void getprops(Server *sp)
 {
     char *onedev = NULL;
     int i;
@@ -335,51 +427,153 @@ static void getprops()
     }
 
     if (onedev)
-        fprintf(svrwfp, "<getProperties version='%g' device='%s'/>\n", INDIV, onedev);
+        sendServer(sp, "<getProperties version='%g' device='%s'/>\n", INDIV, onedev);
     else
-        fprintf(svrwfp, "<getProperties version='%g'/>\n", INDIV);
-    fflush(svrwfp);
+        sendServer(sp, "<getProperties version='%g'/>\n", INDIV);
 
     if (verbose)
-        fprintf(stderr, "Queried properties from %s\n", onedev ? onedev : "*");
+        fprintf(stderr, "Queried properties from %s on %s:%d\n", onedev ? onedev : "*", sp->host, sp->port);
 }
 
-/* listen for INDI traffic on svrrfp.
- * print matching srchs[] and return when see all.
- * timeout and exit if any trouble.
+/* listen for INDI traffic from all servers.
+ * print matching srchs[] and exit once each server has shown all of them,
+ * timed out or had trouble.
  */
 static void listenINDI()
 {
-    char msg[1024];
+    struct pollfd *pfds = (struct pollfd *)calloc(nservers, sizeof(struct pollfd));
+    double end = totaltimeout > 0 ? now() + totaltimeout : 0;
+    int status = 0;
 
-    /* arrange to call onAlarm() if not seeing any more defXXX */
-    signal(SIGALRM, onAlarm);
-    alarm(timeout);
+    /* give up on each server if not seeing any more defXXX */
+    for (int i = 0; i < nservers; i++)
+        servers[i].deadline = now() + timeout;
 
-    /* read from server, exit if find all requested properties */
     while (1)
     {
-        XMLEle *root = readXMLEle(lillp, readServerChar(), msg);
-        if (root)
+        double wait = -1;
+        int n = 0;
+
+        /* wait for the one due first */
+        for (int i = 0; i < nservers; i++)
+        {
+            Server *sp = &servers[i];
+            if (sp->status >= 0)
+                continue;
+            pfds[n].fd     = sp->fd;
+            pfds[n].events = sp->connecting ? POLLOUT : POLLIN;
+            n++;
+            if (wait < 0 || sp->deadline < wait)
+                wait = sp->deadline;
+        }
+        if (n == 0)
+            break;
+        if (end > 0 && end < wait)
+            wait = end;
+
+        wait -= now();
+        if (poll(pfds, n, wait > 0 ? (int)(wait * 1000) + 1 : 0) < 0 && errno != EINTR)
+        {
+            perror("poll");
+            exit(2);
+        }
+
+        /* handle what came in, the pfds are in the order of the running servers */
+        n = 0;
+        for (int i = 0; i < nservers; i++)
+        {
+            Server *sp = &servers[i];
+            if (sp->status >= 0)
+                continue;
+            short revents = pfds[n++].revents;
+            if (!revents)
+                continue;
+
+            if (sp->connecting)
+            {
+                int err      = 0;
+                socklen_t sz = sizeof(err);
+                getsockopt(sp->fd, SOL_SOCKET, SO_ERROR, &err, &sz);
+                if (err)
+                {
+                    fprintf(stderr, "connect %s:%d: %s\n", sp->host, sp->port, strerror(err));
+                    doneServer(sp, 2);
+                    continue;
+                }
+                sp->connecting = 0;
+                fcntl(sp->fd, F_SETFL, fcntl(sp->fd, F_GETFL, 0) & ~O_NONBLOCK);
+                if (verbose)
+                    fprintf(stderr, "Connected to %s on port %d\n", sp->host, sp->port);
+                getprops(sp);
+                continue;
+            }
+
+            readServer(sp);
+        }
+
+        /* give up on those that took too long */
+        double t = now();
+        for (int i = 0; i < nservers; i++)
+            if (servers[i].status < 0 && (servers[i].deadline <= t || (end > 0 && end <= t)))
+                onTimeout(&servers[i]);
+    }
+
+    for (int i = 0; i < nservers; i++)
+        if (servers[i].status > status)
+            status = servers[i].status;
+    exit(status);
+}
+
+/* read what sp sent, handle every complete XML element */
+static void readServer(Server *sp)
+{
+    /* don't absorb next guy's stuff from a direct fd */
+    char buf[8192];
+    ssize_t nr = read(sp->fd, buf, directfd >= 0 ? 1 : sizeof(buf));
+    char msg[1024];
+    XMLEle **nodes;
+
+    if (nr <= 0)
+    {
+        if (nr < 0)
+            perror("read");
+        else
+            fprintf(stderr, "INDI server %s/%d disconnected\n", sp->host, sp->port);
+        doneServer(sp, 2);
+        return;
+    }
+
+    if (verbose > 2)
+        fprintf(stderr, "Read %.*s\n", (int)nr, buf);
+
+    nodes = parseXMLChunk(sp->lp, buf, nr, msg);
+    if (!nodes)
+    {
+        fprintf(stderr, "Bad XML from %s/%d: %s\n", sp->host, sp->port, msg);
+        doneServer(sp, 2);
+        return;
+    }
+
+    svr = sp;
+    for (int i = 0; nodes[i]; i++)
+    {
+        XMLEle *root = nodes[i];
+        if (sp->status < 0)
         {
             /* found a complete XML element */
             if (verbose > 1)
                 prXMLEle(stderr, root, 0);
             findDPE(root);
-            if (finished() == 0)
-                exit(0);     /* found all we want */
-            delXMLEle(root); /* not yet, delete and continue */
-        }
-        else if (msg[0])
-        {
-            fprintf(stderr, "Bad XML from %s/%d: %s\n", host, port, msg);
-            exit(2);
+            if (finished(sp) == 0)
+                doneServer(sp, 0); /* found all we want */
         }
+        delXMLEle(root);
     }
+    free(nodes);
 }
 
-/* return 0 if we are sure we have everything we are looking for, else -1 */
-static int finished()
+/* return 0 if we are sure we have everything we are looking for from sp, else -1 */
+static int finished(Server *sp)
 {
     int i;
 
@@ -387,49 +581,53 @@ static int finished()
         return (-1);
 
     for (i = 0; i < nsrchs; i++)
-        if (srchs[i].wc || !srchs[i].ok)
+        if (srchs[i].wc || !sp->ok[i])
             return (-1);
     return (0);
 }
 
+/* stop talking to sp, status is what it adds to our exit status */
+static void doneServer(Server *sp, int status)
+{
+    if (sp->fd >= 0 && sp->fd != directfd)
+        close(sp->fd);
+    sp->fd     = -1;
+    sp->status = status;
+    fflush(stdout);
+}
+
 /* called after timeout seconds either because we are matching wild cards or
  * there is something still not found
  */
-static void onAlarm(int dummy)
+static void onTimeout(Server *sp)
 {
-    (void)dummy;
     int trouble = 0;
 
     for (int i = 0; i < nsrchs; i++)
     {
-        if (!srchs[i].ok)
+        if (!sp->ok[i])
         {
             trouble = 1;
-            fprintf(stderr, "No %s.%s.%s from %s:%d\n", srchs[i].d, srchs[i].p, srchs[i].e, host, port);
+            fprintf(stderr, "No %s.%s.%s from %s:%d\n", srchs[i].d, srchs[i].p, srchs[i].e, sp->host, sp->port);
         }
     }
 
-    exit(trouble ? 1 : 0);
+    doneServer(sp, trouble ? 1 : 0);
 }
 
-/* read one char from svrrfp */
-static int readServerChar()
+/* monotonic time, secs */
+static double now()
 {
-    int c = fgetc(svrrfp);
-
-    if (c == EOF)
-    {
-        if (ferror(svrrfp))
-            perror("read");
-        else
-            fprintf(stderr, "INDI server %s/%d disconnected\n", host, port);
-        exit(2);
-    }
-
-    if (verbose > 2)
-        fprintf(stderr, "Read %c\n", c);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-    return (c);
+/* name the server of the next output line when there are several */
+static void prServer()
+{
+    if (nservers > 1)
+        printf("%s:%d/", svr->host, svr->port);
 }
 
 /* print value if root is any srchs[] we are looking for*/
@@ -472,7 +670,7 @@ static void findDPE(XMLEle *root)
                             if (onematch)
                                 return; /* only one can match */
                             if (!strncmp(defs[j].vec, "def", 3))
-                                alarm(timeout); /* reset timer if def */
+                                svr->deadline = now() + timeout; /* reset timer if def */
                         }
                     }
                 }
@@ -496,7 +694,8 @@ static void findEle(XMLEle *root, char *dev, char *nam, char *defone, SearchDef
         {
             /* just print the property state, not the element values */
             char *s = (char *)findXMLAttValu(root, kwattr[i].indiattr);
-            sp->ok  = 1; /* progress */
+            svr->ok[sp - srchs] = 1; /* progress */
+            prServer();
             if (onematch && justvalue)
                 printf("%s\n", s);
             else
@@ -516,13 +715,19 @@ static void findEle(XMLEle *root, char *dev, char *nam, char *defone, SearchDef
             {
                 /* found it! */
                 char *p = pcdataXMLEle(ep);
-                sp->ok  = 1; /* progress */
+                svr->ok[sp - srchs] = 1; /* progress */
                 if (!strcmp(defone, "oneBLOB"))
                     oneBLOB(ep, dev, nam, enam, p, pcdatalenXMLEle(ep));
                 else if (onematch && justvalue)
+                {
+                    prServer();
                     printf("%s\n", p);
+                }
                 else
+                {
+                    prServer();
                     printf("%s.%s.%s=%s\n", dev, nam, enam, p);
+                }
                 if (onematch)
                     return; /* only one can match*/
             }
@@ -530,14 +735,13 @@ static void findEle(XMLEle *root, char *dev, char *nam, char *defone, SearchDef
     }
 }
 
-/* send server command to svrwfp that enables blobs for the given dev nam
+/* send server command to svr that enables blobs for the given dev nam
  */
 static void enableBLOBs(char *dev, char *nam)
 {
     if (verbose)
         fprintf(stderr, "sending enableBLOB %s.%s\n", dev, nam);
-    fprintf(svrwfp, "<enableBLOB device='%s' name='%s'>Also</enableBLOB>\n", dev, nam);
-    fflush(svrwfp);
+    sendServer(svr, "<enableBLOB device='%s' name='%s'>Also</enableBLOB>\n", dev, nam);
 }
 
 /* given a oneBLOB, save
@@ -550,8 +754,8 @@ static void oneBLOB(XMLEle *root, char *dev, char *nam, char *enam, char *p, int
     unsigned char *blob;
     int ucs;
     int isz;
-    char fn[128];
-    int i;
+    char fn[256];
+    int i = 0;
 
     /* get uncompressed size */
     ucs = atoi(findXMLAttValu(root, "size"));
@@ -588,7 +792,9 @@ static void oneBLOB(XMLEle *root, char *dev, char *nam, char *enam, char *p, int
     }
 
     /* rig up a file name from property name */
-    i = sprintf(fn, "%s.%s.%s%s", dev, nam, enam, format);
+    if (nservers > 1)
+        i = sprintf(fn, "%s:%d.", svr->host, svr->port);
+    i += sprintf(fn + i, "%s.%s.%s%s", dev, nam, enam, format);
     if (isz)
         fn[i - 2] = '\0'; /* chop off .z */
 